@@ -14,13 +14,16 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include "tensorrt_llm/batch_manager/packedEncoderBatcher.h"
 #include "tensorrt_llm/common/memoryUtils.h"
 #include "tensorrt_llm/plugins/api/tllmPlugin.h"
+#include "tensorrt_llm/runtime/encoderOnlyRunner.h"
 #include "tensorrt_llm/runtime/iTensor.h"
 #include "tensorrt_llm/runtime/rawEngine.h"
 #include "tensorrt_llm/runtime/tllmLogger.h"
 #include "tensorrt_llm/runtime/tllmRuntime.h"
 #include "tensorrt_llm/runtime/worldConfig.h"
+#include "utils/utils.h"
 
 #include <NvInfer.h>
 #include <chrono>
@@ -29,6 +32,7 @@
 #include <fstream>
 #include <iostream>
 #include <nlohmann/json.hpp>
+#include <random>
 #include <sstream>
 #include <string>
 
@@ -141,6 +145,78 @@ void benchmarkBert(std::string const& modelName, std::filesystem::path const& da
             }
         }
     }
+    if (worldConfig.getRank() == 0)
+    {
+        tensorrt_llm::benchmark::reportMemoryCounterPeaks();
+    }
+}
+
+// Requests of random lengths up to each input length, packed into batches of maxNumTokens by the PackedEncoderBatcher
+// and run on an engine built with remove_input_padding.
+void benchmarkPackedBert(std::string const& modelName, std::filesystem::path const& dataPath,
+    std::vector<int> const& batchSizes, std::vector<int> const& inLens, int maxNumTokens, int numRequests,
+    EncoderOnlyRunner::PoolingMode pooling, std::shared_ptr<nvinfer1::ILogger> const& logger, int warmUp)
+{
+    using tensorrt_llm::batch_manager::PackedEncoderBatcher;
+
+    auto const worldConfig = WorldConfig::mpi();
+    auto const enginePath = dataPath / engineFilename(dataPath, worldConfig, modelName);
+    EncoderOnlyRunner::Config config;
+    config.pooling = pooling;
+    EncoderOnlyRunner runner{RawEngine(enginePath), logger.get(), config};
+
+    for (auto const inLen : inLens)
+    {
+        for (auto const maxBatchSize : batchSizes)
+        {
+            std::mt19937 gen(0);
+            std::uniform_int_distribution<SizeType32> lengthDist(1, std::min(inLen, maxNumTokens));
+            auto enqueueRequests = [&](PackedEncoderBatcher& batcher, int count)
+            {
+                SizeType32 numTokens = 0;
+                for (int ri = 0; ri < count; ++ri)
+                {
+                    PackedEncoderBatcher::Request request;
+                    request.requestId = static_cast<PackedEncoderBatcher::RequestIdType>(ri);
+                    request.inputTokens.assign(lengthDist(gen), 0);
+                    numTokens += static_cast<SizeType32>(request.inputTokens.size());
+                    batcher.enqueue(std::move(request));
+                }
+                return numTokens;
+            };
+
+            PackedEncoderBatcher warmUpBatcher{maxNumTokens, maxBatchSize};
+            enqueueRequests(warmUpBatcher, warmUp * maxBatchSize);
+            while (auto const batch = warmUpBatcher.nextBatch())
+            {
+                [[maybe_unused]] auto const outputs = runner.run(*batch);
+            }
+
+            PackedEncoderBatcher batcher{maxNumTokens, maxBatchSize};
+            auto const numTokens = enqueueRequests(batcher, numRequests);
+            int numBatches = 0;
+            auto const start = std::chrono::steady_clock::now();
+            while (auto const batch = batcher.nextBatch())
+            {
+                [[maybe_unused]] auto const outputs = runner.run(*batch);
+                ++numBatches;
+            }
+            auto const end = std::chrono::steady_clock::now();
+            auto const seconds = std::chrono::duration<float>(end - start).count();
+
+            if (worldConfig.getRank() == 0)
+            {
+                printf("[BENCHMARK] max_batch_size %d max_input_length %d max_num_tokens %d num_batches %d "
+                       "latency(ms) %.2f sequences_per_sec %.2f tokens_per_sec %.2f\n",
+                    maxBatchSize, inLen, maxNumTokens, numBatches, seconds * 1000 / std::max(numBatches, 1),
+                    numRequests / seconds, numTokens / seconds);
+            }
+        }
+    }
+    if (worldConfig.getRank() == 0)
+    {
+        tensorrt_llm::benchmark::reportMemoryCounterPeaks();
+    }
 }
 
 } // namespace
@@ -175,6 +251,15 @@ int main(int argc, char* argv[])
         "example: \"0.0;0.5;1.0\".",
         cxxopts::value<std::string>()->default_value("1.0"));
 
+    options.add_options()("max_num_tokens",
+        "Pack requests of random lengths up to the input length into batches of at most this many tokens, with an "
+        "engine built with remove_input_padding. 0 runs fixed padded batches.",
+        cxxopts::value<int>()->default_value("0"));
+    options.add_options()("num_requests", "Number of requests of the packed benchmark.",
+        cxxopts::value<int>()->default_value("1024"));
+    options.add_options()("pooling", "Output of the packed benchmark, one of cls/mean/none.",
+        cxxopts::value<std::string>()->default_value("cls"));
+
     auto result = options.parse(argc, argv);
 
     if (result.count("help"))
@@ -255,8 +340,31 @@ int main(int argc, char* argv[])
     }
     initTrtLlmPlugins(logger.get());
 
+    auto const maxNumTokens = result["max_num_tokens"].as<int>();
+    auto pooling = EncoderOnlyRunner::PoolingMode::kCls;
+    auto const poolingArg = result["pooling"].as<std::string>();
+    if (poolingArg == "mean")
+    {
+        pooling = EncoderOnlyRunner::PoolingMode::kMean;
+    }
+    else if (poolingArg == "none")
+    {
+        pooling = EncoderOnlyRunner::PoolingMode::kNone;
+    }
+    else if (poolingArg != "cls")
+    {
+        TLLM_LOG_ERROR("Unexpected pooling: " + poolingArg);
+        return 1;
+    }
+
     try
     {
+        if (maxNumTokens > 0)
+        {
+            benchmarkPackedBert(result["model"].as<std::string>(), result["engine_dir"].as<std::string>(), batchSizes,
+                inLens, maxNumTokens, result["num_requests"].as<int>(), pooling, logger, result["warm_up"].as<int>());
+            return 0;
+        }
         benchmarkBert(result["model"].as<std::string>(), result["engine_dir"].as<std::string>(), batchSizes, inLens,
             gpuWeightsPercents, logger, result["warm_up"].as<int>(), result["num_runs"].as<int>(),
             result["duration"].as<int>());
@@ -20,6 +20,7 @@
 #include "tensorrt_llm/batch_manager/common.h"
 #include "tensorrt_llm/batch_manager/llmRequest.h"
 #include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/dataType.h"
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/mpiUtils.h"
 #include "tensorrt_llm/common/stringUtils.h"
@@ -35,17 +36,21 @@
 #include "tensorrt_llm/runtime/worldConfig.h"
 #include "utils/utils.h"
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <cstdio>
+#include <deque>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <nlohmann/json.hpp>
 #include <numeric>
 #include <optional>
 #include <random>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -69,7 +74,7 @@ class Recorder
 public:
     explicit Recorder(std::string opCsvFile, bool streaming = false, int beamWidth = 1,
         bool calculateKvCacheTransferTime = true, bool calculateQueueTime = true, std::string responsesJsonFile = "",
-        bool excludeInputInOutput = false)
+        bool excludeInputInOutput = false, bool calculatePhases = false)
         : mOpCsvFile(std::move(opCsvFile))
         , mStreaming(streaming)
         , mBeamWidth(beamWidth)
@@ -77,8 +82,32 @@ public:
         , mOutputHasInput(!excludeInputInOutput)
         , mCalculateKVCacheTransferTime(calculateKvCacheTransferTime)
         , mCalculateQueueTime(calculateQueueTime)
-    {
-    }
+        , mCalculatePhases(calculatePhases)
+    {
+    }
+
+    //! \brief The phases of a disaggregated request, measured from the perf metrics of its context and generation
+    //! responses and from the orchestrator timestamps. The executors timestamps are steady clock times of other
+    //! processes, comparable only with all the instances on the same node.
+    enum Phase : int
+    {
+        // From the arrival to the first scheduling on the context instance
+        kCONTEXT_QUEUE = 0,
+        // From the first scheduling to the first token on the context instance
+        kPREFILL,
+        // From the first token to the context response received by the orchestrator, with the context phase params
+        kCONTEXT_RESPONSE,
+        // Delay added by --network_bandwidth_gbps before the generation request is enqueued
+        kEMULATED_NETWORK,
+        // From the enqueue of the generation request to its arrival on the generation instance
+        kGEN_DISPATCH,
+        // From the arrival on the generation instance to the start of the KV cache transfer
+        kGEN_RECEIVE_WAIT,
+        kKV_TRANSFER,
+        // From the end of the KV cache transfer to the first generated token
+        kFIRST_DECODE,
+        kNUM_PHASES
+    };
 
     void initialize()
     {
@@ -92,6 +121,16 @@ public:
         mContextReqQueuingLatency.mDataTimes.clear();
         mGenReqQueuingLatency.mDataTimes.clear();
         mGenReqKvCacheTransferLatency.mDataTimes.clear();
+        for (auto& phaseLatency : mPhaseLatencies)
+        {
+            phaseLatency.mDataTimes.clear();
+        }
+        mRequestBenchInfos.clear();
+    }
+
+    void setOpCsvFile(std::string opCsvFile)
+    {
+        mOpCsvFile = std::move(opCsvFile);
     }
 
     void finalize()
@@ -131,6 +170,21 @@ public:
         mRequestBenchInfos.at(requestId).decodingIter += 1;
     }
 
+    void recordContextEnd(tensorrt_llm::executor::IdType requestId, texec::Response const& response)
+    {
+        recordContextEnd(requestId, response.hasError());
+        if (!response.hasError() && response.getResult().requestPerfMetrics.has_value())
+        {
+            mRequestBenchInfos.at(requestId).contextTiming = response.getResult().requestPerfMetrics->timingMetrics;
+        }
+    }
+
+    void recordEmulatedTransfer(tensorrt_llm::executor::IdType requestId, float latency)
+    {
+        TLLM_CHECK(mRequestBenchInfos.find(requestId) != mRequestBenchInfos.end());
+        mRequestBenchInfos.at(requestId).emulatedTransferLatency = latency;
+    }
+
     void recordToken(tensorrt_llm::executor::IdType requestId)
     {
         TLLM_CHECK(mStreaming);
@@ -182,6 +236,10 @@ public:
         recordGenEnd(requestId, response.hasError());
         if (!response.hasError())
         {
+            if (response.getResult().requestPerfMetrics.has_value())
+            {
+                mRequestBenchInfos[requestId].genTiming = response.getResult().requestPerfMetrics->timingMetrics;
+            }
             if (!mStreaming)
             {
                 TLLM_LOG_DEBUG("response.getResult().outputTokenIds");
@@ -247,6 +305,10 @@ public:
                         / static_cast<float>(reqInfo.second.outputLength - 2);
                 }
             }
+            if (mCalculatePhases)
+            {
+                calculatePhaseLatencies(reqInfo.second);
+            }
         }
     }
 
@@ -344,6 +406,30 @@ public:
         {
             mGenReqKvCacheTransferLatency.calculate();
         }
+        if (mCalculatePhases)
+        {
+            for (auto const& reqInfo : mRequestBenchInfos)
+            {
+                if (reqInfo.second.contextHasError || reqInfo.second.genHasError)
+                {
+                    continue;
+                }
+                for (int phase = 0; phase < kNUM_PHASES; ++phase)
+                {
+                    if (reqInfo.second.phaseLatencies.at(phase).has_value())
+                    {
+                        mPhaseLatencies.at(phase).mDataTimes.push_back(reqInfo.second.phaseLatencies.at(phase).value());
+                    }
+                }
+            }
+            for (auto& phaseLatency : mPhaseLatencies)
+            {
+                if (!phaseLatency.mDataTimes.empty())
+                {
+                    phaseLatency.calculate();
+                }
+            }
+        }
     }
 
     void report()
@@ -379,6 +465,16 @@ public:
         {
             mGenReqKvCacheTransferLatency.report();
         }
+        if (mCalculatePhases)
+        {
+            for (auto const& phaseLatency : mPhaseLatencies)
+            {
+                if (!phaseLatency.mDataTimes.empty())
+                {
+                    phaseLatency.report();
+                }
+            }
+        }
     }
 
     void writeOpMetricsToCsv()
@@ -415,6 +511,15 @@ public:
                 headers.insert(headers.end(), std::make_move_iterator(genReqKVCacheTransferHeader.begin()),
                     std::make_move_iterator(genReqKVCacheTransferHeader.end()));
             }
+            if (mCalculatePhases)
+            {
+                for (auto const& phaseLatency : mPhaseLatencies)
+                {
+                    auto phaseHeader = phaseLatency.genHeaders();
+                    headers.insert(headers.end(), std::make_move_iterator(phaseHeader.begin()),
+                        std::make_move_iterator(phaseHeader.end()));
+                }
+            }
 
             std::ofstream outputFile(mOpCsvFile);
 
@@ -439,6 +544,13 @@ public:
                 {
                     outputFile << "," << mGenReqKvCacheTransferLatency;
                 }
+                if (mCalculatePhases)
+                {
+                    for (auto const& phaseLatency : mPhaseLatencies)
+                    {
+                        outputFile << "," << phaseLatency;
+                    }
+                }
 
                 outputFile << "\n";
             }
@@ -477,8 +589,34 @@ private:
         std::optional<float> avgGenExcludeFirstIterT2TLatency;
         bool genFirstTokenSeen{false};
         SizeType32 decodingIter{0};
+        std::optional<texec::RequestPerfMetrics::TimingMetrics> contextTiming;
+        std::optional<texec::RequestPerfMetrics::TimingMetrics> genTiming;
+        std::optional<float> emulatedTransferLatency;
+        std::array<std::optional<float>, kNUM_PHASES> phaseLatencies;
     };
 
+    static void calculatePhaseLatencies(BenchInfo& info)
+    {
+        auto const toMs = [](auto const& start, auto const& end)
+        { return std::chrono::duration<float, std::milli>(end - start).count(); };
+        if (info.contextTiming.has_value())
+        {
+            auto const& timing = info.contextTiming.value();
+            info.phaseLatencies.at(kCONTEXT_QUEUE) = toMs(timing.arrivalTime, timing.firstScheduledTime);
+            info.phaseLatencies.at(kPREFILL) = toMs(timing.firstScheduledTime, timing.firstTokenTime);
+            info.phaseLatencies.at(kCONTEXT_RESPONSE) = toMs(timing.firstTokenTime, info.contextEnd);
+        }
+        info.phaseLatencies.at(kEMULATED_NETWORK) = info.emulatedTransferLatency;
+        if (info.genTiming.has_value())
+        {
+            auto const& timing = info.genTiming.value();
+            info.phaseLatencies.at(kGEN_DISPATCH) = toMs(info.genStart, timing.arrivalTime);
+            info.phaseLatencies.at(kGEN_RECEIVE_WAIT) = toMs(timing.arrivalTime, timing.kvCacheTransferStart);
+            info.phaseLatencies.at(kKV_TRANSFER) = toMs(timing.kvCacheTransferStart, timing.kvCacheTransferEnd);
+            info.phaseLatencies.at(kFIRST_DECODE) = toMs(timing.kvCacheTransferEnd, timing.firstTokenTime);
+        }
+    }
+
     std::unordered_map<uint64_t, BenchInfo> mRequestBenchInfos;
 
     std::chrono::time_point<std::chrono::steady_clock> mStart;
@@ -499,6 +637,9 @@ private:
 
     RecordTimeMetric mGenReqQueuingLatency{"gen_req_queueing_latency"};
     RecordTimeMetric mGenReqKvCacheTransferLatency{"gen_req_kv_cache_transfer_latency"};
+    std::vector<RecordTimeMetric> mPhaseLatencies{{"phase_context_queue_latency"}, {"phase_prefill_latency"},
+        {"phase_context_response_latency"}, {"phase_emulated_network_latency"}, {"phase_gen_dispatch_latency"},
+        {"phase_gen_receive_wait_latency"}, {"phase_kv_transfer_latency"}, {"phase_first_decode_latency"}};
 
     float mTokenThroughput{};
     float mAcceptanceRate{};
@@ -511,6 +652,7 @@ private:
     bool mOutputHasInput;
     bool mCalculateKVCacheTransferTime;
     bool mCalculateQueueTime;
+    bool mCalculatePhases;
     float mAvgUserTokensPerSecond{};
 };
 
@@ -519,10 +661,11 @@ texec::Request makeExecutorContextRequest(Sample const& sample, SizeType32 const
     bool const& returnContextLogits = false, bool const& returnGenerationLogits = false,
     std::optional<texec::LoraConfig> const& loraConfig = std::nullopt,
     std::optional<texec::LookaheadDecodingConfig> const& lookaheadConfig = std::nullopt,
-    std::optional<texec::VecTokens> const& encoderInputTokenIds = std::nullopt)
+    std::optional<texec::VecTokens> const& encoderInputTokenIds = std::nullopt, bool returnPerfMetrics = false)
 {
     auto samplingConfig = texec::SamplingConfig{beamWidth};
-    auto outputConfig = texec::OutputConfig{false, returnContextLogits, returnGenerationLogits, false};
+    auto outputConfig
+        = texec::OutputConfig{false, returnContextLogits, returnGenerationLogits, false, false, returnPerfMetrics};
     auto request
         = texec::Request(sample.inputIds, sample.outputLen, streaming, samplingConfig, outputConfig, eosId, padId,
             std::nullopt,    // positionIds
@@ -726,7 +869,7 @@ public:
                 }
                 if (!warmup)
                 {
-                    mRecorder->recordContextEnd(response.gid, response.response.hasError());
+                    mRecorder->recordContextEnd(response.gid, response.response);
                 }
                 ret.emplace_back(std::move(response));
             }
@@ -924,6 +1067,120 @@ private:
     std::atomic<uint64_t> mNumContextActive{0};
 };
 
+//! \brief The instance sweep and the network emulation of the benchmark.
+struct DisaggSweepParams
+{
+    //! \brief Report the phases of the requests, from their perf metrics.
+    bool phaseBreakdown{false};
+    //! \brief The (context, generation) instance counts to run one after the other, the first instances of each kind.
+    std::vector<std::pair<SizeType32, SizeType32>> instanceRatios;
+    std::optional<double> networkBandwidthGbps;
+    std::size_t kvBytesPerToken{0};
+};
+
+//! \brief Emulates a network link of limited bandwidth between the context and the generation instances. The KV cache
+//! of a request is sent once the ones of the requests before it are, and its generation request is enqueued when it
+//! is received. The emulated delay adds to the actual KV cache transfer of the executors.
+class EmulatedKvLink
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using SendCallback = std::function<void(std::vector<texec::Request>&&, std::vector<texec::IdType>&&)>;
+
+    EmulatedKvLink(double bandwidthGbps, std::size_t kvBytesPerToken, std::shared_ptr<Recorder> recorder,
+        SendCallback send)
+        : mBytesPerSecond(bandwidthGbps * 1e9 / 8)
+        , mKvBytesPerToken(kvBytesPerToken)
+        , mRecorder(std::move(recorder))
+        , mSend(std::move(send))
+        , mThread(&EmulatedKvLink::run, this)
+    {
+    }
+
+    ~EmulatedKvLink()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mShutdown = true;
+        }
+        mCv.notify_all();
+        mThread.join();
+    }
+
+    EmulatedKvLink(EmulatedKvLink const&) = delete;
+    EmulatedKvLink& operator=(EmulatedKvLink const&) = delete;
+
+    void submit(std::vector<texec::Request>&& requests, std::vector<texec::IdType> const& gids)
+    {
+        TLLM_CHECK(requests.size() == gids.size());
+        auto const now = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (std::size_t i = 0; i < requests.size(); ++i)
+            {
+                auto const bytes = static_cast<double>(requests[i].getInputTokenIds().size() * mKvBytesPerToken);
+                mLinkFreeTime = std::max(mLinkFreeTime, now)
+                    + std::chrono::duration_cast<Clock::duration>(
+                        std::chrono::duration<double>(bytes / mBytesPerSecond));
+                mRecorder->recordEmulatedTransfer(
+                    gids[i], std::chrono::duration<float, std::milli>(mLinkFreeTime - now).count());
+                mPending.push_back(Transfer{mLinkFreeTime, std::move(requests[i]), gids[i]});
+            }
+        }
+        mCv.notify_one();
+    }
+
+private:
+    struct Transfer
+    {
+        Clock::time_point received;
+        texec::Request request;
+        texec::IdType gid;
+    };
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true)
+        {
+            mCv.wait(lock, [this]() { return mShutdown || !mPending.empty(); });
+            if (mShutdown)
+            {
+                return;
+            }
+            // The transfers are received in order, the later submissions cannot be received earlier.
+            if (mCv.wait_until(lock, mPending.front().received, [this]() { return mShutdown; }))
+            {
+                return;
+            }
+            std::vector<texec::Request> requests;
+            std::vector<texec::IdType> gids;
+            auto const now = Clock::now();
+            while (!mPending.empty() && mPending.front().received <= now)
+            {
+                requests.emplace_back(std::move(mPending.front().request));
+                gids.push_back(mPending.front().gid);
+                mPending.pop_front();
+            }
+            lock.unlock();
+            mSend(std::move(requests), std::move(gids));
+            lock.lock();
+        }
+    }
+
+    double const mBytesPerSecond;
+    std::size_t const mKvBytesPerToken;
+    std::shared_ptr<Recorder> mRecorder;
+    SendCallback mSend;
+
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    std::deque<Transfer> mPending;
+    Clock::time_point mLinkFreeTime{};
+    bool mShutdown{false};
+    std::thread mThread;
+};
+
 } // namespace
 
 void benchmark(std::vector<std::filesystem::path> const& contextEngineDirs,
@@ -933,7 +1190,8 @@ void benchmark(std::vector<std::filesystem::path> const& contextEngineDirs,
     std::optional<int32_t> const& padId, BenchmarkParams const& benchmarkParams,
     texec::CapacitySchedulerPolicy capacitySchedulerPolicy, std::chrono::milliseconds waitSleep,
     bool returnContextLogits, bool returnGenerationLogits, std::optional<int> const staticEmulatedBatchSize,
-    bool logIterationData, std::optional<SizeType32> const maxPromptLen, bool hasContextAwait, bool hasGenAwait)
+    bool logIterationData, std::optional<SizeType32> const maxPromptLen, bool hasContextAwait, bool hasGenAwait,
+    DisaggSweepParams const& sweepParams)
 {
 
     auto const& world = tensorrt_llm::mpi::MpiComm::world();
@@ -943,7 +1201,8 @@ void benchmark(std::vector<std::filesystem::path> const& contextEngineDirs,
     auto const samples = parseWorkloadJson(datasetPath, maxNumSamples, maxPromptLen);
     auto const numSamples = samples.size();
     auto recorder = std::make_shared<Recorder>(opCsvFile, benchmarkParams.streaming, beamWidth,
-        benchmarkParams.enableCollectkvCacheTransferTime, benchmarkParams.enableCollectIterStats);
+        benchmarkParams.enableCollectkvCacheTransferTime, benchmarkParams.enableCollectIterStats, "", false,
+        sweepParams.phaseBreakdown);
     auto disaggExecutor = std::make_shared<DisaggExecutorServer>(contextEngineDirs, generationEngineDirs,
         deviceIdsForInstances, beamWidth, capacitySchedulerPolicy, benchmarkParams, recorder, waitSleep,
         logIterationData, hasContextAwait, hasGenAwait);
@@ -1022,7 +1281,68 @@ void benchmark(std::vector<std::filesystem::path> const& contextEngineDirs,
             TLLM_LOG_INFO("Warmup done");
         }
 
+        auto const numContextInstances = static_cast<SizeType32>(contextEngineDirs.size());
+        auto const numGenInstances = static_cast<SizeType32>(generationEngineDirs.size());
+        auto sweepPoints = sweepParams.instanceRatios;
+        if (sweepPoints.empty())
+        {
+            sweepPoints.emplace_back(numContextInstances, numGenInstances);
+        }
+        auto const isSweep = !sweepParams.instanceRatios.empty();
+
+        // The instances of each kind are selected round-robin among the first ones of the sweep point, or by the
+        // orchestrator without a sweep.
+        SizeType32 numActiveContext{numContextInstances};
+        SizeType32 numActiveGen{numGenInstances};
+        std::size_t nextContextIdx{0};
+        std::size_t nextGenIdx{0};
+        auto const selectContext = [&]() -> std::optional<int>
+        {
+            if (!isSweep)
+            {
+                return std::nullopt;
+            }
+            return static_cast<int>(nextContextIdx++ % numActiveContext);
+        };
+        auto const enqueueGeneration
+            = [&](std::vector<texec::Request>&& requests, std::vector<tensorrt_llm::executor::IdType>&& gids)
         {
+            if (!isSweep)
+            {
+                disaggExecutor->enqueueGeneration(requests, gids);
+                return;
+            }
+            for (std::size_t i = 0; i < requests.size(); ++i)
+            {
+                disaggExecutor->enqueueGeneration(
+                    {requests[i]}, {gids[i]}, static_cast<int>(nextGenIdx++ % numActiveGen));
+            }
+        };
+        std::optional<EmulatedKvLink> kvLink;
+        if (sweepParams.networkBandwidthGbps.has_value())
+        {
+            kvLink.emplace(sweepParams.networkBandwidthGbps.value(), sweepParams.kvBytesPerToken, recorder,
+                enqueueGeneration);
+        }
+        auto const dispatchGeneration
+            = [&](std::vector<texec::Request>&& requests, std::vector<tensorrt_llm::executor::IdType>&& gids)
+        {
+            if (kvLink.has_value())
+            {
+                kvLink->submit(std::move(requests), gids);
+            }
+            else
+            {
+                enqueueGeneration(std::move(requests), std::move(gids));
+            }
+        };
+
+        for (auto const& [numContext, numGen] : sweepPoints)
+        {
+            numActiveContext = numContext;
+            numActiveGen = numGen;
+            nextContextIdx = 0;
+            nextGenIdx = 0;
 
             auto timeDelays = computeTimeDelays(benchmarkParams, numSamples - 1);
 
@@ -1033,7 +1353,7 @@ void benchmark(std::vector<std::filesystem::path> const& contextEngineDirs,
                 std::optional<texec::LoraConfig> loraConfig = std::nullopt;
                 contextRequests.emplace_back(makeExecutorContextRequest(samples[i], beamWidth, eosId, padId,
                     benchmarkParams.streaming, returnContextLogits, returnGenerationLogits, loraConfig,
-                    benchmarkParams.requestLookaheadConfig));
+                    benchmarkParams.requestLookaheadConfig, std::nullopt, sweepParams.phaseBreakdown));
             }
 
             bool const hasDelay
@@ -1043,6 +1363,14 @@ void benchmark(std::vector<std::filesystem::path> const& contextEngineDirs,
 
             recorder->reserve(numSamples);
             recorder->initialize();
+            if (isSweep && !opCsvFile.empty())
+            {
+                std::filesystem::path const csvPath{opCsvFile};
+                auto const suffix = "_ctx" + std::to_string(numContext) + "_gen" + std::to_string(numGen);
+                recorder->setOpCsvFile(
+                    (csvPath.parent_path() / (csvPath.stem().string() + suffix + csvPath.extension().string()))
+                        .string());
+            }
             if (!staticEmulatedBatchSize)
             {
 
@@ -1059,12 +1387,11 @@ void benchmark(std::vector<std::filesystem::path> const& contextEngineDirs,
                             }
                             for (auto&& contextResponseWithId : contextResponseWithIds)
                             {
-                                recorder->recordContextEnd(
-                                    contextResponseWithId.gid, contextResponseWithId.response.hasError());
+                                recorder->recordContextEnd(contextResponseWithId.gid, contextResponseWithId.response);
                             }
                             numRequest -= contextResponseWithIds.size();
                             auto&& [genReqeust, genGids] = makeGenRequest(std::move(contextResponseWithIds));
-                            disaggExecutor->enqueueGeneration(genReqeust, genGids);
+                            dispatchGeneration(std::move(genReqeust), std::move(genGids));
                         }
                     }};
 
@@ -1075,7 +1402,8 @@ void benchmark(std::vector<std::filesystem::path> const& contextEngineDirs,
 
                     if (disaggExecutor->canEnqueue(numSentRequests))
                     {
-                        auto gids = disaggExecutor->enqueueContext({contextRequests.at(numSentRequests)});
+                        auto gids = disaggExecutor->enqueueContext(
+                            {contextRequests.at(numSentRequests)}, selectContext());
                         fillRequestMap(gids, {contextRequests.at(numSentRequests)});
 
                         if (hasDelay && numSentRequests < numSamples - 1)
@@ -1103,27 +1431,31 @@ void benchmark(std::vector<std::filesystem::path> const& contextEngineDirs,
                         std::make_move_iterator(contextRequests.begin() + req + static_cast<int64_t>(batchSize)));
                     // Enqueue in batches
 
-                    auto reqIds = disaggExecutor->enqueueContext(requestsBatch);
+                    auto reqIds = disaggExecutor->enqueueContext(requestsBatch, selectContext());
                     fillRequestMap(reqIds, std::move(requestsBatch));
                     auto contextResponse = disaggExecutor->waitForContextResponse(static_cast<SizeType32>(batchSize));
                     auto&& [genRequests, genReqIds] = makeGenRequest(std::move(contextResponse));
-                    disaggExecutor->enqueueGeneration(genRequests, genReqIds);
+                    dispatchGeneration(std::move(genRequests), std::move(genReqIds));
                     disaggExecutor->waitForGenResponse(static_cast<SizeType32>(batchSize));
 
                     // Wait for current batch to be done
                 }
             }
+            recorder->finalize();
+            // sleep for collect stats
+            if (benchmarkParams.enableCollectIterStats || benchmarkParams.enableCollectkvCacheTransferTime)
+            {
+                auto const collectWaitSleep = std::chrono::milliseconds(50);
+                std::this_thread::sleep_for(collectWaitSleep);
+            }
+            recorder->calculateMetrics();
+            if (isSweep)
+            {
+                printf("[BENCHMARK] context_instances %d generation_instances %d\n", numContext, numGen);
+            }
+            recorder->report();
+            recorder->writeOpMetricsToCsv();
         }
-        recorder->finalize();
-        // sleep for collect stats
-        if (benchmarkParams.enableCollectIterStats || benchmarkParams.enableCollectkvCacheTransferTime)
-        {
-            auto const collectWaitSleep = std::chrono::milliseconds(50);
-            std::this_thread::sleep_for(collectWaitSleep);
-        }
-        recorder->calculateMetrics();
-        recorder->report();
-        recorder->writeOpMetricsToCsv();
     }
 }
 
@@ -1232,6 +1564,20 @@ int main(int argc, char* argv[])
         cxxopts::value<bool>()->default_value("false"));
     options.add_options()("enable_collect_iter_stats", "When enabled, will collect iteration stats.",
         cxxopts::value<bool>()->default_value("false"));
+    options.add_options()("enable_phase_breakdown",
+        "When enabled, will report the latency of each phase of the requests from their perf metrics: context queue, "
+        "prefill, context response, generation dispatch, generation receive wait, KV cache transfer and first decode.",
+        cxxopts::value<bool>()->default_value("false"));
+    options.add_options()("instance_ratios",
+        "Run the benchmark once per number of context and generation instances, using the first ones of each kind, "
+        "example: \"1:1,1:2,2:1\"",
+        cxxopts::value<std::string>());
+    options.add_options()("network_bandwidth_gbps",
+        "Emulate a network link of this bandwidth shared by the KV cache transfers, delaying the generation requests.",
+        cxxopts::value<double>());
+    options.add_options()("kv_bytes_per_token",
+        "KV cache bytes per token sent over the emulated network, computed from the first context engine by default.",
+        cxxopts::value<size_t>());
 
     auto result = options.parse(argc, argv);
 
@@ -1565,8 +1911,53 @@ int main(int argc, char* argv[])
     {
         deviceIdsForInstance = parseVectorOfVectors(result["device_ids_for_instances"].as<std::string>());
     }
+
+    DisaggSweepParams sweepParams;
+    // Argument: enable_phase_breakdown
+    sweepParams.phaseBreakdown = result["enable_phase_breakdown"].as<bool>();
+    // Argument: instance_ratios
+    if (result.count("instance_ratios"))
+    {
+        std::istringstream ratios(result["instance_ratios"].as<std::string>());
+        std::string ratio;
+        while (std::getline(ratios, ratio, ','))
+        {
+            auto const sep = ratio.find(':');
+            TLLM_CHECK_WITH_INFO(sep != std::string::npos,
+                "Expected <context>:<generation> in --instance_ratios, got %s", ratio.c_str());
+            auto const numContext = std::stoi(ratio.substr(0, sep));
+            auto const numGen = std::stoi(ratio.substr(sep + 1));
+            TLLM_CHECK_WITH_INFO(numContext >= 1 && numContext <= static_cast<int>(contextEnigePaths.size())
+                    && numGen >= 1 && numGen <= static_cast<int>(generationEnginePaths.size()),
+                "--instance_ratios %s exceeds the %zu context and %zu generation engines", ratio.c_str(),
+                contextEnigePaths.size(), generationEnginePaths.size());
+            sweepParams.instanceRatios.emplace_back(numContext, numGen);
+        }
+    }
+    // Argument: network_bandwidth_gbps
+    if (result.count("network_bandwidth_gbps"))
+    {
+        sweepParams.networkBandwidthGbps = result["network_bandwidth_gbps"].as<double>();
+        TLLM_CHECK_WITH_INFO(sweepParams.networkBandwidthGbps.value() > 0, "--network_bandwidth_gbps must be positive");
+        if (result.count("kv_bytes_per_token"))
+        {
+            sweepParams.kvBytesPerToken = result["kv_bytes_per_token"].as<size_t>();
+        }
+        else
+        {
+            auto const modelConfig
+                = tensorrt_llm::runtime::GptJsonConfig::parse(contextEnigePaths.front() / "config.json")
+                      .getModelConfig();
+            auto const& numKvHeadsPerLayer = modelConfig.getNumKvHeadsPerLayer();
+            auto const numKvHeads = std::accumulate(numKvHeadsPerLayer.begin(), numKvHeadsPerLayer.end(), size_t{0});
+            // K and V of all the attention layers
+            sweepParams.kvBytesPerToken = 2 * numKvHeads * modelConfig.getSizePerHead()
+                * tensorrt_llm::common::getDTypeSize(modelConfig.getKvDataType());
+        }
+    }
+
     benchmark(contextEnigePaths, generationEnginePaths, deviceIdsForInstance, datasetPath, opCsvFile, maxNumSamples,
         beamWidth, result["warm_up"].as<int>(), eosId, padId, benchmarkParams, capacitySchedulerPolicy, waitSleep,
         returnContextLogits, returnContextLogits, staticEmulatedBatchSize, logIterationData, maxPromptLen,
-        hasContextAwait, hasGenAwait);
+        hasContextAwait, hasGenAwait, sweepParams);
 }
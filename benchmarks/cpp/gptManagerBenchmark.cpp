@@ -18,12 +18,14 @@
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/mpiUtils.h"
+#include "tensorrt_llm/common/startupTrace.h"
 #include "tensorrt_llm/executor/executor.h"
 #include "tensorrt_llm/executor/tensor.h"
 #include "tensorrt_llm/executor/types.h"
 #include "tensorrt_llm/plugins/api/tllmPlugin.h"
 #include "tensorrt_llm/runtime/common.h"
 #include "tensorrt_llm/runtime/gptJsonConfig.h"
+#include "tensorrt_llm/runtime/memoryCounters.h"
 #include "tensorrt_llm/runtime/tllmLogger.h"
 #include "tensorrt_llm/runtime/utils/numpyUtils.h"
 #include "tensorrt_llm/runtime/worldConfig.h"
@@ -32,6 +34,7 @@
 #include <chrono>
 #include <cstdint>
 #include <cxxopts.hpp>
+#include <fstream>
 #include <iostream>
 #include <memory>
 #include <nlohmann/json.hpp>
@@ -142,9 +145,10 @@ struct BenchInfo
 {
     BenchInfo() = default;
 
-    BenchInfo(int inputLength, std::chrono::time_point<std::chrono::steady_clock> start)
+    BenchInfo(int inputLength, std::chrono::time_point<std::chrono::steady_clock> start, RequestSlo slo = {})
         : inputLength(inputLength)
         , start(start)
+        , slo(std::move(slo))
     {
     }
 
@@ -159,6 +163,7 @@ struct BenchInfo
     std::optional<float> avgGenT2TLatency{};
     bool firstTokenSeen{false};
     SizeType32 decodingIter{0};
+    RequestSlo slo{};
 };
 
 class Recorder
@@ -196,13 +201,13 @@ public:
     //   - if eos_id == -1 (default behavior), this is correct since output seq will have max permissible length.
     //   - However, if eos_id != -1, the token size of output sequence may be less than max_output_len, and token
     //   throughput may be inaccurate
-    void recordStart(
-        SizeType32 inputLength, uint64_t requestId, std::chrono::time_point<std::chrono::steady_clock> const& start)
+    void recordStart(SizeType32 inputLength, uint64_t requestId,
+        std::chrono::time_point<std::chrono::steady_clock> const& start, RequestSlo const& slo = {})
     {
         TLLM_CHECK_WITH_INFO(mRequestBenchInfos.find(requestId) == mRequestBenchInfos.end(),
             "Request %lu already exists in record before start, please report a bug to developers.", requestId);
         const std::lock_guard<std::mutex> lock(mRequestBenchInfosMutex);
-        mRequestBenchInfos[requestId] = BenchInfo(inputLength, start);
+        mRequestBenchInfos[requestId] = BenchInfo(inputLength, start, slo);
     }
 
     void recordToken(
@@ -297,6 +302,36 @@ public:
         }
     }
 
+    //! \brief Whether a request met its SLOs. TTFT is only measured in streaming mode, it is not checked otherwise.
+    bool meetsSlo(BenchInfo const& reqInfo) const
+    {
+        if (reqInfo.hasError)
+        {
+            return false;
+        }
+        if (reqInfo.slo.e2eMs && reqInfo.latency > reqInfo.slo.e2eMs.value())
+        {
+            return false;
+        }
+        return !(mStreaming && reqInfo.slo.ttftMs && reqInfo.firstTokenLatency > reqInfo.slo.ttftMs.value());
+    }
+
+    void calculateGoodput()
+    {
+        mNumSloSamples = 0;
+        mNumSloMetSamples = 0;
+        for (auto const& reqInfo : mRequestBenchInfos)
+        {
+            if (reqInfo.second.slo.isSet())
+            {
+                ++mNumSloSamples;
+                mNumSloMetSamples += meetsSlo(reqInfo.second) ? 1 : 0;
+            }
+        }
+        mGoodput = mNumSloMetSamples / (mTotalLatency / 1000);
+        mSloAttainment = mNumSloSamples ? 100.F * mNumSloMetSamples / mNumSloSamples : 0.F;
+    }
+
     void calculateMetrics()
     {
         calculateLatencies();
@@ -345,6 +380,7 @@ public:
         mAcceptanceRate = totalDecodingIter
             ? (static_cast<float>(totalOutputTokens) / static_cast<float>(totalDecodingIter))
             : 0.0f;
+        calculateGoodput();
 
         mAvgSeqLatency = std::accumulate(reqLatencies.begin(), reqLatencies.end(), 0.F) / reqLatencies.size();
 
@@ -417,6 +453,14 @@ public:
         printf("[BENCHMARK] token_throughput(token/sec) %.2f\n", mTokenThroughput);
         printf("[BENCHMARK] avg_acceptance_rate(tokens/decoding steps) %.2f\n\n", mAcceptanceRate);
 
+        if (mNumSloSamples)
+        {
+            printf("[BENCHMARK] num_slo_samples %d\n", mNumSloSamples);
+            printf("[BENCHMARK] num_slo_met_samples %d\n", mNumSloMetSamples);
+            printf("[BENCHMARK] slo_attainment(%%) %.2f\n", mSloAttainment);
+            printf("[BENCHMARK] goodput(seq/sec) %.2f\n\n", mGoodput);
+        }
+
         printf("[BENCHMARK] avg_sequence_latency(ms) %.2f\n", mAvgSeqLatency);
         printf("[BENCHMARK] max_sequence_latency(ms) %.2f\n", mMaxSeqLatency);
         printf("[BENCHMARK] min_sequence_latency(ms) %.2f\n", mMinSeqLatency);
@@ -490,6 +534,12 @@ public:
 
                 headers.insert(headers.end(), streamingHeaders.begin(), streamingHeaders.end());
             }
+            if (mNumSloSamples)
+            {
+                std::vector<std::string> sloHeaders
+                    = {"num_slo_samples", "num_slo_met_samples", "slo_attainment(%)", "goodput(seq/sec)"};
+                headers.insert(headers.end(), sloHeaders.begin(), sloHeaders.end());
+            }
 
             std::ofstream outputFile(mOpCsvFile);
 
@@ -512,7 +562,12 @@ public:
                                << mP99GenT2TLatency << "," << mP90GenT2TLatency << "," << mP50GenT2TLatency << ","
                                << mAvgUserTokensPerSecond << "," << mMaxUserTokensPerSecond << ","
                                << mMinUserTokensPerSecond << "," << mP99UserTokensPerSecond << ","
-                               << mP90UserTokensPerSecond << "," << mP50UserTokensPerSecond << ",";
+                               << mP90UserTokensPerSecond << "," << mP50UserTokensPerSecond;
+                }
+                if (mNumSloSamples)
+                {
+                    outputFile << "," << mNumSloSamples << "," << mNumSloMetSamples << "," << mSloAttainment << ","
+                               << mGoodput;
                 }
 
                 outputFile << "\n";
@@ -597,6 +652,10 @@ private:
     float mMaxReqQueueingLatency{};
     float mMinReqQueueingLatency{};
     std::vector<float> mRequestsQueueingLatencies{};
+    int mNumSloSamples{};
+    int mNumSloMetSamples{};
+    float mSloAttainment{};
+    float mGoodput{};
 
     std::string mOpCsvFile;
     bool mStreaming;
@@ -669,6 +728,7 @@ public:
             benchmarkParams.medusaChoices, benchmarkParams.eagleConfig));
         executorConfig.setExtendedRuntimePerfKnobConfig(extendedRuntimePerfKnobConfig);
 
+        TLLM_STARTUP_PHASE("executor_construction");
         if (executorModelType == texec::ModelType::kDECODER_ONLY)
         {
             mExecutor
@@ -706,7 +766,7 @@ public:
         }
     }
 
-    void enqueue(std::vector<texec::Request> requests, bool warmup = false)
+    void enqueue(std::vector<texec::Request> requests, bool warmup = false, std::vector<RequestSlo> const& slos = {})
     {
         try
         {
@@ -721,7 +781,8 @@ public:
             {
                 if (!warmup)
                 {
-                    mRecorder->recordStart(inputLengths.at(req), reqIds.at(req), start);
+                    mRecorder->recordStart(
+                        inputLengths.at(req), reqIds.at(req), start, slos.empty() ? RequestSlo{} : slos.at(req));
                 }
                 mActiveCount++;
             }
@@ -819,7 +880,10 @@ texec::Request makeExecutorRequest(Sample const& sample, SizeType32 const& beamW
     std::optional<float> temperature = std::nullopt)
 {
     auto samplingConfig = texec::SamplingConfig{beamWidth};
-    samplingConfig.setTemperature(temperature);
+    // The sampling params of a trace request override the ones of the benchmark
+    samplingConfig.setTemperature(sample.temperature ? sample.temperature : temperature);
+    samplingConfig.setTopK(sample.topK);
+    samplingConfig.setTopP(sample.topP);
     auto outputConfig = texec::OutputConfig{false, returnContextLogits, returnGenerationLogits, false};
     return texec::Request(sample.inputIds, sample.outputLen, streaming, samplingConfig, outputConfig, eosId, padId,
         std::nullopt,    // positionIds
@@ -849,7 +913,9 @@ void benchmarkExecutor(std::optional<std::filesystem::path> const& decoderEngine
     auto worldRank = world.getRank();
 
     // Load dataset
-    auto const samples = parseWorkloadJson(datasetPath, maxNumSamples, maxPromptLen);
+    auto const samples = benchmarkParams.traceFile
+        ? parseTraceJson(benchmarkParams.traceFile.value(), maxNumSamples, maxPromptLen, benchmarkParams)
+        : parseWorkloadJson(datasetPath, maxNumSamples, maxPromptLen);
     auto const numSamples = samples.size();
 
     auto recorder = std::make_shared<Recorder>(opCsvFile, benchmarkParams.streaming, beamWidth, responsesJsonFile);
@@ -905,6 +971,20 @@ void benchmarkExecutor(std::optional<std::filesystem::path> const& decoderEngine
         return;
     }
 
+    auto const& startupTrace = tensorrt_llm::common::StartupTrace::getInstance();
+    if (benchmarkParams.startupTraceFile)
+    {
+        auto const traceFile = benchmarkParams.startupTraceFile.value() + "_rank" + std::to_string(worldRank) + ".json";
+        std::ofstream(traceFile) << startupTrace.toJson() << std::endl;
+    }
+    if (worldRank == 0)
+    {
+        for (auto const& phase : startupTrace.getPhases())
+        {
+            printf("[BENCHMARK] startup %s(ms) %.2f (%zu times)\n", phase.name.c_str(), phase.durationMs, phase.count);
+        }
+    }
+
     if (worldRank == 0)
     {
         if (benchmarkParams.loraDir)
@@ -967,7 +1047,9 @@ void benchmarkExecutor(std::optional<std::filesystem::path> const& decoderEngine
 
             // Create requests
             recorder->initialize();
+            MemoryCounters::getInstance().resetPeaks();
             std::vector<texec::Request> requests;
+            std::vector<RequestSlo> slos;
 
             for (std::size_t i = 0; i < numSamples; ++i)
             {
@@ -978,7 +1060,8 @@ void benchmarkExecutor(std::optional<std::filesystem::path> const& decoderEngine
                 }
                 if (executorModelType == texec::ModelType::kENCODER_DECODER)
                 {
-                    Sample s{std::vector<int32_t>{decoderStartTokenId}, samples[i].outputLen, samples[i].taskId};
+                    Sample s{samples[i]};
+                    s.inputIds = std::vector<int32_t>{decoderStartTokenId};
                     requests.emplace_back(makeExecutorRequest(s, beamWidth, eosId, padId, benchmarkParams.streaming,
                         returnContextLogits, returnGenerationLogits, loraConfig, benchmarkParams.requestLookaheadConfig,
                         samples[i].inputIds));
@@ -989,10 +1072,16 @@ void benchmarkExecutor(std::optional<std::filesystem::path> const& decoderEngine
                         benchmarkParams.streaming, returnContextLogits, returnGenerationLogits, loraConfig,
                         benchmarkParams.requestLookaheadConfig, std::nullopt, benchmarkParams.temperature));
                 }
+                RequestSlo slo = samples[i].slo;
+                if (!benchmarkParams.traceFile)
+                {
+                    slo = RequestSlo{benchmarkParams.sloTtftMs, benchmarkParams.sloE2eMs};
+                }
+                slos.emplace_back(slo);
             }
 
-            bool const hasDelay
-                = std::any_of(timeDelays.begin(), timeDelays.end(), [](auto const& delay) { return delay > 0.0; });
+            bool const hasDelay = benchmarkParams.traceFile.has_value()
+                || std::any_of(timeDelays.begin(), timeDelays.end(), [](auto const& delay) { return delay > 0.0; });
             executorServer->resetNumFinished();
             if (!staticEmulatedBatchSize)
             {
@@ -1002,11 +1091,23 @@ void benchmarkExecutor(std::optional<std::filesystem::path> const& decoderEngine
 
                 // Enqueue requests one by one
                 int numSentRequests = 0;
+                auto const replayStart = std::chrono::steady_clock::now();
                 while (numSentRequests < numSamples)
                 {
-                    if (executorServer->canEnqueue(numSentRequests))
+                    if (benchmarkParams.traceFile)
                     {
-                        executorServer->enqueue({requests.at(numSentRequests)});
+                        // Replay at the trace arrival times. Sleeping until an absolute time keeps the enqueue
+                        // overhead from accumulating over the trace.
+                        std::this_thread::sleep_until(replayStart
+                            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                std::chrono::duration<double, std::milli>(
+                                    samples[numSentRequests].arrivalTimeMs.value())));
+                        executorServer->enqueue({requests.at(numSentRequests)}, false, {slos.at(numSentRequests)});
+                        numSentRequests += 1;
+                    }
+                    else if (executorServer->canEnqueue(numSentRequests))
+                    {
+                        executorServer->enqueue({requests.at(numSentRequests)}, false, {slos.at(numSentRequests)});
                         if (hasDelay && numSentRequests < numSamples - 1)
                         {
                             std::this_thread::sleep_for(
@@ -1029,8 +1130,9 @@ void benchmarkExecutor(std::optional<std::filesystem::path> const& decoderEngine
 
                     std::vector<texec::Request> requestsBatch(std::make_move_iterator(requests.begin() + req),
                         std::make_move_iterator(requests.begin() + req + batchSize));
+                    std::vector<RequestSlo> slosBatch(slos.begin() + req, slos.begin() + req + batchSize);
                     // Enqueue in batches
-                    executorServer->enqueue(std::move(requestsBatch));
+                    executorServer->enqueue(std::move(requestsBatch), false, slosBatch);
                     // Wait for current batch to be done
                     executorServer->waitForResponses(batchSize);
                 }
@@ -1039,6 +1141,7 @@ void benchmarkExecutor(std::optional<std::filesystem::path> const& decoderEngine
         recorder->finalize();
         recorder->calculateMetrics();
         recorder->report();
+        reportMemoryCounterPeaks();
         recorder->writeOpMetricsToCsv();
         recorder->dumpResponseSeqs();
         // Send terminateReqId to terminate servers on all ranks
@@ -1064,6 +1167,13 @@ int main(int argc, char* argv[])
         cxxopts::value<std::string>()->default_value("inflight"));
     options.add_options()("dataset", "Dataset that is used for benchmarking BatchManager.",
         cxxopts::value<std::string>()->default_value(""));
+    options.add_options()("trace",
+        "Request trace replayed at its arrival times instead of the dataset, see parseTraceJson for its format.",
+        cxxopts::value<std::string>());
+    options.add_options()("slo_ttft_ms", "Default time-to-first-token SLO of the requests, for the goodput.",
+        cxxopts::value<float>());
+    options.add_options()(
+        "slo_e2e_ms", "Default end-to-end latency SLO of the requests, for the goodput.", cxxopts::value<float>());
     options.add_options()(
         "output_csv", "Write output metrics to CSV", cxxopts::value<std::string>()->default_value(""));
     options.add_options()("max_num_samples", "maximum number of samples to use from dataset/generate",
@@ -1123,6 +1233,9 @@ int main(int argc, char* argv[])
     options.add_options()("wait_sleep", "Specify how many milliseconds to sleep each iteration of waitForEmpty loop.",
         cxxopts::value<int>()->default_value("25"));
     options.add_options()("lora_dir", "Directory containing LoRAs", cxxopts::value<std::string>()->default_value(""));
+    options.add_options()("startup_trace",
+        "Write the timings of the startup phases of every rank to <startup_trace>_rank<N>.json.",
+        cxxopts::value<std::string>());
     options.add_options()("lora_host_cache_bytes", "LoRA host cache memory in bytes", cxxopts::value<size_t>());
     options.add_options()("lora_num_device_mod_layers", "LoRA number 1d cache rows", cxxopts::value<int>());
     options.add_options()("kv_host_cache_bytes",
@@ -1302,6 +1415,28 @@ int main(int argc, char* argv[])
         benchmarkParams.concurrency = result["concurrency"].as<int>();
     }
 
+    // Argument: trace replay
+    if (result.count("trace"))
+    {
+        TLLM_CHECK_WITH_INFO(!result.count("request_rate") && !result.count("concurrency"),
+            "The trace sets the arrival times, request_rate and concurrency cannot be specified with it.");
+        benchmarkParams.traceFile = result["trace"].as<std::string>();
+    }
+
+    // Argument: SLOs
+    if (result.count("slo_ttft_ms"))
+    {
+        benchmarkParams.sloTtftMs = result["slo_ttft_ms"].as<float>();
+    }
+    if (result.count("slo_e2e_ms"))
+    {
+        benchmarkParams.sloE2eMs = result["slo_e2e_ms"].as<float>();
+    }
+    if (benchmarkParams.traceFile && !benchmarkParams.streaming)
+    {
+        TLLM_LOG_WARNING("The time-to-first-token SLOs are only checked with streaming.");
+    }
+
     // Argument: request rate
     if (result.count("max_batch_size"))
     {
@@ -1333,6 +1468,12 @@ int main(int argc, char* argv[])
     // Argument: Enable return context logits
     bool returnGenerationLogits = result["return_generation_logits"].as<bool>();
 
+    // Argument: Startup trace
+    if (result.count("startup_trace"))
+    {
+        benchmarkParams.startupTraceFile = result["startup_trace"].as<std::string>();
+    }
+
     if (result.count("lora_dir"))
     {
         benchmarkParams.loraDir = result["lora_dir"].as<std::string>();
@@ -30,6 +30,7 @@
 #include "tensorrt_llm/runtime/iTensor.h"
 #include "tensorrt_llm/runtime/memoryCounters.h"
 #include "tensorrt_llm/runtime/tllmLogger.h"
+#include "utils/utils.h"
 
 #include <NvInfer.h>
 #include <atomic>
@@ -394,6 +395,10 @@ void benchmarkGptSession(std::filesystem::path const& dataPath, std::vector<int>
             }
         }
         TLLM_LOG_INFO(memoryCounter.toString());
+        if (worldConfig.getRank() == 0)
+        {
+            tensorrt_llm::benchmark::reportMemoryCounterPeaks();
+        }
     }
 }
 
@@ -0,0 +1,244 @@
+# SPDX-FileCopyrightText: Copyright (c) 2022-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Runs a fixed matrix of the C++ benchmarks and compares their metrics with stored baselines.
+
+The matrix lists the cases to run, the metrics to keep of each and their tolerance bands. The results are written in
+the format of the baselines, described by perf_regression/results.schema.json, so the results of a reference run can
+be stored as the next baselines with --update_baselines. The exit code is 1 if a metric regressed beyond its band.
+"""
+import argparse
+import json
+import os
+import re
+import string
+import subprocess
+import sys
+from typing import Dict, List, Optional
+
+SCHEMA_VERSION = 1
+
+# The keys that identify a configuration of the benchmarks printing one [BENCHMARK] line per configuration, e.g.
+# gptSessionBenchmark and bertBenchmark. Their other values are named <key>@<id>=<value>,...
+ID_KEYS = ('batch_size', 'input_length', 'output_length', 'beam_width')
+
+
+def _to_float(value: str) -> Optional[float]:
+    try:
+        return float(value)
+    except ValueError:
+        return None
+
+
+def parse_benchmark_lines(output: str) -> Dict[str, float]:
+    """Parses the "[BENCHMARK] <key> <value> [<key> <value> ...]" lines of the benchmarks."""
+    metrics = {}
+    for line in output.splitlines():
+        if not line.startswith('[BENCHMARK]'):
+            continue
+        tokens = line[len('[BENCHMARK]'):].split()
+        pairs = list(zip(tokens[0::2], tokens[1::2]))
+        ids = ','.join(f'{key}={value}' for key, value in pairs
+                       if key in ID_KEYS)
+        for key, value in pairs:
+            number = _to_float(value)
+            if key in ID_KEYS or number is None:
+                continue
+            metrics[f'{key}@{ids}' if ids else key] = number
+    return metrics
+
+
+def parse_google_benchmark_json(output: str) -> Dict[str, float]:
+    """Parses the --benchmark_format=json output of the micro benchmarks, the real time of each benchmark."""
+    report = json.loads(output[output.index('{'):])
+    return {
+        f"{benchmark['name']}/real_time({benchmark['time_unit']})":
+        float(benchmark['real_time'])
+        for benchmark in report['benchmarks']
+        if benchmark.get('run_type', 'iteration') == 'iteration'
+    }
+
+
+PARSERS = {
+    'benchmark_lines': parse_benchmark_lines,
+    'google_benchmark_json': parse_google_benchmark_json,
+}
+
+
+def expand(value: str, variables: Dict[str, str]) -> str:
+    try:
+        return string.Template(value).substitute(variables)
+    except KeyError as e:
+        raise SystemExit(
+            f'Undefined variable {e} in "{value}", pass it with --define or the environment'
+        )
+
+
+def run_case(case: dict, defaults: dict, build_dir: str,
+             variables: Dict[str, str]) -> dict:
+    binary = os.path.join(build_dir, expand(case['binary'], variables))
+    command = case.get('launcher', []) + [binary] + case.get('args', [])
+    command = [expand(arg, variables) for arg in command]
+    print(f"[perf_regression] {case['name']}: {' '.join(command)}",
+          flush=True)
+    completed = subprocess.run(command,
+                               stdout=subprocess.PIPE,
+                               stderr=subprocess.STDOUT,
+                               text=True,
+                               timeout=case.get('timeout_s'),
+                               check=False)
+    if completed.returncode != 0:
+        print(completed.stdout)
+        return {'error': f'exit code {completed.returncode}', 'metrics': {}}
+
+    parsed = PARSERS[case.get('format', 'benchmark_lines')](completed.stdout)
+    # The metrics named in the case, then all the ones matching its patterns, e.g. the names of a benchmark filter.
+    selected = [(name, band) for name, band in case.get('metrics', {}).items()]
+    for pattern, band in case.get('metric_patterns', {}).items():
+        matches = [name for name in parsed if re.fullmatch(pattern, name)]
+        if not matches:
+            return {'error': f'no metric matches {pattern}', 'metrics': {}}
+        selected += [(name, band) for name in sorted(matches)]
+    metrics = {}
+    for name, band in selected:
+        if name not in parsed:
+            return {
+                'error': f'metric {name} not in the output',
+                'metrics': metrics
+            }
+        metrics[name] = {
+            'value': parsed[name],
+            'better': band['better'],
+            'tolerance': band.get('tolerance', defaults.get('tolerance',
+                                                           0.05)),
+        }
+    return {'metrics': metrics}
+
+
+def compare(results: dict, baselines: dict) -> List[str]:
+    """Returns the regressions of the results against the baselines, the bands are the ones of the baselines."""
+    regressions = []
+    for name, case in results['cases'].items():
+        if 'error' in case:
+            regressions.append(f"{name}: {case['error']}")
+            continue
+        baseline_case = baselines['cases'].get(name)
+        if baseline_case is None:
+            print(f'[perf_regression] {name}: no baseline')
+            continue
+        for metric, result in case['metrics'].items():
+            baseline = baseline_case['metrics'].get(metric)
+            if baseline is None:
+                print(f'[perf_regression] {name} {metric}: no baseline')
+                continue
+            reference = baseline['value']
+            tolerance = baseline['tolerance']
+            value = result['value']
+            if baseline['better'] == 'higher':
+                regressed = value < reference * (1 - tolerance)
+            else:
+                regressed = value > reference * (1 + tolerance)
+            change = (value - reference) / reference * 100 if reference else 0
+            status = 'REGRESSED' if regressed else 'ok'
+            print(
+                f'[perf_regression] {name} {metric}: {value:.4g} vs {reference:.4g} ({change:+.2f}%, '
+                f'band {tolerance * 100:.1f}%) {status}')
+            if regressed:
+                regressions.append(
+                    f'{name} {metric}: {value:.4g} vs baseline {reference:.4g} ({change:+.2f}%)'
+                )
+    return regressions
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--matrix',
+                        required=True,
+                        help='JSON matrix of the cases to run')
+    parser.add_argument('--baselines',
+                        required=True,
+                        help='JSON baselines to compare with')
+    parser.add_argument('--build_dir',
+                        required=True,
+                        help='CMake build directory of the benchmarks')
+    parser.add_argument('--output',
+                        default='perf_regression_results.json',
+                        help='Where to write the results')
+    parser.add_argument('--cases',
+                        default=None,
+                        help='Regex of the cases to run, all by default')
+    parser.add_argument('--define',
+                        action='append',
+                        default=[],
+                        metavar='NAME=VALUE',
+                        help='Variable of the matrix, e.g. ENGINE_DIR=...')
+    parser.add_argument(
+        '--update_baselines',
+        action='store_true',
+        help='Write the results to the baselines instead of comparing')
+    args = parser.parse_args()
+
+    with open(args.matrix) as f:
+        matrix = json.load(f)
+    variables = dict(os.environ)
+    variables.update(define.split('=', 1) for define in args.define)
+
+    results = {'schema_version': SCHEMA_VERSION, 'cases': {}}
+    for case in matrix['cases']:
+        if args.cases and not re.search(args.cases, case['name']):
+            continue
+        results['cases'][case['name']] = run_case(case,
+                                                  matrix.get('defaults', {}),
+                                                  args.build_dir, variables)
+
+    with open(args.output, 'w') as f:
+        json.dump(results, f, indent=2)
+
+    if args.update_baselines:
+        failed = [
+            name for name, case in results['cases'].items() if 'error' in case
+        ]
+        if failed:
+            print(f"[perf_regression] not updating, failed: {', '.join(failed)}")
+            return 1
+        baselines = {'schema_version': SCHEMA_VERSION, 'cases': {}}
+        if os.path.exists(args.baselines):
+            with open(args.baselines) as f:
+                baselines = json.load(f)
+        baselines['cases'].update(results['cases'])
+        with open(args.baselines, 'w') as f:
+            json.dump(baselines, f, indent=2)
+        print(f'[perf_regression] updated {args.baselines}')
+        return 0
+
+    if not os.path.exists(args.baselines):
+        print(
+            f'[perf_regression] no baselines at {args.baselines}, run with --update_baselines first'
+        )
+        return 1
+    with open(args.baselines) as f:
+        baselines = json.load(f)
+    if baselines.get('schema_version') != SCHEMA_VERSION:
+        print(
+            f"[perf_regression] baselines schema {baselines.get('schema_version')} != {SCHEMA_VERSION}"
+        )
+        return 1
+    regressions = compare(results, baselines)
+    for regression in regressions:
+        print(f'[perf_regression] REGRESSION {regression}')
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
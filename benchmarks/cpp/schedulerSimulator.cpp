@@ -0,0 +1,467 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays a request trace through the inflight batching schedulers and the KV cache manager with a latency model in
+// place of the engine, to sweep the scheduler configurations without running the model.
+
+#include "tensorrt_llm/batch_manager/capacityScheduler.h"
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/batch_manager/microBatchScheduler.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/executor/types.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/samplingConfig.h"
+#include "utils/utils.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cxxopts.hpp>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace tensorrt_llm::batch_manager;
+using namespace tensorrt_llm::runtime;
+using namespace tensorrt_llm::benchmark;
+namespace texec = tensorrt_llm::executor;
+namespace tbk = tensorrt_llm::batch_manager::kv_cache_manager;
+
+namespace
+{
+
+//! \brief Time of one engine step, linear in the context tokens, the generation requests and the KV tokens they read.
+struct StepLatencyModel
+{
+    double fixedMs;
+    double perContextTokenUs;
+    double perGenerationRequestUs;
+    double perKvTokenNs;
+
+    [[nodiscard]] double operator()(SizeType32 numContextTokens, SizeType32 numGenRequests, int64_t numKvTokens) const
+    {
+        return fixedMs + numContextTokens * perContextTokenUs * 1e-3 + numGenRequests * perGenerationRequestUs * 1e-3
+            + static_cast<double>(numKvTokens) * perKvTokenNs * 1e-6;
+    }
+};
+
+struct SimulatorConfig
+{
+    texec::CapacitySchedulerPolicy capacitySchedulerPolicy;
+    std::optional<texec::ContextChunkingPolicy> chunkingPolicy;
+    SizeType32 maxBatchSize;
+    std::optional<SizeType32> maxNumTokens;
+    SizeType32 tokensPerBlock;
+    SizeType32 blocksInPrimaryPool;
+    SizeType32 blocksInSecondaryPool;
+    bool enableBlockReuse;
+    StepLatencyModel latencyModel;
+};
+
+struct RequestTimes
+{
+    double arrivalMs{0};
+    std::optional<double> firstTokenMs{std::nullopt};
+    double lastTokenMs{0};
+};
+
+struct SimulatorStats
+{
+    SizeType32 numSteps{0};
+    SizeType32 numPauses{0};
+    SizeType32 maxUsedBlocks{0};
+    int64_t numContextTokens{0};
+    int64_t numGeneratedTokens{0};
+    double endMs{0};
+    RecordTimeMetric ttft{"ttft"};
+    RecordTimeMetric itl{"itl"};
+    RecordTimeMetric e2e{"e2e"};
+};
+
+SimulatorStats simulate(Samples const& samples, std::vector<double> const& arrivalsMs, SimulatorConfig const& config)
+{
+    SizeType32 maxSequenceLength{1};
+    for (auto const& sample : samples)
+    {
+        auto const sequenceLength = static_cast<SizeType32>(sample.inputIds.size()) + sample.outputLen;
+        maxSequenceLength = std::max(maxSequenceLength, sequenceLength);
+    }
+
+    // A single layer with a single head of size 1, the block accounting is the one of the model while the pools are
+    // negligible. The stream only serves the copies between the pools, when blocks are offloaded.
+    auto constexpr numLayers = 1;
+    auto constexpr numKvHeads = 1;
+    auto constexpr sizePerHead = 1;
+    auto constexpr beamWidth = 1;
+    tbk::KVCacheManager kvCacheManager(numLayers, numKvHeads, sizePerHead, config.tokensPerBlock,
+        config.blocksInPrimaryPool, config.blocksInSecondaryPool, config.maxBatchSize, beamWidth, maxSequenceLength,
+        /*temporaryAttentionWindow*/ 0, /*sinkTokenLength*/ 0, std::make_shared<CudaStream>(), maxSequenceLength,
+        config.enableBlockReuse);
+    kvCacheManager.allocatePools(nvinfer1::DataType::kHALF);
+
+    CapacityScheduler const capacityScheduler(config.maxBatchSize, config.capacitySchedulerPolicy, true);
+    std::optional<batch_scheduler::ContextChunkingConfig> chunkingConfig{std::nullopt};
+    if (config.chunkingPolicy)
+    {
+        chunkingConfig = batch_scheduler::ContextChunkingConfig{};
+        chunkingConfig->chunkingPolicy = config.chunkingPolicy.value();
+        chunkingConfig->chunkUnitSize = config.tokensPerBlock;
+    }
+    MicroBatchScheduler const microBatchScheduler(
+        chunkingConfig, chunkingConfig ? config.maxNumTokens : std::optional<SizeType32>{std::nullopt});
+
+    SimulatorStats stats;
+    std::vector<RequestTimes> times(samples.size());
+    RequestList activeRequests;
+    std::unordered_set<LlmRequest::RequestIdType> startedRequests;
+    ReqIdsSet const inflightReqIds;
+    std::size_t nextSample{0};
+    std::size_t numFinished{0};
+    double nowMs{0};
+    TokenIdType nextToken{0};
+
+    while (numFinished < samples.size())
+    {
+        for (; nextSample < samples.size() && arrivalsMs[nextSample] <= nowMs; ++nextSample)
+        {
+            auto const& sample = samples[nextSample];
+            auto inputTokens = std::make_shared<LlmRequest::VecTokens>(sample.inputIds.begin(), sample.inputIds.end());
+            activeRequests.push_back(std::make_shared<LlmRequest>(
+                nextSample, sample.outputLen, inputTokens, SamplingConfig{beamWidth}, false));
+            times[nextSample].arrivalMs = arrivalsMs[nextSample];
+        }
+
+        kvCacheManager.startScheduling();
+        auto const [fittingRequests, pausedRequests] = capacityScheduler(activeRequests, kvCacheManager);
+        for (auto const& llmReq : pausedRequests)
+        {
+            // Paused requests start over with the tokens generated so far appended to their prompt.
+            if (startedRequests.erase(llmReq->mRequestId) > 0)
+            {
+                kvCacheManager.removeSequence(llmReq->mRequestId, *llmReq);
+                llmReq->pause(maxSequenceLength);
+                ++stats.numPauses;
+            }
+        }
+
+        auto scheduledRequests = fittingRequests;
+        auto const [contextRequests, generationRequests]
+            = microBatchScheduler(scheduledRequests, inflightReqIds, config.maxBatchSize, config.maxNumTokens);
+        if (contextRequests.empty() && generationRequests.empty())
+        {
+            TLLM_CHECK_WITH_INFO(nextSample < samples.size(),
+                "No request can be scheduled, the KV cache of %d blocks cannot hold the next request",
+                config.blocksInPrimaryPool);
+            nowMs = std::max(nowMs, arrivalsMs[nextSample]);
+            continue;
+        }
+
+        SizeType32 numContextTokens{0};
+        for (auto const& llmReq : contextRequests)
+        {
+            if (startedRequests.insert(llmReq->mRequestId).second)
+            {
+                // With block reuse, this advances the context past the reused blocks.
+                kvCacheManager.addSequence(llmReq->mRequestId, llmReq->getPromptLen(), beamWidth, *llmReq);
+            }
+            numContextTokens += llmReq->getContextChunkSize();
+        }
+        int64_t numKvTokens{0};
+        for (auto const& llmReq : generationRequests)
+        {
+            kvCacheManager.addToken(llmReq->mRequestId);
+            numKvTokens += llmReq->getNumTokens(0);
+        }
+        stats.maxUsedBlocks = std::max(stats.maxUsedBlocks, kvCacheManager.getUsedNumBlocks());
+
+        nowMs += config.latencyModel(numContextTokens, static_cast<SizeType32>(generationRequests.size()), numKvTokens);
+        ++stats.numSteps;
+        stats.numContextTokens += numContextTokens;
+
+        auto const addToken = [&](std::shared_ptr<LlmRequest> const& llmReq)
+        {
+            llmReq->addNewToken(nextToken++, 0);
+            ++stats.numGeneratedTokens;
+            auto& reqTimes = times[llmReq->mRequestId];
+            if (!reqTimes.firstTokenMs)
+            {
+                reqTimes.firstTokenMs = nowMs;
+                stats.ttft.mDataTimes.push_back(static_cast<float>(nowMs - reqTimes.arrivalMs));
+            }
+            else
+            {
+                stats.itl.mDataTimes.push_back(static_cast<float>(nowMs - reqTimes.lastTokenMs));
+            }
+            reqTimes.lastTokenMs = nowMs;
+            if (llmReq->getMaxNumGeneratedTokens() >= llmReq->mMaxNewTokens)
+            {
+                llmReq->setState(LlmRequestState::kGENERATION_COMPLETE);
+                kvCacheManager.removeSequence(llmReq->mRequestId, *llmReq);
+                startedRequests.erase(llmReq->mRequestId);
+                stats.e2e.mDataTimes.push_back(static_cast<float>(nowMs - reqTimes.arrivalMs));
+                ++numFinished;
+            }
+        };
+
+        for (auto const& llmReq : contextRequests)
+        {
+            auto const isLastChunk = llmReq->isLastContextChunk();
+            llmReq->moveToNextContextChunk();
+            if (isLastChunk)
+            {
+                llmReq->setState(LlmRequestState::kGENERATION_IN_PROGRESS);
+                if (config.enableBlockReuse)
+                {
+                    kvCacheManager.storeContextBlocks(*llmReq);
+                }
+                addToken(llmReq);
+            }
+        }
+        for (auto const& llmReq : generationRequests)
+        {
+            addToken(llmReq);
+        }
+        activeRequests.remove_if([](auto const& llmReq) { return llmReq->isGenerationCompleteState(); });
+    }
+
+    stats.endMs = nowMs;
+    auto const kvCacheStats = kvCacheManager.getKvCacheStats();
+    printf("[BENCHMARK] kv_cache_reused_blocks %d\n", kvCacheStats.reusedBlocks);
+    printf("[BENCHMARK] kv_cache_missed_blocks %d\n", kvCacheStats.missedBlocks);
+    printf("[BENCHMARK] kv_cache_hit_rate(%%) %.2f\n", kvCacheStats.cacheHitRate * 100.F);
+    return stats;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    cxxopts::Options options("TensorRT-LLM Scheduler Simulator",
+        "Replays a request trace through the batch manager schedulers and the KV cache manager with a step latency "
+        "model instead of an engine.");
+    options.add_options()("h,help", "Print usage");
+    options.add_options()("dataset", "Dataset of prepare_dataset.py, the requests arrive at --request_rate.",
+        cxxopts::value<std::string>()->default_value(""));
+    options.add_options()("trace", "Request trace replayed at its arrival times, see parseTraceJson for its format.",
+        cxxopts::value<std::string>());
+    options.add_options()("max_num_samples", "Maximum number of samples to use from the dataset.",
+        cxxopts::value<int>()->default_value("100000"));
+    options.add_options()("request_rate", "Request rate of the dataset in requests per second, all at once if unset.",
+        cxxopts::value<float>());
+    options.add_options()("enable_exp_delays", "Exponentially distributed arrival times of the dataset.",
+        cxxopts::value<bool>()->default_value("false"));
+    options.add_options()("random_seed", "Random seed of the exponential arrival times.",
+        cxxopts::value<int>()->default_value("420"));
+    options.add_options()("scheduler_policy",
+        "Choose scheduler policy between max_utilization/guaranteed_no_evict/static_batch.",
+        cxxopts::value<std::string>()->default_value("guaranteed_no_evict"));
+    options.add_options()("context_chunking_policy",
+        "Chunk the contexts with first_come_first_served/equal_progress, or none to disable chunking.",
+        cxxopts::value<std::string>()->default_value("none"));
+    options.add_options()("max_batch_size", "The max runtime batch size.", cxxopts::value<int>()->default_value("256"));
+    options.add_options()("max_num_tokens", "The max runtime number of tokens per step.", cxxopts::value<int>());
+    options.add_options()(
+        "tokens_per_block", "Tokens per KV cache block.", cxxopts::value<int>()->default_value("64"));
+    options.add_options()(
+        "kv_cache_blocks", "Blocks in the primary KV cache pool.", cxxopts::value<int>()->default_value("4096"));
+    options.add_options()("kv_host_cache_blocks", "Blocks in the secondary KV cache pool, for offloading.",
+        cxxopts::value<int>()->default_value("0"));
+    options.add_options()("enable_kv_cache_reuse", "Enables the KV cache reuse.",
+        cxxopts::value<bool>()->default_value("false"));
+    options.add_options()("step_fixed_ms", "Latency model: fixed time of a step in ms.",
+        cxxopts::value<double>()->default_value("5"));
+    options.add_options()("step_context_token_us", "Latency model: time per context token in us.",
+        cxxopts::value<double>()->default_value("50"));
+    options.add_options()("step_gen_request_us", "Latency model: time per generation request in us.",
+        cxxopts::value<double>()->default_value("30"));
+    options.add_options()("step_kv_token_ns", "Latency model: time per KV token read by the generation requests in ns.",
+        cxxopts::value<double>()->default_value("2"));
+    options.add_options()("log_level", "Choose log level between verbose/info/warning/error.",
+        cxxopts::value<std::string>()->default_value("error"));
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help"))
+    {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    auto logger = tensorrt_llm::common::Logger::getLogger();
+    auto const logLevel = result["log_level"].as<std::string>();
+    if (logLevel == "verbose")
+    {
+        logger->setLevel(tensorrt_llm::common::Logger::TRACE);
+    }
+    else if (logLevel == "info")
+    {
+        logger->setLevel(tensorrt_llm::common::Logger::INFO);
+    }
+    else if (logLevel == "warning")
+    {
+        logger->setLevel(tensorrt_llm::common::Logger::WARNING);
+    }
+    else if (logLevel == "error")
+    {
+        logger->setLevel(tensorrt_llm::common::Logger::ERROR);
+    }
+    else
+    {
+        TLLM_LOG_ERROR("Unexpected log level: " + logLevel);
+        return 1;
+    }
+
+    SimulatorConfig config;
+    auto const capacitySchedulerPolicyArg = result["scheduler_policy"].as<std::string>();
+    if (capacitySchedulerPolicyArg == "max_utilization")
+    {
+        config.capacitySchedulerPolicy = texec::CapacitySchedulerPolicy::kMAX_UTILIZATION;
+    }
+    else if (capacitySchedulerPolicyArg == "guaranteed_no_evict")
+    {
+        config.capacitySchedulerPolicy = texec::CapacitySchedulerPolicy::kGUARANTEED_NO_EVICT;
+    }
+    else if (capacitySchedulerPolicyArg == "static_batch")
+    {
+        config.capacitySchedulerPolicy = texec::CapacitySchedulerPolicy::kSTATIC_BATCH;
+    }
+    else
+    {
+        TLLM_LOG_ERROR("Unexpected scheduler policy: " + capacitySchedulerPolicyArg);
+        return 1;
+    }
+
+    auto const chunkingPolicyArg = result["context_chunking_policy"].as<std::string>();
+    if (chunkingPolicyArg == "first_come_first_served")
+    {
+        config.chunkingPolicy = texec::ContextChunkingPolicy::kFIRST_COME_FIRST_SERVED;
+    }
+    else if (chunkingPolicyArg == "equal_progress")
+    {
+        config.chunkingPolicy = texec::ContextChunkingPolicy::kEQUAL_PROGRESS;
+    }
+    else if (chunkingPolicyArg != "none")
+    {
+        TLLM_LOG_ERROR("Unexpected context chunking policy: " + chunkingPolicyArg);
+        return 1;
+    }
+
+    config.maxBatchSize = result["max_batch_size"].as<int>();
+    if (result.count("max_num_tokens"))
+    {
+        config.maxNumTokens = result["max_num_tokens"].as<int>();
+    }
+    if (config.chunkingPolicy && !config.maxNumTokens)
+    {
+        TLLM_LOG_ERROR("Context chunking needs --max_num_tokens.");
+        return 1;
+    }
+    config.tokensPerBlock = result["tokens_per_block"].as<int>();
+    config.blocksInPrimaryPool = result["kv_cache_blocks"].as<int>();
+    config.blocksInSecondaryPool = result["kv_host_cache_blocks"].as<int>();
+    config.enableBlockReuse = result["enable_kv_cache_reuse"].as<bool>();
+    config.latencyModel = StepLatencyModel{result["step_fixed_ms"].as<double>(),
+        result["step_context_token_us"].as<double>(), result["step_gen_request_us"].as<double>(),
+        result["step_kv_token_ns"].as<double>()};
+
+    BenchmarkParams benchmarkParams;
+    if (result.count("request_rate"))
+    {
+        benchmarkParams.requestRate = result["request_rate"].as<float>();
+    }
+    benchmarkParams.enableExpDelays = result["enable_exp_delays"].as<bool>();
+    benchmarkParams.randomSeed = result["random_seed"].as<int>();
+
+    auto const maxNumSamples = result["max_num_samples"].as<int>();
+    std::optional<SizeType32> const maxPromptLen{std::nullopt};
+    Samples samples;
+    std::vector<double> arrivalsMs;
+    if (result.count("trace"))
+    {
+        if (benchmarkParams.requestRate)
+        {
+            TLLM_LOG_ERROR("--request_rate cannot be combined with --trace, the trace sets the arrival times.");
+            return 1;
+        }
+        samples = parseTraceJson(result["trace"].as<std::string>(), maxNumSamples, maxPromptLen, benchmarkParams);
+        auto const firstArrivalMs = samples.empty() ? 0. : samples.front().arrivalTimeMs.value();
+        for (auto const& sample : samples)
+        {
+            arrivalsMs.push_back(sample.arrivalTimeMs.value() - firstArrivalMs);
+        }
+    }
+    else if (!result["dataset"].as<std::string>().empty())
+    {
+        samples = parseWorkloadJson(result["dataset"].as<std::string>(), maxNumSamples, maxPromptLen);
+        double arrivalMs{0};
+        for (auto const delay : computeTimeDelays(benchmarkParams, static_cast<int>(samples.size())))
+        {
+            arrivalsMs.push_back(arrivalMs);
+            arrivalMs += delay * 1000.;
+        }
+    }
+    else
+    {
+        std::cout << options.help() << std::endl;
+        TLLM_LOG_ERROR("Please specify a dataset or a trace.");
+        return 1;
+    }
+    if (samples.empty())
+    {
+        TLLM_LOG_ERROR("No request to simulate.");
+        return 1;
+    }
+    TLLM_CHECK_WITH_INFO(std::is_sorted(arrivalsMs.begin(), arrivalsMs.end()),
+        "The requests of the trace must be sorted by their timestamp_ms");
+
+    try
+    {
+        auto stats = simulate(samples, arrivalsMs, config);
+
+        auto const endSec = stats.endMs * 1e-3;
+        printf("[BENCHMARK] num_samples %zu\n", samples.size());
+        printf("[BENCHMARK] simulated_time(ms) %.2f\n", stats.endMs);
+        printf("[BENCHMARK] num_steps %d\n", stats.numSteps);
+        printf("[BENCHMARK] num_pauses %d\n", stats.numPauses);
+        printf("[BENCHMARK] max_used_kv_cache_blocks %d\n", stats.maxUsedBlocks);
+        printf("[BENCHMARK] context_tokens_per_step %.2f\n",
+            static_cast<double>(stats.numContextTokens) / stats.numSteps);
+        printf("[BENCHMARK] seq_throughput(seq/sec) %.2f\n", samples.size() / endSec);
+        printf("[BENCHMARK] token_throughput(token/sec) %.2f\n\n", stats.numGeneratedTokens / endSec);
+        for (auto* metric : {&stats.ttft, &stats.itl, &stats.e2e})
+        {
+            if (!metric->mDataTimes.empty())
+            {
+                metric->calculate();
+                metric->report();
+            }
+        }
+    }
+    catch (std::exception const& e)
+    {
+        TLLM_LOG_ERROR(e.what());
+        return 1;
+    }
+
+    return 0;
+}
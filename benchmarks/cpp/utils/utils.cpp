@@ -18,10 +18,13 @@
 
 #include "utils.h"
 #include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/memoryCounters.h"
 #include <random>
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <unordered_map>
 
 namespace tensorrt_llm::benchmark
 {
@@ -104,6 +107,86 @@ Samples parseWorkloadJson(
     return samples;
 }
 
+Samples parseTraceJson(std::filesystem::path const& tracePath, int maxNumSamples,
+    std::optional<SizeType32> const maxPromptLen, BenchmarkParams const& benchmarkParams)
+{
+    auto constexpr allowExceptions = true;
+    auto constexpr ignoreComments = true;
+    TLLM_CHECK_WITH_INFO(std::filesystem::exists(tracePath), "File does not exist: %s", tracePath.c_str());
+    std::ifstream jsonStream(tracePath);
+    auto json = nlohmann::json::parse(jsonStream, nullptr, allowExceptions, ignoreComments);
+
+    std::unordered_map<std::string, std::vector<int32_t>> prefixGroups;
+    if (json.count("prefix_groups"))
+    {
+        for (auto const& [groupId, prefixIds] : json["prefix_groups"].items())
+        {
+            prefixGroups.emplace(groupId, prefixIds.template get<std::vector<int32_t>>());
+        }
+    }
+
+    auto const optionalValue = [](nlohmann::json const& request, char const* key, auto defaultValue)
+    {
+        using ValueType = typename decltype(defaultValue)::value_type;
+        return request.count(key) ? std::optional<ValueType>{request[key].template get<ValueType>()} : defaultValue;
+    };
+
+    Samples samples;
+    for (auto const& request : json["requests"])
+    {
+        std::vector<int32_t> inputIds;
+        if (request.count("prefix_group"))
+        {
+            // Group ids may be written as numbers or strings
+            auto const& group = request["prefix_group"];
+            auto const groupId = group.is_string() ? group.template get<std::string>() : group.dump();
+            auto const it = prefixGroups.find(groupId);
+            TLLM_CHECK_WITH_INFO(it != prefixGroups.end(), "Unknown prefix group %s in trace", groupId.c_str());
+            inputIds = it->second;
+            if (request.count("suffix_ids"))
+            {
+                auto const suffixIds = request["suffix_ids"].template get<std::vector<int32_t>>();
+                inputIds.insert(inputIds.end(), suffixIds.begin(), suffixIds.end());
+            }
+        }
+        else
+        {
+            inputIds = request["input_ids"].template get<std::vector<int32_t>>();
+        }
+        if (maxPromptLen && (inputIds.size() > maxPromptLen.value()))
+        {
+            inputIds.resize(maxPromptLen.value());
+        }
+        int32_t taskId = request.count("task_id") ? request["task_id"].template get<int32_t>() : -1;
+
+        Sample sample{std::move(inputIds), request["output_len"], taskId};
+        sample.arrivalTimeMs = request["timestamp_ms"].template get<double>();
+        sample.temperature = optionalValue(request, "temperature", std::optional<float>{});
+        sample.topK = optionalValue(request, "top_k", std::optional<SizeType32>{});
+        sample.topP = optionalValue(request, "top_p", std::optional<float>{});
+        sample.slo.ttftMs = optionalValue(request, "slo_ttft_ms", benchmarkParams.sloTtftMs);
+        sample.slo.e2eMs = optionalValue(request, "slo_e2e_ms", benchmarkParams.sloE2eMs);
+        samples.emplace_back(std::move(sample));
+    }
+
+    // Truncate in arrival order, so that max_num_samples replays the beginning of the trace
+    std::stable_sort(samples.begin(), samples.end(),
+        [](Sample const& lhs, Sample const& rhs) { return lhs.arrivalTimeMs.value() < rhs.arrivalTimeMs.value(); });
+    if (samples.size() > maxNumSamples)
+    {
+        samples.resize(maxNumSamples);
+    }
+    if (!samples.empty())
+    {
+        auto const firstArrivalMs = samples.front().arrivalTimeMs.value();
+        for (auto& sample : samples)
+        {
+            sample.arrivalTimeMs = sample.arrivalTimeMs.value() - firstArrivalMs;
+        }
+    }
+    return samples;
+}
+
 std::vector<double> generateRandomExponentialValues(int count, float lambda, int seed)
 {
     // Set a constant seed for reproducibility
@@ -152,4 +235,15 @@ std::ostream& operator<<(std::ostream& os, RecordTimeMetric const& metric)
        << metric.mP50;
     return os;
 }
+
+void reportMemoryCounterPeaks()
+{
+    auto const& counters = MemoryCounters::getInstance();
+    auto const toMiB = [](MemoryCounters::SizeType32 bytes) { return static_cast<double>(bytes) / (1 << 20); };
+    printf("[BENCHMARK] memory_counters_gpu_peak(MiB) %.2f\n", toMiB(counters.getGpuPeak()));
+    printf("[BENCHMARK] memory_counters_cpu_peak(MiB) %.2f\n", toMiB(counters.getCpuPeak()));
+    printf("[BENCHMARK] memory_counters_pinned_peak(MiB) %.2f\n", toMiB(counters.getPinnedPeak()));
+    printf("[BENCHMARK] memory_counters_uvm_peak(MiB) %.2f\n", toMiB(counters.getUVMPeak()));
+    printf("[BENCHMARK] memory_counters_pinned_pool_peak(MiB) %.2f\n", toMiB(counters.getPinnedPoolPeak()));
+}
 } // namespace tensorrt_llm::benchmark
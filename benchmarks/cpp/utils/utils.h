@@ -93,6 +93,15 @@ struct BenchmarkParams
 
     bool enableCollectkvCacheTransferTime = false;
     bool enableCollectIterStats = false;
+
+    // Prefix of the per-rank JSON files of the startup phases
+    std::optional<std::string> startupTraceFile{std::nullopt};
+
+    // Request trace replayed with its arrival times instead of the dataset
+    std::optional<std::string> traceFile{std::nullopt};
+    // Default SLOs of the requests that do not set theirs
+    std::optional<float> sloTtftMs{std::nullopt};
+    std::optional<float> sloE2eMs{std::nullopt};
 };
 
 struct RecordTimeMetric
@@ -159,11 +168,30 @@ struct RecordTimeMetric
 
 std::ostream& operator<<(std::ostream& os, RecordTimeMetric const& metric);
 
+//! \brief Latency objectives of a request, a request meeting all of its set objectives counts in the goodput.
+struct RequestSlo
+{
+    std::optional<float> ttftMs{std::nullopt};
+    std::optional<float> e2eMs{std::nullopt};
+
+    [[nodiscard]] bool isSet() const
+    {
+        return ttftMs.has_value() || e2eMs.has_value();
+    }
+};
+
 struct Sample
 {
     std::vector<int32_t> inputIds;
     int32_t outputLen;
     int32_t taskId;
+
+    // Trace replay only
+    std::optional<double> arrivalTimeMs{std::nullopt};
+    std::optional<float> temperature{std::nullopt};
+    std::optional<SizeType32> topK{std::nullopt};
+    std::optional<float> topP{std::nullopt};
+    RequestSlo slo{};
 };
 
 using Samples = std::vector<Sample>;
@@ -171,8 +199,19 @@ using Samples = std::vector<Sample>;
 Samples parseWorkloadJson(
     std::filesystem::path const& datasetPath, int maxNumSamples, std::optional<SizeType32> const maxPromptLen);
 
+//! \brief Reads a request trace, sorted by arrival time with the first arrival at 0.
+//! \details The trace is a JSON object with a "requests" array and an optional "prefix_groups" object mapping a group
+//! id to the token ids its prompts start with. A request has "timestamp_ms", "output_len", and either "input_ids" or a
+//! "prefix_group" followed by its own "suffix_ids". It may set "task_id", "temperature", "top_k", "top_p",
+//! "slo_ttft_ms" and "slo_e2e_ms". The requests without SLOs take the default ones of the benchmark params.
+Samples parseTraceJson(std::filesystem::path const& tracePath, int maxNumSamples,
+    std::optional<SizeType32> const maxPromptLen, BenchmarkParams const& benchmarkParams);
+
 std::vector<double> generateRandomExponentialValues(int count, float lambda, int seed);
 
 std::vector<double> computeTimeDelays(BenchmarkParams const& benchmarkParams, int numDelays);
 
+//! \brief Prints the high-water marks of the MemoryCounters as [BENCHMARK] lines, in MiB.
+void reportMemoryCounterPeaks();
+
 } // namespace tensorrt_llm::benchmark
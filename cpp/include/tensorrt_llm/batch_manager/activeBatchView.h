@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Structure of arrays of the host state of the active requests, for the loops of every iteration.
+//! \details The schedulers, the token updates and the stop checks of an iteration read a few fields of every active
+//! request, and with the requests behind shared pointers each of them is a cache miss at large batch sizes. The view
+//! keeps those fields in dense arrays, one entry per active request: index i of every array is the same request, and
+//! getIndex maps a sequence slot to its index. Removing a request moves the last one to its index, so the arrays stay
+//! dense and their order is not the order of the RequestList.
+//!
+//! The view holds the state, the lengths and the flags of its requests between iterations: the hot paths update the
+//! view, and flush writes the state back to the LlmRequest for the cold paths, e.g. responses and stats. Cold paths
+//! that change a request call refresh. Tokens themselves stay in the LlmRequest.
+class ActiveBatchView
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+    using Flags = std::uint8_t;
+
+    static constexpr SizeType32 kNoIndex = -1;
+
+    //! \brief Bits of getFlags.
+    static constexpr Flags kStreaming = 1U << 0;
+    static constexpr Flags kChild = 1U << 1;
+    static constexpr Flags kLengthFinished = 1U << 2;
+
+    explicit ActiveBatchView(SizeType32 maxNumSequences)
+        : mSlotToIndex(maxNumSequences, kNoIndex)
+    {
+        mRequests.reserve(maxNumSequences);
+        mRequestIds.reserve(maxNumSequences);
+        mSeqSlots.reserve(maxNumSequences);
+        mStates.reserve(maxNumSequences);
+        mPromptLens.reserve(maxNumSequences);
+        mNumTokens.reserve(maxNumSequences);
+        mMaxNumTokens.reserve(maxNumSequences);
+        mContextPositions.reserve(maxNumSequences);
+        mPriorities.reserve(maxNumSequences);
+        mFlags.reserve(maxNumSequences);
+    }
+
+    //! \brief Add a request with a sequence slot.
+    void add(std::shared_ptr<LlmRequest> const& req)
+    {
+        TLLM_CHECK_WITH_INFO(req->mSeqSlot.has_value(), "Request %lu has no sequence slot", req->mRequestId);
+        auto const seqSlot = req->mSeqSlot.value();
+        TLLM_CHECK_WITH_INFO(seqSlot >= 0 && seqSlot < static_cast<SizeType32>(mSlotToIndex.size()),
+            "Sequence slot %d is out of range", seqSlot);
+        TLLM_CHECK_WITH_INFO(mSlotToIndex[seqSlot] == kNoIndex, "Sequence slot %d is in the view already", seqSlot);
+        mSlotToIndex[seqSlot] = size();
+        mRequests.push_back(req);
+        mRequestIds.push_back(req->mRequestId);
+        mSeqSlots.push_back(seqSlot);
+        mStates.emplace_back();
+        mPromptLens.emplace_back();
+        mNumTokens.emplace_back();
+        mMaxNumTokens.emplace_back();
+        mContextPositions.emplace_back();
+        mPriorities.emplace_back();
+        mFlags.emplace_back();
+        refresh(size() - 1);
+    }
+
+    //! \brief Remove the request of a sequence slot, the last request takes its index.
+    void remove(SizeType32 seqSlot)
+    {
+        auto const index = getIndex(seqSlot);
+        TLLM_CHECK_WITH_INFO(index != kNoIndex, "Sequence slot %d is not in the view", seqSlot);
+        auto const last = size() - 1;
+        if (index != last)
+        {
+            moveEntry(last, index);
+            mSlotToIndex[mSeqSlots[index]] = index;
+        }
+        mSlotToIndex[seqSlot] = kNoIndex;
+        popEntry();
+    }
+
+    //! \brief Reload an entry from its request, after a cold path changed the request.
+    void refresh(SizeType32 index)
+    {
+        auto const& req = *mRequests[index];
+        mStates[index] = req.getState();
+        mPromptLens[index] = req.mPromptLen;
+        mNumTokens[index] = req.getMaxBeamNumTokens();
+        mMaxNumTokens[index] = req.mPromptLen + req.mMaxNewTokens;
+        mContextPositions[index] = req.getContextCurrentPosition();
+        mPriorities[index] = req.priority();
+        mFlags[index] = (req.isStreaming() ? kStreaming : 0) | (req.isChild() ? kChild : 0)
+            | (mNumTokens[index] >= mMaxNumTokens[index] ? kLengthFinished : 0);
+    }
+
+    //! \brief Write the state of an entry back to its request.
+    void flush(SizeType32 index) const
+    {
+        mRequests[index]->setState(mStates[index]);
+    }
+
+    void flushAll() const
+    {
+        for (SizeType32 i = 0; i < size(); ++i)
+        {
+            flush(i);
+        }
+    }
+
+    //! \brief Count the tokens of a generation step, numNewTokens[i] for the request of index i, and flag the
+    //! requests that reach their length.
+    //! \return The indices of the requests that reached their length at this step.
+    std::vector<SizeType32> addGeneratedTokens(std::vector<SizeType32> const& numNewTokens)
+    {
+        TLLM_CHECK(static_cast<SizeType32>(numNewTokens.size()) == size());
+        std::vector<SizeType32> finished;
+        for (SizeType32 i = 0; i < size(); ++i)
+        {
+            mNumTokens[i] += numNewTokens[i];
+            if (numNewTokens[i] > 0 && mNumTokens[i] >= mMaxNumTokens[i] && !(mFlags[i] & kLengthFinished))
+            {
+                mFlags[i] |= kLengthFinished;
+                finished.push_back(i);
+            }
+        }
+        return finished;
+    }
+
+    //! \brief Move the context position of a request by a chunk, and to the generation once the prompt is done.
+    void advanceContext(SizeType32 index, SizeType32 chunkSize)
+    {
+        mContextPositions[index] += chunkSize;
+        if (mContextPositions[index] >= mPromptLens[index])
+        {
+            mStates[index] = LlmRequestState::kGENERATION_IN_PROGRESS;
+        }
+    }
+
+    void setState(SizeType32 index, LlmRequestState state)
+    {
+        mStates[index] = state;
+    }
+
+    //! \brief Tokens a request may still generate.
+    [[nodiscard]] SizeType32 getRemainingTokens(SizeType32 index) const
+    {
+        return std::max(mMaxNumTokens[index] - mNumTokens[index], 0);
+    }
+
+    //! \brief Index of the request of a sequence slot, kNoIndex if it has none.
+    [[nodiscard]] SizeType32 getIndex(SizeType32 seqSlot) const
+    {
+        return mSlotToIndex.at(seqSlot);
+    }
+
+    [[nodiscard]] SizeType32 size() const
+    {
+        return static_cast<SizeType32>(mRequestIds.size());
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return mRequestIds.empty();
+    }
+
+    //! \brief The request of an entry, for the cold paths.
+    [[nodiscard]] std::shared_ptr<LlmRequest> const& getRequest(SizeType32 index) const
+    {
+        return mRequests[index];
+    }
+
+    [[nodiscard]] std::vector<RequestIdType> const& getRequestIds() const
+    {
+        return mRequestIds;
+    }
+
+    [[nodiscard]] std::vector<SizeType32> const& getSeqSlots() const
+    {
+        return mSeqSlots;
+    }
+
+    [[nodiscard]] std::vector<LlmRequestState> const& getStates() const
+    {
+        return mStates;
+    }
+
+    [[nodiscard]] std::vector<SizeType32> const& getPromptLens() const
+    {
+        return mPromptLens;
+    }
+
+    //! \brief Tokens of the longest beam, prompt included.
+    [[nodiscard]] std::vector<SizeType32> const& getNumTokens() const
+    {
+        return mNumTokens;
+    }
+
+    //! \brief Length budget, prompt plus max new tokens.
+    [[nodiscard]] std::vector<SizeType32> const& getMaxNumTokens() const
+    {
+        return mMaxNumTokens;
+    }
+
+    [[nodiscard]] std::vector<SizeType32> const& getContextPositions() const
+    {
+        return mContextPositions;
+    }
+
+    [[nodiscard]] std::vector<executor::PriorityType> const& getPriorities() const
+    {
+        return mPriorities;
+    }
+
+    [[nodiscard]] std::vector<Flags> const& getFlags() const
+    {
+        return mFlags;
+    }
+
+private:
+    void moveEntry(SizeType32 from, SizeType32 to)
+    {
+        mRequests[to] = std::move(mRequests[from]);
+        mRequestIds[to] = mRequestIds[from];
+        mSeqSlots[to] = mSeqSlots[from];
+        mStates[to] = mStates[from];
+        mPromptLens[to] = mPromptLens[from];
+        mNumTokens[to] = mNumTokens[from];
+        mMaxNumTokens[to] = mMaxNumTokens[from];
+        mContextPositions[to] = mContextPositions[from];
+        mPriorities[to] = mPriorities[from];
+        mFlags[to] = mFlags[from];
+    }
+
+    void popEntry()
+    {
+        mRequests.pop_back();
+        mRequestIds.pop_back();
+        mSeqSlots.pop_back();
+        mStates.pop_back();
+        mPromptLens.pop_back();
+        mNumTokens.pop_back();
+        mMaxNumTokens.pop_back();
+        mContextPositions.pop_back();
+        mPriorities.pop_back();
+        mFlags.pop_back();
+    }
+
+    std::vector<SizeType32> mSlotToIndex;
+    std::vector<std::shared_ptr<LlmRequest>> mRequests;
+    std::vector<RequestIdType> mRequestIds;
+    std::vector<SizeType32> mSeqSlots;
+    std::vector<LlmRequestState> mStates;
+    std::vector<SizeType32> mPromptLens;
+    std::vector<SizeType32> mNumTokens;
+    std::vector<SizeType32> mMaxNumTokens;
+    std::vector<SizeType32> mContextPositions;
+    std::vector<executor::PriorityType> mPriorities;
+    std::vector<Flags> mFlags;
+};
+
+} // namespace tensorrt_llm::batch_manager
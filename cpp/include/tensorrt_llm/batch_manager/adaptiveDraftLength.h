@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Online draft length of every request, from its running acceptance rate.
+//! \details Drafts are modelled as accepted token by token with a per-request probability alpha, so a draft of length L
+//! yields (1 - alpha^(L+1)) / (1 - alpha) tokens per step (the last one from the target model) for a cost of
+//! 1 + draftTokenCost * L target tokens. alpha is estimated from the accepted lengths of the last steps, with
+//! exponential forgetting, and every adaptInterval steps the draft length is set to the one with the most tokens per
+//! cost, within [minDraftLen, maxDraftLen]. Low acceptance (creative text) thus gives short drafts and frees batch
+//! capacity, high acceptance (code) long ones. trimDraftTokens applies the length to the drafts of a request before
+//! scheduling, so that MicroBatchScheduler::fitDraftTokens works with the adapted budget.
+class AdaptiveDraftLengthController
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+
+    struct Config
+    {
+        //! \brief Bounds of the draft length. maxDraftLen is usually the max draft length of the engine.
+        SizeType32 minDraftLen{1};
+        SizeType32 maxDraftLen;
+        //! \brief Number of verified steps between two adaptations.
+        SizeType32 adaptInterval{8};
+        //! \brief Cost of verifying one draft token, relative to a step without drafts.
+        double draftTokenCost{0.1};
+        //! \brief Weight kept by past steps after every new one.
+        double forgettingFactor{0.95};
+    };
+
+    explicit AdaptiveDraftLengthController(Config const& config)
+        : mConfig{config}
+    {
+        TLLM_CHECK_WITH_INFO(config.minDraftLen >= 0 && config.minDraftLen <= config.maxDraftLen,
+            "Invalid draft length bounds [%d, %d]", config.minDraftLen, config.maxDraftLen);
+        TLLM_CHECK_WITH_INFO(config.adaptInterval > 0, "adaptInterval must be positive");
+        TLLM_CHECK_WITH_INFO(config.draftTokenCost > 0., "draftTokenCost must be positive");
+        TLLM_CHECK_WITH_INFO(config.forgettingFactor > 0. && config.forgettingFactor <= 1.,
+            "forgettingFactor must be in (0, 1]");
+    }
+
+    //! \brief Draft length of a request. Requests start with maxDraftLen.
+    [[nodiscard]] SizeType32 getDraftLen(RequestIdType requestId) const
+    {
+        auto const it = mRequests.find(requestId);
+        return it == mRequests.end() ? mConfig.maxDraftLen : it->second.draftLen;
+    }
+
+    //! \brief Estimated per-token acceptance probability of a request, 1 until a draft was verified.
+    [[nodiscard]] double getAcceptanceRate(RequestIdType requestId) const
+    {
+        auto const it = mRequests.find(requestId);
+        return it == mRequests.end() ? 1. : it->second.acceptanceRate();
+    }
+
+    //! \brief Record a verification step: numAcceptedTokens of the numDraftTokens draft tokens were accepted.
+    //! \return The draft length of the request, updated every adaptInterval steps.
+    SizeType32 update(RequestIdType requestId, SizeType32 numDraftTokens, SizeType32 numAcceptedTokens)
+    {
+        TLLM_CHECK_WITH_INFO(numAcceptedTokens >= 0 && numAcceptedTokens <= numDraftTokens,
+            "Accepted %d of %d draft tokens", numAcceptedTokens, numDraftTokens);
+        auto [it, inserted] = mRequests.try_emplace(requestId);
+        auto& state = it->second;
+        if (inserted)
+        {
+            state.draftLen = mConfig.maxDraftLen;
+        }
+        if (numDraftTokens == 0)
+        {
+            return state.draftLen;
+        }
+        // A draft token is a Bernoulli trial until the first rejection, which only happens if not all were accepted.
+        state.numAccepted = state.numAccepted * mConfig.forgettingFactor + numAcceptedTokens;
+        state.numRejected
+            = state.numRejected * mConfig.forgettingFactor + (numAcceptedTokens < numDraftTokens ? 1. : 0.);
+        if (++state.numSteps % mConfig.adaptInterval == 0)
+        {
+            state.draftLen = getBestDraftLen(state.acceptanceRate());
+        }
+        return state.draftLen;
+    }
+
+    //! \brief Forget a request, e.g. when it is finished.
+    void remove(RequestIdType requestId)
+    {
+        mRequests.erase(requestId);
+    }
+
+    //! \brief Discard the draft tokens of a request beyond its draft length.
+    void trimDraftTokens(LlmRequest& request) const
+    {
+        auto const draftLen = getDraftLen(request.mRequestId);
+        if (request.getNumDraftTokens() > draftLen)
+        {
+            request.discardDraftTokens(request.getNumDraftTokens() - draftLen);
+        }
+    }
+
+    //! \brief Lookahead configuration of a request for a draft length, scaling the window and verification set sizes
+    //! of maxConfig. The n-gram size is kept since it sets the length of the accepted paths.
+    [[nodiscard]] executor::LookaheadDecodingConfig getLookaheadConfig(
+        executor::LookaheadDecodingConfig const& maxConfig, RequestIdType requestId) const
+    {
+        auto const [windowSize, ngramSize, verificationSetSize] = maxConfig.get();
+        auto const ratio = static_cast<double>(getDraftLen(requestId)) / std::max(mConfig.maxDraftLen, 1);
+        auto scale = [ratio](SizeType32 size)
+        { return std::max(static_cast<SizeType32>(std::ceil(size * ratio)), SizeType32{1}); };
+        if (!executor::LookaheadDecodingConfig::isLegal(scale(windowSize), ngramSize, scale(verificationSetSize)))
+        {
+            return maxConfig;
+        }
+        return executor::LookaheadDecodingConfig(scale(windowSize), ngramSize, scale(verificationSetSize));
+    }
+
+private:
+    struct RequestState
+    {
+        SizeType32 draftLen{0};
+        SizeType32 numSteps{0};
+        double numAccepted{0.};
+        double numRejected{0.};
+
+        [[nodiscard]] double acceptanceRate() const
+        {
+            auto const numTrials = numAccepted + numRejected;
+            return numTrials > 0. ? numAccepted / numTrials : 1.;
+        }
+    };
+
+    [[nodiscard]] SizeType32 getBestDraftLen(double acceptanceRate) const
+    {
+        SizeType32 bestDraftLen = mConfig.minDraftLen;
+        double bestTokensPerCost = 0.;
+        double acceptedPower = 1.;
+        for (SizeType32 draftLen = 0; draftLen <= mConfig.maxDraftLen; ++draftLen)
+        {
+            // Expected number of tokens: sum of alpha^i for i in [0, draftLen].
+            acceptedPower *= acceptanceRate;
+            auto const numTokens = acceptanceRate < 1. ? (1. - acceptedPower) / (1. - acceptanceRate)
+                                                       : static_cast<double>(draftLen + 1);
+            auto const tokensPerCost = numTokens / (1. + mConfig.draftTokenCost * draftLen);
+            if (draftLen >= mConfig.minDraftLen && tokensPerCost > bestTokensPerCost)
+            {
+                bestTokensPerCost = tokensPerCost;
+                bestDraftLen = draftLen;
+            }
+        }
+        return bestDraftLen;
+    }
+
+    Config mConfig;
+    std::unordered_map<RequestIdType, RequestState> mRequests;
+};
+
+} // namespace tensorrt_llm::batch_manager
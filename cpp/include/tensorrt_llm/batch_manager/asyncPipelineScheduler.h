@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <cstdint>
+#include <deque>
+#include <unordered_set>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Bookkeeping of the asynchronous micro-batch scheduling of pipeline parallel in-flight batching.
+//! \details With the fixed micro-batches of in-flight batching, micro-batch k only takes its own sequences back once
+//! its decoder outputs were broadcast from the last rank, so a stage idles whenever micro-batch k is not ready when its
+//! turn comes. Here, the sequences are not bound to a micro-batch: the first rank launches a new micro-batch as soon
+//! as fewer than getMaxMicroBatchesInFlight are in flight, from the sequences whose new tokens arrived, whatever
+//! micro-batch they were in before. The last rank samples and sends the new tokens of each micro-batch to the first
+//! rank with runtime::PipelineTokenReturn, and the first rank passes getInflightReqIds to the MicroBatchScheduler so
+//! that the sequences waiting for their tokens are not scheduled twice.
+class AsyncPipelineScheduler
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+    using MicroBatchIdType = std::uint64_t;
+
+    //! \brief Outcome of the arrival of the new tokens of the oldest micro-batch in flight.
+    struct CompletedMicroBatch
+    {
+        MicroBatchIdType microBatchId{0};
+        //! \brief Requests that can be scheduled in the next micro-batch.
+        std::vector<RequestIdType> readyRequests;
+        //! \brief Requests that finished in this micro-batch, their resources can be released.
+        std::vector<RequestIdType> finishedRequests;
+    };
+
+    //! \param maxMicroBatchesInFlight At least the pipeline parallelism so that every stage has a micro-batch. One
+    //! more hides the return of the tokens from the last rank to the first one.
+    AsyncPipelineScheduler(SizeType32 pipelineParallelism, SizeType32 maxMicroBatchesInFlight)
+        : mMaxMicroBatchesInFlight{maxMicroBatchesInFlight}
+    {
+        TLLM_CHECK_WITH_INFO(maxMicroBatchesInFlight >= pipelineParallelism,
+            "%d micro-batches in flight cannot keep %d pipeline stages busy", maxMicroBatchesInFlight,
+            pipelineParallelism);
+    }
+
+    explicit AsyncPipelineScheduler(SizeType32 pipelineParallelism)
+        : AsyncPipelineScheduler{pipelineParallelism, pipelineParallelism + 1}
+    {
+    }
+
+    //! \brief Whether the executor loop schedules pipeline parallel micro-batches asynchronously.
+    [[nodiscard]] static bool isEnabled()
+    {
+        return common::getEnvAsyncPipelineScheduler();
+    }
+
+    [[nodiscard]] bool canLaunch() const
+    {
+        return getNumMicroBatchesInFlight() < mMaxMicroBatchesInFlight;
+    }
+
+    //! \brief Requests of the micro-batches in flight, whose new tokens did not arrive yet.
+    [[nodiscard]] ReqIdsSet const& getInflightReqIds() const
+    {
+        return mInflightReqIds;
+    }
+
+    //! \brief Record the launch of a micro-batch on the first rank.
+    MicroBatchIdType launch(std::vector<RequestIdType> requestIds)
+    {
+        TLLM_CHECK_WITH_INFO(canLaunch(), "%d micro-batches are in flight already", getNumMicroBatchesInFlight());
+        for (auto const requestId : requestIds)
+        {
+            TLLM_CHECK_WITH_INFO(mInflightReqIds.count(requestId) == 0,
+                "Request %lu is in a micro-batch in flight already", requestId);
+        }
+        mInflightReqIds.insert(requestIds.begin(), requestIds.end());
+        if (requestIds.empty())
+        {
+            ++mNumEmptyLaunches;
+        }
+        mNumLaunchedSequences += requestIds.size();
+        mMicroBatchesInFlight.push_back({mNextMicroBatchId, std::move(requestIds)});
+        return mNextMicroBatchId++;
+    }
+
+    //! \brief Id of the oldest micro-batch in flight, whose tokens arrive next.
+    [[nodiscard]] MicroBatchIdType getOldestMicroBatchId() const
+    {
+        TLLM_CHECK_WITH_INFO(!mMicroBatchesInFlight.empty(), "No micro-batch is in flight");
+        return mMicroBatchesInFlight.front().microBatchId;
+    }
+
+    //! \brief Record the arrival of the new tokens of the oldest micro-batch in flight on the first rank.
+    //! \param finishedRequests Requests of the micro-batch whose last token arrived.
+    CompletedMicroBatch complete(std::vector<RequestIdType> const& finishedRequests)
+    {
+        TLLM_CHECK_WITH_INFO(!mMicroBatchesInFlight.empty(), "No micro-batch is in flight");
+        auto microBatch = std::move(mMicroBatchesInFlight.front());
+        mMicroBatchesInFlight.pop_front();
+
+        ReqIdsSet const finished(finishedRequests.begin(), finishedRequests.end());
+        CompletedMicroBatch completed;
+        completed.microBatchId = microBatch.microBatchId;
+        for (auto const requestId : microBatch.requestIds)
+        {
+            mInflightReqIds.erase(requestId);
+            (finished.count(requestId) > 0 ? completed.finishedRequests : completed.readyRequests)
+                .push_back(requestId);
+        }
+        TLLM_CHECK_WITH_INFO(completed.finishedRequests.size() == finished.size(),
+            "Finished requests are not all in micro-batch %lu", microBatch.microBatchId);
+        return completed;
+    }
+
+    [[nodiscard]] SizeType32 getNumMicroBatchesInFlight() const
+    {
+        return static_cast<SizeType32>(mMicroBatchesInFlight.size());
+    }
+
+    [[nodiscard]] SizeType32 getMaxMicroBatchesInFlight() const noexcept
+    {
+        return mMaxMicroBatchesInFlight;
+    }
+
+    //! \brief Micro-batches launched without a ready sequence, i.e. the pipeline bubbles that remain.
+    [[nodiscard]] std::size_t getNumEmptyLaunches() const noexcept
+    {
+        return mNumEmptyLaunches;
+    }
+
+    [[nodiscard]] std::size_t getNumLaunchedSequences() const noexcept
+    {
+        return mNumLaunchedSequences;
+    }
+
+private:
+    struct MicroBatch
+    {
+        MicroBatchIdType microBatchId;
+        std::vector<RequestIdType> requestIds;
+    };
+
+    SizeType32 mMaxMicroBatchesInFlight;
+    MicroBatchIdType mNextMicroBatchId{0};
+    std::deque<MicroBatch> mMicroBatchesInFlight;
+    ReqIdsSet mInflightReqIds;
+    std::size_t mNumEmptyLaunches{0};
+    std::size_t mNumLaunchedSequences{0};
+};
+
+} // namespace tensorrt_llm::batch_manager
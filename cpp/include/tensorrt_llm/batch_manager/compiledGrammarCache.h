@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/workerPool.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief LRU cache of the compiled grammars of guided decoding, shared by the requests and by the GuidedDecoders of a
+//! tokenizer.
+//! \details Compiling a JSON schema or a regex takes tens to hundreds of milliseconds, and GuidedDecoder compiles the
+//! guide of every request, even when thousands of requests use the same schema. Grammars are keyed by guide type,
+//! normalized guide and tokenizer, and compiled on a pool of worker threads: the executor loop polls tryGet and keeps
+//! the request queued until its grammar is ready, instead of blocking on the compilation. Requests that arrive while
+//! their grammar compiles wait for the same compilation.
+//! \tparam CompiledGrammarT The compiled grammar of the backend, e.g. xgrammar::CompiledGrammar, shared read-only by
+//! the matchers of the requests.
+template <typename CompiledGrammarT>
+class CompiledGrammarCache
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using GuideType = executor::GuidedDecodingParams::GuideType;
+    using GrammarPtr = std::shared_ptr<CompiledGrammarT const>;
+    //! \brief Compiles a normalized guide, e.g. with GrammarCompiler::CompileJSONSchema. Called on a worker, and
+    //! concurrently for different guides.
+    using Compile = std::function<GrammarPtr(GuideType, std::string const& guide)>;
+
+    struct Stats
+    {
+        std::size_t numHits{0};
+        std::size_t numMisses{0};
+        std::size_t numEvictions{0};
+        std::size_t numFailures{0};
+    };
+
+    //! \param tokenizerHash Identifies the tokenizer the grammars are compiled for, see hashTokenizer.
+    //! \param maxNumGrammars Capacity of the cache, 0 to compile the guide of every request.
+    CompiledGrammarCache(Compile compile, std::uint64_t tokenizerHash,
+        std::size_t maxNumGrammars = common::getEnvCompiledGrammarCacheSize(),
+        std::size_t numWorkers = common::getEnvGrammarCompilerWorkers())
+        : mCompile{std::move(compile)}
+        , mTokenizerHash{tokenizerHash}
+        , mMaxNumGrammars{maxNumGrammars}
+        , mWorkerPool{std::make_unique<runtime::WorkerPool>(numWorkers)}
+    {
+        TLLM_CHECK_WITH_INFO(mCompile != nullptr, "A compiled grammar cache needs a compile function");
+    }
+
+    //! \brief The cache of the tokenizer shared by all the GuidedDecoders of the process, created with makeCompile on
+    //! the first call. It lives as long as one of them holds it.
+    [[nodiscard]] static std::shared_ptr<CompiledGrammarCache> getShared(
+        std::uint64_t tokenizerHash, std::function<Compile()> const& makeCompile)
+    {
+        static std::map<std::uint64_t, std::weak_ptr<CompiledGrammarCache>> registry;
+        static std::mutex registryMutex;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto& entry = registry[tokenizerHash];
+        auto cache = entry.lock();
+        if (cache == nullptr)
+        {
+            cache = std::make_shared<CompiledGrammarCache>(makeCompile(), tokenizerHash);
+            entry = cache;
+        }
+        return cache;
+    }
+
+    //! \brief Hash of the vocabulary and of the tokenizer of a guided decoding config.
+    [[nodiscard]] static std::uint64_t hashTokenizer(executor::GuidedDecodingConfig const& config)
+    {
+        std::uint64_t hash{static_cast<std::uint64_t>(config.getBackend())};
+        auto const combine = [&hash](std::string const& str)
+        { hash ^= std::hash<std::string>{}(str) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2); };
+        for (auto const& token : config.getEncodedVocab().value_or(std::vector<std::string>{}))
+        {
+            combine(token);
+        }
+        combine(config.getTokenizerStr().value_or(""));
+        return hash;
+    }
+
+    //! \brief The guide with the whitespace that does not change its meaning removed, so that the same schema
+    //! formatted differently hits the same grammar: outside of the strings of a JSON schema, and around EBNF grammars.
+    //! Regexes are kept as they are.
+    [[nodiscard]] static std::string normalizeGuide(GuideType guideType, std::string const& guide)
+    {
+        auto const isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+        if (guideType == GuideType::kJSON_SCHEMA)
+        {
+            std::string normalized;
+            normalized.reserve(guide.size());
+            bool inString{false};
+            bool escaped{false};
+            for (auto const c : guide)
+            {
+                if (inString)
+                {
+                    inString = escaped || c != '"';
+                    escaped = !escaped && c == '\\';
+                }
+                else if (isSpace(c))
+                {
+                    continue;
+                }
+                else
+                {
+                    inString = c == '"';
+                }
+                normalized.push_back(c);
+            }
+            return normalized;
+        }
+        if (guideType == GuideType::kEBNF_GRAMMAR)
+        {
+            auto first = guide.begin();
+            auto last = guide.end();
+            while (first != last && isSpace(*first))
+            {
+                ++first;
+            }
+            while (last != first && isSpace(*(last - 1)))
+            {
+                --last;
+            }
+            return {first, last};
+        }
+        return guide;
+    }
+
+    //! \brief Start compiling the grammar of the guide unless it is cached or compiling.
+    [[nodiscard]] std::shared_future<GrammarPtr> compileAsync(executor::GuidedDecodingParams const& params)
+    {
+        auto const guideType = params.getGuideType();
+        auto guide = normalizeGuide(guideType, params.getGuide().value_or(""));
+        Key key{guideType, guide, mTokenizerHash};
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (auto const it = mIndex.find(key); it != mIndex.end())
+        {
+            mEntries.splice(mEntries.begin(), mEntries, it->second);
+            ++mStats.numHits;
+            return it->second->grammar;
+        }
+        ++mStats.numMisses;
+        std::shared_future<GrammarPtr> grammar = mWorkerPool->enqueue(
+            [compile = mCompile, guideType, guide = std::move(guide)]() { return compile(guideType, guide); });
+        if (mMaxNumGrammars > 0)
+        {
+            if (mEntries.size() >= mMaxNumGrammars)
+            {
+                // Requests waiting for the grammar of the evicted entry still hold its future.
+                mIndex.erase(mEntries.back().key);
+                mEntries.pop_back();
+                ++mStats.numEvictions;
+            }
+            mEntries.push_front(Entry{key, grammar});
+            mIndex.emplace(std::move(key), mEntries.begin());
+        }
+        return grammar;
+    }
+
+    //! \brief The compiled grammar of the guide if ready, starting its compilation otherwise. Rethrows the error of a
+    //! failed compilation, which is then dropped from the cache so that a later request compiles the guide again.
+    [[nodiscard]] std::optional<GrammarPtr> tryGet(executor::GuidedDecodingParams const& params)
+    {
+        auto grammar = compileAsync(params);
+        if (grammar.wait_for(std::chrono::seconds{0}) != std::future_status::ready)
+        {
+            return std::nullopt;
+        }
+        return getReady(params, grammar);
+    }
+
+    //! \brief The compiled grammar of the guide, waiting for its compilation.
+    [[nodiscard]] GrammarPtr get(executor::GuidedDecodingParams const& params)
+    {
+        auto grammar = compileAsync(params);
+        grammar.wait();
+        return getReady(params, grammar);
+    }
+
+    [[nodiscard]] std::size_t getNumGrammars() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEntries.size();
+    }
+
+    [[nodiscard]] Stats getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+private:
+    struct Key
+    {
+        GuideType guideType;
+        std::string guide;
+        std::uint64_t tokenizerHash;
+
+        bool operator==(Key const& other) const
+        {
+            return guideType == other.guideType && tokenizerHash == other.tokenizerHash && guide == other.guide;
+        }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(Key const& key) const
+        {
+            auto const hash = std::hash<std::string>{}(key.guide);
+            return hash ^ (static_cast<std::size_t>(key.guideType) << 1) ^ (key.tokenizerHash << 2);
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        std::shared_future<GrammarPtr> grammar;
+    };
+
+    [[nodiscard]] GrammarPtr getReady(
+        executor::GuidedDecodingParams const& params, std::shared_future<GrammarPtr> const& grammar)
+    {
+        try
+        {
+            return grammar.get();
+        }
+        catch (...)
+        {
+            auto const guideType = params.getGuideType();
+            Key const key{guideType, normalizeGuide(guideType, params.getGuide().value_or("")), mTokenizerHash};
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (auto const it = mIndex.find(key); it != mIndex.end())
+            {
+                mEntries.erase(it->second);
+                mIndex.erase(it);
+                ++mStats.numFailures;
+            }
+            throw;
+        }
+    }
+
+    Compile mCompile;
+    std::uint64_t mTokenizerHash;
+    std::size_t mMaxNumGrammars;
+
+    // Most recently used first.
+    std::list<Entry> mEntries;
+    std::unordered_map<Key, typename std::list<Entry>::iterator, KeyHash> mIndex;
+    mutable std::mutex mMutex;
+    Stats mStats;
+
+    // Declared last to join the workers before the cache is destroyed.
+    std::unique_ptr<runtime::WorkerPool> mWorkerPool;
+};
+
+} // namespace tensorrt_llm::batch_manager
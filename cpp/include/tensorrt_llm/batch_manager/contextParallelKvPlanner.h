@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/worldConfig.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Which rank of a context parallel group owns which tokens of a sequence, and so what its BlockManager holds.
+//! \details The prompt is cut into 2 * cpSize slices and rank r owns slices r and 2 * cpSize - 1 - r. With causal
+//! attention, the late slices attend to more tokens than the early ones, so pairing them balances the ring attention
+//! steps of the ranks. The generated tokens are owned a block at a time, round robin from rank 0, so that the KV cache
+//! of every rank grows by whole blocks and the ranks are evenly loaded in the generation phase too. Each rank only
+//! allocates the blocks of its own tokens, the sum being one GPU worth of KV cache for cpSize times longer sequences.
+class ContextParallelKvPlanner
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using TokenRange = std::pair<SizeType32, SizeType32>;
+
+    ContextParallelKvPlanner(SizeType32 cpRank, SizeType32 cpSize, SizeType32 tokensPerBlock)
+        : mCpRank{cpRank}
+        , mCpSize{cpSize}
+        , mTokensPerBlock{tokensPerBlock}
+    {
+        TLLM_CHECK_WITH_INFO(cpSize >= 1 && cpRank >= 0 && cpRank < cpSize, "Invalid context parallel rank %d of %d",
+            cpRank, cpSize);
+        TLLM_CHECK(tokensPerBlock > 0);
+    }
+
+    ContextParallelKvPlanner(runtime::WorldConfig const& worldConfig, SizeType32 tokensPerBlock)
+        : ContextParallelKvPlanner{
+            worldConfig.getContextParallelRank(), worldConfig.getContextParallelism(), tokensPerBlock}
+    {
+    }
+
+    //! \brief Prompt tokens of a rank, as at most 2 non-empty [begin, end) ranges in increasing order.
+    [[nodiscard]] std::vector<TokenRange> getContextTokenRanges(SizeType32 promptLen, SizeType32 cpRank) const
+    {
+        auto const numSlices = 2 * mCpSize;
+        auto const sliceLen = divUp(promptLen, numSlices);
+        std::vector<TokenRange> ranges;
+        for (auto const slice : {cpRank, numSlices - 1 - cpRank})
+        {
+            auto const begin = std::min(slice * sliceLen, promptLen);
+            auto const end = std::min(begin + sliceLen, promptLen);
+            if (begin < end)
+            {
+                ranges.emplace_back(begin, end);
+            }
+        }
+        return ranges;
+    }
+
+    [[nodiscard]] std::vector<TokenRange> getContextTokenRanges(SizeType32 promptLen) const
+    {
+        return getContextTokenRanges(promptLen, mCpRank);
+    }
+
+    //! \brief Positions of the prompt tokens of this rank, the queries and KV positions of the ring attention.
+    [[nodiscard]] std::vector<SizeType32> getContextPositions(SizeType32 promptLen) const
+    {
+        std::vector<SizeType32> positions;
+        for (auto const& [begin, end] : getContextTokenRanges(promptLen))
+        {
+            for (auto pos = begin; pos < end; ++pos)
+            {
+                positions.push_back(pos);
+            }
+        }
+        return positions;
+    }
+
+    [[nodiscard]] SizeType32 getNumLocalContextTokens(SizeType32 promptLen, SizeType32 cpRank) const
+    {
+        SizeType32 numTokens = 0;
+        for (auto const& [begin, end] : getContextTokenRanges(promptLen, cpRank))
+        {
+            numTokens += end - begin;
+        }
+        return numTokens;
+    }
+
+    //! \brief Largest number of prompt tokens of a rank, the capacity of the KV chunks of the ring.
+    [[nodiscard]] SizeType32 getMaxLocalContextTokens(SizeType32 promptLen) const
+    {
+        SizeType32 maxTokens = 0;
+        for (SizeType32 rank = 0; rank < mCpSize; ++rank)
+        {
+            maxTokens = std::max(maxTokens, getNumLocalContextTokens(promptLen, rank));
+        }
+        return maxTokens;
+    }
+
+    //! \brief Rank that stores the KV of the generated token at position pos >= promptLen.
+    [[nodiscard]] SizeType32 getGenerationTokenOwner(SizeType32 promptLen, SizeType32 pos) const
+    {
+        TLLM_CHECK_WITH_INFO(pos >= promptLen, "Token %d is in the prompt of length %d", pos, promptLen);
+        return ((pos - promptLen) / mTokensPerBlock) % mCpSize;
+    }
+
+    //! \brief Generated tokens of this rank among the first numGenerated.
+    [[nodiscard]] SizeType32 getNumLocalGenerationTokens(SizeType32 numGenerated) const
+    {
+        auto const numFullRounds = numGenerated / (mTokensPerBlock * mCpSize);
+        auto const rest = numGenerated - numFullRounds * mTokensPerBlock * mCpSize;
+        auto const restOfRank = std::clamp(rest - mCpRank * mTokensPerBlock, 0, mTokensPerBlock);
+        return numFullRounds * mTokensPerBlock + restOfRank;
+    }
+
+    //! \brief Tokens of a sequence whose KV this rank stores.
+    [[nodiscard]] SizeType32 getNumLocalTokens(SizeType32 promptLen, SizeType32 numGenerated) const
+    {
+        return getNumLocalContextTokens(promptLen, mCpRank) + getNumLocalGenerationTokens(numGenerated);
+    }
+
+    //! \brief Blocks the BlockManager of this rank allocates for a sequence. The two prompt slices do not share blocks
+    //! since their tokens are not contiguous, the generated tokens fill whole blocks of their own.
+    [[nodiscard]] SizeType32 getNumLocalBlocks(SizeType32 promptLen, SizeType32 numGenerated) const
+    {
+        SizeType32 numBlocks = 0;
+        for (auto const& [begin, end] : getContextTokenRanges(promptLen))
+        {
+            numBlocks += divUp(end - begin, mTokensPerBlock);
+        }
+        return numBlocks + divUp(getNumLocalGenerationTokens(numGenerated), mTokensPerBlock);
+    }
+
+private:
+    [[nodiscard]] static SizeType32 divUp(SizeType32 a, SizeType32 b)
+    {
+        return (a + b - 1) / b;
+    }
+
+    SizeType32 mCpRank;
+    SizeType32 mCpSize;
+    SizeType32 mTokensPerBlock;
+};
+
+} // namespace tensorrt_llm::batch_manager
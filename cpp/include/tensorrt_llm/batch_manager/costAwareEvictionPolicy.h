@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/evictionPolicy.h"
+#include "tensorrt_llm/batch_manager/indexedEvictionPolicy.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::eviction_policy
+{
+
+//! \brief Counters of an eviction policy, used to compare policies against each other.
+struct EvictionPolicyStats
+{
+    // Number of claimed blocks whose cached content was reused.
+    std::size_t numHits{0};
+    // Number of claimed blocks that were allocated for new content.
+    std::size_t numMisses{0};
+    // Number of blocks with cached content that were handed out for eviction.
+    std::size_t numEvictions{0};
+
+    [[nodiscard]] float getHitRate() const
+    {
+        auto const numClaims = numHits + numMisses;
+        return numClaims == 0 ? 0.F : static_cast<float>(numHits) / static_cast<float>(numClaims);
+    }
+};
+
+// Greedy-dual-size-frequency (GDSF) eviction. Every released block gets the key
+//     H = L + frequency * cost
+// where L is the key of the last evicted block of the same cache level (aging), frequency counts how often the block
+// was claimed since it was filled, and cost estimates how expensive it is to lose the block:
+//     cost = (1 + depthWeight / depth) * (hostCopyDiscount if a host copy can be made else 1)
+// Blocks close to the root of the reuse tree are shared by more descendants and are therefore more expensive to lose.
+// Primary blocks that are offloaded on eviction only cost a transfer to restore. All blocks have the same size, so the
+// cost per byte is proportional to the cost. Retention priorities take precedence over the key, as in
+// LRUEvictionPolicy: blocks of lower priority are always evicted first.
+class CostAwareEvictionPolicy : public BaseEvictionPolicy
+{
+public:
+    explicit CostAwareEvictionPolicy(double depthWeight = 4.0, double hostCopyDiscount = 0.5)
+        : mDepthWeight{depthWeight}
+        , mHostCopyDiscount{hostCopyDiscount}
+    {
+    }
+
+    void initialize(std::vector<BlockPtr>& mAllBlocksById, std::vector<SizeType32> sizes,
+        std::optional<executor::RetentionPriority> secondaryOffloadMinPriority) override
+    {
+        mAllBlocks = &mAllBlocksById;
+        mSecondaryOffloadMinPriority
+            = secondaryOffloadMinPriority.value_or(executor::KvCacheRetentionConfig::kMinRetentionPriority);
+        mFreeBlocks.assign(sizes.size(), {});
+        mInflation.assign(sizes.size(), 0.0);
+        mBlockStates.assign(mAllBlocksById.size(), {});
+
+        SizeType32 blockIdx{0};
+        for (SizeType32 level = 0; level < static_cast<SizeType32>(sizes.size()); ++level)
+        {
+            for (SizeType32 i = 0; i < sizes[level]; ++i, ++blockIdx)
+            {
+                auto& state = mBlockStates.at(blockIdx);
+                state.level = level;
+                state.key = EvictionKey{executor::KvCacheRetentionConfig::kDefaultRetentionPriority, 0.0, blockIdx};
+                state.isFree = true;
+                mFreeBlocks[level].insert(state.key);
+            }
+        }
+    }
+
+    std::tuple<BlockPtr, bool> getFreeBlock(SizeType32 cacheLevel) override
+    {
+        auto& freeBlocks = mFreeBlocks.at(cacheLevel);
+        TLLM_CHECK_WITH_INFO(!freeBlocks.empty(), "No free block in cache level %d", cacheLevel);
+        auto const& key = *freeBlocks.begin();
+        auto const& block = mAllBlocks->at(key.blockId);
+        auto& state = mBlockStates.at(key.blockId);
+        if (state.hasContent)
+        {
+            mInflation[cacheLevel] = std::max(mInflation[cacheLevel], key.value);
+            ++mStats.numEvictions;
+        }
+        state.isPendingEviction = true;
+
+        bool const canOffload = cacheLevel == kPrimaryLevel && hasSecondaryLevel()
+            && !mFreeBlocks[kSecondaryLevel].empty() && block->getPriority() >= mSecondaryOffloadMinPriority;
+        return {block, canOffload};
+    }
+
+    void releaseBlock(BlockPtr block) override
+    {
+        releaseBlock(std::move(block), false);
+    }
+
+    void releaseBlock(BlockPtr block, bool toFront) override
+    {
+        auto const blockId = block->getBlockId();
+        auto& state = mBlockStates.at(blockId);
+        if (state.isFree)
+        {
+            mFreeBlocks[state.level].erase(state.key);
+        }
+        state.level = block->isPrimary() ? kPrimaryLevel : kSecondaryLevel;
+        auto const& prevBlock = block->getPrevBlock();
+        state.depth = prevBlock != nullptr ? mBlockStates.at(prevBlock->getBlockId()).depth + 1 : 1;
+
+        auto const priority = toFront ? executor::KvCacheRetentionConfig::kMinRetentionPriority - 1
+                                      : block->getPriority();
+        state.key = EvictionKey{priority, mInflation[state.level] + state.frequency * getCost(state), blockId};
+        state.isFree = true;
+        mFreeBlocks[state.level].insert(state.key);
+
+        if (block->getDurationMs().has_value()
+            && block->getPriority() != executor::KvCacheRetentionConfig::kDefaultRetentionPriority)
+        {
+            block->setExpirationTime(getTime() + *block->getDurationMs());
+            mExpiringBlockHeap.insert(block);
+        }
+    }
+
+    SizeType32 getNumFreeBlocks(SizeType32 cacheLevel) override
+    {
+        return static_cast<SizeType32>(mFreeBlocks.at(cacheLevel).size());
+    }
+
+    void claimBlock(BlockPtr block) override
+    {
+        claimBlock(std::move(block), std::nullopt, std::nullopt);
+    }
+
+    void claimBlock(BlockPtr block, std::optional<executor::RetentionPriority> priority,
+        std::optional<std::chrono::milliseconds> durationMs) override
+    {
+        auto& state = mBlockStates.at(block->getBlockId());
+        if (state.isFree)
+        {
+            mFreeBlocks[state.level].erase(state.key);
+            state.isFree = false;
+        }
+        if (state.isPendingEviction || !state.hasContent)
+        {
+            // The block is (re)allocated for new content.
+            ++mStats.numMisses;
+            state.frequency = 1;
+            state.hasContent = true;
+        }
+        else
+        {
+            ++mStats.numHits;
+            ++state.frequency;
+        }
+        state.isPendingEviction = false;
+
+        if (priority.has_value())
+        {
+            block->setPriority(*priority);
+        }
+        mExpiringBlockHeap.erase(block);
+        block->setDurationMs(durationMs);
+    }
+
+    // Check the expiring blocks heap, and give expired blocks the default priority again.
+    void refresh() override
+    {
+        while (!mExpiringBlockHeap.empty())
+        {
+            auto const block = *mExpiringBlockHeap.begin();
+            if (block->getExpirationTime() > getTime())
+            {
+                break;
+            }
+            mExpiringBlockHeap.erase(mExpiringBlockHeap.begin());
+
+            auto& state = mBlockStates.at(block->getBlockId());
+            block->setPriority(executor::KvCacheRetentionConfig::kDefaultRetentionPriority);
+            if (state.isFree)
+            {
+                mFreeBlocks[state.level].erase(state.key);
+                state.key.priority = executor::KvCacheRetentionConfig::kDefaultRetentionPriority;
+                mFreeBlocks[state.level].insert(state.key);
+            }
+        }
+    }
+
+    // Making this public and virtual makes it possible to test.
+    [[nodiscard]] virtual std::chrono::steady_clock::time_point::duration getTime() const
+    {
+        return std::chrono::steady_clock::now().time_since_epoch();
+    }
+
+    [[nodiscard]] EvictionPolicyStats const& getStats() const
+    {
+        return mStats;
+    }
+
+private:
+    struct EvictionKey
+    {
+        executor::RetentionPriority priority;
+        double value;
+        KVCacheBlock::IdType blockId;
+
+        bool operator<(EvictionKey const& other) const
+        {
+            return std::tie(priority, value, blockId) < std::tie(other.priority, other.value, other.blockId);
+        }
+    };
+
+    struct BlockState
+    {
+        EvictionKey key{};
+        SizeType32 level{kPrimaryLevel};
+        SizeType32 depth{1};
+        std::uint32_t frequency{0};
+        bool isFree{false};
+        bool hasContent{false};
+        bool isPendingEviction{false};
+    };
+
+    [[nodiscard]] bool hasSecondaryLevel() const
+    {
+        return mFreeBlocks.size() > static_cast<std::size_t>(kSecondaryLevel);
+    }
+
+    [[nodiscard]] double getCost(BlockState const& state) const
+    {
+        auto const cost = 1.0 + mDepthWeight / static_cast<double>(state.depth);
+        return state.level == kPrimaryLevel && hasSecondaryLevel() ? cost * mHostCopyDiscount : cost;
+    }
+
+    double mDepthWeight;
+    double mHostCopyDiscount;
+    std::vector<BlockPtr>* mAllBlocks{nullptr};
+    // Free blocks of every cache level, ordered by eviction key. The first block is evicted first.
+    std::vector<std::set<EvictionKey>> mFreeBlocks;
+    // Key of the last evicted block of every cache level.
+    std::vector<double> mInflation;
+    std::vector<BlockState> mBlockStates;
+    // Secondary offload threshold. Blocks below this priority won't be offloaded.
+    executor::RetentionPriority mSecondaryOffloadMinPriority{executor::KvCacheRetentionConfig::kMinRetentionPriority};
+    // Heap of block times
+    std::set<BlockPtr, ExpiringBlockComparator> mExpiringBlockHeap;
+    EvictionPolicyStats mStats;
+};
+
+//! \brief Create the eviction policy selected by name, see getEnvKVCacheEvictionPolicy.
+inline std::shared_ptr<BaseEvictionPolicy> createEvictionPolicy(
+    std::string const& name = common::getEnvKVCacheEvictionPolicy())
+{
+    if (name == "lru")
+    {
+        return std::make_shared<LRUEvictionPolicy>();
+    }
+    if (name == "indexed_lru")
+    {
+        return std::make_shared<IndexedLRUEvictionPolicy>();
+    }
+    if (name == "cost_aware")
+    {
+        return std::make_shared<CostAwareEvictionPolicy>();
+    }
+    TLLM_THROW("Unknown KV cache eviction policy %s, expected lru, indexed_lru or cost_aware", name.c_str());
+}
+
+} // namespace tensorrt_llm::batch_manager::eviction_policy
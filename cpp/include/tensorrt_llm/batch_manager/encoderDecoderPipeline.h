@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Runs the encoder steps of encoder-decoder models on their own stream, in parallel with the decoder steps.
+//! \details Without it, the encoder step of the new requests and the decoder steps of the running ones alternate on
+//! one stream. Here the encoder engine runs on the encoder stream, with its own execution context, and writes its
+//! outputs to one of numEncoderBuffers buffers. The decoder stream waits for the encoder step of a request before its
+//! context step, which computes the cross KV cache of the request from the encoder output. From then on the decoder
+//! reads the cross KV cache only, and the request releases its encoder output. A buffer is reused by a later encoder
+//! step once all its requests released it, the encoder stream then waits for the decoder steps that read it.
+//!
+//! With two buffers, the encoder of step N + 1 runs while the decoder reads the outputs of step N.
+class EncoderDecoderPipeline
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+    using CudaStreamPtr = std::shared_ptr<runtime::CudaStream>;
+
+    explicit EncoderDecoderPipeline(SizeType32 numEncoderBuffers = 2)
+        : mEncoderStream{std::make_shared<runtime::CudaStream>()}
+        , mBuffers(numEncoderBuffers)
+    {
+        TLLM_CHECK_WITH_INFO(numEncoderBuffers >= 1, "The encoder needs at least one output buffer");
+    }
+
+    //! \brief Whether the executor pipelines the encoder and decoder steps.
+    [[nodiscard]] static bool isEnabled()
+    {
+        return common::getEnvEncoderDecoderPipelining();
+    }
+
+    //! \brief The stream to run the encoder engine and the copies of its outputs on.
+    [[nodiscard]] CudaStreamPtr const& getEncoderStream() const
+    {
+        return mEncoderStream;
+    }
+
+    //! \brief Whether an encoder buffer is free for a new encoder step.
+    [[nodiscard]] bool canLaunchEncoder() const
+    {
+        return findFreeBuffer().has_value();
+    }
+
+    //! \brief Claims a free buffer for an encoder step of some requests. The encoder stream waits for the decoder
+    //! steps that read the previous outputs of the buffer, enqueue the encoder step on it afterwards.
+    //! \return The index of the buffer to write the encoder outputs to.
+    SizeType32 beginEncoderStep(std::vector<RequestIdType> const& requestIds)
+    {
+        auto const bufferIdx = findFreeBuffer();
+        TLLM_CHECK_WITH_INFO(bufferIdx.has_value(), "All %zu encoder buffers are in use", mBuffers.size());
+        TLLM_CHECK_WITH_INFO(!requestIds.empty(), "An encoder step needs requests");
+        auto& buffer = mBuffers[*bufferIdx];
+        if (buffer.used)
+        {
+            mEncoderStream->wait(buffer.released);
+        }
+        buffer.used = true;
+        buffer.ended = false;
+        for (auto const requestId : requestIds)
+        {
+            TLLM_CHECK_WITH_INFO(mBufferByRequest.count(requestId) == 0, "Request %lu has an encoder output already",
+                requestId);
+            buffer.readers.insert(requestId);
+            mBufferByRequest.emplace(requestId, *bufferIdx);
+        }
+        return *bufferIdx;
+    }
+
+    //! \brief Marks the end of the encoder step writing to a buffer, once it is enqueued on the encoder stream.
+    void endEncoderStep(SizeType32 bufferIdx)
+    {
+        auto& buffer = mBuffers.at(bufferIdx);
+        TLLM_CHECK_WITH_INFO(
+            !buffer.readers.empty() && !buffer.ended, "No encoder step writes to buffer %d", bufferIdx);
+        mEncoderStream->record(buffer.ready);
+        buffer.ended = true;
+    }
+
+    //! \brief The buffer holding the encoder output of a request, nullopt once released.
+    [[nodiscard]] std::optional<SizeType32> getBufferIdx(RequestIdType requestId) const
+    {
+        auto const it = mBufferByRequest.find(requestId);
+        return it == mBufferByRequest.end() ? std::nullopt : std::optional<SizeType32>{it->second};
+    }
+
+    //! \brief Whether the encoder step of a request is done on the device. The scheduler may prefer the requests
+    //! whose encoder output is ready, the others would make the decoder step wait.
+    [[nodiscard]] bool isEncoderOutputReady(RequestIdType requestId) const
+    {
+        auto const& buffer = getBuffer(requestId);
+        if (!buffer.ended)
+        {
+            return false;
+        }
+        auto const status = ::cudaEventQuery(buffer.ready.get());
+        if (status == cudaErrorNotReady)
+        {
+            return false;
+        }
+        TLLM_CUDA_CHECK(status);
+        return true;
+    }
+
+    //! \brief Makes the decoder stream wait for the encoder step of a request, before its context step.
+    void waitForEncoderOutput(RequestIdType requestId, runtime::CudaStream const& decoderStream) const
+    {
+        auto const& buffer = getBuffer(requestId);
+        TLLM_CHECK_WITH_INFO(buffer.ended, "The encoder step of request %lu is not enqueued", requestId);
+        decoderStream.wait(buffer.ready);
+    }
+
+    //! \brief Releases the encoder output of a request once the decoder steps reading it are enqueued on the decoder
+    //! stream, the context step that computes the cross KV cache. Call it for the requests that are terminated before
+    //! their context step too.
+    void releaseEncoderOutput(RequestIdType requestId, runtime::CudaStream const& decoderStream)
+    {
+        auto const it = mBufferByRequest.find(requestId);
+        if (it == mBufferByRequest.end())
+        {
+            return;
+        }
+        auto& buffer = mBuffers[it->second];
+        // The buffers are released on the one decoder stream, so the last record covers the earlier readers.
+        decoderStream.record(buffer.released);
+        buffer.readers.erase(requestId);
+        mBufferByRequest.erase(it);
+    }
+
+    [[nodiscard]] SizeType32 getNumBuffersInUse() const
+    {
+        SizeType32 numInUse{0};
+        for (auto const& buffer : mBuffers)
+        {
+            numInUse += buffer.readers.empty() ? 0 : 1;
+        }
+        return numInUse;
+    }
+
+private:
+    struct Buffer
+    {
+        //! \brief The requests whose encoder output is in the buffer and not released.
+        std::unordered_set<RequestIdType> readers;
+        //! \brief Recorded on the encoder stream after the encoder step.
+        runtime::CudaEvent ready;
+        //! \brief Recorded on the decoder stream after the last step reading the buffer.
+        runtime::CudaEvent released;
+        //! \brief Whether the buffer was written once, the next encoder step must then wait for its readers.
+        bool used{false};
+        bool ended{false};
+    };
+
+    [[nodiscard]] std::optional<SizeType32> findFreeBuffer() const
+    {
+        for (SizeType32 idx = 0; idx < static_cast<SizeType32>(mBuffers.size()); ++idx)
+        {
+            if (mBuffers[idx].readers.empty())
+            {
+                return idx;
+            }
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] Buffer const& getBuffer(RequestIdType requestId) const
+    {
+        auto const it = mBufferByRequest.find(requestId);
+        TLLM_CHECK_WITH_INFO(it != mBufferByRequest.end(), "Request %lu has no encoder output", requestId);
+        return mBuffers[it->second];
+    }
+
+    CudaStreamPtr mEncoderStream;
+    std::vector<Buffer> mBuffers;
+    std::unordered_map<RequestIdType, SizeType32> mBufferByRequest;
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+// Reuse of the encoder of encoder-decoder models. The same encoder input, an audio chunk retried or a document queried
+// several times, gives the same encoder output and the same cross KV cache. The requests are keyed by a hash of their
+// encoder input: a request whose input is cached takes the cached encoder output and skips the encoder phase.
+//
+// The cross KV cache blocks are reused by the cross KVCacheManager like the self attention ones, keyed by the encoder
+// unique tokens of the request. Every request gets unique tokens derived from the hash of its whole encoder input, so
+// that the blocks of the same input match and the blocks of inputs sharing a prefix do not, see CrossKvBlockReuse.
+
+namespace encoder_output_cache
+{
+
+using InputHash = std::uint64_t;
+
+inline std::uint64_t mix(std::uint64_t value)
+{
+    value = (value ^ (value >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    value = (value ^ (value >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return value ^ (value >> 31);
+}
+
+inline InputHash combine(InputHash seed, std::uint64_t value)
+{
+    return seed ^ (mix(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+//! \brief The hash of the encoder input of a request, nullopt if the encoder output cannot be reused.
+//! \details Features are hashed with their shape and type, they must be in host memory. The requests with a prompt
+//! table are not reused, the table is part of what the encoder sees.
+inline std::optional<InputHash> hashEncoderInput(LlmRequest const& llmRequest)
+{
+    if (llmRequest.getPromptEmbeddingTable().has_value())
+    {
+        return std::nullopt;
+    }
+    auto const loraTaskId = llmRequest.getLoraTaskId();
+    InputHash seed = combine(combine(0, loraTaskId.has_value()), loraTaskId.value_or(0));
+    if (auto const& features = llmRequest.getEncoderInputFeatures(); features)
+    {
+        if (features->getMemoryType() == runtime::MemoryType::kGPU)
+        {
+            return std::nullopt;
+        }
+        seed = combine(seed, static_cast<std::uint64_t>(features->getDataType()));
+        auto const& shape = features->getShape();
+        for (runtime::SizeType32 dim = 0; dim < shape.nbDims; ++dim)
+        {
+            seed = combine(seed, static_cast<std::uint64_t>(shape.d[dim]));
+        }
+        auto const* bytes = static_cast<std::uint8_t const*>(features->data());
+        auto const numBytes = features->getSizeInBytes();
+        std::size_t idx = 0;
+        for (; idx + sizeof(std::uint64_t) <= numBytes; idx += sizeof(std::uint64_t))
+        {
+            std::uint64_t word;
+            std::memcpy(&word, bytes + idx, sizeof(word));
+            seed = combine(seed, word);
+        }
+        for (; idx < numBytes; ++idx)
+        {
+            seed = combine(seed, bytes[idx]);
+        }
+        return seed;
+    }
+    if (auto const& tokens = llmRequest.getEncoderTokens(); tokens.has_value() && tokens.value())
+    {
+        seed = combine(seed, tokens.value()->size());
+        for (auto const token : *tokens.value())
+        {
+            seed = combine(seed, static_cast<std::uint32_t>(token));
+        }
+        return seed;
+    }
+    return std::nullopt;
+}
+
+//! \brief The unique tokens keying the cross KV cache blocks of an encoder output of numTokens positions.
+inline std::shared_ptr<runtime::VecUniqueTokens> makeCrossKvUniqueTokens(InputHash hash, runtime::SizeType32 numTokens)
+{
+    auto tokens = std::make_shared<runtime::VecUniqueTokens>(numTokens);
+    for (runtime::SizeType32 idx = 0; idx < numTokens; ++idx)
+    {
+        // The token ids alone key the blocks in case the cross cache ignores the extra ids.
+        auto const tokenId
+            = static_cast<runtime::TokenIdType>(mix(hash + static_cast<std::uint64_t>(idx)) & 0x7fffffff);
+        (*tokens)[idx] = runtime::UniqueToken{tokenId, hash};
+    }
+    return tokens;
+}
+
+} // namespace encoder_output_cache
+
+//! \brief The encoder inputs whose outputs are cached, least recently used evicted first within a byte budget.
+class EncoderOutputCacheIndex
+{
+public:
+    using InputHash = encoder_output_cache::InputHash;
+
+    explicit EncoderOutputCacheIndex(std::size_t maxBytes)
+        : mMaxBytes{maxBytes}
+    {
+    }
+
+    [[nodiscard]] std::size_t getMaxBytes() const
+    {
+        return mMaxBytes;
+    }
+
+    [[nodiscard]] std::size_t getNumBytes() const
+    {
+        return mNumBytes;
+    }
+
+    [[nodiscard]] std::size_t getNumEntries() const
+    {
+        return mEntries.size();
+    }
+
+    [[nodiscard]] bool contains(InputHash hash) const
+    {
+        return mEntries.count(hash) != 0;
+    }
+
+    //! \return Whether the input is cached, and makes it the most recently used if so.
+    bool touch(InputHash hash)
+    {
+        auto const it = mEntries.find(hash);
+        if (it == mEntries.end())
+        {
+            return false;
+        }
+        mLru.splice(mLru.begin(), mLru, it->second.lruIt);
+        return true;
+    }
+
+    //! \brief Adds an input whose output takes numBytes, evicting the least recently used ones to make room.
+    //! \return The evicted inputs, or nullopt if the output is cached already or does not fit in the budget at all.
+    std::optional<std::vector<InputHash>> insert(InputHash hash, std::size_t numBytes)
+    {
+        if (numBytes > mMaxBytes || touch(hash))
+        {
+            return std::nullopt;
+        }
+        std::vector<InputHash> evicted;
+        while (mNumBytes + numBytes > mMaxBytes)
+        {
+            evicted.push_back(mLru.back());
+            erase(mLru.back());
+        }
+        mLru.push_front(hash);
+        mEntries.emplace(hash, Entry{numBytes, mLru.begin()});
+        mNumBytes += numBytes;
+        return evicted;
+    }
+
+    void erase(InputHash hash)
+    {
+        auto const it = mEntries.find(hash);
+        if (it == mEntries.end())
+        {
+            return;
+        }
+        mNumBytes -= it->second.numBytes;
+        mLru.erase(it->second.lruIt);
+        mEntries.erase(it);
+    }
+
+private:
+    struct Entry
+    {
+        std::size_t numBytes;
+        std::list<InputHash>::iterator lruIt;
+    };
+
+    std::size_t mMaxBytes;
+    std::size_t mNumBytes{0};
+    //! \brief Most recently used first.
+    std::list<InputHash> mLru;
+    std::unordered_map<InputHash, Entry> mEntries;
+};
+
+//! \brief Device copies of the encoder outputs of recent encoder inputs, indexed by EncoderOutputCacheIndex.
+//! \details Call `lookup` when an encoder-decoder request arrives and skip its encoder phase on a hit. Call `store`
+//! once the encoder output of a request is computed. The cached outputs are shared read only with the requests, so an
+//! eviction only drops the reference of the cache.
+class EncoderOutputCache
+{
+public:
+    using TensorPtr = runtime::ITensor::SharedPtr;
+    using InputHash = encoder_output_cache::InputHash;
+
+    struct Stats
+    {
+        std::size_t numHits{0};
+        std::size_t numMisses{0};
+        std::size_t numEvictions{0};
+    };
+
+    EncoderOutputCache(std::size_t maxBytes, runtime::BufferManager const& bufferManager)
+        : mIndex{maxBytes}
+        , mBufferManager{bufferManager}
+    {
+    }
+
+    //! \brief Gives the request the cached encoder output of its input, if any, and the cross KV cache keys of its
+    //! input.
+    //! \return Whether the encoder output is cached, the request can then skip the encoder phase.
+    bool lookup(LlmRequest& llmRequest)
+    {
+        auto const hash = encoder_output_cache::hashEncoderInput(llmRequest);
+        if (!hash.has_value())
+        {
+            return false;
+        }
+        llmRequest.setEncoderUniqueTokens(
+            encoder_output_cache::makeCrossKvUniqueTokens(*hash, llmRequest.getEncoderOutputLen()));
+        if (!mIndex.touch(*hash))
+        {
+            ++mStats.numMisses;
+            return false;
+        }
+        ++mStats.numHits;
+        llmRequest.setEncoderOutput(mOutputs.at(*hash));
+        TLLM_LOG_DEBUG("Request %lu reuses a cached encoder output", llmRequest.mRequestId);
+        return true;
+    }
+
+    //! \brief Keeps a copy of the encoder output of the request, enqueued on the stream of the buffer manager.
+    //! \return Whether the output is cached, false if it is cached already, cannot be reused or exceeds the budget.
+    bool store(LlmRequest const& llmRequest)
+    {
+        auto const& output = llmRequest.getEncoderOutput();
+        auto const hash = encoder_output_cache::hashEncoderInput(llmRequest);
+        if (!output || !hash.has_value())
+        {
+            return false;
+        }
+        auto const evicted = mIndex.insert(*hash, output->getSizeInBytes());
+        if (!evicted.has_value())
+        {
+            return false;
+        }
+        for (auto const evictedHash : *evicted)
+        {
+            mOutputs.erase(evictedHash);
+        }
+        mStats.numEvictions += evicted->size();
+        // The encoder output of the request may be a slice of the buffers of the encoder step, reused by the next one.
+        mOutputs.emplace(*hash, mBufferManager.copyFrom(*output, runtime::MemoryType::kGPU));
+        return true;
+    }
+
+    [[nodiscard]] EncoderOutputCacheIndex const& getIndex() const
+    {
+        return mIndex;
+    }
+
+    [[nodiscard]] Stats const& getStats() const
+    {
+        return mStats;
+    }
+
+private:
+    EncoderOutputCacheIndex mIndex;
+    runtime::BufferManager const& mBufferManager;
+    std::unordered_map<InputHash, TensorPtr> mOutputs;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::batch_manager
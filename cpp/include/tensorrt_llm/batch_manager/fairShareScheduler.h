@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Weighted fair sharing of the batch between tenants, by virtual time.
+//! \details A tenant is the client id of a request, or its LoRA task id if it has no client id. Every tenant has a
+//! virtual time that advances by the tokens it was served divided by its weight. Requests are ordered by the virtual
+//! time at which their next piece of work would finish, so the capacity and micro batch schedulers, which serve their
+//! input in order, serve tenants in proportion to their weights however many requests each one queues. A tenant that
+//! becomes active again starts at the current virtual time and cannot spend service it did not use while idle.
+class FairShareScheduler
+{
+public:
+    using SizeType32 = runtime::SizeType32;
+    using TenantIdType = std::uint64_t;
+
+    static constexpr TenantIdType kDefaultTenantId = std::numeric_limits<TenantIdType>::max();
+
+    struct TenantStats
+    {
+        std::int64_t numTokens{0};
+        //! \brief Tokens per second over the last iteration the tenant was served in.
+        double tokensPerSecond{0.};
+    };
+
+    [[nodiscard]] static TenantIdType getTenantId(LlmRequest const& request)
+    {
+        if (request.mClientId.has_value())
+        {
+            return *request.mClientId;
+        }
+        auto const loraTaskId = request.getLoraTaskId();
+        return loraTaskId.has_value() ? static_cast<TenantIdType>(*loraTaskId) : kDefaultTenantId;
+    }
+
+    //! \brief Share of a tenant relative to the others. Tenants have weight 1 by default.
+    void setWeight(TenantIdType tenantId, double weight)
+    {
+        TLLM_CHECK_WITH_INFO(weight > 0., "Tenant weights must be positive");
+        mTenants[tenantId].weight = weight;
+    }
+
+    //! \brief Order requests for the schedulers, stable within a tenant.
+    template <typename Requests>
+    [[nodiscard]] RequestVector order(Requests const& requests)
+    {
+        // Tenants without queued work do not hold back the virtual time.
+        double minVirtualTime{std::numeric_limits<double>::max()};
+        for (auto const& req : requests)
+        {
+            auto& tenant = mTenants[getTenantId(*req)];
+            tenant.virtualTime = std::max(tenant.virtualTime, mVirtualTime);
+            minVirtualTime = std::min(minVirtualTime, tenant.virtualTime);
+        }
+        if (!requests.empty())
+        {
+            mVirtualTime = minVirtualTime;
+        }
+
+        std::unordered_map<TenantIdType, double> finishTimes;
+        std::vector<std::tuple<double, std::size_t, typename Requests::value_type>> keyed;
+        keyed.reserve(requests.size());
+        for (auto const& req : requests)
+        {
+            auto const tenantId = getTenantId(*req);
+            auto const& tenant = mTenants[tenantId];
+            auto [it, inserted] = finishTimes.try_emplace(tenantId, tenant.virtualTime);
+            it->second += static_cast<double>(getNextCost(*req)) / tenant.weight;
+            keyed.emplace_back(it->second, keyed.size(), req);
+        }
+        std::sort(keyed.begin(), keyed.end(),
+            [](auto const& lhs, auto const& rhs)
+            { return std::tie(std::get<0>(lhs), std::get<1>(lhs)) < std::tie(std::get<0>(rhs), std::get<1>(rhs)); });
+
+        RequestVector ordered;
+        ordered.reserve(keyed.size());
+        for (auto& entry : keyed)
+        {
+            ordered.push_back(std::move(std::get<2>(entry)));
+        }
+        return ordered;
+    }
+
+    //! \brief Charge the tokens a request processed in this iteration to its tenant.
+    void charge(LlmRequest const& request, SizeType32 numTokens)
+    {
+        auto& tenant = mTenants[getTenantId(request)];
+        tenant.virtualTime += static_cast<double>(numTokens) / tenant.weight;
+        tenant.stats.numTokens += numTokens;
+        tenant.numIterationTokens += numTokens;
+    }
+
+    //! \brief Close the iteration and update the throughput of the tenants served in it.
+    void endIteration(std::chrono::duration<double> iterationTime)
+    {
+        for (auto& [tenantId, tenant] : mTenants)
+        {
+            if (tenant.numIterationTokens > 0 && iterationTime.count() > 0.)
+            {
+                tenant.stats.tokensPerSecond = static_cast<double>(tenant.numIterationTokens) / iterationTime.count();
+            }
+            tenant.numIterationTokens = 0;
+        }
+    }
+
+    [[nodiscard]] std::unordered_map<TenantIdType, TenantStats> getTenantStats() const
+    {
+        std::unordered_map<TenantIdType, TenantStats> stats;
+        for (auto const& [tenantId, tenant] : mTenants)
+        {
+            stats.emplace(tenantId, tenant.stats);
+        }
+        return stats;
+    }
+
+private:
+    struct Tenant
+    {
+        double weight{1.};
+        double virtualTime{0.};
+        std::int64_t numIterationTokens{0};
+        TenantStats stats;
+    };
+
+    //! \brief Tokens the next step of a request processes: its remaining context, or one generated token per beam.
+    [[nodiscard]] static SizeType32 getNextCost(LlmRequest const& request)
+    {
+        if (request.isContextInitState())
+        {
+            return std::max(request.getContextRemainingLength(), 1);
+        }
+        return request.mSamplingConfig.beamWidth;
+    }
+
+    std::unordered_map<TenantIdType, Tenant> mTenants;
+    double mVirtualTime{0.};
+};
+
+} // namespace tensorrt_llm::batch_manager
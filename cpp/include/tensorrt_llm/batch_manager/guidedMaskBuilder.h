@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/workerPool.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Builds the token bitmasks of guided decoding on a pool of worker threads.
+//! \details GuidedDecoder::build fills the bitmask of every scheduled request from its grammar matcher, one after the
+//! other on the executor thread. The masks are only needed by invokeLogitsBitmask at sampling time, so they can instead
+//! be built while the engine executes the step: buildAsync splits the requests over the workers and returns at once,
+//! and wait is called just before the host bitmask is uploaded. Requests whose grammar is in a state seen before, e.g.
+//! between the fields of many requests using the same JSON schema, get the mask from an LRU cache instead of the
+//! matcher.
+class GuidedMaskBuilder
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using BitmaskT = std::uint32_t;
+    //! \brief Identifies a grammar and the state of its matcher. Equal keys must give equal masks.
+    using StateKey = std::uint64_t;
+
+    struct MaskRequest
+    {
+        //! \brief Row of the request in the host bitmask.
+        SizeType32 row;
+        //! \brief Set if the mask can be cached.
+        std::optional<StateKey> stateKey;
+        //! \brief Fills the mask of the request, e.g. with GrammarMatcher::FillNextTokenBitmask. Called on a worker.
+        //! Requests of the same batch use different matchers, so the calls are independent.
+        std::function<void(BitmaskT* mask)> fillMask;
+    };
+
+    struct Stats
+    {
+        std::size_t numCacheHits{0};
+        std::size_t numCacheMisses{0};
+    };
+
+    //! \param bitmaskSize Number of BitmaskT of a mask, ceilDiv(vocabSizePadded, 32).
+    //! \param maxCachedMasks Capacity of the cache, 0 to disable it.
+    GuidedMaskBuilder(SizeType32 numWorkers, SizeType32 bitmaskSize, std::size_t maxCachedMasks)
+        : mNumWorkers{numWorkers}
+        , mBitmaskSize{bitmaskSize}
+        , mMaxCachedMasks{maxCachedMasks}
+    {
+        TLLM_CHECK_WITH_INFO(numWorkers > 0, "numWorkers must be positive");
+        TLLM_CHECK_WITH_INFO(bitmaskSize > 0, "bitmaskSize must be positive");
+        mWorkerPool = std::make_unique<runtime::WorkerPool>(numWorkers);
+    }
+
+    //! \brief Number of workers from the environment, 0 if masks are built on the executor thread.
+    [[nodiscard]] static SizeType32 getNumWorkersFromEnv()
+    {
+        return static_cast<SizeType32>(common::getEnvGuidedDecodingMaskWorkers());
+    }
+
+    //! \brief Start building the masks of requests into bitmaskHost [numRows, bitmaskSize]. The previous build must
+    //! have been waited for. bitmaskHost and the matchers of the requests must not be used until wait returns.
+    void buildAsync(std::vector<MaskRequest> requests, BitmaskT* bitmaskHost)
+    {
+        TLLM_CHECK_WITH_INFO(mPendingTasks.empty(), "The previous masks are still being built");
+        if (requests.empty())
+        {
+            return;
+        }
+        auto shared = std::make_shared<std::vector<MaskRequest>>(std::move(requests));
+        auto const numRequests = static_cast<SizeType32>(shared->size());
+        auto const numTasks = std::min(mNumWorkers, numRequests);
+        auto const requestsPerTask = (numRequests + numTasks - 1) / numTasks;
+        for (SizeType32 begin = 0; begin < numRequests; begin += requestsPerTask)
+        {
+            auto const end = std::min(begin + requestsPerTask, numRequests);
+            mPendingTasks.push_back(mWorkerPool->enqueue(
+                [this, shared, begin, end, bitmaskHost]()
+                {
+                    for (auto i = begin; i < end; ++i)
+                    {
+                        buildMask((*shared)[i], bitmaskHost);
+                    }
+                }));
+        }
+    }
+
+    //! \brief Wait until the masks of the last buildAsync are in the host bitmask. Rethrows the errors of the matchers.
+    void wait()
+    {
+        auto tasks = std::move(mPendingTasks);
+        mPendingTasks.clear();
+        for (auto& task : tasks)
+        {
+            task.get();
+        }
+    }
+
+    [[nodiscard]] Stats getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mCacheMutex);
+        return mStats;
+    }
+
+private:
+    void buildMask(MaskRequest const& request, BitmaskT* bitmaskHost)
+    {
+        auto* mask = bitmaskHost + static_cast<std::size_t>(request.row) * mBitmaskSize;
+        auto const numBytes = sizeof(BitmaskT) * mBitmaskSize;
+        bool const cacheable = request.stateKey.has_value() && mMaxCachedMasks > 0;
+        if (cacheable)
+        {
+            std::lock_guard<std::mutex> lock(mCacheMutex);
+            if (auto const it = mCacheIndex.find(*request.stateKey); it != mCacheIndex.end())
+            {
+                mCache.splice(mCache.begin(), mCache, it->second);
+                std::memcpy(mask, it->second->mask.data(), numBytes);
+                ++mStats.numCacheHits;
+                return;
+            }
+            ++mStats.numCacheMisses;
+        }
+
+        request.fillMask(mask);
+
+        if (cacheable)
+        {
+            std::lock_guard<std::mutex> lock(mCacheMutex);
+            if (mCacheIndex.find(*request.stateKey) != mCacheIndex.end())
+            {
+                // Built concurrently by another worker.
+                return;
+            }
+            if (mCache.size() >= mMaxCachedMasks)
+            {
+                mCacheIndex.erase(mCache.back().key);
+                mCache.pop_back();
+            }
+            mCache.push_front({*request.stateKey, std::vector<BitmaskT>(mask, mask + mBitmaskSize)});
+            mCacheIndex[*request.stateKey] = mCache.begin();
+        }
+    }
+
+    struct CachedMask
+    {
+        StateKey key;
+        std::vector<BitmaskT> mask;
+    };
+
+    SizeType32 mNumWorkers;
+    SizeType32 mBitmaskSize;
+    std::size_t mMaxCachedMasks;
+
+    // Most recently used first.
+    std::list<CachedMask> mCache;
+    std::unordered_map<StateKey, std::list<CachedMask>::iterator> mCacheIndex;
+    mutable std::mutex mCacheMutex;
+    Stats mStats;
+
+    std::vector<std::future<void>> mPendingTasks;
+    // Declared last to join the workers before the cache is destroyed.
+    std::unique_ptr<runtime::WorkerPool> mWorkerPool;
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/evictionPolicy.h"
+#include "tensorrt_llm/common/assert.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::eviction_policy
+{
+
+// LRU eviction on intrusive, index-based free lists. Every cache level has one doubly linked list per retention
+// priority, threaded through arrays indexed by block id, so releasing and claiming blocks neither allocates list
+// nodes nor copies BlockPtr. Expiring priorities are kept in a vector-backed heap with lazy deletion.
+//
+// Only deferReleaseBlock is thread-safe. It pushes the block onto a lock-free stack, which the owning thread drains
+// before any other operation, so blocks can be released off the critical path of the scheduler.
+class IndexedLRUEvictionPolicy : public BaseEvictionPolicy
+{
+public:
+    using IdType = KVCacheBlock::IdType;
+
+    void initialize(std::vector<BlockPtr>& mAllBlocksById, std::vector<SizeType32> sizes,
+        std::optional<executor::RetentionPriority> secondaryOffloadMinPriority) override
+    {
+        mAllBlocks = &mAllBlocksById;
+        mSecondaryOffloadMinPriority
+            = secondaryOffloadMinPriority.value_or(executor::KvCacheRetentionConfig::kMinRetentionPriority);
+        auto const numBlocks = mAllBlocksById.size();
+        mBlockStates.assign(numBlocks, {});
+        mDeferredNext.assign(numBlocks, kInvalidId);
+        mDeferredToFront.assign(numBlocks, 0);
+        mFreeLists.assign(sizes.size(), std::vector<FreeList>(kNumPriorities));
+        mNumFreeBlocksPerLevel.assign(sizes.size(), 0);
+        mExpiringBlockHeap.clear();
+
+        IdType blockId{0};
+        for (SizeType32 level = 0; level < static_cast<SizeType32>(sizes.size()); ++level)
+        {
+            for (SizeType32 i = 0; i < sizes[level]; ++i, ++blockId)
+            {
+                auto& state = mBlockStates.at(blockId);
+                state.level = level;
+                state.priority = executor::KvCacheRetentionConfig::kDefaultRetentionPriority;
+                link(blockId, false);
+            }
+        }
+    }
+
+    std::tuple<BlockPtr, bool> getFreeBlock(SizeType32 cacheLevel) override
+    {
+        drainDeferredReleases();
+        auto const& freeLists = mFreeLists.at(cacheLevel);
+        auto const it = std::find_if(
+            freeLists.begin(), freeLists.end(), [](FreeList const& list) { return list.head != kInvalidId; });
+        TLLM_CHECK_WITH_INFO(it != freeLists.end(), "No free block in cache level %d", cacheLevel);
+        auto const& block = (*mAllBlocks)[it->head];
+        bool const canOffload = cacheLevel == kPrimaryLevel && hasSecondaryLevel()
+            && mNumFreeBlocksPerLevel[kSecondaryLevel] > 0 && block->getPriority() >= mSecondaryOffloadMinPriority;
+        return {block, canOffload};
+    }
+
+    void releaseBlock(BlockPtr block) override
+    {
+        releaseBlock(std::move(block), false);
+    }
+
+    void releaseBlock(BlockPtr block, bool toFront) override
+    {
+        drainDeferredReleases();
+        releaseBlockId(block->getBlockId(), toFront);
+    }
+
+    //! \brief Release a block from any thread. It becomes free when the owning thread next uses the policy.
+    void deferReleaseBlock(IdType blockId, bool toFront = false)
+    {
+        mDeferredToFront[blockId] = toFront ? 1 : 0;
+        auto head = mDeferredHead.load(std::memory_order_relaxed);
+        do
+        {
+            mDeferredNext[blockId] = head;
+        } while (
+            !mDeferredHead.compare_exchange_weak(head, blockId, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    SizeType32 getNumFreeBlocks(SizeType32 cacheLevel) override
+    {
+        drainDeferredReleases();
+        return mNumFreeBlocksPerLevel.at(cacheLevel);
+    }
+
+    void claimBlock(BlockPtr block) override
+    {
+        claimBlock(std::move(block), std::nullopt, std::nullopt);
+    }
+
+    void claimBlock(BlockPtr block, std::optional<executor::RetentionPriority> priority,
+        std::optional<std::chrono::milliseconds> durationMs) override
+    {
+        drainDeferredReleases();
+        auto const blockId = block->getBlockId();
+        auto& state = mBlockStates.at(blockId);
+        if (state.isFree)
+        {
+            unlink(blockId);
+        }
+        if (priority.has_value())
+        {
+            block->setPriority(*priority);
+        }
+        // Invalidates the entry of the block in the heap, if any.
+        state.expirationTime.reset();
+        block->setDurationMs(durationMs);
+    }
+
+    // Give blocks whose retention duration has passed the default priority again.
+    void refresh() override
+    {
+        drainDeferredReleases();
+        auto const now = getTime();
+        while (!mExpiringBlockHeap.empty() && mExpiringBlockHeap.front().first <= now)
+        {
+            std::pop_heap(mExpiringBlockHeap.begin(), mExpiringBlockHeap.end(), std::greater<>{});
+            auto const [expirationTime, blockId] = mExpiringBlockHeap.back();
+            mExpiringBlockHeap.pop_back();
+
+            auto& state = mBlockStates.at(blockId);
+            if (state.expirationTime != expirationTime)
+            {
+                continue;
+            }
+            state.expirationTime.reset();
+            (*mAllBlocks)[blockId]->setPriority(executor::KvCacheRetentionConfig::kDefaultRetentionPriority);
+            if (state.isFree)
+            {
+                unlink(blockId);
+                state.priority = executor::KvCacheRetentionConfig::kDefaultRetentionPriority;
+                link(blockId, false);
+            }
+        }
+    }
+
+    // Making this public and virtual makes it possible to test.
+    [[nodiscard]] virtual std::chrono::steady_clock::time_point::duration getTime() const
+    {
+        return std::chrono::steady_clock::now().time_since_epoch();
+    }
+
+private:
+    using TimeType = std::chrono::steady_clock::time_point::duration;
+
+    static constexpr IdType kInvalidId = -1;
+    static constexpr SizeType32 kNumPriorities = executor::KvCacheRetentionConfig::kMaxRetentionPriority + 1;
+
+    struct FreeList
+    {
+        IdType head{kInvalidId};
+        IdType tail{kInvalidId};
+    };
+
+    struct BlockState
+    {
+        IdType prev{kInvalidId};
+        IdType next{kInvalidId};
+        SizeType32 level{kPrimaryLevel};
+        executor::RetentionPriority priority{executor::KvCacheRetentionConfig::kDefaultRetentionPriority};
+        bool isFree{false};
+        std::optional<TimeType> expirationTime;
+    };
+
+    [[nodiscard]] bool hasSecondaryLevel() const
+    {
+        return mFreeLists.size() > static_cast<std::size_t>(kSecondaryLevel);
+    }
+
+    void releaseBlockId(IdType blockId, bool toFront)
+    {
+        auto const& block = (*mAllBlocks)[blockId];
+        auto& state = mBlockStates.at(blockId);
+        if (state.isFree)
+        {
+            unlink(blockId);
+        }
+        state.level = block->isPrimary() ? kPrimaryLevel : kSecondaryLevel;
+        state.priority = block->getPriority();
+        link(blockId, toFront);
+
+        if (block->getDurationMs().has_value()
+            && block->getPriority() != executor::KvCacheRetentionConfig::kDefaultRetentionPriority)
+        {
+            auto const expirationTime = getTime() + *block->getDurationMs();
+            block->setExpirationTime(expirationTime);
+            state.expirationTime = expirationTime;
+            mExpiringBlockHeap.emplace_back(expirationTime, blockId);
+            std::push_heap(mExpiringBlockHeap.begin(), mExpiringBlockHeap.end(), std::greater<>{});
+        }
+    }
+
+    void drainDeferredReleases()
+    {
+        if (mDeferredHead.load(std::memory_order_relaxed) == kInvalidId)
+        {
+            return;
+        }
+        // Released blocks are pushed in reverse order, restore it to keep the LRU order.
+        auto blockId = mDeferredHead.exchange(kInvalidId, std::memory_order_acquire);
+        IdType reversed{kInvalidId};
+        while (blockId != kInvalidId)
+        {
+            auto const next = mDeferredNext[blockId];
+            mDeferredNext[blockId] = reversed;
+            reversed = blockId;
+            blockId = next;
+        }
+        for (blockId = reversed; blockId != kInvalidId; blockId = mDeferredNext[blockId])
+        {
+            releaseBlockId(blockId, mDeferredToFront[blockId] != 0);
+        }
+    }
+
+    void link(IdType blockId, bool toFront)
+    {
+        auto& state = mBlockStates[blockId];
+        auto& list = mFreeLists[state.level][state.priority];
+        if (list.head == kInvalidId)
+        {
+            state.prev = state.next = kInvalidId;
+            list.head = list.tail = blockId;
+        }
+        else if (toFront)
+        {
+            state.prev = kInvalidId;
+            state.next = list.head;
+            mBlockStates[list.head].prev = blockId;
+            list.head = blockId;
+        }
+        else
+        {
+            state.prev = list.tail;
+            state.next = kInvalidId;
+            mBlockStates[list.tail].next = blockId;
+            list.tail = blockId;
+        }
+        state.isFree = true;
+        ++mNumFreeBlocksPerLevel[state.level];
+    }
+
+    void unlink(IdType blockId)
+    {
+        auto& state = mBlockStates[blockId];
+        auto& list = mFreeLists[state.level][state.priority];
+        (state.prev != kInvalidId ? mBlockStates[state.prev].next : list.head) = state.next;
+        (state.next != kInvalidId ? mBlockStates[state.next].prev : list.tail) = state.prev;
+        state.prev = state.next = kInvalidId;
+        state.isFree = false;
+        --mNumFreeBlocksPerLevel[state.level];
+    }
+
+    std::vector<BlockPtr>* mAllBlocks{nullptr};
+    std::vector<BlockState> mBlockStates;
+    // Free lists of every cache level and retention priority. The head of the lowest priority is evicted first.
+    std::vector<std::vector<FreeList>> mFreeLists;
+    std::vector<SizeType32> mNumFreeBlocksPerLevel;
+    // Secondary offload threshold. Blocks below this priority won't be offloaded.
+    executor::RetentionPriority mSecondaryOffloadMinPriority{executor::KvCacheRetentionConfig::kMinRetentionPriority};
+    // Min-heap of expiration times. Entries that no longer match the state of their block are skipped.
+    std::vector<std::pair<TimeType, IdType>> mExpiringBlockHeap;
+    // Lock-free stack of deferred releases, linked through mDeferredNext. Only whole stacks are taken, so there is
+    // no ABA problem.
+    std::atomic<IdType> mDeferredHead{kInvalidId};
+    std::vector<IdType> mDeferredNext;
+    std::vector<std::uint8_t> mDeferredToFront;
+};
+
+} // namespace tensorrt_llm::batch_manager::eviction_policy
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/kernels/kvCacheBlockCopy.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Gathers the block copies of an iteration (offloads and onboards, all pools) and moves them with a single kernel
+// launch instead of one cudaMemcpyAsync per block and pool, which is dominated by launch overhead under offload
+// pressure.
+class KVCacheBatchedBlockCopier
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    struct Stats
+    {
+        // Total number of block copies (a block in every pool counts once per pool).
+        std::size_t numCopies{0};
+        // Total number of bytes moved.
+        std::size_t numBytes{0};
+        // Bytes moved by the last completed flush.
+        std::size_t lastNumBytes{0};
+        // Throughput of the last completed flush in bytes per second.
+        double lastBytesPerSecond{0.0};
+    };
+
+    explicit KVCacheBatchedBlockCopier(std::vector<KVCacheBlockPool> const& pools)
+    {
+        for (auto const& pool : pools)
+        {
+            auto const numBlocks = pool.primaryPtr->getShape().d[0];
+            mPools.push_back(PoolInfo{static_cast<std::uint8_t*>(pool.primaryPtr->data()),
+                pool.secondaryPtr ? static_cast<std::uint8_t*>(pool.secondaryPtr->data()) : nullptr,
+                static_cast<std::int64_t>(pool.primaryPtr->getSizeInBytes() / numBlocks)});
+        }
+    }
+
+    //! \brief Queue the copy of a primary block to a secondary block in every pool.
+    void addOffload(SizeType32 primaryBlockIdx, SizeType32 secondaryBlockIdx)
+    {
+        add(primaryBlockIdx, secondaryBlockIdx, true);
+    }
+
+    //! \brief Queue the copy of a secondary block to a primary block in every pool.
+    void addOnboard(SizeType32 secondaryBlockIdx, SizeType32 primaryBlockIdx)
+    {
+        add(secondaryBlockIdx, primaryBlockIdx, false);
+    }
+
+    [[nodiscard]] std::size_t getNumPendingCopies() const
+    {
+        return mPendingCopies.size();
+    }
+
+    //! \brief Launch all queued copies on the stream of bufferManager.
+    void flush(runtime::BufferManager const& bufferManager)
+    {
+        if (mPendingCopies.empty())
+        {
+            return;
+        }
+        updateStats();
+
+        std::int64_t maxNumBytes{0};
+        std::size_t numBytes{0};
+        for (auto const& copy : mPendingCopies)
+        {
+            maxNumBytes = std::max(maxNumBytes, copy.numBytes);
+            numBytes += static_cast<std::size_t>(copy.numBytes);
+        }
+        auto const& stream = bufferManager.getStream();
+        // Stream-ordered allocation, released once the kernel is done with it.
+        auto const descriptors = bufferManager.gpu(
+            mPendingCopies.size() * sizeof(kernels::KVBlockCopyDesc), nvinfer1::DataType::kUINT8);
+        bufferManager.copy(mPendingCopies.data(), *descriptors, runtime::MemoryType::kCPU);
+
+        stream.record(mStart);
+        kernels::invokeBatchedBlockCopy(static_cast<kernels::KVBlockCopyDesc const*>(descriptors->data()),
+            static_cast<std::int32_t>(mPendingCopies.size()), maxNumBytes, stream.get());
+        stream.record(mStop);
+
+        mStats.numCopies += mPendingCopies.size();
+        mStats.numBytes += numBytes;
+        mInFlightNumBytes = numBytes;
+        mPendingCopies.clear();
+    }
+
+    //! \brief Statistics, including the throughput of the last flush that has completed.
+    [[nodiscard]] Stats const& getStats()
+    {
+        updateStats();
+        return mStats;
+    }
+
+private:
+    struct PoolInfo
+    {
+        std::uint8_t* primary;
+        std::uint8_t* secondary;
+        std::int64_t blockSizeInBytes;
+    };
+
+    void add(SizeType32 srcBlockIdx, SizeType32 dstBlockIdx, bool isOffload)
+    {
+        for (auto const& pool : mPools)
+        {
+            TLLM_CHECK_WITH_INFO(pool.secondary != nullptr, "Block copies require a secondary pool");
+            auto* primary = pool.primary + (isOffload ? srcBlockIdx : dstBlockIdx) * pool.blockSizeInBytes;
+            auto* secondary = pool.secondary + (isOffload ? dstBlockIdx : srcBlockIdx) * pool.blockSizeInBytes;
+            mPendingCopies.push_back(isOffload ? kernels::KVBlockCopyDesc{primary, secondary, pool.blockSizeInBytes}
+                                               : kernels::KVBlockCopyDesc{secondary, primary, pool.blockSizeInBytes});
+        }
+    }
+
+    void updateStats()
+    {
+        if (!mInFlightNumBytes || cudaEventQuery(mStop.get()) != cudaSuccess)
+        {
+            return;
+        }
+        float milliseconds{0.F};
+        TLLM_CUDA_CHECK(cudaEventElapsedTime(&milliseconds, mStart.get(), mStop.get()));
+        mStats.lastNumBytes = *mInFlightNumBytes;
+        mStats.lastBytesPerSecond
+            = milliseconds > 0.F ? static_cast<double>(*mInFlightNumBytes) * 1000.0 / milliseconds : 0.0;
+        mInFlightNumBytes.reset();
+    }
+
+    std::vector<PoolInfo> mPools;
+    std::vector<kernels::KVBlockCopyDesc> mPendingCopies;
+    // Timing events of the last flush.
+    runtime::CudaEvent mStart{static_cast<unsigned int>(cudaEventDefault)};
+    runtime::CudaEvent mStop{static_cast<unsigned int>(cudaEventDefault)};
+    std::optional<std::size_t> mInFlightNumBytes;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/common/assert.h"
+
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Block-level copy-on-write forking of the beams of one sequence. Instead of the dense cache indirection tensor
+// [batch, beam, maxSeqLen] that is gathered from the parent beams at every step, every beam owns a block table holding
+// its own history. Beams share the blocks of their common prefix by reference count; when beams select their parents,
+// only the last, partially filled block of a parent with several children is forked, and full blocks are never
+// copied. With beam widths 4-8 most of the history is shared, so this costs a few block copies per step instead of an
+// update of maxSeqLen indirection entries per beam, and distinct beams never occupy more than one private block each
+// beyond the shared prefix. The cache indirection of such a sequence is the identity.
+class BeamBlockForkTable
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using BlockIdType = KVCacheBlock::IdType;
+    //! \brief Returns a free block that is owned by this table until it is released.
+    using AllocateBlock = std::function<BlockIdType()>;
+    //! \brief Returns a block to the pool once no beam uses it anymore.
+    using ReleaseBlock = std::function<void(BlockIdType)>;
+
+    //! \brief Content of block src must be copied to block dst before the next token is written to the cache.
+    struct BlockCopy
+    {
+        BlockIdType src;
+        BlockIdType dst;
+
+        bool operator==(BlockCopy const& other) const
+        {
+            return src == other.src && dst == other.dst;
+        }
+    };
+
+    //! \brief Start from the context blocks, shared by all beams. The last block may be partially filled.
+    BeamBlockForkTable(SizeType32 tokensPerBlock, SizeType32 beamWidth, std::vector<BlockIdType> const& contextBlockIds,
+        SizeType32 numContextTokens, AllocateBlock allocateBlock, ReleaseBlock releaseBlock)
+        : mTokensPerBlock{tokensPerBlock}
+        , mNumTokens{numContextTokens}
+        , mAllocateBlock{std::move(allocateBlock)}
+        , mReleaseBlock{std::move(releaseBlock)}
+    {
+        TLLM_CHECK_WITH_INFO(tokensPerBlock > 0, "tokensPerBlock must be positive");
+        TLLM_CHECK_WITH_INFO(beamWidth > 0, "beamWidth must be positive");
+        TLLM_CHECK_WITH_INFO(static_cast<SizeType32>(contextBlockIds.size()) == getNumBlocks(numContextTokens),
+            "%zu context blocks do not hold %d tokens", contextBlockIds.size(), numContextTokens);
+        mBlockTables.assign(beamWidth, contextBlockIds);
+        for (auto const blockId : contextBlockIds)
+        {
+            mRefCounts[blockId] += beamWidth;
+        }
+    }
+
+    BeamBlockForkTable(BeamBlockForkTable const&) = delete;
+    BeamBlockForkTable& operator=(BeamBlockForkTable const&) = delete;
+
+    ~BeamBlockForkTable()
+    {
+        release();
+    }
+
+    //! \brief Make room for the next token of every beam. Beam b continues the sequence of beam parentBeams[b] of the
+    //! previous step, as written to parent ids by the beam search kernels. Must be called before the token is written
+    //! to the cache.
+    //! \return Copies of the forked blocks. They all read blocks that stay alive until the next call.
+    std::vector<BlockCopy> advance(std::vector<SizeType32> const& parentBeams)
+    {
+        auto const beamWidth = getBeamWidth();
+        TLLM_CHECK_WITH_INFO(static_cast<SizeType32>(parentBeams.size()) == beamWidth,
+            "Expected %d parent beams, got %zu", beamWidth, parentBeams.size());
+
+        for (auto const parent : parentBeams)
+        {
+            TLLM_CHECK_WITH_INFO(parent >= 0 && parent < beamWidth, "Invalid parent beam %d", parent);
+        }
+
+        // Reference the parents before dropping the old tables so that no shared block is released in between.
+        std::vector<std::vector<BlockIdType>> newTables;
+        newTables.reserve(beamWidth);
+        for (auto const parent : parentBeams)
+        {
+            newTables.push_back(mBlockTables[parent]);
+            for (auto const blockId : newTables.back())
+            {
+                ++mRefCounts[blockId];
+            }
+        }
+        for (auto const& table : mBlockTables)
+        {
+            for (auto const blockId : table)
+            {
+                unref(blockId);
+            }
+        }
+        mBlockTables = std::move(newTables);
+
+        std::vector<BlockCopy> copies;
+        if (mNumTokens % mTokensPerBlock == 0)
+        {
+            // The token starts a new block, which is private to every beam.
+            for (auto& table : mBlockTables)
+            {
+                auto const blockId = mAllocateBlock();
+                mRefCounts[blockId] = 1;
+                table.push_back(blockId);
+            }
+        }
+        else
+        {
+            // The token is written to the last block. Every beam but the last holder forks it.
+            for (auto& table : mBlockTables)
+            {
+                auto& lastBlockId = table.back();
+                if (mRefCounts.at(lastBlockId) == 1)
+                {
+                    continue;
+                }
+                auto const blockId = mAllocateBlock();
+                mRefCounts[blockId] = 1;
+                copies.push_back({lastBlockId, blockId});
+                unref(lastBlockId);
+                lastBlockId = blockId;
+                ++mNumForkedBlocks;
+            }
+        }
+        ++mNumTokens;
+        return copies;
+    }
+
+    //! \brief Release all blocks, e.g. when the sequence is finished.
+    void release()
+    {
+        for (auto const& table : mBlockTables)
+        {
+            for (auto const blockId : table)
+            {
+                unref(blockId);
+            }
+        }
+        mBlockTables.clear();
+    }
+
+    //! \brief Block table of every beam, in the layout of GenerationRequest::getCacheBlockIds.
+    [[nodiscard]] std::vector<std::vector<BlockIdType>> const& getCacheBlockIds() const
+    {
+        return mBlockTables;
+    }
+
+    [[nodiscard]] SizeType32 getBeamWidth() const
+    {
+        return static_cast<SizeType32>(mBlockTables.size());
+    }
+
+    //! \brief Number of tokens of every beam, including the context.
+    [[nodiscard]] SizeType32 getNumTokens() const
+    {
+        return mNumTokens;
+    }
+
+    //! \brief Number of distinct blocks used by all beams.
+    [[nodiscard]] SizeType32 getNumUniqueBlocks() const
+    {
+        return static_cast<SizeType32>(mRefCounts.size());
+    }
+
+    //! \brief Number of partial blocks that were copied since the start.
+    [[nodiscard]] std::size_t getNumForkedBlocks() const
+    {
+        return mNumForkedBlocks;
+    }
+
+private:
+    [[nodiscard]] SizeType32 getNumBlocks(SizeType32 numTokens) const
+    {
+        return (numTokens + mTokensPerBlock - 1) / mTokensPerBlock;
+    }
+
+    void unref(BlockIdType blockId)
+    {
+        auto const it = mRefCounts.find(blockId);
+        TLLM_CHECK_WITH_INFO(it != mRefCounts.end(), "Block %d is not referenced", blockId);
+        if (--it->second == 0)
+        {
+            mRefCounts.erase(it);
+            mReleaseBlock(blockId);
+        }
+    }
+
+    SizeType32 mTokensPerBlock;
+    SizeType32 mNumTokens;
+    AllocateBlock mAllocateBlock;
+    ReleaseBlock mReleaseBlock;
+    // Block table of every beam.
+    std::vector<std::vector<BlockIdType>> mBlockTables;
+    // Number of beams that hold every block.
+    std::unordered_map<BlockIdType, SizeType32> mRefCounts;
+    std::size_t mNumForkedBlocks{0};
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
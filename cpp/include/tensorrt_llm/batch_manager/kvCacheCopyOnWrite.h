@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Copy-on-write reuse of partially filled blocks. BlockManager::addSequence only reuses full blocks, so a shared
+// prompt ending in the middle of a block recomputes up to tokensPerBlock - 1 tokens. With this tracker a request can
+// adopt the partially matched block of a prefix match (see KVCacheRadixTree::PrefixMatch) as-is and only gets a private
+// copy when it writes its first token past the shared part. The fork relies on BlockManager::replaceSharedBlock to
+// allocate the private block and then copies the shared block into it.
+class PartialBlockReuseTracker
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+
+    //! \brief Record that the block at blockIdx of sequence is shared and only holds numSharedTokens valid tokens for
+    //! this request.
+    void adopt(GenerationRequest const& sequence, SizeType32 blockIdx, SizeType32 numSharedTokens,
+        SizeType32 tokensPerBlock)
+    {
+        TLLM_CHECK_WITH_INFO(numSharedTokens > 0 && numSharedTokens <= tokensPerBlock,
+            "Invalid number of shared tokens %d in a block of %d tokens", numSharedTokens, tokensPerBlock);
+        if (numSharedTokens == tokensPerBlock)
+        {
+            // Full blocks are never written to again and do not need a copy.
+            return;
+        }
+        mAdoptedBlocks[sequence.getRequestId()].push_back({blockIdx, numSharedTokens});
+        mNumAdoptedTokens += numSharedTokens;
+    }
+
+    //! \brief Whether sequence still uses a shared partial block.
+    [[nodiscard]] bool hasAdoptedBlocks(RequestIdType requestId) const
+    {
+        return mAdoptedBlocks.find(requestId) != mAdoptedBlocks.end();
+    }
+
+    //! \brief Give sequence a private copy of every adopted block written by the tokens at [firstTokenPos,
+    //! firstTokenPos + numTokens). Must be called before these tokens are written to the cache.
+    //! \return Number of forked blocks.
+    SizeType32 forkOnWrite(
+        BlockManager& blockManager, GenerationRequest& sequence, SizeType32 firstTokenPos, SizeType32 numTokens = 1)
+    {
+        auto const it = mAdoptedBlocks.find(sequence.getRequestId());
+        if (it == mAdoptedBlocks.end())
+        {
+            return 0;
+        }
+
+        auto const tokensPerBlock = blockManager.getTokensPerBlock();
+        auto& adoptedBlocks = it->second;
+        SizeType32 numForked{0};
+        for (auto adoptedIt = adoptedBlocks.begin(); adoptedIt != adoptedBlocks.end();)
+        {
+            auto const blockBegin = adoptedIt->blockIdx * tokensPerBlock;
+            auto const blockEnd = blockBegin + tokensPerBlock;
+            if (firstTokenPos >= blockEnd || firstTokenPos + numTokens <= blockBegin)
+            {
+                ++adoptedIt;
+                continue;
+            }
+            forkBlock(blockManager, sequence, adoptedIt->blockIdx);
+            adoptedIt = adoptedBlocks.erase(adoptedIt);
+            ++numForked;
+        }
+        if (adoptedBlocks.empty())
+        {
+            mAdoptedBlocks.erase(it);
+        }
+        mNumForkedBlocks += numForked;
+        return numForked;
+    }
+
+    //! \brief Forget the adopted blocks of a request, e.g. when it is removed.
+    void release(RequestIdType requestId)
+    {
+        mAdoptedBlocks.erase(requestId);
+    }
+
+    //! \brief Number of tokens that were reused from partial blocks instead of being recomputed.
+    [[nodiscard]] std::size_t getNumAdoptedTokens() const
+    {
+        return mNumAdoptedTokens;
+    }
+
+    [[nodiscard]] std::size_t getNumForkedBlocks() const
+    {
+        return mNumForkedBlocks;
+    }
+
+private:
+    struct AdoptedBlock
+    {
+        SizeType32 blockIdx;
+        SizeType32 numSharedTokens;
+    };
+
+    //! \brief Replace the shared block at blockIdx by a private block holding the same content.
+    static void forkBlock(BlockManager& blockManager, GenerationRequest& sequence, SizeType32 blockIdx)
+    {
+        // Keep the shared block alive while it is being copied.
+        std::vector<BlockPtr> sharedBlocks;
+        sharedBlocks.reserve(sequence.getBeamWidth());
+        for (auto const& beamBlockIds : sequence.getCacheBlockIds())
+        {
+            sharedBlocks.push_back(blockManager.getBlockById(beamBlockIds.at(blockIdx)));
+        }
+
+        blockManager.replaceSharedBlock(sequence, blockIdx);
+
+        auto const& bufferManager = blockManager.getBufferManager();
+        for (SizeType32 beamIdx = 0; beamIdx < sequence.getBeamWidth(); ++beamIdx)
+        {
+            auto const& src = sharedBlocks[beamIdx];
+            auto const& dst = blockManager.getBlockById(sequence.getCacheBlockIds()[beamIdx].at(blockIdx));
+            if (src == dst)
+            {
+                // The block was not shared with any other sequence, nothing to copy.
+                continue;
+            }
+            TLLM_CHECK_WITH_INFO(
+                src->isPrimary() && dst->isPrimary(), "Copy-on-write is only supported for primary blocks");
+            // Blocks are contiguous in every pool, copying the complete block is a single memcpy and cheaper than
+            // copying the shared tokens of every layer and head separately.
+            for (SizeType32 poolIdx = 0; poolIdx < blockManager.getNumPools(); ++poolIdx)
+            {
+                auto const pool = blockManager.getPrimaryPool(poolIdx);
+                auto const srcBlock = runtime::ITensor::slice(pool, src->getMemoryPoolBlockIndex(), 1);
+                auto dstBlock = runtime::ITensor::slice(pool, dst->getMemoryPoolBlockIndex(), 1);
+                bufferManager.copy(*srcBlock, *dstBlock);
+            }
+            TLLM_LOG_DEBUG("Forked shared block %d into block %d for request %lu", src->getBlockId(),
+                dst->getBlockId(), sequence.getRequestId());
+        }
+    }
+
+    std::unordered_map<RequestIdType, std::vector<AdoptedBlock>> mAdoptedBlocks;
+    std::size_t mNumAdoptedTokens{0};
+    std::size_t mNumForkedBlocks{0};
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
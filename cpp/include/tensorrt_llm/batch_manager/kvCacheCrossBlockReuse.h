@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/encoderOutputCache.h"
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/kvCacheRadixTree.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Reuse of the cross KV cache blocks of encoder-decoder models. The self attention blocks are keyed by the tokens of
+// the prefix they hold, which is exact because the decoder is causal. The encoder is not: every position of the encoder
+// output, and so every cross KV block, depends on the whole encoder input. Keying the cross blocks by the encoder input
+// tokens would match the prefix of two inputs that diverge later, and the encoder output length differs from the input
+// length for audio, where the encoder downsamples its features.
+//
+// The cross blocks are keyed instead by unique tokens derived from the hash of the whole encoder input, one per
+// position of the encoder output (see encoder_output_cache::makeCrossKvUniqueTokens). They go through the same
+// BlockKey / radix tree machinery as the self attention blocks of the cross KVCacheManager. Since it is complete once
+// projected, the last partially filled block of a cross cache is final and is keyed and reused too.
+class CrossKvBlockReuse
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using BlockIdType = KVCacheBlock::IdType;
+    using InputHash = encoder_output_cache::InputHash;
+
+    //! \brief Reuse of the cross KV cache of a request.
+    struct Plan
+    {
+        //! \brief Cached blocks the request takes, in sequence order.
+        std::vector<BlockIdType> reusedBlocks;
+        SizeType32 numReusedTokens{0};
+        SizeType32 numBlocks{0};
+
+        //! \brief Whether all the cross KV cache is cached, the request then skips the cross KV projection of its
+        //! encoder output. Otherwise the projection runs for every position and the reused blocks are not written.
+        [[nodiscard]] bool canSkipProjection() const
+        {
+            return numBlocks > 0 && static_cast<SizeType32>(reusedBlocks.size()) == numBlocks;
+        }
+    };
+
+    struct Stats
+    {
+        std::size_t numRequests{0};
+        std::size_t numFullHits{0};
+        std::size_t numReusedBlocks{0};
+        std::size_t numStoredBlocks{0};
+    };
+
+    explicit CrossKvBlockReuse(SizeType32 tokensPerBlock)
+        : mIndex{tokensPerBlock, /*usesExtraIds=*/true}
+    {
+    }
+
+    //! \brief Key the cross KV cache of the request by the hash of its encoder input, replacing the encoder unique
+    //! tokens set from its input tokens.
+    //! \return The hash, nullopt if the encoder input cannot be hashed, the request is then left as it is.
+    static std::optional<InputHash> prepareRequest(LlmRequest& llmRequest)
+    {
+        auto const hash = encoder_output_cache::hashEncoderInput(llmRequest);
+        if (!hash.has_value())
+        {
+            return std::nullopt;
+        }
+        llmRequest.setEncoderUniqueTokens(
+            encoder_output_cache::makeCrossKvUniqueTokens(*hash, llmRequest.getEncoderOutputLen()));
+        return hash;
+    }
+
+    //! \brief The keys of the cross KV cache blocks of a request, for BlockManager::loadOrAllocateBlocks and
+    //! storeBlocks of the cross KVCacheManager. The last block is partially filled when the encoder output length is
+    //! not a multiple of tokensPerBlock.
+    [[nodiscard]] static std::vector<BlockKey> makeBlockKeys(LlmRequest const& llmRequest, SizeType32 tokensPerBlock)
+    {
+        TLLM_CHECK_WITH_INFO(tokensPerBlock > 0, "tokensPerBlock must be positive");
+        auto const& uniqueTokens = llmRequest.getEncoderUniqueTokens();
+        if (!uniqueTokens.has_value() || !uniqueTokens.value())
+        {
+            return {};
+        }
+        auto const loraTaskId = llmRequest.getLoraTaskId();
+        auto const& tokens = *uniqueTokens.value();
+        auto const numTokens = static_cast<SizeType32>(tokens.size());
+        std::vector<BlockKey> blockKeys;
+        blockKeys.reserve((numTokens + tokensPerBlock - 1) / tokensPerBlock);
+        for (SizeType32 begin = 0; begin < numTokens; begin += tokensPerBlock)
+        {
+            auto const end = std::min(begin + tokensPerBlock, numTokens);
+            blockKeys.emplace_back(loraTaskId.has_value(), /*usesExtraIds=*/true, loraTaskId.value_or(0),
+                VecUniqueTokens(tokens.begin() + begin, tokens.begin() + end));
+        }
+        return blockKeys;
+    }
+
+    //! \brief The cached cross KV cache blocks the request can take. Call after prepareRequest.
+    [[nodiscard]] Plan plan(LlmRequest const& llmRequest)
+    {
+        ++mStats.numRequests;
+        Plan plan;
+        auto const& uniqueTokens = llmRequest.getEncoderUniqueTokens();
+        if (!uniqueTokens.has_value() || !uniqueTokens.value())
+        {
+            return plan;
+        }
+        auto const& tokens = *uniqueTokens.value();
+        auto const tokensPerBlock = mIndex.getTokensPerBlock();
+        auto const numTokens = static_cast<SizeType32>(tokens.size());
+        plan.numBlocks = (numTokens + tokensPerBlock - 1) / tokensPerBlock;
+
+        auto match = mIndex.findLongestPrefix(llmRequest.getLoraTaskId(), tokens);
+        // All the positions of a cross cache share the hash of the input, a match stops only at evicted blocks. A
+        // partially matched block holds the positions of another input past the match and is not reused.
+        if (match.isLastBlockPartial(tokensPerBlock) && match.numMatchedTokens < numTokens)
+        {
+            match.blocks.pop_back();
+            match.numMatchedTokens = static_cast<SizeType32>(match.blocks.size()) * tokensPerBlock;
+        }
+        plan.reusedBlocks = std::move(match.blocks);
+        plan.numReusedTokens = match.numMatchedTokens;
+        mStats.numReusedBlocks += plan.reusedBlocks.size();
+        if (plan.canSkipProjection())
+        {
+            ++mStats.numFullHits;
+            TLLM_LOG_DEBUG("Request %lu reuses all %d cross KV cache blocks", llmRequest.mRequestId, plan.numBlocks);
+        }
+        return plan;
+    }
+
+    //! \brief Make the cross KV cache blocks of a request reusable once its cross KV projection is done.
+    //! \param blockIds The blocks of the cross cache of the request, in sequence order.
+    //! \return Number of blocks that were not cached yet.
+    SizeType32 store(LlmRequest const& llmRequest, std::vector<BlockIdType> const& blockIds)
+    {
+        auto const& uniqueTokens = llmRequest.getEncoderUniqueTokens();
+        if (!uniqueTokens.has_value() || !uniqueTokens.value())
+        {
+            return 0;
+        }
+        auto const numInserted = mIndex.insert(llmRequest.getLoraTaskId(), *uniqueTokens.value(), blockIds);
+        mStats.numStoredBlocks += numInserted;
+        return numInserted;
+    }
+
+    //! \brief Forget a block of the cross cache, e.g. when the cross KVCacheManager evicts it.
+    bool remove(BlockIdType blockId)
+    {
+        return mIndex.remove(blockId);
+    }
+
+    [[nodiscard]] KVCacheRadixTree const& getIndex() const
+    {
+        return mIndex;
+    }
+
+    [[nodiscard]] Stats const& getStats() const
+    {
+        return mStats;
+    }
+
+private:
+    KVCacheRadixTree mIndex;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/memoryMappedFile.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/workerPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// The disk tier is an optional third cache level (kTertiaryLevel) behind the secondary pools. Blocks evicted from the
+// secondary pool are written to a memory-mapped file instead of being dropped, so that reusable prefixes survive much
+// longer than the host pool alone allows. Only the host<->disk leg is handled here, on worker threads; the
+// host<->device leg stays on the onboard/offload streams of the KVCacheTransferManager. Blocks are therefore always
+// staged through the secondary pool, which must be pinned host memory.
+//
+// The file holds one slot per tertiary block. A slot contains the block of every pool back to back, in pool order, so
+// that a block is a single contiguous range of the file.
+class KVCacheDiskTier
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using TensorPtr = runtime::ITensor::SharedPtr;
+
+    //! \brief A single block transfer: the tertiary block index and the secondary block of every pool.
+    struct BlockTransfer
+    {
+        SizeType32 diskBlockIdx;
+        std::vector<TensorPtr> hostBlocks;
+    };
+
+    //! \param path File backing the disk tier. It is created or truncated.
+    //! \param numBlocks Number of blocks in the disk tier.
+    //! \param blockSizeInBytesPerPool Size in bytes of one block (all layers, K and V) in every pool.
+    //! \param numWorkers Number of threads moving blocks between host and disk.
+    KVCacheDiskTier(std::string path, SizeType32 numBlocks, std::vector<std::size_t> blockSizeInBytesPerPool,
+        SizeType32 numWorkers = 2)
+        : mNumBlocks{numBlocks}
+        , mBlockSizeInBytesPerPool{std::move(blockSizeInBytesPerPool)}
+        , mPoolOffsets(mBlockSizeInBytesPerPool.size())
+        , mSlotSize{std::accumulate(mBlockSizeInBytesPerPool.begin(), mBlockSizeInBytesPerPool.end(), std::size_t{0})}
+        , mFile{std::move(path), common::MemoryMappedFile::Mode::kCREATE,
+              static_cast<std::size_t>(numBlocks) * requireNonZero(mSlotSize)}
+        , mNumWorkers{static_cast<std::size_t>(std::max(numWorkers, 1))}
+        , mWorkers{mNumWorkers, common::getDevice()}
+    {
+        TLLM_CHECK_WITH_INFO(numBlocks > 0, "Disk tier requires at least one block");
+        std::exclusive_scan(
+            mBlockSizeInBytesPerPool.begin(), mBlockSizeInBytesPerPool.end(), mPoolOffsets.begin(), std::size_t{0});
+        // Blocks are accessed in no particular order and the page cache should not read ahead.
+        mFile.advise(common::MemoryMappedFile::Advice::kRANDOM);
+        TLLM_LOG_INFO("KV cache disk tier: %d blocks of %zu bytes in %s", mNumBlocks, mSlotSize,
+            mFile.getPath().c_str());
+    }
+
+    //! \brief Create the disk tier configured by TRTLLM_KVCACHE_DISK_TIER_PATH and TRTLLM_KVCACHE_DISK_TIER_SIZE.
+    //! \return nullptr if the disk tier is not configured.
+    [[nodiscard]] static std::unique_ptr<KVCacheDiskTier> createFromEnv(
+        std::vector<std::size_t> blockSizeInBytesPerPool)
+    {
+        auto const path = common::getEnvKVCacheDiskTierPath();
+        auto const size = common::getEnvKVCacheDiskTierSize();
+        if (path.empty() || size == 0)
+        {
+            return nullptr;
+        }
+        auto const slotSize
+            = std::accumulate(blockSizeInBytesPerPool.begin(), blockSizeInBytesPerPool.end(), std::size_t{0});
+        auto const numBlocks = static_cast<SizeType32>(size / requireNonZero(slotSize));
+        if (numBlocks == 0)
+        {
+            TLLM_LOG_WARNING("KV cache disk tier of %zu bytes cannot hold a single block of %zu bytes, disabling it",
+                size, slotSize);
+            return nullptr;
+        }
+        return std::make_unique<KVCacheDiskTier>(path, numBlocks, std::move(blockSizeInBytesPerPool));
+    }
+
+    ~KVCacheDiskTier()
+    {
+        syncTransfers();
+    }
+
+    KVCacheDiskTier(KVCacheDiskTier const&) = delete;
+    KVCacheDiskTier& operator=(KVCacheDiskTier const&) = delete;
+
+    [[nodiscard]] SizeType32 getNumBlocks() const noexcept
+    {
+        return mNumBlocks;
+    }
+
+    [[nodiscard]] std::size_t getBlockSizeInBytes(SizeType32 poolIdx) const
+    {
+        return mBlockSizeInBytesPerPool.at(poolIdx);
+    }
+
+    [[nodiscard]] kernels::KVCacheIndex getBlockIndex(SizeType32 diskBlockIdx) const
+    {
+        checkBlockIdx(diskBlockIdx);
+        return kernels::KVCacheIndex::tertiary(diskBlockIdx);
+    }
+
+    //! \brief Asynchronously write secondary blocks to the disk tier.
+    //! \details The host blocks must not be modified until the transfer completed, see syncBlock.
+    void offload(std::vector<BlockTransfer> transfers)
+    {
+        enqueue(std::move(transfers), true);
+    }
+
+    //! \brief Asynchronously read blocks from the disk tier into secondary blocks.
+    //! \details Pending writes of the same disk blocks complete first.
+    void onboard(std::vector<BlockTransfer> transfers)
+    {
+        enqueue(std::move(transfers), false);
+    }
+
+    void offload(SizeType32 diskBlockIdx, std::vector<TensorPtr> hostBlocks)
+    {
+        std::vector<BlockTransfer> transfers;
+        transfers.push_back(BlockTransfer{diskBlockIdx, std::move(hostBlocks)});
+        offload(std::move(transfers));
+    }
+
+    void onboard(SizeType32 diskBlockIdx, std::vector<TensorPtr> hostBlocks)
+    {
+        std::vector<BlockTransfer> transfers;
+        transfers.push_back(BlockTransfer{diskBlockIdx, std::move(hostBlocks)});
+        onboard(std::move(transfers));
+    }
+
+    //! \brief Wait for the pending transfer of a disk block, if any.
+    void syncBlock(SizeType32 diskBlockIdx)
+    {
+        std::shared_future<void> pending;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto it = mPendingTransfers.find(diskBlockIdx);
+            if (it == mPendingTransfers.end())
+            {
+                return;
+            }
+            pending = it->second;
+        }
+        pending.get();
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mPendingTransfers.find(diskBlockIdx);
+        if (it != mPendingTransfers.end() && isReady(it->second))
+        {
+            mPendingTransfers.erase(it);
+        }
+    }
+
+    //! \brief Wait for all pending transfers.
+    void syncTransfers()
+    {
+        std::unordered_map<SizeType32, std::shared_future<void>> pending;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            pending.swap(mPendingTransfers);
+        }
+        for (auto& [blockIdx, future] : pending)
+        {
+            future.get();
+        }
+    }
+
+    //! \brief Number of bytes moved between host and disk since construction.
+    [[nodiscard]] std::size_t getNumBytesTransferred() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mNumBytesTransferred;
+    }
+
+private:
+    static std::size_t requireNonZero(std::size_t slotSize)
+    {
+        TLLM_CHECK_WITH_INFO(slotSize > 0, "Disk tier block size must be positive");
+        return slotSize;
+    }
+
+    static bool isReady(std::shared_future<void> const& future)
+    {
+        return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    void checkBlockIdx(SizeType32 diskBlockIdx) const
+    {
+        TLLM_CHECK_WITH_INFO(diskBlockIdx >= 0 && diskBlockIdx < mNumBlocks, "Disk block index %d out of range [0, %d)",
+            diskBlockIdx, mNumBlocks);
+    }
+
+    void copyBlock(BlockTransfer const& transfer, bool isOffload)
+    {
+        auto* slot = mFile.data() + static_cast<std::size_t>(transfer.diskBlockIdx) * mSlotSize;
+        for (std::size_t poolIdx = 0; poolIdx < transfer.hostBlocks.size(); ++poolIdx)
+        {
+            auto const& hostBlock = transfer.hostBlocks[poolIdx];
+            auto const numBytes = mBlockSizeInBytesPerPool[poolIdx];
+            auto* diskPtr = slot + mPoolOffsets[poolIdx];
+            if (isOffload)
+            {
+                std::memcpy(diskPtr, hostBlock->data(), numBytes);
+            }
+            else
+            {
+                std::memcpy(hostBlock->data(), diskPtr, numBytes);
+            }
+        }
+        if (isOffload)
+        {
+            // Start write-back early, the page cache would otherwise accumulate dirty pages of the whole tier.
+            mFile.flush(static_cast<std::size_t>(transfer.diskBlockIdx) * mSlotSize, mSlotSize, true);
+        }
+    }
+
+    void enqueue(std::vector<BlockTransfer> transfers, bool isOffload)
+    {
+        if (transfers.empty())
+        {
+            return;
+        }
+
+        std::size_t numBytes = 0;
+        std::vector<std::shared_future<void>> dependencies;
+        for (auto const& transfer : transfers)
+        {
+            checkBlockIdx(transfer.diskBlockIdx);
+            TLLM_CHECK_WITH_INFO(transfer.hostBlocks.size() == mBlockSizeInBytesPerPool.size(),
+                "Expected %zu host blocks, got %zu", mBlockSizeInBytesPerPool.size(), transfer.hostBlocks.size());
+            for (std::size_t poolIdx = 0; poolIdx < transfer.hostBlocks.size(); ++poolIdx)
+            {
+                auto const& hostBlock = transfer.hostBlocks[poolIdx];
+                TLLM_CHECK(hostBlock);
+                TLLM_CHECK_WITH_INFO(hostBlock->getMemoryType() != runtime::MemoryType::kGPU,
+                    "Disk tier transfers must be staged through host memory");
+                TLLM_CHECK_WITH_INFO(hostBlock->getSizeInBytes() >= mBlockSizeInBytesPerPool[poolIdx],
+                    "Host block of pool %zu is smaller than the disk block", poolIdx);
+            }
+            numBytes += mSlotSize;
+        }
+
+        // Split the batch over the workers, one task per worker, instead of one task per block.
+        auto const numChunks = std::min(mNumWorkers, transfers.size());
+        auto const chunkSize = (transfers.size() + numChunks - 1) / numChunks;
+        auto sharedTransfers = std::make_shared<std::vector<BlockTransfer>>(std::move(transfers));
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto const& transfer : *sharedTransfers)
+        {
+            auto it = mPendingTransfers.find(transfer.diskBlockIdx);
+            if (it != mPendingTransfers.end())
+            {
+                dependencies.push_back(it->second);
+            }
+        }
+        for (std::size_t chunkBegin = 0; chunkBegin < sharedTransfers->size(); chunkBegin += chunkSize)
+        {
+            auto const chunkEnd = std::min(chunkBegin + chunkSize, sharedTransfers->size());
+            auto future = mWorkers
+                              .enqueue(
+                                  [this, sharedTransfers, dependencies, chunkBegin, chunkEnd, isOffload]()
+                                  {
+                                      for (auto const& dependency : dependencies)
+                                      {
+                                          dependency.wait();
+                                      }
+                                      for (auto i = chunkBegin; i < chunkEnd; ++i)
+                                      {
+                                          copyBlock((*sharedTransfers)[i], isOffload);
+                                      }
+                                  })
+                              .share();
+            for (auto i = chunkBegin; i < chunkEnd; ++i)
+            {
+                mPendingTransfers[(*sharedTransfers)[i].diskBlockIdx] = future;
+            }
+        }
+        mNumBytesTransferred += numBytes;
+    }
+
+    SizeType32 mNumBlocks;
+    std::vector<std::size_t> mBlockSizeInBytesPerPool;
+    // Offset of every pool inside a slot.
+    std::vector<std::size_t> mPoolOffsets;
+    // Size of one slot, i.e. one block of every pool.
+    std::size_t mSlotSize;
+    common::MemoryMappedFile mFile;
+    std::size_t mNumWorkers;
+    runtime::WorkerPool mWorkers;
+
+    mutable std::mutex mMutex;
+    // Last pending transfer of every disk block.
+    std::unordered_map<SizeType32, std::shared_future<void>> mPendingTransfers;
+    std::size_t mNumBytesTransferred{0};
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/kvCacheUvmPrefetcher.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Decides which blocks of a pool larger than the device memory reside on the device. Every block has a score, the
+// exponentially decayed number of steps that read it, as ExpertResidencyPolicy does for the experts of a MoE layer.
+// Blocks read by a step that are not resident replace the resident blocks with lower scores that the step did not
+// read, up to a number of migrations per step so that the migrations stay hidden behind the step.
+class BlockResidencyPolicy
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    struct Config
+    {
+        // Blocks that fit in the device memory given to the KV cache.
+        SizeType32 numDeviceBlocks;
+        float decay{0.9F};
+        SizeType32 maxMigrationsPerStep{256};
+    };
+
+    struct Migrations
+    {
+        // Sorted indices of the blocks to migrate to the device, and to the host.
+        std::vector<SizeType32> promotions;
+        std::vector<SizeType32> demotions;
+    };
+
+    struct Stats
+    {
+        std::int64_t numReads{0};
+        // Reads of blocks resident on the host, served over the host link.
+        std::int64_t numHostReads{0};
+        std::int64_t numPromotions{0};
+        std::int64_t numDemotions{0};
+    };
+
+    BlockResidencyPolicy(SizeType32 numBlocks, Config const& config)
+        : mConfig{config}
+        , mScores(numBlocks, 0.F)
+        , mIsOnDevice(numBlocks, false)
+        , mIsRead(numBlocks, false)
+    {
+        TLLM_CHECK(numBlocks >= 0 && config.numDeviceBlocks >= 0 && config.maxMigrationsPerStep >= 0);
+        TLLM_CHECK(config.decay > 0.F && config.decay <= 1.F);
+    }
+
+    //! \brief Record the blocks a step reads and decide the migrations that follow.
+    //! \param readBlocks Sorted indices without duplicates, see KVCacheUvmPrefetcher::getPrimaryBlockIndices.
+    [[nodiscard]] Migrations step(std::vector<SizeType32> const& readBlocks)
+    {
+        for (auto& score : mScores)
+        {
+            score *= mConfig.decay;
+        }
+        std::vector<SizeType32> candidates;
+        for (auto const idx : readBlocks)
+        {
+            TLLM_CHECK_WITH_INFO(idx >= 0 && idx < getNumBlocks(), "Block %d out of %d blocks", idx, getNumBlocks());
+            mScores[idx] += 1.F;
+            mIsRead[idx] = true;
+            if (!mIsOnDevice[idx])
+            {
+                candidates.push_back(idx);
+            }
+        }
+        mStats.numReads += static_cast<std::int64_t>(readBlocks.size());
+        mStats.numHostReads += static_cast<std::int64_t>(candidates.size());
+
+        std::vector<SizeType32> victims;
+        for (SizeType32 idx = 0; idx < getNumBlocks(); ++idx)
+        {
+            if (mIsOnDevice[idx] && !mIsRead[idx])
+            {
+                victims.push_back(idx);
+            }
+        }
+        auto const byScore = [this](SizeType32 lhs, SizeType32 rhs) { return mScores[lhs] < mScores[rhs]; };
+        std::stable_sort(
+            candidates.begin(), candidates.end(), [&byScore](auto lhs, auto rhs) { return byScore(rhs, lhs); });
+        std::stable_sort(victims.begin(), victims.end(), byScore);
+
+        Migrations migrations;
+        std::size_t victimIdx{0};
+        for (auto const idx : candidates)
+        {
+            if (static_cast<SizeType32>(migrations.promotions.size()) >= mConfig.maxMigrationsPerStep)
+            {
+                break;
+            }
+            if (mNumOnDevice >= mConfig.numDeviceBlocks)
+            {
+                if (victimIdx == victims.size() || mScores[victims[victimIdx]] >= mScores[idx])
+                {
+                    break;
+                }
+                auto const victim = victims[victimIdx++];
+                mIsOnDevice[victim] = false;
+                --mNumOnDevice;
+                migrations.demotions.push_back(victim);
+            }
+            mIsOnDevice[idx] = true;
+            ++mNumOnDevice;
+            migrations.promotions.push_back(idx);
+        }
+        for (auto const idx : readBlocks)
+        {
+            mIsRead[idx] = false;
+        }
+        std::sort(migrations.promotions.begin(), migrations.promotions.end());
+        std::sort(migrations.demotions.begin(), migrations.demotions.end());
+        mStats.numPromotions += static_cast<std::int64_t>(migrations.promotions.size());
+        mStats.numDemotions += static_cast<std::int64_t>(migrations.demotions.size());
+        return migrations;
+    }
+
+    [[nodiscard]] SizeType32 getNumBlocks() const noexcept
+    {
+        return static_cast<SizeType32>(mScores.size());
+    }
+
+    [[nodiscard]] SizeType32 getNumOnDevice() const noexcept
+    {
+        return mNumOnDevice;
+    }
+
+    [[nodiscard]] bool isOnDevice(SizeType32 idx) const
+    {
+        return mIsOnDevice.at(idx);
+    }
+
+    [[nodiscard]] float getScore(SizeType32 idx) const
+    {
+        return mScores.at(idx);
+    }
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+private:
+    Config mConfig;
+    std::vector<float> mScores;
+    std::vector<bool> mIsOnDevice;
+    // Blocks of the current step, only set within step.
+    std::vector<bool> mIsRead;
+    SizeType32 mNumOnDevice{0};
+    Stats mStats;
+};
+
+// Cache level for UVM block pools on a host link that the device reads coherently, e.g. NVLink-C2C on Grace Hopper.
+// KVCacheTransferManager copies offloaded blocks back to the device before they are reused, as it would over PCIe.
+// Here the pools are mapped in the page tables of the device, so the attention kernels read the blocks resident on
+// the host in place at the speed of the host link, and only hot blocks migrate to the device, see
+// BlockResidencyPolicy. Both are the same memory, so a migration changes no block offset.
+//
+// Usage: allocate the pools with useUvm, then call step with the requests scheduled for the next step once the current
+// step is enqueued, like KVCacheUvmPrefetcher::update.
+class KVCacheHostDirectTier
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    KVCacheHostDirectTier(
+        KVCacheUvmPrefetcher prefetcher, SizeType32 numBlocks, BlockResidencyPolicy::Config const& config, int device)
+        : mPrefetcher{std::move(prefetcher)}
+        , mPolicy{numBlocks, config}
+        , mDevice{device}
+    {
+        TLLM_CHECK_WITH_INFO(mPrefetcher.isEnabled(), "The host direct tier needs KV cache pools in UVM");
+        mPrefetcher.mapPoolsOnDevice(mDevice);
+    }
+
+    //! \brief Whether the device reads host memory coherently through the page tables of the host, which is the case
+    //! on NVLink-C2C.
+    [[nodiscard]] static bool isSupported(int device)
+    {
+        int value{0};
+        TLLM_CUDA_CHECK(cudaDeviceGetAttribute(&value, cudaDevAttrPageableMemoryAccessUsesHostPageTables, device));
+        return value != 0;
+    }
+
+    //! \brief Tier over the primary pools of the block manager, not set if they are not in UVM or the device does not
+    //! read host memory coherently.
+    [[nodiscard]] static std::optional<KVCacheHostDirectTier> fromKvCacheManager(
+        BaseKVCacheManager const& kvCacheManager, SizeType32 numDeviceBlocks, int device = common::getDevice())
+    {
+        auto prefetcher = KVCacheUvmPrefetcher::fromKvCacheManager(kvCacheManager);
+        if (!prefetcher.isEnabled() || !isSupported(device))
+        {
+            TLLM_LOG_DEBUG("KV cache host direct tier disabled, it needs UVM pools on a coherent host link");
+            return std::nullopt;
+        }
+        auto const numBlocks = kvCacheManager.getBlockManager().getNumPrimaryBlocks();
+        return KVCacheHostDirectTier{std::move(prefetcher), numBlocks,
+            BlockResidencyPolicy::Config{std::min(numDeviceBlocks, numBlocks)}, device};
+    }
+
+    //! \brief Migrate the blocks the scheduled requests make hot to the device, and the colder blocks they replace to
+    //! the host once the current step is done with them.
+    void step(BaseKVCacheManager const& kvCacheManager, RequestVector const& scheduledRequests,
+        runtime::CudaStream const& computeStream)
+    {
+        auto const migrations
+            = mPolicy.step(KVCacheUvmPrefetcher::getPrimaryBlockIndices(kvCacheManager, scheduledRequests));
+        mPrefetcher.demote(migrations.demotions, computeStream);
+        mPrefetcher.prefetch(migrations.promotions, mDevice);
+    }
+
+    [[nodiscard]] BlockResidencyPolicy const& getPolicy() const noexcept
+    {
+        return mPolicy;
+    }
+
+    [[nodiscard]] KVCacheUvmPrefetcher const& getPrefetcher() const noexcept
+    {
+        return mPrefetcher;
+    }
+
+private:
+    KVCacheUvmPrefetcher mPrefetcher;
+    BlockResidencyPolicy mPolicy;
+    int mDevice;
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <memory>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Layer-granular onboarding of reused blocks. Instead of making the forward stream wait for the complete copy of every
+// onboarded block (KVCacheTransferManager::syncTransfers), blocks are copied layer by layer on a separate stream and
+// an event is recorded after every layer. The attention plugin of layer L only waits for the event of layer L, so the
+// copy of the later layers overlaps with the context phase of the earlier ones.
+//
+// The onboarder is made visible to the attention plugin for the duration of a forward pass with ScopedActivation, the
+// same way ContextProgress is used to track the progress of the context phase.
+class KVCacheLayerwiseOnboarder
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using TensorPtr = runtime::ITensor::SharedPtr;
+
+    //! \brief One pool of blocks. Both tensors have shape [numBlocks, numLayersInPool, ...].
+    struct Pool
+    {
+        TensorPtr primary;
+        TensorPtr secondary;
+    };
+
+    //! \brief Copy of the secondary block at srcIdx to the primary block at dstIdx in every pool.
+    struct BlockCopy
+    {
+        SizeType32 srcIdx;
+        SizeType32 dstIdx;
+    };
+
+    //! \param pools Block pools.
+    //! \param layerToPool Pool of every local layer.
+    //! \param layerToPoolLayer Index of every local layer within its pool.
+    KVCacheLayerwiseOnboarder(std::vector<Pool> pools, std::vector<SizeType32> layerToPool,
+        std::vector<SizeType32> layerToPoolLayer, runtime::BufferManager::CudaStreamPtr stream = nullptr)
+        : mPools{std::move(pools)}
+        , mLayerToPool{std::move(layerToPool)}
+        , mLayerToPoolLayer{std::move(layerToPoolLayer)}
+        , mStream{stream ? std::move(stream) : std::make_shared<runtime::CudaStream>()}
+        , mBufferManager{mStream}
+        , mLayerEvents(mLayerToPool.size())
+    {
+        TLLM_CHECK(mLayerToPool.size() == mLayerToPoolLayer.size());
+    }
+
+    //! \brief Start copying blocks layer by layer. Copies wait for the work already enqueued on computeStream, so that
+    //! destination blocks can be safely overwritten.
+    void onboard(std::vector<BlockCopy> const& copies, runtime::CudaStream const& computeStream)
+    {
+        if (copies.empty())
+        {
+            return;
+        }
+        runtime::CudaEvent ready;
+        computeStream.record(ready);
+        mStream->wait(ready);
+
+        for (SizeType32 layerIdx = 0; layerIdx < getNumLayers(); ++layerIdx)
+        {
+            auto const& pool = mPools.at(mLayerToPool[layerIdx]);
+            auto const poolLayerIdx = static_cast<runtime::ITensor::DimType64>(mLayerToPoolLayer[layerIdx]);
+            for (auto const& copy : copies)
+            {
+                auto const src = runtime::ITensor::slice(pool.secondary, {copy.srcIdx, poolLayerIdx}, 1);
+                auto dst = runtime::ITensor::slice(pool.primary, {copy.dstIdx, poolLayerIdx}, 1);
+                mBufferManager.copy(*src, *dst);
+            }
+            mStream->record(mLayerEvents[layerIdx]);
+        }
+        mHasPendingCopies = true;
+    }
+
+    //! \brief Make stream wait until the blocks of layerIdx are onboarded.
+    void waitForLayer(SizeType32 layerIdx, cudaStream_t stream) const
+    {
+        if (mHasPendingCopies)
+        {
+            TLLM_CUDA_CHECK(cudaStreamWaitEvent(stream, mLayerEvents.at(layerIdx).get()));
+        }
+    }
+
+    //! \brief Make computeStream wait for all copies, e.g. before the blocks are used outside of the attention plugin.
+    void syncTransfers(runtime::CudaStream const& computeStream)
+    {
+        if (mHasPendingCopies)
+        {
+            computeStream.wait(mLayerEvents.back());
+            mHasPendingCopies = false;
+        }
+    }
+
+    [[nodiscard]] SizeType32 getNumLayers() const
+    {
+        return static_cast<SizeType32>(mLayerToPool.size());
+    }
+
+    //! \brief Onboarder active for the forward pass enqueued by the calling thread, or nullptr.
+    [[nodiscard]] static KVCacheLayerwiseOnboarder const* getActive()
+    {
+        return activeOnboarder();
+    }
+
+    //! \brief Make onboarder visible to the attention plugin while the engine is enqueued.
+    class ScopedActivation
+    {
+    public:
+        explicit ScopedActivation(KVCacheLayerwiseOnboarder const* onboarder)
+            : mPrevious{activeOnboarder()}
+        {
+            activeOnboarder() = onboarder;
+        }
+
+        ~ScopedActivation()
+        {
+            activeOnboarder() = mPrevious;
+        }
+
+        ScopedActivation(ScopedActivation const&) = delete;
+        ScopedActivation& operator=(ScopedActivation const&) = delete;
+
+    private:
+        KVCacheLayerwiseOnboarder const* mPrevious;
+    };
+
+private:
+    static KVCacheLayerwiseOnboarder const*& activeOnboarder()
+    {
+        thread_local KVCacheLayerwiseOnboarder const* onboarder{nullptr};
+        return onboarder;
+    }
+
+    std::vector<Pool> mPools;
+    std::vector<SizeType32> mLayerToPool;
+    std::vector<SizeType32> mLayerToPoolLayer;
+    runtime::BufferManager::CudaStreamPtr mStream;
+    runtime::BufferManager mBufferManager;
+    std::vector<runtime::CudaEvent> mLayerEvents;
+    bool mHasPendingCopies{false};
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
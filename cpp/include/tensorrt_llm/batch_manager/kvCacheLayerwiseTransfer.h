@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/contextProgress.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Layer-wise streaming of the KV cache from the context to the generation instance, enabled by
+// TRTLLM_DISAGG_LAYERWISE. On the context instance, the attention plugin records an event in the ContextProgress of
+// the request after every layer. KVCacheLayerwiseSender waits for these events on its own thread and hands the blocks
+// of every finished layer to the transport while the later layers are still computed, so only the last layer is sent
+// after the context phase. On the generation instance, KVCacheLayerwiseReceiver exposes the destination blocks, which
+// are allocated when the request arrives with its ContextPhaseParams, and tracks which layers have landed.
+//
+// Both sides describe the pools like KVCacheLayerwiseOnboarder: tensors of shape [numBlocks, numLayersInPool, ...]
+// and the pool and index within the pool of every local layer.
+
+//! \brief Pool layout shared by sender and receiver.
+struct KVCacheLayerLayout
+{
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using TensorPtr = runtime::ITensor::SharedPtr;
+
+    std::vector<TensorPtr> pools;
+    std::vector<SizeType32> layerToPool;
+    std::vector<SizeType32> layerToPoolLayer;
+
+    [[nodiscard]] SizeType32 getNumLayers() const
+    {
+        return static_cast<SizeType32>(layerToPool.size());
+    }
+
+    //! \brief Views of the given blocks of one layer, each of shape [1, 1, ...].
+    [[nodiscard]] std::vector<TensorPtr> getLayerBlocks(
+        SizeType32 layerIdx, std::vector<SizeType32> const& memoryPoolBlockIndices) const
+    {
+        auto const& pool = pools.at(layerToPool.at(layerIdx));
+        auto const poolLayerIdx = static_cast<runtime::ITensor::DimType64>(layerToPoolLayer[layerIdx]);
+        std::vector<TensorPtr> blocks;
+        blocks.reserve(memoryPoolBlockIndices.size());
+        for (auto const blockIdx : memoryPoolBlockIndices)
+        {
+            blocks.push_back(runtime::ITensor::slice(pool, {blockIdx, poolLayerIdx}, 1));
+        }
+        return blocks;
+    }
+};
+
+class KVCacheLayerwiseSender
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+    using TensorPtr = runtime::ITensor::SharedPtr;
+    //! \brief Send the blocks of one layer of a request. The blocks may only be read until the call returns.
+    using SendLayer
+        = std::function<void(RequestIdType requestId, SizeType32 layerIdx, std::vector<TensorPtr> const& blocks)>;
+
+    KVCacheLayerwiseSender(KVCacheLayerLayout layout, SendLayer sendLayer)
+        : mLayout{std::move(layout)}
+        , mSendLayer{std::move(sendLayer)}
+    {
+        TLLM_CHECK(mLayout.layerToPool.size() == mLayout.layerToPoolLayer.size());
+        mWorker = std::thread([this] { run(); });
+    }
+
+    ~KVCacheLayerwiseSender()
+    {
+        {
+            std::lock_guard lock{mMutex};
+            mShutdown = true;
+        }
+        mCondition.notify_all();
+        mWorker.join();
+    }
+
+    KVCacheLayerwiseSender(KVCacheLayerwiseSender const&) = delete;
+    KVCacheLayerwiseSender& operator=(KVCacheLayerwiseSender const&) = delete;
+
+    //! \brief Stream the blocks of a request whose context phase is enqueued or about to be, layer by layer as
+    //! progress reports them. The blocks must stay allocated until the returned future is ready.
+    [[nodiscard]] std::future<void> send(RequestIdType requestId, std::vector<SizeType32> memoryPoolBlockIndices,
+        std::shared_ptr<ContextProgress> progress)
+    {
+        TLLM_CHECK(progress != nullptr && progress->getNumLayers() == mLayout.getNumLayers());
+        Job job{requestId, std::move(memoryPoolBlockIndices), std::move(progress), {}};
+        auto future = job.promise.get_future();
+        {
+            std::lock_guard lock{mMutex};
+            mJobs.push_back(std::move(job));
+        }
+        mCondition.notify_one();
+        return future;
+    }
+
+    [[nodiscard]] std::future<void> send(LlmRequest const& request, std::vector<SizeType32> memoryPoolBlockIndices)
+    {
+        return send(request.mRequestId, std::move(memoryPoolBlockIndices), request.getContextProgress());
+    }
+
+private:
+    struct Job
+    {
+        RequestIdType requestId;
+        std::vector<SizeType32> memoryPoolBlockIndices;
+        std::shared_ptr<ContextProgress> progress;
+        std::promise<void> promise;
+    };
+
+    void run()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock lock{mMutex};
+                mCondition.wait(lock, [this] { return mShutdown || !mJobs.empty(); });
+                if (mJobs.empty())
+                {
+                    return;
+                }
+                job = std::move(mJobs.front());
+                mJobs.pop_front();
+            }
+            try
+            {
+                for (SizeType32 layerIdx = 0; layerIdx < mLayout.getNumLayers(); ++layerIdx)
+                {
+                    // Returns once the attention of layerIdx completed on the device.
+                    job.progress->wait(layerIdx);
+                    mSendLayer(job.requestId, layerIdx, mLayout.getLayerBlocks(layerIdx, job.memoryPoolBlockIndices));
+                }
+                job.promise.set_value();
+            }
+            catch (std::exception const& e)
+            {
+                TLLM_LOG_ERROR("Layer-wise KV cache send of request %lu failed: %s", job.requestId, e.what());
+                job.promise.set_exception(std::current_exception());
+            }
+        }
+    }
+
+    KVCacheLayerLayout mLayout;
+    SendLayer mSendLayer;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<Job> mJobs;
+    bool mShutdown{false};
+    std::thread mWorker;
+};
+
+class KVCacheLayerwiseReceiver
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+    using TensorPtr = runtime::ITensor::SharedPtr;
+
+    explicit KVCacheLayerwiseReceiver(KVCacheLayerLayout layout)
+        : mLayout{std::move(layout)}
+    {
+        TLLM_CHECK(mLayout.layerToPool.size() == mLayout.layerToPoolLayer.size());
+    }
+
+    //! \brief Register the destination blocks of a request, allocated from its ContextPhaseParams before any layer
+    //! arrives. requestId is the id of the request on the context instance.
+    void expect(RequestIdType requestId, std::vector<SizeType32> memoryPoolBlockIndices)
+    {
+        std::lock_guard lock{mMutex};
+        auto const [it, inserted] = mPending.try_emplace(
+            requestId, Pending{std::move(memoryPoolBlockIndices), std::vector<bool>(mLayout.getNumLayers()), 0});
+        TLLM_CHECK_WITH_INFO(inserted, "Request %lu is already expected", requestId);
+    }
+
+    //! \brief Destination blocks of one layer, for the transport to write into.
+    [[nodiscard]] std::vector<TensorPtr> getLayerBlocks(RequestIdType requestId, SizeType32 layerIdx) const
+    {
+        std::lock_guard lock{mMutex};
+        return mLayout.getLayerBlocks(layerIdx, getPending(requestId).memoryPoolBlockIndices);
+    }
+
+    //! \brief Mark a layer as landed once the transport completed its writes.
+    void markLayerReceived(RequestIdType requestId, SizeType32 layerIdx)
+    {
+        {
+            std::lock_guard lock{mMutex};
+            auto& pending = getPending(requestId);
+            if (pending.receivedLayers.at(layerIdx))
+            {
+                return;
+            }
+            pending.receivedLayers[layerIdx] = true;
+            ++pending.numReceived;
+        }
+        mCondition.notify_all();
+    }
+
+    //! \brief Whether every layer of the request landed, after which it can start decoding.
+    [[nodiscard]] bool isComplete(RequestIdType requestId) const
+    {
+        std::lock_guard lock{mMutex};
+        return getPending(requestId).numReceived == mLayout.getNumLayers();
+    }
+
+    void waitComplete(RequestIdType requestId) const
+    {
+        std::unique_lock lock{mMutex};
+        mCondition.wait(lock, [&] { return getPending(requestId).numReceived == mLayout.getNumLayers(); });
+    }
+
+    //! \brief Stop tracking a request, when it is complete or cancelled.
+    void erase(RequestIdType requestId)
+    {
+        std::lock_guard lock{mMutex};
+        mPending.erase(requestId);
+    }
+
+private:
+    struct Pending
+    {
+        std::vector<SizeType32> memoryPoolBlockIndices;
+        std::vector<bool> receivedLayers;
+        SizeType32 numReceived;
+    };
+
+    [[nodiscard]] Pending const& getPending(RequestIdType requestId) const
+    {
+        auto const it = mPending.find(requestId);
+        TLLM_CHECK_WITH_INFO(it != mPending.end(), "Request %lu is not expected", requestId);
+        return it->second;
+    }
+
+    [[nodiscard]] Pending& getPending(RequestIdType requestId)
+    {
+        return const_cast<Pending&>(std::as_const(*this).getPending(requestId));
+    }
+
+    KVCacheLayerLayout mLayout;
+    mutable std::mutex mMutex;
+    mutable std::condition_variable mCondition;
+    std::unordered_map<RequestIdType, Pending> mPending;
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
@@ -51,6 +51,8 @@ static constexpr SizeType32 kPrimaryLevel = 0;
 
 static constexpr SizeType32 kSecondaryLevel = 1;
 
+static constexpr SizeType32 kTertiaryLevel = 2;
+
 class KVCacheBlock;
 class KVCacheManager;
 class KVCacheTransferManager;
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/kvCachePoolResizer.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Shares the device memory of one GPU between the KV caches of several models, each served by its own executor.
+// Every model is guaranteed minNumBlocks blocks and may borrow memory the other models do not need, up to maxNumBlocks.
+// Models report their demand every iteration; the broker splits the memory beyond the guarantees in proportion to
+// the weights of the models whose demand is not met, and leaves memory nobody asks for with the model holding it.
+//
+// The primary pools of every model must be reserved for maxNumBlocks and backed by runtime::VirtualDeviceMemory, so a
+// KVCachePoolResizer can map and unmap them. Each model calls rebalance from its own iteration loop; growing only
+// maps memory that the other models already gave back, so the mapped total never exceeds the budget.
+class KVCacheMemoryBroker
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using ModelId = SizeType32;
+
+    struct ModelConfig
+    {
+        //! \brief Bytes of one block over all primary pools of the model.
+        std::size_t blockSizeInBytes;
+        SizeType32 minNumBlocks;
+        SizeType32 maxNumBlocks;
+        float weight{1.F};
+    };
+
+    struct Stats
+    {
+        std::int64_t numGrows{0};
+        std::int64_t numShrinks{0};
+        //! \brief Shrinks that were cut short because the model used too many blocks.
+        std::int64_t numPartialShrinks{0};
+        std::size_t numMappedBytes{0};
+    };
+
+    explicit KVCacheMemoryBroker(std::size_t memoryBudget)
+        : mMemoryBudget{memoryBudget}
+    {
+    }
+
+    //! \brief Register a model that currently holds numBlocks blocks.
+    ModelId addModel(ModelConfig const& config, SizeType32 numBlocks)
+    {
+        TLLM_CHECK(config.blockSizeInBytes > 0 && config.weight > 0.F);
+        TLLM_CHECK(config.minNumBlocks > 0 && config.minNumBlocks <= numBlocks && numBlocks <= config.maxNumBlocks);
+        std::lock_guard lock{mMutex};
+        std::size_t guaranteed{config.minNumBlocks * config.blockSizeInBytes};
+        for (auto const& model : mModels)
+        {
+            guaranteed += model.config.minNumBlocks * model.config.blockSizeInBytes;
+        }
+        TLLM_CHECK_WITH_INFO(guaranteed <= mMemoryBudget, "The guaranteed KV cache memory exceeds the budget");
+        TLLM_CHECK_WITH_INFO(getNumMappedBytes() + numBlocks * config.blockSizeInBytes <= mMemoryBudget,
+            "The KV cache memory of the models exceeds the budget");
+        mModels.push_back({config, numBlocks, numBlocks});
+        return static_cast<ModelId>(mModels.size() - 1);
+    }
+
+    //! \brief Number of blocks the model needs, for example its used blocks plus the ones of its waiting requests.
+    void setDemand(ModelId modelId, SizeType32 numBlocks)
+    {
+        std::lock_guard lock{mMutex};
+        mModels.at(modelId).demand = numBlocks;
+    }
+
+    [[nodiscard]] SizeType32 getNumBlocks(ModelId modelId) const
+    {
+        std::lock_guard lock{mMutex};
+        return mModels.at(modelId).numBlocks;
+    }
+
+    //! \brief Number of blocks the model should hold given the demand of all models.
+    [[nodiscard]] SizeType32 getTargetNumBlocks(ModelId modelId) const
+    {
+        std::lock_guard lock{mMutex};
+        return computeTargets().at(modelId);
+    }
+
+    //! \brief Reserve memory for the model to grow to numBlocks blocks, as far as the budget allows.
+    //! \return The number of blocks the model may map now, at least its current number.
+    SizeType32 reserve(ModelId modelId, SizeType32 numBlocks)
+    {
+        std::lock_guard lock{mMutex};
+        auto& model = mModels.at(modelId);
+        numBlocks = std::min(numBlocks, model.config.maxNumBlocks);
+        if (numBlocks <= model.numBlocks)
+        {
+            return model.numBlocks;
+        }
+        auto const numFreeBlocks
+            = static_cast<SizeType32>((mMemoryBudget - getNumMappedBytes()) / model.config.blockSizeInBytes);
+        auto const granted = std::min(numBlocks, model.numBlocks + numFreeBlocks);
+        if (granted > model.numBlocks)
+        {
+            model.numBlocks = granted;
+            ++mStats.numGrows;
+        }
+        return granted;
+    }
+
+    //! \brief Give back the memory of a model that shrank to numBlocks blocks.
+    void release(ModelId modelId, SizeType32 numBlocks)
+    {
+        std::lock_guard lock{mMutex};
+        auto& model = mModels.at(modelId);
+        TLLM_CHECK(numBlocks >= model.config.minNumBlocks);
+        if (numBlocks < model.numBlocks)
+        {
+            model.numBlocks = numBlocks;
+            ++mStats.numShrinks;
+        }
+    }
+
+    //! \brief Resize the pools of the model towards its target. Must be called between iterations of the model, with
+    //! every sequence that holds blocks, see KVCachePoolResizer::resize.
+    //! \return The number of blocks the model holds afterwards.
+    SizeType32 rebalance(ModelId modelId, KVCachePoolResizer& resizer, BlockManager const& blockManager,
+        std::vector<KVCachePoolResizer::SequenceRef> const& sequences)
+    {
+        auto const numBlocks = getNumBlocks(modelId);
+        auto const target = getTargetNumBlocks(modelId);
+        if (target > numBlocks)
+        {
+            auto const granted = reserve(modelId, target);
+            if (granted > numBlocks && !resizer.resize(granted, sequences))
+            {
+                // The pools were reserved for fewer than maxNumBlocks blocks.
+                std::lock_guard lock{mMutex};
+                mModels.at(modelId).numBlocks = numBlocks;
+                --mStats.numGrows;
+                TLLM_LOG_WARNING("Cannot grow the KV cache of model %d to %d blocks", modelId, granted);
+                return numBlocks;
+            }
+            return granted;
+        }
+        if (target < numBlocks)
+        {
+            // Blocks in use cannot be given back before their requests finish, the ballast of the resizer is not
+            // free either but lies beyond numBlocks.
+            auto const numUsedBlocks = numBlocks - blockManager.getNumFreeBlocks();
+            auto const shrunk = std::max(target, numUsedBlocks);
+            if (shrunk < numBlocks && resizer.resize(shrunk, sequences))
+            {
+                release(modelId, shrunk);
+                if (shrunk > target)
+                {
+                    std::lock_guard lock{mMutex};
+                    ++mStats.numPartialShrinks;
+                }
+                return shrunk;
+            }
+        }
+        return numBlocks;
+    }
+
+    [[nodiscard]] Stats getStats() const
+    {
+        std::lock_guard lock{mMutex};
+        auto stats = mStats;
+        stats.numMappedBytes = getNumMappedBytes();
+        return stats;
+    }
+
+private:
+    struct Model
+    {
+        ModelConfig config;
+        SizeType32 numBlocks;
+        SizeType32 demand;
+    };
+
+    [[nodiscard]] std::size_t getNumMappedBytes() const
+    {
+        std::size_t numBytes{0};
+        for (auto const& model : mModels)
+        {
+            numBytes += model.numBlocks * model.config.blockSizeInBytes;
+        }
+        return numBytes;
+    }
+
+    //! \brief Weighted water filling of the memory beyond the guarantees over the unmet demand.
+    [[nodiscard]] std::vector<SizeType32> computeTargets() const
+    {
+        auto const numModels = mModels.size();
+        std::vector<double> targets(numModels);
+        std::vector<double> wanted(numModels);
+        auto remaining = static_cast<double>(mMemoryBudget);
+        for (std::size_t i = 0; i < numModels; ++i)
+        {
+            auto const& model = mModels[i];
+            auto const blockSize = static_cast<double>(model.config.blockSizeInBytes);
+            targets[i] = model.config.minNumBlocks * blockSize;
+            wanted[i] = std::clamp(model.demand, model.config.minNumBlocks, model.config.maxNumBlocks) * blockSize;
+            remaining -= targets[i];
+        }
+        // Every round satisfies at least one model or hands out all memory.
+        for (std::size_t round = 0; round < numModels && remaining > 0.; ++round)
+        {
+            double sumWeights{0};
+            for (std::size_t i = 0; i < numModels; ++i)
+            {
+                sumWeights += targets[i] < wanted[i] ? mModels[i].config.weight : 0.F;
+            }
+            if (sumWeights == 0.)
+            {
+                break;
+            }
+            auto const available = remaining;
+            for (std::size_t i = 0; i < numModels; ++i)
+            {
+                if (targets[i] < wanted[i])
+                {
+                    auto const share
+                        = std::min(available * mModels[i].config.weight / sumWeights, wanted[i] - targets[i]);
+                    targets[i] += share;
+                    remaining -= share;
+                }
+            }
+        }
+        // Memory nobody asks for stays where it is, so idle models keep their cached blocks.
+        for (std::size_t i = 0; i < numModels && remaining > 0.; ++i)
+        {
+            auto const held = static_cast<double>(mModels[i].numBlocks * mModels[i].config.blockSizeInBytes);
+            auto const kept = std::clamp(held - targets[i], 0., remaining);
+            targets[i] += kept;
+            remaining -= kept;
+        }
+
+        std::vector<SizeType32> numBlocks(numModels);
+        for (std::size_t i = 0; i < numModels; ++i)
+        {
+            auto const blockSize = static_cast<double>(mModels[i].config.blockSizeInBytes);
+            numBlocks[i] = static_cast<SizeType32>(targets[i] / blockSize);
+        }
+        return numBlocks;
+    }
+
+    std::size_t const mMemoryBudget;
+    mutable std::mutex mMutex;
+    std::vector<Model> mModels;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Registration of the whole KV cache pools with the network for the lifetime of the cache. Registering memory for
+// RDMA (ibv_reg_mr, ucp_mem_map) pins and maps it on the NIC and costs far more than the transfer of a few blocks, so
+// instead of registering a staging buffer or the blocks of every request, every pool is registered once. Its packed
+// remote keys are exchanged once per peer in a KVCacheMemoryDescriptor, after which a peer can RDMA-write any block
+// directly into its destination from the address computed by getRemoteBlock.
+
+//! \brief Backend that registers memory with the NIC, e.g. the UCX or NIXL wrapper of the transceiver.
+class KVCacheMemoryRegistrar
+{
+public:
+    using Handle = std::uint64_t;
+
+    virtual ~KVCacheMemoryRegistrar() = default;
+
+    //! \brief Register [address, address + size) for remote access.
+    //! \param remoteKey Packed key that lets peers access the memory, e.g. from ucp_rkey_pack.
+    virtual Handle registerMemory(void* address, std::size_t size, std::vector<std::uint8_t>& remoteKey) = 0;
+
+    virtual void deregisterMemory(Handle handle) = 0;
+};
+
+//! \brief Registered pools of one instance, as sent to its peers.
+struct KVCacheMemoryDescriptor
+{
+    struct Pool
+    {
+        std::uint64_t address;
+        std::uint64_t sizeInBytes;
+        std::uint64_t blockSizeInBytes;
+        std::vector<std::uint8_t> remoteKey;
+    };
+
+    std::vector<Pool> pools;
+
+    [[nodiscard]] std::vector<std::uint8_t> serialize() const
+    {
+        std::vector<std::uint8_t> buffer;
+        auto const write = [&buffer](std::uint64_t value)
+        {
+            auto const offset = buffer.size();
+            buffer.resize(offset + sizeof(value));
+            std::memcpy(buffer.data() + offset, &value, sizeof(value));
+        };
+        write(pools.size());
+        for (auto const& pool : pools)
+        {
+            write(pool.address);
+            write(pool.sizeInBytes);
+            write(pool.blockSizeInBytes);
+            write(pool.remoteKey.size());
+            buffer.insert(buffer.end(), pool.remoteKey.begin(), pool.remoteKey.end());
+        }
+        return buffer;
+    }
+
+    [[nodiscard]] static KVCacheMemoryDescriptor deserialize(std::vector<std::uint8_t> const& buffer)
+    {
+        std::size_t offset{0};
+        auto const read = [&]()
+        {
+            TLLM_CHECK_WITH_INFO(offset + sizeof(std::uint64_t) <= buffer.size(), "Truncated KV cache descriptor");
+            std::uint64_t value{0};
+            std::memcpy(&value, buffer.data() + offset, sizeof(value));
+            offset += sizeof(value);
+            return value;
+        };
+        KVCacheMemoryDescriptor descriptor;
+        descriptor.pools.resize(read());
+        for (auto& pool : descriptor.pools)
+        {
+            pool.address = read();
+            pool.sizeInBytes = read();
+            pool.blockSizeInBytes = read();
+            auto const keySize = read();
+            TLLM_CHECK_WITH_INFO(offset + keySize <= buffer.size(), "Truncated KV cache descriptor");
+            pool.remoteKey.assign(buffer.begin() + offset, buffer.begin() + offset + keySize);
+            offset += keySize;
+        }
+        return descriptor;
+    }
+};
+
+class KVCacheMemoryRegistry
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using PeerId = std::uint64_t;
+
+    //! \brief Block of a pool of a peer, to be written with the key of its pool.
+    struct RemoteBlock
+    {
+        std::uint64_t address;
+        std::uint64_t sizeInBytes;
+        std::vector<std::uint8_t> const* remoteKey;
+    };
+
+    //! \param pools Primary pools of shape [numBlocks, ...], registered until the registry is destroyed.
+    KVCacheMemoryRegistry(std::vector<runtime::ITensor::SharedPtr> pools, KVCacheMemoryRegistrar& registrar)
+        : mPools{std::move(pools)}
+        , mRegistrar{registrar}
+    {
+        try
+        {
+            for (auto const& pool : mPools)
+            {
+                std::vector<std::uint8_t> remoteKey;
+                mHandles.push_back(mRegistrar.registerMemory(pool->data(), pool->getSizeInBytes(), remoteKey));
+                mLocal.pools.push_back({reinterpret_cast<std::uint64_t>(pool->data()), pool->getSizeInBytes(),
+                    pool->getSizeInBytes() / pool->getShape().d[0], std::move(remoteKey)});
+            }
+        }
+        catch (...)
+        {
+            deregisterAll();
+            throw;
+        }
+        TLLM_LOG_INFO("Registered %zu KV cache pools for remote access", mPools.size());
+    }
+
+    ~KVCacheMemoryRegistry()
+    {
+        deregisterAll();
+    }
+
+    KVCacheMemoryRegistry(KVCacheMemoryRegistry const&) = delete;
+    KVCacheMemoryRegistry& operator=(KVCacheMemoryRegistry const&) = delete;
+
+    //! \brief Descriptor to send to every peer once.
+    [[nodiscard]] KVCacheMemoryDescriptor const& getLocalDescriptor() const noexcept
+    {
+        return mLocal;
+    }
+
+    //! \brief Store the descriptor received from a peer. Replaces the one of a peer that restarted.
+    void addPeer(PeerId peerId, KVCacheMemoryDescriptor descriptor)
+    {
+        std::lock_guard lock{mMutex};
+        mPeers.insert_or_assign(peerId, std::move(descriptor));
+    }
+
+    [[nodiscard]] bool hasPeer(PeerId peerId) const
+    {
+        std::lock_guard lock{mMutex};
+        return mPeers.count(peerId) != 0;
+    }
+
+    void removePeer(PeerId peerId)
+    {
+        std::lock_guard lock{mMutex};
+        mPeers.erase(peerId);
+    }
+
+    //! \brief Destination of a block of a peer. The key stays valid until the peer is removed or replaced.
+    [[nodiscard]] RemoteBlock getRemoteBlock(PeerId peerId, SizeType32 poolIdx, SizeType32 memoryPoolBlockIndex) const
+    {
+        std::lock_guard lock{mMutex};
+        auto const it = mPeers.find(peerId);
+        TLLM_CHECK_WITH_INFO(it != mPeers.end(), "No KV cache descriptor of peer %lu", peerId);
+        auto const& pool = it->second.pools.at(poolIdx);
+        auto const offset = static_cast<std::uint64_t>(memoryPoolBlockIndex) * pool.blockSizeInBytes;
+        TLLM_CHECK_WITH_INFO(offset + pool.blockSizeInBytes <= pool.sizeInBytes,
+            "Block %d is outside of pool %d of peer %lu", memoryPoolBlockIndex, poolIdx, peerId);
+        return {pool.address + offset, pool.blockSizeInBytes, &pool.remoteKey};
+    }
+
+    //! \brief Source address of a local block, inside the registered memory.
+    [[nodiscard]] void* getLocalBlock(SizeType32 poolIdx, SizeType32 memoryPoolBlockIndex) const
+    {
+        auto const& pool = mLocal.pools.at(poolIdx);
+        return reinterpret_cast<std::uint8_t*>(pool.address) + memoryPoolBlockIndex * pool.blockSizeInBytes;
+    }
+
+private:
+    void deregisterAll()
+    {
+        for (auto const handle : mHandles)
+        {
+            mRegistrar.deregisterMemory(handle);
+        }
+        mHandles.clear();
+    }
+
+    std::vector<runtime::ITensor::SharedPtr> mPools;
+    KVCacheMemoryRegistrar& mRegistrar;
+    std::vector<KVCacheMemoryRegistrar::Handle> mHandles;
+    KVCacheMemoryDescriptor mLocal;
+    mutable std::mutex mMutex;
+    std::unordered_map<PeerId, KVCacheMemoryDescriptor> mPeers;
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
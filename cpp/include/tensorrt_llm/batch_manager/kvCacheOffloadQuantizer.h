@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/kernels/kvCacheOffloadQuantization.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+#ifdef ENABLE_FP8
+
+// Compressed secondary pools. Offloaded blocks are stored in pinned host memory as FP8 E4M3 with one scale per layer
+// and K/V, instead of in the data type of the primary pool. The kernels read and write the host pools directly, so the
+// PCIe traffic shrinks by the same factor as the host memory footprint (2x for FP16/BF16 caches).
+//
+// Only pools holding FP16, BF16 or FP32 blocks are compressed. Block scale pools of FP4 caches are already compact and
+// are not supported.
+class KVCacheOffloadQuantizer
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using TensorPtr = runtime::ITensor::SharedPtr;
+
+    //! \brief Pair of (primary block index, secondary block index) in memory pool coordinates.
+    using BlockPair = std::pair<SizeType32, SizeType32>;
+
+    //! \param pools Pools of the block manager. Their secondary pools are not used and need not be allocated.
+    //! \param numSecondaryBlocks Number of blocks in every compressed pool.
+    KVCacheOffloadQuantizer(std::vector<KVCacheBlockPool> const& pools, SizeType32 numSecondaryBlocks)
+    {
+        for (auto const& pool : pools)
+        {
+            TLLM_CHECK_WITH_INFO(!pool.containsBlockScales, "Block scale pools cannot be quantized on offload");
+            auto const dataType = pool.primaryPtr->getDataType();
+            TLLM_CHECK_WITH_INFO(dataType == nvinfer1::DataType::kHALF || dataType == nvinfer1::DataType::kBF16
+                    || dataType == nvinfer1::DataType::kFLOAT,
+                "Quantize-on-offload requires a FP16, BF16 or FP32 KV cache");
+            // One K or V block of one layer shares a scale.
+            auto const chunkSize = static_cast<std::int64_t>(pool.blockSize);
+            auto const blockNumel
+                = static_cast<std::int64_t>(pool.primaryPtr->getSize() / pool.primaryPtr->getShape().d[0]);
+            auto const numChunks = blockNumel / chunkSize;
+            mPools.push_back(CompressedPool{pool.primaryPtr,
+                runtime::BufferManager::pinnedPool(
+                    runtime::ITensor::makeShape({numSecondaryBlocks, blockNumel}), nvinfer1::DataType::kFP8),
+                runtime::BufferManager::pinnedPool(
+                    runtime::ITensor::makeShape({numSecondaryBlocks, numChunks}), nvinfer1::DataType::kFLOAT),
+                blockNumel, chunkSize});
+        }
+    }
+
+    //! \brief Quantize primary blocks into the compressed pools.
+    void offload(std::vector<BlockPair> const& blocks, runtime::BufferManager const& bufferManager) const
+    {
+        run(blocks, bufferManager, true);
+    }
+
+    //! \brief Dequantize blocks of the compressed pools into primary blocks.
+    void onboard(std::vector<BlockPair> const& blocks, runtime::BufferManager const& bufferManager) const
+    {
+        run(blocks, bufferManager, false);
+    }
+
+    //! \brief Host memory used by the compressed pools, scales included.
+    [[nodiscard]] std::size_t getSizeInBytes() const
+    {
+        std::size_t size{0};
+        for (auto const& pool : mPools)
+        {
+            size += pool.data->getSizeInBytes() + pool.scales->getSizeInBytes();
+        }
+        return size;
+    }
+
+private:
+    struct CompressedPool
+    {
+        TensorPtr primary;
+        TensorPtr data;
+        TensorPtr scales;
+        std::int64_t blockNumel;
+        std::int64_t chunkSize;
+    };
+
+    void run(std::vector<BlockPair> const& blocks, runtime::BufferManager const& bufferManager, bool isOffload) const
+    {
+        if (blocks.empty())
+        {
+            return;
+        }
+        std::vector<std::int32_t> indices(2 * blocks.size());
+        for (std::size_t i = 0; i < blocks.size(); ++i)
+        {
+            indices[i] = blocks[i].first;
+            indices[blocks.size() + i] = blocks[i].second;
+        }
+        // Stream-ordered allocation, released once the kernels below are done with it.
+        auto const deviceIndices = bufferManager.copyFrom(indices, runtime::MemoryType::kGPU);
+        auto const* indicesPtr = runtime::bufferCast<std::int32_t>(*deviceIndices);
+        auto const stream = bufferManager.getStream().get();
+
+        for (auto const& pool : mPools)
+        {
+            kernels::KVBlockQuantizationParams const params{static_cast<std::int32_t>(blocks.size()), pool.blockNumel,
+                pool.chunkSize, indicesPtr, indicesPtr + blocks.size()};
+            auto* data = runtime::bufferCast<__nv_fp8_e4m3>(*pool.data);
+            auto* scales = runtime::bufferCast<float>(*pool.scales);
+            switch (pool.primary->getDataType())
+            {
+            case nvinfer1::DataType::kHALF:
+                dispatch<half>(params, pool.primary, data, scales, stream, isOffload);
+                break;
+#ifdef ENABLE_BF16
+            case nvinfer1::DataType::kBF16:
+                dispatch<__nv_bfloat16>(params, pool.primary, data, scales, stream, isOffload);
+                break;
+#endif // ENABLE_BF16
+            case nvinfer1::DataType::kFLOAT:
+                dispatch<float>(params, pool.primary, data, scales, stream, isOffload);
+                break;
+            default: TLLM_THROW("Unsupported KV cache data type for quantize-on-offload");
+            }
+        }
+    }
+
+    template <typename T>
+    static void dispatch(kernels::KVBlockQuantizationParams const& params, TensorPtr const& primary,
+        __nv_fp8_e4m3* data, float* scales, cudaStream_t stream, bool isOffload)
+    {
+        auto* primaryPtr = static_cast<T*>(primary->data());
+        if (isOffload)
+        {
+            kernels::invokeQuantizeKVBlocks<T>(params, primaryPtr, data, scales, stream);
+        }
+        else
+        {
+            kernels::invokeDequantizeKVBlocks<T>(params, data, scales, primaryPtr, stream);
+        }
+    }
+
+    std::vector<CompressedPool> mPools;
+};
+
+#endif // ENABLE_FP8
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/iBuffer.h"
+
+#include <NvInferRuntime.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+//! \brief Layers that share an attention window, and the pool that serves them.
+struct KVCacheLayerGroup
+{
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    SizeType32 attentionWindow;
+    //! \brief Local layer indices and their number of KV heads.
+    std::vector<SizeType32> layers;
+    std::vector<SizeType32> numKvHeadsPerLayer;
+    nvinfer1::DataType dtype;
+    SizeType32 tokensPerBlock;
+    SizeType32 numBlocks{0};
+
+    //! \brief Bytes of one block, over all layers of the group and K and V.
+    [[nodiscard]] std::size_t getBlockSizeInBytes(SizeType32 sizePerHead) const
+    {
+        std::size_t numKvHeads{0};
+        for (auto const heads : numKvHeadsPerLayer)
+        {
+            numKvHeads += heads;
+        }
+        return numKvHeads * 2 * sizePerHead * tokensPerBlock * runtime::BufferDataType(dtype).getSize();
+    }
+};
+
+//! \brief Measured number of tokens every attention window actually keeps per sequence.
+//! \details A windowed layer keeps min(window, sequence length) tokens, so the demand of short windows saturates while
+//! the one of full attention layers follows the length distribution of the traffic.
+class KVCacheLayerDemand
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    explicit KVCacheLayerDemand(std::vector<SizeType32> const& attentionWindows)
+    {
+        for (auto const window : attentionWindows)
+        {
+            mSumTokens.emplace(window, 0);
+        }
+    }
+
+    //! \brief Record a finished sequence of numTokens tokens.
+    void addSequence(SizeType32 numTokens)
+    {
+        for (auto& [window, sumTokens] : mSumTokens)
+        {
+            sumTokens += std::min(window, numTokens);
+        }
+        ++mNumSequences;
+    }
+
+    [[nodiscard]] std::int64_t getNumSequences() const noexcept
+    {
+        return mNumSequences;
+    }
+
+    //! \brief Mean number of tokens a layer with this window keeps per sequence.
+    [[nodiscard]] double getMeanTokens(SizeType32 attentionWindow) const
+    {
+        auto const it = mSumTokens.find(attentionWindow);
+        TLLM_CHECK_WITH_INFO(it != mSumTokens.end(), "Attention window %d is not tracked", attentionWindow);
+        return mNumSequences == 0 ? 0. : static_cast<double>(it->second) / static_cast<double>(mNumSequences);
+    }
+
+private:
+    std::map<SizeType32, std::int64_t> mSumTokens;
+    std::int64_t mNumSequences{0};
+};
+
+struct KVCachePoolPlannerConfig
+{
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    //! \brief Data type and block size of the layers with full attention.
+    nvinfer1::DataType dtype;
+    SizeType32 tokensPerBlock;
+    //! \brief Data type and block size of the layers with a sliding window, the ones of full attention if not set.
+    std::optional<nvinfer1::DataType> windowDtype{std::nullopt};
+    std::optional<SizeType32> windowTokensPerBlock{std::nullopt};
+};
+
+//! \brief Partition the layers by attention window and split the memory budget between the groups.
+//! \details Without measured demand, every group is sized for sequences of maxSequenceLength tokens. Window groups
+//! never get more blocks than maxNumSequences sequences can use, the remaining memory goes to the larger windows.
+//! \param maxAttentionWindowVec Attention window per layer, repeated over the layers like in the attention plugin.
+[[nodiscard]] inline std::vector<KVCacheLayerGroup> planKVCachePools(
+    std::vector<runtime::SizeType32> const& numKvHeadsPerLayer, runtime::SizeType32 sizePerHead,
+    std::vector<runtime::SizeType32> const& maxAttentionWindowVec, runtime::SizeType32 maxSequenceLength,
+    runtime::SizeType32 maxNumSequences, std::size_t memoryBudget, KVCachePoolPlannerConfig const& config,
+    std::optional<KVCacheLayerDemand> const& demand = std::nullopt)
+{
+    using SizeType32 = runtime::SizeType32;
+    TLLM_CHECK(!maxAttentionWindowVec.empty());
+
+    std::map<SizeType32, KVCacheLayerGroup> groupsByWindow;
+    for (SizeType32 layerIdx = 0; layerIdx < static_cast<SizeType32>(numKvHeadsPerLayer.size()); ++layerIdx)
+    {
+        auto const window
+            = std::min(maxAttentionWindowVec[layerIdx % maxAttentionWindowVec.size()], maxSequenceLength);
+        auto const isWindowed = window < maxSequenceLength;
+        auto [it, inserted] = groupsByWindow.try_emplace(window,
+            KVCacheLayerGroup{window, {}, {}, isWindowed ? config.windowDtype.value_or(config.dtype) : config.dtype,
+                isWindowed ? config.windowTokensPerBlock.value_or(config.tokensPerBlock) : config.tokensPerBlock});
+        it->second.layers.push_back(layerIdx);
+        it->second.numKvHeadsPerLayer.push_back(numKvHeadsPerLayer[layerIdx]);
+    }
+
+    auto const useDemand = demand.has_value() && demand->getNumSequences() > 0;
+    std::vector<KVCacheLayerGroup> groups;
+    std::vector<double> bytesPerSequence;
+    for (auto& [window, group] : groupsByWindow)
+    {
+        auto const tokens = useDemand ? std::max(demand->getMeanTokens(window), 1.) : static_cast<double>(window);
+        bytesPerSequence.push_back(tokens / group.tokensPerBlock * group.getBlockSizeInBytes(sizePerHead));
+        groups.push_back(std::move(group));
+    }
+
+    // Groups are ordered by window, so capped memory of a group flows to the larger windows after it.
+    auto remainingBudget = static_cast<double>(memoryBudget);
+    double remainingBytesPerSequence{0};
+    for (auto const bytes : bytesPerSequence)
+    {
+        remainingBytesPerSequence += bytes;
+    }
+    for (std::size_t groupIdx = 0; groupIdx < groups.size(); ++groupIdx)
+    {
+        auto& group = groups[groupIdx];
+        auto const blockSize = static_cast<double>(group.getBlockSizeInBytes(sizePerHead));
+        auto const share = remainingBudget * bytesPerSequence[groupIdx] / remainingBytesPerSequence;
+        auto numBlocks = static_cast<std::int64_t>(share / blockSize);
+        if (group.attentionWindow < maxSequenceLength)
+        {
+            // A window spans at most one more block than it covers.
+            auto const maxBlocksPerSequence
+                = (group.attentionWindow + group.tokensPerBlock - 1) / group.tokensPerBlock + 1;
+            numBlocks = std::min(numBlocks, static_cast<std::int64_t>(maxBlocksPerSequence) * maxNumSequences);
+        }
+        group.numBlocks = static_cast<SizeType32>(numBlocks);
+        remainingBudget -= static_cast<double>(numBlocks) * blockSize;
+        remainingBytesPerSequence -= bytesPerSequence[groupIdx];
+    }
+    return groups;
+}
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/kernels/kvCacheBlockCopy.h"
+#include "tensorrt_llm/kernels/kvCacheIndex.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/virtualDeviceMemory.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Online resizing of the primary pools. To shrink, the resizer allocates a ballast sequence that holds as many blocks
+// as should be given back, so that the block manager never hands them out again. Live and cached blocks whose memory
+// lies in the tail of the pools are then migrated into the memory of ballast blocks at the front
+// (swapMemoryPoolBlockOffset), after which the tail only holds ballast and can be unmapped. Growing maps the memory
+// again and releases the ballast.
+//
+// Physical memory is only given back if the primary pools are backed by runtime::VirtualDeviceMemory. For other pools,
+// resizing bounds the number of usable blocks without freeing memory.
+class KVCachePoolResizer
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using SequenceRef = std::reference_wrapper<GenerationRequest>;
+
+    //! \param backingMemory Virtual memory backing every primary pool, in pool order, or empty.
+    KVCachePoolResizer(
+        BlockManager& blockManager, std::vector<std::shared_ptr<runtime::VirtualDeviceMemory>> backingMemory = {})
+        : mBlockManager{blockManager}
+        , mBackingMemory{std::move(backingMemory)}
+    {
+        TLLM_CHECK(mBackingMemory.empty()
+            || static_cast<SizeType32>(mBackingMemory.size()) == mBlockManager.getNumPools());
+    }
+
+    //! \brief Number of primary blocks that can currently be used.
+    [[nodiscard]] SizeType32 getNumUsableBlocks() const
+    {
+        auto numUsable = mBlockManager.getNumPrimaryBlocks();
+        for (auto const& ballast : mBallasts)
+        {
+            numUsable -= static_cast<SizeType32>(ballast->getCacheBlockIds().at(0).size());
+        }
+        return numUsable;
+    }
+
+    //! \brief Resize the primary pools to numBlocks blocks. Must be called between iterations, with every sequence
+    //! that holds blocks, as their block offsets are updated when their blocks move.
+    //! \return False if the pools cannot shrink that much because too few blocks are free.
+    bool resize(SizeType32 numBlocks, std::vector<SequenceRef> const& sequences)
+    {
+        TLLM_CHECK(numBlocks > 0 && numBlocks <= mBlockManager.getNumPrimaryBlocks());
+        // Grow by releasing ballast, newest first. The last one may have to be shrunk again.
+        while (!mBallasts.empty() && getNumUsableBlocks() < numBlocks)
+        {
+            mapPools(getNumUsableBlocks() + static_cast<SizeType32>(mBallasts.back()->getCacheBlockIds().at(0).size()));
+            mBlockManager.releaseBlocks(*mBallasts.back());
+            mBallasts.pop_back();
+        }
+        auto const numUsable = getNumUsableBlocks();
+        if (numUsable == numBlocks)
+        {
+            return true;
+        }
+        if (numUsable < numBlocks)
+        {
+            // Nothing left to release.
+            return false;
+        }
+        auto const numRetired = numUsable - numBlocks;
+        if (mBlockManager.getNumFreeBlocks() < numRetired)
+        {
+            TLLM_LOG_WARNING("Cannot shrink the KV cache to %d blocks, only %d blocks are free", numBlocks,
+                mBlockManager.getNumFreeBlocks());
+            return false;
+        }
+
+        // Cached blocks are evicted as needed to fill the ballast, like for any new sequence.
+        auto const tokensPerBlock = mBlockManager.getTokensPerBlock();
+        auto ballast = std::make_unique<GenerationRequest>(
+            mNextRequestId--, numRetired * tokensPerBlock, 1, numRetired, mBlockManager.getNumPools());
+        mBlockManager.addSequence(*ballast, numRetired, numRetired);
+        migrate(*ballast, numBlocks, numUsable, sequences);
+        mBallasts.push_back(std::move(ballast));
+        mapPools(numBlocks);
+        TLLM_LOG_INFO("Resized the KV cache to %d primary blocks", numBlocks);
+        return true;
+    }
+
+private:
+    //! \brief Move the blocks at memory indices [numBlocks, numUsable) into the memory of ballast blocks below
+    //! numBlocks.
+    void migrate(GenerationRequest& ballast, SizeType32 numBlocks, SizeType32 numUsable,
+        std::vector<SequenceRef> const& sequences)
+    {
+        auto const& ballastIds = ballast.getCacheBlockIds().at(0);
+        std::unordered_set<KVCacheBlock::IdType> const ballastSet(ballastIds.begin(), ballastIds.end());
+
+        std::vector<BlockPtr> targets;
+        for (auto const blockId : ballastIds)
+        {
+            auto const& block = mBlockManager.getBlockById(blockId);
+            if (block->getMemoryPoolBlockIndex() < numBlocks)
+            {
+                targets.push_back(block);
+            }
+        }
+        std::vector<BlockPtr> sources;
+        for (KVCacheBlock::IdType blockId = 0; blockId < mBlockManager.getMaxNumBlocks(); ++blockId)
+        {
+            auto const& block = mBlockManager.getBlockById(blockId);
+            auto const memoryIdx = block->getMemoryPoolBlockIndex();
+            if (block->isPrimary() && memoryIdx >= numBlocks && memoryIdx < numUsable && ballastSet.count(blockId) == 0)
+            {
+                sources.push_back(block);
+            }
+        }
+        TLLM_CHECK(sources.size() == targets.size());
+        if (sources.empty())
+        {
+            return;
+        }
+
+        // Only the content of the migrated blocks matters, the ballast content is garbage.
+        std::vector<kernels::KVBlockCopyDesc> copies;
+        std::int64_t maxNumBytes{0};
+        for (SizeType32 poolIdx = 0; poolIdx < mBlockManager.getNumPools(); ++poolIdx)
+        {
+            auto const pool = mBlockManager.getPrimaryPool(poolIdx);
+            auto const blockSizeInBytes = static_cast<std::int64_t>(pool->getSizeInBytes() / pool->getShape().d[0]);
+            auto* base = static_cast<std::uint8_t*>(pool->data());
+            for (std::size_t i = 0; i < sources.size(); ++i)
+            {
+                copies.push_back({base + sources[i]->getMemoryPoolBlockIndex() * blockSizeInBytes,
+                    base + targets[i]->getMemoryPoolBlockIndex() * blockSizeInBytes, blockSizeInBytes});
+            }
+            maxNumBytes = std::max(maxNumBytes, blockSizeInBytes);
+        }
+        auto const& bufferManager = mBlockManager.getBufferManager();
+        auto const deviceCopies
+            = bufferManager.gpu(copies.size() * sizeof(kernels::KVBlockCopyDesc), nvinfer1::DataType::kUINT8);
+        bufferManager.copy(copies.data(), *deviceCopies, runtime::MemoryType::kCPU);
+        kernels::invokeBatchedBlockCopy(static_cast<kernels::KVBlockCopyDesc const*>(deviceCopies->data()),
+            static_cast<std::int32_t>(copies.size()), maxNumBytes, bufferManager.getStream().get());
+
+        std::unordered_map<KVCacheBlock::IdType, KVCacheBlock::IdType> moved;
+        for (std::size_t i = 0; i < sources.size(); ++i)
+        {
+            sources[i]->swapMemoryPoolBlockOffset(targets[i]);
+            moved.emplace(sources[i]->getBlockId(), targets[i]->getBlockId());
+        }
+        for (auto const& sequence : sequences)
+        {
+            updateOffsets(sequence.get(), moved);
+        }
+        updateOffsets(ballast, moved);
+        // The tail is unmapped after this.
+        bufferManager.getStream().synchronize();
+        TLLM_LOG_DEBUG("Migrated %zu KV cache blocks", sources.size());
+    }
+
+    //! \brief Rewrite the cached block offsets of sequence for the blocks that moved, the same way
+    //! BlockManager::setOffsets computes them.
+    void updateOffsets(GenerationRequest& sequence,
+        std::unordered_map<KVCacheBlock::IdType, KVCacheBlock::IdType> const& moved) const
+    {
+        auto& offsets = sequence.getCacheBlockIndices();
+        auto const& offsetsShape = offsets.getShape();
+        auto* offsetsPtr = runtime::bufferCast<kernels::KVCacheIndex>(offsets);
+        auto const& cacheBlockIds = sequence.getCacheBlockIds();
+        for (SizeType32 beamIdx = 0; beamIdx < static_cast<SizeType32>(cacheBlockIds.size()); ++beamIdx)
+        {
+            auto const& blockIds = cacheBlockIds[beamIdx];
+            for (SizeType32 blockIdx = 0; blockIdx < static_cast<SizeType32>(blockIds.size()); ++blockIdx)
+            {
+                auto const blockId = blockIds[blockIdx];
+                bool const isMoved = moved.count(blockId) != 0 || std::any_of(moved.begin(), moved.end(),
+                    [blockId](auto const& entry) { return entry.second == blockId; });
+                if (!isMoved)
+                {
+                    continue;
+                }
+                auto const& block = mBlockManager.getBlockById(blockId);
+                for (SizeType32 poolIdx = 0; poolIdx < mBlockManager.getNumPools(); ++poolIdx)
+                {
+                    // Pools have shape [numBlocks, numLayers, kvFactor, blockSize].
+                    auto const& poolShape = mBlockManager.getPrimaryPool(poolIdx)->getShape();
+                    auto const numLayers = poolShape.d[1];
+                    auto const kvFactor = poolShape.d[2];
+                    for (SizeType32 xIdx = 0; xIdx < 2; ++xIdx)
+                    {
+                        auto const fieldIdx = kvFactor == 1 ? 0 : xIdx;
+                        auto const offsetIndex
+                            = ((poolIdx * offsetsShape.d[1] + beamIdx) * offsetsShape.d[2] + xIdx) * offsetsShape.d[3]
+                            + blockIdx;
+                        offsetsPtr[offsetIndex] = kernels::KVCacheIndex{
+                            static_cast<kernels::KVCacheIndex::UnderlyingType>(
+                                block->getMemoryPoolBlockIndex() * numLayers * kvFactor + fieldIdx),
+                            !block->isPrimary()};
+                    }
+                }
+            }
+        }
+    }
+
+    void mapPools(SizeType32 numBlocks)
+    {
+        for (SizeType32 poolIdx = 0; poolIdx < static_cast<SizeType32>(mBackingMemory.size()); ++poolIdx)
+        {
+            auto const pool = mBlockManager.getPrimaryPool(poolIdx);
+            TLLM_CHECK(pool->data() == mBackingMemory[poolIdx]->data());
+            mBackingMemory[poolIdx]->resize(pool->getSizeInBytes() / pool->getShape().d[0] * numBlocks);
+        }
+    }
+
+    BlockManager& mBlockManager;
+    std::vector<std::shared_ptr<runtime::VirtualDeviceMemory>> mBackingMemory;
+    // Sequences holding the retired blocks, in the order they were created.
+    std::vector<std::unique_ptr<GenerationRequest>> mBallasts;
+    // Ids of the ballast sequences, counting down from a quarter of the range.
+    LlmRequest::RequestIdType mNextRequestId{std::numeric_limits<LlmRequest::RequestIdType>::max() / 4};
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
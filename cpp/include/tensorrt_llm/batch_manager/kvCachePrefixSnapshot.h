@@ -0,0 +1,512 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/memoryMappedFile.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/samplingConfig.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Persistent prefix cache. The reuse tree of committed blocks is tracked incrementally from the stored/removed event
+// stream of the KVCacheEventManager (KVCachePrefixJournal). On shutdown, the tree is written to a snapshot file
+// together with the content of every block (writePrefixSnapshot). On startup the snapshot is memory-mapped and its
+// blocks are loaded back into the pools and registered for reuse (KVCachePrefixSnapshot::warm), so that the first
+// requests after a restart hit the cache instead of recomputing long system prompts.
+//
+// Snapshot layout:
+//     PrefixSnapshotHeader
+//     std::uint64_t blockSizeInBytes[numPools]
+//     numBlocks x (PrefixSnapshotRecord, UniqueToken[numTokens])   parents always precede their children
+//     padding up to dataOffset (page aligned)
+//     numBlocks x slot                                             a slot holds the block of every pool back to back
+
+//! \brief Reuse tree of committed blocks, rebuilt from KV cache events.
+class KVCachePrefixJournal
+{
+public:
+    using IdType = executor::IdType;
+
+    struct Entry
+    {
+        std::optional<IdType> parentHash;
+        VecUniqueTokens tokens;
+        LoraTaskIdType loraId;
+        std::vector<IdType> children;
+    };
+
+    //! \brief Update the tree with a batch of events, e.g. from BaseKVCacheManager::getLatestEvents.
+    void apply(std::deque<executor::KVCacheEvent> const& events)
+    {
+        for (auto const& event : events)
+        {
+            if (auto const* stored = std::get_if<executor::KVCacheStoredData>(&event.data))
+            {
+                auto parentHash = stored->parentHash;
+                for (auto const& block : stored->blocks)
+                {
+                    add(block.blockHash, parentHash, block.tokens, block.loraId);
+                    parentHash = block.blockHash;
+                }
+            }
+            else if (auto const* removed = std::get_if<executor::KVCacheRemovedData>(&event.data))
+            {
+                for (auto const hash : removed->blockHashes)
+                {
+                    remove(hash);
+                }
+            }
+            else if (std::holds_alternative<executor::KVCacheCreatedData>(event.data))
+            {
+                // A new cache manager starts with an empty tree.
+                mEntries.clear();
+            }
+        }
+    }
+
+    [[nodiscard]] std::unordered_map<IdType, Entry> const& getEntries() const
+    {
+        return mEntries;
+    }
+
+    //! \brief Hashes of all blocks reachable from a root, parents before children.
+    [[nodiscard]] std::vector<IdType> getTopologicalOrder() const
+    {
+        std::vector<IdType> order;
+        order.reserve(mEntries.size());
+        for (auto const& [hash, entry] : mEntries)
+        {
+            if (!entry.parentHash.has_value())
+            {
+                order.push_back(hash);
+            }
+        }
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            auto const& children = mEntries.at(order[i]).children;
+            order.insert(order.end(), children.begin(), children.end());
+        }
+        return order;
+    }
+
+private:
+    void add(IdType hash, std::optional<IdType> parentHash, VecUniqueTokens const& tokens, LoraTaskIdType loraId)
+    {
+        if (mEntries.find(hash) != mEntries.end())
+        {
+            return;
+        }
+        if (parentHash.has_value())
+        {
+            auto const parentIt = mEntries.find(*parentHash);
+            if (parentIt == mEntries.end())
+            {
+                // The parent was stored before the journal was started, the block cannot be reached from a root.
+                return;
+            }
+            parentIt->second.children.push_back(hash);
+        }
+        mEntries.emplace(hash, Entry{parentHash, tokens, loraId, {}});
+    }
+
+    void remove(IdType hash)
+    {
+        auto const it = mEntries.find(hash);
+        if (it == mEntries.end())
+        {
+            return;
+        }
+        if (it->second.parentHash.has_value())
+        {
+            if (auto const parentIt = mEntries.find(*it->second.parentHash); parentIt != mEntries.end())
+            {
+                auto& siblings = parentIt->second.children;
+                siblings.erase(std::remove(siblings.begin(), siblings.end(), hash), siblings.end());
+            }
+        }
+        // Descendants are no longer reachable once their ancestor is gone.
+        std::vector<IdType> stack{hash};
+        while (!stack.empty())
+        {
+            auto const current = stack.back();
+            stack.pop_back();
+            auto const currentIt = mEntries.find(current);
+            if (currentIt == mEntries.end())
+            {
+                continue;
+            }
+            stack.insert(stack.end(), currentIt->second.children.begin(), currentIt->second.children.end());
+            mEntries.erase(currentIt);
+        }
+    }
+
+    std::unordered_map<IdType, Entry> mEntries;
+};
+
+namespace detail
+{
+inline constexpr char kPrefixSnapshotMagic[8] = {'T', 'L', 'L', 'M', 'K', 'V', 'P', 'S'};
+inline constexpr std::uint32_t kPrefixSnapshotVersion = 1;
+inline constexpr std::uint64_t kNoParent = std::numeric_limits<std::uint64_t>::max();
+inline constexpr std::size_t kPrefixSnapshotAlignment = 4096;
+
+static_assert(std::is_trivially_copyable_v<UniqueToken>);
+
+struct PrefixSnapshotHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t tokensPerBlock;
+    std::uint32_t numPools;
+    std::uint32_t reserved;
+    std::uint64_t numBlocks;
+    std::uint64_t dataOffset;
+    std::uint64_t slotSize;
+};
+
+struct PrefixSnapshotRecord
+{
+    std::uint64_t hash;
+    // Index of the parent record, kNoParent for roots.
+    std::uint64_t parentIdx;
+    std::uint64_t loraId;
+    std::uint32_t numTokens;
+    std::uint32_t reserved;
+};
+
+inline std::vector<std::uint64_t> getBlockSizesInBytes(BlockManager const& blockManager)
+{
+    std::vector<std::uint64_t> sizes;
+    for (SizeType32 poolIdx = 0; poolIdx < blockManager.getNumPools(); ++poolIdx)
+    {
+        auto const pool = blockManager.getPrimaryPool(poolIdx);
+        sizes.push_back(pool->getSizeInBytes() / pool->getShape().d[0]);
+    }
+    return sizes;
+}
+
+//! \brief Allocate the blocks of tokens in blockManager, fill the ones that could not be reused with contents and store
+//! them for reuse. contents holds one host pointer per full block of tokens, with the block of every pool back to back.
+//! The copies are enqueued on the stream of the buffer manager.
+//! \return Number of blocks filled from contents.
+inline SizeType32 storeBlocksForReuse(BlockManager& blockManager, LlmRequest::RequestIdType requestId,
+    VecTokens tokens, LoraTaskIdType loraId, std::vector<std::uint8_t const*> const& contents,
+    std::vector<std::uint64_t> const& blockSizes)
+{
+    auto const numTokens = static_cast<SizeType32>(tokens.size());
+    auto const numBlocks = static_cast<SizeType32>(contents.size());
+    TLLM_CHECK(numTokens == numBlocks * blockManager.getTokensPerBlock());
+    LlmRequest llmRequest(
+        requestId, 1, std::make_shared<VecTokens>(std::move(tokens)), runtime::SamplingConfig{1}, false);
+    if (loraId != 0)
+    {
+        llmRequest.setLoraTaskId(loraId);
+    }
+    GenerationRequest sequence(requestId, numTokens, 1, numBlocks, blockManager.getNumPools());
+
+    blockManager.addSequence(sequence, numTokens, numBlocks, llmRequest);
+    // Blocks matched by the reuse lookup already hold the right content.
+    auto const firstNewBlock = llmRequest.getPrepopulatedPromptLen() / blockManager.getTokensPerBlock();
+    auto const& blockIds = sequence.getCacheBlockIds().at(0);
+    auto const& bufferManager = blockManager.getBufferManager();
+    for (SizeType32 i = firstNewBlock; i < numBlocks; ++i)
+    {
+        auto const& block = blockManager.getBlockById(blockIds.at(i));
+        auto const* src = contents[i];
+        for (SizeType32 poolIdx = 0; poolIdx < blockManager.getNumPools(); ++poolIdx)
+        {
+            auto dst
+                = runtime::ITensor::slice(blockManager.getPrimaryPool(poolIdx), block->getMemoryPoolBlockIndex(), 1);
+            bufferManager.copy(src, *dst, runtime::MemoryType::kCPU);
+            src += blockSizes[poolIdx];
+        }
+    }
+    blockManager.releaseBlocks(sequence, llmRequest);
+    return numBlocks - firstNewBlock;
+}
+} // namespace detail
+
+//! \brief Write the blocks of journal that are still cached in blockManager to a snapshot file.
+//! \return Number of blocks written.
+inline std::size_t writePrefixSnapshot(
+    std::string const& path, KVCachePrefixJournal const& journal, BlockManager const& blockManager)
+{
+    using namespace detail;
+
+    // Resolve every reachable entry to its cached block. Entries whose parent was skipped are skipped as well.
+    struct Resolved
+    {
+        KVCachePrefixJournal::IdType hash;
+        std::uint64_t parentIdx;
+        BlockPtr block;
+    };
+
+    std::vector<Resolved> resolved;
+    std::unordered_map<KVCachePrefixJournal::IdType, std::uint64_t> indexByHash;
+    auto const& entries = journal.getEntries();
+    std::size_t metadataSize{0};
+    for (auto const hash : journal.getTopologicalOrder())
+    {
+        auto const& entry = entries.at(hash);
+        auto parentIdx = kNoParent;
+        if (entry.parentHash.has_value())
+        {
+            auto const parentIt = indexByHash.find(*entry.parentHash);
+            if (parentIt == indexByHash.end())
+            {
+                continue;
+            }
+            parentIdx = parentIt->second;
+        }
+        BlockPtr block;
+        auto const [begin, end] = blockManager.getBlocksByHash(hash);
+        for (auto it = begin; it != end; ++it)
+        {
+            if (it->second->getUniqueTokens() == entry.tokens)
+            {
+                block = it->second;
+                break;
+            }
+        }
+        if (!block)
+        {
+            continue;
+        }
+        indexByHash.emplace(hash, resolved.size());
+        resolved.push_back({hash, parentIdx, std::move(block)});
+        metadataSize += sizeof(PrefixSnapshotRecord) + entry.tokens.size() * sizeof(UniqueToken);
+    }
+
+    auto const blockSizes = getBlockSizesInBytes(blockManager);
+    std::uint64_t slotSize{0};
+    for (auto const size : blockSizes)
+    {
+        slotSize += size;
+    }
+    auto const headerSize = sizeof(PrefixSnapshotHeader) + blockSizes.size() * sizeof(std::uint64_t);
+    auto const dataOffset
+        = common::ceilDiv(headerSize + metadataSize, kPrefixSnapshotAlignment) * kPrefixSnapshotAlignment;
+    common::MemoryMappedFile file(
+        path, common::MemoryMappedFile::Mode::kCREATE, dataOffset + resolved.size() * slotSize);
+    auto* ptr = file.data();
+
+    PrefixSnapshotHeader header{};
+    std::memcpy(header.magic, kPrefixSnapshotMagic, sizeof(header.magic));
+    header.version = kPrefixSnapshotVersion;
+    header.tokensPerBlock = static_cast<std::uint32_t>(blockManager.getTokensPerBlock());
+    header.numPools = static_cast<std::uint32_t>(blockSizes.size());
+    header.numBlocks = resolved.size();
+    header.dataOffset = dataOffset;
+    header.slotSize = slotSize;
+    std::memcpy(ptr, &header, sizeof(header));
+    ptr += sizeof(header);
+    std::memcpy(ptr, blockSizes.data(), blockSizes.size() * sizeof(std::uint64_t));
+    ptr += blockSizes.size() * sizeof(std::uint64_t);
+
+    auto const& bufferManager = blockManager.getBufferManager();
+    for (std::size_t i = 0; i < resolved.size(); ++i)
+    {
+        auto const& [hash, parentIdx, block] = resolved[i];
+        auto const& entry = entries.at(hash);
+        PrefixSnapshotRecord const record{
+            hash, parentIdx, entry.loraId, static_cast<std::uint32_t>(entry.tokens.size()), 0};
+        std::memcpy(ptr, &record, sizeof(record));
+        ptr += sizeof(record);
+        std::memcpy(ptr, entry.tokens.data(), entry.tokens.size() * sizeof(UniqueToken));
+        ptr += entry.tokens.size() * sizeof(UniqueToken);
+
+        auto* slot = file.data() + dataOffset + i * slotSize;
+        for (SizeType32 poolIdx = 0; poolIdx < blockManager.getNumPools(); ++poolIdx)
+        {
+            auto const pool
+                = block->isPrimary() ? blockManager.getPrimaryPool(poolIdx) : blockManager.getSecondaryPool(poolIdx);
+            auto const src = runtime::ITensor::slice(pool, block->getMemoryPoolBlockIndex(), 1);
+            bufferManager.copy(*src, slot, runtime::MemoryType::kCPU);
+            slot += blockSizes[poolIdx];
+        }
+    }
+    bufferManager.getStream().synchronize();
+    file.flush();
+    TLLM_LOG_INFO("Wrote %zu KV cache blocks to prefix snapshot %s", resolved.size(), path.c_str());
+    return resolved.size();
+}
+
+//! \brief Memory-mapped snapshot written by writePrefixSnapshot.
+class KVCachePrefixSnapshot
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    struct Block
+    {
+        std::uint64_t hash;
+        std::optional<std::size_t> parentIdx;
+        LoraTaskIdType loraId;
+        UniqueToken const* tokens;
+        std::size_t numTokens;
+        std::uint8_t const* contents;
+    };
+
+    explicit KVCachePrefixSnapshot(std::string const& path)
+        : mFile{path, common::MemoryMappedFile::Mode::kREAD_ONLY}
+    {
+        using namespace detail;
+        TLLM_CHECK_WITH_INFO(mFile.size() >= sizeof(PrefixSnapshotHeader), "%s is not a prefix snapshot", path.c_str());
+        std::memcpy(&mHeader, mFile.data(), sizeof(mHeader));
+        TLLM_CHECK_WITH_INFO(std::memcmp(mHeader.magic, kPrefixSnapshotMagic, sizeof(mHeader.magic)) == 0
+                && mHeader.version == kPrefixSnapshotVersion,
+            "%s is not a prefix snapshot of version %u", path.c_str(), kPrefixSnapshotVersion);
+        TLLM_CHECK_WITH_INFO(mHeader.dataOffset + mHeader.numBlocks * mHeader.slotSize <= mFile.size(),
+            "Prefix snapshot %s is truncated", path.c_str());
+
+        auto const* ptr = mFile.data() + sizeof(PrefixSnapshotHeader);
+        mBlockSizes.resize(mHeader.numPools);
+        std::memcpy(mBlockSizes.data(), ptr, mHeader.numPools * sizeof(std::uint64_t));
+        ptr += mHeader.numPools * sizeof(std::uint64_t);
+
+        auto const* const metadataEnd = mFile.data() + mHeader.dataOffset;
+        mBlocks.reserve(mHeader.numBlocks);
+        for (std::uint64_t i = 0; i < mHeader.numBlocks; ++i)
+        {
+            PrefixSnapshotRecord record{};
+            TLLM_CHECK(ptr + sizeof(record) <= metadataEnd);
+            std::memcpy(&record, ptr, sizeof(record));
+            ptr += sizeof(record);
+            TLLM_CHECK(ptr + record.numTokens * sizeof(UniqueToken) <= metadataEnd);
+            TLLM_CHECK_WITH_INFO(record.parentIdx == kNoParent || record.parentIdx < i,
+                "Prefix snapshot %s is corrupted", path.c_str());
+            mBlocks.push_back(Block{record.hash,
+                record.parentIdx == kNoParent ? std::nullopt : std::optional<std::size_t>{record.parentIdx},
+                static_cast<LoraTaskIdType>(record.loraId), reinterpret_cast<UniqueToken const*>(ptr), record.numTokens,
+                mFile.data() + mHeader.dataOffset + i * mHeader.slotSize});
+            ptr += record.numTokens * sizeof(UniqueToken);
+        }
+        // The contents are read once, sequentially per block.
+        mFile.advise(common::MemoryMappedFile::Advice::kWILL_NEED, mHeader.dataOffset);
+    }
+
+    [[nodiscard]] std::vector<Block> const& getBlocks() const
+    {
+        return mBlocks;
+    }
+
+    [[nodiscard]] SizeType32 getTokensPerBlock() const
+    {
+        return static_cast<SizeType32>(mHeader.tokensPerBlock);
+    }
+
+    //! \brief Load the blocks into blockManager and store them for reuse, longest prefixes first until maxNumBlocks
+    //! blocks are loaded.
+    //! \return Number of loaded blocks.
+    SizeType32 warm(BlockManager& blockManager, std::optional<SizeType32> maxNumBlocks = std::nullopt) const
+    {
+        if (blockManager.getTokensPerBlock() != getTokensPerBlock()
+            || detail::getBlockSizesInBytes(blockManager) != mBlockSizes)
+        {
+            TLLM_LOG_WARNING("Prefix snapshot does not match the KV cache layout, it is ignored");
+            return 0;
+        }
+        auto const budget = maxNumBlocks.value_or(blockManager.getNumPrimaryBlocks());
+
+        std::vector<bool> isLeaf(mBlocks.size(), true);
+        for (auto const& block : mBlocks)
+        {
+            if (block.parentIdx.has_value())
+            {
+                isLeaf[*block.parentIdx] = false;
+            }
+        }
+
+        auto requestId = std::numeric_limits<LlmRequest::RequestIdType>::max();
+        SizeType32 numLoaded{0};
+        for (std::size_t leafIdx = 0; leafIdx < mBlocks.size() && numLoaded < budget; ++leafIdx)
+        {
+            if (!isLeaf[leafIdx])
+            {
+                continue;
+            }
+            auto const chain = getChain(leafIdx);
+            VecTokens tokens;
+            bool hasExtraIds{false};
+            for (auto const idx : chain)
+            {
+                auto const& block = mBlocks[idx];
+                for (std::size_t i = 0; i < block.numTokens; ++i)
+                {
+                    hasExtraIds |= block.tokens[i].tokenExtraId != 0;
+                    tokens.push_back(block.tokens[i].tokenId);
+                }
+            }
+            if (hasExtraIds)
+            {
+                // Requests with extra token ids (e.g. multimodal) cannot be rebuilt from token ids alone.
+                continue;
+            }
+
+            std::vector<std::uint8_t const*> contents;
+            for (auto const idx : chain)
+            {
+                contents.push_back(mBlocks[idx].contents);
+            }
+            numLoaded += detail::storeBlocksForReuse(
+                blockManager, requestId--, std::move(tokens), mBlocks[chain.front()].loraId, contents, mBlockSizes);
+        }
+        blockManager.getBufferManager().getStream().synchronize();
+        TLLM_LOG_INFO("Loaded %d KV cache blocks from prefix snapshot", numLoaded);
+        return numLoaded;
+    }
+
+private:
+    //! \brief Indices of the blocks from the root to leafIdx.
+    [[nodiscard]] std::vector<std::size_t> getChain(std::size_t leafIdx) const
+    {
+        std::vector<std::size_t> chain;
+        for (std::optional<std::size_t> idx = leafIdx; idx.has_value(); idx = mBlocks[*idx].parentIdx)
+        {
+            chain.push_back(*idx);
+        }
+        std::reverse(chain.begin(), chain.end());
+        return chain;
+    }
+
+    common::MemoryMappedFile mFile;
+    detail::PrefixSnapshotHeader mHeader{};
+    std::vector<std::uint64_t> mBlockSizes;
+    std::vector<Block> mBlocks;
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
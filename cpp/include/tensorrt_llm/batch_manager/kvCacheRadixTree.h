@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/common/assert.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Compressed radix tree over the unique tokens of cached sequences. It replaces the per-block walk over
+// KVCacheBlock::getNextBlocks / BlockKeyHasher when looking for the longest reusable prefix: a lookup is a single
+// traversal whose cost is proportional to the length of the matched prefix, independently of how many blocks are
+// cached.
+//
+// Edges are labelled with runs of tokens. The tree is split at every block boundary that holds a block, so that every
+// cached block is attached to the node ending at its last token. Partially filled blocks are attached to a node in the
+// middle of a block. There is one tree per LoRA task; extra token ids (multimodal keys) are part of the token when
+// usesExtraIds is set.
+class KVCacheRadixTree
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using BlockIdType = KVCacheBlock::IdType;
+
+    //! \brief Result of a prefix lookup.
+    struct PrefixMatch
+    {
+        //! \brief Matched blocks in sequence order. All but the last one are fully matched.
+        std::vector<BlockIdType> blocks;
+        //! \brief Number of leading tokens of the query covered by blocks.
+        SizeType32 numMatchedTokens{0};
+
+        //! \brief Number of matched tokens in the last block. Equals tokensPerBlock for a full match.
+        [[nodiscard]] SizeType32 getNumMatchedTokensInLastBlock(SizeType32 tokensPerBlock) const
+        {
+            return blocks.empty() ? 0 : numMatchedTokens - static_cast<SizeType32>(blocks.size() - 1) * tokensPerBlock;
+        }
+
+        //! \brief Whether the last block is only partially matched and must be copied before it is written to.
+        [[nodiscard]] bool isLastBlockPartial(SizeType32 tokensPerBlock) const
+        {
+            return !blocks.empty() && getNumMatchedTokensInLastBlock(tokensPerBlock) < tokensPerBlock;
+        }
+    };
+
+    explicit KVCacheRadixTree(SizeType32 tokensPerBlock, bool usesExtraIds = false)
+        : mTokensPerBlock{tokensPerBlock}
+        , mUsesExtraIds{usesExtraIds}
+    {
+        TLLM_CHECK_WITH_INFO(tokensPerBlock > 0, "tokensPerBlock must be positive");
+    }
+
+    //! \brief Add the blocks of a sequence. Block i holds tokens [i * tokensPerBlock, (i + 1) * tokensPerBlock), the
+    //! last block may be partially filled. Blocks already cached for the same tokens are kept.
+    //! \return Number of blocks that were added.
+    SizeType32 insert(std::optional<LoraTaskIdType> loraTaskId, VecUniqueTokens const& uniqueTokens,
+        std::vector<BlockIdType> const& blockIds)
+    {
+        auto const numTokens = std::min(
+            static_cast<SizeType32>(uniqueTokens.size()), static_cast<SizeType32>(blockIds.size()) * mTokensPerBlock);
+        auto* node = &getRoot(loraTaskId);
+        SizeType32 numInserted{0};
+        for (SizeType32 pos = 0, blockIdx = 0; pos < numTokens; ++blockIdx)
+        {
+            auto const end = std::min(pos + mTokensPerBlock, numTokens);
+            node = descend(*node, uniqueTokens, pos, end);
+            pos = end;
+            if (!node->blockId)
+            {
+                auto const blockId = blockIds[blockIdx];
+                TLLM_CHECK_WITH_INFO(mNodeByBlock.find(blockId) == mNodeByBlock.end(),
+                    "Block %d is already cached for a different prefix", blockId);
+                node->blockId = blockId;
+                mNodeByBlock.emplace(blockId, node);
+                ++numInserted;
+            }
+        }
+        return numInserted;
+    }
+
+    //! \brief Find the longest cached prefix of uniqueTokens. The last matched block can be partially matched, either
+    //! because the cached block is not full or because the query diverges inside it.
+    [[nodiscard]] PrefixMatch findLongestPrefix(
+        std::optional<LoraTaskIdType> loraTaskId, VecUniqueTokens const& uniqueTokens) const
+    {
+        PrefixMatch match;
+        auto const rootIt = mRoots.find(toRootKey(loraTaskId));
+        if (rootIt == mRoots.end())
+        {
+            return match;
+        }
+
+        auto const numTokens = static_cast<SizeType32>(uniqueTokens.size());
+        Node const* node = rootIt->second.get();
+        // Node whose edge contains the divergence point, when the query stops in the middle of an edge.
+        Node const* divergenceNode = node;
+        SizeType32 depth{0};
+        while (depth < numTokens)
+        {
+            auto const childIt = node->children.find(normalize(uniqueTokens[depth]));
+            if (childIt == node->children.end())
+            {
+                divergenceNode = node;
+                break;
+            }
+            Node const* child = childIt->second.get();
+            auto const& edge = child->edge;
+            SizeType32 offset{0};
+            while (offset < static_cast<SizeType32>(edge.size()) && depth < numTokens
+                && edge[offset] == normalize(uniqueTokens[depth]))
+            {
+                ++offset;
+                ++depth;
+            }
+            divergenceNode = child;
+            if (offset < static_cast<SizeType32>(edge.size()))
+            {
+                break;
+            }
+            if (!appendBlock(match, *child))
+            {
+                return match;
+            }
+            node = child;
+        }
+
+        // Blocks on the path only cover the prefix up to the last node. If the query continues past it within the
+        // next block, any block below the divergence point covering that block holds the matched tokens as well.
+        if (depth > match.numMatchedTokens)
+        {
+            auto const blockIdx = (depth - 1) / mTokensPerBlock;
+            auto const chainBlockIdx = static_cast<SizeType32>(match.blocks.size())
+                - (match.numMatchedTokens % mTokensPerBlock != 0 ? 1 : 0);
+            if (blockIdx == chainBlockIdx)
+            {
+                if (auto const blockId = findBlockBelow(*divergenceNode, blockIdx, depth))
+                {
+                    if (blockIdx == static_cast<SizeType32>(match.blocks.size()))
+                    {
+                        match.blocks.push_back(*blockId);
+                    }
+                    else
+                    {
+                        match.blocks.back() = *blockId;
+                    }
+                    match.numMatchedTokens = depth;
+                }
+            }
+        }
+        return match;
+    }
+
+    //! \brief Remove a block, e.g. when it is evicted. Blocks below it stay cached but are no longer reachable for
+    //! reuse until the block is inserted again.
+    //! \return Whether the block was cached.
+    bool remove(BlockIdType blockId)
+    {
+        auto const it = mNodeByBlock.find(blockId);
+        if (it == mNodeByBlock.end())
+        {
+            return false;
+        }
+        auto* node = it->second;
+        mNodeByBlock.erase(it);
+        node->blockId.reset();
+        compact(node);
+        return true;
+    }
+
+    [[nodiscard]] bool contains(BlockIdType blockId) const
+    {
+        return mNodeByBlock.find(blockId) != mNodeByBlock.end();
+    }
+
+    [[nodiscard]] SizeType32 getNumBlocks() const
+    {
+        return static_cast<SizeType32>(mNodeByBlock.size());
+    }
+
+    [[nodiscard]] SizeType32 getNumNodes() const
+    {
+        return mNumNodes;
+    }
+
+    [[nodiscard]] SizeType32 getTokensPerBlock() const
+    {
+        return mTokensPerBlock;
+    }
+
+    void clear()
+    {
+        mRoots.clear();
+        mNodeByBlock.clear();
+        mNumNodes = 0;
+    }
+
+private:
+    struct UniqueTokenHasher
+    {
+        std::size_t operator()(UniqueToken const& token) const noexcept
+        {
+            auto seed = static_cast<std::uint64_t>(static_cast<std::uint32_t>(token.tokenId));
+            seed ^= static_cast<std::uint64_t>(token.tokenExtraId) * UINT64_C(0x9e3779b97f4a7c15);
+            seed = (seed ^ (seed >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+            seed = (seed ^ (seed >> 27)) * UINT64_C(0x94d049bb133111eb);
+            return static_cast<std::size_t>(seed ^ (seed >> 31));
+        }
+    };
+
+    struct Node
+    {
+        // Tokens on the edge from the parent to this node.
+        VecUniqueTokens edge;
+        // Number of tokens from the root to the end of this node.
+        SizeType32 depth{0};
+        // Block ending at the last token of this node, if any.
+        std::optional<BlockIdType> blockId;
+        Node* parent{nullptr};
+        std::unordered_map<UniqueToken, std::unique_ptr<Node>, UniqueTokenHasher> children;
+    };
+
+    using RootKey = std::pair<bool, LoraTaskIdType>;
+
+    [[nodiscard]] static RootKey toRootKey(std::optional<LoraTaskIdType> loraTaskId)
+    {
+        return {loraTaskId.has_value(), loraTaskId.value_or(0)};
+    }
+
+    [[nodiscard]] UniqueToken normalize(UniqueToken const& token) const
+    {
+        return mUsesExtraIds ? token : UniqueToken{token.tokenId, 0};
+    }
+
+    Node& getRoot(std::optional<LoraTaskIdType> loraTaskId)
+    {
+        auto& root = mRoots[toRootKey(loraTaskId)];
+        if (!root)
+        {
+            root = std::make_unique<Node>();
+        }
+        return *root;
+    }
+
+    //! \brief Walk from node along tokens [begin, end), creating and splitting nodes as needed, and return the node
+    //! ending exactly at end.
+    Node* descend(Node& start, VecUniqueTokens const& uniqueTokens, SizeType32 begin, SizeType32 end)
+    {
+        auto* node = &start;
+        auto pos = begin;
+        while (pos < end)
+        {
+            auto const first = normalize(uniqueTokens[pos]);
+            auto childIt = node->children.find(first);
+            if (childIt == node->children.end())
+            {
+                auto child = std::make_unique<Node>();
+                child->edge.reserve(end - pos);
+                for (auto i = pos; i < end; ++i)
+                {
+                    child->edge.push_back(normalize(uniqueTokens[i]));
+                }
+                child->depth = end;
+                child->parent = node;
+                auto* result = child.get();
+                node->children.emplace(first, std::move(child));
+                ++mNumNodes;
+                return result;
+            }
+
+            auto* child = childIt->second.get();
+            auto const edgeLength = static_cast<SizeType32>(child->edge.size());
+            SizeType32 common{1};
+            while (common < edgeLength && pos + common < end
+                && child->edge[common] == normalize(uniqueTokens[pos + common]))
+            {
+                ++common;
+            }
+            if (common < edgeLength)
+            {
+                child = split(*node, childIt->second, common);
+            }
+            node = child;
+            pos += common;
+        }
+        return node;
+    }
+
+    //! \brief Split the edge to child after offset tokens and return the new intermediate node.
+    Node* split(Node& parent, std::unique_ptr<Node>& child, SizeType32 offset)
+    {
+        auto middle = std::make_unique<Node>();
+        middle->edge.assign(child->edge.begin(), child->edge.begin() + offset);
+        middle->depth = child->depth - static_cast<SizeType32>(child->edge.size()) + offset;
+        middle->parent = &parent;
+        child->edge.erase(child->edge.begin(), child->edge.begin() + offset);
+        child->parent = middle.get();
+        auto const childFirst = child->edge.front();
+        middle->children.emplace(childFirst, std::move(child));
+        child = std::move(middle);
+        ++mNumNodes;
+        return child.get();
+    }
+
+    //! \brief Extend the contiguous chain of blocks in match with the block of node.
+    //! \return False if the chain is broken, i.e. a block boundary was crossed without a block.
+    bool appendBlock(PrefixMatch& match, Node const& node) const
+    {
+        auto const chainEnd = match.numMatchedTokens;
+        if (!node.blockId)
+        {
+            // Nodes without a block are fine as long as they do not pass the end of the block being matched.
+            return node.depth <= (chainEnd / mTokensPerBlock + 1) * mTokensPerBlock;
+        }
+        auto const blockIdx = (node.depth - 1) / mTokensPerBlock;
+        if (blockIdx == static_cast<SizeType32>(match.blocks.size()) && chainEnd == blockIdx * mTokensPerBlock)
+        {
+            match.blocks.push_back(*node.blockId);
+        }
+        else if (blockIdx + 1 == static_cast<SizeType32>(match.blocks.size()))
+        {
+            // A deeper partial or full block for the same position covers more tokens.
+            match.blocks.back() = *node.blockId;
+        }
+        else
+        {
+            return false;
+        }
+        match.numMatchedTokens = node.depth;
+        return true;
+    }
+
+    //! \brief Find a block with index blockIdx in the subtree of node that covers at least minDepth tokens.
+    [[nodiscard]] std::optional<BlockIdType> findBlockBelow(
+        Node const& node, SizeType32 blockIdx, SizeType32 minDepth) const
+    {
+        if (node.blockId && node.depth >= minDepth && (node.depth - 1) / mTokensPerBlock == blockIdx)
+        {
+            return node.blockId;
+        }
+        if (node.depth >= (blockIdx + 1) * mTokensPerBlock)
+        {
+            return std::nullopt;
+        }
+        for (auto const& [token, child] : node.children)
+        {
+            if (auto blockId = findBlockBelow(*child, blockIdx, minDepth))
+            {
+                return blockId;
+            }
+        }
+        return std::nullopt;
+    }
+
+    //! \brief Remove nodes that neither hold a block nor lead to one, and merge pass-through nodes.
+    void compact(Node* node)
+    {
+        while (node->parent != nullptr && !node->blockId && node->children.empty())
+        {
+            auto* parent = node->parent;
+            parent->children.erase(node->edge.front());
+            --mNumNodes;
+            node = parent;
+        }
+        if (node->parent == nullptr || node->blockId || node->children.size() != 1)
+        {
+            return;
+        }
+
+        // Merge the single child into node.
+        auto child = std::move(node->children.begin()->second);
+        node->children.clear();
+        node->edge.insert(node->edge.end(), child->edge.begin(), child->edge.end());
+        node->depth = child->depth;
+        node->blockId = child->blockId;
+        if (node->blockId)
+        {
+            mNodeByBlock[*node->blockId] = node;
+        }
+        node->children = std::move(child->children);
+        for (auto& [token, grandChild] : node->children)
+        {
+            grandChild->parent = node;
+        }
+        --mNumNodes;
+    }
+
+    SizeType32 mTokensPerBlock;
+    bool mUsesExtraIds;
+    std::map<RootKey, std::unique_ptr<Node>> mRoots;
+    std::unordered_map<BlockIdType, Node*> mNodeByBlock;
+    SizeType32 mNumNodes{0};
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
@@ -0,0 +1,404 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/kvCachePrefixSnapshot.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <limits>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Sharing of cached blocks between replicas. Every replica publishes the KV cache events of its KVCacheEventManager,
+// and every replica feeds the events of its peers into a KVCacheRemoteBlockIndex. Before a request is scheduled, the
+// index tells which peer holds the longest prefix beyond the local match. KVCacheRemoteBlockFetcher starts pulling
+// those blocks into pinned host memory through a KVCacheRemoteBlockTransport (e.g. the UCX connections used for
+// disaggregated serving), and once the transfer is done the blocks are stored for reuse in the local BlockManager, so
+// that the regular reuse lookup of the request finds them.
+//
+// Content of remote blocks is exchanged in the slot layout of the prefix snapshot: the block of every pool back to
+// back.
+
+//! \brief Block hashes of the full blocks of tokens, as computed by the block manager and reported in KV cache events.
+inline std::vector<executor::IdType> computeBlockHashes(VecUniqueTokens const& tokens,
+    tensorrt_llm::runtime::SizeType32 tokensPerBlock, std::optional<LoraTaskIdType> loraTaskId, bool usesExtraIds)
+{
+    std::vector<executor::IdType> hashes;
+    std::size_t parentHash{0};
+    for (std::size_t begin = 0; begin + tokensPerBlock <= tokens.size(); begin += tokensPerBlock)
+    {
+        BlockKey const key{loraTaskId.has_value(), usesExtraIds, loraTaskId.value_or(0),
+            VecUniqueTokens(tokens.begin() + begin, tokens.begin() + begin + tokensPerBlock)};
+        parentHash = BlockKeyHasher()(key, parentHash);
+        hashes.push_back(parentHash);
+    }
+    return hashes;
+}
+
+//! \brief Which peer holds which block, rebuilt from the KV cache events of the peers.
+class KVCacheRemoteBlockIndex
+{
+public:
+    using IdType = executor::IdType;
+    using InstanceId = std::uint32_t;
+
+    struct RemotePrefix
+    {
+        // Peer holding the blocks, nullopt if no peer holds the first block.
+        std::optional<InstanceId> instanceId;
+        // Number of leading blocks held by the peer.
+        std::size_t numBlocks{0};
+    };
+
+    //! \brief Update the index with a batch of events published by instanceId.
+    void apply(InstanceId instanceId, std::deque<executor::KVCacheEvent> const& events)
+    {
+        for (auto const& event : events)
+        {
+            if (auto const* stored = std::get_if<executor::KVCacheStoredData>(&event.data))
+            {
+                for (auto const& block : stored->blocks)
+                {
+                    if (mInstanceBlocks[instanceId].insert(block.blockHash).second)
+                    {
+                        mHolders[block.blockHash].insert(instanceId);
+                    }
+                }
+            }
+            else if (auto const* removed = std::get_if<executor::KVCacheRemovedData>(&event.data))
+            {
+                for (auto const hash : removed->blockHashes)
+                {
+                    remove(instanceId, hash);
+                }
+            }
+            else if (std::holds_alternative<executor::KVCacheCreatedData>(event.data))
+            {
+                removeInstance(instanceId);
+            }
+        }
+    }
+
+    //! \brief Forget all blocks of instanceId, e.g. after the peer went away.
+    void removeInstance(InstanceId instanceId)
+    {
+        auto const it = mInstanceBlocks.find(instanceId);
+        if (it == mInstanceBlocks.end())
+        {
+            return;
+        }
+        for (auto const hash : it->second)
+        {
+            eraseHolder(hash, instanceId);
+        }
+        mInstanceBlocks.erase(it);
+    }
+
+    //! \brief Peer holding the longest prefix of blockHashes. Ties go to the lowest instance id.
+    [[nodiscard]] RemotePrefix findLongestPrefix(
+        std::vector<IdType> const& blockHashes, std::optional<InstanceId> excludedInstanceId = std::nullopt) const
+    {
+        RemotePrefix prefix;
+        std::set<InstanceId> candidates;
+        for (std::size_t i = 0; i < blockHashes.size(); ++i)
+        {
+            auto const it = mHolders.find(blockHashes[i]);
+            if (it == mHolders.end())
+            {
+                break;
+            }
+            std::set<InstanceId> remaining;
+            for (auto const instanceId : it->second)
+            {
+                if (instanceId != excludedInstanceId && (i == 0 || candidates.count(instanceId) != 0))
+                {
+                    remaining.insert(instanceId);
+                }
+            }
+            if (remaining.empty())
+            {
+                break;
+            }
+            candidates = std::move(remaining);
+            prefix = RemotePrefix{*candidates.begin(), i + 1};
+        }
+        return prefix;
+    }
+
+    //! \brief Number of leading blocks of blockHashes that instanceId holds.
+    [[nodiscard]] std::size_t getNumPrefixBlocks(InstanceId instanceId, std::vector<IdType> const& blockHashes) const
+    {
+        auto const it = mInstanceBlocks.find(instanceId);
+        if (it == mInstanceBlocks.end())
+        {
+            return 0;
+        }
+        std::size_t numBlocks{0};
+        while (numBlocks < blockHashes.size() && it->second.count(blockHashes[numBlocks]) != 0)
+        {
+            ++numBlocks;
+        }
+        return numBlocks;
+    }
+
+    [[nodiscard]] std::size_t getNumBlocks(InstanceId instanceId) const
+    {
+        auto const it = mInstanceBlocks.find(instanceId);
+        return it == mInstanceBlocks.end() ? 0 : it->second.size();
+    }
+
+private:
+    void remove(InstanceId instanceId, IdType hash)
+    {
+        auto const it = mInstanceBlocks.find(instanceId);
+        if (it != mInstanceBlocks.end() && it->second.erase(hash) != 0)
+        {
+            eraseHolder(hash, instanceId);
+        }
+    }
+
+    void eraseHolder(IdType hash, InstanceId instanceId)
+    {
+        auto const it = mHolders.find(hash);
+        if (it == mHolders.end())
+        {
+            return;
+        }
+        it->second.erase(instanceId);
+        if (it->second.empty())
+        {
+            mHolders.erase(it);
+        }
+    }
+
+    std::unordered_map<IdType, std::set<InstanceId>> mHolders;
+    std::unordered_map<InstanceId, std::unordered_set<IdType>> mInstanceBlocks;
+};
+
+//! \brief Moves block contents between replicas. Implemented on top of the connections of the deployment.
+class KVCacheRemoteBlockTransport
+{
+public:
+    using InstanceId = KVCacheRemoteBlockIndex::InstanceId;
+
+    virtual ~KVCacheRemoteBlockTransport() = default;
+
+    //! \brief Copy the content of the blocks with the given hashes from instanceId into dst, one slot per block.
+    //! \return Future set to the number of leading blocks that were copied. The peer may have evicted the others.
+    virtual std::future<std::size_t> fetch(
+        InstanceId instanceId, std::vector<executor::IdType> const& blockHashes, runtime::IBuffer& dst)
+        = 0;
+};
+
+//! \brief Serving side of KVCacheRemoteBlockTransport::fetch: copy the cached blocks with the given hashes to dst.
+//! \return Number of leading blocks found in blockManager.
+inline std::size_t readBlocksForRemote(
+    BlockManager const& blockManager, std::vector<executor::IdType> const& blockHashes, void* dst)
+{
+    auto const blockSizes = detail::getBlockSizesInBytes(blockManager);
+    auto const& bufferManager = blockManager.getBufferManager();
+    auto* slot = static_cast<std::uint8_t*>(dst);
+    std::size_t numBlocks{0};
+    for (auto const hash : blockHashes)
+    {
+        auto const [begin, end] = blockManager.getBlocksByHash(hash);
+        if (begin == end)
+        {
+            break;
+        }
+        auto const& block = begin->second;
+        for (SizeType32 poolIdx = 0; poolIdx < blockManager.getNumPools(); ++poolIdx)
+        {
+            auto const pool
+                = block->isPrimary() ? blockManager.getPrimaryPool(poolIdx) : blockManager.getSecondaryPool(poolIdx);
+            auto const src = runtime::ITensor::slice(pool, block->getMemoryPoolBlockIndex(), 1);
+            bufferManager.copy(*src, slot, runtime::MemoryType::kCPU);
+            slot += blockSizes[poolIdx];
+        }
+        ++numBlocks;
+    }
+    bufferManager.getStream().synchronize();
+    return numBlocks;
+}
+
+//! \brief Remote cache level of a BlockManager: fetches prefixes computed by peers asynchronously and stores them for
+//! reuse once they arrived.
+class KVCacheRemoteBlockFetcher
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using InstanceId = KVCacheRemoteBlockIndex::InstanceId;
+
+    struct Stats
+    {
+        std::size_t numFetches{0};
+        // Number of blocks stored for reuse after a fetch.
+        std::size_t numFetchedBlocks{0};
+        // Number of requested blocks the peer did not have anymore.
+        std::size_t numMissedBlocks{0};
+    };
+
+    //! \param minNumBlocks Smallest remote prefix, beyond the local match, that is worth a transfer.
+    KVCacheRemoteBlockFetcher(KVCacheRemoteBlockIndex const& index,
+        std::shared_ptr<KVCacheRemoteBlockTransport> transport, InstanceId localInstanceId, SizeType32 minNumBlocks = 1)
+        : mIndex{index}
+        , mTransport{std::move(transport)}
+        , mLocalInstanceId{localInstanceId}
+        , mMinNumBlocks{minNumBlocks}
+    {
+        TLLM_CHECK(mTransport != nullptr);
+    }
+
+    //! \brief Start fetching the part of the prompt of llmRequest held by a peer but not by blockManager.
+    //! \return True if a fetch was started.
+    bool prefetch(BlockManager const& blockManager, LlmRequest const& llmRequest)
+    {
+        auto const requestId = llmRequest.mRequestId;
+        if (mPending.count(requestId) != 0)
+        {
+            return true;
+        }
+        auto const tokensPerBlock = blockManager.getTokensPerBlock();
+        // The last prompt token is always recomputed, so its block is never reused.
+        auto const& uniqueTokens = llmRequest.getUniqueTokens(0);
+        auto const numReusableTokens = static_cast<std::size_t>(llmRequest.getPromptLen() - 1);
+        VecUniqueTokens const prompt(uniqueTokens.begin(), uniqueTokens.begin() + numReusableTokens);
+        auto hashes = computeBlockHashes(prompt, tokensPerBlock, llmRequest.getLoraTaskId(), false);
+
+        std::size_t numLocalBlocks{0};
+        while (numLocalBlocks < hashes.size())
+        {
+            auto const [begin, end] = blockManager.getBlocksByHash(hashes[numLocalBlocks]);
+            if (begin == end)
+            {
+                break;
+            }
+            ++numLocalBlocks;
+        }
+        auto const remote = mIndex.findLongestPrefix(hashes, mLocalInstanceId);
+        if (!remote.instanceId.has_value()
+            || remote.numBlocks < numLocalBlocks + static_cast<std::size_t>(mMinNumBlocks))
+        {
+            return false;
+        }
+
+        // The peer sends the whole prefix: the local blocks may be evicted before the fetch completes.
+        hashes.resize(remote.numBlocks);
+        std::uint64_t slotSize{0};
+        for (auto const size : detail::getBlockSizesInBytes(blockManager))
+        {
+            slotSize += size;
+        }
+        auto buffer = runtime::BufferManager::pinnedPool(hashes.size() * slotSize, nvinfer1::DataType::kUINT8);
+        auto future = mTransport->fetch(*remote.instanceId, hashes, *buffer);
+        VecTokens tokens;
+        for (std::size_t i = 0; i < remote.numBlocks * tokensPerBlock; ++i)
+        {
+            tokens.push_back(prompt[i].tokenId);
+        }
+        mPending.emplace(requestId,
+            PendingFetch{std::move(tokens), llmRequest.getLoraTaskId().value_or(0), remote.numBlocks, slotSize,
+                std::move(buffer), std::move(future)});
+        ++mStats.numFetches;
+        return true;
+    }
+
+    //! \brief Store the blocks of the fetches that completed for reuse. Call before the reuse lookup of the requests.
+    //! \return Number of blocks that were stored.
+    SizeType32 storeCompleted(BlockManager& blockManager)
+    {
+        SizeType32 numStored{0};
+        auto const blockSizes = detail::getBlockSizesInBytes(blockManager);
+        for (auto it = mPending.begin(); it != mPending.end();)
+        {
+            auto& fetch = it->second;
+            if (fetch.future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+            auto const numFetched = fetch.future.get();
+            mStats.numMissedBlocks += fetch.numBlocks - numFetched;
+            if (numFetched > 0)
+            {
+                std::vector<std::uint8_t const*> contents;
+                for (std::size_t i = 0; i < numFetched; ++i)
+                {
+                    contents.push_back(runtime::bufferCast<std::uint8_t>(*fetch.buffer) + i * fetch.slotSize);
+                }
+                fetch.tokens.resize(numFetched * blockManager.getTokensPerBlock());
+                numStored += detail::storeBlocksForReuse(
+                    blockManager, mNextRequestId--, std::move(fetch.tokens), fetch.loraId, contents, blockSizes);
+            }
+            it = mPending.erase(it);
+        }
+        // The staging buffers are released once the copies are done.
+        blockManager.getBufferManager().getStream().synchronize();
+        mStats.numFetchedBlocks += numStored;
+        return numStored;
+    }
+
+    //! \brief True while a fetch for requestId is in flight. The request should not be scheduled before it completes.
+    [[nodiscard]] bool isPending(LlmRequest::RequestIdType requestId) const
+    {
+        return mPending.count(requestId) != 0;
+    }
+
+    [[nodiscard]] Stats const& getStats() const
+    {
+        return mStats;
+    }
+
+private:
+    struct PendingFetch
+    {
+        VecTokens tokens;
+        LoraTaskIdType loraId;
+        std::size_t numBlocks;
+        std::uint64_t slotSize;
+        runtime::IBuffer::SharedPtr buffer;
+        std::future<std::size_t> future;
+    };
+
+    KVCacheRemoteBlockIndex const& mIndex;
+    std::shared_ptr<KVCacheRemoteBlockTransport> mTransport;
+    InstanceId mLocalInstanceId;
+    SizeType32 mMinNumBlocks;
+    std::unordered_map<LlmRequest::RequestIdType, PendingFetch> mPending;
+    // Ids of the internal requests used to store fetched blocks, counting down from the middle of the range so that
+    // they stay clear of client ids and of the ids used by KVCachePrefixSnapshot::warm.
+    LlmRequest::RequestIdType mNextRequestId{std::numeric_limits<LlmRequest::RequestIdType>::max() / 2};
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
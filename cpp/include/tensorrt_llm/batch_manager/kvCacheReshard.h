@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/kernels/kvCacheBlockCopy.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Transfer of KV cache blocks between instances with different tensor and pipeline parallelism. A rank holds the
+// blocks of its local layers and KV heads, laid out as [numLocalLayers, kvFactor, numLocalHeads, tokensPerBlock,
+// sizePerHead], so the heads of one layer and K or V form one contiguous range. The plan maps every destination head
+// range to one source rank, and the copies of a block pair are contiguous runs that are merged whenever source and
+// destination are both adjacent. They run as one batched copy kernel that writes into the destination pool directly,
+// i.e. into peer memory mapped over NVLink or CUDA IPC when getEnvTryZCopyForKVCacheTransfer is set, without staging.
+
+//! \brief How the KV cache of a model is split over the ranks of an instance.
+struct KVCacheParallelLayout
+{
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    SizeType32 tpSize;
+    SizeType32 ppSize;
+    SizeType32 numLayers;
+    SizeType32 numKvHeads;
+    SizeType32 sizePerHead;
+    SizeType32 tokensPerBlock;
+    SizeType32 elementSize;
+    SizeType32 kvFactor{2};
+
+    [[nodiscard]] SizeType32 getNumLocalLayers() const
+    {
+        return numLayers / ppSize;
+    }
+
+    //! \brief Heads are replicated if there are more TP ranks than KV heads.
+    [[nodiscard]] SizeType32 getNumLocalHeads() const
+    {
+        return std::max(numKvHeads / tpSize, 1);
+    }
+
+    [[nodiscard]] SizeType32 getFirstHead(SizeType32 tpRank) const
+    {
+        return numKvHeads >= tpSize ? tpRank * getNumLocalHeads() : tpRank / (tpSize / numKvHeads);
+    }
+
+    //! \brief Ranks that hold a head, i.e. its replication factor.
+    [[nodiscard]] SizeType32 getNumHeadReplicas() const
+    {
+        return numKvHeads >= tpSize ? 1 : tpSize / numKvHeads;
+    }
+
+    [[nodiscard]] std::int64_t getHeadSizeInBytes() const
+    {
+        return static_cast<std::int64_t>(tokensPerBlock) * sizePerHead * elementSize;
+    }
+
+    [[nodiscard]] std::int64_t getBlockSizeInBytes() const
+    {
+        return static_cast<std::int64_t>(getNumLocalLayers()) * kvFactor * getNumLocalHeads() * getHeadSizeInBytes();
+    }
+
+    [[nodiscard]] SizeType32 getRank(SizeType32 tpRank, SizeType32 ppRank) const
+    {
+        return ppRank * tpSize + tpRank;
+    }
+
+    void check() const
+    {
+        TLLM_CHECK(tpSize > 0 && ppSize > 0 && numKvHeads > 0);
+        TLLM_CHECK_WITH_INFO(numLayers % ppSize == 0, "%d layers cannot be split over %d PP ranks", numLayers, ppSize);
+        TLLM_CHECK_WITH_INFO(numKvHeads % tpSize == 0 || tpSize % numKvHeads == 0,
+            "%d KV heads cannot be split over %d TP ranks", numKvHeads, tpSize);
+    }
+};
+
+//! \brief Heads [srcHead, srcHead + numHeads) of layers [srcLayer, srcLayer + numLayers) of a source rank, which are
+//! heads [dstHead, ...) of layers [dstLayer, ...) of a destination rank. Layers and heads are local to the ranks.
+struct KVCacheReshardSegment
+{
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    SizeType32 srcRank;
+    SizeType32 dstRank;
+    SizeType32 srcLayer;
+    SizeType32 dstLayer;
+    SizeType32 numLayers;
+    SizeType32 srcHead;
+    SizeType32 dstHead;
+    SizeType32 numHeads;
+};
+
+//! \brief Smallest set of segments that fills every destination rank. Of replicated source heads, destination TP
+//! ranks read from different replicas to spread the load.
+[[nodiscard]] inline std::vector<KVCacheReshardSegment> planKVCacheReshard(
+    KVCacheParallelLayout const& src, KVCacheParallelLayout const& dst)
+{
+    using SizeType32 = runtime::SizeType32;
+    src.check();
+    dst.check();
+    TLLM_CHECK_WITH_INFO(src.numLayers == dst.numLayers && src.numKvHeads == dst.numKvHeads
+            && src.sizePerHead == dst.sizePerHead && src.tokensPerBlock == dst.tokensPerBlock
+            && src.elementSize == dst.elementSize && src.kvFactor == dst.kvFactor,
+        "Source and destination KV caches differ in more than their parallelism");
+
+    std::vector<KVCacheReshardSegment> segments;
+    auto const srcLocalLayers = src.getNumLocalLayers();
+    auto const dstLocalLayers = dst.getNumLocalLayers();
+    auto const srcLocalHeads = src.getNumLocalHeads();
+    for (SizeType32 dstPp = 0; dstPp < dst.ppSize; ++dstPp)
+    {
+        auto const dstFirstLayer = dstPp * dstLocalLayers;
+        for (SizeType32 dstTp = 0; dstTp < dst.tpSize; ++dstTp)
+        {
+            auto const dstFirstHead = dst.getFirstHead(dstTp);
+            auto const replica = dstTp % src.getNumHeadReplicas();
+            for (auto layer = dstFirstLayer; layer < dstFirstLayer + dstLocalLayers;)
+            {
+                auto const srcPp = layer / srcLocalLayers;
+                auto const numLayers = std::min((srcPp + 1) * srcLocalLayers, dstFirstLayer + dstLocalLayers) - layer;
+                for (auto head = dstFirstHead; head < dstFirstHead + dst.getNumLocalHeads();)
+                {
+                    auto const srcTp = head / srcLocalHeads * src.getNumHeadReplicas() + replica;
+                    auto const srcFirstHead = src.getFirstHead(srcTp);
+                    auto const numHeads
+                        = std::min(srcFirstHead + srcLocalHeads, dstFirstHead + dst.getNumLocalHeads()) - head;
+                    segments.push_back({src.getRank(srcTp, srcPp), dst.getRank(dstTp, dstPp),
+                        layer - srcPp * srcLocalLayers, layer - dstFirstLayer, numLayers, head - srcFirstHead,
+                        head - dstFirstHead, numHeads});
+                    head += numHeads;
+                }
+                layer += numLayers;
+            }
+        }
+    }
+    return segments;
+}
+
+//! \brief Copies of the KV cache blocks that one source rank sends to one destination rank.
+class KVCacheResharder
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    KVCacheResharder(
+        KVCacheParallelLayout const& src, KVCacheParallelLayout const& dst, SizeType32 srcRank, SizeType32 dstRank)
+        : mSrc{src}
+        , mDst{dst}
+    {
+        for (auto const& segment : planKVCacheReshard(src, dst))
+        {
+            if (segment.srcRank == srcRank && segment.dstRank == dstRank)
+            {
+                mSegments.push_back(segment);
+            }
+        }
+    }
+
+    //! \brief Whether the source rank sends anything to the destination rank.
+    [[nodiscard]] bool isEmpty() const noexcept
+    {
+        return mSegments.empty();
+    }
+
+    [[nodiscard]] std::vector<KVCacheReshardSegment> const& getSegments() const noexcept
+    {
+        return mSegments;
+    }
+
+    //! \brief Contiguous copies from the blocks srcBlocks of the pool at srcPool to the blocks dstBlocks of the pool at
+    //! dstPool, in memory order and merged where possible.
+    [[nodiscard]] std::vector<kernels::KVBlockCopyDesc> getCopies(void const* srcPool, void* dstPool,
+        std::vector<SizeType32> const& srcBlocks, std::vector<SizeType32> const& dstBlocks) const
+    {
+        TLLM_CHECK(srcBlocks.size() == dstBlocks.size());
+        auto const headSize = mSrc.getHeadSizeInBytes();
+        auto const srcBlockSize = mSrc.getBlockSizeInBytes();
+        auto const dstBlockSize = mDst.getBlockSizeInBytes();
+        auto const* srcBase = static_cast<std::uint8_t const*>(srcPool);
+        auto* dstBase = static_cast<std::uint8_t*>(dstPool);
+
+        std::vector<kernels::KVBlockCopyDesc> copies;
+        auto const append = [&copies](std::uint8_t const* src, std::uint8_t* dst, std::int64_t numBytes)
+        {
+            if (!copies.empty())
+            {
+                auto& last = copies.back();
+                if (static_cast<std::uint8_t const*>(last.src) + last.numBytes == src
+                    && static_cast<std::uint8_t*>(last.dst) + last.numBytes == dst)
+                {
+                    last.numBytes += numBytes;
+                    return;
+                }
+            }
+            copies.push_back({src, dst, numBytes});
+        };
+        for (std::size_t blockIdx = 0; blockIdx < srcBlocks.size(); ++blockIdx)
+        {
+            auto const* srcBlock = srcBase + srcBlocks[blockIdx] * srcBlockSize;
+            auto* dstBlock = dstBase + dstBlocks[blockIdx] * dstBlockSize;
+            for (auto const& segment : mSegments)
+            {
+                for (SizeType32 layer = 0; layer < segment.numLayers; ++layer)
+                {
+                    for (SizeType32 kvIdx = 0; kvIdx < mSrc.kvFactor; ++kvIdx)
+                    {
+                        auto const srcOffset
+                            = ((static_cast<std::int64_t>(segment.srcLayer + layer) * mSrc.kvFactor + kvIdx)
+                                      * mSrc.getNumLocalHeads()
+                                  + segment.srcHead)
+                            * headSize;
+                        auto const dstOffset
+                            = ((static_cast<std::int64_t>(segment.dstLayer + layer) * mDst.kvFactor + kvIdx)
+                                      * mDst.getNumLocalHeads()
+                                  + segment.dstHead)
+                            * headSize;
+                        append(srcBlock + srcOffset, dstBlock + dstOffset, segment.numHeads * headSize);
+                    }
+                }
+            }
+        }
+        return copies;
+    }
+
+    //! \brief Enqueue the copies on the stream of bufferManager. dstPool must be writable from the device, e.g. a
+    //! peer or IPC mapping of the destination pool.
+    void copy(void const* srcPool, void* dstPool, std::vector<SizeType32> const& srcBlocks,
+        std::vector<SizeType32> const& dstBlocks, runtime::BufferManager const& bufferManager) const
+    {
+        auto const copies = getCopies(srcPool, dstPool, srcBlocks, dstBlocks);
+        if (copies.empty())
+        {
+            return;
+        }
+        std::int64_t maxNumBytes{0};
+        for (auto const& copy : copies)
+        {
+            maxNumBytes = std::max(maxNumBytes, copy.numBytes);
+        }
+        auto const deviceCopies
+            = bufferManager.gpu(copies.size() * sizeof(kernels::KVBlockCopyDesc), nvinfer1::DataType::kUINT8);
+        bufferManager.copy(copies.data(), *deviceCopies, runtime::MemoryType::kCPU);
+        kernels::invokeBatchedBlockCopy(static_cast<kernels::KVBlockCopyDesc const*>(deviceCopies->data()),
+            static_cast<std::int32_t>(copies.size()), maxNumBytes, bufferManager.getStream().get());
+    }
+
+private:
+    KVCacheParallelLayout mSrc;
+    KVCacheParallelLayout mDst;
+    std::vector<KVCacheReshardSegment> mSegments;
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
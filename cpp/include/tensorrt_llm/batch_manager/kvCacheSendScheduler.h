@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Schedules the KV cache sends of many requests over one link.
+//! \details The blocks of every request are split into chunks of chunkNumBlocks blocks. Sender threads acquire chunks
+//! one at a time, always of the request with the fewest remaining blocks, so a long prompt no longer delays the many
+//! short ones queued behind it and only finishes last. The number of chunks in flight is tuned by hill climbing on the
+//! measured throughput of the link: after every window of completed chunks, it keeps moving in the direction that
+//! raised the throughput and turns around otherwise.
+//!
+//! Per-request transfer times are collected for DisServingRequestStats::kvCacheTransferMS and in a histogram.
+class KVCacheSendScheduler
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+    using Clock = std::chrono::steady_clock;
+
+    //! \brief Bucket i counts the transfers that took less than 2^i ms, the last one all longer ones.
+    static constexpr std::size_t kNumHistogramBuckets{16};
+
+    struct Config
+    {
+        SizeType32 chunkNumBlocks{16};
+        SizeType32 minConcurrency{1};
+        //! \brief E.g. getEnvKVCacheSendMaxConcurrenceNum.
+        SizeType32 maxConcurrency{16};
+        //! \brief Completed chunks between two throughput measurements.
+        SizeType32 windowNumChunks{32};
+        //! \brief Relative throughput change that counts as an improvement.
+        double minImprovement{0.05};
+    };
+
+    struct Chunk
+    {
+        RequestIdType requestId;
+        //! \brief Range of blocks within the blocks of the request.
+        SizeType32 firstBlock;
+        SizeType32 numBlocks;
+    };
+
+    struct Stats
+    {
+        std::int64_t numChunks{0};
+        std::int64_t numBytes{0};
+        std::int64_t numRequests{0};
+        SizeType32 concurrency{0};
+        //! \brief Throughput of the last window in bytes per second.
+        double throughput{0.};
+        std::array<std::int64_t, kNumHistogramBuckets> transferTimeHistogram{};
+    };
+
+    explicit KVCacheSendScheduler(Config const& config)
+        : mConfig{config}
+        , mConcurrency{config.minConcurrency}
+    {
+        TLLM_CHECK(config.chunkNumBlocks > 0 && config.windowNumChunks > 0);
+        TLLM_CHECK(config.minConcurrency > 0 && config.maxConcurrency >= config.minConcurrency);
+    }
+
+    virtual ~KVCacheSendScheduler() = default;
+
+    //! \brief Queue the send of numBlocks blocks of a request.
+    void add(RequestIdType requestId, SizeType32 numBlocks)
+    {
+        TLLM_CHECK(numBlocks > 0);
+        {
+            std::lock_guard lock{mMutex};
+            auto const [it, inserted] = mTransfers.try_emplace(requestId, Transfer{numBlocks, 0, 0, getTime()});
+            TLLM_CHECK_WITH_INFO(inserted, "KV cache send of request %lu is already queued", requestId);
+        }
+        mCondition.notify_one();
+    }
+
+    //! \brief Next chunk to send, if the concurrency limit allows another one.
+    [[nodiscard]] std::optional<Chunk> tryAcquire()
+    {
+        std::lock_guard lock{mMutex};
+        return acquireLocked();
+    }
+
+    //! \brief Wait for a chunk to send until timeout passes or shutdown is called.
+    [[nodiscard]] std::optional<Chunk> acquire(std::chrono::milliseconds timeout)
+    {
+        std::unique_lock lock{mMutex};
+        std::optional<Chunk> chunk;
+        mCondition.wait_for(lock, timeout, [&] { return mShutdown || (chunk = acquireLocked()).has_value(); });
+        return chunk;
+    }
+
+    //! \brief Report a sent chunk.
+    //! \return Transfer time of the request if this was its last chunk.
+    std::optional<std::chrono::duration<double, std::milli>> complete(Chunk const& chunk, std::int64_t numBytes)
+    {
+        std::optional<std::chrono::duration<double, std::milli>> transferTime;
+        {
+            std::lock_guard lock{mMutex};
+            auto const now = getTime();
+            --mNumInFlight;
+            ++mStats.numChunks;
+            mStats.numBytes += numBytes;
+            mWindowBytes += numBytes;
+            if (++mWindowNumChunks == mConfig.windowNumChunks)
+            {
+                adapt(now);
+            }
+            auto const it = mTransfers.find(chunk.requestId);
+            TLLM_CHECK_WITH_INFO(it != mTransfers.end(), "KV cache send of request %lu is not queued", chunk.requestId);
+            auto& transfer = it->second;
+            transfer.numCompleted += chunk.numBlocks;
+            if (transfer.numCompleted == transfer.numBlocks)
+            {
+                transferTime = std::chrono::duration<double, std::milli>(now - transfer.startTime);
+                record(chunk.requestId, *transferTime);
+                mTransfers.erase(it);
+            }
+        }
+        mCondition.notify_all();
+        return transferTime;
+    }
+
+    //! \brief Drop the remaining chunks of a request, e.g. when it is cancelled. Chunks in flight must still complete.
+    void cancel(RequestIdType requestId)
+    {
+        std::lock_guard lock{mMutex};
+        auto const it = mTransfers.find(requestId);
+        if (it != mTransfers.end())
+        {
+            it->second.numBlocks = it->second.numScheduled;
+            if (it->second.numCompleted == it->second.numBlocks)
+            {
+                mTransfers.erase(it);
+            }
+        }
+    }
+
+    void shutdown()
+    {
+        {
+            std::lock_guard lock{mMutex};
+            mShutdown = true;
+        }
+        mCondition.notify_all();
+    }
+
+    //! \brief Transfer times in ms of the requests that finished since the last call.
+    [[nodiscard]] std::vector<std::pair<RequestIdType, double>> popTransferTimes()
+    {
+        std::lock_guard lock{mMutex};
+        return std::exchange(mTransferTimes, {});
+    }
+
+    [[nodiscard]] Stats getStats() const
+    {
+        std::lock_guard lock{mMutex};
+        auto stats = mStats;
+        stats.concurrency = mConcurrency;
+        return stats;
+    }
+
+    // Making this public and virtual makes it possible to test.
+    [[nodiscard]] virtual Clock::time_point getTime() const
+    {
+        return Clock::now();
+    }
+
+private:
+    struct Transfer
+    {
+        SizeType32 numBlocks;
+        SizeType32 numScheduled;
+        SizeType32 numCompleted;
+        Clock::time_point startTime;
+    };
+
+    [[nodiscard]] std::optional<Chunk> acquireLocked()
+    {
+        if (mShutdown || mNumInFlight >= mConcurrency)
+        {
+            return std::nullopt;
+        }
+        // Shortest remaining first. The number of requests in flight is small, a scan is cheaper than a heap that has
+        // to be updated after every chunk.
+        Transfer* shortest{nullptr};
+        RequestIdType shortestId{0};
+        for (auto& [requestId, transfer] : mTransfers)
+        {
+            auto const remaining = transfer.numBlocks - transfer.numScheduled;
+            if (remaining > 0
+                && (shortest == nullptr || remaining < shortest->numBlocks - shortest->numScheduled
+                    || (remaining == shortest->numBlocks - shortest->numScheduled && requestId < shortestId)))
+            {
+                shortest = &transfer;
+                shortestId = requestId;
+            }
+        }
+        if (shortest == nullptr)
+        {
+            return std::nullopt;
+        }
+        if (mNumInFlight == 0 && mWindowNumChunks == 0)
+        {
+            mWindowStart = getTime();
+        }
+        Chunk const chunk{shortestId, shortest->numScheduled,
+            std::min(mConfig.chunkNumBlocks, shortest->numBlocks - shortest->numScheduled)};
+        shortest->numScheduled += chunk.numBlocks;
+        ++mNumInFlight;
+        return chunk;
+    }
+
+    void adapt(Clock::time_point now)
+    {
+        auto const seconds = std::chrono::duration<double>(now - mWindowStart).count();
+        auto const throughput = seconds > 0. ? static_cast<double>(mWindowBytes) / seconds : 0.;
+        if (throughput < mStats.throughput * (1. + mConfig.minImprovement))
+        {
+            mDirection = -mDirection;
+        }
+        mConcurrency = std::clamp(mConcurrency + mDirection, mConfig.minConcurrency, mConfig.maxConcurrency);
+        TLLM_LOG_DEBUG("KV cache send throughput %.1f MB/s, concurrency %d", throughput / 1e6, mConcurrency);
+        mStats.throughput = throughput;
+        mWindowStart = now;
+        mWindowBytes = 0;
+        mWindowNumChunks = 0;
+    }
+
+    void record(RequestIdType requestId, std::chrono::duration<double, std::milli> transferTime)
+    {
+        std::size_t bucket{0};
+        while (bucket + 1 < kNumHistogramBuckets && transferTime.count() >= static_cast<double>(1 << bucket))
+        {
+            ++bucket;
+        }
+        ++mStats.transferTimeHistogram[bucket];
+        ++mStats.numRequests;
+        mTransferTimes.emplace_back(requestId, transferTime.count());
+    }
+
+    Config mConfig;
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::unordered_map<RequestIdType, Transfer> mTransfers;
+    SizeType32 mConcurrency;
+    SizeType32 mNumInFlight{0};
+    SizeType32 mDirection{1};
+    Clock::time_point mWindowStart{};
+    std::int64_t mWindowBytes{0};
+    SizeType32 mWindowNumChunks{0};
+    std::vector<std::pair<RequestIdType, double>> mTransferTimes;
+    Stats mStats;
+    bool mShutdown{false};
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/kernels/kvCacheBlockCopy.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/iBuffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Preemption by swapping instead of recomputing. When the scheduler pauses a request, its KV cache is dropped and the
+// whole sequence is prefilled again on resume. For long sequences, copying the cache to pinned host memory and back
+// is cheaper. The swapper decides per request with a cost model:
+//     swap      = 2 * cache bytes / transfer bandwidth
+//     recompute = tokens / prefill throughput
+// Both rates are estimates that the caller should update with measurements, for example the bandwidth from
+// KVCacheBatchedBlockCopier::Stats.
+//
+// Usage: call swapOut for a request that is about to be paused, before its blocks are freed. Once the resumed request
+// has its blocks again, call swapIn before its context step. That restores the cache and skips the prefill of the
+// restored tokens. All copies are enqueued on the stream of the block manager, so they are ordered with the forward
+// passes that free and reuse the blocks.
+class KVCacheSwapper
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+
+    struct Config
+    {
+        // Device <-> pinned host bandwidth in bytes per second.
+        double transferBytesPerSecond{12e9};
+        // Prefill throughput in tokens per second.
+        double prefillTokensPerSecond{2e4};
+        // Pinned host memory available for swapped caches.
+        std::size_t maxHostBytes{std::size_t{8} << 30};
+        // Shorter sequences are always recomputed.
+        SizeType32 minNumTokens{256};
+    };
+
+    struct Stats
+    {
+        std::size_t numSwapOuts{0};
+        std::size_t numSwapIns{0};
+        // Paused requests that were left to recompute.
+        std::size_t numRecomputes{0};
+        std::size_t numBytes{0};
+    };
+
+    explicit KVCacheSwapper(Config const& config)
+        : mConfig{config}
+    {
+    }
+
+    void updateTransferBandwidth(double bytesPerSecond)
+    {
+        if (bytesPerSecond > 0.0)
+        {
+            mConfig.transferBytesPerSecond = bytesPerSecond;
+        }
+    }
+
+    //! \brief Update the prefill throughput with a measured context step.
+    void updatePrefillThroughput(SizeType32 numTokens, double seconds)
+    {
+        if (numTokens > 0 && seconds > 0.0)
+        {
+            // Exponential moving average, the throughput depends on the batch.
+            mConfig.prefillTokensPerSecond = 0.9 * mConfig.prefillTokensPerSecond + 0.1 * numTokens / seconds;
+        }
+    }
+
+    //! \brief Whether restoring the cache of the request from the host is cheaper than recomputing it.
+    [[nodiscard]] bool shouldSwap(BaseKVCacheManager const& kvCacheManager, LlmRequest const& req) const
+    {
+        // LlmRequest::pause drops the generated tokens of beam search, the cache would not match.
+        if (req.mSamplingConfig.beamWidth != 1 || !req.isGenerationInProgressState())
+        {
+            return false;
+        }
+        auto const numTokens = getNumCachedTokens(req);
+        if (numTokens < mConfig.minNumTokens)
+        {
+            return false;
+        }
+        auto const numBytes = getNumBlocks(kvCacheManager, numTokens) * getBlockSizeInBytes(kvCacheManager);
+        if (mHostBytes + numBytes > mConfig.maxHostBytes)
+        {
+            return false;
+        }
+        auto const swapSeconds = 2.0 * static_cast<double>(numBytes) / mConfig.transferBytesPerSecond;
+        auto const recomputeSeconds = static_cast<double>(numTokens) / mConfig.prefillTokensPerSecond;
+        return swapSeconds < recomputeSeconds;
+    }
+
+    //! \brief Copy the cache of a request that is about to be paused to the host, if shouldSwap.
+    //! \return True if the cache was swapped out.
+    bool swapOut(BaseKVCacheManager const& kvCacheManager, LlmRequest const& req)
+    {
+        releaseCompleted();
+        if (!shouldSwap(kvCacheManager, req))
+        {
+            ++mStats.numRecomputes;
+            return false;
+        }
+        auto const numTokens = getNumCachedTokens(req);
+        auto const numBlocks = getNumBlocks(kvCacheManager, numTokens);
+        auto const numBytes = numBlocks * getBlockSizeInBytes(kvCacheManager);
+        auto host = runtime::BufferManager::pinnedPool(numBytes, nvinfer1::DataType::kUINT8);
+        copyBlocks(kvCacheManager, req.mRequestId, *host, 0, numBlocks, true);
+
+        mHostBytes += numBytes;
+        mStats.numBytes += numBytes;
+        ++mStats.numSwapOuts;
+        mSwapped.insert_or_assign(req.mRequestId, SwappedCache{numTokens, std::move(host)});
+        TLLM_LOG_DEBUG("Swapped out %d tokens of request %lu", numTokens, req.mRequestId);
+        return true;
+    }
+
+    //! \brief Restore the cache of a resumed request whose blocks have just been allocated again, and advance its
+    //! context position past the restored tokens.
+    //! \return True if a cache was restored.
+    bool swapIn(BaseKVCacheManager const& kvCacheManager, LlmRequest& req)
+    {
+        releaseCompleted();
+        auto const it = mSwapped.find(req.mRequestId);
+        if (it == mSwapped.end())
+        {
+            return false;
+        }
+        auto const tokensPerBlock = kvCacheManager.getTokensPerBlock();
+        // The prompt may have been truncated to maxInputLen on pause, and the last prompt token has to be computed.
+        auto const numTokens = std::min(it->second.numTokens, req.getPromptLen() - 1);
+        // Blocks already filled by reuse are shared with other sequences, leave them alone.
+        auto const firstBlockIdx = req.getPrepopulatedPromptLen() / tokensPerBlock;
+        if (numTokens > req.getPrepopulatedPromptLen())
+        {
+            copyBlocks(kvCacheManager, req.mRequestId, *it->second.host, firstBlockIdx,
+                getNumBlocks(kvCacheManager, numTokens), false);
+            req.setPrepopulatedPromptLen(numTokens, tokensPerBlock);
+            mStats.numBytes += (getNumBlocks(kvCacheManager, numTokens) - firstBlockIdx)
+                * getBlockSizeInBytes(kvCacheManager);
+        }
+        // The host memory must outlive the copies.
+        runtime::CudaEvent copied;
+        kvCacheManager.getBlockManager().getBufferManager().getStream().record(copied);
+        mPendingReleases.emplace_back(std::move(copied), std::move(it->second.host));
+        mSwapped.erase(it);
+        ++mStats.numSwapIns;
+        TLLM_LOG_DEBUG("Swapped in %d tokens of request %lu", numTokens, req.mRequestId);
+        return true;
+    }
+
+    //! \brief Drop the swapped cache of a request that will not resume, for example because it was cancelled.
+    void drop(BaseKVCacheManager const& kvCacheManager, RequestIdType requestId)
+    {
+        auto const it = mSwapped.find(requestId);
+        if (it != mSwapped.end())
+        {
+            // The swap-out may still be in flight.
+            runtime::CudaEvent copied;
+            kvCacheManager.getBlockManager().getBufferManager().getStream().record(copied);
+            mPendingReleases.emplace_back(std::move(copied), std::move(it->second.host));
+            mSwapped.erase(it);
+        }
+    }
+
+    [[nodiscard]] bool isSwapped(RequestIdType requestId) const
+    {
+        return mSwapped.count(requestId) != 0;
+    }
+
+    [[nodiscard]] std::size_t getHostBytes() const noexcept
+    {
+        return mHostBytes;
+    }
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+private:
+    struct SwappedCache
+    {
+        SizeType32 numTokens;
+        runtime::IBuffer::SharedPtr host;
+    };
+
+    using SwappedMap = std::unordered_map<RequestIdType, SwappedCache>;
+
+    //! \brief Tokens with a cache entry. The last generated token is the input of the next step.
+    [[nodiscard]] static SizeType32 getNumCachedTokens(LlmRequest const& req)
+    {
+        return req.getNumTokens(0) - 1;
+    }
+
+    [[nodiscard]] static std::size_t getNumBlocks(BaseKVCacheManager const& kvCacheManager, SizeType32 numTokens)
+    {
+        auto const tokensPerBlock = kvCacheManager.getTokensPerBlock();
+        return static_cast<std::size_t>((numTokens + tokensPerBlock - 1) / tokensPerBlock);
+    }
+
+    //! \brief Bytes of a block over all pools.
+    [[nodiscard]] static std::size_t getBlockSizeInBytes(BaseKVCacheManager const& kvCacheManager)
+    {
+        auto const& blockManager = kvCacheManager.getBlockManager();
+        std::size_t blockSize{0};
+        for (SizeType32 poolIdx = 0; poolIdx < blockManager.getNumPools(); ++poolIdx)
+        {
+            auto const pool = blockManager.getPrimaryPool(poolIdx);
+            blockSize += pool->getSizeInBytes() / pool->getShape().d[0];
+        }
+        return blockSize;
+    }
+
+    //! \brief Copy blocks [beginBlockIdx, endBlockIdx) of a sequence between the pools and host, where host holds the
+    //! blocks of all pools back to back.
+    static void copyBlocks(BaseKVCacheManager const& kvCacheManager, RequestIdType requestId, runtime::IBuffer& host,
+        std::size_t beginBlockIdx, std::size_t endBlockIdx, bool toHost)
+    {
+        auto const& blockManager = kvCacheManager.getBlockManager();
+        auto const& blockIds = kvCacheManager.getSequence(requestId).getCacheBlockIds().at(0);
+        TLLM_CHECK(endBlockIdx <= blockIds.size());
+
+        std::vector<kernels::KVBlockCopyDesc> copies;
+        std::int64_t maxNumBytes{0};
+        auto* hostPtr = static_cast<std::uint8_t*>(host.data()) + beginBlockIdx * getBlockSizeInBytes(kvCacheManager);
+        for (auto blockIdx = beginBlockIdx; blockIdx < endBlockIdx; ++blockIdx)
+        {
+            auto const memoryIdx = blockManager.getBlockById(blockIds[blockIdx])->getMemoryPoolBlockIndex();
+            for (SizeType32 poolIdx = 0; poolIdx < blockManager.getNumPools(); ++poolIdx)
+            {
+                auto const pool = blockManager.getPrimaryPool(poolIdx);
+                auto const blockSize = static_cast<std::int64_t>(pool->getSizeInBytes() / pool->getShape().d[0]);
+                auto* devicePtr = static_cast<std::uint8_t*>(pool->data()) + memoryIdx * blockSize;
+                copies.push_back(toHost ? kernels::KVBlockCopyDesc{devicePtr, hostPtr, blockSize}
+                                        : kernels::KVBlockCopyDesc{hostPtr, devicePtr, blockSize});
+                hostPtr += blockSize;
+                maxNumBytes = std::max(maxNumBytes, blockSize);
+            }
+        }
+        if (copies.empty())
+        {
+            return;
+        }
+        auto const& bufferManager = blockManager.getBufferManager();
+        auto const descriptors
+            = bufferManager.gpu(copies.size() * sizeof(kernels::KVBlockCopyDesc), nvinfer1::DataType::kUINT8);
+        bufferManager.copy(copies.data(), *descriptors, runtime::MemoryType::kCPU);
+        kernels::invokeBatchedBlockCopy(static_cast<kernels::KVBlockCopyDesc const*>(descriptors->data()),
+            static_cast<std::int32_t>(copies.size()), maxNumBytes, bufferManager.getStream().get());
+    }
+
+    void releaseCompleted()
+    {
+        auto const isCompleted = [this](auto const& pending)
+        {
+            if (cudaEventQuery(pending.first.get()) != cudaSuccess)
+            {
+                return false;
+            }
+            mHostBytes -= pending.second->getSizeInBytes();
+            return true;
+        };
+        mPendingReleases.erase(
+            std::remove_if(mPendingReleases.begin(), mPendingReleases.end(), isCompleted), mPendingReleases.end());
+    }
+
+    Config mConfig;
+    SwappedMap mSwapped;
+    // Host memory of restored or dropped caches, freed once the event has completed.
+    std::vector<std::pair<runtime::CudaEvent, runtime::IBuffer::SharedPtr>> mPendingReleases;
+    std::size_t mHostBytes{0};
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
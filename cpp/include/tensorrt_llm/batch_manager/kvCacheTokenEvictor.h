@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/kernels/kvCacheTokenCompaction.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Attention-score-based token eviction (H2O). In the generation phase, the MMHA kernels add the attention
+// probabilities of every layer and head to the attention mass of the cached tokens of a sequence. Once a sequence holds
+// more than tokenBudget tokens, the tokens with the lowest mass are dropped, the kept tokens are compacted to the front
+// of the sequence (invokeCompactKVTokens) and the freed blocks at the end are returned to the block manager. The first
+// numSinkTokens, the last numRecentTokens and the tokens in reused (shared) blocks are always kept.
+//
+// The evictor is made visible to the attention plugin for the duration of a forward pass with ScopedActivation, like
+// KVCacheLayerwiseOnboarder. The mass is indexed by the position of a token in the cache, so sliding window attention
+// (cyclic KV cache) cannot be combined with token eviction.
+class KVCacheTokenEvictor
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+
+    struct Config
+    {
+        // Number of tokens a sequence keeps after an eviction.
+        SizeType32 tokenBudget;
+        // Attention sinks at the start of the sequence that are never evicted.
+        SizeType32 numSinkTokens{4};
+        // Most recent tokens that are never evicted.
+        SizeType32 numRecentTokens{64};
+        // Tokens a sequence may grow beyond tokenBudget before the next eviction, to amortize the compaction.
+        SizeType32 slack{64};
+    };
+
+    //! \param maxNumSequences Number of sequences tracked at the same time.
+    //! \param maxAttentionWindow Capacity of a sequence in tokens, the row stride of the attention mass.
+    //! \param sizePerHead Head size of the model.
+    KVCacheTokenEvictor(Config const& config, SizeType32 maxNumSequences, SizeType32 maxAttentionWindow,
+        SizeType32 sizePerHead, runtime::BufferManager const& bufferManager)
+        : mConfig{config}
+        , mMaxAttentionWindow{maxAttentionWindow}
+        , mSizePerHead{sizePerHead}
+        // The last row is a scratch row for the requests that are not tracked.
+        , mAttentionMass{bufferManager.gpu(
+              runtime::ITensor::makeShape({maxNumSequences + 1, maxAttentionWindow}), nvinfer1::DataType::kFLOAT)}
+        , mRows{bufferManager.gpu(runtime::ITensor::makeShape({maxNumSequences}), nvinfer1::DataType::kINT32)}
+    {
+        TLLM_CHECK_WITH_INFO(config.numSinkTokens + config.numRecentTokens <= config.tokenBudget,
+            "The token budget must hold the sink and recent tokens");
+        bufferManager.setZero(*mAttentionMass);
+        mFreeRows.resize(maxNumSequences);
+        std::iota(mFreeRows.rbegin(), mFreeRows.rend(), 0);
+    }
+
+    //! \brief Start tracking the attention mass of requestId.
+    void addSequence(RequestIdType requestId)
+    {
+        TLLM_CHECK_WITH_INFO(!mFreeRows.empty(), "Too many sequences for token eviction");
+        mRowByRequest.emplace(requestId, mFreeRows.back());
+        mFreeRows.pop_back();
+    }
+
+    //! \brief Stop tracking requestId. Blocks of sequences with evicted tokens must not be stored for reuse.
+    void removeSequence(RequestIdType requestId, runtime::BufferManager const& bufferManager)
+    {
+        auto const it = mRowByRequest.find(requestId);
+        if (it == mRowByRequest.end())
+        {
+            return;
+        }
+        bufferManager.setZero(*runtime::ITensor::slice(mAttentionMass, it->second, 1));
+        mFreeRows.push_back(it->second);
+        mRowByRequest.erase(it);
+        mNumEvictedTokens.erase(requestId);
+    }
+
+    //! \brief Set the requests of the next forward pass, in batch order. Requests that are not tracked get no mass.
+    void setBatch(std::vector<RequestIdType> const& requestIds, runtime::BufferManager const& bufferManager)
+    {
+        auto const scratchRow = static_cast<std::int32_t>(mAttentionMass->getShape().d[0] - 1);
+        std::vector<std::int32_t> rows;
+        rows.reserve(requestIds.size());
+        for (auto const requestId : requestIds)
+        {
+            auto const it = mRowByRequest.find(requestId);
+            rows.push_back(it != mRowByRequest.end() ? it->second : scratchRow);
+        }
+        TLLM_CHECK(rows.size() <= mRows->getSize());
+        bufferManager.copy(rows.data(), *runtime::ITensor::slice(mRows, 0, rows.size()), runtime::MemoryType::kCPU);
+    }
+
+    //! \brief Attention mass of the batch set with setBatch, see Multihead_attention_params_base::attention_mass.
+    [[nodiscard]] float* getAttentionMass() const
+    {
+        return runtime::bufferCast<float>(*mAttentionMass);
+    }
+
+    [[nodiscard]] std::int32_t const* getAttentionMassRows() const
+    {
+        return runtime::bufferCast<std::int32_t>(*mRows);
+    }
+
+    //! \brief Number of tokens evicted from requestId so far. The sequence length seen by the attention is the number
+    //! of tokens of the request minus this.
+    [[nodiscard]] SizeType32 getNumEvictedTokens(RequestIdType requestId) const
+    {
+        auto const it = mNumEvictedTokens.find(requestId);
+        return it == mNumEvictedTokens.end() ? 0 : it->second;
+    }
+
+    //! \brief Evict the least attended tokens of the requests that exceeded their budget and compact their caches.
+    //! \return Number of evicted tokens.
+    SizeType32 evict(KVCacheManager& kvCacheManager, std::vector<std::shared_ptr<LlmRequest>> const& requests)
+    {
+        auto const& blockManager = kvCacheManager.getBlockManager();
+        TLLM_CHECK_WITH_INFO(blockManager.getNumPools(false) == blockManager.getNumPools(),
+            "Token eviction does not support FP4 KV caches");
+        auto const tokensPerBlock = blockManager.getTokensPerBlock();
+        auto const& bufferManager = blockManager.getBufferManager();
+
+        std::vector<kernels::KVTokenMove> moves;
+        std::vector<std::int32_t> moveOffsets{0};
+        std::vector<std::pair<RequestIdType, SizeType32>> evictions;
+        std::vector<float> mass;
+        for (auto const& request : requests)
+        {
+            auto const rowIt = mRowByRequest.find(request->mRequestId);
+            if (rowIt == mRowByRequest.end())
+            {
+                continue;
+            }
+            auto const numTokens = kvCacheManager.getSequence(request->mRequestId).getNumTokens();
+            if (numTokens <= mConfig.tokenBudget + mConfig.slack)
+            {
+                continue;
+            }
+            // The last token of the sequence has no KV yet.
+            auto const numCachedTokens = numTokens - 1;
+            TLLM_CHECK(numCachedTokens <= mMaxAttentionWindow);
+            runtime::ITensor::SharedPtr const row = runtime::ITensor::slice(mAttentionMass, rowIt->second, 1);
+            mass.resize(numCachedTokens);
+            bufferManager.copy(*runtime::ITensor::slice(row, {0, 0}, numCachedTokens), mass.data(),
+                runtime::MemoryType::kCPU);
+            bufferManager.getStream().synchronize();
+
+            // Shared blocks are read by other sequences and must not be written to.
+            auto const numSharedTokens
+                = common::ceilDiv(request->getPrepopulatedPromptLen(), tokensPerBlock) * tokensPerBlock;
+            auto const kept = selectKeptTokens(mass, std::max(mConfig.numSinkTokens, numSharedTokens));
+            auto const numKept = static_cast<SizeType32>(kept.size());
+            if (numKept == numCachedTokens)
+            {
+                continue;
+            }
+
+            auto const& blockIds = kvCacheManager.getCacheBlockIds(request->mRequestId).at(0);
+            auto const poolIndex = [&](SizeType32 tokenIdx)
+            { return blockManager.getBlockById(blockIds.at(tokenIdx / tokensPerBlock))->getMemoryPoolBlockIndex(); };
+            std::vector<float> compactedMass(numCachedTokens, 0.F);
+            for (SizeType32 i = 0; i < numKept; ++i)
+            {
+                compactedMass[i] = mass[kept[i]];
+                if (kept[i] != i)
+                {
+                    moves.push_back({poolIndex(kept[i]), kept[i] % tokensPerBlock, poolIndex(i), i % tokensPerBlock});
+                }
+            }
+            bufferManager.copy(compactedMass.data(), *runtime::ITensor::slice(row, {0, 0}, numCachedTokens),
+                runtime::MemoryType::kCPU);
+            moveOffsets.push_back(static_cast<std::int32_t>(moves.size()));
+            evictions.emplace_back(request->mRequestId, numCachedTokens - numKept);
+        }
+        if (evictions.empty())
+        {
+            return 0;
+        }
+
+        // Stream-ordered allocations, released once the kernels are done with them.
+        auto const deviceMoves
+            = bufferManager.gpu(moves.size() * sizeof(kernels::KVTokenMove), nvinfer1::DataType::kUINT8);
+        bufferManager.copy(moves.data(), *deviceMoves, runtime::MemoryType::kCPU);
+        auto const deviceMoveOffsets = bufferManager.copyFrom(moveOffsets, runtime::MemoryType::kGPU);
+        for (SizeType32 poolIdx = 0; poolIdx < blockManager.getNumPools(); ++poolIdx)
+        {
+            auto const pool = blockManager.getPrimaryPool(poolIdx);
+            auto const blockNumel = static_cast<std::int64_t>(pool->getSize() / pool->getShape().d[0]);
+            auto const tokenNumel = static_cast<std::int64_t>(mSizePerHead);
+            kernels::KVTokenCompactionParams const params{pool->data(),
+                static_cast<std::int32_t>(blockNumel / (tokensPerBlock * tokenNumel)), tokensPerBlock,
+                static_cast<std::int32_t>(
+                    tokenNumel * static_cast<std::int64_t>(runtime::BufferDataType(pool->getDataType()).getSize())),
+                static_cast<kernels::KVTokenMove const*>(deviceMoves->data()),
+                runtime::bufferCast<std::int32_t>(*deviceMoveOffsets), static_cast<std::int32_t>(evictions.size())};
+            kernels::invokeCompactKVTokens(params, bufferManager.getStream().get());
+        }
+
+        SizeType32 numEvicted{0};
+        for (auto const& [requestId, numTokens] : evictions)
+        {
+            // Frees the blocks that are empty after the compaction.
+            for (SizeType32 i = 0; i < numTokens; ++i)
+            {
+                kvCacheManager.removeToken(requestId);
+            }
+            mNumEvictedTokens[requestId] += numTokens;
+            numEvicted += numTokens;
+        }
+        return numEvicted;
+    }
+
+    //! \brief Evictor active for the forward pass enqueued by the calling thread, or nullptr.
+    [[nodiscard]] static KVCacheTokenEvictor const* getActive()
+    {
+        return activeEvictor();
+    }
+
+    //! \brief Make evictor visible to the attention plugin while the engine is enqueued.
+    class ScopedActivation
+    {
+    public:
+        explicit ScopedActivation(KVCacheTokenEvictor const* evictor)
+            : mPrevious{activeEvictor()}
+        {
+            activeEvictor() = evictor;
+        }
+
+        ~ScopedActivation()
+        {
+            activeEvictor() = mPrevious;
+        }
+
+        ScopedActivation(ScopedActivation const&) = delete;
+        ScopedActivation& operator=(ScopedActivation const&) = delete;
+
+    private:
+        KVCacheTokenEvictor const* mPrevious;
+    };
+
+private:
+    //! \brief Positions of the tokens to keep, in increasing order.
+    [[nodiscard]] std::vector<SizeType32> selectKeptTokens(
+        std::vector<float> const& mass, SizeType32 numProtectedTokens) const
+    {
+        auto const numTokens = static_cast<SizeType32>(mass.size());
+        auto const recentBegin = std::max(numTokens - mConfig.numRecentTokens, 0);
+        auto const protectedEnd = std::min(numProtectedTokens, recentBegin);
+        auto const numHeavyHitters
+            = std::max(mConfig.tokenBudget - protectedEnd - (numTokens - recentBegin), static_cast<SizeType32>(0));
+
+        std::vector<SizeType32> candidates(recentBegin - protectedEnd);
+        std::iota(candidates.begin(), candidates.end(), protectedEnd);
+        if (static_cast<SizeType32>(candidates.size()) > numHeavyHitters)
+        {
+            std::nth_element(candidates.begin(), candidates.begin() + numHeavyHitters, candidates.end(),
+                [&mass](SizeType32 a, SizeType32 b) { return mass[a] > mass[b]; });
+            candidates.resize(numHeavyHitters);
+        }
+
+        std::vector<SizeType32> kept(protectedEnd);
+        std::iota(kept.begin(), kept.end(), 0);
+        std::sort(candidates.begin(), candidates.end());
+        kept.insert(kept.end(), candidates.begin(), candidates.end());
+        for (auto i = recentBegin; i < numTokens; ++i)
+        {
+            kept.push_back(i);
+        }
+        return kept;
+    }
+
+    static KVCacheTokenEvictor const*& activeEvictor()
+    {
+        thread_local KVCacheTokenEvictor const* evictor{nullptr};
+        return evictor;
+    }
+
+    Config mConfig;
+    SizeType32 mMaxAttentionWindow;
+    SizeType32 mSizePerHead;
+    // [maxNumSequences, maxAttentionWindow]
+    runtime::ITensor::SharedPtr mAttentionMass;
+    // Row of every batch entry of the current forward pass.
+    runtime::ITensor::SharedPtr mRows;
+    std::unordered_map<RequestIdType, SizeType32> mRowByRequest;
+    std::vector<SizeType32> mFreeRows;
+    std::unordered_map<RequestIdType, SizeType32> mNumEvictedTokens;
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
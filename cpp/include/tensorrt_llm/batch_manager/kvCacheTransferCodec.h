@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/kernels/kvCacheOffloadQuantization.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+#ifdef ENABLE_FP8
+
+// FP8 encoding of KV cache blocks for the transfer from context to generation instances, enabled by
+// TRTLLM_KV_CACHE_TRANSFER_FP8. The sender quantizes the blocks of a request into a device buffer with one scale per
+// layer and K/V block, using the offload quantization kernels, the transport ships that buffer and the receiver
+// expands it into its own pool. FP16 and BF16 caches cross the network at half their size, which matters when the
+// transfer of long prompts over RoCE, not the prefill, bounds TTFT.
+//
+// The wire buffer holds, for every pool, the FP8 blocks [numBlocks, blockNumel] followed by their scales
+// [numBlocks, numChunks], each section aligned to kAlignment bytes.
+class KVCacheTransferCodec
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using TensorPtr = runtime::ITensor::SharedPtr;
+
+    static constexpr std::size_t kAlignment{256};
+
+    struct Stats
+    {
+        std::int64_t numBlocks{0};
+        std::int64_t numRawBytes{0};
+        std::int64_t numEncodedBytes{0};
+        //! \brief Time the transport spent on the encoded bytes.
+        double transferSeconds{0.};
+
+        [[nodiscard]] double getCompressionRatio() const
+        {
+            return numEncodedBytes == 0 ? 1. : static_cast<double>(numRawBytes) / static_cast<double>(numEncodedBytes);
+        }
+
+        //! \brief Encoded bytes per second on the wire.
+        [[nodiscard]] double getBandwidth() const
+        {
+            return transferSeconds > 0. ? static_cast<double>(numEncodedBytes) / transferSeconds : 0.;
+        }
+
+        //! \brief Bytes of KV cache delivered per second.
+        [[nodiscard]] double getEffectiveBandwidth() const
+        {
+            return transferSeconds > 0. ? static_cast<double>(numRawBytes) / transferSeconds : 0.;
+        }
+    };
+
+    [[nodiscard]] static bool isSupported(std::vector<KVCacheBlockPool> const& pools)
+    {
+        return std::all_of(pools.begin(), pools.end(),
+            [](KVCacheBlockPool const& pool)
+            {
+                auto const dataType = pool.primaryPtr->getDataType();
+                return !pool.containsBlockScales
+                    && (dataType == nvinfer1::DataType::kHALF || dataType == nvinfer1::DataType::kBF16
+                        || dataType == nvinfer1::DataType::kFLOAT);
+            });
+    }
+
+    explicit KVCacheTransferCodec(std::vector<KVCacheBlockPool> const& pools)
+    {
+        TLLM_CHECK_WITH_INFO(isSupported(pools), "FP8 KV cache transfer requires a FP16, BF16 or FP32 KV cache");
+        for (auto const& pool : pools)
+        {
+            auto const blockNumel
+                = static_cast<std::int64_t>(pool.primaryPtr->getSize() / pool.primaryPtr->getShape().d[0]);
+            mPools.push_back(Pool{pool.primaryPtr, blockNumel, static_cast<std::int64_t>(pool.blockSize)});
+        }
+    }
+
+    //! \brief Size of the wire buffer of numBlocks blocks.
+    [[nodiscard]] std::size_t getEncodedSizeInBytes(SizeType32 numBlocks) const
+    {
+        std::size_t size{0};
+        for (auto const& pool : mPools)
+        {
+            auto const [dataSize, scalesSize] = getSectionSizes(pool, numBlocks);
+            size += dataSize + scalesSize;
+        }
+        return size;
+    }
+
+    //! \brief Bytes the blocks occupy in the pools.
+    [[nodiscard]] std::size_t getRawSizeInBytes(SizeType32 numBlocks) const
+    {
+        std::size_t size{0};
+        for (auto const& pool : mPools)
+        {
+            size += static_cast<std::size_t>(numBlocks) * pool.blockNumel
+                * runtime::BufferDataType(pool.primary->getDataType()).getSize();
+        }
+        return size;
+    }
+
+    //! \brief Quantize the blocks at memoryPoolBlockIndices into wire, a device buffer of getEncodedSizeInBytes.
+    void encode(std::vector<SizeType32> const& memoryPoolBlockIndices, runtime::IBuffer& wire,
+        runtime::BufferManager const& bufferManager) const
+    {
+        run(memoryPoolBlockIndices, wire, bufferManager, true);
+    }
+
+    //! \brief Expand a received wire buffer into the blocks at memoryPoolBlockIndices.
+    void decode(runtime::IBuffer const& wire, std::vector<SizeType32> const& memoryPoolBlockIndices,
+        runtime::BufferManager const& bufferManager) const
+    {
+        run(memoryPoolBlockIndices, const_cast<runtime::IBuffer&>(wire), bufferManager, false);
+    }
+
+    //! \brief Account a transfer of numBlocks blocks that took transferSeconds.
+    void recordTransfer(SizeType32 numBlocks, double transferSeconds)
+    {
+        mStats.numBlocks += numBlocks;
+        mStats.numRawBytes += static_cast<std::int64_t>(getRawSizeInBytes(numBlocks));
+        mStats.numEncodedBytes += static_cast<std::int64_t>(getEncodedSizeInBytes(numBlocks));
+        mStats.transferSeconds += transferSeconds;
+    }
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+private:
+    struct Pool
+    {
+        TensorPtr primary;
+        std::int64_t blockNumel;
+        std::int64_t chunkSize;
+    };
+
+    static std::size_t align(std::size_t size)
+    {
+        return (size + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+    //! \brief Aligned sizes of the data and the scales of a pool.
+    [[nodiscard]] static std::pair<std::size_t, std::size_t> getSectionSizes(Pool const& pool, SizeType32 numBlocks)
+    {
+        auto const numElements = static_cast<std::size_t>(numBlocks) * pool.blockNumel;
+        return {align(numElements), align(numElements / pool.chunkSize * sizeof(float))};
+    }
+
+    void run(std::vector<SizeType32> const& memoryPoolBlockIndices, runtime::IBuffer& wire,
+        runtime::BufferManager const& bufferManager, bool isEncode) const
+    {
+        auto const numBlocks = static_cast<SizeType32>(memoryPoolBlockIndices.size());
+        if (numBlocks == 0)
+        {
+            return;
+        }
+        TLLM_CHECK_WITH_INFO(wire.getSizeInBytes() >= getEncodedSizeInBytes(numBlocks),
+            "Wire buffer of %zu bytes cannot hold %d encoded blocks", wire.getSizeInBytes(), numBlocks);
+        // The blocks are packed in the order of memoryPoolBlockIndices.
+        std::vector<std::int32_t> indices(memoryPoolBlockIndices.begin(), memoryPoolBlockIndices.end());
+        indices.resize(2 * numBlocks);
+        std::iota(indices.begin() + numBlocks, indices.end(), 0);
+        // Stream-ordered allocation, released once the kernels below are done with it.
+        auto const deviceIndices = bufferManager.copyFrom(indices, runtime::MemoryType::kGPU);
+        auto const* indicesPtr = runtime::bufferCast<std::int32_t>(*deviceIndices);
+        auto const stream = bufferManager.getStream().get();
+
+        auto* section = static_cast<std::uint8_t*>(wire.data());
+        for (auto const& pool : mPools)
+        {
+            auto const [dataSize, scalesSize] = getSectionSizes(pool, numBlocks);
+            auto* data = reinterpret_cast<__nv_fp8_e4m3*>(section);
+            auto* scales = reinterpret_cast<float*>(section + dataSize);
+            section += dataSize + scalesSize;
+
+            kernels::KVBlockQuantizationParams const params{
+                numBlocks, pool.blockNumel, pool.chunkSize, indicesPtr, indicesPtr + numBlocks};
+            switch (pool.primary->getDataType())
+            {
+            case nvinfer1::DataType::kHALF: dispatch<half>(params, pool.primary, data, scales, stream, isEncode); break;
+#ifdef ENABLE_BF16
+            case nvinfer1::DataType::kBF16:
+                dispatch<__nv_bfloat16>(params, pool.primary, data, scales, stream, isEncode);
+                break;
+#endif // ENABLE_BF16
+            case nvinfer1::DataType::kFLOAT:
+                dispatch<float>(params, pool.primary, data, scales, stream, isEncode);
+                break;
+            default: TLLM_THROW("Unsupported KV cache data type for FP8 transfer");
+            }
+        }
+    }
+
+    template <typename T>
+    static void dispatch(kernels::KVBlockQuantizationParams const& params, TensorPtr const& primary,
+        __nv_fp8_e4m3* data, float* scales, cudaStream_t stream, bool isEncode)
+    {
+        auto* primaryPtr = static_cast<T*>(primary->data());
+        if (isEncode)
+        {
+            kernels::invokeQuantizeKVBlocks<T>(params, primaryPtr, data, scales, stream);
+        }
+        else
+        {
+            kernels::invokeDequantizeKVBlocks<T>(params, data, scales, primaryPtr, stream);
+        }
+    }
+
+    std::vector<Pool> mPools;
+    Stats mStats;
+};
+
+#endif // ENABLE_FP8
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
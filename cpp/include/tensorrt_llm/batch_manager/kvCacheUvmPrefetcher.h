@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::kv_cache_manager
+{
+
+// Prefetch policy for block pools allocated in UVM, see BlockManager::allocatePools(dtype, useUvm). With UVM the pools
+// can be larger than the device memory, e.g. on Grace Hopper where the host memory is coherent, but a block that is
+// not resident when the attention kernel reads it is migrated by page faults, which stalls the whole step.
+//
+// The scheduler knows which blocks the next step reads. Once the current step is enqueued, call update with the
+// requests scheduled for the next step and the requests that were paused: the blocks of the scheduled requests are
+// prefetched to the device on a side stream, overlapping with the current step, and the blocks of the paused requests
+// are advised to live on the host and migrated there once the current step is done with them, which makes room for the
+// prefetches. Blocks shared with a scheduled request, e.g. reused prefix blocks, are never demoted.
+// Like KVCacheSwapper::swapOut, update must see the paused requests before their sequences are removed.
+//
+// Prefetches are hints: a block that is not resident yet is still read correctly, through page faults.
+class KVCacheUvmPrefetcher
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using TensorPtr = runtime::ITensor::SharedPtr;
+
+    struct Stats
+    {
+        std::size_t numPrefetchedBlocks{0};
+        std::size_t numDemotedBlocks{0};
+        std::size_t numPrefetchedBytes{0};
+        std::size_t numDemotedBytes{0};
+    };
+
+    //! \param pools Primary pools of shape [numBlocks, ...]. Pools that are not in UVM are ignored.
+    explicit KVCacheUvmPrefetcher(std::vector<TensorPtr> pools, runtime::BufferManager::CudaStreamPtr stream = nullptr)
+        : mStream{stream ? std::move(stream) : std::make_shared<runtime::CudaStream>()}
+    {
+        for (auto& pool : pools)
+        {
+            TLLM_CHECK(pool != nullptr && pool->getShape().nbDims > 0);
+            if (pool->getMemoryType() == runtime::MemoryType::kUVM)
+            {
+                mPools.push_back(std::move(pool));
+            }
+        }
+    }
+
+    //! \brief Prefetcher of the primary pools of the block manager.
+    [[nodiscard]] static KVCacheUvmPrefetcher fromKvCacheManager(
+        BaseKVCacheManager const& kvCacheManager, runtime::BufferManager::CudaStreamPtr stream = nullptr)
+    {
+        auto const& blockManager = kvCacheManager.getBlockManager();
+        std::vector<TensorPtr> pools;
+        for (SizeType32 poolIdx = 0; poolIdx < blockManager.getNumPools(); ++poolIdx)
+        {
+            pools.push_back(blockManager.getPrimaryPool(poolIdx));
+        }
+        KVCacheUvmPrefetcher prefetcher{std::move(pools), std::move(stream)};
+        if (!prefetcher.isEnabled())
+        {
+            TLLM_LOG_DEBUG("KV cache pools are not in UVM, blocks will not be prefetched");
+        }
+        return prefetcher;
+    }
+
+    //! \brief Whether there is a pool in UVM.
+    [[nodiscard]] bool isEnabled() const noexcept
+    {
+        return !mPools.empty();
+    }
+
+    //! \brief Indices in the primary pools of the blocks of the requests, sorted and without duplicates. Blocks
+    //! offloaded to the secondary pools are skipped.
+    [[nodiscard]] static std::vector<SizeType32> getPrimaryBlockIndices(
+        BaseKVCacheManager const& kvCacheManager, RequestVector const& requests)
+    {
+        auto const& blockManager = kvCacheManager.getBlockManager();
+        std::vector<SizeType32> indices;
+        for (auto const& request : requests)
+        {
+            for (auto const& beamBlockIds : kvCacheManager.getCacheBlockIds(request->mRequestId))
+            {
+                for (auto const blockId : beamBlockIds)
+                {
+                    auto const& block = blockManager.getBlockById(blockId);
+                    if (block->isPrimary())
+                    {
+                        indices.push_back(static_cast<SizeType32>(block->getMemoryPoolBlockIndex()));
+                    }
+                }
+            }
+        }
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+        return indices;
+    }
+
+    //! \brief Prefetch the blocks of the scheduled requests and demote the blocks of the paused ones, see class.
+    void update(BaseKVCacheManager const& kvCacheManager, RequestVector const& scheduledRequests,
+        RequestVector const& pausedRequests, runtime::CudaStream const& computeStream)
+    {
+        if (!isEnabled())
+        {
+            return;
+        }
+        auto const scheduled = getPrimaryBlockIndices(kvCacheManager, scheduledRequests);
+        auto paused = getPrimaryBlockIndices(kvCacheManager, pausedRequests);
+        std::unordered_set<SizeType32> const scheduledSet(scheduled.begin(), scheduled.end());
+        paused.erase(std::remove_if(paused.begin(), paused.end(),
+                         [&scheduledSet](SizeType32 idx) { return scheduledSet.count(idx) > 0; }),
+            paused.end());
+        demote(paused, computeStream);
+        prefetch(scheduled, computeStream.getDevice());
+    }
+
+    //! \brief Migrate the blocks to the device on the side stream.
+    void prefetch(std::vector<SizeType32> const& blockIndices, int device)
+    {
+        forEachRange(blockIndices,
+            [this, device](void* ptr, std::size_t bytes)
+            {
+                TLLM_CUDA_CHECK(cudaMemAdvise(ptr, bytes, cudaMemAdviseSetPreferredLocation, device));
+                TLLM_CUDA_CHECK(cudaMemPrefetchAsync(ptr, bytes, device, mStream->get()));
+                mStats.numPrefetchedBytes += bytes;
+            });
+        mStats.numPrefetchedBlocks += blockIndices.size();
+    }
+
+    //! \brief Migrate the blocks to the host once the work enqueued on computeStream is done.
+    void demote(std::vector<SizeType32> const& blockIndices, runtime::CudaStream const& computeStream)
+    {
+        if (blockIndices.empty())
+        {
+            return;
+        }
+        runtime::CudaEvent done;
+        computeStream.record(done);
+        mStream->wait(done);
+        forEachRange(blockIndices,
+            [this](void* ptr, std::size_t bytes)
+            {
+                TLLM_CUDA_CHECK(cudaMemAdvise(ptr, bytes, cudaMemAdviseSetPreferredLocation, cudaCpuDeviceId));
+                TLLM_CUDA_CHECK(cudaMemPrefetchAsync(ptr, bytes, cudaCpuDeviceId, mStream->get()));
+                mStats.numDemotedBytes += bytes;
+            });
+        mStats.numDemotedBlocks += blockIndices.size();
+    }
+
+    //! \brief Map the pools in the page tables of the device, so that it reads the blocks resident on the host in
+    //! place rather than faulting them in. With a coherent host link, e.g. NVLink-C2C, such reads are close to HBM
+    //! speed and a block only needs to migrate once it is hot, see KVCacheHostDirectTier.
+    void mapPoolsOnDevice(int device) const
+    {
+        for (auto const& pool : mPools)
+        {
+            TLLM_CUDA_CHECK(cudaMemAdvise(pool->data(), pool->getSizeInBytes(), cudaMemAdviseSetAccessedBy, device));
+        }
+    }
+
+    //! \brief Make computeStream wait for the prefetches, e.g. when a step cannot afford any page fault.
+    void syncPrefetches(runtime::CudaStream const& computeStream) const
+    {
+        runtime::CudaEvent done;
+        mStream->record(done);
+        computeStream.wait(done);
+    }
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+private:
+    //! \brief Call func on the memory of every run of consecutive blocks in every pool.
+    template <typename Func>
+    void forEachRange(std::vector<SizeType32> const& blockIndices, Func&& func) const
+    {
+        for (auto const& pool : mPools)
+        {
+            auto const numBlocks = static_cast<SizeType32>(pool->getShape().d[0]);
+            auto const blockBytes = pool->getSizeInBytes() / numBlocks;
+            auto* base = static_cast<std::uint8_t*>(pool->data());
+            for (std::size_t first = 0; first < blockIndices.size();)
+            {
+                auto last = first;
+                while (last + 1 < blockIndices.size() && blockIndices[last + 1] == blockIndices[last] + 1)
+                {
+                    ++last;
+                }
+                TLLM_CHECK_WITH_INFO(blockIndices[last] < numBlocks, "Block %d out of a pool of %d blocks",
+                    blockIndices[last], numBlocks);
+                func(base + blockIndices[first] * blockBytes, (last - first + 1) * blockBytes);
+                first = last + 1;
+            }
+        }
+    }
+
+    std::vector<TensorPtr> mPools;
+    runtime::BufferManager::CudaStreamPtr mStream;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::batch_manager::kv_cache_manager
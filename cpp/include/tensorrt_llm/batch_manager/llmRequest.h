@@ -631,6 +631,13 @@ public:
         return mEncoderUniqueTokens;
     }
 
+    /// @brief Set the unique tokens keying the cross KV cache blocks of the request, for feature inputs
+    /// @param encoderUniqueTokens A vector of UniqueTokens of the encoder output length
+    void setEncoderUniqueTokens(std::shared_ptr<VecUniqueTokens> encoderUniqueTokens)
+    {
+        mEncoderUniqueTokens = std::move(encoderUniqueTokens);
+    }
+
     /// @brief Get length of encoder input (could be tokens or features length)
     /// @return An integer.
     [[nodiscard]] SizeType32 getEncoderInputLen() const
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "common.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Shapes the context chunks of a step around the optimization profiles of the engine.
+//! \details The engine selects its profile by the number of tokens of the step against the split points of
+//! ModelConfig::getOptProfilesSplitPoints, like TllmRuntime::getOptProfileId, so a step a few tokens past a split point
+//! runs on the kernels tuned for the next profile. The latency of every profile is modelled as fixedLatency +
+//! numTokens * perTokenLatency, measured at startup by calibrate. After the MicroBatchScheduler has chunked the
+//! context requests, adjustChunks trims the chunks down to a split point, or tops them up to the end of the profile,
+//! when the predicted throughput of the step improves. Chunks only move by multiples of the chunk unit, so the KV cache
+//! blocks stay aligned, and the blocks of the whole prompt are already allocated by the capacity scheduler, so a
+//! larger chunk needs no more blocks.
+class OptProfileTokenBucketer
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using Duration = std::chrono::duration<double>;
+    //! \brief Runs a step of the given number of tokens, e.g. a dummy context request, and returns its latency.
+    using StepRunner = std::function<Duration(SizeType32)>;
+
+    struct Config
+    {
+        //! \brief Split points of the profiles, see ModelConfig::getOptProfilesSplitPoints.
+        std::vector<SizeType32> splitPoints;
+        //! \brief maxNumTokens of the engine, the end of the last profile.
+        SizeType32 maxNumTokens;
+        SizeType32 chunkUnitSize{1};
+        //! \brief Relative throughput gain under which a step is left as scheduled.
+        double minRelativeGain{0.02};
+    };
+
+    struct ProfileModel
+    {
+        double fixedLatency{0.};
+        double perTokenLatency{0.};
+    };
+
+    explicit OptProfileTokenBucketer(Config config)
+        : mConfig{std::move(config)}
+        , mModels(mConfig.splitPoints.size() + 1)
+    {
+        TLLM_CHECK(mConfig.maxNumTokens > 0 && mConfig.chunkUnitSize > 0 && mConfig.minRelativeGain >= 0.);
+        TLLM_CHECK_WITH_INFO(std::is_sorted(mConfig.splitPoints.begin(), mConfig.splitPoints.end()),
+            "The split points of the optimization profiles must be sorted");
+    }
+
+    [[nodiscard]] SizeType32 getNbProfiles() const noexcept
+    {
+        return static_cast<SizeType32>(mModels.size());
+    }
+
+    //! \brief The profile the engine selects for a step of numTokens, as TllmRuntime::getOptProfileId.
+    [[nodiscard]] SizeType32 getProfileId(SizeType32 numTokens) const
+    {
+        auto const it = std::lower_bound(mConfig.splitPoints.begin(), mConfig.splitPoints.end(), numTokens);
+        return static_cast<SizeType32>(std::distance(mConfig.splitPoints.begin(), it));
+    }
+
+    //! \brief The first and last number of tokens of a profile.
+    [[nodiscard]] std::pair<SizeType32, SizeType32> getProfileRange(SizeType32 profileId) const
+    {
+        TLLM_CHECK(profileId >= 0 && profileId < getNbProfiles());
+        auto const& splitPoints = mConfig.splitPoints;
+        auto const first = profileId > 0 ? splitPoints[profileId - 1] + 1 : 1;
+        auto const last = profileId < static_cast<SizeType32>(splitPoints.size())
+            ? std::min(splitPoints[profileId], mConfig.maxNumTokens)
+            : mConfig.maxNumTokens;
+        return {first, last};
+    }
+
+    //! \brief Measure the profiles with two steps each, at their first and last number of tokens, after a warmup step.
+    //! Profiles past maxNumTokens are skipped.
+    void calibrate(StepRunner const& runStep)
+    {
+        for (SizeType32 profileId = 0; profileId < getNbProfiles(); ++profileId)
+        {
+            auto const [first, last] = getProfileRange(profileId);
+            if (first > last)
+            {
+                continue;
+            }
+            static_cast<void>(runStep(first));
+            auto const firstLatency = runStep(first).count();
+            auto const lastLatency = last > first ? runStep(last).count() : firstLatency;
+            auto const slope = last > first ? std::max((lastLatency - firstLatency) / (last - first), 0.) : 0.;
+            setProfileModel(profileId, ProfileModel{std::max(firstLatency - slope * first, 0.), slope});
+        }
+    }
+
+    void setProfileModel(SizeType32 profileId, ProfileModel const& model)
+    {
+        TLLM_CHECK(profileId >= 0 && profileId < getNbProfiles());
+        mModels[profileId] = model;
+        mCalibrated = true;
+    }
+
+    [[nodiscard]] ProfileModel const& getProfileModel(SizeType32 profileId) const
+    {
+        return mModels.at(profileId);
+    }
+
+    //! \brief Whether there are several profiles and a latency model for them.
+    [[nodiscard]] bool isEnabled() const noexcept
+    {
+        return mCalibrated && getNbProfiles() > 1;
+    }
+
+    [[nodiscard]] double predictLatency(SizeType32 numTokens) const
+    {
+        auto const& model = mModels[getProfileId(numTokens)];
+        return model.fixedLatency + numTokens * model.perTokenLatency;
+    }
+
+    //! \brief The number of tokens in [minNumTokens, maxNumTokens] with the best predicted throughput, among the ends
+    //! of the profiles and the range itself, or numTokens if none is better by minRelativeGain.
+    [[nodiscard]] SizeType32 getTargetNumTokens(
+        SizeType32 numTokens, SizeType32 minNumTokens, SizeType32 maxNumTokens) const
+    {
+        if (!isEnabled() || numTokens <= 0)
+        {
+            return numTokens;
+        }
+        auto const throughput = [this](SizeType32 n)
+        {
+            auto const latency = predictLatency(n);
+            return latency > 0. ? n / latency : 0.;
+        };
+        auto bestNumTokens = numTokens;
+        auto bestThroughput = throughput(numTokens) * (1. + mConfig.minRelativeGain);
+        auto const consider = [&](SizeType32 n)
+        {
+            if (n >= std::max(minNumTokens, 1) && n <= maxNumTokens && throughput(n) > bestThroughput)
+            {
+                bestNumTokens = n;
+                bestThroughput = throughput(n);
+            }
+        };
+        for (SizeType32 profileId = 0; profileId < getNbProfiles(); ++profileId)
+        {
+            consider(getProfileRange(profileId).second);
+        }
+        consider(minNumTokens);
+        consider(maxNumTokens);
+        return bestNumTokens;
+    }
+
+    //! \brief Trim or top up the chunks of the context requests scheduled by the MicroBatchScheduler.
+    //! \param numGenerationTokens The tokens of the generation requests of the step, including their draft tokens.
+    //! \param maxNumTokens The token budget of the step, maxNumTokensRuntime of the scheduler.
+    //! \return The number of tokens of the step.
+    SizeType32 adjustChunks(RequestVector const& contextRequests, SizeType32 numGenerationTokens,
+        std::optional<SizeType32> maxNumTokens = std::nullopt,
+        std::optional<SizeType32> const& maxContextLength = std::nullopt) const
+    {
+        SizeType32 numTokens{numGenerationTokens};
+        SizeType32 numTrimmable{0};
+        SizeType32 numToppable{0};
+        for (auto const& request : contextRequests)
+        {
+            auto const [minChunk, maxChunk] = getChunkRange(*request, maxContextLength);
+            auto const chunk = request->getContextChunkSize();
+            numTokens += chunk;
+            numTrimmable += chunk - minChunk;
+            numToppable += maxChunk - chunk;
+        }
+        auto const budget = std::min(maxNumTokens.value_or(mConfig.maxNumTokens), mConfig.maxNumTokens);
+        auto const target = getTargetNumTokens(
+            numTokens, numTokens - numTrimmable, std::max(std::min(numTokens + numToppable, budget), numTokens));
+        if (target < numTokens)
+        {
+            // Trim the last requests first, they were scheduled with the lowest priority.
+            for (auto it = contextRequests.rbegin(); it != contextRequests.rend() && numTokens > target; ++it)
+            {
+                auto& request = **it;
+                auto const chunk = request.getContextChunkSize();
+                auto const minChunk = getChunkRange(request, maxContextLength).first;
+                auto const newChunk = std::max(alignChunk(request, chunk - (numTokens - target)), minChunk);
+                // A chunk rounded down to a block boundary may leave the step a few tokens under the target.
+                if (newChunk < chunk)
+                {
+                    request.setContextChunkSize(newChunk);
+                    numTokens -= chunk - newChunk;
+                }
+            }
+        }
+        else if (target > numTokens)
+        {
+            for (auto const& request : contextRequests)
+            {
+                auto const chunk = request->getContextChunkSize();
+                auto const maxChunk = getChunkRange(*request, maxContextLength).second;
+                auto const newChunk = std::min(alignChunk(*request, chunk + (target - numTokens)), maxChunk);
+                if (newChunk > chunk)
+                {
+                    request->setContextChunkSize(newChunk);
+                    numTokens += newChunk - chunk;
+                }
+                if (numTokens >= target)
+                {
+                    break;
+                }
+            }
+        }
+        return numTokens;
+    }
+
+private:
+    //! \brief The largest chunk of at most size that ends on a chunk unit boundary or at the end of the prompt.
+    [[nodiscard]] SizeType32 alignChunk(LlmRequest const& request, SizeType32 size) const
+    {
+        auto const remaining = request.getContextRemainingLength();
+        if (size >= remaining)
+        {
+            return remaining;
+        }
+        auto const position = request.getContextCurrentPosition();
+        auto const unit = mConfig.chunkUnitSize;
+        return std::max((position + size) / unit * unit - position, 0);
+    }
+
+    //! \brief The chunks a request can be trimmed or topped up to. Requests with draft tokens, which only fit in their
+    //! last chunk, keep the chunk of the scheduler.
+    [[nodiscard]] std::pair<SizeType32, SizeType32> getChunkRange(
+        LlmRequest const& request, std::optional<SizeType32> const& maxContextLength) const
+    {
+        auto const chunk = request.getContextChunkSize();
+        if (request.hasDraftTokens())
+        {
+            return {chunk, chunk};
+        }
+        // A chunk can not be trimmed under one chunk unit, nor to nothing.
+        auto const unitChunk = alignChunk(request, mConfig.chunkUnitSize);
+        auto const minChunk = unitChunk > 0 ? std::min(unitChunk, chunk) : chunk;
+        auto const maxSize = std::min(
+            request.getContextRemainingLength(), maxContextLength.value_or(std::numeric_limits<SizeType32>::max()));
+        auto const maxChunk = std::max(alignChunk(request, maxSize), chunk);
+        return {minChunk, maxChunk};
+    }
+
+    Config mConfig;
+    std::vector<ProfileModel> mModels;
+    bool mCalibrated{false};
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Bookkeeping of the overlap scheduler, which launches step N+1 before the outputs of step N are processed on
+//! the host.
+//! \details Step N+1 reads the new tokens of step N from the device, so the host work of step N (forwardSync, updating
+//! the LlmRequest tokens, stop checks, responses) runs while step N+1 executes. The price is that a request which
+//! finished at step N has already been decoded once more at step N+1. That token is speculative: the host discards it
+//! when step N+1 is processed, and the resources of the request (sequence slot, KV cache blocks) are only released
+//! once no step in flight uses them anymore.
+class OverlapStepScheduler
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+    using StepIdType = std::uint64_t;
+
+    //! \brief Outcome of processing the oldest step in flight.
+    struct CompletedStep
+    {
+        StepIdType stepId{0};
+        //! \brief Requests whose tokens of this step are valid.
+        std::vector<RequestIdType> validRequests;
+        //! \brief Requests that finished at an earlier step. Their tokens of this step must be discarded.
+        std::vector<RequestIdType> discardedRequests;
+        //! \brief Finished requests that no step in flight uses anymore, their resources can be released. They are
+        //! forgotten by the scheduler.
+        std::vector<RequestIdType> releasableRequests;
+    };
+
+    //! \brief maxStepsInFlight is 2 to overlap the host work of one step with the next one.
+    explicit OverlapStepScheduler(SizeType32 maxStepsInFlight = 2)
+        : mMaxStepsInFlight{maxStepsInFlight}
+    {
+        TLLM_CHECK_WITH_INFO(maxStepsInFlight >= 1, "maxStepsInFlight must be at least 1");
+    }
+
+    //! \brief Whether the overlap scheduler is enabled for the executor loop.
+    [[nodiscard]] static bool isEnabled()
+    {
+        return common::getEnvOverlapScheduler();
+    }
+
+    //! \brief Whether another step can be launched before the oldest step in flight is processed.
+    [[nodiscard]] bool canLaunch() const
+    {
+        return static_cast<SizeType32>(mStepsInFlight.size()) < mMaxStepsInFlight;
+    }
+
+    //! \brief Whether a request can be scheduled in a new step. Requests known to be finished are not, even if their
+    //! resources cannot be released yet.
+    [[nodiscard]] bool isSchedulable(RequestIdType requestId) const
+    {
+        auto const it = mRequests.find(requestId);
+        return it == mRequests.end() || !it->second.finished;
+    }
+
+    //! \brief Record the launch of a step decoding requestIds.
+    StepIdType launch(std::vector<RequestIdType> requestIds)
+    {
+        TLLM_CHECK_WITH_INFO(canLaunch(), "%zu steps are in flight already", mStepsInFlight.size());
+        for (auto const requestId : requestIds)
+        {
+            TLLM_CHECK_WITH_INFO(isSchedulable(requestId), "Request %lu is finished", requestId);
+            ++mRequests[requestId].numStepsInFlight;
+        }
+        mStepsInFlight.push_back({mNextStepId, std::move(requestIds)});
+        return mNextStepId++;
+    }
+
+    //! \brief Process the oldest step in flight, once its outputs are on the host.
+    //! \param finishedRequests Requests that finished at this step, from the valid ones.
+    CompletedStep complete(std::vector<RequestIdType> const& finishedRequests)
+    {
+        TLLM_CHECK_WITH_INFO(!mStepsInFlight.empty(), "No step is in flight");
+        auto step = std::move(mStepsInFlight.front());
+        mStepsInFlight.pop_front();
+
+        CompletedStep completed;
+        completed.stepId = step.stepId;
+        for (auto const requestId : step.requestIds)
+        {
+            auto& state = mRequests.at(requestId);
+            --state.numStepsInFlight;
+            (state.finished ? completed.discardedRequests : completed.validRequests).push_back(requestId);
+        }
+        mNumDiscardedTokens += completed.discardedRequests.size();
+
+        for (auto const requestId : finishedRequests)
+        {
+            auto const it = mRequests.find(requestId);
+            TLLM_CHECK_WITH_INFO(it != mRequests.end() && !it->second.finished,
+                "Request %lu was not decoded by step %lu", requestId, step.stepId);
+            it->second.finished = true;
+        }
+
+        for (auto it = mRequests.begin(); it != mRequests.end();)
+        {
+            if (it->second.numStepsInFlight == 0)
+            {
+                if (it->second.finished)
+                {
+                    completed.releasableRequests.push_back(it->first);
+                }
+                it = mRequests.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        return completed;
+    }
+
+    [[nodiscard]] SizeType32 getNumStepsInFlight() const
+    {
+        return static_cast<SizeType32>(mStepsInFlight.size());
+    }
+
+    //! \brief Number of tokens decoded for requests that had finished already.
+    [[nodiscard]] std::size_t getNumDiscardedTokens() const
+    {
+        return mNumDiscardedTokens;
+    }
+
+private:
+    struct Step
+    {
+        StepIdType stepId;
+        std::vector<RequestIdType> requestIds;
+    };
+
+    struct RequestState
+    {
+        SizeType32 numStepsInFlight{0};
+        bool finished{false};
+    };
+
+    SizeType32 mMaxStepsInFlight;
+    StepIdType mNextStepId{0};
+    std::deque<Step> mStepsInFlight;
+    // Requests used by a step in flight.
+    std::unordered_map<RequestIdType, RequestState> mRequests;
+    std::size_t mNumDiscardedTokens{0};
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Dynamic batching of the requests of encoder-only models, e.g. BERT embedding or reranking services.
+//! \details The engines built with remove_input_padding take the tokens of all the sequences of a batch packed in one
+//! dimension, and the BERT attention plugin runs the variable-length FMHA over the sequence offsets, so a batch costs
+//! its number of tokens rather than batchSize * maxInputLength. nextBatch fills a budget of maxNumTokens from the
+//! oldest requests: the oldest one is always taken, and the ones among the next lookahead that fit in what is left of
+//! the budget join it. The requests that do not fit keep their place in the queue.
+class PackedEncoderBatcher
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using TokenIdType = tensorrt_llm::runtime::TokenIdType;
+    using VecTokens = std::vector<TokenIdType>;
+    using RequestIdType = std::uint64_t;
+
+    struct Request
+    {
+        RequestIdType requestId{0};
+        VecTokens inputTokens;
+        //! \brief Segment of every token, empty for all zeros.
+        VecTokens tokenTypeIds;
+    };
+
+    //! \brief The inputs of a packed engine step, the tokens of the requests one after the other.
+    struct PackedBatch
+    {
+        std::vector<RequestIdType> requestIds;
+        VecTokens inputIds;
+        VecTokens tokenTypeIds;
+        std::vector<SizeType32> positionIds;
+        std::vector<SizeType32> inputLengths;
+        //! \brief Tokens of request i are [seqOffsets[i], seqOffsets[i + 1]).
+        std::vector<SizeType32> seqOffsets{0};
+        SizeType32 maxInputLength{0};
+
+        [[nodiscard]] SizeType32 getBatchSize() const
+        {
+            return static_cast<SizeType32>(requestIds.size());
+        }
+
+        [[nodiscard]] SizeType32 getNumTokens() const
+        {
+            return static_cast<SizeType32>(inputIds.size());
+        }
+    };
+
+    PackedEncoderBatcher(SizeType32 maxNumTokens, SizeType32 maxBatchSize, SizeType32 lookahead = 64)
+        : mMaxNumTokens{maxNumTokens}
+        , mMaxBatchSize{maxBatchSize}
+        , mLookahead{lookahead}
+    {
+        TLLM_CHECK_WITH_INFO(maxNumTokens > 0 && maxBatchSize > 0, "Invalid token budget %d or batch size %d",
+            maxNumTokens, maxBatchSize);
+        TLLM_CHECK(lookahead >= 0);
+    }
+
+    void enqueue(Request request)
+    {
+        auto const numTokens = static_cast<SizeType32>(request.inputTokens.size());
+        TLLM_CHECK_WITH_INFO(numTokens > 0, "Request %lu has no input tokens", request.requestId);
+        TLLM_CHECK_WITH_INFO(numTokens <= mMaxNumTokens, "Request %lu has %d tokens, more than max_num_tokens %d",
+            request.requestId, numTokens, mMaxNumTokens);
+        TLLM_CHECK_WITH_INFO(request.tokenTypeIds.empty() || request.tokenTypeIds.size() == request.inputTokens.size(),
+            "Request %lu has %zu token types for %d tokens", request.requestId, request.tokenTypeIds.size(),
+            numTokens);
+        mPending.push_back(std::move(request));
+    }
+
+    [[nodiscard]] SizeType32 getNumPending() const
+    {
+        return static_cast<SizeType32>(mPending.size());
+    }
+
+    //! \brief The next batch, nullopt if no request is pending.
+    [[nodiscard]] std::optional<PackedBatch> nextBatch()
+    {
+        if (mPending.empty())
+        {
+            return std::nullopt;
+        }
+        PackedBatch batch;
+        auto remaining = mMaxNumTokens;
+        SizeType32 numVisited = 0;
+        for (auto it = mPending.begin(); it != mPending.end() && batch.getBatchSize() < mMaxBatchSize
+             && numVisited <= mLookahead && remaining > 0;
+             ++numVisited)
+        {
+            auto const numTokens = static_cast<SizeType32>(it->inputTokens.size());
+            if (numTokens > remaining)
+            {
+                ++it;
+                continue;
+            }
+            append(batch, *it);
+            remaining -= numTokens;
+            it = mPending.erase(it);
+        }
+        return batch;
+    }
+
+    [[nodiscard]] SizeType32 getMaxNumTokens() const
+    {
+        return mMaxNumTokens;
+    }
+
+private:
+    static void append(PackedBatch& batch, Request const& request)
+    {
+        auto const numTokens = static_cast<SizeType32>(request.inputTokens.size());
+        batch.requestIds.push_back(request.requestId);
+        batch.inputIds.insert(batch.inputIds.end(), request.inputTokens.begin(), request.inputTokens.end());
+        if (request.tokenTypeIds.empty())
+        {
+            batch.tokenTypeIds.insert(batch.tokenTypeIds.end(), numTokens, 0);
+        }
+        else
+        {
+            batch.tokenTypeIds.insert(
+                batch.tokenTypeIds.end(), request.tokenTypeIds.begin(), request.tokenTypeIds.end());
+        }
+        for (SizeType32 pos = 0; pos < numTokens; ++pos)
+        {
+            batch.positionIds.push_back(pos);
+        }
+        batch.inputLengths.push_back(numTokens);
+        batch.seqOffsets.push_back(batch.seqOffsets.back() + numTokens);
+        batch.maxInputLength = std::max(batch.maxInputLength, numTokens);
+    }
+
+    SizeType32 mMaxNumTokens;
+    SizeType32 mMaxBatchSize;
+    SizeType32 mLookahead;
+    std::deque<Request> mPending;
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,406 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheMemoryBroker.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/modelConfig.h"
+#include "tensorrt_llm/runtime/utils/sessionUtils.h"
+#include "tensorrt_llm/runtime/virtualDeviceMemory.h"
+#include "tensorrt_llm/runtime/worldConfig.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::rnn_state_manager
+{
+
+// Paged pool of the conv and SSM states of recurrent layers. RnnStateManager allocates the states of maxNumSequences
+// sequences up front; here every layer state lives in its own runtime::VirtualDeviceMemory range reserved for
+// maxNumSlots slots, of which only the pages holding live sequences are mapped. The base address of every layer stays
+// fixed, so the state pointers handed to the engine never change, and the sequences find their state through the slot
+// mapping.
+//
+// The mapped pages are accounted in a KVCacheMemoryBroker, as one more client next to the KV cache of the model, so the
+// memory of the two kinds of state follows the actual mix of sequences instead of a fixed split. Slots are handed out
+// lowest first and compact() moves the states of the sequences in the tail into free slots below, so that the tail
+// pages can be given back.
+//
+// Only beam width 1 is supported, like the paged state of RnnStateBuffers.
+class PagedRnnStatePool
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+    using TensorPtr = runtime::ITensor::SharedPtr;
+    using TensorMap = runtime::StringPtrMap<runtime::ITensor>;
+
+    struct Config
+    {
+        SizeType32 numLayers;
+        //! \brief The state of one sequence in one layer.
+        runtime::ITensor::Shape rnnStateShape;
+        runtime::ITensor::Shape convStateShape;
+        nvinfer1::DataType rnnDataType;
+        nvinfer1::DataType convDataType;
+        SizeType32 maxNumSlots;
+        //! \brief Granularity of mapping. A page should span the allocation granularity of the device in every layer.
+        SizeType32 slotsPerPage{8};
+    };
+
+    struct Stats
+    {
+        SizeType32 numMappedPages{0};
+        SizeType32 numUsedSlots{0};
+        std::int64_t numMovedSlots{0};
+        //! \brief Allocations refused because the pool could not grow.
+        std::int64_t numRefusals{0};
+    };
+
+    //! \brief The config of the states of the local recurrent layers, in the layout of RnnStateBuffers.
+    [[nodiscard]] static Config makeConfig(runtime::ModelConfig const& modelConfig,
+        runtime::WorldConfig const& worldConfig, SizeType32 maxNumSlots, SizeType32 slotsPerPage = 8)
+    {
+        auto const rnnConfig = modelConfig.getRnnConfig();
+        TLLM_CHECK_WITH_INFO(rnnConfig.has_value(), "The paged RNN state pool needs a model with an RNN config");
+        Config config;
+        config.numLayers = modelConfig.getNbRnnLayers(worldConfig.getPipelineParallelism());
+        config.rnnStateShape = rnnConfig->rnnHeadSize > 0
+            ? runtime::ITensor::makeShape({rnnConfig->rnnHiddenSize / rnnConfig->rnnHeadSize, rnnConfig->stateSize,
+                rnnConfig->rnnHeadSize})
+            : runtime::ITensor::makeShape({rnnConfig->stateSize, rnnConfig->rnnHiddenSize});
+        config.convStateShape = modelConfig.useMambaConv1dPlugin()
+            ? runtime::ITensor::makeShape({rnnConfig->convKernel - 1, rnnConfig->rnnConvDimSize})
+            : runtime::ITensor::makeShape({rnnConfig->rnnConvDimSize, rnnConfig->convKernel - 1});
+        auto const isRecurrentGemma
+            = modelConfig.getModelVariant() == runtime::ModelConfig::ModelVariant::kRecurrentGemma;
+        config.rnnDataType = isRecurrentGemma ? nvinfer1::DataType::kFLOAT : modelConfig.getDataType();
+        config.convDataType = modelConfig.getDataType();
+        config.maxNumSlots = maxNumSlots;
+        config.slotsPerPage = slotsPerPage;
+        return config;
+    }
+
+    //! \param broker Accounts the mapped pages against the memory shared with the KV cache, or null for a pool that
+    //! grows up to maxNumSlots.
+    explicit PagedRnnStatePool(Config const& config,
+        std::shared_ptr<kv_cache_manager::KVCacheMemoryBroker> broker = nullptr, float weight = 1.F)
+        : mConfig{config}
+        , mMaxNumPages{static_cast<SizeType32>(common::ceilDiv(config.maxNumSlots, config.slotsPerPage))}
+        , mBroker{std::move(broker)}
+    {
+        TLLM_CHECK_WITH_INFO(config.numLayers > 0 && config.maxNumSlots > 0 && config.slotsPerPage > 0,
+            "The paged RNN state pool needs layers and slots");
+        auto const rnnSlotSize = runtime::ITensor::volume(config.rnnStateShape)
+            * runtime::BufferDataType(config.rnnDataType).getSize();
+        auto const convSlotSize = runtime::ITensor::volume(config.convStateShape)
+            * runtime::BufferDataType(config.convDataType).getSize();
+        for (SizeType32 layer = 0; layer < config.numLayers; ++layer)
+        {
+            mRnnStates.push_back(makeLayer(rnnSlotSize, config.rnnStateShape, config.rnnDataType));
+            mConvStates.push_back(makeLayer(convSlotSize, config.convStateShape, config.convDataType));
+        }
+        mPageSizeInBytes = config.numLayers * (rnnSlotSize + convSlotSize) * config.slotsPerPage;
+
+        if (mBroker)
+        {
+            mModelId = mBroker->addModel({mPageSizeInBytes, 1, mMaxNumPages, weight}, 1);
+        }
+        mapPages(1);
+        TLLM_LOG_INFO("Reserved RNN states of %d slots in %d layers, %zu bytes per page of %d slots",
+            config.maxNumSlots, config.numLayers, mPageSizeInBytes, config.slotsPerPage);
+    }
+
+    //! \brief Assign a slot to a new sequence, mapping a new page if every mapped slot is used.
+    //! \return The slot, or nullopt if the pool cannot grow, in which case the sequence must wait.
+    std::optional<SizeType32> allocate(RequestIdType requestId)
+    {
+        TLLM_CHECK_WITH_INFO(
+            mSlotByRequest.count(requestId) == 0, "Request %lu already has an RNN state slot", requestId);
+        if (mFreeSlots.empty() && !grow(mNumPages + 1))
+        {
+            ++mStats.numRefusals;
+            return std::nullopt;
+        }
+        auto const slot = *mFreeSlots.begin();
+        mFreeSlots.erase(mFreeSlots.begin());
+        mSlotByRequest.emplace(requestId, slot);
+        return slot;
+    }
+
+    void free(RequestIdType requestId)
+    {
+        auto const it = mSlotByRequest.find(requestId);
+        if (it == mSlotByRequest.end())
+        {
+            return;
+        }
+        mFreeSlots.insert(it->second);
+        mSlotByRequest.erase(it);
+    }
+
+    [[nodiscard]] SizeType32 getSlot(RequestIdType requestId) const
+    {
+        auto const it = mSlotByRequest.find(requestId);
+        TLLM_CHECK_WITH_INFO(it != mSlotByRequest.end(), "Request %lu has no RNN state slot", requestId);
+        return it->second;
+    }
+
+    //! \brief Write the slot of the sequence to the host slot mapping, at dstSlotOffset.
+    void fillSlotMapping(runtime::ITensor& dstSlotMapping, SizeType32 dstSlotOffset, RequestIdType requestId) const
+    {
+        runtime::bufferCast<SizeType32>(dstSlotMapping)[dstSlotOffset] = getSlot(requestId);
+    }
+
+    //! \brief Insert the state pointers of the local recurrent layers, as RnnStateBuffers does for paged states.
+    void getPtrBuffers(TensorMap& inputBuffers, runtime::ModelConfig const& modelConfig,
+        runtime::WorldConfig const& worldConfig) const
+    {
+        auto const firstLayerId = worldConfig.getPipelineParallelRank() * mConfig.numLayers;
+        auto const& layerTypes = modelConfig.getLayerTypes();
+        runtime::utils::insertTensorVector(inputBuffers, "conv_state_ptr_", mConvStatePtr, firstLayerId, layerTypes,
+            runtime::ModelConfig::LayerType::kRECURRENT);
+        runtime::utils::insertTensorVector(inputBuffers, "rnn_state_ptr_", mRnnStatePtr, firstLayerId, layerTypes,
+            runtime::ModelConfig::LayerType::kRECURRENT);
+    }
+
+    //! \brief The SSM states of a layer, [maxNumSlots, ...]. Only the slots of mapped pages may be accessed.
+    [[nodiscard]] TensorPtr const& getRnnStates(SizeType32 layer) const
+    {
+        return mRnnStates.at(layer).tensor;
+    }
+
+    [[nodiscard]] TensorPtr const& getConvStates(SizeType32 layer) const
+    {
+        return mConvStates.at(layer).tensor;
+    }
+
+    //! \brief Report the number of sequences that need a state, e.g. the active ones plus the ones of the requests
+    //! waiting for capacity, so the broker can move memory between the KV cache and the pool.
+    void setDemand(SizeType32 numSequences)
+    {
+        if (mBroker)
+        {
+            auto const numPages = common::ceilDiv(std::max(numSequences, 1), mConfig.slotsPerPage);
+            mBroker->setDemand(mModelId, static_cast<SizeType32>(numPages));
+        }
+    }
+
+    //! \brief Resize the pool towards the target of the broker. Must be called between iterations, as the states of
+    //! some sequences may move; their slot mapping must be filled again afterwards.
+    //! \return The number of mapped pages afterwards.
+    SizeType32 rebalance(runtime::BufferManager const& bufferManager)
+    {
+        if (!mBroker)
+        {
+            return mNumPages;
+        }
+        auto const target = mBroker->getTargetNumBlocks(mModelId);
+        if (target > mNumPages)
+        {
+            grow(target);
+        }
+        else if (target < mNumPages)
+        {
+            compact(target, bufferManager);
+        }
+        return mNumPages;
+    }
+
+    //! \brief Move the states of the sequences in the tail into free slots below and unmap the empty pages, down to
+    //! numPages or as far as the live sequences allow.
+    void compact(SizeType32 numPages, runtime::BufferManager const& bufferManager)
+    {
+        auto const numUsed = static_cast<SizeType32>(mSlotByRequest.size());
+        auto const kept = std::max({numPages, 1,
+            static_cast<SizeType32>(common::ceilDiv(numUsed, mConfig.slotsPerPage))});
+        if (kept >= mNumPages)
+        {
+            return;
+        }
+        auto const numKeptSlots = kept * mConfig.slotsPerPage;
+        for (auto& [requestId, slot] : mSlotByRequest)
+        {
+            if (slot < numKeptSlots)
+            {
+                continue;
+            }
+            auto const target = *mFreeSlots.begin();
+            TLLM_CHECK(target < numKeptSlots);
+            mFreeSlots.erase(mFreeSlots.begin());
+            for (SizeType32 layer = 0; layer < mConfig.numLayers; ++layer)
+            {
+                copySlot(mRnnStates[layer].tensor, slot, target, bufferManager);
+                copySlot(mConvStates[layer].tensor, slot, target, bufferManager);
+            }
+            mFreeSlots.insert(slot);
+            slot = target;
+            ++mStats.numMovedSlots;
+        }
+        // The tail is unmapped after this.
+        bufferManager.getStream().synchronize();
+        mapPages(kept);
+        if (mBroker)
+        {
+            mBroker->release(mModelId, kept);
+        }
+    }
+
+    [[nodiscard]] SizeType32 getNumFreeSlots() const
+    {
+        return static_cast<SizeType32>(mFreeSlots.size());
+    }
+
+    [[nodiscard]] SizeType32 getNumMappedSlots() const
+    {
+        return std::min(mNumPages * mConfig.slotsPerPage, mConfig.maxNumSlots);
+    }
+
+    //! \brief Device memory of one page over all layers, the unit in which the broker accounts the pool.
+    [[nodiscard]] std::size_t getPageSizeInBytes() const
+    {
+        return mPageSizeInBytes;
+    }
+
+    [[nodiscard]] Stats getStats() const
+    {
+        auto stats = mStats;
+        stats.numMappedPages = mNumPages;
+        stats.numUsedSlots = static_cast<SizeType32>(mSlotByRequest.size());
+        return stats;
+    }
+
+private:
+    struct Layer
+    {
+        std::unique_ptr<runtime::VirtualDeviceMemory> memory;
+        std::size_t slotSizeInBytes;
+        TensorPtr tensor;
+    };
+
+    [[nodiscard]] Layer makeLayer(std::size_t slotSizeInBytes, runtime::ITensor::Shape const& slotShape,
+        nvinfer1::DataType dataType) const
+    {
+        auto const pageSize = slotSizeInBytes * mConfig.slotsPerPage;
+        auto memory = std::make_unique<runtime::VirtualDeviceMemory>(mMaxNumPages * pageSize, pageSize);
+        auto shape = runtime::ITensor::makeShape({mConfig.maxNumSlots});
+        for (SizeType32 dim = 0; dim < slotShape.nbDims; ++dim)
+        {
+            shape.d[shape.nbDims++] = slotShape.d[dim];
+        }
+        TensorPtr tensor = runtime::ITensor::wrap(memory->data(), dataType, shape);
+        return Layer{std::move(memory), slotSizeInBytes, std::move(tensor)};
+    }
+
+    //! \brief Grow to numPages pages as far as the broker allows.
+    bool grow(SizeType32 numPages)
+    {
+        numPages = std::min(numPages, mMaxNumPages);
+        if (numPages <= mNumPages)
+        {
+            return false;
+        }
+        if (mBroker)
+        {
+            numPages = mBroker->reserve(mModelId, numPages);
+            if (numPages <= mNumPages)
+            {
+                return false;
+            }
+        }
+        mapPages(numPages);
+        return true;
+    }
+
+    void mapPages(SizeType32 numPages)
+    {
+        if (mRnnStatePtr.empty())
+        {
+            initPtrBuffers();
+        }
+        for (auto* layers : {&mRnnStates, &mConvStates})
+        {
+            for (auto& layer : *layers)
+            {
+                layer.memory->resize(numPages * layer.slotSizeInBytes * mConfig.slotsPerPage);
+            }
+        }
+        auto const numSlots = std::min(numPages * mConfig.slotsPerPage, mConfig.maxNumSlots);
+        auto const previousSlots = std::min(mNumPages * mConfig.slotsPerPage, mConfig.maxNumSlots);
+        for (auto slot = previousSlots; slot < numSlots; ++slot)
+        {
+            mFreeSlots.insert(slot);
+        }
+        mFreeSlots.erase(mFreeSlots.lower_bound(numSlots), mFreeSlots.end());
+        mNumPages = numPages;
+    }
+
+    void initPtrBuffers()
+    {
+        auto const shape = runtime::ITensor::makeShape({mConfig.numLayers});
+        mRnnStatePtrs = runtime::BufferManager::cpu(shape, runtime::TRTDataType<void*>::value);
+        mConvStatePtrs = runtime::BufferManager::cpu(shape, runtime::TRTDataType<void*>::value);
+        auto* rnnPtrs = runtime::bufferCast<void*>(*mRnnStatePtrs);
+        auto* convPtrs = runtime::bufferCast<void*>(*mConvStatePtrs);
+        for (SizeType32 layer = 0; layer < mConfig.numLayers; ++layer)
+        {
+            rnnPtrs[layer] = mRnnStates[layer].memory->data();
+            convPtrs[layer] = mConvStates[layer].memory->data();
+            mRnnStatePtr.push_back(runtime::ITensor::slice(mRnnStatePtrs, layer, 1));
+            mConvStatePtr.push_back(runtime::ITensor::slice(mConvStatePtrs, layer, 1));
+        }
+    }
+
+    static void copySlot(
+        TensorPtr const& states, SizeType32 srcSlot, SizeType32 dstSlot, runtime::BufferManager const& bufferManager)
+    {
+        auto const src = runtime::ITensor::slice(states, srcSlot, 1);
+        auto dst = runtime::ITensor::slice(states, dstSlot, 1);
+        bufferManager.copy(*src, *dst);
+    }
+
+    Config mConfig;
+    SizeType32 mMaxNumPages;
+    std::shared_ptr<kv_cache_manager::KVCacheMemoryBroker> mBroker;
+    kv_cache_manager::KVCacheMemoryBroker::ModelId mModelId{-1};
+    std::size_t mPageSizeInBytes{0};
+
+    std::vector<Layer> mRnnStates;
+    std::vector<Layer> mConvStates;
+    TensorPtr mRnnStatePtrs;                // [numLayers]
+    TensorPtr mConvStatePtrs;               // [numLayers]
+    std::vector<TensorPtr> mRnnStatePtr;    // [1]
+    std::vector<TensorPtr> mConvStatePtr;   // [1]
+
+    SizeType32 mNumPages{0};
+    //! \brief Free slots of the mapped pages, the lowest is handed out first.
+    std::set<SizeType32> mFreeSlots;
+    std::unordered_map<RequestIdType, SizeType32> mSlotByRequest;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::batch_manager::rnn_state_manager
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/capacityScheduler.h"
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Predicts the output length of requests from the lengths of finished requests of the same client.
+//! \details Every client (LlmRequest::mClientId, requests without one share a key) has a histogram of output
+//! lengths. The prediction is a quantile of the lengths that exceed what the request already generated, so a request
+//! that overruns its prediction gets a longer one instead of none. Counts are halved once a histogram holds
+//! maxNumSamples samples, so the prediction follows changes in the traffic.
+class OutputLengthPredictor
+{
+public:
+    using RequestIdType = LlmRequest::RequestIdType;
+
+    explicit OutputLengthPredictor(float quantile = 0.9F, SizeType32 minNumSamples = 16,
+        SizeType32 maxNumSamples = 4096, SizeType32 bucketSize = 16)
+        : mQuantile{quantile}
+        , mMinNumSamples{minNumSamples}
+        , mMaxNumSamples{maxNumSamples}
+        , mBucketSize{bucketSize}
+    {
+        TLLM_CHECK(quantile > 0.F && quantile <= 1.F);
+        TLLM_CHECK(bucketSize > 0 && minNumSamples > 0 && maxNumSamples >= minNumSamples);
+    }
+
+    //! \brief Record the output length of a finished request.
+    void addSample(std::optional<RequestIdType> clientId, SizeType32 outputLength)
+    {
+        auto& histogram = mHistograms[clientId.value_or(kNoClientId)];
+        auto const bucketIdx = static_cast<std::size_t>(std::max(outputLength - 1, 0) / mBucketSize);
+        if (histogram.counts.size() <= bucketIdx)
+        {
+            histogram.counts.resize(bucketIdx + 1, 0);
+        }
+        ++histogram.counts[bucketIdx];
+        if (++histogram.numSamples >= mMaxNumSamples)
+        {
+            histogram.numSamples = 0;
+            for (auto& count : histogram.counts)
+            {
+                count /= 2;
+                histogram.numSamples += count;
+            }
+        }
+    }
+
+    void addSample(LlmRequest const& request)
+    {
+        addSample(request.mClientId, request.getMaxNumGeneratedTokens());
+        mHints.erase(request.mRequestId);
+    }
+
+    //! \brief Expected output length of a request, for example from a prompt classifier. Takes precedence over the
+    //! histogram until the request overruns it.
+    void setHint(RequestIdType requestId, SizeType32 outputLength)
+    {
+        mHints[requestId] = outputLength;
+    }
+
+    //! \brief Predicted output length of a request that generated numGenerated tokens so far, capped by
+    //! maxNewTokens. Not set if there are not enough samples.
+    [[nodiscard]] std::optional<SizeType32> predict(std::optional<RequestIdType> clientId, SizeType32 numGenerated,
+        SizeType32 maxNewTokens) const
+    {
+        auto const it = mHistograms.find(clientId.value_or(kNoClientId));
+        if (it == mHistograms.end())
+        {
+            return std::nullopt;
+        }
+        auto const& counts = it->second.counts;
+        // Only lengths above numGenerated are still possible.
+        auto const firstBucketIdx = static_cast<std::size_t>(numGenerated / mBucketSize);
+        std::int64_t numSamples{0};
+        for (auto bucketIdx = firstBucketIdx; bucketIdx < counts.size(); ++bucketIdx)
+        {
+            numSamples += counts[bucketIdx];
+        }
+        if (numSamples < mMinNumSamples)
+        {
+            return std::nullopt;
+        }
+        auto const target = static_cast<std::int64_t>(mQuantile * static_cast<float>(numSamples));
+        std::int64_t cumulative{0};
+        for (auto bucketIdx = firstBucketIdx; bucketIdx < counts.size(); ++bucketIdx)
+        {
+            cumulative += counts[bucketIdx];
+            if (cumulative >= target)
+            {
+                auto const length = static_cast<SizeType32>(bucketIdx + 1) * mBucketSize;
+                return std::min(std::max(length, numGenerated + 1), maxNewTokens);
+            }
+        }
+        return maxNewTokens;
+    }
+
+    [[nodiscard]] std::optional<SizeType32> predict(LlmRequest const& request) const
+    {
+        auto const numGenerated = request.getMaxNumGeneratedTokens();
+        auto const hint = mHints.find(request.mRequestId);
+        if (hint != mHints.end() && hint->second > numGenerated)
+        {
+            return std::min(hint->second, request.mMaxNewTokens);
+        }
+        return predict(request.mClientId, numGenerated, request.mMaxNewTokens);
+    }
+
+private:
+    static constexpr RequestIdType kNoClientId = std::numeric_limits<RequestIdType>::max();
+
+    struct Histogram
+    {
+        std::vector<std::int64_t> counts;
+        std::int64_t numSamples{0};
+    };
+
+    float mQuantile;
+    SizeType32 mMinNumSamples;
+    SizeType32 mMaxNumSamples;
+    SizeType32 mBucketSize;
+    std::unordered_map<RequestIdType, Histogram> mHistograms;
+    std::unordered_map<RequestIdType, SizeType32> mHints;
+};
+
+/// @brief   Schedule requests by reserving KV cache blocks for their predicted output length
+/// @details Like GUARANTEED_NO_EVICT, new requests are only scheduled if the started ones can keep running, but the
+///          reservation covers the predicted instead of the maximum output length. A request that overruns its
+///          prediction is given a longer one. Started requests are only paused, newest first, if the cache cannot
+///          even hold their next step, which is when MAX_UTILIZATION would pause.
+///          Without enough samples for a prediction, requests reserve for maxNewTokens.
+class PredictiveCapacityScheduler : public BaseCapacityScheduler
+{
+public:
+    explicit PredictiveCapacityScheduler(SizeType32 maxNumRequests, OutputLengthPredictor const& predictor,
+        LlmRequestState noScheduleUntilState = LlmRequestState::kCONTEXT_INIT,
+        LlmRequestState noScheduleAfterState = LlmRequestState::kGENERATION_COMPLETE)
+        : BaseCapacityScheduler(noScheduleUntilState, noScheduleAfterState)
+        , mMaxNumRequests{maxNumRequests}
+        , mPredictor{predictor}
+    {
+    }
+
+    /// @brief Takes as input a sorted list of requests and outputs a sorted lists of requests
+    ///        to update for this current iteration, and a list of requests to pause
+    [[nodiscard]] std::tuple<RequestVector, RequestVector> operator()(
+        kv_cache_manager::BaseKVCacheManager const& kvCacheManager, RequestList const& activeRequests) const
+    {
+        RequestVector startedRequests;
+        RequestVector pendingRequests;
+        for (auto const& req : activeRequests)
+        {
+            if (!req->hasReachedState(getNoScheduleUntilState()) || req->hasReachedState(getNoScheduleAfterState()))
+            {
+                continue;
+            }
+            bool const isStarted = req->isGenerationInProgressState()
+                || (req->isContextInitState() && !req->isFirstContextChunk());
+            (isStarted ? startedRequests : pendingRequests).push_back(req);
+        }
+
+        RequestVector scheduledRequests;
+        RequestVector pausedRequests;
+        auto numAvailableBlocks = kvCacheManager.getNumFreeBlocks();
+
+        // Started requests must at least advance by one step. Pause the newest ones if that does not fit.
+        SizeType32 numStepBlocks{0};
+        SizeType32 numKept{0};
+        for (auto const& req : startedRequests)
+        {
+            auto const stepBlocks = kvCacheManager.getNeededBlocksOneStep(*req, false);
+            if (numKept < mMaxNumRequests && numStepBlocks + stepBlocks <= numAvailableBlocks)
+            {
+                numStepBlocks += stepBlocks;
+                ++numKept;
+            }
+            else
+            {
+                break;
+            }
+        }
+        for (SizeType32 i = 0; i < static_cast<SizeType32>(startedRequests.size()); ++i)
+        {
+            auto const& req = startedRequests[i];
+            if (i < numKept)
+            {
+                scheduledRequests.push_back(req);
+                numAvailableBlocks -= getNumReservedBlocks(kvCacheManager, *req);
+            }
+            else
+            {
+                pausedRequests.push_back(req);
+            }
+        }
+        if (!pausedRequests.empty())
+        {
+            TLLM_LOG_DEBUG("Pausing %zu requests, the KV cache cannot hold their next step", pausedRequests.size());
+            return {std::move(scheduledRequests), std::move(pausedRequests)};
+        }
+
+        // Admit new requests in order while their predicted demand fits beside the started ones.
+        for (auto const& req : pendingRequests)
+        {
+            if (static_cast<SizeType32>(scheduledRequests.size()) >= mMaxNumRequests)
+            {
+                break;
+            }
+            auto const reservedBlocks = getNumReservedBlocks(kvCacheManager, *req);
+            if (reservedBlocks > numAvailableBlocks)
+            {
+                break;
+            }
+            numAvailableBlocks -= reservedBlocks;
+            scheduledRequests.push_back(req);
+        }
+        return {std::move(scheduledRequests), std::move(pausedRequests)};
+    }
+
+private:
+    //! \brief Blocks the request still needs to reach its predicted output length, at least one step.
+    [[nodiscard]] SizeType32 getNumReservedBlocks(
+        kv_cache_manager::BaseKVCacheManager const& kvCacheManager, LlmRequest const& req) const
+    {
+        auto const toCompletion = kvCacheManager.getRemainingBlocksToCompletion(req);
+        auto const predicted = mPredictor.predict(req);
+        if (!predicted.has_value())
+        {
+            return toCompletion;
+        }
+        // Every beam owns the blocks it generates into.
+        auto const tokensPerBlock = kvCacheManager.getTokensPerBlock();
+        auto const promptLen = req.getPromptLen();
+        auto const numBlocks = [tokensPerBlock](SizeType32 numTokens)
+        { return (numTokens + tokensPerBlock - 1) / tokensPerBlock; };
+        auto const numSavedBlocks = (numBlocks(promptLen + req.mMaxNewTokens) - numBlocks(promptLen + *predicted))
+            * req.mSamplingConfig.beamWidth;
+        return std::max(toCompletion - numSavedBlocks, kvCacheManager.getNeededBlocksOneStep(req, false));
+    }
+
+    SizeType32 mMaxNumRequests;
+    OutputLengthPredictor const& mPredictor;
+};
+
+} // namespace tensorrt_llm::batch_manager
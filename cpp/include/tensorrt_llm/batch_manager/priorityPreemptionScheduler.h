@@ -0,0 +1,237 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/capacityScheduler.h"
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/executor/types.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+/// @brief   Admit requests by priority, preempting lower priority running requests when the KV cache is full
+/// @details Running requests keep the blocks they need to completion reserved, like GUARANTEED_NO_EVICT. A pending
+///          request that does not fit may preempt running requests whose priority is at least minPriorityGap lower,
+///          lowest priority and latest arrival first, but only if the blocks they hold and reserve are enough to admit
+///          it: no request is paused for nothing. The preempted requests are returned as the requests to pause, for
+///          PauseRequests to drop their KV cache or KVCacheSwapper to swap it out. Against thrashing, a request that
+///          has run for less than minResidency since it was (re)started is not preempted, and the priority gap keeps
+///          requests of close priorities from preempting each other in turn.
+class PriorityPreemptionScheduler : public BaseCapacityScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+    using RequestIdType = LlmRequest::RequestIdType;
+
+    struct Config
+    {
+        SizeType32 maxNumRequests{0};
+        executor::PriorityType minPriorityGap{0.1f};
+        std::chrono::milliseconds minResidency{500};
+    };
+
+    struct Stats
+    {
+        std::uint64_t numPreemptions{0};
+        //! \brief Requests admitted thanks to preemptions.
+        std::uint64_t numAdmittedByPreemption{0};
+        //! \brief Times a request could not be admitted because the victims had not run for minResidency.
+        std::uint64_t numBlockedByResidency{0};
+    };
+
+    explicit PriorityPreemptionScheduler(Config const& config,
+        LlmRequestState noScheduleUntilState = LlmRequestState::kCONTEXT_INIT,
+        LlmRequestState noScheduleAfterState = LlmRequestState::kGENERATION_COMPLETE)
+        : BaseCapacityScheduler(noScheduleUntilState, noScheduleAfterState)
+        , mConfig{config}
+    {
+        TLLM_CHECK(config.maxNumRequests > 0);
+        TLLM_CHECK(config.minPriorityGap >= 0.f);
+    }
+
+    /// @brief Takes as input a list of requests and outputs a list of requests to update for this current iteration,
+    ///        highest priority first, and a list of requests to pause
+    [[nodiscard]] std::tuple<RequestVector, RequestVector> operator()(
+        kv_cache_manager::BaseKVCacheManager const& kvCacheManager, RequestList const& activeRequests,
+        TimePoint now = Clock::now())
+    {
+        RequestVector runningRequests;
+        RequestVector pendingRequests;
+        for (auto const& req : activeRequests)
+        {
+            if (!req->hasReachedState(getNoScheduleUntilState()) || req->hasReachedState(getNoScheduleAfterState()))
+            {
+                continue;
+            }
+            bool const isStarted = req->isGenerationInProgressState()
+                || (req->isContextInitState() && !req->isFirstContextChunk());
+            (isStarted ? runningRequests : pendingRequests).push_back(req);
+        }
+        forgetInactive(activeRequests);
+        sortByPriority(runningRequests);
+        sortByPriority(pendingRequests);
+
+        auto numAvailableBlocks = kvCacheManager.getNumFreeBlocks();
+        for (auto const& req : runningRequests)
+        {
+            numAvailableBlocks -= kvCacheManager.getRemainingBlocksToCompletion(*req);
+        }
+
+        RequestVector scheduledRequests;
+        RequestVector pausedRequests;
+        for (auto const& req : runningRequests)
+        {
+            if (static_cast<SizeType32>(scheduledRequests.size()) < mConfig.maxNumRequests)
+            {
+                scheduledRequests.push_back(req);
+            }
+            else
+            {
+                pausedRequests.push_back(req);
+            }
+        }
+
+        for (auto const& req : pendingRequests)
+        {
+            auto const neededBlocks = kvCacheManager.getRemainingBlocksToCompletion(*req);
+            auto const hasSlot = static_cast<SizeType32>(scheduledRequests.size()) < mConfig.maxNumRequests;
+            if (neededBlocks <= numAvailableBlocks && hasSlot)
+            {
+                numAvailableBlocks -= neededBlocks;
+                scheduledRequests.push_back(req);
+                continue;
+            }
+
+            // Victims from the lowest priority up, until the request fits.
+            RequestVector victims;
+            auto freedBlocks = numAvailableBlocks;
+            auto freedSlots = hasSlot ? 1 : 0;
+            bool blockedByResidency = false;
+            for (auto it = scheduledRequests.rbegin(); it != scheduledRequests.rend(); ++it)
+            {
+                auto const& victim = *it;
+                if (freedBlocks >= neededBlocks && freedSlots > 0)
+                {
+                    break;
+                }
+                if (victim->priority() + mConfig.minPriorityGap > req->priority() || !isPreemptible(*victim))
+                {
+                    continue;
+                }
+                if (now - mRunningSince.at(victim->mRequestId) < mConfig.minResidency)
+                {
+                    blockedByResidency = true;
+                    continue;
+                }
+                victims.push_back(victim);
+                freedBlocks += kvCacheManager.getRemainingBlocksToCompletion(*victim)
+                    + getNumHeldBlocks(kvCacheManager, *victim);
+                ++freedSlots;
+            }
+            if (freedBlocks < neededBlocks || freedSlots == 0)
+            {
+                mStats.numBlockedByResidency += blockedByResidency ? 1 : 0;
+                // Like GUARANTEED_NO_EVICT, a lower priority request must not take the blocks this one waits for.
+                break;
+            }
+
+            for (auto const& victim : victims)
+            {
+                TLLM_LOG_DEBUG("Request %lu of priority %f preempts request %lu of priority %f", req->mRequestId,
+                    req->priority(), victim->mRequestId, victim->priority());
+                scheduledRequests.erase(std::find(scheduledRequests.begin(), scheduledRequests.end(), victim));
+                pausedRequests.push_back(victim);
+                mRunningSince.erase(victim->mRequestId);
+            }
+            mStats.numPreemptions += victims.size();
+            ++mStats.numAdmittedByPreemption;
+            numAvailableBlocks = freedBlocks - neededBlocks;
+            scheduledRequests.push_back(req);
+            sortByPriority(scheduledRequests);
+        }
+
+        for (auto const& req : scheduledRequests)
+        {
+            mRunningSince.try_emplace(req->mRequestId, now);
+        }
+        for (auto const& req : pausedRequests)
+        {
+            mRunningSince.erase(req->mRequestId);
+        }
+        return {std::move(scheduledRequests), std::move(pausedRequests)};
+    }
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+private:
+    //! \brief Only the requests that started can be preempted, the ones admitted this iteration hold no blocks yet.
+    [[nodiscard]] bool isPreemptible(LlmRequest const& req) const
+    {
+        return mRunningSince.count(req.mRequestId) > 0;
+    }
+
+    [[nodiscard]] static SizeType32 getNumHeldBlocks(
+        kv_cache_manager::BaseKVCacheManager const& kvCacheManager, LlmRequest const& req)
+    {
+        auto const tokensPerBlock = kvCacheManager.getTokensPerBlock();
+        auto const numTokens
+            = req.isGenerationInProgressState() ? req.getNumTokens(0) : req.getContextCurrentPosition();
+        return (numTokens + tokensPerBlock - 1) / tokensPerBlock;
+    }
+
+    //! \brief Highest priority first. Stable, so ties keep their arrival order.
+    static void sortByPriority(RequestVector& requests)
+    {
+        std::stable_sort(requests.begin(), requests.end(),
+            [](auto const& lhs, auto const& rhs) { return lhs->priority() > rhs->priority(); });
+    }
+
+    void forgetInactive(RequestList const& activeRequests)
+    {
+        std::unordered_map<RequestIdType, TimePoint> runningSince;
+        for (auto const& req : activeRequests)
+        {
+            if (auto const it = mRunningSince.find(req->mRequestId); it != mRunningSince.end())
+            {
+                runningSince.emplace(*it);
+            }
+        }
+        mRunningSince = std::move(runningSince);
+    }
+
+    Config mConfig;
+    //! \brief When the scheduled requests were last (re)started.
+    std::unordered_map<RequestIdType, TimePoint> mRunningSince;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/batch_manager/peftCacheManager.h"
+#include "tensorrt_llm/batch_manager/sequenceSlotManager.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Counters of the cancellations, next to the IterationStats of the iteration they happened in.
+struct CancellationStats
+{
+    //! \brief Requests finished as cancelled, and the ones among them that were in the generation phase.
+    std::uint64_t numCancelled{0};
+    std::uint64_t numCancelledInGeneration{0};
+    //! \brief KV cache blocks returned to the free queue, or to the reuse tree with KV cache reuse.
+    std::uint64_t numBlocksReleased{0};
+};
+
+//! \brief Fast path of Executor::cancelRequest, which otherwise only marks the request and leaves its KV cache blocks
+//! and sequence slot to the next time the request is visited by the scheduling.
+//! \details cancel is called from any thread. Before the scheduling of an iteration, the executor loop calls apply,
+//! which finishes the cancelled active requests with FinishReason::kCANCELLED and releases their KV cache, LoRA pages
+//! and sequence slots right away, so that the capacity scheduler of the same iteration sees the freed capacity. The
+//! blocks can be handed to other requests even though the step in flight may still write them: the steps are ordered
+//! on the runtime stream, so the next step of the new owner runs after it. A request cancelled after its iteration was
+//! scheduled is removed from the scheduled batch by mask, so that the decoder does not step it once more.
+class RequestCanceller
+{
+public:
+    using BaseKVCacheManager = kv_cache_manager::BaseKVCacheManager;
+    using RequestIdType = LlmRequest::RequestIdType;
+
+    //! \brief Mark a request for cancellation, thread safe.
+    void cancel(RequestIdType requestId)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPending.insert(requestId);
+    }
+
+    [[nodiscard]] bool hasPending() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return !mPending.empty();
+    }
+
+    //! \brief Forget a cancellation whose request is not active, e.g. one removed from the queue of the executor.
+    void forget(RequestIdType requestId)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPending.erase(requestId);
+    }
+
+    //! \brief Finish the cancelled active requests, release their resources and remove them from activeRequests.
+    //! Cancellations of requests that are not active yet stay pending.
+    //! \return The cancelled requests, for the executor to send their final responses.
+    RequestVector apply(RequestList& activeRequests, BaseKVCacheManager* kvCacheManager,
+        BaseKVCacheManager* crossKvCacheManager, BasePeftCacheManager* peftCacheManager,
+        SequenceSlotManager* seqSlotManager)
+    {
+        RequestVector cancelled;
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mPending.empty())
+        {
+            return cancelled;
+        }
+        for (auto it = activeRequests.begin(); it != activeRequests.end();)
+        {
+            auto const& llmReq = *it;
+            if (mPending.erase(llmReq->mRequestId) == 0)
+            {
+                ++it;
+                continue;
+            }
+            release(*llmReq, kvCacheManager, crossKvCacheManager, peftCacheManager, seqSlotManager);
+            cancelled.push_back(llmReq);
+            it = activeRequests.erase(it);
+        }
+        return cancelled;
+    }
+
+    //! \brief Remove the requests cancelled after the scheduling of an iteration from its scheduled batch, and
+    //! release them like apply.
+    //! \return The requests removed from the batch.
+    RequestVector mask(RequestVector& scheduledRequests, BaseKVCacheManager* kvCacheManager,
+        BaseKVCacheManager* crossKvCacheManager, BasePeftCacheManager* peftCacheManager,
+        SequenceSlotManager* seqSlotManager)
+    {
+        RequestVector cancelled;
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mPending.empty())
+        {
+            return cancelled;
+        }
+        auto const isCancelled = [this](auto const& llmReq) { return mPending.count(llmReq->mRequestId) > 0; };
+        std::copy_if(scheduledRequests.begin(), scheduledRequests.end(), std::back_inserter(cancelled), isCancelled);
+        scheduledRequests.erase(
+            std::remove_if(scheduledRequests.begin(), scheduledRequests.end(), isCancelled), scheduledRequests.end());
+        for (auto const& llmReq : cancelled)
+        {
+            mPending.erase(llmReq->mRequestId);
+            release(*llmReq, kvCacheManager, crossKvCacheManager, peftCacheManager, seqSlotManager);
+        }
+        return cancelled;
+    }
+
+    //! \brief The counters since the last call, to report with the stats of the iteration.
+    [[nodiscard]] CancellationStats takeStats()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto stats = mStats;
+        mStats = CancellationStats{};
+        return stats;
+    }
+
+private:
+    void release(LlmRequest& llmReq, BaseKVCacheManager* kvCacheManager, BaseKVCacheManager* crossKvCacheManager,
+        BasePeftCacheManager* peftCacheManager, SequenceSlotManager* seqSlotManager)
+    {
+        auto const inGeneration = llmReq.isGenerationInProgressState();
+        llmReq.finishByReason(executor::FinishReason::kCANCELLED);
+        for (auto* manager : {kvCacheManager, crossKvCacheManager})
+        {
+            if (manager != nullptr)
+            {
+                auto const numFreeBefore = manager->getNumFreeBlocks();
+                // With KV cache reuse, the blocks of the prompt go to the reuse tree for a retry of the request.
+                manager->removeSequence(llmReq.mRequestId, llmReq);
+                mStats.numBlocksReleased += std::max(manager->getNumFreeBlocks() - numFreeBefore, 0);
+            }
+        }
+        if (peftCacheManager != nullptr)
+        {
+            peftCacheManager->markRequestDone(llmReq);
+        }
+        if (seqSlotManager != nullptr)
+        {
+            seqSlotManager->freeSequenceSlot(llmReq.mRequestId);
+        }
+        ++mStats.numCancelled;
+        mStats.numCancelledInGeneration += inGeneration ? 1 : 0;
+        TLLM_LOG_DEBUG("Cancelled request %lu released its resources", llmReq.mRequestId);
+    }
+
+    mutable std::mutex mMutex;
+    ReqIdsSet mPending;
+    CancellationStats mStats;
+};
+
+} // namespace tensorrt_llm::batch_manager
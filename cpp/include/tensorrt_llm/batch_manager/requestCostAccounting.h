@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/batch_manager/peftCacheManager.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Resources used by a request, for per-tenant billing and capacity planning.
+//! \details The GPU time of an iteration is split between its requests by their share of the tokens of the iteration,
+//! so that the GPU seconds of all requests add up to the time of the iterations. The KV cache and LoRA integrals are
+//! the blocks and pages held by the request times the duration of the iterations they were held in.
+struct RequestCost
+{
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    //! \brief Context tokens the engine computed, and the ones reused from the KV cache instead.
+    std::int64_t contextTokensComputed{0};
+    std::int64_t contextTokensReused{0};
+    SizeType32 numContextChunks{0};
+    SizeType32 numGenerationSteps{0};
+    //! \brief Generated and draft tokens that the generation steps computed.
+    std::int64_t generationTokensComputed{0};
+    double gpuSeconds{0};
+    double kvBlockSeconds{0};
+    SizeType32 maxKvBlocks{0};
+    //! \brief Pages of the LoRA weights of the request in the device cache, and in the host cache if the request
+    //! brought the weights itself instead of reusing the ones of a cached task.
+    SizeType32 loraDevicePages{0};
+    SizeType32 loraHostPages{0};
+    double loraDevicePageSeconds{0};
+
+    [[nodiscard]] std::string toJsonStr() const
+    {
+        std::ostringstream os;
+        os << "{\"context_tokens_computed\":" << contextTokensComputed
+           << ",\"context_tokens_reused\":" << contextTokensReused << ",\"context_chunks\":" << numContextChunks
+           << ",\"generation_steps\":" << numGenerationSteps
+           << ",\"generation_tokens_computed\":" << generationTokensComputed << ",\"gpu_seconds\":" << gpuSeconds
+           << ",\"kv_block_seconds\":" << kvBlockSeconds << ",\"max_kv_blocks\":" << maxKvBlocks
+           << ",\"lora_device_pages\":" << loraDevicePages << ",\"lora_host_pages\":" << loraHostPages
+           << ",\"lora_device_page_seconds\":" << loraDevicePageSeconds << "}";
+        return os.str();
+    }
+};
+
+//! \brief Accumulates the RequestCost of the active requests, one scheduled iteration at a time.
+//! \details The executor calls accumulate with the scheduled requests once the forward step of an iteration is done,
+//! before the context requests move to their next chunk, and takes the cost of a request when it is finished to
+//! report it with its response or in the request stats.
+class RequestCostAccounting
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using BaseKVCacheManager = kv_cache_manager::BaseKVCacheManager;
+    using RequestIdType = LlmRequest::RequestIdType;
+    using Seconds = std::chrono::duration<double>;
+
+    void accumulate(RequestVector const& contextRequests, RequestVector const& generationRequests,
+        Seconds iterationTime, BaseKVCacheManager const* kvCacheManager = nullptr,
+        BasePeftCacheManager const* peftCacheManager = nullptr)
+    {
+        TLLM_CHECK_WITH_INFO(iterationTime.count() >= 0, "Negative iteration time %f s", iterationTime.count());
+        auto const seconds = iterationTime.count();
+
+        std::int64_t numIterationTokens = 0;
+        for (auto const& llmReq : contextRequests)
+        {
+            numIterationTokens += llmReq->getContextChunkSize();
+        }
+        for (auto const& llmReq : generationRequests)
+        {
+            numIterationTokens += getNumGenerationTokens(*llmReq);
+        }
+        auto const secondsPerToken = numIterationTokens > 0 ? seconds / static_cast<double>(numIterationTokens) : 0.;
+
+        for (auto const& llmReq : contextRequests)
+        {
+            auto [it, isNew] = mCosts.try_emplace(llmReq->mRequestId);
+            auto& cost = it->second;
+            if (isNew)
+            {
+                // The prepopulated prompt is known once the blocks were reused, before the first chunk runs.
+                cost.contextTokensReused = llmReq->getPrepopulatedPromptLen();
+                addLoraHostPages(cost, llmReq, peftCacheManager);
+            }
+            auto const numTokens = llmReq->getContextChunkSize();
+            cost.contextTokensComputed += numTokens;
+            ++cost.numContextChunks;
+            cost.gpuSeconds += secondsPerToken * numTokens;
+            addHeldResources(cost, llmReq, seconds, kvCacheManager, peftCacheManager);
+        }
+        for (auto const& llmReq : generationRequests)
+        {
+            auto [it, isNew] = mCosts.try_emplace(llmReq->mRequestId);
+            auto& cost = it->second;
+            if (isNew)
+            {
+                // E.g. the generation side of a disaggregated request, whose context ran on another instance.
+                addLoraHostPages(cost, llmReq, peftCacheManager);
+            }
+            auto const numTokens = getNumGenerationTokens(*llmReq);
+            cost.generationTokensComputed += numTokens;
+            ++cost.numGenerationSteps;
+            cost.gpuSeconds += secondsPerToken * numTokens;
+            addHeldResources(cost, llmReq, seconds, kvCacheManager, peftCacheManager);
+        }
+    }
+
+    //! \brief Cost of a request so far, empty if it was never scheduled.
+    [[nodiscard]] RequestCost const& getCost(RequestIdType requestId) const
+    {
+        static RequestCost const kEmpty{};
+        auto const it = mCosts.find(requestId);
+        return it == mCosts.end() ? kEmpty : it->second;
+    }
+
+    //! \brief Cost of a finished request, which is forgotten.
+    [[nodiscard]] RequestCost take(RequestIdType requestId)
+    {
+        auto node = mCosts.extract(requestId);
+        return node.empty() ? RequestCost{} : std::move(node.mapped());
+    }
+
+    [[nodiscard]] std::size_t getNumTrackedRequests() const noexcept
+    {
+        return mCosts.size();
+    }
+
+private:
+    [[nodiscard]] static SizeType32 getNumGenerationTokens(LlmRequest const& llmReq)
+    {
+        return llmReq.mSamplingConfig.beamWidth * (1 + llmReq.getNumDraftTokens());
+    }
+
+    //! \brief Distinct blocks of the request, since the beams share the blocks of the context.
+    [[nodiscard]] static SizeType32 getNumKvBlocks(BaseKVCacheManager const& kvCacheManager, RequestIdType requestId)
+    {
+        auto const& blockIds = kvCacheManager.getCacheBlockIds(requestId);
+        if (blockIds.size() <= 1)
+        {
+            return blockIds.empty() ? 0 : static_cast<SizeType32>(blockIds.front().size());
+        }
+        std::vector<SizeType32> uniqueIds;
+        for (auto const& beamBlockIds : blockIds)
+        {
+            uniqueIds.insert(uniqueIds.end(), beamBlockIds.begin(), beamBlockIds.end());
+        }
+        std::sort(uniqueIds.begin(), uniqueIds.end());
+        return static_cast<SizeType32>(std::unique(uniqueIds.begin(), uniqueIds.end()) - uniqueIds.begin());
+    }
+
+    static void addLoraHostPages(
+        RequestCost& cost, std::shared_ptr<LlmRequest> const& llmReq, BasePeftCacheManager const* peftCacheManager)
+    {
+        if (peftCacheManager != nullptr && peftCacheManager->enabled() && llmReq->getLoraWeights().has_value())
+        {
+            cost.loraHostPages = peftCacheManager->determineNumPages(llmReq);
+        }
+    }
+
+    static void addHeldResources(RequestCost& cost, std::shared_ptr<LlmRequest> const& llmReq, double seconds,
+        BaseKVCacheManager const* kvCacheManager, BasePeftCacheManager const* peftCacheManager)
+    {
+        if (kvCacheManager != nullptr)
+        {
+            auto const numBlocks = getNumKvBlocks(*kvCacheManager, llmReq->mRequestId);
+            cost.kvBlockSeconds += numBlocks * seconds;
+            cost.maxKvBlocks = std::max(cost.maxKvBlocks, numBlocks);
+        }
+        if (peftCacheManager != nullptr && peftCacheManager->enabled() && llmReq->getLoraTaskId().has_value())
+        {
+            auto const numPages = peftCacheManager->determineNumPages(llmReq);
+            cost.loraDevicePages = std::max(cost.loraDevicePages, numPages);
+            cost.loraDevicePageSeconds += numPages * seconds;
+        }
+    }
+
+    std::unordered_map<RequestIdType, RequestCost> mCosts;
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::rnn_state_manager
+{
+
+// Prefix caching for recurrent layers. Unlike the KV cache, the state of a Mamba or RNN layer after a prefix is a
+// fixed size summary that cannot be assembled from per-block pieces. The request keeps the state of its prefixes every
+// checkpointInterval tokens instead: when a context chunk ends on a multiple of the interval, the conv and SSM states
+// of its slot are copied to a checkpoint keyed by the tokens so far. A later request with the same prefix restores the
+// longest checkpoint into its slot and only runs the context from there.
+//
+// The checkpoints are keyed like the reuse tree of the KV cache, by the BlockKey of every interval of tokens and the
+// hash of the chain of its ancestors, so that the same prompt hits the two caches at the same boundaries when
+// checkpointInterval is a multiple of tokensPerBlock.
+
+//! \brief Maps the prefixes of the checkpoints to their slots, least recently used slots are reused first.
+class RnnStateCheckpointIndex
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using VecUniqueTokens = kv_cache_manager::VecUniqueTokens;
+    using LoraTaskIdType = kv_cache_manager::LoraTaskIdType;
+
+    struct Match
+    {
+        SizeType32 slot;
+        SizeType32 numTokens;
+    };
+
+    RnnStateCheckpointIndex(SizeType32 checkpointInterval, SizeType32 maxCheckpoints)
+        : mCheckpointInterval{checkpointInterval}
+        , mSlots(maxCheckpoints)
+    {
+        TLLM_CHECK_WITH_INFO(checkpointInterval > 0, "The RNN state checkpoint interval must be positive");
+        TLLM_CHECK_WITH_INFO(maxCheckpoints > 0, "The RNN state checkpoint cache needs at least one slot");
+        for (SizeType32 slot = 0; slot < maxCheckpoints; ++slot)
+        {
+            mLru.push_back(slot);
+            mSlots[slot].lruIt = std::prev(mLru.end());
+        }
+    }
+
+    [[nodiscard]] SizeType32 getCheckpointInterval() const
+    {
+        return mCheckpointInterval;
+    }
+
+    [[nodiscard]] SizeType32 getNumCheckpoints() const
+    {
+        return static_cast<SizeType32>(mSlotByHash.size());
+    }
+
+    //! \brief The longest checkpoint of a prefix of tokens that leaves at least one token to run in the context.
+    [[nodiscard]] std::optional<Match> findLongestPrefix(
+        VecUniqueTokens const& tokens, std::optional<LoraTaskIdType> loraTaskId)
+    {
+        auto const numTokens = static_cast<SizeType32>(tokens.size());
+        auto const hashes = getChainHashes(tokens, loraTaskId, (numTokens - 1) / mCheckpointInterval);
+        // The state at a boundary summarizes the whole prefix, so the ancestors of a checkpoint need not be cached.
+        for (auto idx = static_cast<SizeType32>(hashes.size()) - 1; idx >= 0; --idx)
+        {
+            auto const it = mSlotByHash.find(hashes[idx]);
+            if (it == mSlotByHash.end())
+            {
+                continue;
+            }
+            auto const parentHash = idx > 0 ? hashes[idx - 1] : 0;
+            auto& slot = mSlots[it->second];
+            if (slot.parentHash != parentHash || !(slot.key == makeKey(tokens, loraTaskId, idx)))
+            {
+                continue;
+            }
+            touch(it->second);
+            return Match{it->second, (idx + 1) * mCheckpointInterval};
+        }
+        return std::nullopt;
+    }
+
+    //! \brief Claims the slot of the checkpoint of the first numTokens of tokens, a multiple of the interval.
+    //! \return The slot to copy the states to, or nullopt if the prefix has a checkpoint already.
+    [[nodiscard]] std::optional<SizeType32> insert(
+        VecUniqueTokens const& tokens, SizeType32 numTokens, std::optional<LoraTaskIdType> loraTaskId)
+    {
+        TLLM_CHECK_WITH_INFO(numTokens > 0 && numTokens % mCheckpointInterval == 0
+                && numTokens <= static_cast<SizeType32>(tokens.size()),
+            "RNN state checkpoints are taken every %d tokens, not after %d", mCheckpointInterval, numTokens);
+        auto const numIntervals = numTokens / mCheckpointInterval;
+        auto const hashes = getChainHashes(tokens, loraTaskId, numIntervals);
+        auto const hash = hashes.back();
+        if (auto const it = mSlotByHash.find(hash); it != mSlotByHash.end())
+        {
+            touch(it->second);
+            return std::nullopt;
+        }
+
+        auto const slotIdx = mLru.back();
+        auto& slot = mSlots[slotIdx];
+        if (slot.hash.has_value())
+        {
+            mSlotByHash.erase(*slot.hash);
+        }
+        slot.hash = hash;
+        slot.parentHash = numIntervals > 1 ? hashes[numIntervals - 2] : 0;
+        slot.key = makeKey(tokens, loraTaskId, numIntervals - 1);
+        mSlotByHash.emplace(hash, slotIdx);
+        touch(slotIdx);
+        return slotIdx;
+    }
+
+private:
+    struct Slot
+    {
+        std::optional<std::size_t> hash;
+        std::size_t parentHash{0};
+        kv_cache_manager::BlockKey key;
+        std::list<SizeType32>::iterator lruIt;
+    };
+
+    [[nodiscard]] kv_cache_manager::BlockKey makeKey(
+        VecUniqueTokens const& tokens, std::optional<LoraTaskIdType> loraTaskId, SizeType32 intervalIdx) const
+    {
+        auto const begin = tokens.begin() + intervalIdx * mCheckpointInterval;
+        VecUniqueTokens intervalTokens(begin, begin + mCheckpointInterval);
+        bool const usesExtraIds = std::any_of(intervalTokens.begin(), intervalTokens.end(),
+            [](kv_cache_manager::UniqueToken const& token) { return token.tokenExtraId != 0; });
+        return kv_cache_manager::BlockKey{
+            loraTaskId.has_value(), usesExtraIds, loraTaskId.value_or(0), std::move(intervalTokens)};
+    }
+
+    //! \brief The hashes of the first numIntervals intervals of tokens, each chained with the one of its parent.
+    [[nodiscard]] std::vector<std::size_t> getChainHashes(
+        VecUniqueTokens const& tokens, std::optional<LoraTaskIdType> loraTaskId, SizeType32 numIntervals) const
+    {
+        std::vector<std::size_t> hashes;
+        hashes.reserve(numIntervals);
+        std::size_t parentHash{0};
+        for (SizeType32 idx = 0; idx < numIntervals; ++idx)
+        {
+            parentHash = kv_cache_manager::BlockKeyHasher()(makeKey(tokens, loraTaskId, idx), parentHash);
+            hashes.push_back(parentHash);
+        }
+        return hashes;
+    }
+
+    void touch(SizeType32 slotIdx)
+    {
+        mLru.splice(mLru.begin(), mLru, mSlots[slotIdx].lruIt);
+    }
+
+    SizeType32 mCheckpointInterval;
+    std::vector<Slot> mSlots;
+    //! \brief Most recently used first.
+    std::list<SizeType32> mLru;
+    std::unordered_map<std::size_t, SizeType32> mSlotByHash;
+};
+
+//! \brief Device pools of the checkpoints of the conv and SSM states, indexed by RnnStateCheckpointIndex.
+//! \details The states are passed in the layout of the paged states of RnnStateManager, [localNbLayers, numSlots,
+//! ...]. The copies are enqueued on the stream of the buffer manager, which must be the stream the context runs on:
+//! a checkpoint slot is then only overwritten once the restores from it are done.
+class RnnStateCheckpointCache
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using TensorPtr = runtime::ITensor::SharedPtr;
+    using VecUniqueTokens = kv_cache_manager::VecUniqueTokens;
+    using LoraTaskIdType = kv_cache_manager::LoraTaskIdType;
+
+    //! \param rnnStates Paged SSM states, [localNbLayers, numSlots, stateSize, rnnHiddenSize] or [localNbLayers,
+    //! numSlots, numHeads, stateSize, rnnHeadSize].
+    //! \param convStates Paged conv states, [localNbLayers, numSlots, convKernel - 1, rnnConvDimSize].
+    RnnStateCheckpointCache(SizeType32 checkpointInterval, SizeType32 maxCheckpoints,
+        TensorPtr const& rnnStates, TensorPtr const& convStates, runtime::BufferManager const& bufferManager)
+        : mIndex{checkpointInterval, maxCheckpoints}
+        , mBufferManager{bufferManager}
+    {
+        auto rnnShape = rnnStates->getShape();
+        auto convShape = convStates->getShape();
+        TLLM_CHECK_WITH_INFO(rnnShape.nbDims >= 3 && convShape.nbDims == 4 && rnnShape.d[0] == convShape.d[0],
+            "The RNN states %s and conv states %s are not in the layout of the paged states",
+            runtime::ITensor::toString(rnnShape).c_str(), runtime::ITensor::toString(convShape).c_str());
+        rnnShape.d[1] = maxCheckpoints;
+        convShape.d[1] = maxCheckpoints;
+        mRnnCheckpoints = bufferManager.gpu(rnnShape, rnnStates->getDataType());
+        mConvCheckpoints = bufferManager.gpu(convShape, convStates->getDataType());
+        TLLM_LOG_INFO("Allocated %d RNN state checkpoints every %d tokens (%zu bytes)", maxCheckpoints,
+            checkpointInterval, mRnnCheckpoints->getSizeInBytes() + mConvCheckpoints->getSizeInBytes());
+    }
+
+    [[nodiscard]] RnnStateCheckpointIndex const& getIndex() const
+    {
+        return mIndex;
+    }
+
+    //! \brief Restores the longest checkpoint of a prefix of the prompt into the slot of the request.
+    //! \return The number of prompt tokens covered by the restored states, 0 on a miss.
+    SizeType32 restore(VecUniqueTokens const& tokens, std::optional<LoraTaskIdType> loraTaskId,
+        TensorPtr const& rnnStates, TensorPtr const& convStates, SizeType32 seqSlot)
+    {
+        auto const match = mIndex.findLongestPrefix(tokens, loraTaskId);
+        if (!match.has_value())
+        {
+            return 0;
+        }
+        copySlot(mRnnCheckpoints, match->slot, rnnStates, seqSlot);
+        copySlot(mConvCheckpoints, match->slot, convStates, seqSlot);
+        return match->numTokens;
+    }
+
+    //! \brief Checkpoints the states of the slot of a request after the first numTokens of tokens. Call after a
+    //! context chunk ending on a multiple of the interval, before the next chunk is enqueued.
+    //! \return Whether a new checkpoint was taken.
+    bool store(VecUniqueTokens const& tokens, SizeType32 numTokens, std::optional<LoraTaskIdType> loraTaskId,
+        TensorPtr const& rnnStates, TensorPtr const& convStates, SizeType32 seqSlot)
+    {
+        auto const slot = mIndex.insert(tokens, numTokens, loraTaskId);
+        if (!slot.has_value())
+        {
+            return false;
+        }
+        copySlot(rnnStates, seqSlot, mRnnCheckpoints, *slot);
+        copySlot(convStates, seqSlot, mConvCheckpoints, *slot);
+        return true;
+    }
+
+private:
+    void copySlot(TensorPtr const& src, SizeType32 srcSlot, TensorPtr const& dst, SizeType32 dstSlot) const
+    {
+        // The slots are the second dimension, a slot is strided across the layers.
+        auto const numLayers = src->getShape().d[0];
+        for (SizeType32 layer = 0; layer < numLayers; ++layer)
+        {
+            auto const srcSlice = runtime::ITensor::slice(src, {layer, srcSlot}, 1);
+            auto dstSlice = runtime::ITensor::slice(dst, {layer, dstSlot}, 1);
+            mBufferManager.copy(*srcSlice, *dstSlice);
+        }
+    }
+
+    RnnStateCheckpointIndex mIndex;
+    runtime::BufferManager const& mBufferManager;
+    TensorPtr mRnnCheckpoints;
+    TensorPtr mConvCheckpoints;
+};
+
+} // namespace tensorrt_llm::batch_manager::rnn_state_manager
@@ -0,0 +1,330 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/executor/types.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Online tuning of the runtime max batch size and max num tokens toward the highest throughput that keeps the
+//! p99 inter-token latency under a bound.
+//! \details The DynamicBatchTuner of the executor picks the limits from the moving averages of the input and output
+//! lengths, without looking at what the iterations cost. This controller decides from measurements instead: every
+//! window of iterations, it computes the p99 latency of the iterations that generated tokens, which is the inter-token
+//! latency of their requests, and the throughput in tokens per second. Over the bound, both limits decrease
+//! multiplicatively. Under KV cache pressure, the batch size decreases so that requests are not paused. Otherwise,
+//! the limits the last window saturated increase, and an increase that lowered the throughput is reverted and held
+//! for a few windows, a hill climb on the measured throughput.
+class RuntimeBatchTuner
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using Duration = std::chrono::duration<double>;
+
+    struct Config
+    {
+        Duration targetP99InterTokenLatency;
+        //! \brief Bounds of the limits. The max ones are usually the static limits of the executor.
+        SizeType32 minBatchSize;
+        SizeType32 maxBatchSize;
+        SizeType32 minNumTokens;
+        SizeType32 maxNumTokens;
+        //! \brief Iterations between two decisions.
+        SizeType32 windowSize{64};
+        //! \brief Fraction of the KV cache blocks in use above which the batch size decreases.
+        double kvCacheHighWatermark{0.95};
+        double increaseFactor{1.125};
+        double decreaseFactor{0.75};
+        //! \brief Relative drop of throughput after an increase that reverts it.
+        double throughputTolerance{0.02};
+    };
+
+    enum class Decision : std::int8_t
+    {
+        kKeep,
+        kIncrease,
+        kDecreaseLatency,
+        kDecreaseKvCache,
+        kRevert,
+    };
+
+    struct Stats
+    {
+        std::int64_t numIterations{0};
+        std::int64_t numWindows{0};
+        std::int64_t numIncreases{0};
+        std::int64_t numLatencyDecreases{0};
+        std::int64_t numKvCacheDecreases{0};
+        std::int64_t numReverts{0};
+        //! \brief Measurements of the last window.
+        double p99InterTokenLatencyMs{0.};
+        double tokensPerSecond{0.};
+    };
+
+    explicit RuntimeBatchTuner(Config const& config)
+        : mConfig{config}
+        , mMaxBatchSize{config.maxBatchSize}
+        , mMaxNumTokens{config.maxNumTokens}
+    {
+        TLLM_CHECK(config.targetP99InterTokenLatency.count() > 0.);
+        TLLM_CHECK(config.minBatchSize > 0 && config.minBatchSize <= config.maxBatchSize);
+        TLLM_CHECK(config.minNumTokens > 0 && config.minNumTokens <= config.maxNumTokens);
+        TLLM_CHECK(config.windowSize > 0);
+        TLLM_CHECK(config.increaseFactor > 1. && config.decreaseFactor > 0. && config.decreaseFactor < 1.);
+        mLatencies.reserve(config.windowSize);
+    }
+
+    //! \brief Tuner for the bound of TRTLLM_TARGET_P99_ITL_MS, not set if the variable is not.
+    [[nodiscard]] static std::optional<RuntimeBatchTuner> fromEnv(
+        SizeType32 maxBatchSize, SizeType32 maxNumTokens, SizeType32 minNumTokens = 1)
+    {
+        auto const targetMs = common::getEnvTargetP99InterTokenLatencyMs();
+        if (!targetMs.has_value())
+        {
+            return std::nullopt;
+        }
+        return RuntimeBatchTuner{Config{std::chrono::duration<double, std::milli>(*targetMs), 1, maxBatchSize,
+            std::min(minNumTokens, maxNumTokens), maxNumTokens}};
+    }
+
+    //! \brief Record an iteration and decide the limits of the next ones when it ends a window.
+    //! \param numGenRequests Requests that generated a token, the latency of an iteration without them is no
+    //! inter-token latency.
+    //! \param numTokens Context and generation tokens processed by the iteration.
+    //! \param kvCacheUsage Fraction of the KV cache blocks in use at the end of the iteration.
+    //! \return The decision, kKeep in the middle of a window.
+    Decision recordIteration(Duration latency, SizeType32 numActiveRequests, SizeType32 numGenRequests,
+        SizeType32 numTokens, double kvCacheUsage)
+    {
+        ++mStats.numIterations;
+        if (numGenRequests > 0)
+        {
+            mLatencies.push_back(latency.count());
+        }
+        mWindowTime += latency.count();
+        mWindowTokens += numTokens;
+        mBatchSizeSaturated |= numActiveRequests >= mMaxBatchSize;
+        mNumTokensSaturated |= numTokens >= mMaxNumTokens;
+        mMaxKvCacheUsage = std::max(mMaxKvCacheUsage, kvCacheUsage);
+        if (++mWindowIterations < mConfig.windowSize)
+        {
+            return Decision::kKeep;
+        }
+        auto const decision = decide();
+        resetWindow();
+        return decision;
+    }
+
+    //! \brief Record an iteration from the stats the executor reports for it.
+    Decision recordIteration(executor::IterationStats const& stats)
+    {
+        SizeType32 numGenRequests{0};
+        SizeType32 numTokens{0};
+        if (stats.inflightBatchingStats.has_value())
+        {
+            numGenRequests = stats.inflightBatchingStats->numGenRequests;
+            numTokens = stats.inflightBatchingStats->numCtxTokens + numGenRequests;
+        }
+        double kvCacheUsage{0.};
+        if (stats.kvCacheStats.has_value() && stats.kvCacheStats->maxNumBlocks > 0)
+        {
+            kvCacheUsage = static_cast<double>(stats.kvCacheStats->usedNumBlocks) / stats.kvCacheStats->maxNumBlocks;
+        }
+        return recordIteration(std::chrono::duration<double, std::milli>(stats.iterLatencyMS),
+            stats.numActiveRequests, numGenRequests, numTokens, kvCacheUsage);
+    }
+
+    //! \brief Report the limits in the stats of an iteration, as the recommendation of the tuner and as the limits
+    //! the runtime uses.
+    void fillIterationStats(executor::IterationStats& stats) const
+    {
+        stats.maxBatchSizeTunerRecommended = mMaxBatchSize;
+        stats.maxNumTokensTunerRecommended = mMaxNumTokens;
+        stats.maxBatchSizeRuntime
+            = stats.maxBatchSizeStatic > 0 ? std::min(mMaxBatchSize, stats.maxBatchSizeStatic) : mMaxBatchSize;
+        stats.maxNumTokensRuntime
+            = stats.maxNumTokensStatic > 0 ? std::min(mMaxNumTokens, stats.maxNumTokensStatic) : mMaxNumTokens;
+    }
+
+    [[nodiscard]] SizeType32 getMaxBatchSize() const noexcept
+    {
+        return mMaxBatchSize;
+    }
+
+    [[nodiscard]] SizeType32 getMaxNumTokens() const noexcept
+    {
+        return mMaxNumTokens;
+    }
+
+    [[nodiscard]] Decision getLastDecision() const noexcept
+    {
+        return mLastDecision;
+    }
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+    [[nodiscard]] static char const* toString(Decision decision)
+    {
+        switch (decision)
+        {
+        case Decision::kKeep: return "keep";
+        case Decision::kIncrease: return "increase";
+        case Decision::kDecreaseLatency: return "decrease for latency";
+        case Decision::kDecreaseKvCache: return "decrease for KV cache";
+        case Decision::kRevert: return "revert";
+        }
+        return "unknown";
+    }
+
+private:
+    [[nodiscard]] Decision decide()
+    {
+        ++mStats.numWindows;
+        auto const throughput = mWindowTime > 0. ? static_cast<double>(mWindowTokens) / mWindowTime : 0.;
+        std::optional<double> p99;
+        if (!mLatencies.empty())
+        {
+            auto const rank = static_cast<std::size_t>(std::ceil(0.99 * static_cast<double>(mLatencies.size()))) - 1;
+            std::nth_element(mLatencies.begin(), mLatencies.begin() + rank, mLatencies.end());
+            p99 = mLatencies[rank];
+        }
+        mStats.p99InterTokenLatencyMs = p99.value_or(0.) * 1e3;
+        mStats.tokensPerSecond = throughput;
+
+        auto const lastBatchSize = mMaxBatchSize;
+        auto const lastNumTokens = mMaxNumTokens;
+        auto decision = Decision::kKeep;
+        if (p99.has_value() && *p99 > mConfig.targetP99InterTokenLatency.count())
+        {
+            mMaxBatchSize = scale(mMaxBatchSize, mConfig.decreaseFactor, mConfig.minBatchSize, mConfig.maxBatchSize);
+            mMaxNumTokens = scale(mMaxNumTokens, mConfig.decreaseFactor, mConfig.minNumTokens, mConfig.maxNumTokens);
+            decision = Decision::kDecreaseLatency;
+            ++mStats.numLatencyDecreases;
+        }
+        else if (mMaxKvCacheUsage >= mConfig.kvCacheHighWatermark)
+        {
+            mMaxBatchSize = scale(mMaxBatchSize, mConfig.decreaseFactor, mConfig.minBatchSize, mConfig.maxBatchSize);
+            decision = Decision::kDecreaseKvCache;
+            ++mStats.numKvCacheDecreases;
+        }
+        else if (mLastDecision == Decision::kIncrease
+            && throughput < mPreviousThroughput * (1. - mConfig.throughputTolerance))
+        {
+            mMaxBatchSize = mPreviousBatchSize;
+            mMaxNumTokens = mPreviousNumTokens;
+            mHoldWindows = kNumHoldWindows;
+            decision = Decision::kRevert;
+            ++mStats.numReverts;
+        }
+        else if (mHoldWindows > 0)
+        {
+            --mHoldWindows;
+        }
+        else if (mBatchSizeSaturated || mNumTokensSaturated)
+        {
+            // A limit the window did not reach does not bound the throughput, raising it measures nothing.
+            if (mBatchSizeSaturated)
+            {
+                mMaxBatchSize
+                    = scale(mMaxBatchSize, mConfig.increaseFactor, mConfig.minBatchSize, mConfig.maxBatchSize);
+            }
+            if (mNumTokensSaturated)
+            {
+                mMaxNumTokens
+                    = scale(mMaxNumTokens, mConfig.increaseFactor, mConfig.minNumTokens, mConfig.maxNumTokens);
+            }
+            if (mMaxBatchSize != lastBatchSize || mMaxNumTokens != lastNumTokens)
+            {
+                decision = Decision::kIncrease;
+                ++mStats.numIncreases;
+            }
+        }
+        mPreviousBatchSize = lastBatchSize;
+        mPreviousNumTokens = lastNumTokens;
+        mPreviousThroughput = throughput;
+        mLastDecision = decision;
+
+        if (decision != Decision::kKeep)
+        {
+            TLLM_LOG_INFO("Runtime batch tuner: %s, max batch size %d -> %d, max num tokens %d -> %d "
+                          "(p99 ITL %.2f ms, %.0f tokens/s, KV cache usage %.2f)",
+                toString(decision), lastBatchSize, mMaxBatchSize, lastNumTokens, mMaxNumTokens,
+                mStats.p99InterTokenLatencyMs, throughput, mMaxKvCacheUsage);
+        }
+        return decision;
+    }
+
+    [[nodiscard]] static SizeType32 scale(SizeType32 value, double factor, SizeType32 minValue, SizeType32 maxValue)
+    {
+        auto scaled = static_cast<SizeType32>(factor > 1. ? std::ceil(value * factor) : std::floor(value * factor));
+        // Small limits would not move with the rounding.
+        if (scaled == value)
+        {
+            scaled += factor > 1. ? 1 : -1;
+        }
+        return std::clamp(scaled, minValue, maxValue);
+    }
+
+    void resetWindow()
+    {
+        mLatencies.clear();
+        mWindowIterations = 0;
+        mWindowTime = 0.;
+        mWindowTokens = 0;
+        mBatchSizeSaturated = false;
+        mNumTokensSaturated = false;
+        mMaxKvCacheUsage = 0.;
+    }
+
+    static constexpr SizeType32 kNumHoldWindows = 4;
+
+    Config mConfig;
+    SizeType32 mMaxBatchSize;
+    SizeType32 mMaxNumTokens;
+    Decision mLastDecision{Decision::kKeep};
+    SizeType32 mPreviousBatchSize{0};
+    SizeType32 mPreviousNumTokens{0};
+    double mPreviousThroughput{0.};
+    SizeType32 mHoldWindows{0};
+
+    // Measurements of the current window, latencies in seconds.
+    std::vector<double> mLatencies;
+    SizeType32 mWindowIterations{0};
+    double mWindowTime{0.};
+    std::int64_t mWindowTokens{0};
+    bool mBatchSizeSaturated{false};
+    bool mNumTokensSaturated{false};
+    double mMaxKvCacheUsage{0.};
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::batch_manager
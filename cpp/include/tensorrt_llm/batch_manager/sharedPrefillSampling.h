@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/kvCacheBeamFork.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Parallel sampling of numReturnSequences > 1 with one context phase for all the sequences of a request.
+//! \details The child requests of LlmRequest::createChildRequest have the prompt of their parent, and would each run
+//! the context phase and hold the KV cache of the prompt. Here the siblings form a group: only the parent runs the
+//! context phase, and the children are kept out of the context batches until it is done. Then the context blocks are
+//! shared by the siblings in a kv_cache_manager::BeamBlockForkTable whose beams are the siblings, each of them its own
+//! parent at every step, so that only the last, partial block of the prompt is copied, at the first generated token,
+//! and the full blocks are shared by reference count to the end. The capacity scheduler admits the groups as a whole
+//! with getGroupBlocksToCompletion, which counts the shared prompt once.
+//!
+//! The blocks of the group are released when its last sibling finishes, the accounting reserves them to completion.
+class SharedPrefillSampling
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+    using ForkTable = kv_cache_manager::BeamBlockForkTable;
+    using BlockIdType = ForkTable::BlockIdType;
+    using BlockCopy = ForkTable::BlockCopy;
+
+    //! \brief Whether the request is a sibling of a group with several sequences.
+    [[nodiscard]] static bool isGrouped(LlmRequest const& req)
+    {
+        return req.isChild() || (req.mSamplingConfig.beamWidth == 1 && req.getNumSubRequests() > 1);
+    }
+
+    [[nodiscard]] static RequestIdType getGroupId(LlmRequest const& req)
+    {
+        return req.isChild() ? req.getParentRequestId() : req.mRequestId;
+    }
+
+    //! \brief Blocks a group needs to its end: the full blocks of the prompt once, and for every sibling the partial
+    //! block of the prompt it forks and the blocks of its generated tokens.
+    [[nodiscard]] static SizeType32 getGroupBlocksToCompletion(
+        SizeType32 tokensPerBlock, SizeType32 promptLen, SizeType32 maxNewTokens, SizeType32 groupSize)
+    {
+        auto const numSharedBlocks = promptLen / tokensPerBlock;
+        auto const numBlocksPerSibling = (promptLen + maxNewTokens + tokensPerBlock - 1) / tokensPerBlock;
+        return numSharedBlocks + groupSize * (numBlocksPerSibling - numSharedBlocks);
+    }
+
+    [[nodiscard]] static SizeType32 getGroupBlocksToCompletion(SizeType32 tokensPerBlock, LlmRequest const& parent)
+    {
+        return getGroupBlocksToCompletion(
+            tokensPerBlock, parent.getPromptLen(), parent.mMaxNewTokens, parent.getNumSubRequests());
+    }
+
+    //! \brief The requests grouped by sibling group, in the order of their first member, for the capacity scheduler
+    //! to admit or pause them together. Requests without siblings are a group of their own.
+    [[nodiscard]] static std::vector<RequestVector> groupSiblings(RequestVector const& requests)
+    {
+        std::vector<RequestVector> groups;
+        std::unordered_map<RequestIdType, std::size_t> groupIndices;
+        for (auto const& req : requests)
+        {
+            if (!isGrouped(*req))
+            {
+                groups.push_back({req});
+                continue;
+            }
+            auto const [it, inserted] = groupIndices.try_emplace(getGroupId(*req), groups.size());
+            if (inserted)
+            {
+                groups.emplace_back();
+            }
+            groups[it->second].push_back(req);
+        }
+        return groups;
+    }
+
+    //! \brief Remove the children from the context requests, their parent runs the context phase for them.
+    static void removeChildContexts(RequestVector& contextRequests)
+    {
+        contextRequests.erase(std::remove_if(contextRequests.begin(), contextRequests.end(),
+                                  [](auto const& req) { return req->isChild(); }),
+            contextRequests.end());
+    }
+
+    //! \brief Share the context blocks of a parent whose context phase completed with its children. Sibling 0 is the
+    //! parent and sibling i + 1 its child i.
+    ForkTable& fork(LlmRequest const& parent, std::vector<BlockIdType> const& contextBlockIds,
+        SizeType32 tokensPerBlock, ForkTable::AllocateBlock allocateBlock, ForkTable::ReleaseBlock releaseBlock)
+    {
+        TLLM_CHECK_WITH_INFO(!parent.isChild(), "Request %lu is not the parent of its group", parent.mRequestId);
+        auto const groupSize = static_cast<SizeType32>(parent.getChildRequests().size()) + 1;
+        auto [it, inserted] = mGroups.try_emplace(parent.mRequestId);
+        TLLM_CHECK_WITH_INFO(inserted, "The context of request %lu is forked already", parent.mRequestId);
+        it->second.table = std::make_unique<ForkTable>(tokensPerBlock, groupSize, contextBlockIds,
+            parent.getPromptLen(), std::move(allocateBlock), std::move(releaseBlock));
+        it->second.numActive = groupSize;
+        return *it->second.table;
+    }
+
+    [[nodiscard]] bool isForked(RequestIdType groupId) const
+    {
+        return mGroups.count(groupId) > 0;
+    }
+
+    //! \brief Make room for the next token of every sibling, before the generation step writes it.
+    //! \return The partial blocks to copy, at the first generated token only.
+    std::vector<BlockCopy> advance(RequestIdType groupId)
+    {
+        auto& table = getTable(groupId);
+        std::vector<SizeType32> selfParents(table.getBeamWidth());
+        for (SizeType32 si = 0; si < table.getBeamWidth(); ++si)
+        {
+            selfParents[si] = si;
+        }
+        return table.advance(selfParents);
+    }
+
+    //! \brief Block table of a sibling, its row of GenerationRequest::getCacheBlockIds.
+    [[nodiscard]] std::vector<BlockIdType> const& getCacheBlockIds(RequestIdType groupId, SizeType32 siblingIdx)
+    {
+        return getTable(groupId).getCacheBlockIds().at(siblingIdx);
+    }
+
+    //! \brief A sibling finished. The blocks of the group are released with the last one.
+    void finish(RequestIdType groupId)
+    {
+        auto const it = mGroups.find(groupId);
+        TLLM_CHECK_WITH_INFO(it != mGroups.end(), "Group %lu is not forked", groupId);
+        if (--it->second.numActive == 0)
+        {
+            it->second.table->release();
+            mGroups.erase(it);
+        }
+    }
+
+    //! \brief Blocks held by all the forked groups, each shared block counted once.
+    [[nodiscard]] SizeType32 getNumUniqueBlocks() const
+    {
+        SizeType32 numBlocks = 0;
+        for (auto const& [groupId, group] : mGroups)
+        {
+            numBlocks += group.table->getNumUniqueBlocks();
+        }
+        return numBlocks;
+    }
+
+private:
+    struct Group
+    {
+        std::unique_ptr<ForkTable> table;
+        SizeType32 numActive{0};
+    };
+
+    [[nodiscard]] ForkTable& getTable(RequestIdType groupId)
+    {
+        auto const it = mGroups.find(groupId);
+        TLLM_CHECK_WITH_INFO(it != mGroups.end(), "Group %lu is not forked", groupId);
+        return *it->second.table;
+    }
+
+    std::unordered_map<RequestIdType, Group> mGroups;
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/capacityScheduler.h"
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/executor/types.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Latency targets of a request.
+struct RequestSlo
+{
+    //! \brief Time to first token, from the arrival of the request.
+    std::optional<std::chrono::milliseconds> timeToFirstToken{std::nullopt};
+    //! \brief Time per output token after the first one.
+    std::optional<std::chrono::milliseconds> timePerOutputToken{std::nullopt};
+    //! \brief Requests of a higher class are always served before the ones of a lower class, regardless of slack.
+    SizeType32 priorityClass{0};
+};
+
+//! \brief Tracks the latency targets of requests and how much slack they have left.
+//! \details Arrival and first token times are taken from the RequestPerfMetrics of the request if it returns them,
+//! otherwise from the iteration in which the tracker first observed the request in that state.
+class RequestSloTracker
+{
+public:
+    using RequestIdType = LlmRequest::RequestIdType;
+    using TimePoint = executor::RequestPerfMetrics::TimePoint;
+    using Duration = std::chrono::nanoseconds;
+
+    static constexpr Duration kNoDeadline = Duration::max();
+
+    struct Stats
+    {
+        std::int64_t numFirstTokens{0};
+        std::int64_t numTimeToFirstTokenMisses{0};
+    };
+
+    void setSlo(RequestIdType requestId, RequestSlo const& slo)
+    {
+        mEntries[requestId].slo = slo;
+    }
+
+    void erase(RequestIdType requestId)
+    {
+        mEntries.erase(requestId);
+    }
+
+    //! \brief Record the arrival and first token of the request. Called by the scheduler every iteration.
+    void observe(LlmRequest const& request, TimePoint now)
+    {
+        auto& entry = mEntries[request.mRequestId];
+        auto const& timing = request.getPerfMetrics().timingMetrics;
+        if (!entry.arrivalTime.has_value())
+        {
+            entry.arrivalTime = timing.arrivalTime != TimePoint{} ? timing.arrivalTime : now;
+        }
+        if (!entry.firstTokenTime.has_value() && request.getMaxNumGeneratedTokens() > 0)
+        {
+            entry.firstTokenTime = timing.firstTokenTime != TimePoint{} ? timing.firstTokenTime : now;
+            ++mStats.numFirstTokens;
+            if (entry.slo.timeToFirstToken.has_value()
+                && *entry.firstTokenTime - *entry.arrivalTime > *entry.slo.timeToFirstToken)
+            {
+                ++mStats.numTimeToFirstTokenMisses;
+            }
+        }
+    }
+
+    [[nodiscard]] SizeType32 getPriorityClass(LlmRequest const& request) const
+    {
+        auto const it = mEntries.find(request.mRequestId);
+        return it == mEntries.end() ? 0 : it->second.slo.priorityClass;
+    }
+
+    //! \brief Time left until the next deadline of the request, after the estimated time to produce its next token.
+    //! Negative if the deadline will be missed, kNoDeadline if the request has no target for its current phase.
+    //! \param prefillTokensPerSecond Throughput used to estimate the remaining context time, ignored if not positive.
+    [[nodiscard]] Duration getSlack(LlmRequest const& request, TimePoint now, double prefillTokensPerSecond = 0.) const
+    {
+        auto const it = mEntries.find(request.mRequestId);
+        if (it == mEntries.end() || !it->second.arrivalTime.has_value())
+        {
+            return kNoDeadline;
+        }
+        auto const& entry = it->second;
+        if (!entry.firstTokenTime.has_value())
+        {
+            if (!entry.slo.timeToFirstToken.has_value())
+            {
+                return kNoDeadline;
+            }
+            auto const deadline = *entry.arrivalTime + *entry.slo.timeToFirstToken;
+            auto slack = std::chrono::duration_cast<Duration>(deadline - now);
+            if (prefillTokensPerSecond > 0.)
+            {
+                auto const numContextTokens = request.isContextInitState()
+                    ? request.getContextRemainingLength()
+                    : request.getPromptLen() - request.getPrepopulatedPromptLen();
+                slack -= std::chrono::duration_cast<Duration>(
+                    std::chrono::duration<double>(numContextTokens / prefillTokensPerSecond));
+            }
+            return slack;
+        }
+        if (!entry.slo.timePerOutputToken.has_value())
+        {
+            return kNoDeadline;
+        }
+        // The next token is due one target interval after the previous one was due.
+        auto const numGenerated = request.getMaxNumGeneratedTokens();
+        auto const deadline = *entry.firstTokenTime + *entry.slo.timePerOutputToken * numGenerated;
+        return std::chrono::duration_cast<Duration>(deadline - now);
+    }
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+private:
+    struct Entry
+    {
+        RequestSlo slo;
+        std::optional<TimePoint> arrivalTime;
+        std::optional<TimePoint> firstTokenTime;
+    };
+
+    std::unordered_map<RequestIdType, Entry> mEntries;
+    Stats mStats;
+};
+
+/// @brief   Schedule requests by priority class and slack to their latency targets
+/// @details New requests are admitted most urgent first, and only while the KV cache can hold them to completion, like
+///          GUARANTEED_NO_EVICT. Started requests keep running unless the cache cannot hold their next step, in which
+///          case the ones with the most slack are paused. The scheduled requests are returned most urgent first, so
+///          the micro batch scheduler fills context chunks in the order of their deadlines.
+class SloCapacityScheduler : public BaseCapacityScheduler
+{
+public:
+    using TimePoint = RequestSloTracker::TimePoint;
+
+    explicit SloCapacityScheduler(SizeType32 maxNumRequests, RequestSloTracker& tracker,
+        double prefillTokensPerSecond = 0., LlmRequestState noScheduleUntilState = LlmRequestState::kCONTEXT_INIT,
+        LlmRequestState noScheduleAfterState = LlmRequestState::kGENERATION_COMPLETE)
+        : BaseCapacityScheduler(noScheduleUntilState, noScheduleAfterState)
+        , mMaxNumRequests{maxNumRequests}
+        , mTracker{tracker}
+        , mPrefillTokensPerSecond{prefillTokensPerSecond}
+    {
+    }
+
+    /// @brief Takes as input a list of requests and outputs a list of requests to update for this current iteration,
+    ///        sorted by urgency, and a list of requests to pause
+    [[nodiscard]] std::tuple<RequestVector, RequestVector> operator()(
+        kv_cache_manager::BaseKVCacheManager const& kvCacheManager, RequestList const& activeRequests,
+        TimePoint now = std::chrono::steady_clock::now()) const
+    {
+        RequestVector startedRequests;
+        RequestVector pendingRequests;
+        for (auto const& req : activeRequests)
+        {
+            if (!req->hasReachedState(getNoScheduleUntilState()) || req->hasReachedState(getNoScheduleAfterState()))
+            {
+                continue;
+            }
+            mTracker.observe(*req, now);
+            bool const isStarted = req->isGenerationInProgressState()
+                || (req->isContextInitState() && !req->isFirstContextChunk());
+            (isStarted ? startedRequests : pendingRequests).push_back(req);
+        }
+        sortByUrgency(startedRequests, now);
+        sortByUrgency(pendingRequests, now);
+
+        RequestVector scheduledRequests;
+        RequestVector pausedRequests;
+        auto numAvailableBlocks = kvCacheManager.getNumFreeBlocks();
+
+        // Started requests only need their next step, the most urgent ones are kept if not all of them fit.
+        for (auto const& req : startedRequests)
+        {
+            auto const stepBlocks = kvCacheManager.getNeededBlocksOneStep(*req, false);
+            if (static_cast<SizeType32>(scheduledRequests.size()) < mMaxNumRequests && stepBlocks <= numAvailableBlocks)
+            {
+                numAvailableBlocks -= stepBlocks;
+                scheduledRequests.push_back(req);
+            }
+            else
+            {
+                pausedRequests.push_back(req);
+            }
+        }
+        if (!pausedRequests.empty())
+        {
+            TLLM_LOG_DEBUG("Pausing %zu requests with the most slack", pausedRequests.size());
+            return {std::move(scheduledRequests), std::move(pausedRequests)};
+        }
+        // The rest of the cache must hold the started requests to completion before new ones are admitted.
+        numAvailableBlocks = kvCacheManager.getNumFreeBlocks();
+        for (auto const& req : startedRequests)
+        {
+            numAvailableBlocks -= kvCacheManager.getRemainingBlocksToCompletion(*req);
+        }
+
+        for (auto const& req : pendingRequests)
+        {
+            if (static_cast<SizeType32>(scheduledRequests.size()) >= mMaxNumRequests)
+            {
+                break;
+            }
+            auto const neededBlocks = kvCacheManager.getRemainingBlocksToCompletion(*req);
+            if (neededBlocks > numAvailableBlocks)
+            {
+                // A less urgent request may still fit, but it must not delay the admission of this one.
+                break;
+            }
+            numAvailableBlocks -= neededBlocks;
+            scheduledRequests.push_back(req);
+        }
+        sortByUrgency(scheduledRequests, now);
+        return {std::move(scheduledRequests), std::move(pausedRequests)};
+    }
+
+private:
+    //! \brief Higher priority class first, then least slack. Stable, so ties keep their arrival order.
+    void sortByUrgency(RequestVector& requests, TimePoint now) const
+    {
+        std::vector<std::tuple<SizeType32, RequestSloTracker::Duration, RequestVector::value_type>> keyed;
+        keyed.reserve(requests.size());
+        for (auto const& req : requests)
+        {
+            keyed.emplace_back(
+                -mTracker.getPriorityClass(*req), mTracker.getSlack(*req, now, mPrefillTokensPerSecond), req);
+        }
+        std::stable_sort(keyed.begin(), keyed.end(), [](auto const& lhs, auto const& rhs)
+            { return std::tie(std::get<0>(lhs), std::get<1>(lhs)) < std::tie(std::get<0>(rhs), std::get<1>(rhs)); });
+        for (std::size_t i = 0; i < requests.size(); ++i)
+        {
+            requests[i] = std::get<2>(keyed[i]);
+        }
+    }
+
+    SizeType32 mMaxNumRequests;
+    RequestSloTracker& mTracker;
+    double mPrefillTokensPerSecond;
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/executor/types.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Acceptance of the draft tokens of a set of verification steps.
+//! \details A draft token at depth d (0-based position in the accepted path) is reached when the d tokens before it
+//! were accepted. The acceptance probability of a depth is the ratio of its accepted to its reached tokens, which is
+//! the per-position alpha that Medusa choices and Eagle trees are tuned with. For trees, the accepted path of every
+//! step is counted too, so that rarely accepted branches can be pruned.
+struct SpeculativeDecodingStats
+{
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    //! \brief Number of steps by number of accepted draft tokens, [maxDraftLen + 1].
+    std::vector<SizeType32> acceptedLengthsHistogram;
+    //! \brief Number of draft tokens reached and accepted by depth, [maxDraftLen].
+    std::vector<SizeType32> numReachedPerDepth;
+    std::vector<SizeType32> numAcceptedPerDepth;
+    //! \brief Number of steps by accepted path index, for tree based methods. Empty if not recorded.
+    std::vector<SizeType32> acceptedPathsHistogram;
+    SizeType32 numSteps{0};
+    SizeType32 numDraftTokens{0};
+    SizeType32 numAcceptedDraftTokens{0};
+
+    //! \brief Record a verification step: numAcceptedTokens of the numDraftTokens draft tokens were accepted, along
+    //! path acceptedPathIdx of the tree if it is not negative.
+    void record(SizeType32 numDraftTokens, SizeType32 numAcceptedTokens, SizeType32 acceptedPathIdx = -1)
+    {
+        TLLM_CHECK_WITH_INFO(numAcceptedTokens >= 0 && numAcceptedTokens <= numDraftTokens,
+            "Accepted %d of %d draft tokens", numAcceptedTokens, numDraftTokens);
+        growTo(acceptedLengthsHistogram, numAcceptedTokens + 1);
+        growTo(numReachedPerDepth, numDraftTokens);
+        growTo(numAcceptedPerDepth, numDraftTokens);
+        ++acceptedLengthsHistogram[numAcceptedTokens];
+        // Depths past the first rejection are not reached, whatever the length of the draft.
+        auto const numReached = std::min(numAcceptedTokens + 1, numDraftTokens);
+        for (SizeType32 di = 0; di < numReached; ++di)
+        {
+            ++numReachedPerDepth[di];
+            numAcceptedPerDepth[di] += di < numAcceptedTokens ? 1 : 0;
+        }
+        if (acceptedPathIdx >= 0)
+        {
+            growTo(acceptedPathsHistogram, acceptedPathIdx + 1);
+            ++acceptedPathsHistogram[acceptedPathIdx];
+        }
+        ++numSteps;
+        this->numDraftTokens += numDraftTokens;
+        numAcceptedDraftTokens += numAcceptedTokens;
+    }
+
+    void merge(SpeculativeDecodingStats const& other)
+    {
+        addTo(acceptedLengthsHistogram, other.acceptedLengthsHistogram);
+        addTo(numReachedPerDepth, other.numReachedPerDepth);
+        addTo(numAcceptedPerDepth, other.numAcceptedPerDepth);
+        addTo(acceptedPathsHistogram, other.acceptedPathsHistogram);
+        numSteps += other.numSteps;
+        numDraftTokens += other.numDraftTokens;
+        numAcceptedDraftTokens += other.numAcceptedDraftTokens;
+    }
+
+    //! \brief Probability that the draft token at a depth is accepted once it is reached, 0 if it never was.
+    [[nodiscard]] double getAcceptanceProbability(SizeType32 depth) const
+    {
+        if (depth < 0 || depth >= static_cast<SizeType32>(numReachedPerDepth.size()) || numReachedPerDepth[depth] == 0)
+        {
+            return 0.;
+        }
+        return static_cast<double>(numAcceptedPerDepth[depth]) / numReachedPerDepth[depth];
+    }
+
+    //! \brief Draft tokens that were verified but rejected, i.e. target model compute without output.
+    [[nodiscard]] SizeType32 getNumWastedDraftTokens() const
+    {
+        return numDraftTokens - numAcceptedDraftTokens;
+    }
+
+    [[nodiscard]] double getMeanAcceptedLength() const
+    {
+        return numSteps > 0 ? static_cast<double>(numAcceptedDraftTokens) / numSteps : 0.;
+    }
+
+    //! \brief Totals in the layout of RequestStats and IterationStats.
+    [[nodiscard]] executor::RequestPerfMetrics::SpeculativeDecodingMetrics getMetrics() const
+    {
+        executor::RequestPerfMetrics::SpeculativeDecodingMetrics metrics;
+        metrics.totalDraftTokens = numDraftTokens;
+        metrics.totalAcceptedDraftTokens = numAcceptedDraftTokens;
+        if (numDraftTokens > 0)
+        {
+            metrics.acceptanceRate = static_cast<executor::FloatType>(numAcceptedDraftTokens) / numDraftTokens;
+        }
+        return metrics;
+    }
+
+private:
+    static void growTo(std::vector<SizeType32>& values, SizeType32 size)
+    {
+        if (static_cast<SizeType32>(values.size()) < size)
+        {
+            values.resize(size, 0);
+        }
+    }
+
+    static void addTo(std::vector<SizeType32>& values, std::vector<SizeType32> const& other)
+    {
+        growTo(values, static_cast<SizeType32>(other.size()));
+        for (size_t i = 0; i < other.size(); ++i)
+        {
+            values[i] += other[i];
+        }
+    }
+};
+
+//! \brief Speculative decoding stats of the current iteration and of every active request.
+//! \details The executor records the accepted lengths of the generation requests after each decoding step, reports
+//! takeIterationStats with the IterationStats of the step and getRequestStats with the RequestStats of a request.
+class SpeculativeDecodingStatsCollector
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using RequestIdType = LlmRequest::RequestIdType;
+
+    void record(RequestIdType requestId, SizeType32 numDraftTokens, SizeType32 numAcceptedTokens,
+        SizeType32 acceptedPathIdx = -1)
+    {
+        if (numDraftTokens == 0)
+        {
+            return;
+        }
+        mIterationStats.record(numDraftTokens, numAcceptedTokens, acceptedPathIdx);
+        mRequestStats[requestId].record(numDraftTokens, numAcceptedTokens, acceptedPathIdx);
+        mTotalStats.record(numDraftTokens, numAcceptedTokens, acceptedPathIdx);
+    }
+
+    //! \brief Stats of the steps since the last call.
+    [[nodiscard]] SpeculativeDecodingStats takeIterationStats()
+    {
+        SpeculativeDecodingStats stats;
+        std::swap(stats, mIterationStats);
+        return stats;
+    }
+
+    //! \brief Stats of a request over all its steps, empty if it has no verified draft.
+    [[nodiscard]] SpeculativeDecodingStats const& getRequestStats(RequestIdType requestId) const
+    {
+        static SpeculativeDecodingStats const kEmpty{};
+        auto const it = mRequestStats.find(requestId);
+        return it == mRequestStats.end() ? kEmpty : it->second;
+    }
+
+    //! \brief Stats since the creation of the collector.
+    [[nodiscard]] SpeculativeDecodingStats const& getTotalStats() const
+    {
+        return mTotalStats;
+    }
+
+    //! \brief Forget a request, e.g. when it is finished and its stats were reported.
+    void remove(RequestIdType requestId)
+    {
+        mRequestStats.erase(requestId);
+    }
+
+private:
+    SpeculativeDecodingStats mIterationStats;
+    SpeculativeDecodingStats mTotalStats;
+    std::unordered_map<RequestIdType, SpeculativeDecodingStats> mRequestStats;
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/common.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <array>
+#include <optional>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Load-aware switch of speculative decoding for the whole batch, for all speculative decoding modes.
+//! \details Speculation trades compute for latency: at small batch sizes the engine is memory-bound and verifying
+//! drafts is nearly free, while at large batch sizes it is compute-bound and the extra tokens per request slow every
+//! step down more than the accepted drafts gain. The throttle measures the goodput, accepted tokens per second, of
+//! steps with and without drafts, per batch size bucket (powers of two), and enables drafting for a batch size only
+//! while it is the faster mode. Both modes are tried first, and the non-preferred one is probed every probeInterval
+//! steps to follow changes of the acceptance rate. Since the gain of drafting decreases with load, a bucket without
+//! measurements starts with the preference of the nearest smaller bucket.
+class SpeculativeDecodingThrottle
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+
+    struct Config
+    {
+        //! \brief Number of steps of each mode to measure before a bucket has a preference.
+        SizeType32 minSteps{4};
+        //! \brief Period of the steps that probe the non-preferred mode, 0 to never probe.
+        SizeType32 probeInterval{64};
+        //! \brief Weight of a new step in the average goodput.
+        double smoothing{0.1};
+        //! \brief Relative goodput gain needed to switch the preferred mode of a bucket.
+        double hysteresis{0.05};
+    };
+
+    SpeculativeDecodingThrottle()
+        : SpeculativeDecodingThrottle(Config{})
+    {
+    }
+
+    explicit SpeculativeDecodingThrottle(Config const& config)
+        : mConfig{config}
+    {
+        TLLM_CHECK_WITH_INFO(config.minSteps > 0, "minSteps must be positive");
+        TLLM_CHECK_WITH_INFO(config.probeInterval >= 0, "probeInterval must not be negative");
+        TLLM_CHECK_WITH_INFO(config.smoothing > 0. && config.smoothing <= 1., "smoothing must be in (0, 1]");
+        TLLM_CHECK_WITH_INFO(config.hysteresis >= 0., "hysteresis must not be negative");
+    }
+
+    //! \brief Whether the next step of numGenRequests generation requests should draft.
+    [[nodiscard]] bool isDraftingEnabled(SizeType32 numGenRequests)
+    {
+        auto& bucket = mBuckets.at(getBucketIdx(numGenRequests));
+        auto const preferred = getPreferredMode(bucket, getBucketIdx(numGenRequests));
+        // Measure the preferred mode first, then the other one.
+        for (auto const enabled : {preferred, !preferred})
+        {
+            if (bucket.modes[enabled].numSteps < mConfig.minSteps)
+            {
+                return enabled;
+            }
+        }
+        if (mConfig.probeInterval > 0 && ++bucket.numDecisions % mConfig.probeInterval == 0)
+        {
+            return !preferred;
+        }
+        return preferred;
+    }
+
+    //! \brief Record a generation step of numGenRequests requests that produced numTokens accepted tokens, the target
+    //! model tokens included, in stepTimeMs.
+    void update(SizeType32 numGenRequests, bool draftingEnabled, SizeType32 numTokens, double stepTimeMs)
+    {
+        TLLM_CHECK_WITH_INFO(stepTimeMs > 0., "stepTimeMs must be positive");
+        auto const bucketIdx = getBucketIdx(numGenRequests);
+        auto& bucket = mBuckets.at(bucketIdx);
+        auto& mode = bucket.modes[draftingEnabled];
+        // Normalized by the number of requests, since the batch size varies within a bucket.
+        auto const goodput = numTokens / stepTimeMs / numGenRequests;
+        mode.goodput
+            = mode.numSteps == 0 ? goodput : (1. - mConfig.smoothing) * mode.goodput + mConfig.smoothing * goodput;
+        ++mode.numSteps;
+
+        auto const& off = bucket.modes[false];
+        auto const& on = bucket.modes[true];
+        if (off.numSteps < mConfig.minSteps || on.numSteps < mConfig.minSteps)
+        {
+            return;
+        }
+        auto const current = getPreferredMode(bucket, bucketIdx);
+        auto const& currentMode = bucket.modes[current];
+        auto const& otherMode = bucket.modes[!current];
+        bucket.preferred = otherMode.goodput > currentMode.goodput * (1. + mConfig.hysteresis) ? !current : current;
+    }
+
+    //! \brief Discard the draft tokens of requests, for a step that does not draft. Lookahead requests are switched off
+    //! with GptDecoderBatched::disableLookahead instead, and Medusa and Eagle engines always verify their trees.
+    static void discardDraftTokens(RequestVector const& requests)
+    {
+        for (auto const& request : requests)
+        {
+            if (request->hasDraftTokens())
+            {
+                request->discardDraftTokens(request->getNumDraftTokens());
+            }
+        }
+    }
+
+    //! \brief Preferred mode for numGenRequests requests, std::nullopt if it is not measured.
+    [[nodiscard]] std::optional<bool> getPreference(SizeType32 numGenRequests) const
+    {
+        return mBuckets.at(getBucketIdx(numGenRequests)).preferred;
+    }
+
+private:
+    static constexpr SizeType32 kNumBuckets = 32;
+
+    struct ModeStats
+    {
+        double goodput{0.};
+        SizeType32 numSteps{0};
+    };
+
+    struct Bucket
+    {
+        // Indexed by whether drafting is enabled.
+        std::array<ModeStats, 2> modes;
+        std::optional<bool> preferred;
+        SizeType32 numDecisions{0};
+    };
+
+    [[nodiscard]] static SizeType32 getBucketIdx(SizeType32 numGenRequests)
+    {
+        TLLM_CHECK_WITH_INFO(numGenRequests > 0, "No generation requests");
+        SizeType32 idx = 0;
+        while ((numGenRequests >>= 1) > 0)
+        {
+            ++idx;
+        }
+        return idx;
+    }
+
+    [[nodiscard]] bool getPreferredMode(Bucket const& bucket, SizeType32 bucketIdx) const
+    {
+        if (bucket.preferred)
+        {
+            return *bucket.preferred;
+        }
+        for (auto idx = bucketIdx - 1; idx >= 0; --idx)
+        {
+            if (mBuckets[idx].preferred)
+            {
+                return *mBuckets[idx].preferred;
+            }
+        }
+        return true;
+    }
+
+    Config mConfig;
+    std::array<Bucket, kNumBuckets> mBuckets;
+};
+
+} // namespace tensorrt_llm::batch_manager
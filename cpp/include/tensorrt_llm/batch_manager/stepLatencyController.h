@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+
+namespace tensorrt_llm::batch_manager
+{
+
+//! \brief Closed-loop token budget of a step, passed as maxNumTokensRuntime to the MicroBatchScheduler.
+//! \details Steps are modelled as latency = fixedLatency + numTokens * perTokenLatency, fitted online by least
+//! squares with exponential forgetting. The budget is the number of tokens that keeps a step under the target
+//! latency, so decode requests keep their inter-token latency while context chunks take the rest of the step, as in
+//! stall-free batching. Until the fit is usable, the budget is adjusted multiplicatively from the last step.
+class StepLatencyController
+{
+public:
+    using SizeType32 = tensorrt_llm::runtime::SizeType32;
+    using Duration = std::chrono::duration<double>;
+
+    struct Config
+    {
+        Duration targetStepLatency;
+        //! \brief Bounds of the budget. maxNumTokens is usually the maxNumTokens of the engine.
+        SizeType32 minNumTokens;
+        SizeType32 maxNumTokens;
+        //! \brief The budget is a multiple of the context chunk unit.
+        SizeType32 chunkUnitSize{1};
+        //! \brief Weight kept by past steps after every new one.
+        double forgettingFactor{0.98};
+    };
+
+    struct Stats
+    {
+        std::int64_t numSteps{0};
+        std::int64_t numStepsOverTarget{0};
+        double fixedLatency{0.};
+        double perTokenLatency{0.};
+    };
+
+    explicit StepLatencyController(Config const& config)
+        : mConfig{config}
+        , mNumTokens{config.maxNumTokens}
+    {
+        TLLM_CHECK(config.targetStepLatency.count() > 0.);
+        TLLM_CHECK(config.chunkUnitSize > 0 && config.minNumTokens > 0 && config.minNumTokens <= config.maxNumTokens);
+        TLLM_CHECK(config.forgettingFactor > 0. && config.forgettingFactor <= 1.);
+    }
+
+    //! \brief Controller for the target of TRTLLM_TARGET_STEP_LATENCY_MS, not set if the variable is not.
+    [[nodiscard]] static std::optional<StepLatencyController> fromEnv(
+        SizeType32 minNumTokens, SizeType32 maxNumTokens, SizeType32 chunkUnitSize)
+    {
+        auto const targetMs = common::getEnvTargetStepLatencyMs();
+        if (!targetMs.has_value())
+        {
+            return std::nullopt;
+        }
+        return StepLatencyController{Config{std::chrono::duration<double, std::milli>(*targetMs),
+            std::min(minNumTokens, maxNumTokens), maxNumTokens, chunkUnitSize}};
+    }
+
+    //! \brief Record the latency of a step that processed numTokens tokens.
+    void recordStep(SizeType32 numTokens, Duration latency)
+    {
+        auto const x = static_cast<double>(numTokens);
+        auto const y = latency.count();
+        auto const lambda = mConfig.forgettingFactor;
+        mSumWeights = lambda * mSumWeights + 1.;
+        mSumX = lambda * mSumX + x;
+        mSumY = lambda * mSumY + y;
+        mSumXX = lambda * mSumXX + x * x;
+        mSumXY = lambda * mSumXY + x * y;
+        ++mStats.numSteps;
+        if (latency > mConfig.targetStepLatency)
+        {
+            ++mStats.numStepsOverTarget;
+        }
+        mNumTokens = computeNumTokens(numTokens, latency);
+    }
+
+    //! \brief Token budget of the next step, at least numGenerationTokens plus one chunk so context requests always
+    //! progress.
+    [[nodiscard]] SizeType32 getMaxNumTokens(SizeType32 numGenerationTokens = 0) const
+    {
+        auto const minNumTokens = std::min(numGenerationTokens + mConfig.chunkUnitSize, mConfig.maxNumTokens);
+        return std::max(mNumTokens, minNumTokens);
+    }
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+private:
+    [[nodiscard]] SizeType32 computeNumTokens(SizeType32 lastNumTokens, Duration lastLatency)
+    {
+        double numTokens{0.};
+        auto const varianceX = mSumWeights * mSumXX - mSumX * mSumX;
+        auto const slope = varianceX > 0. ? (mSumWeights * mSumXY - mSumX * mSumY) / varianceX : 0.;
+        // The fit needs steps of different sizes, which chunked prefill produces naturally.
+        if (mStats.numSteps >= kMinNumSteps && varianceX > kMinRelativeVariance * mSumXX * mSumWeights && slope > 0.)
+        {
+            auto const intercept = std::max((mSumY - slope * mSumX) / mSumWeights, 0.);
+            mStats.fixedLatency = intercept;
+            mStats.perTokenLatency = slope;
+            numTokens = (mConfig.targetStepLatency.count() - intercept) / slope;
+        }
+        else if (lastLatency > mConfig.targetStepLatency)
+        {
+            numTokens = lastNumTokens * kDecreaseFactor;
+        }
+        else
+        {
+            numTokens = static_cast<double>(mNumTokens) + mConfig.chunkUnitSize;
+        }
+        auto const clamped = std::clamp(numTokens, static_cast<double>(mConfig.minNumTokens),
+            static_cast<double>(mConfig.maxNumTokens));
+        auto const rounded = static_cast<SizeType32>(clamped) / mConfig.chunkUnitSize * mConfig.chunkUnitSize;
+        return std::max(rounded, mConfig.minNumTokens);
+    }
+
+    static constexpr std::int64_t kMinNumSteps = 8;
+    static constexpr double kMinRelativeVariance = 1e-3;
+    static constexpr double kDecreaseFactor = 0.75;
+
+    Config mConfig;
+    SizeType32 mNumTokens;
+    // Exponentially weighted sums of the least squares fit.
+    double mSumWeights{0.};
+    double mSumX{0.};
+    double mSumY{0.};
+    double mSumXX{0.};
+    double mSumXY{0.};
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::batch_manager
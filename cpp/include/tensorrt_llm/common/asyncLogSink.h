@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/stringUtils.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief A log message whose printf formatting is deferred to the writer thread of AsyncLogSink. The payload holds
+//! the arguments, then copies of the format and of the string arguments, which may not outlive the log call.
+struct LogRecord
+{
+    static constexpr std::size_t kPayloadSize = 464;
+
+    using FormatFn = std::string (*)(LogRecord const& record);
+
+    FormatFn format{nullptr};
+    //! \brief Static strings of the logger.
+    char const* prefix{nullptr};
+    char const* levelName{nullptr};
+    //! \brief -1 if the message has no rank.
+    int rank{-1};
+    alignas(std::max_align_t) std::array<char, kPayloadSize> payload;
+};
+
+//! \brief Writes the log messages of all the threads from one background thread, so that the threads that log only
+//! copy their arguments. Every thread that logs gets a single producer ring of kRingCapacity records, which the
+//! writer drains without lock. Messages that do not fit in a record are left to the caller to log synchronously.
+//! Enabled by TLLM_LOG_ASYNC=1.
+class AsyncLogSink
+{
+public:
+    static constexpr std::size_t kRingCapacity = 256;
+
+    static AsyncLogSink& getInstance();
+
+    [[nodiscard]] static bool isEnabled();
+
+    //! \brief Queue a message of the calling thread. False if it does not fit in a record or the ring of the thread
+    //! stays full, the caller then logs it synchronously.
+    template <typename... Args>
+    bool push(char const* prefix, char const* levelName, int rank, char const* format, Args const&... args);
+
+    //! \brief Wait for the writer to output the queued messages of the calling thread, e.g. before a synchronous
+    //! message that must come after them.
+    void flushThread();
+
+    ~AsyncLogSink();
+
+    AsyncLogSink(AsyncLogSink const&) = delete;
+    AsyncLogSink& operator=(AsyncLogSink const&) = delete;
+
+private:
+    //! \brief What a record stores for an argument of type T, char strings being offsets in the payload.
+    template <typename T>
+    using StoredArg = std::conditional_t<std::is_same_v<std::decay_t<T>, char const*>
+            || std::is_same_v<std::decay_t<T>, char*>,
+        std::uint32_t, std::decay_t<T>>;
+
+    template <typename... Args>
+    static std::string formatRecord(LogRecord const& record)
+    {
+        using Stored = std::tuple<StoredArg<Args>...>;
+        auto const& stored = *std::launder(reinterpret_cast<Stored const*>(record.payload.data()));
+        auto const* format = record.payload.data() + sizeof(Stored);
+        return std::apply(
+            [&record, format](auto const&... storedArgs)
+            {
+                if constexpr (sizeof...(storedArgs) > 0)
+                {
+                    return fmtstr(format, restoreArg<Args>(record, storedArgs)...);
+                }
+                else
+                {
+                    return std::string{format};
+                }
+            },
+            stored);
+    }
+
+    template <typename T, typename S>
+    static auto restoreArg(LogRecord const& record, S const& storedArg)
+    {
+        if constexpr (std::is_same_v<StoredArg<T>, std::uint32_t> && !std::is_same_v<std::decay_t<T>, std::uint32_t>)
+        {
+            return static_cast<char const*>(record.payload.data() + storedArg);
+        }
+        else
+        {
+            return storedArg;
+        }
+    }
+
+    //! \brief Copy a string in the payload at offset, nullptr as "(null)" like printf.
+    static bool appendString(LogRecord& record, std::size_t& offset, char const* str)
+    {
+        auto const* src = str != nullptr ? str : "(null)";
+        auto const size = std::strlen(src) + 1;
+        if (offset + size > LogRecord::kPayloadSize)
+        {
+            return false;
+        }
+        std::memcpy(record.payload.data() + offset, src, size);
+        offset += size;
+        return true;
+    }
+
+    template <typename T>
+    static StoredArg<T> storeArg(LogRecord& record, std::size_t& offset, T const& arg, bool& fits)
+    {
+        if constexpr (std::is_same_v<StoredArg<T>, std::uint32_t> && !std::is_same_v<std::decay_t<T>, std::uint32_t>)
+        {
+            auto const argOffset = static_cast<std::uint32_t>(offset);
+            fits = appendString(record, offset, arg) && fits;
+            return argOffset;
+        }
+        else
+        {
+            return arg;
+        }
+    }
+
+    //! \brief Where the calling thread writes its next record, nullptr if its ring is still full after a wait.
+    LogRecord* acquireRecord();
+    void commitRecord();
+
+    AsyncLogSink();
+
+    void writerLoop();
+
+    struct Impl;
+    Impl* mImpl;
+};
+
+template <typename... Args>
+bool AsyncLogSink::push(char const* prefix, char const* levelName, int rank, char const* format, Args const&... args)
+{
+    // Other arguments, if any, are formatted synchronously.
+    if constexpr (!((std::is_arithmetic_v<std::decay_t<Args>> || std::is_enum_v<std::decay_t<Args>>
+                        || std::is_pointer_v<std::decay_t<Args>>) &&...))
+    {
+        return false;
+    }
+    else
+    {
+        using Stored = std::tuple<StoredArg<Args>...>;
+        static_assert(alignof(Stored) <= alignof(std::max_align_t) && sizeof(Stored) < LogRecord::kPayloadSize);
+
+        auto* record = acquireRecord();
+        if (record == nullptr)
+        {
+            return false;
+        }
+        // The arguments go first, so that the strings are copied after their offsets are known.
+        std::size_t offset = sizeof(Stored);
+        bool fits = appendString(*record, offset, format);
+        if (fits)
+        {
+            new (record->payload.data()) Stored{storeArg(*record, offset, args, fits)...};
+        }
+        if (!fits)
+        {
+            // The record is not committed, the next message reuses it.
+            return false;
+        }
+        record->format = &formatRecord<Args...>;
+        record->prefix = prefix;
+        record->levelName = levelName;
+        record->rank = rank;
+        commitRecord();
+        return true;
+    }
+}
+
+} // namespace tensorrt_llm::common
@@ -22,8 +22,19 @@
 #include <string>
 
 #include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/asyncLogSink.h"
 #include "tensorrt_llm/common/stringUtils.h"
 
+// The TLLM_LOG_* calls below this level are compiled out, see the LOG_MIN_LEVEL option of CMake. Release builds keep
+// INFO and above by default.
+#ifndef TLLM_LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define TLLM_LOG_MIN_LEVEL 20
+#else
+#define TLLM_LOG_MIN_LEVEL 0
+#endif
+#endif
+
 namespace tensorrt_llm::common
 {
 
@@ -122,6 +133,24 @@ private:
         TLLM_THROW("Unknown log level: %d", level);
     }
 
+    //! \brief Queue the message in the AsyncLogSink if it is enabled. Warnings, errors and the messages that do not
+    //! fit in a record are left to the synchronous path, after the queued messages of the thread.
+    template <typename... Args>
+    static bool logAsync(Level const level, int const rank, char const* format, Args const&... args)
+    {
+        if (!AsyncLogSink::isEnabled())
+        {
+            return false;
+        }
+        auto& sink = AsyncLogSink::getInstance();
+        if (level < WARNING && sink.push(kPREFIX, getLevelName(level), rank, format, args...))
+        {
+            return true;
+        }
+        sink.flushThread();
+        return false;
+    }
+
     static inline std::string getPrefix(Level const level)
     {
         return fmtstr("%s[%s] ", kPREFIX, getLevelName(level));
@@ -136,7 +165,7 @@ private:
 template <typename... Args>
 void Logger::log(Logger::Level level, char const* format, Args const&... args)
 {
-    if (isEnabled(level))
+    if (isEnabled(level) && !logAsync(level, -1, format, args...))
     {
         auto const fmt = getPrefix(level) + format;
         auto& out = level_ < WARNING ? std::cout : std::cerr;
@@ -155,7 +184,7 @@ void Logger::log(Logger::Level level, char const* format, Args const&... args)
 template <typename... Args>
 void Logger::log(Logger::Level const level, int const rank, char const* format, Args const&... args)
 {
-    if (isEnabled(level))
+    if (isEnabled(level) && !logAsync(level, rank, format, args...))
     {
         auto const fmt = getPrefix(level, rank) + format;
         auto& out = level_ < WARNING ? std::cout : std::cerr;
@@ -174,10 +203,13 @@ void Logger::log(Logger::Level const level, int const rank, char const* format,
 #define TLLM_LOG(level, ...)                                                                                           \
     do                                                                                                                 \
     {                                                                                                                  \
-        auto* const logger = tensorrt_llm::common::Logger::getLogger();                                                \
-        if (logger->isEnabled(level))                                                                                  \
+        if constexpr (static_cast<int>(level) >= TLLM_LOG_MIN_LEVEL)                                                   \
         {                                                                                                              \
-            logger->log(level, __VA_ARGS__);                                                                           \
+            auto* const logger = tensorrt_llm::common::Logger::getLogger();                                            \
+            if (logger->isEnabled(level))                                                                              \
+            {                                                                                                          \
+                logger->log(level, __VA_ARGS__);                                                                       \
+            }                                                                                                          \
         }                                                                                                              \
     } while (0)
 
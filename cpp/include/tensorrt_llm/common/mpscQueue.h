@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief Unbounded multiple producer, single consumer queue. A push is one atomic exchange whatever the number of
+//! producers, and never waits on the consumer or on another producer.
+//! \details Intrusive linked list with a stub node, after D. Vyukov. A push that exchanged the head but did not link
+//! its node yet hides the later nodes from tryPop for that time, so the consumer must retry, not assume the queue is
+//! empty for good.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue()
+        : mHead{new Node}
+        , mTail{mHead.load(std::memory_order_relaxed)}
+    {
+    }
+
+    ~MpscQueue()
+    {
+        while (tryPop().has_value())
+        {
+        }
+        delete mTail;
+    }
+
+    MpscQueue(MpscQueue const&) = delete;
+    MpscQueue& operator=(MpscQueue const&) = delete;
+
+    //! \brief Any thread.
+    void push(T value)
+    {
+        auto* node = new Node{std::move(value)};
+        auto* prev = mHead.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    //! \brief The consumer thread only.
+    [[nodiscard]] std::optional<T> tryPop()
+    {
+        auto* tail = mTail;
+        auto* next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+        {
+            return std::nullopt;
+        }
+        // next becomes the stub node.
+        std::optional<T> value{std::move(next->value)};
+        next->value.reset();
+        mTail = next;
+        delete tail;
+        return value;
+    }
+
+    //! \brief The consumer thread only. False may be transient, see the class details.
+    [[nodiscard]] bool hasNext() const
+    {
+        return mTail->next.load(std::memory_order_acquire) != nullptr;
+    }
+
+private:
+    struct Node
+    {
+        Node() = default;
+
+        explicit Node(T&& v)
+            : value{std::move(v)}
+        {
+        }
+
+        std::atomic<Node*> next{nullptr};
+        std::optional<T> value;
+    };
+
+    alignas(64) std::atomic<Node*> mHead;
+    alignas(64) Node* mTail;
+};
+
+} // namespace tensorrt_llm::common
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace tensorrt_llm::common
+{
+
+//!
+//! \brief Vector of trivially copyable elements that stores up to N of them inline and only allocates beyond that.
+//!
+template <typename T, std::size_t N>
+class SmallVector
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector only holds trivially copyable types");
+
+public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using iterator = T*;
+    using const_iterator = T const*;
+
+    SmallVector() = default;
+
+    SmallVector(SmallVector const& other)
+    {
+        assign(other.begin(), other.end());
+    }
+
+    SmallVector& operator=(SmallVector const& other)
+    {
+        if (this != &other)
+        {
+            clear();
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    SmallVector(SmallVector&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept
+    {
+        if (this != &other)
+        {
+            mHeap = std::move(other.mHeap);
+            mCapacity = other.mCapacity;
+            mSize = other.mSize;
+            if (!mHeap)
+            {
+                std::memcpy(mInline.data(), other.mInline.data(), mSize * sizeof(T));
+            }
+            other.mCapacity = N;
+            other.mSize = 0;
+        }
+        return *this;
+    }
+
+    [[nodiscard]] T* data() noexcept
+    {
+        return mHeap ? mHeap.get() : mInline.data();
+    }
+
+    [[nodiscard]] T const* data() const noexcept
+    {
+        return mHeap ? mHeap.get() : mInline.data();
+    }
+
+    [[nodiscard]] iterator begin() noexcept
+    {
+        return data();
+    }
+
+    [[nodiscard]] iterator end() noexcept
+    {
+        return data() + mSize;
+    }
+
+    [[nodiscard]] const_iterator begin() const noexcept
+    {
+        return data();
+    }
+
+    [[nodiscard]] const_iterator end() const noexcept
+    {
+        return data() + mSize;
+    }
+
+    [[nodiscard]] size_type size() const noexcept
+    {
+        return mSize;
+    }
+
+    [[nodiscard]] size_type capacity() const noexcept
+    {
+        return mCapacity;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return mSize == 0;
+    }
+
+    //! \brief Whether the elements are stored inline.
+    [[nodiscard]] bool isInline() const noexcept
+    {
+        return !mHeap;
+    }
+
+    [[nodiscard]] T& operator[](size_type index)
+    {
+        TLLM_CHECK_DEBUG_WITH_INFO(index < mSize, "Index %zu is out of bounds [0, %zu)", index, mSize);
+        return data()[index];
+    }
+
+    [[nodiscard]] T const& operator[](size_type index) const
+    {
+        TLLM_CHECK_DEBUG_WITH_INFO(index < mSize, "Index %zu is out of bounds [0, %zu)", index, mSize);
+        return data()[index];
+    }
+
+    void clear() noexcept
+    {
+        mSize = 0;
+    }
+
+    void reserve(size_type capacity)
+    {
+        if (capacity <= mCapacity)
+        {
+            return;
+        }
+        auto heap = std::make_unique<T[]>(capacity);
+        std::memcpy(heap.get(), data(), mSize * sizeof(T));
+        mHeap = std::move(heap);
+        mCapacity = capacity;
+    }
+
+    void push_back(T const& value)
+    {
+        if (mSize == mCapacity)
+        {
+            reserve(mCapacity * 2);
+        }
+        data()[mSize++] = value;
+    }
+
+    void append(T const* first, T const* last)
+    {
+        auto const count = static_cast<size_type>(last - first);
+        if (mSize + count > mCapacity)
+        {
+            reserve(std::max(mSize + count, mCapacity * 2));
+        }
+        if (count > 0)
+        {
+            std::memcpy(data() + mSize, first, count * sizeof(T));
+        }
+        mSize += count;
+    }
+
+    void assign(T const* first, T const* last)
+    {
+        clear();
+        append(first, last);
+    }
+
+private:
+    std::array<T, N> mInline{};
+    std::unique_ptr<T[]> mHeap;
+    size_type mCapacity{N};
+    size_type mSize{0};
+};
+
+} // namespace tensorrt_llm::common
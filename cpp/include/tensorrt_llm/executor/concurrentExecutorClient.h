@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/mpscQueue.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/executor/types.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::executor
+{
+
+/// @brief Front of an executor for many client threads, e.g. the handlers of a gRPC server.
+/// @details enqueueRequest is a lock-free push to a queue that one submitter thread drains, passing every batch it
+/// finds to a single enqueueRequests call, so the client threads neither wait for the executor nor contend on its
+/// request queue. One poller thread takes the responses of the executor and files them by client id in numShards
+/// maps, each with its own lock, so a client thread awaiting its requests only contends with the others of its shard.
+///
+/// Every request is identified by its client id, which is assigned by enqueueRequest unless the request has one. The
+/// client ids of the requests in flight must be unique.
+class ConcurrentExecutorClient
+{
+public:
+    using RequestSink = std::function<std::vector<IdType>(std::vector<Request> const&)>;
+    using ResponseSource = std::function<std::vector<Response>(std::optional<std::chrono::milliseconds> const&)>;
+
+    explicit ConcurrentExecutorClient(Executor& executor, SizeType32 numShards = 16,
+        std::chrono::milliseconds pollTimeout = std::chrono::milliseconds{100})
+        : ConcurrentExecutorClient(
+            [&executor](std::vector<Request> const& requests) { return executor.enqueueRequests(requests); },
+            [&executor](std::optional<std::chrono::milliseconds> const& timeout)
+            { return executor.awaitResponses(timeout); },
+            numShards, pollTimeout)
+    {
+    }
+
+    ConcurrentExecutorClient(RequestSink sink, ResponseSource source, SizeType32 numShards = 16,
+        std::chrono::milliseconds pollTimeout = std::chrono::milliseconds{100})
+        : mSink{std::move(sink)}
+        , mSource{std::move(source)}
+        , mPollTimeout{pollTimeout}
+    {
+        TLLM_CHECK_WITH_INFO(numShards > 0, "The client needs at least one response shard");
+        mShards.reserve(numShards);
+        for (SizeType32 si = 0; si < numShards; ++si)
+        {
+            mShards.push_back(std::make_unique<Shard>());
+        }
+        mSubmitter = std::thread(&ConcurrentExecutorClient::submitLoop, this);
+        mPoller = std::thread(&ConcurrentExecutorClient::pollLoop, this);
+    }
+
+    ~ConcurrentExecutorClient()
+    {
+        stop();
+    }
+
+    ConcurrentExecutorClient(ConcurrentExecutorClient const&) = delete;
+    ConcurrentExecutorClient& operator=(ConcurrentExecutorClient const&) = delete;
+
+    //! \brief Submit the queued requests and stop the threads. The responses already filed can still be awaited.
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mSubmitMutex);
+            mStop = true;
+        }
+        mSubmitCv.notify_one();
+        if (mSubmitter.joinable())
+        {
+            mSubmitter.join();
+        }
+        if (mPoller.joinable())
+        {
+            mPoller.join();
+        }
+        for (auto& shard : mShards)
+        {
+            shard->cv.notify_all();
+        }
+    }
+
+    //! \brief Queue a request for the submitter thread, from any thread.
+    //! \return The client id of the request, with which its responses are awaited.
+    IdType enqueueRequest(Request request)
+    {
+        auto clientId = request.getClientId();
+        if (!clientId.has_value())
+        {
+            clientId = mNextClientId.fetch_add(1, std::memory_order_relaxed);
+            request.setClientId(*clientId);
+        }
+        mQueue.push(std::move(request));
+        // Pairs with the fence of the submitter before it sleeps: either it sees the request or this sees it asleep.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (mSubmitterSleeping.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(mSubmitMutex);
+            mSubmitCv.notify_one();
+        }
+        return *clientId;
+    }
+
+    //! \brief Wait for the responses of a request, at most timeout if given.
+    [[nodiscard]] std::vector<Response> awaitResponses(
+        IdType clientId, std::optional<std::chrono::milliseconds> const& timeout = std::nullopt)
+    {
+        auto& shard = getShard(clientId);
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        auto const ready = [this, &shard, clientId]()
+        {
+            auto const it = shard.responses.find(clientId);
+            return (it != shard.responses.end() && !it->second.empty()) || mPollerDone.load();
+        };
+        if (timeout.has_value())
+        {
+            shard.cv.wait_for(lock, *timeout, ready);
+        }
+        else
+        {
+            shard.cv.wait(lock, ready);
+        }
+        std::vector<Response> responses;
+        if (auto const it = shard.responses.find(clientId); it != shard.responses.end())
+        {
+            responses = std::move(it->second);
+            shard.responses.erase(it);
+        }
+        return responses;
+    }
+
+    //! \brief Executor request id of a request once it is submitted, e.g. to cancel it.
+    [[nodiscard]] std::optional<IdType> getRequestId(IdType clientId) const
+    {
+        auto const& shard = getShard(clientId);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto const it = shard.requestIds.find(clientId);
+        return it != shard.requestIds.end() ? std::optional<IdType>{it->second} : std::nullopt;
+    }
+
+    [[nodiscard]] SizeType32 getNumShards() const noexcept
+    {
+        return static_cast<SizeType32>(mShards.size());
+    }
+
+private:
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::condition_variable cv;
+        std::unordered_map<IdType, std::vector<Response>> responses;
+        std::unordered_map<IdType, IdType> requestIds;
+    };
+
+    [[nodiscard]] Shard& getShard(IdType clientId) const
+    {
+        return *mShards[clientId % mShards.size()];
+    }
+
+    void file(Response response)
+    {
+        auto const clientId = response.getClientId();
+        if (!clientId.has_value())
+        {
+            TLLM_LOG_WARNING("Dropping a response of request %lu without client id", response.getRequestId());
+            return;
+        }
+        auto& shard = getShard(*clientId);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            if (response.hasError() || response.getResult().isFinal)
+            {
+                shard.requestIds.erase(*clientId);
+            }
+            shard.responses[*clientId].push_back(std::move(response));
+        }
+        shard.cv.notify_all();
+    }
+
+    void submit(std::vector<Request>& batch)
+    {
+        std::vector<IdType> requestIds;
+        try
+        {
+            requestIds = mSink(batch);
+        }
+        catch (std::exception const&)
+        {
+            // One invalid request fails the whole batch, retry them one at a time to fail only that one.
+            for (auto const& request : batch)
+            {
+                try
+                {
+                    requestIds.push_back(mSink({request}).front());
+                }
+                catch (std::exception const& requestError)
+                {
+                    file(Response{0, requestError.what(), request.getClientId()});
+                    requestIds.push_back(0);
+                }
+            }
+        }
+        for (std::size_t ri = 0; ri < batch.size(); ++ri)
+        {
+            auto const clientId = batch[ri].getClientId().value();
+            if (requestIds[ri] == 0)
+            {
+                continue;
+            }
+            auto& shard = getShard(clientId);
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            // The final response may already be filed.
+            auto const it = shard.responses.find(clientId);
+            bool const finished = it != shard.responses.end() && !it->second.empty()
+                && (it->second.back().hasError() || it->second.back().getResult().isFinal);
+            if (!finished)
+            {
+                shard.requestIds[clientId] = requestIds[ri];
+            }
+        }
+        batch.clear();
+    }
+
+    void submitLoop()
+    {
+        std::vector<Request> batch;
+        while (true)
+        {
+            while (auto request = mQueue.tryPop())
+            {
+                batch.push_back(std::move(*request));
+            }
+            if (!batch.empty())
+            {
+                submit(batch);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(mSubmitMutex);
+            if (mStop && !mQueue.hasNext())
+            {
+                break;
+            }
+            mSubmitterSleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!mQueue.hasNext())
+            {
+                // The timeout covers the requests of a push that is not linked yet, see MpscQueue.
+                mSubmitCv.wait_for(lock, mPollTimeout);
+            }
+            mSubmitterSleeping.store(false, std::memory_order_relaxed);
+        }
+        mSubmitterDone = true;
+    }
+
+    void pollLoop()
+    {
+        // Keep polling until the submitted requests could not produce more responses, i.e. until stop.
+        while (!mSubmitterDone.load())
+        {
+            for (auto& response : mSource(mPollTimeout))
+            {
+                file(std::move(response));
+            }
+        }
+        mPollerDone = true;
+    }
+
+    RequestSink mSink;
+    ResponseSource mSource;
+    std::chrono::milliseconds mPollTimeout;
+    std::vector<std::unique_ptr<Shard>> mShards;
+
+    common::MpscQueue<Request> mQueue;
+    std::atomic<IdType> mNextClientId{1};
+    std::atomic<bool> mSubmitterSleeping{false};
+    std::mutex mSubmitMutex;
+    std::condition_variable mSubmitCv;
+    bool mStop{false};
+    std::atomic<bool> mSubmitterDone{false};
+    std::atomic<bool> mPollerDone{false};
+
+    std::thread mSubmitter;
+    std::thread mPoller;
+};
+
+} // namespace tensorrt_llm::executor
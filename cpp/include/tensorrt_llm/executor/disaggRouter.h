@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheRemoteBlocks.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/executor/types.h"
+
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace tensorrt_llm::executor::disagg_executor
+{
+
+/// @brief Chooses the context and generation executors of DisaggExecutorOrchestrator requests.
+/// @details Context instances are chosen by the prefill work a request adds: the prompt blocks the instance does not
+///          hold already plus a fixed cost per request queued or running there. Held prefixes are tracked from the
+///          KV cache events of every context instance, so requests sharing a prefix land where its KV cache lives.
+///          Generation instances are chosen by free KV cache blocks. Both count the requests they routed since the last
+///          stats update of an instance, so a burst is spread before the stats catch up.
+///
+///          Pass its choices as the explicit indices of enqueueContext and enqueueGeneration, and feed it with the
+///          latest iteration stats and KV cache events of the executors.
+class DisaggRouter
+{
+public:
+    struct Config
+    {
+        /// @brief Tokens per KV cache block of the context instances.
+        SizeType32 tokensPerBlock;
+        /// @brief Prefill cost of a request that is queued or running on an instance, in blocks.
+        float requestCostInBlocks{8.F};
+        /// @brief Whether the block hashes of the instances include extra token ids, e.g. for prompt tuning.
+        bool usesExtraIds{false};
+    };
+
+    struct Stats
+    {
+        std::int64_t numContextRequests{0};
+        std::int64_t numGenerationRequests{0};
+        //! \brief Prompt blocks held by the chosen context instances.
+        std::int64_t numCachedBlocks{0};
+        std::int64_t numPromptBlocks{0};
+    };
+
+    DisaggRouter(SizeType32 numContextInstances, SizeType32 numGenInstances, Config const& config)
+        : mConfig{config}
+        , mContextInstances(numContextInstances)
+        , mGenInstances(numGenInstances)
+    {
+        TLLM_CHECK(numContextInstances > 0 && numGenInstances > 0 && config.tokensPerBlock > 0);
+    }
+
+    void updateContextStats(SizeType32 instanceIdx, IterationStats const& stats)
+    {
+        std::lock_guard lock{mMutex};
+        update(mContextInstances.at(instanceIdx), stats);
+    }
+
+    void updateGenerationStats(SizeType32 instanceIdx, IterationStats const& stats)
+    {
+        std::lock_guard lock{mMutex};
+        update(mGenInstances.at(instanceIdx), stats);
+    }
+
+    /// @brief Track the blocks a context instance stores and evicts, e.g. from KVCacheEventManager::getLatestEvents.
+    void applyContextEvents(SizeType32 instanceIdx, std::deque<KVCacheEvent> const& events)
+    {
+        std::lock_guard lock{mMutex};
+        TLLM_CHECK(instanceIdx >= 0 && instanceIdx < static_cast<SizeType32>(mContextInstances.size()));
+        mBlockIndex.apply(static_cast<InstanceId>(instanceIdx), events);
+    }
+
+    [[nodiscard]] SizeType32 selectContext(Request const& request)
+    {
+        auto const tokens = request.getInputTokenIds();
+        batch_manager::kv_cache_manager::VecUniqueTokens uniqueTokens;
+        uniqueTokens.reserve(tokens.size());
+        for (auto const token : tokens)
+        {
+            uniqueTokens.push_back({token, 0});
+        }
+        auto const loraConfig = request.getLoraConfig();
+        std::optional<batch_manager::kv_cache_manager::LoraTaskIdType> loraTaskId;
+        if (loraConfig.has_value())
+        {
+            loraTaskId = loraConfig->getTaskId();
+        }
+        auto const blockHashes = batch_manager::kv_cache_manager::computeBlockHashes(
+            uniqueTokens, mConfig.tokensPerBlock, loraTaskId, mConfig.usesExtraIds);
+        auto const numPromptBlocks = getNumBlocks(static_cast<SizeType32>(tokens.size()));
+
+        std::lock_guard lock{mMutex};
+        SizeType32 bestIdx{0};
+        std::size_t bestNumCached{0};
+        auto bestCost = std::numeric_limits<double>::max();
+        for (SizeType32 idx = 0; idx < static_cast<SizeType32>(mContextInstances.size()); ++idx)
+        {
+            auto const& instance = mContextInstances[idx];
+            auto const numCached = mBlockIndex.getNumPrefixBlocks(static_cast<InstanceId>(idx), blockHashes);
+            auto const numNewBlocks = numPromptBlocks - static_cast<SizeType32>(numCached);
+            auto cost = static_cast<double>(numNewBlocks)
+                + mConfig.requestCostInBlocks * static_cast<double>(instance.numRequests + instance.numRouted);
+            // Instances that cannot hold the new blocks would queue the request until others finish.
+            if (instance.numFreeBlocks.has_value() && *instance.numFreeBlocks - instance.numReserved < numNewBlocks)
+            {
+                cost += kFullPenalty;
+            }
+            if (cost < bestCost)
+            {
+                bestIdx = idx;
+                bestCost = cost;
+                bestNumCached = numCached;
+            }
+        }
+        auto& chosen = mContextInstances[bestIdx];
+        ++chosen.numRouted;
+        chosen.numReserved += numPromptBlocks - static_cast<SizeType32>(bestNumCached);
+        ++mStats.numContextRequests;
+        mStats.numCachedBlocks += static_cast<std::int64_t>(bestNumCached);
+        mStats.numPromptBlocks += numPromptBlocks;
+        return bestIdx;
+    }
+
+    [[nodiscard]] SizeType32 selectGeneration(Request const& request)
+    {
+        auto const numBlocks = getNumBlocks(static_cast<SizeType32>(request.getInputTokenIds().size())
+                                   + request.getMaxTokens())
+            * request.getSamplingConfig().getBeamWidth();
+
+        std::lock_guard lock{mMutex};
+        SizeType32 bestIdx{0};
+        auto bestNumFree = std::numeric_limits<std::int64_t>::min();
+        for (SizeType32 idx = 0; idx < static_cast<SizeType32>(mGenInstances.size()); ++idx)
+        {
+            auto const& instance = mGenInstances[idx];
+            // Without stats, every instance counts as empty and the routed requests decide.
+            auto const numFree = static_cast<std::int64_t>(instance.numFreeBlocks.value_or(0)) - instance.numReserved;
+            if (numFree > bestNumFree)
+            {
+                bestIdx = idx;
+                bestNumFree = numFree;
+            }
+        }
+        auto& chosen = mGenInstances[bestIdx];
+        ++chosen.numRouted;
+        chosen.numReserved += numBlocks;
+        ++mStats.numGenerationRequests;
+        return bestIdx;
+    }
+
+    [[nodiscard]] Stats getStats() const
+    {
+        std::lock_guard lock{mMutex};
+        return mStats;
+    }
+
+private:
+    using InstanceId = batch_manager::kv_cache_manager::KVCacheRemoteBlockIndex::InstanceId;
+
+    static constexpr double kFullPenalty{1e9};
+
+    struct Instance
+    {
+        SizeType32 numRequests{0};
+        std::optional<SizeType32> numFreeBlocks;
+        //! \brief Requests and blocks routed since the last stats update.
+        SizeType32 numRouted{0};
+        std::int64_t numReserved{0};
+    };
+
+    static void update(Instance& instance, IterationStats const& stats)
+    {
+        instance.numRequests = stats.numActiveRequests + stats.numQueuedRequests;
+        if (stats.kvCacheStats.has_value())
+        {
+            instance.numFreeBlocks = stats.kvCacheStats->freeNumBlocks;
+        }
+        instance.numRouted = 0;
+        instance.numReserved = 0;
+    }
+
+    [[nodiscard]] SizeType32 getNumBlocks(SizeType32 numTokens) const
+    {
+        return (numTokens + mConfig.tokensPerBlock - 1) / mConfig.tokensPerBlock;
+    }
+
+    Config mConfig;
+    mutable std::mutex mMutex;
+    std::vector<Instance> mContextInstances;
+    std::vector<Instance> mGenInstances;
+    batch_manager::kv_cache_manager::KVCacheRemoteBlockIndex mBlockIndex;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::executor::disagg_executor
@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/executor/executor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::executor
+{
+
+/// @brief Runs draft-target speculative decoding with two executors in one process.
+/// @details A request goes through speculation rounds. First the draft executor generates up to numDraftTokens tokens.
+/// Then the target executor verifies them as ExternalDraftTokensConfig and yields the accepted tokens plus one of its
+/// own. The rounds are chained by one thread per executor, the thread that receives the responses of that executor, so
+/// the client enqueues and awaits a request once, as with a single Executor. Draft rounds of some requests run while
+/// the target verifies others. Both executors should enable KV cache block reuse so that every round only computes the
+/// context of the tokens of the previous round.
+class DraftTargetExecutor
+{
+public:
+    DraftTargetExecutor(
+        std::shared_ptr<Executor> draftExecutor, std::shared_ptr<Executor> targetExecutor, SizeType32 numDraftTokens)
+        : mDraftExecutor{std::move(draftExecutor)}
+        , mTargetExecutor{std::move(targetExecutor)}
+        , mNumDraftTokens{numDraftTokens}
+    {
+        TLLM_CHECK_WITH_INFO(mDraftExecutor && mTargetExecutor, "Both executors are required");
+        TLLM_CHECK_WITH_INFO(numDraftTokens > 0, "numDraftTokens must be positive");
+        TLLM_CHECK_WITH_INFO(mDraftExecutor->canEnqueueRequests() && mTargetExecutor->canEnqueueRequests(),
+            "DraftTargetExecutor must run on the ranks that enqueue requests");
+        mDraftThread = std::thread([this]() { receiveLoop(*mDraftExecutor, true); });
+        mTargetThread = std::thread([this]() { receiveLoop(*mTargetExecutor, false); });
+    }
+
+    DraftTargetExecutor(DraftTargetExecutor const&) = delete;
+    DraftTargetExecutor& operator=(DraftTargetExecutor const&) = delete;
+
+    ~DraftTargetExecutor()
+    {
+        shutdown();
+    }
+
+    /// @brief Enqueue a request with beam width 1. Its sampling config, end id and stop words are used by both models.
+    IdType enqueueRequest(Request const& request)
+    {
+        TLLM_CHECK_WITH_INFO(
+            request.getSamplingConfig().getBeamWidth() == 1, "Draft-target speculation requires beam width 1");
+        TLLM_CHECK_WITH_INFO(!request.getExternalDraftTokensConfig().has_value(),
+            "Draft tokens of a draft-target request are generated by the draft executor");
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto const requestId = mNextRequestId++;
+        auto& sequence = mSequences.emplace(requestId, Sequence{request}).first->second;
+        sequence.tokens = request.getInputTokenIds();
+        sequence.numPromptTokens = static_cast<SizeType32>(sequence.tokens.size());
+        startRound(requestId, sequence);
+        return requestId;
+    }
+
+    /// @brief Responses of all requests, as Executor::awaitResponses. Streaming requests get the new tokens of every
+    /// speculation round.
+    std::vector<Response> awaitResponses(std::optional<std::chrono::milliseconds> const& timeout = std::nullopt)
+    {
+        std::unique_lock<std::mutex> lock(mResponsesMutex);
+        auto const ready = [this]() { return !mResponses.empty() || mShutdown; };
+        if (timeout)
+        {
+            mResponsesCv.wait_for(lock, *timeout, ready);
+        }
+        else
+        {
+            mResponsesCv.wait(lock, ready);
+        }
+        std::vector<Response> responses(
+            std::make_move_iterator(mResponses.begin()), std::make_move_iterator(mResponses.end()));
+        mResponses.clear();
+        return responses;
+    }
+
+    /// @brief Cancel a request. Its final response is sent once the round in flight returns.
+    void cancelRequest(IdType requestId)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (auto const it = mSequences.find(requestId); it != mSequences.end())
+        {
+            it->second.cancelled = true;
+        }
+    }
+
+    /// @brief Fraction of the draft tokens that were accepted by the target model.
+    [[nodiscard]] double getAcceptanceRate() const
+    {
+        auto const numDraft = mNumDraftTokensTotal.load();
+        return numDraft == 0 ? 0. : static_cast<double>(mNumAcceptedTokensTotal.load()) / numDraft;
+    }
+
+    void shutdown()
+    {
+        if (mShutdown.exchange(true))
+        {
+            return;
+        }
+        mResponsesCv.notify_all();
+        mDraftThread.join();
+        mTargetThread.join();
+    }
+
+private:
+    static constexpr auto kPollTimeout = std::chrono::milliseconds(10);
+
+    struct Sequence
+    {
+        Request request;
+        //! Prompt and accepted tokens.
+        VecTokens tokens{};
+        SizeType32 numPromptTokens{0};
+        //! Draft tokens of the round in flight.
+        VecTokens draftTokens{};
+        bool cancelled{false};
+
+        [[nodiscard]] SizeType32 getNumGeneratedTokens() const
+        {
+            return static_cast<SizeType32>(tokens.size()) - numPromptTokens;
+        }
+
+        [[nodiscard]] SizeType32 getNumRemainingTokens() const
+        {
+            return request.getMaxTokens() - getNumGeneratedTokens();
+        }
+    };
+
+    [[nodiscard]] static Request makeRoundRequest(Sequence const& sequence, SizeType32 maxTokens)
+    {
+        auto const& request = sequence.request;
+        OutputConfig outputConfig;
+        outputConfig.excludeInputFromOutput = true;
+        Request roundRequest(sequence.tokens, maxTokens, false, request.getSamplingConfig(), outputConfig,
+            request.getEndId(), request.getPadId(), std::nullopt, request.getBadWords(), request.getStopWords());
+        roundRequest.setPriority(request.getPriority());
+        return roundRequest;
+    }
+
+    //! Draft the next round of a sequence, or verify without drafts when a single token remains. mMutex is held.
+    void startRound(IdType requestId, Sequence& sequence)
+    {
+        auto const numDraftTokens = std::min(mNumDraftTokens, sequence.getNumRemainingTokens() - 1);
+        sequence.draftTokens.clear();
+        if (numDraftTokens > 0)
+        {
+            mDraftRequestIds[mDraftExecutor->enqueueRequest(makeRoundRequest(sequence, numDraftTokens))] = requestId;
+        }
+        else
+        {
+            startVerification(requestId, sequence);
+        }
+    }
+
+    //! Verify the draft tokens of a sequence, mMutex is held.
+    void startVerification(IdType requestId, Sequence& sequence)
+    {
+        auto const numDraftTokens = static_cast<SizeType32>(sequence.draftTokens.size());
+        auto roundRequest = makeRoundRequest(sequence, numDraftTokens + 1);
+        if (numDraftTokens > 0)
+        {
+            roundRequest.setExternalDraftTokensConfig(ExternalDraftTokensConfig(sequence.draftTokens));
+        }
+        mTargetRequestIds[mTargetExecutor->enqueueRequest(roundRequest)] = requestId;
+    }
+
+    void receiveLoop(Executor& executor, bool isDraft)
+    {
+        while (!mShutdown)
+        {
+            for (auto const& response : executor.awaitResponses(kPollTimeout))
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                auto& requestIds = isDraft ? mDraftRequestIds : mTargetRequestIds;
+                auto const idIt = requestIds.find(response.getRequestId());
+                if (idIt == requestIds.end())
+                {
+                    continue;
+                }
+                auto const requestId = idIt->second;
+                if (response.hasError())
+                {
+                    requestIds.erase(idIt);
+                    finish(requestId, Response(requestId, response.getErrorMsg()));
+                    continue;
+                }
+                if (!response.getResult().isFinal)
+                {
+                    continue;
+                }
+                requestIds.erase(idIt);
+                auto& sequence = mSequences.at(requestId);
+                if (isDraft)
+                {
+                    onDraftResult(requestId, sequence, response.getResult());
+                }
+                else
+                {
+                    onTargetResult(requestId, sequence, response.getResult());
+                }
+            }
+        }
+    }
+
+    void onDraftResult(IdType requestId, Sequence& sequence, Result const& result)
+    {
+        if (sequence.cancelled)
+        {
+            finish(requestId, makeResponse(requestId, sequence, {}, true, FinishReason::kCANCELLED));
+            return;
+        }
+        sequence.draftTokens = result.outputTokenIds.at(0);
+        startVerification(requestId, sequence);
+    }
+
+    void onTargetResult(IdType requestId, Sequence& sequence, Result const& result)
+    {
+        auto const& newTokens = result.outputTokenIds.at(0);
+        auto const numDraftTokens = static_cast<SizeType32>(sequence.draftTokens.size());
+        auto const numAccepted = std::min(std::max(static_cast<SizeType32>(newTokens.size()) - 1, 0), numDraftTokens);
+        mNumDraftTokensTotal += numDraftTokens;
+        mNumAcceptedTokensTotal += numAccepted;
+        sequence.tokens.insert(sequence.tokens.end(), newTokens.begin(), newTokens.end());
+
+        auto finishReason = result.finishReasons.empty() ? FinishReason::kNOT_FINISHED : result.finishReasons.front();
+        if (finishReason == FinishReason::kLENGTH)
+        {
+            // The length of a round is not the one of the request.
+            finishReason = FinishReason::kNOT_FINISHED;
+        }
+        if (finishReason == FinishReason::kNOT_FINISHED && sequence.getNumRemainingTokens() <= 0)
+        {
+            finishReason = FinishReason::kLENGTH;
+        }
+        if (finishReason == FinishReason::kNOT_FINISHED && sequence.cancelled)
+        {
+            finishReason = FinishReason::kCANCELLED;
+        }
+
+        auto const isFinal = finishReason != FinishReason::kNOT_FINISHED;
+        if (isFinal)
+        {
+            finish(requestId, makeResponse(requestId, sequence, newTokens, true, finishReason));
+            return;
+        }
+        if (sequence.request.getStreaming())
+        {
+            pushResponse(makeResponse(requestId, sequence, newTokens, false, finishReason));
+        }
+        startRound(requestId, sequence);
+    }
+
+    [[nodiscard]] static Response makeResponse(IdType requestId, Sequence const& sequence, VecTokens const& newTokens,
+        bool isFinal, FinishReason finishReason)
+    {
+        Result result;
+        result.isFinal = isFinal;
+        if (sequence.request.getStreaming())
+        {
+            result.outputTokenIds = {newTokens};
+        }
+        else
+        {
+            auto const excludeInput = sequence.request.getOutputConfig().excludeInputFromOutput;
+            auto const begin = sequence.tokens.begin() + (excludeInput ? sequence.numPromptTokens : 0);
+            result.outputTokenIds = {VecTokens(begin, sequence.tokens.end())};
+        }
+        result.finishReasons = {finishReason};
+        return Response(requestId, std::move(result), sequence.request.getClientId());
+    }
+
+    //! Send the final response of a request and forget it, mMutex is held.
+    void finish(IdType requestId, Response response)
+    {
+        mSequences.erase(requestId);
+        pushResponse(std::move(response));
+    }
+
+    void pushResponse(Response response)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mResponsesMutex);
+            mResponses.push_back(std::move(response));
+        }
+        mResponsesCv.notify_all();
+    }
+
+    std::shared_ptr<Executor> mDraftExecutor;
+    std::shared_ptr<Executor> mTargetExecutor;
+    SizeType32 mNumDraftTokens;
+
+    std::mutex mMutex;
+    IdType mNextRequestId{1};
+    std::unordered_map<IdType, Sequence> mSequences;
+    // Request ids of the rounds in flight in each executor, to the id of their request.
+    std::unordered_map<IdType, IdType> mDraftRequestIds;
+    std::unordered_map<IdType, IdType> mTargetRequestIds;
+
+    std::mutex mResponsesMutex;
+    std::condition_variable mResponsesCv;
+    std::deque<Response> mResponses;
+
+    std::atomic<std::uint64_t> mNumDraftTokensTotal{0};
+    std::atomic<std::uint64_t> mNumAcceptedTokensTotal{0};
+    std::atomic<bool> mShutdown{false};
+    std::thread mDraftThread;
+    std::thread mTargetThread;
+};
+
+} // namespace tensorrt_llm::executor
@@ -0,0 +1,597 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/arrayView.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/executor/tensor.h"
+#include "tensorrt_llm/executor/types.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::executor
+{
+
+/// @brief Flat wire format of responses that is read in place, e.g. from an MPI receive buffer.
+/// @details A buffer starts with a header and a table of record offsets. Every record has a fixed layout and refers
+/// to its variable sized fields by offset and size, with every field aligned to 8 bytes. Readers access tokens, log
+/// probabilities and tensors through views into the buffer instead of decoding them into new containers. The header
+/// holds the size of a record, so that newer writers can append fields to it that older readers skip.
+///
+/// The format covers the fields of streamed results. Responses with speculative decoding fast logits, context phase
+/// params, perf metrics, additional outputs or GPU tensors are not supported, see canSerialize(), and must go through
+/// Serialization.
+class FlatSerialization
+{
+public:
+    static constexpr std::uint32_t kMagic = 0x46544C54; // "TLTF"
+    static constexpr std::uint16_t kVersion = 1;
+    static constexpr std::int32_t kMaxDims = 8;
+
+    struct Section
+    {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    struct TensorRecord
+    {
+        std::int32_t dataType;
+        std::int32_t numDims;
+        std::int64_t dims[kMaxDims];
+        Section data;
+    };
+
+    struct ResponseRecord
+    {
+        enum Flags : std::uint32_t
+        {
+            kHAS_CLIENT_ID = 1U << 0,
+            kHAS_ERROR = 1U << 1,
+            kIS_FINAL = 1U << 2,
+            kIS_SEQUENCE_FINAL = 1U << 3,
+            kHAS_CUM_LOG_PROBS = 1U << 4,
+            kHAS_LOG_PROBS = 1U << 5,
+            kHAS_CONTEXT_LOGITS = 1U << 6,
+            kHAS_GENERATION_LOGITS = 1U << 7,
+            kHAS_ENCODER_OUTPUT = 1U << 8,
+        };
+
+        std::uint64_t requestId;
+        std::uint64_t clientId;
+        std::uint32_t flags;
+        std::int32_t numBeams;
+        std::int32_t decodingIter;
+        std::int32_t sequenceIndex;
+        Section errorMsg;
+        //! \brief Number of tokens of every beam, then the tokens of all beams.
+        Section beamLengths;
+        Section outputTokenIds;
+        Section cumLogProbs;
+        Section logProbLengths;
+        Section logProbs;
+        Section finishReasons;
+        TensorRecord contextLogits;
+        TensorRecord generationLogits;
+        TensorRecord encoderOutput;
+    };
+
+    struct Header
+    {
+        std::uint32_t magic;
+        std::uint16_t version;
+        std::uint16_t recordSize;
+        std::uint32_t numResponses;
+        std::uint32_t reserved;
+        std::uint64_t size;
+    };
+
+    //! \brief Whether the response only has fields that the flat format holds.
+    [[nodiscard]] static bool canSerialize(Response const& response)
+    {
+        if (response.hasError())
+        {
+            return true;
+        }
+        auto const& result = response.getResult();
+        auto const isHostTensor = [](std::optional<Tensor> const& tensor)
+        {
+            return !tensor.has_value()
+                || (tensor->getMemoryType() != MemoryType::kGPU && tensor->getShape().size() <= kMaxDims);
+        };
+        return !result.specDecFastLogitsInfo.has_value() && !result.contextPhaseParams.has_value()
+            && !result.requestPerfMetrics.has_value() && result.additionalOutputs.empty()
+            && isHostTensor(result.contextLogits) && isHostTensor(result.generationLogits)
+            && isHostTensor(result.encoderOutput);
+    }
+
+    [[nodiscard]] static std::size_t serializedSize(std::vector<Response> const& responses)
+    {
+        auto size = align(sizeof(Header)) + align(responses.size() * sizeof(std::uint64_t));
+        for (auto const& response : responses)
+        {
+            size += align(sizeof(ResponseRecord));
+            if (response.hasError())
+            {
+                size += align(response.getErrorMsg().size());
+                continue;
+            }
+            auto const& result = response.getResult();
+            size += align(result.outputTokenIds.size() * sizeof(std::int32_t));
+            for (auto const& beam : result.outputTokenIds)
+            {
+                size += align(beam.size() * sizeof(TokenIdType));
+            }
+            if (result.cumLogProbs.has_value())
+            {
+                size += align(result.cumLogProbs->size() * sizeof(FloatType));
+            }
+            if (result.logProbs.has_value())
+            {
+                size += align(result.logProbs->size() * sizeof(std::int32_t));
+                for (auto const& beam : *result.logProbs)
+                {
+                    size += align(beam.size() * sizeof(FloatType));
+                }
+            }
+            size += align(result.finishReasons.size() * sizeof(std::int32_t));
+            for (auto const* tensor : {&result.contextLogits, &result.generationLogits, &result.encoderOutput})
+            {
+                size += tensor->has_value() ? align((*tensor)->getSizeInBytes()) : 0;
+            }
+        }
+        return size;
+    }
+
+    //! \brief Serialize responses into buffer, which is resized and can be reused across calls.
+    static void serialize(std::vector<Response> const& responses, std::vector<char>& buffer)
+    {
+        buffer.assign(serializedSize(responses), 0);
+        Writer writer{buffer};
+        auto const headerOffset = writer.reserve(sizeof(Header));
+        auto const tableOffset = writer.reserve(responses.size() * sizeof(std::uint64_t));
+        for (std::size_t i = 0; i < responses.size(); ++i)
+        {
+            auto const recordOffset = writer.reserve(sizeof(ResponseRecord));
+            auto const record = writeResponse(responses[i], writer);
+            writer.put(recordOffset, record);
+            writer.put(tableOffset + i * sizeof(std::uint64_t), static_cast<std::uint64_t>(recordOffset));
+        }
+        TLLM_CHECK(writer.getSize() == buffer.size());
+        Header const header{kMagic, kVersion, static_cast<std::uint16_t>(sizeof(ResponseRecord)),
+            static_cast<std::uint32_t>(responses.size()), 0, static_cast<std::uint64_t>(buffer.size())};
+        writer.put(headerOffset, header);
+    }
+
+    [[nodiscard]] static std::vector<char> serialize(std::vector<Response> const& responses)
+    {
+        std::vector<char> buffer;
+        serialize(responses, buffer);
+        return buffer;
+    }
+
+    static std::size_t align(std::size_t size) noexcept
+    {
+        return (size + kAlignment - 1) / kAlignment * kAlignment;
+    }
+
+private:
+    static constexpr std::size_t kAlignment = 8;
+
+    class Writer
+    {
+    public:
+        explicit Writer(std::vector<char>& buffer)
+            : mBuffer{buffer}
+        {
+        }
+
+        std::size_t reserve(std::size_t size)
+        {
+            auto const offset = mSize;
+            mSize += align(size);
+            TLLM_CHECK(mSize <= mBuffer.size());
+            return offset;
+        }
+
+        Section append(void const* data, std::size_t size)
+        {
+            auto const offset = reserve(size);
+            if (size > 0)
+            {
+                std::memcpy(mBuffer.data() + offset, data, size);
+            }
+            return {offset, size};
+        }
+
+        template <typename T>
+        void put(std::size_t offset, T const& value)
+        {
+            std::memcpy(mBuffer.data() + offset, &value, sizeof(T));
+        }
+
+        [[nodiscard]] std::size_t getSize() const noexcept
+        {
+            return mSize;
+        }
+
+    private:
+        std::vector<char>& mBuffer;
+        std::size_t mSize{0};
+    };
+
+    [[nodiscard]] static std::uint32_t flagIf(bool condition, ResponseRecord::Flags flag) noexcept
+    {
+        return condition ? static_cast<std::uint32_t>(flag) : 0U;
+    }
+
+    static TensorRecord writeTensor(std::optional<Tensor> const& tensor, Writer& writer)
+    {
+        TensorRecord record{};
+        if (!tensor.has_value())
+        {
+            return record;
+        }
+        auto const shape = tensor->getShape();
+        record.dataType = static_cast<std::int32_t>(tensor->getDataType());
+        record.numDims = static_cast<std::int32_t>(shape.size());
+        std::copy(shape.begin(), shape.end(), record.dims);
+        record.data = writer.append(tensor->getData(), tensor->getSizeInBytes());
+        return record;
+    }
+
+    static ResponseRecord writeResponse(Response const& response, Writer& writer)
+    {
+        TLLM_CHECK_WITH_INFO(canSerialize(response), "Response %lu has fields the flat format does not hold",
+            static_cast<unsigned long>(response.getRequestId()));
+        ResponseRecord record{};
+        record.requestId = response.getRequestId();
+        auto const clientId = response.getClientId();
+        record.clientId = clientId.value_or(0);
+        record.flags = flagIf(clientId.has_value(), ResponseRecord::kHAS_CLIENT_ID);
+        if (response.hasError())
+        {
+            record.flags |= ResponseRecord::kHAS_ERROR;
+            auto const& errorMsg = response.getErrorMsg();
+            record.errorMsg = writer.append(errorMsg.data(), errorMsg.size());
+            return record;
+        }
+
+        auto const& result = response.getResult();
+        record.flags |= flagIf(result.isFinal, ResponseRecord::kIS_FINAL)
+            | flagIf(result.isSequenceFinal, ResponseRecord::kIS_SEQUENCE_FINAL);
+        record.numBeams = static_cast<std::int32_t>(result.outputTokenIds.size());
+        record.decodingIter = result.decodingIter;
+        record.sequenceIndex = result.sequenceIndex;
+        std::tie(record.beamLengths, record.outputTokenIds) = writeNested(result.outputTokenIds, writer);
+        if (result.cumLogProbs.has_value())
+        {
+            record.flags |= ResponseRecord::kHAS_CUM_LOG_PROBS;
+            record.cumLogProbs
+                = writer.append(result.cumLogProbs->data(), result.cumLogProbs->size() * sizeof(FloatType));
+        }
+        if (result.logProbs.has_value())
+        {
+            record.flags |= ResponseRecord::kHAS_LOG_PROBS;
+            std::tie(record.logProbLengths, record.logProbs) = writeNested(*result.logProbs, writer);
+        }
+        std::vector<std::int32_t> finishReasons(result.finishReasons.size());
+        std::transform(result.finishReasons.begin(), result.finishReasons.end(), finishReasons.begin(),
+            [](FinishReason reason) { return static_cast<std::int32_t>(reason); });
+        record.finishReasons = writer.append(finishReasons.data(), finishReasons.size() * sizeof(std::int32_t));
+        record.flags |= flagIf(result.contextLogits.has_value(), ResponseRecord::kHAS_CONTEXT_LOGITS)
+            | flagIf(result.generationLogits.has_value(), ResponseRecord::kHAS_GENERATION_LOGITS)
+            | flagIf(result.encoderOutput.has_value(), ResponseRecord::kHAS_ENCODER_OUTPUT);
+        record.contextLogits = writeTensor(result.contextLogits, writer);
+        record.generationLogits = writeTensor(result.generationLogits, writer);
+        record.encoderOutput = writeTensor(result.encoderOutput, writer);
+        return record;
+    }
+
+    //! \brief Write the lengths of the inner vectors, then their concatenated contents, each inner vector aligned.
+    template <typename T>
+    static std::pair<Section, Section> writeNested(std::vector<std::vector<T>> const& values, Writer& writer)
+    {
+        std::vector<std::int32_t> lengths;
+        lengths.reserve(values.size());
+        for (auto const& inner : values)
+        {
+            lengths.push_back(static_cast<std::int32_t>(inner.size()));
+        }
+        auto const lengthsSection = writer.append(lengths.data(), lengths.size() * sizeof(std::int32_t));
+        Section data{writer.getSize(), 0};
+        for (auto const& inner : values)
+        {
+            writer.append(inner.data(), inner.size() * sizeof(T));
+        }
+        data.size = writer.getSize() - data.offset;
+        return {lengthsSection, data};
+    }
+};
+
+/// @brief View of one response in a flat buffer. Valid as long as the buffer is.
+class FlatResponseView
+{
+public:
+    using Record = FlatSerialization::ResponseRecord;
+
+    FlatResponseView(char const* buffer, std::size_t bufferSize, Record const& record)
+        : mBuffer{buffer}
+        , mBufferSize{bufferSize}
+        , mRecord{record}
+    {
+    }
+
+    [[nodiscard]] IdType getRequestId() const noexcept
+    {
+        return mRecord.requestId;
+    }
+
+    [[nodiscard]] std::optional<IdType> getClientId() const noexcept
+    {
+        return hasFlag(Record::kHAS_CLIENT_ID) ? std::optional<IdType>{mRecord.clientId} : std::nullopt;
+    }
+
+    [[nodiscard]] bool hasError() const noexcept
+    {
+        return hasFlag(Record::kHAS_ERROR);
+    }
+
+    [[nodiscard]] std::string_view getErrorMsg() const
+    {
+        return {getSection<char>(mRecord.errorMsg).begin(), mRecord.errorMsg.size};
+    }
+
+    [[nodiscard]] bool isFinal() const noexcept
+    {
+        return hasFlag(Record::kIS_FINAL);
+    }
+
+    [[nodiscard]] bool isSequenceFinal() const noexcept
+    {
+        return hasFlag(Record::kIS_SEQUENCE_FINAL);
+    }
+
+    [[nodiscard]] SizeType32 getNumBeams() const noexcept
+    {
+        return mRecord.numBeams;
+    }
+
+    [[nodiscard]] SizeType32 getDecodingIter() const noexcept
+    {
+        return mRecord.decodingIter;
+    }
+
+    [[nodiscard]] SizeType32 getSequenceIndex() const noexcept
+    {
+        return mRecord.sequenceIndex;
+    }
+
+    [[nodiscard]] common::ArrayView<TokenIdType const> getOutputTokenIds(SizeType32 beam) const
+    {
+        return getNested<TokenIdType>(mRecord.beamLengths, mRecord.outputTokenIds, beam);
+    }
+
+    [[nodiscard]] std::optional<common::ArrayView<FloatType const>> getCumLogProbs() const
+    {
+        if (!hasFlag(Record::kHAS_CUM_LOG_PROBS))
+        {
+            return std::nullopt;
+        }
+        return getSection<FloatType>(mRecord.cumLogProbs);
+    }
+
+    [[nodiscard]] std::optional<common::ArrayView<FloatType const>> getLogProbs(SizeType32 beam) const
+    {
+        if (!hasFlag(Record::kHAS_LOG_PROBS))
+        {
+            return std::nullopt;
+        }
+        return getNested<FloatType>(mRecord.logProbLengths, mRecord.logProbs, beam);
+    }
+
+    //! \brief Tensors alias the buffer and must not be written to.
+    [[nodiscard]] std::optional<Tensor> getContextLogits() const
+    {
+        return getTensor(Record::kHAS_CONTEXT_LOGITS, mRecord.contextLogits);
+    }
+
+    [[nodiscard]] std::optional<Tensor> getGenerationLogits() const
+    {
+        return getTensor(Record::kHAS_GENERATION_LOGITS, mRecord.generationLogits);
+    }
+
+    [[nodiscard]] std::optional<Tensor> getEncoderOutput() const
+    {
+        return getTensor(Record::kHAS_ENCODER_OUTPUT, mRecord.encoderOutput);
+    }
+
+    //! \brief Build a Response. Tokens and log probabilities are copied, tensors alias the buffer unless copyTensors
+    //! is set.
+    [[nodiscard]] Response toResponse(bool copyTensors = false) const
+    {
+        if (hasError())
+        {
+            return Response{getRequestId(), std::string{getErrorMsg()}, getClientId()};
+        }
+        Result result;
+        result.isFinal = isFinal();
+        result.isSequenceFinal = isSequenceFinal();
+        result.decodingIter = getDecodingIter();
+        result.sequenceIndex = getSequenceIndex();
+        for (SizeType32 beam = 0; beam < getNumBeams(); ++beam)
+        {
+            auto const tokens = getOutputTokenIds(beam);
+            result.outputTokenIds.emplace_back(tokens.begin(), tokens.end());
+        }
+        if (auto const cumLogProbs = getCumLogProbs())
+        {
+            result.cumLogProbs = VecLogProbs(cumLogProbs->begin(), cumLogProbs->end());
+        }
+        if (hasFlag(Record::kHAS_LOG_PROBS))
+        {
+            result.logProbs.emplace();
+            auto const numBeams = static_cast<SizeType32>(mRecord.logProbLengths.size / sizeof(std::int32_t));
+            for (SizeType32 beam = 0; beam < numBeams; ++beam)
+            {
+                auto const logProbs = *getLogProbs(beam);
+                result.logProbs->emplace_back(logProbs.begin(), logProbs.end());
+            }
+        }
+        for (auto const reason : getSection<std::int32_t>(mRecord.finishReasons))
+        {
+            result.finishReasons.push_back(static_cast<FinishReason>(reason));
+        }
+        result.contextLogits = copyTensors ? copyTensor(getContextLogits()) : getContextLogits();
+        result.generationLogits = copyTensors ? copyTensor(getGenerationLogits()) : getGenerationLogits();
+        result.encoderOutput = copyTensors ? copyTensor(getEncoderOutput()) : getEncoderOutput();
+        return Response{getRequestId(), std::move(result), getClientId()};
+    }
+
+private:
+    [[nodiscard]] bool hasFlag(std::uint32_t flag) const noexcept
+    {
+        return (mRecord.flags & flag) != 0;
+    }
+
+    template <typename T>
+    [[nodiscard]] common::ArrayView<T const> getSection(FlatSerialization::Section const& section) const
+    {
+        TLLM_CHECK_WITH_INFO(section.offset <= mBufferSize && section.size <= mBufferSize - section.offset
+                && section.offset % alignof(T) == 0 && section.size % sizeof(T) == 0,
+            "Corrupt section in flat response buffer");
+        return {reinterpret_cast<T const*>(mBuffer + section.offset), section.size / sizeof(T)};
+    }
+
+    template <typename T>
+    [[nodiscard]] common::ArrayView<T const> getNested(
+        FlatSerialization::Section const& lengthsSection, FlatSerialization::Section const& data, SizeType32 idx) const
+    {
+        auto const lengths = getSection<std::int32_t>(lengthsSection);
+        TLLM_CHECK(idx >= 0 && static_cast<std::size_t>(idx) < lengths.size());
+        std::uint64_t offset{data.offset};
+        for (SizeType32 i = 0; i < idx; ++i)
+        {
+            offset += FlatSerialization::align(lengths[i] * sizeof(T));
+        }
+        auto const section = FlatSerialization::Section{offset, lengths[idx] * sizeof(T)};
+        TLLM_CHECK_WITH_INFO(offset + section.size <= data.offset + data.size, "Corrupt flat response buffer");
+        return getSection<T>(section);
+    }
+
+    [[nodiscard]] std::optional<Tensor> getTensor(
+        std::uint32_t flag, FlatSerialization::TensorRecord const& record) const
+    {
+        if (!hasFlag(flag))
+        {
+            return std::nullopt;
+        }
+        TLLM_CHECK(record.numDims >= 0 && record.numDims <= FlatSerialization::kMaxDims);
+        auto const data = getSection<char>(record.data);
+        auto tensor = Tensor::of(static_cast<DataType>(record.dataType), const_cast<char*>(data.begin()),
+            Shape{record.dims, static_cast<Shape::size_type>(record.numDims)});
+        TLLM_CHECK_WITH_INFO(tensor.getSizeInBytes() == record.data.size, "Corrupt tensor in flat response buffer");
+        return tensor;
+    }
+
+    [[nodiscard]] static std::optional<Tensor> copyTensor(std::optional<Tensor> const& tensor)
+    {
+        if (!tensor.has_value())
+        {
+            return std::nullopt;
+        }
+        auto copy = Tensor::cpu(tensor->getDataType(), tensor->getShape());
+        std::memcpy(copy.getData(), tensor->getData(), tensor->getSizeInBytes());
+        return copy;
+    }
+
+    char const* mBuffer;
+    std::size_t mBufferSize;
+    Record mRecord;
+};
+
+/// @brief View of the responses in a flat buffer, validating its header. The buffer must be aligned to 8 bytes.
+class FlatResponsesView
+{
+public:
+    FlatResponsesView(char const* buffer, std::size_t bufferSize)
+        : mBuffer{buffer}
+        , mBufferSize{bufferSize}
+    {
+        TLLM_CHECK_WITH_INFO(reinterpret_cast<std::uintptr_t>(buffer) % alignof(std::uint64_t) == 0,
+            "Flat response buffers must be aligned to 8 bytes");
+        TLLM_CHECK_WITH_INFO(bufferSize >= sizeof(FlatSerialization::Header), "Flat response buffer too small");
+        std::memcpy(&mHeader, buffer, sizeof(mHeader));
+        TLLM_CHECK_WITH_INFO(mHeader.magic == FlatSerialization::kMagic, "Not a flat response buffer");
+        TLLM_CHECK_WITH_INFO(mHeader.version == FlatSerialization::kVersion,
+            "Flat response buffer has version %u, expected %u", mHeader.version, FlatSerialization::kVersion);
+        TLLM_CHECK_WITH_INFO(mHeader.size <= bufferSize, "Truncated flat response buffer");
+        auto const tableOffset = FlatSerialization::align(sizeof(FlatSerialization::Header));
+        TLLM_CHECK(tableOffset + mHeader.numResponses * sizeof(std::uint64_t) <= mHeader.size);
+        mOffsets = reinterpret_cast<std::uint64_t const*>(buffer + tableOffset);
+    }
+
+    explicit FlatResponsesView(std::vector<char> const& buffer)
+        : FlatResponsesView(buffer.data(), buffer.size())
+    {
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return mHeader.numResponses;
+    }
+
+    [[nodiscard]] FlatResponseView operator[](std::size_t idx) const
+    {
+        TLLM_CHECK(idx < size());
+        auto const offset = mOffsets[idx];
+        // Fields newer writers appended to the record are skipped, missing trailing fields are zero.
+        std::size_t const recordSize = std::min<std::size_t>(mHeader.recordSize, sizeof(FlatResponseView::Record));
+        TLLM_CHECK_WITH_INFO(offset + recordSize <= mHeader.size, "Corrupt record offset in flat response buffer");
+        FlatResponseView::Record record{};
+        std::memcpy(&record, mBuffer + offset, recordSize);
+        return FlatResponseView{mBuffer, static_cast<std::size_t>(mHeader.size), record};
+    }
+
+    [[nodiscard]] std::vector<Response> toResponses(bool copyTensors = false) const
+    {
+        std::vector<Response> responses;
+        responses.reserve(size());
+        for (std::size_t i = 0; i < size(); ++i)
+        {
+            responses.push_back((*this)[i].toResponse(copyTensors));
+        }
+        return responses;
+    }
+
+private:
+    char const* mBuffer;
+    std::size_t mBufferSize;
+    FlatSerialization::Header mHeader{};
+    std::uint64_t const* mOffsets{nullptr};
+};
+
+} // namespace tensorrt_llm::executor
@@ -0,0 +1,528 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/shmRingBuffer.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/executor/types.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace tensorrt_llm::executor
+{
+
+/// @brief Compact binary encoding of the KV cache events of one iteration, for cache-aware routers.
+/// @details A batch holds the events returned by one KVCacheEventManager::getLatestEvents and a sequence number, so
+/// that a router notices lost batches and resynchronizes. Integers are varints, signed ones zigzag encoded, and event
+/// ids, cache levels, priorities and tokens are delta encoded. The parent of a stored sequence that continues the
+/// previous stored sequence of the batch, the common case of a request storing its blocks chunk by chunk, takes a
+/// single byte. Block hashes are kept raw. In hash-only mode, the default, block tokens are dropped: routers match
+/// requests against the block hashes, see kv_cache_manager::computeBlockHashes.
+class KVCacheEventEncoding
+{
+public:
+    static constexpr std::uint32_t kMagic = 0x45564B54; // "TKVE"
+    static constexpr std::uint16_t kVersion = 1;
+
+    struct Batch
+    {
+        std::uint64_t sequenceNumber{0};
+        /// @brief Whether the stored blocks have their tokens.
+        bool withTokens{false};
+        std::vector<KVCacheEvent> events;
+    };
+
+    template <typename Events>
+    [[nodiscard]] static std::vector<char> encode(
+        std::uint64_t sequenceNumber, Events const& events, bool withTokens = false)
+    {
+        Writer writer;
+        writer.raw(kMagic);
+        writer.raw(kVersion);
+        writer.raw(static_cast<std::uint16_t>(withTokens ? kWITH_TOKENS : 0));
+        writer.raw(sequenceNumber);
+        writer.varint(events.size());
+        IdType prevEventId{0};
+        std::optional<IdType> lastStoredHash;
+        for (auto const& event : events)
+        {
+            writer.svarint(static_cast<std::int64_t>(event.eventId - prevEventId));
+            prevEventId = event.eventId;
+            writer.raw(static_cast<std::uint8_t>(event.data.index()));
+            std::visit([&](auto const& data) { encodeData(writer, data, withTokens, lastStoredHash); }, event.data);
+        }
+        return std::move(writer.buffer);
+    }
+
+    [[nodiscard]] static Batch decode(char const* data, std::size_t size)
+    {
+        Reader reader{data, size};
+        TLLM_CHECK_WITH_INFO(reader.raw<std::uint32_t>() == kMagic, "Not a KV cache event batch");
+        auto const version = reader.raw<std::uint16_t>();
+        TLLM_CHECK_WITH_INFO(version == kVersion, "Unsupported version %u of KV cache event batches", version);
+        Batch batch;
+        batch.withTokens = (reader.raw<std::uint16_t>() & kWITH_TOKENS) != 0;
+        batch.sequenceNumber = reader.raw<std::uint64_t>();
+        auto const numEvents = reader.varint();
+        batch.events.reserve(numEvents);
+        IdType eventId{0};
+        std::optional<IdType> lastStoredHash;
+        for (std::uint64_t i = 0; i < numEvents; ++i)
+        {
+            eventId += static_cast<IdType>(reader.svarint());
+            auto const type = reader.raw<std::uint8_t>();
+            batch.events.emplace_back(eventId, decodeData(reader, type, batch.withTokens, lastStoredHash));
+        }
+        TLLM_CHECK_WITH_INFO(reader.remaining() == 0, "Trailing bytes after a KV cache event batch");
+        return batch;
+    }
+
+    [[nodiscard]] static Batch decode(std::vector<char> const& buffer)
+    {
+        return decode(buffer.data(), buffer.size());
+    }
+
+private:
+    static constexpr std::uint16_t kWITH_TOKENS = 1U << 0;
+
+    enum ParentMode : std::uint8_t
+    {
+        kNO_PARENT = 0,
+        kPREVIOUS_STORED = 1,
+        kEXPLICIT = 2,
+    };
+
+    enum UpdatedFields : std::uint8_t
+    {
+        kCACHE_LEVEL = 1U << 0,
+        kPRIORITY = 1U << 1,
+    };
+
+    struct Writer
+    {
+        std::vector<char> buffer;
+
+        template <typename T>
+        void raw(T value)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            auto const offset = buffer.size();
+            buffer.resize(offset + sizeof(T));
+            std::memcpy(buffer.data() + offset, &value, sizeof(T));
+        }
+
+        void varint(std::uint64_t value)
+        {
+            while (value >= 0x80)
+            {
+                buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+                value >>= 7;
+            }
+            buffer.push_back(static_cast<char>(value));
+        }
+
+        void svarint(std::int64_t value)
+        {
+            varint((static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+        }
+    };
+
+    struct Reader
+    {
+        char const* data;
+        std::size_t size;
+        std::size_t offset{0};
+
+        template <typename T>
+        T raw()
+        {
+            TLLM_CHECK_WITH_INFO(offset + sizeof(T) <= size, "Truncated KV cache event batch");
+            T value;
+            std::memcpy(&value, data + offset, sizeof(T));
+            offset += sizeof(T);
+            return value;
+        }
+
+        std::uint64_t varint()
+        {
+            std::uint64_t value{0};
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                auto const byte = raw<std::uint8_t>();
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return value;
+                }
+            }
+            TLLM_THROW("Malformed varint in a KV cache event batch");
+        }
+
+        std::int64_t svarint()
+        {
+            auto const value = varint();
+            return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+        }
+
+        [[nodiscard]] std::size_t remaining() const noexcept
+        {
+            return size - offset;
+        }
+    };
+
+    static void encodeData(Writer& writer, KVCacheCreatedData const& data, bool /*withTokens*/,
+        std::optional<IdType>& /*lastStoredHash*/)
+    {
+        writer.varint(data.numBlocksPerCacheLevel.size());
+        for (auto const numBlocks : data.numBlocksPerCacheLevel)
+        {
+            writer.svarint(numBlocks);
+        }
+    }
+
+    static void encodeData(
+        Writer& writer, KVCacheStoredData const& data, bool withTokens, std::optional<IdType>& lastStoredHash)
+    {
+        if (!data.parentHash.has_value())
+        {
+            writer.raw(static_cast<std::uint8_t>(kNO_PARENT));
+        }
+        else if (data.parentHash == lastStoredHash)
+        {
+            writer.raw(static_cast<std::uint8_t>(kPREVIOUS_STORED));
+        }
+        else
+        {
+            writer.raw(static_cast<std::uint8_t>(kEXPLICIT));
+            writer.raw(*data.parentHash);
+        }
+        writer.varint(data.blocks.size());
+        SizeType32 cacheLevel{0};
+        SizeType32 priority{0};
+        for (auto const& block : data.blocks)
+        {
+            writer.raw(block.blockHash);
+            writer.varint(block.loraId);
+            writer.svarint(block.cacheLevel - cacheLevel);
+            writer.svarint(block.priority - priority);
+            cacheLevel = block.cacheLevel;
+            priority = block.priority;
+            if (withTokens)
+            {
+                writer.varint(block.tokens.size());
+                TokenIdType tokenId{0};
+                for (auto const& token : block.tokens)
+                {
+                    writer.svarint(static_cast<std::int64_t>(token.tokenId) - tokenId);
+                    writer.varint(token.tokenExtraId);
+                    tokenId = token.tokenId;
+                }
+            }
+        }
+        if (!data.blocks.empty())
+        {
+            lastStoredHash = data.blocks.back().blockHash;
+        }
+    }
+
+    static void encodeData(Writer& writer, KVCacheRemovedData const& data, bool /*withTokens*/,
+        std::optional<IdType>& /*lastStoredHash*/)
+    {
+        writer.varint(data.blockHashes.size());
+        for (auto const hash : data.blockHashes)
+        {
+            writer.raw(hash);
+        }
+    }
+
+    static void encodeData(Writer& writer, KVCacheUpdatedData const& data, bool /*withTokens*/,
+        std::optional<IdType>& /*lastStoredHash*/)
+    {
+        writer.raw(data.blockHash);
+        auto const fields = static_cast<std::uint8_t>(
+            (data.cacheLevel.has_value() ? kCACHE_LEVEL : 0) | (data.priority.has_value() ? kPRIORITY : 0));
+        writer.raw(fields);
+        for (auto const& diff : {data.cacheLevel, data.priority})
+        {
+            if (diff.has_value())
+            {
+                writer.svarint(diff->oldValue);
+                writer.svarint(diff->newValue - diff->oldValue);
+            }
+        }
+    }
+
+    [[nodiscard]] static KVCacheEventData decodeData(
+        Reader& reader, std::uint8_t type, bool withTokens, std::optional<IdType>& lastStoredHash)
+    {
+        switch (type)
+        {
+        case 0:
+        {
+            KVCacheCreatedData data;
+            data.numBlocksPerCacheLevel.resize(reader.varint());
+            for (auto& numBlocks : data.numBlocksPerCacheLevel)
+            {
+                numBlocks = static_cast<SizeType32>(reader.svarint());
+            }
+            return data;
+        }
+        case 1:
+        {
+            KVCacheStoredData data;
+            auto const parentMode = reader.raw<std::uint8_t>();
+            if (parentMode == kPREVIOUS_STORED)
+            {
+                TLLM_CHECK_WITH_INFO(lastStoredHash.has_value(), "Stored blocks refer to a missing previous block");
+                data.parentHash = lastStoredHash;
+            }
+            else if (parentMode == kEXPLICIT)
+            {
+                data.parentHash = reader.raw<IdType>();
+            }
+            auto const numBlocks = reader.varint();
+            data.blocks.reserve(numBlocks);
+            SizeType32 cacheLevel{0};
+            SizeType32 priority{0};
+            for (std::uint64_t b = 0; b < numBlocks; ++b)
+            {
+                auto const blockHash = reader.raw<IdType>();
+                auto const loraId = static_cast<runtime::LoraTaskIdType>(reader.varint());
+                cacheLevel += static_cast<SizeType32>(reader.svarint());
+                priority += static_cast<SizeType32>(reader.svarint());
+                runtime::VecUniqueTokens tokens;
+                if (withTokens)
+                {
+                    tokens.resize(reader.varint());
+                    TokenIdType tokenId{0};
+                    for (auto& token : tokens)
+                    {
+                        tokenId += static_cast<TokenIdType>(reader.svarint());
+                        token.tokenId = tokenId;
+                        token.tokenExtraId = reader.varint();
+                    }
+                }
+                data.blocks.emplace_back(blockHash, std::move(tokens), loraId, cacheLevel, priority);
+            }
+            if (!data.blocks.empty())
+            {
+                lastStoredHash = data.blocks.back().blockHash;
+            }
+            return data;
+        }
+        case 2:
+        {
+            KVCacheRemovedData data;
+            data.blockHashes.resize(reader.varint());
+            for (auto& hash : data.blockHashes)
+            {
+                hash = reader.raw<IdType>();
+            }
+            return data;
+        }
+        case 3:
+        {
+            KVCacheUpdatedData data{reader.raw<IdType>()};
+            auto const fields = reader.raw<std::uint8_t>();
+            auto const readDiff = [&reader]()
+            {
+                auto const oldValue = static_cast<SizeType32>(reader.svarint());
+                return KVCacheEventDiff<SizeType32>{oldValue, oldValue + static_cast<SizeType32>(reader.svarint())};
+            };
+            if (fields & kCACHE_LEVEL)
+            {
+                data.cacheLevel = readDiff();
+            }
+            if (fields & kPRIORITY)
+            {
+                data.priority = readDiff();
+            }
+            return data;
+        }
+        default: TLLM_THROW("Unknown KV cache event type %u", type);
+        }
+    }
+};
+
+/// @brief Publishes the KV cache events of an executor to routers on the same host through a shared memory ring, one
+/// encoded batch per iteration.
+/// @details When the ring is full, batches queue up to maxPendingBatches and the oldest are dropped beyond, which the
+/// subscriber sees as a gap in the sequence numbers. Batches larger than a ring message are split.
+class KVCacheEventPublisher
+{
+public:
+    KVCacheEventPublisher(
+        std::string const& name, std::size_t capacity, bool withTokens = false, std::size_t maxPendingBatches = 1024)
+        : mRing{common::ShmRingBuffer::create(name, capacity)}
+        , mWithTokens{withTokens}
+        , mMaxPendingBatches{maxPendingBatches}
+    {
+    }
+
+    ~KVCacheEventPublisher()
+    {
+        try
+        {
+            flush();
+        }
+        catch (std::exception const& e)
+        {
+            TLLM_LOG_EXCEPTION(e);
+        }
+    }
+
+    KVCacheEventPublisher(KVCacheEventPublisher const&) = delete;
+    KVCacheEventPublisher& operator=(KVCacheEventPublisher const&) = delete;
+
+    void publish(std::deque<KVCacheEvent> const& events)
+    {
+        if (!events.empty())
+        {
+            enqueue(std::vector<KVCacheEvent>(events.begin(), events.end()));
+        }
+        flush();
+    }
+
+    /// @brief Publish the events of the event manager that arrive within timeout.
+    void pump(KVCacheEventManager& eventManager, std::optional<std::chrono::milliseconds> const& timeout)
+    {
+        publish(eventManager.getLatestEvents(timeout));
+    }
+
+    /// @brief Push the queued batches as far as the ring takes them.
+    /// @return True if nothing is left queued.
+    bool flush()
+    {
+        while (!mPending.empty() && mRing->tryPush(mPending.front().data(), mPending.front().size()))
+        {
+            mPending.pop_front();
+            ++mNumBatches;
+        }
+        return mPending.empty();
+    }
+
+    [[nodiscard]] std::uint64_t getNumBatches() const noexcept
+    {
+        return mNumBatches;
+    }
+
+    [[nodiscard]] std::uint64_t getNumDroppedBatches() const noexcept
+    {
+        return mNumDroppedBatches;
+    }
+
+private:
+    void enqueue(std::vector<KVCacheEvent> events)
+    {
+        auto message = KVCacheEventEncoding::encode(mNextSequenceNumber, events, mWithTokens);
+        if (message.size() > mRing->getMaxMessageSize() && events.size() > 1)
+        {
+            auto const middle = events.begin() + static_cast<std::ptrdiff_t>(events.size() / 2);
+            enqueue(std::vector<KVCacheEvent>(events.begin(), middle));
+            enqueue(std::vector<KVCacheEvent>(middle, events.end()));
+            return;
+        }
+        TLLM_CHECK_WITH_INFO(message.size() <= mRing->getMaxMessageSize(),
+            "A KV cache event of %zu bytes does not fit in the ring", message.size());
+        ++mNextSequenceNumber;
+        mPending.push_back(std::move(message));
+        if (mPending.size() > mMaxPendingBatches)
+        {
+            mPending.pop_front();
+            ++mNumDroppedBatches;
+        }
+    }
+
+    std::unique_ptr<common::ShmRingBuffer> mRing;
+    bool mWithTokens;
+    std::size_t mMaxPendingBatches;
+    std::deque<std::vector<char>> mPending;
+    std::uint64_t mNextSequenceNumber{0};
+    std::uint64_t mNumBatches{0};
+    std::uint64_t mNumDroppedBatches{0};
+};
+
+/// @brief Receives the batches of a KVCacheEventPublisher.
+class KVCacheEventSubscriber
+{
+public:
+    explicit KVCacheEventSubscriber(std::string const& name)
+        : mRing{common::ShmRingBuffer::open(name)}
+    {
+    }
+
+    /// @brief Wait for batches and return every one that arrived. A router that sees getNumMissedBatches grow has lost
+    /// events and should rebuild its index of the publisher, e.g. from a new KVCacheCreatedData.
+    [[nodiscard]] std::vector<KVCacheEventEncoding::Batch> awaitBatches(
+        std::optional<std::chrono::milliseconds> const& timeout)
+    {
+        std::vector<KVCacheEventEncoding::Batch> batches;
+        auto const waitFor = timeout.value_or(std::chrono::hours{24 * 365});
+        if (!mRing->waitPop(mMessage, waitFor))
+        {
+            return batches;
+        }
+        add(KVCacheEventEncoding::decode(mMessage), batches);
+        while (auto const message = mRing->front())
+        {
+            add(KVCacheEventEncoding::decode(message->begin(), message->size()), batches);
+            mRing->popFront();
+        }
+        return batches;
+    }
+
+    [[nodiscard]] std::uint64_t getNumMissedBatches() const noexcept
+    {
+        return mNumMissedBatches;
+    }
+
+    /// @brief The publisher went away and every batch was received.
+    [[nodiscard]] bool isClosed()
+    {
+        return mRing->isClosed() && !mRing->front().has_value();
+    }
+
+private:
+    void add(KVCacheEventEncoding::Batch batch, std::vector<KVCacheEventEncoding::Batch>& batches)
+    {
+        if (mNextSequenceNumber.has_value() && batch.sequenceNumber > *mNextSequenceNumber)
+        {
+            mNumMissedBatches += batch.sequenceNumber - *mNextSequenceNumber;
+        }
+        mNextSequenceNumber = batch.sequenceNumber + 1;
+        batches.push_back(std::move(batch));
+    }
+
+    std::unique_ptr<common::ShmRingBuffer> mRing;
+    std::vector<char> mMessage;
+    std::optional<std::uint64_t> mNextSequenceNumber;
+    std::uint64_t mNumMissedBatches{0};
+};
+
+} // namespace tensorrt_llm::executor
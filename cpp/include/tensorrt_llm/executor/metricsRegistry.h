@@ -0,0 +1,368 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/executor/types.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::executor
+{
+
+/// @brief Lock-free histogram of non-negative values with log-linear buckets, as in HDR histograms.
+/// @details Every power of two range [unit * 2^e, unit * 2^(e+1)) is split into kSubBuckets linear buckets, so a
+/// quantile is within 1 / kSubBuckets of the recorded value over numRanges powers of two. The values below the unit
+/// fall into the first bucket and the values above the last range into the last one. Recording is a relaxed atomic
+/// increment, a concurrent reader sees every complete record eventually but no consistent snapshot.
+class LogLinearHistogram
+{
+public:
+    static constexpr int kSubBuckets = 16;
+
+    explicit LogLinearHistogram(double unit, int numRanges)
+        : mUnit{unit}
+        , mNumRanges{numRanges}
+        , mCounts(1 + static_cast<std::size_t>(numRanges) * kSubBuckets)
+    {
+        TLLM_CHECK_WITH_INFO(unit > 0 && numRanges > 0, "The histogram needs a positive unit and range");
+        reset();
+    }
+
+    void record(double value) noexcept
+    {
+        mCounts[getBucketIdx(value)].fetch_add(1, std::memory_order_relaxed);
+        mCount.fetch_add(1, std::memory_order_relaxed);
+        auto sum = mSum.load(std::memory_order_relaxed);
+        while (!mSum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    [[nodiscard]] std::uint64_t getCount() const noexcept
+    {
+        return mCount.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] double getSum() const noexcept
+    {
+        return mSum.load(std::memory_order_relaxed);
+    }
+
+    /// @brief The upper bound of the bucket of the q-quantile, 0 when empty.
+    [[nodiscard]] double getQuantile(double q) const noexcept
+    {
+        std::uint64_t total{0};
+        for (auto const& count : mCounts)
+        {
+            total += count.load(std::memory_order_relaxed);
+        }
+        if (total == 0)
+        {
+            return 0.;
+        }
+        auto const rank = static_cast<std::uint64_t>(std::ceil(std::clamp(q, 0., 1.) * total));
+        std::uint64_t cumulative{0};
+        for (std::size_t idx = 0; idx < mCounts.size(); ++idx)
+        {
+            cumulative += mCounts[idx].load(std::memory_order_relaxed);
+            if (cumulative >= std::max(rank, std::uint64_t{1}))
+            {
+                return getUpperBound(idx);
+            }
+        }
+        return getUpperBound(mCounts.size() - 1);
+    }
+
+    /// @brief The number of values up to every power of two of the unit, [numRanges + 1], for the le buckets of the
+    /// Prometheus histograms.
+    [[nodiscard]] std::vector<std::pair<double, std::uint64_t>> getCumulativeCounts() const
+    {
+        std::vector<std::pair<double, std::uint64_t>> counts;
+        counts.reserve(mNumRanges + 1);
+        std::uint64_t cumulative = mCounts[0].load(std::memory_order_relaxed);
+        counts.emplace_back(mUnit, cumulative);
+        for (int range = 0; range < mNumRanges; ++range)
+        {
+            for (int sub = 0; sub < kSubBuckets; ++sub)
+            {
+                cumulative += mCounts[1 + range * kSubBuckets + sub].load(std::memory_order_relaxed);
+            }
+            counts.emplace_back(std::ldexp(mUnit, range + 1), cumulative);
+        }
+        return counts;
+    }
+
+    void reset() noexcept
+    {
+        for (auto& count : mCounts)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+        mCount.store(0, std::memory_order_relaxed);
+        mSum.store(0., std::memory_order_relaxed);
+    }
+
+private:
+    [[nodiscard]] std::size_t getBucketIdx(double value) const noexcept
+    {
+        auto const units = value / mUnit;
+        if (!(units >= 1.))
+        {
+            return 0;
+        }
+        int exponent{0};
+        // units = mantissa * 2^exponent with mantissa in [0.5, 1)
+        auto const mantissa = std::frexp(units, &exponent);
+        auto const range = exponent - 1;
+        if (range >= mNumRanges)
+        {
+            return mCounts.size() - 1;
+        }
+        auto const sub = std::min(static_cast<int>((mantissa * 2. - 1.) * kSubBuckets), kSubBuckets - 1);
+        return 1 + static_cast<std::size_t>(range) * kSubBuckets + sub;
+    }
+
+    [[nodiscard]] double getUpperBound(std::size_t idx) const noexcept
+    {
+        if (idx == 0)
+        {
+            return mUnit;
+        }
+        auto const range = static_cast<int>((idx - 1) / kSubBuckets);
+        auto const sub = static_cast<int>((idx - 1) % kSubBuckets);
+        return std::ldexp(mUnit, range) * (1. + static_cast<double>(sub + 1) / kSubBuckets);
+    }
+
+    double const mUnit;
+    int const mNumRanges;
+    std::vector<std::atomic<std::uint64_t>> mCounts;
+    std::atomic<std::uint64_t> mCount{0};
+    std::atomic<double> mSum{0.};
+};
+
+/// @brief Serving metrics of an executor, aggregated in process and scraped in the Prometheus text format.
+/// @details The responses and the iteration stats are observed where the application already handles them, e.g. in
+/// the callbacks of a ResponseDispatcher and after getLatestIterationStats, and a scrape reads the histograms at any
+/// time without draining anything. The latencies need returnPerfMetrics in the OutputConfig of the requests. The
+/// observers are lock-free and may be called from several threads.
+class MetricsRegistry
+{
+public:
+    explicit MetricsRegistry(std::string prefix = "trtllm")
+        : mPrefix{std::move(prefix)}
+    {
+    }
+
+    /// @brief Records the latencies, the KV cache reuse and the draft acceptance of the final responses.
+    void observe(Response const& response)
+    {
+        if (response.hasError())
+        {
+            mNumFailedRequests.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        auto const& result = response.getResult();
+        if (!result.isFinal)
+        {
+            return;
+        }
+        mNumCompletedRequests.fetch_add(1, std::memory_order_relaxed);
+        if (!result.requestPerfMetrics)
+        {
+            return;
+        }
+        auto const& metrics = result.requestPerfMetrics.value();
+        auto const& timing = metrics.timingMetrics;
+        auto const toMs = [](auto duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+        mQueueTimeMs.record(toMs(timing.firstScheduledTime - timing.arrivalTime));
+        mTtftMs.record(toMs(timing.firstTokenTime - timing.arrivalTime));
+        mE2eLatencyMs.record(toMs(timing.lastTokenTime - timing.arrivalTime));
+        // The output tokens may include the prompt, the iterations are the steps that generated tokens.
+        if (result.decodingIter > 1)
+        {
+            mItlMs.record(toMs(timing.lastTokenTime - timing.firstTokenTime) / (result.decodingIter - 1));
+        }
+        auto const& kvCache = metrics.kvCacheMetrics;
+        if (kvCache.numReusedBlocks + kvCache.numMissedBlocks > 0)
+        {
+            mKvCacheReuseRate.record(static_cast<double>(kvCache.numReusedBlocks)
+                / (kvCache.numReusedBlocks + kvCache.numMissedBlocks));
+        }
+        if (metrics.speculativeDecoding.totalDraftTokens > 0)
+        {
+            mDraftAcceptanceRate.record(metrics.speculativeDecoding.acceptanceRate);
+        }
+    }
+
+    /// @brief Records the batch of an iteration and sets the gauges of the queue and of the KV cache.
+    void observe(IterationStats const& stats)
+    {
+        mIterationLatencyMs.record(stats.iterLatencyMS);
+        mNumQueuedRequests.store(stats.numQueuedRequests, std::memory_order_relaxed);
+        mNumActiveRequests.store(stats.numActiveRequests, std::memory_order_relaxed);
+        if (stats.inflightBatchingStats)
+        {
+            mBatchSize.record(stats.inflightBatchingStats->numScheduledRequests);
+            mNumPausedRequests.fetch_add(stats.inflightBatchingStats->numPausedRequests, std::memory_order_relaxed);
+        }
+        else if (stats.staticBatchingStats)
+        {
+            mBatchSize.record(stats.staticBatchingStats->numScheduledRequests);
+        }
+        if (stats.kvCacheStats)
+        {
+            auto const& kvCache = stats.kvCacheStats.value();
+            mKvCacheUsedBlocks.store(kvCache.usedNumBlocks, std::memory_order_relaxed);
+            mKvCacheMaxBlocks.store(kvCache.maxNumBlocks, std::memory_order_relaxed);
+            mKvCacheHitRate.store(kvCache.cacheHitRate, std::memory_order_relaxed);
+        }
+    }
+
+    template <typename Iterable>
+    void observeAll(Iterable const& items)
+    {
+        for (auto const& item : items)
+        {
+            observe(item);
+        }
+    }
+
+    [[nodiscard]] LogLinearHistogram const& getTtftMs() const noexcept
+    {
+        return mTtftMs;
+    }
+
+    [[nodiscard]] LogLinearHistogram const& getItlMs() const noexcept
+    {
+        return mItlMs;
+    }
+
+    [[nodiscard]] LogLinearHistogram const& getQueueTimeMs() const noexcept
+    {
+        return mQueueTimeMs;
+    }
+
+    [[nodiscard]] LogLinearHistogram const& getBatchSize() const noexcept
+    {
+        return mBatchSize;
+    }
+
+    /// @brief The metrics in the Prometheus text exposition format, the latencies in seconds.
+    [[nodiscard]] std::string toPrometheusText() const
+    {
+        std::stringstream ss;
+        ss << std::setprecision(9);
+        writeCounter(ss, "requests_completed_total", "Requests that finished.", mNumCompletedRequests);
+        writeCounter(ss, "requests_failed_total", "Requests that finished with an error.", mNumFailedRequests);
+        writeCounter(ss, "requests_paused_total", "Pauses of requests evicted from the KV cache.", mNumPausedRequests);
+        writeGauge(ss, "requests_queued", "Requests waiting to be scheduled.", mNumQueuedRequests.load());
+        writeGauge(ss, "requests_active", "Requests being processed.", mNumActiveRequests.load());
+        writeGauge(ss, "kv_cache_used_blocks", "Used blocks of the primary KV cache pool.", mKvCacheUsedBlocks.load());
+        writeGauge(ss, "kv_cache_max_blocks", "Blocks of the primary KV cache pool.", mKvCacheMaxBlocks.load());
+        writeGauge(ss, "kv_cache_hit_rate", "KV cache block reuse rate since the start.", mKvCacheHitRate.load());
+        writeHistogram(ss, "time_to_first_token_seconds", "Time from the arrival to the first token.", mTtftMs, 1e-3);
+        writeHistogram(
+            ss, "inter_token_latency_seconds", "Mean time between the decoding steps of a request.", mItlMs, 1e-3);
+        writeHistogram(ss, "queue_time_seconds", "Time from the arrival to the first scheduling.", mQueueTimeMs, 1e-3);
+        writeHistogram(
+            ss, "e2e_request_latency_seconds", "Time from the arrival to the last token.", mE2eLatencyMs, 1e-3);
+        writeHistogram(ss, "iteration_latency_seconds", "Time of an executor iteration.", mIterationLatencyMs, 1e-3);
+        writeHistogram(ss, "batch_size", "Requests scheduled in an iteration.", mBatchSize, 1.);
+        writeHistogram(
+            ss, "request_kv_cache_reuse_rate", "Reused KV cache blocks of a request.", mKvCacheReuseRate, 1.);
+        writeHistogram(ss, "request_draft_acceptance_rate", "Accepted draft tokens of a request.", mDraftAcceptanceRate,
+            1.);
+        return ss.str();
+    }
+
+    void reset() noexcept
+    {
+        for (auto* histogram : {&mTtftMs, &mItlMs, &mQueueTimeMs, &mE2eLatencyMs, &mIterationLatencyMs, &mBatchSize,
+                 &mKvCacheReuseRate, &mDraftAcceptanceRate})
+        {
+            histogram->reset();
+        }
+        mNumCompletedRequests.store(0, std::memory_order_relaxed);
+        mNumFailedRequests.store(0, std::memory_order_relaxed);
+        mNumPausedRequests.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    void writeCounter(std::stringstream& ss, char const* name, char const* help,
+        std::atomic<std::uint64_t> const& counter) const
+    {
+        ss << "# HELP " << mPrefix << "_" << name << " " << help << "\n";
+        ss << "# TYPE " << mPrefix << "_" << name << " counter\n";
+        ss << mPrefix << "_" << name << " " << counter.load(std::memory_order_relaxed) << "\n";
+    }
+
+    template <typename T>
+    void writeGauge(std::stringstream& ss, char const* name, char const* help, T value) const
+    {
+        ss << "# HELP " << mPrefix << "_" << name << " " << help << "\n";
+        ss << "# TYPE " << mPrefix << "_" << name << " gauge\n";
+        ss << mPrefix << "_" << name << " " << value << "\n";
+    }
+
+    void writeHistogram(std::stringstream& ss, char const* name, char const* help,
+        LogLinearHistogram const& histogram, double scale) const
+    {
+        ss << "# HELP " << mPrefix << "_" << name << " " << help << "\n";
+        ss << "# TYPE " << mPrefix << "_" << name << " histogram\n";
+        for (auto const& [bound, count] : histogram.getCumulativeCounts())
+        {
+            ss << mPrefix << "_" << name << "_bucket{le=\"" << bound * scale << "\"} " << count << "\n";
+        }
+        auto const count = histogram.getCount();
+        ss << mPrefix << "_" << name << "_bucket{le=\"+Inf\"} " << count << "\n";
+        ss << mPrefix << "_" << name << "_sum " << histogram.getSum() * scale << "\n";
+        ss << mPrefix << "_" << name << "_count " << count << "\n";
+    }
+
+    std::string mPrefix;
+
+    // Latencies in ms from 0.1 ms to about 28 min, the ratios from 1/1024 to 1
+    LogLinearHistogram mTtftMs{0.1, 24};
+    LogLinearHistogram mItlMs{0.1, 24};
+    LogLinearHistogram mQueueTimeMs{0.1, 24};
+    LogLinearHistogram mE2eLatencyMs{0.1, 24};
+    LogLinearHistogram mIterationLatencyMs{0.1, 24};
+    LogLinearHistogram mBatchSize{1., 16};
+    LogLinearHistogram mKvCacheReuseRate{1. / 1024, 10};
+    LogLinearHistogram mDraftAcceptanceRate{1. / 1024, 10};
+
+    std::atomic<std::uint64_t> mNumCompletedRequests{0};
+    std::atomic<std::uint64_t> mNumFailedRequests{0};
+    std::atomic<std::uint64_t> mNumPausedRequests{0};
+    std::atomic<SizeType32> mNumQueuedRequests{0};
+    std::atomic<SizeType32> mNumActiveRequests{0};
+    std::atomic<SizeType32> mKvCacheUsedBlocks{0};
+    std::atomic<SizeType32> mKvCacheMaxBlocks{0};
+    std::atomic<float> mKvCacheHitRate{0.F};
+};
+
+} // namespace tensorrt_llm::executor
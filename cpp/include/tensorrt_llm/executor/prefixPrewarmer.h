@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/executor/types.h"
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::executor
+{
+
+/// @brief A prefix submitted by PrefixPrewarmer::prefillPrefix.
+struct PrefixHandle
+{
+    /// @brief The executor request that computes the prefix.
+    IdType requestId;
+    VecTokens tokens;
+    RetentionPriority priority;
+    std::optional<std::chrono::milliseconds> durationMs;
+};
+
+/// @brief Computes the KV cache blocks of prefixes ahead of the requests that share them, e.g. the system prompts of
+/// the templates at startup or after a template rollout, so that the first requests reuse them instead of paying the
+/// prefill.
+/// @details A prefix is prefilled by a request that generates a single token, with the retention priority of the prefix
+/// over all its tokens and the lowest priority for the block of the generated token. Block reuse must be enabled in the
+/// KvCacheConfig of the executor, and only the full blocks of the prefix are reused: a prefix should end on a block
+/// boundary. The blocks stay at the priority for the duration, if any, and are then evicted like any other block;
+/// refresh prefills the prefix again, which reuses its blocks if they are still cached and restarts the duration.
+class PrefixPrewarmer
+{
+public:
+    using RequestSink = std::function<std::vector<IdType>(std::vector<Request> const&)>;
+    using ResponseSource
+        = std::function<std::vector<Response>(IdType, std::optional<std::chrono::milliseconds> const&)>;
+
+    explicit PrefixPrewarmer(Executor& executor)
+        : PrefixPrewarmer(
+            [&executor](std::vector<Request> const& requests) { return executor.enqueueRequests(requests); },
+            [&executor](IdType requestId, std::optional<std::chrono::milliseconds> const& timeout)
+            { return executor.awaitResponses(requestId, timeout); })
+    {
+    }
+
+    PrefixPrewarmer(RequestSink sink, ResponseSource source)
+        : mSink{std::move(sink)}
+        , mSource{std::move(source)}
+    {
+    }
+
+    /// @brief Submit the prefill of a prefix without waiting for it, see await.
+    [[nodiscard]] PrefixHandle prefillPrefix(VecTokens tokens,
+        RetentionPriority priority = KvCacheRetentionConfig::kMaxRetentionPriority,
+        std::optional<std::chrono::milliseconds> durationMs = std::nullopt)
+    {
+        auto handles = prefillPrefixes({std::move(tokens)}, priority, durationMs);
+        return std::move(handles.front());
+    }
+
+    /// @brief Submit the prefills of several prefixes with a single enqueueRequests, so they are batched together.
+    [[nodiscard]] std::vector<PrefixHandle> prefillPrefixes(std::vector<VecTokens> prefixes,
+        RetentionPriority priority = KvCacheRetentionConfig::kMaxRetentionPriority,
+        std::optional<std::chrono::milliseconds> durationMs = std::nullopt)
+    {
+        std::vector<Request> requests;
+        requests.reserve(prefixes.size());
+        for (auto const& tokens : prefixes)
+        {
+            requests.push_back(makeRequest(tokens, priority, durationMs));
+        }
+        auto const requestIds = mSink(requests);
+        TLLM_CHECK_WITH_INFO(requestIds.size() == prefixes.size(), "Submitted %zu prefixes, got %zu request ids",
+            prefixes.size(), requestIds.size());
+
+        std::vector<PrefixHandle> handles;
+        handles.reserve(prefixes.size());
+        for (std::size_t pi = 0; pi < prefixes.size(); ++pi)
+        {
+            handles.push_back(PrefixHandle{requestIds[pi], std::move(prefixes[pi]), priority, durationMs});
+        }
+        return handles;
+    }
+
+    /// @brief Wait until the blocks of the prefix are computed, at most timeout if given.
+    /// @return Whether the prefill finished, false on timeout. Throws if the prefill failed.
+    [[nodiscard]] bool await(
+        PrefixHandle const& handle, std::optional<std::chrono::milliseconds> const& timeout = std::nullopt) const
+    {
+        for (auto const& response : mSource(handle.requestId, timeout))
+        {
+            TLLM_CHECK_WITH_INFO(!response.hasError(), "Prefill of a prefix of %zu tokens failed: %s",
+                handle.tokens.size(), response.getErrorMsg().c_str());
+            if (response.getResult().isFinal)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Prefill the prefix of the handle again, to restart the duration of its priority or to compute the blocks
+    /// evicted since.
+    [[nodiscard]] PrefixHandle refresh(PrefixHandle const& handle)
+    {
+        return prefillPrefix(handle.tokens, handle.priority, handle.durationMs);
+    }
+
+    [[nodiscard]] static Request makeRequest(VecTokens const& tokens, RetentionPriority priority,
+        std::optional<std::chrono::milliseconds> durationMs)
+    {
+        TLLM_CHECK_WITH_INFO(!tokens.empty(), "Cannot prefill an empty prefix");
+        Request request(tokens, /*maxTokens=*/1);
+        request.setKvCacheRetentionConfig(KvCacheRetentionConfig(
+            {KvCacheRetentionConfig::TokenRangeRetentionConfig(0, std::nullopt, priority, durationMs)},
+            KvCacheRetentionConfig::kMinRetentionPriority));
+        return request;
+    }
+
+private:
+    RequestSink mSink;
+    ResponseSource mSource;
+};
+
+} // namespace tensorrt_llm::executor
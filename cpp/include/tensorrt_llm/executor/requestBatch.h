@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/arrayView.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/executor/types.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::executor
+{
+
+/// @brief Bulk submission of requests that share their configuration, e.g. for batch scoring.
+/// @details The prompts live in one contiguous token buffer with offsets, and the sampling and output configs are
+/// stored once for the batch. Requests are only materialized when enqueued, a chunk at a time, so the client never
+/// holds more than one chunk of Request objects and builds each prompt directly from the buffer.
+class RequestBatch
+{
+public:
+    struct SharedConfig
+    {
+        SizeType32 maxTokens;
+        SamplingConfig samplingConfig{};
+        OutputConfig outputConfig{};
+        std::optional<SizeType32> endId{std::nullopt};
+        std::optional<SizeType32> padId{std::nullopt};
+        bool streaming{false};
+        PriorityType priority{Request::kDefaultPriority};
+    };
+
+    explicit RequestBatch(SharedConfig config)
+        : mConfig{std::move(config)}
+        , mOffsets{0}
+    {
+    }
+
+    //! \brief Take ownership of prompts that are already laid out contiguously.
+    //! \param offsets Start of every prompt in tokens, followed by the end of the last one.
+    RequestBatch(SharedConfig config, VecTokens tokens, std::vector<std::size_t> offsets)
+        : mConfig{std::move(config)}
+        , mTokens{std::move(tokens)}
+        , mOffsets{std::move(offsets)}
+    {
+        TLLM_CHECK_WITH_INFO(!mOffsets.empty() && mOffsets.front() == 0 && mOffsets.back() == mTokens.size()
+                && std::is_sorted(mOffsets.begin(), mOffsets.end()),
+            "Offsets must start at 0, grow and end at the number of tokens");
+    }
+
+    void reserve(std::size_t numRequests, std::size_t numTokens)
+    {
+        mTokens.reserve(numTokens);
+        mOffsets.reserve(numRequests + 1);
+    }
+
+    //! \brief Append a prompt, optionally with its own maximum number of new tokens and client id.
+    void add(TokenIdType const* tokens, std::size_t numTokens, std::optional<SizeType32> maxTokens = std::nullopt,
+        std::optional<IdType> clientId = std::nullopt)
+    {
+        TLLM_CHECK_WITH_INFO(numTokens > 0, "Prompts must not be empty");
+        auto const requestIdx = size();
+        mTokens.insert(mTokens.end(), tokens, tokens + numTokens);
+        mOffsets.push_back(mTokens.size());
+        if (maxTokens.has_value())
+        {
+            mMaxTokens.resize(requestIdx + 1, mConfig.maxTokens);
+            mMaxTokens[requestIdx] = *maxTokens;
+        }
+        if (clientId.has_value())
+        {
+            mClientIds.resize(requestIdx + 1);
+            mClientIds[requestIdx] = clientId;
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return mOffsets.size() - 1;
+    }
+
+    [[nodiscard]] common::ArrayView<TokenIdType const> getTokens(std::size_t requestIdx) const
+    {
+        TLLM_CHECK(requestIdx < size());
+        return {mTokens.data() + mOffsets[requestIdx], mOffsets[requestIdx + 1] - mOffsets[requestIdx]};
+    }
+
+    //! \brief Build the request at requestIdx, copying its prompt straight from the buffer.
+    [[nodiscard]] Request createRequest(std::size_t requestIdx) const
+    {
+        auto const tokens = getTokens(requestIdx);
+        auto const maxTokens = requestIdx < mMaxTokens.size() ? mMaxTokens[requestIdx] : mConfig.maxTokens;
+        Request request{VecTokens(tokens.begin(), tokens.end()), maxTokens, mConfig.streaming, mConfig.samplingConfig,
+            mConfig.outputConfig, mConfig.endId, mConfig.padId};
+        if (mConfig.priority != Request::kDefaultPriority)
+        {
+            request.setPriority(mConfig.priority);
+        }
+        if (requestIdx < mClientIds.size() && mClientIds[requestIdx].has_value())
+        {
+            request.setClientId(*mClientIds[requestIdx]);
+        }
+        return request;
+    }
+
+    //! \brief Enqueue every request of the batch, chunkSize requests per enqueueRequests call.
+    //! \return The request ids, in the order of the batch.
+    [[nodiscard]] std::vector<IdType> enqueue(Executor& executor, std::size_t chunkSize = 1024) const
+    {
+        TLLM_CHECK(chunkSize > 0);
+        std::vector<IdType> requestIds;
+        requestIds.reserve(size());
+        std::vector<Request> chunk;
+        chunk.reserve(std::min(chunkSize, size()));
+        for (std::size_t begin = 0; begin < size(); begin += chunkSize)
+        {
+            auto const end = std::min(begin + chunkSize, size());
+            chunk.clear();
+            for (auto requestIdx = begin; requestIdx < end; ++requestIdx)
+            {
+                chunk.push_back(createRequest(requestIdx));
+            }
+            auto const ids = executor.enqueueRequests(chunk);
+            requestIds.insert(requestIds.end(), ids.begin(), ids.end());
+        }
+        return requestIds;
+    }
+
+private:
+    SharedConfig mConfig;
+    VecTokens mTokens;
+    std::vector<std::size_t> mOffsets;
+    // Per request overrides, only as long as the last request that has one.
+    std::vector<SizeType32> mMaxTokens;
+    std::vector<std::optional<IdType>> mClientIds;
+};
+
+} // namespace tensorrt_llm::executor
@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/executor/types.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define TLLM_HAS_COROUTINES 1
+#endif
+
+#ifndef _WIN32
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace tensorrt_llm::executor
+{
+
+/// @brief Delivers the responses of an executor without a polling thread per consumer.
+/// @details A single thread blocks in awaitResponses, which returns as soon as responses are ready, so delivery adds
+/// no timeout quantization; the poll timeout only bounds how long stop() takes. Every response goes to the first
+/// consumer that matches it:
+///   1. the callback registered for its request, or the coroutine awaiting the request,
+///   2. the response callback,
+///   3. the queue drained by takeResponses(), which signals an eventfd that can be registered with epoll or io_uring.
+/// Callbacks and resumed coroutines run on the dispatcher thread and should hand heavy work off.
+class ResponseDispatcher
+{
+public:
+    using Callback = std::function<void(Response const&)>;
+    using ResponseSource = std::function<std::vector<Response>(std::optional<std::chrono::milliseconds> const&)>;
+
+    explicit ResponseDispatcher(
+        Executor& executor, std::chrono::milliseconds pollTimeout = std::chrono::milliseconds{100})
+        : ResponseDispatcher(
+            [&executor](std::optional<std::chrono::milliseconds> const& timeout)
+            { return executor.awaitResponses(timeout); },
+            pollTimeout)
+    {
+    }
+
+    explicit ResponseDispatcher(
+        ResponseSource source, std::chrono::milliseconds pollTimeout = std::chrono::milliseconds{100})
+        : mSource{std::move(source)}
+        , mPollTimeout{pollTimeout}
+    {
+#ifndef _WIN32
+        mEventFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        TLLM_CHECK_WITH_INFO(mEventFd >= 0, "Failed to create eventfd: %s", std::strerror(errno));
+#endif // _WIN32
+        mThread = std::thread(&ResponseDispatcher::run, this);
+    }
+
+    ~ResponseDispatcher()
+    {
+        stop();
+#ifndef _WIN32
+        if (mEventFd >= 0)
+        {
+            ::close(mEventFd);
+        }
+#endif // _WIN32
+    }
+
+    ResponseDispatcher(ResponseDispatcher const&) = delete;
+    ResponseDispatcher& operator=(ResponseDispatcher const&) = delete;
+
+    void stop()
+    {
+        mStop = true;
+        if (mThread.joinable())
+        {
+            mThread.join();
+        }
+    }
+
+    //! \brief Callback for the responses of requests without their own consumer.
+    void setResponseCallback(Callback callback)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mResponseCallback = std::move(callback);
+    }
+
+    //! \brief Callback for the responses of a request, removed after its final response. Register it right after
+    //! enqueueing the request, earlier responses take the other routes.
+    void setRequestCallback(IdType requestId, Callback callback)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequests[requestId].callback = std::move(callback);
+    }
+
+    //! \brief File descriptor that is readable while takeResponses() has responses. Not valid on Windows.
+    [[nodiscard]] int getEventFd() const noexcept
+    {
+        return mEventFd;
+    }
+
+    //! \brief Responses that no callback took, in arrival order.
+    [[nodiscard]] std::vector<Response> takeResponses()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+#ifndef _WIN32
+        std::uint64_t count;
+        // Resets the counter, the queue is emptied under the same lock.
+        static_cast<void>(::read(mEventFd, &count, sizeof(count)));
+#endif // _WIN32
+        return std::exchange(mQueue, {});
+    }
+
+#ifdef TLLM_HAS_COROUTINES
+    /// @brief Awaits the next responses of a request: `auto responses = co_await dispatcher.nextResponses(id);`
+    /// @details Call watch() right after enqueueing the request so that no response is missed between two awaits.
+    class ResponsesAwaiter
+    {
+    public:
+        ResponsesAwaiter(ResponseDispatcher& dispatcher, IdType requestId)
+            : mDispatcher{dispatcher}
+            , mRequestId{requestId}
+        {
+        }
+
+        [[nodiscard]] bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            return mDispatcher.suspend(mRequestId, handle, mResponses);
+        }
+
+        std::vector<Response> await_resume() noexcept
+        {
+            return std::move(mResponses);
+        }
+
+    private:
+        ResponseDispatcher& mDispatcher;
+        IdType mRequestId;
+        std::vector<Response> mResponses;
+    };
+
+    void watch(IdType requestId)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequests[requestId].isWatched = true;
+    }
+
+    [[nodiscard]] ResponsesAwaiter nextResponses(IdType requestId)
+    {
+        watch(requestId);
+        return ResponsesAwaiter{*this, requestId};
+    }
+#endif // TLLM_HAS_COROUTINES
+
+private:
+    struct RequestState
+    {
+        Callback callback;
+        bool isWatched{false};
+        std::vector<Response> buffered;
+#ifdef TLLM_HAS_COROUTINES
+        std::coroutine_handle<> waiter;
+        std::vector<Response>* waiterResponses{nullptr};
+#endif // TLLM_HAS_COROUTINES
+    };
+
+    [[nodiscard]] static bool isFinal(Response const& response)
+    {
+        return response.hasError() || response.getResult().isFinal;
+    }
+
+#ifdef TLLM_HAS_COROUTINES
+    //! \return False if responses were already buffered, in which case the coroutine continues right away.
+    bool suspend(IdType requestId, std::coroutine_handle<> handle, std::vector<Response>& responses)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& state = mRequests[requestId];
+        if (!state.buffered.empty())
+        {
+            responses = std::exchange(state.buffered, {});
+            if (isFinal(responses.back()) && !state.callback)
+            {
+                mRequests.erase(requestId);
+            }
+            return false;
+        }
+        TLLM_CHECK_WITH_INFO(!state.waiter, "Request %lu is already awaited", static_cast<unsigned long>(requestId));
+        state.waiter = handle;
+        state.waiterResponses = &responses;
+        return true;
+    }
+#endif // TLLM_HAS_COROUTINES
+
+    void run()
+    {
+        while (!mStop)
+        {
+            std::vector<Response> responses;
+            try
+            {
+                responses = mSource(mPollTimeout);
+            }
+            catch (std::exception const& e)
+            {
+                TLLM_LOG_EXCEPTION(e);
+                break;
+            }
+            dispatch(std::move(responses));
+        }
+    }
+
+    void dispatch(std::vector<Response> responses)
+    {
+        std::vector<std::pair<Callback, Response>> callbacks;
+#ifdef TLLM_HAS_COROUTINES
+        std::vector<std::coroutine_handle<>> resumed;
+#endif // TLLM_HAS_COROUTINES
+        bool queued{false};
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            for (auto& response : responses)
+            {
+                auto const it = mRequests.find(response.getRequestId());
+                if (it != mRequests.end())
+                {
+                    auto& state = it->second;
+                    bool const final = isFinal(response);
+                    if (state.callback)
+                    {
+                        callbacks.emplace_back(state.callback, std::move(response));
+                    }
+                    else
+                    {
+                        state.buffered.push_back(std::move(response));
+                    }
+#ifdef TLLM_HAS_COROUTINES
+                    if (state.waiter && !state.buffered.empty())
+                    {
+                        *state.waiterResponses = std::exchange(state.buffered, {});
+                        resumed.push_back(std::exchange(state.waiter, {}));
+                    }
+#endif // TLLM_HAS_COROUTINES
+                    if (final && state.buffered.empty())
+                    {
+                        mRequests.erase(it);
+                    }
+                }
+                else if (mResponseCallback)
+                {
+                    callbacks.emplace_back(mResponseCallback, std::move(response));
+                }
+                else
+                {
+                    mQueue.push_back(std::move(response));
+                    queued = true;
+                }
+            }
+        }
+#ifndef _WIN32
+        if (queued)
+        {
+            std::uint64_t const one{1};
+            static_cast<void>(::write(mEventFd, &one, sizeof(one)));
+        }
+#endif // _WIN32
+        // Outside of the lock, consumers may register callbacks or await again.
+        for (auto& [callback, response] : callbacks)
+        {
+            callback(response);
+        }
+#ifdef TLLM_HAS_COROUTINES
+        for (auto const handle : resumed)
+        {
+            handle.resume();
+        }
+#endif // TLLM_HAS_COROUTINES
+    }
+
+    ResponseSource mSource;
+    std::chrono::milliseconds mPollTimeout;
+    int mEventFd{-1};
+    std::mutex mMutex;
+    Callback mResponseCallback;
+    std::unordered_map<IdType, RequestState> mRequests;
+    std::vector<Response> mQueue;
+    std::atomic<bool> mStop{false};
+    std::thread mThread;
+};
+
+} // namespace tensorrt_llm::executor
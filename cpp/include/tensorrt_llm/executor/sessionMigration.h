@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/executor/serialization.h"
+#include "tensorrt_llm/executor/types.h"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// @brief Moving the KV cache of a conversation or of a request in flight from one executor to another, over the
+/// cache transceiver of disaggregated serving: the source executor runs the tokens as a context-only request, and
+/// the target continues as a generation-only request that pulls the KV blocks from the source. Both executors need a
+/// CacheTransceiverConfig, and the source block reuse, so that the context-only request reuses the blocks of the
+/// conversation or of the request it replaces rather than recomputing them.
+///
+/// - Between the turns of a chat, exportSession parks the history on the executor that served it, and the next turn
+///   imports it on any replica.
+/// - To drain a replica, cancel its requests and export their prompts with the tokens they generated so far, then
+///   import them on the other replicas with the remaining token budget.
+namespace tensorrt_llm::executor::session_migration
+{
+
+/// @brief What the target executor needs to continue a session: its tokens and the context phase state that locates
+/// their KV blocks on the source executor. It can be serialized and sent to the target, see serializeSnapshot.
+struct SessionSnapshot
+{
+    /// @brief The tokens of the session, whose KV blocks the source holds.
+    VecTokens tokens;
+    /// @brief The context phase of the tokens on the source, with the first token it generated.
+    ContextPhaseParams contextPhaseParams;
+};
+
+/// @brief Compute or reuse the KV blocks of the tokens on the source executor and keep them for a transfer.
+/// @details Waits for the context phase, at most timeout per wait if given, and throws on error or timeout.
+[[nodiscard]] inline SessionSnapshot exportSession(
+    Executor& source, VecTokens tokens, std::optional<std::chrono::milliseconds> const& timeout = std::nullopt)
+{
+    TLLM_CHECK_WITH_INFO(!tokens.empty(), "Cannot export a session without tokens");
+    Request request(tokens, /*maxTokens=*/1);
+    request.setRequestType(RequestType::REQUEST_TYPE_CONTEXT_ONLY);
+    auto const requestId = source.enqueueRequest(request);
+    while (true)
+    {
+        auto responses = source.awaitResponses(requestId, timeout);
+        TLLM_CHECK_WITH_INFO(!responses.empty(), "Timed out exporting a session of %zu tokens", tokens.size());
+        for (auto const& response : responses)
+        {
+            TLLM_CHECK_WITH_INFO(!response.hasError(), "Exporting a session of %zu tokens failed: %s", tokens.size(),
+                response.getErrorMsg().c_str());
+            auto const& result = response.getResult();
+            if (result.isFinal)
+            {
+                TLLM_CHECK_WITH_INFO(result.contextPhaseParams.has_value(),
+                    "The source executor returned no context phase, does it have a cache transceiver?");
+                return SessionSnapshot{std::move(tokens), *result.contextPhaseParams};
+            }
+        }
+    }
+}
+
+/// @brief Continue the session on the target executor, pulling its KV blocks from the source.
+/// @param continuation The request that continues the session, with the tokens of the snapshot as input tokens and the
+/// sampling and output configs of the session. Its maxTokens includes the first token generated by the export.
+/// @return The id of the request on the target.
+[[nodiscard]] inline IdType importSession(Executor& target, SessionSnapshot snapshot, Request continuation)
+{
+    TLLM_CHECK_WITH_INFO(continuation.getInputTokenIds() == snapshot.tokens,
+        "The continuation of a session must have the %zu tokens of the snapshot as input", snapshot.tokens.size());
+    continuation.setRequestType(RequestType::REQUEST_TYPE_GENERATION_ONLY);
+    continuation.setContextPhaseParams(std::move(snapshot.contextPhaseParams));
+    return target.enqueueRequest(continuation);
+}
+
+/// @brief Bytes of a snapshot to send to the target host, or to park between the turns of a chat.
+[[nodiscard]] inline std::vector<char> serializeSnapshot(SessionSnapshot const& snapshot)
+{
+    std::ostringstream os;
+    auto const numTokens = static_cast<std::uint64_t>(snapshot.tokens.size());
+    os.write(reinterpret_cast<char const*>(&numTokens), sizeof(numTokens));
+    os.write(reinterpret_cast<char const*>(snapshot.tokens.data()),
+        static_cast<std::streamsize>(numTokens * sizeof(TokenIdType)));
+    Serialization::serialize(snapshot.contextPhaseParams, os);
+    auto const str = os.str();
+    return {str.begin(), str.end()};
+}
+
+[[nodiscard]] inline SessionSnapshot deserializeSnapshot(std::vector<char> const& buffer)
+{
+    std::istringstream is(std::string(buffer.begin(), buffer.end()));
+    std::uint64_t numTokens{0};
+    is.read(reinterpret_cast<char*>(&numTokens), sizeof(numTokens));
+    TLLM_CHECK_WITH_INFO(is.good() && numTokens * sizeof(TokenIdType) <= buffer.size(), "Truncated session snapshot");
+    VecTokens tokens(numTokens);
+    is.read(reinterpret_cast<char*>(tokens.data()), static_cast<std::streamsize>(numTokens * sizeof(TokenIdType)));
+    TLLM_CHECK_WITH_INFO(is.good(), "Truncated session snapshot");
+    return SessionSnapshot{std::move(tokens), Serialization::deserializeContextPhaseParams(is)};
+}
+
+} // namespace tensorrt_llm::executor::session_migration
@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/shmRingBuffer.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/executor/flatSerialization.h"
+#include "tensorrt_llm/executor/serialization.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::executor
+{
+
+/// @brief Merges the streamed responses of a request that queue up between two deliveries into one.
+/// @details Only plain token results are merged: no errors, log probabilities, logits, encoder output or other
+/// optional outputs, and a single beam. The merged result has the tokens of both, and the state of the newer one.
+class ResponseCoalescer
+{
+public:
+    //! \param tokensAreDeltas Whether results hold only the new tokens, as in streaming without
+    //! returnAllGeneratedTokens. Otherwise a newer result replaces an older one.
+    explicit ResponseCoalescer(bool tokensAreDeltas = true)
+        : mTokensAreDeltas{tokensAreDeltas}
+    {
+    }
+
+    void add(Response response)
+    {
+        if (isMergeable(response))
+        {
+            auto const key = getKey(response);
+            auto const it = mMergeable.find(key);
+            if (it != mMergeable.end())
+            {
+                auto& pending = mPending[it->second];
+                pending = merge(pending, response);
+                ++mNumCoalesced;
+                if (response.getResult().isSequenceFinal)
+                {
+                    mMergeable.erase(it);
+                }
+                return;
+            }
+            if (!response.getResult().isSequenceFinal)
+            {
+                mMergeable.emplace(key, mPending.size());
+            }
+        }
+        mPending.push_back(std::move(response));
+    }
+
+    void add(std::vector<Response> responses)
+    {
+        for (auto& response : responses)
+        {
+            add(std::move(response));
+        }
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return mPending.empty();
+    }
+
+    [[nodiscard]] std::vector<Response> take()
+    {
+        mMergeable.clear();
+        return std::exchange(mPending, {});
+    }
+
+    //! \brief Number of responses merged into an earlier one.
+    [[nodiscard]] std::int64_t getNumCoalesced() const noexcept
+    {
+        return mNumCoalesced;
+    }
+
+private:
+    using KeyType = std::pair<IdType, SizeType32>;
+
+    struct KeyHash
+    {
+        std::size_t operator()(KeyType const& key) const noexcept
+        {
+            return std::hash<IdType>{}(key.first) ^ (std::hash<SizeType32>{}(key.second) << 1);
+        }
+    };
+
+    [[nodiscard]] static KeyType getKey(Response const& response)
+    {
+        return {response.getRequestId(), response.getResult().sequenceIndex};
+    }
+
+    [[nodiscard]] static bool isMergeable(Response const& response)
+    {
+        if (response.hasError())
+        {
+            return false;
+        }
+        auto const& result = response.getResult();
+        return result.outputTokenIds.size() == 1 && !result.cumLogProbs.has_value() && !result.logProbs.has_value()
+            && !result.contextLogits.has_value() && !result.generationLogits.has_value()
+            && !result.encoderOutput.has_value() && !result.specDecFastLogitsInfo.has_value()
+            && !result.contextPhaseParams.has_value() && result.additionalOutputs.empty();
+    }
+
+    [[nodiscard]] Response merge(Response const& older, Response const& newer) const
+    {
+        auto result = newer.getResult();
+        if (mTokensAreDeltas)
+        {
+            auto tokens = older.getResult().outputTokenIds.front();
+            auto const& newTokens = result.outputTokenIds.front();
+            tokens.insert(tokens.end(), newTokens.begin(), newTokens.end());
+            result.outputTokenIds.front() = std::move(tokens);
+        }
+        return Response{newer.getRequestId(), std::move(result), newer.getClientId()};
+    }
+
+    bool mTokensAreDeltas;
+    std::vector<Response> mPending;
+    // Index into mPending of the latest response of a sequence that later responses can still be merged into.
+    std::unordered_map<KeyType, std::size_t, KeyHash> mMergeable;
+    std::int64_t mNumCoalesced{0};
+};
+
+namespace detail
+{
+//! \brief Every ring message starts with an 8 byte format tag, which keeps the payload aligned.
+enum class ShmMessageFormat : std::uint64_t
+{
+    kFLAT = 1,
+    kSERIALIZATION = 2,
+};
+} // namespace detail
+
+/// @brief Sends responses to an orchestrator on the same host through a shared memory ring.
+/// @details Responses are coalesced while the ring is full, so a slow consumer receives fewer and larger messages
+/// instead of stalling the executor. Responses are written in the flat format and only fall back to Serialization
+/// for fields it does not hold. Remote orchestrators keep using MPI.
+class ShmResponseSender
+{
+public:
+    ShmResponseSender(std::string const& name, std::size_t capacity, bool tokensAreDeltas = true)
+        : mRing{common::ShmRingBuffer::create(name, capacity)}
+        , mCoalescer{tokensAreDeltas}
+    {
+    }
+
+    ~ShmResponseSender()
+    {
+        try
+        {
+            flush();
+        }
+        catch (std::exception const& e)
+        {
+            TLLM_LOG_EXCEPTION(e);
+        }
+    }
+
+    ShmResponseSender(ShmResponseSender const&) = delete;
+    ShmResponseSender& operator=(ShmResponseSender const&) = delete;
+
+    void send(std::vector<Response> responses)
+    {
+        mCoalescer.add(std::move(responses));
+        flush();
+    }
+
+    //! \brief Send the queued responses as far as the ring takes them.
+    //! \return True if nothing is left queued.
+    bool flush()
+    {
+        if (mCoalescer.empty())
+        {
+            return true;
+        }
+        auto pending = mCoalescer.take();
+        std::size_t sent{0};
+        while (sent < pending.size())
+        {
+            auto const end = getBatchEnd(pending, sent);
+            std::vector<Response> batch(pending.begin() + sent, pending.begin() + end);
+            auto const format = FlatSerialization::canSerialize(batch.front()) ? detail::ShmMessageFormat::kFLAT
+                                                                             : detail::ShmMessageFormat::kSERIALIZATION;
+            auto const payload = format == detail::ShmMessageFormat::kFLAT ? FlatSerialization::serialize(batch)
+                                                                           : Serialization::serialize(batch);
+            mMessage.resize(sizeof(format) + payload.size());
+            std::memcpy(mMessage.data(), &format, sizeof(format));
+            std::memcpy(mMessage.data() + sizeof(format), payload.data(), payload.size());
+            if (!mRing->tryPush(mMessage.data(), mMessage.size()))
+            {
+                break;
+            }
+            sent = end;
+            ++mNumMessages;
+        }
+        // Whatever did not fit waits for the next flush and keeps coalescing meanwhile.
+        for (auto it = pending.begin() + sent; it != pending.end(); ++it)
+        {
+            mCoalescer.add(std::move(*it));
+        }
+        return mCoalescer.empty();
+    }
+
+    [[nodiscard]] std::int64_t getNumMessages() const noexcept
+    {
+        return mNumMessages;
+    }
+
+    [[nodiscard]] std::int64_t getNumCoalesced() const noexcept
+    {
+        return mCoalescer.getNumCoalesced();
+    }
+
+private:
+    //! \brief End of the batch starting at begin: responses of the same format that fit into one message.
+    [[nodiscard]] std::size_t getBatchEnd(std::vector<Response> const& responses, std::size_t begin) const
+    {
+        auto const isFlat = FlatSerialization::canSerialize(responses[begin]);
+        if (!isFlat)
+        {
+            return begin + 1;
+        }
+        auto const headerSize = FlatSerialization::align(sizeof(FlatSerialization::Header));
+        auto const maxSize = mRing->getMaxMessageSize() - sizeof(detail::ShmMessageFormat);
+        auto size = headerSize;
+        auto end = begin;
+        while (end < responses.size() && FlatSerialization::canSerialize(responses[end]))
+        {
+            // Header and offset table of a single response, minus the header shared by the batch.
+            auto const responseSize = FlatSerialization::serializedSize({responses[end]}) - headerSize;
+            if (end > begin && size + responseSize > maxSize)
+            {
+                break;
+            }
+            size += responseSize;
+            ++end;
+        }
+        return end;
+    }
+
+    std::unique_ptr<common::ShmRingBuffer> mRing;
+    ResponseCoalescer mCoalescer;
+    std::vector<char> mMessage;
+    std::int64_t mNumMessages{0};
+};
+
+/// @brief Receives the responses of a ShmResponseSender, the same host counterpart of awaitResponses.
+class ShmResponseReceiver
+{
+public:
+    explicit ShmResponseReceiver(std::string const& name)
+        : mRing{common::ShmRingBuffer::open(name)}
+    {
+    }
+
+    //! \brief Wait for responses and return every one that arrived, in one batch per wakeup.
+    [[nodiscard]] std::vector<Response> awaitResponses(std::optional<std::chrono::milliseconds> const& timeout)
+    {
+        std::vector<Response> responses;
+        auto const waitFor = timeout.value_or(std::chrono::hours{24 * 365});
+        if (!mRing->waitPop(mMessage, waitFor))
+        {
+            return responses;
+        }
+        decode(mMessage.data(), mMessage.size(), responses);
+        // Drain what else arrived without waiting again, reading the messages in place.
+        while (auto const message = mRing->front())
+        {
+            decode(message->begin(), message->size(), responses);
+            mRing->popFront();
+        }
+        return responses;
+    }
+
+    //! \brief The producer went away and every message was received.
+    [[nodiscard]] bool isClosed()
+    {
+        return mRing->isClosed() && !mRing->front().has_value();
+    }
+
+private:
+    static void decode(char const* message, std::size_t size, std::vector<Response>& responses)
+    {
+        TLLM_CHECK(size >= sizeof(detail::ShmMessageFormat));
+        detail::ShmMessageFormat format;
+        std::memcpy(&format, message, sizeof(format));
+        auto const* payload = message + sizeof(format);
+        auto const payloadSize = size - sizeof(format);
+        if (format == detail::ShmMessageFormat::kFLAT)
+        {
+            // The message is released after decoding, so tensors must not alias it.
+            auto decoded = FlatResponsesView{payload, payloadSize}.toResponses(true);
+            std::move(decoded.begin(), decoded.end(), std::back_inserter(responses));
+            return;
+        }
+        TLLM_CHECK_WITH_INFO(format == detail::ShmMessageFormat::kSERIALIZATION, "Unknown response message format");
+        std::vector<char> buffer(payload, payload + payloadSize);
+        auto decoded = Serialization::deserializeResponses(buffer);
+        std::move(decoded.begin(), decoded.end(), std::back_inserter(responses));
+    }
+
+    std::unique_ptr<common::ShmRingBuffer> mRing;
+    std::vector<char> mMessage;
+};
+
+} // namespace tensorrt_llm::executor
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/smallVector.h"
+#include "tensorrt_llm/executor/executor.h"
+#include "tensorrt_llm/executor/types.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::executor
+{
+
+/// @brief The tokens a request generated since its last delivery.
+struct TokenDelta
+{
+    static constexpr std::size_t kNumInlineTokens = 16;
+
+    IdType requestId{0};
+    common::SmallVector<TokenIdType, kNumInlineTokens> tokens;
+    bool isFinal{false};
+    std::optional<FinishReason> finishReason{std::nullopt};
+    //! \brief Number of iterations whose tokens were coalesced into this delta.
+    SizeType32 numIterations{0};
+};
+
+/// @brief Lightweight streaming of beam width 1 outputs as token deltas.
+/// @details Every active request owns a slot of preallocated token storage. Appending the tokens of an iteration
+/// copies them into the slot without allocating, and everything appended since the last poll is delivered as one
+/// delta, so iterations coalesce naturally when the client is slower than generation. A slot only allocates if the
+/// client falls behind by more than its capacity, which is counted in the stats.
+class TokenDeltaStream
+{
+public:
+    struct Stats
+    {
+        std::int64_t numAppends{0};
+        std::int64_t numDeltas{0};
+        //! \brief Appends that did not fit into the preallocated storage.
+        std::int64_t numOverflows{0};
+    };
+
+    explicit TokenDeltaStream(SizeType32 maxNumRequests, SizeType32 slotCapacity = 256)
+        : mSlotCapacity{slotCapacity}
+    {
+        TLLM_CHECK(maxNumRequests > 0 && slotCapacity > 0);
+        mSlots.reserve(maxNumRequests);
+        mFreeSlots.reserve(maxNumRequests);
+        mReadySlots.reserve(maxNumRequests);
+        mSlotsByRequest.reserve(2 * static_cast<std::size_t>(maxNumRequests));
+        for (SizeType32 slotIdx = maxNumRequests - 1; slotIdx >= 0; --slotIdx)
+        {
+            mFreeSlots.push_back(slotIdx);
+        }
+        mSlots.resize(maxNumRequests);
+        mStorage.resize(static_cast<std::size_t>(maxNumRequests) * slotCapacity);
+    }
+
+    //! \brief Append the tokens a request generated in an iteration.
+    void append(IdType requestId, TokenIdType const* tokens, SizeType32 numTokens, bool isFinal,
+        std::optional<FinishReason> finishReason = std::nullopt)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto const slotIdx = getSlot(requestId);
+            auto& slot = mSlots[slotIdx];
+            auto const numInline = std::min(numTokens, mSlotCapacity - slot.numTokens);
+            std::copy(tokens, tokens + numInline,
+                mStorage.begin() + static_cast<std::size_t>(slotIdx) * mSlotCapacity + slot.numTokens);
+            slot.numTokens += numInline;
+            if (numInline < numTokens)
+            {
+                slot.overflow.insert(slot.overflow.end(), tokens + numInline, tokens + numTokens);
+                ++mStats.numOverflows;
+            }
+            slot.isFinal = slot.isFinal || isFinal;
+            slot.finishReason = finishReason.has_value() ? finishReason : slot.finishReason;
+            ++slot.numIterations;
+            if (!slot.isReady)
+            {
+                slot.isReady = true;
+                mReadySlots.push_back(slotIdx);
+            }
+            ++mStats.numAppends;
+        }
+        mCondition.notify_one();
+    }
+
+    //! \brief Append the result of a streamed response.
+    //! \return False if the response is not a beam width 1 result, which must be delivered as a full response.
+    bool append(Response const& response)
+    {
+        if (response.hasError())
+        {
+            return false;
+        }
+        auto const& result = response.getResult();
+        if (result.outputTokenIds.size() != 1)
+        {
+            return false;
+        }
+        auto const& tokens = result.outputTokenIds.front();
+        auto const finishReason = result.finishReasons.empty() ? std::nullopt
+                                                                : std::optional<FinishReason>{result.finishReasons[0]};
+        append(response.getRequestId(), tokens.data(), static_cast<SizeType32>(tokens.size()), result.isFinal,
+            finishReason);
+        return true;
+    }
+
+    //! \brief Take the deltas of every request that has new tokens, in the order they became ready. Waits up to
+    //! timeout, or indefinitely if not set, if there are none. Reusing deltas across calls avoids allocating.
+    //! \return The number of deltas.
+    std::size_t poll(std::vector<TokenDelta>& deltas, std::optional<std::chrono::milliseconds> const& timeout)
+    {
+        deltas.clear();
+        std::unique_lock<std::mutex> lock(mMutex);
+        auto const hasReady = [this]() { return !mReadySlots.empty(); };
+        if (timeout.has_value())
+        {
+            mCondition.wait_for(lock, *timeout, hasReady);
+        }
+        else
+        {
+            mCondition.wait(lock, hasReady);
+        }
+        for (auto const slotIdx : mReadySlots)
+        {
+            auto& slot = mSlots[slotIdx];
+            auto& delta = deltas.emplace_back();
+            delta.requestId = slot.requestId;
+            auto const* storage = mStorage.data() + static_cast<std::size_t>(slotIdx) * mSlotCapacity;
+            delta.tokens.assign(storage, storage + slot.numTokens);
+            delta.tokens.append(slot.overflow.data(), slot.overflow.data() + slot.overflow.size());
+            delta.isFinal = slot.isFinal;
+            delta.finishReason = slot.finishReason;
+            delta.numIterations = slot.numIterations;
+            if (slot.isFinal)
+            {
+                mSlotsByRequest.erase(slot.requestId);
+                mFreeSlots.push_back(slotIdx);
+                slot = Slot{};
+            }
+            else
+            {
+                slot.numTokens = 0;
+                slot.overflow.clear();
+                slot.numIterations = 0;
+                slot.isReady = false;
+            }
+        }
+        mStats.numDeltas += static_cast<std::int64_t>(mReadySlots.size());
+        mReadySlots.clear();
+        return deltas.size();
+    }
+
+    [[nodiscard]] Stats getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+private:
+    struct Slot
+    {
+        IdType requestId{0};
+        SizeType32 numTokens{0};
+        std::vector<TokenIdType> overflow;
+        bool isFinal{false};
+        bool isReady{false};
+        std::optional<FinishReason> finishReason{std::nullopt};
+        SizeType32 numIterations{0};
+    };
+
+    [[nodiscard]] SizeType32 getSlot(IdType requestId)
+    {
+        auto const it = mSlotsByRequest.find(requestId);
+        if (it != mSlotsByRequest.end())
+        {
+            return it->second;
+        }
+        if (mFreeSlots.empty())
+        {
+            // More active requests than planned for, grow the storage.
+            mFreeSlots.push_back(static_cast<SizeType32>(mSlots.size()));
+            mSlots.emplace_back();
+            mStorage.resize(mSlots.size() * mSlotCapacity);
+        }
+        auto const slotIdx = mFreeSlots.back();
+        mFreeSlots.pop_back();
+        mSlots[slotIdx].requestId = requestId;
+        mSlotsByRequest.emplace(requestId, slotIdx);
+        return slotIdx;
+    }
+
+    SizeType32 mSlotCapacity;
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<TokenIdType> mStorage;
+    std::vector<Slot> mSlots;
+    std::vector<SizeType32> mFreeSlots;
+    std::vector<SizeType32> mReadySlots;
+    std::unordered_map<IdType, SizeType32> mSlotsByRequest;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::executor
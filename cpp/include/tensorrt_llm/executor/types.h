@@ -629,6 +629,15 @@ public:
         return *this;
     }
 
+    /// @brief Apply the penalties, the bias and the temperature while the top-k sampling kernel reads the logits,
+    /// instead of in a separate pass over them. Only used by TopK sampling without banned tokens, and only while no
+    /// request asks for log probs or min-p, otherwise the decoder falls back to separate passes.
+    auto constexpr useFusedSampling(bool useFusedSampling)
+    {
+        mState = setBitTo(kUseFusedSampling, useFusedSampling);
+        return *this;
+    }
+
     [[nodiscard]] bool constexpr isAuto() const
     {
         return anyBitSet(kAuto);
@@ -759,6 +768,11 @@ public:
         return anyBitSet(kUseMinP);
     }
 
+    bool constexpr isUseFusedSampling() const
+    {
+        return anyBitSet(kUseFusedSampling);
+    }
+
     using UnderlyingType = uint32_t;
 
     bool operator==(DecodingMode const& other) const
@@ -806,6 +820,8 @@ private:
     static UnderlyingType constexpr kExternalDraftTokens{1u << (kNumFlags + 7)};
     static UnderlyingType constexpr kEagle{1u << (kNumFlags + 8)};
     static UnderlyingType constexpr kTopKTopP{kTopK | kTopP};
+    // Placed after the modes, so that the states of the other flags and modes keep their values.
+    static UnderlyingType constexpr kUseFusedSampling{1u << (kNumFlags + 9)};
 
     [[nodiscard]] bool constexpr anyBitSet(UnderlyingType bits) const
     {
@@ -859,6 +875,10 @@ static_assert(!DecodingMode::TopK().isLookahead());
 static_assert(!DecodingMode::TopK().isExplicitDraftTokens());
 static_assert(!DecodingMode::TopK().isExternalDraftTokens());
 static_assert(!DecodingMode::TopK().isEagle());
+static_assert(!DecodingMode::TopK().isUseFusedSampling());
+static_assert(DecodingMode::TopK().useFusedSampling(true).isUseFusedSampling());
+static_assert(DecodingMode::TopK().useFusedSampling(true).isTopK());
+static_assert(!DecodingMode::TopK().useFusedSampling(true).isTopP());
 
 static_assert(DecodingMode::TopP().isTopP());
 static_assert(DecodingMode::TopP().isTopKorTopP());
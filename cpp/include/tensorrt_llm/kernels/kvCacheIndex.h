@@ -33,15 +33,31 @@ public:
     static constexpr UnderlyingType kSecondaryPoolFlag = static_cast<UnderlyingType>(1)
         << (8 * sizeof(UnderlyingType) - 1);
 
+    // Flag indicating KVCacheIndex refers to the disk tier. Tertiary indices also carry kSecondaryPoolFlag so that they
+    // are never mistaken for primary blocks.
+    static constexpr UnderlyingType kTertiaryPoolFlag = static_cast<UnderlyingType>(1)
+        << (8 * sizeof(UnderlyingType) - 2);
+
     explicit KVCacheIndex(UnderlyingType value, bool isSecondary = false)
         : value{isSecondary ? value | kSecondaryPoolFlag : value}
     {
         TLLM_CHECK_DEBUG(value >= 0);
     }
 
+    [[nodiscard]] static KVCacheIndex tertiary(UnderlyingType value)
+    {
+        TLLM_CHECK_DEBUG(value >= 0 && value < kTertiaryPoolFlag);
+        return KVCacheIndex{value | kTertiaryPoolFlag, true};
+    }
+
     __host__ __device__ [[nodiscard]] UnderlyingType get() const
     {
-        return value & (~kSecondaryPoolFlag);
+        return value & (~(kSecondaryPoolFlag | kTertiaryPoolFlag));
+    }
+
+    __host__ __device__ [[nodiscard]] bool isTertiary() const
+    {
+        return (value & kTertiaryPoolFlag) != 0;
     }
 
     __host__ __device__ [[nodiscard]] bool isPrimary() const
@@ -119,6 +119,11 @@ public:
     {
         return 0.0f;
     }
+
+    [[nodiscard]] __host__ __device__ static constexpr float getTypicalP()
+    {
+        return 1.0f;
+    }
 };
 } // namespace layers
 } // namespace tensorrt_llm
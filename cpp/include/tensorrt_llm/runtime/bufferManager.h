@@ -35,6 +35,7 @@ namespace tensorrt_llm::runtime
 
 /// @brief Forward declaration as only used through pointer.
 class CudaMemPool;
+class ScratchArena;
 
 //! \brief A helper class for managing memory on host and device.
 class BufferManager
@@ -46,6 +47,7 @@ public:
 
     using CudaStreamPtr = std::shared_ptr<CudaStream>;
     using CudaMemPoolPtr = std::shared_ptr<CudaMemPool>;
+    using ScratchArenaPtr = std::shared_ptr<ScratchArena>;
 
     //! \brief Construct a BufferManager.
     //!
@@ -70,6 +72,27 @@ public:
     //! \brief Allocates an `ITensor` of the given dimensions on the GPU, using cudaMallocAsync.
     [[nodiscard]] ITensorPtr gpu(nvinfer1::Dims dims, nvinfer1::DataType type = kBYTE_TYPE) const;
 
+    //! \brief Allocates an `IBuffer` of the given size on the GPU in the scratch arena of the manager, shared by its
+    //! copies. The buffer is valid until the next `resetScratch` and must only be used on the stream of the manager.
+    //! Falls back to `gpu` when the arena is full, and the arena grows to the size of the step at the next reset.
+    [[nodiscard]] IBufferPtr scratch(std::size_t size, nvinfer1::DataType type = kBYTE_TYPE) const;
+
+    //! \brief Allocates an `ITensor` of the given dimensions on the GPU in the scratch arena of the manager.
+    [[nodiscard]] ITensorPtr scratch(nvinfer1::Dims dims, nvinfer1::DataType type = kBYTE_TYPE) const;
+
+    //! \brief Releases all the scratch buffers, at the end of a step. The buffers of the step must not be used
+    //! afterwards, except by the work already enqueued on the stream.
+    void resetScratch() const;
+
+    //! \brief Grows the scratch arena to at least `size` bytes, which must be done when no scratch buffer is in use.
+    void reserveScratch(std::size_t size) const;
+
+    //! \brief The size of the slab of the scratch arena.
+    [[nodiscard]] std::size_t scratchCapacity() const;
+
+    //! \brief The number of bytes of the scratch arena in use since the last reset.
+    [[nodiscard]] std::size_t scratchUsed() const;
+
     //! \brief Allocates an `IBuffer` of the given size on the GPU, using cudaMalloc.
     [[nodiscard]] static IBufferPtr gpuSync(std::size_t size, nvinfer1::DataType type = kBYTE_TYPE);
 
@@ -205,6 +228,7 @@ private:
 
     CudaStreamPtr mStream;
     CudaMemPoolPtr mPool;
+    ScratchArenaPtr mScratch;
     bool const mTrimPool;
 };
 
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/iBuffer.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <NvInferRuntime.h>
+#include <cuda_runtime.h>
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief What a device logits processor gets for the requests that use it in a decoding step. All the pointers are
+//! device pointers, valid for the launch only.
+struct DeviceLogitsProcessorParams
+{
+    //! \brief Logits of the step [numRows, vocabSizePadded] of logitsType, modified in place.
+    void* logits{nullptr};
+    nvinfer1::DataType logitsType{nvinfer1::DataType::kFLOAT};
+    //! \brief Row of the first beam of every request [numRequests], the beams are the next rows.
+    SizeType32 const* rowOffsets{nullptr};
+    //! \brief Batch slot of every request [numRequests].
+    SizeType32 const* batchSlots{nullptr};
+    //! \brief State of every request [numRequests], stateSize bytes the processor may read and write.
+    void* const* states{nullptr};
+    //! \brief Sequence lengths by batch slot [maxNumSequences], null if the decoder did not provide them.
+    SizeType32 const* sequenceLengths{nullptr};
+    SizeType32 numRequests{0};
+    SizeType32 beamWidth{1};
+    SizeType32 vocabSize{0};
+    SizeType32 vocabSizePadded{0};
+};
+
+//! \brief Enqueues the kernels of a processor on the decoder stream. It must not synchronize the stream.
+using DeviceLogitsProcessorLauncher = void (*)(DeviceLogitsProcessorParams const& params, cudaStream_t stream);
+
+//! \brief Device side alternative to the executor::LogitsPostProcessor callbacks, which get host tensors and
+//! synchronize the decoder stream at every step. Processors are registered by name with the size of their
+//! per-request state, e.g. at the load of a user library, and requests select one by name with its initial state.
+class DeviceLogitsProcessorRegistry
+{
+public:
+    struct Processor
+    {
+        DeviceLogitsProcessorLauncher launcher{nullptr};
+        std::size_t stateSize{0};
+    };
+
+    static DeviceLogitsProcessorRegistry& getInstance();
+
+    void registerProcessor(std::string const& name, DeviceLogitsProcessorLauncher launcher, std::size_t stateSize);
+
+    [[nodiscard]] std::optional<Processor> getProcessor(std::string const& name) const;
+
+    //! \brief Built-in processor adding a bias to some tokens, with kernels::TokenBiasLogitsProcessorState as state.
+    static constexpr char const* kTokenBias = "token_bias";
+
+private:
+    DeviceLogitsProcessorRegistry();
+
+    mutable std::mutex mMutex;
+    std::unordered_map<std::string, Processor> mProcessors;
+};
+
+//! \brief The device logits processors of the requests of a decoder, by batch slot.
+//! \details run groups the requests of a step by processor and launches every processor once for its requests, on the
+//! decoder stream. The request arrays of the launches are staged in pinned memory and copied asynchronously, so that
+//! nothing waits for the device as long as the steps do not get more than kNumStagingBuffers ahead of it.
+class DeviceLogitsProcessorBatch
+{
+public:
+    explicit DeviceLogitsProcessorBatch(SizeType32 maxNumSequences);
+
+    //! \brief Select the processor of a batch slot and copy its initial state, stateSize bytes of host memory, to the
+    //! device on the stream of bufferManager. hostState is read before the call returns.
+    void setRequest(SizeType32 batchSlot, std::string const& processorName, void const* hostState,
+        BufferManager const& bufferManager);
+
+    void clearRequest(SizeType32 batchSlot);
+
+    [[nodiscard]] bool hasRequest(SizeType32 batchSlot) const;
+
+    //! \brief Device state of a batch slot, e.g. for another kernel to update it.
+    [[nodiscard]] void* getState(SizeType32 batchSlot) const;
+
+    //! \brief Run the processors of the requests of batchSlots on their rows of logits [numRows, vocabSizePadded].
+    //! Requests without processor are skipped.
+    void run(ITensor& logits, std::vector<SizeType32> const& batchSlots, std::vector<SizeType32> const& rowOffsets,
+        SizeType32 beamWidth, SizeType32 vocabSize, ITensor const* sequenceLengths,
+        BufferManager const& bufferManager);
+
+    static constexpr std::size_t kNumStagingBuffers = 2;
+
+private:
+    struct SlotProcessor
+    {
+        std::string name;
+        DeviceLogitsProcessorLauncher launcher{nullptr};
+        IBuffer::SharedPtr state;
+    };
+
+    struct StagingBuffer
+    {
+        IBuffer::SharedPtr host;
+        IBuffer::SharedPtr device;
+        CudaEvent copied{};
+        bool pending{false};
+    };
+
+    SizeType32 mMaxNumSequences;
+    std::vector<std::optional<SlotProcessor>> mSlots;
+    std::array<StagingBuffer, kNumStagingBuffers> mStaging;
+    std::size_t mNextStaging{0};
+};
+
+} // namespace tensorrt_llm::runtime
@@ -34,6 +34,8 @@ class LlmRequest;
 
 namespace tensorrt_llm::runtime
 {
+class CudaGraphBuckets;
+class CudaGraphCache;
 
 //! GPT decoder class with support for in-flight batching
 class GptDecoderBatched : public IGptDecoderBatched
@@ -145,6 +147,35 @@ public:
     //! @brief Gather final beam search results for all requests.
     void finalize(SamplingConfig const& samplingConfig) const override;
 
+    //! @brief Gather final beam search results for all the requests finishing in an iteration at once, and copy them
+    //! to the pinned finalized beams buffers, where row `i` holds request `batchSlots[i]`. Nothing is synchronized with
+    //! the host and every kernel is launched once for all the requests. Not for streaming requests, whose beams are
+    //! still searched: the gathered buffers are written in place.
+    //! Result will only be available after event returned, and until the next call.
+    [[nodiscard]] CudaEvent finalize(
+        std::vector<SizeType32> const& batchSlots, std::vector<SamplingConfig> const& samplingConfigs) const;
+
+    //! @returns [maxBatchSize, maxBeamWidth, maxSequenceLength], gathered token ids of the requests of the last batched
+    //! finalize, only the tokens of each beam are written, in pinned host memory
+    [[nodiscard]] TensorPtr getFinalizedIds() const
+    {
+        return mFinalizedIds;
+    }
+
+    //! @returns [maxBatchSize, maxBeamWidth], sequence lengths of the requests of the last batched finalize, in pinned
+    //! host memory
+    [[nodiscard]] TensorPtr getFinalizedSequenceLengths() const
+    {
+        return mFinalizedSequenceLengths;
+    }
+
+    //! @returns [maxBatchSize, maxBeamWidth], cumulative log probabilities of the requests of the last batched
+    //! finalize, in pinned host memory
+    [[nodiscard]] TensorPtr getFinalizedCumLogProbs() const
+    {
+        return mFinalizedCumLogProbs;
+    }
+
     //! @returns [batchSize, maxBeamWidth, maxInputLength + maxNewTokens], contains parent ids collected during beam
     //! search without padding, on gpu
     [[nodiscard]] TensorPtr getParentIds() const override
@@ -259,6 +290,16 @@ public:
         return mDecoderStream;
     }
 
+    //! @brief Leave the decoding of forwardAsync on the decoder stream instead of joining it back to the runtime
+    //! stream, so that the engine step of another batch enqueued on the runtime stream right after runs concurrently
+    //! with it. The users of the outputs on another stream wait for the decoder stream first.
+    void setOverlapWithEngine(bool overlapWithEngine);
+
+    [[nodiscard]] bool getOverlapWithEngine() const
+    {
+        return mOverlapWithEngine;
+    }
+
     SpeculativeDecodingMode getSpeculativeDecodingMode() const
     {
         return mSpeculativeDecodingMode;
@@ -388,5 +429,26 @@ private:
     // will store a slice of DecodingOutput::cumLogProbs
     DecodingOutput::TensorPtr mCumLogProbsTmp;
     SizeType32 mNumSMs;
+
+    // CUDA graphs of the decoding layers, one per bucket of the decoder batch size, set when
+    // TRTLLM_DECODER_CUDA_GRAPH is enabled.
+    std::shared_ptr<CudaGraphBuckets> mDecoderGraphBuckets;
+    std::shared_ptr<CudaGraphCache> mDecoderGraphs;
+    // Whether a bucket already ran eagerly, which lets the layers allocate their workspaces outside of a capture.
+    std::vector<bool> mDecoderGraphWarm;
+
+    // Parameters of the requests of a batched finalize, read by the device, and its outputs written by the device.
+    // Allocated for beam search.
+    TensorPtr mFinalizeBatchSlots;       // [maxBatchSize], int32_t, pinned
+    TensorPtr mFinalizeLengthPenalties;  // [maxBatchSize], float, pinned
+    TensorPtr mFinalizeBeamWidths;       // [maxBatchSize], int32_t, pinned
+    TensorPtr mFinalizedIds;             // [maxBatchSize, maxBeamWidth, maxSequenceLength], int32_t, pinned
+    TensorPtr mFinalizedSequenceLengths; // [maxBatchSize, maxBeamWidth], int32_t, pinned
+    TensorPtr mFinalizedCumLogProbs;     // [maxBatchSize, maxBeamWidth], float, pinned
+    // Recorded after a batched finalize, the parameters of the next one are written once it has read them.
+    CudaEvent mFinalizeEvent;
+
+    // Whether forwardAsync leaves the decoding on mDecoderStream, the events of the decoding are recorded on it too.
+    bool mOverlapWithEngine{false};
 };
 } // namespace tensorrt_llm::runtime
@@ -283,6 +283,10 @@ private:
     //! @brief Execute decoder on last PP rank, receive decoder output on other PP ranks.
     void decoderStepAsync(SizeType32 decoderStep, SizeType32 microBatchId);
 
+    //! @brief Make the runtime stream wait for the outputs of the last decoder step of the micro batch, which runs on
+    //! the stream of its decoder when the decoding of the micro batches overlaps the engine.
+    void waitForDecoderStep(SizeType32 microBatchId);
+
     //! @brief Synchronize with the decoder and return the `shouldStop` flag.
     bool shouldStopSync(SizeType32 batchSize, SizeType32 beamWidth, SizeType32 microBatchId);
 
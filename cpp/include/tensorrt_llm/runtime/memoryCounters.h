@@ -59,6 +59,57 @@ public:
         return mPinnedPool;
     }
 
+    //! \brief Bytes of pinned memory held by the size-class pinned pool, in use or not.
+    [[nodiscard]] SizeType32 getPinnedPoolReserved() const
+    {
+        return mPinnedPoolReserved;
+    }
+
+    //! \brief High-water mark of getPinnedPool().
+    [[nodiscard]] SizeType32 getPinnedPoolPeak() const
+    {
+        return mPinnedPoolPeak;
+    }
+
+    //! \brief High-water marks of the counters since the start or the last resetPeaks().
+    [[nodiscard]] SizeType32 getGpuPeak() const
+    {
+        return mGpuPeak;
+    }
+
+    [[nodiscard]] SizeType32 getCpuPeak() const
+    {
+        return mCpuPeak;
+    }
+
+    [[nodiscard]] SizeType32 getPinnedPeak() const
+    {
+        return mPinnedPeak;
+    }
+
+    [[nodiscard]] SizeType32 getUVMPeak() const
+    {
+        return mUVMPeak;
+    }
+
+    //! \brief Restarts the high-water marks from the current usage, e.g. after the warmup of a benchmark.
+    void resetPeaks()
+    {
+        mGpuPeak = mGpu.load();
+        mCpuPeak = mCpu.load();
+        mPinnedPeak = mPinned.load();
+        mUVMPeak = mUVM.load();
+        mPinnedPoolPeak = mPinnedPool.load();
+    }
+
+    //! \brief Bytes reserved by the pinned pool that no allocation uses, idle blocks and size-class rounding.
+    [[nodiscard]] SizeType32 getPinnedPoolFragmentation() const
+    {
+        SizeType32 const reserved = mPinnedPoolReserved;
+        SizeType32 const used = mPinnedPool;
+        return reserved > used ? reserved - used : 0;
+    }
+
     [[nodiscard]] DiffType getGpuDiff() const
     {
         return mGpuDiff;
@@ -90,27 +141,27 @@ public:
         auto const sizeDiff = static_cast<DiffType>(size);
         if constexpr (T == MemoryType::kGPU)
         {
-            mGpu += size;
+            updatePeak(mGpuPeak, mGpu += size);
             mGpuDiff = sizeDiff;
         }
         else if constexpr (T == MemoryType::kCPU)
         {
-            mCpu += size;
+            updatePeak(mCpuPeak, mCpu += size);
             mCpuDiff = sizeDiff;
         }
         else if constexpr (T == MemoryType::kPINNED)
         {
-            mPinned += size;
+            updatePeak(mPinnedPeak, mPinned += size);
             mPinnedDiff = sizeDiff;
         }
         else if constexpr (T == MemoryType::kUVM)
         {
-            mUVM += size;
+            updatePeak(mUVMPeak, mUVM += size);
             mUVMDiff = sizeDiff;
         }
         else if constexpr (T == MemoryType::kPINNEDPOOL)
         {
-            mPinnedPool += size;
+            updatePeak(mPinnedPoolPeak, mPinnedPool += size);
             mPinnedPoolDiff = sizeDiff;
         }
         else
@@ -158,6 +209,16 @@ public:
 
     void deallocate(MemoryType memoryType, SizeType32 size);
 
+    void reservePinnedPool(SizeType32 size)
+    {
+        mPinnedPoolReserved += size;
+    }
+
+    void releasePinnedPool(SizeType32 size)
+    {
+        mPinnedPoolReserved -= size;
+    }
+
     static MemoryCounters& getInstance();
 
     static std::string bytesToString(SizeType32 bytes, int precision = 2);
@@ -167,8 +228,18 @@ public:
     [[nodiscard]] std::string toString() const;
 
 private:
+    static void updatePeak(std::atomic<SizeType32>& peak, SizeType32 used)
+    {
+        auto current = peak.load();
+        while (current < used && !peak.compare_exchange_weak(current, used))
+        {
+        }
+    }
+
     std::atomic<SizeType32> mGpu{}, mCpu{}, mPinned{}, mUVM{}, mPinnedPool{};
+    std::atomic<SizeType32> mPinnedPoolReserved{}, mPinnedPoolPeak{};
     std::atomic<DiffType> mGpuDiff{}, mCpuDiff{}, mPinnedDiff{}, mUVMDiff{}, mPinnedPoolDiff{};
+    std::atomic<SizeType32> mGpuPeak{}, mCpuPeak{}, mPinnedPeak{}, mUVMPeak{};
 };
 
 } // namespace tensorrt_llm::runtime
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Device copies of the prompt embedding tables of the requests, e.g. the vision embeddings of multimodal
+//! requests, shared by the requests whose tables have the same content.
+//! \details A table is identified by the hashes of its rows. The rows are the embeddings of the prompt tokens at and
+//! above the vocabulary size, so the row hash is also a stable extra id of such a token: two requests with the same
+//! image get the same BlockKey for its tokens and reuse the KV cache of the other, where the fake token ids alone
+//! would make them differ or collide. The tables stay on the device after their requests finish, the least recently
+//! used tables no request holds being released beyond the capacity. The cache is thread safe.
+class PromptEmbeddingCache
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+    using HashType = std::uint64_t;
+
+    struct Stats
+    {
+        std::size_t numHits{0};
+        std::size_t numMisses{0};
+        std::size_t numEvictions{0};
+        std::size_t usedBytes{0};
+    };
+
+    //! \brief Hashes of the rows of a host table [..., hiddenSize], never 0, which is the extra id of the plain tokens.
+    [[nodiscard]] static std::vector<HashType> hashRows(ITensor const& table);
+
+    //! \brief Hash of a table from the hashes of its rows.
+    [[nodiscard]] static HashType hashTable(std::vector<HashType> const& rowHashes);
+
+    //! \brief Extra ids of the input tokens: the hash of their embedding row for the prompt tuning tokens, which are
+    //! vocabSize + row, and 0 for the others.
+    [[nodiscard]] static VecTokenExtraIds makeExtraIds(
+        std::vector<TokenIdType> const& inputTokens, SizeType32 vocabSize, std::vector<HashType> const& rowHashes);
+
+    PromptEmbeddingCache(std::size_t maxBytes, BufferManager bufferManager);
+
+    //! \brief Device copy of a host table, uploaded on the stream of the buffer manager unless a table of the same
+    //! content is cached. The table can be released by the cache once the returned tensor is destroyed.
+    [[nodiscard]] TensorPtr acquire(ITensor const& hostTable, std::vector<HashType> const& rowHashes);
+
+    [[nodiscard]] TensorPtr acquire(ITensor const& hostTable)
+    {
+        return acquire(hostTable, hashRows(hostTable));
+    }
+
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    struct Entry
+    {
+        HashType hash;
+        TensorPtr table;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    //! \brief Release the least recently used tables nobody holds until the cache fits in its capacity.
+    void evict();
+
+    std::size_t mMaxBytes;
+    BufferManager mBufferManager;
+
+    mutable std::mutex mMutex;
+    // Most recently used first.
+    EntryList mEntries;
+    std::unordered_map<HashType, EntryList::iterator> mIndex;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::runtime
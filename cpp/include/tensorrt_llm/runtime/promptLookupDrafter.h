@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Draft tokens of SpeculativeDecodingMode::PromptLookup for one sequence.
+//! \details Proposes the tokens that followed the most recent earlier occurrence of the longest suffix of the sequence
+//! that appeared before, with suffixes of minNgramSize to maxNgramSize tokens. The drafts are verified like external
+//! draft tokens, so no draft model is needed; they are accepted often when the output copies spans of the context, as
+//! for code editing or retrieval-augmented generation. The prompt is indexed once at context and every accepted token
+//! once afterwards, so a proposal costs maxNgramSize hash lookups independently of the length of the sequence.
+class PromptLookupDrafter
+{
+public:
+    using VecTokens = std::vector<TokenIdType>;
+
+    PromptLookupDrafter(SizeType32 maxDraftLen, SizeType32 maxNgramSize = 3, SizeType32 minNgramSize = 1);
+
+    //! \brief Index the tokens that were appended to the sequence since the last call. tokens is the complete
+    //! sequence, prompt included, and must start with the tokens seen before.
+    void update(VecTokens const& tokens);
+
+    //! \brief Draft tokens continuing tokens, up to maxDraftLen. Empty if no suffix of the sequence appeared before.
+    //! Calls update first.
+    [[nodiscard]] VecTokens propose(VecTokens const& tokens);
+
+    //! \brief Number of tokens that were indexed.
+    [[nodiscard]] SizeType32 getNumIndexedTokens() const
+    {
+        return mNumIndexed;
+    }
+
+private:
+    [[nodiscard]] static std::uint64_t hashNgram(TokenIdType const* begin, SizeType32 ngramSize);
+
+    SizeType32 mMaxDraftLen;
+    SizeType32 mMaxNgramSize;
+    SizeType32 mMinNgramSize;
+    SizeType32 mNumIndexed{0};
+    // Hash of an n-gram to the position of the token that followed its most recent occurrence.
+    std::unordered_map<std::uint64_t, SizeType32> mContinuations;
+};
+
+} // namespace tensorrt_llm::runtime
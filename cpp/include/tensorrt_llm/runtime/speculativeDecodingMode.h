@@ -55,6 +55,20 @@ public:
         return SpeculativeDecodingMode{kEagle};
     }
 
+    //! Draft tokens copied from the prompt and the output by PromptLookupDrafter. The engine and the acceptance are the
+    //! same as for DraftTokensExternal, without a draft model.
+    static auto constexpr PromptLookup()
+    {
+        return SpeculativeDecodingMode{kDraftTokensExternal | kPromptLookup};
+    }
+
+    //! Draft tokens predicted by the multi-token-prediction modules of the model, chained after the main forward and
+    //! sharing its KV cache. The buffers, the engine IOs and the acceptance are the ones of Eagle, with a chain tree.
+    static auto constexpr Mtp()
+    {
+        return SpeculativeDecodingMode{kEagle | kMtp};
+    }
+
     [[nodiscard]] bool constexpr isNone() const
     {
         return anyBitSet(kNone);
@@ -85,6 +99,16 @@ public:
         return anyBitSet(kEagle);
     }
 
+    [[nodiscard]] bool constexpr isPromptLookup() const
+    {
+        return anyBitSet(kPromptLookup);
+    }
+
+    [[nodiscard]] bool constexpr isMtp() const
+    {
+        return anyBitSet(kMtp);
+    }
+
     [[nodiscard]] bool constexpr updatesPositionIds() const
     {
         return anyBitSet(kLookaheadDecoding | kExplicitDraftTokens);
@@ -140,6 +164,8 @@ private:
     static UnderlyingType constexpr kLookaheadDecoding{1U << 3U};
     static UnderlyingType constexpr kExplicitDraftTokens{1U << 4U};
     static UnderlyingType constexpr kEagle{1U << 5U};
+    static UnderlyingType constexpr kPromptLookup{1U << 6U};
+    static UnderlyingType constexpr kMtp{1U << 7U};
 
     [[nodiscard]] bool constexpr anyBitSet(UnderlyingType bits) const
     {
@@ -191,4 +217,17 @@ static_assert(!SpeculativeDecodingMode::Eagle().isMedusa());
 static_assert(!SpeculativeDecodingMode::Eagle().isExplicitDraftTokens());
 static_assert(!SpeculativeDecodingMode::Eagle().isLookaheadDecoding());
 
+static_assert(SpeculativeDecodingMode::PromptLookup().isPromptLookup());
+static_assert(SpeculativeDecodingMode::PromptLookup().isDraftTokensExternal());
+static_assert(!SpeculativeDecodingMode::PromptLookup().isNone());
+static_assert(!SpeculativeDecodingMode::PromptLookup().predictsDraftTokens());
+static_assert(!SpeculativeDecodingMode::DraftTokensExternal().isPromptLookup());
+
+static_assert(SpeculativeDecodingMode::Mtp().isMtp());
+static_assert(SpeculativeDecodingMode::Mtp().isEagle());
+static_assert(SpeculativeDecodingMode::Mtp().predictsDraftTokens());
+static_assert(!SpeculativeDecodingMode::Mtp().isNone());
+static_assert(!SpeculativeDecodingMode::Mtp().isDraftTokensExternal());
+static_assert(!SpeculativeDecodingMode::Eagle().isMtp());
+
 } // namespace tensorrt_llm::runtime
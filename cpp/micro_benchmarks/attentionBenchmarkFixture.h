@@ -0,0 +1,495 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include "tensorrt_llm/common/attentionOp.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+#include "tensorrt_llm/common/quantization.h"
+#include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention.h"
+#include "tensorrt_llm/kernels/kvCacheUtils.h"
+#include "tensorrt_llm/kernels/mlaKernels.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+
+#include <algorithm>
+#include <cuda.h>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace tensorrt_llm::kernels;
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::runtime;
+
+using tensorrt_llm::common::op::AttentionOp;
+
+static BufferManager::CudaStreamPtr streamPtr;
+static std::unique_ptr<BufferManager> bufferManager;
+static int deviceCount;
+
+/**
+ * Benchmarks AttentionOp on a synthetic paged KV cache, as the GPT attention plugin runs it: the generation phase
+ * (MMHA or XQA), the context phase (context FMHA or the unfused kernels) and the MLA generation. The label of each
+ * run is the dispatcher path the op took, see AttentionOp::KernelPath.
+ */
+template <class T>
+class AttentionBenchmark : public benchmark::Fixture
+{
+public:
+    enum class Phase
+    {
+        GENERATION = 0,
+        CONTEXT = 1,
+        MLA_GENERATION = 2
+    };
+
+    //! The KV lengths of the requests, up to the max sequence length.
+    enum class SeqLenDist
+    {
+        //! All requests at the max sequence length
+        UNIFORM = 0,
+        //! Uniformly random between an eighth of the max sequence length and the max sequence length
+        RANDOM = 1,
+        //! One request at the max sequence length, the others at a sixteenth of it
+        LONG_TAIL = 2
+    };
+
+    enum class KvCacheType
+    {
+        ACTIVATION = 0,
+        INT8 = 1,
+        FP8 = 2
+    };
+
+    static constexpr int kTokensPerBlock = 64;
+    // The MLA of DeepSeek-V2 and V3, the only MLA dims AttentionOp supports
+    static constexpr int kMlaQLoraRank = 1536;
+    static constexpr int kMlaKvLoraRank = 512;
+    static constexpr int kMlaQkNopeHeadDim = 128;
+    static constexpr int kMlaQkRopeHeadDim = 64;
+    static constexpr int kMlaVHeadDim = 128;
+
+    void SetUp(benchmark::State& s) override
+    {
+        assert(bufferManager);
+        check_cuda_error(cudaDeviceSynchronize());
+        check_cuda_error(cudaEventCreate(&mStartEvent));
+        check_cuda_error(cudaEventCreate(&mEndEvent));
+    }
+
+    void TearDown(benchmark::State& s) override
+    {
+        mOp.reset();
+        managed_buffers.clear();
+
+        check_cuda_error(cudaEventDestroy(mStartEvent));
+        check_cuda_error(cudaEventDestroy(mEndEvent));
+        check_cuda_error(cudaDeviceSynchronize());
+    }
+
+    cudaEvent_t mStartEvent, mEndEvent;
+    std::vector<BufferManager::IBufferPtr> managed_buffers;
+
+    std::unique_ptr<AttentionOp> mOp;
+    Phase mPhase{};
+    std::vector<int32_t> mSeqLengths;
+    std::vector<int32_t> mContextLengths;
+    std::vector<KVBlockArray::DataType> mHostBlockOffsets;
+    int32_t mMaxSeqLength{};
+    int32_t mMaxBlocksPerSeq{};
+    int64_t mNumTokens{};
+
+    AttentionOp::EnqueueContextParams<T> mContextParams;
+    AttentionOp::EnqueueGenerationParams<T> mGenerationParams;
+    mlaParams<T> mMlaParams{};
+
+    template <class U>
+    U* allocBuffer(size_t size)
+    {
+        managed_buffers.emplace_back(bufferManager->gpu(size * sizeof(U)));
+        U* ptr = static_cast<U*>(managed_buffers.back()->data());
+        check_cuda_error(cudaMemsetAsync(ptr, 0x0, size * sizeof(U), streamPtr->get()));
+        return ptr;
+    }
+
+    template <class U>
+    U* allocFromHost(std::vector<U> const& host)
+    {
+        U* ptr = allocBuffer<U>(host.size());
+        check_cuda_error(
+            cudaMemcpyAsync(ptr, host.data(), host.size() * sizeof(U), cudaMemcpyHostToDevice, streamPtr->get()));
+        return ptr;
+    }
+
+    static size_t getKvElemSize(KvCacheType kv_type)
+    {
+        return kv_type == KvCacheType::ACTIVATION ? sizeof(T) : 1;
+    }
+
+    void initSeqLengths(int batch_size, int max_seq_length, SeqLenDist dist)
+    {
+        std::mt19937 gen(0xA7);
+        std::uniform_int_distribution<int32_t> random_length(std::max(1, max_seq_length / 8), max_seq_length);
+        mSeqLengths.resize(batch_size);
+        for (int bi = 0; bi < batch_size; bi++)
+        {
+            switch (dist)
+            {
+            case SeqLenDist::UNIFORM: mSeqLengths[bi] = max_seq_length; break;
+            case SeqLenDist::RANDOM: mSeqLengths[bi] = random_length(gen); break;
+            case SeqLenDist::LONG_TAIL:
+                mSeqLengths[bi] = bi == 0 ? max_seq_length : std::max(1, max_seq_length / 16);
+                break;
+            }
+        }
+        mMaxSeqLength = max_seq_length;
+        mMaxBlocksPerSeq = (max_seq_length + kTokensPerBlock - 1) / kTokensPerBlock;
+    }
+
+    //! The bytes of the KV pool, its blocks are handed out to the requests in random order, like a fragmented cache.
+    size_t getKvPoolSize(size_t bytes_per_block) const
+    {
+        size_t num_blocks = 0;
+        for (auto const seq_length : mSeqLengths)
+        {
+            num_blocks += (seq_length + kTokensPerBlock - 1) / kTokensPerBlock;
+        }
+        return num_blocks * 2 * bytes_per_block;
+    }
+
+    void* initKvPool(size_t bytes_per_block)
+    {
+        int32_t num_blocks = getKvPoolSize(bytes_per_block) / (2 * bytes_per_block);
+        std::vector<int32_t> block_ids(num_blocks);
+        std::iota(block_ids.begin(), block_ids.end(), 0);
+        std::shuffle(block_ids.begin(), block_ids.end(), std::mt19937(0xA7));
+
+        int const batch_size = mSeqLengths.size();
+        mHostBlockOffsets.assign(batch_size * 2 * mMaxBlocksPerSeq, KVBlockArray::DataType{0});
+        int32_t next_block = 0;
+        for (int bi = 0; bi < batch_size; bi++)
+        {
+            int32_t const num_seq_blocks = (mSeqLengths[bi] + kTokensPerBlock - 1) / kTokensPerBlock;
+            for (int32_t block = 0; block < num_seq_blocks; block++)
+            {
+                // The K and V blocks of a block id are adjacent in the pool of one layer
+                auto const block_id = block_ids[next_block++];
+                mHostBlockOffsets[(bi * 2) * mMaxBlocksPerSeq + block] = KVBlockArray::DataType{2 * block_id};
+                mHostBlockOffsets[(bi * 2 + 1) * mMaxBlocksPerSeq + block] = KVBlockArray::DataType{2 * block_id + 1};
+            }
+        }
+        return allocBuffer<int8_t>(getKvPoolSize(bytes_per_block));
+    }
+
+    void initOp(int num_heads, int num_kv_heads, int head_size, KvCacheType kv_type, bool multi_block)
+    {
+        mOp = std::make_unique<AttentionOp>();
+        mOp->mType = TRTDataType<T>::value;
+        mOp->mFMHAForceFP32Acc = mOp->mType == nvinfer1::DataType::kBF16;
+        mOp->mLayerIdx = 0;
+        mOp->mLayerIdxInCachePool = 0;
+        mOp->mNumHeads = num_heads;
+        mOp->mNumKVHeads = num_kv_heads;
+        mOp->mHeadSize = head_size;
+        mOp->mMaskType = AttentionMaskType::CAUSAL;
+        mOp->mTokensPerBlock = kTokensPerBlock;
+        mOp->mMaxContextLength = mMaxSeqLength;
+        mOp->mMultiBlockMode = multi_block;
+        mOp->mKVCacheQuantMode = kv_type == KvCacheType::INT8 ? QuantMode::int8KvCache()
+            : kv_type == KvCacheType::FP8                     ? QuantMode::fp8KvCache()
+                                                              : QuantMode{};
+        if (mPhase == Phase::MLA_GENERATION)
+        {
+            mOp->mIsMLAEnabled = true;
+            mOp->mMLAParams = mlaMetaParams{kMlaQLoraRank, kMlaKvLoraRank, kMlaQkNopeHeadDim, kMlaQkRopeHeadDim,
+                kMlaVHeadDim};
+        }
+        mOp->initialize();
+
+        if (mPhase == Phase::GENERATION)
+        {
+            int const batch_size = mSeqLengths.size();
+            AttentionOp::EnqueueGenerationParams<T> prepare_params;
+            prepare_params.beam_width = 1;
+            prepare_params.max_attention_window = mMaxSeqLength;
+            prepare_params.cyclic_attention_window_size = mMaxSeqLength;
+            prepare_params.max_cyclic_attention_window_size = mMaxSeqLength;
+            prepare_params.num_requests = batch_size;
+            mOp->prepareEnqueueGeneration<T, KVBlockArray>(prepare_params);
+            // MMHA may enable the multi-block mode when the shared memory is not enough, as in the attention op
+            mOp->reserveSemaphoreArray(num_heads * batch_size);
+        }
+    }
+
+    void initBuffers(int num_heads, int num_kv_heads, int head_size, KvCacheType kv_type)
+    {
+        int const batch_size = mSeqLengths.size();
+        bool const context = mPhase == Phase::CONTEXT;
+        // One new token per request in the generation, the whole sequence in the context
+        mNumTokens = context ? std::accumulate(mSeqLengths.begin(), mSeqLengths.end(), int64_t{0}) : batch_size;
+        mContextLengths = mSeqLengths;
+        if (!context)
+        {
+            for (auto& context_length : mContextLengths)
+            {
+                context_length = std::max(1, context_length - 1);
+            }
+        }
+
+        auto const bytes_per_block = mPhase == Phase::MLA_GENERATION
+            ? static_cast<size_t>(kTokensPerBlock) * (kMlaKvLoraRank + kMlaQkRopeHeadDim) * sizeof(T)
+            : static_cast<size_t>(kTokensPerBlock) * num_kv_heads * head_size * getKvElemSize(kv_type);
+        void* kv_pool = initKvPool(bytes_per_block);
+        auto* block_offsets = allocFromHost(mHostBlockOffsets);
+        auto* seq_lengths = allocFromHost(mSeqLengths);
+        auto* context_lengths = allocFromHost(mContextLengths);
+        auto* kv_scales = allocFromHost(std::vector<float>(1, 1.f));
+
+        auto const workspace_size = std::max(mOp->getWorkspaceSizeForContext(mOp->mType, batch_size, mMaxSeqLength, 0,
+                                                 context ? mNumTokens : 0),
+            mOp->getWorkspaceSizeForGeneration(mOp->mType, batch_size, mMaxSeqLength, mNumTokens));
+        auto* workspace = allocBuffer<int8_t>(workspace_size);
+        auto* attention_input = allocBuffer<T>(mNumTokens * (num_heads + 2 * num_kv_heads) * head_size);
+        auto* context_buf = allocBuffer<T>(
+            mNumTokens * num_heads * (mPhase == Phase::MLA_GENERATION ? kMlaVHeadDim : head_size));
+        float const* kv_scale_ptr = kv_type == KvCacheType::ACTIVATION ? nullptr : kv_scales;
+
+        if (context)
+        {
+            mContextParams = {};
+            mContextParams.attention_input = attention_input;
+            mContextParams.input_seq_length = mMaxSeqLength;
+            mContextParams.max_past_kv_len = mMaxSeqLength;
+            mContextParams.max_attention_window = mMaxSeqLength;
+            mContextParams.cyclic_attention_window_size = mMaxSeqLength;
+            mContextParams.max_cyclic_attention_window_size = mMaxSeqLength;
+            mContextParams.q_seq_lengths = context_lengths;
+            mContextParams.kv_seq_lengths = seq_lengths;
+            mContextParams.kv_scale_orig_quant = kv_scale_ptr;
+            mContextParams.kv_scale_quant_orig = kv_scale_ptr;
+            mContextParams.context_buf = context_buf;
+            mContextParams.block_offsets = block_offsets;
+            mContextParams.host_block_offsets = mHostBlockOffsets.data();
+            mContextParams.host_primary_pool_pointer = kv_pool;
+            mContextParams.batch_size = batch_size;
+            mContextParams.num_tokens = mNumTokens;
+            mContextParams.max_blocks_per_sequence = mMaxBlocksPerSeq;
+            mContextParams.host_context_lengths = mContextLengths.data();
+            mContextParams.workspace = workspace;
+            check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+            return;
+        }
+
+        mGenerationParams = {};
+        mGenerationParams.attention_input = attention_input;
+        mGenerationParams.input_seq_length = 1;
+        mGenerationParams.sequence_lengths = seq_lengths;
+        mGenerationParams.max_past_kv_length = *std::max_element(mSeqLengths.begin(), mSeqLengths.end());
+        mGenerationParams.beam_width = 1;
+        mGenerationParams.context_lengths = context_lengths;
+        mGenerationParams.kv_scale_orig_quant = kv_scale_ptr;
+        mGenerationParams.kv_scale_quant_orig = kv_scale_ptr;
+        mGenerationParams.context_buf = context_buf;
+        mGenerationParams.block_offsets = block_offsets;
+        mGenerationParams.host_primary_pool_pointer = kv_pool;
+        mGenerationParams.max_attention_window = mMaxSeqLength;
+        mGenerationParams.cyclic_attention_window_size = mMaxSeqLength;
+        mGenerationParams.max_cyclic_attention_window_size = mMaxSeqLength;
+        mGenerationParams.num_requests = batch_size;
+        mGenerationParams.max_blocks_per_sequence = mMaxBlocksPerSeq;
+        mGenerationParams.semaphores = mOp->mMultiBlockSemaphores.get();
+        mGenerationParams.workspace = workspace;
+        mGenerationParams.host_past_key_value_lengths = mSeqLengths.data();
+        mGenerationParams.host_context_lengths = mContextLengths.data();
+        mGenerationParams.total_num_input_tokens = mNumTokens;
+
+        if (mPhase == Phase::MLA_GENERATION)
+        {
+            // The projections of the latent, run by mlaGeneration around the attention
+            int const latent_size = kMlaKvLoraRank + kMlaQkRopeHeadDim;
+            mMlaParams = {};
+            mMlaParams.fused_a_input = allocBuffer<T>(mNumTokens * (kMlaQLoraRank + latent_size));
+            mMlaParams.attention_input_buf = allocBuffer<T>(mNumTokens * num_heads * latent_size);
+            mMlaParams.context_buf = context_buf;
+            mMlaParams.fused_q_proj = allocBuffer<T>(static_cast<size_t>(num_heads) * latent_size * kMlaQLoraRank);
+            mMlaParams.q_b_proj = allocBuffer<T>(
+                static_cast<size_t>(num_heads) * (kMlaQkNopeHeadDim + kMlaQkRopeHeadDim) * kMlaQLoraRank);
+            mMlaParams.kv_b_proj = allocBuffer<T>(
+                static_cast<size_t>(num_heads) * (kMlaQkNopeHeadDim + kMlaVHeadDim) * kMlaKvLoraRank);
+            mMlaParams.cos_sin_cache = allocFromHost(
+                std::vector<float2>(static_cast<size_t>(mMaxSeqLength + 1) * kMlaQkRopeHeadDim, float2{1.f, 0.f}));
+            mMlaParams.batch_size = batch_size;
+            mMlaParams.acc_q_len = mNumTokens;
+            mMlaParams.head_num = num_heads;
+            mMlaParams.workspace = workspace;
+            mMlaParams.cache_seq_lens = seq_lengths;
+            mMlaParams.meta = mOp->mMLAParams;
+        }
+        check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+    }
+
+    void runAttention()
+    {
+        switch (mPhase)
+        {
+        case Phase::GENERATION:
+            mOp->enqueueGeneration<T, KVBlockArray>(mGenerationParams, streamPtr->get());
+            break;
+        case Phase::CONTEXT: mOp->enqueueContext<T, KVBlockArray>(mContextParams, streamPtr->get()); break;
+        case Phase::MLA_GENERATION: mOp->mlaGeneration<T>(mMlaParams, mGenerationParams, streamPtr->get()); break;
+        }
+    }
+
+    float benchmarkLoop()
+    {
+        check_cuda_error(cudaEventRecord(mStartEvent, streamPtr->get()));
+        runAttention();
+        check_cuda_error(cudaEventRecord(mEndEvent, streamPtr->get()));
+        check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+
+        float ms;
+        check_cuda_error(cudaEventElapsedTime(&ms, mStartEvent, mEndEvent));
+        return ms;
+    }
+
+    //! The bytes of the attention the kernels have to move at least, and its FLOPs, the projections of MLA excluded.
+    std::pair<double, double> getBytesAndFlops(int num_heads, int num_kv_heads, int head_size, KvCacheType kv_type)
+    {
+        double const elem_size = sizeof(T);
+        double bytes = 0;
+        double flops = 0;
+        for (auto const seq_length : mSeqLengths)
+        {
+            double const length = seq_length;
+            switch (mPhase)
+            {
+            case Phase::GENERATION:
+                // Reads the K and V of the sequence, Q and O are negligible
+                bytes += length * 2 * num_kv_heads * head_size * getKvElemSize(kv_type);
+                flops += 4 * length * num_heads * head_size;
+                break;
+            case Phase::CONTEXT:
+                // Reads QKV once, writes O and the KV cache, with a causal mask
+                bytes += length * (num_heads + 2 * num_kv_heads) * head_size * elem_size;
+                bytes += length * num_heads * head_size * elem_size;
+                bytes += length * 2 * num_kv_heads * head_size * getKvElemSize(kv_type);
+                flops += 4 * num_heads * head_size * length * (length + 1) / 2;
+                break;
+            case Phase::MLA_GENERATION:
+                // The heads share the latent, read once. QK^T over the latent and rope dims, PV over the latent.
+                bytes += length * (kMlaKvLoraRank + kMlaQkRopeHeadDim) * elem_size;
+                flops += 2 * length * num_heads * (2 * kMlaKvLoraRank + kMlaQkRopeHeadDim);
+                break;
+            }
+        }
+        return {bytes, flops};
+    }
+
+    void runBenchmark(benchmark::State& state)
+    {
+        NVTX3_SCOPED_RANGE(AttentionBenchmark);
+        mPhase = static_cast<Phase>(state.range(0));
+        int const batch_size = state.range(1);
+        int const max_seq_length = state.range(2);
+        auto const dist = static_cast<SeqLenDist>(state.range(3));
+        int const num_heads = state.range(4);
+        bool const is_mla = mPhase == Phase::MLA_GENERATION;
+        // The MLA op has as many KV heads as heads, its KV cache holds one latent per token shared by all of them
+        int const num_kv_heads = is_mla ? num_heads : state.range(5);
+        int const head_size = is_mla ? kMlaQkNopeHeadDim + kMlaQkRopeHeadDim : state.range(6);
+        auto const kv_type = static_cast<KvCacheType>(state.range(7));
+        bool const multi_block = state.range(8);
+
+        state.counters["phase"] = static_cast<int>(mPhase);
+        state.counters["batch_size"] = batch_size;
+        state.counters["max_seq_len"] = max_seq_length;
+        state.counters["seq_len_dist"] = static_cast<int>(dist);
+        state.counters["num_heads"] = num_heads;
+        state.counters["num_kv_heads"] = num_kv_heads;
+        state.counters["head_size"] = head_size;
+        state.counters["kv_cache_type"] = static_cast<int>(kv_type);
+        state.counters["multi_block"] = multi_block;
+
+        if (num_heads % num_kv_heads != 0)
+        {
+            state.SkipWithMessage("The number of heads must be a multiple of the number of KV heads");
+            return;
+        }
+        if (!is_mla && !mmha_supported(head_size))
+        {
+            state.SkipWithMessage("Head size not supported by MMHA");
+            return;
+        }
+        if (kv_type == KvCacheType::FP8 && getSMVersion() < 89)
+        {
+            state.SkipWithMessage("FP8 KV cache requires SM89 or later");
+            return;
+        }
+        if (is_mla && (kv_type != KvCacheType::ACTIVATION || sizeof(T) != 2))
+        {
+            state.SkipWithMessage("MLA only supports a half or bfloat16 KV cache");
+            return;
+        }
+        if (TRTDataType<T>::value == nvinfer1::DataType::kBF16 && getSMVersion() < 80)
+        {
+            state.SkipWithMessage("Bfloat16 requires SM80 or later");
+            return;
+        }
+
+        initSeqLengths(batch_size, max_seq_length, dist);
+        auto const bytes_per_block = is_mla
+            ? static_cast<size_t>(kTokensPerBlock) * (kMlaKvLoraRank + kMlaQkRopeHeadDim) * sizeof(T)
+            : static_cast<size_t>(kTokensPerBlock) * num_kv_heads * head_size * getKvElemSize(kv_type);
+        size_t free_bytes;
+        size_t total_bytes;
+        check_cuda_error(cudaMemGetInfo(&free_bytes, &total_bytes));
+        if (getKvPoolSize(bytes_per_block) > free_bytes * 0.8)
+        {
+            state.SkipWithMessage("The KV cache does not fit in the device memory");
+            return;
+        }
+
+        initOp(num_heads, num_kv_heads, head_size, kv_type, multi_block);
+        initBuffers(num_heads, num_kv_heads, head_size, kv_type);
+
+        // The first run may JIT compile the XQA kernels
+        runAttention();
+        check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+        state.SetLabel(AttentionOp::getKernelPathName(mOp->getLastKernelPath()));
+
+        for (auto _ : state)
+        {
+            float ms = benchmarkLoop();
+            state.SetIterationTime(ms / 1000.f);
+        }
+
+        auto const [bytes, flops] = getBytesAndFlops(num_heads, num_kv_heads, head_size, kv_type);
+        state.counters["HBM_GBps"] = benchmark::Counter(bytes / 1e9, benchmark::Counter::kIsIterationInvariantRate);
+        state.counters["TFLOPs"] = benchmark::Counter(flops / 1e12, benchmark::Counter::kIsIterationInvariantRate);
+        state.SetItemsProcessed(state.iterations() * mNumTokens);
+
+        mOp.reset();
+        managed_buffers.clear();
+        check_cuda_error(cudaDeviceSynchronize());
+    }
+};
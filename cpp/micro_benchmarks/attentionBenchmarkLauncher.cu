@@ -0,0 +1,232 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Include the fixture with the actual benchmark code
+#include "attentionBenchmarkFixture.h"
+
+#include <cstring>
+#include <iostream>
+
+/*
+ * Below is all the setup for parameterising the benchmarks
+ */
+
+namespace
+{
+using Phase = AttentionBenchmark<half>::Phase;
+using SeqLenDist = AttentionBenchmark<half>::SeqLenDist;
+using KvCacheType = AttentionBenchmark<half>::KvCacheType;
+
+struct HeadConfig
+{
+    int64_t numHeads;
+    int64_t numKvHeads;
+    int64_t headSize;
+};
+
+// MHA, GQA with group sizes 4 and 8, and a small head size
+std::vector<HeadConfig> const kHeadConfigs = {{32, 32, 128}, {32, 8, 128}, {64, 8, 128}, {32, 8, 64}};
+std::vector<int64_t> const kSeqLenDists = {static_cast<int64_t>(SeqLenDist::UNIFORM),
+    static_cast<int64_t>(SeqLenDist::RANDOM), static_cast<int64_t>(SeqLenDist::LONG_TAIL)};
+} // namespace
+
+#define BENCHMARK_ATTENTION(dtype)                                                                                     \
+    BENCHMARK_TEMPLATE_DEFINE_F(AttentionBenchmark, Attention_##dtype, dtype)(benchmark::State & state)                \
+    {                                                                                                                  \
+        runBenchmark(state);                                                                                           \
+    }
+
+void argGenAttention(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->UseManualTime();
+    benchmark->ArgNames(
+        {"Phase", "Batch", "SeqLen", "SeqLenDist", "Heads", "KvHeads", "HeadSize", "KvCacheType", "MultiBlock"});
+
+    auto const generation = static_cast<int64_t>(Phase::GENERATION);
+    for (auto const& heads : kHeadConfigs)
+    {
+        for (int64_t batch_size : {1, 16, 64, 256})
+        {
+            for (int64_t seq_length : {1024, 8192, 32768})
+            {
+                for (auto dist : kSeqLenDists)
+                {
+                    for (auto kv_type : {KvCacheType::ACTIVATION, KvCacheType::INT8, KvCacheType::FP8})
+                    {
+                        // Multi-block matters when the batch does not fill the device
+                        for (int64_t multi_block : {0, 1})
+                        {
+                            if (multi_block == 0 && batch_size > 16)
+                            {
+                                continue;
+                            }
+                            benchmark->Args({generation, batch_size, seq_length, dist, heads.numHeads,
+                                heads.numKvHeads, heads.headSize, static_cast<int64_t>(kv_type), multi_block});
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    auto const context = static_cast<int64_t>(Phase::CONTEXT);
+    for (auto const& heads : kHeadConfigs)
+    {
+        for (int64_t batch_size : {1, 4, 16})
+        {
+            for (int64_t seq_length : {512, 2048, 8192})
+            {
+                for (auto dist : kSeqLenDists)
+                {
+                    for (auto kv_type : {KvCacheType::ACTIVATION, KvCacheType::FP8})
+                    {
+                        benchmark->Args({context, batch_size, seq_length, dist, heads.numHeads, heads.numKvHeads,
+                            heads.headSize, static_cast<int64_t>(kv_type), 1});
+                    }
+                }
+            }
+        }
+    }
+
+    // The heads of DeepSeek-V3 with TP 1 and TP 8, the KV heads and head size are fixed by MLA
+    auto const mla = static_cast<int64_t>(Phase::MLA_GENERATION);
+    for (int64_t num_heads : {16, 128})
+    {
+        for (int64_t batch_size : {1, 16, 64, 256})
+        {
+            for (int64_t seq_length : {1024, 8192, 32768})
+            {
+                for (auto dist : kSeqLenDists)
+                {
+                    benchmark->Args({mla, batch_size, seq_length, dist, num_heads, num_heads, 0,
+                        static_cast<int64_t>(KvCacheType::ACTIVATION), 1});
+                }
+            }
+        }
+    }
+}
+
+BENCHMARK_ATTENTION(half)
+#ifdef ENABLE_BF16
+BENCHMARK_ATTENTION(__nv_bfloat16)
+#endif
+
+void registerBenchmarks()
+{
+    BENCHMARK_REGISTER_F(AttentionBenchmark, Attention_half)->Apply(argGenAttention);
+#ifdef ENABLE_BF16
+    BENCHMARK_REGISTER_F(AttentionBenchmark, Attention___nv_bfloat16)->Apply(argGenAttention);
+#endif
+}
+
+void doCleanup()
+{
+    bufferManager.reset();
+    streamPtr.reset();
+}
+
+void help()
+{
+    std::cout << "Usage: attentionBenchmark [benchmark options]\n";
+    std::cout << "Runs AttentionOp on a synthetic paged KV cache. The label of each run is the kernels the op "
+                 "dispatched to:\n"
+                 "context_fmha, context_fmha_trtllm_gen, context_unfused, mmha, mmha_multi_block, xqa_precompiled, "
+                 "xqa_jit,\nxqa_trtllm_gen, mla_decode or mla_fmha.\n\n"
+              << "Arguments\n"
+                 "- Phase - 0 = generation, 1 = context, 2 = MLA generation\n"
+                 "- Batch - The number of requests\n"
+                 "- SeqLen - The max KV length of the requests\n"
+                 "- SeqLenDist - 0 = all at SeqLen, 1 = random between SeqLen / 8 and SeqLen, 2 = one at SeqLen and "
+                 "the others at SeqLen / 16\n"
+                 "- Heads, KvHeads, HeadSize - The attention heads, MLA uses KvHeads = Heads and its fixed head "
+                 "sizes\n"
+                 "- KvCacheType - 0 = the activation type, 1 = int8, 2 = fp8\n"
+                 "- MultiBlock - Whether the generation kernels may split a sequence over several blocks\n\n"
+                 "The XQA JIT and precompiled kernels are selected with TRTLLM_ENABLE_XQA_JIT, the MLA decode kernel "
+                 "with\nTRTLLM_ENABLE_MLA_DECODE_KERNEL. HBM_GBps and TFLOPs count the minimal traffic and the FLOPs "
+                 "of the attention,\nthe projections of MLA excluded.\n\n";
+
+    std::cout << "benchmark options:\n";
+    benchmark::PrintDefaultHelp();
+}
+
+void gbenchCustomHelp()
+{
+    help();
+    // google-benchmark calls exit() so we need to cleanup manually
+    doCleanup();
+}
+
+int parseArgsAndRunBench(int argc, char** argv)
+{
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            if (strcmp("--help", argv[i]) == 0 || strcmp("-h", argv[i]) == 0)
+            {
+                help();
+                return 0;
+            }
+        }
+
+        registerBenchmarks();
+
+        benchmark::Initialize(&argc, argv, &gbenchCustomHelp);
+
+        if (argc > 1)
+        {
+            help();
+            std::cout << std::flush; // Force flush
+            // Print the error second, so it's easy to see
+            std::cerr << "\nUnrecognised argument: " << argv[1] << std::endl;
+            return -4;
+        }
+
+        benchmark::RunSpecifiedBenchmarks();
+        benchmark::Shutdown();
+
+        return 0;
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << "Exiting benchmarks with exception: " << e.what() << std::endl;
+        return -3;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    deviceCount = getDeviceCount();
+    if (deviceCount < 0)
+        return 0;
+    streamPtr = std::make_shared<CudaStream>();
+    bufferManager = std::make_unique<BufferManager>(streamPtr);
+
+    int res = -1;
+    try
+    {
+        res = parseArgsAndRunBench(argc, argv);
+    }
+    catch (std::exception const& e)
+    {
+        std::cout << "Benchmark exited with unhandled exception: " << e.what() << std::endl;
+    }
+
+    doCleanup();
+    return res;
+}
@@ -0,0 +1,712 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/memoryUtils.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+#include "tensorrt_llm/executor/types.h"
+#include "tensorrt_llm/kernels/beamSearchKernels.h"
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/kernels/samplingTopKKernels.h"
+#include "tensorrt_llm/kernels/samplingTopPKernels.h"
+#include "tensorrt_llm/kernels/topkLastDim.h"
+#include "tensorrt_llm/layers/decodingParams.h"
+#include "tensorrt_llm/layers/dynamicDecodeLayer.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/decodingLayerWorkspace.h"
+#include "tensorrt_llm/runtime/runtimeKernels.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cuda.h>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace tensorrt_llm::kernels;
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::runtime;
+using namespace tensorrt_llm::layers;
+
+namespace tle = tensorrt_llm::executor;
+namespace trk = tensorrt_llm::runtime::kernels;
+
+static BufferManager::CudaStreamPtr streamPtr;
+static std::shared_ptr<BufferManager> bufferManager;
+static int deviceCount;
+static bool useCudaGraph = true;
+
+namespace
+{
+
+//! Decoding steps are benchmarked at this position, the sequences are reset to it before each step.
+constexpr SizeType32 kInputLength = 128;
+constexpr SizeType32 kMaxSeqLength = 256;
+
+//! Fills rows of logits with the same random normal logits, sampling cost depends on their distribution, not on the
+//! differences between the rows.
+template <class T>
+void initRandomLogits(T* logits, int64_t num_rows, int64_t vocab_size)
+{
+    std::mt19937 gen(0xD5);
+    std::normal_distribution<float> dist(0.f, 2.f);
+    std::vector<T> row(vocab_size);
+    std::generate(row.begin(), row.end(), [&]() { return static_cast<T>(dist(gen)); });
+    for (int64_t r = 0; r < num_rows; r++)
+    {
+        check_cuda_error(cudaMemcpyAsync(logits + r * vocab_size, row.data(), vocab_size * sizeof(T),
+            cudaMemcpyHostToDevice, streamPtr->get()));
+    }
+    check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+}
+
+} // namespace
+
+/**
+ * Benchmarks the sampling kernels alone, one decoding step of a batch of requests with the same top-k or top-p
+ */
+template <class T>
+class SamplingKernelBenchmark : public benchmark::Fixture
+{
+public:
+    enum class Kernel
+    {
+        TOP_K = 0,
+        TOP_P = 1,
+        AIR_TOP_P = 2
+    };
+
+    void SetUp(benchmark::State& s) override
+    {
+        assert(bufferManager);
+        check_cuda_error(cudaDeviceSynchronize());
+        check_cuda_error(cudaEventCreate(&mStartEvent));
+        check_cuda_error(cudaEventCreate(&mEndEvent));
+    }
+
+    void TearDown(benchmark::State& s) override
+    {
+        managed_buffers.clear();
+
+        check_cuda_error(cudaEventDestroy(mStartEvent));
+        check_cuda_error(cudaEventDestroy(mEndEvent));
+        check_cuda_error(cudaDeviceSynchronize());
+    }
+
+    cudaEvent_t mStartEvent, mEndEvent;
+    std::vector<BufferManager::IBufferPtr> managed_buffers;
+
+    Kernel mKernel{};
+    TopKSamplingKernelParams<T> mTopKParams{};
+    TopPSamplingKernelParams<T> mTopPParams{};
+    SizeType32* mSequenceLengths{};
+    int64_t mBatchSize{};
+
+    template <class U>
+    U* allocBuffer(size_t size)
+    {
+        managed_buffers.emplace_back(bufferManager->gpu(size * sizeof(U)));
+        U* ptr = static_cast<U*>(managed_buffers.back()->data());
+        check_cuda_error(cudaMemsetAsync(ptr, 0x0, size * sizeof(U), streamPtr->get()));
+        return ptr;
+    }
+
+    template <class U>
+    U* allocFilledBuffer(size_t size, U value)
+    {
+        std::vector<U> host(size, value);
+        U* ptr = allocBuffer<U>(size);
+        check_cuda_error(
+            cudaMemcpyAsync(ptr, host.data(), size * sizeof(U), cudaMemcpyHostToDevice, streamPtr->get()));
+        return ptr;
+    }
+
+    void initBuffers(int64_t batch_size, int64_t vocab_size, int64_t top_k, float top_p)
+    {
+        mBatchSize = batch_size;
+        auto* logits = allocBuffer<T>(batch_size * vocab_size);
+        initRandomLogits(logits, batch_size, vocab_size);
+
+        std::vector<SizeType32> batch_slots(batch_size);
+        std::iota(batch_slots.begin(), batch_slots.end(), 0);
+        auto* batch_slots_device = allocBuffer<SizeType32>(batch_size);
+        check_cuda_error(cudaMemcpyAsync(batch_slots_device, batch_slots.data(), batch_size * sizeof(SizeType32),
+            cudaMemcpyHostToDevice, streamPtr->get()));
+
+        auto* output_ids = allocBuffer<TokenIdType>(batch_size * kMaxSeqLength);
+        mSequenceLengths = allocBuffer<SizeType32>(batch_size);
+        // An unlikely end id, a finished request would be skipped by the next steps otherwise
+        auto* end_ids = allocFilledBuffer<TokenIdType>(batch_size, vocab_size - 1);
+        auto* finished = allocBuffer<FinishedState>(batch_size);
+        auto* skip_decode = allocBuffer<bool>(batch_size);
+        auto* curand_states = allocBuffer<curandState_t>(batch_size);
+        invokeCurandInitialize(curand_states, batch_slots_device, batch_size, 0xD5, streamPtr->get());
+
+        if (mKernel == Kernel::TOP_K)
+        {
+            auto const workspace_size = getTopKWorkspaceSize<T>(batch_size, 1, top_k, vocab_size);
+            mTopKParams = TopKSamplingKernelParams<T>{};
+            mTopKParams.logProbs = logits;
+            mTopKParams.outputIds = output_ids;
+            mTopKParams.workspace = allocBuffer<char>(workspace_size);
+            mTopKParams.endIds = end_ids;
+            mTopKParams.sequenceLengths = mSequenceLengths;
+            mTopKParams.batchSlots = batch_slots_device;
+            mTopKParams.finishedOutput = finished;
+            mTopKParams.skipDecode = skip_decode;
+            mTopKParams.curandState = curand_states;
+            mTopKParams.topKs = allocFilledBuffer<SizeType32>(batch_size, top_k);
+            mTopKParams.topPs = allocFilledBuffer<float>(batch_size, 1.f);
+            mTopKParams.maxTopK = top_k;
+            mTopKParams.batchSize = batch_size;
+            mTopKParams.maxBatchSize = batch_size;
+            mTopKParams.vocabSizePadded = vocab_size;
+            mTopKParams.maxTokensPerStep = 1;
+            mTopKParams.maxSeqLen = kMaxSeqLength;
+            mTopKParams.checkParams();
+        }
+        else
+        {
+            // The top-p kernels sample the probabilities, computed once here
+            auto* probs = allocBuffer<T>(batch_size * vocab_size);
+            BiasSoftmaxParams<T> softmax_params;
+            softmax_params.logits = logits;
+            softmax_params.probs = probs;
+            softmax_params.batchSize = batch_size;
+            softmax_params.maxBatchSize = batch_size;
+            softmax_params.maxBeamWidth = 1;
+            softmax_params.vocabSize = vocab_size;
+            softmax_params.vocabSizePadded = vocab_size;
+            softmax_params.checkParams();
+            invokeAddBiasSoftMax(softmax_params, streamPtr->get());
+
+            bool const is_air = mKernel == Kernel::AIR_TOP_P;
+            auto const workspace_size = is_air ? getAirTopPWorkspaceSize<T>(batch_size, vocab_size)
+                                               : getTopPWorkspaceSize<T>(batch_size, vocab_size);
+            mTopPParams = TopPSamplingKernelParams<T>{};
+            mTopPParams.probs = probs;
+            mTopPParams.outputIds = output_ids;
+            mTopPParams.workspace = allocBuffer<char>(workspace_size);
+            mTopPParams.topPs = allocFilledBuffer<float>(batch_size, top_p);
+            mTopPParams.sequenceLength = mSequenceLengths;
+            mTopPParams.endIds = end_ids;
+            mTopPParams.batchSlots = batch_slots_device;
+            mTopPParams.finishedOutput = finished;
+            mTopPParams.skipDecode = skip_decode;
+            mTopPParams.curandState = curand_states;
+            if (is_air)
+            {
+                int dev;
+                int sm_count;
+                check_cuda_error(cudaGetDevice(&dev));
+                check_cuda_error(cudaDeviceGetAttribute(&sm_count, cudaDevAttrMultiProcessorCount, dev));
+                mTopPParams.blockNum = calcAirTopPBlockNum<T>(batch_size, vocab_size, sm_count);
+                mTopPParams.isDeterministic = false;
+            }
+            mTopPParams.batchSize = batch_size;
+            mTopPParams.maxBatchSize = batch_size;
+            mTopPParams.vocabSizePadded = vocab_size;
+            mTopPParams.maxSeqLen = kMaxSeqLength;
+            mTopPParams.checkParams();
+        }
+        check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+    }
+
+    void runSampling()
+    {
+        switch (mKernel)
+        {
+        case Kernel::TOP_K: invokeBatchTopKSampling(mTopKParams, streamPtr->get()); break;
+        case Kernel::TOP_P: invokeBatchTopPSampling(mTopPParams, streamPtr->get()); break;
+        case Kernel::AIR_TOP_P: invokeBatchAirTopPSampling(mTopPParams, streamPtr->get()); break;
+        }
+    }
+
+    cudaGraph_t mGraph{};
+    cudaGraphExec_t mGraphInstance{};
+
+    void createGraph()
+    {
+        if (!useCudaGraph)
+            return;
+
+        check_cuda_error(cudaGraphCreate(&mGraph, 0));
+        check_cuda_error(cudaStreamBeginCapture(streamPtr->get(), cudaStreamCaptureModeThreadLocal));
+        runSampling();
+        check_cuda_error(cudaStreamEndCapture(streamPtr->get(), &mGraph));
+        check_cuda_error(cudaGraphInstantiate(&mGraphInstance, mGraph, nullptr, nullptr, 0));
+    }
+
+    void destroyGraph()
+    {
+        if (!useCudaGraph)
+            return;
+
+        check_cuda_error(cudaGraphExecDestroy(mGraphInstance));
+        check_cuda_error(cudaGraphDestroy(mGraph));
+    }
+
+    float benchmarkLoop()
+    {
+        // Outside of the timed region, the sampled token is written at the same position at every step
+        check_cuda_error(cudaMemsetAsync(mSequenceLengths, 0x0, mBatchSize * sizeof(SizeType32), streamPtr->get()));
+
+        check_cuda_error(cudaEventRecord(mStartEvent, streamPtr->get()));
+        if (useCudaGraph)
+        {
+            cudaGraphLaunch(mGraphInstance, streamPtr->get());
+        }
+        else
+        {
+            runSampling();
+        }
+        check_cuda_error(cudaEventRecord(mEndEvent, streamPtr->get()));
+        check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+
+        float ms;
+        check_cuda_error(cudaEventElapsedTime(&ms, mStartEvent, mEndEvent));
+        return ms;
+    }
+
+    void runBenchmark(benchmark::State& state)
+    {
+        NVTX3_SCOPED_RANGE(SamplingKernelBenchmark);
+        int const batch_size = state.range(0);
+        int const vocab_size = state.range(1);
+        int const top_k = state.range(2);
+        float const top_p = state.range(3) / 100.f;
+        mKernel = static_cast<Kernel>(state.range(4));
+
+        state.counters["batch_size"] = batch_size;
+        state.counters["vocab_size"] = vocab_size;
+        state.counters["top_k"] = top_k;
+        state.counters["top_p"] = top_p;
+        state.counters["kernel"] = static_cast<int>(mKernel);
+
+        if (mKernel == Kernel::TOP_K && (top_k < 1 || top_k > TOP_K_MAX))
+        {
+            state.SkipWithMessage("Top-k out of the range of the top-k kernel");
+            return;
+        }
+
+        initBuffers(batch_size, vocab_size, top_k, top_p);
+        createGraph();
+        for (auto _ : state)
+        {
+            float ms = benchmarkLoop();
+            state.SetIterationTime(ms / 1000.f);
+        }
+        destroyGraph();
+
+        state.SetItemsProcessed(state.iterations() * batch_size);
+        managed_buffers.clear();
+        check_cuda_error(cudaDeviceSynchronize());
+    }
+};
+
+/**
+ * Benchmarks invokeTopkLastDim, the sorted top-k of every row of logits, with the sort algorithms of the selected
+ * elements
+ */
+template <class T>
+class TopkLastDimBenchmark : public benchmark::Fixture
+{
+public:
+    void SetUp(benchmark::State& s) override
+    {
+        assert(bufferManager);
+        check_cuda_error(cudaDeviceSynchronize());
+        check_cuda_error(cudaEventCreate(&mStartEvent));
+        check_cuda_error(cudaEventCreate(&mEndEvent));
+    }
+
+    void TearDown(benchmark::State& s) override
+    {
+        managed_buffers.clear();
+
+        check_cuda_error(cudaEventDestroy(mStartEvent));
+        check_cuda_error(cudaEventDestroy(mEndEvent));
+        check_cuda_error(cudaDeviceSynchronize());
+    }
+
+    cudaEvent_t mStartEvent, mEndEvent;
+    std::vector<BufferManager::IBufferPtr> managed_buffers;
+
+    template <class U>
+    U* allocBuffer(size_t size)
+    {
+        managed_buffers.emplace_back(bufferManager->gpu(size * sizeof(U)));
+        return static_cast<U*>(managed_buffers.back()->data());
+    }
+
+    void runBenchmark(benchmark::State& state)
+    {
+        NVTX3_SCOPED_RANGE(TopkLastDimBenchmark);
+        int const batch_size = state.range(0);
+        int const vocab_size = state.range(1);
+        int const top_k = state.range(2);
+        auto const sort_algo = static_cast<TopkLastDimSortAlgo>(state.range(3));
+
+        state.counters["batch_size"] = batch_size;
+        state.counters["vocab_size"] = vocab_size;
+        state.counters["top_k"] = top_k;
+        state.counters["sort_algo"] = static_cast<int>(sort_algo);
+
+        auto* logits = allocBuffer<T>(static_cast<size_t>(batch_size) * vocab_size);
+        initRandomLogits(logits, batch_size, vocab_size);
+        auto* out_val = allocBuffer<T>(static_cast<size_t>(batch_size) * top_k);
+        auto* out_idx = allocBuffer<SizeType32>(static_cast<size_t>(batch_size) * top_k);
+        auto* workspace = allocBuffer<char>(
+            invokeComputeTopkLastDimWorkspaceSize<T>(batch_size, vocab_size, top_k, true, sort_algo));
+
+        for (auto _ : state)
+        {
+            check_cuda_error(cudaEventRecord(mStartEvent, streamPtr->get()));
+            invokeTopkLastDim<T>(
+                batch_size, vocab_size, top_k, true, logits, out_val, out_idx, workspace, streamPtr->get(), sort_algo);
+            check_cuda_error(cudaEventRecord(mEndEvent, streamPtr->get()));
+            check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+
+            float ms;
+            check_cuda_error(cudaEventElapsedTime(&ms, mStartEvent, mEndEvent));
+            state.SetIterationTime(ms / 1000.f);
+        }
+
+        state.SetItemsProcessed(state.iterations() * batch_size);
+        managed_buffers.clear();
+        check_cuda_error(cudaDeviceSynchronize());
+    }
+};
+
+/**
+ * Benchmarks one generation step of DynamicDecodeLayer: penalties, ban words, sampling or beam search, and the
+ * stop criteria, with the host work of the layers between the kernels
+ */
+template <class T>
+class DynamicDecodeLayerBenchmark : public benchmark::Fixture
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+
+    //! The sampling params of the requests of the batch. Beam search only takes the penalties of the mix.
+    enum class SamplingMix
+    {
+        GREEDY = 0,
+        TOP_K = 1,
+        TOP_P = 2,
+        TOP_K_TOP_P = 3,
+        //! Requests alternating greedy, top-k, top-p and top-k with top-p, as in a served batch
+        MIXED = 4,
+        //! MIXED with temperature, repetition, presence and frequency penalties
+        MIXED_PENALTIES = 5
+    };
+
+    static std::string getMixName(SamplingMix mix)
+    {
+        switch (mix)
+        {
+        case SamplingMix::GREEDY: return "greedy";
+        case SamplingMix::TOP_K: return "top_k";
+        case SamplingMix::TOP_P: return "top_p";
+        case SamplingMix::TOP_K_TOP_P: return "top_k_top_p";
+        case SamplingMix::MIXED: return "mixed";
+        case SamplingMix::MIXED_PENALTIES: return "mixed_penalties";
+        }
+        return "unknown";
+    }
+
+    void SetUp(benchmark::State& s) override
+    {
+        assert(bufferManager);
+        check_cuda_error(cudaDeviceSynchronize());
+        check_cuda_error(cudaEventCreate(&mStartEvent));
+        check_cuda_error(cudaEventCreate(&mEndEvent));
+    }
+
+    void TearDown(benchmark::State& s) override
+    {
+        freeLayer();
+
+        check_cuda_error(cudaEventDestroy(mStartEvent));
+        check_cuda_error(cudaEventDestroy(mEndEvent));
+        check_cuda_error(cudaDeviceSynchronize());
+    }
+
+    cudaEvent_t mStartEvent, mEndEvent;
+
+    SizeType32 mBatchSize{};
+    SizeType32 mBeamWidth{};
+    std::unique_ptr<DynamicDecodeLayer<T>> mDecodeLayer;
+    std::shared_ptr<DecodingLayerWorkspace> mWorkspace;
+    std::shared_ptr<DecodingInputs> mInputs;
+    std::shared_ptr<BaseDecodingOutputs> mOutputs;
+
+    TensorPtr mLogitsInit;
+    TensorPtr mLogits;
+    TensorPtr mSequenceLengths;
+    TensorPtr mFinished;
+    TensorPtr mBatchDones;
+    TensorPtr mNumBeamsCBA;
+    TensorPtr mMinNormedScoresCBA;
+    std::vector<TensorPtr> managed_buffers;
+
+    TensorPtr allocBuffer(ITensor::Shape shape, nvinfer1::DataType type, bool pinned = false)
+    {
+        managed_buffers.emplace_back(pinned ? BufferManager::pinned(shape, type) : bufferManager->gpu(shape, type));
+        bufferManager->setZero(*managed_buffers.back());
+        return managed_buffers.back();
+    }
+
+    void freeLayer()
+    {
+        mInputs.reset();
+        mOutputs.reset();
+        mWorkspace.reset();
+        mDecodeLayer.reset();
+        managed_buffers.clear();
+    }
+
+    std::shared_ptr<DynamicDecodeSetupParams> makeSetupParams(SamplingMix mix)
+    {
+        auto setup_params = std::make_shared<DynamicDecodeSetupParams>();
+        setup_params->penaltyParams = std::make_shared<PenaltySetupParams>();
+        if (mix == SamplingMix::MIXED_PENALTIES)
+        {
+            setup_params->penaltyParams->temperature = std::vector<float>{0.8f};
+            setup_params->penaltyParams->repetitionPenalty = std::vector<float>{1.1f};
+            setup_params->penaltyParams->presencePenalty = std::vector<float>{0.5f};
+            setup_params->penaltyParams->frequencyPenalty = std::vector<float>{0.5f};
+        }
+        setup_params->banWordsParams = std::make_shared<BanWordsSetupParams>();
+
+        if (mBeamWidth > 1)
+        {
+            auto beam_params = std::make_shared<BeamSearchSetupParams>();
+            beam_params->beamSearchDiversityRate = std::vector<float>(mBatchSize, 0.f);
+            beam_params->lengthPenalty = std::vector<float>(mBatchSize, 1.f);
+            beam_params->earlyStopping = std::vector<int>(mBatchSize, 1);
+            setup_params->decodingParams = beam_params;
+            return setup_params;
+        }
+
+        std::vector<SizeType32> top_ks(mBatchSize);
+        std::vector<float> top_ps(mBatchSize);
+        for (SizeType32 bi = 0; bi < mBatchSize; bi++)
+        {
+            // The request kind of the mixed batches cycles with the batch index
+            auto const request_mix
+                = (mix == SamplingMix::MIXED || mix == SamplingMix::MIXED_PENALTIES) ? static_cast<SamplingMix>(bi % 4)
+                                                                                     : mix;
+            switch (request_mix)
+            {
+            case SamplingMix::GREEDY:
+                top_ks[bi] = 1;
+                top_ps[bi] = 1.f;
+                break;
+            case SamplingMix::TOP_K:
+                top_ks[bi] = 50;
+                top_ps[bi] = 1.f;
+                break;
+            case SamplingMix::TOP_P:
+                top_ks[bi] = 0;
+                top_ps[bi] = 0.9f;
+                break;
+            default:
+                top_ks[bi] = 40;
+                top_ps[bi] = 0.95f;
+                break;
+            }
+        }
+        auto sampling_params = std::make_shared<SamplingSetupParams>();
+        sampling_params->randomSeed = std::vector<uint64_t>{0xD5};
+        sampling_params->runtimeTopK = top_ks;
+        sampling_params->runtimeTopP = top_ps;
+        sampling_params->outputLogProbs = std::vector<bool>(mBatchSize, false);
+        sampling_params->cumLogProbs = std::vector<bool>(mBatchSize, false);
+        setup_params->decodingParams = sampling_params;
+        return setup_params;
+    }
+
+    void initLayer(SizeType32 batch_size, SizeType32 vocab_size, SizeType32 beam_width, SamplingMix mix)
+    {
+        mBatchSize = batch_size;
+        mBeamWidth = beam_width;
+        auto const data_type = TRTDataType<T>::value;
+        auto const decoding_mode = beam_width > 1 ? tle::DecodingMode::BeamSearch() : tle::DecodingMode::TopKTopP();
+        auto const decoder_domain = DecoderDomain(batch_size, beam_width, vocab_size, vocab_size);
+        mDecodeLayer = std::make_unique<DynamicDecodeLayer<T>>(decoding_mode, decoder_domain, bufferManager);
+        mWorkspace = std::make_shared<DecodingLayerWorkspace>(
+            bufferManager, decoder_domain, data_type, mDecodeLayer->getWorkspaceSize());
+
+        auto const batch_beam = ITensor::makeShape({batch_size, beam_width});
+        auto const batch_beam_seq = ITensor::makeShape({batch_size, beam_width, kMaxSeqLength});
+        mLogitsInit = allocBuffer(ITensor::makeShape({batch_size, beam_width, vocab_size}), data_type);
+        initRandomLogits(bufferCast<T>(*mLogitsInit), batch_size * beam_width, vocab_size);
+        mLogits = allocBuffer(mLogitsInit->getShape(), data_type);
+
+        auto batch_slots = allocBuffer(ITensor::makeShape({batch_size}), nvinfer1::DataType::kINT32, true);
+        auto* batch_slots_ptr = bufferCast<SizeType32>(*batch_slots);
+        std::iota(batch_slots_ptr, batch_slots_ptr + batch_size, 0);
+        auto end_ids = allocBuffer(ITensor::makeShape({batch_size}), nvinfer1::DataType::kINT32);
+        trk::invokeFill(*end_ids, TokenIdType{vocab_size - 1}, *streamPtr);
+
+        mDecodeLayer->setup(batch_size, beam_width, batch_slots, makeSetupParams(mix), mWorkspace);
+
+        // Inputs
+        mInputs = beam_width > 1
+            ? std::make_shared<DecodingInputs>(end_ids, batch_slots, kInputLength, 0, batch_size)
+            : std::make_shared<SamplingInputs>(end_ids, batch_slots, kInputLength, 0, batch_size);
+        mInputs->logits = mLogits;
+        mFinished = allocBuffer(batch_beam, TRTDataType<FinishedState::UnderlyingType>::value);
+        mInputs->finished = mFinished;
+        auto input_lengths = allocBuffer(batch_beam, nvinfer1::DataType::kINT32);
+        trk::invokeFill(*input_lengths, kInputLength, *streamPtr);
+        mInputs->inputLengths = input_lengths;
+        mInputs->maxAttentionWindow = kMaxSeqLength;
+
+        mInputs->banWordsInputs = std::make_shared<BanWordsDecodingInputs>(batch_size);
+
+        // One stop word of two tokens per request, and the length limit
+        auto const stop_words_len = 2;
+        auto stop_words
+            = allocBuffer(ITensor::makeShape({batch_size, 2, stop_words_len}), nvinfer1::DataType::kINT32, true);
+        auto stop_words_ptrs = allocBuffer(ITensor::makeShape({batch_size}), nvinfer1::DataType::kINT64, true);
+        auto stop_words_lens = allocBuffer(ITensor::makeShape({batch_size}), nvinfer1::DataType::kINT32, true);
+        auto* stop_words_data = bufferCast<SizeType32>(*stop_words);
+        for (SizeType32 bi = 0; bi < batch_size; bi++)
+        {
+            auto* words = stop_words_data + bi * 2 * stop_words_len;
+            words[0] = vocab_size - 2;
+            words[1] = vocab_size - 3;
+            words[stop_words_len] = stop_words_len;
+            words[stop_words_len + 1] = -1;
+            bufferCast<int64_t>(*stop_words_ptrs)[bi] = reinterpret_cast<int64_t>(words);
+            bufferCast<SizeType32>(*stop_words_lens)[bi] = stop_words_len;
+        }
+        auto sequence_limit_length = allocBuffer(ITensor::makeShape({batch_size}), nvinfer1::DataType::kINT32);
+        trk::invokeFill(*sequence_limit_length, kMaxSeqLength, *streamPtr);
+        mInputs->stopCriteriaInputs = std::make_shared<StopCriteriaDecodingInputs>(batch_size);
+        mInputs->stopCriteriaInputs->stopWordsPtr = stop_words_ptrs;
+        mInputs->stopCriteriaInputs->stopWordsLengths = stop_words_lens;
+        mInputs->stopCriteriaInputs->maxStopWordsLen = stop_words_len;
+        mInputs->stopCriteriaInputs->sequenceLimitLength = sequence_limit_length;
+
+        // Outputs
+        auto output_ids = allocBuffer(batch_beam_seq, nvinfer1::DataType::kINT32);
+        if (beam_width > 1)
+        {
+            auto beam_outputs = std::make_shared<BeamSearchOutputs>(output_ids);
+            beam_outputs->parentIds = allocBuffer(batch_beam_seq, nvinfer1::DataType::kINT32);
+            beam_outputs->tgtCacheIndirection = allocBuffer(batch_beam_seq, nvinfer1::DataType::kINT32);
+            mInputs->srcCacheIndirection = allocBuffer(batch_beam_seq, nvinfer1::DataType::kINT32);
+
+            auto const batch_cba = ITensor::makeShape({batch_size, 2 * beam_width});
+            auto const batch_cba_seq = ITensor::makeShape({batch_size, 2 * beam_width, kMaxSeqLength});
+            auto bh = std::make_unique<BeamHypotheses>();
+            bh->outputIdsCBA = bufferCast<int>(*allocBuffer(batch_cba_seq, nvinfer1::DataType::kINT32));
+            bh->logProbsCBA = bufferCast<float>(*allocBuffer(batch_cba_seq, nvinfer1::DataType::kFLOAT));
+            bh->sequenceLengthsCBA = bufferCast<int>(*allocBuffer(batch_cba, nvinfer1::DataType::kINT32));
+            bh->cumLogProbsCBA = bufferCast<float>(*allocBuffer(batch_cba, nvinfer1::DataType::kFLOAT));
+            bh->normedScoresCBA = bufferCast<float>(*allocBuffer(batch_cba, nvinfer1::DataType::kFLOAT));
+            mNumBeamsCBA = allocBuffer(ITensor::makeShape({batch_size}), nvinfer1::DataType::kINT32);
+            bh->numBeamsCBA = bufferCast<int>(*mNumBeamsCBA);
+            mMinNormedScoresCBA = allocBuffer(ITensor::makeShape({batch_size}), nvinfer1::DataType::kFLOAT);
+            bh->minNormedScoresCBA = bufferCast<float>(*mMinNormedScoresCBA);
+            mBatchDones = allocBuffer(ITensor::makeShape({batch_size}), nvinfer1::DataType::kBOOL);
+            bh->batchDones = bufferCast<bool>(*mBatchDones);
+            beam_outputs->beamHypotheses = std::move(bh);
+            mOutputs = beam_outputs;
+        }
+        else
+        {
+            mOutputs = std::make_shared<BaseDecodingOutputs>(output_ids);
+        }
+        mSequenceLengths = allocBuffer(batch_beam, nvinfer1::DataType::kINT32);
+        mOutputs->sequenceLength = mSequenceLengths;
+        mOutputs->finished = mFinished;
+        mOutputs->finishedSum = allocBuffer(ITensor::makeShape({1}), nvinfer1::DataType::kINT32, true);
+        mOutputs->cumLogProbs = allocBuffer(batch_beam, nvinfer1::DataType::kFLOAT);
+        mOutputs->newTokens = allocBuffer(ITensor::makeShape({1, batch_size, beam_width}), nvinfer1::DataType::kINT32);
+
+        check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+    }
+
+    void resetStep()
+    {
+        // The penalties and the sampling overwrite the logits, and every step decodes at the same position
+        bufferManager->copy(*mLogitsInit, *mLogits);
+        trk::invokeFill(*mSequenceLengths, kInputLength, *streamPtr);
+        bufferManager->setZero(*mFinished);
+        if (mBeamWidth > 1)
+        {
+            bufferManager->setZero(*mBatchDones);
+            bufferManager->setZero(*mNumBeamsCBA);
+            trk::invokeFill(*mMinNormedScoresCBA, FLT_MAX, *streamPtr);
+        }
+    }
+
+    float benchmarkLoop()
+    {
+        resetStep();
+
+        check_cuda_error(cudaEventRecord(mStartEvent, streamPtr->get()));
+        mDecodeLayer->forwardAsync(mOutputs, mInputs, mWorkspace);
+        check_cuda_error(cudaEventRecord(mEndEvent, streamPtr->get()));
+        check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+
+        float ms;
+        check_cuda_error(cudaEventElapsedTime(&ms, mStartEvent, mEndEvent));
+        return ms;
+    }
+
+    void runBenchmark(benchmark::State& state)
+    {
+        NVTX3_SCOPED_RANGE(DynamicDecodeLayerBenchmark);
+        int const batch_size = state.range(0);
+        int const vocab_size = state.range(1);
+        int const beam_width = state.range(2);
+        auto const mix = static_cast<SamplingMix>(state.range(3));
+
+        state.counters["batch_size"] = batch_size;
+        state.counters["vocab_size"] = vocab_size;
+        state.counters["beam_width"] = beam_width;
+        state.counters["sampling_mix"] = static_cast<int>(mix);
+        state.SetLabel(beam_width > 1 ? "beam_search_" + getMixName(mix) : getMixName(mix));
+
+        initLayer(batch_size, vocab_size, beam_width, mix);
+        // The first step allocates the buffers some layers size at runtime
+        resetStep();
+        mDecodeLayer->forwardAsync(mOutputs, mInputs, mWorkspace);
+        check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+
+        for (auto _ : state)
+        {
+            float ms = benchmarkLoop();
+            state.SetIterationTime(ms / 1000.f);
+        }
+
+        state.SetItemsProcessed(state.iterations() * batch_size * beam_width);
+        freeLayer();
+        check_cuda_error(cudaDeviceSynchronize());
+    }
+};
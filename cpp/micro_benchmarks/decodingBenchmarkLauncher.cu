@@ -0,0 +1,235 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Include the fixture with the actual benchmark code
+#include "decodingBenchmarkFixture.h"
+
+#include <cstring>
+#include <iostream>
+
+/*
+ * Below is all the setup for parameterising the benchmarks
+ */
+
+namespace
+{
+std::vector<int64_t> const kBatchSizes = {1, 8, 64, 256};
+std::vector<int64_t> const kVocabSizes = {32000, 128256};
+} // namespace
+
+#define BENCHMARK_SAMPLING(dtype)                                                                                      \
+    BENCHMARK_TEMPLATE_DEFINE_F(SamplingKernelBenchmark, Sampling_##dtype, dtype)(benchmark::State & state)            \
+    {                                                                                                                  \
+        runBenchmark(state);                                                                                           \
+    }
+
+#define BENCHMARK_TOPK_LAST_DIM(dtype)                                                                                 \
+    BENCHMARK_TEMPLATE_DEFINE_F(TopkLastDimBenchmark, TopkLastDim_##dtype, dtype)(benchmark::State & state)            \
+    {                                                                                                                  \
+        runBenchmark(state);                                                                                           \
+    }
+
+#define BENCHMARK_DECODE_LAYER(dtype)                                                                                  \
+    BENCHMARK_TEMPLATE_DEFINE_F(DynamicDecodeLayerBenchmark, DecodeLayer_##dtype, dtype)(benchmark::State & state)     \
+    {                                                                                                                  \
+        runBenchmark(state);                                                                                           \
+    }
+
+void argGenSampling(benchmark::internal::Benchmark* benchmark)
+{
+    using Kernel = SamplingKernelBenchmark<float>::Kernel;
+    benchmark->UseManualTime();
+    benchmark->ArgNames({"Batch", "Vocab", "TopK", "TopPx100", "Kernel"});
+    for (auto batch_size : kBatchSizes)
+    {
+        for (auto vocab_size : kVocabSizes)
+        {
+            for (int64_t top_k : {1, 4, 50, 1024})
+            {
+                benchmark->Args({batch_size, vocab_size, top_k, 100, static_cast<int64_t>(Kernel::TOP_K)});
+            }
+            for (int64_t top_p : {50, 90, 95})
+            {
+                for (auto kernel : {Kernel::TOP_P, Kernel::AIR_TOP_P})
+                {
+                    benchmark->Args({batch_size, vocab_size, 0, top_p, static_cast<int64_t>(kernel)});
+                }
+            }
+        }
+    }
+}
+
+void argGenTopkLastDim(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->UseManualTime();
+    benchmark->ArgNames({"Batch", "Vocab", "TopK", "SortAlgo"});
+    for (int64_t batch_size : {1, 8, 64})
+    {
+        // Without and with a wide beam search stage 2 row, and large vocabularies
+        for (int64_t vocab_size : {2048, 128256, 262144})
+        {
+            for (int64_t top_k : {16, 64, 256, 1024})
+            {
+                for (auto algo : {TopkLastDimSortAlgo::kSEGMENTED, TopkLastDimSortAlgo::kPACKED})
+                {
+                    benchmark->Args({batch_size, vocab_size, top_k, static_cast<int64_t>(algo)});
+                }
+            }
+        }
+    }
+}
+
+void argGenDecodeLayer(benchmark::internal::Benchmark* benchmark)
+{
+    using SamplingMix = DynamicDecodeLayerBenchmark<float>::SamplingMix;
+    benchmark->UseManualTime();
+    benchmark->ArgNames({"Batch", "Vocab", "BeamWidth", "Mix"});
+    for (auto batch_size : kBatchSizes)
+    {
+        for (auto vocab_size : kVocabSizes)
+        {
+            for (auto mix : {SamplingMix::GREEDY, SamplingMix::TOP_K, SamplingMix::TOP_P, SamplingMix::TOP_K_TOP_P,
+                     SamplingMix::MIXED, SamplingMix::MIXED_PENALTIES})
+            {
+                benchmark->Args({batch_size, vocab_size, 1, static_cast<int64_t>(mix)});
+            }
+            // Beam search with and without the penalties
+            for (auto mix : {SamplingMix::GREEDY, SamplingMix::MIXED_PENALTIES})
+            {
+                benchmark->Args({batch_size, vocab_size, 4, static_cast<int64_t>(mix)});
+            }
+        }
+    }
+}
+
+BENCHMARK_SAMPLING(float)
+BENCHMARK_SAMPLING(half)
+BENCHMARK_TOPK_LAST_DIM(float)
+BENCHMARK_TOPK_LAST_DIM(half)
+BENCHMARK_DECODE_LAYER(float)
+BENCHMARK_DECODE_LAYER(half)
+
+void registerBenchmarks()
+{
+    BENCHMARK_REGISTER_F(SamplingKernelBenchmark, Sampling_float)->Apply(argGenSampling);
+    BENCHMARK_REGISTER_F(SamplingKernelBenchmark, Sampling_half)->Apply(argGenSampling);
+    BENCHMARK_REGISTER_F(TopkLastDimBenchmark, TopkLastDim_float)->Apply(argGenTopkLastDim);
+    BENCHMARK_REGISTER_F(TopkLastDimBenchmark, TopkLastDim_half)->Apply(argGenTopkLastDim);
+    BENCHMARK_REGISTER_F(DynamicDecodeLayerBenchmark, DecodeLayer_float)->Apply(argGenDecodeLayer);
+    BENCHMARK_REGISTER_F(DynamicDecodeLayerBenchmark, DecodeLayer_half)->Apply(argGenDecodeLayer);
+}
+
+void doCleanup()
+{
+    bufferManager.reset();
+    streamPtr.reset();
+}
+
+void help()
+{
+    std::cout << "Usage: decodingBenchmark [--disable_cuda_graphs] [benchmark options]\n";
+    std::cout << "--disable_cuda_graphs\t\tPrevent the sampling kernel benchmarks from using cuda graphs. The decode "
+                 "layer benchmarks never use them, the layers do host work between the kernels\n\n"
+              << "Benchmarks\n"
+                 "- SamplingKernelBenchmark/Sampling_<dtype> - One step of the sampling kernels alone.\n"
+                 "  Kernel: 0 = top-k, 1 = top-p, 2 = AIR top-p. TopPx100 is the top-p in percent.\n"
+                 "- TopkLastDimBenchmark/TopkLastDim_<dtype> - The sorted top-k of every row of logits.\n"
+                 "  SortAlgo: 1 = by index then stable by value, 2 = once on packed value and index keys.\n"
+                 "- DynamicDecodeLayerBenchmark/DecodeLayer_<dtype> - One generation step of DynamicDecodeLayer,\n"
+                 "  with the penalties, the sampling or the beam search, and the stop criteria.\n"
+                 "  Mix: 0 = greedy, 1 = top-k 50, 2 = top-p 0.9, 3 = top-k 40 and top-p 0.95,\n"
+                 "  4 = the previous four alternating between the requests, 5 = 4 with penalties.\n"
+                 "  Beam search only takes the penalties of the mix.\n\n";
+
+    std::cout << "benchmark options:\n";
+    benchmark::PrintDefaultHelp();
+}
+
+void gbenchCustomHelp()
+{
+    help();
+    // google-benchmark calls exit() so we need to cleanup manually
+    doCleanup();
+}
+
+int parseArgsAndRunBench(int argc, char** argv)
+{
+    try
+    {
+        int shift = 0;
+        for (int i = 1; i < argc; i++)
+        {
+            argv[i - shift] = argv[i];
+            if (strcmp("--disable_cuda_graphs", argv[i]) == 0)
+            {
+                useCudaGraph = false;
+                shift++;
+            }
+            else if (strcmp("--help", argv[i]) == 0 || strcmp("-h", argv[i]) == 0)
+            {
+                help();
+                return 0;
+            }
+        }
+        argc -= shift;
+
+        registerBenchmarks();
+
+        benchmark::Initialize(&argc, argv, &gbenchCustomHelp);
+
+        if (argc > 1)
+        {
+            help();
+            std::cout << std::flush; // Force flush
+            // Print the error second, so it's easy to see
+            std::cerr << "\nUnrecognised argument: " << argv[1] << std::endl;
+            return -4;
+        }
+
+        benchmark::RunSpecifiedBenchmarks();
+        benchmark::Shutdown();
+
+        return 0;
+    }
+    catch (std::exception const& e)
+    {
+        std::cerr << "Exiting benchmarks with exception: " << e.what() << std::endl;
+        return -3;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    deviceCount = getDeviceCount();
+    if (deviceCount < 0)
+        return 0;
+    streamPtr = std::make_shared<CudaStream>();
+    bufferManager = std::make_shared<BufferManager>(streamPtr);
+
+    int res = -1;
+    try
+    {
+        res = parseArgsAndRunBench(argc, argv);
+    }
+    catch (std::exception const& e)
+    {
+        std::cout << "Benchmark exited with unhandled exception: " << e.what() << std::endl;
+    }
+
+    doCleanup();
+    return res;
+}
@@ -8,6 +8,7 @@ template = '''{{
   "tp_size": {tp_size},
   "ep_size": {ep_size},
   "world_rank": {world_rank},
+  "ep_link_bandwidth_gbps": {ep_link_bandwidth_gbps},
   "num_tokens": {num_tokens},
   "act_fn": {act_fn},
   "norm_mode": {norm_mode},
@@ -41,6 +42,20 @@ def make_routing_string(name=None, values=None, is_distribution=False):
     return values
 
 
+def make_zipf_routing_string(exponent, name=None):
+    values = f'"routing_zipf": {exponent},'
+    if name is not None:
+        values += f' "routing_values_name": "{name}",'
+    return values
+
+
+def make_trace_routing_string(path, name=None):
+    values = f'"routing_trace": "{path}",'
+    if name is not None:
+        values += f' "routing_values_name": "{name}",'
+    return values
+
+
 def make_tactic_string(tactic_id=None, tactic_id1=None, tactic_id2=None):
     if tactic_id is not None:
         return f'"tactic_id": {tactic_id},'
@@ -53,52 +68,108 @@ def populate_benchmark_config(**kwargs):
     return template.format(**kwargs)
 
 
+parser = argparse.ArgumentParser()
+parser.add_argument('filename',
+                    type=str,
+                    help='The name of the file to generate',
+                    nargs='?',
+                    default="moe-benchmark-file.json")
+parser.add_argument(
+    '--routing',
+    type=str,
+    nargs='+',
+    choices=["uniform", "balanced", "zipf", "trace"],
+    default=["uniform"],
+    help='The routing distributions to sweep, zipf and trace need their own '
+    'arguments')
+parser.add_argument('--zipf_exponents',
+                    type=float,
+                    nargs='+',
+                    default=[1.0],
+                    help='The exponents of the zipf routing distributions')
+parser.add_argument(
+    '--routing_trace',
+    type=str,
+    default=None,
+    help='A JSON file of the experts selected by each token in a recorded '
+    'routing trace')
+parser.add_argument('--ep_sizes',
+                    type=int,
+                    nargs='+',
+                    default=[1],
+                    help='The EP sizes to sweep, they must divide the experts')
+parser.add_argument(
+    '--ep_link_bandwidth_gbps',
+    type=int,
+    default=0,
+    help='The bandwidth of a rank over the all-to-all in GB/s, to estimate '
+    'the time of the dispatch and combine. 0 only reports their bytes')
+args = parser.parse_args()
+
 # Default Mixtral configurations
 num_experts = 8
 k = 2
 hidden_size = 4096
 inter_size = 14336
 tp_size = 4
-ep_size = 1
 world_rank = 0
 act_fn = 3
 norm_mode = 1
 dtype_string = make_dtype_string()  # All dtypes
-routing_string = make_routing_string(
-    name="uniform",
-    is_distribution=True)  # Use the default uniform random distribution
 tactic_id1 = '"auto"'
 tactic_id2 = '"auto"'
 
+# Each routing is defined by its first config, and referenced by name by the
+# others
+routing_strings = []
+for routing in args.routing:
+    if routing in ["uniform", "balanced"]:
+        # Use the predefined random uniform or perfectly balanced distributions
+        routing_strings.append([
+            make_routing_string(name=routing,
+                                is_distribution=routing == "uniform")
+        ] * 2)
+    elif routing == "zipf":
+        for exponent in args.zipf_exponents:
+            name = f"zipf_{exponent}"
+            routing_strings.append([
+                make_zipf_routing_string(exponent, name),
+                make_routing_string(name=name, is_distribution=True)
+            ])
+    else:
+        if args.routing_trace is None:
+            parser.error("--routing trace needs --routing_trace")
+        routing_strings.append([
+            make_trace_routing_string(args.routing_trace, "trace"),
+            make_routing_string(name="trace")
+        ])
+
+ep_size = args.ep_sizes[0] if len(
+    args.ep_sizes) == 1 else f'[{",".join(map(str, args.ep_sizes))}]'
+
 configs = []
-for num_tokens in [1, 8, 64, 2048, 65536]:
-    configs.append(
-        populate_benchmark_config(
-            num_experts=num_experts,
-            k=k,
-            hidden_size=hidden_size,
-            inter_size=inter_size,
-            tp_size=tp_size,
-            ep_size=ep_size,
-            world_rank=world_rank,
-            num_tokens=num_tokens,
-            act_fn=act_fn,
-            norm_mode=norm_mode,
-            dtype_string=dtype_string,
-            routing_string=routing_string,
-            tactic_string=make_tactic_string(tactic_id1=tactic_id1,
-                                             tactic_id2=tactic_id2),
-        ))
+for definition, reference in routing_strings:
+    for i, num_tokens in enumerate([1, 8, 64, 2048, 65536]):
+        configs.append(
+            populate_benchmark_config(
+                num_experts=num_experts,
+                k=k,
+                hidden_size=hidden_size,
+                inter_size=inter_size,
+                tp_size=tp_size,
+                ep_size=ep_size,
+                world_rank=world_rank,
+                ep_link_bandwidth_gbps=args.ep_link_bandwidth_gbps,
+                num_tokens=num_tokens,
+                act_fn=act_fn,
+                norm_mode=norm_mode,
+                dtype_string=dtype_string,
+                routing_string=definition if i == 0 else reference,
+                tactic_string=make_tactic_string(tactic_id1=tactic_id1,
+                                                 tactic_id2=tactic_id2),
+            ))
 
 full_string = "[\n" + ",\n".join(configs) + "\n]"
 
-parser = argparse.ArgumentParser()
-parser.add_argument('filename',
-                    type=str,
-                    help='The name of the file to generate',
-                    nargs='?',
-                    default="moe-benchmark-file.json")
-args = parser.parse_args()
-
 with open(args.filename, "w+") as f:
     f.write(full_string)
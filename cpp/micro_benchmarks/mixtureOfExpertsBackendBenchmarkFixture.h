@@ -25,10 +25,13 @@
 #include "tensorrt_llm/common/nvtxUtils.h"
 #include "tensorrt_llm/kernels/cutlass_kernels/cutlass_preprocessors.h"
 #include "tensorrt_llm/kernels/internal_cutlass_kernels/include/moe_kernels.h"
+#include "tensorrt_llm/kernels/moeFusedRoutingKernels.h"
 #include "tensorrt_llm/runtime/bufferManager.h"
 #include "tensorrt_llm/runtime/cudaStream.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cub/cub.cuh>
 #include <cuda.h>
 #include <memory>
 #include <numeric>
@@ -255,6 +258,140 @@ struct VectoredRoutingConfig : public RoutingConfig
     }
 };
 
+/**
+ * Weights of a Zipf distribution over the experts, to sample with RandomDistributionRoutingConfig. The expert of
+ * popularity rank i is selected with a weight of 1 / (i + 1)^exponent. The popularity ranks are a fixed random
+ * permutation of the experts, so the hot experts are spread over the EP ranks instead of all being on the first one.
+ */
+std::vector<float> makeZipfDistribution(int64_t num_experts, double exponent)
+{
+    std::vector<int64_t> popularity(num_experts);
+    std::iota(popularity.begin(), popularity.end(), 0);
+    std::shuffle(popularity.begin(), popularity.end(), std::mt19937_64{0x21F});
+    std::vector<float> weights(num_experts);
+    for (int64_t expert = 0; expert < num_experts; expert++)
+    {
+        weights[expert] = static_cast<float>(1.0 / std::pow(static_cast<double>(popularity[expert] + 1), exponent));
+    }
+    return weights;
+}
+
+/**
+ * Converts a recorded routing trace, the experts selected by each token in order of preference, to routing values for
+ * VectoredRoutingConfig that select the same experts. With a smaller k the first experts of each token are selected.
+ */
+std::vector<float> makeTraceRoutingValues(std::vector<std::vector<int64_t>> const& trace, int64_t num_experts)
+{
+    std::vector<float> values(trace.size() * num_experts, 0.f);
+    for (size_t token = 0; token < trace.size(); token++)
+    {
+        auto const& experts = trace[token];
+        for (size_t choice = 0; choice < experts.size(); choice++)
+        {
+            TLLM_CHECK_WITH_INFO(experts[choice] >= 0 && experts[choice] < num_experts,
+                "Routing trace selects expert %ld of %ld experts", experts[choice], num_experts);
+            values[token * num_experts + experts[choice]] = static_cast<float>(experts.size() - choice);
+        }
+    }
+    return values;
+}
+
+/**
+ * The load of the experts and of the EP ranks under a routing, and the rows of the all-to-all that dispatches the
+ * tokens to the EP ranks of their experts and combines the results back. The tokens are spread evenly over the EP
+ * ranks, and a token sends one row to every other rank that holds some of its experts.
+ */
+struct RoutingLoadStats
+{
+    std::vector<int64_t> tokens_per_expert;
+    // Expanded rows computed by each EP rank
+    std::vector<int64_t> rows_per_rank;
+    // Rows each EP rank sends to the other ranks in the dispatch, and receives back in the combine
+    std::vector<int64_t> sent_rows_per_rank;
+    // Rows each EP rank receives from the other ranks in the dispatch, and sends back in the combine
+    std::vector<int64_t> received_rows_per_rank;
+
+    static RoutingLoadStats compute(
+        std::vector<float> const& routing_values, int64_t num_experts, int64_t k, int64_t num_tokens, int ep_size)
+    {
+        RoutingLoadStats stats;
+        stats.tokens_per_expert.assign(num_experts, 0);
+        stats.rows_per_rank.assign(ep_size, 0);
+        stats.sent_rows_per_rank.assign(ep_size, 0);
+        stats.received_rows_per_rank.assign(ep_size, 0);
+        int64_t const experts_per_rank = num_experts / ep_size;
+
+        std::vector<int64_t> experts(num_experts);
+        std::vector<bool> rank_selected(ep_size);
+        for (int64_t token = 0; token < num_tokens; token++)
+        {
+            // Same order as the top-k of the runner, ties go to the lower expert
+            float const* values = routing_values.data() + token * num_experts;
+            std::iota(experts.begin(), experts.end(), 0);
+            std::partial_sort(experts.begin(), experts.begin() + k, experts.end(),
+                [values](int64_t a, int64_t b) { return values[a] > values[b] || (values[a] == values[b] && a < b); });
+
+            std::fill(rank_selected.begin(), rank_selected.end(), false);
+            for (int64_t choice = 0; choice < k; choice++)
+            {
+                auto const expert = experts[choice];
+                auto const rank = expert / experts_per_rank;
+                stats.tokens_per_expert[expert]++;
+                stats.rows_per_rank[rank]++;
+                rank_selected[rank] = true;
+            }
+            int64_t const source_rank = token % ep_size;
+            for (int rank = 0; rank < ep_size; rank++)
+            {
+                if (rank_selected[rank] && rank != source_rank)
+                {
+                    stats.sent_rows_per_rank[source_rank]++;
+                    stats.received_rows_per_rank[rank]++;
+                }
+            }
+        }
+        return stats;
+    }
+
+    // Max over mean of the loads, 1 for a perfectly balanced load
+    static double imbalance(std::vector<int64_t> const& loads)
+    {
+        double const total = std::accumulate(loads.begin(), loads.end(), 0.0);
+        if (total == 0)
+        {
+            return 1.0;
+        }
+        return *std::max_element(loads.begin(), loads.end()) * loads.size() / total;
+    }
+
+    // Coefficient of variation of the loads, 0 for a perfectly balanced load
+    static double coefficientOfVariation(std::vector<int64_t> const& loads)
+    {
+        double const mean = std::accumulate(loads.begin(), loads.end(), 0.0) / loads.size();
+        if (mean == 0)
+        {
+            return 0.0;
+        }
+        double variance = 0;
+        for (auto const load : loads)
+        {
+            variance += (load - mean) * (load - mean);
+        }
+        return std::sqrt(variance / loads.size()) / mean;
+    }
+
+    // Rows of the all-to-all the slowest rank has to move in one direction, which bounds its time
+    int64_t maxAllToAllRows() const
+    {
+        int64_t rows = 0;
+        for (size_t rank = 0; rank < rows_per_rank.size(); rank++)
+        {
+            rows = std::max({rows, sent_rows_per_rank[rank], received_rows_per_rank[rank]});
+        }
+        return rows;
+    }
+};
+
 }; // namespace
 
 constexpr int LOAD_BALANCED_ROUTING_CONFIG = 0;
@@ -720,6 +857,63 @@ public:
             parallelism_config, mNormMode, mUseLora, mLoraParams, stream);
     }
 
+    // Bytes of a row of activations sent to the experts in the dispatch, and of a row of results in the combine
+    int64_t dispatchRowBytes() const
+    {
+        if constexpr (FP4)
+        {
+            return mHiddenSize / 2;
+        }
+        else
+        {
+            return mHiddenSize * sizeof(DataType);
+        }
+    }
+
+    int64_t combineRowBytes() const
+    {
+        return mHiddenSize * sizeof(OutputType);
+    }
+
+    /**
+     * Reports the load of the experts and of the EP ranks under the routing of the benchmark, and the all-to-all
+     * around the MoE on each rank if it was run with EP across ranks. The routing of non deterministic configs is the
+     * one of the first iteration.
+     * \param link_bandwidth_gbps Bandwidth of a rank over the all-to-all in GB/s to estimate its time, 0 to skip it
+     */
+    void reportRoutingLoad(benchmark::State& state, MOEParallelismConfig parallelism_config, int link_bandwidth_gbps)
+    {
+        std::vector<float> routing_values(mTotalTokens * mNumExperts);
+        check_cuda_error(cudaMemcpyAsync(routing_values.data(), mInputProbabilities,
+            routing_values.size() * sizeof(float), cudaMemcpyDeviceToHost, streamPtr->get()));
+        check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+        auto const stats
+            = RoutingLoadStats::compute(routing_values, mNumExperts, mK, mTotalTokens, parallelism_config.ep_size);
+
+        state.counters["expert_load_imbalance"] = RoutingLoadStats::imbalance(stats.tokens_per_expert);
+        state.counters["expert_load_cv"] = RoutingLoadStats::coefficientOfVariation(stats.tokens_per_expert);
+        state.counters["max_expert_tokens"] = static_cast<double>(
+            *std::max_element(stats.tokens_per_expert.begin(), stats.tokens_per_expert.end()));
+        state.counters["ep_rank_rows"] = static_cast<double>(stats.rows_per_rank.at(parallelism_config.ep_rank));
+        state.counters["ep_load_imbalance"] = RoutingLoadStats::imbalance(stats.rows_per_rank);
+
+        if (parallelism_config.ep_size == 1)
+        {
+            return;
+        }
+        auto const a2a_rows = stats.maxAllToAllRows();
+        auto const dispatch_bytes = static_cast<double>(a2a_rows * dispatchRowBytes());
+        auto const combine_bytes = static_cast<double>(a2a_rows * combineRowBytes());
+        state.counters["a2a_dispatch_bytes"] = dispatch_bytes;
+        state.counters["a2a_combine_bytes"] = combine_bytes;
+        if (link_bandwidth_gbps > 0)
+        {
+            // Bytes over GB/s to microseconds
+            state.counters["a2a_dispatch_us"] = dispatch_bytes / (link_bandwidth_gbps * 1e3);
+            state.counters["a2a_combine_us"] = combine_bytes / (link_bandwidth_gbps * 1e3);
+        }
+    }
+
     void runBenchmark(benchmark::State& state);
 };
 
@@ -741,6 +935,7 @@ void MixtureOfExpertsBenchmark<TypeTuple_>::runBenchmark(benchmark::State& state
     int tactic_idx1 = state.range(11);
     int tactic_idx2 = state.range(12);
     int const routing_config = state.range(13);
+    int const link_bandwidth_gbps = state.range(14);
 
     state.counters["num_experts"] = num_experts;
     state.counters["top_k"] = top_k;
@@ -754,6 +949,7 @@ void MixtureOfExpertsBenchmark<TypeTuple_>::runBenchmark(benchmark::State& state
     state.counters["act_fn"] = (int) mActType;
     state.counters["norm_mode"] = (int) mNormMode;
     state.counters["routing_config"] = (int) routing_config;
+    state.counters["link_bandwidth_gbps"] = link_bandwidth_gbps;
     state.counters["dtype"] = (int) toDTypeID();
 
     std::stringstream ss;
@@ -770,6 +966,7 @@ void MixtureOfExpertsBenchmark<TypeTuple_>::runBenchmark(benchmark::State& state
     // Always use EP size for moe config until we support TP+EP, we just divide the inter size for TP
     MOEParallelismConfig parallelism_config{tp_size, world_rank / ep_size, ep_size, world_rank % ep_size};
     initBuffersPermute(num_tokens, hidden_size, inter_size, num_experts, top_k, routing_config, parallelism_config);
+    reportRoutingLoad(state, parallelism_config, link_bandwidth_gbps);
 
     // Parse the tactic, does checks for "auto" mode and out of range
     std::tie(tactic_idx1, tactic_idx2) = setTactic(tactic_idx1, tactic_idx2, parallelism_config);
@@ -808,3 +1005,181 @@ void MixtureOfExpertsBenchmark<TypeTuple_>::runBenchmark(benchmark::State& state
     managed_buffers.clear();
     check_cuda_error(cudaDeviceSynchronize());
 }
+
+/**
+ * Benchmarks the routing of the MoE alone: the fused routing kernel against the radix sort of the expanded rows by
+ * expert that the runner does before its permutation kernels.
+ */
+class MoeRoutingBenchmark : public benchmark::Fixture
+{
+public:
+    enum class Backend
+    {
+        CUB_SORT = 0,
+        FUSED = 1
+    };
+
+    void SetUp(benchmark::State& s) override
+    {
+        assert(bufferManager);
+        check_cuda_error(cudaDeviceSynchronize());
+        check_cuda_error(cudaEventCreate(&mStartEvent));
+        check_cuda_error(cudaEventCreate(&mEndEvent));
+    }
+
+    void TearDown(benchmark::State& s) override
+    {
+        managed_buffers.clear();
+
+        check_cuda_error(cudaEventDestroy(mStartEvent));
+        check_cuda_error(cudaEventDestroy(mEndEvent));
+        check_cuda_error(cudaDeviceSynchronize());
+    }
+
+    cudaEvent_t mStartEvent, mEndEvent;
+    std::vector<BufferManager::IBufferPtr> managed_buffers;
+
+    Backend mBackend{};
+    MoeFusedRoutingParams mParams{};
+    int32_t* mSourceRows{};
+    int32_t* mSortedExperts{};
+    void* mSortWorkspace{};
+    size_t mSortWorkspaceSize{};
+    int mSortEndBit{};
+
+    template <class T>
+    T* allocBuffer(size_t size)
+    {
+        managed_buffers.emplace_back(bufferManager->gpu(size * sizeof(T)));
+        T* ptr = static_cast<T*>(managed_buffers.back()->data());
+        check_cuda_error(cudaMemsetAsync(ptr, 0x0, size * sizeof(T), streamPtr->get()));
+        return ptr;
+    }
+
+    void initBuffers(int64_t num_tokens, int64_t num_experts, int64_t k, int64_t routing_config)
+    {
+        auto const num_rows = num_tokens * k;
+        auto* logits = allocBuffer<float>(num_tokens * num_experts);
+        routingConfigCache.at(routing_config)->setRouting(logits, num_experts, k, num_tokens);
+
+        mParams = MoeFusedRoutingParams{};
+        mParams.routingLogits = logits;
+        mParams.expertForSourceRow = allocBuffer<int32_t>(num_rows);
+        mParams.tokenTopkUnpermutedScales = allocBuffer<float>(num_rows);
+        mParams.permutedRowToUnpermutedRow = allocBuffer<int32_t>(num_rows);
+        mParams.unpermutedRowToPermutedRow = allocBuffer<int32_t>(num_rows);
+        mParams.expertFirstTokenOffset = allocBuffer<int64_t>(num_experts + 1);
+        mParams.numTokens = num_tokens;
+        mParams.numExperts = num_experts;
+        mParams.topK = k;
+        mParams.endExpert = num_experts;
+
+        // The sort is given the experts the fused kernel selects, and the same number of key bits as in the runner.
+        invokeMoeFusedRouting(mParams, streamPtr->get());
+        std::vector<int32_t> source_rows(num_rows);
+        std::iota(source_rows.begin(), source_rows.end(), 0);
+        mSourceRows = allocBuffer<int32_t>(num_rows);
+        check_cuda_error(cudaMemcpyAsync(mSourceRows, source_rows.data(), num_rows * sizeof(int32_t),
+            cudaMemcpyHostToDevice, streamPtr->get()));
+        mSortedExperts = allocBuffer<int32_t>(num_rows);
+        mSortEndBit = static_cast<int>(std::log2(num_experts)) + 1;
+        check_cuda_error(cub::DeviceRadixSort::SortPairs(nullptr, mSortWorkspaceSize, mParams.expertForSourceRow,
+            mSortedExperts, mSourceRows, mParams.permutedRowToUnpermutedRow, num_rows, 0, mSortEndBit,
+            streamPtr->get()));
+        mSortWorkspace = allocBuffer<char>(mSortWorkspaceSize);
+        check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+    }
+
+    void runRouting()
+    {
+        if (mBackend == Backend::FUSED)
+        {
+            invokeMoeFusedRouting(mParams, streamPtr->get());
+        }
+        else
+        {
+            check_cuda_error(cub::DeviceRadixSort::SortPairs(mSortWorkspace, mSortWorkspaceSize,
+                mParams.expertForSourceRow, mSortedExperts, mSourceRows, mParams.permutedRowToUnpermutedRow,
+                mParams.numTokens * mParams.topK, 0, mSortEndBit, streamPtr->get()));
+        }
+    }
+
+    cudaGraph_t mGraph{};
+    cudaGraphExec_t mGraphInstance{};
+
+    void createGraph()
+    {
+        if (!useCudaGraph)
+            return;
+
+        check_cuda_error(cudaGraphCreate(&mGraph, 0));
+        check_cuda_error(cudaStreamBeginCapture(streamPtr->get(), cudaStreamCaptureModeThreadLocal));
+        runRouting();
+        check_cuda_error(cudaStreamEndCapture(streamPtr->get(), &mGraph));
+        check_cuda_error(cudaGraphInstantiate(&mGraphInstance, mGraph, nullptr, nullptr, 0));
+    }
+
+    void destroyGraph()
+    {
+        if (!useCudaGraph)
+            return;
+
+        check_cuda_error(cudaGraphExecDestroy(mGraphInstance));
+        check_cuda_error(cudaGraphDestroy(mGraph));
+    }
+
+    float benchmarkLoop()
+    {
+        check_cuda_error(cudaEventRecord(mStartEvent, streamPtr->get()));
+        if (useCudaGraph)
+        {
+            cudaGraphLaunch(mGraphInstance, streamPtr->get());
+        }
+        else
+        {
+            runRouting();
+        }
+        check_cuda_error(cudaEventRecord(mEndEvent, streamPtr->get()));
+        check_cuda_error(cudaStreamSynchronize(streamPtr->get()));
+
+        float ms;
+        check_cuda_error(cudaEventElapsedTime(&ms, mStartEvent, mEndEvent));
+        return ms;
+    }
+
+    void runBenchmark(benchmark::State& state)
+    {
+        NVTX3_SCOPED_RANGE(RoutingBenchmark);
+        int const num_experts = state.range(0);
+        int const top_k = state.range(1);
+        int const num_tokens = state.range(2);
+        int const routing_config = state.range(3);
+        mBackend = static_cast<Backend>(state.range(4));
+
+        state.counters["num_experts"] = num_experts;
+        state.counters["top_k"] = top_k;
+        state.counters["num_tokens"] = num_tokens;
+        state.counters["routing_config"] = routing_config;
+        state.counters["backend"] = static_cast<int>(mBackend);
+        state.SetLabel(routingConfigCache.at(routing_config)->getName());
+
+        if (num_experts > kMoeFusedRoutingMaxExperts)
+        {
+            state.SkipWithMessage("Too many experts for the fused routing");
+            return;
+        }
+
+        initBuffers(num_tokens, num_experts, top_k, routing_config);
+        createGraph();
+        for (auto _ : state)
+        {
+            float ms = benchmarkLoop();
+            state.SetIterationTime(ms / 1000.f);
+        }
+        destroyGraph();
+
+        state.SetItemsProcessed(state.iterations() * num_tokens);
+        managed_buffers.clear();
+        check_cuda_error(cudaDeviceSynchronize());
+    }
+};
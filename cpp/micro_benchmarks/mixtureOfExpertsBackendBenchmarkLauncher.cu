@@ -288,6 +288,30 @@ std::optional<int> loadRoutingValues(nlohmann::json entry, int64_t num_experts,
     return routing_config;
 }
 
+// Routing values of a recorded trace, either inline or the path of a JSON file holding it
+nlohmann::json loadRoutingTrace(nlohmann::json const& entry, int64_t num_experts)
+{
+    std::vector<std::vector<int64_t>> trace;
+    if (entry.is_string())
+    {
+        std::ifstream trace_file{entry.get<std::string>()};
+        if (!trace_file)
+        {
+            throw std::invalid_argument("Could not open routing trace " + entry.get<std::string>());
+        }
+        nlohmann::json::parse(trace_file).get_to(trace);
+    }
+    else
+    {
+        entry.get_to(trace);
+    }
+    if (trace.empty())
+    {
+        throw std::invalid_argument("Routing trace must select the experts of at least one token");
+    }
+    return makeTraceRoutingValues(trace, num_experts);
+}
+
 // This is suboptimal for large benchmark files as we reread it for every data type
 template <class BenchClass>
 void argGenLoadFile(benchmark::internal::Benchmark* benchmark)
@@ -316,7 +340,8 @@ void argGenLoadFile(benchmark::internal::Benchmark* benchmark)
         if (run_config.contains("routing_values_name"))
         {
             run_config["routing_values_name"].get_to(config_name);
-            if (!run_config.contains("routing_values") && !run_config.contains("routing_distribution"))
+            if (!run_config.contains("routing_values") && !run_config.contains("routing_distribution")
+                && !run_config.contains("routing_zipf") && !run_config.contains("routing_trace"))
             {
                 throw std::invalid_argument("Setting routing value configuration name but missing routing values");
             }
@@ -351,6 +376,18 @@ void argGenLoadFile(benchmark::internal::Benchmark* benchmark)
                 routing_config = loadRoutingValues<RandomDistributionRoutingConfig>(
                     run_config["routing_distribution"], num_experts, config_name);
             }
+            else if (run_config.contains("routing_zipf"))
+            {
+                nlohmann::json distribution
+                    = makeZipfDistribution(num_experts, run_config["routing_zipf"].get<double>());
+                routing_config
+                    = loadRoutingValues<RandomDistributionRoutingConfig>(distribution, num_experts, config_name);
+            }
+            else if (run_config.contains("routing_trace"))
+            {
+                routing_config = loadRoutingValues<VectoredRoutingConfig>(
+                    loadRoutingTrace(run_config["routing_trace"], num_experts), num_experts, config_name);
+            }
         }
         // Use the selected config or fall back to balanced
         routing_config = routing_config.value_or(LOAD_BALANCED_ROUTING_CONFIG);
@@ -436,10 +473,22 @@ void argGenLoadFile(benchmark::internal::Benchmark* benchmark)
         auto get_or = [&](auto name, auto def)
         { return run_config.contains(name) ? run_config[name].template get<decltype(def)>() : def; };
         int tp_size = get_or("tp_size", 1);
-        int ep_size = get_or("ep_size", 1);
+        // A list of EP sizes sweeps them, the same rank is benchmarked for each
+        std::vector<int> ep_sizes{1};
+        if (run_config.contains("ep_size"))
+        {
+            ep_sizes = run_config["ep_size"].is_array() ? run_config["ep_size"].get<std::vector<int>>()
+                                                        : std::vector<int>{run_config["ep_size"].get<int>()};
+        }
         int world_rank = get_or("world_rank", 0);
         int bias = get_or("bias", 0);
-        TLLM_CHECK_WITH_INFO(world_rank < tp_size * ep_size, "Rank is out of bounds of tp*ep");
+        int link_bandwidth_gbps = get_or("ep_link_bandwidth_gbps", 0);
+        for (auto ep_size : ep_sizes)
+        {
+            TLLM_CHECK_WITH_INFO(ep_size >= 1 && num_experts % ep_size == 0,
+                "EP size %d does not divide the %d experts", ep_size, num_experts);
+            TLLM_CHECK_WITH_INFO(world_rank < tp_size * ep_size, "Rank is out of bounds of tp*ep");
+        }
 
         auto get_range = [&](std::string name, int min = 1, int max = INT32_MAX)
         {
@@ -451,26 +500,30 @@ void argGenLoadFile(benchmark::internal::Benchmark* benchmark)
             return val;
         };
 
-        for (auto t1 : tactic_ids1)
+        for (auto ep_size : ep_sizes)
         {
-            // tactic_ids2 will have one dummy value if has_tactic_ids2 = false
-            for (auto t2 : tactic_ids2)
+            for (auto t1 : tactic_ids1)
             {
-                if (!has_tactic_ids2)
-                    t2 = t1;
-
-                benchmark->Args({num_experts,                                                      //
-                    get_range("k"),                                                                //
-                    get_range("hidden_size"),                                                      //
-                    get_range("inter_size"),                                                       //
-                    tp_size, ep_size, world_rank,                                                  //
-                    get_range("num_tokens"),                                                       //
-                    bias,                                                                          //
-                    get_range("act_fn", 0, (int) tensorrt_llm::ActivationType::Identity),          //
-                    get_range("norm_mode", 0, (int) MOEExpertScaleNormalizationMode::RENORMALIZE), //
-                    t1,                                                                            //
-                    t2,                                                                            //
-                    *routing_config});
+                // tactic_ids2 will have one dummy value if has_tactic_ids2 = false
+                for (auto t2 : tactic_ids2)
+                {
+                    if (!has_tactic_ids2)
+                        t2 = t1;
+
+                    benchmark->Args({num_experts,                                                      //
+                        get_range("k"),                                                                //
+                        get_range("hidden_size"),                                                      //
+                        get_range("inter_size"),                                                       //
+                        tp_size, ep_size, world_rank,                                                  //
+                        get_range("num_tokens"),                                                       //
+                        bias,                                                                          //
+                        get_range("act_fn", 0, (int) tensorrt_llm::ActivationType::Identity),          //
+                        get_range("norm_mode", 0, (int) MOEExpertScaleNormalizationMode::RENORMALIZE), //
+                        t1,                                                                            //
+                        t2,                                                                            //
+                        *routing_config,                                                               //
+                        link_bandwidth_gbps});
+                }
             }
         }
     }
@@ -508,7 +561,7 @@ void argGenHardcoded(benchmark::internal::Benchmark* benchmark)
                                             for (auto tactic2 : cutlass_tactic)
                                                 for (auto routing : routing_config)
                                                     benchmark->Args({num_expert, k, size, inter_size, 1, 1, 0, tokens,
-                                                        bias, (int) act, (int) norm, tactic1, tactic2, routing});
+                                                        bias, (int) act, (int) norm, tactic1, tactic2, routing, 0});
                     }
 }
 
@@ -531,7 +584,8 @@ void argGen(benchmark::internal::Benchmark* benchmark)
     // Generic setup
     benchmark->UseManualTime();
     benchmark->ArgNames({"Num Experts", "K", "Hidden Size", "Inter Size", "TP Size", "EP Size", "World Rank",
-        "Num Tokens", "Use Bias", "Activation Function", "Norm Mode", "Tactic ID 1", "Tactic ID 2", "Routing ID"});
+        "Num Tokens", "Use Bias", "Activation Function", "Norm Mode", "Tactic ID 1", "Tactic ID 2", "Routing ID",
+        "Link GB/s"});
 
     if (workloadFile)
         argGenLoadFile<BenchClass>(benchmark);
@@ -555,6 +609,31 @@ BENCHMARK_BASIC(SafeFP8, SafeFP8, half)
 BENCHMARK_BASIC(SafeFP4, SafeFP4, half)
 #endif
 
+BENCHMARK_DEFINE_F(MoeRoutingBenchmark, Routing)(benchmark::State& state)
+{
+    runBenchmark(state);
+}
+
+// The decode token counts, where the fixed cost of the routing matters
+void argGenRouting(benchmark::internal::Benchmark* benchmark)
+{
+    auto num_experts = {8, 64, 128, 256};
+    auto top_k = {2, 8};
+    auto num_tokens = {1, 8, 64, 256, 1024};
+    auto routing_config = {UNIFORM_ROUTING_CONFIG};
+    auto backend = {MoeRoutingBenchmark::Backend::CUB_SORT, MoeRoutingBenchmark::Backend::FUSED};
+
+    benchmark->UseManualTime();
+    benchmark->ArgNames({"Num Experts", "K", "Num Tokens", "Routing ID", "Backend"});
+    for (auto num_expert : num_experts)
+        for (auto k : top_k)
+            if (k <= num_expert)
+                for (auto tokens : num_tokens)
+                    for (auto routing : routing_config)
+                        for (auto b : backend)
+                            benchmark->Args({num_expert, k, tokens, routing, (int) b});
+}
+
 void delayedRegisterBenchmark()
 {
     BENCHMARK_BASIC_DO_REGISTER(half, half, half);
@@ -574,6 +653,10 @@ void delayedRegisterBenchmark()
         BENCHMARK_BASIC_DO_REGISTER(SafeFP4, SafeFP4, half);
 #endif
     }
+    else
+    {
+        BENCHMARK_REGISTER_F(MoeRoutingBenchmark, Routing)->Apply(argGenRouting);
+    }
 }
 
 void doCleanup()
@@ -598,7 +681,7 @@ void help()
            "    \"hidden_size\": int,\n"
            "    \"inter_size\": int,\n"
            "    \"tp_size\": int, (optional)\n"
-           "    \"ep_size\": int, (optional)\n"
+           "    \"ep_size\": int or [int, ...], (optional)\n"
            "    \"world_rank\": int, (optional)\n"
            "    \"num_tokens\": int,\n"
            "    \"bias\": int,\n"
@@ -611,6 +694,9 @@ void help()
            "    \"routing_values_name\": string, (optional)\n"
            "    \"routing_values\": [float, ...], or string, (optional, length is a multiple of num_experts)\n"
            "    \"routing_distribution\": [float, ...], or string, (optional, length is num_experts)\n"
+           "    \"routing_zipf\": float, (optional)\n"
+           "    \"routing_trace\": [[int, ...], ...], or string, (optional)\n"
+           "    \"ep_link_bandwidth_gbps\": int, (optional)\n"
            "  },\n"
            "  ...\n"
            "]\n"
@@ -620,7 +706,11 @@ void help()
            "- \"hidden_size\" - The hidden size\n"
            "- \"inter_size\" - The inter size\n"
            "- \"tp_size\" - The TP size to use\n"
-           "- \"ep_size\" - The EP size to use\n"
+           "- \"ep_size\" - The EP size to use, or a list of EP sizes to sweep. The benchmark runs the experts of one "
+           "EP rank and\n"
+           "reports the load of the experts and of the EP ranks, and the rows of the all-to-all dispatch and combine "
+           "of the\n"
+           "slowest rank, with the tokens spread evenly over the ranks\n"
            "- \"world_rank\" - The world rank = tp_rank * ep_size + ep_rank\n"
            "- \"num_tokens\" - The total number of tokens to benchmark\n"
            "- \"bias\" - If bias should be used, 0 = no bias, 1 = bias\n"
@@ -671,6 +761,17 @@ void help()
            "- \"routing_distribution\" - instead of explicitly setting routing_values, define a random distribution "
            "that experts will be randomly sampled from."
            "There is also pre-defined config \"uniform\", which is short-hand for a random uniform distribution\n"
+           "- \"routing_zipf\" - instead of explicitly setting routing_values, sample the experts from a Zipf "
+           "distribution with\n"
+           "this exponent: the i-th most popular expert is selected with a weight of 1 / i^exponent\n"
+           "- \"routing_trace\" - instead of explicitly setting routing_values, replay a recorded routing trace: the "
+           "list of the\n"
+           "experts selected by each token in order of preference, or the path of a JSON file holding it. It repeats "
+           "from the\n"
+           "beginning if `num_tokens` is greater than the number of tokens of the trace\n"
+           "- \"ep_link_bandwidth_gbps\" - the bandwidth of a rank over the all-to-all in GB/s, to estimate the time "
+           "of the\n"
+           "dispatch and of the combine. Defaults to 0, which only reports their bytes\n"
            "\n";
 
     std::cout << "benchmark options:\n";
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/asyncLogSink.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tensorrt_llm::common
+{
+
+namespace
+{
+
+//! \brief Lock-free single producer, single consumer ring of the records of a thread.
+struct LogRing
+{
+    alignas(64) std::atomic<std::uint64_t> head{0};
+    alignas(64) std::atomic<std::uint64_t> tail{0};
+    //! \brief Set when the thread exits, the writer drops the ring once it is drained.
+    std::atomic<bool> closed{false};
+    std::array<LogRecord, AsyncLogSink::kRingCapacity> records;
+};
+
+//! \brief The ring of the calling thread, closed at the exit of the thread.
+struct ThreadRing
+{
+    std::shared_ptr<LogRing> ring;
+
+    ~ThreadRing()
+    {
+        if (ring)
+        {
+            ring->closed.store(true, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadRing tThreadRing;
+
+// Threads may still log during the destruction of the static objects, after the one of the sink.
+std::atomic<bool> gSinkDestroyed{false};
+
+auto constexpr kWriterIdlePeriod = std::chrono::milliseconds(10);
+// Yields of a thread whose ring is full before it logs synchronously.
+auto constexpr kFullRingYields = 1000;
+
+} // namespace
+
+struct AsyncLogSink::Impl
+{
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::vector<std::shared_ptr<LogRing>> rings;
+    bool stop{false};
+    std::thread writer;
+
+    LogRing& getThreadRing()
+    {
+        if (!tThreadRing.ring)
+        {
+            tThreadRing.ring = std::make_shared<LogRing>();
+            std::lock_guard<std::mutex> lock(mutex);
+            rings.push_back(tThreadRing.ring);
+        }
+        return *tThreadRing.ring;
+    }
+};
+
+AsyncLogSink& AsyncLogSink::getInstance()
+{
+    static AsyncLogSink instance;
+    return instance;
+}
+
+bool AsyncLogSink::isEnabled()
+{
+    static bool const enabled = []()
+    {
+        char const* env = std::getenv("TLLM_LOG_ASYNC");
+        return env != nullptr && std::string(env) == "1";
+    }();
+    return enabled && !gSinkDestroyed.load(std::memory_order_relaxed);
+}
+
+AsyncLogSink::AsyncLogSink()
+    : mImpl{new Impl}
+{
+    mImpl->writer = std::thread(&AsyncLogSink::writerLoop, this);
+}
+
+AsyncLogSink::~AsyncLogSink()
+{
+    gSinkDestroyed.store(true, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(mImpl->mutex);
+        mImpl->stop = true;
+    }
+    mImpl->wakeUp.notify_one();
+    mImpl->writer.join();
+    delete mImpl;
+}
+
+LogRecord* AsyncLogSink::acquireRecord()
+{
+    auto& ring = mImpl->getThreadRing();
+    auto const tail = ring.tail.load(std::memory_order_relaxed);
+    for (int yields = 0; tail - ring.head.load(std::memory_order_acquire) >= kRingCapacity; ++yields)
+    {
+        if (yields == kFullRingYields)
+        {
+            return nullptr;
+        }
+        mImpl->wakeUp.notify_one();
+        std::this_thread::yield();
+    }
+    return &ring.records[tail % kRingCapacity];
+}
+
+void AsyncLogSink::commitRecord()
+{
+    auto& ring = *tThreadRing.ring;
+    ring.tail.store(ring.tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void AsyncLogSink::flushThread()
+{
+    if (!tThreadRing.ring)
+    {
+        return;
+    }
+    auto const& ring = *tThreadRing.ring;
+    auto const tail = ring.tail.load(std::memory_order_relaxed);
+    while (ring.head.load(std::memory_order_acquire) < tail)
+    {
+        mImpl->wakeUp.notify_one();
+        std::this_thread::yield();
+    }
+}
+
+void AsyncLogSink::writerLoop()
+{
+    std::vector<std::shared_ptr<LogRing>> rings;
+    std::string line;
+    bool wrote = false;
+    while (true)
+    {
+        bool stop = false;
+        {
+            std::unique_lock<std::mutex> lock(mImpl->mutex);
+            if (!wrote)
+            {
+                mImpl->wakeUp.wait_for(lock, kWriterIdlePeriod);
+            }
+            stop = mImpl->stop;
+            // Drained rings of the threads that exited are dropped, see below.
+            rings = mImpl->rings;
+        }
+
+        wrote = false;
+        std::vector<LogRing const*> drainedClosed;
+        for (auto const& ring : rings)
+        {
+            // Read closed first, so that the records the thread pushed before it exited are drained below.
+            auto const closed = ring->closed.load(std::memory_order_acquire);
+            auto head = ring->head.load(std::memory_order_relaxed);
+            auto const tail = ring->tail.load(std::memory_order_acquire);
+            for (; head < tail; ++head)
+            {
+                auto const& record = ring->records[head % kRingCapacity];
+                line.clear();
+                line += record.rank < 0 ? fmtstr("%s[%s] ", record.prefix, record.levelName)
+                                        : fmtstr("%s[%s][%d] ", record.prefix, record.levelName, record.rank);
+                line += record.format(record);
+                std::cout << line << '\n';
+                ring->head.store(head + 1, std::memory_order_release);
+                wrote = true;
+            }
+            if (closed)
+            {
+                drainedClosed.push_back(ring.get());
+            }
+        }
+        if (wrote)
+        {
+            std::cout.flush();
+        }
+
+        if (!drainedClosed.empty())
+        {
+            std::lock_guard<std::mutex> lock(mImpl->mutex);
+            auto& allRings = mImpl->rings;
+            for (auto const* ring : drainedClosed)
+            {
+                allRings.erase(std::remove_if(allRings.begin(), allRings.end(),
+                                   [ring](auto const& other) { return other.get() == ring; }),
+                    allRings.end());
+            }
+        }
+        if (stop)
+        {
+            break;
+        }
+    }
+}
+
+} // namespace tensorrt_llm::common
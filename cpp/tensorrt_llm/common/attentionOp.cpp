@@ -20,10 +20,13 @@
 #include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/common/memoryUtils.h"
 #include "tensorrt_llm/common/mpiUtils.h"
+#include "tensorrt_llm/kernels/buildRelativeAttentionBiasKernel.h"
 #include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention.h"
 #include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention/decoderXQARunner.h"
+#include "tensorrt_llm/kernels/gatherPagedKvCache.h"
 #include "tensorrt_llm/kernels/gptKernels.h"
 #include "tensorrt_llm/kernels/kvCacheUtils.h"
+#include "tensorrt_llm/kernels/mlaDecodeAttention.h"
 #include "tensorrt_llm/kernels/rmsnormKernels.h"
 #include "tensorrt_llm/kernels/unfusedAttentionKernels.h"
 #include "tensorrt_llm/plugins/common/checkMacrosPlugin.h"
@@ -55,6 +58,7 @@ struct FusedQKVMaskedAttentionDispatchParams
     T const* qkv_buf;
     T const* qkv_bias;
     T const* relative_attention_bias;
+    T const* relative_attention_distance_bias;
     bool const* attention_mask;
     float const* logn_scaling_ptr;
     int const* cache_indir;
@@ -80,6 +84,7 @@ struct FusedQKVMaskedAttentionDispatchParams
     int rotary_cogvlm_vision_length;
     PositionEmbeddingType position_embedding_type;
     bool position_shift_enabled;
+    bool position_shift_in_kernel;
 
     int attention_mask_stride;
     int max_attention_window;
@@ -90,6 +95,7 @@ struct FusedQKVMaskedAttentionDispatchParams
     float q_scaling;
     float attn_logit_softcapping_scale;
     int relative_attention_bias_stride;
+    int relative_attention_distance_bias_stride;
     T const* linear_bias_slopes;
     int const* ia3_tasks;
     T const* ia3_key_weights;
@@ -108,6 +114,7 @@ struct FusedQKVMaskedAttentionDispatchParams
     int* block_counter;
     float const* kv_scale_orig_quant;
     float const* kv_scale_quant_orig;
+    bool kv_scale_per_head = false;
     tc::QuantMode kv_cache_quant_mode;
     int multi_processor_count;
     KVCacheBuffer kv_block_array;
@@ -118,6 +125,8 @@ struct FusedQKVMaskedAttentionDispatchParams
     bool block_sparse_attention = false;
     BlockSparseParams block_sparse_params;
     int32_t const* mrope_position_deltas;
+    float* attention_mass;
+    int32_t const* attention_mass_rows;
 };
 
 template <typename T, typename KVCacheBuffer>
@@ -208,6 +217,10 @@ bool AttentionOp::convertMMHAParamsToXQAParams(tensorrt_llm::kernels::XQAParams&
     {
         xqaParams.kv_cache_data_type = DATA_TYPE_E4M3;
     }
+    else if (mKVCacheQuantMode.hasFp4KvCache())
+    {
+        xqaParams.kv_cache_data_type = DATA_TYPE_E2M1;
+    }
     else
     {
         xqaParams.kv_cache_data_type = xqaParams.data_type;
@@ -307,6 +320,7 @@ void fusedQKV_masked_attention_dispatch(Multihead_attention_params<T_MMHA, CROSS
     {
         params.kv_scale_orig_quant = input_params.kv_scale_orig_quant;
         params.kv_scale_quant_orig = input_params.kv_scale_quant_orig;
+        params.kv_scale_per_head = input_params.kv_scale_per_head;
     }
 
     params.stride = hidden_units + 2 * hidden_units_kv;
@@ -337,6 +351,7 @@ void fusedQKV_masked_attention_dispatch(Multihead_attention_params<T_MMHA, CROSS
     params.rotary_cogvlm_vision_length = input_params.rotary_cogvlm_vision_length;
     params.position_embedding_type = input_params.position_embedding_type;
     params.position_shift_enabled = input_params.position_shift_enabled;
+    params.position_shift_in_kernel = input_params.position_shift_in_kernel;
     // Note: keep norm factor (sqrt(K_dim)) when adopting megatron T5 structure (may adjust)
     params.inv_sqrt_dh = 1.F / (sqrtf((float) params.hidden_size_per_head) * input_params.q_scaling);
     params.attn_logit_softcapping_scale = input_params.attn_logit_softcapping_scale;
@@ -346,6 +361,9 @@ void fusedQKV_masked_attention_dispatch(Multihead_attention_params<T_MMHA, CROSS
     params.relative_attention_bias = reinterpret_cast<DataType const*>(input_params.relative_attention_bias);
     params.relative_attention_bias_stride = input_params.relative_attention_bias_stride;
     params.max_distance = input_params.max_distance;
+    params.relative_attention_distance_bias
+        = reinterpret_cast<DataType const*>(input_params.relative_attention_distance_bias);
+    params.relative_attention_distance_bias_stride = input_params.relative_attention_distance_bias_stride;
     params.block_sparse_attention = input_params.block_sparse_attention;
     params.block_sparse_params = input_params.block_sparse_params;
 
@@ -392,6 +410,8 @@ void fusedQKV_masked_attention_dispatch(Multihead_attention_params<T_MMHA, CROSS
     params.memory_length_per_sample = input_params.memory_length_per_sample;
 
     params.mrope_position_deltas = input_params.mrope_position_deltas;
+    params.attention_mass = input_params.attention_mass;
+    params.attention_mass_rows = input_params.attention_mass_rows;
     sync_check_cuda_error();
 
     masked_multihead_attention(params, input_params.kv_block_array, input_params.shift_k_cache_buffer, stream);
@@ -474,8 +494,11 @@ size_t AttentionOp::getWorkspaceSizeForContext(nvinfer1::DataType type, int32_t
     size_t const cpWorkspaceSize = mCpSize == 1
         ? 0
         : (2 * size * cpMaxPaddedSequenceLength * getHeadSize() * (mNumHeads + 2 * mNumKVHeads) + cu_seqlens_size);
+    // The KV cache of the context requests gathered for the context FMHA, up to the max input length each.
+    size_t const gathered_kv_size
+        = mGatherPagedKvForContextFMHA ? 2 * size * batch_size * input_seq_length * local_hidden_units_kv : 0;
 
-    int const NUM_BUFFERS = 20;
+    int const NUM_BUFFERS = 21;
     size_t workspaces[NUM_BUFFERS];
     workspaces[0] = CUBLAS_WORKSPACE_SIZE;
     workspaces[1] = attention_mask_size;
@@ -497,6 +520,7 @@ size_t AttentionOp::getWorkspaceSizeForContext(nvinfer1::DataType type, int32_t
     workspaces[17] = fmha_bmm1_scale_size;
     workspaces[18] = fmha_bmm2_scale_size;
     workspaces[19] = cpWorkspaceSize;
+    workspaces[20] = gathered_kv_size;
     context_workspace_size = tc::calculateTotalWorkspaceSize(workspaces, NUM_BUFFERS);
 
     return context_workspace_size;
@@ -515,13 +539,17 @@ size_t AttentionOp::getWorkspaceSizeForGeneration(
         size_t cu_seqlens_size = sizeof(int) * (max_num_tokens + 1);
         size_t fmha_scheduler_counter = sizeof(uint32_t);
         size_t o_buffer_size = size * max_num_tokens * mNumHeads * mMLAParams.kv_lora_rank;
-        int const NUM_BUFFERS = 5;
+        size_t const mla_decode_workspace_size = tensorrt_llm::common::getEnvMlaDecodeKernel()
+            ? getMlaDecodeMaxWorkspaceSize(max_num_tokens, mNumHeads, max_attention_window, mMultiProcessorCount)
+            : 0;
+        int const NUM_BUFFERS = 6;
         size_t workspaces[NUM_BUFFERS];
         workspaces[0] = CUBLAS_WORKSPACE_SIZE;
         workspaces[1] = cu_seqlens_size; // cu_q_len
         workspaces[2] = cu_seqlens_size; // cu_kv_len
         workspaces[3] = fmha_scheduler_counter;
         workspaces[4] = o_buffer_size;
+        workspaces[5] = mla_decode_workspace_size;
         generation_workspace_size = tc::calculateTotalWorkspaceSize(workspaces, NUM_BUFFERS);
         return generation_workspace_size;
     }
@@ -533,7 +561,7 @@ size_t AttentionOp::getWorkspaceSizeForGeneration(
     size_t const partial_out_size = size * batch_beam * mNumHeads * mHeadSize * maxSeqLenTile;
     size_t const partial_sum_size = sizeof(float) * batch_beam * mNumHeads * maxSeqLenTile;
     size_t const partial_max_size = sizeof(float) * batch_beam * mNumHeads * maxSeqLenTile;
-    size_t const shift_k_cache_size = (!mPosShiftEnabled || isCrossAttention())
+    size_t const shift_k_cache_size = (!mPosShiftEnabled || isCrossAttention() || rotatePastKeysInKernel())
         ? 0
         : size * batch_beam * mNumHeads * mHeadSize * max_attention_window;
     size_t const cpMaxPaddedSequenceLength = (batch_beam + mCpSize - 1) / mCpSize * mCpSize;
@@ -585,6 +613,16 @@ int AttentionOp::getMaxNumSeqLenTile(int batch_beam_size) const
     return 0;
 }
 
+bool AttentionOp::rotatePastKeysInKernel() const
+{
+    // The kernel rotates unquantized keys with the GPT-J or GPT-NeoX embedding, whose rotated pairs never straddle the
+    // 16-byte vectors it loads.
+    bool const supportedRoPE = mPositionEmbeddingType == PositionEmbeddingType::kROPE_GPTJ
+        || mPositionEmbeddingType == PositionEmbeddingType::kROPE_GPT_NEOX;
+    return mPosShiftEnabled && !isCrossAttention() && supportedRoPE && !mKVCacheQuantMode.hasKvCacheQuant()
+        && mRotaryEmbeddingDim > 0 && (mRotaryEmbeddingDim / 2) % 8 == 0 && !tc::getEnvDisablePosShiftInKernel();
+}
+
 template <typename T>
 int AttentionOp::mlaPreContext(mlaParams<T>& params, cudaStream_t stream)
 {
@@ -720,6 +758,18 @@ int AttentionOp::mlaGeneration(
         = reinterpret_cast<uint32_t*>(nextWorkspacePtr(workspace_byte_ptr, offset, fmha_scheduler_counter));
     T* o_buffer = reinterpret_cast<T*>(nextWorkspacePtr(workspace_byte_ptr, offset, o_buffer_size));
 
+    // The open latent kernel reads the K blocks only, since the V blocks duplicate the latent.
+    bool const use_mla_decode_kernel = tensorrt_llm::common::getEnvMlaDecodeKernel()
+        && mAttnLogitSoftcappingScale == 0.f
+        && generation_params.max_past_kv_length <= generation_params.cyclic_attention_window_size;
+    int const mla_decode_num_splits = use_mla_decode_kernel
+        ? getMlaDecodeNumSplits(batch_beam, params.head_num, generation_params.max_past_kv_length, mMultiProcessorCount)
+        : 1;
+    size_t const mla_decode_workspace_size
+        = getMlaDecodeWorkspaceSize(batch_beam, params.head_num, mla_decode_num_splits);
+    void* mla_decode_workspace = nextWorkspacePtr(workspace_byte_ptr, offset, mla_decode_workspace_size);
+    mLastKernelPath = use_mla_decode_kernel ? KernelPath::kMLA_DECODE : KernelPath::kMLA_FMHA;
+
     params.seqQOffset = cu_q_seqlens;
     params.cu_kv_seqlens = cu_kv_seqlens;
     params.fmha_tile_counter = fmha_tile_counter_ptr;
@@ -732,35 +782,58 @@ int AttentionOp::mlaGeneration(
         mFMHAForceFP32Acc = mFMHAForceFP32Acc || enable_context_fmha_fp32_acc_val == 1;
     }
 
-    MHARunnerParams fmhaParams;
-    memset(&fmhaParams, 0, sizeof(fmhaParams));
-    fmhaParams.b = batch_beam;
-    fmhaParams.qSeqLen = params.head_num;
-    fmhaParams.kvSeqLen = generation_params.max_past_kv_length;
-    // Disable sliding window attention when it is not needed.
-    fmhaParams.slidingWindowSize = generation_params.cyclic_attention_window_size;
-    fmhaParams.totalQSeqLen = batch_beam * params.head_num;
-    // TODO: set it correctly for contiguous kv buffer (cross-attention).
-    // fmhaParams.totalKvSeqLen = params.num_tokens;
-    // Device buffer pointers.
-    // fmhaParams.qkvPtr = reinterpret_cast<void const*>(params.attention_input);
-    fmhaParams.qPtr = reinterpret_cast<void const*>(params.attention_input_buf);
-    // TODO: add contiguous kv buffer (cross-attention).
-    fmhaParams.kvPtr = nullptr;
-    fmhaParams.outputPtr = o_buffer;
-    // fmhaParams.packedMaskPtr = params.fmha_custom_mask;
-    fmhaParams.pagedKvCache = kv_cache_buffer;
-    fmhaParams.cuQSeqLenPtr = cu_q_seqlens;
-    fmhaParams.cuKvSeqLenPtr = cu_kv_seqlens;
-    fmhaParams.cuMaskRowsPtr = nullptr; // mla not support custorm mask right now
-    fmhaParams.tileCounterPtr = fmha_tile_counter_ptr;
-    fmhaParams.scaleBmm1Ptr = nullptr;
-    fmhaParams.scaleBmm2Ptr = nullptr;
-    fmhaParams.stream = stream;
-    fmhaParams.forceFp32Acc = mFMHAForceFP32Acc;
-
-    // Run the fmha kernel
-    mDecoderFMHARunner->run(fmhaParams);
+    if (use_mla_decode_kernel)
+    {
+        MlaDecodeAttentionParams<T> decodeParams;
+        decodeParams.q = params.attention_input_buf;
+        decodeParams.out = o_buffer;
+        decodeParams.kvLengths = params.cache_seq_lens;
+        decodeParams.batchSize = batch_beam;
+        decodeParams.numHeads = params.head_num;
+        decodeParams.kvLoraRank = mMLAParams.kv_lora_rank;
+        decodeParams.qkRopeHeadDim = mMLAParams.qk_rope_head_dim;
+        decodeParams.numSplits = mla_decode_num_splits;
+        // Same softmax scale as the fused MHA path, whose qScaling accounts for its head size of 576.
+        decodeParams.qScale = 1.f
+            / (mQScaling * sqrtf(static_cast<float>(mMLAParams.qk_nope_head_dim + mMLAParams.qk_rope_head_dim)));
+        decodeParams.workspace = mla_decode_workspace;
+        invokeMlaDecodeAttention(decodeParams, kv_cache_buffer, stream);
+    }
+    else
+    {
+        TLLM_CHECK_WITH_INFO(mDecoderFMHARunner->isFmhaSupported(),
+            "The MLA generation is not supported by the fused MHA kernels and cannot use the MLA decode kernel.");
+
+        MHARunnerParams fmhaParams;
+        memset(&fmhaParams, 0, sizeof(fmhaParams));
+        fmhaParams.b = batch_beam;
+        fmhaParams.qSeqLen = params.head_num;
+        fmhaParams.kvSeqLen = generation_params.max_past_kv_length;
+        // Disable sliding window attention when it is not needed.
+        fmhaParams.slidingWindowSize = generation_params.cyclic_attention_window_size;
+        fmhaParams.totalQSeqLen = batch_beam * params.head_num;
+        // TODO: set it correctly for contiguous kv buffer (cross-attention).
+        // fmhaParams.totalKvSeqLen = params.num_tokens;
+        // Device buffer pointers.
+        // fmhaParams.qkvPtr = reinterpret_cast<void const*>(params.attention_input);
+        fmhaParams.qPtr = reinterpret_cast<void const*>(params.attention_input_buf);
+        // TODO: add contiguous kv buffer (cross-attention).
+        fmhaParams.kvPtr = nullptr;
+        fmhaParams.outputPtr = o_buffer;
+        // fmhaParams.packedMaskPtr = params.fmha_custom_mask;
+        fmhaParams.pagedKvCache = kv_cache_buffer;
+        fmhaParams.cuQSeqLenPtr = cu_q_seqlens;
+        fmhaParams.cuKvSeqLenPtr = cu_kv_seqlens;
+        fmhaParams.cuMaskRowsPtr = nullptr; // mla not support custorm mask right now
+        fmhaParams.tileCounterPtr = fmha_tile_counter_ptr;
+        fmhaParams.scaleBmm1Ptr = nullptr;
+        fmhaParams.scaleBmm2Ptr = nullptr;
+        fmhaParams.stream = stream;
+        fmhaParams.forceFp32Acc = mFMHAForceFP32Acc;
+
+        // Run the fmha kernel
+        mDecoderFMHARunner->run(fmhaParams);
+    }
 
     {
         auto transa = CUBLAS_OP_T;
@@ -798,6 +871,11 @@ template <typename T, typename KVCacheBuffer>
 int AttentionOp::enqueueContext(EnqueueContextParams<T> const& params, cudaStream_t stream)
 {
     int const headSize = getHeadSize();
+    // The context kernels that read the quantized KV cache, or write it outside of the QKV preprocessing, use a single
+    // scale.
+    TLLM_CHECK_WITH_INFO(!params.kv_scale_per_head
+            || (mEnableContextFMHA && !mFP8ContextFMHA && !mPagedContextFMHA && !mIsMLAEnabled && !mPosShiftEnabled),
+        "Per-head KV cache scales require the context FMHA, without FP8, paged KV, MLA or position shift.");
 
     int const local_hidden_units_qo = mNumHeads * headSize;
     int const local_hidden_units_kv = mNumKVHeads * headSize;
@@ -805,8 +883,8 @@ int AttentionOp::enqueueContext(EnqueueContextParams<T> const& params, cudaStrea
     float const q_scaling = mQScaling;
 
     KVCacheBuffer kv_cache_buffer;
-    auto const elemSize = mKVCacheQuantMode.hasKvCacheQuant() ? sizeof(int8_t) : sizeof(T);
-    auto sizePerToken = mNumKVHeads * headSize * elemSize;
+    KVCacheBuffer kv_cache_block_scales_buffer;
+    auto sizePerToken = getKvCacheSizePerToken(sizeof(T));
     if (useKVCache())
     {
         if constexpr (std::is_same_v<KVCacheBuffer, KVBlockArray>)
@@ -815,6 +893,15 @@ int AttentionOp::enqueueContext(EnqueueContextParams<T> const& params, cudaStrea
                 sizePerToken, params.cyclic_attention_window_size, params.max_cyclic_attention_window_size,
                 params.sink_token_length, params.can_use_one_more_block, params.host_primary_pool_pointer,
                 params.host_secondary_pool_pointer, params.block_offsets);
+            if (mKVCacheQuantMode.hasFp4KvCache())
+            {
+                // The scale pools have the same blocks as the data pools.
+                kv_cache_block_scales_buffer = KVBlockArray(params.batch_size, params.max_blocks_per_sequence,
+                    mTokensPerBlock, getKvCacheBlockScaleSizePerToken(), params.cyclic_attention_window_size,
+                    params.max_cyclic_attention_window_size, params.sink_token_length, params.can_use_one_more_block,
+                    params.host_primary_block_scale_pool_pointer, params.host_secondary_block_scale_pool_pointer,
+                    params.block_offsets);
+            }
         }
         else if constexpr (std::is_same_v<KVCacheBuffer, KVLinearBuffer>)
         {
@@ -891,6 +978,9 @@ int AttentionOp::enqueueContext(EnqueueContextParams<T> const& params, cudaStrea
     size_t const cpMaxPadedSequenceLength = params.num_tokens + params.batch_size * (mCpSize - 1);
     size_t const cpWorkspaceSize
         = mCpSize == 1 ? 0 : 2 * sizeof(T) * cpMaxPadedSequenceLength * getHeadSize() * (mNumHeads + 2 * mNumKVHeads);
+    size_t const gathered_kv_size = mGatherPagedKvForContextFMHA
+        ? 2 * sizeof(T) * params.batch_size * params.input_seq_length * local_hidden_units_kv
+        : 0;
 
     bool const is_qk_buf_float_ = true;
 
@@ -930,6 +1020,7 @@ int AttentionOp::enqueueContext(EnqueueContextParams<T> const& params, cudaStrea
     T* gatherOutBuffer = gatherInBuffer + cpMaxPadedSequenceLength * getHeadSize() * (mNumHeads + 2 * mNumKVHeads);
     int* cu_cp_partial_seqlens = reinterpret_cast<int*>(
         gatherOutBuffer + cpMaxPadedSequenceLength * getHeadSize() * (mNumHeads + 2 * mNumKVHeads));
+    T* gathered_kv = reinterpret_cast<T*>(nextWorkspacePtr(workspace_byte_ptr, offset, gathered_kv_size));
 
     // build attention_mask, cu_seqlens, and padding_offset tensors
     // Note: self attn and cross attn should use different params
@@ -1021,9 +1112,7 @@ int AttentionOp::enqueueContext(EnqueueContextParams<T> const& params, cudaStrea
         sync_check_cuda_error();
     }
 
-    KvCacheDataType const cache_type = mKVCacheQuantMode.hasInt8KvCache()
-        ? KvCacheDataType::INT8
-        : (mKVCacheQuantMode.hasFp8KvCache() ? KvCacheDataType::FP8 : KvCacheDataType::BASE);
+    KvCacheDataType const cache_type = getKvCacheDataType(mKVCacheQuantMode);
 
     cudaDataType_t const gemm_data_type = tc::CudaDataType<T>::value;
     int const attention_seq_len_1 = params.input_seq_length;                                               // q length
@@ -1114,7 +1203,8 @@ int AttentionOp::enqueueContext(EnqueueContextParams<T> const& params, cudaStrea
         sync_check_cuda_error();
 
         bool const enablePagedKVContextFMHA = mPagedKVCache && mPagedContextFMHA;
-        TLLM_CHECK_WITH_INFO(!(mKVCacheQuantMode.hasInt8KvCache() && enablePagedKVContextFMHA),
+        TLLM_CHECK_WITH_INFO(
+            !(mKVCacheQuantMode.hasInt8KvCache() && enablePagedKVContextFMHA && !mGatherPagedKvForContextFMHA),
             "Paged Context FMHA doesn't work with int8 kv cache currently.");
         TLLM_CHECK_WITH_INFO(!(params.sink_token_length > 0 && enablePagedKVContextFMHA),
             "Cannot support StreamingLLM now when enabling paged KV context FMHA.");
@@ -1131,6 +1221,7 @@ int AttentionOp::enqueueContext(EnqueueContextParams<T> const& params, cudaStrea
         preprocessingParams.quantized_qkv_output = fp8_qkv_buffer;
         preprocessingParams.q_output = q_buf_2_;
         preprocessingParams.kv_cache_buffer = kv_cache_buffer;
+        preprocessingParams.kv_cache_block_scales_buffer = kv_cache_block_scales_buffer;
         preprocessingParams.qkv_bias = params.qkv_bias;
         preprocessingParams.tokens_info = decoder_params.tokensInfo;
         preprocessingParams.seq_lens = params.q_seq_lengths;
@@ -1144,6 +1235,10 @@ int AttentionOp::enqueueContext(EnqueueContextParams<T> const& params, cudaStrea
         preprocessingParams.rotary_coef_cache_buffer = params.rotary_cos_sin;
         preprocessingParams.mrope_rotary_cos_sin = params.mrope_rotary_cos_sin;
         preprocessingParams.kvScaleOrigQuant = params.kv_scale_orig_quant;
+        preprocessingParams.kv_scale_per_head = params.kv_scale_per_head;
+        // The second level scales of the NVFP4 KV cache, K then V.
+        preprocessingParams.kv_cache_scale_factors
+            = mKVCacheQuantMode.hasFp4KvCache() ? params.kv_scale_orig_quant : nullptr;
         preprocessingParams.spec_decoding_position_offsets = nullptr;
         preprocessingParams.logn_scaling = params.logn_scaling_ptr;
 
@@ -1242,6 +1337,28 @@ int AttentionOp::enqueueContext(EnqueueContextParams<T> const& params, cudaStrea
         fmhaParams.qPtr = reinterpret_cast<void const*>(q_buf_2_);
         // TODO: add contiguous kv buffer (cross-attention).
         fmhaParams.kvPtr = nullptr;
+        if constexpr (std::is_same_v<KVCacheBuffer, KVBlockArray>)
+        {
+            if (mGatherPagedKvForContextFMHA)
+            {
+                // Read the previous chunks and the current one, written by the QKV preprocessing, from the cache.
+                GatherPagedKvCacheParams<T> gatherParams;
+                gatherParams.kvOutput = gathered_kv;
+                gatherParams.kvSeqLens = params.kv_seq_lengths;
+                gatherParams.cuKvSeqLens = cu_kv_seqlens;
+                gatherParams.kvScaleQuantOrig = params.kv_scale_quant_orig;
+                gatherParams.kvScalePerHead = params.kv_scale_per_head;
+                gatherParams.cacheType = cache_type;
+                gatherParams.batchSize = params.batch_size;
+                gatherParams.kvHeadNum = mNumKVHeads / mCpSize;
+                gatherParams.sizePerHead = getHeadSize();
+                gatherParams.maxKvSeqLen = max_kv_seq_len;
+                invokeGatherPagedKvCache(gatherParams, kv_cache_buffer, stream);
+                fmhaParams.kvPtr = gathered_kv;
+                // Bounds the tensor map of the contiguous KV, within the gathered buffer.
+                fmhaParams.totalKvSeqLen = params.batch_size * max_kv_seq_len;
+            }
+        }
         fmhaParams.outputPtr
             = mCpSize > 1 ? gatherOutBuffer : params.context_buf; // only use [totalLength, h / cpSize, Dh]
         fmhaParams.outputSfPtr = params.context_buf_sf;
@@ -1262,6 +1379,8 @@ int AttentionOp::enqueueContext(EnqueueContextParams<T> const& params, cudaStrea
 
         // Run the fmha kernel.
         mFmhaDispatcher->run(fmhaParams);
+        mLastKernelPath
+            = mFmhaDispatcher->useTllmGen() ? KernelPath::kCONTEXT_FMHA_TLLM_GEN : KernelPath::kCONTEXT_FMHA;
         sync_check_cuda_error();
 
         // The kv cache might need to be updated after FMHA (only when sliding window attention + chunked context is
@@ -1347,6 +1466,7 @@ int AttentionOp::enqueueContext(EnqueueContextParams<T> const& params, cudaStrea
     }
     else
     {
+        mLastKernelPath = KernelPath::kCONTEXT_UNFUSED;
         TLLM_CHECK_DEBUG_WITH_INFO(params.logn_scaling_ptr == nullptr, "Unfused MHA does not support logn scaling");
         // FIXME: a temporary solution to make sure the padding part of key/value buffer is 0
         // NOTE: pointer subtraction is used below since there could be some extra gap due to alignment.
@@ -1641,6 +1761,50 @@ template int AttentionOp::enqueueContext<__nv_bfloat16, KVBlockArray>(
 
 bool AttentionOp::mForceMultiBlockWarned = false;
 
+char const* AttentionOp::getKernelPathName(KernelPath path)
+{
+    switch (path)
+    {
+    case KernelPath::kNONE: return "none";
+    case KernelPath::kCONTEXT_FMHA: return "context_fmha";
+    case KernelPath::kCONTEXT_FMHA_TLLM_GEN: return "context_fmha_trtllm_gen";
+    case KernelPath::kCONTEXT_UNFUSED: return "context_unfused";
+    case KernelPath::kMMHA: return "mmha";
+    case KernelPath::kMMHA_MULTI_BLOCK: return "mmha_multi_block";
+    case KernelPath::kXQA_PRECOMPILED: return "xqa_precompiled";
+    case KernelPath::kXQA_JIT: return "xqa_jit";
+    case KernelPath::kXQA_TLLM_GEN: return "xqa_trtllm_gen";
+    case KernelPath::kMLA_DECODE: return "mla_decode";
+    case KernelPath::kMLA_FMHA: return "mla_fmha";
+    }
+    return "unknown";
+}
+
+template <typename T>
+T const* AttentionOp::getRelativeAttentionDistanceBias(
+    T const* relativeAttentionTable, int numBuckets, int maxAttentionWindow, cudaStream_t stream)
+{
+    if (mRelativeAttentionDistanceBias != nullptr && mRelativeAttentionDistanceBiasTable == relativeAttentionTable
+        && mRelativeAttentionDistanceBiasStride >= maxAttentionWindow)
+    {
+        return reinterpret_cast<T const*>(mRelativeAttentionDistanceBias.get());
+    }
+    int const numHeads = mNumHeads / mCpSize;
+    int const stride = std::max(maxAttentionWindow, mRelativeAttentionDistanceBiasStride);
+    if (mRelativeAttentionDistanceBias == nullptr || stride > mRelativeAttentionDistanceBiasStride)
+    {
+        char* ptr;
+        deviceMalloc(&ptr, sizeof(T) * numHeads * stride, false);
+        mRelativeAttentionDistanceBias.reset(ptr);
+    }
+    invokeBuildRelativeAttentionDistanceBias(reinterpret_cast<T*>(mRelativeAttentionDistanceBias.get()),
+        relativeAttentionTable, numHeads, stride, numBuckets, mMaxDistance, stream);
+    sync_check_cuda_error();
+    mRelativeAttentionDistanceBiasTable = relativeAttentionTable;
+    mRelativeAttentionDistanceBiasStride = stride;
+    return reinterpret_cast<T const*>(mRelativeAttentionDistanceBias.get());
+}
+
 template <typename T, typename KVCacheBuffer>
 int AttentionOp::enqueueGeneration(EnqueueGenerationParams<T> const& params, cudaStream_t stream)
 {
@@ -1662,8 +1826,8 @@ int AttentionOp::enqueueGeneration(EnqueueGenerationParams<T> const& params, cud
     int32_t const batch_beam = params.beam_width * params.num_requests;
 
     KVCacheBuffer kv_cache_buffer;
-    auto const elemSize = mKVCacheQuantMode.hasKvCacheQuant() ? sizeof(int8_t) : sizeof(T);
-    auto const sizePerToken = mNumKVHeads * headSize * elemSize;
+    KVCacheBuffer kv_cache_block_scales_buffer;
+    auto const sizePerToken = getKvCacheSizePerToken(sizeof(T));
     if (useKVCache())
     {
         if constexpr (std::is_same_v<KVCacheBuffer, KVBlockArray>)
@@ -1673,6 +1837,14 @@ int AttentionOp::enqueueGeneration(EnqueueGenerationParams<T> const& params, cud
                 params.cyclic_attention_window_size, params.max_cyclic_attention_window_size, params.sink_token_length,
                 params.can_use_one_more_block, params.host_primary_pool_pointer, params.host_secondary_pool_pointer,
                 reinterpret_cast<BufferDataType*>(params.block_offsets));
+            if (mKVCacheQuantMode.hasFp4KvCache())
+            {
+                kv_cache_block_scales_buffer = KVBlockArray(batch_beam, params.max_blocks_per_sequence,
+                    mTokensPerBlock, getKvCacheBlockScaleSizePerToken(), params.cyclic_attention_window_size,
+                    params.max_cyclic_attention_window_size, params.sink_token_length, params.can_use_one_more_block,
+                    params.host_primary_block_scale_pool_pointer, params.host_secondary_block_scale_pool_pointer,
+                    reinterpret_cast<BufferDataType*>(params.block_offsets));
+            }
         }
         else if constexpr (std::is_same_v<KVCacheBuffer, KVLinearBuffer>)
         {
@@ -1719,17 +1891,24 @@ int AttentionOp::enqueueGeneration(EnqueueGenerationParams<T> const& params, cud
         }
     }
 
+    // The attention mass of the cached tokens is only accumulated by the single-block MMHA kernels.
+    bool const accumulateAttentionMass = params.attention_mass != nullptr;
+
     // Try XQA optimization first.
     {
         // NOTE: input_seq_length = num_medusa_tokens + 1 (new generated one from the original LM head)
         // self attn
         XQAParams xqaParams{};
         this->template convertMMHAParamsToXQAParams<T, KVCacheBuffer>(xqaParams, params, /*forConfigurePlugin=*/false);
-        if (mEnableXQA && mXqaDispatcher->shouldUse(xqaParams))
+        // XQA kernels read the KV cache with a single scale.
+        if (mEnableXQA && !accumulateAttentionMass && !params.kv_scale_per_head && mXqaDispatcher->shouldUse(xqaParams))
         {
             TLLM_LOG_DEBUG("XQA kernels are selected in the generation phase.");
             xqaParams.stream = stream;
-            mXqaDispatcher->run(xqaParams, kv_cache_buffer);
+            mLastKernelPath = mXqaDispatcher->useTllmGen()
+                ? KernelPath::kXQA_TLLM_GEN
+                : (mXqaDispatcher->useJitImpl(xqaParams) ? KernelPath::kXQA_JIT : KernelPath::kXQA_PRECOMPILED);
+            mXqaDispatcher->run(xqaParams, kv_cache_buffer, kv_cache_block_scales_buffer);
             return 0;
         }
         else if (mIsSpecDecodingEnabled && mUseSpecDecoding)
@@ -1740,6 +1919,10 @@ int AttentionOp::enqueueGeneration(EnqueueGenerationParams<T> const& params, cud
         {
             TLLM_CHECK_WITH_INFO(false, "No available kernels are found for FP4 output.");
         }
+        else if (mKVCacheQuantMode.hasFp4KvCache())
+        {
+            TLLM_CHECK_WITH_INFO(false, "No available kernels are found for the NVFP4 KV cache.");
+        }
     }
 
     // This is the number of kv tokens that q needs to visit, but excluding one as it will be processed before the kv
@@ -1763,15 +1946,26 @@ int AttentionOp::enqueueGeneration(EnqueueGenerationParams<T> const& params, cud
     // Runtime check to see the actual number of blocks per sequence we need.
     int32_t const max_num_seq_len_tiles = std::max(getMaxNumSeqLenTile(batch_beam), estimated_min_multi_block_count);
     int32_t const min_num_seq_len_tiles = std::max(1, estimated_min_multi_block_count);
-    bool const enable_multi_block
-        = (mMultiBlockMode && max_num_seq_len_tiles > 1) || estimated_min_multi_block_count > 1;
+    bool const enable_multi_block = (mMultiBlockMode && !accumulateAttentionMass && max_num_seq_len_tiles > 1)
+        || estimated_min_multi_block_count > 1;
+    if (accumulateAttentionMass && estimated_min_multi_block_count > 1)
+    {
+        static bool attentionMassWarned{false};
+        if (!attentionMassWarned)
+        {
+            attentionMassWarned = true;
+            TLLM_LOG_WARNING(
+                "The attention mass is not accumulated as the KV cache is too long for single-block MMHA, "
+                "the token eviction budget should be lowered.");
+        }
+    }
     size_t const partial_out_size
         = enable_multi_block ? sizeof(T) * batch_beam * mNumHeads * mHeadSize * max_num_seq_len_tiles : 0;
     size_t const partial_sum_size
         = enable_multi_block ? sizeof(float) * batch_beam * mNumHeads * max_num_seq_len_tiles : 0;
     size_t const partial_max_size
         = enable_multi_block ? sizeof(float) * batch_beam * mNumHeads * max_num_seq_len_tiles : 0;
-    size_t const shift_k_cache_size = (!mPosShiftEnabled || isCrossAttention())
+    size_t const shift_k_cache_size = (!mPosShiftEnabled || isCrossAttention() || rotatePastKeysInKernel())
         ? 0
         : sizeof(T) * batch_beam * mNumHeads * mHeadSize * params.max_attention_window;
     size_t const cpMaxPaddedSequenceLength = (batch_beam + mCpSize - 1) / mCpSize * mCpSize;
@@ -1788,7 +1982,7 @@ int AttentionOp::enqueueGeneration(EnqueueGenerationParams<T> const& params, cud
 
     // Apply position embedding to the keys in the K cache
     KVLinearBuffer shift_k_cache_buffer;
-    if (useKVCache() && mPosShiftEnabled && !isCrossAttention())
+    if (useKVCache() && mPosShiftEnabled && !isCrossAttention() && !rotatePastKeysInKernel())
     {
         shift_k_cache_buffer
             = KVLinearBuffer(batch_beam, params.max_attention_window, sizePerToken, params.cyclic_attention_window_size,
@@ -1860,6 +2054,13 @@ int AttentionOp::enqueueGeneration(EnqueueGenerationParams<T> const& params, cud
     dispatch_params.attention_mask = params.attention_mask;
     dispatch_params.attention_mask_stride = params.attention_mask_stride;
     dispatch_params.max_distance = max_distance;
+    if (relative_attention_bias != nullptr && max_distance > 0)
+    {
+        // Implicit mode: the bias of a distance is the same at every step, gather it from the table once.
+        dispatch_params.relative_attention_distance_bias = getRelativeAttentionDistanceBias(
+            relative_attention_bias, relative_attention_bias_stride, params.max_attention_window, stream);
+        dispatch_params.relative_attention_distance_bias_stride = mRelativeAttentionDistanceBiasStride;
+    }
     dispatch_params.cache_indir = params.cache_indir;
     dispatch_params.context_buf = mCpSize > 1 ? mhaOutput : params.context_buf; //
     dispatch_params.finished = finished;
@@ -1889,6 +2090,7 @@ int AttentionOp::enqueueGeneration(EnqueueGenerationParams<T> const& params, cud
     dispatch_params.attention_out_scale = params.attention_output_orig_quant;
     dispatch_params.quant_option = quant_option;
     dispatch_params.multi_block_mode = enable_multi_block;
+    mLastKernelPath = enable_multi_block ? KernelPath::kMMHA_MULTI_BLOCK : KernelPath::kMMHA;
     dispatch_params.max_seq_len_tile = max_num_seq_len_tiles;
     dispatch_params.min_seq_len_tile = min_num_seq_len_tiles;
     dispatch_params.partial_out = partial_out;
@@ -1898,6 +2100,7 @@ int AttentionOp::enqueueGeneration(EnqueueGenerationParams<T> const& params, cud
     dispatch_params.kv_cache_quant_mode = mKVCacheQuantMode;
     dispatch_params.kv_scale_orig_quant = params.kv_scale_orig_quant;
     dispatch_params.kv_scale_quant_orig = params.kv_scale_quant_orig;
+    dispatch_params.kv_scale_per_head = params.kv_scale_per_head;
     dispatch_params.kv_block_array = kv_cache_buffer;
     dispatch_params.shift_k_cache_buffer = shift_k_cache_buffer;
     dispatch_params.multi_processor_count = mMultiProcessorCount;
@@ -1910,6 +2113,7 @@ int AttentionOp::enqueueGeneration(EnqueueGenerationParams<T> const& params, cud
     dispatch_params.rotary_embedding_max_positions = mRotaryEmbeddingMaxPositions;
     dispatch_params.rotary_embedding_original_max_positions = mRotaryEmbeddingOriginalMaxPositions;
     dispatch_params.position_shift_enabled = mPosShiftEnabled;
+    dispatch_params.position_shift_in_kernel = rotatePastKeysInKernel();
     dispatch_params.rotary_cogvlm_vision_start = mVisionStart;
     dispatch_params.rotary_cogvlm_vision_length = mVisionLength;
     dispatch_params.cross_attention = isCrossAttention();
@@ -1917,6 +2121,8 @@ int AttentionOp::enqueueGeneration(EnqueueGenerationParams<T> const& params, cud
     dispatch_params.block_sparse_attention = mMaskType == AttentionMaskType::BLOCKSPARSE;
     dispatch_params.block_sparse_params = mBlockSparseParams;
     dispatch_params.mrope_position_deltas = params.mrope_position_deltas;
+    dispatch_params.attention_mass = params.attention_mass;
+    dispatch_params.attention_mass_rows = params.attention_mass_rows;
 
     using DataType = typename SATypeConverter<T>::Type;
     if (!isCrossAttention())
@@ -2206,7 +2412,32 @@ int AttentionOp::initialize() noexcept
         }
 
         // Load kernels from the pre-compiled cubins.
-        mFmhaDispatcher.reset(new FmhaDispatcher(fmhaParams));
+        bool const pagedKvInput
+            = fmhaParams.attentionInputLayout == AttentionInputLayout::Q_PAGED_KV && !isCrossAttention();
+        // Only the TRTLLM-GEN kernels read a KV cache type that differs from the input type.
+        bool const kvTypeSupported = mSM == 100 || fmhaParams.dataTypeKv == fmhaParams.dataType;
+        mFmhaDispatcher.reset(kvTypeSupported ? new FmhaDispatcher(fmhaParams) : nullptr);
+        mGatherPagedKvForContextFMHA = false;
+        if (pagedKvInput && !mFP8ContextFMHA && (!mFmhaDispatcher || !mFmhaDispatcher->isSupported()))
+        {
+            // Gather the KV cache into the workspace for the kernels with contiguous KV input, so that chunked context
+            // and reused blocks do not fall back to the unfused MHA.
+            auto contiguousKvParams = fmhaParams;
+            contiguousKvParams.attentionInputLayout = AttentionInputLayout::Q_CONTIGUOUS_KV;
+            contiguousKvParams.dataTypeKv = fmhaParams.dataType;
+            auto contiguousKvDispatcher = std::make_unique<FmhaDispatcher>(contiguousKvParams);
+            if (contiguousKvDispatcher->isSupported())
+            {
+                TLLM_LOG_INFO("Paged context FMHA gathers the KV cache for the kernels with contiguous KV input.");
+                mFmhaDispatcher.reset(contiguousKvDispatcher.release());
+                mGatherPagedKvForContextFMHA = true;
+            }
+        }
+        if (!mFmhaDispatcher)
+        {
+            // Reports the unsupported KV cache type.
+            mFmhaDispatcher.reset(new FmhaDispatcher(fmhaParams));
+        }
 
         // Deepseek-V2 Generation needs a differ fmha with different argumments
         if (mIsMLAEnabled)
@@ -2235,8 +2466,9 @@ int AttentionOp::initialize() noexcept
             fmhaParams.tpRank = mTpRank;
             mDecoderFMHARunner.reset(new FusedMHARunnerV2(fmhaParams));
 
-            // Only deepseek must using fmha.
-            TLLM_CHECK_WITH_INFO(mFmhaDispatcher->isSupported() && mDecoderFMHARunner->isFmhaSupported(),
+            // Only deepseek must using fmha. The generation may run the open MLA decode kernel instead.
+            TLLM_CHECK_WITH_INFO(mFmhaDispatcher->isSupported()
+                    && (mDecoderFMHARunner->isFmhaSupported() || tensorrt_llm::common::getEnvMlaDecodeKernel()),
                 "Deepseek should be supported by fmha in context and generation part.");
         }
 
@@ -2280,6 +2512,12 @@ int AttentionOp::initialize() noexcept
             fixedParams.kvDataType = DATA_TYPE_E4M3;
             fixedParams.mathDataType = DATA_TYPE_E4M3;
         }
+        else if (mKVCacheQuantMode.hasFp4KvCache())
+        {
+            // The trtllm-gen kernels dequantize the NVFP4 KV cache to FP8 for the BMMs.
+            fixedParams.kvDataType = DATA_TYPE_E2M1;
+            fixedParams.mathDataType = DATA_TYPE_E4M3;
+        }
         else
         {
             fixedParams.kvDataType = fixedParams.inputDataType;
@@ -2322,6 +2560,15 @@ int AttentionOp::initialize() noexcept
         TLLM_CHECK_WITH_INFO(false, "Speculative decoding mode doesn't support the data type or cross attention.");
     }
 
+    if (mKVCacheQuantMode.hasFp4KvCache())
+    {
+        // Only the QKV preprocessing writes the NVFP4 KV cache and only the trtllm-gen generation kernels read it.
+        TLLM_CHECK_WITH_INFO(mPagedKVCache && mEnableXQA && mXqaDispatcher->useTllmGen(),
+            "The NVFP4 KV cache requires the paged KV cache and the trtllm-gen generation kernels (SM100).");
+        TLLM_CHECK_WITH_INFO(mEnableContextFMHA && !mPagedContextFMHA && !isCrossAttention() && !mIsMLAEnabled,
+            "The NVFP4 KV cache requires the context FMHA without paged KV, cross attention or MLA.");
+    }
+
     if (mNbMultiBlockSemaphores != 0)
     {
         reserveSemaphoreArray(mNbMultiBlockSemaphores);
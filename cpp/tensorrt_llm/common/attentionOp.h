@@ -108,6 +108,12 @@ public:
         void* workspace = nullptr;
         float2 const* mrope_rotary_cos_sin = nullptr;
 
+        // optional when the INT8/FP8 KV cache has one scale per KV head, i.e. kv_scale_orig_quant and
+        // kv_scale_quant_orig are [num_kv_heads] instead of [1]
+        bool kv_scale_per_head = false;
+        // optional when the KV cache is NVFP4, the pools of the FP8 scales of every 16 elements
+        void* host_primary_block_scale_pool_pointer = nullptr;
+        void* host_secondary_block_scale_pool_pointer = nullptr;
         // optional when logn scaling
         float const* logn_scaling_ptr = nullptr;
         // optional when relative position
@@ -150,6 +156,7 @@ public:
                << std::endl;
             ss << "kv_scale_orig_quant: " << kv_scale_orig_quant << std::endl;
             ss << "kv_scale_quant_orig: " << kv_scale_quant_orig << std::endl;
+            ss << "kv_scale_per_head: " << (kv_scale_per_head ? "true" : "false") << std::endl;
             ss << "attention_output_orig_quant: " << attention_output_orig_quant << std::endl;
             ss << "alibi_slopes: " << alibi_slopes << std::endl;
             ss << "context_buf: " << context_buf << std::endl;
@@ -159,6 +166,8 @@ public:
             ss << "host_block_offsets: " << host_block_offsets << std::endl;
             ss << "host_primary_pool_pointer: " << host_primary_pool_pointer << std::endl;
             ss << "host_secondary_pool_pointer: " << host_secondary_pool_pointer << std::endl;
+            ss << "host_primary_block_scale_pool_pointer: " << host_primary_block_scale_pool_pointer << std::endl;
+            ss << "host_secondary_block_scale_pool_pointer: " << host_secondary_block_scale_pool_pointer << std::endl;
             ss << "batch_size: " << batch_size << std::endl;
             ss << "num_tokens: " << num_tokens << std::endl;
             ss << "max_blocks_per_sequence: " << max_blocks_per_sequence << std::endl;
@@ -224,6 +233,12 @@ public:
         int32_t const* host_past_key_value_lengths = nullptr;
         int32_t const* mrope_position_deltas = nullptr;
 
+        // optional when the INT8/FP8 KV cache has one scale per KV head, i.e. kv_scale_orig_quant and
+        // kv_scale_quant_orig are [num_kv_heads] instead of [1]
+        bool kv_scale_per_head = false;
+        // optional when the KV cache is NVFP4, the pools of the FP8 scales of every 16 elements
+        void* host_primary_block_scale_pool_pointer = nullptr;
+        void* host_secondary_block_scale_pool_pointer = nullptr;
         // optional when logn scaling
         float const* logn_scaling_ptr = nullptr;
         // optional when relative position
@@ -243,6 +258,9 @@ public:
         int64_t const* runtime_perf_knobs = nullptr;
         // optional when fuse_fp4_quant is enabled
         int32_t start_token_idx_sf = 0;
+        // optional when attention-score-based token eviction is enabled
+        float* attention_mass = nullptr;
+        int32_t const* attention_mass_rows = nullptr;
     };
 
     template <typename T, typename KVCacheBuffer>
@@ -317,6 +335,29 @@ public:
         return mUseKVCache;
     }
 
+    // Bytes of the K or V cache of one token in the data pools, half a byte per element with the NVFP4 KV cache.
+    size_t getKvCacheSizePerToken(size_t elemSize) const
+    {
+        auto const numElems = static_cast<size_t>(mNumKVHeads) * getHeadSize();
+        if (mKVCacheQuantMode.hasFp4KvCache())
+        {
+            return numElems / 2;
+        }
+        return numElems * (mKVCacheQuantMode.hasKvCacheQuant() ? sizeof(int8_t) : elemSize);
+    }
+
+    // Bytes of the FP8 block scales of one token of the NVFP4 KV cache, one scale per kFp4KvCacheBlockSize elements.
+    size_t getKvCacheBlockScaleSizePerToken() const
+    {
+        return static_cast<size_t>(mNumKVHeads) * getHeadSize() / kFp4KvCacheBlockSize;
+    }
+
+    static constexpr int kFp4KvCacheBlockSize = 16;
+
+    // Whether the generation kernel rotates the keys of the position shift, kept without position embedding in the KV
+    // cache, by their position in the window while loading them, so that no rotated copy of the K cache is written.
+    bool rotatePastKeysInKernel() const;
+
     bool useCustomMask() const
     {
         return mMaskType == tensorrt_llm::kernels::AttentionMaskType::CUSTOM_MASK;
@@ -334,8 +375,37 @@ public:
 
     void reserveSemaphoreArray(int32_t size);
 
+    // Returns the bias of every head and distance gathered from the implicit relative attention table, built on the
+    // first generation step and reused until the table or the attention window changes.
+    template <typename T>
+    T const* getRelativeAttentionDistanceBias(
+        T const* relativeAttentionTable, int numBuckets, int maxAttentionWindow, cudaStream_t stream);
+
     void debugCheckSemaphores(cudaStream_t stream);
 
+    // The kernels the last enqueue dispatched the attention to.
+    enum class KernelPath : int8_t
+    {
+        kNONE,
+        kCONTEXT_FMHA,
+        kCONTEXT_FMHA_TLLM_GEN,
+        kCONTEXT_UNFUSED,
+        kMMHA,
+        kMMHA_MULTI_BLOCK,
+        kXQA_PRECOMPILED,
+        kXQA_JIT,
+        kXQA_TLLM_GEN,
+        kMLA_DECODE,
+        kMLA_FMHA
+    };
+
+    static char const* getKernelPathName(KernelPath path);
+
+    KernelPath getLastKernelPath() const
+    {
+        return mLastKernelPath;
+    }
+
     static constexpr int kReservedMaxSeqLenTilePerSeq = 64;
 
     int mLayerIdx = -1;
@@ -399,6 +469,9 @@ public:
     // fmha runner (enabled by default)
     // flag: disabled = 0, enabled = 1, enabled with fp32 accumulation = 2
     bool mEnableContextFMHA = true;
+    // The paged context FMHA runs the kernels with contiguous KV input on the KV cache gathered into the workspace,
+    // since no paged KV kernel exists for the configuration.
+    bool mGatherPagedKvForContextFMHA = false;
     bool mFMHAForceFP32Acc = false;
     int mSM = tensorrt_llm::common::getSMVersion();
     bool mUseTllmGen = (mSM >= 100);
@@ -427,6 +500,9 @@ public:
 
     bool mSkipAttn = false;
 
+    // Set by enqueueContext, enqueueGeneration and mlaGeneration, for the benchmarks and the debug logs.
+    KernelPath mLastKernelPath = KernelPath::kNONE;
+
     struct Deleter
     {
         void operator()(void* ptr)
@@ -437,6 +513,12 @@ public:
 
     UniqPtrWNullCopy<int32_t[], Deleter> mMultiBlockSemaphores = {};
 
+    // Distance bias [mNumHeads / mCpSize, mRelativeAttentionDistanceBiasStride] gathered from the relative attention
+    // table mRelativeAttentionDistanceBiasTable, see getRelativeAttentionDistanceBias.
+    UniqPtrWNullCopy<char[], Deleter> mRelativeAttentionDistanceBias = {};
+    void const* mRelativeAttentionDistanceBiasTable = nullptr;
+    int mRelativeAttentionDistanceBiasStride = 0;
+
     std::string toString() const
     {
         // member variables
@@ -473,6 +555,7 @@ public:
         ss << "mFP8ContextFMHA: " << std::boolalpha << mFP8ContextFMHA << std::endl;
         ss << "mDenseContextFMHA: " << std::boolalpha << mDenseContextFMHA << std::endl;
         ss << "mEnableContextFMHA: " << std::boolalpha << mEnableContextFMHA << std::endl;
+        ss << "mGatherPagedKvForContextFMHA: " << std::boolalpha << mGatherPagedKvForContextFMHA << std::endl;
         ss << "mFMHAForceFP32Acc: " << std::boolalpha << mFMHAForceFP32Acc << std::endl;
         ss << "mSM: " << mSM << std::endl;
         ss << "mUseTllmGen: " << mUseTllmGen << std::endl;
@@ -86,6 +86,16 @@ CUDADriverWrapper::CUDADriverWrapper()
     *reinterpret_cast<void**>(&_cuTensorMapEncodeTiled) = load_sym(handle, "cuTensorMapEncodeTiled");
     *reinterpret_cast<void**>(&_cuMemcpyDtoH) = load_sym(handle, "cuMemcpyDtoH_v2");
     *reinterpret_cast<void**>(&_cuDeviceGetAttribute) = load_sym(handle, "cuDeviceGetAttribute");
+    *reinterpret_cast<void**>(&_cuMemAddressReserve) = load_sym(handle, "cuMemAddressReserve");
+    *reinterpret_cast<void**>(&_cuMemAddressFree) = load_sym(handle, "cuMemAddressFree");
+    *reinterpret_cast<void**>(&_cuMemCreate) = load_sym(handle, "cuMemCreate");
+    *reinterpret_cast<void**>(&_cuMemRelease) = load_sym(handle, "cuMemRelease");
+    *reinterpret_cast<void**>(&_cuMemMap) = load_sym(handle, "cuMemMap");
+    *reinterpret_cast<void**>(&_cuMemUnmap) = load_sym(handle, "cuMemUnmap");
+    *reinterpret_cast<void**>(&_cuMemSetAccess) = load_sym(handle, "cuMemSetAccess");
+    *reinterpret_cast<void**>(&_cuMemGetAllocationGranularity) = load_sym(handle, "cuMemGetAllocationGranularity");
+    *reinterpret_cast<void**>(&_cuMemExportToShareableHandle) = load_sym(handle, "cuMemExportToShareableHandle");
+    *reinterpret_cast<void**>(&_cuMemImportFromShareableHandle) = load_sym(handle, "cuMemImportFromShareableHandle");
 }
 
 CUDADriverWrapper::~CUDADriverWrapper()
@@ -197,4 +207,61 @@ CUresult CUDADriverWrapper::cuDeviceGetAttribute(int* pi, CUdevice_attribute att
     return (*_cuDeviceGetAttribute)(pi, attrib, dev);
 }
 
+CUresult CUDADriverWrapper::cuMemAddressReserve(
+    CUdeviceptr* ptr, size_t size, size_t alignment, CUdeviceptr addr, unsigned long long flags) const
+{
+    return (*_cuMemAddressReserve)(ptr, size, alignment, addr, flags);
+}
+
+CUresult CUDADriverWrapper::cuMemAddressFree(CUdeviceptr ptr, size_t size) const
+{
+    return (*_cuMemAddressFree)(ptr, size);
+}
+
+CUresult CUDADriverWrapper::cuMemCreate(
+    CUmemGenericAllocationHandle* handle, size_t size, CUmemAllocationProp const* prop, unsigned long long flags) const
+{
+    return (*_cuMemCreate)(handle, size, prop, flags);
+}
+
+CUresult CUDADriverWrapper::cuMemRelease(CUmemGenericAllocationHandle handle) const
+{
+    return (*_cuMemRelease)(handle);
+}
+
+CUresult CUDADriverWrapper::cuMemMap(
+    CUdeviceptr ptr, size_t size, size_t offset, CUmemGenericAllocationHandle handle, unsigned long long flags) const
+{
+    return (*_cuMemMap)(ptr, size, offset, handle, flags);
+}
+
+CUresult CUDADriverWrapper::cuMemUnmap(CUdeviceptr ptr, size_t size) const
+{
+    return (*_cuMemUnmap)(ptr, size);
+}
+
+CUresult CUDADriverWrapper::cuMemSetAccess(
+    CUdeviceptr ptr, size_t size, CUmemAccessDesc const* desc, size_t count) const
+{
+    return (*_cuMemSetAccess)(ptr, size, desc, count);
+}
+
+CUresult CUDADriverWrapper::cuMemGetAllocationGranularity(
+    size_t* granularity, CUmemAllocationProp const* prop, CUmemAllocationGranularity_flags option) const
+{
+    return (*_cuMemGetAllocationGranularity)(granularity, prop, option);
+}
+
+CUresult CUDADriverWrapper::cuMemExportToShareableHandle(void* shareableHandle, CUmemGenericAllocationHandle handle,
+    CUmemAllocationHandleType handleType, unsigned long long flags) const
+{
+    return (*_cuMemExportToShareableHandle)(shareableHandle, handle, handleType, flags);
+}
+
+CUresult CUDADriverWrapper::cuMemImportFromShareableHandle(
+    CUmemGenericAllocationHandle* handle, void* osHandle, CUmemAllocationHandleType shHandleType) const
+{
+    return (*_cuMemImportFromShareableHandle)(handle, osHandle, shHandleType);
+}
+
 } // namespace tensorrt_llm::common
@@ -83,6 +83,32 @@ public:
 
     CUresult cuDeviceGetAttribute(int* pi, CUdevice_attribute attrib, CUdevice dev) const;
 
+    CUresult cuMemAddressReserve(
+        CUdeviceptr* ptr, size_t size, size_t alignment, CUdeviceptr addr, unsigned long long flags) const;
+
+    CUresult cuMemAddressFree(CUdeviceptr ptr, size_t size) const;
+
+    CUresult cuMemCreate(CUmemGenericAllocationHandle* handle, size_t size, CUmemAllocationProp const* prop,
+        unsigned long long flags) const;
+
+    CUresult cuMemRelease(CUmemGenericAllocationHandle handle) const;
+
+    CUresult cuMemMap(CUdeviceptr ptr, size_t size, size_t offset, CUmemGenericAllocationHandle handle,
+        unsigned long long flags) const;
+
+    CUresult cuMemUnmap(CUdeviceptr ptr, size_t size) const;
+
+    CUresult cuMemSetAccess(CUdeviceptr ptr, size_t size, CUmemAccessDesc const* desc, size_t count) const;
+
+    CUresult cuMemGetAllocationGranularity(
+        size_t* granularity, CUmemAllocationProp const* prop, CUmemAllocationGranularity_flags option) const;
+
+    CUresult cuMemExportToShareableHandle(void* shareableHandle, CUmemGenericAllocationHandle handle,
+        CUmemAllocationHandleType handleType, unsigned long long flags) const;
+
+    CUresult cuMemImportFromShareableHandle(
+        CUmemGenericAllocationHandle* handle, void* osHandle, CUmemAllocationHandleType shHandleType) const;
+
 private:
     void* handle;
     CUDADriverWrapper();
@@ -112,6 +138,18 @@ private:
         CUtensorMapSwizzle swizzle, CUtensorMapL2promotion l2Promotion, CUtensorMapFloatOOBfill oobFill);
     CUresult (*_cuMemcpyDtoH)(void* dstHost, CUdeviceptr srcDevice, size_t ByteCount);
     CUresult (*_cuDeviceGetAttribute)(int*, CUdevice_attribute attrib, CUdevice dev);
+    CUresult (*_cuMemAddressReserve)(CUdeviceptr*, size_t, size_t, CUdeviceptr, unsigned long long);
+    CUresult (*_cuMemAddressFree)(CUdeviceptr, size_t);
+    CUresult (*_cuMemCreate)(CUmemGenericAllocationHandle*, size_t, CUmemAllocationProp const*, unsigned long long);
+    CUresult (*_cuMemRelease)(CUmemGenericAllocationHandle);
+    CUresult (*_cuMemMap)(CUdeviceptr, size_t, size_t, CUmemGenericAllocationHandle, unsigned long long);
+    CUresult (*_cuMemUnmap)(CUdeviceptr, size_t);
+    CUresult (*_cuMemSetAccess)(CUdeviceptr, size_t, CUmemAccessDesc const*, size_t);
+    CUresult (*_cuMemGetAllocationGranularity)(
+        size_t*, CUmemAllocationProp const*, CUmemAllocationGranularity_flags);
+    CUresult (*_cuMemExportToShareableHandle)(
+        void*, CUmemGenericAllocationHandle, CUmemAllocationHandleType, unsigned long long);
+    CUresult (*_cuMemImportFromShareableHandle)(CUmemGenericAllocationHandle*, void*, CUmemAllocationHandleType);
 };
 
 template <typename T>
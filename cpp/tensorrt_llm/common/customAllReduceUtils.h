@@ -16,8 +16,21 @@
 
 #pragma once
 
+#include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/kernels/customAllReduceKernels.h"
+
 #include <cstddef>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace tensorrt_llm::utils::customAllReduceUtils
 {
@@ -38,4 +51,228 @@ inline size_t getMaxRequiredWorkspaceSize(int worldSize) noexcept
     return 8 * 1000 * 1000;
 }
 
+// How the ranks of an all-reduce group are connected.
+enum class AllReduceTopology : int8_t
+{
+    // Ranks on several nodes. The custom kernels need peer access, only NCCL is possible.
+    kINTER_NODE = 0,
+    // Peer access over PCIe only.
+    kPCIE = 1,
+    // Direct NVLink between every pair of ranks.
+    kNVLINK = 2,
+    // NVLink through NVSwitch.
+    kNVSWITCH = 3,
+};
+
+inline AllReduceTopology parseAllReduceTopology(std::string const& name)
+{
+    if (name == "inter_node")
+    {
+        return AllReduceTopology::kINTER_NODE;
+    }
+    if (name == "pcie")
+    {
+        return AllReduceTopology::kPCIE;
+    }
+    if (name == "nvlink")
+    {
+        return AllReduceTopology::kNVLINK;
+    }
+    if (name == "nvswitch")
+    {
+        return AllReduceTopology::kNVSWITCH;
+    }
+    TLLM_THROW("Unknown all-reduce topology %s", name.c_str());
+}
+
+inline char const* getAllReduceTopologyName(AllReduceTopology topology) noexcept
+{
+    switch (topology)
+    {
+    case AllReduceTopology::kINTER_NODE: return "inter_node";
+    case AllReduceTopology::kPCIE: return "pcie";
+    case AllReduceTopology::kNVLINK: return "nvlink";
+    case AllReduceTopology::kNVSWITCH: return "nvswitch";
+    }
+    return "unknown";
+}
+
+inline kernels::AllReduceStrategyType parseAllReduceStrategy(std::string const& name)
+{
+    if (name == "NCCL")
+    {
+        return kernels::AllReduceStrategyType::NCCL;
+    }
+    if (name == "ONESHOT")
+    {
+        return kernels::AllReduceStrategyType::ONESHOT;
+    }
+    if (name == "TWOSHOT")
+    {
+        return kernels::AllReduceStrategyType::TWOSHOT;
+    }
+    TLLM_THROW("AUTO cannot select the all-reduce strategy %s", name.c_str());
+}
+
+inline char const* getAllReduceStrategyName(kernels::AllReduceStrategyType strategy) noexcept
+{
+    switch (strategy)
+    {
+    case kernels::AllReduceStrategyType::NCCL: return "NCCL";
+    case kernels::AllReduceStrategyType::ONESHOT: return "ONESHOT";
+    case kernels::AllReduceStrategyType::TWOSHOT: return "TWOSHOT";
+    case kernels::AllReduceStrategyType::NVLS: return "NVLS";
+    default: return "UNKNOWN";
+    }
+}
+
+// Strategy table of AUTO. A rule applies to groups with the given topology and at most maxWorldSize ranks, and to
+// messages smaller than maxMessageBytes. The first rule that applies wins, NCCL is used if none does.
+//
+// The defaults are the thresholds measured on NVLink systems. A profile tuned on the target system can be loaded from
+// the file set in TRTLLM_ALLREDUCE_PROFILE, with one rule per line:
+//     <inter_node|pcie|nvlink|nvswitch> <maxWorldSize> <maxMessageBytes> <NCCL|ONESHOT|TWOSHOT> [config]
+// where the optional config is the AllReduceStrategyConfig bit mask AUTO runs the custom kernels with, instead of the
+// one of the plugin. Empty lines and lines starting with '#' are ignored.
+class AllReduceStrategyProfile
+{
+public:
+    struct Rule
+    {
+        AllReduceTopology topology;
+        int maxWorldSize;
+        size_t maxMessageBytes;
+        kernels::AllReduceStrategyType strategy;
+        std::optional<kernels::AllReduceStrategyConfig> config{std::nullopt};
+    };
+
+    explicit AllReduceStrategyProfile(std::vector<Rule> rules)
+        : mRules{std::move(rules)}
+    {
+    }
+
+    static AllReduceStrategyProfile getDefault()
+    {
+        std::vector<Rule> rules;
+        for (auto const topology : {AllReduceTopology::kNVLINK, AllReduceTopology::kNVSWITCH})
+        {
+            rules.push_back({topology, 2, std::numeric_limits<size_t>::max(), kernels::AllReduceStrategyType::ONESHOT});
+            rules.push_back({topology, 4, 1000 * 1000, kernels::AllReduceStrategyType::ONESHOT});
+            rules.push_back({topology, static_cast<int>(kernels::MAX_RANKS_PER_NODE), 500 * 1000,
+                kernels::AllReduceStrategyType::ONESHOT});
+        }
+        return AllReduceStrategyProfile{std::move(rules)};
+    }
+
+    static AllReduceStrategyProfile load(std::istream& is)
+    {
+        std::vector<Rule> rules;
+        std::string line;
+        while (std::getline(is, line))
+        {
+            if (line.empty() || line[0] == '#')
+            {
+                continue;
+            }
+            std::istringstream fields{line};
+            std::string topology;
+            std::string strategy;
+            Rule rule{};
+            TLLM_CHECK_WITH_INFO(static_cast<bool>(fields >> topology >> rule.maxWorldSize >> rule.maxMessageBytes
+                                     >> strategy),
+                "Malformed all-reduce profile rule: %s", line.c_str());
+            rule.topology = parseAllReduceTopology(topology);
+            rule.strategy = parseAllReduceStrategy(strategy);
+            int config{0};
+            if (fields >> config)
+            {
+                rule.config = static_cast<kernels::AllReduceStrategyConfig>(config);
+            }
+            rules.push_back(rule);
+        }
+        return AllReduceStrategyProfile{std::move(rules)};
+    }
+
+    void save(std::ostream& os) const
+    {
+        for (auto const& rule : mRules)
+        {
+            os << getAllReduceTopologyName(rule.topology) << ' ' << rule.maxWorldSize << ' ' << rule.maxMessageBytes
+               << ' ' << getAllReduceStrategyName(rule.strategy);
+            if (rule.config.has_value())
+            {
+                os << ' ' << static_cast<int>(*rule.config);
+            }
+            os << '\n';
+        }
+    }
+
+    // Profile of TRTLLM_ALLREDUCE_PROFILE, or the default one, until a tuned profile is set.
+    static std::shared_ptr<AllReduceStrategyProfile const> getActive()
+    {
+        return std::atomic_load(&getActiveStorage());
+    }
+
+    // Use profile for AUTO from now on. Plugins that are running may still use the previous one for a while.
+    static void setActive(AllReduceStrategyProfile profile)
+    {
+        std::shared_ptr<AllReduceStrategyProfile const> active
+            = std::make_shared<AllReduceStrategyProfile const>(std::move(profile));
+        std::atomic_store(&getActiveStorage(), std::move(active));
+    }
+
+    [[nodiscard]] std::vector<Rule> const& getRules() const noexcept
+    {
+        return mRules;
+    }
+
+    // First rule that applies, nullptr if none does.
+    [[nodiscard]] Rule const* find(AllReduceTopology topology, int worldSize, size_t messageBytes) const noexcept
+    {
+        for (auto const& rule : mRules)
+        {
+            if (rule.topology == topology && worldSize <= rule.maxWorldSize && messageBytes < rule.maxMessageBytes)
+            {
+                return &rule;
+            }
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] kernels::AllReduceStrategyType select(
+        AllReduceTopology topology, int worldSize, size_t messageBytes) const noexcept
+    {
+        auto const* rule = find(topology, worldSize, messageBytes);
+        return rule != nullptr ? rule->strategy : kernels::AllReduceStrategyType::NCCL;
+    }
+
+    // Config of the custom kernels for the message, fallback if the profile does not set one.
+    [[nodiscard]] kernels::AllReduceStrategyConfig selectConfig(AllReduceTopology topology, int worldSize,
+        size_t messageBytes, kernels::AllReduceStrategyConfig fallback) const noexcept
+    {
+        auto const* rule = find(topology, worldSize, messageBytes);
+        return rule != nullptr ? rule->config.value_or(fallback) : fallback;
+    }
+
+private:
+    static std::shared_ptr<AllReduceStrategyProfile const>& getActiveStorage()
+    {
+        static std::shared_ptr<AllReduceStrategyProfile const> profile = []()
+        {
+            auto const path = common::getEnvAllReduceProfilePath();
+            if (path.empty())
+            {
+                return std::make_shared<AllReduceStrategyProfile const>(getDefault());
+            }
+            std::ifstream file{path};
+            TLLM_CHECK_WITH_INFO(file.is_open(), "Cannot open all-reduce profile %s", path.c_str());
+            TLLM_LOG_INFO("Loading all-reduce strategy profile %s", path.c_str());
+            return std::make_shared<AllReduceStrategyProfile const>(load(file));
+        }();
+        return profile;
+    }
+
+    std::vector<Rule> mRules;
+};
+
 } // namespace tensorrt_llm::utils::customAllReduceUtils
@@ -18,6 +18,8 @@
 #include "envUtils.h"
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/common/logger.h"
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdlib>
 #include <mutex>
@@ -47,6 +49,16 @@ std::optional<size_t> getUInt64Env(char const* name)
     return {val};
 };
 
+static std::optional<float> getFloatEnv(char const* name)
+{
+    char const* const env = std::getenv(name);
+    if (env == nullptr)
+    {
+        return std::nullopt;
+    }
+    return {std::stof(env)};
+}
+
 // Returns true if the env variable exists and is set to "1"
 static bool getBoolEnv(char const* name)
 {
@@ -363,4 +375,382 @@ size_t getEnvMemSizeForKVCacheTransferBuffer()
     return memSizeForKVCacheTransferBuffer;
 }
 
+std::string getEnvKVCacheDiskTierPath()
+{
+    static std::once_flag flag;
+    static std::string diskTierPath;
+
+    std::call_once(flag,
+        [&]()
+        {
+            char const* diskTierPathEnv = std::getenv("TRTLLM_KVCACHE_DISK_TIER_PATH");
+            if (diskTierPathEnv)
+            {
+                diskTierPath = diskTierPathEnv;
+            }
+        });
+    return diskTierPath;
+}
+
+size_t getEnvKVCacheDiskTierSize()
+{
+    static std::once_flag flag;
+    static size_t diskTierSize = 0;
+
+    std::call_once(flag,
+        [&]()
+        {
+            char const* diskTierSizeEnv = std::getenv("TRTLLM_KVCACHE_DISK_TIER_SIZE");
+            if (diskTierSizeEnv)
+            {
+                diskTierSize = parseMemorySize(diskTierSizeEnv);
+            }
+        });
+    return diskTierSize;
+}
+
+std::string getEnvKVCacheEvictionPolicy()
+{
+    static std::once_flag flag;
+    static std::string evictionPolicy = "lru";
+
+    std::call_once(flag,
+        [&]()
+        {
+            char const* evictionPolicyEnv = std::getenv("TRTLLM_KVCACHE_EVICTION_POLICY");
+            if (evictionPolicyEnv)
+            {
+                evictionPolicy = evictionPolicyEnv;
+            }
+        });
+    return evictionPolicy;
+}
+
+bool getEnvKVCacheOffloadQuantization()
+{
+    static bool const offloadQuantization = getBoolEnv("TRTLLM_KVCACHE_OFFLOAD_QUANTIZATION");
+    return offloadQuantization;
+}
+
+std::string getEnvKVCachePrefixSnapshotPath()
+{
+    static std::once_flag flag;
+    static std::string snapshotPath;
+
+    std::call_once(flag,
+        [&]()
+        {
+            char const* snapshotPathEnv = std::getenv("TRTLLM_KVCACHE_PREFIX_SNAPSHOT_PATH");
+            if (snapshotPathEnv)
+            {
+                snapshotPath = snapshotPathEnv;
+            }
+        });
+    return snapshotPath;
+}
+
+bool getEnvVirtualLinearKVCache()
+{
+    static bool const virtualLinearKVCache = getBoolEnv("TRTLLM_VIRTUAL_LINEAR_KVCACHE");
+    return virtualLinearKVCache;
+}
+
+std::optional<int32_t> getEnvTargetStepLatencyMs()
+{
+    static auto const targetStepLatencyMs = []()
+    {
+        auto const val = getIntEnv("TRTLLM_TARGET_STEP_LATENCY_MS");
+        return (val.has_value() && *val <= 0) ? std::nullopt : val;
+    }();
+    return targetStepLatencyMs;
+}
+
+size_t getEnvEngineLoadThreads()
+{
+    static auto const engineLoadThreads = []()
+    {
+        auto const val = getIntEnv("TRTLLM_ENGINE_LOAD_THREADS");
+        return val.has_value() ? static_cast<size_t>(std::max(*val, 0)) : size_t{8};
+    }();
+    return engineLoadThreads;
+}
+
+bool getEnvKVCacheTransferFp8()
+{
+    static bool const kvCacheTransferFp8 = getBoolEnv("TRTLLM_KV_CACHE_TRANSFER_FP8");
+    return kvCacheTransferFp8;
+}
+
+std::string getEnvAllReduceProfilePath()
+{
+    static std::once_flag flag;
+    static std::string profilePath;
+
+    std::call_once(flag,
+        [&]()
+        {
+            char const* profilePathEnv = std::getenv("TRTLLM_ALLREDUCE_PROFILE");
+            if (profilePathEnv)
+            {
+                profilePath = profilePathEnv;
+            }
+        });
+    return profilePath;
+}
+
+std::string getEnvAllReduceAutotuneCacheDir()
+{
+    static std::once_flag flag;
+    static std::string cacheDir;
+
+    std::call_once(flag,
+        [&]()
+        {
+            char const* cacheDirEnv = std::getenv("TRTLLM_ALLREDUCE_AUTOTUNE_CACHE_DIR");
+            if (cacheDirEnv)
+            {
+                cacheDir = cacheDirEnv;
+            }
+        });
+    return cacheDir;
+}
+
+std::string getEnvXqaJitCacheDir()
+{
+    static std::once_flag flag;
+    static std::string cacheDir;
+
+    std::call_once(flag,
+        [&]()
+        {
+            char const* cacheDirEnv = std::getenv("TRTLLM_XQA_JIT_CACHE_DIR");
+            if (cacheDirEnv)
+            {
+                cacheDir = cacheDirEnv;
+            }
+        });
+    return cacheDir;
+}
+
+std::string getEnvGemmTacticCacheDir()
+{
+    static std::once_flag flag;
+    static std::string cacheDir;
+
+    std::call_once(flag,
+        [&]()
+        {
+            char const* cacheDirEnv = std::getenv("TRTLLM_GEMM_TACTIC_CACHE_DIR");
+            if (cacheDirEnv)
+            {
+                cacheDir = cacheDirEnv;
+            }
+        });
+    return cacheDir;
+}
+
+bool getEnvMultiBlockAutotune()
+{
+    static bool const multiBlockAutotune = getBoolEnv("TRTLLM_MULTI_BLOCK_AUTOTUNE");
+    return multiBlockAutotune;
+}
+
+bool getEnvUseRejectionTopPSampling()
+{
+    static bool const useRejectionTopPSampling = getBoolEnv("TRTLLM_TOPP_REJECTION_SAMPLING");
+    return useRejectionTopPSampling;
+}
+
+bool getEnvOverlapScheduler()
+{
+    static bool const overlapScheduler = getBoolEnv("TRTLLM_ENABLE_OVERLAP_SCHEDULER");
+    return overlapScheduler;
+}
+
+bool getEnvAsyncPipelineScheduler()
+{
+    static bool const asyncPipelineScheduler = getBoolEnv("TRTLLM_ENABLE_ASYNC_PP_SCHEDULER");
+    return asyncPipelineScheduler;
+}
+
+bool getEnvDecoderNcclTransport()
+{
+    static bool const decoderNcclTransport = getBoolEnv("TRTLLM_DECODER_NCCL_TRANSPORT");
+    return decoderNcclTransport;
+}
+
+int32_t getEnvReturnLogitsTopK()
+{
+    static int32_t const topK = std::max(getIntEnv("TRTLLM_RETURN_LOGITS_TOPK").value_or(0), 0);
+    return topK;
+}
+
+bool getEnvReturnLogitsHalf()
+{
+    static bool const returnLogitsHalf = getBoolEnv("TRTLLM_RETURN_LOGITS_FP16");
+    return returnLogitsHalf;
+}
+
+bool getEnvMlaDecodeKernel()
+{
+    static bool const mlaDecodeKernel = getBoolEnv("TRTLLM_ENABLE_MLA_DECODE_KERNEL");
+    return mlaDecodeKernel;
+}
+
+bool getEnvDisablePosShiftInKernel()
+{
+    static bool const disablePosShiftInKernel = getBoolEnv("TRTLLM_DISABLE_POS_SHIFT_IN_KERNEL");
+    return disablePosShiftInKernel;
+}
+
+size_t getEnvGuidedDecodingMaskWorkers()
+{
+    static auto const maskWorkers = []()
+    {
+        auto const val = getIntEnv("TRTLLM_GUIDED_DECODING_MASK_WORKERS");
+        return val.has_value() ? static_cast<size_t>(std::max(*val, 0)) : size_t{0};
+    }();
+    return maskWorkers;
+}
+
+float getEnvTypicalAcceptanceEpsilon()
+{
+    static float const epsilon = std::max(getFloatEnv("TRTLLM_TYPICAL_ACCEPTANCE_EPSILON").value_or(0.f), 0.f);
+    return epsilon;
+}
+
+float getEnvTypicalAcceptanceDelta()
+{
+    static float const delta
+        = getFloatEnv("TRTLLM_TYPICAL_ACCEPTANCE_DELTA").value_or(std::sqrt(getEnvTypicalAcceptanceEpsilon()));
+    return delta;
+}
+
+int getEnvMoeLoadBalanceInterval()
+{
+    static int const interval = std::max(getIntEnv("TRTLLM_MOE_LOAD_BALANCE_INTERVAL").value_or(0), 0);
+    return interval;
+}
+
+int getEnvLoraSgmvMaxTokens()
+{
+    static int const maxTokens = std::max(getIntEnv("TRTLLM_LORA_SGMV_MAX_TOKENS").value_or(128), 0);
+    return maxTokens;
+}
+
+bool getEnvPinnedPoolSizeClasses()
+{
+    static bool const sizeClasses = getBoolEnv("TRTLLM_PINNED_POOL_SIZE_CLASSES");
+    return sizeClasses;
+}
+
+bool getEnvDecoderCudaGraph()
+{
+    static bool const decoderCudaGraph = getBoolEnv("TRTLLM_DECODER_CUDA_GRAPH");
+    return decoderCudaGraph;
+}
+
+bool getEnvNumaBinding()
+{
+    static bool const numaBinding = getBoolEnv("TRTLLM_NUMA_BINDING");
+    return numaBinding;
+}
+
+bool getEnvEncoderDecoderPipelining()
+{
+    static bool const pipelining = getBoolEnv("TRTLLM_ENCODER_DECODER_PIPELINING");
+    return pipelining;
+}
+
+std::string getEnvIterationTimelinePrefix()
+{
+    static std::once_flag flag;
+    static std::string pathPrefix;
+
+    std::call_once(flag,
+        [&]()
+        {
+            char const* pathPrefixEnv = std::getenv("TLLM_ITERATION_TIMELINE");
+            if (pathPrefixEnv)
+            {
+                pathPrefix = pathPrefixEnv;
+            }
+        });
+    return pathPrefix;
+}
+
+size_t getEnvIterationTimelineEvents()
+{
+    static size_t const numEvents = getUInt64Env("TLLM_ITERATION_TIMELINE_EVENTS").value_or(size_t{1} << 16);
+    return numEvents;
+}
+
+int32_t getEnvKernelSamplingInterval()
+{
+    static int32_t const interval = std::max(getIntEnv("TLLM_KERNEL_SAMPLING_INTERVAL").value_or(0), 0);
+    return interval;
+}
+
+bool getEnvDisableGreedyFastPath()
+{
+    static bool const disableGreedyFastPath = getBoolEnv("TRTLLM_DISABLE_GREEDY_FAST_PATH");
+    return disableGreedyFastPath;
+}
+
+size_t getEnvNvlsWorkspaceSize()
+{
+    static size_t const workspaceSize = getUInt64Env("TRTLLM_NVLS_WORKSPACE_SIZE").value_or(size_t{64} << 20);
+    return workspaceSize;
+}
+
+size_t getEnvGrammarCompilerWorkers()
+{
+    static auto const compilerWorkers = []()
+    {
+        auto const val = getIntEnv("TRTLLM_GRAMMAR_COMPILER_WORKERS");
+        return val.has_value() ? static_cast<size_t>(std::max(*val, 1)) : size_t{2};
+    }();
+    return compilerWorkers;
+}
+
+size_t getEnvCompiledGrammarCacheSize()
+{
+    static auto const cacheSize = []()
+    {
+        auto const val = getIntEnv("TRTLLM_COMPILED_GRAMMAR_CACHE_SIZE");
+        return val.has_value() ? static_cast<size_t>(std::max(*val, 0)) : size_t{256};
+    }();
+    return cacheSize;
+}
+
+int32_t getEnvWeightStreamingProfileInterval()
+{
+    static auto const profileInterval
+        = std::max(getIntEnv("TRTLLM_WEIGHT_STREAMING_PROFILE_INTERVAL").value_or(100), 0);
+    return profileInterval;
+}
+
+bool getEnvOverlapMicroBatchDecoding()
+{
+    static bool const overlapMicroBatchDecoding = getBoolEnv("TRTLLM_OVERLAP_MICRO_BATCH_DECODING");
+    return overlapMicroBatchDecoding;
+}
+
+std::optional<int32_t> getEnvTargetP99InterTokenLatencyMs()
+{
+    static auto const targetP99InterTokenLatencyMs = []()
+    {
+        auto const val = getIntEnv("TRTLLM_TARGET_P99_ITL_MS");
+        return (val.has_value() && *val <= 0) ? std::nullopt : val;
+    }();
+    return targetP99InterTokenLatencyMs;
+}
+
+size_t getEnvHostSamplingThreads()
+{
+    static auto const numThreads
+        = static_cast<size_t>(std::max(getIntEnv("TRTLLM_HOST_SAMPLING_THREADS").value_or(0), 0));
+    return numThreads;
+}
+
 } // namespace tensorrt_llm::common
@@ -88,4 +88,146 @@ size_t getEnvKVCacheSendMaxConcurrenceNum();
 
 size_t getEnvMemSizeForKVCacheTransferBuffer();
 
+// Path of the file backing the KV cache disk tier (cache level 2). Empty if the disk tier is disabled.
+std::string getEnvKVCacheDiskTierPath();
+
+// Size of the KV cache disk tier, e.g. "64GB". 0 if the disk tier is disabled.
+size_t getEnvKVCacheDiskTierSize();
+
+// Eviction policy of the KV cache block manager: "lru" (default), "indexed_lru" or "cost_aware".
+std::string getEnvKVCacheEvictionPolicy();
+
+// Store offloaded KV cache blocks in FP8 in the secondary pools.
+bool getEnvKVCacheOffloadQuantization();
+
+// Path of the KV cache prefix snapshot, loaded on startup and written on shutdown. Empty if disabled.
+std::string getEnvKVCachePrefixSnapshotPath();
+
+// Back the contiguous (non-paged) KV cache with virtual memory that is mapped as sequences grow.
+bool getEnvVirtualLinearKVCache();
+
+// Target step latency in milliseconds for the adaptive context token budget. Not set if the budget is static.
+std::optional<int32_t> getEnvTargetStepLatencyMs();
+
+// Number of threads that prefetch memory-mapped engine and weight files ahead of deserialization, 0 to disable.
+size_t getEnvEngineLoadThreads();
+
+// Send KV cache blocks to generation instances in FP8 with one scale per layer and K/V block.
+bool getEnvKVCacheTransferFp8();
+
+// Path of the strategy profile of the AUTO all-reduce. Empty to use the built-in thresholds.
+std::string getEnvAllReduceProfilePath();
+
+// Directory of the all-reduce strategy profiles tuned at startup, one file per hardware fingerprint. Empty to
+// disable tuning.
+std::string getEnvAllReduceAutotuneCacheDir();
+
+// Directory of the cubins compiled by the XQA JIT, shared by the processes of a node. Empty to compile in every
+// process.
+std::string getEnvXqaJitCacheDir();
+
+// Directory of the GEMM plugin tactics profiled by the processes of a node, reused by later engine builds and engines
+// of the same GEMM shapes. Empty to profile in every build.
+std::string getEnvGemmTacticCacheDir();
+
+// Time the blocks per sequence of the multi-block MMHA and XQA kernels during the first launches of every shape and
+// use the fastest one afterwards.
+bool getEnvMultiBlockAutotune();
+
+// Sample top P by rejection instead of sorting, which needs no workspace proportional to the vocab.
+bool getEnvUseRejectionTopPSampling();
+
+// Launch the engine of step N+1 before the outputs of step N are processed on the host.
+bool getEnvOverlapScheduler();
+
+// Launch the pipeline parallel micro-batches from any sequence whose new tokens returned to the first rank, instead of
+// the fixed micro-batches of in-flight batching.
+bool getEnvAsyncPipelineScheduler();
+
+// Move the decoder outputs of a step between the ranks with NCCL instead of the host staged MPI sends.
+bool getEnvDecoderNcclTransport();
+
+// Return only the top K logits of every position with their log-probabilities when the context or generation logits
+// are returned, 0 (default) to return all of them.
+int32_t getEnvReturnLogitsTopK();
+
+// Return the context and generation logits in half precision instead of FP32.
+bool getEnvReturnLogitsHalf();
+
+// Run the MLA generation attention with the open split-KV latent kernel instead of the fused MHA cubins.
+bool getEnvMlaDecodeKernel();
+
+// Rotate a copy of the K cache every step for the position shift of StreamingLLM instead of rotating the keys inside
+// the generation kernel.
+bool getEnvDisablePosShiftInKernel();
+
+// Number of threads that build the token bitmasks of guided decoding during the forward pass, 0 to build them on the
+// executor thread.
+size_t getEnvGuidedDecodingMaskWorkers();
+
+// Epsilon of the typical acceptance of external draft tokens, 0 (default) to accept them by rejection sampling or by
+// exact match.
+float getEnvTypicalAcceptanceEpsilon();
+
+// Delta of the typical acceptance of external draft tokens, sqrt(epsilon) by default.
+float getEnvTypicalAcceptanceDelta();
+
+// Steps between two re-placements of the replicas of the hot MoE experts, 0 (default) to keep the placement of the
+// engine.
+int getEnvMoeLoadBalanceInterval();
+
+// Largest number of tokens the LoRA plugin runs with the segmented gather matmuls when the tokens use different
+// adapters or ranks, 0 to always run the grouped GEMMs.
+int getEnvLoraSgmvMaxTokens();
+
+// Serve BufferManager::pinnedPool from the size-class pinned pool with per-thread caches instead of the first-fit pool.
+bool getEnvPinnedPoolSizeClasses();
+
+// Launch the decoding layers of GptDecoderBatched as CUDA graphs, one per bucket of the decoder batch size.
+bool getEnvDecoderCudaGraph();
+
+// Place the pinned host memory and the worker threads of every GPU on the NUMA node of the GPU.
+bool getEnvNumaBinding();
+
+// Run the encoder of encoder-decoder models on its own stream, overlapped with the decoder steps.
+bool getEnvEncoderDecoderPipelining();
+
+// Path prefix of the Chrome traces of the iteration timeline, empty (default) to disable the timeline.
+std::string getEnvIterationTimelinePrefix();
+
+// Number of events the ring buffer of the iteration timeline keeps, 65536 by default.
+size_t getEnvIterationTimelineEvents();
+
+// Collect the kernels of 1 in N iterations with CUPTI, 0 (the default) disables the sampling.
+int32_t getEnvKernelSamplingInterval();
+
+// Run greedy-only batches through the whole layer chain of DynamicDecodeLayer instead of the fused greedy kernel.
+bool getEnvDisableGreedyFastPath();
+
+// Bytes of the multicast workspace of the NVLS all-reduce strategy, 64 MiB by default. Larger messages fall back to
+// NCCL.
+size_t getEnvNvlsWorkspaceSize();
+
+// Number of threads that compile the grammars of guided decoding, 2 by default.
+size_t getEnvGrammarCompilerWorkers();
+
+// Number of compiled grammars the shared grammar cache of guided decoding keeps, 256 by default.
+size_t getEnvCompiledGrammarCacheSize();
+
+// Steps between the profiled steps that choose which layers keep their managed weights on the device under weight
+// streaming, 100 by default, 0 to keep the initial residency.
+int32_t getEnvWeightStreamingProfileInterval();
+
+// Decode each generation micro batch of GptSession on the stream of its decoder while the engine runs the step of the
+// next micro batch, instead of joining the decoding back to the runtime stream.
+bool getEnvOverlapMicroBatchDecoding();
+
+// Bound of the p99 inter-token latency in milliseconds the runtime max batch size and max num tokens are tuned under.
+// Not set if the limits are not tuned.
+std::optional<int32_t> getEnvTargetP99InterTokenLatencyMs();
+
+// Host threads that sample the requests with greedy or plain top-k sampling on the CPU, 0 (default) to sample all the
+// requests on the device.
+size_t getEnvHostSamplingThreads();
+
 } // namespace tensorrt_llm::common
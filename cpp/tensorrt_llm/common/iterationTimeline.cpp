@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/iterationTimeline.h"
+#include "tensorrt_llm/common/cudaProfilerUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/mpiUtils.h"
+
+#include <algorithm>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <tuple>
+
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#elif defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace tensorrt_llm::common
+{
+
+namespace
+{
+std::uint32_t getThreadIdx()
+{
+    static std::atomic<std::uint32_t> numThreads{0};
+    thread_local std::uint32_t const threadIdx = numThreads.fetch_add(1, std::memory_order_relaxed);
+    return threadIdx;
+}
+
+#ifdef SIGUSR2
+void handleDumpSignal(int)
+{
+    IterationTimeline::requestDump();
+}
+#endif
+} // namespace
+
+std::atomic<bool> IterationTimeline::sDumpRequested{false};
+
+IterationTimeline::ScopedEvent::ScopedEvent(char const* name) noexcept
+    : mName{name}
+    , mStart{IterationTimeline::getInstance().isRecording() ? readTicks() : 0}
+{
+}
+
+IterationTimeline::ScopedEvent::~ScopedEvent()
+{
+    if (mStart != 0)
+    {
+        IterationTimeline::getInstance().record(mName, mStart, readTicks());
+    }
+}
+
+IterationTimeline::ScopedIteration::ScopedIteration()
+    : mIteration{-1}
+    , mStart{0}
+{
+    auto& timeline = IterationTimeline::getInstance();
+    if (timeline.isEnabled())
+    {
+        mIteration = timeline.beginIteration();
+        mStart = readTicks();
+    }
+}
+
+IterationTimeline::ScopedIteration::~ScopedIteration()
+{
+    if (mIteration >= 0)
+    {
+        IterationTimeline::getInstance().endIteration(mIteration, mStart);
+    }
+}
+
+IterationTimeline::IterationTimeline(std::size_t capacity, std::string pathPrefix,
+    std::unordered_set<std::int32_t> startIterations, std::unordered_set<std::int32_t> stopIterations)
+    : mCapacity{capacity}
+    , mPathPrefix{std::move(pathPrefix)}
+    , mStartIterations{std::move(startIterations)}
+    , mStopIterations{std::move(stopIterations)}
+    , mEvents(capacity)
+    , mRecording{capacity > 0 && mStartIterations.empty()}
+    , mOriginTicks{readTicks()}
+    , mOriginTime{Clock::now()}
+{
+}
+
+IterationTimeline& IterationTimeline::getInstance()
+{
+    static IterationTimeline timeline = []()
+    {
+        auto const pathPrefix = getEnvIterationTimelinePrefix();
+        if (pathPrefix.empty())
+        {
+            return IterationTimeline(0, pathPrefix, {}, {});
+        }
+        auto [startIterations, stopIterations] = populateIterationIndexes("TLLM_ITERATION_TIMELINE_START_STOP");
+        if (startIterations.empty() && stopIterations.empty())
+        {
+            std::tie(startIterations, stopIterations)
+                = populateIterationIndexes("TLLM_PROFILE_START_STOP", "TLLM_GPTM_PROFILE_START_STOP");
+        }
+#ifdef SIGUSR2
+        auto const previousHandler = std::signal(SIGUSR2, handleDumpSignal);
+        if (previousHandler != SIG_DFL && previousHandler != SIG_ERR)
+        {
+            std::signal(SIGUSR2, previousHandler);
+            TLLM_LOG_WARNING(
+                "SIGUSR2 is handled already, the iteration timeline is only dumped at its stop iterations");
+        }
+#endif
+        TLLM_LOG_INFO("Recording the iteration timeline to %s_rank*.json", pathPrefix.c_str());
+        return IterationTimeline(getEnvIterationTimelineEvents(), pathPrefix, std::move(startIterations),
+            std::move(stopIterations));
+    }();
+    return timeline;
+}
+
+std::uint64_t IterationTimeline::readTicks() noexcept
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+#endif
+}
+
+std::int64_t IterationTimeline::beginIteration()
+{
+    if (sDumpRequested.exchange(false, std::memory_order_relaxed))
+    {
+        dump();
+    }
+    auto const iteration = mNextIteration.fetch_add(1, std::memory_order_relaxed);
+    if (isEnabled() && mStartIterations.count(static_cast<std::int32_t>(iteration)) > 0)
+    {
+        mRangeBegin.store(mNumRecorded.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        mRecording.store(true, std::memory_order_relaxed);
+    }
+    mCurrentIteration.store(iteration, std::memory_order_relaxed);
+    return iteration;
+}
+
+void IterationTimeline::endIteration(std::int64_t iteration, std::uint64_t startTicks)
+{
+    record("iteration", startTicks, readTicks());
+    mCurrentIteration.store(-1, std::memory_order_relaxed);
+    if (mStopIterations.count(static_cast<std::int32_t>(iteration)) > 0 && isRecording())
+    {
+        dump();
+        mRecording.store(false, std::memory_order_relaxed);
+    }
+}
+
+void IterationTimeline::record(char const* name, std::uint64_t startTicks, std::uint64_t endTicks) noexcept
+{
+    if (!isRecording())
+    {
+        return;
+    }
+    // The slots are claimed without a lock, a dump racing with the writers may read a torn event of the oldest.
+    auto const idx = mNumRecorded.fetch_add(1, std::memory_order_relaxed);
+    mEvents[idx % mCapacity]
+        = Event{name, startTicks, endTicks, mCurrentIteration.load(std::memory_order_relaxed), getThreadIdx()};
+}
+
+std::vector<IterationTimeline::Event> IterationTimeline::getEvents() const
+{
+    std::vector<Event> events;
+    if (!isEnabled())
+    {
+        return events;
+    }
+    auto const numRecorded = mNumRecorded.load(std::memory_order_relaxed);
+    auto const first = std::max(mRangeBegin.load(std::memory_order_relaxed),
+        numRecorded > mCapacity ? numRecorded - mCapacity : std::uint64_t{0});
+    events.reserve(numRecorded - first);
+    for (auto idx = first; idx < numRecorded; ++idx)
+    {
+        events.push_back(mEvents[idx % mCapacity]);
+    }
+    return events;
+}
+
+std::string IterationTimeline::toChromeTraceJson() const
+{
+    auto const events = getEvents();
+    // The TSC runs at a constant rate, calibrated against the steady clock over the lifetime of the timeline.
+    auto const elapsedUs = std::chrono::duration<double, std::micro>(Clock::now() - mOriginTime).count();
+    auto const elapsedTicks = static_cast<double>(readTicks() - mOriginTicks);
+    auto const usPerTick = elapsedTicks > 0 ? elapsedUs / elapsedTicks : 0.;
+    auto const toUs = [&](std::uint64_t ticks)
+    { return static_cast<double>(static_cast<std::int64_t>(ticks - mOriginTicks)) * usPerTick; };
+
+    auto const rank = mpi::MpiComm::world().getRank();
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    for (std::size_t idx = 0; idx < events.size(); ++idx)
+    {
+        auto const& event = events[idx];
+        auto const startUs = toUs(event.startTicks);
+        ss << (idx == 0 ? "" : ", ") << "{\"name\": \"" << event.name << "\", \"cat\": \"host\", \"ph\": \"X\", "
+           << "\"pid\": " << rank << ", \"tid\": " << event.threadIdx << ", \"ts\": " << startUs
+           << ", \"dur\": " << toUs(event.endTicks) - startUs << ", \"args\": {\"iteration\": " << event.iteration
+           << "}}";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+std::string IterationTimeline::dump()
+{
+    if (!isEnabled())
+    {
+        return {};
+    }
+    std::lock_guard<std::mutex> lock(mDumpMutex);
+    auto const path = mPathPrefix + "_rank" + std::to_string(mpi::MpiComm::world().getRank()) + "_"
+        + std::to_string(mNumDumps++) + ".json";
+    std::ofstream(path) << toChromeTraceJson() << std::endl;
+    TLLM_LOG_INFO("Wrote the iteration timeline to %s", path.c_str());
+    return path;
+}
+
+void IterationTimeline::reset()
+{
+    mNumRecorded.store(0, std::memory_order_relaxed);
+    mRangeBegin.store(0, std::memory_order_relaxed);
+    mNextIteration.store(0, std::memory_order_relaxed);
+    mCurrentIteration.store(-1, std::memory_order_relaxed);
+    mRecording.store(isEnabled() && mStartIterations.empty(), std::memory_order_relaxed);
+}
+
+void IterationTimeline::requestDump() noexcept
+{
+    sDumpRequested.store(true, std::memory_order_relaxed);
+}
+
+} // namespace tensorrt_llm::common
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief Timeline of the host work inside the iterations of the generation loops, exported as a Chrome trace.
+//! \details The loops mark their iterations with a ScopedIteration and the phases of an iteration with
+//! TLLM_TIMELINE_SCOPE, e.g. "scheduling", "kv_cache_alloc", "peft_ensure_batch", "prepare_inputs", "engine_enqueue",
+//! "decoder" and "response_dispatch". A scope writes its begin and end timestamps, read from the TSC on x86, to a
+//! fixed ring buffer of events that overwrites the oldest ones. Disabled, a scope costs a load of a bool.
+//!
+//! Enabled with TLLM_ITERATION_TIMELINE=<path prefix>, of size TLLM_ITERATION_TIMELINE_EVENTS. The ring is written to
+//! <prefix>_rank<r>_<n>.json, loadable in chrome://tracing or ui.perfetto.dev:
+//! - after the stop iterations of TLLM_ITERATION_TIMELINE_START_STOP, or of the cudaProfiler ranges
+//!   TLLM_PROFILE_START_STOP if unset. With such ranges, only the iterations inside them are recorded.
+//! - at the start of the next iteration after a SIGUSR2.
+//! - on dump().
+class IterationTimeline
+{
+public:
+    struct Event
+    {
+        //! \brief A string literal, the scopes do not copy the names.
+        char const* name;
+        std::uint64_t startTicks;
+        std::uint64_t endTicks;
+        //! \brief The iteration the event was recorded in, -1 outside of the iterations.
+        std::int64_t iteration;
+        std::uint32_t threadIdx;
+    };
+
+    class ScopedEvent
+    {
+    public:
+        explicit ScopedEvent(char const* name) noexcept;
+        ~ScopedEvent();
+
+        ScopedEvent(ScopedEvent const&) = delete;
+        ScopedEvent& operator=(ScopedEvent const&) = delete;
+
+    private:
+        char const* mName;
+        std::uint64_t mStart;
+    };
+
+    class ScopedIteration
+    {
+    public:
+        ScopedIteration();
+        ~ScopedIteration();
+
+        ScopedIteration(ScopedIteration const&) = delete;
+        ScopedIteration& operator=(ScopedIteration const&) = delete;
+
+    private:
+        std::int64_t mIteration;
+        std::uint64_t mStart;
+    };
+
+    //! \param capacity The number of events of the ring buffer, 0 to disable the timeline.
+    //! \param startIterations, stopIterations The iteration ranges to record, everything if both are empty.
+    IterationTimeline(std::size_t capacity, std::string pathPrefix, std::unordered_set<std::int32_t> startIterations,
+        std::unordered_set<std::int32_t> stopIterations);
+
+    //! \brief The timeline configured by the environment.
+    static IterationTimeline& getInstance();
+
+    [[nodiscard]] static std::uint64_t readTicks() noexcept;
+
+    [[nodiscard]] bool isEnabled() const noexcept
+    {
+        return mCapacity > 0;
+    }
+
+    [[nodiscard]] bool isRecording() const noexcept
+    {
+        return mRecording.load(std::memory_order_relaxed);
+    }
+
+    //! \brief Starts the next iteration of the loop, dumps the ring first when a dump was requested by a signal.
+    //! \return The index of the iteration, counted from 0 over all the loops of the process.
+    std::int64_t beginIteration();
+
+    //! \brief Ends an iteration, dumps the ring if it is a stop iteration.
+    void endIteration(std::int64_t iteration, std::uint64_t startTicks);
+
+    void record(char const* name, std::uint64_t startTicks, std::uint64_t endTicks) noexcept;
+
+    //! \brief The events in the ring, oldest first.
+    [[nodiscard]] std::vector<Event> getEvents() const;
+
+    //! \brief The events in the ring in the Chrome trace event format, as complete events in us since the timeline
+    //! was created, with the rank as the pid.
+    [[nodiscard]] std::string toChromeTraceJson() const;
+
+    //! \brief Writes the ring to the next file of the path prefix.
+    //! \return The path of the file, empty if the timeline is disabled.
+    std::string dump();
+
+    void reset();
+
+    //! \brief Requests a dump at the next iteration, safe to call from a signal handler.
+    static void requestDump() noexcept;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::size_t const mCapacity;
+    std::string const mPathPrefix;
+    std::unordered_set<std::int32_t> const mStartIterations;
+    std::unordered_set<std::int32_t> const mStopIterations;
+
+    std::vector<Event> mEvents;
+    //! \brief Events recorded since the reset and at the start of the recorded range, the ring holds the last
+    //! mCapacity events of the range.
+    std::atomic<std::uint64_t> mNumRecorded{0};
+    std::atomic<std::uint64_t> mRangeBegin{0};
+    std::atomic<std::int64_t> mNextIteration{0};
+    std::atomic<std::int64_t> mCurrentIteration{-1};
+    std::atomic<bool> mRecording;
+
+    std::uint64_t mOriginTicks;
+    Clock::time_point mOriginTime;
+
+    std::mutex mDumpMutex;
+    std::size_t mNumDumps{0};
+
+    static std::atomic<bool> sDumpRequested;
+};
+
+} // namespace tensorrt_llm::common
+
+#define TLLM_TIMELINE_SCOPE(name) ::tensorrt_llm::common::IterationTimeline::ScopedEvent timelineEvent_(name)
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/memoryMappedFile.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <cuda_runtime_api.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace tensorrt_llm::common
+{
+
+#ifndef _WIN32
+namespace
+{
+std::size_t getPageSize()
+{
+    static std::size_t const pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    return pageSize;
+}
+
+int toMadvise(MemoryMappedFile::Advice advice)
+{
+    switch (advice)
+    {
+    case MemoryMappedFile::Advice::kNORMAL: return MADV_NORMAL;
+    case MemoryMappedFile::Advice::kSEQUENTIAL: return MADV_SEQUENTIAL;
+    case MemoryMappedFile::Advice::kRANDOM: return MADV_RANDOM;
+    case MemoryMappedFile::Advice::kWILL_NEED: return MADV_WILLNEED;
+    case MemoryMappedFile::Advice::kDONT_NEED: return MADV_DONTNEED;
+    }
+    return MADV_NORMAL;
+}
+} // namespace
+#endif // _WIN32
+
+MemoryMappedFile::MemoryMappedFile(std::string path, Mode mode, std::size_t size)
+    : mPath{std::move(path)}
+    , mMode{mode}
+{
+#ifndef _WIN32
+    int const flags = mode == Mode::kREAD_ONLY ? O_RDONLY : (mode == Mode::kREAD_WRITE ? O_RDWR : O_RDWR | O_CREAT);
+    mFd = ::open(mPath.c_str(), flags, 0644);
+    TLLM_CHECK_WITH_INFO(mFd >= 0, "Failed to open %s: %s", mPath.c_str(), std::strerror(errno));
+
+    if (mode == Mode::kCREATE)
+    {
+        TLLM_CHECK_WITH_INFO(size > 0, "Size must be positive when creating %s", mPath.c_str());
+        if (::ftruncate(mFd, static_cast<off_t>(size)) != 0)
+        {
+            auto const err = errno;
+            ::close(mFd);
+            TLLM_THROW("Failed to resize %s to %zu bytes: %s", mPath.c_str(), size, std::strerror(err));
+        }
+        mSize = size;
+    }
+    else
+    {
+        struct stat st
+        {
+        };
+
+        if (::fstat(mFd, &st) != 0)
+        {
+            auto const err = errno;
+            ::close(mFd);
+            TLLM_THROW("Failed to stat %s: %s", mPath.c_str(), std::strerror(err));
+        }
+        mSize = static_cast<std::size_t>(st.st_size);
+    }
+
+    if (mSize == 0)
+    {
+        // mmap does not accept empty mappings, keep the descriptor so that getPath/size remain meaningful.
+        return;
+    }
+
+    int const prot = mode == Mode::kREAD_ONLY ? PROT_READ : PROT_READ | PROT_WRITE;
+    mData = ::mmap(nullptr, mSize, prot, MAP_SHARED, mFd, 0);
+    if (mData == MAP_FAILED)
+    {
+        auto const err = errno;
+        mData = nullptr;
+        ::close(mFd);
+        mFd = -1;
+        TLLM_THROW("Failed to map %s (%zu bytes): %s", mPath.c_str(), mSize, std::strerror(err));
+    }
+    TLLM_LOG_DEBUG("Mapped %s (%zu bytes)", mPath.c_str(), mSize);
+#else
+    TLLM_THROW("MemoryMappedFile is not supported on Windows");
+#endif // _WIN32
+}
+
+MemoryMappedFile::MemoryMappedFile(MemoryMappedFile&& other) noexcept
+    : mPath{std::move(other.mPath)}
+    , mMode{other.mMode}
+    , mFd{std::exchange(other.mFd, -1)}
+    , mData{std::exchange(other.mData, nullptr)}
+    , mSize{std::exchange(other.mSize, 0)}
+    , mPinned{std::exchange(other.mPinned, false)}
+{
+}
+
+MemoryMappedFile& MemoryMappedFile::operator=(MemoryMappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        mPath = std::move(other.mPath);
+        mMode = other.mMode;
+        mFd = std::exchange(other.mFd, -1);
+        mData = std::exchange(other.mData, nullptr);
+        mSize = std::exchange(other.mSize, 0);
+        mPinned = std::exchange(other.mPinned, false);
+    }
+    return *this;
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    release();
+}
+
+void MemoryMappedFile::release() noexcept
+{
+#ifndef _WIN32
+    if (mPinned)
+    {
+        cudaHostUnregister(mData);
+        mPinned = false;
+    }
+    if (mData != nullptr)
+    {
+        ::munmap(mData, mSize);
+        mData = nullptr;
+    }
+    if (mFd >= 0)
+    {
+        ::close(mFd);
+        mFd = -1;
+    }
+#endif // _WIN32
+}
+
+std::size_t MemoryMappedFile::clampLength(std::size_t offset, std::size_t length) const
+{
+    TLLM_CHECK_WITH_INFO(
+        offset <= mSize, "Offset %zu is out of range for %s (%zu bytes)", offset, mPath.c_str(), mSize);
+    return length == 0 ? mSize - offset : std::min(length, mSize - offset);
+}
+
+void MemoryMappedFile::advise(Advice advice, std::size_t offset, std::size_t length) const
+{
+#ifndef _WIN32
+    if (mData == nullptr)
+    {
+        return;
+    }
+    length = clampLength(offset, length);
+    // madvise requires a page-aligned start address.
+    auto const alignedOffset = offset / getPageSize() * getPageSize();
+    length += offset - alignedOffset;
+    if (::madvise(static_cast<std::uint8_t*>(mData) + alignedOffset, length, toMadvise(advice)) != 0)
+    {
+        TLLM_LOG_WARNING("madvise failed on %s: %s", mPath.c_str(), std::strerror(errno));
+    }
+#endif // _WIN32
+}
+
+void MemoryMappedFile::prefetch(std::size_t offset, std::size_t length, std::size_t numThreads) const
+{
+    if (mData == nullptr)
+    {
+        return;
+    }
+    length = clampLength(offset, length);
+    advise(Advice::kWILL_NEED, offset, length);
+
+    auto const* base = data() + offset;
+    auto touch = [base](std::size_t begin, std::size_t end)
+    {
+        auto const pageSize = getPageSize();
+        volatile std::uint8_t sink = 0;
+        for (std::size_t pos = begin; pos < end; pos += pageSize)
+        {
+            sink = sink ^ base[pos];
+        }
+    };
+
+    numThreads = std::max<std::size_t>(1, std::min(numThreads, length / getPageSize() + 1));
+    if (numThreads == 1)
+    {
+        touch(0, length);
+        return;
+    }
+
+    auto const chunk = (length + numThreads - 1) / numThreads;
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; ++i)
+    {
+        auto const begin = i * chunk;
+        auto const end = std::min(length, begin + chunk);
+        if (begin >= end)
+        {
+            break;
+        }
+        threads.emplace_back(touch, begin, end);
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void MemoryMappedFile::flush(std::size_t offset, std::size_t length, bool async) const
+{
+#ifndef _WIN32
+    if (mData == nullptr || !isWritable())
+    {
+        return;
+    }
+    length = clampLength(offset, length);
+    auto const alignedOffset = offset / getPageSize() * getPageSize();
+    length += offset - alignedOffset;
+    TLLM_CHECK_WITH_INFO(::msync(static_cast<std::uint8_t*>(mData) + alignedOffset, length, async ? MS_ASYNC : MS_SYNC)
+            == 0,
+        "msync failed on %s: %s", mPath.c_str(), std::strerror(errno));
+#endif // _WIN32
+}
+
+bool MemoryMappedFile::pin()
+{
+    if (mData == nullptr || mPinned)
+    {
+        return mPinned;
+    }
+    // The pages of a read-only mapping can only be registered read-only, the device then only reads them.
+    auto const flags = cudaHostRegisterPortable | (isWritable() ? 0U : cudaHostRegisterReadOnly);
+    auto const status = cudaHostRegister(mData, mSize, flags);
+    if (status != cudaSuccess)
+    {
+        // Clear the error so that it is not reported by the next CUDA call.
+        cudaGetLastError();
+        TLLM_LOG_WARNING("Failed to pin the mapping of %s, it stays pageable: %s", mPath.c_str(),
+            cudaGetErrorString(status));
+        return false;
+    }
+    mPinned = true;
+    TLLM_LOG_DEBUG("Pinned the mapping of %s (%zu bytes)", mPath.c_str(), mSize);
+    return true;
+}
+
+} // namespace tensorrt_llm::common
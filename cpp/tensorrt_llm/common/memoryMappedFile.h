@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief RAII wrapper around a memory mapping of a regular file.
+//! \details Used wherever large files are accessed in place (KV cache disk tier, engine and weight loading) instead of
+//! being read into a heap buffer first. Only supported on Linux.
+class MemoryMappedFile
+{
+public:
+    enum class Mode : std::int8_t
+    {
+        // Map an existing file read-only.
+        kREAD_ONLY,
+        // Map an existing file read-write. The file is not resized.
+        kREAD_WRITE,
+        // Create (or truncate) the file, resize it to the requested size and map it read-write.
+        kCREATE
+    };
+
+    enum class Advice : std::int8_t
+    {
+        kNORMAL,
+        kSEQUENTIAL,
+        kRANDOM,
+        kWILL_NEED,
+        kDONT_NEED
+    };
+
+    //! \param path Path of the file to map.
+    //! \param mode Access mode, see Mode.
+    //! \param size Size of the file in bytes. Only used with Mode::kCREATE.
+    MemoryMappedFile(std::string path, Mode mode, std::size_t size = 0);
+
+    MemoryMappedFile(MemoryMappedFile const&) = delete;
+    MemoryMappedFile& operator=(MemoryMappedFile const&) = delete;
+    MemoryMappedFile(MemoryMappedFile&& other) noexcept;
+    MemoryMappedFile& operator=(MemoryMappedFile&& other) noexcept;
+
+    ~MemoryMappedFile();
+
+    [[nodiscard]] std::uint8_t* data() noexcept
+    {
+        return static_cast<std::uint8_t*>(mData);
+    }
+
+    [[nodiscard]] std::uint8_t const* data() const noexcept
+    {
+        return static_cast<std::uint8_t const*>(mData);
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return mSize;
+    }
+
+    [[nodiscard]] bool isWritable() const noexcept
+    {
+        return mMode != Mode::kREAD_ONLY;
+    }
+
+    [[nodiscard]] std::string const& getPath() const noexcept
+    {
+        return mPath;
+    }
+
+    //! \brief Give the kernel a hint about the access pattern of [offset, offset + length).
+    void advise(Advice advice, std::size_t offset = 0, std::size_t length = 0) const;
+
+    //! \brief Touch every page of [offset, offset + length) from numThreads threads so that later accesses do not
+    //! fault. Useful to overlap file IO with other initialization work.
+    void prefetch(std::size_t offset = 0, std::size_t length = 0, std::size_t numThreads = 1) const;
+
+    //! \brief Write dirty pages of [offset, offset + length) back to the file.
+    void flush(std::size_t offset = 0, std::size_t length = 0, bool async = false) const;
+
+    //! \brief Page-lock the mapping and register it with CUDA, so that copies between it and the device are
+    //! asynchronous DMA transfers without a staging buffer. Every page of the file is read in by the registration, and
+    //! the mapping is unregistered when it is released.
+    //! \return Whether the mapping is pinned, it stays pageable when the registration fails.
+    bool pin();
+
+    [[nodiscard]] bool isPinned() const noexcept
+    {
+        return mPinned;
+    }
+
+private:
+    void release() noexcept;
+
+    [[nodiscard]] std::size_t clampLength(std::size_t offset, std::size_t length) const;
+
+    std::string mPath;
+    Mode mMode;
+    int mFd{-1};
+    void* mData{nullptr};
+    std::size_t mSize{0};
+    bool mPinned{false};
+};
+
+} // namespace tensorrt_llm::common
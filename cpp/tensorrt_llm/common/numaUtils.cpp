@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/numaUtils.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // __linux__
+
+namespace tensorrt_llm::common
+{
+
+namespace
+{
+std::optional<std::string> readFirstLine(std::string const& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    if (!file || !std::getline(file, line))
+    {
+        return std::nullopt;
+    }
+    return line;
+}
+
+#ifdef __linux__
+// From <numaif.h>, which comes with libnuma.
+int constexpr kMpolDefault = 0;
+int constexpr kMpolPreferred = 1;
+#endif // __linux__
+} // namespace
+
+std::vector<int> parseCpuList(std::string const& cpuList)
+{
+    std::vector<int> cpus;
+    std::stringstream ranges(cpuList);
+    std::string range;
+    while (std::getline(ranges, range, ','))
+    {
+        range.erase(std::remove_if(range.begin(), range.end(), [](unsigned char c) { return std::isspace(c); }),
+            range.end());
+        if (range.empty())
+        {
+            continue;
+        }
+        auto const dash = range.find('-');
+        auto const first = std::stoi(range.substr(0, dash));
+        auto const last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::optional<int> getDeviceNumaNode(int device)
+{
+#ifdef __linux__
+    char busId[32]{};
+    if (cudaDeviceGetPCIBusId(busId, sizeof(busId), device) != cudaSuccess)
+    {
+        static_cast<void>(cudaGetLastError());
+        return std::nullopt;
+    }
+    std::string pciAddress{busId};
+    std::transform(pciAddress.begin(), pciAddress.end(), pciAddress.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    auto const numaNode = readFirstLine("/sys/bus/pci/devices/" + pciAddress + "/numa_node");
+    if (!numaNode)
+    {
+        return std::nullopt;
+    }
+    auto const node = std::stoi(*numaNode);
+    return node < 0 ? std::nullopt : std::optional<int>{node};
+#else
+    return std::nullopt;
+#endif // __linux__
+}
+
+std::vector<int> getNumaNodeCpus(int node)
+{
+    auto const cpuList = readFirstLine("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    return cpuList ? parseCpuList(*cpuList) : std::vector<int>{};
+}
+
+std::optional<int> getNumaBindingNode(int device)
+{
+    if (!getEnvNumaBinding())
+    {
+        return std::nullopt;
+    }
+    static std::mutex mutex;
+    static std::unordered_map<int, std::optional<int>> nodes;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto const it = nodes.find(device);
+    if (it != nodes.end())
+    {
+        return it->second;
+    }
+
+    auto const node = getDeviceNumaNode(device);
+    if (node)
+    {
+        auto const cpuList = readFirstLine("/sys/devices/system/node/node" + std::to_string(*node) + "/cpulist");
+        TLLM_LOG_INFO("NUMA binding: GPU %d is local to NUMA node %d (CPUs %s), its pinned host memory and worker "
+                      "threads are placed there",
+            device, *node, cpuList.value_or("unknown").c_str());
+    }
+    else
+    {
+        TLLM_LOG_INFO("NUMA binding: the NUMA node of GPU %d is unknown, its host memory and threads are not bound",
+            device);
+    }
+    nodes.emplace(device, node);
+    return node;
+}
+
+std::optional<int> getNumaBindingNode()
+{
+    if (!getEnvNumaBinding())
+    {
+        return std::nullopt;
+    }
+    return getNumaBindingNode(getDevice());
+}
+
+bool bindThreadToCpus(std::vector<int> const& cpus)
+{
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto const cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &cpuSet);
+        }
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+    {
+        TLLM_LOG_WARNING("Failed to bind the thread to %zu CPUs", cpus.size());
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif // __linux__
+}
+
+bool bindThreadToNumaNode(int node)
+{
+    auto const cpus = getNumaNodeCpus(node);
+    if (cpus.empty())
+    {
+        TLLM_LOG_WARNING("NUMA binding: no CPUs found for NUMA node %d", node);
+        return false;
+    }
+    return bindThreadToCpus(cpus);
+}
+
+ScopedNumaMemoryPolicy::ScopedNumaMemoryPolicy(std::optional<int> node)
+{
+#ifdef __linux__
+    auto constexpr kMaxNodes = static_cast<unsigned long>(kMaxNodeMaskWords) * sizeof(unsigned long) * 8;
+    if (!node || *node < 0 || static_cast<unsigned long>(*node) >= kMaxNodes)
+    {
+        return;
+    }
+    // The kernel reads maxnode - 1 bits of the masks.
+    if (syscall(SYS_get_mempolicy, &mPrevMode, mPrevNodeMask, kMaxNodes + 1, nullptr, 0UL) != 0)
+    {
+        return;
+    }
+    unsigned long nodeMask[kMaxNodeMaskWords]{};
+    auto constexpr kBitsPerWord = sizeof(unsigned long) * 8;
+    nodeMask[*node / kBitsPerWord] = 1UL << (*node % kBitsPerWord);
+    mActive = syscall(SYS_set_mempolicy, kMpolPreferred, nodeMask, kMaxNodes + 1) == 0;
+#endif // __linux__
+}
+
+ScopedNumaMemoryPolicy::~ScopedNumaMemoryPolicy()
+{
+#ifdef __linux__
+    if (mActive)
+    {
+        auto constexpr kMaxNodes = static_cast<unsigned long>(kMaxNodeMaskWords) * sizeof(unsigned long) * 8;
+        auto const* const prevNodeMask = mPrevMode == kMpolDefault ? nullptr : mPrevNodeMask;
+        static_cast<void>(syscall(SYS_set_mempolicy, mPrevMode, prevNodeMask, kMaxNodes + 1));
+    }
+#endif // __linux__
+}
+
+} // namespace tensorrt_llm::common
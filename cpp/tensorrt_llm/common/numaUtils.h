@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief NUMA node closest to a GPU, read from the PCI topology in sysfs. Not set when the system does not report it,
+//! e.g. on single node systems or outside of Linux.
+std::optional<int> getDeviceNumaNode(int device);
+
+//! \brief CPUs of a NUMA node, empty if unknown.
+std::vector<int> getNumaNodeCpus(int node);
+
+//! \brief Parse a sysfs CPU list such as "0-15,32-47".
+std::vector<int> parseCpuList(std::string const& cpuList);
+
+//! \brief NUMA node the host memory and the threads of a GPU are bound to. Set when TRTLLM_NUMA_BINDING is enabled and
+//! the node of the GPU is known. The placement is logged the first time a GPU is queried.
+std::optional<int> getNumaBindingNode(int device);
+
+//! \brief getNumaBindingNode of the current device.
+std::optional<int> getNumaBindingNode();
+
+//! \brief Restrict the calling thread to a set of CPUs.
+//! \return Whether the affinity was set.
+bool bindThreadToCpus(std::vector<int> const& cpus);
+
+//! \brief Restrict the calling thread to the CPUs of a NUMA node.
+//! \return Whether the affinity was set.
+bool bindThreadToNumaNode(int node);
+
+//! \brief Prefers a NUMA node for the pages the calling thread allocates, e.g. while the driver pins a host allocation,
+//! and restores the previous policy of the thread on destruction. Does nothing without a node.
+class ScopedNumaMemoryPolicy
+{
+public:
+    explicit ScopedNumaMemoryPolicy(std::optional<int> node);
+
+    ScopedNumaMemoryPolicy(ScopedNumaMemoryPolicy const&) = delete;
+    ScopedNumaMemoryPolicy& operator=(ScopedNumaMemoryPolicy const&) = delete;
+
+    ~ScopedNumaMemoryPolicy();
+
+private:
+    static int constexpr kMaxNodeMaskWords{16};
+
+    bool mActive{false};
+    int mPrevMode{0};
+    unsigned long mPrevNodeMask[kMaxNodeMaskWords]{};
+};
+
+} // namespace tensorrt_llm::common
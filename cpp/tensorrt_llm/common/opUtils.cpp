@@ -16,6 +16,7 @@
  */
 #include "tensorrt_llm/common/opUtils.h"
 #include "tensorrt_llm/common/mpiUtils.h"
+#include "tensorrt_llm/common/startupTrace.h"
 
 #include "cuda.h"
 #include <cstdint>
@@ -111,7 +112,10 @@ std::shared_ptr<ncclComm_t> getComm(std::set<int> const& group)
 #else
     setenv("NCCL_RUNTIME_CONNECT", "0", 0);
 #endif // _WIN32
-    NCCLCHECK(ncclCommInitRank(ncclComm.get(), group.size(), id, groupRank));
+    {
+        TLLM_STARTUP_PHASE("nccl_comm_init");
+        NCCLCHECK(ncclCommInitRank(ncclComm.get(), group.size(), id, groupRank));
+    }
     commMap[group] = ncclComm;
     TLLM_LOG_TRACE("%s stop for rank %d", __PRETTY_FUNCTION__, rank);
     return ncclComm;
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+
+#include <cuda_runtime.h>
+
+#include <utility>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief Programmatic dependent launch (PDL) of the kernels of a step on SM90+, enabled by TRTLLM_ENABLE_PDL.
+//! \details A kernel launched with launchWithPdl may start while the kernel before it on the stream is still running:
+//! it must call pdlWaitPrimaryGrid before it reads what the kernels before it wrote, or writes what they read, and
+//! only the prologue before that call, the index math and the loads of read-only data such as weights, overlaps the
+//! tail of the previous kernel. pdlLaunchDependents lets the next kernel start its own prologue, it may be called once
+//! the kernel does not need its SMs for itself anymore, the visibility of its writes is still at its completion. Both
+//! are no-ops below SM90 and in kernels launched without the attribute.
+__device__ __forceinline__ void pdlWaitPrimaryGrid()
+{
+#if (defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 900))
+    cudaGridDependencySynchronize();
+#endif
+}
+
+__device__ __forceinline__ void pdlLaunchDependents()
+{
+#if (defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 900))
+    cudaTriggerProgrammaticLaunchCompletion();
+#endif
+}
+
+//! \brief Launch a kernel with programmatic stream serialization if PDL is enabled, with <<<>>> otherwise. The kernel
+//! must call pdlWaitPrimaryGrid.
+template <typename... KernelArgs, typename... Args>
+void launchWithPdl(void (*kernel)(KernelArgs...), dim3 grid, dim3 block, size_t dynamicSmemBytes, cudaStream_t stream,
+    Args&&... args)
+{
+    if (getEnvEnablePDL())
+    {
+        cudaLaunchConfig_t kernelConfig = {0};
+        kernelConfig.gridDim = grid;
+        kernelConfig.blockDim = block;
+        kernelConfig.dynamicSmemBytes = dynamicSmemBytes;
+        kernelConfig.stream = stream;
+
+        cudaLaunchAttribute attribute[1];
+        attribute[0].id = cudaLaunchAttributeProgrammaticStreamSerialization;
+        attribute[0].val.programmaticStreamSerializationAllowed = 1;
+        kernelConfig.attrs = attribute;
+        kernelConfig.numAttrs = 1;
+
+        TLLM_CUDA_CHECK(cudaLaunchKernelEx(&kernelConfig, kernel, std::forward<Args>(args)...));
+    }
+    else
+    {
+        kernel<<<grid, block, dynamicSmemBytes, stream>>>(std::forward<Args>(args)...);
+    }
+}
+
+} // namespace tensorrt_llm::common
@@ -17,9 +17,10 @@
 #include "safetensors.h"
 #include "nlohmann/json.hpp"
 #include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/memoryMappedFile.h"
 #include <NvInferRuntime.h>
 #include <cstdint>
-#include <fstream>
+#include <cstring>
 #include <map>
 #include <memory>
 #include <utility>
@@ -55,34 +56,29 @@ static DataType convertDataTypeStrToEnum(std::string const& str)
 class SafeTensorArray : public INdArray
 {
     std::vector<int64_t> mShape;
-    mutable std::unique_ptr<std::byte[]> mData;
     DataType mDataType;
     int64_t mOffsetBegin; // adjusted to represent offset relative to the beginning of the file
     int64_t mOffsetEnd;   // adjusted to represent offset relative to the beginning of the file
-    std::shared_ptr<std::ifstream> mFs;
+    std::shared_ptr<MemoryMappedFile const> mFile;
 
 public:
-    SafeTensorArray(std::shared_ptr<std::ifstream> const& fs, std::string const& dtypeStr,
+    SafeTensorArray(std::shared_ptr<MemoryMappedFile const> file, std::string const& dtypeStr,
         std::vector<int64_t> const& shape, int64_t offsetBegin, int64_t offsetEnd)
-        : mFs(fs)
-        , mShape(shape)
+        : mShape(shape)
         , mDataType(convertDataTypeStrToEnum(dtypeStr))
         , mOffsetBegin(offsetBegin)
         , mOffsetEnd(offsetEnd)
+        , mFile(std::move(file))
     {
+        TLLM_CHECK_WITH_INFO(0 <= mOffsetBegin && mOffsetBegin <= mOffsetEnd
+                && static_cast<std::size_t>(mOffsetEnd) <= mFile->size(),
+            "Tensor data is out of the bounds of %s", mFile->getPath().c_str());
     }
 
+    // Points into the mapping of the file, so the data can be copied to the device without a host copy.
     [[nodiscard]] void const* data() const override
     {
-        if (!mData)
-        {
-            mFs->seekg(mOffsetBegin);
-            int64_t size = mOffsetEnd - mOffsetBegin;
-            mData.reset(new std::byte[size]);
-            mFs->read(reinterpret_cast<char*>(mData.get()), size);
-        }
-
-        return mData.get();
+        return mFile->data() + mOffsetBegin;
     }
 
     [[nodiscard]] int ndim() const override
@@ -99,6 +95,16 @@ public:
     {
         return mDataType;
     }
+
+    [[nodiscard]] std::size_t fileOffset() const override
+    {
+        return static_cast<std::size_t>(mOffsetBegin);
+    }
+
+    [[nodiscard]] std::size_t sizeInBytes() const override
+    {
+        return static_cast<std::size_t>(mOffsetEnd - mOffsetBegin);
+    }
 };
 
 // Implemented based on safetensors 0.4.3.
@@ -107,20 +113,18 @@ class SafeTensor : public ISafeTensor
     int64_t mJsonSize;
     std::map<std::string, std::string> mMetadata;
     std::map<std::string, nlohmann::basic_json<>> mTensorInfo;
-    std::shared_ptr<std::ifstream> mFs;
+    std::shared_ptr<MemoryMappedFile> mFile;
 
 public:
     SafeTensor(char const* filename)
-        : mFs(new std::ifstream(filename, std::ios::binary))
+        : mFile(std::make_shared<MemoryMappedFile>(filename, MemoryMappedFile::Mode::kREAD_ONLY))
     {
-        if (!mFs->is_open())
-        {
-            TLLM_THROW("Failed to open file: " + std::string(filename));
-        }
-        mFs->read(reinterpret_cast<char*>(&mJsonSize), sizeof(mJsonSize));
-        std::vector<char> jsonBuffer(mJsonSize);
-        mFs->read(jsonBuffer.data(), mJsonSize);
-        nlohmann::json attributes = nlohmann::json::parse(jsonBuffer);
+        TLLM_CHECK_WITH_INFO(mFile->size() >= sizeof(mJsonSize), "Invalid safetensors file: " + std::string(filename));
+        std::memcpy(&mJsonSize, mFile->data(), sizeof(mJsonSize));
+        TLLM_CHECK_WITH_INFO(mJsonSize >= 0 && static_cast<std::size_t>(mJsonSize) <= mFile->size() - sizeof(mJsonSize),
+            "Invalid safetensors file: " + std::string(filename));
+        auto const* jsonBegin = reinterpret_cast<char const*>(mFile->data()) + sizeof(mJsonSize);
+        nlohmann::json attributes = nlohmann::json::parse(jsonBegin, jsonBegin + mJsonSize);
         for (auto const& [key, value] : attributes.items())
         {
             if (key == "__metadata__")
@@ -152,12 +156,27 @@ public:
         {
             auto const& value = it->second;
             int64_t offset = mJsonSize + sizeof(mJsonSize);
-            return std::make_shared<SafeTensorArray>(mFs, value["dtype"], value["shape"],
+            return std::make_shared<SafeTensorArray>(mFile, value["dtype"], value["shape"],
                 static_cast<int64_t>(value["data_offsets"][0]) + offset,
                 static_cast<int64_t>(value["data_offsets"][1]) + offset);
         }
         TLLM_THROW("Tensor not found: " + std::string(name));
     }
+
+    [[nodiscard]] std::string const& path() const override
+    {
+        return mFile->getPath();
+    }
+
+    void prefetch(std::size_t numThreads) const override
+    {
+        mFile->prefetch(mJsonSize + sizeof(mJsonSize), 0, numThreads);
+    }
+
+    bool pin() override
+    {
+        return mFile->pin();
+    }
 };
 
 std::shared_ptr<ISafeTensor> ISafeTensor::open(char const* filename)
@@ -21,6 +21,7 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <string>
 #include <utility>
 
 namespace tensorrt_llm::common::safetensors
@@ -33,6 +34,10 @@ public:
     [[nodiscard]] virtual std::vector<int64_t> const& dims() const = 0;
     [[nodiscard]] virtual nvinfer1::DataType dtype() const = 0;
 
+    //! \brief Location of the data in the file, for loaders that read it without mapping the file.
+    [[nodiscard]] virtual std::size_t fileOffset() const = 0;
+    [[nodiscard]] virtual std::size_t sizeInBytes() const = 0;
+
     [[nodiscard]] nvinfer1::Dims trtDims() const
     {
         nvinfer1::Dims dims;
@@ -55,6 +60,17 @@ public:
     static std::shared_ptr<ISafeTensor> open(char const* filename);
     virtual std::shared_ptr<INdArray> getTensor(char const* name) = 0;
     virtual std::vector<std::string> keys() = 0;
+    [[nodiscard]] virtual std::string const& path() const = 0;
+
+    //! \brief Read the tensor data of the file in from numThreads threads, so that the first accesses to the data of
+    //! the tensors do not wait on the file.
+    virtual void prefetch(std::size_t numThreads) const = 0;
+
+    //! \brief Pin the mapping of the file, see MemoryMappedFile::pin. The data of the tensors can then be copied to
+    //! the device asynchronously, straight from the page cache.
+    //! \return Whether the mapping is pinned.
+    virtual bool pin() = 0;
+
     virtual ~ISafeTensor() = default;
 };
 
@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/shmRingBuffer.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <new>
+
+#ifndef _WIN32
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif // _WIN32
+
+namespace tensorrt_llm::common
+{
+
+struct ShmRingBuffer::Control
+{
+    std::uint64_t magic;
+    std::uint64_t capacity;
+    // Written by the producer only.
+    alignas(64) std::atomic<std::uint64_t> head;
+    // Number of pushes, the futex word waiting consumers sleep on.
+    std::atomic<std::uint32_t> sequence;
+    std::atomic<std::uint32_t> closed;
+    // Written by the consumer only.
+    alignas(64) std::atomic<std::uint64_t> tail;
+    std::atomic<std::uint32_t> numWaiters;
+};
+
+namespace
+{
+constexpr std::uint64_t kMagic = 0x54524C4C4D52494EULL; // "TRLLMRIN"
+constexpr std::size_t kAlignment = 8;
+constexpr std::size_t kDataOffset = 256;
+// Length of the padding record at the end of the ring when a message does not fit contiguously.
+constexpr std::uint64_t kWrapMarker = std::numeric_limits<std::uint64_t>::max();
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free && std::atomic<std::uint32_t>::is_always_lock_free,
+    "Shared memory atomics must be lock free");
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "The futex word must be 32 bits");
+
+std::size_t align(std::size_t size)
+{
+    return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+std::string getPath(std::string const& name)
+{
+    TLLM_CHECK_WITH_INFO(!name.empty() && name.find('/') == std::string::npos, "Invalid ring buffer name %s",
+        name.c_str());
+    return "/dev/shm/" + name;
+}
+
+#ifndef _WIN32
+void futexWait(std::atomic<std::uint32_t>& word, std::uint32_t expected, std::chrono::microseconds timeout)
+{
+    auto const seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    timespec const ts{static_cast<time_t>(seconds.count()),
+        static_cast<long>(std::chrono::duration_cast<std::chrono::nanoseconds>(timeout - seconds).count())};
+    // Shared futex, the word is mapped by both processes.
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+void futexWake(std::atomic<std::uint32_t>& word)
+{
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+#endif // _WIN32
+} // namespace
+
+std::unique_ptr<ShmRingBuffer> ShmRingBuffer::create(std::string const& name, std::size_t capacity)
+{
+    TLLM_CHECK(capacity > 0);
+    std::size_t roundedCapacity{kAlignment};
+    while (roundedCapacity < capacity)
+    {
+        roundedCapacity *= 2;
+    }
+    MemoryMappedFile file{getPath(name), MemoryMappedFile::Mode::kCREATE, kDataOffset + roundedCapacity};
+    auto* control = new (file.data()) Control{};
+    control->capacity = roundedCapacity;
+    // Publish the ring only once it is initialized.
+    std::atomic_thread_fence(std::memory_order_release);
+    control->magic = kMagic;
+    return std::unique_ptr<ShmRingBuffer>(new ShmRingBuffer(std::move(file), true));
+}
+
+std::unique_ptr<ShmRingBuffer> ShmRingBuffer::open(std::string const& name)
+{
+    MemoryMappedFile file{getPath(name), MemoryMappedFile::Mode::kREAD_WRITE};
+    TLLM_CHECK_WITH_INFO(file.size() > kDataOffset, "Ring buffer %s is too small", name.c_str());
+    auto const* control = reinterpret_cast<Control const*>(file.data());
+    TLLM_CHECK_WITH_INFO(control->magic == kMagic, "%s is not an initialized ring buffer", name.c_str());
+    std::atomic_thread_fence(std::memory_order_acquire);
+    TLLM_CHECK(kDataOffset + control->capacity == file.size());
+    return std::unique_ptr<ShmRingBuffer>(new ShmRingBuffer(std::move(file), false));
+}
+
+ShmRingBuffer::ShmRingBuffer(MemoryMappedFile file, bool isProducer)
+    : mFile{std::move(file)}
+    , mIsProducer{isProducer}
+{
+    static_assert(sizeof(Control) <= kDataOffset);
+}
+
+ShmRingBuffer::~ShmRingBuffer()
+{
+    if (mIsProducer)
+    {
+        close();
+#ifndef _WIN32
+        // The consumer keeps its mapping, the name is released right away.
+        ::unlink(mFile.getPath().c_str());
+#endif // _WIN32
+    }
+}
+
+ShmRingBuffer::Control& ShmRingBuffer::getControl() noexcept
+{
+    return *reinterpret_cast<Control*>(mFile.data());
+}
+
+ShmRingBuffer::Control const& ShmRingBuffer::getControl() const noexcept
+{
+    return *reinterpret_cast<Control const*>(mFile.data());
+}
+
+char* ShmRingBuffer::getData() noexcept
+{
+    return reinterpret_cast<char*>(mFile.data() + kDataOffset);
+}
+
+std::size_t ShmRingBuffer::getMaxMessageSize() const noexcept
+{
+    // A message may have to skip up to its own size at the end of the ring.
+    return getControl().capacity / 2 - sizeof(std::uint64_t);
+}
+
+bool ShmRingBuffer::tryPush(void const* data, std::size_t size)
+{
+    TLLM_CHECK_WITH_INFO(mIsProducer, "Only the producer pushes to a ring buffer");
+    TLLM_CHECK_WITH_INFO(size <= getMaxMessageSize(), "Message of %zu bytes exceeds the ring buffer limit of %zu",
+        size, getMaxMessageSize());
+    auto& control = getControl();
+    auto const capacity = control.capacity;
+    auto const head = control.head.load(std::memory_order_relaxed);
+    auto const tail = control.tail.load(std::memory_order_acquire);
+    auto const recordSize = sizeof(std::uint64_t) + align(size);
+    auto const offset = head & (capacity - 1);
+    auto const skip = capacity - offset < recordSize ? capacity - offset : 0;
+    if (capacity - (head - tail) < skip + recordSize)
+    {
+        return false;
+    }
+
+    auto* ring = getData();
+    if (skip > 0)
+    {
+        std::memcpy(ring + offset, &kWrapMarker, sizeof(kWrapMarker));
+    }
+    auto const start = (head + skip) & (capacity - 1);
+    std::uint64_t const length = size;
+    std::memcpy(ring + start, &length, sizeof(length));
+    std::memcpy(ring + start + sizeof(length), data, size);
+    control.head.store(head + skip + recordSize, std::memory_order_release);
+
+    // Sequentially consistent with the registration of waiters, so no wakeup is lost.
+    control.sequence.fetch_add(1, std::memory_order_seq_cst);
+#ifndef _WIN32
+    if (control.numWaiters.load(std::memory_order_seq_cst) > 0)
+    {
+        futexWake(control.sequence);
+    }
+#endif // _WIN32
+    return true;
+}
+
+std::optional<ArrayView<char const>> ShmRingBuffer::front()
+{
+    auto& control = getControl();
+    auto const capacity = control.capacity;
+    auto tail = control.tail.load(std::memory_order_relaxed);
+    auto const head = control.head.load(std::memory_order_acquire);
+    auto* ring = getData();
+    while (tail != head)
+    {
+        std::uint64_t length;
+        std::memcpy(&length, ring + (tail & (capacity - 1)), sizeof(length));
+        if (length == kWrapMarker)
+        {
+            tail = (tail + capacity) & ~(capacity - 1);
+            control.tail.store(tail, std::memory_order_release);
+            continue;
+        }
+        return ArrayView<char const>{ring + (tail & (capacity - 1)) + sizeof(length), length};
+    }
+    return std::nullopt;
+}
+
+void ShmRingBuffer::popFront()
+{
+    auto const message = front();
+    TLLM_CHECK_WITH_INFO(message.has_value(), "Pop from an empty ring buffer");
+    auto& control = getControl();
+    auto const tail = control.tail.load(std::memory_order_relaxed);
+    control.tail.store(tail + sizeof(std::uint64_t) + align(message->size()), std::memory_order_release);
+}
+
+bool ShmRingBuffer::waitPop(std::vector<char>& message, std::chrono::microseconds timeout)
+{
+    auto& control = getControl();
+    auto const deadline = std::chrono::steady_clock::now() + timeout;
+    while (true)
+    {
+        auto const sequence = control.sequence.load(std::memory_order_acquire);
+        if (auto const view = front())
+        {
+            message.assign(view->begin(), view->end());
+            popFront();
+            return true;
+        }
+        auto const now = std::chrono::steady_clock::now();
+        if (isClosed() || now >= deadline)
+        {
+            return false;
+        }
+#ifndef _WIN32
+        control.numWaiters.fetch_add(1, std::memory_order_seq_cst);
+        // Returns right away if a push happened since sequence was read.
+        futexWait(control.sequence, sequence,
+            std::chrono::duration_cast<std::chrono::microseconds>(deadline - now) + std::chrono::microseconds{1});
+        control.numWaiters.fetch_sub(1, std::memory_order_seq_cst);
+#endif // _WIN32
+    }
+}
+
+void ShmRingBuffer::close()
+{
+    auto& control = getControl();
+    control.closed.store(1, std::memory_order_release);
+    control.sequence.fetch_add(1, std::memory_order_release);
+#ifndef _WIN32
+    futexWake(control.sequence);
+#endif // _WIN32
+}
+
+bool ShmRingBuffer::isClosed() const noexcept
+{
+    return getControl().closed.load(std::memory_order_acquire) != 0;
+}
+
+} // namespace tensorrt_llm::common
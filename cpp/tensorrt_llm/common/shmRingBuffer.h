@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/arrayView.h"
+#include "tensorrt_llm/common/memoryMappedFile.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief Single producer, single consumer ring of variable sized messages in shared memory, for processes on the
+//! same host.
+//! \details The ring lives in a file under /dev/shm that the producer creates and removes. Head and tail are byte
+//! positions that only grow, so the ring needs no lock: the producer only writes the head and the consumer only
+//! writes the tail. Messages are stored contiguously and aligned to 8 bytes, so the consumer can read them in place
+//! before releasing them. A waiting consumer sleeps on a futex that the producer only wakes if someone waits. Only
+//! supported on Linux.
+class ShmRingBuffer
+{
+public:
+    //! \brief Create the ring as the producer. The capacity is rounded up to a power of two.
+    static std::unique_ptr<ShmRingBuffer> create(std::string const& name, std::size_t capacity);
+
+    //! \brief Open the ring that a producer created, as the consumer.
+    static std::unique_ptr<ShmRingBuffer> open(std::string const& name);
+
+    ShmRingBuffer(ShmRingBuffer const&) = delete;
+    ShmRingBuffer& operator=(ShmRingBuffer const&) = delete;
+
+    ~ShmRingBuffer();
+
+    //! \brief Largest message that fits into the ring.
+    [[nodiscard]] std::size_t getMaxMessageSize() const noexcept;
+
+    //! \brief Append a message. Returns false without blocking if the ring has no room for it.
+    bool tryPush(void const* data, std::size_t size);
+
+    //! \brief The oldest message, read in place, or not set if the ring is empty. Valid until popFront.
+    [[nodiscard]] std::optional<ArrayView<char const>> front();
+
+    void popFront();
+
+    //! \brief Copy out and release the oldest message, waiting up to timeout for one to arrive.
+    bool waitPop(std::vector<char>& message, std::chrono::microseconds timeout);
+
+    //! \brief Mark the ring as closed by the producer, waking a waiting consumer.
+    void close();
+
+    [[nodiscard]] bool isClosed() const noexcept;
+
+private:
+    struct Control;
+
+    ShmRingBuffer(MemoryMappedFile file, bool isProducer);
+
+    [[nodiscard]] Control& getControl() noexcept;
+    [[nodiscard]] Control const& getControl() const noexcept;
+    [[nodiscard]] char* getData() noexcept;
+
+    MemoryMappedFile mFile;
+    bool mIsProducer;
+};
+
+} // namespace tensorrt_llm::common
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/startupTrace.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/mpiUtils.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace tensorrt_llm::common
+{
+
+namespace
+{
+double toMs(StartupTrace::Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+} // namespace
+
+StartupTrace::ScopedPhase::ScopedPhase(char const* name)
+    : mName{name}
+    , mStart{Clock::now()}
+    , mRange{nvtx::nextColor(), name}
+{
+}
+
+StartupTrace::ScopedPhase::~ScopedPhase()
+{
+    auto const end = Clock::now();
+    TLLM_LOG_DEBUG("[StartupTrace] %s took %.2f ms", mName, toMs(end - mStart));
+    StartupTrace::getInstance().record(mName, mStart, end);
+}
+
+StartupTrace::StartupTrace()
+    : mOrigin{Clock::now()}
+{
+}
+
+StartupTrace& StartupTrace::getInstance()
+{
+    static StartupTrace trace;
+    return trace;
+}
+
+void StartupTrace::record(std::string const& name, Clock::time_point start, Clock::time_point end)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = std::find_if(mPhases.begin(), mPhases.end(), [&name](Phase const& phase) { return phase.name == name; });
+    if (it == mPhases.end())
+    {
+        it = mPhases.insert(mPhases.end(), Phase{name, toMs(start - mOrigin), 0, 0});
+    }
+    it->durationMs += toMs(end - start);
+    ++it->count;
+}
+
+std::vector<StartupTrace::Phase> StartupTrace::getPhases() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPhases;
+}
+
+std::string StartupTrace::toJson() const
+{
+    auto const phases = getPhases();
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{\"rank\": " << mpi::MpiComm::world().getRank() << ", \"phases\": [";
+    for (std::size_t idx = 0; idx < phases.size(); ++idx)
+    {
+        auto const& phase = phases[idx];
+        ss << (idx == 0 ? "" : ", ") << "{\"name\": \"" << phase.name << "\", \"start_ms\": " << phase.startMs
+           << ", \"duration_ms\": " << phase.durationMs << ", \"count\": " << phase.count << "}";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+void StartupTrace::reset()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mOrigin = Clock::now();
+    mPhases.clear();
+}
+
+} // namespace tensorrt_llm::common
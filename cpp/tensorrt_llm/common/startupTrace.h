@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/nvtxUtils.h"
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief Timings of the phases of the startup of a rank, e.g. the engine deserialization, the GEMM plugin profiling
+//! or the all-reduce IPC setup.
+//! \details A phase is timed by a ScopedPhase, which also emits an NVTX range. The phases entered several times, e.g.
+//! the profiling of every GEMM plugin, add up to one entry with a count.
+class StartupTrace
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Phase
+    {
+        std::string name;
+        //! \brief Start of the first entry, since the trace was created or reset.
+        double startMs{0};
+        //! \brief Time spent in the phase over all its entries.
+        double durationMs{0};
+        std::size_t count{0};
+    };
+
+    class ScopedPhase
+    {
+    public:
+        explicit ScopedPhase(char const* name);
+        ~ScopedPhase();
+
+        ScopedPhase(ScopedPhase const&) = delete;
+        ScopedPhase& operator=(ScopedPhase const&) = delete;
+
+    private:
+        char const* mName;
+        Clock::time_point mStart;
+        nvtx3::scoped_range mRange;
+    };
+
+    static StartupTrace& getInstance();
+
+    void record(std::string const& name, Clock::time_point start, Clock::time_point end);
+
+    //! \brief The phases in the order they were first entered.
+    [[nodiscard]] std::vector<Phase> getPhases() const;
+
+    //! \brief The phases of this rank as a JSON object: {"rank": r, "phases": [{"name", "start_ms", "duration_ms",
+    //! "count"}, ...]}.
+    [[nodiscard]] std::string toJson() const;
+
+    void reset();
+
+private:
+    StartupTrace();
+
+    mutable std::mutex mMutex;
+    Clock::time_point mOrigin;
+    std::vector<Phase> mPhases;
+};
+
+} // namespace tensorrt_llm::common
+
+#define TLLM_STARTUP_PHASE(name) ::tensorrt_llm::common::StartupTrace::ScopedPhase startupPhase_(name)
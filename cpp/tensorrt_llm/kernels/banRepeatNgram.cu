@@ -162,12 +162,148 @@ void invokeBanRepeatNgram(T* logits, TokenIdType const** output_ids_buf, Finishe
     sync_check_cuda_error();
 }
 
+namespace
+{
+__device__ uint32_t hash_ngram_context(TokenIdType const* tokens, SizeType32 length)
+{
+    // FNV-1a over the token ids.
+    uint32_t hash{2166136261u};
+    for (SizeType32 idx = 0; idx < length; idx++)
+    {
+        hash = (hash ^ static_cast<uint32_t>(tokens[idx])) * 16777619u;
+    }
+    return hash;
+}
+} // namespace
+
+template <typename T>
+__global__ void ban_repeat_ngram_incremental(T* logits, TokenIdType const** output_ids_buf,
+    FinishedState const* finished_buf, SizeType32 const* batch_slots, SizeType32 const* no_repeat_ngram_size_buf,
+    SizeType32 vocab_size_padded, SizeType32 const* sequence_lengths, SizeType32* ngram_tables, SizeType32 table_size)
+{
+    /**
+     * Same result as ban_repeat_ngram for beam width 1, without rescanning the sequence. The table of a sequence maps
+     * the hash of the first (ngram_size - 1) tokens of every n-gram to the position of its last token. Each call
+     * inserts the n-grams that end in the tokens generated since the last call, then bans the last token of every
+     * n-gram whose first tokens match the last (ngram_size - 1) generated tokens. Hash matches are verified against
+     * output_ids_buf, so collisions do not ban tokens.
+     */
+
+    auto const local_batch_idx = static_cast<SizeType32>(blockIdx.x);
+    auto const batch_slot = batch_slots != nullptr ? batch_slots[local_batch_idx] : local_batch_idx;
+    auto const no_repeat_ngram_size = no_repeat_ngram_size_buf[batch_slot];
+    auto const step = sequence_lengths[batch_slot];
+
+    if (no_repeat_ngram_size == 0 || step < no_repeat_ngram_size)
+    {
+        return;
+    }
+
+    if ((finished_buf != nullptr) && (finished_buf[batch_slot].isFinished()))
+    {
+        return;
+    }
+
+    auto const* output_ids = output_ids_buf[batch_slot];
+    auto* num_indexed = ngram_tables + static_cast<int64_t>(batch_slot) * (1 + 2 * table_size);
+    auto* positions = num_indexed + 1;
+    auto* hashes = positions + table_size;
+    auto const context_length = no_repeat_ngram_size - 1;
+
+    auto first_new_idx = *num_indexed;
+    if (step < first_new_idx)
+    {
+        // The sequence was rewound, index it again.
+        for (auto slot = static_cast<SizeType32>(threadIdx.x); slot < table_size;
+             slot += static_cast<SizeType32>(blockDim.x))
+        {
+            positions[slot] = 0;
+        }
+        first_new_idx = 0;
+        __syncthreads();
+    }
+
+    // Insert the n-grams ending at positions [max(first_new_idx, ngram_size - 1), step).
+    for (auto last_idx = max(first_new_idx, context_length) + static_cast<SizeType32>(threadIdx.x); last_idx < step;
+         last_idx += static_cast<SizeType32>(blockDim.x))
+    {
+        auto const hash = hash_ngram_context(output_ids + last_idx - context_length, context_length);
+        auto slot = static_cast<SizeType32>(hash & (table_size - 1));
+        while (atomicCAS(&positions[slot], 0, last_idx + 1) != 0)
+        {
+            slot = (slot + 1) & (table_size - 1);
+        }
+        hashes[slot] = static_cast<SizeType32>(hash);
+    }
+
+    __syncthreads();
+
+    if (threadIdx.x != 0)
+    {
+        return;
+    }
+    *num_indexed = step;
+
+    auto const* last_tokens = output_ids + step - context_length;
+    auto const hash = hash_ngram_context(last_tokens, context_length);
+    for (auto slot = static_cast<SizeType32>(hash & (table_size - 1)); positions[slot] != 0;
+         slot = (slot + 1) & (table_size - 1))
+    {
+        if (hashes[slot] != static_cast<SizeType32>(hash))
+        {
+            continue;
+        }
+        auto const banned_idx = positions[slot] - 1;
+        bool ban_ngram = true;
+        for (SizeType32 ngram_idx = 0; ngram_idx < context_length; ngram_idx++)
+        {
+            if (output_ids[banned_idx - context_length + ngram_idx] != last_tokens[ngram_idx])
+            {
+                ban_ngram = false;
+                break;
+            }
+        }
+        if (ban_ngram)
+        {
+            logits[local_batch_idx * vocab_size_padded + output_ids[banned_idx]] = static_cast<T>(-INFINITY);
+        }
+    }
+}
+
+SizeType32 getBanRepeatNgramTableSize(SizeType32 maxSeqLen)
+{
+    // A sequence holds fewer than maxSeqLen n-grams, keep the table at most half full.
+    SizeType32 tableSize{1};
+    while (tableSize < 2 * maxSeqLen)
+    {
+        tableSize *= 2;
+    }
+    return tableSize;
+}
+
+template <typename T>
+void invokeBanRepeatNgramIncremental(T* logits, TokenIdType const** output_ids_buf, FinishedState const* finished_buf,
+    SizeType32 const* batch_slot, SizeType32 const* sequence_lengths, SizeType32 batch_size,
+    SizeType32 const* no_repeat_ngram_size_buf, SizeType32 vocab_size_padded, SizeType32* ngram_tables,
+    SizeType32 table_size, cudaStream_t stream)
+{
+    // One block per sequence. Blocks only do more than one insertion for the prompt.
+    constexpr SizeType32 block_size{256};
+    ban_repeat_ngram_incremental<<<batch_size, block_size, 0, stream>>>(logits, output_ids_buf, finished_buf,
+        batch_slot, no_repeat_ngram_size_buf, vocab_size_padded, sequence_lengths, ngram_tables, table_size);
+    sync_check_cuda_error();
+}
+
 #define INVOKE_BAN_REPEAT_NGRAM(T)                                                                                     \
     template void invokeBanRepeatNgram(T* logits, TokenIdType const** output_ids_buf,                                  \
         const FinishedState* finished_buf, SizeType32 const** parent_ids_buf, SizeType32 const* batch_slot,            \
         SizeType32 const* sequence_lengths, SizeType32 batch_size, SizeType32 beam_width, SizeType32 max_seq_len,      \
         SizeType32 const* no_repeat_ngram_size_buf, SizeType32 vocab_size_padded, SizeType32 max_step,                 \
-        cudaStream_t stream);
+        cudaStream_t stream);                                                                                          \
+    template void invokeBanRepeatNgramIncremental(T* logits, TokenIdType const** output_ids_buf,                       \
+        FinishedState const* finished_buf, SizeType32 const* batch_slot, SizeType32 const* sequence_lengths,           \
+        SizeType32 batch_size, SizeType32 const* no_repeat_ngram_size_buf, SizeType32 vocab_size_padded,               \
+        SizeType32* ngram_tables, SizeType32 table_size, cudaStream_t stream);
 
 INVOKE_BAN_REPEAT_NGRAM(float)
 INVOKE_BAN_REPEAT_NGRAM(half)
@@ -33,5 +33,22 @@ void invokeBanRepeatNgram(T* logits, runtime::TokenIdType const** output_ids_buf
     runtime::SizeType32 max_seq_len, runtime::SizeType32 const* no_repeat_ngram_size_buf,
     runtime::SizeType32 vocab_size_padded, runtime::SizeType32 max_step, cudaStream_t stream);
 
+//! \brief Returns the number of slots of the n-gram table of a sequence, for sequences of up to maxSeqLen tokens.
+runtime::SizeType32 getBanRepeatNgramTableSize(runtime::SizeType32 maxSeqLen);
+
+//! \brief Bans repeat n-grams for beam width 1 from a table of the n-grams seen by every sequence, which is extended
+//! by the tokens generated since the last call only. Each batch slot of ngram_tables holds 1 + 2 * table_size
+//! entries: the number of indexed tokens, the positions + 1 of the last token of every n-gram (0 for an empty slot)
+//! and the hashes of their first n - 1 tokens. The tables of a new request must be zeroed.
+//!
+//! \param ngram_tables [maxBatchSize, 1 + 2 * table_size], on gpu
+//! \param table_size number of slots per sequence, from getBanRepeatNgramTableSize
+template <typename T>
+void invokeBanRepeatNgramIncremental(T* logits, runtime::TokenIdType const** output_ids_buf,
+    FinishedState const* finished_buf, runtime::SizeType32 const* batch_slot,
+    runtime::SizeType32 const* sequence_lengths, runtime::SizeType32 batch_size,
+    runtime::SizeType32 const* no_repeat_ngram_size_buf, runtime::SizeType32 vocab_size_padded,
+    runtime::SizeType32* ngram_tables, runtime::SizeType32 table_size, cudaStream_t stream);
+
 } // namespace kernels
 } // namespace tensorrt_llm
@@ -15,6 +15,7 @@
  */
 
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/reduceKernelUtils.cuh"
 #include "tensorrt_llm/kernels/beamSearchKernels.h"
 
 using namespace tensorrt_llm::common;
@@ -88,16 +89,23 @@ template void invokeTopkBeamSearch<half, true>(
 template <typename T>
 __global__ void addCumLogProbs(T* __restrict pStage1Probs, float const* __restrict cumLogProbs,
     FinishedState const* finished, int const* endIds, float const* diversityRates,
-    runtime::SizeType32 const* batchSlots, size_t const nBS, size_t const nBM)
+    runtime::SizeType32 const* batchSlots, runtime::SizeType32 const* beamWidths, size_t const nBS, size_t const nBM)
 {
     int const bid = blockIdx.x;
     float const diversityRate{diversityRates[batchSlots[bid]]};
+    int const nBMSlot = (beamWidths != nullptr) ? beamWidths[batchSlots[bid]] : nBM;
     T* pLocalProbs = pStage1Probs + bid * nBM * nBM * 2;
+    T const MAX_T_VAL = std::is_same_v<T, half> ? HALF_FLT_MAX : FLT_MAX;
 
     for (int index = threadIdx.x; index < nBM * nBM * 2; index += blockDim.x)
     {
         int const indexBM = index / (nBM * 2);
-        if (finished[bid * nBM + indexBM].isFinished())
+        if (indexBM >= nBMSlot)
+        {
+            // Padding beam of a request with a smaller beam width, never selected in stage 2
+            pLocalProbs[index] = -MAX_T_VAL;
+        }
+        else if (finished[bid * nBM + indexBM].isFinished())
         {
             pLocalProbs[index] += (index == endIds[bid]) ? 1.0f : 0.0f;
         }
@@ -111,11 +119,11 @@ __global__ void addCumLogProbs(T* __restrict pStage1Probs, float const* __restri
 
 template __global__ void addCumLogProbs<float>(float* __restrict pStage1Probs, float const* __restrict cumLogProbs,
     FinishedState const* finished, int const* endIds, float const* diversityRates,
-    runtime::SizeType32 const* batchSlots, size_t const nBS, size_t const nBM);
+    runtime::SizeType32 const* batchSlots, runtime::SizeType32 const* beamWidths, size_t const nBS, size_t const nBM);
 
 template __global__ void addCumLogProbs<half>(half* __restrict pStage1Probs, float const* __restrict cumLogProbs,
     FinishedState const* finished, int const* endIds, float const* diversityRates,
-    runtime::SizeType32 const* batchSlots, size_t const nBS, size_t const nBM);
+    runtime::SizeType32 const* batchSlots, runtime::SizeType32 const* beamWidths, size_t const nBS, size_t const nBM);
 
 __global__ void gatherId(
     int const* __restrict pStage1Id, int* __restrict pStage2Id, size_t const nBS, size_t const nBM, size_t const nV)
@@ -88,6 +88,10 @@ struct BeamHypotheses
     int const* outputIdsUnfinish{nullptr};          // [BS, BM, MSL]   %% self.output_ids
     int const* parentIdsUnfinish{nullptr};          // [BS, BM, MSL]   %% self.parent_ids
 
+    // Pointer of the beam width of each request, which can be smaller than nBeamWidth. The beams beyond it are padding,
+    // they never get a candidate and are kept finished. All requests use nBeamWidth if it is nullptr.
+    runtime::SizeType32 const* beamWidths{nullptr}; // [BS]
+
     // clang-format on
 };
 
@@ -118,7 +122,7 @@ void invokeTopkBeamSearch(T const* logProbs, T const* bias, void* workspace, Bea
 template <typename T>
 __global__ void addCumLogProbs(T* __restrict pStage1Probs, float const* __restrict cumLogProbs,
     FinishedState const* finished, int const* endIds, float const* diversityRates,
-    runtime::SizeType32 const* batchSlots, size_t const nBS, size_t const nBM);
+    runtime::SizeType32 const* batchSlots, runtime::SizeType32 const* beamWidths, size_t const nBS, size_t const nBM);
 
 __global__ void gatherId(
     int const* __restrict pStage1Id, int* __restrict pStage2Id, size_t const nBS, size_t const nBM, size_t const nV);
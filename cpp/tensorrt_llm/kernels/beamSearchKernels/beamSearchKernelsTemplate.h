@@ -194,6 +194,7 @@ __launch_bounds__(BLOCK_SIZE) __global__ void beamStage3Kernel(
     int const slot = bh.batchSlots[bid];
     size_t const nMBS{bh.nMaxBatchSize}; // Only for bh.logProbsTiled
     size_t const nBM{bh.nBeamWidth};
+    size_t const nBMSlot = (bh.beamWidths != nullptr) ? bh.beamWidths[slot] : nBM; // nBM is still the stride
     size_t const nV{bh.nVocabSize};
     float const diversityRate{bh.diversityRates[slot]};
     float const lengthPenalty{bh.lengthPenalties[slot]};
@@ -212,7 +213,7 @@ __launch_bounds__(BLOCK_SIZE) __global__ void beamStage3Kernel(
             // Initialize worst score in the first call
             bh.minNormedScoresCBA[slot] = FLT_MAX;
         }
-        else if (earlyStopping == 1 && bh.numBeamsCBA[slot] == nBM
+        else if (earlyStopping == 1 && bh.numBeamsCBA[slot] == nBMSlot
             || earlyStopping != 1 && bh.finished[slot * nBM].isFinished())
         {
             // Condition of early return:
@@ -251,7 +252,8 @@ __launch_bounds__(BLOCK_SIZE) __global__ void beamStage3Kernel(
         for (int i = tid; i < nCandidate; i += BLOCK_SIZE)
         {
             int const index = bh.numBeamsCBA == nullptr ? i % nBM : i / 2 / nBM;
-            T const value = pStage2LogProbs[i] + static_cast<T>(diversityRate * index);
+            // Candidates from the padding beams of a request with a smaller beam width are never selected
+            T const value = (index < nBMSlot) ? pStage2LogProbs[i] + static_cast<T>(diversityRate * index) : -MAX_T_VAL;
             kvLocal = argmax(kvLocal, {i, value});
             smemVal[i] = value;
         }
@@ -297,7 +299,7 @@ __launch_bounds__(BLOCK_SIZE) __global__ void beamStage3Kernel(
         // Select finished beams into CBA or select tokens for next step sequentially
         // Reference (might be changed along HF in the future):
         // https://github.com/huggingface/transformers/blob/main/src/transformers/generation/beam_search.py#L272
-        for (int i = 0; i < 2 * nBM; ++i)
+        for (int i = 0; i < 2 * nBMSlot; ++i)
         {
             int topId;
             T topLogProb;
@@ -315,14 +317,14 @@ __launch_bounds__(BLOCK_SIZE) __global__ void beamStage3Kernel(
                 topLogProb = pStage2LogProbs[key];
             }
             bool const isEndToken = (topId % nV == bh.endIds[slot]);
-            if (i < nBM && bh.numBeamsCBA != nullptr && isEndToken)
+            if (i < nBMSlot && bh.numBeamsCBA != nullptr && isEndToken)
             {
                 // Condition of this branch
                 // This token is end-token and belongs to top nBM range in Beam search mode
                 int const nSeqLen = bh.sequenceLengths[slot * nBM + i] + 1 - bh.inputLengths[slot * nBM + i];
                 float const score = applyLengthPenalty(topLogProb, nSeqLen, lengthPenalty);
                 int nCBA = bh.numBeamsCBA[slot];
-                if (nCBA == nBM)
+                if (nCBA == nBMSlot)
                 {
                     // There are already nBM beams
                     if (score < bh.minNormedScoresCBA[slot])
@@ -343,7 +345,7 @@ __launch_bounds__(BLOCK_SIZE) __global__ void beamStage3Kernel(
                     {
                         // Current score is better than the worst one in candidate beams
                         // Find the candidate beam index with the worst score and erase it
-                        for (int j = 0; j < nBM; j++)
+                        for (int j = 0; j < nBMSlot; j++)
                         {
                             if (bh.normedScoresCBA[slot * (nBM * 2) + j] == bh.minNormedScoresCBA[slot])
                             {
@@ -351,7 +353,7 @@ __launch_bounds__(BLOCK_SIZE) __global__ void beamStage3Kernel(
                                 bh.numBeamsCBA[slot]--;
                                 bh.minNormedScoresCBA[slot] = FLT_MAX;
                                 bh.normedScoresCBA[slot * (nBM * 2) + j] = score;
-                                for (int l = 0; l < nBM; l++)
+                                for (int l = 0; l < nBMSlot; l++)
                                 {
                                     bh.minNormedScoresCBA[slot]
                                         = min(bh.minNormedScoresCBA[slot], bh.normedScoresCBA[slot * (nBM * 2) + l]);
@@ -395,7 +397,7 @@ __launch_bounds__(BLOCK_SIZE) __global__ void beamStage3Kernel(
                 bh.numBeamsCBA[slot]++;
                 bh.cumLogProbsCBA[index] = (float) topLogProb;
             }
-            else if (i < nBM || bh.numBeamsCBA != nullptr && !isEndToken)
+            else if (i < nBMSlot || bh.numBeamsCBA != nullptr && !isEndToken)
             {
                 // Condition of this branch
                 // 1. bh.numBeamsCBA == nullptr && i <  nBM, i.e., beam search is disable
@@ -420,7 +422,7 @@ __launch_bounds__(BLOCK_SIZE) __global__ void beamStage3Kernel(
                 // 2. bh.numBeamsCBA != nullptr && i >= nBM && isEndToken == true, i.e., ignore the worse beams
             }
 
-            if (nBeamForNextStep >= nBM)
+            if (nBeamForNextStep >= nBMSlot)
             {
                 // Condition of this branch
                 // 1. In EarlyStopping mode, and get enough candidate beams
@@ -436,7 +438,7 @@ __launch_bounds__(BLOCK_SIZE) __global__ void beamStage3Kernel(
     // Update bh.batchDones
     if (tid == 0 && bh.numBeamsCBA != nullptr)
     {
-        if (bh.numBeamsCBA[slot] < nBM)
+        if (bh.numBeamsCBA[slot] < nBMSlot)
         {
             // no enough beams
             bh.batchDones[slot] = false;
@@ -472,7 +474,12 @@ __launch_bounds__(BLOCK_SIZE) __global__ void beamStage3Kernel(
     }
     __syncthreads();
 
-    if (tid < nBM)
+    if (tid >= nBMSlot && tid < nBM)
+    {
+        // Padding beams of a request with a smaller beam width stay finished
+        bh.finished[slot * nBM + tid].setFinished();
+    }
+    else if (tid < nBMSlot)
     {
         int const indexBatchBeam = slot * nBM + tid;
         int const step = smemSeqLen[tid];
@@ -491,7 +498,7 @@ __launch_bounds__(BLOCK_SIZE) __global__ void beamStage3Kernel(
         bh.parentIdsPtr[slot][tid * bh.nMaxSeqLen + step] = newBeamId;
         bh.outputIdsPtr[slot][tid * bh.nMaxSeqLen + step] = newTokenId;
 
-        if ((earlyStopping == 1) && (bh.numBeamsCBA != nullptr && bh.numBeamsCBA[slot] == nBM)
+        if ((earlyStopping == 1) && (bh.numBeamsCBA != nullptr && bh.numBeamsCBA[slot] == nBMSlot)
             || (earlyStopping != 1) && bh.batchDones[slot])
         {
             bh.batchDones[slot] = true;
@@ -613,7 +620,8 @@ void beamSearchKernelLauncher(
 
         int nThread = min(roundUp(nBM * nBM * 2, 32), 1024);
         addCumLogProbs<<<nBS, nThread, 0, stream>>>(
-            pStage1LogProbs, bh.cumLogProbs, bh.finished, bh.endIds, bh.diversityRates, bh.batchSlots, nBS, nBM);
+            pStage1LogProbs, bh.cumLogProbs, bh.finished, bh.endIds, bh.diversityRates, bh.batchSlots, bh.beamWidths,
+            nBS, nBM);
         sync_check_cuda_error();
 
         // Stage 2
@@ -98,5 +98,54 @@ template void invokeBuildRelativeAttentionBias<__nv_bfloat16>(__nv_bfloat16* rel
     bool const is_bidirectional, int const max_distance, cudaStream_t stream);
 #endif
 
+template <typename T>
+__global__ void buildRelativeAttentionDistanceBias(T* distance_bias, T const* relative_attention_bias_table,
+    int const max_seq_len, int const num_bucket, int const max_distance)
+{
+    int const head_id = blockIdx.y;
+    int const relative_position = blockIdx.x * blockDim.x + threadIdx.x;
+    if (relative_position >= max_seq_len)
+    {
+        return;
+    }
+
+    // Same arithmetic as the IMPLICIT_REL_ATTN_BIAS path of the masked MHA kernel, so that the gathered bias is
+    // bitwise identical to the one it computes on the fly.
+    int const max_exact = num_bucket / 2;
+    bool const is_small = relative_position < max_exact;
+    int relative_position_if_large = max_exact
+        + (int) (logf(relative_position * 1.0f / max_exact) / logf((float) max_distance / max_exact)
+            * (num_bucket - max_exact));
+    relative_position_if_large = min(relative_position_if_large, num_bucket - 1);
+    int const relative_buckets = is_small ? relative_position : relative_position_if_large;
+
+    distance_bias[head_id * max_seq_len + relative_position]
+        = relative_attention_bias_table[head_id * num_bucket + relative_buckets];
+}
+
+template <typename T>
+void invokeBuildRelativeAttentionDistanceBias(T* distance_bias, T const* relative_attention_bias_table,
+    int const head_num, int const max_seq_len, int const num_bucket, int const max_distance, cudaStream_t stream)
+{
+    dim3 block(256);
+    dim3 grid((max_seq_len + block.x - 1) / block.x, head_num);
+    buildRelativeAttentionDistanceBias<<<grid, block, 0, stream>>>(
+        distance_bias, relative_attention_bias_table, max_seq_len, num_bucket, max_distance);
+}
+
+template void invokeBuildRelativeAttentionDistanceBias<float>(float* distance_bias,
+    float const* relative_attention_bias_table, int const head_num, int const max_seq_len, int const num_bucket,
+    int const max_distance, cudaStream_t stream);
+
+template void invokeBuildRelativeAttentionDistanceBias<half>(half* distance_bias,
+    half const* relative_attention_bias_table, int const head_num, int const max_seq_len, int const num_bucket,
+    int const max_distance, cudaStream_t stream);
+
+#ifdef ENABLE_BF16
+template void invokeBuildRelativeAttentionDistanceBias<__nv_bfloat16>(__nv_bfloat16* distance_bias,
+    __nv_bfloat16 const* relative_attention_bias_table, int const head_num, int const max_seq_len,
+    int const num_bucket, int const max_distance, cudaStream_t stream);
+#endif
+
 } // namespace kernels
 } // namespace tensorrt_llm
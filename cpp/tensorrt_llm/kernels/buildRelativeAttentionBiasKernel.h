@@ -29,5 +29,14 @@ void invokeBuildRelativeAttentionBias(T* relative_attention_bias, T const* relat
     int const head_num, int const seq_len, int const num_bucket, bool const is_bidirectional, int const max_distance,
     cudaStream_t stream);
 
+//! \brief Gather the bias of every head and unidirectional distance from the bucket table, once per engine rather
+//! than at every generation step. distance_bias[h, d] = table[h, bucket(d)] for d in [0, max_seq_len), with the buckets
+//! computed exactly as the implicit relative attention bias path of the masked MHA kernel computes them.
+//! \param distance_bias Output of shape [head_num, max_seq_len].
+//! \param relative_attention_bias_table The bucket table of shape [head_num, num_bucket].
+template <typename T>
+void invokeBuildRelativeAttentionDistanceBias(T* distance_bias, T const* relative_attention_bias_table,
+    int const head_num, int const max_seq_len, int const num_bucket, int const max_distance, cudaStream_t stream);
+
 } // namespace kernels
 } // namespace tensorrt_llm
@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/cascadeAttention.h"
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+namespace
+{
+
+int32_t constexpr kWarpSize = 32;
+int32_t constexpr kNumWarps = 4;
+// Rows (sequence, query head) of a warp. Their softmax states stay in registers over the whole KV loop.
+int32_t constexpr kRowsPerWarp = 4;
+int32_t constexpr kChunkRows = kNumWarps * kRowsPerWarp;
+// Tokens of a KV tile, one per lane when the scores are computed.
+int32_t constexpr kTileTokens = kWarpSize;
+
+template <int32_t HEAD_SIZE>
+struct CascadeAttentionSmem
+{
+    float q[kChunkRows][HEAD_SIZE];
+    // Padded so that the lanes reading one channel of different tokens do not share a bank.
+    float k[kTileTokens][HEAD_SIZE + 1];
+    float v[kTileTokens][HEAD_SIZE];
+};
+
+__device__ __forceinline__ float warpMax(float val)
+{
+#pragma unroll
+    for (int32_t mask = kWarpSize / 2; mask > 0; mask >>= 1)
+    {
+        val = fmaxf(val, __shfl_xor_sync(0xffffffff, val, mask));
+    }
+    return val;
+}
+
+__device__ __forceinline__ float warpSum(float val)
+{
+#pragma unroll
+    for (int32_t mask = kWarpSize / 2; mask > 0; mask >>= 1)
+    {
+        val += __shfl_xor_sync(0xffffffff, val, mask);
+    }
+    return val;
+}
+
+// PREFIX: grid [numKvHeads, divUp(batchSize * groupSize, kChunkRows)], a block attends the shared prefix for a chunk
+// of the (sequence, query head) rows of the batch and writes the workspace.
+// !PREFIX: grid [numKvHeads, batchSize], a block attends the suffix of one sequence for the query heads of one KV head
+// and merges it with the prefix part from the workspace.
+// block [kNumWarps * kWarpSize].
+template <typename T, int32_t HEAD_SIZE, bool PREFIX>
+__global__ void __launch_bounds__(kNumWarps* kWarpSize)
+    cascadeAttentionKernel(CascadeAttentionParams<T> params, KVBlockArray kvCache)
+{
+    int32_t constexpr kChannelsPerLane = HEAD_SIZE / kWarpSize;
+    __shared__ CascadeAttentionSmem<HEAD_SIZE> smem;
+
+    auto const kvHeadIdx = static_cast<int32_t>(blockIdx.x);
+    auto const warpIdx = static_cast<int32_t>(threadIdx.x) / kWarpSize;
+    auto const laneIdx = static_cast<int32_t>(threadIdx.x) % kWarpSize;
+
+    auto const groupSize = params.numHeads / params.numKvHeads;
+    auto const numRows = PREFIX ? params.batchSize * groupSize : groupSize;
+    auto const cacheSeqIdx = PREFIX ? 0 : static_cast<int32_t>(blockIdx.y);
+    auto const tokenBegin = PREFIX ? 0 : params.numSharedTokens;
+    auto const tokenEnd = PREFIX ? params.numSharedTokens : params.kvLengths[blockIdx.y];
+    auto const chunkBegin = PREFIX ? static_cast<int32_t>(blockIdx.y) * kChunkRows : 0;
+    auto const chunkEnd = PREFIX ? chunkBegin + kChunkRows : numRows;
+
+    // Prefix part of every query head: normalized output [batchSize, numHeads, headSize] and log-sum-exp
+    // [batchSize, numHeads].
+    auto* prefixOut = reinterpret_cast<float*>(params.workspace);
+    auto* prefixLse = prefixOut + static_cast<size_t>(params.batchSize) * params.numHeads * HEAD_SIZE;
+
+    auto rowToHead = [&](int32_t row)
+    {
+        auto const batchIdx = PREFIX ? row / groupSize : static_cast<int32_t>(blockIdx.y);
+        return batchIdx * params.numHeads + kvHeadIdx * groupSize + row % groupSize;
+    };
+
+    for (int32_t chunkStart = chunkBegin; chunkStart < chunkEnd; chunkStart += kChunkRows)
+    {
+        // Load the scaled queries of the chunk.
+        __syncthreads();
+        for (auto idx = static_cast<int32_t>(threadIdx.x); idx < kChunkRows * HEAD_SIZE; idx += blockDim.x)
+        {
+            auto const localRow = idx / HEAD_SIZE;
+            auto const channel = idx % HEAD_SIZE;
+            auto const row = chunkStart + localRow;
+            float value = 0.f;
+            if (row < numRows)
+            {
+                auto const offset = static_cast<size_t>(rowToHead(row)) * HEAD_SIZE + channel;
+                value = cuda_cast<float>(params.q[offset]) * params.qScale;
+            }
+            smem.q[localRow][channel] = value;
+        }
+
+        float rowMax[kRowsPerWarp];
+        float rowSum[kRowsPerWarp];
+        float acc[kRowsPerWarp][kChannelsPerLane];
+#pragma unroll
+        for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+        {
+            rowMax[ri] = -FLT_MAX;
+            rowSum[ri] = 0.f;
+#pragma unroll
+            for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+            {
+                acc[ri][ci] = 0.f;
+            }
+        }
+
+        for (int32_t tileStart = tokenBegin; tileStart < tokenEnd; tileStart += kTileTokens)
+        {
+            // Load the tile once for all rows of the chunk.
+            __syncthreads();
+            for (auto idx = static_cast<int32_t>(threadIdx.x); idx < kTileTokens * HEAD_SIZE; idx += blockDim.x)
+            {
+                auto const tokenOffset = idx / HEAD_SIZE;
+                auto const channel = idx % HEAD_SIZE;
+                auto const tokenIdx = tileStart + tokenOffset;
+                float kValue = 0.f;
+                float vValue = 0.f;
+                if (tokenIdx < tokenEnd)
+                {
+                    auto const localIdx = kvCache.getKVLocalIdx(tokenIdx, kvHeadIdx, HEAD_SIZE, channel);
+                    kValue = cuda_cast<float>(
+                        reinterpret_cast<T const*>(kvCache.getKBlockPtr(cacheSeqIdx, tokenIdx))[localIdx]);
+                    vValue = cuda_cast<float>(
+                        reinterpret_cast<T const*>(kvCache.getVBlockPtr(cacheSeqIdx, tokenIdx))[localIdx]);
+                }
+                smem.k[tokenOffset][channel] = kValue;
+                smem.v[tokenOffset][channel] = vValue;
+            }
+            __syncthreads();
+
+            bool const visible = tileStart + laneIdx < tokenEnd;
+#pragma unroll
+            for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+            {
+                auto const localRow = warpIdx * kRowsPerWarp + ri;
+                if (chunkStart + localRow >= numRows)
+                {
+                    continue;
+                }
+                float score = -FLT_MAX;
+                if (visible)
+                {
+                    score = 0.f;
+#pragma unroll 16
+                    for (int32_t channel = 0; channel < HEAD_SIZE; ++channel)
+                    {
+                        score += smem.q[localRow][channel] * smem.k[laneIdx][channel];
+                    }
+                }
+
+                auto const newMax = fmaxf(rowMax[ri], warpMax(score));
+                auto const correction = __expf(rowMax[ri] - newMax);
+                auto const prob = visible ? __expf(score - newMax) : 0.f;
+                rowSum[ri] = rowSum[ri] * correction + warpSum(prob);
+                rowMax[ri] = newMax;
+#pragma unroll
+                for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+                {
+                    acc[ri][ci] *= correction;
+                }
+                for (int32_t ti = 0; ti < kTileTokens; ++ti)
+                {
+                    auto const p = __shfl_sync(0xffffffff, prob, ti);
+#pragma unroll
+                    for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+                    {
+                        acc[ri][ci] += p * smem.v[ti][ci * kWarpSize + laneIdx];
+                    }
+                }
+            }
+        }
+
+#pragma unroll
+        for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+        {
+            auto const row = chunkStart + warpIdx * kRowsPerWarp + ri;
+            if (row >= numRows)
+            {
+                continue;
+            }
+            auto const headOffset = static_cast<size_t>(rowToHead(row));
+            if constexpr (PREFIX)
+            {
+                auto const invSum = rowSum[ri] > 0.f ? 1.f / rowSum[ri] : 0.f;
+#pragma unroll
+                for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+                {
+                    prefixOut[headOffset * HEAD_SIZE + ci * kWarpSize + laneIdx] = acc[ri][ci] * invSum;
+                }
+                if (laneIdx == 0)
+                {
+                    prefixLse[headOffset] = rowSum[ri] > 0.f ? rowMax[ri] + __logf(rowSum[ri]) : -FLT_MAX;
+                }
+            }
+            else
+            {
+                // Both parts are weighted by their share of the softmax denominator.
+                auto const lse = params.numSharedTokens > 0 ? prefixLse[headOffset] : -FLT_MAX;
+                auto const maxScore = fmaxf(lse, rowMax[ri]);
+                auto const prefixWeight = lse == -FLT_MAX ? 0.f : __expf(lse - maxScore);
+                auto const suffixScale = __expf(rowMax[ri] - maxScore);
+                auto const denominator = prefixWeight + suffixScale * rowSum[ri];
+                auto const invDenominator = denominator > 0.f ? 1.f / denominator : 0.f;
+                auto* out = params.out + headOffset * HEAD_SIZE;
+#pragma unroll
+                for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+                {
+                    auto const channel = ci * kWarpSize + laneIdx;
+                    auto const prefixValue = prefixWeight > 0.f ? prefixOut[headOffset * HEAD_SIZE + channel] : 0.f;
+                    out[channel]
+                        = cuda_cast<T>((prefixWeight * prefixValue + suffixScale * acc[ri][ci]) * invDenominator);
+                }
+            }
+        }
+    }
+}
+
+template <typename T, int32_t HEAD_SIZE>
+void launchCascadeAttention(CascadeAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream)
+{
+    auto const groupSize = params.numHeads / params.numKvHeads;
+    if (params.numSharedTokens > 0)
+    {
+        dim3 const prefixGrid(params.numKvHeads, divUp(params.batchSize * groupSize, kChunkRows));
+        cascadeAttentionKernel<T, HEAD_SIZE, true><<<prefixGrid, kNumWarps * kWarpSize, 0, stream>>>(params, kvCache);
+    }
+    dim3 const suffixGrid(params.numKvHeads, params.batchSize);
+    cascadeAttentionKernel<T, HEAD_SIZE, false><<<suffixGrid, kNumWarps * kWarpSize, 0, stream>>>(params, kvCache);
+}
+
+} // namespace
+
+int32_t getNumSharedPrefixTokens(KVCacheIndex const* hostBlockOffsets, int32_t const* hostKvLengths, int32_t batchSize,
+    int32_t maxBlocksPerSeq, int32_t tokensPerBlock)
+{
+    if (batchSize < 2)
+    {
+        return 0;
+    }
+    // The block holding the last token of a sequence can still be written, only blocks full in all sequences count.
+    auto const minKvLength = *std::min_element(hostKvLengths, hostKvLengths + batchSize);
+    auto const maxSharedBlocks = std::min(minKvLength / tokensPerBlock, maxBlocksPerSeq);
+    auto sameBlock = [](KVCacheIndex const& lhs, KVCacheIndex const& rhs)
+    { return lhs.isPrimary() && rhs.isPrimary() && lhs.get() == rhs.get(); };
+
+    int32_t numSharedBlocks = 0;
+    for (; numSharedBlocks < maxSharedBlocks; ++numSharedBlocks)
+    {
+        bool shared = true;
+        for (int32_t seqIdx = 1; seqIdx < batchSize && shared; ++seqIdx)
+        {
+            for (int32_t kvIdx = 0; kvIdx < 2 && shared; ++kvIdx)
+            {
+                auto const& first = hostBlockOffsets[kvIdx * maxBlocksPerSeq + numSharedBlocks];
+                auto const& other
+                    = hostBlockOffsets[(seqIdx * 2 + kvIdx) * static_cast<size_t>(maxBlocksPerSeq) + numSharedBlocks];
+                shared = sameBlock(first, other);
+            }
+        }
+        if (!shared)
+        {
+            break;
+        }
+    }
+    return numSharedBlocks * tokensPerBlock;
+}
+
+size_t getCascadeAttentionWorkspaceSize(int32_t batchSize, int32_t numHeads, int32_t headSize)
+{
+    return static_cast<size_t>(batchSize) * numHeads * (headSize + 1) * sizeof(float);
+}
+
+template <typename T>
+void invokeCascadeAttention(CascadeAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream)
+{
+    params.checkParams();
+    switch (params.headSize)
+    {
+    case 64: launchCascadeAttention<T, 64>(params, kvCache, stream); break;
+    case 128: launchCascadeAttention<T, 128>(params, kvCache, stream); break;
+    default: TLLM_THROW("Unsupported head size %d", params.headSize);
+    }
+
+    sync_check_cuda_error();
+}
+
+template void invokeCascadeAttention<float>(
+    CascadeAttentionParams<float> const& params, KVBlockArray const& kvCache, cudaStream_t stream);
+template void invokeCascadeAttention<half>(
+    CascadeAttentionParams<half> const& params, KVBlockArray const& kvCache, cudaStream_t stream);
+#ifdef ENABLE_BF16
+template void invokeCascadeAttention<__nv_bfloat16>(
+    CascadeAttentionParams<__nv_bfloat16> const& params, KVBlockArray const& kvCache, cudaStream_t stream);
+#endif
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/kernels/kvCacheIndex.h"
+#include "tensorrt_llm/kernels/kvCacheUtils.h"
+#include <cstddef>
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+template <typename T>
+struct CascadeAttentionParams
+{
+    // Queries of the generation tokens after the rotary embedding [batchSize, numHeads, headSize].
+    T const* q{nullptr};
+    // Output [batchSize, numHeads, headSize].
+    T* out{nullptr};
+    // Number of tokens in the cache of every sequence, including the generation token [batchSize].
+    int32_t const* kvLengths{nullptr};
+    // Length of the prefix whose blocks are shared by all sequences, see getNumSharedPrefixTokens. Its K and V are read
+    // from the blocks of the first sequence.
+    int32_t numSharedTokens{0};
+    int32_t batchSize{0};
+    int32_t numHeads{0};
+    int32_t numKvHeads{0};
+    int32_t headSize{0};
+    // Scale of the attention scores, usually 1 / sqrt(headSize).
+    float qScale{1.f};
+    // Workspace of getCascadeAttentionWorkspaceSize bytes, for the prefix attention of every query head.
+    void* workspace{nullptr};
+
+    void checkParams() const
+    {
+        TLLM_CHECK(q && out && kvLengths && workspace);
+        TLLM_CHECK(batchSize > 0 && numSharedTokens >= 0);
+        TLLM_CHECK(numKvHeads > 0 && numHeads % numKvHeads == 0);
+        TLLM_CHECK_WITH_INFO(headSize == 64 || headSize == 128, "Cascade attention supports head sizes 64 and 128");
+    }
+};
+
+//! \brief Number of leading tokens of the sequences that are stored in the same KV cache blocks for all of them, e.g.
+//! a system prompt reused through the block reuse of the BlockManager. Only full blocks of the primary pool count.
+//! \param hostBlockOffsets Block offsets of the batch in the KVBlockArray layout [batchSize, 2, maxBlocksPerSeq].
+//! \param hostKvLengths Number of tokens in the cache of every sequence [batchSize].
+int32_t getNumSharedPrefixTokens(KVCacheIndex const* hostBlockOffsets, int32_t const* hostKvLengths, int32_t batchSize,
+    int32_t maxBlocksPerSeq, int32_t tokensPerBlock);
+
+size_t getCascadeAttentionWorkspaceSize(int32_t batchSize, int32_t numHeads, int32_t headSize);
+
+//! \brief Generation attention of a batch whose sequences share a prefix in the KV cache.
+//! \details The prefix is attended once for the whole batch: a block scores every tile of the shared blocks against a
+//! chunk of (sequence, query head) rows of a KV head, as a multi-query pass, and stores the normalized output and the
+//! log-sum-exp of every row in the workspace. The blocks of the prefix pass read the same tiles at the same time, so
+//! the prefix is read from HBM about once instead of once per sequence. A second pass attends the unique suffix of
+//! every sequence and merges both parts with their log-sum-exp. The KV cache must hold T, without quantization, beam
+//! search or cyclic window, and the K and V of the generation tokens must be in the cache, e.g. written by
+//! invokeQKVPreprocessing.
+template <typename T>
+void invokeCascadeAttention(CascadeAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -969,8 +969,10 @@ static __global__ void __launch_bounds__(1024, 1) one_shot_all_reduce_norm_kerne
                 vals[ii].packed = *reinterpret_cast<int4 const*>(&buffers[ii][block_offset + norm_offset + offset]);
             }
 #pragma unroll
-            for (int ii = 0; ii < RanksPerNode; ++ii)
+            for (int rank = 0; rank < RanksPerNode; ++rank)
             {
+                // Always reduce from rank 0, so that all the ranks and strategies get the same sums.
+                int ii = (rank + RanksPerNode - params.local_rank) % RanksPerNode;
                 sum_vec.packed = add128b(sum_vec, vals[ii]);
             }
             if constexpr (Bias)
@@ -1077,8 +1079,10 @@ static __global__ void __launch_bounds__(1024, 1) one_shot_prenorm_all_reduce_no
                 vals[ii].packed = *reinterpret_cast<int4 const*>(&buffers[ii][block_offset + norm_offset + offset]);
             }
 #pragma unroll
-            for (int ii = 0; ii < RanksPerNode; ++ii)
+            for (int rank = 0; rank < RanksPerNode; ++rank)
             {
+                // Always reduce from rank 0, so that all the ranks and strategies get the same sums.
+                int ii = (rank + RanksPerNode - params.local_rank) % RanksPerNode;
                 sum_vec.packed = add128b(sum_vec, vals[ii]);
             }
 
@@ -1412,8 +1416,8 @@ static __global__ void oneShotAllReduceKernel(AllReduceParams params)
 #pragma unroll
         for (int rank = 0; rank < RANKS_PER_NODE; ++rank)
         {
-            // Always reduce from rank 0 to ensure stable reduce order.
-            int ii = (rank + RANKS_PER_NODE - params.local_rank) % RANKS_PER_NODE;
+            // Always reduce from rank 0 to ensure stable reduce order. The pushed values are indexed by rank already.
+            int ii = PUSH_MODE ? rank : (rank + RANKS_PER_NODE - params.local_rank) % RANKS_PER_NODE;
             sums.packed = add128b(sums, vals[ii]);
         }
         // Store to the destination buffer.
@@ -1556,8 +1560,8 @@ static __global__ void __launch_bounds__(512, 1) twoShotAllReduceKernel(AllReduc
 #pragma unroll
         for (int rank = 0; rank < RANKS_PER_NODE; ++rank)
         {
-            // Always reduce from rank 0 to ensure stable reduce order.
-            int ii = (rank + RANKS_PER_NODE - params.local_rank) % RANKS_PER_NODE;
+            // Always reduce from rank 0 to ensure stable reduce order. The pushed values are indexed by rank already.
+            int ii = PUSH_MODE ? rank : (rank + RANKS_PER_NODE - params.local_rank) % RANKS_PER_NODE;
             sums.packed = add128b(sums, vals[ii]);
         }
 
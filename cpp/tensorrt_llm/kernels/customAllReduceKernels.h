@@ -50,6 +50,9 @@ enum class AllReduceStrategyType : int8_t
     TWOSHOT = 2,
     UB = 3,
     AUTO = 4,
+    // Multicast collectives of a NVSwitch node, see nvlsCollectiveKernels.h. Falls back to NCCL for the messages
+    // and the fusions it does not support.
+    NVLS = 5,
 };
 
 enum class AllReduceStrategyConfig : int8_t
@@ -301,6 +301,24 @@ std::vector<CutlassGemmConfig> get_candidate_configs_sm90(CutlassGemmConfig::Can
                 tile_config, MainloopScheduleType::AUTO, EpilogueScheduleType::AUTO, ClusterShape::ClusterShape_2x2x1);
             candidate_configs.push_back(config);
         }
+
+        // The mixed input GEMMs with an M tile of 128 use the stream-K scheduler, which can also split K into a fixed
+        // number of parts, so that the profiler picks the decomposition that fills the SMs at small M.
+        if ((config & CutlassGemmConfig::WEIGHT_ONLY) && has_m_mcast)
+        {
+            for (int split_k_factor : {2, 4})
+            {
+                CutlassGemmConfig split_k_config(tile_config, MainloopScheduleType::AUTO,
+                    EpilogueScheduleType::AUTO, ClusterShape::ClusterShape_1x1x1);
+                split_k_config.split_k_style = SplitKStyle::SPLIT_K_SERIAL;
+                split_k_config.split_k_factor = split_k_factor;
+                candidate_configs.push_back(split_k_config);
+            }
+            CutlassGemmConfig stream_k_config(
+                tile_config, MainloopScheduleType::AUTO, EpilogueScheduleType::AUTO, ClusterShape::ClusterShape_1x1x1);
+            stream_k_config.split_k_style = SplitKStyle::STREAM_K;
+            candidate_configs.push_back(stream_k_config);
+        }
     }
     // add cuda kernel profiler to tactics
     if (tiles.size() > 0)
@@ -510,7 +510,7 @@ void add_bias_and_interleave_quantized_tensor_inplace(int8_t* tensor, const size
 }
 
 void interleave_column_major_tensor(int8_t* interleaved_quantized_tensor, int8_t const* quantized_tensor,
-    std::vector<size_t> const& shape, QuantType quant_type, LayoutDetails details)
+    std::vector<size_t> const& shape, QuantType quant_type, MixedGemmWeightLayout const& layout)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
 
@@ -522,7 +522,7 @@ void interleave_column_major_tensor(int8_t* interleaved_quantized_tensor, int8_t
     int const BITS_PER_ELT = get_weight_quant_bits(quant_type);
     int const elts_in_int32 = 32 / BITS_PER_ELT;
 
-    int const rows_per_tile = details.rows_per_column_tile;
+    int const rows_per_tile = layout.rows_per_column_tile;
 
     TLLM_CHECK_WITH_INFO(!(num_rows % elts_in_int32),
         fmtstr("The number of rows must be a multiple of %d but the number of rows is %ld.", elts_in_int32, num_rows));
@@ -535,7 +535,7 @@ void interleave_column_major_tensor(int8_t* interleaved_quantized_tensor, int8_t
 
     int const num_vec_rows = num_rows / elts_in_int32;
     int const vec_rows_per_tile = rows_per_tile / elts_in_int32;
-    int const interleave = details.columns_interleaved;
+    int const interleave = layout.columns_interleaved;
 
     for (int expert = 0; expert < num_experts; ++expert)
     {
@@ -561,8 +561,7 @@ void interleave_column_major_tensor(int8_t* interleaved_quantized_tensor, int8_t
     }
 }
 
-void preprocess_weights_for_mixed_gemm(int8_t* preprocessed_quantized_weight, int8_t const* row_major_quantized_weight,
-    std::vector<size_t> const& shape, QuantType quant_type, bool force_interleave)
+MixedGemmWeightLayout get_mixed_gemm_weight_layout(QuantType quant_type, bool force_interleave)
 {
     int arch = getSMVersion();
     if (force_interleave && arch >= 90)
@@ -577,6 +576,20 @@ void preprocess_weights_for_mixed_gemm(int8_t* preprocessed_quantized_weight, in
     }
     LayoutDetails details = getLayoutDetailsForTransform(quant_type, arch);
 
+    MixedGemmWeightLayout layout;
+    layout.permute_rows = details.uses_imma_ldsm;
+    layout.transpose = details.layoutB == LayoutDetails::Layout::COLUMN_MAJOR;
+    layout.rows_per_column_tile = details.rows_per_column_tile;
+    layout.columns_interleaved = arch != 90 ? details.columns_interleaved : 1;
+    return layout;
+}
+
+void preprocess_weights_for_mixed_gemm(int8_t* preprocessed_quantized_weight, int8_t const* row_major_quantized_weight,
+    std::vector<size_t> const& shape, QuantType quant_type, bool force_interleave)
+{
+    int const arch = getSMVersion();
+    MixedGemmWeightLayout const layout = get_mixed_gemm_weight_layout(quant_type, force_interleave);
+
     TLLM_CHECK_WITH_INFO(shape.size() == 2 || shape.size() == 3, "Shape must be 2-D or 3-D");
 
     size_t num_elts = 1;
@@ -592,21 +605,21 @@ void preprocess_weights_for_mixed_gemm(int8_t* preprocessed_quantized_weight, in
     std::copy(row_major_quantized_weight, row_major_quantized_weight + num_bytes, src_buf.begin());
 
     // Works on row major data, so issue this permutation first.
-    if (details.uses_imma_ldsm)
+    if (layout.permute_rows)
     {
         permute_B_rows_for_mixed_gemm(dst_buf.data(), src_buf.data(), shape, quant_type, arch);
         src_buf.swap(dst_buf);
     }
 
-    if (details.layoutB == LayoutDetails::Layout::COLUMN_MAJOR)
+    if (layout.transpose)
     {
         subbyte_transpose(dst_buf.data(), src_buf.data(), shape, quant_type);
         src_buf.swap(dst_buf);
     }
 
-    if (details.columns_interleaved > 1 && arch != 90)
+    if (layout.columns_interleaved > 1)
     {
-        interleave_column_major_tensor(dst_buf.data(), src_buf.data(), shape, quant_type, details);
+        interleave_column_major_tensor(dst_buf.data(), src_buf.data(), shape, quant_type, layout);
         src_buf.swap(dst_buf);
     }
 
@@ -47,6 +47,9 @@ constexpr int get_weight_quant_bits(QuantType quant_type)
     }
 }
 
+// Map of the LDSM permutation of permute_B_rows_for_mixed_gemm, from the row of a group to the row it reads.
+std::vector<int> get_permutation_map(QuantType quant_type);
+
 // Shapes here can be 2 or 3D. 2-D shapes are [num_rows, num_cols]
 // 3-D shapes are [num_experts, num_rows, num_cols]
 void permute_B_rows_for_mixed_gemm(int8_t* permuted_quantized_tensor, int8_t const* quantized_tensor,
@@ -60,6 +63,34 @@ void add_bias_and_interleave_quantized_tensor_inplace(int8_t* tensor, const size
 void preprocess_weights_for_mixed_gemm(int8_t* preprocessed_quantized_weight, int8_t const* row_major_quantized_weight,
     std::vector<size_t> const& shape, QuantType quant_type, bool force_interleave = false);
 
+// The transforms preprocess_weights_for_mixed_gemm applies on the current GPU, in order. The bias and register
+// interleave always follows them. Preprocessed weights are interchangeable between GPUs with the same layout.
+struct MixedGemmWeightLayout
+{
+    // LDSM permutation of the rows of every 8 * 16 / bits rows, on the row major weights.
+    bool permute_rows{false};
+    // Transposition to column major.
+    bool transpose{false};
+    // Interleave of the column major tiles, when columns_interleaved > 1.
+    int rows_per_column_tile{1};
+    int columns_interleaved{1};
+
+    bool operator==(MixedGemmWeightLayout const& other) const
+    {
+        return permute_rows == other.permute_rows && transpose == other.transpose
+            && rows_per_column_tile == other.rows_per_column_tile && columns_interleaved == other.columns_interleaved;
+    }
+};
+
+MixedGemmWeightLayout get_mixed_gemm_weight_layout(QuantType quant_type, bool force_interleave = false);
+
+// Same as preprocess_weights_for_mixed_gemm with the weights in device memory, so that the preprocessing of a refit or
+// an engine build is bound by the memory bandwidth of the GPU instead of a host thread. The workspace holds as many
+// bytes as the weights, and the source is not modified.
+void preprocess_weights_for_mixed_gemm_cuda(int8_t* preprocessed_quantized_weight,
+    int8_t const* row_major_quantized_weight, int8_t* workspace, std::vector<size_t> const& shape, QuantType quant_type,
+    bool force_interleave, cudaStream_t stream);
+
 template <typename ComputeType, typename WeightType>
 void symmetric_quantize(int8_t* processed_quantized_weight, ComputeType* scale_ptr, WeightType const* input_weight_ptr,
     std::vector<size_t> const& shape, QuantType quant_type, bool force_interleave);
@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/stringUtils.h"
+#include "tensorrt_llm/kernels/cutlass_kernels/cutlass_preprocessors.h"
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+namespace cutlass_kernels
+{
+namespace
+{
+
+int constexpr kThreads = 256;
+int constexpr kMaxPermutedRows = 32;
+// Tile of the transposition, in elements.
+int constexpr kTransposeTile = 64;
+
+struct RowPermutation
+{
+    int map[kMaxPermutedRows];
+    int rows;
+};
+
+// A thread per 32b word of the output. The groups of rows never straddle two experts.
+__global__ void permuteRowsKernel(uint32_t const* input, uint32_t* output, RowPermutation permutation,
+    int64_t num_vec_cols, int64_t num_vecs)
+{
+    for (int64_t idx = blockIdx.x * int64_t(blockDim.x) + threadIdx.x; idx < num_vecs;
+         idx += int64_t(gridDim.x) * blockDim.x)
+    {
+        int64_t const write_row = idx / num_vec_cols;
+        int64_t const col = idx % num_vec_cols;
+        int64_t const tile_row = write_row % permutation.rows;
+        int64_t const read_row = write_row - tile_row + permutation.map[tile_row];
+        output[idx] = input[read_row * num_vec_cols + col];
+    }
+}
+
+// Grid: [num_cols / tile, num_rows / tile, num_experts]. The elements of a tile are unpacked in the shared memory, so
+// that the packed int4s swap their nibbles with the transposition.
+template <int BitsPerElt>
+__global__ void __launch_bounds__(kThreads) subbyteTransposeKernel(
+    uint8_t const* input, uint8_t* output, int64_t num_rows, int64_t num_cols)
+{
+    int constexpr kEltsPerByte = 8 / BitsPerElt;
+    int constexpr kTileBytes = kTransposeTile / kEltsPerByte;
+    uint8_t constexpr kMask = (1u << BitsPerElt) - 1u;
+    __shared__ uint8_t tile[kTransposeTile][kTransposeTile + 1];
+
+    int64_t const col_bytes = num_cols / kEltsPerByte;
+    int64_t const row_bytes = num_rows / kEltsPerByte;
+    int64_t const matrix_offset = blockIdx.z * num_rows * col_bytes;
+    int64_t const tile_row = blockIdx.y * int64_t(kTransposeTile);
+    int64_t const tile_col = blockIdx.x * int64_t(kTransposeTile);
+
+    for (int idx = threadIdx.x; idx < kTransposeTile * kTransposeTile; idx += kThreads)
+    {
+        int const ii = idx / kTransposeTile;
+        int const jj = idx % kTransposeTile;
+        int64_t const row = tile_row + ii;
+        int64_t const col = tile_col + jj;
+        if (row < num_rows && col < num_cols)
+        {
+            uint8_t const packed = input[matrix_offset + row * col_bytes + col / kEltsPerByte];
+            tile[ii][jj] = (packed >> (BitsPerElt * (col % kEltsPerByte))) & kMask;
+        }
+    }
+    __syncthreads();
+
+    for (int idx = threadIdx.x; idx < kTransposeTile * kTileBytes; idx += kThreads)
+    {
+        int const jj = idx / kTileBytes;
+        int const ii_byte = idx % kTileBytes;
+        int64_t const row_trans = tile_col + jj;
+        int64_t const col_trans = tile_row + ii_byte * kEltsPerByte;
+        if (row_trans < num_cols && col_trans < num_rows)
+        {
+            uint8_t packed = 0;
+#pragma unroll
+            for (int elt = 0; elt < kEltsPerByte; ++elt)
+            {
+                packed |= tile[ii_byte * kEltsPerByte + elt][jj] << (BitsPerElt * elt);
+            }
+            output[matrix_offset + row_trans * row_bytes + col_trans / kEltsPerByte] = packed;
+        }
+    }
+}
+
+// A thread per 32b word of the column major input, which is scattered to its interleaved position.
+__global__ void interleaveColumnMajorKernel(uint32_t const* input, uint32_t* output, int64_t num_cols,
+    int64_t num_vec_rows, int64_t vec_rows_per_tile, int64_t interleave, int64_t num_vecs)
+{
+    for (int64_t idx = blockIdx.x * int64_t(blockDim.x) + threadIdx.x; idx < num_vecs;
+         idx += int64_t(gridDim.x) * blockDim.x)
+    {
+        int64_t const matrix_vecs = num_cols * num_vec_rows;
+        int64_t const matrix_offset = idx / matrix_vecs * matrix_vecs;
+        int64_t const read_col = idx % matrix_vecs / num_vec_rows;
+        int64_t const vec_read_row = idx % num_vec_rows;
+        int64_t const base_vec_row = vec_read_row - vec_read_row % vec_rows_per_tile;
+
+        int64_t const write_col = read_col / interleave;
+        int64_t const vec_write_row = interleave * base_vec_row + vec_rows_per_tile * (read_col % interleave)
+            + vec_read_row % vec_rows_per_tile;
+        output[matrix_offset + write_col * num_vec_rows * interleave + vec_write_row] = input[idx];
+    }
+}
+
+// The unsigned bias is a flip of the sign bit of every element, followed by the relayout of every register described
+// in add_bias_and_interleave_int8s_inplace and add_bias_and_interleave_int4s_inplace.
+template <int BitsPerElt>
+__global__ void addBiasAndInterleaveKernel(uint32_t* data, int64_t num_registers)
+{
+    for (int64_t idx = blockIdx.x * int64_t(blockDim.x) + threadIdx.x; idx < num_registers;
+         idx += int64_t(gridDim.x) * blockDim.x)
+    {
+        uint32_t transformed = 0;
+        if constexpr (BitsPerElt == 8)
+        {
+            uint32_t const biased = data[idx] ^ 0x80808080u;
+            transformed = (biased & 0xff0000ffu) | ((biased >> 8) & 0x0000ff00u) | ((biased << 8) & 0x00ff0000u);
+        }
+        else
+        {
+            uint32_t const biased = data[idx] ^ 0x88888888u;
+#pragma unroll
+            for (int dest_idx = 0; dest_idx < 8; ++dest_idx)
+            {
+                int const src_idx = dest_idx < 4 ? 2 * dest_idx : 2 * (dest_idx - 4) + 1;
+                transformed |= ((biased >> (4 * src_idx)) & 0xFu) << (4 * dest_idx);
+            }
+        }
+        data[idx] = transformed;
+    }
+}
+
+int getGridSize(int64_t num_items)
+{
+    // Grid-stride loops, enough CTAs to saturate the memory bandwidth.
+    int64_t constexpr kMaxCtas = 65536;
+    return static_cast<int>(std::min(kMaxCtas, std::max<int64_t>(1, divUp(num_items, int64_t(kThreads)))));
+}
+
+enum class PreprocessStep
+{
+    kPermuteRows,
+    kTranspose,
+    kInterleave
+};
+
+} // namespace
+
+void preprocess_weights_for_mixed_gemm_cuda(int8_t* preprocessed_quantized_weight,
+    int8_t const* row_major_quantized_weight, int8_t* workspace, std::vector<size_t> const& shape, QuantType quant_type,
+    bool force_interleave, cudaStream_t stream)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    TLLM_CHECK_WITH_INFO(shape.size() == 2 || shape.size() == 3, "Shape must be 2-D or 3-D");
+    int64_t const num_experts = shape.size() == 2 ? 1 : shape[0];
+    int64_t const num_rows = shape.size() == 2 ? shape[0] : shape[1];
+    int64_t const num_cols = shape.size() == 2 ? shape[1] : shape[2];
+
+    int const bits_per_elt = get_weight_quant_bits(quant_type);
+    int const elts_in_int32 = 32 / bits_per_elt;
+    int64_t const num_elts = num_experts * num_rows * num_cols;
+    int64_t const num_bytes = num_elts * bits_per_elt / 8;
+    TLLM_CHECK_WITH_INFO(num_cols % elts_in_int32 == 0 && num_rows % elts_in_int32 == 0,
+        fmtstr("The number of rows and cols must be multiples of %d, got [%ld, %ld].", elts_in_int32, num_rows,
+            num_cols));
+    TLLM_CHECK_WITH_INFO(reinterpret_cast<uintptr_t>(preprocessed_quantized_weight) % sizeof(uint32_t) == 0
+            && reinterpret_cast<uintptr_t>(row_major_quantized_weight) % sizeof(uint32_t) == 0
+            && reinterpret_cast<uintptr_t>(workspace) % sizeof(uint32_t) == 0,
+        "The weights and the workspace must be 4B aligned.");
+
+    MixedGemmWeightLayout const layout = get_mixed_gemm_weight_layout(quant_type, force_interleave);
+    std::vector<PreprocessStep> steps;
+    if (layout.permute_rows)
+    {
+        steps.push_back(PreprocessStep::kPermuteRows);
+    }
+    if (layout.transpose)
+    {
+        steps.push_back(PreprocessStep::kTranspose);
+    }
+    if (layout.columns_interleaved > 1)
+    {
+        TLLM_CHECK_WITH_INFO(num_rows % layout.rows_per_column_tile == 0,
+            fmtstr("The number of rows must be a multiple of %d but the number of rows is %ld.",
+                layout.rows_per_column_tile, num_rows));
+        steps.push_back(PreprocessStep::kInterleave);
+    }
+    TLLM_CHECK_WITH_INFO(workspace != nullptr || steps.size() < 2, "The preprocessing needs a workspace.");
+
+    int64_t const num_vecs = num_bytes / static_cast<int64_t>(sizeof(uint32_t));
+    int8_t const* src = row_major_quantized_weight;
+    for (size_t ii = 0; ii < steps.size(); ++ii)
+    {
+        // Ping-pong between the output and the workspace, so that the last step writes the output.
+        int8_t* dst = (steps.size() - ii) % 2 == 1 ? preprocessed_quantized_weight : workspace;
+        auto const* src_vecs = reinterpret_cast<uint32_t const*>(src);
+        auto* dst_vecs = reinterpret_cast<uint32_t*>(dst);
+        switch (steps[ii])
+        {
+        case PreprocessStep::kPermuteRows:
+        {
+            std::vector<int> const row_permutation = get_permutation_map(quant_type);
+            TLLM_CHECK_WITH_INFO(num_rows % int64_t(row_permutation.size()) == 0,
+                fmtstr("Invalid shape for quantized tensor. Number of rows of quantized matrix must be a multiple "
+                       "of %zu",
+                    row_permutation.size()));
+            RowPermutation permutation{};
+            permutation.rows = static_cast<int>(row_permutation.size());
+            std::copy(row_permutation.begin(), row_permutation.end(), permutation.map);
+            permuteRowsKernel<<<getGridSize(num_vecs), kThreads, 0, stream>>>(
+                src_vecs, dst_vecs, permutation, num_cols / elts_in_int32, num_vecs);
+            break;
+        }
+        case PreprocessStep::kTranspose:
+        {
+            dim3 const grid(divUp(num_cols, int64_t(kTransposeTile)), divUp(num_rows, int64_t(kTransposeTile)),
+                num_experts);
+            auto const* src_bytes = reinterpret_cast<uint8_t const*>(src);
+            auto* dst_bytes = reinterpret_cast<uint8_t*>(dst);
+            if (bits_per_elt == 8)
+            {
+                subbyteTransposeKernel<8><<<grid, kThreads, 0, stream>>>(src_bytes, dst_bytes, num_rows, num_cols);
+            }
+            else
+            {
+                subbyteTransposeKernel<4><<<grid, kThreads, 0, stream>>>(src_bytes, dst_bytes, num_rows, num_cols);
+            }
+            break;
+        }
+        case PreprocessStep::kInterleave:
+        {
+            interleaveColumnMajorKernel<<<getGridSize(num_vecs), kThreads, 0, stream>>>(src_vecs, dst_vecs, num_cols,
+                num_rows / elts_in_int32, layout.rows_per_column_tile / elts_in_int32, layout.columns_interleaved,
+                num_vecs);
+            break;
+        }
+        }
+        sync_check_cuda_error();
+        src = dst;
+    }
+    if (steps.empty())
+    {
+        TLLM_CUDA_CHECK(cudaMemcpyAsync(
+            preprocessed_quantized_weight, row_major_quantized_weight, num_bytes, cudaMemcpyDeviceToDevice, stream));
+    }
+
+    auto* registers = reinterpret_cast<uint32_t*>(preprocessed_quantized_weight);
+    if (bits_per_elt == 8)
+    {
+        addBiasAndInterleaveKernel<8><<<getGridSize(num_vecs), kThreads, 0, stream>>>(registers, num_vecs);
+    }
+    else
+    {
+        addBiasAndInterleaveKernel<4><<<getGridSize(num_vecs), kThreads, 0, stream>>>(registers, num_vecs);
+    }
+    sync_check_cuda_error();
+}
+
+} // namespace cutlass_kernels
+} // namespace kernels
+} // namespace tensorrt_llm
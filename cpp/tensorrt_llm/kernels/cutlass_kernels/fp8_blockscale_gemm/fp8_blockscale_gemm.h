@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "cutlass_extensions/gemm_configs.h"
+
+#include <cuda_runtime_api.h>
+#include <vector>
+
+namespace tkc = tensorrt_llm::cutlass_extensions;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+namespace cutlass_kernels
+{
+
+/*
+  This runner supports FP8 e4m3 GEMMs scaled by blocks, the layout of the fine-grained FP8 checkpoints:
+
+  Activations A [m, k] are row-major with a float scale per 1x128 group, [k / 128, m] M-major, as written by
+  invokeFP8BlockwiseQuantization.
+  Weights B [n, k] are column-major with a float scale per 128x128 tile, [k / 128, n / 128] N-major, as written by
+  invokeFP8WeightBlockQuantization.
+  Outputs D [m, n] are row-major.
+
+  The grouped GEMM of a MoE takes the rows of the experts contiguous in A and D, from expertFirstTokenOffset
+  [numExperts + 1] on the device, with the weights and their scales of the experts stacked.
+*/
+
+class CutlassFp8BlockScaleGemmRunnerInterface
+{
+public:
+    CutlassFp8BlockScaleGemmRunnerInterface() {}
+
+    virtual ~CutlassFp8BlockScaleGemmRunnerInterface() {}
+
+    virtual void gemm(void* D, void const* A, void const* B, int m, int n, int k, float const* scaleA,
+        float const* scaleB, tkc::CutlassGemmConfig gemmConfig, char* workspace, size_t workspaceBytes,
+        cudaStream_t stream)
+        = 0;
+
+    virtual void moeGemm(void* D, void const* A, void const* B, int64_t const* expertFirstTokenOffset, int numExperts,
+        int n, int k, float const* scaleA, float const* scaleB, tkc::CutlassGemmConfig gemmConfig, char* workspace,
+        size_t workspaceBytes, cudaStream_t stream)
+        = 0;
+
+    // Returns desired workspace size in bytes.
+    virtual size_t getWorkspaceSize(int const m, int const n, int const k) = 0;
+
+    virtual size_t getMoeWorkspaceSize(int const numExperts) = 0;
+
+    virtual std::vector<tkc::CutlassGemmConfig> getConfigs() const = 0;
+};
+
+template <typename T>
+class CutlassFp8BlockScaleGemmRunner : public virtual CutlassFp8BlockScaleGemmRunnerInterface
+{
+public:
+    CutlassFp8BlockScaleGemmRunner();
+    ~CutlassFp8BlockScaleGemmRunner();
+
+    void gemm(void* D, void const* A, void const* B, int m, int n, int k, float const* scaleA, float const* scaleB,
+        tkc::CutlassGemmConfig gemmConfig, char* workspace, size_t workspaceBytes, cudaStream_t stream) override;
+
+    void moeGemm(void* D, void const* A, void const* B, int64_t const* expertFirstTokenOffset, int numExperts, int n,
+        int k, float const* scaleA, float const* scaleB, tkc::CutlassGemmConfig gemmConfig, char* workspace,
+        size_t workspaceBytes, cudaStream_t stream) override;
+
+    // Returns desired workspace size in bytes.
+    size_t getWorkspaceSize(int const m, int const n, int const k) override;
+
+    size_t getMoeWorkspaceSize(int const numExperts) override;
+
+    std::vector<tkc::CutlassGemmConfig> getConfigs() const override;
+
+private:
+    size_t dispatchToArch(void* D, void const* A, void const* B, int m, int n, int k, float const* scaleA,
+        float const* scaleB, tkc::CutlassGemmConfig gemmConfig, char* workspace, size_t workspaceBytes,
+        cudaStream_t stream);
+
+    size_t dispatchMoeToArch(void* D, void const* A, void const* B, int64_t const* expertFirstTokenOffset,
+        int numExperts, int n, int k, float const* scaleA, float const* scaleB, tkc::CutlassGemmConfig gemmConfig,
+        char* workspace, size_t workspaceBytes, cudaStream_t stream);
+
+    int mSm;
+};
+
+} // namespace cutlass_kernels
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -0,0 +1,533 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#ifdef __GNUC__ // Check if the compiler is GCC or Clang
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wstrict-aliasing"
+#endif // __GNUC__
+
+#include "cute/tensor.hpp"
+#include "cutlass/conv/convolution.h"
+// Order matters here, packed_stride.hpp is missing cute and convolution includes
+#include "cutlass/util/packed_stride.hpp"
+
+#include "cutlass/epilogue/collective/collective_builder.hpp"
+#include "cutlass/gemm/collective/collective_builder.hpp"
+#include "cutlass/gemm/device/gemm_universal_adapter.h"
+#include "cutlass/gemm/dispatch_policy.hpp"
+#include "cutlass/gemm/group_array_problem_shape.hpp"
+#include "cutlass/gemm/kernel/gemm_universal.hpp"
+#include "cutlass_extensions/gemm_configs.h"
+
+#ifdef __GNUC__ // Check if the compiler is GCC or Clang
+#pragma GCC diagnostic pop
+#endif          // __GNUC__
+
+#include "fp8_blockscale_gemm.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/workspace.h"
+#include "tensorrt_llm/kernels/cutlass_kernels/cutlass_type_conversion.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace tk = tensorrt_llm::common;
+namespace tkc = tensorrt_llm::cutlass_extensions;
+
+using namespace cute;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+namespace cutlass_kernels
+{
+
+// Granularity of the scales: 1 row by 128 columns of the activations, 128x128 of the weights.
+constexpr int kFp8BlockScaleGranularityM = 1;
+constexpr int kFp8BlockScaleSize = 128;
+// The scales are promoted to the accumulators at every k tile of 128.
+constexpr int kFp8BlockScaleMmaPromotionInterval = 4;
+
+template <typename T>
+struct Fp8BlockScaleGemmTypes
+{
+    using ElementInput = cutlass::float_e4m3_t;
+    using ElementOutput = typename TllmToCutlassTypeAdapter<T>::type;
+    using ElementAccumulator = float;
+    using ElementBlockScale = float;
+    using LayoutA = cutlass::layout::RowMajor;
+    using LayoutB = cutlass::layout::ColumnMajor;
+    using LayoutD = cutlass::layout::RowMajor;
+    static constexpr int AlignmentInput = 128 / cutlass::sizeof_bits<ElementInput>::value;
+    static constexpr int AlignmentOutput = 128 / cutlass::sizeof_bits<ElementOutput>::value;
+};
+
+template <typename Gemm>
+size_t typedFp8BlockScaleGemmKernelLauncher(Gemm gemm, typename Gemm::Arguments args, void* D, void const* A,
+    void const* B, char* workspace, size_t workspaceBytes, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+
+    // Check shared memory size; throw when SMEM exceeds
+    int smem_size = int(sizeof(typename Gemm::GemmKernel::SharedStorage));
+    static int mMaxSmemSize = tk::getMaxSharedMemoryPerBlockOptin();
+    if (smem_size > mMaxSmemSize)
+    {
+        std::string errMsg = "SMEM size exceeds maximum allowed. Required " + std::to_string(smem_size) + ", got "
+            + std::to_string(mMaxSmemSize);
+        throw std::runtime_error("[TensorRT-LLM Error][fp8BlockScaleGemm Runner] " + errMsg);
+    }
+
+    // Return workspace size
+    if (!A && !B && !D)
+    {
+        return gemm.get_workspace_size(args);
+    }
+
+    if (gemm.get_workspace_size(args) > workspaceBytes)
+    {
+        std::string errMsg("Requested workspace size insufficient. Required "
+            + std::to_string(gemm.get_workspace_size(args)) + ", got " + std::to_string(workspaceBytes));
+        throw std::runtime_error("[TensorRT-LLM Error][fp8BlockScaleGemm Runner] " + errMsg);
+    }
+
+    auto can_implement = gemm.can_implement(args);
+    if (can_implement != cutlass::Status::kSuccess)
+    {
+        std::string errMsg = "fp8BlockScaleGemm cutlass kernel not implemented given the params. Error: "
+            + std::string(cutlassGetStatusString(can_implement));
+        throw std::runtime_error("[TensorRT-LLM Error][fp8BlockScaleGemm Runner] " + errMsg);
+    }
+
+    auto initStatus = gemm.initialize(args, workspace, stream);
+    if (initStatus != cutlass::Status::kSuccess)
+    {
+        std::string errMsg = "Failed to initialize. Error: " + std::string(cutlassGetStatusString(initStatus));
+        throw std::runtime_error("[TensorRT-LLM Error][fp8BlockScaleGemm Runner] " + errMsg);
+    }
+
+    auto runStatus = gemm.run(stream);
+    if (runStatus != cutlass::Status::kSuccess)
+    {
+        std::string errMsg = "Failed to run gemm. Error: " + std::string(cutlassGetStatusString(runStatus));
+        throw std::runtime_error("[TensorRT-LLM Error][fp8BlockScaleGemm Runner] " + errMsg);
+    }
+    return gemm.get_workspace_size(args);
+}
+
+template <typename T, typename CTAShape, typename ClusterShape>
+size_t genericFp8BlockScaleGemmKernelLauncherSm90(void* D, void const* A, void const* B, int m, int n, int k,
+    float const* scaleA, float const* scaleB, char* workspace, size_t workspaceBytes, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+
+#ifdef COMPILE_HOPPER_TMA_GEMMS
+    using Types = Fp8BlockScaleGemmTypes<T>;
+    using ElementInput = typename Types::ElementInput;
+    using ElementOutput = typename Types::ElementOutput;
+    using ElementAccumulator = typename Types::ElementAccumulator;
+
+    using CollectiveEpilogue = typename cutlass::epilogue::collective::CollectiveBuilder<cutlass::arch::Sm90,
+        cutlass::arch::OpClassTensorOp, CTAShape, ClusterShape, cutlass::epilogue::collective::EpilogueTileAuto,
+        ElementAccumulator, ElementAccumulator, void, typename Types::LayoutD, Types::AlignmentOutput, ElementOutput,
+        typename Types::LayoutD, Types::AlignmentOutput,
+        cutlass::epilogue::TmaWarpSpecializedCooperative>::CollectiveOp;
+
+    using CollectiveMainloop = typename cutlass::gemm::collective::CollectiveBuilder<cutlass::arch::Sm90,
+        cutlass::arch::OpClassTensorOp, ElementInput, typename Types::LayoutA, Types::AlignmentInput, ElementInput,
+        typename Types::LayoutB, Types::AlignmentInput, ElementAccumulator, CTAShape, ClusterShape,
+        cutlass::gemm::collective::StageCountAutoCarveout<static_cast<int>(
+            sizeof(typename CollectiveEpilogue::SharedStorage))>,
+        cutlass::gemm::KernelTmaWarpSpecializedCooperativeFP8BlockScaledAccum<kFp8BlockScaleGranularityM>>::
+        CollectiveOp;
+
+    using GemmKernel = cutlass::gemm::kernel::GemmUniversal<Shape<int, int, int, int>, CollectiveMainloop,
+        CollectiveEpilogue>;
+    using Gemm = cutlass::gemm::device::GemmUniversalAdapter<GemmKernel>;
+
+    using StrideA = typename Gemm::GemmKernel::StrideA;
+    using StrideB = typename Gemm::GemmKernel::StrideB;
+    using StrideC = typename Gemm::GemmKernel::StrideC;
+    using StrideD = typename Gemm::GemmKernel::StrideD;
+    StrideA stride_A = cutlass::make_cute_packed_stride(StrideA{}, make_shape(m, k, 1));
+    StrideB stride_B = cutlass::make_cute_packed_stride(StrideB{}, make_shape(n, k, 1));
+    StrideC stride_C;
+    StrideD stride_D = cutlass::make_cute_packed_stride(StrideD{}, make_shape(m, n, 1));
+
+    typename Gemm::Arguments args = {cutlass::gemm::GemmUniversalMode::kGemm, {m, n, k, 1},
+        {reinterpret_cast<ElementInput const*>(A), stride_A, reinterpret_cast<ElementInput const*>(B), stride_B,
+            kFp8BlockScaleMmaPromotionInterval, scaleA, scaleB},
+        {{1.f, 0.f}, nullptr, stride_C, reinterpret_cast<ElementOutput*>(D), stride_D}};
+    return typedFp8BlockScaleGemmKernelLauncher(Gemm{}, args, D, A, B, workspace, workspaceBytes, stream);
+#else  // COMPILE_HOPPER_TMA_GEMMS
+    throw std::runtime_error(
+        "[TensorRT-LLm Error][Fp8BlockScaleGemmKernelLauncherSm90] Please recompile with support for hopper by "
+        "passing 90-real as an arch to build_wheel.py.");
+#endif // COMPILE_HOPPER_TMA_GEMMS
+}
+
+#ifdef COMPILE_HOPPER_TMA_GEMMS
+// A thread per expert writes the problem, the pointers and the strides of its group from the offsets on the device, so
+// that the grouped GEMM needs no copy of the expert sizes to the host.
+template <typename ProblemShape, typename ElementInput, typename ElementOutput, typename StrideA, typename StrideB,
+    typename StrideD>
+__global__ void setupFp8BlockScaleGroupedGemmArgs(ProblemShape* problemShapes, ElementInput const** ptrA,
+    ElementInput const** ptrB, ElementOutput** ptrD, float const** ptrScaleA, float const** ptrScaleB,
+    StrideA* strideA, StrideB* strideB, StrideD* strideD, ElementInput const* A, ElementInput const* B,
+    ElementOutput* D, float const* scaleA, float const* scaleB, int64_t const* expertFirstTokenOffset, int numExperts,
+    int n, int k)
+{
+    int const expert = blockIdx.x * blockDim.x + threadIdx.x;
+    if (expert >= numExperts)
+    {
+        return;
+    }
+    int64_t const rowBegin = expertFirstTokenOffset[expert];
+    int const m = static_cast<int>(expertFirstTokenOffset[expert + 1] - rowBegin);
+    int64_t const kBlocks = k / kFp8BlockScaleSize;
+    int64_t const nBlocks = n / kFp8BlockScaleSize;
+
+    problemShapes[expert] = make_shape(m, n, k);
+    ptrA[expert] = A + rowBegin * k;
+    ptrB[expert] = B + static_cast<int64_t>(expert) * n * k;
+    ptrD[expert] = D + rowBegin * n;
+    ptrScaleA[expert] = scaleA + rowBegin * kBlocks;
+    ptrScaleB[expert] = scaleB + expert * kBlocks * nBlocks;
+    strideA[expert] = cutlass::make_cute_packed_stride(StrideA{}, make_shape(m, k, 1));
+    strideB[expert] = cutlass::make_cute_packed_stride(StrideB{}, make_shape(n, k, 1));
+    strideD[expert] = cutlass::make_cute_packed_stride(StrideD{}, make_shape(m, n, 1));
+}
+#endif // COMPILE_HOPPER_TMA_GEMMS
+
+template <typename T, typename CTAShape, typename ClusterShape>
+size_t genericFp8BlockScaleGroupedGemmKernelLauncherSm90(void* D, void const* A, void const* B,
+    int64_t const* expertFirstTokenOffset, int numExperts, int n, int k, float const* scaleA, float const* scaleB,
+    char* workspace, size_t workspaceBytes, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+
+#ifdef COMPILE_HOPPER_TMA_GEMMS
+    using Types = Fp8BlockScaleGemmTypes<T>;
+    using ElementInput = typename Types::ElementInput;
+    using ElementOutput = typename Types::ElementOutput;
+    using ElementAccumulator = typename Types::ElementAccumulator;
+    using ProblemShape = cutlass::gemm::GroupProblemShape<Shape<int, int, int>>;
+
+    using CollectiveEpilogue = typename cutlass::epilogue::collective::CollectiveBuilder<cutlass::arch::Sm90,
+        cutlass::arch::OpClassTensorOp, CTAShape, ClusterShape, cutlass::epilogue::collective::EpilogueTileAuto,
+        ElementAccumulator, ElementAccumulator, void, typename Types::LayoutD*, Types::AlignmentOutput, ElementOutput,
+        typename Types::LayoutD*, Types::AlignmentOutput,
+        cutlass::epilogue::PtrArrayTmaWarpSpecializedCooperative>::CollectiveOp;
+
+    using CollectiveMainloop = typename cutlass::gemm::collective::CollectiveBuilder<cutlass::arch::Sm90,
+        cutlass::arch::OpClassTensorOp, ElementInput, typename Types::LayoutA*, Types::AlignmentInput, ElementInput,
+        typename Types::LayoutB*, Types::AlignmentInput, ElementAccumulator, CTAShape, ClusterShape,
+        cutlass::gemm::collective::StageCountAutoCarveout<static_cast<int>(
+            sizeof(typename CollectiveEpilogue::SharedStorage))>,
+        cutlass::gemm::KernelPtrArrayTmaWarpSpecializedCooperativeFP8BlockScaledAccum<kFp8BlockScaleGranularityM>>::
+        CollectiveOp;
+
+    using GemmKernel = cutlass::gemm::kernel::GemmUniversal<ProblemShape, CollectiveMainloop, CollectiveEpilogue>;
+    using Gemm = cutlass::gemm::device::GemmUniversalAdapter<GemmKernel>;
+
+    using UnderlyingProblemShape = typename ProblemShape::UnderlyingProblemShape;
+    using StrideA = typename Gemm::GemmKernel::InternalStrideA;
+    using StrideB = typename Gemm::GemmKernel::InternalStrideB;
+    using StrideD = typename Gemm::GemmKernel::InternalStrideD;
+
+    // The per expert arguments live at the start of the workspace, the CUTLASS workspace after them.
+    size_t const expertArgsSizes[] = {numExperts * sizeof(UnderlyingProblemShape),
+        numExperts * sizeof(ElementInput const*), numExperts * sizeof(ElementInput const*),
+        numExperts * sizeof(ElementOutput*), numExperts * sizeof(float const*), numExperts * sizeof(float const*),
+        numExperts * sizeof(StrideA), numExperts * sizeof(StrideB), numExperts * sizeof(StrideD)};
+    size_t const expertArgsBytes
+        = tk::calculateTotalWorkspaceSize(expertArgsSizes, sizeof(expertArgsSizes) / sizeof(expertArgsSizes[0]));
+
+    auto* base = reinterpret_cast<int8_t*>(workspace);
+    uintptr_t offset = 0;
+    auto* problemShapes
+        = reinterpret_cast<UnderlyingProblemShape*>(tk::nextWorkspacePtr(base, offset, expertArgsSizes[0]));
+    auto* ptrA = reinterpret_cast<ElementInput const**>(tk::nextWorkspacePtr(base, offset, expertArgsSizes[1]));
+    auto* ptrB = reinterpret_cast<ElementInput const**>(tk::nextWorkspacePtr(base, offset, expertArgsSizes[2]));
+    auto* ptrD = reinterpret_cast<ElementOutput**>(tk::nextWorkspacePtr(base, offset, expertArgsSizes[3]));
+    auto* ptrScaleA = reinterpret_cast<float const**>(tk::nextWorkspacePtr(base, offset, expertArgsSizes[4]));
+    auto* ptrScaleB = reinterpret_cast<float const**>(tk::nextWorkspacePtr(base, offset, expertArgsSizes[5]));
+    auto* strideA = reinterpret_cast<StrideA*>(tk::nextWorkspacePtr(base, offset, expertArgsSizes[6]));
+    auto* strideB = reinterpret_cast<StrideB*>(tk::nextWorkspacePtr(base, offset, expertArgsSizes[7]));
+    auto* strideD = reinterpret_cast<StrideD*>(tk::nextWorkspacePtr(base, offset, expertArgsSizes[8]));
+
+    cutlass::KernelHardwareInfo hwInfo;
+    hwInfo.device_id = 0;
+    hwInfo.sm_count = tk::getMultiProcessorCount();
+
+    // The host problem shapes are not given, the tile scheduler reads the device ones.
+    typename Gemm::Arguments args = {cutlass::gemm::GemmUniversalMode::kGrouped, {numExperts, problemShapes, nullptr},
+        {ptrA, strideA, ptrB, strideB, kFp8BlockScaleMmaPromotionInterval, ptrScaleA, ptrScaleB},
+        {{1.f, 0.f}, nullptr, nullptr, ptrD, strideD}, hwInfo};
+
+    if (!A && !B && !D)
+    {
+        return expertArgsBytes + typedFp8BlockScaleGemmKernelLauncher(Gemm{}, args, D, A, B, nullptr, 0, stream);
+    }
+    TLLM_CHECK_WITH_INFO(workspaceBytes >= expertArgsBytes,
+        "[fp8BlockScaleGemm Runner] The workspace of %zu bytes cannot hold the arguments of %d experts", workspaceBytes,
+        numExperts);
+
+    int const threads = 128;
+    setupFp8BlockScaleGroupedGemmArgs<<<(numExperts + threads - 1) / threads, threads, 0, stream>>>(problemShapes,
+        ptrA, ptrB, ptrD, ptrScaleA, ptrScaleB, strideA, strideB, strideD, reinterpret_cast<ElementInput const*>(A),
+        reinterpret_cast<ElementInput const*>(B), reinterpret_cast<ElementOutput*>(D), scaleA, scaleB,
+        expertFirstTokenOffset, numExperts, n, k);
+    sync_check_cuda_error();
+
+    return expertArgsBytes
+        + typedFp8BlockScaleGemmKernelLauncher(Gemm{}, args, D, A, B, workspace + expertArgsBytes,
+            workspaceBytes - expertArgsBytes, stream);
+#else  // COMPILE_HOPPER_TMA_GEMMS
+    throw std::runtime_error(
+        "[TensorRT-LLm Error][Fp8BlockScaleGroupedGemmKernelLauncherSm90] Please recompile with support for hopper by "
+        "passing 90-real as an arch to build_wheel.py.");
+#endif // COMPILE_HOPPER_TMA_GEMMS
+}
+
+template <typename T, typename CTAShape>
+size_t dispatchGemmConfigSm90(void* D, void const* A, void const* B, int64_t const* expertFirstTokenOffset,
+    int numExperts, int m, int n, int k, float const* scaleA, float const* scaleB, tkc::CutlassGemmConfig gemmConfig,
+    char* workspace, size_t workspaceBytes, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    // The dense GEMM has no experts.
+    bool const grouped = numExperts > 0;
+    switch (gemmConfig.cluster_shape)
+    {
+    case tkc::ClusterShape::ClusterShape_1x1x1:
+        return grouped ? genericFp8BlockScaleGroupedGemmKernelLauncherSm90<T, CTAShape, Shape<_1, _1, _1>>(D, A, B,
+                   expertFirstTokenOffset, numExperts, n, k, scaleA, scaleB, workspace, workspaceBytes, stream)
+                       : genericFp8BlockScaleGemmKernelLauncherSm90<T, CTAShape, Shape<_1, _1, _1>>(
+                           D, A, B, m, n, k, scaleA, scaleB, workspace, workspaceBytes, stream);
+        break;
+    case tkc::ClusterShape::ClusterShape_1x2x1:
+        return grouped ? genericFp8BlockScaleGroupedGemmKernelLauncherSm90<T, CTAShape, Shape<_1, _2, _1>>(D, A, B,
+                   expertFirstTokenOffset, numExperts, n, k, scaleA, scaleB, workspace, workspaceBytes, stream)
+                       : genericFp8BlockScaleGemmKernelLauncherSm90<T, CTAShape, Shape<_1, _2, _1>>(
+                           D, A, B, m, n, k, scaleA, scaleB, workspace, workspaceBytes, stream);
+        break;
+    default:
+        throw std::runtime_error(
+            "[TensorRT-LLM Error][CutlassFp8BlockScaleGemmRunner][dispatchGemmConfigSm90] Config is invalid for "
+            "Fp8 Block Scale GEMM.");
+        break;
+    }
+}
+
+template <typename T>
+size_t dispatchGemmToCutlassSm90(void* D, void const* A, void const* B, int64_t const* expertFirstTokenOffset,
+    int numExperts, int m, int n, int k, float const* scaleA, float const* scaleB, tkc::CutlassGemmConfig gemmConfig,
+    char* workspace, size_t workspaceBytes, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    // The k tile is the k of a scale block.
+    using _Ktile = Int<kFp8BlockScaleSize>;
+    switch (gemmConfig.tile_config_sm90)
+    {
+    case tkc::CutlassTileConfigSM90::CtaShape128x64x128B:
+        return dispatchGemmConfigSm90<T, Shape<_128, _64, _Ktile>>(D, A, B, expertFirstTokenOffset, numExperts, m, n,
+            k, scaleA, scaleB, gemmConfig, workspace, workspaceBytes, stream);
+        break;
+    case tkc::CutlassTileConfigSM90::CtaShape128x128x128B:
+        return dispatchGemmConfigSm90<T, Shape<_128, _128, _Ktile>>(D, A, B, expertFirstTokenOffset, numExperts, m, n,
+            k, scaleA, scaleB, gemmConfig, workspace, workspaceBytes, stream);
+        break;
+    case tkc::CutlassTileConfigSM90::Undefined:
+        throw std::runtime_error(
+            "[TensorRT-LLm Error][CutlassFp8BlockScaleGemmRunner][dispatchGemmToCutlassSm90] gemm config undefined.");
+        break;
+    case tkc::CutlassTileConfigSM90::ChooseWithHeuristic:
+        throw std::runtime_error(
+            "[TensorRT-LLm Error][CutlassFp8BlockScaleGemmRunner][dispatchGemmToCutlassSm90] gemm config should have "
+            "already been set by heuristic.");
+        break;
+    default:
+        throw std::runtime_error(
+            "[TensorRT-LLm Error][CutlassFp8BlockScaleGemmRunner][dispatchGemmToCutlassSm90] Config is invalid for "
+            "Fp8 Block Scale GEMM.");
+        break;
+    }
+}
+
+template <typename T>
+CutlassFp8BlockScaleGemmRunner<T>::CutlassFp8BlockScaleGemmRunner()
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    mSm = tk::getSMVersion();
+}
+
+template <typename T>
+CutlassFp8BlockScaleGemmRunner<T>::~CutlassFp8BlockScaleGemmRunner()
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+}
+
+template <typename T>
+size_t CutlassFp8BlockScaleGemmRunner<T>::dispatchToArch(void* D, void const* A, void const* B, int m, int n, int k,
+    float const* scaleA, float const* scaleB, tkc::CutlassGemmConfig gemmConfig, char* workspace,
+    size_t workspaceBytes, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    if (mSm == 90)
+    {
+        return dispatchGemmToCutlassSm90<T>(
+            D, A, B, nullptr, 0, m, n, k, scaleA, scaleB, gemmConfig, workspace, workspaceBytes, stream);
+    }
+    else
+    {
+        throw std::runtime_error(
+            "[TensorRT-LLM Error][CutlassFp8BlockScaleGemmRunner][GEMM Dispatch] Arch unsupported for CUTLASS "
+            "Fp8 Block Scale GEMM");
+    }
+    return 0;
+}
+
+template <typename T>
+size_t CutlassFp8BlockScaleGemmRunner<T>::dispatchMoeToArch(void* D, void const* A, void const* B,
+    int64_t const* expertFirstTokenOffset, int numExperts, int n, int k, float const* scaleA, float const* scaleB,
+    tkc::CutlassGemmConfig gemmConfig, char* workspace, size_t workspaceBytes, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    if (mSm == 90)
+    {
+        return dispatchGemmToCutlassSm90<T>(D, A, B, expertFirstTokenOffset, numExperts, 0, n, k, scaleA, scaleB,
+            gemmConfig, workspace, workspaceBytes, stream);
+    }
+    else
+    {
+        throw std::runtime_error(
+            "[TensorRT-LLM Error][CutlassFp8BlockScaleGemmRunner][GEMM Dispatch] Arch unsupported for CUTLASS "
+            "Fp8 Block Scale GEMM");
+    }
+    return 0;
+}
+
+template <typename T>
+void CutlassFp8BlockScaleGemmRunner<T>::gemm(void* D, void const* A, void const* B, int m, int n, int k,
+    float const* scaleA, float const* scaleB, tkc::CutlassGemmConfig gemmConfig, char* workspace,
+    size_t workspaceBytes, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    TLLM_CHECK_WITH_INFO(n % kFp8BlockScaleSize == 0 && k % kFp8BlockScaleSize == 0,
+        "The FP8 block scale GEMM needs n and k multiples of %d, got n %d and k %d", kFp8BlockScaleSize, n, k);
+    if (m == 0)
+    {
+        return;
+    }
+    dispatchToArch(D, A, B, m, n, k, scaleA, scaleB, gemmConfig, workspace, workspaceBytes, stream);
+}
+
+template <typename T>
+void CutlassFp8BlockScaleGemmRunner<T>::moeGemm(void* D, void const* A, void const* B,
+    int64_t const* expertFirstTokenOffset, int numExperts, int n, int k, float const* scaleA, float const* scaleB,
+    tkc::CutlassGemmConfig gemmConfig, char* workspace, size_t workspaceBytes, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    TLLM_CHECK_WITH_INFO(n % kFp8BlockScaleSize == 0 && k % kFp8BlockScaleSize == 0,
+        "The FP8 block scale GEMM needs n and k multiples of %d, got n %d and k %d", kFp8BlockScaleSize, n, k);
+    TLLM_CHECK(numExperts > 0);
+    dispatchMoeToArch(D, A, B, expertFirstTokenOffset, numExperts, n, k, scaleA, scaleB, gemmConfig, workspace,
+        workspaceBytes, stream);
+}
+
+template <typename T>
+std::vector<tkc::CutlassGemmConfig> CutlassFp8BlockScaleGemmRunner<T>::getConfigs() const
+{
+    using tkc::CutlassGemmConfig;
+
+    std::vector<CutlassGemmConfig> candidateConfigs;
+    if (mSm == 90)
+    {
+        // The cooperative schedules need a tile m of 128, and the k tile is the 128 of the scale blocks.
+        std::vector<tkc::CutlassTileConfigSM90> tilesSm90
+            = {tkc::CutlassTileConfigSM90::CtaShape128x64x128B, tkc::CutlassTileConfigSM90::CtaShape128x128x128B};
+        std::vector<tkc::ClusterShape> clustersSm90
+            = {tkc::ClusterShape::ClusterShape_1x1x1, tkc::ClusterShape::ClusterShape_1x2x1};
+        for (auto const& tile_config : tilesSm90)
+        {
+            for (auto const& cluster_shape : clustersSm90)
+            {
+                candidateConfigs.emplace_back(
+                    tile_config, tkc::MainloopScheduleType::AUTO, tkc::EpilogueScheduleType::AUTO, cluster_shape);
+            }
+        }
+    }
+    else
+    {
+        throw std::runtime_error(
+            "[TensorRT-LLM Error][CutlassFp8BlockScaleGemmRunner][GEMM Dispatch] Arch unsupported for CUTLASS "
+            "Fp8 Block Scale GEMM");
+    }
+    return candidateConfigs;
+}
+
+template <typename T>
+size_t CutlassFp8BlockScaleGemmRunner<T>::getWorkspaceSize(int const m, int const n, int const k)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    size_t workspace_size = 0;
+    for (auto const& gemmConfig : getConfigs())
+    {
+        try
+        {
+            size_t curr_workspace_size
+                = dispatchToArch(nullptr, nullptr, nullptr, m, n, k, nullptr, nullptr, gemmConfig, nullptr, 0, 0);
+            workspace_size = std::max(workspace_size, curr_workspace_size);
+        }
+        catch (std::runtime_error& e)
+        {
+            // Swallow errors when SMEM exceeds maximum allowed
+            continue;
+        }
+    }
+    return workspace_size;
+}
+
+template <typename T>
+size_t CutlassFp8BlockScaleGemmRunner<T>::getMoeWorkspaceSize(int const numExperts)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    // The workspace of the grouped GEMM depends on the number of groups only.
+    size_t workspace_size = 0;
+    for (auto const& gemmConfig : getConfigs())
+    {
+        try
+        {
+            size_t curr_workspace_size = dispatchMoeToArch(nullptr, nullptr, nullptr, nullptr, numExperts,
+                kFp8BlockScaleSize, kFp8BlockScaleSize, nullptr, nullptr, gemmConfig, nullptr, 0, 0);
+            workspace_size = std::max(workspace_size, curr_workspace_size);
+        }
+        catch (std::runtime_error& e)
+        {
+            // Swallow errors when SMEM exceeds maximum allowed
+            continue;
+        }
+    }
+    return workspace_size;
+}
+
+} // namespace cutlass_kernels
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -247,9 +247,37 @@ void sm90_generic_mixed_gemm_kernelLauncher(ActivationType const* A, WeightType
             {}                                                                        // end multiply_add
         };
 
+        // The split of K chosen by the profiler for the stream-K kernels, which use the CUTLASS heuristic by default.
+        bool const has_k_decomposition = gemm_config.split_k_style != tkc::SplitKStyle::NO_SPLIT_K;
+        if constexpr (std::is_same_v<TileScheduler, cutlass::gemm::StreamKScheduler>)
+        {
+            using DecompositionMode =
+                typename cutlass::gemm::kernel::detail::PersistentTileSchedulerSm90StreamKParams::DecompositionMode;
+            if (gemm_config.split_k_style == tkc::SplitKStyle::SPLIT_K_SERIAL)
+            {
+                args.scheduler.decomposition_mode = DecompositionMode::SplitK;
+                args.scheduler.splits = gemm_config.split_k_factor;
+            }
+            else if (gemm_config.split_k_style == tkc::SplitKStyle::STREAM_K)
+            {
+                args.scheduler.decomposition_mode = DecompositionMode::StreamK;
+            }
+        }
+        else if (has_k_decomposition)
+        {
+            throw std::runtime_error(
+                "[TensorRT-LLm Error][fpA_intB Runner] Split-K and stream-K need a CTA tile of 128 along N.");
+        }
+
         Gemm gemm;
         if (gemm.get_workspace_size(args) > workspace_bytes)
         {
+            if (has_k_decomposition)
+            {
+                // The profiler skips the split for this shape.
+                throw std::runtime_error("[TensorRT-LLm Error][fpA_intB Runner] given workspace size insufficient for "
+                                         "the split of K.");
+            }
             TLLM_LOG_ERROR("[TensorRT-LLm Error][fpA_intB Runner] given workspace size insufficient.");
         }
 
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/cutlass_kernels/preprocessed_weight_cache.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/stringUtils.h"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <unistd.h>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+namespace cutlass_kernels
+{
+
+namespace
+{
+
+uint32_t constexpr kMagic = 0x57505054; // "TPPW"
+// Bump when the preprocessing of a layout changes.
+uint32_t constexpr kFormatVersion = 1;
+
+template <typename T>
+bool readValue(std::ifstream& file, T& value)
+{
+    file.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return static_cast<bool>(file);
+}
+
+template <typename T>
+void writeValue(std::ofstream& file, T const& value)
+{
+    file.write(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+std::optional<PreprocessedWeightHeader> readHeader(std::ifstream& file)
+{
+    uint32_t magic{0};
+    uint32_t version{0};
+    int32_t quant_type{0};
+    uint8_t permute_rows{0};
+    uint8_t transpose{0};
+    PreprocessedWeightHeader header;
+    if (!readValue(file, magic) || magic != kMagic || !readValue(file, version) || version != kFormatVersion
+        || !readValue(file, quant_type) || !readValue(file, permute_rows) || !readValue(file, transpose)
+        || !readValue(file, header.layout.rows_per_column_tile) || !readValue(file, header.layout.columns_interleaved))
+    {
+        return std::nullopt;
+    }
+    header.quant_type = static_cast<QuantType>(quant_type);
+    header.layout.permute_rows = permute_rows != 0;
+    header.layout.transpose = transpose != 0;
+    header.shape.resize(3);
+    for (auto& dim : header.shape)
+    {
+        uint64_t value{0};
+        if (!readValue(file, value))
+        {
+            return std::nullopt;
+        }
+        dim = static_cast<size_t>(value);
+    }
+    return header;
+}
+
+std::vector<size_t> getShape3D(std::vector<size_t> const& shape)
+{
+    TLLM_CHECK_WITH_INFO(shape.size() == 2 || shape.size() == 3, "Shape must be 2-D or 3-D");
+    return shape.size() == 2 ? std::vector<size_t>{1, shape[0], shape[1]} : shape;
+}
+
+} // namespace
+
+size_t PreprocessedWeightHeader::num_bytes() const
+{
+    size_t num_elts = 1;
+    for (auto const& dim : shape)
+    {
+        num_elts *= dim;
+    }
+    return num_elts * get_weight_quant_bits(quant_type) / 8;
+}
+
+void save_preprocessed_weights(
+    std::string const& path, int8_t const* preprocessed_quantized_weight, PreprocessedWeightHeader const& header)
+{
+    auto const shape = getShape3D(header.shape);
+    auto const tmp_path = fmtstr("%s.tmp.%d.%zu", path.c_str(), static_cast<int>(getpid()),
+        std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        writeValue(file, kMagic);
+        writeValue(file, kFormatVersion);
+        writeValue(file, static_cast<int32_t>(header.quant_type));
+        writeValue(file, static_cast<uint8_t>(header.layout.permute_rows));
+        writeValue(file, static_cast<uint8_t>(header.layout.transpose));
+        writeValue(file, header.layout.rows_per_column_tile);
+        writeValue(file, header.layout.columns_interleaved);
+        for (auto const dim : shape)
+        {
+            writeValue(file, static_cast<uint64_t>(dim));
+        }
+        file.write(reinterpret_cast<char const*>(preprocessed_quantized_weight),
+            static_cast<std::streamsize>(header.num_bytes()));
+        if (!file)
+        {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(tmp_path, error);
+            TLLM_THROW("Cannot write the preprocessed weights %s", tmp_path.c_str());
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tmp_path, path, error);
+    if (error)
+    {
+        std::filesystem::remove(tmp_path, error);
+        TLLM_THROW("Cannot write the preprocessed weights %s (%s)", path.c_str(), error.message().c_str());
+    }
+}
+
+std::optional<PreprocessedWeightHeader> read_preprocessed_weight_header(std::string const& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return std::nullopt;
+    }
+    return readHeader(file);
+}
+
+bool load_preprocessed_weights(std::string const& path, int8_t* preprocessed_quantized_weight,
+    std::vector<size_t> const& shape, QuantType quant_type, bool force_interleave)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    auto const header = readHeader(file);
+    if (!header)
+    {
+        TLLM_LOG_WARNING("Ignoring %s, which is not a file of preprocessed weights.", path.c_str());
+        return false;
+    }
+    if (header->quant_type != quant_type || header->shape != getShape3D(shape))
+    {
+        TLLM_LOG_WARNING(
+            "Ignoring the preprocessed weights %s, which have another quantization or shape.", path.c_str());
+        return false;
+    }
+    if (!(header->layout == get_mixed_gemm_weight_layout(quant_type, force_interleave)))
+    {
+        TLLM_LOG_INFO("The preprocessed weights %s have the layout of another GPU, preprocessing them again.",
+            path.c_str());
+        return false;
+    }
+    file.read(
+        reinterpret_cast<char*>(preprocessed_quantized_weight), static_cast<std::streamsize>(header->num_bytes()));
+    if (!file)
+    {
+        TLLM_LOG_WARNING("Ignoring the truncated preprocessed weights %s.", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace cutlass_kernels
+} // namespace kernels
+} // namespace tensorrt_llm
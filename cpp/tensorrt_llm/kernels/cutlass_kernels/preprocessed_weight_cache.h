@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/kernels/cutlass_kernels/cutlass_preprocessors.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+namespace cutlass_kernels
+{
+
+// File of weights already preprocessed for the mixed GEMMs, so that the loads of a checkpoint skip
+// preprocess_weights_for_mixed_gemm. The header records the quantization, the shape and the MixedGemmWeightLayout the
+// weights were preprocessed for, and a file is only loaded on a GPU with the same layout, e.g. preprocessed on an SM80
+// GPU and loaded on an SM86 one.
+struct PreprocessedWeightHeader
+{
+    QuantType quant_type{QuantType::W8_A16};
+    MixedGemmWeightLayout layout;
+    // [num_experts, num_rows, num_cols] in elements, num_experts is 1 for the 2-D weights.
+    std::vector<size_t> shape;
+
+    [[nodiscard]] size_t num_bytes() const;
+};
+
+// Writes the preprocessed weights in host memory, to a temporary file renamed on success so that the readers never see
+// a partial file. Throws on failure.
+void save_preprocessed_weights(std::string const& path, int8_t const* preprocessed_quantized_weight,
+    PreprocessedWeightHeader const& header);
+
+// Reads the header of a file, std::nullopt if it is not a file of preprocessed weights of this version.
+std::optional<PreprocessedWeightHeader> read_preprocessed_weight_header(std::string const& path);
+
+// Reads the weights of a file into host memory if the file holds the quantization and the shape of the weights and its
+// layout is the one of the current GPU, returns false otherwise so that the caller falls back to the preprocessing.
+bool load_preprocessed_weights(std::string const& path, int8_t* preprocessed_quantized_weight,
+    std::vector<size_t> const& shape, QuantType quant_type, bool force_interleave = false);
+
+} // namespace cutlass_kernels
+} // namespace kernels
+} // namespace tensorrt_llm
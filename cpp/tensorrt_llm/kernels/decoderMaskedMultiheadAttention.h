@@ -133,6 +133,9 @@ struct Multihead_attention_params_base
     int rotary_cogvlm_vision_length = -1;
     // Position shift for streamingllm
     bool position_shift_enabled = false;
+    // Rotate the past keys by their position in the window while loading them from the KV cache, instead of reading the
+    // rotated copy of shift_k_cache (position shift only).
+    bool position_shift_in_kernel = false;
     // The current timestep. TODO Check that do we only this param in cross attention?
     int timestep = 0;
     // The current timestep of each sentences (support different timestep for different sentences)
@@ -152,6 +155,11 @@ struct Multihead_attention_params_base
     T const* relative_attention_bias = nullptr;
     int relative_attention_bias_stride = 0;
     int max_distance = 0;
+    // Optional bias of every head and distance [num_heads, relative_attention_distance_bias_stride] gathered once from
+    // the bucket table, see invokeBuildRelativeAttentionDistanceBias. Read instead of computing the bucket of every key
+    // in the implicit mode, for distances below the stride.
+    T const* relative_attention_distance_bias = nullptr;
+    int relative_attention_distance_bias_stride = 0;
 
     // If logn scaling is used
     float const* logn_scaling_ptr = nullptr;
@@ -170,9 +178,10 @@ struct Multihead_attention_params_base
     float const* qkv_scale_quant_orig = nullptr;
     float const* attention_out_scale_orig_quant = nullptr;
 
-    // 8 bits kv cache scales.
+    // 8 bits kv cache scales, (1) or (num_kv_heads) if kv_scale_per_head.
     float const* kv_scale_orig_quant = nullptr;
     float const* kv_scale_quant_orig = nullptr;
+    bool kv_scale_per_head = false;
 
     bool int8_kv_cache = false;
     bool fp8_kv_cache = false;
@@ -201,6 +210,13 @@ struct Multihead_attention_params_base
 
     int const* memory_length_per_sample = nullptr;
     int32_t const* mrope_position_deltas = nullptr;
+
+    // Optional attention mass per cached token [num_rows, max_attention_window_size]. The normalized attention
+    // probabilities of every head are added to it, for attention-score-based token eviction. Only accumulated in
+    // single-block mode.
+    float* attention_mass = nullptr;
+    // Row of attention_mass for every batch entry [batch_size]. Row batch_beam_idx if nullptr.
+    int32_t const* attention_mass_rows = nullptr;
 };
 
 template <typename T, bool USE_CROSS_ATTENTION = false>
@@ -19,11 +19,13 @@
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention.h"
+#include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention/multiBlockTuner.h"
 #include "tensorrt_llm/kernels/gptKernels.h"
 #include "tensorrt_llm/kernels/kvCacheUtils.h"
 
 #include <algorithm>
 #include <cuda_runtime_api.h>
+#include <optional>
 #ifdef ENABLE_FP8
 #include <cuda_fp8.h>
 #endif
@@ -95,13 +97,16 @@ inline size_t smem_size_in_bytes(Multihead_attention_params<T, DO_CROSS_ATTENTIO
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Returns the key of the shape when the number of blocks per sequence comes from MultiBlockTuner, which must be told
+// of the end of the launch.
 template <typename T, int Dh, bool DO_CROSS_ATTENTION>
-inline void multi_block_grid_setup(dim3& grid, Multihead_attention_params<T, DO_CROSS_ATTENTION> const& params,
-    int blocks_per_sm, int block_size, int tlength)
+inline std::optional<MultiBlockTuner::Key> multi_block_grid_setup(dim3& grid,
+    Multihead_attention_params<T, DO_CROSS_ATTENTION> const& params, int blocks_per_sm, int block_size, int tlength,
+    cudaStream_t stream)
 {
     if (!params.multi_block_mode)
     {
-        return;
+        return std::nullopt;
     }
 
     int balanced_seq_len_tile
@@ -125,6 +130,15 @@ inline void multi_block_grid_setup(dim3& grid, Multihead_attention_params<T, DO_
         max_seq_len_tile = std::min(mmha::divUp(tlength + 1, seq_len_per_kv_loop), max_seq_len_tile);
     }
 
+    std::optional<MultiBlockTuner::Key> tuner_key;
+    if (!multi_block_debug_flag && MultiBlockTuner::isEnabled())
+    {
+        tuner_key = MultiBlockTuner::makeKey(MultiBlockTuner::Kernel::kMMHA, params.batch_size, tlength + 1,
+            params.num_heads, params.num_kv_heads, params.hidden_size_per_head);
+        balanced_seq_len_tile = MultiBlockTuner::getInstance().select(*tuner_key, balanced_seq_len_tile,
+            params.min_seq_len_tile, std::min(max_seq_len_tile, block_size), stream);
+    }
+
     params.seq_len_tile = std::clamp(balanced_seq_len_tile, params.min_seq_len_tile, max_seq_len_tile);
 
     TLLM_CHECK_WITH_INFO(
@@ -145,6 +159,7 @@ inline void multi_block_grid_setup(dim3& grid, Multihead_attention_params<T, DO_
     }
 
     grid.z = params.seq_len_tile;
+    return tuner_key;
 }
 
 #define MMHA_LAUNCH_CHECK(DYNAMIC_THDS_PER_BLOCK, DO_MULTI_BLOCK)                                                      \
@@ -302,7 +317,8 @@ void mmha_launch_kernel_ex(KernelParamsType const& params, KVCacheBuffer const&
     dynamic_block_size = getEnvMmhaKernelBlockSize() > 0 ? getEnvMmhaKernelBlockSize() : dynamic_block_size;
 
     // If blocks with larger block size already fill all SMs, then disable the multi blocks mode.
-    mmha::multi_block_grid_setup<T, Dh>(grid, params, available_blocks, dynamic_block_size, tlength);
+    auto const tuner_key
+        = mmha::multi_block_grid_setup<T, Dh>(grid, params, available_blocks, dynamic_block_size, tlength, stream);
 
     // Launch kernels based on the valid block size.
     switch (dynamic_block_size)
@@ -341,6 +357,11 @@ void mmha_launch_kernel_ex(KernelParamsType const& params, KVCacheBuffer const&
         break;
     default: TLLM_CHECK_WITH_INFO(false, "Wrong kernel block size for launching the MMHA kernel.");
     }
+
+    if (tuner_key)
+    {
+        MultiBlockTuner::getInstance().finish(*tuner_key, stream);
+    }
 }
 
 template <typename T, typename T_cache, typename KVCacheBuffer, typename KernelParamsType, int Dh, int THDS_PER_BLOCK,
@@ -349,6 +370,17 @@ template <typename T, typename T_cache, typename KVCacheBuffer, typename KernelP
 void mmha_launch_kernel_dispatch_pos_shift(KernelParamsType const& params, KVCacheBuffer const& kv_cache_buffer,
     KVLinearBuffer const& shift_k_cache, cudaStream_t const& stream, int tlength)
 {
+    if constexpr (std::is_same_v<T_cache, T>)
+    {
+        if (params.position_shift_enabled && params.position_shift_in_kernel && !KernelParamsType::DO_CROSS_ATTENTION)
+        {
+            // The past keys are read from the KV cache without position embedding and rotated in the kernel.
+            mmha_launch_kernel_ex<T, T_cache, T_cache, KVCacheBuffer, KVCacheBuffer, KernelParamsType, Dh,
+                THDS_PER_BLOCK, HAS_BEAMS, DO_MULTI_BLOCK, true, BLOCK_SPARSE_ATTN, IMPLICIT_REL_ATTN_BIAS,
+                ATTN_LOGIT_SOFTCAPPING>(params, kv_cache_buffer, kv_cache_buffer, stream, tlength);
+            return;
+        }
+    }
     if (params.position_shift_enabled && !KernelParamsType::DO_CROSS_ATTENTION)
     {
         mmha_launch_kernel_ex<T, T_cache, T, KVCacheBuffer, KVLinearBuffer, KernelParamsType, Dh, THDS_PER_BLOCK,
@@ -1260,6 +1260,50 @@ __device__ inline constexpr uint2 chunk_index(unsigned tidx)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Apply the rotary embedding of the position in the window to the channels [channel, channel + num_elems) of a past
+// key kept without position embedding in the KV cache (see position_shift_in_kernel). The GPT-NeoX embedding rotates
+// them with the channels half the rotary dim away, read into k_pair.
+template <typename T, typename K_vec>
+inline __device__ void rotate_past_key(K_vec& k, K_vec const& k_pair, int const channel,
+    PositionEmbeddingType const position_embedding_type, int const rotary_embedding_dim, float const base,
+    float const scale, float const* inv_freq_cache, int const position)
+{
+    constexpr int VEC_SIZE = sizeof(K_vec) / sizeof(T);
+    T* k_elts = reinterpret_cast<T*>(&k);
+    T const* k_pair_elts = reinterpret_cast<T const*>(&k_pair);
+    if (position_embedding_type == PositionEmbeddingType::kROPE_GPTJ)
+    {
+#pragma unroll
+        for (int elt_id = 0; elt_id < VEC_SIZE; elt_id += 2)
+        {
+            float2 const coef = rotary_embedding_coefficient(
+                inv_freq_cache, channel + elt_id, rotary_embedding_dim, base, scale, 1.f, float(position));
+            float2 const rotated = rotary_embedding_transform(
+                make_float2(convert_to_float(k_elts[elt_id]), convert_to_float(k_elts[elt_id + 1])), coef);
+            convert_from_float(&k_elts[elt_id], rotated.x);
+            convert_from_float(&k_elts[elt_id + 1], rotated.y);
+        }
+    }
+    else
+    {
+        int const half_rotary_dim = rotary_embedding_dim / 2;
+        bool const first_half = channel < half_rotary_dim;
+        int const freq_idx = first_half ? channel : channel - half_rotary_dim;
+#pragma unroll
+        for (int elt_id = 0; elt_id < VEC_SIZE; elt_id++)
+        {
+            float2 const coef = rotary_embedding_coefficient(
+                inv_freq_cache, 2 * (freq_idx + elt_id), rotary_embedding_dim, base, scale, 1.f, float(position));
+            float const x = convert_to_float(k_elts[elt_id]);
+            float const x_pair = convert_to_float(k_pair_elts[elt_id]);
+            float const rotated = first_half ? x * coef.x - x_pair * coef.y : x * coef.x + x_pair * coef.y;
+            convert_from_float(&k_elts[elt_id], rotated);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 template <
     // The type of the inputs. Supported types: float, uint16_t, nv_bfloat16.
     typename T,
@@ -1505,6 +1549,8 @@ __global__ void __launch_bounds__(MAX_THEADS_PER_BLOCK, MIN_BLOCKS_PER_SM) maske
         = HAS_BEAMS && tlength > cyclic_kv_cache_len ? 0 : params.input_lengths[batch_beam_idx];
     // The position of the current timestep, and it is used to apply the position embedding
     int current_pos_idx = (!POS_SHIFT || DO_CROSS_ATTENTION) ? tlength : kv_loop_length;
+    // The past keys of the position shift are read from the KV cache without position embedding and rotated here.
+    [[maybe_unused]] bool const rotate_past_keys = POS_SHIFT && !DO_CROSS_ATTENTION && params.position_shift_in_kernel;
 
     // The offset in the Q and K buffer also accounts for the batch.
     auto const qk_vec_idx = tidx * QK_VEC_SIZE;
@@ -1513,13 +1559,16 @@ __global__ void __launch_bounds__(MAX_THEADS_PER_BLOCK, MIN_BLOCKS_PER_SM) maske
     bool const load_qkv_quant = params.qkv_scale_quant_orig != nullptr;
     bool const write_attention_quant = params.attention_out_scale_orig_quant != nullptr;
 
-    // Quant/Dequant scales for 8bits kv cache.
+    // Quant/Dequant scales for 8bits kv cache. The query head of a block reads a single KV head, so per-head scales are
+    // folded into the queries and the logits like per-tensor ones.
     using T_scale = typename kv_cache_scale_type_t<T, Tcache>::Type;
     T_scale kv_scale_orig_quant, k_scale_quant_orig;
-    float const k_scale_quant_orig_f = (ENABLE_8BITS_K_CACHE ? params.kv_scale_quant_orig[0] : 1.0f);
-    float const kv_scale_quant_orig_f = (ENABLE_8BITS_KV_CACHE ? params.kv_scale_quant_orig[0] : 1.0f);
+    auto const kv_scale_idx = params.kv_scale_per_head ? hi_kv : 0;
+    float const k_scale_quant_orig_f = (ENABLE_8BITS_K_CACHE ? params.kv_scale_quant_orig[kv_scale_idx] : 1.0f);
+    float const kv_scale_quant_orig_f = (ENABLE_8BITS_KV_CACHE ? params.kv_scale_quant_orig[kv_scale_idx] : 1.0f);
     convert_from_float(&k_scale_quant_orig, k_scale_quant_orig_f);
-    convert_from_float(&kv_scale_orig_quant, (ENABLE_8BITS_KV_CACHE ? params.kv_scale_orig_quant[0] : 1.0f));
+    convert_from_float(
+        &kv_scale_orig_quant, (ENABLE_8BITS_KV_CACHE ? params.kv_scale_orig_quant[kv_scale_idx] : 1.0f));
 
 #if (defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 900))
     cudaGridDependencySynchronize();
@@ -1814,6 +1863,13 @@ __global__ void __launch_bounds__(MAX_THEADS_PER_BLOCK, MIN_BLOCKS_PER_SM) maske
         relative_attention_bias_ptr = &params.relative_attention_bias[offset];
         relative_attention_bias_ptr_fixed = &params.relative_attention_bias[offset];
     }
+    // The row of the head in the precomputed distance bias, if any.
+    [[maybe_unused]] T const* relative_attention_distance_bias_row = nullptr;
+    if (IMPLICIT_REL_ATTN_BIAS && has_relative_attention_bias && params.relative_attention_distance_bias != nullptr)
+    {
+        relative_attention_distance_bias_row = &params.relative_attention_distance_bias[(int64_t) hi
+            * params.relative_attention_distance_bias_stride];
+    }
 
     // Pre-compute the pointer for the attention mask.
     bool const* attention_mask_ptr = nullptr;
@@ -1942,6 +1998,15 @@ __global__ void __launch_bounds__(MAX_THEADS_PER_BLOCK, MIN_BLOCKS_PER_SM) maske
         linear_bias_slope = mul<float>(params.linear_bias_slopes[hi], 1.f);
     }
 
+    // The rotary base and scale of the past keys, updated by every thread.
+    [[maybe_unused]] float past_k_rotary_base = params.rotary_embedding_base;
+    [[maybe_unused]] float past_k_rotary_scale = params.rotary_embedding_scale;
+    if (rotate_past_keys)
+    {
+        mmha::update_rotary_base_n_scale(past_k_rotary_base, past_k_rotary_scale, params.rotary_embedding_scale_type,
+            params.rotary_embedding_dim, params.rotary_embedding_max_positions, current_pos_idx);
+    }
+
     // Handle only context key cache with beam searching.
     // Handle both context and generation key cache without beam searching.
     // Explicit batching of LDGs (by K_LOOP_UNROLL) as it doesn't depend on indirection tables.
@@ -1963,6 +2028,8 @@ __global__ void __launch_bounds__(MAX_THEADS_PER_BLOCK, MIN_BLOCKS_PER_SM) maske
                 // Seq OOB values will be masked out when storing back to smem.
                 auto const jj = min(k_idx.y + k_vec_i * K_ELTS_PER_CHUNK, Dh - K_VEC_SIZE);
                 int valid_time_now = min(time_now + k_loop * K_PER_ITER, kv_loop_length - 1);
+                // The position of the key in the window.
+                [[maybe_unused]] int const k_position = valid_time_now;
                 // The beam offset is always 0 either when beam_width = 1
                 // or the time_idx < kv_loop_length (all beams share the same context kv cache).
                 int beam_offset
@@ -1985,6 +2052,23 @@ __global__ void __launch_bounds__(MAX_THEADS_PER_BLOCK, MIN_BLOCKS_PER_SM) maske
 
                 int inBlockIdx = pastKCache.getKVLocalIdx(valid_time_now, hi_kv, Dh, jj);
                 k_vec_cache[k_loop][k_vec_i] = *reinterpret_cast<K_vec_m const*>(&k_cache_batch[inBlockIdx]);
+                if constexpr (POS_SHIFT && !DO_CROSS_ATTENTION && !ENABLE_8BITS_K_CACHE)
+                {
+                    if (rotate_past_keys && jj < params.rotary_embedding_dim)
+                    {
+                        K_vec_m k_pair;
+                        if (params.position_embedding_type == PositionEmbeddingType::kROPE_GPT_NEOX)
+                        {
+                            int const half_rotary_dim = params.rotary_embedding_dim / 2;
+                            int const pair_channel = jj < half_rotary_dim ? jj + half_rotary_dim : jj - half_rotary_dim;
+                            k_pair = *reinterpret_cast<K_vec_m const*>(
+                                &k_cache_batch[pastKCache.getKVLocalIdx(valid_time_now, hi_kv, Dh, pair_channel)]);
+                        }
+                        rotate_past_key<T>(k_vec_cache[k_loop][k_vec_i], k_pair, jj, params.position_embedding_type,
+                            params.rotary_embedding_dim, past_k_rotary_base, past_k_rotary_scale,
+                            rotary_embedding_inv_freq_cache, k_position);
+                    }
+                }
             }
         }
 
@@ -2019,15 +2103,25 @@ __global__ void __launch_bounds__(MAX_THEADS_PER_BLOCK, MIN_BLOCKS_PER_SM) maske
                 // (ref: tensorrt_llm/layers/attention.py compute_relative_bias())
                 relative_position = relative_position >= 0 ? 0 : -relative_position;
 
-                int max_exact = num_buckets / 2;
-                bool is_small = relative_position < max_exact;
-                int relative_position_if_large = max_exact
-                    + (int) (logf(relative_position * 1.0f / max_exact) / logf((float) max_distance / max_exact)
-                        * (num_buckets - max_exact));
-                relative_position_if_large = min(relative_position_if_large, num_buckets - 1);
-                relative_buckets += is_small ? relative_position : relative_position_if_large;
-                relative_attention_bias_ptr
-                    = relative_attention_bias_ptr_fixed + (tlength - local_time_now) + relative_buckets;
+                if (relative_attention_distance_bias_row != nullptr
+                    && relative_position < params.relative_attention_distance_bias_stride)
+                {
+                    // The bias of the distance was gathered from the table once, skip the bucket computation.
+                    relative_attention_bias_ptr
+                        = relative_attention_distance_bias_row + relative_position - local_time_now;
+                }
+                else
+                {
+                    int max_exact = num_buckets / 2;
+                    bool is_small = relative_position < max_exact;
+                    int relative_position_if_large = max_exact
+                        + (int) (logf(relative_position * 1.0f / max_exact) / logf((float) max_distance / max_exact)
+                            * (num_buckets - max_exact));
+                    relative_position_if_large = min(relative_position_if_large, num_buckets - 1);
+                    relative_buckets += is_small ? relative_position : relative_position_if_large;
+                    relative_attention_bias_ptr
+                        = relative_attention_bias_ptr_fixed + (tlength - local_time_now) + relative_buckets;
+                }
             }
 
             // Prefetch the relative attention bias.
@@ -2241,6 +2335,14 @@ __global__ void __launch_bounds__(MAX_THEADS_PER_BLOCK, MIN_BLOCKS_PER_SM) maske
 #endif // MMHA_FP8_SCALE_P_INSTEAD_OF_V
     float inv_sum = __fdividef(logit_scale, sum + 1.e-6f);
 
+    // Attention mass of the cached tokens, summed over the heads.
+    float* attention_mass_row = nullptr;
+    if (!MULTI_BLOCK_FLAG && params.attention_mass != nullptr)
+    {
+        auto const row = params.attention_mass_rows != nullptr ? params.attention_mass_rows[batch_idx] : batch_beam_idx;
+        attention_mass_row = params.attention_mass + static_cast<size_t>(row) * params.max_attention_window_size;
+    }
+
     int const normlization_loop_end = MULTI_BLOCK_FLAG ? timesteps_per_block : kv_loop_length;
     for (int ti = tidx; ti <= normlization_loop_end; ti += THREADS_PER_BLOCK)
     {
@@ -2249,6 +2351,10 @@ __global__ void __launch_bounds__(MAX_THEADS_PER_BLOCK, MIN_BLOCKS_PER_SM) maske
         if (!MULTI_BLOCK_FLAG)
         {
             convert_from_float(&logits_smem[ti], qk_smem[ti] * inv_sum);
+            if (attention_mass_row != nullptr && ti < kv_loop_length)
+            {
+                atomicAdd(&attention_mass_row[ti], __fdividef(qk_smem[ti], sum + 1.e-6f));
+            }
         }
         else
         {
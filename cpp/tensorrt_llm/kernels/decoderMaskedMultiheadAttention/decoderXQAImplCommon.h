@@ -22,11 +22,13 @@
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/common/workspace.h"
+#include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention/multiBlockTuner.h"
 #include "tensorrt_llm/kernels/kvCacheUtils.h"
 #include "tensorrt_llm/kernels/multiHeadAttentionCommon.h"
 #include "xqaParams.h"
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <utility>
 
 namespace tensorrt_llm
@@ -366,5 +368,24 @@ inline int computeMultiBlockCount(XQAParams const& xqaParams, int batch_size, in
     return multi_block_count;
 }
 
+// Multi-block count of a launch: the one of computeMultiBlockCount, or the one selected by MultiBlockTuner if it is
+// enabled. In the latter case tunerKey is set and MultiBlockTuner::finish must be called after the launch.
+inline int selectMultiBlockCount(XQAParams const& xqaParams, int batch_size, int multiprocessor_count,
+    cudaStream_t stream, std::optional<MultiBlockTuner::Key>& tunerKey)
+{
+    auto const heuristic = computeMultiBlockCount(xqaParams, batch_size, multiprocessor_count);
+    if (!MultiBlockTuner::isEnabled() || tensorrt_llm::common::getEnvXqaBlocksPerSequence().has_value())
+    {
+        return heuristic;
+    }
+    // The same workspace limit as the heuristic, and at least kMinHistoryTokensPerBlock / 2 tokens per block.
+    auto const maxCount = std::max(std::min(kXQA_MAX_NUM_SUB_SEQ / batch_size,
+                                       divUp(xqaParams.max_past_kv_length, kMinHistoryTokensPerBlock / 2)),
+        1);
+    tunerKey = MultiBlockTuner::makeKey(MultiBlockTuner::Kernel::kXQA, batch_size, xqaParams.max_past_kv_length,
+        xqaParams.num_q_heads, xqaParams.num_kv_heads, xqaParams.head_size);
+    return MultiBlockTuner::getInstance().select(*tunerKey, heuristic, 1, maxCount, stream);
+}
+
 } // namespace kernels
 } // namespace tensorrt_llm
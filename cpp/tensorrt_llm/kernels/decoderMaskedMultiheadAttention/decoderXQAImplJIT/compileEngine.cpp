@@ -15,9 +15,11 @@
  */
 #include "compileEngine.h"
 
+#include "cubinDiskCache.h"
 #include "cubinObj.h"
 #include "nvrtcWrapper/include/nvrtcWrapper.h"
 #include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/startupTrace.h"
 #include "tensorrt_llm/common/stringUtils.h"
 #include "tensorrt_llm/common/tllmException.h"
 #include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention/decoderXQAImplJIT/kernelUtils.h"
@@ -51,6 +53,7 @@ namespace jit
 
 CubinObj CompileEngine::compile() const
 {
+    TLLM_STARTUP_PHASE("xqa_jit_compile");
     tllmXqaJitProgram program;
     bool useQGMMAKernel = supportConfigQGMMA(mXqaParams, mSM, true);
     tllmXqaJitRopeStyle ropeStyle = tllmXqaJitRopeStyle::TLLM_XQA_JIT_ROPE_NONE;
@@ -79,6 +82,12 @@ CubinObj CompileEngine::compile() const
         /*use_input_kv=*/useQGMMAKernel,
         /*rope_style=*/ropeStyle};
 
+    auto const& diskCache = CubinDiskCache::getInstance();
+    if (auto cubin = diskCache.load(context))
+    {
+        return CubinObj(*cubin);
+    }
+
     CHECK_TLLM_XQA_JIT_ERROR(tllmXqaJitCreateAndCompileProgram(&program, &context));
 
     size_t cubinSize;
@@ -88,6 +97,7 @@ CubinObj CompileEngine::compile() const
 
     CHECK_TLLM_XQA_JIT_ERROR(tllmXqaJitDestroyProgram(&program));
 
+    diskCache.store(context, cubinContent);
     return CubinObj(cubinContent);
 }
 
@@ -97,6 +107,23 @@ CompileEngine::CompileEngine(int SM, XQAParams const& xqaParams)
 {
 }
 
+int prewarmCubinDiskCache(int SM, XQAParams const& umbrellaXQAParams)
+{
+    TLLM_CHECK_WITH_INFO(CubinDiskCache::getInstance().isEnabled(), "TRTLLM_XQA_JIT_CACHE_DIR is not set");
+    int numCubins = 0;
+    for (int beamWidth = 1; beamWidth <= umbrellaXQAParams.beam_width; ++beamWidth)
+    {
+        XQAParams xqaParams = umbrellaXQAParams;
+        xqaParams.beam_width = beamWidth;
+        if (supportConfigQGMMA(xqaParams, SM, true) || supportConfigHMMA(xqaParams, SM, true))
+        {
+            CompileEngine(SM, xqaParams).compile();
+            ++numCubins;
+        }
+    }
+    return numCubins;
+}
+
 } // namespace jit
 } // namespace kernels
 } // namespace tensorrt_llm
@@ -42,6 +42,11 @@ private:
     XQAParams const& mXqaParams;
 };
 
+// Compiles the kernels that DecoderXQAImplJIT::prepare would for the umbrella params, i.e. of every beam width up to
+// umbrellaXQAParams.beam_width, into the cubin disk cache without loading them. Run offline with the params of the
+// attention layers of an engine so that its processes start without compiling. Returns the number of cubins.
+int prewarmCubinDiskCache(int SM, XQAParams const& umbrellaXQAParams);
+
 } // namespace jit
 } // namespace kernels
 } // namespace tensorrt_llm
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "cubinDiskCache.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/stringUtils.h"
+
+#include <cuda.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+namespace jit
+{
+
+namespace
+{
+
+uint32_t constexpr kMagic = 0x4a415158; // "XQAJ"
+// Bump when the JIT sources change the generated code for the same context.
+uint32_t constexpr kFormatVersion = 1;
+
+} // namespace
+
+CubinDiskCache const& CubinDiskCache::getInstance()
+{
+    static CubinDiskCache const cache{tensorrt_llm::common::getEnvXqaJitCacheDir()};
+    return cache;
+}
+
+CubinDiskCache::CubinDiskCache(std::string dir)
+    : mDir(std::move(dir))
+{
+    if (mDir.empty())
+    {
+        return;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(mDir, error);
+    if (error)
+    {
+        TLLM_LOG_WARNING("Cannot create the XQA JIT cache directory %s (%s), the cache is disabled.", mDir.c_str(),
+            error.message().c_str());
+        mDir.clear();
+    }
+}
+
+std::vector<uint32_t> CubinDiskCache::getKeyFields(tllmXqaJitContext const& context)
+{
+    return {static_cast<uint32_t>(context.sm), context.head_size, context.num_q_heads, context.num_kv_heads,
+        context.beam_width, context.tokens_per_block, context.multi_query_tokens, context.paged_kv_cache,
+        static_cast<uint32_t>(context.data_type), static_cast<uint32_t>(context.kv_cache_data_type),
+        static_cast<uint32_t>(context.kernel_type), context.fp8_output, context.use_input_kv,
+        static_cast<uint32_t>(context.rope_style), static_cast<uint32_t>(CUDA_VERSION), kFormatVersion};
+}
+
+std::string CubinDiskCache::getPath(tllmXqaJitContext const& context) const
+{
+    // FNV-1a of the key fields, collisions are caught by the check of the fields on load.
+    uint64_t hash = 14695981039346656037ull;
+    for (auto const field : getKeyFields(context))
+    {
+        hash = (hash ^ field) * 1099511628211ull;
+    }
+    auto const name = tensorrt_llm::common::fmtstr("xqa_sm%d_%016llx.cubin", context.sm,
+        static_cast<unsigned long long>(hash));
+    return (std::filesystem::path{mDir} / name).string();
+}
+
+std::optional<std::string> CubinDiskCache::load(tllmXqaJitContext const& context) const
+{
+    if (!isEnabled())
+    {
+        return std::nullopt;
+    }
+    std::ifstream file(getPath(context), std::ios::binary);
+    if (!file)
+    {
+        return std::nullopt;
+    }
+    auto readU32 = [&file]()
+    {
+        uint32_t value{0};
+        file.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    };
+    if (readU32() != kMagic)
+    {
+        return std::nullopt;
+    }
+    auto const fields = getKeyFields(context);
+    if (readU32() != fields.size())
+    {
+        return std::nullopt;
+    }
+    for (auto const field : fields)
+    {
+        if (readU32() != field)
+        {
+            return std::nullopt;
+        }
+    }
+    uint64_t size{0};
+    file.read(reinterpret_cast<char*>(&size), sizeof(size));
+    std::string cubin(size, '\0');
+    file.read(cubin.data(), static_cast<std::streamsize>(size));
+    if (!file || size == 0)
+    {
+        TLLM_LOG_WARNING("Ignoring the truncated XQA JIT cache file %s.", getPath(context).c_str());
+        return std::nullopt;
+    }
+    TLLM_LOG_DEBUG("Loaded the XQA JIT cubin %s.", getPath(context).c_str());
+    return cubin;
+}
+
+void CubinDiskCache::store(tllmXqaJitContext const& context, std::string const& cubin) const
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+    auto const path = getPath(context);
+    auto const tmpPath = tensorrt_llm::common::fmtstr("%s.tmp.%d.%zu", path.c_str(), static_cast<int>(getpid()),
+        std::hash<std::thread::id>{}(std::this_thread::get_id()));
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        auto writeU32 = [&file](uint32_t value) { file.write(reinterpret_cast<char const*>(&value), sizeof(value)); };
+        auto const fields = getKeyFields(context);
+        writeU32(kMagic);
+        writeU32(static_cast<uint32_t>(fields.size()));
+        for (auto const field : fields)
+        {
+            writeU32(field);
+        }
+        uint64_t const size = cubin.size();
+        file.write(reinterpret_cast<char const*>(&size), sizeof(size));
+        file.write(cubin.data(), static_cast<std::streamsize>(size));
+        if (!file)
+        {
+            TLLM_LOG_WARNING("Cannot write the XQA JIT cache file %s.", tmpPath.c_str());
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(tmpPath, error);
+            return;
+        }
+    }
+    // Readers see either no file or a complete one. A concurrent writer of the same context writes the same cubin.
+    std::error_code error;
+    std::filesystem::rename(tmpPath, path, error);
+    if (error)
+    {
+        TLLM_LOG_WARNING("Cannot write the XQA JIT cache file %s (%s).", path.c_str(), error.message().c_str());
+        std::filesystem::remove(tmpPath, error);
+    }
+}
+
+} // namespace jit
+} // namespace kernels
+} // namespace tensorrt_llm
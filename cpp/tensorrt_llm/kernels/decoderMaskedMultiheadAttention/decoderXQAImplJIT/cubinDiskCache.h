@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "nvrtcWrapper/include/nvrtcWrapper.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+namespace jit
+{
+
+// Cubins compiled by NVRTC, stored in the directory of TRTLLM_XQA_JIT_CACHE_DIR so that later processes skip the
+// compilation. A file holds one cubin and the full compile context it was built for, including the SM version and the
+// CUDA version, and is verified on load. Files are written to a temporary name and renamed, so processes of a node can
+// share the directory.
+class CubinDiskCache
+{
+public:
+    static CubinDiskCache const& getInstance();
+
+    [[nodiscard]] bool isEnabled() const
+    {
+        return !mDir.empty();
+    }
+
+    // Cubin of the context, if it was stored before.
+    [[nodiscard]] std::optional<std::string> load(tllmXqaJitContext const& context) const;
+
+    // Never throws: a failure to write only costs a compilation in a later process.
+    void store(tllmXqaJitContext const& context, std::string const& cubin) const;
+
+    [[nodiscard]] std::string getPath(tllmXqaJitContext const& context) const;
+
+private:
+    explicit CubinDiskCache(std::string dir);
+
+    // Every field of the context that changes the generated code, followed by the versions of the toolchain.
+    [[nodiscard]] static std::vector<uint32_t> getKeyFields(tllmXqaJitContext const& context);
+
+    std::string mDir;
+};
+
+} // namespace jit
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -313,14 +313,20 @@ void DecoderXQAImplJIT::runImpl(XQAParams const& xqaParams, KVCacheBuffer const&
     appendParam(&launchParams.scratch);
     kernelParams[idxNextParam] = nullptr; // one extra nullptr at end as guard.
     int multi_block = 1;
+    std::optional<MultiBlockTuner::Key> multiBlockTunerKey;
     if (xqaParams.multi_block_mode)
     {
-        multi_block = computeMultiBlockCount(xqaParams, xqaParams.batch_size, multiprocessor_count);
+        multi_block = selectMultiBlockCount(
+            xqaParams, xqaParams.batch_size, multiprocessor_count, stream, multiBlockTunerKey);
     }
 
     dim3 gridDim(multi_block, xqaParams.num_kv_heads, xqaParams.batch_size);
     dim3 blockDim(128, 1, isGMMAKernel ? 3 : 2);
     cubinObj->launch(gridDim, blockDim, stream, kernelParams);
+    if (multiBlockTunerKey)
+    {
+        MultiBlockTuner::getInstance().finish(*multiBlockTunerKey, stream);
+    }
     sync_check_cuda_error();
 
     if (needOutputCvt)
@@ -63,8 +63,9 @@ public:
             if (kernelMeta.mSM != mSM || kernelMeta.mDataType != mDataType)
                 continue;
 
-            // Cubins for kernels that would take the JIT path are removed from kernelMeta.
-            if (kernelMeta.mCubin == nullptr)
+            // Cubins for kernels that would take the JIT path are removed from kernelMeta, and the cubins left out by
+            // XQA_CUBIN_CONFIGS at build time are empty.
+            if (kernelMeta.mCubin == nullptr || kernelMeta.mCubinSize == 0)
                 continue;
 
             CUmodule hmod{0};
@@ -253,15 +254,21 @@ public:
                 &launchParams.output, &xqa_q_input_ptr, &maskPtr, &launchParams.kvCacheParams, &launchParams.batch_size,
                 &launchParams.kv_scale_quant_orig, &launchParams.scratch};
             int multi_block = 1;
+            std::optional<MultiBlockTuner::Key> multiBlockTunerKey;
             if (xqaParams.multi_block_mode)
             {
-                multi_block = computeMultiBlockCount(xqaParams, xqaParams.batch_size, multiprocessor_count);
+                multi_block = selectMultiBlockCount(
+                    xqaParams, xqaParams.batch_size, multiprocessor_count, stream, multiBlockTunerKey);
                 check_cuda_error(cudaMemsetAsync(xqaParams.workspaces, 0,
                     sizeof(int) * xqaParams.batch_size * qSeqLen * xqaParams.num_kv_heads, stream));
                 sync_check_cuda_error();
             }
             TLLM_CU_CHECK(mDriver->cuLaunchKernel(func, multi_block, xqaParams.num_kv_heads * nbTokenBlocksPerGrp,
                 xqaParams.batch_size, 128, 1, 2, shared_mem_bytes, stream, kernelParams, nullptr));
+            if (multiBlockTunerKey)
+            {
+                MultiBlockTuner::getInstance().finish(*multiBlockTunerKey, stream);
+            }
         }
         else
         {
@@ -298,12 +305,18 @@ public:
             appendParam(&launchParams.scratch);
             kernelParams[idxNextParam] = nullptr; // one extra nullptr at end as guard.
             int multi_block = 1;
+            std::optional<MultiBlockTuner::Key> multiBlockTunerKey;
             if (xqaParams.multi_block_mode)
             {
-                multi_block = computeMultiBlockCount(xqaParams, xqaParams.batch_size, multiprocessor_count);
+                multi_block = selectMultiBlockCount(
+                    xqaParams, xqaParams.batch_size, multiprocessor_count, stream, multiBlockTunerKey);
             }
             TLLM_CU_CHECK(mDriver->cuLaunchKernel(func, multi_block, xqaParams.num_kv_heads, xqaParams.batch_size, 128,
                 1, isGmmaKernel ? 3 : 2, shared_mem_bytes, stream, kernelParams, nullptr));
+            if (multiBlockTunerKey)
+            {
+                MultiBlockTuner::getInstance().finish(*multiBlockTunerKey, stream);
+            }
         }
 
         sync_check_cuda_error();
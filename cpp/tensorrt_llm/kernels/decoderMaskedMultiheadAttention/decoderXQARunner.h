@@ -83,6 +83,14 @@ public:
      */
     bool shouldUse(XQAParams const& xqaParams, bool forConfigurePlugin);
 
+    /**
+     * \return whether enqueueGeneration runs the JIT compiled kernels for xqaParams, rather than the precompiled ones.
+     */
+    bool isJitImpl(XQAParams const& xqaParams)
+    {
+        return getImplFromXQAParams(xqaParams, false) == mJITImpl.get();
+    }
+
     void prepare(XQAParams const& xqa_params)
     {
         this->prepareForRun(xqa_params);
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention/multiBlockTuner.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+bool MultiBlockTuner::isEnabled()
+{
+    return common::getEnvMultiBlockAutotune();
+}
+
+MultiBlockTuner& MultiBlockTuner::getInstance()
+{
+    static MultiBlockTuner tuner;
+    return tuner;
+}
+
+MultiBlockTuner::Key MultiBlockTuner::makeKey(
+    Kernel kernel, int32_t batchSize, int32_t seqLen, int32_t numHeads, int32_t numKvHeads, int32_t headSize)
+{
+    int32_t seqLenBucket = kMinSeqLenBucket;
+    while (seqLenBucket < seqLen && seqLenBucket <= std::numeric_limits<int32_t>::max() / 2)
+    {
+        seqLenBucket *= 2;
+    }
+    return Key{kernel, common::getDevice(), batchSize, seqLenBucket, numHeads, numKvHeads, headSize};
+}
+
+bool MultiBlockTuner::collect(ShapeState& state)
+{
+    if (state.pending < 0)
+    {
+        return true;
+    }
+    if (!state.pendingFinished || cudaEventQuery(state.stop) != cudaSuccess)
+    {
+        // cudaEventQuery returns cudaErrorNotReady while the launch is in flight, which is not an error.
+        cudaGetLastError();
+        return false;
+    }
+    float timeMs{0.f};
+    common::check_cuda_error(cudaEventElapsedTime(&timeMs, state.start, state.stop));
+    auto const idx = state.pending;
+    if (state.numSamples[idx] > 0)
+    {
+        state.totalTimeMs[idx] += timeMs;
+    }
+    ++state.numSamples[idx];
+    state.pending = -1;
+    state.pendingFinished = false;
+    return true;
+}
+
+void MultiBlockTuner::decide(Key const& key, ShapeState& state)
+{
+    size_t best = 0;
+    for (size_t ci = 1; ci < state.candidates.size(); ++ci)
+    {
+        if (state.totalTimeMs[ci] < state.totalTimeMs[best])
+        {
+            best = ci;
+        }
+    }
+    state.tuned = state.candidates[best];
+    TLLM_LOG_INFO(
+        "%s multi-block tuned for batch %d, KV length bucket %d, heads %d/%d, head size %d: %d blocks per sequence "
+        "(%.3f ms)",
+        key.kernel == Kernel::kMMHA ? "MMHA" : "XQA", key.batchSize, key.seqLenBucket, key.numHeads, key.numKvHeads,
+        key.headSize, state.tuned, state.totalTimeMs[best] / (kSamplesPerCandidate - 1));
+    common::check_cuda_error(cudaEventDestroy(state.start));
+    common::check_cuda_error(cudaEventDestroy(state.stop));
+    state.start = nullptr;
+    state.stop = nullptr;
+}
+
+int32_t MultiBlockTuner::select(
+    Key const& key, int32_t heuristic, int32_t minBlocks, int32_t maxBlocks, cudaStream_t stream)
+{
+    maxBlocks = std::max(maxBlocks, minBlocks);
+    heuristic = std::clamp(heuristic, minBlocks, maxBlocks);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto [it, inserted] = mShapes.try_emplace(key);
+    auto& state = it->second;
+    if (state.tuned > 0)
+    {
+        return std::clamp(state.tuned, minBlocks, maxBlocks);
+    }
+    if (inserted)
+    {
+        // Powers of 2 in the range, the heuristic and the upper bound.
+        for (int32_t count = 1; count <= maxBlocks; count *= 2)
+        {
+            if (count >= minBlocks)
+            {
+                state.candidates.push_back(count);
+            }
+        }
+        state.candidates.push_back(heuristic);
+        state.candidates.push_back(maxBlocks);
+        std::sort(state.candidates.begin(), state.candidates.end());
+        state.candidates.erase(
+            std::unique(state.candidates.begin(), state.candidates.end()), state.candidates.end());
+        state.numSamples.assign(state.candidates.size(), 0);
+        state.totalTimeMs.assign(state.candidates.size(), 0.f);
+        common::check_cuda_error(cudaEventCreate(&state.start));
+        common::check_cuda_error(cudaEventCreate(&state.stop));
+    }
+    if (!collect(state))
+    {
+        return heuristic;
+    }
+
+    auto const next = std::min_element(state.numSamples.begin(), state.numSamples.end()) - state.numSamples.begin();
+    if (state.numSamples[next] >= kSamplesPerCandidate)
+    {
+        decide(key, state);
+        return std::clamp(state.tuned, minBlocks, maxBlocks);
+    }
+    state.pending = static_cast<int32_t>(next);
+    common::check_cuda_error(cudaEventRecord(state.start, stream));
+    return state.candidates[next];
+}
+
+void MultiBlockTuner::finish(Key const& key, cudaStream_t stream)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mShapes.find(key);
+    if (it == mShapes.end() || it->second.pending < 0 || it->second.pendingFinished)
+    {
+        return;
+    }
+    common::check_cuda_error(cudaEventRecord(it->second.stop, stream));
+    it->second.pendingFinished = true;
+}
+
+int32_t MultiBlockTuner::getTuned(Key const& key) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mShapes.find(key);
+    return it == mShapes.end() ? 0 : it->second.tuned;
+}
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cuda_runtime_api.h>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+//! \brief Online tuner of the number of blocks per sequence of the multi-block (split-KV) generation attention.
+//! \details The first launches of every shape (kernel, batch size, bucket of the KV length, heads and head size) try
+//! the candidate counts in turn and time them with events on the launch stream. The events are read without
+//! synchronization at the next launches of the shape, so launches are never slowed down beyond the candidate they run.
+//! Once every candidate has been timed kSamplesPerCandidate times, the fastest one is cached and used for the shape
+//! from then on. Enabled by TRTLLM_MULTI_BLOCK_AUTOTUNE; TRTLLM_MMHA_BLOCKS_PER_SEQUENCE (with the multi-block debug
+//! flag) and TRTLLM_XQA_BLOCKS_PER_SEQUENCE still take precedence.
+class MultiBlockTuner
+{
+public:
+    enum class Kernel : int32_t
+    {
+        kMMHA = 0,
+        kXQA = 1,
+    };
+
+    struct Key
+    {
+        Kernel kernel;
+        int32_t device;
+        int32_t batchSize;
+        //! \brief Smallest power of 2, at least kMinSeqLenBucket, that is not below the KV length.
+        int32_t seqLenBucket;
+        int32_t numHeads;
+        int32_t numKvHeads;
+        int32_t headSize;
+
+        bool operator==(Key const& other) const
+        {
+            return kernel == other.kernel && device == other.device && batchSize == other.batchSize
+                && seqLenBucket == other.seqLenBucket && numHeads == other.numHeads && numKvHeads == other.numKvHeads
+                && headSize == other.headSize;
+        }
+    };
+
+    static int32_t constexpr kMinSeqLenBucket = 256;
+    //! \brief Timed launches per candidate. The first one of each is dropped since it may include the setup of the
+    //! kernel.
+    static int32_t constexpr kSamplesPerCandidate = 4;
+
+    [[nodiscard]] static bool isEnabled();
+
+    static MultiBlockTuner& getInstance();
+
+    [[nodiscard]] static Key makeKey(
+        Kernel kernel, int32_t batchSize, int32_t seqLen, int32_t numHeads, int32_t numKvHeads, int32_t headSize);
+
+    //! \brief Number of blocks per sequence of a launch of the shape, within [minBlocks, maxBlocks]. When a candidate
+    //! is being timed, the start event is recorded on stream and the caller must call finish after the launch.
+    //! \param heuristic Count of the static heuristic, which is one of the candidates and used while no other is free.
+    int32_t select(Key const& key, int32_t heuristic, int32_t minBlocks, int32_t maxBlocks, cudaStream_t stream);
+
+    //! \brief Record the end of the timed launch of the shape, if select started one.
+    void finish(Key const& key, cudaStream_t stream);
+
+    //! \brief Fastest count of the shape, or 0 if it is not tuned yet.
+    [[nodiscard]] int32_t getTuned(Key const& key) const;
+
+private:
+    struct KeyHasher
+    {
+        size_t operator()(Key const& key) const
+        {
+            size_t hash = std::hash<int32_t>{}(static_cast<int32_t>(key.kernel));
+            for (auto const value :
+                {key.device, key.batchSize, key.seqLenBucket, key.numHeads, key.numKvHeads, key.headSize})
+            {
+                hash ^= std::hash<int32_t>{}(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            }
+            return hash;
+        }
+    };
+
+    struct ShapeState
+    {
+        std::vector<int32_t> candidates;
+        std::vector<int32_t> numSamples;
+        std::vector<float> totalTimeMs;
+        int32_t tuned{0};
+        // Candidate of the launch being timed, -1 if none.
+        int32_t pending{-1};
+        bool pendingFinished{false};
+        cudaEvent_t start{nullptr};
+        cudaEvent_t stop{nullptr};
+    };
+
+    // Not destroyed before exit, when the CUDA context may already be gone: the events of untuned shapes are kept.
+    MultiBlockTuner() = default;
+
+    //! \brief Add the time of the pending launch if its events completed. Returns false while it is in flight.
+    static bool collect(ShapeState& state);
+
+    static void decide(Key const& key, ShapeState& state);
+
+    mutable std::mutex mMutex;
+    std::unordered_map<Key, ShapeState, KeyHasher> mShapes;
+};
+
+} // namespace kernels
+} // namespace tensorrt_llm
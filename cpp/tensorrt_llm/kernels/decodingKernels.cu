@@ -18,6 +18,7 @@
 #include "tensorrt_llm/common/cudaTypeUtils.cuh"
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/common/memoryUtils.h"
+#include "tensorrt_llm/common/pdlUtils.cuh"
 #include "tensorrt_llm/common/reduceKernelUtils.cuh"
 #include "tensorrt_llm/kernels/decodingKernels.h"
 #ifndef CUDART_VERSION
@@ -329,19 +330,22 @@ __global__ void insertUnfinishedPathKernel(BeamHypotheses bh)
     // update bh.normedScoresCBA
     // update bh.numBeamsCBA
 
-    size_t const bid = blockIdx.x;       // Index of Batch
+    size_t const batchIdx = blockIdx.x;  // Index of Batch, for the per request parameters
+    // Index of the request in the buffers, only differs from batchIdx when the requests are gathered by batchSlots
+    size_t const bid = (bh.batchSlots != nullptr) ? bh.batchSlots[batchIdx] : batchIdx;
     size_t const nBM{bh.nBeamWidth};
     size_t const nMBS{bh.nMaxBatchSize}; // Only for bh.logProbsTiled
     size_t const nMSL{bh.nMaxSeqLen};
     bool const bOutputLogProbs{bh.logProbsCBA != nullptr && bh.logProbsTiled != nullptr};
     int const indexDstStart{bh.numBeamsCBA[bid]};
+    int const nBMSlot = (bh.beamWidths != nullptr) ? bh.beamWidths[batchIdx] : nBM;
 
     if (bh.batchDones[bid])
     {
         return;
     }
 
-    for (int i = 0; i < nBM; ++i)
+    for (int i = 0; i < nBMSlot; ++i)
     {
         int const srcBeam = bid * nBM + i;
         int const dstBeam = bid * nBM * 2 + i + indexDstStart;
@@ -375,8 +379,8 @@ __global__ void insertUnfinishedPathKernel(BeamHypotheses bh)
         }
         // Other parameters
         bh.sequenceLengthsCBA[dstBeam] = bh.sequenceLengths[srcBeam];
-        bh.normedScoresCBA[dstBeam]
-            = applyLengthPenalty(bh.cumLogProbs[srcBeam], step - bh.inputLengths[srcBeam] + 1, bh.lengthPenalties[bid]);
+        bh.normedScoresCBA[dstBeam] = applyLengthPenalty(
+            bh.cumLogProbs[srcBeam], step - bh.inputLengths[srcBeam] + 1, bh.lengthPenalties[batchIdx]);
         bh.cumLogProbsCBA[dstBeam] = bh.cumLogProbs[srcBeam];
         bh.numBeamsCBA[bid]++;
     }
@@ -396,11 +400,15 @@ __global__ void finalizeKernel(BeamHypotheses bh)
     // bh.cumLogProbsCBA     -> bh.cumLogProbs
     // bh.logProbsCBA        -> bh.logProbs
 
-    int const bid = blockIdx.x;  // Index of Batch
-    int const tid = threadIdx.x; // Index of Beam
+    int const batchIdx = blockIdx.x; // Index of Batch, for the per request parameters
+    // Index of the request in the buffers, only differs from batchIdx when the requests are gathered by batchSlots
+    int const bid = (bh.batchSlots != nullptr) ? bh.batchSlots[batchIdx] : batchIdx;
+    int const tid = threadIdx.x;     // Index of Beam
     size_t const nBM{bh.nBeamWidth};
     size_t const nMSL{bh.nMaxSeqLen};
     int const nCBA{bh.numBeamsCBA[bid]}; // Count of candidates in CBA, nBM <= nCBA <= 2*nBM
+    // Only the beam width of the request is written, the padding beams keep the end ids of the prefilled output
+    int const nBMSlot = (bh.beamWidths != nullptr) ? bh.beamWidths[batchIdx] : nBM;
 
     extern __shared__ char smem[];
     int* smemRank = (int*) (smem);                // [nBM]
@@ -450,7 +458,7 @@ __global__ void finalizeKernel(BeamHypotheses bh)
             rankNorm = swap(rankNorm, 0x02, bfe(laneid, 5) ^ bfe(laneid, 1));
             rankNorm = swap(rankNorm, 0x01, bfe(laneid, 5) ^ bfe(laneid, 0));
         }
-        if (tid < nBM)
+        if (tid < nBMSlot)
         {
             smemRank[tid] = rankNorm.rank;
         }
@@ -459,7 +467,7 @@ __global__ void finalizeKernel(BeamHypotheses bh)
     else
     {
         // TODO, wili: use CUB to sort for large nCBA
-        for (int i = 0; i < nBM; ++i)
+        for (int i = 0; i < nBMSlot; ++i)
         {
             float maxScore = -FLT_MAX;
             for (int j = 0; j < (nCBA + 1024 - 1) / 1024; ++j)
@@ -486,7 +494,7 @@ __global__ void finalizeKernel(BeamHypotheses bh)
     }
 
     // Move bh.sequenceLengths, bh.cumLogProbs
-    if (tid < nBM)
+    if (tid < nBMSlot)
     {
         smemSL[tid] = bh.sequenceLengthsCBA[bid * nBM * 2 + smemRank[tid]];
         bh.sequenceLengths[bid * nBM + tid] = smemSL[tid];
@@ -498,7 +506,7 @@ __global__ void finalizeKernel(BeamHypotheses bh)
     __syncthreads();
 
     // Move bh.outputIds, bh.logProbs
-    for (int beamIdx = 0; beamIdx < nBM; beamIdx++)
+    for (int beamIdx = 0; beamIdx < nBMSlot; beamIdx++)
     {
         for (int i = tid; i < smemSL[beamIdx]; i += blockDim.x)
         {
@@ -629,19 +637,56 @@ void invokeCopyBeamHypotheses(DecodingOutput::BeamHypotheses const& src, Decodin
     copyBeamHypotheses<<<numSMs, 256, 0, stream.get()>>>(copyStruct);
 }
 
-__global__ void initializeOutput(
-    TokenIdType* finalOutputIds, TokenIdType const* endIds, SizeType32 const beam, SizeType32 const nMaxSeqLen)
+__global__ void initializeOutput(TokenIdType* finalOutputIds, TokenIdType const* endIds, SizeType32 const* batchSlots,
+    SizeType32 const beam, SizeType32 const nMaxSeqLen)
 {
+    auto const batchIdx = static_cast<SizeType32>(blockIdx.x) / beam;
+    auto const batchSlot = (batchSlots != nullptr) ? batchSlots[batchIdx] : batchIdx;
+    auto const batchBeamIdx = batchSlot * beam + static_cast<SizeType32>(blockIdx.x) % beam;
     for (int i = threadIdx.x; i < nMaxSeqLen; i += blockDim.x)
     {
-        finalOutputIds[blockIdx.x * nMaxSeqLen + i] = endIds[blockIdx.x / beam];
+        finalOutputIds[batchBeamIdx * nMaxSeqLen + i] = endIds[batchSlot];
     }
 }
 
 void invokeInitializeOutput(TokenIdType* finalOutputIds, TokenIdType const* endIds, SizeType32 const batch,
-    SizeType32 const beam, SizeType32 const nMaxSeqLen, cudaStream_t stream)
+    SizeType32 const beam, SizeType32 const nMaxSeqLen, cudaStream_t stream, SizeType32 const* batchSlots)
 {
-    initializeOutput<<<batch * beam, 256, 0, stream>>>(finalOutputIds, endIds, beam, nMaxSeqLen);
+    initializeOutput<<<batch * beam, 256, 0, stream>>>(finalOutputIds, endIds, batchSlots, beam, nMaxSeqLen);
+}
+
+__global__ void copyFinalizedBeams(TokenIdType* dstOutputIds, SizeType32* dstSequenceLengths, float* dstCumLogProbs,
+    TokenIdType const* srcOutputIds, SizeType32 const* srcSequenceLengths, float const* srcCumLogProbs,
+    SizeType32 const* batchSlots, SizeType32 beamWidth, SizeType32 maxSeqLen)
+{
+    auto const batchIdx = static_cast<SizeType32>(blockIdx.x) / beamWidth;
+    auto const beamIdx = static_cast<SizeType32>(blockIdx.x) % beamWidth;
+    auto const srcBatchBeamIdx = batchSlots[batchIdx] * beamWidth + beamIdx;
+    auto const dstBatchBeamIdx = batchIdx * beamWidth + beamIdx;
+    auto const sequenceLength = srcSequenceLengths[srcBatchBeamIdx];
+
+    // Only the tokens of the beam are copied, the rest of the row of the destination is not written
+    for (auto i = static_cast<SizeType32>(threadIdx.x); i < sequenceLength; i += static_cast<SizeType32>(blockDim.x))
+    {
+        dstOutputIds[dstBatchBeamIdx * maxSeqLen + i] = srcOutputIds[srcBatchBeamIdx * maxSeqLen + i];
+    }
+    if (threadIdx.x == 0)
+    {
+        dstSequenceLengths[dstBatchBeamIdx] = sequenceLength;
+        if (dstCumLogProbs != nullptr)
+        {
+            dstCumLogProbs[dstBatchBeamIdx] = srcCumLogProbs[srcBatchBeamIdx];
+        }
+    }
+}
+
+void invokeCopyFinalizedBeams(TokenIdType* dstOutputIds, SizeType32* dstSequenceLengths, float* dstCumLogProbs,
+    TokenIdType const* srcOutputIds, SizeType32 const* srcSequenceLengths, float const* srcCumLogProbs,
+    SizeType32 const* batchSlots, SizeType32 batchSize, SizeType32 beamWidth, SizeType32 maxSeqLen,
+    cudaStream_t stream)
+{
+    copyFinalizedBeams<<<batchSize * beamWidth, 256, 0, stream>>>(dstOutputIds, dstSequenceLengths, dstCumLogProbs,
+        srcOutputIds, srcSequenceLengths, srcCumLogProbs, batchSlots, beamWidth, maxSeqLen);
 }
 
 __global__ void copyNextStepIds(TokenIdType* nextStepIds, TokenIdType const* const* outputIdsPtr,
@@ -649,6 +694,9 @@ __global__ void copyNextStepIds(TokenIdType* nextStepIds, TokenIdType const* con
     SizeType32 batchSize, SizeType32 maxBatchSize, SizeType32 beamWidth, SizeType32 maxSeqLen,
     SizeType32 maxTokensPerStep)
 {
+    pdlWaitPrimaryGrid();
+    pdlLaunchDependents();
+
     for (auto index = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
          index < batchSize * beamWidth * maxTokensPerStep; index += static_cast<SizeType32>(blockDim.x * gridDim.x))
     {
@@ -678,8 +726,8 @@ void invokeCopyNextStepIds(TokenIdType* nextStepIds, TokenIdType const* const* o
     int const numElems = batchSize * beamWidth * maxTokensPerStep;
     dim3 block(min(256, numElems));
     dim3 grid(divUp(numElems, block.x));
-    copyNextStepIds<<<grid, block, 0, stream>>>(nextStepIds, outputIdsPtr, sequenceLengths, numNewTokens, batchSlots,
-        batchSize, maxBatchSize, beamWidth, maxSeqLen, maxTokensPerStep);
+    launchWithPdl(copyNextStepIds, grid, block, 0, stream, nextStepIds, outputIdsPtr, sequenceLengths, numNewTokens,
+        batchSlots, batchSize, maxBatchSize, beamWidth, maxSeqLen, maxTokensPerStep);
 }
 
 __global__ void transposeLogProbs(float* outputLogProbs, float* outputLogProbsTiled, SizeType32 const* sequenceLengths,
@@ -772,12 +820,21 @@ void gatherTree(DecodingOutput const& decodingOutput, DecodingInput const& decod
 
     lengthPenaltyPtr = manager.copyFrom(lengthPenaltyVec, ITensor::makeShape({batchSize}), runtime::MemoryType::kGPU);
 
+    // A request with a smaller beam width than the decoder only finalizes its own beams
+    ITensor::SharedPtr beamWidthsPtr;
+    if (samplingConfig.beamWidth < beamWidth)
+    {
+        beamWidthsPtr = manager.copyFrom(std::vector<SizeType32>(batchSize, samplingConfig.beamWidth),
+            ITensor::makeShape({batchSize}), runtime::MemoryType::kGPU);
+    }
+
     tensorrt_llm::kernels::BeamHypotheses bh;
     bh.nMaxBatchSize = batchSize;
     bh.nBatchSize = batchSize;
     bh.nBeamWidth = beamWidth;
     bh.nMaxSeqLen = maxSeqLength;
     bh.lengthPenalties = bufferCast<float>(*lengthPenaltyPtr);
+    bh.beamWidths = bufferCastOrNull<SizeType32>(beamWidthsPtr);
     bh.inputLengths = bufferCast<SizeType32>(*decodingInput.lengths);
     bh.outputIds = bufferCast<TokenIdType>(finalOutputIds);
     bh.logProbs = bufferCastOrNull<float>(decodingOutput.logProbs);
@@ -806,6 +863,66 @@ void gatherTree(DecodingOutput const& decodingOutput, DecodingInput const& decod
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
 
+void gatherTree(DecodingOutput const& decodingOutput, DecodingInput const& decodingInput,
+    SizeType32 const* batchSlots, float const* lengthPenalties, SizeType32 const* beamWidths, SizeType32 batchSize,
+    CudaStream const& stream)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    auto& finalOutputIds = *decodingOutput.gatheredIds;
+    auto const& finalOutputIdsShape = finalOutputIds.getShape();
+    auto const maxBatchSize = finalOutputIdsShape.d[0];
+    auto const beamWidth = finalOutputIdsShape.d[1];
+    auto const maxSeqLength = finalOutputIdsShape.d[2];
+
+    TLLM_CHECK_WITH_INFO(beamWidth > 1, "gatherTree is only needed for beam search.");
+    TLLM_CHECK_WITH_INFO(batchSize <= maxBatchSize,
+        common::fmtstr("Cannot finalize %d requests with a decoder of batch size " FMT_DIM, batchSize, maxBatchSize));
+    TLLM_CHECK_WITH_INFO(decodingOutput.ids->getShape().d[0] == maxBatchSize,
+        "gatherTree of several requests works on the joint buffers of the decoder");
+    if (batchSize == 0)
+    {
+        return;
+    }
+
+    tensorrt_llm::kernels::invokeInitializeOutput(bufferCast<TokenIdType>(finalOutputIds),
+        bufferCast<TokenIdType>(*decodingInput.endIds), batchSize, beamWidth, maxSeqLength, stream.get(), batchSlots);
+    sync_check_cuda_error();
+
+    tensorrt_llm::kernels::BeamHypotheses bh;
+    bh.nMaxBatchSize = maxBatchSize;
+    bh.nBatchSize = batchSize;
+    bh.nBeamWidth = beamWidth;
+    bh.nMaxSeqLen = maxSeqLength;
+    bh.batchSlots = batchSlots;
+    bh.lengthPenalties = lengthPenalties;
+    bh.beamWidths = beamWidths;
+    bh.inputLengths = bufferCast<SizeType32>(*decodingInput.lengths);
+    bh.outputIds = bufferCast<TokenIdType>(finalOutputIds);
+    bh.logProbs = bufferCastOrNull<float>(decodingOutput.logProbs);
+    bh.logProbsTiled = bufferCast<float>(*decodingOutput.logProbsTiled);
+    bh.sequenceLengths = bufferCast<SizeType32>(*decodingOutput.lengths);
+    bh.cumLogProbs = bufferCast<float>(*decodingOutput.cumLogProbs);
+    bh.outputIdsCBA = bufferCast<TokenIdType>(*decodingOutput.beamHypotheses.outputIdsCBA);
+    bh.logProbsCBA = bufferCast<float>(*decodingOutput.beamHypotheses.logProbsCBA);
+    bh.sequenceLengthsCBA = bufferCast<SizeType32>(*decodingOutput.beamHypotheses.sequenceLengthsCBA);
+    bh.cumLogProbsCBA = bufferCast<float>(*decodingOutput.beamHypotheses.cumLogProbsCBA);
+    bh.normedScoresCBA = bufferCast<float>(*decodingOutput.beamHypotheses.normedScoresCBA);
+    bh.numBeamsCBA = bufferCast<SizeType32>(*decodingOutput.beamHypotheses.numBeamsCBA);
+    bh.minNormedScoresCBA = bufferCast<float>(*decodingOutput.beamHypotheses.minNormedScoresCBA);
+    bh.batchDones = bufferCast<bool>(*decodingOutput.beamHypotheses.batchDones);
+    bh.finished = bufferCast<tensorrt_llm::kernels::FinishedState>(*decodingOutput.finishReasons);
+    bh.outputIdsUnfinish = bufferCast<TokenIdType>(*decodingOutput.ids);
+    bh.parentIdsUnfinish = bufferCast<TokenIdType>(*decodingOutput.parentIds);
+
+    tensorrt_llm::kernels::invokeInsertUnfinishedPath(bh, stream.get());
+    sync_check_cuda_error();
+
+    tensorrt_llm::kernels::invokeFinalize(bh, stream.get());
+    sync_check_cuda_error();
+
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
 } // namespace runtime::kernels
 
 } // namespace tensorrt_llm
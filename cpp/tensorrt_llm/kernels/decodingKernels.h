@@ -20,6 +20,7 @@
 #include "tensorrt_llm/kernels/beamSearchKernels.h"
 #include "tensorrt_llm/kernels/decodingCommon.h"
 #include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
 #include "tensorrt_llm/runtime/decodingInput.h"
 #include "tensorrt_llm/runtime/decodingOutput.h"
 #include "tensorrt_llm/runtime/samplingConfig.h"
@@ -71,8 +72,25 @@ void invokeFinalize(BeamHypotheses& bh, cudaStream_t stream);
 //! \param batchBeam batchSize*beamWidth. inferred from finalOutputIds.shape[0] * finalOutputIds.shape[1]
 //! \param maxSeqLen The maximum sequence length, inferred from the finalOutputIds.shape[3]
 //! \param stream The CUDA stream on which to perform the operation.
+//! \param batchSlots [batch], the rows of finalOutputIds and endIds to initialize, the first batch rows if nullptr.
 void invokeInitializeOutput(runtime::TokenIdType* finalOutputIds, runtime::TokenIdType const* endIds,
-    runtime::SizeType32 batch, runtime::SizeType32 beam, runtime::SizeType32 maxSeqLen, cudaStream_t stream);
+    runtime::SizeType32 batch, runtime::SizeType32 beam, runtime::SizeType32 maxSeqLen, cudaStream_t stream,
+    runtime::SizeType32 const* batchSlots = nullptr);
+
+//! \brief Copies the finalized beams of the requests in batchSlots to contiguous rows of dst, e.g. pinned response
+//! staging buffers written by the device directly.
+//!
+//! \param dstOutputIds [batchSize, beamWidth, maxSeqLen], only the tokens of each beam are written.
+//! \param dstSequenceLengths [batchSize, beamWidth].
+//! \param dstCumLogProbs [batchSize, beamWidth], not written if nullptr.
+//! \param srcOutputIds [maxBatchSize, beamWidth, maxSeqLen], the gathered ids.
+//! \param srcSequenceLengths [maxBatchSize, beamWidth].
+//! \param srcCumLogProbs [maxBatchSize, beamWidth].
+//! \param batchSlots [batchSize], address map from local index to the rows of src.
+void invokeCopyFinalizedBeams(runtime::TokenIdType* dstOutputIds, runtime::SizeType32* dstSequenceLengths,
+    float* dstCumLogProbs, runtime::TokenIdType const* srcOutputIds, runtime::SizeType32 const* srcSequenceLengths,
+    float const* srcCumLogProbs, runtime::SizeType32 const* batchSlots, runtime::SizeType32 batchSize,
+    runtime::SizeType32 beamWidth, runtime::SizeType32 maxSeqLen, cudaStream_t stream);
 
 //! \brief Copies the data from the buffers in src to dst to reduce the kernel launch overhead of individual memcpy.
 //! for streaming + beam search, where we need to avoid overwriting the beam search buffers.
@@ -134,6 +152,22 @@ namespace runtime::kernels
 
 void gatherTree(DecodingOutput const& decodingOutput, DecodingInput const& decodingInput, BufferManager const& manager,
     SamplingConfig const& samplingConfig);
+
+//! \brief gatherTree for several requests at once, in place in the joint buffers of the decoder. Unlike gatherTree,
+//! there is no host copy or allocation: the parameters of the requests are passed in buffers the device reads, and each
+//! kernel is launched once for all the requests.
+//!
+//! \param decodingOutput the joint output buffers of the decoder, of maxBatchSize requests.
+//! \param decodingInput used for endIds and input lengths, of maxBatchSize requests.
+//! \param batchSlots [batchSize], the requests to finalize, in pinned or device memory.
+//! \param lengthPenalties [batchSize], the length penalty of each request, in pinned or device memory.
+//! \param beamWidths [batchSize], the beam width of each request, nullptr if all of them use the beam width of the
+//! decoder.
+//! \param batchSize the number of requests to finalize.
+//! \param stream the stream to enqueue the kernels on.
+void gatherTree(DecodingOutput const& decodingOutput, DecodingInput const& decodingInput,
+    SizeType32 const* batchSlots, float const* lengthPenalties, SizeType32 const* beamWidths, SizeType32 batchSize,
+    CudaStream const& stream);
 } // namespace runtime::kernels
 
 } // namespace tensorrt_llm
@@ -23,8 +23,8 @@ namespace tensorrt_llm::kernels
 {
 template <typename T>
 __global__ void tokenPerChannelScaleKernel(size_t const numModules, size_t const numTokens,
-    int64_t const* __restrict__ cumModuleSizes, T const* __restrict__ a, T const* const* __restrict__ scales,
-    T* __restrict__ result)
+    int64_t const* __restrict__ cumModuleSizes, T const* a, T const* __restrict__ residual,
+    T const* const* __restrict__ scales, T* result)
 {
     /*
      * This kernel applies DoRA scaling to LoRA output.
@@ -62,8 +62,10 @@ __global__ void tokenPerChannelScaleKernel(size_t const numModules, size_t const
 
     if (threadId < numChannels * numTokens)
     {
+        // add the residual of the fused variant, if any
+        T const value = residual == nullptr ? a[threadId] : a[threadId] + residual[threadId];
         // apply scaling if scale is not null (it is null in case of a non-DoRA adapter)
-        result[threadId] = scale == nullptr ? a[threadId] : a[threadId] * scale[channelId - scaleChannelOffset];
+        result[threadId] = scale == nullptr ? value : value * scale[channelId - scaleChannelOffset];
     }
 }
 
@@ -76,7 +78,19 @@ void tokenPerChannelScale(int64_t const numel, size_t const numModules, size_t c
     dim3 grid((numel + 255) / 256);
 
     tokenPerChannelScaleKernel<T>
-        <<<grid, block, 0, stream>>>(numModules, numTokens, cumModuleSizes, a, scale_ptrs, result);
+        <<<grid, block, 0, stream>>>(numModules, numTokens, cumModuleSizes, a, nullptr, scale_ptrs, result);
+}
+
+template <typename T>
+void tokenPerChannelScaleResidual(int64_t const numel, size_t const numModules, size_t const numTokens,
+    int64_t const* __restrict__ cumModuleSizes, T const* a, T const* residual, T const* const* scale_ptrs, T* result,
+    cudaStream_t stream)
+{
+    dim3 block(256);
+    dim3 grid((numel + 255) / 256);
+
+    tokenPerChannelScaleKernel<T>
+        <<<grid, block, 0, stream>>>(numModules, numTokens, cumModuleSizes, a, residual, scale_ptrs, result);
 }
 
 template void tokenPerChannelScale<half>(int64_t const numel, size_t const numModules, size_t const numTokens,
@@ -89,4 +103,17 @@ template void tokenPerChannelScale<nv_bfloat16>(int64_t const numel, size_t cons
     nv_bfloat16 const* const* __restrict__ scale_ptrs, nv_bfloat16* __restrict__ result, cudaStream_t stream);
 #endif
 
+#define INSTANTIATE_TOKEN_PER_CHANNEL_SCALE_RESIDUAL(T)                                                                \
+    template void tokenPerChannelScaleResidual<T>(int64_t const numel, size_t const numModules,                        \
+        size_t const numTokens, int64_t const* __restrict__ cumModuleSizes, T const* a, T const* residual,             \
+        T const* const* scale_ptrs, T* result, cudaStream_t stream)
+
+INSTANTIATE_TOKEN_PER_CHANNEL_SCALE_RESIDUAL(float);
+INSTANTIATE_TOKEN_PER_CHANNEL_SCALE_RESIDUAL(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_TOKEN_PER_CHANNEL_SCALE_RESIDUAL(nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_TOKEN_PER_CHANNEL_SCALE_RESIDUAL
+
 } // namespace tensorrt_llm::kernels
@@ -24,5 +24,12 @@ namespace kernels
 template <typename T>
 void tokenPerChannelScale(int64_t const numel, size_t const numModules, size_t const numGroups,
     int64_t const* __restrict__ cumModuleSizes, T const* a, T const* const* scale_ptrs, T* result, cudaStream_t stream);
+
+// Same as tokenPerChannelScale, scaling a + residual instead of a so that the add of the base output is not a pass of
+// its own. result may alias a.
+template <typename T>
+void tokenPerChannelScaleResidual(int64_t const numel, size_t const numModules, size_t const numGroups,
+    int64_t const* __restrict__ cumModuleSizes, T const* a, T const* residual, T const* const* scale_ptrs, T* result,
+    cudaStream_t stream);
 } // namespace kernels
 } // namespace tensorrt_llm
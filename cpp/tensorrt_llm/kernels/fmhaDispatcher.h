@@ -49,6 +49,12 @@ public:
     // Run the fmha kernel.
     void run(tensorrt_llm::kernels::MHARunnerParams runnerParams);
 
+    // Whether the trtllm-gen kernels run instead of the fmha v2 ones.
+    bool useTllmGen() const
+    {
+        return mUseTllmGen;
+    }
+
 private:
     // The fixed fmha parameters.
     kernels::MHARunnerFixedParams mFixedParams;
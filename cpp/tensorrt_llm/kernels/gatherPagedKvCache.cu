@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/gatherPagedKvCache.h"
+
+#include <type_traits>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+namespace
+{
+
+int32_t constexpr kBlockSize = 256;
+int32_t constexpr kTokensPerCta = 16;
+
+// Grid: [divUp(maxKvSeqLen, kTokensPerCta), batchSize, 2 (K, V)].
+template <typename T, typename TCache>
+__global__ void __launch_bounds__(kBlockSize)
+    gatherPagedKvCacheKernel(GatherPagedKvCacheParams<T> params, KVBlockArray kvCache)
+{
+    auto const batchIdx = static_cast<int32_t>(blockIdx.y);
+    auto const kvIdx = static_cast<int32_t>(blockIdx.z);
+    auto const kvLength = params.kvSeqLens[batchIdx];
+    auto const tokenBegin = static_cast<int32_t>(blockIdx.x) * kTokensPerCta;
+    if (tokenBegin >= kvLength)
+    {
+        return;
+    }
+    auto const tokenEnd = min(tokenBegin + kTokensPerCta, kvLength);
+
+    auto const hiddenSize = params.kvHeadNum * params.sizePerHead;
+    auto* out = params.kvOutput + static_cast<size_t>(params.cuKvSeqLens[batchIdx]) * 2 * hiddenSize;
+    auto const numElts = (tokenEnd - tokenBegin) * hiddenSize;
+    for (auto idx = static_cast<int32_t>(threadIdx.x); idx < numElts; idx += kBlockSize)
+    {
+        auto const tokenIdx = tokenBegin + idx / hiddenSize;
+        auto const hiddenIdx = idx % hiddenSize;
+        auto const headIdx = hiddenIdx / params.sizePerHead;
+        auto const channel = hiddenIdx % params.sizePerHead;
+
+        // Tokens are read without the cyclic mapping, as the paged KV kernels do.
+        auto const* block = reinterpret_cast<TCache const*>(
+            kvIdx == 0 ? kvCache.getKBlockPtr(batchIdx, tokenIdx) : kvCache.getVBlockPtr(batchIdx, tokenIdx));
+        auto const cached = block[kvCache.getKVLocalIdx(tokenIdx, headIdx, params.sizePerHead, channel)];
+        T value;
+        if constexpr (std::is_same_v<T, TCache>)
+        {
+            value = cached;
+        }
+        else
+        {
+            auto const scale = params.kvScaleQuantOrig[params.kvScalePerHead ? headIdx : 0];
+            value = cuda_cast<T>(static_cast<float>(cached) * scale);
+        }
+        out[(static_cast<size_t>(tokenIdx) * 2 + kvIdx) * hiddenSize + hiddenIdx] = value;
+    }
+}
+
+template <typename T, typename TCache>
+void launchGatherPagedKvCache(
+    GatherPagedKvCacheParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream)
+{
+    dim3 const grid(divUp(params.maxKvSeqLen, kTokensPerCta), params.batchSize, 2);
+    gatherPagedKvCacheKernel<T, TCache><<<grid, kBlockSize, 0, stream>>>(params, kvCache);
+}
+
+} // namespace
+
+template <typename T>
+void invokeGatherPagedKvCache(
+    GatherPagedKvCacheParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream)
+{
+    params.checkParams();
+    if (params.maxKvSeqLen <= 0)
+    {
+        return;
+    }
+
+    switch (params.cacheType)
+    {
+    case KvCacheDataType::BASE: launchGatherPagedKvCache<T, T>(params, kvCache, stream); break;
+    case KvCacheDataType::INT8: launchGatherPagedKvCache<T, int8_t>(params, kvCache, stream); break;
+#ifdef ENABLE_FP8
+    case KvCacheDataType::FP8: launchGatherPagedKvCache<T, __nv_fp8_e4m3>(params, kvCache, stream); break;
+#endif
+    default: TLLM_THROW("Unsupported KV cache data type %d", static_cast<int>(params.cacheType));
+    }
+
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_GATHER_PAGED_KV_CACHE(T)                                                                           \
+    template void invokeGatherPagedKvCache<T>(                                                                         \
+        GatherPagedKvCacheParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream)
+
+INSTANTIATE_GATHER_PAGED_KV_CACHE(float);
+INSTANTIATE_GATHER_PAGED_KV_CACHE(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_GATHER_PAGED_KV_CACHE(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_GATHER_PAGED_KV_CACHE
+
+} // namespace tensorrt_llm::kernels
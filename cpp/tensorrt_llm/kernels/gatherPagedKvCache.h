@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/kernels/kvCacheUtils.h"
+#include "tensorrt_llm/kernels/unfusedAttentionKernels.h"
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+template <typename T>
+struct GatherPagedKvCacheParams
+{
+    // Contiguous KV of the context FMHA [totalKvTokens, 2, kvHeadNum, sizePerHead], where the tokens of a sequence
+    // start at its cuKvSeqLens offset.
+    T* kvOutput{nullptr};
+    // Number of tokens in the cache of every sequence, including the tokens of the current chunk [batchSize].
+    int32_t const* kvSeqLens{nullptr};
+    // Exclusive prefix sum of kvSeqLens [batchSize + 1].
+    int32_t const* cuKvSeqLens{nullptr};
+    // Dequantization scales of the INT8/FP8 KV cache, [1] or [kvHeadNum] with kvScalePerHead.
+    float const* kvScaleQuantOrig{nullptr};
+    bool kvScalePerHead{false};
+    KvCacheDataType cacheType{KvCacheDataType::BASE};
+    int32_t batchSize{0};
+    int32_t kvHeadNum{0};
+    int32_t sizePerHead{0};
+    int32_t maxKvSeqLen{0};
+
+    void checkParams() const
+    {
+        TLLM_CHECK(kvOutput && kvSeqLens && cuKvSeqLens);
+        TLLM_CHECK(batchSize > 0 && kvHeadNum > 0 && sizePerHead > 0);
+        TLLM_CHECK(cacheType == KvCacheDataType::BASE || kvScaleQuantOrig);
+        TLLM_CHECK_WITH_INFO(cacheType != KvCacheDataType::NVFP4, "Gathering the NVFP4 KV cache is not supported");
+    }
+};
+
+//! \brief Copy the K and V of every sequence from the paged cache to a contiguous buffer of T, dequantizing INT8 and
+//! FP8 caches, so that the context FMHA kernels with contiguous KV input can attend the previous chunks and reused
+//! blocks when no paged KV kernel exists for the head size or the KV cache type.
+template <typename T>
+void invokeGatherPagedKvCache(
+    GatherPagedKvCacheParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
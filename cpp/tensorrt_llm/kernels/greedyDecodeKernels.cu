@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.  All rights reserved.
+ * Copyright (c) 2021, NAVER Corp.  Authored by CLOVA.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/pdlUtils.cuh"
+#include "tensorrt_llm/kernels/greedyDecodeKernels.h"
+
+#include <cub/cub.cuh>
+#include <cuda_fp16.h>
+#ifdef ENABLE_BF16
+#include <cuda_bf16.h>
+#endif
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::runtime;
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+constexpr SizeType32 kBlockSize = 256;
+
+//! \brief Argmax of a part of the vocab, with the sum of the exponentials of its logits relative to the max.
+struct GreedyPartial
+{
+    float maxLogit;
+    float sumExp;
+    TokenIdType tokenId;
+};
+
+__device__ __forceinline__ void insertLogit(GreedyPartial& partial, float logit, TokenIdType tokenId)
+{
+    if (logit > partial.maxLogit)
+    {
+        partial.sumExp = partial.sumExp * __expf(partial.maxLogit - logit) + 1.f;
+        partial.maxLogit = logit;
+        partial.tokenId = tokenId;
+    }
+    else
+    {
+        partial.sumExp += __expf(logit - partial.maxLogit);
+    }
+}
+
+struct MergeGreedyPartials
+{
+    __device__ __forceinline__ GreedyPartial operator()(GreedyPartial const& a, GreedyPartial const& b) const
+    {
+        // The lowest token id wins the ties, whatever the order of the reduction.
+        bool const takeB = b.maxLogit > a.maxLogit
+            || (b.maxLogit == a.maxLogit && b.tokenId >= 0 && (a.tokenId < 0 || b.tokenId < a.tokenId));
+        auto const maxLogit = takeB ? b.maxLogit : a.maxLogit;
+        return GreedyPartial{maxLogit,
+            a.sumExp * __expf(a.maxLogit - maxLogit) + b.sumExp * __expf(b.maxLogit - maxLogit),
+            takeB ? b.tokenId : a.tokenId};
+    }
+};
+
+//! \brief Append the selected token, if any, and apply the stop criteria, as the top-k sampling, stop criteria and
+//! next step ids kernels do.
+template <typename T>
+__device__ void finalizeGreedyStep(
+    GreedyDecodeParams<T> const& params, SizeType32 batchSlot, FinishedState finishState, GreedyPartial const* best)
+{
+    auto* outputIds = params.outputIdsPtrs[batchSlot];
+    auto seqLen = params.sequenceLengths[batchSlot];
+    if (best != nullptr)
+    {
+        // Like the top-k sampling, an invalid id shows as the last token of the vocab.
+        auto const tokenId = best->tokenId < 0 ? params.vocabSize - 1 : best->tokenId;
+        outputIds[seqLen] = tokenId;
+        // The log-softmax of the max logit.
+        auto const logProb = -__logf(best->sumExp);
+        if (params.cumLogProbs != nullptr)
+        {
+            params.cumLogProbs[batchSlot] += logProb;
+        }
+        if (params.outputLogProbs != nullptr)
+        {
+            params.outputLogProbs[seqLen * params.maxBatchSize + batchSlot] = params.normalizeLogProbs ? 0.f : logProb;
+        }
+        if (tokenId == params.endIds[batchSlot])
+        {
+            // The sequence length excludes the EOS token.
+            finishState.setFinishedEOS();
+        }
+        else
+        {
+            ++seqLen;
+        }
+    }
+    if (params.sequenceLimitLength != nullptr && params.sequenceLimitLength[batchSlot] - seqLen <= 0)
+    {
+        finishState.setFinishedMaxLength();
+        seqLen = params.sequenceLimitLength[batchSlot];
+    }
+    params.sequenceLengths[batchSlot] = seqLen;
+    if (params.finishedOutput != nullptr)
+    {
+        params.finishedOutput[batchSlot] = finishState;
+    }
+    if (params.finishedSum != nullptr)
+    {
+        params.finishedSum[batchSlot] = finishState.isFinished() ? 1 : 0;
+    }
+    if (seqLen > 0)
+    {
+        params.newTokens[batchSlot] = outputIds[seqLen - 1];
+    }
+}
+
+//! \brief Grid [blocksPerRequest, batchSize]. The blocks of a request each reduce a range of its vocab, the last one
+//! to finish merges their results and finalizes the step.
+template <typename T, bool VECTORIZED>
+__global__ void greedyDecodeKernel(GreedyDecodeParams<T> const params)
+{
+    using BlockReduce = cub::BlockReduce<GreedyPartial, kBlockSize>;
+    __shared__ typename BlockReduce::TempStorage tempStorage;
+    __shared__ bool sIsLastBlock;
+
+    auto const batchIdx = static_cast<SizeType32>(blockIdx.y);
+    auto const blockIdxInRequest = static_cast<SizeType32>(blockIdx.x);
+    auto const blocksPerRequest = static_cast<SizeType32>(gridDim.x);
+
+    pdlWaitPrimaryGrid();
+
+    auto const batchSlot = params.batchSlots[batchIdx];
+    auto const finishState = params.finishedInput != nullptr ? params.finishedInput[batchSlot] : FinishedState::empty();
+    if (finishState.isFinished() || finishState.isSkipDecoding())
+    {
+        // No token, the length criterion and the outputs of the step still apply.
+        if (blockIdxInRequest == 0 && threadIdx.x == 0)
+        {
+            finalizeGreedyStep<T>(params, batchSlot, finishState, nullptr);
+        }
+        return;
+    }
+
+    // EOS is masked until the request generated minLength tokens, as the penalty kernel does.
+    auto const seqLen = params.sequenceLengths[batchSlot];
+    auto const inputLen = params.inputLengths != nullptr ? params.inputLengths[batchSlot] : 0;
+    auto const maskedId = params.minLengths != nullptr && seqLen - inputLen < params.minLengths[batchSlot]
+        ? params.endIds[batchSlot]
+        : TokenIdType{-1};
+
+    constexpr SizeType32 kVecSize = VECTORIZED ? static_cast<SizeType32>(sizeof(uint4) / sizeof(T)) : 1;
+    auto const numVecs = (params.vocabSize + kVecSize - 1) / kVecSize;
+    auto const vecsPerBlock = (numVecs + blocksPerRequest - 1) / blocksPerRequest;
+    auto const beginVec = blockIdxInRequest * vecsPerBlock;
+    auto const endVec = min(beginVec + vecsPerBlock, numVecs);
+    auto const* logits = params.logitsPtrs[batchIdx];
+
+    GreedyPartial partial{-FLT_MAX, 0.f, -1};
+    for (auto vi = beginVec + static_cast<SizeType32>(threadIdx.x); vi < endVec; vi += kBlockSize)
+    {
+        if constexpr (VECTORIZED)
+        {
+            // The rows are padded to whole vectors, see invokeGreedyDecode.
+            uint4 const packed = reinterpret_cast<uint4 const*>(logits)[vi];
+            auto const* values = reinterpret_cast<T const*>(&packed);
+#pragma unroll
+            for (SizeType32 vj = 0; vj < kVecSize; ++vj)
+            {
+                auto const tokenId = vi * kVecSize + vj;
+                if (tokenId < params.vocabSize && tokenId != maskedId)
+                {
+                    insertLogit(partial, static_cast<float>(values[vj]), tokenId);
+                }
+            }
+        }
+        else if (vi != maskedId)
+        {
+            insertLogit(partial, static_cast<float>(logits[vi]), vi);
+        }
+    }
+    pdlLaunchDependents();
+
+    auto const total = BlockReduce(tempStorage).Reduce(partial, MergeGreedyPartials{});
+    if (blocksPerRequest == 1)
+    {
+        if (threadIdx.x == 0)
+        {
+            finalizeGreedyStep<T>(params, batchSlot, finishState, &total);
+        }
+        return;
+    }
+
+    auto* partials = static_cast<GreedyPartial*>(params.workspace) + batchIdx * kGreedyDecodeMaxBlocksPerRequest;
+    if (threadIdx.x == 0)
+    {
+        partials[blockIdxInRequest] = total;
+        __threadfence();
+        auto const numDone = atomicAdd(params.blockCounters + batchIdx, 1);
+        sIsLastBlock = numDone == blocksPerRequest - 1;
+    }
+    __syncthreads();
+    if (!sIsLastBlock || threadIdx.x != 0)
+    {
+        return;
+    }
+
+    volatile GreedyPartial const* donePartials = partials;
+    GreedyPartial best{donePartials[0].maxLogit, donePartials[0].sumExp, donePartials[0].tokenId};
+    for (SizeType32 bi = 1; bi < blocksPerRequest; ++bi)
+    {
+        best = MergeGreedyPartials{}(
+            best, GreedyPartial{donePartials[bi].maxLogit, donePartials[bi].sumExp, donePartials[bi].tokenId});
+    }
+    params.blockCounters[batchIdx] = 0;
+    finalizeGreedyStep<T>(params, batchSlot, finishState, &best);
+}
+
+} // namespace
+
+size_t getGreedyDecodeWorkspaceSize(SizeType32 batchSize)
+{
+    return static_cast<size_t>(batchSize) * kGreedyDecodeMaxBlocksPerRequest * sizeof(GreedyPartial);
+}
+
+template <typename T>
+void invokeGreedyDecode(GreedyDecodeParams<T> const& params, cudaStream_t stream)
+{
+    if (params.batchSize == 0)
+    {
+        return;
+    }
+    constexpr auto kVecSize = static_cast<SizeType32>(sizeof(uint4) / sizeof(T));
+    bool const vectorized = params.vocabSizePadded % kVecSize == 0;
+    auto const numVecs = divUp(params.vocabSize, vectorized ? kVecSize : 1);
+    // Enough blocks for about 2 per SM, but each with a full iteration of work at least.
+    auto const blocksPerRequest = std::clamp(static_cast<SizeType32>(std::min(
+                                                 divUp(2 * params.multiProcessorCount, params.batchSize),
+                                                 divUp(numVecs, kBlockSize))),
+        1, kGreedyDecodeMaxBlocksPerRequest);
+
+    dim3 const grid(blocksPerRequest, params.batchSize);
+    dim3 const block(kBlockSize);
+    if (vectorized)
+    {
+        launchWithPdl(greedyDecodeKernel<T, true>, grid, block, 0, stream, params);
+    }
+    else
+    {
+        launchWithPdl(greedyDecodeKernel<T, false>, grid, block, 0, stream, params);
+    }
+    sync_check_cuda_error();
+}
+
+template void invokeGreedyDecode(GreedyDecodeParams<float> const& params, cudaStream_t stream);
+template void invokeGreedyDecode(GreedyDecodeParams<half> const& params, cudaStream_t stream);
+#ifdef ENABLE_BF16
+template void invokeGreedyDecode(GreedyDecodeParams<__nv_bfloat16> const& params, cudaStream_t stream);
+#endif
+
+} // namespace tensorrt_llm::kernels
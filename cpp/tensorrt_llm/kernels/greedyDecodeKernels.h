@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.  All rights reserved.
+ * Copyright (c) 2021, NAVER Corp.  Authored by CLOVA.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Greedy decoding step of requests with beam width 1, one token per step and no penalties: the argmax over
+//! the vocab, the EOS, min length and max length checks and the output ids and sequence lengths updates, each fused
+//! in one kernel instead of the penalty, top-k sampling, stop criteria and next step ids kernels.
+template <typename T>
+struct GreedyDecodeParams
+{
+    //! input buffer [batchSize][vocabSizePadded], the logits of every request.
+    T const* const* logitsPtrs{nullptr};
+    //! input buffer [batchSize], the batch slot of every request.
+    runtime::SizeType32 const* batchSlots{nullptr};
+    //! input buffer [maxBatchSize], EOS token ids per request.
+    runtime::TokenIdType const* endIds{nullptr};
+    //! input buffer [maxBatchSize], optional. Prompt lengths, for minLengths.
+    runtime::SizeType32 const* inputLengths{nullptr};
+    //! input buffer [maxBatchSize], optional. EOS is not selected before the request generated minLengths tokens.
+    runtime::SizeType32 const* minLengths{nullptr};
+    //! input buffer [maxBatchSize], optional. Requests finish with their length at sequenceLimitLength.
+    runtime::SizeType32 const* sequenceLimitLength{nullptr};
+    //! input buffer [maxBatchSize], optional. Finished requests are not decoded.
+    FinishedState const* finishedInput{nullptr};
+
+    //! output buffer [maxBatchSize][maxSeqLen], the token is written at the current sequence length.
+    runtime::TokenIdType* const* outputIdsPtrs{nullptr};
+    //! input/output buffer [maxBatchSize]. Set up to, but excluding the EOS token.
+    runtime::SizeType32* sequenceLengths{nullptr};
+    //! output buffer [maxBatchSize], optional.
+    FinishedState* finishedOutput{nullptr};
+    //! output buffer [maxBatchSize], optional. 1 if the request is finished, 0 otherwise.
+    runtime::SizeType32* finishedSum{nullptr};
+    //! output buffer [maxBatchSize], the last token of every request, as invokeCopyNextStepIds.
+    runtime::TokenIdType* newTokens{nullptr};
+    //! input/output buffer [maxBatchSize], optional. Adds the log probability of the selected token.
+    float* cumLogProbs{nullptr};
+    //! output buffer [maxSeqLen, maxBatchSize], optional. Log probability of the selected token, 0 if
+    //! normalizeLogProbs since it has all the probability of the top-1.
+    float* outputLogProbs{nullptr};
+
+    //! Required. Pointer to the workspace of getGreedyDecodeWorkspaceSize(batchSize) bytes, for the partial results
+    //! of the blocks that share the vocab of a request.
+    void* workspace{nullptr};
+    //! Buffer [batchSize], zero before the first launch. The kernel resets it to zero.
+    runtime::SizeType32* blockCounters{nullptr};
+
+    runtime::SizeType32 batchSize{0};
+    runtime::SizeType32 maxBatchSize{0};
+    runtime::SizeType32 vocabSize{0};
+    runtime::SizeType32 vocabSizePadded{0};
+    //! Small batches spread the vocab of a request over several blocks to fill the SMs.
+    runtime::SizeType32 multiProcessorCount{1};
+    bool normalizeLogProbs{false};
+};
+
+//! \brief Most blocks sharing the vocab of a request.
+static constexpr runtime::SizeType32 kGreedyDecodeMaxBlocksPerRequest = 16;
+
+[[nodiscard]] size_t getGreedyDecodeWorkspaceSize(runtime::SizeType32 batchSize);
+
+template <typename T>
+void invokeGreedyDecode(GreedyDecodeParams<T> const& params, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
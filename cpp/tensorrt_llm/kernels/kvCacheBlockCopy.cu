@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/kvCacheBlockCopy.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+constexpr int kThreadsPerBlock = 256;
+// Bytes copied by one CTA for large copies, so that a single large block is spread over multiple SMs.
+constexpr int64_t kBytesPerCta = 64 * 1024;
+
+// grid.y indexes the copy, grid.x splits every copy into kBytesPerCta pieces.
+__global__ void batchedBlockCopyKernel(KVBlockCopyDesc const* __restrict__ copies)
+{
+    auto const copy = copies[blockIdx.y];
+    auto const begin = static_cast<int64_t>(blockIdx.x) * kBytesPerCta;
+    if (begin >= copy.numBytes)
+    {
+        return;
+    }
+    auto const end = min(begin + kBytesPerCta, copy.numBytes);
+    auto const* src = static_cast<uint8_t const*>(copy.src);
+    auto* dst = static_cast<uint8_t*>(copy.dst);
+
+    bool const isAligned
+        = ((reinterpret_cast<uintptr_t>(src) | reinterpret_cast<uintptr_t>(dst) | begin) % sizeof(uint4)) == 0;
+    auto pos = begin;
+    if (isAligned)
+    {
+        auto const numVecs = (end - begin) / static_cast<int64_t>(sizeof(uint4));
+        auto const* srcVec = reinterpret_cast<uint4 const*>(src + begin);
+        auto* dstVec = reinterpret_cast<uint4*>(dst + begin);
+        for (int64_t i = threadIdx.x; i < numVecs; i += blockDim.x)
+        {
+            dstVec[i] = srcVec[i];
+        }
+        pos += numVecs * static_cast<int64_t>(sizeof(uint4));
+    }
+    for (int64_t i = pos + threadIdx.x; i < end; i += blockDim.x)
+    {
+        dst[i] = src[i];
+    }
+}
+} // namespace
+
+void invokeBatchedBlockCopy(KVBlockCopyDesc const* copies, int32_t numCopies, int64_t maxNumBytes, cudaStream_t stream)
+{
+    if (numCopies == 0 || maxNumBytes == 0)
+    {
+        return;
+    }
+    auto const numCtasPerCopy = static_cast<unsigned int>(common::ceilDiv(maxNumBytes, kBytesPerCta));
+    // grid.y is limited to 65535.
+    constexpr int32_t kMaxCopiesPerLaunch = 65535;
+    for (int32_t first = 0; first < numCopies; first += kMaxCopiesPerLaunch)
+    {
+        auto const num = std::min(kMaxCopiesPerLaunch, numCopies - first);
+        dim3 const grid(numCtasPerCopy, static_cast<unsigned int>(num));
+        batchedBlockCopyKernel<<<grid, kThreadsPerBlock, 0, stream>>>(copies + first);
+    }
+    sync_check_cuda_error();
+}
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief One contiguous copy of a batched block copy.
+struct KVBlockCopyDesc
+{
+    void const* src;
+    void* dst;
+    int64_t numBytes;
+};
+
+//! \brief Perform numCopies independent copies in a single kernel launch.
+//! \details Replaces one cudaMemcpyAsync per block and pool when many small blocks are moved between primary and
+//! secondary pools. Pinned host memory is accessed directly through unified virtual addressing, so src and dst can be
+//! any combination of device and pinned host pointers.
+//! \param copies Device-accessible array of numCopies descriptors.
+void invokeBatchedBlockCopy(KVBlockCopyDesc const* copies, int32_t numCopies, int64_t maxNumBytes, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/reduceKernelUtils.cuh"
+#include "tensorrt_llm/kernels/kvCacheOffloadQuantization.h"
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+
+#ifdef ENABLE_FP8
+namespace
+{
+constexpr int kThreadsPerBlock = 256;
+
+// One CTA per (chunk, block). The chunk is read twice from device memory: once for the amax and once to quantize.
+template <typename T>
+__global__ void quantizeKVBlocksKernel(KVBlockQuantizationParams params, T const* __restrict__ devicePool,
+    __nv_fp8_e4m3* __restrict__ compressedPool, float* __restrict__ scales)
+{
+    auto const chunkIdx = static_cast<int64_t>(blockIdx.x);
+    auto const numChunks = params.blockNumel / params.chunkSize;
+    auto const offset = chunkIdx * params.chunkSize;
+    T const* src = devicePool + params.deviceBlockIndices[blockIdx.y] * params.blockNumel + offset;
+    auto const compressedBlockIdx = static_cast<int64_t>(params.compressedBlockIndices[blockIdx.y]);
+    __nv_fp8_e4m3* dst = compressedPool + compressedBlockIdx * params.blockNumel + offset;
+
+    float amax = 0.F;
+    for (int64_t i = threadIdx.x; i < params.chunkSize; i += blockDim.x)
+    {
+        amax = fmaxf(amax, fabsf(cuda_cast<float>(src[i])));
+    }
+    amax = blockAllReduceMax<float>(amax);
+
+    // Avoid a division by zero for chunks of zeros.
+    float const scale = amax > 0.F ? amax / kFP8E4M3Max : 1.F;
+    if (threadIdx.x == 0)
+    {
+        scales[compressedBlockIdx * numChunks + chunkIdx] = scale;
+    }
+    float const invScale = 1.F / scale;
+    for (int64_t i = threadIdx.x; i < params.chunkSize; i += blockDim.x)
+    {
+        dst[i] = __nv_fp8_e4m3(cuda_cast<float>(src[i]) * invScale);
+    }
+}
+
+template <typename T>
+__global__ void dequantizeKVBlocksKernel(KVBlockQuantizationParams params,
+    __nv_fp8_e4m3 const* __restrict__ compressedPool, float const* __restrict__ scales, T* __restrict__ devicePool)
+{
+    auto const chunkIdx = static_cast<int64_t>(blockIdx.x);
+    auto const numChunks = params.blockNumel / params.chunkSize;
+    auto const offset = chunkIdx * params.chunkSize;
+    auto const compressedBlockIdx = static_cast<int64_t>(params.compressedBlockIndices[blockIdx.y]);
+    __nv_fp8_e4m3 const* src = compressedPool + compressedBlockIdx * params.blockNumel + offset;
+    T* dst = devicePool + params.deviceBlockIndices[blockIdx.y] * params.blockNumel + offset;
+
+    float const scale = scales[compressedBlockIdx * numChunks + chunkIdx];
+    for (int64_t i = threadIdx.x; i < params.chunkSize; i += blockDim.x)
+    {
+        dst[i] = cuda_cast<T>(static_cast<float>(src[i]) * scale);
+    }
+}
+
+dim3 getGrid(KVBlockQuantizationParams const& params)
+{
+    TLLM_CHECK_WITH_INFO(params.chunkSize > 0 && params.blockNumel % params.chunkSize == 0,
+        "Chunk size %ld must divide the block size %ld", params.chunkSize, params.blockNumel);
+    return dim3(static_cast<unsigned int>(params.blockNumel / params.chunkSize), params.numBlocks);
+}
+} // namespace
+
+template <typename T>
+void invokeQuantizeKVBlocks(KVBlockQuantizationParams const& params, T const* devicePool, __nv_fp8_e4m3* compressedPool,
+    float* scales, cudaStream_t stream)
+{
+    if (params.numBlocks == 0)
+    {
+        return;
+    }
+    quantizeKVBlocksKernel<T>
+        <<<getGrid(params), kThreadsPerBlock, 0, stream>>>(params, devicePool, compressedPool, scales);
+    sync_check_cuda_error();
+}
+
+template <typename T>
+void invokeDequantizeKVBlocks(KVBlockQuantizationParams const& params, __nv_fp8_e4m3 const* compressedPool,
+    float const* scales, T* devicePool, cudaStream_t stream)
+{
+    if (params.numBlocks == 0)
+    {
+        return;
+    }
+    dequantizeKVBlocksKernel<T>
+        <<<getGrid(params), kThreadsPerBlock, 0, stream>>>(params, compressedPool, scales, devicePool);
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_KV_BLOCK_QUANTIZATION(T)                                                                           \
+    template void invokeQuantizeKVBlocks<T>(KVBlockQuantizationParams const& params, T const* devicePool,             \
+        __nv_fp8_e4m3* compressedPool, float* scales, cudaStream_t stream);                                            \
+    template void invokeDequantizeKVBlocks<T>(KVBlockQuantizationParams const& params,                                \
+        __nv_fp8_e4m3 const* compressedPool, float const* scales, T* devicePool, cudaStream_t stream)
+
+INSTANTIATE_KV_BLOCK_QUANTIZATION(float);
+INSTANTIATE_KV_BLOCK_QUANTIZATION(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_KV_BLOCK_QUANTIZATION(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_KV_BLOCK_QUANTIZATION
+#endif // ENABLE_FP8
+
+} // namespace tensorrt_llm::kernels
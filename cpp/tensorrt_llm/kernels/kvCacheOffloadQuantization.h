@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "tensorrt_llm/common/cudaUtils.h"
+
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Largest magnitude representable in FP8 E4M3.
+constexpr float kFP8E4M3Max = 448.F;
+
+//! \brief Parameters of a batch of KV cache block (de)quantizations between a device pool and a compressed pool.
+//! \details Every block of blockNumel elements is split into chunks of chunkSize elements (e.g. one K or V block of one
+//! layer) that have their own scale. The compressed pool and its scales are usually in pinned host memory and are
+//! accessed directly from the kernel, so only the compressed bytes cross PCIe.
+struct KVBlockQuantizationParams
+{
+    // Number of blocks to process.
+    int32_t numBlocks;
+    // Number of elements of one block.
+    int64_t blockNumel;
+    // Number of elements sharing a scale. Must divide blockNumel.
+    int64_t chunkSize;
+    // [numBlocks] indices of the blocks in the device pool.
+    int32_t const* deviceBlockIndices;
+    // [numBlocks] indices of the blocks in the compressed pool.
+    int32_t const* compressedBlockIndices;
+};
+
+#ifdef ENABLE_FP8
+//! \brief Quantize blocks of the device pool to FP8 E4M3 with one scale per chunk.
+//! \param devicePool Pool of shape [numDeviceBlocks, blockNumel].
+//! \param compressedPool Pool of shape [numCompressedBlocks, blockNumel].
+//! \param scales Scales of shape [numCompressedBlocks, blockNumel / chunkSize].
+template <typename T>
+void invokeQuantizeKVBlocks(KVBlockQuantizationParams const& params, T const* devicePool, __nv_fp8_e4m3* compressedPool,
+    float* scales, cudaStream_t stream);
+
+//! \brief Expand FP8 E4M3 blocks of the compressed pool into the device pool. Inverse of invokeQuantizeKVBlocks.
+template <typename T>
+void invokeDequantizeKVBlocks(KVBlockQuantizationParams const& params, __nv_fp8_e4m3 const* compressedPool,
+    float const* scales, T* devicePool, cudaStream_t stream);
+#endif // ENABLE_FP8
+
+} // namespace tensorrt_llm::kernels
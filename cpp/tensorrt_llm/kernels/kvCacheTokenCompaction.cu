@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/kvCacheTokenCompaction.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+constexpr int kMaxThreadsPerBlock = 256;
+
+// grid.x indexes the slice (layer, K/V, head) of the blocks, grid.y the sequence. Every thread owns the same 16 bytes
+// of every token, so applying the moves in order is race free without synchronization: destinations are always below
+// the sources of the later moves.
+__global__ void compactKVTokensKernel(KVTokenCompactionParams const params)
+{
+    auto const sliceIdx = static_cast<int64_t>(blockIdx.x);
+    auto const tokenSizeInVecs = params.tokenSizeInBytes / static_cast<int32_t>(sizeof(uint4));
+    auto const sliceSizeInVecs = static_cast<int64_t>(params.tokensPerBlock) * tokenSizeInVecs;
+    auto const blockSizeInVecs = sliceSizeInVecs * params.numSlicesPerBlock;
+    auto* pool = static_cast<uint4*>(params.pool);
+
+    auto const movesBegin = params.moveOffsets[blockIdx.y];
+    auto const movesEnd = params.moveOffsets[blockIdx.y + 1];
+    for (auto moveIdx = movesBegin; moveIdx < movesEnd; ++moveIdx)
+    {
+        auto const move = params.moves[moveIdx];
+        auto const* src = pool + move.srcBlockIdx * blockSizeInVecs + sliceIdx * sliceSizeInVecs
+            + static_cast<int64_t>(move.srcTokenIdx) * tokenSizeInVecs;
+        auto* dst = pool + move.dstBlockIdx * blockSizeInVecs + sliceIdx * sliceSizeInVecs
+            + static_cast<int64_t>(move.dstTokenIdx) * tokenSizeInVecs;
+        for (int32_t i = threadIdx.x; i < tokenSizeInVecs; i += blockDim.x)
+        {
+            dst[i] = src[i];
+        }
+    }
+}
+} // namespace
+
+void invokeCompactKVTokens(KVTokenCompactionParams const& params, cudaStream_t stream)
+{
+    if (params.numSequences == 0)
+    {
+        return;
+    }
+    TLLM_CHECK_WITH_INFO(params.tokenSizeInBytes % sizeof(uint4) == 0,
+        "KV token compaction requires the size of a token per head to be a multiple of 16 bytes");
+    auto const threads = std::min(kMaxThreadsPerBlock, params.tokenSizeInBytes / static_cast<int>(sizeof(uint4)));
+    dim3 const grid(
+        static_cast<unsigned int>(params.numSlicesPerBlock), static_cast<unsigned int>(params.numSequences));
+    compactKVTokensKernel<<<grid, threads, 0, stream>>>(params);
+    sync_check_cuda_error();
+}
+
+} // namespace tensorrt_llm::kernels
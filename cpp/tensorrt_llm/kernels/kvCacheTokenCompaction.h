@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Move of one token of a sequence to a lower position, in memory pool block coordinates.
+struct KVTokenMove
+{
+    int32_t srcBlockIdx;
+    int32_t srcTokenIdx;
+    int32_t dstBlockIdx;
+    int32_t dstTokenIdx;
+};
+
+struct KVTokenCompactionParams
+{
+    // Primary pool, shape [numBlocks, numSlicesPerBlock, tokensPerBlock, tokenSizeInBytes].
+    void* pool;
+    // numSlicesPerBlock = numLayers * kvFactor * numKvHeads.
+    int32_t numSlicesPerBlock;
+    int32_t tokensPerBlock;
+    // sizePerHead * element size. Must be a multiple of 16.
+    int32_t tokenSizeInBytes;
+    // Moves of all sequences [moveOffsets[numSequences]]. The moves of a sequence are ordered by increasing
+    // destination position and every destination precedes its source.
+    KVTokenMove const* moves;
+    // Offsets of the moves of every sequence [numSequences + 1].
+    int32_t const* moveOffsets;
+    int32_t numSequences;
+};
+
+//! \brief Compact the KV cache of sequences in place after tokens were evicted: the K and V of every layer and head of
+//! the kept tokens are moved to the front of the sequence, in order. Sequences must not share the blocks written to.
+void invokeCompactKVTokens(KVTokenCompactionParams const& params, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
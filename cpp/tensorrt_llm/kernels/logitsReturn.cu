@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/logitsReturn.h"
+
+#include <cub/cub.cuh>
+#include <cuda_fp16.h>
+#ifdef ENABLE_BF16
+#include <cuda_bf16.h>
+#endif
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+constexpr int32_t kBlockSize = 256;
+
+template <typename TIn, typename TOut>
+__global__ void compactLogitsKernel(TIn const* in, TOut* out, int32_t vocabSize, int32_t vocabSizePadded)
+{
+    auto const row = static_cast<int64_t>(blockIdx.y);
+    for (int32_t vi = blockIdx.x * blockDim.x + threadIdx.x; vi < vocabSize; vi += blockDim.x * gridDim.x)
+    {
+        out[row * vocabSize + vi] = cuda_cast<TOut>(in[row * vocabSizePadded + vi]);
+    }
+}
+
+template <typename T>
+__global__ void rowLogSumExpKernel(T const* logits, float* lse, int32_t vocabSize)
+{
+    using BlockReduce = cub::BlockReduce<float, kBlockSize>;
+    __shared__ typename BlockReduce::TempStorage tempStorage;
+    __shared__ float rowMax;
+
+    auto const* rowLogits = logits + static_cast<int64_t>(blockIdx.x) * vocabSize;
+    float threadMax = -FLT_MAX;
+    for (int32_t vi = threadIdx.x; vi < vocabSize; vi += kBlockSize)
+    {
+        threadMax = fmaxf(threadMax, static_cast<float>(rowLogits[vi]));
+    }
+    auto const blockMax = BlockReduce(tempStorage).Reduce(threadMax, cub::Max());
+    if (threadIdx.x == 0)
+    {
+        rowMax = blockMax;
+    }
+    __syncthreads();
+
+    float threadSum = 0.f;
+    for (int32_t vi = threadIdx.x; vi < vocabSize; vi += kBlockSize)
+    {
+        threadSum += __expf(static_cast<float>(rowLogits[vi]) - rowMax);
+    }
+    auto const blockSum = BlockReduce(tempStorage).Sum(threadSum);
+    if (threadIdx.x == 0)
+    {
+        lse[blockIdx.x] = rowMax + __logf(blockSum);
+    }
+}
+
+template <typename T>
+__global__ void topKLogProbsKernel(T const* topKLogits, float const* lse, float* logProbs, int32_t numRows, int32_t k)
+{
+    auto const idx = static_cast<int64_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+    if (idx < static_cast<int64_t>(numRows) * k)
+    {
+        logProbs[idx] = static_cast<float>(topKLogits[idx]) - lse[idx / k];
+    }
+}
+
+} // namespace
+
+template <typename TIn, typename TOut>
+void invokeCompactLogits(TIn const* in, TOut* out, int32_t numRows, int32_t vocabSize, int32_t vocabSizePadded,
+    cudaStream_t stream)
+{
+    if (numRows == 0)
+    {
+        return;
+    }
+    TLLM_CHECK(vocabSize <= vocabSizePadded);
+    dim3 const grid(std::min(static_cast<int32_t>(divUp(vocabSize, kBlockSize)), 64), numRows);
+    compactLogitsKernel<TIn, TOut><<<grid, kBlockSize, 0, stream>>>(in, out, vocabSize, vocabSizePadded);
+    sync_check_cuda_error();
+}
+
+template <typename T>
+void invokeRowLogSumExp(T const* logits, float* lse, int32_t numRows, int32_t vocabSize, cudaStream_t stream)
+{
+    if (numRows == 0)
+    {
+        return;
+    }
+    rowLogSumExpKernel<T><<<numRows, kBlockSize, 0, stream>>>(logits, lse, vocabSize);
+    sync_check_cuda_error();
+}
+
+template <typename T>
+void invokeTopKLogProbs(
+    T const* topKLogits, float const* lse, float* logProbs, int32_t numRows, int32_t k, cudaStream_t stream)
+{
+    auto const numElements = numRows * k;
+    if (numElements == 0)
+    {
+        return;
+    }
+    topKLogProbsKernel<T><<<divUp(numElements, kBlockSize), kBlockSize, 0, stream>>>(
+        topKLogits, lse, logProbs, numRows, k);
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_COMPACT_LOGITS(TIn, TOut)                                                                          \
+    template void invokeCompactLogits<TIn, TOut>(TIn const* in, TOut* out, int32_t numRows, int32_t vocabSize,         \
+        int32_t vocabSizePadded, cudaStream_t stream)
+
+#define INSTANTIATE_LOGITS_REDUCTIONS(T)                                                                               \
+    template void invokeRowLogSumExp<T>(                                                                               \
+        T const* logits, float* lse, int32_t numRows, int32_t vocabSize, cudaStream_t stream);                         \
+    template void invokeTopKLogProbs<T>(                                                                               \
+        T const* topKLogits, float const* lse, float* logProbs, int32_t numRows, int32_t k, cudaStream_t stream)
+
+INSTANTIATE_COMPACT_LOGITS(float, float);
+INSTANTIATE_COMPACT_LOGITS(float, half);
+INSTANTIATE_COMPACT_LOGITS(half, float);
+INSTANTIATE_COMPACT_LOGITS(half, half);
+INSTANTIATE_LOGITS_REDUCTIONS(float);
+INSTANTIATE_LOGITS_REDUCTIONS(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_COMPACT_LOGITS(__nv_bfloat16, float);
+INSTANTIATE_COMPACT_LOGITS(__nv_bfloat16, half);
+INSTANTIATE_COMPACT_LOGITS(__nv_bfloat16, __nv_bfloat16);
+INSTANTIATE_LOGITS_REDUCTIONS(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_COMPACT_LOGITS
+#undef INSTANTIATE_LOGITS_REDUCTIONS
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Copy the first vocabSize logits of every row, dropping the padding of the vocabulary and converting them.
+//! \param in [numRows, vocabSizePadded].
+//! \param out [numRows, vocabSize].
+template <typename TIn, typename TOut>
+void invokeCompactLogits(TIn const* in, TOut* out, int32_t numRows, int32_t vocabSize, int32_t vocabSizePadded,
+    cudaStream_t stream);
+
+//! \brief Log of the sum of the exponentials of every row of logits [numRows, vocabSize], into lse [numRows].
+template <typename T>
+void invokeRowLogSumExp(T const* logits, float* lse, int32_t numRows, int32_t vocabSize, cudaStream_t stream);
+
+//! \brief Log-probabilities of the top-k logits [numRows, k] of rows whose log-sum-exp is lse [numRows].
+template <typename T>
+void invokeTopKLogProbs(
+    T const* topKLogits, float const* lse, float* logProbs, int32_t numRows, int32_t k, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
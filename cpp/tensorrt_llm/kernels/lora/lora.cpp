@@ -19,12 +19,18 @@
 
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/cublasMMWrapper.h"
+#include "tensorrt_llm/common/cudaBf16Wrapper.h"
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/memoryUtils.h"
+#include "tensorrt_llm/kernels/doraScaling.h"
 #include "tensorrt_llm/kernels/groupGemm.h"
+#include "tensorrt_llm/kernels/loraSgmvKernels.h"
 #include "tensorrt_llm/kernels/splitkGroupGemm.h"
 #include "tensorrt_llm/runtime/iBuffer.h"
 
 #include <algorithm>
+#include <iterator>
 
 using namespace nvinfer1;
 using namespace tensorrt_llm::common;
@@ -110,6 +116,19 @@ int64_t getGemmParamsWorkSpaceSize(int64_t nbReq)
     return std::max(getSplitkGroupedGemmParamsWorkSpaceSize(nbReq), getGroupedGemmParamsWorkSpaceSize(nbReq));
 }
 
+// Device tables of the adapters and the adapter of every token
+int64_t getSgmvParamsWorkSpaceSize(int64_t numTokens, int64_t numAdapters, int64_t numLoraModules)
+{
+    auto const tablesSize = numLoraModules * numAdapters * (3 * sizeof(int64_t) + sizeof(int32_t));
+    return divUp(tablesSize + numTokens * sizeof(int32_t), 16) * 16;
+}
+
+// The hidden size and the magnitude of every token of every module for the DoRA epilogue of the GEMM paths
+int64_t getDoraEpilogueWorkSpaceSize(int64_t numTokens, int64_t numLoraModules)
+{
+    return divUp(numLoraModules * (1 + numTokens) * sizeof(int64_t), 16) * 16;
+}
+
 int64_t getSplitkGroupedGemmWorkSpaceSize(
     int64_t numTokens, int64_t maxLoraModuleNum, int64_t maxLowRank, int64_t splitKSlices)
 {
@@ -130,7 +149,9 @@ size_t LoraImpl::getWorkspaceSize(
 
     return (size_t) getGemmWorkSpaceSize(numTokens, mNumLoraModules, mMaxLowRank, mSplitKSlices)
         + getLowRankWorkSpaceSize(numTokens, mNumLoraModules, mMaxLowRank, typeSize)
-        + getGemmParamsWorkSpaceSize(std::min(numReqs, numTokens) * mNumLoraModules);
+        + getGemmParamsWorkSpaceSize(std::min(numReqs, numTokens) * mNumLoraModules)
+        + getSgmvParamsWorkSpaceSize(numTokens, std::min(numReqs, numTokens), mNumLoraModules)
+        + getDoraEpilogueWorkSpaceSize(numTokens, mNumLoraModules);
 }
 
 void LoraImpl::setBestTactic(std::optional<Config> config)
@@ -140,6 +161,14 @@ void LoraImpl::setBestTactic(std::optional<Config> config)
 
 int LoraImpl::run(int64_t numTokens, int64_t numReqs, void const* input, int32_t const* loraRanks,
     void const* const* loraWeightsPtr, int weightIndex, void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    return run(numTokens, numReqs, input, loraRanks, loraWeightsPtr, weightIndex, outputs, workspace, stream,
+        DoraEpilogue{});
+}
+
+int LoraImpl::run(int64_t numTokens, int64_t numReqs, void const* input, int32_t const* loraRanks,
+    void const* const* loraWeightsPtr, int weightIndex, void* const* outputs, void* workspace, cudaStream_t stream,
+    DoraEpilogue const& dora)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
     // inputs
@@ -166,6 +195,11 @@ int LoraImpl::run(int64_t numTokens, int64_t numReqs, void const* input, int32_t
     void* lowRankWorkSpace = static_cast<char*>(gemmWorkSpace) + GemmWorkSpaceSize;
     void* groupGemmParamsWorkSpace = static_cast<char*>(lowRankWorkSpace)
         + getLowRankWorkSpaceSize(numTokens, mNumLoraModules, mMaxLowRank, typeSize);
+    void* sgmvParamsWorkSpace = static_cast<char*>(groupGemmParamsWorkSpace) + groupGemmParamsWorkSpaceSize;
+    void* doraWorkSpace = static_cast<char*>(sgmvParamsWorkSpace)
+        + getSgmvParamsWorkSpaceSize(numTokens, std::min(numReqs, numTokens), mNumLoraModules);
+    TLLM_CHECK_WITH_INFO((dora.residuals == nullptr) == (dora.magnitudePtrs == nullptr),
+        "The DoRA epilogue needs both the residuals and the magnitudes");
 
     for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
     {
@@ -229,6 +263,16 @@ int LoraImpl::run(int64_t numTokens, int64_t numReqs, void const* input, int32_t
             }
         }
     }
+    else if (numTokens <= getEnvLoraSgmvMaxTokens() && mNumLoraModules <= LoraSgmvParams::kMaxModules
+        && mInHiddenSize * typeSize % 16 == 0)
+    {
+        // Few tokens with several adapters: the host setup of the grouped GEMMs and their padding of the ranks cost
+        // more than the gather matmuls.
+        runSgmv(numTokens, input, loraRanks, loraWeightsPtr, weightIndex, outputs, lowRankWorkSpace,
+            sgmvParamsWorkSpace, dora, stream);
+        // The expand applies the DoRA epilogue.
+        return 0;
+    }
     else
     {
         std::vector<cutlass::gemm::GemmCoord> problem_sizes;
@@ -334,7 +378,163 @@ int LoraImpl::run(int64_t numTokens, int64_t numReqs, void const* input, int32_t
         }
     }
 
+    if (dora.residuals != nullptr)
+    {
+        runDoraEpilogue(numTokens, outputs, dora, doraWorkSpace, stream);
+    }
+
     return 0;
 }
 
+void LoraImpl::runSgmv(int64_t numTokens, void const* input, int32_t const* loraRanks,
+    void const* const* loraWeightsPtr, int weightIndex, void* const* outputs, void* lowRankWorkSpace,
+    void* sgmvParamsWorkSpace, DoraEpilogue const& dora, cudaStream_t stream) const
+{
+    // The contiguous tokens with the same weights and ranks in all the modules share an adapter, as the tokens of a
+    // request do.
+    std::vector<int32_t> tokenAdapters(numTokens);
+    std::vector<int64_t> adapterFirstTokens;
+    for (int64_t rowId = 0; rowId < numTokens; rowId++)
+    {
+        bool newAdapter = rowId == 0;
+        for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules && !newAdapter; loraModuleIdx++)
+        {
+            auto const idx = loraModuleIdx * numTokens + rowId;
+            newAdapter = loraRanks[idx] != loraRanks[idx - 1] || loraWeightsPtr[idx * 2] != loraWeightsPtr[idx * 2 - 2]
+                || loraWeightsPtr[idx * 2 + 1] != loraWeightsPtr[idx * 2 - 1];
+        }
+        if (newAdapter)
+        {
+            adapterFirstTokens.push_back(rowId);
+        }
+        tokenAdapters[rowId] = static_cast<int32_t>(adapterFirstTokens.size()) - 1;
+    }
+    auto const numAdapters = static_cast<int64_t>(adapterFirstTokens.size());
+
+    // [adapterWeightPtrs, adapterMagnitudePtrs, adapterRanks, tokenAdapters], staged on the host as the grouped GEMMs
+    // stage their params
+    auto const ptrsSize = mNumLoraModules * numAdapters * 2 * sizeof(int64_t);
+    auto const magnitudesSize = mNumLoraModules * numAdapters * sizeof(int64_t);
+    auto const ranksSize = mNumLoraModules * numAdapters * sizeof(int32_t);
+    std::vector<int8_t> hostParams(ptrsSize + magnitudesSize + ranksSize + numTokens * sizeof(int32_t));
+    auto* adapterWeightPtrs = reinterpret_cast<int64_t*>(hostParams.data());
+    auto* adapterMagnitudePtrs = reinterpret_cast<int64_t*>(hostParams.data() + ptrsSize);
+    auto* adapterRanks = reinterpret_cast<int32_t*>(hostParams.data() + ptrsSize + magnitudesSize);
+    for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
+    {
+        for (int64_t adapter = 0; adapter < numAdapters; adapter++)
+        {
+            auto const idx = loraModuleIdx * numTokens + adapterFirstTokens[adapter];
+            auto const rank = loraRanks[idx];
+            TLLM_CHECK_WITH_INFO(rank <= mMaxLowRank,
+                fmtstr("Invalid low_rank (%d). low_rank must be smaller than mMaxLowRank (%d)", rank, mMaxLowRank));
+            auto const tableIdx = loraModuleIdx * numAdapters + adapter;
+            adapterRanks[tableIdx] = rank;
+            adapterWeightPtrs[tableIdx * 2] = reinterpret_cast<int64_t>(loraWeightsPtr[idx * 2]);
+            adapterWeightPtrs[tableIdx * 2 + 1] = reinterpret_cast<int64_t>(loraWeightsPtr[idx * 2 + 1]);
+            adapterMagnitudePtrs[tableIdx]
+                = dora.magnitudePtrs == nullptr ? 0 : reinterpret_cast<int64_t>(dora.magnitudePtrs[idx]);
+        }
+    }
+    std::copy(tokenAdapters.begin(), tokenAdapters.end(),
+        reinterpret_cast<int32_t*>(hostParams.data() + ptrsSize + magnitudesSize + ranksSize));
+    auto* deviceParams = static_cast<int8_t*>(sgmvParamsWorkSpace);
+    cudaAutoCpy(deviceParams, hostParams.data(), hostParams.size(), stream);
+
+    LoraSgmvParams params;
+    params.input = input;
+    params.adapterWeightPtrs = reinterpret_cast<int64_t const*>(deviceParams);
+    params.adapterMagnitudePtrs
+        = dora.magnitudePtrs == nullptr ? nullptr : reinterpret_cast<int64_t const*>(deviceParams + ptrsSize);
+    params.adapterRanks = reinterpret_cast<int32_t const*>(deviceParams + ptrsSize + magnitudesSize);
+    params.tokenAdapters = reinterpret_cast<int32_t const*>(deviceParams + ptrsSize + magnitudesSize + ranksSize);
+    params.lowRank = lowRankWorkSpace;
+    for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
+    {
+        params.outputs[loraModuleIdx] = outputs[loraModuleIdx];
+        params.outHiddenSizes[loraModuleIdx] = mOutHiddenSizes[loraModuleIdx];
+        params.residuals[loraModuleIdx] = dora.residuals == nullptr ? nullptr : dora.residuals[loraModuleIdx];
+    }
+    params.numTokens = numTokens;
+    params.numAdapters = numAdapters;
+    params.numModules = mNumLoraModules;
+    params.inHiddenSize = mInHiddenSize;
+    params.maxLowRank = mMaxLowRank;
+    params.weightIndex = weightIndex;
+
+    if (mType == DataType::kHALF)
+    {
+        invokeLoraSgmvShrink<half>(params, stream);
+        invokeLoraSgmvExpand<half>(params, stream);
+    }
+    else if (mType == DataType::kFLOAT)
+    {
+        invokeLoraSgmvShrink<float>(params, stream);
+        invokeLoraSgmvExpand<float>(params, stream);
+    }
+#ifdef ENABLE_BF16
+    else if (mType == DataType::kBF16)
+    {
+        invokeLoraSgmvShrink<__nv_bfloat16>(params, stream);
+        invokeLoraSgmvExpand<__nv_bfloat16>(params, stream);
+    }
+#endif
+    else
+    {
+        TLLM_THROW("Unsupported data type for the LoRA SGMV kernels");
+    }
+}
+
+void LoraImpl::runDoraEpilogue(
+    int64_t numTokens, void* const* outputs, DoraEpilogue const& dora, void* doraWorkSpace, cudaStream_t stream) const
+{
+    // [outHiddenSize, magnitude of every token] for every module, in one copy
+    std::vector<int64_t> hostParams;
+    hostParams.reserve(mNumLoraModules * (1 + numTokens));
+    for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
+    {
+        hostParams.push_back(mOutHiddenSizes[loraModuleIdx]);
+        std::transform(dora.magnitudePtrs + loraModuleIdx * numTokens,
+            dora.magnitudePtrs + (loraModuleIdx + 1) * numTokens, std::back_inserter(hostParams),
+            [](void const* ptr) { return reinterpret_cast<int64_t>(ptr); });
+    }
+    auto* deviceParams = static_cast<int64_t*>(doraWorkSpace);
+    cudaAutoCpy(reinterpret_cast<int8_t*>(deviceParams), reinterpret_cast<int8_t const*>(hostParams.data()),
+        hostParams.size() * sizeof(int64_t), stream);
+
+    for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
+    {
+        auto const* moduleParams = deviceParams + loraModuleIdx * (1 + numTokens);
+        auto const numel = numTokens * mOutHiddenSizes[loraModuleIdx];
+        void const* residual = dora.residuals[loraModuleIdx];
+        void* output = outputs[loraModuleIdx];
+        if (mType == DataType::kHALF)
+        {
+            tokenPerChannelScaleResidual<half>(numel, 1, numTokens, moduleParams, static_cast<half const*>(output),
+                static_cast<half const*>(residual), reinterpret_cast<half const* const*>(moduleParams + 1),
+                static_cast<half*>(output), stream);
+        }
+        else if (mType == DataType::kFLOAT)
+        {
+            tokenPerChannelScaleResidual<float>(numel, 1, numTokens, moduleParams, static_cast<float const*>(output),
+                static_cast<float const*>(residual), reinterpret_cast<float const* const*>(moduleParams + 1),
+                static_cast<float*>(output), stream);
+        }
+#ifdef ENABLE_BF16
+        else if (mType == DataType::kBF16)
+        {
+            tokenPerChannelScaleResidual<__nv_bfloat16>(numel, 1, numTokens, moduleParams,
+                static_cast<__nv_bfloat16 const*>(output), static_cast<__nv_bfloat16 const*>(residual),
+                reinterpret_cast<__nv_bfloat16 const* const*>(moduleParams + 1), static_cast<__nv_bfloat16*>(output),
+                stream);
+        }
+#endif
+        else
+        {
+            TLLM_THROW("Unsupported data type for the DoRA epilogue");
+        }
+        sync_check_cuda_error();
+    }
+}
+
 } // namespace tensorrt_llm::kernels
@@ -41,8 +41,21 @@ public:
     size_t getWorkspaceSize(
         int64_t const numTokens, int64_t const numReqs, nvinfer1::DataType const type) const noexcept;
     void setBestTactic(std::optional<Config> config);
+    // The DoRA scaling fused with the LoRA: outputs[m] = magnitude * (residuals[m] + lora), instead of the add of the
+    // base output and the DoRA plugin as passes of their own.
+    struct DoraEpilogue
+    {
+        // The base outputs of the modules, [numTokens, outHiddenSizes[m]] for module m.
+        void const* const* residuals{nullptr};
+        // The magnitude of every token in every module [mNumLoraModules, numTokens] on cpu, null for LoRA adapters.
+        void const* const* magnitudePtrs{nullptr};
+    };
+
     int run(int64_t numTokens, int64_t numReqs, void const* input, int32_t const* loraRanks,
         void const* const* loraWeightsPtr, int weightIndex, void* const* outputs, void* workspace, cudaStream_t stream);
+    int run(int64_t numTokens, int64_t numReqs, void const* input, int32_t const* loraRanks,
+        void const* const* loraWeightsPtr, int weightIndex, void* const* outputs, void* workspace, cudaStream_t stream,
+        DoraEpilogue const& dora);
 
     void setGemmConfig();
 
@@ -57,6 +70,15 @@ public:
     CublasGemmWrapperPtr mCublasWrapper;
 
 private:
+    // Runs the modules with the segmented gather matmuls, an adapter per run of tokens with the same weights.
+    void runSgmv(int64_t numTokens, void const* input, int32_t const* loraRanks, void const* const* loraWeightsPtr,
+        int weightIndex, void* const* outputs, void* lowRankWorkSpace, void* sgmvParamsWorkSpace,
+        DoraEpilogue const& dora, cudaStream_t stream) const;
+
+    // Applies the DoRA epilogue to the outputs of the GEMM paths in one pass per module.
+    void runDoraEpilogue(int64_t numTokens, void* const* outputs, DoraEpilogue const& dora, void* doraWorkSpace,
+        cudaStream_t stream) const;
+
     int mInHiddenSize;
     std::vector<int> mOutHiddenSizes;
     int mMaxLowRank;
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaBf16Wrapper.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/loraMergeKernels.h"
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+namespace
+{
+
+int32_t constexpr kTile = 32;
+int32_t constexpr kRowsPerThread = 4;
+int32_t constexpr kBlockRows = kTile / kRowsPerThread;
+int32_t constexpr kBlockSize = kTile * kBlockRows;
+
+// Grid: [divUp(inHiddenSize, kTile), divUp(outHiddenSize, kTile)], a tile of the weight per CTA. The fast thread index
+// runs along the contiguous dimension of the weight, the in or the out hidden dimension if transposed.
+template <typename T>
+__global__ void __launch_bounds__(kBlockSize) loraMergeKernel(T* merged, T const* base, T const* inWeights,
+    T const* outWeights, int32_t outHiddenSize, int32_t inHiddenSize, int32_t rank, bool transposed)
+{
+    __shared__ float outTile[kTile][kTile + 1]; // [out, rank]
+    __shared__ float inTile[kTile][kTile + 1];  // [rank, in]
+
+    auto const inOffset = static_cast<int32_t>(blockIdx.x) * kTile;
+    auto const outOffset = static_cast<int32_t>(blockIdx.y) * kTile;
+    auto const tid = static_cast<int32_t>(threadIdx.y * kTile + threadIdx.x);
+
+    float acc[kRowsPerThread] = {};
+    for (int32_t rankOffset = 0; rankOffset < rank; rankOffset += kTile)
+    {
+        for (int32_t idx = tid; idx < kTile * kTile; idx += kBlockSize)
+        {
+            auto const row = idx / kTile;
+            auto const col = idx % kTile;
+            auto const outIdx = outOffset + row;
+            auto const rankIdx = rankOffset + col;
+            outTile[row][col] = outIdx < outHiddenSize && rankIdx < rank
+                ? cuda_cast<float>(outWeights[static_cast<int64_t>(outIdx) * rank + rankIdx])
+                : 0.f;
+            auto const inRankIdx = rankOffset + row;
+            auto const inIdx = inOffset + col;
+            inTile[row][col] = inRankIdx < rank && inIdx < inHiddenSize
+                ? cuda_cast<float>(inWeights[static_cast<int64_t>(inRankIdx) * inHiddenSize + inIdx])
+                : 0.f;
+        }
+        __syncthreads();
+#pragma unroll
+        for (int32_t row = 0; row < kRowsPerThread; ++row)
+        {
+            auto const slow = static_cast<int32_t>(threadIdx.y) + row * kBlockRows;
+            auto const outLocal = transposed ? static_cast<int32_t>(threadIdx.x) : slow;
+            auto const inLocal = transposed ? slow : static_cast<int32_t>(threadIdx.x);
+#pragma unroll 8
+            for (int32_t r = 0; r < kTile; ++r)
+            {
+                acc[row] += outTile[outLocal][r] * inTile[r][inLocal];
+            }
+        }
+        __syncthreads();
+    }
+
+#pragma unroll
+    for (int32_t row = 0; row < kRowsPerThread; ++row)
+    {
+        auto const slow = static_cast<int32_t>(threadIdx.y) + row * kBlockRows;
+        auto const outIdx = outOffset + (transposed ? static_cast<int32_t>(threadIdx.x) : slow);
+        auto const inIdx = inOffset + (transposed ? slow : static_cast<int32_t>(threadIdx.x));
+        if (outIdx < outHiddenSize && inIdx < inHiddenSize)
+        {
+            auto const idx = transposed ? static_cast<int64_t>(inIdx) * outHiddenSize + outIdx
+                                        : static_cast<int64_t>(outIdx) * inHiddenSize + inIdx;
+            merged[idx] = cuda_cast<T>(cuda_cast<float>(base[idx]) + acc[row]);
+        }
+    }
+}
+
+} // namespace
+
+template <typename T>
+void invokeLoraMerge(T* merged, T const* base, T const* inWeights, T const* outWeights, int32_t outHiddenSize,
+    int32_t inHiddenSize, int32_t rank, bool transposed, cudaStream_t stream)
+{
+    TLLM_CHECK(merged && base && inWeights && outWeights);
+    TLLM_CHECK(outHiddenSize > 0 && inHiddenSize > 0 && rank > 0);
+    dim3 const grid(divUp(inHiddenSize, kTile), divUp(outHiddenSize, kTile));
+    dim3 const block(kTile, kBlockRows);
+    loraMergeKernel<T><<<grid, block, 0, stream>>>(
+        merged, base, inWeights, outWeights, outHiddenSize, inHiddenSize, rank, transposed);
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_LORA_MERGE(T)                                                                                      \
+    template void invokeLoraMerge<T>(T * merged, T const* base, T const* inWeights, T const* outWeights,               \
+        int32_t outHiddenSize, int32_t inHiddenSize, int32_t rank, bool transposed, cudaStream_t stream)
+
+INSTANTIATE_LORA_MERGE(float);
+INSTANTIATE_LORA_MERGE(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_LORA_MERGE(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_LORA_MERGE
+
+} // namespace tensorrt_llm::kernels
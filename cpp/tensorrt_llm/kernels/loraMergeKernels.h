@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief merged = base + outWeights * inWeights, the weight of a linear layer with a LoRA adapter folded in.
+//! \details base and merged are [outHiddenSize, inHiddenSize], or [inHiddenSize, outHiddenSize] if transposed. The
+//! in weights are [rank, inHiddenSize] and the out weights [outHiddenSize, rank], the layout of the LoRA cache pages.
+//! merged may alias base. The products are accumulated in float.
+template <typename T>
+void invokeLoraMerge(T* merged, T const* base, T const* inWeights, T const* outWeights, int32_t outHiddenSize,
+    int32_t inHiddenSize, int32_t rank, bool transposed, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaBf16Wrapper.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/loraSgmvKernels.h"
+
+#include <algorithm>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+namespace
+{
+
+int32_t constexpr kWarpSize = 32;
+int32_t constexpr kWarpsPerCta = 4;
+int32_t constexpr kBlockSize = kWarpsPerCta * kWarpSize;
+
+// Grid: [maxLowRank / kWarpsPerCta, numTokens, numModules], a warp per rank of a token.
+template <typename T>
+__global__ void __launch_bounds__(kBlockSize) loraSgmvShrinkKernel(LoraSgmvParams params)
+{
+    int32_t constexpr kElemsPerVec = sizeof(uint4) / sizeof(T);
+
+    auto const moduleIdx = static_cast<int32_t>(blockIdx.z);
+    auto const tokenIdx = static_cast<int32_t>(blockIdx.y);
+    auto const rankIdx
+        = static_cast<int32_t>(blockIdx.x) * kWarpsPerCta + static_cast<int32_t>(threadIdx.x) / kWarpSize;
+    auto const laneIdx = static_cast<int32_t>(threadIdx.x) % kWarpSize;
+    auto const adapter = params.tokenAdapters[tokenIdx];
+    if (adapter < 0)
+    {
+        return;
+    }
+    auto const tableIdx = moduleIdx * params.numAdapters + adapter;
+    auto const rank = params.adapterRanks[tableIdx];
+    if (rankIdx >= rank)
+    {
+        return;
+    }
+
+    int64_t const hiddenSize = params.inHiddenSize;
+    auto const* weights = reinterpret_cast<T const*>(params.adapterWeightPtrs[tableIdx * 2]);
+    auto const* weight = reinterpret_cast<uint4 const*>(
+        weights + (static_cast<int64_t>(params.weightIndex) * rank + rankIdx) * hiddenSize);
+    auto const* input = reinterpret_cast<uint4 const*>(static_cast<T const*>(params.input) + tokenIdx * hiddenSize);
+
+    float acc = 0.f;
+    for (int64_t idx = laneIdx; idx < hiddenSize / kElemsPerVec; idx += kWarpSize)
+    {
+        auto const inputVec = input[idx];
+        auto const weightVec = weight[idx];
+        auto const* inputElems = reinterpret_cast<T const*>(&inputVec);
+        auto const* weightElems = reinterpret_cast<T const*>(&weightVec);
+#pragma unroll
+        for (int32_t elem = 0; elem < kElemsPerVec; ++elem)
+        {
+            acc += cuda_cast<float>(inputElems[elem]) * cuda_cast<float>(weightElems[elem]);
+        }
+    }
+    for (int32_t offset = kWarpSize / 2; offset > 0; offset /= 2)
+    {
+        acc += __shfl_xor_sync(0xffffffff, acc, offset);
+    }
+    if (laneIdx == 0)
+    {
+        auto* lowRank = static_cast<T*>(params.lowRank);
+        lowRank[(static_cast<int64_t>(moduleIdx) * params.numTokens + tokenIdx) * params.maxLowRank + rankIdx]
+            = cuda_cast<T>(acc);
+    }
+}
+
+// Grid: [max outHiddenSizes / kBlockSize, numTokens, numModules], a thread per output channel. The low rank row of the
+// token is staged in the dynamic shared memory.
+template <typename T>
+__global__ void __launch_bounds__(kBlockSize) loraSgmvExpandKernel(LoraSgmvParams params)
+{
+    extern __shared__ float lowRankRow[];
+
+    auto const moduleIdx = static_cast<int32_t>(blockIdx.z);
+    auto const tokenIdx = static_cast<int32_t>(blockIdx.y);
+    int64_t const hiddenSize = params.outHiddenSizes[moduleIdx];
+    auto const channel = static_cast<int64_t>(blockIdx.x) * kBlockSize + threadIdx.x;
+    auto const* residual = static_cast<T const*>(params.residuals[moduleIdx]);
+    auto* output = static_cast<T*>(params.outputs[moduleIdx]);
+
+    auto const adapter = params.tokenAdapters[tokenIdx];
+    auto const tableIdx = moduleIdx * params.numAdapters + adapter;
+    if (adapter < 0 || params.adapterRanks[tableIdx] == 0)
+    {
+        if (residual != nullptr && channel < hiddenSize)
+        {
+            output[tokenIdx * hiddenSize + channel] = residual[tokenIdx * hiddenSize + channel];
+        }
+        return;
+    }
+    auto const rank = params.adapterRanks[tableIdx];
+
+    auto const* lowRank = static_cast<T const*>(params.lowRank)
+        + (static_cast<int64_t>(moduleIdx) * params.numTokens + tokenIdx) * params.maxLowRank;
+    for (int32_t idx = threadIdx.x; idx < rank; idx += kBlockSize)
+    {
+        lowRankRow[idx] = cuda_cast<float>(lowRank[idx]);
+    }
+    __syncthreads();
+
+    if (channel >= hiddenSize)
+    {
+        return;
+    }
+    auto const* weight = reinterpret_cast<T const*>(params.adapterWeightPtrs[tableIdx * 2 + 1])
+        + (static_cast<int64_t>(params.weightIndex) * hiddenSize + channel) * rank;
+    float acc = 0.f;
+    for (int32_t idx = 0; idx < rank; ++idx)
+    {
+        acc += lowRankRow[idx] * cuda_cast<float>(weight[idx]);
+    }
+    // The DoRA epilogue, so that the magnitudes cost no pass over the outputs of their own.
+    if (residual != nullptr)
+    {
+        acc += cuda_cast<float>(residual[tokenIdx * hiddenSize + channel]);
+    }
+    if (params.adapterMagnitudePtrs != nullptr && params.adapterMagnitudePtrs[tableIdx] != 0)
+    {
+        acc *= cuda_cast<float>(reinterpret_cast<T const*>(params.adapterMagnitudePtrs[tableIdx])[channel]);
+    }
+    output[tokenIdx * hiddenSize + channel] = cuda_cast<T>(acc);
+}
+
+} // namespace
+
+template <typename T>
+void invokeLoraSgmvShrink(LoraSgmvParams const& params, cudaStream_t stream)
+{
+    params.checkParams();
+    auto constexpr kElemsPerVec = static_cast<int32_t>(sizeof(uint4) / sizeof(T));
+    TLLM_CHECK_WITH_INFO(params.inHiddenSize % kElemsPerVec == 0,
+        "The LoRA SGMV shrink needs an input hidden size multiple of %d, got %d", kElemsPerVec, params.inHiddenSize);
+    if (params.numTokens <= 0)
+    {
+        return;
+    }
+
+    dim3 const grid(divUp(params.maxLowRank, kWarpsPerCta), params.numTokens, params.numModules);
+    loraSgmvShrinkKernel<T><<<grid, kBlockSize, 0, stream>>>(params);
+    sync_check_cuda_error();
+}
+
+template <typename T>
+void invokeLoraSgmvExpand(LoraSgmvParams const& params, cudaStream_t stream)
+{
+    params.checkParams();
+    if (params.numTokens <= 0)
+    {
+        return;
+    }
+
+    auto const maxHiddenSize = *std::max_element(params.outHiddenSizes, params.outHiddenSizes + params.numModules);
+    dim3 const grid(divUp(maxHiddenSize, kBlockSize), params.numTokens, params.numModules);
+    loraSgmvExpandKernel<T><<<grid, kBlockSize, params.maxLowRank * sizeof(float), stream>>>(params);
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_LORA_SGMV(T)                                                                                       \
+    template void invokeLoraSgmvShrink<T>(LoraSgmvParams const& params, cudaStream_t stream);                         \
+    template void invokeLoraSgmvExpand<T>(LoraSgmvParams const& params, cudaStream_t stream)
+
+INSTANTIATE_LORA_SGMV(float);
+INSTANTIATE_LORA_SGMV(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_LORA_SGMV(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_LORA_SGMV
+
+} // namespace tensorrt_llm::kernels
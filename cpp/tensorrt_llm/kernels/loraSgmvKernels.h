@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+// Segmented gather matmuls of the LoRA modules of a layer. Every token gathers the weights of its adapter from device
+// tables, so that the adapters and their ranks need no per-request problem on the host and any number of them runs in
+// one launch of the shrink and one of the expand.
+struct LoraSgmvParams
+{
+    static int32_t constexpr kMaxModules = 8;
+
+    // [numTokens, inHiddenSize]
+    void const* input{nullptr};
+    // Adapter of every token, < 0 for the tokens without LoRA [numTokens].
+    int32_t const* tokenAdapters{nullptr};
+    // Rank of every adapter in every module, 0 for no LoRA [numModules, numAdapters].
+    int32_t const* adapterRanks{nullptr};
+    // Addresses of the in weights [rank, inHiddenSize] and of the out weights [outHiddenSize, rank] of every adapter in
+    // every module [numModules, numAdapters, 2].
+    int64_t const* adapterWeightPtrs{nullptr};
+    // Output of the shrink [numModules, numTokens, maxLowRank].
+    void* lowRank{nullptr};
+    // Outputs of the expand, [numTokens, outHiddenSizes[m]] for module m. The rows of the tokens without LoRA are not
+    // written.
+    void* outputs[kMaxModules]{};
+    int32_t outHiddenSizes[kMaxModules]{};
+    // Base outputs added in the epilogue of the expand for the fused DoRA, [numTokens, outHiddenSizes[m]] for module
+    // m. With residuals the rows of the tokens without LoRA are written with the residual.
+    void const* residuals[kMaxModules]{};
+    // Addresses of the DoRA magnitudes [outHiddenSize] of every adapter in every module, 0 for the LoRA adapters
+    // [numModules, numAdapters]. The epilogue scales the output with them, residual included.
+    int64_t const* adapterMagnitudePtrs{nullptr};
+    int32_t numTokens{0};
+    int32_t numAdapters{0};
+    int32_t numModules{0};
+    int32_t inHiddenSize{0};
+    int32_t maxLowRank{0};
+    // Layer of the weights, which are stacked by layer.
+    int32_t weightIndex{0};
+
+    void checkParams() const
+    {
+        TLLM_CHECK(input && tokenAdapters && adapterRanks && adapterWeightPtrs && lowRank);
+        TLLM_CHECK_WITH_INFO(numModules > 0 && numModules <= kMaxModules,
+            "The LoRA SGMV kernels support up to %d modules, got %d", kMaxModules, numModules);
+        TLLM_CHECK(inHiddenSize > 0 && maxLowRank > 0);
+    }
+};
+
+//! \brief lowRank[m, t, :rank] = input[t] * inWeight^T of the adapter of token t in module m. A warp computes a rank
+//! of a token, the rows of the ranks above the rank of the adapter are not written.
+template <typename T>
+void invokeLoraSgmvShrink(LoraSgmvParams const& params, cudaStream_t stream);
+
+//! \brief outputs[m][t] = lowRank[m, t, :rank] * outWeight^T of the adapter of token t in module m. With DoRA
+//! magnitudes and residuals, outputs[m][t] = magnitude * (residuals[m][t] + lowRank[m, t, :rank] * outWeight^T).
+template <typename T>
+void invokeLoraSgmvExpand(LoraSgmvParams const& params, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -324,7 +324,8 @@ __global__
                         + 2
                             * swizzle<tileD_ * 2, tileD_, T_>(
                                 i + thread * 8 + (warpL_ * laneL * pipe_ + 1 - K_) * tileD_),
-                    g_mxXs_ + sStart + (thread * 8 / tileD_) * D_ + i * (D_ / tileD_) + dStart + thread * 8 % tileD_);
+                    g_mxXs_ + blockIdx.z * (K_ - 1) * D_ + (thread * 8 / tileD_) * D_ + i * (D_ / tileD_) + dStart
+                        + thread * 8 % tileD_);
     }
     else
     {
@@ -607,7 +608,8 @@ __global__ std::enable_if_t<std::is_same_v<T_, float>> mambaConv1dContextKernel(
                         + 4
                             * swizzle<tileD_ * 4, tileD_, T_>(
                                 i + thread * 4 + (warpL_ * laneL * pipe_ + 1 - K_) * tileD_),
-                    g_mxXs_ + sStart + (thread * 4 / tileD_) * D_ + i * (D_ / tileD_) + dStart + thread * 4 % tileD_);
+                    g_mxXs_ + blockIdx.z * (K_ - 1) * D_ + (thread * 4 / tileD_) * D_ + i * (D_ / tileD_) + dStart
+                        + thread * 4 % tileD_);
     }
     else
     {
@@ -768,6 +770,28 @@ __global__ std::enable_if_t<std::is_same_v<T_, float>> mambaConv1dContextKernel(
     }
 }
 
+// The first tile of a sequence reads its initial state while the last one overwrites it in the cache, so the initial
+// states are copied by sequence before the convolution. Sequences without one start from zeros.
+template <typename T>
+__global__ void mambaConv1dGatherInitialStatesKernel(
+    T* dst, T const* src, int const* hasInitialStatePtr, int const* stateSlotMappingPtr, int stateSize)
+{
+    int const sample = blockIdx.x;
+    bool const hasInitialState = hasInitialStatePtr[sample] != 0;
+    int const slot = stateSlotMappingPtr ? stateSlotMappingPtr[sample] : sample;
+    T* sampleDst = dst + int64_t(sample) * stateSize;
+    T const* sampleSrc = src + int64_t(slot) * stateSize;
+    for (int i = threadIdx.x; i < stateSize; i += blockDim.x)
+    {
+        sampleDst[i] = hasInitialState ? sampleSrc[i] : T(0.f);
+    }
+}
+
+size_t getMambaConv1dContextWorkspaceSize(int batch, int dim, int dconv, size_t typeSize)
+{
+    return size_t(batch) * (dconv - 1) * dim * typeSize;
+}
+
 template <typename input_t>
 void invokeMambaConv1dContext(MambaConv1dParamsBase& params, cudaStream_t stream)
 {
@@ -1172,7 +1196,15 @@ void invokeMambaConv1dContext(MambaConv1dParamsBase& params, cudaStream_t stream
     input_t* ya = (input_t*) params.out_ptr;
     input_t* ys = (input_t*) params.state_out_ptr;
     input_t const* xa = (input_t const*) params.in_ptr;
-    input_t const* xs = nullptr; // (input_t const*) params.state_in_ptr;
+    input_t const* xs = nullptr;
+    if (params.has_initial_state_ptr)
+    {
+        TLLM_CHECK_WITH_INFO(params.initial_state_ptr, "Context chunks with an initial state need a workspace.");
+        mambaConv1dGatherInitialStatesKernel<input_t><<<B, 256, 0, stream>>>((input_t*) params.initial_state_ptr,
+            (input_t const*) params.state_in_ptr, params.has_initial_state_ptr, params.state_slot_mapping_ptr,
+            (K - 1) * D);
+        xs = (input_t const*) params.initial_state_ptr;
+    }
     input_t const* w = (input_t const*) params.weight_ptr;
     input_t const* b = (input_t const*) params.bias_ptr;
     bool rmpd = params.remove_padding;
@@ -1230,58 +1262,73 @@ __launch_bounds__(64, 8) __global__
     // load bias
     packed_load_to_float<input_t, CHANNELS_PER_THREAD>(bias, &reg_bias[0]);
 
+    int const num_spec_tokens = max(params.num_spec_tokens, 1);
+    int const state_size = (params.dconv - 1) * params.dim;
+    input_t* snapshots = reinterpret_cast<input_t*>(params.state_snapshot_ptr);
+
     for (int sample = micro_batch * micro_batchsize; sample < min((micro_batch + 1) * micro_batchsize, params.batch);
          ++sample)
     {
         int const slot_idx = params.state_slot_mapping_ptr == nullptr ? sample : params.state_slot_mapping_ptr[sample];
-        input_t* token_input = input + sample * num_channels_in;
-        input_t* token_output = output + sample * params.dim;
-        input_t* token_state_in = state_in + slot_idx * (params.dconv - 1) * params.dim;
-        input_t* token_state_out = state_out + slot_idx * (params.dconv - 1) * params.dim;
-#pragma unroll
-        for (int i = 0; i < DCONV - 1; ++i)
-        {
-            packed_load_to_float<input_t, CHANNELS_PER_THREAD>(token_state_in + i * params.dim, &reg_input[i][0]);
-        }
-        packed_load_to_float<input_t, CHANNELS_PER_THREAD>(token_input, &reg_input[DCONV - 1][0]);
-
-#pragma unroll
-        for (int c = 0; c < CHANNELS_PER_THREAD; ++c)
+        // The tokens of a sequence in speculative decoding each continue from the state of their parent, -1 being the
+        // state in the cache.
+        for (int t = 0; t < num_spec_tokens; ++t)
         {
-            reg_result[c] = 0.0f;
-        }
-        // conv
+            int const token = sample * num_spec_tokens + t;
+            int const parent = params.spec_parent_ptr == nullptr ? t - 1 : params.spec_parent_ptr[token];
+            input_t* token_input = input + token * num_channels_in;
+            input_t* token_output = output + token * params.dim;
+            input_t* token_state_in = parent < 0
+                ? state_in + slot_idx * state_size
+                : snapshots + (sample * num_spec_tokens + parent) * state_size + channel;
+            input_t* token_state_out
+                = snapshots == nullptr ? state_out + slot_idx * state_size : snapshots + token * state_size + channel;
 #pragma unroll
-        for (int row = 0; row < DCONV; ++row)
-        {
+            for (int i = 0; i < DCONV - 1; ++i)
+            {
+                packed_load_to_float<input_t, CHANNELS_PER_THREAD>(token_state_in + i * params.dim, &reg_input[i][0]);
+            }
+            packed_load_to_float<input_t, CHANNELS_PER_THREAD>(token_input, &reg_input[DCONV - 1][0]);
+
 #pragma unroll
             for (int c = 0; c < CHANNELS_PER_THREAD; ++c)
             {
-                reg_result[c] += reg_weight[row][c] * reg_input[row][c];
+                reg_result[c] = 0.0f;
             }
-        }
-        // add bias
+            // conv
 #pragma unroll
-        for (int c = 0; c < CHANNELS_PER_THREAD; ++c)
-        {
-            reg_result[c] += reg_bias[c];
-        }
-        // Silu
-        if (params.apply_silu)
-        {
+            for (int row = 0; row < DCONV; ++row)
+            {
+#pragma unroll
+                for (int c = 0; c < CHANNELS_PER_THREAD; ++c)
+                {
+                    reg_result[c] += reg_weight[row][c] * reg_input[row][c];
+                }
+            }
+            // add bias
 #pragma unroll
             for (int c = 0; c < CHANNELS_PER_THREAD; ++c)
             {
-                float sigmoid = reg_result[c] < -20.0 ? 0.0f : 1.0f / (1.0f + __expf(-reg_result[c]));
-                reg_result[c] *= sigmoid;
+                reg_result[c] += reg_bias[c];
             }
-        }
-        packed_store_float_to<input_t, CHANNELS_PER_THREAD>(&reg_result[0], token_output);
+            // Silu
+            if (params.apply_silu)
+            {
+#pragma unroll
+                for (int c = 0; c < CHANNELS_PER_THREAD; ++c)
+                {
+                    float sigmoid = reg_result[c] < -20.0 ? 0.0f : 1.0f / (1.0f + __expf(-reg_result[c]));
+                    reg_result[c] *= sigmoid;
+                }
+            }
+            packed_store_float_to<input_t, CHANNELS_PER_THREAD>(&reg_result[0], token_output);
 
 #pragma unroll
-        for (int i = 0; i < DCONV - 1; ++i)
-        {
-            packed_store_float_to<input_t, CHANNELS_PER_THREAD>(&reg_input[i + 1][0], token_state_out + i * params.dim);
+            for (int i = 0; i < DCONV - 1; ++i)
+            {
+                packed_store_float_to<input_t, CHANNELS_PER_THREAD>(
+                    &reg_input[i + 1][0], token_state_out + i * params.dim);
+            }
         }
     }
 }
@@ -1298,6 +1345,8 @@ void invokeMambaConv1dGeneration(MambaConv1dParamsBase& params, cudaStream_t str
     int const channelsPerBlock = threadsPerBlock * channelsPerThread;
     TLLM_CHECK_WITH_INFO(channels % channelsPerThread == 0, "channels should be multiple of channelsPerThread");
     TLLM_CHECK_WITH_INFO(params.dconv == dConv, "only dconv == 4 is supported now.");
+    TLLM_CHECK_WITH_INFO(params.num_spec_tokens <= 1 || params.state_snapshot_ptr != nullptr,
+        "The draft tokens of speculative decoding need the state snapshots");
     int blockx = (channels + channelsPerBlock - 1) / channelsPerBlock;
     int blocky = (samples + microBatchSize - 1) / microBatchSize;
     dim3 grid(blockx, blocky, 1);
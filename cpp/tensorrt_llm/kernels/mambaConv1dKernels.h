@@ -37,10 +37,26 @@ struct MambaConv1dParamsBase
     void* __restrict__ out_ptr;
     int const* __restrict__ last_token_ids_ptr;
     int const* __restrict__ state_slot_mapping_ptr;
+    // [batch], nonzero for the context chunks that continue the state in the cache, nullptr if every sequence starts
+    // from a zero state.
+    int const* __restrict__ has_initial_state_ptr;
+    // Workspace of getMambaConv1dContextWorkspaceSize bytes, needed with has_initial_state_ptr.
+    void* initial_state_ptr;
+    // Speculative decoding in the generation phase. The tokens per sequence, 0 or 1 without speculative decoding.
+    int num_spec_tokens;
+    // [batch, num_spec_tokens], the position of the token each token continues from, -1 for the state in the cache.
+    // nullptr for a chain of drafts.
+    int const* __restrict__ spec_parent_ptr;
+    // [batch, num_spec_tokens, dconv - 1, dim], the states after every token, needed with more than one token. The
+    // cache then keeps the state before the drafts until the accepted snapshot is copied back.
+    void* state_snapshot_ptr;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+//! \brief Workspace of invokeMambaConv1dContext for context chunks with an initial state.
+size_t getMambaConv1dContextWorkspaceSize(int batch, int dim, int dconv, size_t typeSize);
+
 template <typename input_t>
 void invokeMambaConv1dContext(MambaConv1dParamsBase& params, cudaStream_t stream);
 
@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/mlaDecodeAttention.h"
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+namespace
+{
+
+int32_t constexpr kWarpSize = 32;
+int32_t constexpr kNumWarps = 4;
+int32_t constexpr kBlockSize = kNumWarps * kWarpSize;
+// Query heads of a warp. Their softmax states and latent accumulators stay in registers over the whole KV loop.
+int32_t constexpr kRowsPerWarp = 4;
+// Query heads of a CTA, which share every tile of the latent cache loaded into shared memory.
+int32_t constexpr kHeadsPerCta = kNumWarps * kRowsPerWarp;
+// Tokens of a KV tile, one per lane when the scores are computed.
+int32_t constexpr kTileTokens = kWarpSize;
+int32_t constexpr kLatentDim = 512;
+int32_t constexpr kRopeDim = 64;
+int32_t constexpr kHeadSize = kLatentDim + kRopeDim;
+int32_t constexpr kChannelsPerLane = kLatentDim / kWarpSize;
+// Splits are not shorter than this, so that the partial results stay small next to the tiles they summarize.
+int32_t constexpr kMinTokensPerSplit = 8 * kTileTokens;
+int32_t constexpr kCombineBlockSize = 128;
+
+// Row stride of the tile in shared memory, padded to an odd number of words so that the lanes reading the same channel
+// of their tokens hit different banks.
+template <typename T>
+constexpr int32_t getTileRowStride()
+{
+    return kHeadSize + static_cast<int32_t>(4 / sizeof(T));
+}
+
+template <typename T>
+constexpr size_t getSmemSize()
+{
+    return (static_cast<size_t>(kHeadsPerCta) * kHeadSize + static_cast<size_t>(kTileTokens) * getTileRowStride<T>())
+        * sizeof(T);
+}
+
+__device__ __forceinline__ float warpMax(float val)
+{
+#pragma unroll
+    for (int32_t mask = kWarpSize / 2; mask > 0; mask >>= 1)
+    {
+        val = fmaxf(val, __shfl_xor_sync(0xffffffff, val, mask));
+    }
+    return val;
+}
+
+__device__ __forceinline__ float warpSum(float val)
+{
+#pragma unroll
+    for (int32_t mask = kWarpSize / 2; mask > 0; mask >>= 1)
+    {
+        val += __shfl_xor_sync(0xffffffff, val, mask);
+    }
+    return val;
+}
+
+__device__ __forceinline__ float* getPartialOut(void* workspace)
+{
+    return reinterpret_cast<float*>(workspace);
+}
+
+__device__ __forceinline__ float* getPartialLse(void* workspace, int32_t numRows, int32_t numSplits)
+{
+    return reinterpret_cast<float*>(workspace) + static_cast<size_t>(numSplits) * numRows * kLatentDim;
+}
+
+// Grid: [divUp(numHeads, kHeadsPerCta), batchSize, numSplits].
+template <typename T>
+__global__ void __launch_bounds__(kBlockSize)
+    mlaDecodeAttentionKernel(MlaDecodeAttentionParams<T> params, KVBlockArray kvCache)
+{
+    using VecT = uint4;
+    int32_t constexpr kEltsPerVec = sizeof(VecT) / sizeof(T);
+    int32_t constexpr kVecsPerToken = kHeadSize / kEltsPerVec;
+    int32_t constexpr kRowStride = getTileRowStride<T>();
+
+    extern __shared__ __align__(16) char smem[];
+    // [kHeadsPerCta, kHeadSize] queries of the chunk, followed by the [kTileTokens, kRowStride] tile.
+    auto* qSmem = reinterpret_cast<T*>(smem);
+    auto* tileSmem = qSmem + kHeadsPerCta * kHeadSize;
+
+    auto const warpIdx = static_cast<int32_t>(threadIdx.x) / kWarpSize;
+    auto const laneIdx = static_cast<int32_t>(threadIdx.x) % kWarpSize;
+    auto const headBegin = static_cast<int32_t>(blockIdx.x) * kHeadsPerCta;
+    auto const batchIdx = static_cast<int32_t>(blockIdx.y);
+    auto const splitIdx = static_cast<int32_t>(blockIdx.z);
+    auto const numSplits = static_cast<int32_t>(gridDim.z);
+
+    auto const kvLength = params.kvLengths[batchIdx];
+    auto const tokensPerSplit = divUp(divUp(kvLength, numSplits), kTileTokens) * kTileTokens;
+    auto const splitBegin = splitIdx * tokensPerSplit;
+    auto const splitEnd = min(splitBegin + tokensPerSplit, kvLength);
+
+    for (auto idx = static_cast<int32_t>(threadIdx.x); idx < kHeadsPerCta * kVecsPerToken; idx += kBlockSize)
+    {
+        auto const head = headBegin + idx / kVecsPerToken;
+        auto const vecIdx = idx % kVecsPerToken;
+        VecT value{};
+        if (head < params.numHeads)
+        {
+            value = reinterpret_cast<VecT const*>(
+                params.q + (static_cast<size_t>(batchIdx) * params.numHeads + head) * kHeadSize)[vecIdx];
+        }
+        reinterpret_cast<VecT*>(qSmem)[idx] = value;
+    }
+
+    float rowMax[kRowsPerWarp];
+    float rowSum[kRowsPerWarp];
+    float acc[kRowsPerWarp][kChannelsPerLane];
+#pragma unroll
+    for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+    {
+        rowMax[ri] = -FLT_MAX;
+        rowSum[ri] = 0.f;
+#pragma unroll
+        for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+        {
+            acc[ri][ci] = 0.f;
+        }
+    }
+
+    bool const warpActive = headBegin + warpIdx * kRowsPerWarp < params.numHeads;
+    auto const* qRows = qSmem + warpIdx * kRowsPerWarp * kHeadSize;
+
+    for (int32_t tileStart = splitBegin; tileStart < splitEnd; tileStart += kTileTokens)
+    {
+        // Load the tile once for all heads of the chunk, with 16B loads from the K blocks.
+        __syncthreads();
+        for (auto idx = static_cast<int32_t>(threadIdx.x); idx < kTileTokens * kVecsPerToken; idx += kBlockSize)
+        {
+            auto const tokenOffset = idx / kVecsPerToken;
+            auto const vecIdx = idx % kVecsPerToken;
+            auto const tokenIdx = tileStart + tokenOffset;
+            VecT value{};
+            if (tokenIdx < splitEnd)
+            {
+                auto const* kBlock = reinterpret_cast<VecT const*>(kvCache.getKBlockPtr(batchIdx, tokenIdx));
+                value = kBlock[kvCache.getKVLocalIdx(tokenIdx, 0, kVecsPerToken, vecIdx)];
+            }
+            auto const* elts = reinterpret_cast<T const*>(&value);
+            auto* dst = tileSmem + tokenOffset * kRowStride + vecIdx * kEltsPerVec;
+#pragma unroll
+            for (int32_t ei = 0; ei < kEltsPerVec; ++ei)
+            {
+                dst[ei] = elts[ei];
+            }
+        }
+        __syncthreads();
+
+        if (!warpActive)
+        {
+            continue;
+        }
+
+        // Scores of the token of the lane, against the latent and rotary channels.
+        bool const visible = tileStart + laneIdx < splitEnd;
+        float score[kRowsPerWarp];
+#pragma unroll
+        for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+        {
+            score[ri] = 0.f;
+        }
+        auto const* kRow = tileSmem + laneIdx * kRowStride;
+#pragma unroll 8
+        for (int32_t channel = 0; channel < kHeadSize; ++channel)
+        {
+            auto const kValue = cuda_cast<float>(kRow[channel]);
+#pragma unroll
+            for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+            {
+                score[ri] += cuda_cast<float>(qRows[ri * kHeadSize + channel]) * kValue;
+            }
+        }
+
+        float prob[kRowsPerWarp];
+#pragma unroll
+        for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+        {
+            auto const scaled = visible ? score[ri] * params.qScale : -FLT_MAX;
+            auto const newMax = fmaxf(rowMax[ri], warpMax(scaled));
+            auto const correction = __expf(rowMax[ri] - newMax);
+            prob[ri] = visible ? __expf(scaled - newMax) : 0.f;
+            rowSum[ri] = rowSum[ri] * correction + warpSum(prob[ri]);
+            rowMax[ri] = newMax;
+#pragma unroll
+            for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+            {
+                acc[ri][ci] *= correction;
+            }
+        }
+
+        // The values are the latent channels of the same tile.
+        for (int32_t ti = 0; ti < kTileTokens; ++ti)
+        {
+            float p[kRowsPerWarp];
+#pragma unroll
+            for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+            {
+                p[ri] = __shfl_sync(0xffffffff, prob[ri], ti);
+            }
+            auto const* vRow = tileSmem + ti * kRowStride;
+#pragma unroll
+            for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+            {
+                auto const vValue = cuda_cast<float>(vRow[ci * kWarpSize + laneIdx]);
+#pragma unroll
+                for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+                {
+                    acc[ri][ci] += p[ri] * vValue;
+                }
+            }
+        }
+    }
+
+    auto const numRows = params.batchSize * params.numHeads;
+#pragma unroll
+    for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+    {
+        auto const head = headBegin + warpIdx * kRowsPerWarp + ri;
+        if (head >= params.numHeads)
+        {
+            continue;
+        }
+        auto const rowIdx = batchIdx * params.numHeads + head;
+        auto const invSum = rowSum[ri] > 0.f ? 1.f / rowSum[ri] : 0.f;
+        if (numSplits == 1)
+        {
+            auto* out = params.out + static_cast<size_t>(rowIdx) * kLatentDim;
+#pragma unroll
+            for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+            {
+                out[ci * kWarpSize + laneIdx] = cuda_cast<T>(acc[ri][ci] * invSum);
+            }
+        }
+        else
+        {
+            auto const partialRow = static_cast<size_t>(splitIdx) * numRows + rowIdx;
+            auto* partialOut = getPartialOut(params.workspace) + partialRow * kLatentDim;
+#pragma unroll
+            for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+            {
+                partialOut[ci * kWarpSize + laneIdx] = acc[ri][ci] * invSum;
+            }
+            if (laneIdx == 0)
+            {
+                getPartialLse(params.workspace, numRows, numSplits)[partialRow]
+                    = rowSum[ri] > 0.f ? rowMax[ri] + __logf(rowSum[ri]) : -INFINITY;
+            }
+        }
+    }
+}
+
+// Grid: [batchSize * numHeads]. Merges the normalized partial outputs of the splits by their log-sum-exp.
+template <typename T>
+__global__ void __launch_bounds__(kCombineBlockSize)
+    mlaDecodeCombineKernel(MlaDecodeAttentionParams<T> params, int32_t numSplits)
+{
+    auto const rowIdx = static_cast<int32_t>(blockIdx.x);
+    auto const numRows = params.batchSize * params.numHeads;
+    auto const* partialOut = getPartialOut(params.workspace);
+    auto const* partialLse = getPartialLse(params.workspace, numRows, numSplits);
+
+    float maxLse = -INFINITY;
+    for (int32_t si = 0; si < numSplits; ++si)
+    {
+        maxLse = fmaxf(maxLse, partialLse[static_cast<size_t>(si) * numRows + rowIdx]);
+    }
+    float weights[kMlaDecodeMaxSplits];
+    float weightSum = 0.f;
+#pragma unroll
+    for (int32_t si = 0; si < kMlaDecodeMaxSplits; ++si)
+    {
+        // Empty splits have an infinite negative log-sum-exp and no weight.
+        weights[si] = si < numSplits ? __expf(partialLse[static_cast<size_t>(si) * numRows + rowIdx] - maxLse) : 0.f;
+        weightSum += weights[si];
+    }
+    auto const invWeightSum = weightSum > 0.f ? 1.f / weightSum : 0.f;
+
+    for (auto channel = static_cast<int32_t>(threadIdx.x); channel < kLatentDim; channel += kCombineBlockSize)
+    {
+        float value = 0.f;
+#pragma unroll
+        for (int32_t si = 0; si < kMlaDecodeMaxSplits; ++si)
+        {
+            if (si < numSplits)
+            {
+                value += weights[si] * partialOut[(static_cast<size_t>(si) * numRows + rowIdx) * kLatentDim + channel];
+            }
+        }
+        params.out[static_cast<size_t>(rowIdx) * kLatentDim + channel] = cuda_cast<T>(value * invWeightSum);
+    }
+}
+
+} // namespace
+
+int32_t getMlaDecodeNumSplits(int32_t batchSize, int32_t numHeads, int32_t maxKvLength, int32_t multiProcessorCount)
+{
+    auto const numCtas = batchSize * divUp(numHeads, kHeadsPerCta);
+    // Two CTAs per SM fit the shared memory of a tile and the queries of a chunk.
+    auto const bySms = divUp(2 * multiProcessorCount, numCtas);
+    auto const byLength = divUp(maxKvLength, kMinTokensPerSplit);
+    return std::max(1, std::min({kMlaDecodeMaxSplits, bySms, byLength}));
+}
+
+size_t getMlaDecodeWorkspaceSize(int32_t batchSize, int32_t numHeads, int32_t numSplits)
+{
+    if (numSplits <= 1)
+    {
+        return 0;
+    }
+    auto const numPartialRows = static_cast<size_t>(numSplits) * batchSize * numHeads;
+    return numPartialRows * (kLatentDim + 1) * sizeof(float);
+}
+
+size_t getMlaDecodeMaxWorkspaceSize(
+    int32_t maxBatchSize, int32_t numHeads, int32_t maxKvLength, int32_t multiProcessorCount)
+{
+    size_t maxSize = 0;
+    for (int32_t batchSize = 1; batchSize <= maxBatchSize; ++batchSize)
+    {
+        auto const numSplits = getMlaDecodeNumSplits(batchSize, numHeads, maxKvLength, multiProcessorCount);
+        maxSize = std::max(maxSize, getMlaDecodeWorkspaceSize(batchSize, numHeads, numSplits));
+    }
+    return maxSize;
+}
+
+template <typename T>
+void invokeMlaDecodeAttention(
+    MlaDecodeAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream)
+{
+    params.checkParams();
+
+    auto const smemSize = getSmemSize<T>();
+    if (smemSize > 48 * 1024)
+    {
+        TLLM_CUDA_CHECK(
+            cudaFuncSetAttribute(mlaDecodeAttentionKernel<T>, cudaFuncAttributeMaxDynamicSharedMemorySize, smemSize));
+    }
+    dim3 const grid(divUp(params.numHeads, kHeadsPerCta), params.batchSize, params.numSplits);
+    mlaDecodeAttentionKernel<T><<<grid, kBlockSize, smemSize, stream>>>(params, kvCache);
+    if (params.numSplits > 1)
+    {
+        mlaDecodeCombineKernel<T>
+            <<<params.batchSize * params.numHeads, kCombineBlockSize, 0, stream>>>(params, params.numSplits);
+    }
+
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_MLA_DECODE_ATTENTION(T)                                                                            \
+    template void invokeMlaDecodeAttention<T>(                                                                         \
+        MlaDecodeAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream)
+
+INSTANTIATE_MLA_DECODE_ATTENTION(float);
+INSTANTIATE_MLA_DECODE_ATTENTION(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_MLA_DECODE_ATTENTION(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_MLA_DECODE_ATTENTION
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/kernels/kvCacheUtils.h"
+#include <cstddef>
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+// Largest number of CTAs along the KV length of a sequence.
+int32_t constexpr kMlaDecodeMaxSplits = 16;
+
+template <typename T>
+struct MlaDecodeAttentionParams
+{
+    // Absorbed queries of the generation tokens after the rotary embedding [batchSize, numHeads, kvLoraRank +
+    // qkRopeHeadDim]: the first kvLoraRank channels are q_nope projected by W_UK.
+    T const* q{nullptr};
+    // Attention output in the latent space [batchSize, numHeads, kvLoraRank], still to be projected by W_UV.
+    T* out{nullptr};
+    // Number of tokens in the cache of every sequence, including the generation token [batchSize].
+    int32_t const* kvLengths{nullptr};
+    int32_t batchSize{0};
+    int32_t numHeads{0};
+    int32_t kvLoraRank{512};
+    int32_t qkRopeHeadDim{64};
+    // CTAs along the KV length of every sequence, see getMlaDecodeNumSplits.
+    int32_t numSplits{1};
+    // Scale of the attention scores, 1 / (qScaling * sqrt(qk_nope_head_dim + qk_rope_head_dim)).
+    float qScale{1.f};
+    // Workspace of getMlaDecodeWorkspaceSize bytes for the partial results of the splits, unused with one split.
+    void* workspace{nullptr};
+
+    void checkParams() const
+    {
+        TLLM_CHECK(q && out && kvLengths);
+        TLLM_CHECK(batchSize > 0 && numHeads > 0);
+        TLLM_CHECK_WITH_INFO(kvLoraRank == 512 && qkRopeHeadDim == 64,
+            "The MLA decode kernel supports kv_lora_rank 512 and qk_rope_head_dim 64");
+        TLLM_CHECK(numSplits >= 1 && numSplits <= kMlaDecodeMaxSplits);
+        TLLM_CHECK(numSplits == 1 || workspace);
+    }
+};
+
+//! \brief CTAs along the KV length, so that small batches still fill the GPU without splits shorter than a few tiles.
+int32_t getMlaDecodeNumSplits(int32_t batchSize, int32_t numHeads, int32_t maxKvLength, int32_t multiProcessorCount);
+
+size_t getMlaDecodeWorkspaceSize(int32_t batchSize, int32_t numHeads, int32_t numSplits);
+
+//! \brief Largest getMlaDecodeWorkspaceSize of the batches up to maxBatchSize with the splits of getMlaDecodeNumSplits.
+size_t getMlaDecodeMaxWorkspaceSize(
+    int32_t maxBatchSize, int32_t numHeads, int32_t maxKvLength, int32_t multiProcessorCount);
+
+//! \brief Generation attention of MLA over the paged latent cache, with W_UK absorbed into the queries.
+//! \details The cache holds a single KV head of kvLoraRank + qkRopeHeadDim channels, the latent followed by its rotary
+//! part, and the values are the latent itself. Every CTA loads a tile of the K blocks once into shared memory and
+//! scores it against a chunk of query heads, then accumulates the same tile as values, so the V blocks are never read
+//! and the latent is read once per chunk of heads instead of once per head. The cache must hold T, without
+//! quantization, beam search indirection or cyclic window.
+template <typename T>
+void invokeMlaDecodeAttention(
+    MlaDecodeAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
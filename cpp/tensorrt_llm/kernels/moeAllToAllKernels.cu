@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/moeAllToAllKernels.h"
+#include "tensorrt_llm/kernels/moeRoutingUtils.cuh"
+#ifndef CUDART_VERSION
+#error CUDART_VERSION Undefined!
+#elif (CUDART_VERSION >= 11050)
+#include <cub/cub.cuh>
+#else
+#include "3rdparty/cub/cub.cuh"
+#endif
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+namespace
+{
+
+int32_t constexpr kWarpSize = 32;
+int32_t constexpr kSelectWarpsPerCta = 4;
+int32_t constexpr kSelectBlockSize = kSelectWarpsPerCta * kWarpSize;
+int32_t constexpr kBlockSize = 256;
+
+// One warp per token. Experts tied with the k-th largest logit are selected. The flags of the selected ranks are
+// written to tokenSendSlots.
+__global__ void __launch_bounds__(kSelectBlockSize) moeAllToAllSelectRanksKernel(MoeAllToAllPlanParams params)
+{
+    auto const tokenIdx
+        = static_cast<int32_t>(blockIdx.x) * kSelectWarpsPerCta + static_cast<int32_t>(threadIdx.x) / kWarpSize;
+    auto const laneIdx = static_cast<int32_t>(threadIdx.x) % kWarpSize;
+    if (tokenIdx >= params.numTokens)
+    {
+        return;
+    }
+
+    auto const* logits = params.routingLogits + static_cast<size_t>(tokenIdx) * params.numExperts;
+    auto const threshold = getMoeTopKThreshold(logits, params.numExperts, params.topK);
+
+    auto const expertsPerRank = params.numExperts / params.epSize;
+    for (int32_t rank = laneIdx; rank < params.epSize; rank += kWarpSize)
+    {
+        int32_t selected = 0;
+        for (int32_t expert = rank * expertsPerRank; expert < (rank + 1) * expertsPerRank; ++expert)
+        {
+            selected |= logits[expert] >= threshold ? 1 : 0;
+        }
+        params.tokenSendSlots[static_cast<size_t>(tokenIdx) * params.epSize + rank] = selected;
+    }
+}
+
+// One CTA per rank numbers the tokens flagged for it in the order of the tokens.
+__global__ void __launch_bounds__(kBlockSize) moeAllToAllAssignSlotsKernel(MoeAllToAllPlanParams params)
+{
+    using BlockScan = cub::BlockScan<int32_t, kBlockSize>;
+    __shared__ typename BlockScan::TempStorage tempStorage;
+
+    auto const rank = static_cast<int32_t>(blockIdx.x);
+    int32_t numSent = 0;
+    for (int32_t tokenBegin = 0; tokenBegin < params.numTokens; tokenBegin += kBlockSize)
+    {
+        auto const tokenIdx = tokenBegin + static_cast<int32_t>(threadIdx.x);
+        auto const slotIdx = static_cast<size_t>(tokenIdx) * params.epSize + rank;
+        auto const selected = tokenIdx < params.numTokens ? params.tokenSendSlots[slotIdx] : 0;
+        int32_t slot;
+        int32_t numSelected;
+        BlockScan(tempStorage).ExclusiveSum(selected, slot, numSelected);
+        if (tokenIdx < params.numTokens)
+        {
+            slot += numSent;
+            params.tokenSendSlots[slotIdx] = selected ? slot : -1;
+            if (selected)
+            {
+                params.sendTokenIds[static_cast<size_t>(rank) * params.numTokens + slot] = tokenIdx;
+            }
+        }
+        numSent += numSelected;
+        // The temporary storage is reused by the next tokens.
+        __syncthreads();
+    }
+    if (threadIdx.x == 0)
+    {
+        params.sendCounts[rank] = numSent;
+    }
+}
+
+__device__ int32_t getRankOffset(int32_t const* sendCounts, int32_t rank)
+{
+    int32_t offset = 0;
+    for (int32_t ii = 0; ii < rank; ++ii)
+    {
+        offset += sendCounts[ii];
+    }
+    return offset;
+}
+
+// Grid: [numTokens, epSize], one CTA per row sent.
+__global__ void __launch_bounds__(kBlockSize) moeAllToAllGatherRowsKernel(int4 const* rows, int64_t rowVecs,
+    int32_t const* sendCounts, int32_t const* sendTokenIds, int32_t numTokens, int4* sendRows)
+{
+    auto const rank = static_cast<int32_t>(blockIdx.y);
+    auto const slot = static_cast<int32_t>(blockIdx.x);
+    if (slot >= sendCounts[rank])
+    {
+        return;
+    }
+    auto const tokenIdx = sendTokenIds[static_cast<size_t>(rank) * numTokens + slot];
+    auto const* src = rows + tokenIdx * rowVecs;
+    auto* dst = sendRows + (getRankOffset(sendCounts, rank) + slot) * rowVecs;
+    for (int64_t idx = threadIdx.x; idx < rowVecs; idx += kBlockSize)
+    {
+        dst[idx] = src[idx];
+    }
+}
+
+// Grid: [numTokens]. The offsets of the ranks are computed once per CTA in the dynamic shared memory.
+template <typename T>
+__global__ void __launch_bounds__(kBlockSize) moeAllToAllCombineKernel(T const* returnedRows,
+    int32_t const* sendCounts, int32_t const* tokenSendSlots, int32_t epSize, int64_t hiddenSize, T* output)
+{
+    extern __shared__ int32_t rankRows[];
+
+    auto const tokenIdx = static_cast<int32_t>(blockIdx.x);
+    if (threadIdx.x == 0)
+    {
+        int32_t offset = 0;
+        for (int32_t rank = 0; rank < epSize; ++rank)
+        {
+            auto const slot = tokenSendSlots[static_cast<size_t>(tokenIdx) * epSize + rank];
+            rankRows[rank] = slot < 0 ? -1 : offset + slot;
+            offset += sendCounts[rank];
+        }
+    }
+    __syncthreads();
+
+    for (int64_t idx = threadIdx.x; idx < hiddenSize; idx += kBlockSize)
+    {
+        float sum = 0.f;
+        for (int32_t rank = 0; rank < epSize; ++rank)
+        {
+            if (rankRows[rank] >= 0)
+            {
+                sum += cuda_cast<float>(returnedRows[rankRows[rank] * hiddenSize + idx]);
+            }
+        }
+        output[tokenIdx * hiddenSize + idx] = cuda_cast<T>(sum);
+    }
+}
+
+} // namespace
+
+void invokeMoeAllToAllPlan(MoeAllToAllPlanParams const& params, cudaStream_t stream)
+{
+    params.checkParams();
+    if (params.numTokens <= 0)
+    {
+        TLLM_CUDA_CHECK(cudaMemsetAsync(params.sendCounts, 0, params.epSize * sizeof(int32_t), stream));
+        return;
+    }
+
+    moeAllToAllSelectRanksKernel<<<divUp(params.numTokens, kSelectWarpsPerCta), kSelectBlockSize, 0, stream>>>(params);
+    moeAllToAllAssignSlotsKernel<<<params.epSize, kBlockSize, 0, stream>>>(params);
+    sync_check_cuda_error();
+}
+
+void invokeMoeAllToAllGatherRows(void const* rows, int64_t rowBytes, int32_t const* sendCounts,
+    int32_t const* sendTokenIds, int32_t numTokens, int32_t epSize, void* sendRows, cudaStream_t stream)
+{
+    TLLM_CHECK_WITH_INFO(rowBytes % sizeof(int4) == 0, "The rows of %ld bytes are not 16B aligned", rowBytes);
+    if (numTokens <= 0)
+    {
+        return;
+    }
+
+    dim3 const grid(numTokens, epSize);
+    moeAllToAllGatherRowsKernel<<<grid, kBlockSize, 0, stream>>>(static_cast<int4 const*>(rows),
+        rowBytes / static_cast<int64_t>(sizeof(int4)), sendCounts, sendTokenIds, numTokens,
+        static_cast<int4*>(sendRows));
+    sync_check_cuda_error();
+}
+
+template <typename T>
+void invokeMoeAllToAllCombine(T const* returnedRows, int32_t const* sendCounts, int32_t const* tokenSendSlots,
+    int32_t numTokens, int32_t epSize, int64_t hiddenSize, T* output, cudaStream_t stream)
+{
+    if (numTokens <= 0)
+    {
+        return;
+    }
+
+    moeAllToAllCombineKernel<T><<<numTokens, kBlockSize, epSize * sizeof(int32_t), stream>>>(
+        returnedRows, sendCounts, tokenSendSlots, epSize, hiddenSize, output);
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_MOE_ALL_TO_ALL_COMBINE(T)                                                                          \
+    template void invokeMoeAllToAllCombine<T>(T const* returnedRows, int32_t const* sendCounts,                        \
+        int32_t const* tokenSendSlots, int32_t numTokens, int32_t epSize, int64_t hiddenSize, T* output,               \
+        cudaStream_t stream)
+
+INSTANTIATE_MOE_ALL_TO_ALL_COMBINE(float);
+INSTANTIATE_MOE_ALL_TO_ALL_COMBINE(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_MOE_ALL_TO_ALL_COMBINE(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_MOE_ALL_TO_ALL_COMBINE
+
+} // namespace tensorrt_llm::kernels
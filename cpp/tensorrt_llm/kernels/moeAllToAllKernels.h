@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+// The expert parallel all-to-all of the MoE sends every local token once to each rank that hosts at least one of its
+// top-k experts, runs the experts of the rank on the tokens it received and sends the partial outputs back, where they
+// are summed. The rows sent to rank r are stored from the offset of r, the exclusive prefix sum of the send counts.
+struct MoeAllToAllPlanParams
+{
+    // Routing logits of the local tokens [numTokens, numExperts].
+    float const* routingLogits{nullptr};
+    // Number of tokens sent to every rank [epSize].
+    int32_t* sendCounts{nullptr};
+    // Local tokens sent to every rank, in the order of the tokens [epSize, numTokens].
+    int32_t* sendTokenIds{nullptr};
+    // Row of every token in the rows sent to every rank, or -1 when the rank hosts none of its experts
+    // [numTokens, epSize].
+    int32_t* tokenSendSlots{nullptr};
+    int32_t numTokens{0};
+    int32_t numExperts{0};
+    int32_t topK{0};
+    int32_t epSize{0};
+
+    void checkParams() const
+    {
+        TLLM_CHECK(routingLogits && sendCounts && sendTokenIds && tokenSendSlots);
+        TLLM_CHECK(numExperts > 0 && topK > 0 && topK <= numExperts);
+        TLLM_CHECK_WITH_INFO(epSize > 0 && numExperts % epSize == 0,
+            "The %d experts must be evenly distributed over the %d ranks", numExperts, epSize);
+    }
+};
+
+//! \brief Select the ranks of the top-k experts of every token and number the tokens sent to every rank. Experts tied
+//! with the k-th largest logit are selected too, so that the ranks receive every token the MoE routes to them.
+void invokeMoeAllToAllPlan(MoeAllToAllPlanParams const& params, cudaStream_t stream);
+
+//! \brief Gather the rows of the tokens sent to every rank into a contiguous buffer, the rows of rank r starting at its
+//! offset. rowBytes must be a multiple of 16.
+void invokeMoeAllToAllGatherRows(void const* rows, int64_t rowBytes, int32_t const* sendCounts,
+    int32_t const* sendTokenIds, int32_t numTokens, int32_t epSize, void* sendRows, cudaStream_t stream);
+
+//! \brief Sum the partial outputs of every token returned by the ranks it was sent to. The partial outputs are laid out
+//! as the rows gathered by invokeMoeAllToAllGatherRows.
+template <typename T>
+void invokeMoeAllToAllCombine(T const* returnedRows, int32_t const* sendCounts, int32_t const* tokenSendSlots,
+    int32_t numTokens, int32_t epSize, int64_t hiddenSize, T* output, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/moeFusedRoutingKernels.h"
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+namespace
+{
+
+int32_t constexpr kWarpSize = 32;
+int32_t constexpr kWarpsPerCta = 8;
+int32_t constexpr kBlockSize = kWarpsPerCta * kWarpSize;
+int32_t constexpr kExpertsPerLane = kMoeFusedRoutingMaxExperts / kWarpSize;
+// A bucket per local expert and one for the experts of the other EP ranks
+int32_t constexpr kMaxBuckets = kMoeFusedRoutingMaxExperts + 1;
+uint32_t constexpr kFullMask = 0xffffffff;
+
+// Softmax and top-k of a token by a warp, lane l holding experts l, l + 32, ... in registers.
+__device__ void selectTopKExperts(MoeFusedRoutingParams const& params, int32_t tokenIdx, int32_t laneIdx)
+{
+    auto const* logits = params.routingLogits + static_cast<size_t>(tokenIdx) * params.numExperts;
+    float values[kExpertsPerLane];
+    float maxValue = -INFINITY;
+#pragma unroll
+    for (int32_t i = 0; i < kExpertsPerLane; ++i)
+    {
+        auto const expert = laneIdx + i * kWarpSize;
+        values[i] = expert < params.numExperts ? logits[expert] : -INFINITY;
+        maxValue = fmaxf(maxValue, values[i]);
+    }
+    for (int32_t offset = kWarpSize / 2; offset > 0; offset /= 2)
+    {
+        maxValue = fmaxf(maxValue, __shfl_xor_sync(kFullMask, maxValue, offset));
+    }
+    float sum = 0.f;
+#pragma unroll
+    for (int32_t i = 0; i < kExpertsPerLane; ++i)
+    {
+        sum += laneIdx + i * kWarpSize < params.numExperts ? __expf(values[i] - maxValue) : 0.f;
+    }
+    for (int32_t offset = kWarpSize / 2; offset > 0; offset /= 2)
+    {
+        sum += __shfl_xor_sync(kFullMask, sum, offset);
+    }
+    auto const invSum = 1.f / sum;
+
+    auto* experts = params.expertForSourceRow + static_cast<size_t>(tokenIdx) * params.topK;
+    auto* scales = params.tokenTopkUnpermutedScales + static_cast<size_t>(tokenIdx) * params.topK;
+    uint32_t selectedMask = 0;
+    float selectedSum = 0.f;
+    for (int32_t k = 0; k < params.topK; ++k)
+    {
+        // The lowest expert wins the ties, as in the runner. No expert is kMoeFusedRoutingMaxExperts.
+        float bestValue = -INFINITY;
+        int32_t bestExpert = kMoeFusedRoutingMaxExperts;
+#pragma unroll
+        for (int32_t i = 0; i < kExpertsPerLane; ++i)
+        {
+            auto const expert = laneIdx + i * kWarpSize;
+            bool const selected = (selectedMask >> i) & 1u;
+            if (expert < params.numExperts && !selected
+                && (bestExpert == kMoeFusedRoutingMaxExperts || values[i] > bestValue))
+            {
+                bestValue = values[i];
+                bestExpert = expert;
+            }
+        }
+        for (int32_t offset = kWarpSize / 2; offset > 0; offset /= 2)
+        {
+            auto const otherValue = __shfl_xor_sync(kFullMask, bestValue, offset);
+            auto const otherExpert = __shfl_xor_sync(kFullMask, bestExpert, offset);
+            bool const better = otherExpert != kMoeFusedRoutingMaxExperts
+                && (bestExpert == kMoeFusedRoutingMaxExperts || otherValue > bestValue
+                    || (otherValue == bestValue && otherExpert < bestExpert));
+            if (better)
+            {
+                bestValue = otherValue;
+                bestExpert = otherExpert;
+            }
+        }
+        if (bestExpert % kWarpSize == laneIdx)
+        {
+            selectedMask |= 1u << (bestExpert / kWarpSize);
+        }
+        auto const score = __expf(bestValue - maxValue) * invSum;
+        selectedSum += score;
+        if (laneIdx == 0)
+        {
+            experts[k] = bestExpert;
+            scales[k] = score;
+        }
+    }
+
+    if (params.renormalize)
+    {
+        __syncwarp();
+        for (int32_t k = laneIdx; k < params.topK; k += kWarpSize)
+        {
+            scales[k] /= selectedSum;
+        }
+    }
+}
+
+// A single CTA. The expanded rows t * topK + j are split in contiguous ranges, one per warp, so that the warps place
+// their rows in order from the counts of the ranges before theirs.
+__global__ void __launch_bounds__(kBlockSize) moeFusedRoutingKernel(MoeFusedRoutingParams params)
+{
+    // Count, then first permuted row, of the rows of every bucket in the range of every warp
+    __shared__ int32_t warpBucketRows[kWarpsPerCta][kMaxBuckets];
+    __shared__ int32_t bucketOffsets[kMaxBuckets];
+
+    auto const warpIdx = static_cast<int32_t>(threadIdx.x) / kWarpSize;
+    auto const laneIdx = static_cast<int32_t>(threadIdx.x) % kWarpSize;
+
+    for (int32_t tokenIdx = warpIdx; tokenIdx < params.numTokens; tokenIdx += kWarpsPerCta)
+    {
+        selectTopKExperts(params, tokenIdx, laneIdx);
+    }
+
+    auto const numLocalExperts = params.endExpert - params.startExpert;
+    auto const numBuckets = numLocalExperts + 1;
+    for (int32_t idx = threadIdx.x; idx < kWarpsPerCta * kMaxBuckets; idx += kBlockSize)
+    {
+        warpBucketRows[idx / kMaxBuckets][idx % kMaxBuckets] = 0;
+    }
+    // Also makes the selected experts visible to the CTA.
+    __syncthreads();
+
+    auto const numRows = params.numTokens * params.topK;
+    auto const rowsPerWarp = (numRows + kWarpsPerCta - 1) / kWarpsPerCta;
+    auto const rowBegin = min(warpIdx * rowsPerWarp, numRows);
+    auto const rowEnd = min(rowBegin + rowsPerWarp, numRows);
+    auto const getBucket = [&](int32_t row)
+    {
+        auto const localExpert = params.expertForSourceRow[row] - params.startExpert;
+        return localExpert >= 0 && localExpert < numLocalExperts ? localExpert : numLocalExperts;
+    };
+
+    for (int32_t row = rowBegin + laneIdx; row < rowEnd; row += kWarpSize)
+    {
+        atomicAdd(&warpBucketRows[warpIdx][getBucket(row)], 1);
+    }
+    __syncthreads();
+
+    for (int32_t bucket = threadIdx.x; bucket < numBuckets; bucket += kBlockSize)
+    {
+        int32_t rows = 0;
+        for (int32_t warp = 0; warp < kWarpsPerCta; ++warp)
+        {
+            auto const count = warpBucketRows[warp][bucket];
+            warpBucketRows[warp][bucket] = rows;
+            rows += count;
+        }
+        bucketOffsets[bucket] = rows;
+    }
+    __syncthreads();
+
+    if (warpIdx == 0)
+    {
+        int32_t carry = 0;
+        for (int32_t base = 0; base < numBuckets; base += kWarpSize)
+        {
+            auto const bucket = base + laneIdx;
+            auto const count = bucket < numBuckets ? bucketOffsets[bucket] : 0;
+            auto inclusive = count;
+            for (int32_t offset = 1; offset < kWarpSize; offset *= 2)
+            {
+                auto const prev = __shfl_up_sync(kFullMask, inclusive, offset);
+                inclusive += laneIdx >= offset ? prev : 0;
+            }
+            if (bucket < numBuckets)
+            {
+                bucketOffsets[bucket] = carry + inclusive - count;
+                // The offset of the bucket of the other ranks is the number of rows of the local experts.
+                params.expertFirstTokenOffset[bucket] = carry + inclusive - count;
+            }
+            carry += __shfl_sync(kFullMask, inclusive, kWarpSize - 1);
+        }
+    }
+    __syncthreads();
+
+    for (int32_t idx = threadIdx.x; idx < kWarpsPerCta * numBuckets; idx += kBlockSize)
+    {
+        warpBucketRows[idx / numBuckets][idx % numBuckets] += bucketOffsets[idx % numBuckets];
+    }
+    __syncthreads();
+
+    // The lanes with the same bucket are ranked by __match_any_sync, and the lowest of them moves the cursor.
+    for (int32_t base = rowBegin; base < rowEnd; base += kWarpSize)
+    {
+        auto const row = base + laneIdx;
+        bool const valid = row < rowEnd;
+        auto const active = __ballot_sync(kFullMask, valid);
+        if (valid)
+        {
+            auto const bucket = getBucket(row);
+            auto const peers = __match_any_sync(active, bucket);
+            auto const rank = __popc(peers & ((1u << laneIdx) - 1u));
+            auto const permutedRow = warpBucketRows[warpIdx][bucket] + rank;
+            __syncwarp(active);
+            if (rank == 0)
+            {
+                warpBucketRows[warpIdx][bucket] += __popc(peers);
+            }
+
+            auto const sourceRow = (row % params.topK) * params.numTokens + row / params.topK;
+            params.permutedRowToUnpermutedRow[permutedRow] = sourceRow;
+            params.unpermutedRowToPermutedRow[sourceRow] = permutedRow;
+        }
+        __syncwarp();
+    }
+}
+
+// Grid: [numTokens * topK], a CTA per permuted row.
+__global__ void __launch_bounds__(kBlockSize) moeExpandInputRowsKernel(int4 const* input, int64_t rowVecs,
+    int32_t const* permutedRowToUnpermutedRow, int64_t const* numValidRows, int32_t numTokens, int4* permutedInput)
+{
+    auto const permutedRow = static_cast<int64_t>(blockIdx.x);
+    if (permutedRow >= *numValidRows)
+    {
+        return;
+    }
+    auto const tokenIdx = permutedRowToUnpermutedRow[permutedRow] % numTokens;
+    auto const* src = input + tokenIdx * rowVecs;
+    auto* dst = permutedInput + permutedRow * rowVecs;
+    for (int64_t idx = threadIdx.x; idx < rowVecs; idx += kBlockSize)
+    {
+        dst[idx] = src[idx];
+    }
+}
+
+} // namespace
+
+void invokeMoeFusedRouting(MoeFusedRoutingParams const& params, cudaStream_t stream)
+{
+    params.checkParams();
+    if (params.numTokens <= 0)
+    {
+        return;
+    }
+
+    moeFusedRoutingKernel<<<1, kBlockSize, 0, stream>>>(params);
+    sync_check_cuda_error();
+}
+
+void invokeMoeExpandInputRows(void const* input, int64_t rowBytes, int32_t const* permutedRowToUnpermutedRow,
+    int64_t const* numValidRows, int32_t numTokens, int32_t topK, void* permutedInput, cudaStream_t stream)
+{
+    TLLM_CHECK_WITH_INFO(rowBytes % sizeof(int4) == 0, "The rows of %ld bytes are not 16B aligned", rowBytes);
+    if (numTokens <= 0)
+    {
+        return;
+    }
+
+    moeExpandInputRowsKernel<<<numTokens * topK, kBlockSize, 0, stream>>>(static_cast<int4 const*>(input),
+        rowBytes / static_cast<int64_t>(sizeof(int4)), permutedRowToUnpermutedRow, numValidRows, numTokens,
+        static_cast<int4*>(permutedInput));
+    sync_check_cuda_error();
+}
+
+} // namespace tensorrt_llm::kernels
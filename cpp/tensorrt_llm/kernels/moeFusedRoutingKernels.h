@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+// Largest number of experts the fused routing sorts with its counting sort.
+int32_t constexpr kMoeFusedRoutingMaxExperts = 256;
+
+// Layouts follow the MoE runner: the expanded source row of the j-th expert of token t is j * numTokens + t, and the
+// permuted rows are sorted by local expert and then by t * topK + j, as the radix sort of the runner orders them. The
+// rows routed to the experts of other EP ranks are placed after expertFirstTokenOffset[numLocalExperts].
+struct MoeFusedRoutingParams
+{
+    // Routing logits [numTokens, numExperts].
+    float const* routingLogits{nullptr};
+    // Selected experts, ordered by descending score [numTokens, topK].
+    int32_t* expertForSourceRow{nullptr};
+    // Softmax scores of the selected experts [numTokens, topK].
+    float* tokenTopkUnpermutedScales{nullptr};
+    // Expanded source row of every permuted row [numTokens * topK].
+    int32_t* permutedRowToUnpermutedRow{nullptr};
+    // Permuted row of every expanded source row [numTokens * topK].
+    int32_t* unpermutedRowToPermutedRow{nullptr};
+    // First permuted row of every local expert, the last entry is the number of rows of the local experts
+    // [numLocalExperts + 1].
+    int64_t* expertFirstTokenOffset{nullptr};
+    int32_t numTokens{0};
+    int32_t numExperts{0};
+    int32_t topK{0};
+    // Local experts of the EP rank [startExpert, endExpert).
+    int32_t startExpert{0};
+    int32_t endExpert{0};
+    // Normalize the scores of the selected experts to sum to 1.
+    bool renormalize{false};
+
+    void checkParams() const
+    {
+        TLLM_CHECK(routingLogits && expertForSourceRow && tokenTopkUnpermutedScales && permutedRowToUnpermutedRow
+            && unpermutedRowToPermutedRow && expertFirstTokenOffset);
+        TLLM_CHECK_WITH_INFO(numExperts <= kMoeFusedRoutingMaxExperts,
+            "The fused MoE routing supports at most %d experts, got %d", kMoeFusedRoutingMaxExperts, numExperts);
+        TLLM_CHECK(topK > 0 && topK <= numExperts);
+        TLLM_CHECK(startExpert >= 0 && startExpert <= endExpert && endExpert <= numExperts);
+    }
+};
+
+//! \brief Route the tokens of a MoE in a single CTA: top-k softmax of every token by a warp, then a stable counting
+//! sort of the expanded rows by expert, with per-warp histograms and __match_any_sync ranks, which replaces the radix
+//! sort, the offsets and the permutation kernels of the runner. Meant for the small token counts of the generation
+//! phase, where the fixed cost of the separate kernels dominates.
+void invokeMoeFusedRouting(MoeFusedRoutingParams const& params, cudaStream_t stream);
+
+//! \brief Copy the input row of every permuted row of the local experts, [numTokens, rowBytes] to
+//! [numTokens * topK, rowBytes]. `numValidRows` is expertFirstTokenOffset + numLocalExperts, so that the copies need no
+//! sync with the host.
+void invokeMoeExpandInputRows(void const* input, int64_t rowBytes, int32_t const* permutedRowToUnpermutedRow,
+    int64_t const* numValidRows, int32_t numTokens, int32_t topK, void* permutedInput, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/moeLoadBalanceKernels.h"
+#include "tensorrt_llm/kernels/moeRoutingUtils.cuh"
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+namespace
+{
+
+int32_t constexpr kWarpSize = 32;
+int32_t constexpr kWarpsPerCta = 4;
+int32_t constexpr kBlockSize = kWarpsPerCta * kWarpSize;
+
+// One warp per token.
+__global__ void __launch_bounds__(kBlockSize) moeMapLogicalToPhysicalExpertsKernel(MoeExpertPlacementParams params)
+{
+    auto const tokenIdx
+        = static_cast<int32_t>(blockIdx.x) * kWarpsPerCta + static_cast<int32_t>(threadIdx.x) / kWarpSize;
+    auto const laneIdx = static_cast<int32_t>(threadIdx.x) % kWarpSize;
+    if (tokenIdx >= params.numTokens)
+    {
+        return;
+    }
+
+    auto const* logical = params.logicalLogits + static_cast<size_t>(tokenIdx) * params.numLogicalExperts;
+    auto* physical = params.physicalLogits + static_cast<size_t>(tokenIdx) * params.numPhysicalExperts;
+    for (int32_t slot = laneIdx; slot < params.numPhysicalExperts; slot += kWarpSize)
+    {
+        physical[slot] = -INFINITY;
+    }
+    __syncwarp();
+
+    for (int32_t expert = laneIdx; expert < params.numLogicalExperts; expert += kWarpSize)
+    {
+        auto const replicaBegin = params.replicaOffsets[expert];
+        auto const numReplicas = params.replicaOffsets[expert + 1] - replicaBegin;
+        // Consecutive tokens and the experts of a token go to different replicas.
+        auto const replica = (tokenIdx + expert) % numReplicas;
+        physical[params.replicaSlots[replicaBegin + replica]] = logical[expert];
+    }
+
+    if (params.expertTokenCounts)
+    {
+        auto const threshold = getMoeTopKThreshold(logical, params.numLogicalExperts, params.topK);
+        for (int32_t expert = laneIdx; expert < params.numLogicalExperts; expert += kWarpSize)
+        {
+            if (logical[expert] >= threshold)
+            {
+                atomicAdd(&params.expertTokenCounts[expert], 1);
+            }
+        }
+    }
+}
+
+} // namespace
+
+void invokeMoeMapLogicalToPhysicalExperts(MoeExpertPlacementParams const& params, cudaStream_t stream)
+{
+    params.checkParams();
+    if (params.numTokens <= 0)
+    {
+        return;
+    }
+
+    moeMapLogicalToPhysicalExpertsKernel<<<divUp(params.numTokens, kWarpsPerCta), kBlockSize, 0, stream>>>(params);
+    sync_check_cuda_error();
+}
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+// The logical experts of the model are placed on the physical experts of the EP ranks, which the MoE runs. A hot expert
+// has several replicas and the tokens routed to it are spread over them.
+struct MoeExpertPlacementParams
+{
+    // Routing logits of the logical experts [numTokens, numLogicalExperts].
+    float const* logicalLogits{nullptr};
+    // Routing logits of the physical experts, -inf for the replicas a token is not sent to
+    // [numTokens, numPhysicalExperts].
+    float* physicalLogits{nullptr};
+    // Physical experts of every logical expert, those of logical expert e starting at replicaOffsets[e]
+    // [numPhysicalExperts].
+    int32_t const* replicaSlots{nullptr};
+    // Exclusive prefix sum of the number of replicas of every logical expert [numLogicalExperts + 1].
+    int32_t const* replicaOffsets{nullptr};
+    // Optional, the tokens routed to every logical expert are added to it [numLogicalExperts].
+    int32_t* expertTokenCounts{nullptr};
+    int32_t numTokens{0};
+    int32_t numLogicalExperts{0};
+    int32_t numPhysicalExperts{0};
+    int32_t topK{0};
+
+    void checkParams() const
+    {
+        TLLM_CHECK(logicalLogits && physicalLogits && replicaSlots && replicaOffsets);
+        TLLM_CHECK(topK > 0 && topK <= numLogicalExperts && numLogicalExperts <= numPhysicalExperts);
+    }
+};
+
+//! \brief Expand the routing logits of the logical experts to the physical experts. The tokens routed to an expert are
+//! sent to its replicas round robin, so that the softmax and the top-k of the MoE over the physical experts select the
+//! same experts with the same scales as over the logical ones. Also counts the tokens routed to every logical expert,
+//! which the placement of the replicas is balanced with.
+void invokeMoeMapLogicalToPhysicalExperts(MoeExpertPlacementParams const& params, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
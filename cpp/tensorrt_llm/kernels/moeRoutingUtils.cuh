@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Return the k-th largest of the routing logits of a token, computed by a warp. The experts with a logit at
+//! least the returned one are a superset of the top-k experts selected by the MoE, which includes the ties.
+__device__ inline float getMoeTopKThreshold(float const* logits, int32_t numExperts, int32_t topK)
+{
+    int32_t constexpr kWarpSize = 32;
+    auto const laneIdx = static_cast<int32_t>(threadIdx.x) % kWarpSize;
+
+    // Lower the threshold through the distinct values of the logits.
+    float threshold = INFINITY;
+    bool inclusive = true;
+    int32_t numSelected = 0;
+    while (numSelected < topK)
+    {
+        float localMax = -INFINITY;
+        for (int32_t expert = laneIdx; expert < numExperts; expert += kWarpSize)
+        {
+            auto const logit = logits[expert];
+            if (inclusive ? logit <= threshold : logit < threshold)
+            {
+                localMax = fmaxf(localMax, logit);
+            }
+        }
+        for (int32_t offset = kWarpSize / 2; offset > 0; offset /= 2)
+        {
+            localMax = fmaxf(localMax, __shfl_xor_sync(0xffffffff, localMax, offset));
+        }
+        int32_t localCount = 0;
+        for (int32_t expert = laneIdx; expert < numExperts; expert += kWarpSize)
+        {
+            localCount += logits[expert] == localMax ? 1 : 0;
+        }
+        for (int32_t offset = kWarpSize / 2; offset > 0; offset /= 2)
+        {
+            localCount += __shfl_xor_sync(0xffffffff, localCount, offset);
+        }
+        threshold = localMax;
+        inclusive = false;
+        if (localCount == 0)
+        {
+            // Only NaN logits are left.
+            break;
+        }
+        numSelected += localCount;
+    }
+    return threshold;
+}
+
+} // namespace tensorrt_llm::kernels
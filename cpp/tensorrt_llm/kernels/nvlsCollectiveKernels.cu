@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/dataType.h"
+#include "tensorrt_llm/common/reduceKernelUtils.cuh"
+#include "tensorrt_llm/kernels/nvlsCollectiveKernels.h"
+
+#include <algorithm>
+#include <type_traits>
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+constexpr int kThreads = 512;
+constexpr int kMaxRowVectorsPerThread = kNvlsMaxRowVectors / kThreads;
+static_assert(sizeof(uint4) == kNvlsVectorBytes);
+
+template <typename T>
+union NvlsPacked
+{
+    uint4 packed;
+    T elts[sizeof(uint4) / sizeof(T)];
+};
+
+//! \brief Sum of the vector at the multicast address over all the ranks.
+template <typename T>
+__device__ __forceinline__ uint4 multimemLdReduce(uint4 const* mcPtr)
+{
+    uint4 val{};
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 900
+    if constexpr (std::is_same_v<T, float>)
+    {
+        asm volatile("multimem.ld_reduce.relaxed.sys.global.add.v4.f32 {%0,%1,%2,%3}, [%4];"
+                     : "=r"(val.x), "=r"(val.y), "=r"(val.z), "=r"(val.w)
+                     : "l"(mcPtr)
+                     : "memory");
+    }
+    else if constexpr (std::is_same_v<T, half>)
+    {
+        asm volatile("multimem.ld_reduce.relaxed.sys.global.add.acc::f32.v4.f16x2 {%0,%1,%2,%3}, [%4];"
+                     : "=r"(val.x), "=r"(val.y), "=r"(val.z), "=r"(val.w)
+                     : "l"(mcPtr)
+                     : "memory");
+    }
+#ifdef ENABLE_BF16
+    else if constexpr (std::is_same_v<T, __nv_bfloat16>)
+    {
+        asm volatile("multimem.ld_reduce.relaxed.sys.global.add.acc::f32.v4.bf16x2 {%0,%1,%2,%3}, [%4];"
+                     : "=r"(val.x), "=r"(val.y), "=r"(val.z), "=r"(val.w)
+                     : "l"(mcPtr)
+                     : "memory");
+    }
+#endif
+#endif
+    return val;
+}
+
+//! \brief Store the vector at the multicast address, on all the ranks.
+__device__ __forceinline__ void multimemSt(uint4* mcPtr, uint4 const& val)
+{
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 900
+    asm volatile("multimem.st.relaxed.sys.global.v4.f32 [%0], {%1,%2,%3,%4};" ::"l"(mcPtr), "r"(val.x), "r"(val.y),
+                 "r"(val.z), "r"(val.w)
+                 : "memory");
+#endif
+}
+
+//! \brief Barrier of the blocks of the same index on all the ranks. The epoch of the barrier stays in the flags of
+//! this rank from one collective to the next, so that the kernels can be captured in CUDA graphs. At every barrier,
+//! each rank adds one to the counter of the block on all the ranks, over multicast, and waits for its own counter to
+//! count the arrivals of all the ranks.
+//!
+//! All the collectives access an element of the workspace from the block of the same index on all the ranks, so the
+//! barriers of the blocks order all the accesses.
+class NvlsBlockBarrier
+{
+public:
+    __device__ explicit NvlsBlockBarrier(NvlsCollectiveParams const& params)
+        : mUcCounter{params.ucFlags + blockIdx.x}
+        , mMcCounter{params.mcFlags + blockIdx.x}
+        , mEpochPtr{params.ucFlags + kNvlsMaxBlocks + blockIdx.x}
+        , mNRanks{static_cast<uint32_t>(params.nRanks)}
+    {
+        if (threadIdx.x == 0)
+        {
+            mEpoch = *mEpochPtr;
+        }
+    }
+
+    __device__ void sync()
+    {
+        __syncthreads();
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 900
+        if (threadIdx.x == 0)
+        {
+            ++mEpoch;
+            asm volatile("multimem.red.release.sys.global.add.u32 [%0], %1;" ::"l"(mMcCounter), "n"(1) : "memory");
+            uint32_t const target = mEpoch * mNRanks;
+            uint32_t arrived;
+            do
+            {
+                asm volatile("ld.acquire.sys.global.u32 %0, [%1];" : "=r"(arrived) : "l"(mUcCounter) : "memory");
+                // The counter wraps around, compare the distance to the target.
+            } while (static_cast<int32_t>(arrived - target) < 0);
+            asm volatile("fence.proxy.alias;" ::: "memory");
+        }
+#endif
+        __syncthreads();
+    }
+
+    __device__ ~NvlsBlockBarrier()
+    {
+        if (threadIdx.x == 0)
+        {
+            *mEpochPtr = mEpoch;
+        }
+    }
+
+private:
+    uint32_t* mUcCounter;
+    uint32_t* mMcCounter;
+    uint32_t* mEpochPtr;
+    uint32_t mNRanks;
+    uint32_t mEpoch{0};
+};
+
+//! \brief Vectors [begin, end) of a slice handled by this thread, the same ones on all the ranks.
+template <typename Fn>
+__device__ __forceinline__ void forEachVector(size_t begin, size_t end, Fn&& fn)
+{
+    auto const stride = static_cast<size_t>(gridDim.x) * blockDim.x;
+    for (auto i = begin + blockIdx.x * blockDim.x + threadIdx.x; i < end; i += stride)
+    {
+        fn(i);
+    }
+}
+
+__device__ __forceinline__ size_t sliceBegin(size_t count, int slice, int nSlices)
+{
+    auto const begin = slice * ((count + nSlices - 1) / nSlices);
+    return begin < count ? begin : count;
+}
+
+template <typename T>
+__global__ void __launch_bounds__(kThreads) nvlsAllReduceKernel(NvlsCollectiveParams params)
+{
+    NvlsBlockBarrier barrier(params);
+    auto const numVecs = params.numElements * sizeof(T) / sizeof(uint4);
+    auto const* input = reinterpret_cast<uint4 const*>(params.input);
+    auto* output = reinterpret_cast<uint4*>(params.output);
+    auto* uc = reinterpret_cast<uint4*>(params.ucBuffer);
+    auto* mc = reinterpret_cast<uint4*>(params.mcBuffer);
+
+    for (int slice = 0; slice < params.nRanks; ++slice)
+    {
+        forEachVector(sliceBegin(numVecs, slice, params.nRanks), sliceBegin(numVecs, slice + 1, params.nRanks),
+            [&](size_t i) { uc[i] = input[i]; });
+    }
+    barrier.sync();
+
+    // Reduce the slice of this rank and broadcast the sums.
+    forEachVector(sliceBegin(numVecs, params.rank, params.nRanks), sliceBegin(numVecs, params.rank + 1, params.nRanks),
+        [&](size_t i) { multimemSt(mc + i, multimemLdReduce<T>(mc + i)); });
+    barrier.sync();
+
+    for (int slice = 0; slice < params.nRanks; ++slice)
+    {
+        forEachVector(sliceBegin(numVecs, slice, params.nRanks), sliceBegin(numVecs, slice + 1, params.nRanks),
+            [&](size_t i) { output[i] = uc[i]; });
+    }
+}
+
+template <typename T>
+__global__ void __launch_bounds__(kThreads) nvlsReduceScatterKernel(NvlsCollectiveParams params)
+{
+    NvlsBlockBarrier barrier(params);
+    auto const numVecs = params.numElements * sizeof(T) / sizeof(uint4);
+    auto const* input = reinterpret_cast<uint4 const*>(params.input);
+    auto* output = reinterpret_cast<uint4*>(params.output);
+    auto* uc = reinterpret_cast<uint4*>(params.ucBuffer);
+    auto* mc = reinterpret_cast<uint4*>(params.mcBuffer);
+
+    for (int slice = 0; slice < params.nRanks; ++slice)
+    {
+        auto const offset = slice * numVecs;
+        forEachVector(offset, offset + numVecs, [&](size_t i) { uc[i] = input[i]; });
+    }
+    barrier.sync();
+
+    auto const offset = params.rank * numVecs;
+    forEachVector(offset, offset + numVecs, [&](size_t i) { output[i - offset] = multimemLdReduce<T>(mc + i); });
+    // The other ranks may still reduce from the workspace of this rank.
+    barrier.sync();
+}
+
+__global__ void __launch_bounds__(kThreads) nvlsAllGatherKernel(NvlsCollectiveParams params, size_t numVecs)
+{
+    NvlsBlockBarrier barrier(params);
+    auto const* input = reinterpret_cast<uint4 const*>(params.input);
+    auto* output = reinterpret_cast<uint4*>(params.output);
+    auto* uc = reinterpret_cast<uint4*>(params.ucBuffer);
+    auto* mc = reinterpret_cast<uint4*>(params.mcBuffer);
+
+    auto const offset = params.rank * numVecs;
+    forEachVector(offset, offset + numVecs,
+        [&](size_t i)
+        {
+            auto const val = input[i - offset];
+            multimemSt(mc + i, val);
+            output[i] = val;
+        });
+    barrier.sync();
+
+    for (int slice = 0; slice < params.nRanks; ++slice)
+    {
+        if (slice != params.rank)
+        {
+            auto const sliceOffset = slice * numVecs;
+            forEachVector(sliceOffset, sliceOffset + numVecs, [&](size_t i) { output[i] = uc[i]; });
+        }
+    }
+    // The other ranks may still read their workspace, which the next collective of this rank writes.
+    barrier.sync();
+}
+
+//! \brief Each rank reduces and normalizes the rows [rank * rowsPerRank, (rank + 1) * rowsPerRank), one row per
+//! block at a time, and broadcasts the sums with the residual to the data of the workspace, in place, and the
+//! normalized rows to the second half of the workspace.
+template <typename T>
+__global__ void __launch_bounds__(kThreads) nvlsAllReduceResidualRmsNormKernel(NvlsCollectiveParams params)
+{
+    using Packed = NvlsPacked<T>;
+    constexpr int kEltsPerVec = sizeof(uint4) / sizeof(T);
+
+    NvlsBlockBarrier barrier(params);
+    auto const hiddenVecs = static_cast<size_t>(params.fusion.hiddenSize) / kEltsPerVec;
+    auto const numRows = params.numElements / params.fusion.hiddenSize;
+    auto const numVecs = numRows * hiddenVecs;
+    auto const* input = reinterpret_cast<uint4 const*>(params.input);
+    auto const* residual = reinterpret_cast<uint4 const*>(params.fusion.residual);
+    auto const* bias = reinterpret_cast<uint4 const*>(params.fusion.bias);
+    auto const* weight = reinterpret_cast<uint4 const*>(params.fusion.weight);
+    auto* output = reinterpret_cast<uint4*>(params.output);
+    auto* residualOutput = reinterpret_cast<uint4*>(params.fusion.residualOutput);
+    auto* uc = reinterpret_cast<uint4*>(params.ucBuffer);
+    auto* mc = reinterpret_cast<uint4*>(params.mcBuffer);
+
+    auto forEachRow = [&](int rank, auto&& fn)
+    {
+        auto const end = sliceBegin(numRows, rank + 1, params.nRanks);
+        for (auto row = sliceBegin(numRows, rank, params.nRanks) + blockIdx.x; row < end; row += gridDim.x)
+        {
+            fn(row * hiddenVecs);
+        }
+    };
+
+    for (int rank = 0; rank < params.nRanks; ++rank)
+    {
+        forEachRow(rank,
+            [&](size_t rowOffset)
+            {
+                for (auto v = threadIdx.x; v < hiddenVecs; v += blockDim.x)
+                {
+                    uc[rowOffset + v] = input[rowOffset + v];
+                }
+            });
+    }
+    barrier.sync();
+
+    __shared__ float sInvRms;
+    forEachRow(params.rank,
+        [&](size_t rowOffset)
+        {
+            Packed sums[kMaxRowVectorsPerThread];
+            float sumSquares = 0.f;
+#pragma unroll
+            for (int k = 0; k < kMaxRowVectorsPerThread; ++k)
+            {
+                auto const v = threadIdx.x + k * blockDim.x;
+                if (v < hiddenVecs)
+                {
+                    Packed reduced, res, b;
+                    reduced.packed = multimemLdReduce<T>(mc + rowOffset + v);
+                    res.packed = residual[rowOffset + v];
+                    b.packed = bias != nullptr ? bias[v] : uint4{};
+#pragma unroll
+                    for (int e = 0; e < kEltsPerVec; ++e)
+                    {
+                        float const sum = cuda_cast<float>(reduced.elts[e]) + cuda_cast<float>(res.elts[e])
+                            + (bias != nullptr ? cuda_cast<float>(b.elts[e]) : 0.f);
+                        sums[k].elts[e] = cuda_cast<T>(sum);
+                        float const rounded = cuda_cast<float>(sums[k].elts[e]);
+                        sumSquares += rounded * rounded;
+                    }
+                    multimemSt(mc + rowOffset + v, sums[k].packed);
+                }
+            }
+            sumSquares = blockReduceSum<float>(sumSquares);
+            if (threadIdx.x == 0)
+            {
+                sInvRms = rsqrtf(sumSquares / params.fusion.hiddenSize + params.fusion.eps);
+            }
+            __syncthreads();
+#pragma unroll
+            for (int k = 0; k < kMaxRowVectorsPerThread; ++k)
+            {
+                auto const v = threadIdx.x + k * blockDim.x;
+                if (v < hiddenVecs)
+                {
+                    Packed normed, w;
+                    w.packed = weight != nullptr ? weight[v] : uint4{};
+#pragma unroll
+                    for (int e = 0; e < kEltsPerVec; ++e)
+                    {
+                        float const scaled = cuda_cast<float>(sums[k].elts[e]) * sInvRms;
+                        normed.elts[e]
+                            = cuda_cast<T>(weight != nullptr ? scaled * cuda_cast<float>(w.elts[e]) : scaled);
+                    }
+                    multimemSt(mc + numVecs + rowOffset + v, normed.packed);
+                }
+            }
+        });
+    barrier.sync();
+
+    for (int rank = 0; rank < params.nRanks; ++rank)
+    {
+        forEachRow(rank,
+            [&](size_t rowOffset)
+            {
+                for (auto v = threadIdx.x; v < hiddenVecs; v += blockDim.x)
+                {
+                    residualOutput[rowOffset + v] = uc[rowOffset + v];
+                    output[rowOffset + v] = uc[numVecs + rowOffset + v];
+                }
+            });
+    }
+}
+
+template <typename Fn>
+void dispatchNvlsDataType(nvinfer1::DataType dataType, Fn&& fn)
+{
+    switch (dataType)
+    {
+    case nvinfer1::DataType::kFLOAT: fn(float{}); break;
+    case nvinfer1::DataType::kHALF: fn(half{}); break;
+#ifdef ENABLE_BF16
+    case nvinfer1::DataType::kBF16: fn(__nv_bfloat16{}); break;
+#endif
+    default: TLLM_THROW("Unsupported data type for the NVLS collectives");
+    }
+}
+
+void checkNvlsParams(NvlsCollectiveParams const& params, nvinfer1::DataType dataType)
+{
+    TLLM_CHECK_WITH_INFO(common::getSMVersion() >= 90, "The NVLS collectives need sm90 or later");
+    TLLM_CHECK(params.ucBuffer != nullptr && params.mcBuffer != nullptr);
+    TLLM_CHECK(params.ucFlags != nullptr && params.mcFlags != nullptr);
+    TLLM_CHECK(params.rank >= 0 && params.rank < params.nRanks);
+    TLLM_CHECK_WITH_INFO(nvlsCollectiveSupported(dataType, params.numElements * common::getDTypeSize(dataType)),
+        "NVLS collectives need float, half or bfloat16 messages of a multiple of 16 bytes");
+}
+
+unsigned int nvlsGridSize(size_t numVecs)
+{
+    return static_cast<unsigned int>(std::clamp<size_t>(common::divUp(numVecs, kThreads), 1, kNvlsMaxBlocks));
+}
+
+} // namespace
+
+bool nvlsCollectiveSupported(nvinfer1::DataType dataType, std::size_t messageSize)
+{
+    auto const supportedType = dataType == nvinfer1::DataType::kFLOAT || dataType == nvinfer1::DataType::kHALF
+#ifdef ENABLE_BF16
+        || dataType == nvinfer1::DataType::kBF16
+#endif
+        ;
+    return supportedType && messageSize > 0 && messageSize % kNvlsVectorBytes == 0;
+}
+
+void invokeNvlsAllReduce(NvlsCollectiveParams const& params, nvinfer1::DataType dataType, cudaStream_t stream)
+{
+    checkNvlsParams(params, dataType);
+    auto const numVecs = params.numElements * common::getDTypeSize(dataType) / sizeof(uint4);
+    auto const grid = nvlsGridSize(common::divUp(numVecs, params.nRanks));
+    dispatchNvlsDataType(dataType,
+        [&](auto tag)
+        {
+            using T = decltype(tag);
+            nvlsAllReduceKernel<T><<<grid, kThreads, 0, stream>>>(params);
+        });
+    sync_check_cuda_error();
+}
+
+void invokeNvlsReduceScatter(NvlsCollectiveParams const& params, nvinfer1::DataType dataType, cudaStream_t stream)
+{
+    checkNvlsParams(params, dataType);
+    auto const numVecs = params.numElements * common::getDTypeSize(dataType) / sizeof(uint4);
+    dispatchNvlsDataType(dataType,
+        [&](auto tag)
+        {
+            using T = decltype(tag);
+            nvlsReduceScatterKernel<T><<<nvlsGridSize(numVecs), kThreads, 0, stream>>>(params);
+        });
+    sync_check_cuda_error();
+}
+
+void invokeNvlsAllGather(NvlsCollectiveParams const& params, nvinfer1::DataType dataType, cudaStream_t stream)
+{
+    checkNvlsParams(params, dataType);
+    // The gather only moves bytes, no need to instantiate it per type.
+    auto const numVecs = params.numElements * common::getDTypeSize(dataType) / sizeof(uint4);
+    nvlsAllGatherKernel<<<nvlsGridSize(numVecs), kThreads, 0, stream>>>(params, numVecs);
+    sync_check_cuda_error();
+}
+
+void invokeNvlsAllReduceResidualRmsNorm(
+    NvlsCollectiveParams const& params, nvinfer1::DataType dataType, cudaStream_t stream)
+{
+    checkNvlsParams(params, dataType);
+    auto const hiddenSize = params.fusion.hiddenSize;
+    TLLM_CHECK(params.fusion.residual != nullptr && params.fusion.residualOutput != nullptr);
+    TLLM_CHECK_WITH_INFO(hiddenSize > 0 && params.numElements % hiddenSize == 0,
+        "The elements of the fused RMSNorm are not a number of rows of hidden size %d", hiddenSize);
+    auto const rowBytes = hiddenSize * common::getDTypeSize(dataType);
+    TLLM_CHECK_WITH_INFO(rowBytes % sizeof(uint4) == 0 && rowBytes / sizeof(uint4) <= kNvlsMaxRowVectors,
+        "Hidden size %d of the NVLS fused RMSNorm not supported", hiddenSize);
+
+    auto const hiddenVecs = static_cast<int>(rowBytes / sizeof(uint4));
+    auto const rowsPerRank = common::divUp(params.numElements / hiddenSize, params.nRanks);
+    auto const grid = static_cast<unsigned int>(std::clamp<size_t>(rowsPerRank, 1, kNvlsMaxBlocks));
+    auto const block = std::min(kThreads, common::roundUp(hiddenVecs, 32));
+    dispatchNvlsDataType(dataType,
+        [&](auto tag)
+        {
+            using T = decltype(tag);
+            nvlsAllReduceResidualRmsNormKernel<T><<<grid, block, 0, stream>>>(params);
+        });
+    sync_check_cuda_error();
+}
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <NvInferRuntime.h>
+#include <cstddef>
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Most blocks of a NVLS collective. The ranks synchronize per block, over one flag per block.
+static constexpr int kNvlsMaxBlocks = 32;
+//! \brief Flags of a NVLS workspace: the arrival counters, written over multicast, and the barrier epochs of this
+//! rank, written over unicast only.
+static constexpr int kNvlsNumFlags = 2 * kNvlsMaxBlocks;
+//! \brief The collectives move vectors of 16 bytes, the sizes must be multiples of it.
+static constexpr std::size_t kNvlsVectorBytes = 16;
+//! \brief Largest hidden size of the fused RMSNorm, in vectors.
+static constexpr int kNvlsMaxRowVectors = 2048;
+
+//! \brief Collectives over a NVLS multicast object of the ranks of a NVSwitch node, see runtime::IpcNvlsHandle. The
+//! reductions are multimem.ld_reduce of the multicast address, the broadcasts multimem.st, so that NVSwitch does the
+//! arithmetic and a few blocks reach the NVLink bandwidth. Needs sm90, sizes multiple of 16 bytes and the same
+//! collective with the same sizes on all the ranks.
+struct NvlsCollectiveParams
+{
+    //! Unicast and multicast addresses of the data of the workspace, as large as the larger of input and output, twice
+    //! the input for the fused RMSNorm.
+    void* ucBuffer{nullptr};
+    void* mcBuffer{nullptr};
+    //! Unicast and multicast addresses of the kNvlsNumFlags flags of the workspace, zero before the first collective.
+    uint32_t* ucFlags{nullptr};
+    uint32_t* mcFlags{nullptr};
+
+    //! All-reduce: [numElements] in and out, input and output can alias.
+    //! Reduce-scatter: [nRanks, numElements] in, [numElements] out, the slice of this rank.
+    //! All-gather: [numElements] in, [nRanks, numElements] out.
+    void const* input{nullptr};
+    void* output{nullptr};
+    std::size_t numElements{0};
+
+    int rank{0};
+    int nRanks{1};
+
+    //! The fused all-reduce, residual and RMSNorm of invokeNvlsAllReduceResidualRmsNorm, on [numElements / hiddenSize,
+    //! hiddenSize]. output is the normalized sum, residualOutput the sum of the reduction, the bias and the residual.
+    struct FusionParams
+    {
+        void const* residual{nullptr};
+        //! [hiddenSize], optional.
+        void const* bias{nullptr};
+        void const* weight{nullptr};
+        void* residualOutput{nullptr};
+        int hiddenSize{0};
+        float eps{1e-6f};
+    } fusion;
+};
+
+//! \brief Whether the collectives of the data type, of messageSize bytes per rank, can run over NVLS.
+bool nvlsCollectiveSupported(nvinfer1::DataType dataType, std::size_t messageSize);
+
+void invokeNvlsAllReduce(NvlsCollectiveParams const& params, nvinfer1::DataType dataType, cudaStream_t stream);
+
+void invokeNvlsReduceScatter(NvlsCollectiveParams const& params, nvinfer1::DataType dataType, cudaStream_t stream);
+
+void invokeNvlsAllGather(NvlsCollectiveParams const& params, nvinfer1::DataType dataType, cudaStream_t stream);
+
+//! \brief All-reduce, add the bias and the residual and normalize the rows, each rank normalizing its share of them
+//! and broadcasting the results, so that the rows are reduced once.
+void invokeNvlsAllReduceResidualRmsNorm(
+    NvlsCollectiveParams const& params, nvinfer1::DataType dataType, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
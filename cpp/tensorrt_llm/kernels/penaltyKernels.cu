@@ -17,6 +17,7 @@
 #include "tensorrt_llm/kernels/penaltyKernels.h"
 
 #include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/pdlUtils.cuh"
 #include "tensorrt_llm/common/reduceKernelUtils.cuh"
 #include "tensorrt_llm/kernels/decodingCommon.h"
 #include "tensorrt_llm/layers/defaultDecodingParams.h"
@@ -35,6 +36,54 @@ __device__ bool almostEqual(float a, float b, float epsilon)
     return fabs(a - b) < epsilon;
 }
 
+namespace
+{
+TokenIdType constexpr kEmptyOccurrence = -1;
+
+//! \brief Count n more occurrences of token in an open addressing table with keys followed by counts.
+//! Safe to call concurrently. The table must have more slots than distinct tokens.
+__device__ void addOccurrences(TokenIdType* table, SizeType32 tableSize, TokenIdType token, SizeType32 n)
+{
+    auto* counts = table + tableSize;
+    auto slot = static_cast<SizeType32>((static_cast<uint32_t>(token) * 2654435761u) & (tableSize - 1));
+    while (true)
+    {
+        auto const prev = atomicCAS(&table[slot], kEmptyOccurrence, token);
+        if (prev == kEmptyOccurrence || prev == token)
+        {
+            atomicAdd(&counts[slot], n);
+            return;
+        }
+        slot = (slot + 1) & (tableSize - 1);
+    }
+}
+
+__device__ float applyOccurrencePenalties(float logit, SizeType32 numOccurences, float const* repetitionPenalties,
+    float repetitionPenalty, float const* presencePenalties, float presencePenalty, float const* frequencyPenalties,
+    float frequencyPenalty)
+{
+    if (numOccurences > 0)
+    {
+        // Repetition
+        if (repetitionPenalties != nullptr)
+        {
+            logit = logit < 0.0f ? logit * repetitionPenalty : logit / repetitionPenalty;
+        }
+        // Presence
+        if (presencePenalties != nullptr)
+        {
+            logit -= presencePenalty;
+        }
+        // Frequency
+        if (frequencyPenalties != nullptr)
+        {
+            logit -= frequencyPenalty * numOccurences;
+        }
+    }
+    return logit;
+}
+} // namespace
+
 template <typename T>
 __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits, T const* biases,
     TokenIdType* penaltyWorkspace, TokenIdType const* penaltyWorkspacePrev, float const* temperatures,
@@ -42,13 +91,18 @@ __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits,
     SizeType32 maxSeqLen, SizeType32 vocabSize, SizeType32 vocabSizePadded, TokenIdType const** outputIdsPtr,
     SizeType32 const** parentIdsPtr, SizeType32 const* inputLengths, SizeType32 const* sequenceLengths,
     SizeType32 const* minLengths, TokenIdType const* endIds, SizeType32 const* batchSlots,
-    SizeType32 const* tokensPerStep, FinishedState const* finished)
+    SizeType32 const* tokensPerStep, FinishedState const* finished, bool countOccurrencesOnly,
+    SizeType32 occurrenceTableSize)
 {
     auto const beamWidth = static_cast<SizeType32>(gridDim.y);
     auto const maxTokensPerStep = static_cast<SizeType32>(gridDim.z);
     auto const batchIdx = static_cast<SizeType32>(blockIdx.x);
     auto const beamIdx = static_cast<SizeType32>(blockIdx.y);
     auto const stepIdx = static_cast<SizeType32>(blockIdx.z);
+
+    pdlWaitPrimaryGrid();
+    pdlLaunchDependents();
+
     auto const batchSlot = batchSlots[batchIdx];
 
     FinishedState const finishState = finished != nullptr ? finished[batchSlot] : FinishedState::empty();
@@ -105,7 +159,55 @@ __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits,
     }
 
     // Initialize or update the number of occurrences of tokens
-    if (accumulateVocab)
+    bool const isSparse = occurrenceTableSize > 0;
+    if (accumulateVocab && isSparse)
+    {
+        // Keys and counts of the tokens seen by this beam.
+        auto const rowSize = 2 * occurrenceTableSize;
+        penaltyWorkspace += batchBeamStepIdx * rowSize;
+        if (currentStep <= inputLen)
+        { // Context phase
+            for (auto index = static_cast<SizeType32>(threadIdx.x); index < rowSize;
+                 index += static_cast<SizeType32>(blockDim.x))
+            {
+                penaltyWorkspace[index] = index < occurrenceTableSize ? kEmptyOccurrence : 0;
+            }
+            __syncthreads();
+            for (auto step = static_cast<SizeType32>(threadIdx.x); step < inputLen;
+                 step += static_cast<SizeType32>(blockDim.x))
+            {
+                auto penaltyIndex = outputIdsPtr[batchSlot][beamIdx * maxSeqLen + step];
+                if (penaltyIndex < vocabSize)
+                {
+                    addOccurrences(penaltyWorkspace, occurrenceTableSize, penaltyIndex, 1);
+                }
+            }
+        }
+        else
+        { // Generation phase
+            if (beamWidth > 1)
+            {
+                auto parentBeam = parentIdsPtr[batchSlot][beamIdx * maxSeqLen + currentStep - 1];
+                penaltyWorkspacePrev += ((batchIdx * beamWidth + parentBeam) * maxTokensPerStep + stepIdx) * rowSize;
+                for (auto index = static_cast<SizeType32>(threadIdx.x); index < rowSize;
+                     index += static_cast<SizeType32>(blockDim.x))
+                {
+                    penaltyWorkspace[index] = penaltyWorkspacePrev[index];
+                }
+                __syncthreads();
+            }
+            if (threadIdx.x == 0)
+            {
+                auto penaltyIndex = outputIdsPtr[batchSlot][beamIdx * maxSeqLen + currentStep - 1];
+                if (penaltyIndex < vocabSize)
+                {
+                    addOccurrences(penaltyWorkspace, occurrenceTableSize, penaltyIndex, 1);
+                }
+            }
+        }
+        __syncthreads();
+    }
+    else if (accumulateVocab)
     {
         penaltyWorkspace += batchBeamStepIdx * vocabSize;
         if (currentStep <= inputLen)
@@ -151,6 +253,10 @@ __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits,
         }
         __syncthreads();
     }
+    if (countOccurrencesOnly)
+    {
+        return;
+    }
 
     // Apply bias and penalties
     auto const inLogitsPtr = inputLogits[batchIdx] + (beamIdx * maxTokensPerStep + stepIdx) * vocabSizePadded;
@@ -172,27 +278,10 @@ __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits,
             {
                 logit *= invTemperature;
             }
-            if (accumulateVocab)
+            if (accumulateVocab && !isSparse)
             {
-                SizeType32 numOccurences = penaltyWorkspace[index];
-                if (numOccurences > 0)
-                {
-                    // Repetition
-                    if (repetitionPenalties != nullptr)
-                    {
-                        logit = logit < 0.0f ? logit * repetitionPenalty : logit / repetitionPenalty;
-                    }
-                    // Presence
-                    if (presencePenalties != nullptr)
-                    {
-                        logit -= presencePenalty;
-                    }
-                    // Frequency
-                    if (frequencyPenalties != nullptr)
-                    {
-                        logit -= frequencyPenalty * numOccurences;
-                    }
-                }
+                logit = applyOccurrencePenalties(logit, penaltyWorkspace[index], repetitionPenalties,
+                    repetitionPenalty, presencePenalties, presencePenalty, frequencyPenalties, frequencyPenalty);
             }
             // do clamp to prevent overflow
             if (logit > static_cast<float>(-MASK_VAL))
@@ -210,6 +299,34 @@ __global__ void batchApplyPenalty(T const* const* inputLogits, T* outputLogits,
             outLogitsPtr[index] = MASK_VAL;
         }
     }
+    if (accumulateVocab && isSparse)
+    {
+        // Scatter the penalties to the seen tokens only, recomputing their logits from the input.
+        __syncthreads();
+        auto const* counts = penaltyWorkspace + occurrenceTableSize;
+        for (auto slot = static_cast<SizeType32>(threadIdx.x); slot < occurrenceTableSize;
+             slot += static_cast<SizeType32>(blockDim.x))
+        {
+            auto const index = penaltyWorkspace[slot];
+            if (index == kEmptyOccurrence)
+            {
+                continue;
+            }
+            auto logit = static_cast<float>(inLogitsPtr[index]);
+            if (biases != nullptr)
+            {
+                logit += static_cast<float>(biasBase[index]);
+            }
+            if (hasTemperature)
+            {
+                logit *= invTemperature;
+            }
+            logit = applyOccurrencePenalties(logit, counts[slot], repetitionPenalties, repetitionPenalty,
+                presencePenalties, presencePenalty, frequencyPenalties, frequencyPenalty);
+            // do clamp to prevent overflow
+            outLogitsPtr[index] = fminf(fmaxf(logit, static_cast<float>(MASK_VAL)), static_cast<float>(-MASK_VAL));
+        }
+    }
     if (hasMinLength)
     {
         __syncthreads();
@@ -227,11 +344,12 @@ void invokeBatchApplyPenalty(InvokeBatchApplyPenaltyParams<T> const& params)
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
     dim3 block(512);
     dim3 grid(params.batchSize, params.beamWidth, params.maxTokensPerStep);
-    batchApplyPenalty<T><<<grid, block, 0, params.stream>>>(params.inputLogits, params.outputLogits, params.biases,
-        params.penaltyWorkspace, params.penaltyWorkspacePrev, params.temperatures, params.repetitionPenalties,
-        params.presencePenalties, params.frequencyPenalties, params.maxSeqLen, params.vocabSize, params.vocabSizePadded,
-        params.outputIdsPtr, params.parentIdsPtr, params.inputLengths, params.sequenceLengths, params.minLengths,
-        params.endIds, params.batchSlots, params.tokensPerStep, params.finished);
+    launchWithPdl(batchApplyPenalty<T>, grid, block, 0, params.stream, params.inputLogits, params.outputLogits,
+        params.biases, params.penaltyWorkspace, params.penaltyWorkspacePrev, params.temperatures,
+        params.repetitionPenalties, params.presencePenalties, params.frequencyPenalties, params.maxSeqLen,
+        params.vocabSize, params.vocabSizePadded, params.outputIdsPtr, params.parentIdsPtr, params.inputLengths,
+        params.sequenceLengths, params.minLengths, params.endIds, params.batchSlots, params.tokensPerStep,
+        params.finished, params.countOccurrencesOnly, params.occurrenceTableSize);
 }
 
 template void invokeBatchApplyPenalty(InvokeBatchApplyPenaltyParams<float> const& params);
@@ -51,6 +51,12 @@ struct InvokeBatchApplyPenaltyParams
     runtime::SizeType32 const* tokensPerStep;
     FinishedState const* finished;
     cudaStream_t stream;
+    //! Only update the occurrence counts in penaltyWorkspace, the top-k sampling kernel applies the penalties.
+    bool countOccurrencesOnly{false};
+    //! Slots of the per beam occurrence table in penaltyWorkspace, a power of 2 larger than the number of distinct
+    //! tokens. Each row then holds the keys followed by the counts of the seen tokens instead of a count per vocab
+    //! entry, and the penalties are scattered to the seen tokens. 0 for a dense [vocabSize] row.
+    runtime::SizeType32 occurrenceTableSize{0};
 };
 
 template <typename T>
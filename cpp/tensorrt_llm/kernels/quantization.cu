@@ -99,13 +99,13 @@ void invokePerTokenQuantization(QuantT* dst, T const* src, int64_t const numRows
     // Do we use smem ?
     if (useSmem)
     {
-        perTokenQuantization<T, QuantT, true><<<grid, block, dynamicSmemSz, stream>>>(
-            dst, src, numRows, numCols, clampPtr, scalePtr, sumPtr, hasFp8MinScaling);
+        launchWithPdl(perTokenQuantization<T, QuantT, true>, grid, block, dynamicSmemSz, stream, dst, src, numRows,
+            numCols, clampPtr, scalePtr, sumPtr, hasFp8MinScaling);
     }
     else
     {
-        perTokenQuantization<T, QuantT, false>
-            <<<grid, block, 0, stream>>>(dst, src, numRows, numCols, clampPtr, scalePtr, sumPtr, hasFp8MinScaling);
+        launchWithPdl(perTokenQuantization<T, QuantT, false>, grid, block, 0, stream, dst, src, numRows, numCols,
+            clampPtr, scalePtr, sumPtr, hasFp8MinScaling);
     }
 }
 
@@ -127,6 +127,57 @@ INSTANTIATE_INVOKE_PER_TOKEN_QUANTIZATION(__nv_bfloat16, __nv_fp8_e4m3);
 #endif
 #endif
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// FP8 Block-wise Quantization
+
+#ifdef ENABLE_FP8
+template <typename T>
+void invokeFP8BlockwiseQuantization(__nv_fp8_e4m3* dst, float* scales, T const* src, int64_t numRows, int64_t numCols,
+    int64_t const* expertFirstTokenOffset, int numExperts, cudaStream_t stream)
+{
+    TLLM_CHECK_WITH_INFO(numCols % FP8_BLOCK_SCALE_SIZE == 0,
+        "[invokeFP8BlockwiseQuantization] numCols should be a multiple of %d.", FP8_BLOCK_SCALE_SIZE);
+    TLLM_CHECK(expertFirstTokenOffset == nullptr || numExperts > 0);
+    if (numRows == 0)
+    {
+        return;
+    }
+
+    // A warp per group.
+    int64_t const numWarps = numRows * (numCols / FP8_BLOCK_SCALE_SIZE);
+    dim3 const block(256);
+    dim3 const grid(static_cast<unsigned int>((numWarps * 32 + block.x - 1) / block.x));
+    fp8BlockwiseQuantization<T>
+        <<<grid, block, 0, stream>>>(dst, scales, src, numRows, numCols, expertFirstTokenOffset, numExperts);
+    sync_check_cuda_error();
+}
+
+template <typename T>
+void invokeFP8WeightBlockQuantization(
+    __nv_fp8_e4m3* dst, float* scales, T const* src, int64_t n, int64_t k, int numExperts, cudaStream_t stream)
+{
+    TLLM_CHECK_WITH_INFO(n % FP8_BLOCK_SCALE_SIZE == 0 && k % FP8_BLOCK_SCALE_SIZE == 0,
+        "[invokeFP8WeightBlockQuantization] n and k should be multiples of %d.", FP8_BLOCK_SCALE_SIZE);
+
+    dim3 const block(256);
+    dim3 const grid(k / FP8_BLOCK_SCALE_SIZE, n / FP8_BLOCK_SCALE_SIZE, numExperts);
+    fp8WeightBlockQuantization<T><<<grid, block, 0, stream>>>(dst, scales, src, n, k);
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_INVOKE_FP8_BLOCK_QUANTIZATION(T)                                                                   \
+    template void invokeFP8BlockwiseQuantization(__nv_fp8_e4m3* dst, float* scales, T const* src, int64_t numRows,     \
+        int64_t numCols, int64_t const* expertFirstTokenOffset, int numExperts, cudaStream_t stream);                  \
+    template void invokeFP8WeightBlockQuantization(__nv_fp8_e4m3* dst, float* scales, T const* src, int64_t n,         \
+        int64_t k, int numExperts, cudaStream_t stream)
+
+INSTANTIATE_INVOKE_FP8_BLOCK_QUANTIZATION(float);
+INSTANTIATE_INVOKE_FP8_BLOCK_QUANTIZATION(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_INVOKE_FP8_BLOCK_QUANTIZATION(__nv_bfloat16);
+#endif
+#endif // ENABLE_FP8
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // FP4 Quantization
 
@@ -144,13 +195,13 @@ void invokeFP4Quantization(int m, int n, T const* input, float const* SFScale, i
     // Launch the cvt kernel.
     if (useUE8M0)
     {
-        cvt_fp16_to_fp4<T, true><<<grid, block, 0, stream>>>(
-            m, n, input, SFScale, reinterpret_cast<uint32_t*>(output), reinterpret_cast<uint32_t*>(SFOuput));
+        launchWithPdl(cvt_fp16_to_fp4<T, true>, grid, block, 0, stream, m, n, input, SFScale,
+            reinterpret_cast<uint32_t*>(output), reinterpret_cast<uint32_t*>(SFOuput));
     }
     else
     {
-        cvt_fp16_to_fp4<T, false><<<grid, block, 0, stream>>>(
-            m, n, input, SFScale, reinterpret_cast<uint32_t*>(output), reinterpret_cast<uint32_t*>(SFOuput));
+        launchWithPdl(cvt_fp16_to_fp4<T, false>, grid, block, 0, stream, m, n, input, SFScale,
+            reinterpret_cast<uint32_t*>(output), reinterpret_cast<uint32_t*>(SFOuput));
     }
 }
 
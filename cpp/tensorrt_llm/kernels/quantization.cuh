@@ -17,6 +17,7 @@
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/cudaTypeUtils.cuh"
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/pdlUtils.cuh"
 #include "tensorrt_llm/common/quantTypeUtils.cuh"
 #include "tensorrt_llm/common/reduceKernelUtils.cuh"
 #include "tensorrt_llm/kernels/quantization.h"
@@ -190,6 +191,8 @@ __global__ void perTokenQuantization(QuantT* dst, T const* src, int64_t const nu
     // Smem buffer.
     extern __shared__ uint4 smemBuffer[];
 
+    pdlWaitPrimaryGrid();
+
     // The clamping minimum / maximum values.
     T const clampMin = cuda_cast<T>(clampPtr ? clampPtr[0] : -FLT_MAX);
     T const clampMax = cuda_cast<T>(clampPtr ? clampPtr[1] : FLT_MAX);
@@ -245,6 +248,7 @@ __global__ void perTokenQuantization(QuantT* dst, T const* src, int64_t const nu
         }
     }
     float const rowMax = blockAllReduceMax(cuda_cast<float>(cuda_max<T, T2>(localMax2)));
+    pdlLaunchDependents();
     if (threadIdx.x == 0)
     {
         scalePtr[blockIdx.x]
@@ -625,6 +629,9 @@ cvt_fp16_to_fp4(
     static constexpr int CVT_FP4_NUM_THREADS_PER_SF = CVT_FP4_SF_VEC_SIZE / CVT_FP4_ELTS_PER_THREAD;
     static_assert(sizeof(PackedVec) == sizeof(Type) * CVT_FP4_ELTS_PER_THREAD, "Vec size is not matched.");
 
+    pdlWaitPrimaryGrid();
+    pdlLaunchDependents();
+
     // Get the global scaling factor, which will be applied to the SF.
     // Note SFScale is the same as next GEMM's alpha, which is (448.f / (Alpha_A / 6.f)).
     float const SFScaleVal = SFScale == nullptr ? 1.0f : SFScale[0];
@@ -691,5 +698,116 @@ cvt_fp8_to_fp4(
 #endif
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// FP8 Block-wise Quantization
+
+#ifdef ENABLE_FP8
+constexpr int FP8_BLOCK_SCALE_SIZE = 128;
+constexpr int FP8_BLOCK_ELTS_PER_LANE = FP8_BLOCK_SCALE_SIZE / 32;
+constexpr float FP8_E4M3_MAX = 448.f;
+
+// A warp per 1x128 group of a row.
+template <typename T>
+__global__ void fp8BlockwiseQuantization(__nv_fp8_e4m3* dst, float* scales, T const* src, int64_t const numRows,
+    int64_t const numCols, int64_t const* expertFirstTokenOffset, int const numExperts)
+{
+    int64_t const numGroups = numCols / FP8_BLOCK_SCALE_SIZE;
+    int64_t const warpIdx = (static_cast<int64_t>(blockIdx.x) * blockDim.x + threadIdx.x) / 32;
+    int const laneIdx = threadIdx.x % 32;
+    int64_t const row = warpIdx / numGroups;
+    int64_t const group = warpIdx % numGroups;
+    if (row >= numRows)
+    {
+        return;
+    }
+
+    // The scales of an expert are [numGroups, expert rows], so that the grouped GEMM indexes them as a dense GEMM.
+    int64_t rowBegin = 0;
+    int64_t expertRows = numRows;
+    if (expertFirstTokenOffset != nullptr)
+    {
+        if (row >= expertFirstTokenOffset[numExperts])
+        {
+            return;
+        }
+        int lo = 0;
+        int hi = numExperts - 1;
+        while (lo < hi)
+        {
+            int const mid = (lo + hi + 1) / 2;
+            if (expertFirstTokenOffset[mid] <= row)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid - 1;
+            }
+        }
+        rowBegin = expertFirstTokenOffset[lo];
+        expertRows = expertFirstTokenOffset[lo + 1] - rowBegin;
+    }
+
+    int64_t const offset = row * numCols + group * FP8_BLOCK_SCALE_SIZE + laneIdx * FP8_BLOCK_ELTS_PER_LANE;
+    float values[FP8_BLOCK_ELTS_PER_LANE];
+    float amax = 0.f;
+#pragma unroll
+    for (int i = 0; i < FP8_BLOCK_ELTS_PER_LANE; ++i)
+    {
+        values[i] = cuda_cast<float>(src[offset + i]);
+        amax = fmaxf(amax, fabsf(values[i]));
+    }
+    amax = warpReduceMax(amax);
+
+    float const scale = fmaxf(amax, FLT_MIN) / FP8_E4M3_MAX;
+    float const invScale = 1.f / scale;
+#pragma unroll
+    for (int i = 0; i < FP8_BLOCK_ELTS_PER_LANE; ++i)
+    {
+        dst[offset + i] = __nv_fp8_e4m3(values[i] * invScale);
+    }
+    if (laneIdx == 0)
+    {
+        scales[rowBegin * numGroups + group * expertRows + (row - rowBegin)] = scale;
+    }
+}
+
+// A CTA per 128x128 tile of the [numExperts * n, k] weights.
+template <typename T>
+__global__ void fp8WeightBlockQuantization(
+    __nv_fp8_e4m3* dst, float* scales, T const* src, int64_t const n, int64_t const k)
+{
+    int64_t const nBlocks = n / FP8_BLOCK_SCALE_SIZE;
+    int64_t const kBlocks = k / FP8_BLOCK_SCALE_SIZE;
+    int64_t const expert = blockIdx.z;
+    int64_t const nBlock = blockIdx.y;
+    int64_t const kBlock = blockIdx.x;
+    int64_t const base = (expert * n + nBlock * FP8_BLOCK_SCALE_SIZE) * k + kBlock * FP8_BLOCK_SCALE_SIZE;
+
+    float amax = 0.f;
+    for (int idx = threadIdx.x; idx < FP8_BLOCK_SCALE_SIZE * FP8_BLOCK_SCALE_SIZE; idx += blockDim.x)
+    {
+        int64_t const offset = base + (idx / FP8_BLOCK_SCALE_SIZE) * k + idx % FP8_BLOCK_SCALE_SIZE;
+        amax = fmaxf(amax, fabsf(cuda_cast<float>(src[offset])));
+    }
+    amax = blockReduceMax(amax);
+
+    __shared__ float sScale;
+    if (threadIdx.x == 0)
+    {
+        sScale = fmaxf(amax, FLT_MIN) / FP8_E4M3_MAX;
+        scales[(expert * kBlocks + kBlock) * nBlocks + nBlock] = sScale;
+    }
+    __syncthreads();
+
+    float const invScale = 1.f / sScale;
+    for (int idx = threadIdx.x; idx < FP8_BLOCK_SCALE_SIZE * FP8_BLOCK_SCALE_SIZE; idx += blockDim.x)
+    {
+        int64_t const offset = base + (idx / FP8_BLOCK_SCALE_SIZE) * k + idx % FP8_BLOCK_SCALE_SIZE;
+        dst[offset] = __nv_fp8_e4m3(cuda_cast<float>(src[offset]) * invScale);
+    }
+}
+#endif // ENABLE_FP8
+
 } // namespace kernels
 } // namespace tensorrt_llm
@@ -17,6 +17,7 @@
 
 #include "tensorrt_llm/common/quantization.h"
 #include <cuda_fp16.h>
+#include <cuda_fp8.h>
 #include <cuda_runtime.h>
 
 namespace tensorrt_llm
@@ -48,5 +49,21 @@ template <typename T>
 void invokeFP4Quantization(int m, int n, T const* input, float const* globalScale, int64_t* output, int32_t* SFOuput,
     bool useUE8M0, int multiProcessorCount, cudaStream_t stream = 0);
 
+#ifdef ENABLE_FP8
+// Quantize the [numRows, numCols] activations with a scale per 1x128 group, the layout of the block-scaled FP8 GEMMs.
+// The scales of a dense GEMM are [numCols / 128, numRows], M-major. When expertFirstTokenOffset [numExperts + 1] is
+// given, the scales of expert e are [numCols / 128, rows of e] from numCols / 128 * expertFirstTokenOffset[e], and the
+// rows after expertFirstTokenOffset[numExperts] are not written.
+template <typename T>
+void invokeFP8BlockwiseQuantization(__nv_fp8_e4m3* dst, float* scales, T const* src, int64_t numRows, int64_t numCols,
+    int64_t const* expertFirstTokenOffset, int numExperts, cudaStream_t stream = 0);
+
+// Quantize the [numExperts, n, k] weights with a scale per 128x128 tile, the scales are [numExperts, k / 128, n / 128],
+// N-major.
+template <typename T>
+void invokeFP8WeightBlockQuantization(
+    __nv_fp8_e4m3* dst, float* scales, T const* src, int64_t n, int64_t k, int numExperts, cudaStream_t stream = 0);
+#endif
+
 } // namespace kernels
 } // namespace tensorrt_llm
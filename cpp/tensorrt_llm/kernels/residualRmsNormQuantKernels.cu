@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/reduceKernelUtils.cuh"
+#include "tensorrt_llm/kernels/quantization.cuh"
+#include "tensorrt_llm/kernels/residualRmsNormQuantKernels.h"
+
+#include <algorithm>
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+int constexpr kEltsPerPack = CVT_FP4_ELTS_PER_THREAD;
+int constexpr kMaxCtaSize = 1024;
+
+// One CTA per token. Every thread owns packs of 8 elements, the NVFP4 scale factor of 16 elements is shared by two
+// neighbouring threads.
+template <typename T, bool Bias, bool Affine, bool QuantNVFP4>
+__global__ void residualRmsNormQuantKernel(AllReduceParams params, float const* scale, uint32_t* scaleOutput)
+{
+    using T2 = typename TypeConverter<T>::Type;
+    using Pack = PackedVec<T>;
+
+    int const hiddenSize = params.fusion_params.hidden_size;
+    int const numPacks = hiddenSize / kEltsPerPack;
+    int const tokenIdx = blockIdx.x;
+    auto const tokenOffset = static_cast<int64_t>(tokenIdx) * numPacks;
+
+    auto* inter = reinterpret_cast<Pack*>(params.fusion_params.intermediate_buffer) + tokenOffset;
+    auto const* residual = reinterpret_cast<Pack const*>(params.fusion_params.residual_buffer) + tokenOffset;
+    auto const* bias = reinterpret_cast<Pack const*>(params.fusion_params.bias_buffer);
+    auto const* weight = reinterpret_cast<Pack const*>(params.fusion_params.weight_buffer);
+
+    float sumSquares{0.F};
+    for (int packIdx = threadIdx.x; packIdx < numPacks; packIdx += blockDim.x)
+    {
+        Pack vec = inter[packIdx];
+        Pack const residualVec = residual[packIdx];
+#pragma unroll
+        for (int i = 0; i < kEltsPerPack / 2; ++i)
+        {
+            float2 val = cuda_cast<float2>(vec.elts[i]);
+            float2 const res = cuda_cast<float2>(residualVec.elts[i]);
+            val.x += res.x;
+            val.y += res.y;
+            if constexpr (Bias)
+            {
+                float2 const b = cuda_cast<float2>(bias[packIdx].elts[i]);
+                val.x += b.x;
+                val.y += b.y;
+            }
+            vec.elts[i] = cuda_cast<T2>(val);
+            // The norm is taken of the rounded sum, which is what the next layer gets as residual.
+            float2 const rounded = cuda_cast<float2>(vec.elts[i]);
+            sumSquares += rounded.x * rounded.x + rounded.y * rounded.y;
+        }
+        inter[packIdx] = vec;
+    }
+
+    __shared__ float sInvRms;
+    sumSquares = blockReduceSum<float>(sumSquares);
+    if (threadIdx.x == 0)
+    {
+        sInvRms = rsqrtf(sumSquares / static_cast<float>(hiddenSize) + params.fusion_params.eps);
+    }
+    __syncthreads();
+    float const invRms = sInvRms;
+    float const scaleFactor = 1.F / *scale;
+
+    // The trip count is uniform over the CTA, the scale factor reduction shuffles within warps.
+    for (int packBase = 0; packBase < numPacks; packBase += blockDim.x)
+    {
+        int const packIdx = packBase + threadIdx.x;
+        bool const active = packIdx < numPacks;
+        Pack vec{};
+        if (active)
+        {
+            vec = inter[packIdx];
+#pragma unroll
+            for (int i = 0; i < kEltsPerPack / 2; ++i)
+            {
+                float2 val = cuda_cast<float2>(vec.elts[i]);
+                val.x *= invRms;
+                val.y *= invRms;
+                if constexpr (Affine)
+                {
+                    float2 const gamma = cuda_cast<float2>(weight[packIdx].elts[i]);
+                    val.x *= gamma.x;
+                    val.y *= gamma.y;
+                }
+                vec.elts[i] = cuda_cast<T2>(val);
+            }
+        }
+        if constexpr (QuantNVFP4)
+        {
+            auto* sfOut = active ? cvt_quant_to_fp4_get_sf_out_offset<uint32_t, 2>(
+                              tokenIdx, packIdx, hiddenSize, scaleOutput)
+                                 : nullptr;
+            auto const quantized = cvt_warp_fp16_to_fp4<T>(vec, scaleFactor, sfOut);
+            if (active)
+            {
+                reinterpret_cast<uint32_t*>(params.local_output_buffer_ptr)[tokenOffset + packIdx] = quantized;
+            }
+        }
+#ifdef ENABLE_FP8
+        else if (active)
+        {
+            __nv_fp8x2_e4m3 quantized[kEltsPerPack / 2];
+#pragma unroll
+            for (int i = 0; i < kEltsPerPack / 2; ++i)
+            {
+                float2 val = cuda_cast<float2>(vec.elts[i]);
+                val.x *= scaleFactor;
+                val.y *= scaleFactor;
+                quantized[i] = __nv_fp8x2_e4m3(val);
+            }
+            reinterpret_cast<uint2*>(params.local_output_buffer_ptr)[tokenOffset + packIdx]
+                = *reinterpret_cast<uint2 const*>(quantized);
+        }
+#endif
+    }
+}
+
+template <typename T, bool Bias, bool Affine>
+void launchResidualRmsNormQuant(
+    AllReduceParams& params, AllReduceFusionOp fusionOp, float const* scale, void* scaleOutput, cudaStream_t stream)
+{
+    auto const hiddenSize = params.fusion_params.hidden_size;
+    auto const numTokens = static_cast<int>(params.elts_total / hiddenSize);
+    auto const numPacks = hiddenSize / kEltsPerPack;
+    // A multiple of the warp size keeps the pairs of threads that share a scale factor in one warp.
+    auto const ctaSize = std::min(kMaxCtaSize, static_cast<int>(common::roundUp(numPacks, 32)));
+    if (fusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM_QUANT_NVFP4)
+    {
+        residualRmsNormQuantKernel<T, Bias, Affine, true><<<numTokens, ctaSize, 0, stream>>>(
+            params, scale, reinterpret_cast<uint32_t*>(scaleOutput));
+    }
+#ifdef ENABLE_FP8
+    else
+    {
+        residualRmsNormQuantKernel<T, Bias, Affine, false><<<numTokens, ctaSize, 0, stream>>>(params, scale, nullptr);
+    }
+#endif
+}
+
+template <typename T>
+void dispatchResidualRmsNormQuant(
+    AllReduceParams& params, AllReduceFusionOp fusionOp, float const* scale, void* scaleOutput, cudaStream_t stream)
+{
+    bool const hasBias = params.fusion_params.bias_buffer != nullptr;
+    bool const hasWeight = params.fusion_params.weight_buffer != nullptr;
+    if (hasBias && hasWeight)
+    {
+        launchResidualRmsNormQuant<T, true, true>(params, fusionOp, scale, scaleOutput, stream);
+    }
+    else if (hasBias)
+    {
+        launchResidualRmsNormQuant<T, true, false>(params, fusionOp, scale, scaleOutput, stream);
+    }
+    else if (hasWeight)
+    {
+        launchResidualRmsNormQuant<T, false, true>(params, fusionOp, scale, scaleOutput, stream);
+    }
+    else
+    {
+        launchResidualRmsNormQuant<T, false, false>(params, fusionOp, scale, scaleOutput, stream);
+    }
+}
+
+} // namespace
+
+void residualRmsNormQuant(AllReduceParams& params, nvinfer1::DataType dataType, AllReduceFusionOp fusionOp,
+    float const* scale, void* scaleOutput, cudaStream_t stream)
+{
+    TLLM_CHECK(fusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM_QUANT_FP8
+        || fusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM_QUANT_NVFP4);
+#ifndef ENABLE_FP8
+    TLLM_CHECK_WITH_INFO(fusionOp != AllReduceFusionOp::RESIDUAL_RMS_NORM_QUANT_FP8,
+        "RESIDUAL_RMS_NORM_QUANT_FP8 needs TensorRT-LLM built with FP8 enabled");
+#endif
+    TLLM_CHECK(scale != nullptr);
+    TLLM_CHECK_WITH_INFO(params.fusion_params.hidden_size % CVT_FP4_SF_VEC_SIZE == 0,
+        "Hidden size %d must be a multiple of %d", params.fusion_params.hidden_size, CVT_FP4_SF_VEC_SIZE);
+    TLLM_CHECK(fusionOp != AllReduceFusionOp::RESIDUAL_RMS_NORM_QUANT_NVFP4 || scaleOutput != nullptr);
+    sync_check_cuda_error();
+    switch (dataType)
+    {
+    case nvinfer1::DataType::kHALF:
+        dispatchResidualRmsNormQuant<half>(params, fusionOp, scale, scaleOutput, stream);
+        break;
+#ifdef ENABLE_BF16
+    case nvinfer1::DataType::kBF16:
+        dispatchResidualRmsNormQuant<__nv_bfloat16>(params, fusionOp, scale, scaleOutput, stream);
+        break;
+#endif
+    default: TLLM_THROW("Unsupported dataType for residualRmsNormQuant");
+    }
+    sync_check_cuda_error();
+}
+
+} // namespace tensorrt_llm::kernels
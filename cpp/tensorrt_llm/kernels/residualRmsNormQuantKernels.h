@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "tensorrt_llm/kernels/customAllReduceKernels.h"
+
+#include <NvInferRuntime.h>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+// Epilogue of RESIDUAL_RMS_NORM_QUANT_FP8 and RESIDUAL_RMS_NORM_QUANT_NVFP4 for the strategies that only reduce, NCCL
+// and the custom kernels without norm fusion. fusion_params.intermediate_buffer holds the reduced sum and gets the
+// sum with bias and residual, which is normalized and quantized into local_output_buffer_ptr in one pass. scale is
+// the dequantization scale of the output. NVFP4 writes its block scale factors to scaleOutput, in the swizzled layout
+// of invokeFP4Quantization.
+void residualRmsNormQuant(AllReduceParams& params, nvinfer1::DataType dataType, AllReduceFusionOp fusionOp,
+    float const* scale, void* scaleOutput, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/ringAttention.h"
+
+#include <cfloat>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+namespace
+{
+
+int32_t constexpr kWarpSize = 32;
+int32_t constexpr kNumWarps = 4;
+// Rows (query token, query head) of a warp. Their softmax states stay in registers over the whole KV loop.
+int32_t constexpr kRowsPerWarp = 4;
+int32_t constexpr kChunkRows = kNumWarps * kRowsPerWarp;
+// Tokens of a KV tile, one per lane when the scores are computed.
+int32_t constexpr kTileTokens = kWarpSize;
+
+template <int32_t HEAD_SIZE>
+struct RingAttentionSmem
+{
+    float q[kChunkRows][HEAD_SIZE];
+    // Padded so that the lanes reading one channel of different tokens do not share a bank.
+    float k[kTileTokens][HEAD_SIZE + 1];
+    float v[kTileTokens][HEAD_SIZE];
+    int32_t kvSeqIdx[kTileTokens];
+    int32_t kvPositions[kTileTokens];
+};
+
+__device__ __forceinline__ float warpMax(float val)
+{
+#pragma unroll
+    for (int32_t mask = kWarpSize / 2; mask > 0; mask >>= 1)
+    {
+        val = fmaxf(val, __shfl_xor_sync(0xffffffff, val, mask));
+    }
+    return val;
+}
+
+__device__ __forceinline__ float warpSum(float val)
+{
+#pragma unroll
+    for (int32_t mask = kWarpSize / 2; mask > 0; mask >>= 1)
+    {
+        val += __shfl_xor_sync(0xffffffff, val, mask);
+    }
+    return val;
+}
+
+// grid [numKvHeads, divUp(numQTokens * groupSize, kChunkRows)], block [kNumWarps * kWarpSize]. A block attends a chunk
+// of the (query token, query head) rows of a KV head to the KV tokens of their sequences in the chunk.
+template <typename T, int32_t HEAD_SIZE>
+__global__ void __launch_bounds__(kNumWarps* kWarpSize)
+    ringAttentionStepKernel(RingAttentionParams<T> params, AttentionState state)
+{
+    int32_t constexpr kChannelsPerLane = HEAD_SIZE / kWarpSize;
+    __shared__ RingAttentionSmem<HEAD_SIZE> smem;
+
+    auto const kvHeadIdx = static_cast<int32_t>(blockIdx.x);
+    auto const warpIdx = static_cast<int32_t>(threadIdx.x) / kWarpSize;
+    auto const laneIdx = static_cast<int32_t>(threadIdx.x) % kWarpSize;
+
+    auto const groupSize = params.numHeads / params.numKvHeads;
+    auto const numRows = params.numQTokens * groupSize;
+    auto const chunkStart = static_cast<int32_t>(blockIdx.y) * kChunkRows;
+    auto const lastRow = min(chunkStart + kChunkRows, numRows) - 1;
+
+    // The queries are sorted by sequence, the chunk attends to the KV tokens of the sequences of its first and last
+    // rows and of the ones in between.
+    auto const firstSeq = params.qSeqIdx[chunkStart / groupSize];
+    auto const lastSeq = params.qSeqIdx[lastRow / groupSize];
+    auto const tokenBegin = params.kvSeqOffsets[firstSeq];
+    auto const tokenEnd = params.kvSeqOffsets[lastSeq + 1];
+
+    auto rowToHead = [&](int32_t row)
+    { return (row / groupSize) * params.numHeads + kvHeadIdx * groupSize + row % groupSize; };
+
+    for (auto idx = static_cast<int32_t>(threadIdx.x); idx < kChunkRows * HEAD_SIZE; idx += blockDim.x)
+    {
+        auto const localRow = idx / HEAD_SIZE;
+        auto const channel = idx % HEAD_SIZE;
+        auto const row = chunkStart + localRow;
+        float value = 0.f;
+        if (row < numRows)
+        {
+            auto const offset = static_cast<size_t>(rowToHead(row)) * HEAD_SIZE + channel;
+            value = cuda_cast<float>(params.q[offset]) * params.qScale;
+        }
+        smem.q[localRow][channel] = value;
+    }
+
+    int32_t rowSeq[kRowsPerWarp];
+    int32_t rowPosition[kRowsPerWarp];
+    float rowMax[kRowsPerWarp];
+    float rowSum[kRowsPerWarp];
+    float acc[kRowsPerWarp][kChannelsPerLane];
+#pragma unroll
+    for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+    {
+        auto const row = min(chunkStart + warpIdx * kRowsPerWarp + ri, lastRow);
+        rowSeq[ri] = params.qSeqIdx[row / groupSize];
+        rowPosition[ri] = params.qPositions[row / groupSize];
+        rowMax[ri] = -FLT_MAX;
+        rowSum[ri] = 0.f;
+#pragma unroll
+        for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+        {
+            acc[ri][ci] = 0.f;
+        }
+    }
+
+    for (int32_t tileStart = tokenBegin; tileStart < tokenEnd; tileStart += kTileTokens)
+    {
+        // Load the tile once for all rows of the chunk.
+        __syncthreads();
+        for (auto idx = static_cast<int32_t>(threadIdx.x); idx < kTileTokens * HEAD_SIZE; idx += blockDim.x)
+        {
+            auto const tokenOffset = idx / HEAD_SIZE;
+            auto const channel = idx % HEAD_SIZE;
+            auto const tokenIdx = tileStart + tokenOffset;
+            float kValue = 0.f;
+            float vValue = 0.f;
+            if (tokenIdx < tokenEnd)
+            {
+                auto const offset
+                    = (static_cast<size_t>(tokenIdx) * params.numKvHeads + kvHeadIdx) * HEAD_SIZE + channel;
+                kValue = cuda_cast<float>(params.k[offset]);
+                vValue = cuda_cast<float>(params.v[offset]);
+            }
+            smem.k[tokenOffset][channel] = kValue;
+            smem.v[tokenOffset][channel] = vValue;
+        }
+        if (threadIdx.x < kTileTokens)
+        {
+            auto const tokenIdx = tileStart + static_cast<int32_t>(threadIdx.x);
+            auto seqIdx = firstSeq;
+            while (seqIdx <= lastSeq && tokenIdx >= params.kvSeqOffsets[seqIdx + 1])
+            {
+                ++seqIdx;
+            }
+            smem.kvSeqIdx[threadIdx.x] = tokenIdx < tokenEnd ? seqIdx : -1;
+            smem.kvPositions[threadIdx.x] = tokenIdx < tokenEnd ? params.kvPositions[tokenIdx] : 0;
+        }
+        __syncthreads();
+
+#pragma unroll
+        for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+        {
+            auto const localRow = warpIdx * kRowsPerWarp + ri;
+            if (chunkStart + localRow >= numRows)
+            {
+                continue;
+            }
+            bool const visible = smem.kvSeqIdx[laneIdx] == rowSeq[ri]
+                && (!params.causal || smem.kvPositions[laneIdx] <= rowPosition[ri]);
+            float score = -FLT_MAX;
+            if (visible)
+            {
+                score = 0.f;
+#pragma unroll 16
+                for (int32_t channel = 0; channel < HEAD_SIZE; ++channel)
+                {
+                    score += smem.q[localRow][channel] * smem.k[laneIdx][channel];
+                }
+            }
+
+            auto const newMax = fmaxf(rowMax[ri], warpMax(score));
+            auto const correction = __expf(rowMax[ri] - newMax);
+            auto const prob = visible ? __expf(score - newMax) : 0.f;
+            rowSum[ri] = rowSum[ri] * correction + warpSum(prob);
+            rowMax[ri] = newMax;
+#pragma unroll
+            for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+            {
+                acc[ri][ci] *= correction;
+            }
+            for (int32_t ti = 0; ti < kTileTokens; ++ti)
+            {
+                auto const p = __shfl_sync(0xffffffff, prob, ti);
+#pragma unroll
+                for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+                {
+                    acc[ri][ci] += p * smem.v[ti][ci * kWarpSize + laneIdx];
+                }
+            }
+        }
+    }
+
+#pragma unroll
+    for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+    {
+        auto const row = chunkStart + warpIdx * kRowsPerWarp + ri;
+        if (row >= numRows)
+        {
+            continue;
+        }
+        auto const headOffset = static_cast<size_t>(rowToHead(row));
+        // Both the state and the chunk are weighted by their share of the softmax denominator.
+        auto const oldLse = params.firstStep ? -FLT_MAX : state.lse[headOffset];
+        __syncwarp();
+        auto const maxScore = fmaxf(oldLse, rowMax[ri]);
+        auto const oldWeight = oldLse == -FLT_MAX ? 0.f : __expf(oldLse - maxScore);
+        auto const chunkScale = rowSum[ri] > 0.f ? __expf(rowMax[ri] - maxScore) : 0.f;
+        auto const denominator = oldWeight + chunkScale * rowSum[ri];
+        auto const invDenominator = denominator > 0.f ? 1.f / denominator : 0.f;
+        auto* out = state.out + headOffset * HEAD_SIZE;
+#pragma unroll
+        for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+        {
+            auto const channel = ci * kWarpSize + laneIdx;
+            auto const oldValue = oldWeight > 0.f ? out[channel] : 0.f;
+            out[channel] = (oldWeight * oldValue + chunkScale * acc[ri][ci]) * invDenominator;
+        }
+        if (laneIdx == 0)
+        {
+            state.lse[headOffset] = denominator > 0.f ? maxScore + __logf(denominator) : -FLT_MAX;
+        }
+    }
+}
+
+// grid [numRows], block [headSize].
+template <typename T>
+__global__ void mergeAttentionStatesKernel(
+    float const* partOut, float const* partLse, int32_t numParts, int32_t numRows, int32_t headSize, T* out)
+{
+    auto const row = static_cast<size_t>(blockIdx.x);
+    auto const channel = static_cast<int32_t>(threadIdx.x);
+
+    float maxLse = -FLT_MAX;
+    for (int32_t pi = 0; pi < numParts; ++pi)
+    {
+        maxLse = fmaxf(maxLse, partLse[pi * static_cast<size_t>(numRows) + row]);
+    }
+    float denominator = 0.f;
+    float value = 0.f;
+    for (int32_t pi = 0; pi < numParts; ++pi)
+    {
+        auto const lse = partLse[pi * static_cast<size_t>(numRows) + row];
+        if (lse == -FLT_MAX)
+        {
+            continue;
+        }
+        auto const weight = __expf(lse - maxLse);
+        denominator += weight;
+        value += weight * partOut[(pi * static_cast<size_t>(numRows) + row) * headSize + channel];
+    }
+    out[row * headSize + channel] = cuda_cast<T>(denominator > 0.f ? value / denominator : 0.f);
+}
+
+template <typename T, int32_t HEAD_SIZE>
+void launchRingAttentionStep(RingAttentionParams<T> const& params, AttentionState state, cudaStream_t stream)
+{
+    auto const groupSize = params.numHeads / params.numKvHeads;
+    dim3 const grid(params.numKvHeads, divUp(params.numQTokens * groupSize, kChunkRows));
+    ringAttentionStepKernel<T, HEAD_SIZE><<<grid, kNumWarps * kWarpSize, 0, stream>>>(params, state);
+}
+
+} // namespace
+
+template <typename T>
+void invokeRingAttentionStep(RingAttentionParams<T> const& params, AttentionState state, cudaStream_t stream)
+{
+    params.checkParams();
+    TLLM_CHECK(state.out && state.lse);
+    if (params.numQTokens == 0)
+    {
+        return;
+    }
+    switch (params.headSize)
+    {
+    case 64: launchRingAttentionStep<T, 64>(params, state, stream); break;
+    case 128: launchRingAttentionStep<T, 128>(params, state, stream); break;
+    default: TLLM_THROW("Unsupported head size %d", params.headSize);
+    }
+
+    sync_check_cuda_error();
+}
+
+template <typename T>
+void invokeMergeAttentionStates(float const* partOut, float const* partLse, int32_t numParts, int32_t numRows,
+    int32_t headSize, T* out, cudaStream_t stream)
+{
+    TLLM_CHECK(partOut && partLse && out && numParts > 0);
+    TLLM_CHECK_WITH_INFO(headSize > 0 && headSize <= 1024, "Unsupported head size %d", headSize);
+    if (numRows == 0)
+    {
+        return;
+    }
+    mergeAttentionStatesKernel<T><<<numRows, headSize, 0, stream>>>(partOut, partLse, numParts, numRows, headSize, out);
+
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_RING_ATTENTION(T)                                                                                  \
+    template void invokeRingAttentionStep<T>(                                                                          \
+        RingAttentionParams<T> const& params, AttentionState state, cudaStream_t stream);                             \
+    template void invokeMergeAttentionStates<T>(float const* partOut, float const* partLse, int32_t numParts,          \
+        int32_t numRows, int32_t headSize, T* out, cudaStream_t stream)
+
+INSTANTIATE_RING_ATTENTION(float);
+INSTANTIATE_RING_ATTENTION(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_RING_ATTENTION(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_RING_ATTENTION
+
+} // namespace tensorrt_llm::kernels
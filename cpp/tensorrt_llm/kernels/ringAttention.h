@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include <cstddef>
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Softmax state of the attention rows of the local queries, merged over the KV chunks of the ring.
+struct AttentionState
+{
+    // Output normalized over the KV tokens seen so far [numQTokens, numHeads, headSize].
+    float* out{nullptr};
+    // Log-sum-exp of the scores of the KV tokens seen so far, -FLT_MAX if none [numQTokens, numHeads].
+    float* lse{nullptr};
+};
+
+template <typename T>
+struct RingAttentionParams
+{
+    // Local queries after the rotary embedding [numQTokens, numHeads, headSize], sorted by sequence.
+    T const* q{nullptr};
+    // Sequence and position in the sequence of every query [numQTokens].
+    int32_t const* qSeqIdx{nullptr};
+    int32_t const* qPositions{nullptr};
+    // KV chunk of the ring step [maxKvTokens, numKvHeads, headSize].
+    T const* k{nullptr};
+    T const* v{nullptr};
+    // Position in the sequence of every KV token of the chunk [maxKvTokens].
+    int32_t const* kvPositions{nullptr};
+    // The KV tokens of sequence s in the chunk are [kvSeqOffsets[s], kvSeqOffsets[s + 1]) [batchSize + 1]. On the
+    // device, so that the chunk sizes of the other ranks need not be known on the host.
+    int32_t const* kvSeqOffsets{nullptr};
+    int32_t numQTokens{0};
+    int32_t batchSize{0};
+    int32_t numHeads{0};
+    int32_t numKvHeads{0};
+    int32_t headSize{0};
+    // Mask the KV tokens at later positions than the query, for the prefill.
+    bool causal{true};
+    // Overwrite the state instead of merging with it, for the first chunk.
+    bool firstStep{false};
+    // Scale of the attention scores, usually 1 / sqrt(headSize).
+    float qScale{1.f};
+
+    void checkParams() const
+    {
+        TLLM_CHECK(q && qSeqIdx && qPositions && k && v && kvPositions && kvSeqOffsets);
+        TLLM_CHECK(numQTokens >= 0 && batchSize > 0);
+        TLLM_CHECK(numKvHeads > 0 && numHeads % numKvHeads == 0);
+        TLLM_CHECK_WITH_INFO(headSize == 64 || headSize == 128, "Ring attention supports head sizes 64 and 128");
+    }
+};
+
+//! \brief Attend the local queries to one KV chunk and merge the result into their softmax state.
+//! \details A step of ring attention: every rank of the context parallel group holds the queries and the KV of its
+//! slice of the prompt, and attends to the KV chunks of the other ranks while they pass around the ring. The state
+//! is merged with the log-sum-exp of the chunk, so that the chunks can come in any order and the result does not
+//! depend on the partition of the prompt.
+template <typename T>
+void invokeRingAttentionStep(RingAttentionParams<T> const& params, AttentionState state, cudaStream_t stream);
+
+//! \brief Merge the softmax states of numParts disjoint KV parts of the same rows and write the output.
+//! \details The generation attention over a KV cache distributed over the context parallel ranks: every rank attends
+//! the generation queries to its own KV blocks, the states of the ranks are gathered and merged here. With a single
+//! part, it converts the state of the ring steps to the output.
+//! \param partOut [numParts, numRows, headSize], partLse [numParts, numRows], out [numRows, headSize].
+template <typename T>
+void invokeMergeAttentionStates(float const* partOut, float const* partLse, int32_t numParts, int32_t numRows,
+    int32_t headSize, T* out, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
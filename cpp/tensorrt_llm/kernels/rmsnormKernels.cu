@@ -15,6 +15,7 @@
  */
 
 #include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/pdlUtils.cuh"
 #include "tensorrt_llm/common/quantTypeUtils.cuh"
 #include "tensorrt_llm/common/reduceKernelUtils.cuh"
 #include "tensorrt_llm/kernels/rmsnormKernels.h"
@@ -62,6 +63,8 @@ __global__ void generalRmsNorm(T const* input, T const* gamma, T const* beta, T*
     using float_packed_t = typename packed_as<float, num_elems_T>::type;
     using T_scalar = typename packed_as<T, 1>::type;
 
+    pdlWaitPrimaryGrid();
+
     // The clamping minimum / maximum values.
     T const clampMin = cuda_cast<T>(clampPtr ? clampPtr[0] : -FLT_MAX);
     T const clampMax = cuda_cast<T>(clampPtr ? clampPtr[1] : FLT_MAX);
@@ -108,6 +111,8 @@ __global__ void generalRmsNorm(T const* input, T const* gamma, T const* beta, T*
     }
     __syncthreads();
 
+    pdlLaunchDependents();
+
     bool const with_per_token_scaling = scale_orig_quant_per_token != nullptr;
     bool const with_per_tensor_scaling = scale_orig_quant_per_tensor != nullptr;
     bool const with_per_token_sum = sum_per_token != nullptr;
@@ -203,15 +208,15 @@ void dispatch_rmsnorm_type_square_method(T const* input, T const* gamma, T const
 
     if (use_shmem)
     {
-        generalRmsNorm<T, QuantT, true><<<grid, block, shmem_size, stream>>>(input, gamma, beta, normed_output, eps,
-            tokens, hidden_dim, clampPtr, scale_orig_quant_per_tensor, scale_orig_quant_per_token, sum_per_token,
-            normed_output_quant, hasFp8MinScaling);
+        launchWithPdl(generalRmsNorm<T, QuantT, true>, grid, block, shmem_size, stream, input, gamma, beta,
+            normed_output, eps, tokens, hidden_dim, clampPtr, scale_orig_quant_per_tensor, scale_orig_quant_per_token,
+            sum_per_token, normed_output_quant, hasFp8MinScaling);
     }
     else
     {
-        generalRmsNorm<T, QuantT, false><<<grid, block, shmem_size, stream>>>(input, gamma, beta, normed_output, eps,
-            tokens, hidden_dim, clampPtr, scale_orig_quant_per_tensor, scale_orig_quant_per_token, sum_per_token,
-            normed_output_quant, hasFp8MinScaling);
+        launchWithPdl(generalRmsNorm<T, QuantT, false>, grid, block, shmem_size, stream, input, gamma, beta,
+            normed_output, eps, tokens, hidden_dim, clampPtr, scale_orig_quant_per_tensor, scale_orig_quant_per_token,
+            sum_per_token, normed_output_quant, hasFp8MinScaling);
     }
 }
 
@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CUDART_VERSION
+#error CUDART_VERSION Undefined!
+#elif (CUDART_VERSION >= 11050)
+#include <cub/cub.cuh>
+#else
+#include "3rdparty/cub/cub.cuh"
+#endif
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/kernels/samplingTopPKernels.h"
+
+#include <climits>
+
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::runtime;
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+// Rounds after which the most probable token is taken. Every round raises the lower pivot to at least the
+// probability of the rejected token, so few rounds are needed unless the distribution is almost flat.
+SizeType32 constexpr kMaxRejectionRounds = 32;
+} // namespace
+
+template <typename T, SizeType32 BLOCK_SIZE>
+__launch_bounds__(BLOCK_SIZE) __global__
+    void rejectionTopPSampling(T const* probs, TokenIdType* ids, TokenIdType** idsPtrs, SizeType32* sequenceLengths,
+        FinishedState const* finishedInput, FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs,
+        SizeType32 vocabSize, curandState_t* curandState, float const* topPs, TokenIdType const* endIds,
+        SizeType32 maxBatchSize, bool const* skipDecode, SizeType32 const* batchSlots, SizeType32 maxSeqLen)
+{
+    /**
+     * Each block samples one request without sorting. A token is drawn from the tokens with probability above the
+     * lower pivot and accepted if the tokens more probable than it hold less than P of the mass, i.e. if it is in the
+     * nucleus. Otherwise, no token with this probability or less is in the nucleus, and the pivot is raised. Two
+     * pivots are tested per round to shrink the range faster. Conditioned on acceptance, the token is distributed
+     * exactly like with sorted top P sampling.
+     */
+    using BlockScan = cub::BlockScan<float, BLOCK_SIZE>;
+    using BlockReduce = cub::BlockReduce<float, BLOCK_SIZE>;
+    using BlockReduceIdx = cub::BlockReduce<SizeType32, BLOCK_SIZE>;
+    using BlockReduceArgMax = cub::BlockReduce<cub::KeyValuePair<SizeType32, float>, BLOCK_SIZE>;
+    __shared__ union
+    {
+        typename BlockScan::TempStorage scan;
+        typename BlockReduce::TempStorage reduce;
+        typename BlockReduceIdx::TempStorage reduceIdx;
+        typename BlockReduceArgMax::TempStorage reduceArgMax;
+    } tempStorage;
+    __shared__ float sRandom;
+    __shared__ float sMass[2];
+    __shared__ SizeType32 sSampledIdx;
+
+    auto const tid = static_cast<SizeType32>(threadIdx.x);
+    auto const batchId = static_cast<SizeType32>(blockIdx.x);
+    auto const batchSlot = batchSlots != nullptr ? batchSlots[batchId] : batchId;
+    FinishedState const finishState = finishedInput != nullptr ? finishedInput[batchSlot] : FinishedState::empty();
+    if ((skipDecode != nullptr && skipDecode[batchSlot]) || (finishState.isSkipDecoding()))
+    {
+        return;
+    }
+
+    if (finishState.isFinished())
+    {
+        if (tid == 0 && finishedOutput != nullptr)
+        {
+            finishedOutput[batchSlot] = finishState;
+        }
+        return;
+    }
+
+    auto const topP = topPs[batchSlot];
+    auto const* requestProbs = probs + batchId * vocabSize;
+
+    // Mass of the tokens with probability above the lower pivot, from which the next token is drawn.
+    float low{0.f};
+    float high{1.f};
+    float threadMass{0.f};
+    for (auto idx = tid; idx < vocabSize; idx += BLOCK_SIZE)
+    {
+        threadMass += static_cast<float>(requestProbs[idx]);
+    }
+    auto const totalMass = BlockReduce(tempStorage.reduce).Sum(threadMass);
+    if (tid == 0)
+    {
+        sMass[0] = totalMass;
+    }
+    __syncthreads();
+    auto mass = sMass[0];
+
+    SizeType32 sampledIdx{-1};
+    bool accepted{false};
+    for (SizeType32 round = 0; round < kMaxRejectionRounds && !accepted; ++round)
+    {
+        if (tid == 0)
+        {
+            sRandom = curand_uniform(curandState + batchSlot) * mass;
+            sSampledIdx = INT_MAX;
+        }
+        __syncthreads();
+
+        // Inverse CDF over the tokens above the lower pivot, in vocab order.
+        float runningMass{0.f};
+        SizeType32 lastIdx{-1};
+        for (SizeType32 base = 0; base < vocabSize; base += BLOCK_SIZE)
+        {
+            auto const idx = base + tid;
+            auto const prob = idx < vocabSize ? static_cast<float>(requestProbs[idx]) : 0.f;
+            auto const value = prob > low ? prob : 0.f;
+            lastIdx = value > 0.f ? idx : lastIdx;
+            float prefix;
+            float aggregate;
+            BlockScan(tempStorage.scan).InclusiveSum(value, prefix, aggregate);
+            if (value > 0.f && runningMass + prefix > sRandom)
+            {
+                atomicMin(&sSampledIdx, idx);
+            }
+            __syncthreads();
+            if (sSampledIdx != INT_MAX)
+            {
+                break;
+            }
+            runningMass += aggregate;
+        }
+        if (sSampledIdx == INT_MAX)
+        {
+            // The random number rounded above the mass, take the last candidate.
+            auto const maxIdx = BlockReduceIdx(tempStorage.reduceIdx).Reduce(lastIdx, cub::Max());
+            if (tid == 0)
+            {
+                sSampledIdx = maxIdx >= 0 ? maxIdx : vocabSize - 1;
+            }
+            __syncthreads();
+        }
+        sampledIdx = sSampledIdx;
+
+        auto const pivot0 = static_cast<float>(requestProbs[sampledIdx]);
+        auto const pivot1 = (pivot0 + high) / 2.f;
+        float threadMass0{0.f};
+        float threadMass1{0.f};
+        for (auto idx = tid; idx < vocabSize; idx += BLOCK_SIZE)
+        {
+            auto const prob = static_cast<float>(requestProbs[idx]);
+            threadMass0 += prob > pivot0 ? prob : 0.f;
+            threadMass1 += prob > pivot1 ? prob : 0.f;
+        }
+        auto const massAbove0 = BlockReduce(tempStorage.reduce).Sum(threadMass0);
+        __syncthreads();
+        auto const massAbove1 = BlockReduce(tempStorage.reduce).Sum(threadMass1);
+        if (tid == 0)
+        {
+            sMass[0] = massAbove0;
+            sMass[1] = massAbove1;
+        }
+        __syncthreads();
+
+        if (sMass[0] < topP)
+        {
+            accepted = true;
+        }
+        else if (sMass[1] < topP)
+        {
+            // The nucleus threshold is in (pivot0, pivot1].
+            low = pivot0;
+            high = pivot1;
+            mass = sMass[0];
+        }
+        else
+        {
+            low = pivot1;
+            mass = sMass[1];
+        }
+        __syncthreads();
+    }
+
+    if (!accepted)
+    {
+        // The most probable token is always in the nucleus.
+        cub::KeyValuePair<SizeType32, float> threadMax{vocabSize - 1, -1.f};
+        for (auto idx = tid; idx < vocabSize; idx += BLOCK_SIZE)
+        {
+            auto const prob = static_cast<float>(requestProbs[idx]);
+            if (prob > threadMax.value)
+            {
+                threadMax = {idx, prob};
+            }
+        }
+        auto const blockMax = BlockReduceArgMax(tempStorage.reduceArgMax).Reduce(threadMax, cub::ArgMax());
+        if (tid == 0)
+        {
+            sSampledIdx = blockMax.key;
+        }
+        __syncthreads();
+        sampledIdx = sSampledIdx;
+    }
+
+    if (tid == 0)
+    {
+        auto* outputIdsRequestPtr = idsPtrs == nullptr ? ids + batchSlot * maxSeqLen : idsPtrs[batchSlot];
+        auto const currentStep = sequenceLengths == nullptr ? 0 : sequenceLengths[batchSlot];
+        outputIdsRequestPtr[currentStep] = sampledIdx;
+
+        if (cumLogProbs != nullptr || outputLogProbs != nullptr)
+        {
+            auto const logProb = logf(static_cast<float>(requestProbs[sampledIdx]));
+            if (cumLogProbs != nullptr)
+            {
+                cumLogProbs[batchSlot] += logProb;
+            }
+            if (outputLogProbs != nullptr)
+            {
+                outputLogProbs[currentStep * maxBatchSize + batchSlot] = logProb;
+            }
+        }
+        if (finishedOutput != nullptr && endIds != nullptr)
+        {
+            if (sampledIdx == endIds[batchSlot])
+            {
+                finishedOutput[batchSlot].setFinishedEOS();
+                // Do not increase seq len when EOS is generated. Seq len should always contain only tokens to be
+                // outputted
+            }
+            else
+            {
+                // We don't need to set output finished state as it is assumed to be in non finished state
+                sequenceLengths[batchSlot] += 1;
+            }
+        }
+    }
+}
+
+template <typename T>
+void invokeBatchRejectionTopPSampling(TopPSamplingKernelParams<T> const& params, cudaStream_t stream)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+
+    // No workspace is used, so checkParams does not apply.
+    TLLM_CHECK(params.batchSize > 0);
+    TLLM_CHECK(params.maxBatchSize >= params.batchSize);
+    TLLM_CHECK(params.vocabSizePadded > 0);
+    TLLM_CHECK(params.probs);
+    TLLM_CHECK(params.outputIds || params.outputIdsPtrs);
+    TLLM_CHECK(params.outputIds == nullptr || params.maxSeqLen > 0);
+    TLLM_CHECK(params.topPs);
+    TLLM_CHECK_WITH_INFO(params.curandState != nullptr, "Rejection top P sampling draws several random numbers");
+    TLLM_CHECK_WITH_INFO(!params.returnAllSelectedTokens && params.returnAllSelectedTokensPerSlot == nullptr,
+        "Rejection top P sampling does not select all tokens of the nucleus");
+    TLLM_CHECK(((params.finishedOutput == nullptr) ^ (params.endIds == nullptr)) == 0);
+
+    SizeType32 constexpr BLOCK_SIZE = 512;
+    rejectionTopPSampling<T, BLOCK_SIZE><<<params.batchSize, BLOCK_SIZE, 0, stream>>>(params.probs, params.outputIds,
+        params.outputIdsPtrs, params.sequenceLength, params.finishedInput, params.finishedOutput, params.cumLogProbs,
+        params.outputLogProbs, params.vocabSizePadded, params.curandState, params.topPs, params.endIds,
+        params.maxBatchSize, params.skipDecode, params.batchSlots, params.maxSeqLen);
+    sync_check_cuda_error();
+
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
+template void invokeBatchRejectionTopPSampling(TopPSamplingKernelParams<float> const& params, cudaStream_t stream);
+
+template void invokeBatchRejectionTopPSampling(TopPSamplingKernelParams<half> const& params, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -25,8 +25,10 @@
 
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/memoryUtils.h"
+#include "tensorrt_llm/common/pdlUtils.cuh"
 #include "tensorrt_llm/common/reduceKernelUtils.cuh"
 #include "tensorrt_llm/kernels/samplingTopKKernels.h"
+#include "tensorrt_llm/layers/defaultDecodingParams.h"
 
 using namespace tensorrt_llm::common;
 using namespace tensorrt_llm::runtime;
@@ -34,11 +36,103 @@ using namespace tensorrt_llm::runtime;
 namespace tensorrt_llm::kernels
 {
 
+namespace
+{
+//! Penalties of one request, as batchApplyPenalty applies them.
+struct RequestPenalties
+{
+    float invTemperature{1.f};
+    float repetitionPenalty{layers::DefaultDecodingParams::getRepetitionPenalty()};
+    float presencePenalty{layers::DefaultDecodingParams::getPresencePenalty()};
+    float frequencyPenalty{layers::DefaultDecodingParams::getFrequencyPenalty()};
+    bool hasTemperature{false};
+    bool hasOccurrencePenalty{false};
+    bool maskEndId{false};
+};
+
+template <typename T>
+__device__ RequestPenalties loadRequestPenalties(
+    InvokeBatchApplyPenaltyParams<T> const& params, SizeType32 batchSlot)
+{
+    RequestPenalties penalties;
+    if (params.temperatures != nullptr)
+    {
+        auto const temperature = params.temperatures[batchSlot];
+        penalties.invTemperature = 1.f / (temperature + 1e-6f);
+        penalties.hasTemperature = fabs(temperature - layers::DefaultDecodingParams::getTemperature()) >= 1e-9f;
+    }
+    if (params.repetitionPenalties != nullptr)
+    {
+        penalties.repetitionPenalty = params.repetitionPenalties[batchSlot];
+        penalties.hasOccurrencePenalty
+            |= fabs(penalties.repetitionPenalty - layers::DefaultDecodingParams::getRepetitionPenalty()) >= 1e-9f;
+    }
+    if (params.presencePenalties != nullptr)
+    {
+        penalties.presencePenalty = params.presencePenalties[batchSlot];
+        penalties.hasOccurrencePenalty
+            |= fabs(penalties.presencePenalty - layers::DefaultDecodingParams::getPresencePenalty()) >= 1e-9f;
+    }
+    if (params.frequencyPenalties != nullptr)
+    {
+        penalties.frequencyPenalty = params.frequencyPenalties[batchSlot];
+        penalties.hasOccurrencePenalty
+            |= fabs(penalties.frequencyPenalty - layers::DefaultDecodingParams::getFrequencyPenalty()) >= 1e-9f;
+    }
+    if (params.minLengths != nullptr)
+    {
+        auto const inputLen = params.inputLengths == nullptr ? SizeType32{0} : params.inputLengths[batchSlot];
+        auto const seqLen = params.sequenceLengths == nullptr ? SizeType32{0} : params.sequenceLengths[batchSlot];
+        penalties.maskEndId = seqLen - inputLen < params.minLengths[batchSlot];
+    }
+    return penalties;
+}
+
+//! \brief Logit of token elemId after bias, temperature and penalties, clamped to the range of T.
+template <typename T>
+__device__ T applyRequestPenalties(InvokeBatchApplyPenaltyParams<T> const& params, RequestPenalties const& penalties,
+    SizeType32 const* occurrences, T logProb, SizeType32 elemId, SizeType32 batchSlot)
+{
+    float const maxVal = std::is_same<T, half>::value ? HALF_FLT_MAX : FLT_MAX;
+    if (elemId >= params.vocabSize || (penalties.maskEndId && elemId == params.endIds[batchSlot]))
+    {
+        return static_cast<T>(-maxVal);
+    }
+    auto logit = static_cast<float>(logProb);
+    if (params.biases != nullptr)
+    {
+        logit += static_cast<float>(params.biases[batchSlot * params.vocabSizePadded + elemId]);
+    }
+    if (penalties.hasTemperature)
+    {
+        logit *= penalties.invTemperature;
+    }
+    auto const numOccurrences = occurrences != nullptr ? occurrences[elemId] : 0;
+    if (numOccurrences > 0)
+    {
+        if (params.repetitionPenalties != nullptr)
+        {
+            logit = logit < 0.f ? logit * penalties.repetitionPenalty : logit / penalties.repetitionPenalty;
+        }
+        if (params.presencePenalties != nullptr)
+        {
+            logit -= penalties.presencePenalty;
+        }
+        if (params.frequencyPenalties != nullptr)
+        {
+            logit -= penalties.frequencyPenalty * static_cast<float>(numOccurrences);
+        }
+    }
+    return static_cast<T>(fminf(fmaxf(logit, -maxVal), maxVal));
+}
+} // namespace
+
 template <typename T, int32_t BLOCK_SIZE_, int32_t BLOCKS_PER_BEAM_>
 __global__ void topKStage1(T const* __restrict logProbs, T const* const* __restrict logProbsPtrs, T* tmpLogProbs,
     SizeType32* topKTmpIdBuf, T* topKTmpValBuf, FinishedState const* finished, SizeType32 maxTopK,
     SizeType32 const* topKs, SizeType32 vocabSize, TokenIdType const* endIds, bool const* skipDecode,
-    SizeType32 const* batchSlots, SizeType32 const* tokensPerStep, SizeType32 maxTokensPerStep)
+    SizeType32 const* batchSlots, SizeType32 const* tokensPerStep, SizeType32 maxTokensPerStep,
+    InvokeBatchApplyPenaltyParams<T> const penaltyParams, bool applyPenalties)
 {
     typedef cub::BlockReduce<TopK_2<T>, BLOCK_SIZE_> BlockReduce;
     __shared__ typename BlockReduce::TempStorage tempStorage;
@@ -48,6 +142,10 @@ __global__ void topKStage1(T const* __restrict logProbs, T const* const* __restr
     auto const tokenIdx = static_cast<SizeType32>(blockIdx.y);
 
     auto const batchId = bid / BLOCKS_PER_BEAM_; // row id for logProbs
+
+    pdlWaitPrimaryGrid();
+    pdlLaunchDependents();
+
     auto const batchSlot = batchSlots == nullptr ? batchId : batchSlots[batchId];
     if (tokensPerStep != nullptr && tokenIdx >= tokensPerStep[batchSlot])
     {
@@ -94,10 +192,29 @@ __global__ void topKStage1(T const* __restrict logProbs, T const* const* __restr
         return;
     }
 
-    for (auto elemId = tid + blockLane * BLOCK_SIZE_; elemId < vocabSize; elemId += BLOCK_SIZE_ * BLOCKS_PER_BEAM_)
+    if (applyPenalties)
     {
-        auto localIndex = elemId + tmpLogBufIndex;
-        tmpLogProbs[localIndex] = logProbsSlot[elemId];
+        // Single token per step and beam, the occurrences of the request are at its batch index.
+        auto const penalties = loadRequestPenalties(penaltyParams, batchSlot);
+        auto const* occurrences = penalties.hasOccurrencePenalty
+            ? penaltyParams.penaltyWorkspace + batchId * penaltyParams.vocabSize
+            : nullptr;
+        for (auto elemId = tid + blockLane * BLOCK_SIZE_; elemId < vocabSize;
+             elemId += BLOCK_SIZE_ * BLOCKS_PER_BEAM_)
+        {
+            auto localIndex = elemId + tmpLogBufIndex;
+            tmpLogProbs[localIndex]
+                = applyRequestPenalties(penaltyParams, penalties, occurrences, logProbsSlot[elemId], elemId, batchSlot);
+        }
+    }
+    else
+    {
+        for (auto elemId = tid + blockLane * BLOCK_SIZE_; elemId < vocabSize;
+             elemId += BLOCK_SIZE_ * BLOCKS_PER_BEAM_)
+        {
+            auto localIndex = elemId + tmpLogBufIndex;
+            tmpLogProbs[localIndex] = logProbsSlot[elemId];
+        }
     }
 
     for (SizeType32 ite = 0; ite < k; ite++)
@@ -142,6 +259,10 @@ __global__ void topKStage2Sampling(SizeType32 const* __restrict topKTmpIdBuf, T*
     auto const tid = static_cast<SizeType32>(threadIdx.x);
     auto const batchIdx = static_cast<SizeType32>(blockIdx.x);
     auto const tokenIdx = static_cast<SizeType32>(blockIdx.y);
+
+    pdlWaitPrimaryGrid();
+    pdlLaunchDependents();
+
     auto const batchSlot = batchSlots == nullptr ? batchIdx : batchSlots[batchIdx];
     FinishedState const finishState = finishedInput != nullptr ? finishedInput[batchSlot] : FinishedState::empty();
     if ((skipDecode != nullptr && skipDecode[batchSlot]) || (finishState.isSkipDecoding()))
@@ -326,24 +447,23 @@ __global__ void topKStage2Sampling(SizeType32 const* __restrict topKTmpIdBuf, T*
         {                                                                                                              \
             dim3 grid(params.batchSize* BLOCKS_PER_BEAM_, params.maxTokensPerStep);                                    \
             dim3 block(BLOCK_SIZE_1_);                                                                                 \
-            topKStage1<T, BLOCK_SIZE_1_, BLOCKS_PER_BEAM_><<<grid, block, 0, stream>>>(params.logProbs,                \
+            launchWithPdl(topKStage1<T, BLOCK_SIZE_1_, BLOCKS_PER_BEAM_>, grid, block, 0, stream, params.logProbs,     \
                 params.logProbsPtrs, tempLogProbs, topKTmpIdBuf, topKTmpValBuf, params.finishedInput, params.maxTopK,  \
                 params.topKs, params.vocabSizePadded, params.endIds, params.skipDecode, params.batchSlots,             \
-                params.tokensPerStep, params.maxTokensPerStep);                                                        \
+                params.tokensPerStep, params.maxTokensPerStep, penaltyParams, params.penaltyParams != nullptr);        \
         }                                                                                                              \
         {                                                                                                              \
             dim3 grid(params.batchSize, params.maxTokensPerStep);                                                      \
             dim3 block(BLOCK_SIZE_2_);                                                                                 \
-            topKStage2Sampling<T, BLOCK_SIZE_2_, BLOCKS_PER_BEAM_>                                                     \
-                <<<grid, block, K_MAX * sizeof(SizeType32) + K_MAX * sizeof(float), stream>>>(topKTmpIdBuf,            \
-                    topKTmpValBuf, params.outputIdsPtrs, params.outputIds, params.sequenceLengths,                     \
-                    params.finishedInput, params.finishedOutput, params.cumLogProbs, params.outputLogProbs,            \
-                    params.maxTopK, params.topKs, params.maxTopP, params.topPs, params.curandState, params.endIds,     \
-                    params.vocabSizePadded, params.skipDecode, params.batchSlots, params.maxBatchSize,                 \
-                    params.normalizeLogProbs, params.logitsHasProbs, params.tokensPerStep, params.maxTokensPerStep,    \
-                    params.maxSeqLen, params.returnAllSelectedTokens, params.strictTopPBoundary,                       \
-                    params.returnAllSelectedTokensPerSlot, params.outputIdCurrentStep,                                 \
-                    params.skipOutputIdCurrentStep);                                                                   \
+            launchWithPdl(topKStage2Sampling<T, BLOCK_SIZE_2_, BLOCKS_PER_BEAM_>, grid, block,                         \
+                K_MAX * sizeof(SizeType32) + K_MAX * sizeof(float), stream, topKTmpIdBuf, topKTmpValBuf,               \
+                params.outputIdsPtrs, params.outputIds, params.sequenceLengths, params.finishedInput,                  \
+                params.finishedOutput, params.cumLogProbs, params.outputLogProbs, params.maxTopK, params.topKs,        \
+                params.maxTopP, params.topPs, params.curandState, params.endIds, params.vocabSizePadded,               \
+                params.skipDecode, params.batchSlots, params.maxBatchSize, params.normalizeLogProbs,                   \
+                params.logitsHasProbs, params.tokensPerStep, params.maxTokensPerStep, params.maxSeqLen,                \
+                params.returnAllSelectedTokens, params.strictTopPBoundary, params.returnAllSelectedTokensPerSlot,      \
+                params.outputIdCurrentStep, params.skipOutputIdCurrentStep);                                           \
         }                                                                                                              \
     } while (0)
 
@@ -369,6 +489,8 @@ void invokeBatchTopKSampling(TopKSamplingKernelParams<T> const& params, cudaStre
     auto tempLogProbs = static_cast<T*>(alignedPointers[0]);
     auto topKTmpIdBuf = static_cast<SizeType32*>(alignedPointers[1]);
     auto topKTmpValBuf = static_cast<T*>(alignedPointers[2]);
+    auto const penaltyParams
+        = params.penaltyParams != nullptr ? *params.penaltyParams : InvokeBatchApplyPenaltyParams<T>{};
 
     SizeType32 logMaxTopK{0};
     SizeType32 recursor{params.maxTopK - 1};
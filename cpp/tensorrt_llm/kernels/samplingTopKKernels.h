@@ -18,6 +18,7 @@
 
 #include "tensorrt_llm/common/memoryUtils.h"
 #include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/kernels/penaltyKernels.h"
 #include "tensorrt_llm/runtime/common.h"
 #include <curand_kernel.h>
 
@@ -126,6 +127,11 @@ struct TopKSamplingKernelParams
     //! input buffer [maxBatchSize]. Determine if multinomial sampling is required when returnAllSelectedTokens==True.
     bool const* skipOutputIdCurrentStep{nullptr};
 
+    //! Optional. Penalties to apply to logProbs while they are copied in the first stage, instead of in a separate
+    //! pass over the vocab. The occurrence counts in penaltyWorkspace must be up to date, see
+    //! InvokeBatchApplyPenaltyParams::countOccurrencesOnly. Requires logits and a single token per step.
+    InvokeBatchApplyPenaltyParams<T> const* penaltyParams{nullptr};
+
     void checkParams() const
     {
         TLLM_CHECK(batchSize > 0);
@@ -166,6 +172,11 @@ struct TopKSamplingKernelParams
         TLLM_CHECK(0 <= maxTopK && maxTopK <= TOP_K_MAX);
         TLLM_CHECK((skipOutputIdCurrentStep && outputIdCurrentStep && returnAllSelectedTokens)
             || (skipOutputIdCurrentStep == nullptr && outputIdCurrentStep == nullptr));
+        if (penaltyParams != nullptr)
+        {
+            TLLM_CHECK(maxTokensPerStep == 1 && !logitsHasProbs && logProbsPtrs == nullptr);
+            TLLM_CHECK(penaltyParams->beamWidth == 1 && penaltyParams->vocabSizePadded == vocabSizePadded);
+        }
     }
 };
 
@@ -166,6 +166,14 @@ void invokeComputeToppDecay(float* runtimeTopP, float const* runtimeInitialTopP,
 template <typename T>
 void invokeBatchAirTopPSampling(TopPSamplingKernelParams<T> const& params, cudaStream_t stream);
 
+//! \brief Given probs, performs top P sampling by rejection instead of sorting or radix selection.
+//! Draws a token from the tokens above a probability pivot and rejects it if it is not in the nucleus, raising the
+//! pivot. Samples exactly from the top P distribution, needs no workspace and is reproducible.
+//! Fills sampled tokens to outputIds. Computes sequenceLength, finished state, cumLogProbs inplace.
+//! Requires curandState, returnAllSelectedTokens is not supported.
+template <typename T>
+void invokeBatchRejectionTopPSampling(TopPSamplingKernelParams<T> const& params, cudaStream_t stream);
+
 //! \brief  Calculate the number of blocks based on the number of multiprocessors, batchSize and vocabSize.
 //! \tparam T the data type of value
 //! \param batchSize
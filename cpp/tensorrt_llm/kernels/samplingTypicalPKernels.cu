@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CUDART_VERSION
+#error CUDART_VERSION Undefined!
+#elif (CUDART_VERSION >= 11050)
+#include <cub/cub.cuh>
+#else
+#include "3rdparty/cub/cub.cuh"
+#endif
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/samplingTypicalPKernels.h"
+#include "tensorrt_llm/layers/defaultDecodingParams.h"
+
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::runtime;
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+// Bisection steps over the distance to the entropy, the cut is found to max distance / 2^steps.
+SizeType32 constexpr kTypicalPBisectionSteps = 24;
+
+__device__ float typicalDistance(float prob, float entropy)
+{
+    return fabsf(-logf(prob) - entropy);
+}
+} // namespace
+
+template <typename T, SizeType32 BLOCK_SIZE>
+__launch_bounds__(BLOCK_SIZE) __global__ void typicalPFilter(T* probs, float const* typicalPs,
+    FinishedState const* finished, SizeType32 const* batchSlots, SizeType32 vocabSize, SizeType32 vocabSizePadded)
+{
+    using BlockReduce = cub::BlockReduce<float, BLOCK_SIZE>;
+    __shared__ typename BlockReduce::TempStorage tempStorage;
+    __shared__ float sValue;
+
+    auto const tid = static_cast<SizeType32>(threadIdx.x);
+    auto const batchId = static_cast<SizeType32>(blockIdx.x);
+    auto const batchSlot = batchSlots != nullptr ? batchSlots[batchId] : batchId;
+    auto const typicalP = typicalPs[batchSlot];
+    FinishedState const finishState = finished != nullptr ? finished[batchSlot] : FinishedState::empty();
+    if (typicalP >= layers::DefaultDecodingParams::getTypicalP() || finishState.isSkipDecoding()
+        || finishState.isFinished())
+    {
+        return;
+    }
+    auto* requestProbs = probs + batchId * vocabSizePadded;
+
+    auto const blockSum = [&](float threadValue)
+    {
+        auto const sum = BlockReduce(tempStorage).Sum(threadValue);
+        if (tid == 0)
+        {
+            sValue = sum;
+        }
+        __syncthreads();
+        auto const value = sValue;
+        __syncthreads();
+        return value;
+    };
+
+    float threadEntropy{0.f};
+    for (auto idx = tid; idx < vocabSize; idx += BLOCK_SIZE)
+    {
+        auto const prob = static_cast<float>(requestProbs[idx]);
+        threadEntropy -= prob > 0.f ? prob * logf(prob) : 0.f;
+    }
+    auto const entropy = blockSum(threadEntropy);
+
+    float threadMaxDistance{0.f};
+    for (auto idx = tid; idx < vocabSize; idx += BLOCK_SIZE)
+    {
+        auto const prob = static_cast<float>(requestProbs[idx]);
+        threadMaxDistance = prob > 0.f ? fmaxf(threadMaxDistance, typicalDistance(prob, entropy)) : threadMaxDistance;
+    }
+    auto const maxDistance = BlockReduce(tempStorage).Reduce(threadMaxDistance, cub::Max());
+    if (tid == 0)
+    {
+        sValue = maxDistance;
+    }
+    __syncthreads();
+
+    // Smallest distance whose set holds typicalP of the mass, up to the bisection precision.
+    float low{0.f};
+    float high{sValue};
+    __syncthreads();
+    for (SizeType32 step = 0; step < kTypicalPBisectionSteps; ++step)
+    {
+        auto const mid = (low + high) / 2.f;
+        float threadMass{0.f};
+        for (auto idx = tid; idx < vocabSize; idx += BLOCK_SIZE)
+        {
+            auto const prob = static_cast<float>(requestProbs[idx]);
+            threadMass += prob > 0.f && typicalDistance(prob, entropy) <= mid ? prob : 0.f;
+        }
+        if (blockSum(threadMass) >= typicalP)
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid;
+        }
+    }
+
+    float threadMass{0.f};
+    for (auto idx = tid; idx < vocabSize; idx += BLOCK_SIZE)
+    {
+        auto const prob = static_cast<float>(requestProbs[idx]);
+        threadMass += prob > 0.f && typicalDistance(prob, entropy) <= high ? prob : 0.f;
+    }
+    auto const keptMass = blockSum(threadMass);
+    auto const invKeptMass = 1.f / fmaxf(keptMass, 1e-20f);
+    for (auto idx = tid; idx < vocabSizePadded; idx += BLOCK_SIZE)
+    {
+        auto const prob = idx < vocabSize ? static_cast<float>(requestProbs[idx]) : 0.f;
+        auto const isKept = prob > 0.f && typicalDistance(prob, entropy) <= high;
+        requestProbs[idx] = static_cast<T>(isKept ? prob * invKeptMass : 0.f);
+    }
+}
+
+template <typename T>
+void invokeTypicalPFilter(T* probs, float const* typicalPs, FinishedState const* finished,
+    SizeType32 const* batchSlots, SizeType32 batchSize, SizeType32 vocabSize, SizeType32 vocabSizePadded,
+    cudaStream_t stream)
+{
+    TLLM_CHECK(probs != nullptr && typicalPs != nullptr);
+    TLLM_CHECK(vocabSize > 0 && vocabSize <= vocabSizePadded);
+
+    SizeType32 constexpr BLOCK_SIZE = 512;
+    typicalPFilter<T, BLOCK_SIZE>
+        <<<batchSize, BLOCK_SIZE, 0, stream>>>(probs, typicalPs, finished, batchSlots, vocabSize, vocabSizePadded);
+    sync_check_cuda_error();
+}
+
+template void invokeTypicalPFilter(float* probs, float const* typicalPs, FinishedState const* finished,
+    SizeType32 const* batchSlots, SizeType32 batchSize, SizeType32 vocabSize, SizeType32 vocabSizePadded,
+    cudaStream_t stream);
+template void invokeTypicalPFilter(half* probs, float const* typicalPs, FinishedState const* finished,
+    SizeType32 const* batchSlots, SizeType32 batchSize, SizeType32 vocabSize, SizeType32 vocabSizePadded,
+    cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/runtime/common.h"
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Restricts probs to the locally typical set, https://arxiv.org/abs/2202.00666.
+//! Tokens are ranked by the distance of their information -log(p) to the entropy of the distribution, and the
+//! closest ones are kept until they hold typicalP of the mass. The others get probability 0 and the kept ones are
+//! renormalized, in place, so that any sampling kernel can draw from the result.
+//! The cut is found by bisection over the distance, without sorting or workspace.
+//!
+//! \param probs input/output buffer [batchSize, vocabSizePadded]. Probabilities, e.g. from invokeAddBiasSoftMax.
+//! \param typicalPs input buffer [maxBatchSize]. Mass of the typical set per request, 1 disables the filter.
+//! \param finished input buffer [maxBatchSize], optional. Finished requests are skipped.
+//! \param batchSlots input buffer [batchSize], optional. Indices of rows of data in memory pool.
+//! \param batchSize batch size
+//! \param vocabSize size of the vocab, probs above it are ignored
+//! \param vocabSizePadded size of padded vocab
+//! \param stream stream
+template <typename T>
+void invokeTypicalPFilter(T* probs, float const* typicalPs, FinishedState const* finished,
+    runtime::SizeType32 const* batchSlots, runtime::SizeType32 batchSize, runtime::SizeType32 vocabSize,
+    runtime::SizeType32 vocabSizePadded, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
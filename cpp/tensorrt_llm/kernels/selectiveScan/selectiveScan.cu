@@ -212,9 +212,12 @@ __launch_bounds__(256, 1) __global__ void selective_scan_loop_kernel(SSMParamsBa
         // Load state and A matrix into registers
         float state_reg[DSTATE];
         float A_reg[DSTATE];
+        bool const has_initial_state
+            = params.has_initial_state_ptr != nullptr && params.has_initial_state_ptr[sample] != 0;
+        input_t const* my_initial_state = &state[slot_idx * num_channels * DSTATE];
         for (int i = 0; i < DSTATE; i++)
         {
-            state_reg[i] = 0.f;
+            state_reg[i] = has_initial_state ? toFloat(my_initial_state[i * num_channels + channel]) : 0.f;
             A_reg[i] = toFloat(A[i * num_channels + channel]);
         }
         float dt_bias_reg = dt_bias[channel];
@@ -422,6 +425,7 @@ void invokeChunkScan(SSMParamsBase& params, cudaStream_t stream, tensorrt_llm::c
     auto rp = params.remove_padding;
     auto ltip = params.last_token_ids_ptr;
     auto ssmp = params.slot_mapping_ptr;
+    auto hisp = params.has_initial_state_ptr;
 
     cudaFuncSetAttribute(chunk_cumsum, cudaFuncAttributeMaxDynamicSharedMemorySize, shms[0]);
     chunk_cumsum<<<bds[0], tds[0], shms[0], stream>>>(
@@ -430,7 +434,8 @@ void invokeChunkScan(SSMParamsBase& params, cudaStream_t stream, tensorrt_llm::c
     chunk_state<<<bds[1], tds[1], shms[1], stream>>>(
         B, L, H, P, G, N, mxSt, mxdc, mxdA, (useTmas[1] ? &descs[0] : mxXBC), rp, ltip);
     cudaFuncSetAttribute(state_passing, cudaFuncAttributeMaxDynamicSharedMemorySize, shms[2]);
-    state_passing<<<bds[2], tds[2], shms[2], stream>>>(B, L, H, P, G, N, mxOs, mxFs, mxSt, mxdA, rp, ltip, ssmp);
+    state_passing<<<bds[2], tds[2], shms[2], stream>>>(
+        B, L, H, P, G, N, mxOs, mxFs, mxSt, mxdA, rp, ltip, ssmp, hisp);
     cudaFuncSetAttribute(bmm_chunk, cudaFuncAttributeMaxDynamicSharedMemorySize, shms[3]);
     bmm_chunk<<<bds[3], tds[3], shms[3], stream>>>(B, L, H, P, G, N, mxCB, (useTmas[3] ? &descs[2] : mxXBC), rp, ltip);
     cudaFuncSetAttribute(chunk_scan, cudaFuncAttributeMaxDynamicSharedMemorySize, shms[4]);
@@ -496,96 +501,110 @@ __launch_bounds__(128, 2) __global__ void selective_scan_update_kernel(SSMParams
     int const x_dim = MAMBA_V1 ? num_channels : num_channels + bc_dim;
     int const z_dim = MAMBA_V1 ? num_channels : 2 * num_channels + bc_dim + (nheads + 7) / 8 * 8;
     int const dt_dim = MAMBA_V1 ? num_channels : (z ? z_dim : z_dim - num_channels);
-    int const dt_offset = MAMBA_V1 ? sample * dt_dim : sample * dt_dim + dt_dim - (nheads + 7) / 8 * 8;
-    int const bc_offset = MAMBA_V1 ? sample * (bc_dim + params.dt_rank) : sample * (num_channels + bc_dim);
     int const b_offset = MAMBA_V1 ? params.dt_rank : num_channels + DSTATE * group;
     int const c_offset = MAMBA_V1 ? params.dt_rank + DSTATE : num_channels + DSTATE * (ngroups + group);
 
-    input_t* my_state = &state[slot_idx * num_channels * DSTATE];
-    input_t* my_output = &output[sample * num_channels];
+    int const state_size = num_channels * DSTATE;
+    int const num_spec_tokens = max(params.num_spec_tokens, 1);
+    input_t* snapshots = reinterpret_cast<input_t*>(params.state_snapshot_ptr);
+    input_t* cache_state = &state[slot_idx * state_size];
 
     int const state_loops = (DSTATE + STATE_UNROLL - 1) / STATE_UNROLL;
 
-    float my_x, my_dt, my_z, my_dt_bias, out;
-    my_x = toFloat(x[sample * x_dim + channel]);
-    my_z = z ? toFloat(z[sample * z_dim + channel]) : 0.f;
-    my_dt = toFloat(dt[dt_offset + dt_d_idx]);
-    my_dt_bias = dt_bias ? toFloat(dt_bias[dt_d_idx]) : 0.f;
-    out = D ? toFloat(D[dt_d_idx]) * my_x : 0.f;
+    float my_dt_bias = dt_bias ? toFloat(dt_bias[dt_d_idx]) : 0.f;
 
-    float dt_b = my_dt + my_dt_bias;
-    float dt_b_sp = 1.0f;
-    if (dt_softplus)
+    // The tokens of a sequence in speculative decoding each continue from the state of their parent, -1 being the
+    // state in the cache. A thread only touches the state of its channel, so it reads back the snapshots it wrote.
+    for (int t = 0; t < num_spec_tokens; t++)
     {
-        dt_b_sp = dt_b <= 20.f ? __logf(1.f + __expf(dt_b)) : dt_b; // softplus
-    }
-
-    if (MAMBA_V1)
-    {
-        float rA[DSTATE];
-        float rB[DSTATE];
-        float rC[DSTATE];
-        float rState[DSTATE];
-#pragma unroll
-        for (int i = 0; i < DSTATE; i++)
+        int const token = sample * num_spec_tokens + t;
+        int const parent = params.spec_parent_ptr == nullptr ? t - 1 : params.spec_parent_ptr[token];
+        input_t* prev_state = parent < 0 ? cache_state : &snapshots[(sample * num_spec_tokens + parent) * state_size];
+        input_t* next_state = snapshots == nullptr ? cache_state : &snapshots[token * state_size];
+
+        int const dt_offset = MAMBA_V1 ? token * dt_dim : token * dt_dim + dt_dim - (nheads + 7) / 8 * 8;
+        int const bc_offset = MAMBA_V1 ? token * (bc_dim + params.dt_rank) : token * (num_channels + bc_dim);
+
+        float my_x, my_dt, my_z, out;
+        my_x = toFloat(x[token * x_dim + channel]);
+        my_z = z ? toFloat(z[token * z_dim + channel]) : 0.f;
+        my_dt = toFloat(dt[dt_offset + dt_d_idx]);
+        out = D ? toFloat(D[dt_d_idx]) * my_x : 0.f;
+
+        float dt_b = my_dt + my_dt_bias;
+        float dt_b_sp = 1.0f;
+        if (dt_softplus)
         {
-            rA[i] = toFloat(A[i * num_channels + channel]);
-            rB[i] = toFloat(B[bc_offset + b_offset + i]);
-            rC[i] = toFloat(C[bc_offset + c_offset + i]);
-            rState[i] = toFloat(my_state[i * num_channels + channel]);
+            dt_b_sp = dt_b <= 20.f ? __logf(1.f + __expf(dt_b)) : dt_b; // softplus
         }
-#pragma unroll
-        for (int i = 0; i < DSTATE; i++)
-        {
-            float dA = __expf(rA[i] * dt_b_sp);
-            float dB = rB[i] * dt_b_sp;
-            float sdA = rState[i] * dA;
-            float dBx = dB * my_x;
-            float newState = sdA + dBx;
-            // Write the new state back out to the cache
-            convertAndStore(&my_state[i * num_channels + channel], newState);
-            out += newState * rC[i];
-        }
-    }
-    else
-    {
-        float A_tmp = toFloat(A[head]);
-        float rB[STATE_UNROLL];
-        float rC[STATE_UNROLL];
-        float rState[STATE_UNROLL];
-        for (int si = 0; si < state_loops; si++)
+
+        if (MAMBA_V1)
         {
-            int i_offset = si * STATE_UNROLL;
+            float rA[DSTATE];
+            float rB[DSTATE];
+            float rC[DSTATE];
+            float rState[DSTATE];
 #pragma unroll
-            for (int i = 0; i < STATE_UNROLL; i++)
+            for (int i = 0; i < DSTATE; i++)
             {
-                rB[i] = toFloat(B[bc_offset + b_offset + i_offset + i]);
-                rC[i] = toFloat(C[bc_offset + c_offset + i_offset + i]);
-                rState[i] = toFloat(my_state[(head * DSTATE + i_offset + i) * head_dim + head_chl]);
+                rA[i] = toFloat(A[i * num_channels + channel]);
+                rB[i] = toFloat(B[bc_offset + b_offset + i]);
+                rC[i] = toFloat(C[bc_offset + c_offset + i]);
+                rState[i] = toFloat(prev_state[i * num_channels + channel]);
             }
 #pragma unroll
-            for (int i = 0; i < STATE_UNROLL; i++)
+            for (int i = 0; i < DSTATE; i++)
             {
-                float dA = __expf(A_tmp * dt_b_sp);
+                float dA = __expf(rA[i] * dt_b_sp);
                 float dB = rB[i] * dt_b_sp;
                 float sdA = rState[i] * dA;
                 float dBx = dB * my_x;
                 float newState = sdA + dBx;
                 // Write the new state back out to the cache
-                convertAndStore(&my_state[(head * DSTATE + i_offset + i) * head_dim + head_chl], newState);
+                convertAndStore(&next_state[i * num_channels + channel], newState);
                 out += newState * rC[i];
             }
         }
-    }
+        else
+        {
+            float A_tmp = toFloat(A[head]);
+            float rB[STATE_UNROLL];
+            float rC[STATE_UNROLL];
+            float rState[STATE_UNROLL];
+            for (int si = 0; si < state_loops; si++)
+            {
+                int i_offset = si * STATE_UNROLL;
+#pragma unroll
+                for (int i = 0; i < STATE_UNROLL; i++)
+                {
+                    rB[i] = toFloat(B[bc_offset + b_offset + i_offset + i]);
+                    rC[i] = toFloat(C[bc_offset + c_offset + i_offset + i]);
+                    rState[i] = toFloat(prev_state[(head * DSTATE + i_offset + i) * head_dim + head_chl]);
+                }
+#pragma unroll
+                for (int i = 0; i < STATE_UNROLL; i++)
+                {
+                    float dA = __expf(A_tmp * dt_b_sp);
+                    float dB = rB[i] * dt_b_sp;
+                    float sdA = rState[i] * dA;
+                    float dBx = dB * my_x;
+                    float newState = sdA + dBx;
+                    // Write the new state back out to the cache
+                    convertAndStore(&next_state[(head * DSTATE + i_offset + i) * head_dim + head_chl], newState);
+                    out += newState * rC[i];
+                }
+            }
+        }
 
-    if (z)
-    {
-        float sig_z = __fdividef(1.f, (1.f + __expf(0.f - my_z)));
-        float silu_z = my_z * sig_z;
-        out *= silu_z;
-    }
+        if (z)
+        {
+            float sig_z = __fdividef(1.f, (1.f + __expf(0.f - my_z)));
+            float silu_z = my_z * sig_z;
+            out *= silu_z;
+        }
 
-    convertAndStore(&my_output[channel], out);
+        convertAndStore(&output[token * num_channels + channel], out);
+    }
 }
 
 template <typename input_t, typename weight_t>
@@ -602,6 +621,8 @@ void invokeSelectiveScanUpdate(SSMParamsBase& params, cudaStream_t stream)
     dim3 grid(blocks, samples);
 
     TLLM_CHECK_WITH_INFO(nheads % ngroups == 0, "nheads must be divisible by ngroups");
+    TLLM_CHECK_WITH_INFO(params.num_spec_tokens <= 1 || params.state_snapshot_ptr != nullptr,
+        "The draft tokens of speculative decoding need the state snapshots");
     if (params.is_mamba2)
     {
         TLLM_CHECK(params.dstate == 128);
@@ -44,7 +44,8 @@ typedef void (*StatePassingKernelFunc)(int B_, int L_, int H_, int P_, int G_, i
                          //  const void *g_mxD_,  // Wt_       H
                          //  const void *g_mxX_,  // Tp_   B*L*(H*P+2*G*N)
                          //  const void *g_mxZ_,  // g_mxdt_ or nullptr
-    bool removePadding_, int const* lastTokenIdsPtr_, int const* stateSlotMappingPtr_);
+    bool removePadding_, int const* lastTokenIdsPtr_, int const* stateSlotMappingPtr_,
+    int const* hasInitialStatePtr_);
 
 template <int Q_, int tileH_, int warpH_, class Tp_>
 __global__ std::enable_if_t<std::is_same_v<Tp_, half> || std::is_same_v<Tp_, __nv_bfloat16>> state_passing_kernel(
@@ -62,7 +63,8 @@ __global__ std::enable_if_t<std::is_same_v<Tp_, half> || std::is_same_v<Tp_, __n
                          //  const void *g_mxD_,  // Wt_       H
                          //  const void *g_mxX_,  // Tp_   B*L*(H*P+2*G*N)
                          //  const void *g_mxZ_,  // g_mxdt_ or nullptr
-    bool removePadding_, int const* lastTokenIdsPtr_, int const* stateSlotMappingPtr_)
+    bool removePadding_, int const* lastTokenIdsPtr_, int const* stateSlotMappingPtr_,
+    int const* hasInitialStatePtr_)
 {
 #if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 800
     using namespace tensorrt_llm::common;
@@ -126,6 +128,12 @@ __global__ std::enable_if_t<std::is_same_v<Tp_, half> || std::is_same_v<Tp_, __n
 
     Tp_ r_mxOs[tileH_ / (warpH_ * 32)] = {0};
     float r_mxSt[tileH_ / (warpH_ * 32)] = {0};
+    // A context chunk continues from the final state of the previous chunk of its sequence.
+    if (hasInitialStatePtr_ && hasInitialStatePtr_[blockIdx.z])
+#pragma unroll
+        for (int i = 0; i < tileH_ / (warpH_ * 32); i++)
+            r_mxSt[i] = float(g_mxFs[get(blockIdx_x * cn<tileH_>
+                + (threadIdx_y * cn<32> + threadIdx_x) * cn<tileH_ / (warpH_ * 32)> + Rn<UNROLL>{i})]);
 
     for (int iC = 0; iC < C.var; iC++)
     {
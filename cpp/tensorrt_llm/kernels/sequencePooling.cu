@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/sequencePooling.h"
+
+#include <cuda_fp16.h>
+#ifdef ENABLE_BF16
+#include <cuda_bf16.h>
+#endif
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+constexpr int32_t kBlockSize = 256;
+
+// grid [batchSize, divUp(hiddenSize, kBlockSize)], one thread per hidden dimension of a sequence.
+template <typename T>
+__global__ void sequencePoolingKernel(
+    T const* hiddenStates, int32_t const* seqOffsets, int32_t hiddenSize, bool mean, float* out)
+{
+    auto const seqIdx = blockIdx.x;
+    auto const dim = static_cast<int32_t>(blockIdx.y * blockDim.x + threadIdx.x);
+    if (dim >= hiddenSize)
+    {
+        return;
+    }
+    auto const begin = seqOffsets[seqIdx];
+    auto const end = mean ? seqOffsets[seqIdx + 1] : begin + 1;
+    float sum = 0.f;
+    for (auto ti = begin; ti < end; ++ti)
+    {
+        sum += static_cast<float>(hiddenStates[static_cast<int64_t>(ti) * hiddenSize + dim]);
+    }
+    out[static_cast<int64_t>(seqIdx) * hiddenSize + dim] = end > begin ? sum / static_cast<float>(end - begin) : 0.f;
+}
+
+} // namespace
+
+template <typename T>
+void invokeSequencePooling(T const* hiddenStates, int32_t const* seqOffsets, int32_t batchSize, int32_t hiddenSize,
+    bool mean, float* out, cudaStream_t stream)
+{
+    if (batchSize == 0)
+    {
+        return;
+    }
+    dim3 const grid(batchSize, divUp(hiddenSize, kBlockSize));
+    sequencePoolingKernel<T><<<grid, kBlockSize, 0, stream>>>(hiddenStates, seqOffsets, hiddenSize, mean, out);
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_SEQUENCE_POOLING(T)                                                                                \
+    template void invokeSequencePooling<T>(T const* hiddenStates, int32_t const* seqOffsets, int32_t batchSize,        \
+        int32_t hiddenSize, bool mean, float* out, cudaStream_t stream)
+
+INSTANTIATE_SEQUENCE_POOLING(float);
+INSTANTIATE_SEQUENCE_POOLING(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_SEQUENCE_POOLING(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_SEQUENCE_POOLING
+
+} // namespace tensorrt_llm::kernels
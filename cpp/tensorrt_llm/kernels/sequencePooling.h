@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Pool the hidden states of the packed sequences of a batch into one FP32 embedding per sequence.
+//! \param hiddenStates [numTokens, hiddenSize], the tokens of sequence s are [seqOffsets[s], seqOffsets[s + 1]).
+//! \param seqOffsets [batchSize + 1] on the device.
+//! \param mean Average the tokens of a sequence if true, take its first token (the CLS token) otherwise.
+//! \param out [batchSize, hiddenSize].
+template <typename T>
+void invokeSequencePooling(T const* hiddenStates, int32_t const* seqOffsets, int32_t batchSize, int32_t hiddenSize,
+    bool mean, float* out, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,439 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/sparseKvAttention.h"
+
+#include <cfloat>
+#include <cub/cub.cuh>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+namespace
+{
+
+int32_t constexpr kWarpSize = 32;
+int32_t constexpr kNumWarps = 4;
+int32_t constexpr kBlockSize = kNumWarps * kWarpSize;
+// Rows (query heads of a KV head) of a warp. Their softmax states stay in registers over the whole KV loop.
+int32_t constexpr kRowsPerWarp = 4;
+int32_t constexpr kChunkRows = kNumWarps * kRowsPerWarp;
+// Tokens of a KV tile, one per lane when the scores are computed.
+int32_t constexpr kTileTokens = kWarpSize;
+// CTAs along the blocks of a sequence when the summaries are updated, so that long contexts are not
+// summarized by a single CTA per KV head.
+int32_t constexpr kSummarySplits = 8;
+
+__device__ __forceinline__ float warpMax(float val)
+{
+#pragma unroll
+    for (int32_t mask = kWarpSize / 2; mask > 0; mask >>= 1)
+    {
+        val = fmaxf(val, __shfl_xor_sync(0xffffffff, val, mask));
+    }
+    return val;
+}
+
+__device__ __forceinline__ float warpSum(float val)
+{
+#pragma unroll
+    for (int32_t mask = kWarpSize / 2; mask > 0; mask >>= 1)
+    {
+        val += __shfl_xor_sync(0xffffffff, val, mask);
+    }
+    return val;
+}
+
+__host__ __device__ inline float* getBlockScores(void* workspace)
+{
+    return reinterpret_cast<float*>(workspace);
+}
+
+__host__ __device__ inline int32_t* getSelectedBlocks(
+    void* workspace, int32_t batchSize, int32_t numKvHeads, int32_t maxBlocksPerSeq)
+{
+    return reinterpret_cast<int32_t*>(getBlockScores(workspace) + static_cast<size_t>(batchSize) * numKvHeads
+        * maxBlocksPerSeq);
+}
+
+__device__ __forceinline__ float* getSummary(
+    float* blockSummaries, KVCacheIndex const& offset, int32_t numKvHeads, int32_t kvHeadIdx, int32_t headSize)
+{
+    return blockSummaries + (static_cast<size_t>(offset.get()) * numKvHeads + kvHeadIdx) * 2 * headSize;
+}
+
+// grid [numKvHeads, batchSize, kSummarySplits], block [headSize]: a thread computes the range of one channel.
+template <typename T>
+__global__ void updateKvBlockSummariesKernel(SparseKvAttentionParams<T> params, KVBlockArray kvCache)
+{
+    auto const kvHeadIdx = static_cast<int32_t>(blockIdx.x);
+    auto const batchIdx = static_cast<int32_t>(blockIdx.y);
+    auto const channel = static_cast<int32_t>(threadIdx.x);
+
+    auto const kvLength = params.kvLengths[batchIdx];
+    auto const numNewTokens = min(params.numNewTokens[batchIdx], kvLength);
+    if (numNewTokens <= 0)
+    {
+        return;
+    }
+    auto const tokensPerBlock = kvCache.mTokensPerBlock;
+    auto const firstBlock = (kvLength - numNewTokens) / tokensPerBlock;
+    auto const lastBlock = (kvLength - 1) / tokensPerBlock;
+    auto const* kOffsets = kvCache.getRowPtr(KVIdxType::K_IDX, batchIdx);
+
+    for (auto blockInSeq = firstBlock + static_cast<int32_t>(blockIdx.z); blockInSeq <= lastBlock;
+         blockInSeq += kSummarySplits)
+    {
+        auto const& offset = kOffsets[blockInSeq];
+        if (!offset.isPrimary())
+        {
+            continue;
+        }
+        // The whole block is summarized again, so that the summary does not depend on the previous one.
+        auto const tokenBegin = blockInSeq * tokensPerBlock;
+        auto const tokenEnd = min(tokenBegin + tokensPerBlock, kvLength);
+        auto const* kBlock = reinterpret_cast<T const*>(kvCache.getKBlockPtr(batchIdx, tokenBegin));
+        float kMin = FLT_MAX;
+        float kMax = -FLT_MAX;
+        for (auto tokenIdx = tokenBegin; tokenIdx < tokenEnd; ++tokenIdx)
+        {
+            auto const value
+                = cuda_cast<float>(kBlock[kvCache.getKVLocalIdx(tokenIdx, kvHeadIdx, params.headSize, channel)]);
+            kMin = fminf(kMin, value);
+            kMax = fmaxf(kMax, value);
+        }
+        auto* summary = getSummary(params.blockSummaries, offset, params.numKvHeads, kvHeadIdx, params.headSize);
+        summary[channel] = kMin;
+        summary[params.headSize + channel] = kMax;
+    }
+}
+
+// grid [numKvHeads, batchSize], block [kBlockSize], dynamic shared memory [groupSize, HEAD_SIZE] floats for the
+// queries of the KV head. A warp scores one block at a time, then the block selects the best ones one by one.
+template <typename T, int32_t HEAD_SIZE>
+__global__ void __launch_bounds__(kBlockSize)
+    selectKvBlocksKernel(SparseKvAttentionParams<T> params, KVBlockArray kvCache)
+{
+    int32_t constexpr kChannelsPerLane = HEAD_SIZE / kWarpSize;
+    using BlockReduceArgMax = cub::BlockReduce<cub::KeyValuePair<int32_t, float>, kBlockSize>;
+    __shared__ typename BlockReduceArgMax::TempStorage reduceStorage;
+    extern __shared__ float qSmem[];
+
+    auto const kvHeadIdx = static_cast<int32_t>(blockIdx.x);
+    auto const batchIdx = static_cast<int32_t>(blockIdx.y);
+    auto const warpIdx = static_cast<int32_t>(threadIdx.x) / kWarpSize;
+    auto const laneIdx = static_cast<int32_t>(threadIdx.x) % kWarpSize;
+    auto const groupSize = params.numHeads / params.numKvHeads;
+
+    auto const numBlocks = divUp(params.kvLengths[batchIdx], kvCache.mTokensPerBlock);
+    auto const rowIdx = batchIdx * params.numKvHeads + kvHeadIdx;
+    auto* scores = getBlockScores(params.workspace) + static_cast<size_t>(rowIdx) * kvCache.mMaxBlocksPerSeq;
+    auto* selected
+        = getSelectedBlocks(params.workspace, params.batchSize, params.numKvHeads, kvCache.mMaxBlocksPerSeq)
+        + static_cast<size_t>(rowIdx) * params.topKBlocks;
+
+    if (numBlocks <= params.topKBlocks)
+    {
+        for (auto idx = static_cast<int32_t>(threadIdx.x); idx < numBlocks; idx += kBlockSize)
+        {
+            selected[idx] = idx;
+        }
+        return;
+    }
+
+    auto const* q = params.q + (static_cast<size_t>(batchIdx) * params.numHeads + kvHeadIdx * groupSize) * HEAD_SIZE;
+    for (auto idx = static_cast<int32_t>(threadIdx.x); idx < groupSize * HEAD_SIZE; idx += kBlockSize)
+    {
+        qSmem[idx] = cuda_cast<float>(q[idx]);
+    }
+    __syncthreads();
+
+    auto const* kOffsets = kvCache.getRowPtr(KVIdxType::K_IDX, batchIdx);
+    for (auto blockInSeq = warpIdx; blockInSeq < numBlocks; blockInSeq += kNumWarps)
+    {
+        float const* summary
+            = getSummary(params.blockSummaries, kOffsets[blockInSeq], params.numKvHeads, kvHeadIdx, HEAD_SIZE);
+        float kMin[kChannelsPerLane];
+        float kMax[kChannelsPerLane];
+#pragma unroll
+        for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+        {
+            kMin[ci] = summary[ci * kWarpSize + laneIdx];
+            kMax[ci] = summary[HEAD_SIZE + ci * kWarpSize + laneIdx];
+        }
+        // For every channel, q * k is largest at one end of the range of the block, so the sum of these products
+        // bounds the score of all its keys (Quest). A block is as relevant as it is for its best query head.
+        float bound = -FLT_MAX;
+        for (int32_t headIdx = 0; headIdx < groupSize; ++headIdx)
+        {
+            float partial = 0.f;
+#pragma unroll
+            for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+            {
+                auto const qValue = qSmem[headIdx * HEAD_SIZE + ci * kWarpSize + laneIdx];
+                partial += fmaxf(qValue * kMin[ci], qValue * kMax[ci]);
+            }
+            bound = fmaxf(bound, warpSum(partial));
+        }
+        if (laneIdx == 0)
+        {
+            bool const forced = blockInSeq < params.numSinkBlocks || blockInSeq == numBlocks - 1;
+            scores[blockInSeq] = forced ? FLT_MAX : bound;
+        }
+    }
+    __syncthreads();
+
+    // Selected blocks are marked with -FLT_MAX, below any bound.
+    for (int32_t ki = 0; ki < params.topKBlocks; ++ki)
+    {
+        cub::KeyValuePair<int32_t, float> threadBest{0, -FLT_MAX};
+        for (auto idx = static_cast<int32_t>(threadIdx.x); idx < numBlocks; idx += kBlockSize)
+        {
+            if (scores[idx] > threadBest.value)
+            {
+                threadBest = {idx, scores[idx]};
+            }
+        }
+        auto const best = BlockReduceArgMax(reduceStorage).Reduce(threadBest, cub::ArgMax());
+        if (threadIdx.x == 0)
+        {
+            selected[ki] = best.key;
+            scores[best.key] = -FLT_MAX;
+        }
+        __syncthreads();
+    }
+}
+
+// grid [numKvHeads, batchSize], block [kBlockSize]: a block attends the selected blocks of one sequence for the query
+// heads of one KV head.
+template <typename T, int32_t HEAD_SIZE>
+__global__ void __launch_bounds__(kBlockSize)
+    sparseKvAttentionKernel(SparseKvAttentionParams<T> params, KVBlockArray kvCache)
+{
+    int32_t constexpr kChannelsPerLane = HEAD_SIZE / kWarpSize;
+    __shared__ float qSmem[kChunkRows][HEAD_SIZE];
+    // Padded so that the lanes reading one channel of different tokens do not share a bank.
+    __shared__ float kSmem[kTileTokens][HEAD_SIZE + 1];
+    __shared__ float vSmem[kTileTokens][HEAD_SIZE];
+
+    auto const kvHeadIdx = static_cast<int32_t>(blockIdx.x);
+    auto const batchIdx = static_cast<int32_t>(blockIdx.y);
+    auto const warpIdx = static_cast<int32_t>(threadIdx.x) / kWarpSize;
+    auto const laneIdx = static_cast<int32_t>(threadIdx.x) % kWarpSize;
+    auto const groupSize = params.numHeads / params.numKvHeads;
+
+    auto const kvLength = params.kvLengths[batchIdx];
+    auto const tokensPerBlock = kvCache.mTokensPerBlock;
+    auto const numSelected = min(divUp(kvLength, tokensPerBlock), params.topKBlocks);
+    auto const* selected
+        = getSelectedBlocks(params.workspace, params.batchSize, params.numKvHeads, kvCache.mMaxBlocksPerSeq)
+        + static_cast<size_t>(batchIdx * params.numKvHeads + kvHeadIdx) * params.topKBlocks;
+    auto const headBegin = batchIdx * params.numHeads + kvHeadIdx * groupSize;
+
+    for (int32_t chunkStart = 0; chunkStart < groupSize; chunkStart += kChunkRows)
+    {
+        // Load the scaled queries of the chunk.
+        __syncthreads();
+        for (auto idx = static_cast<int32_t>(threadIdx.x); idx < kChunkRows * HEAD_SIZE; idx += kBlockSize)
+        {
+            auto const localRow = idx / HEAD_SIZE;
+            auto const channel = idx % HEAD_SIZE;
+            auto const row = chunkStart + localRow;
+            float value = 0.f;
+            if (row < groupSize)
+            {
+                value = cuda_cast<float>(params.q[static_cast<size_t>(headBegin + row) * HEAD_SIZE + channel])
+                    * params.qScale;
+            }
+            qSmem[localRow][channel] = value;
+        }
+
+        float rowMax[kRowsPerWarp];
+        float rowSum[kRowsPerWarp];
+        float acc[kRowsPerWarp][kChannelsPerLane];
+#pragma unroll
+        for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+        {
+            rowMax[ri] = -FLT_MAX;
+            rowSum[ri] = 0.f;
+#pragma unroll
+            for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+            {
+                acc[ri][ci] = 0.f;
+            }
+        }
+
+        for (int32_t si = 0; si < numSelected; ++si)
+        {
+            auto const blockBegin = selected[si] * tokensPerBlock;
+            auto const blockEnd = min(blockBegin + tokensPerBlock, kvLength);
+            for (int32_t tileStart = blockBegin; tileStart < blockEnd; tileStart += kTileTokens)
+            {
+                // Load the tile once for all rows of the chunk.
+                __syncthreads();
+                for (auto idx = static_cast<int32_t>(threadIdx.x); idx < kTileTokens * HEAD_SIZE; idx += kBlockSize)
+                {
+                    auto const tokenOffset = idx / HEAD_SIZE;
+                    auto const channel = idx % HEAD_SIZE;
+                    auto const tokenIdx = tileStart + tokenOffset;
+                    float kValue = 0.f;
+                    float vValue = 0.f;
+                    if (tokenIdx < blockEnd)
+                    {
+                        auto const localIdx = kvCache.getKVLocalIdx(tokenIdx, kvHeadIdx, HEAD_SIZE, channel);
+                        kValue = cuda_cast<float>(
+                            reinterpret_cast<T const*>(kvCache.getKBlockPtr(batchIdx, tokenIdx))[localIdx]);
+                        vValue = cuda_cast<float>(
+                            reinterpret_cast<T const*>(kvCache.getVBlockPtr(batchIdx, tokenIdx))[localIdx]);
+                    }
+                    kSmem[tokenOffset][channel] = kValue;
+                    vSmem[tokenOffset][channel] = vValue;
+                }
+                __syncthreads();
+
+                bool const visible = tileStart + laneIdx < blockEnd;
+#pragma unroll
+                for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+                {
+                    auto const localRow = warpIdx * kRowsPerWarp + ri;
+                    if (chunkStart + localRow >= groupSize)
+                    {
+                        continue;
+                    }
+                    float score = -FLT_MAX;
+                    if (visible)
+                    {
+                        score = 0.f;
+#pragma unroll 16
+                        for (int32_t channel = 0; channel < HEAD_SIZE; ++channel)
+                        {
+                            score += qSmem[localRow][channel] * kSmem[laneIdx][channel];
+                        }
+                    }
+
+                    auto const newMax = fmaxf(rowMax[ri], warpMax(score));
+                    auto const correction = __expf(rowMax[ri] - newMax);
+                    auto const prob = visible ? __expf(score - newMax) : 0.f;
+                    rowSum[ri] = rowSum[ri] * correction + warpSum(prob);
+                    rowMax[ri] = newMax;
+#pragma unroll
+                    for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+                    {
+                        acc[ri][ci] *= correction;
+                    }
+                    for (int32_t ti = 0; ti < kTileTokens; ++ti)
+                    {
+                        auto const p = __shfl_sync(0xffffffff, prob, ti);
+#pragma unroll
+                        for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+                        {
+                            acc[ri][ci] += p * vSmem[ti][ci * kWarpSize + laneIdx];
+                        }
+                    }
+                }
+            }
+        }
+
+#pragma unroll
+        for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+        {
+            auto const row = chunkStart + warpIdx * kRowsPerWarp + ri;
+            if (row >= groupSize)
+            {
+                continue;
+            }
+            auto const invSum = rowSum[ri] > 0.f ? 1.f / rowSum[ri] : 0.f;
+            auto* out = params.out + static_cast<size_t>(headBegin + row) * HEAD_SIZE;
+#pragma unroll
+            for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+            {
+                out[ci * kWarpSize + laneIdx] = cuda_cast<T>(acc[ri][ci] * invSum);
+            }
+        }
+    }
+}
+
+template <typename T, int32_t HEAD_SIZE>
+void launchSparseKvAttention(SparseKvAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream)
+{
+    auto const groupSize = params.numHeads / params.numKvHeads;
+    auto const qSmemSize = static_cast<size_t>(groupSize) * HEAD_SIZE * sizeof(float);
+    TLLM_CHECK_WITH_INFO(qSmemSize <= 48 * 1024, "Too many query heads (%d) per KV head", groupSize);
+    dim3 const grid(params.numKvHeads, params.batchSize);
+    selectKvBlocksKernel<T, HEAD_SIZE><<<grid, kBlockSize, qSmemSize, stream>>>(params, kvCache);
+    sparseKvAttentionKernel<T, HEAD_SIZE><<<grid, kBlockSize, 0, stream>>>(params, kvCache);
+}
+
+} // namespace
+
+size_t getKvBlockSummariesSize(int32_t numPoolBlocks, int32_t numKvHeads, int32_t headSize)
+{
+    return static_cast<size_t>(numPoolBlocks) * numKvHeads * 2 * headSize * sizeof(float);
+}
+
+size_t getSparseKvAttentionWorkspaceSize(
+    int32_t batchSize, int32_t numKvHeads, int32_t maxBlocksPerSeq, int32_t topKBlocks)
+{
+    auto const numRows = static_cast<size_t>(batchSize) * numKvHeads;
+    return numRows * maxBlocksPerSeq * sizeof(float) + numRows * topKBlocks * sizeof(int32_t);
+}
+
+template <typename T>
+void invokeUpdateKvBlockSummaries(
+    SparseKvAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream)
+{
+    TLLM_CHECK(params.kvLengths && params.numNewTokens && params.blockSummaries);
+    TLLM_CHECK(params.batchSize > 0 && params.numKvHeads > 0 && params.headSize > 0 && params.headSize <= 1024);
+
+    dim3 const grid(params.numKvHeads, params.batchSize, kSummarySplits);
+    updateKvBlockSummariesKernel<T><<<grid, params.headSize, 0, stream>>>(params, kvCache);
+
+    sync_check_cuda_error();
+}
+
+template <typename T>
+void invokeSparseKvAttention(SparseKvAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream)
+{
+    params.checkParams();
+    switch (params.headSize)
+    {
+    case 64: launchSparseKvAttention<T, 64>(params, kvCache, stream); break;
+    case 128: launchSparseKvAttention<T, 128>(params, kvCache, stream); break;
+    default: TLLM_THROW("Unsupported head size %d", params.headSize);
+    }
+
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_SPARSE_KV_ATTENTION(T)                                                                             \
+    template void invokeUpdateKvBlockSummaries<T>(                                                                     \
+        SparseKvAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream);                   \
+    template void invokeSparseKvAttention<T>(                                                                          \
+        SparseKvAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream)
+
+INSTANTIATE_SPARSE_KV_ATTENTION(float);
+INSTANTIATE_SPARSE_KV_ATTENTION(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_SPARSE_KV_ATTENTION(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_SPARSE_KV_ATTENTION
+
+} // namespace tensorrt_llm::kernels
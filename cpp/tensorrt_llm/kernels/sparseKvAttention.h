@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/kernels/kvCacheUtils.h"
+#include <cstddef>
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+template <typename T>
+struct SparseKvAttentionParams
+{
+    // Queries of the generation tokens after the rotary embedding [batchSize, numHeads, headSize].
+    T const* q{nullptr};
+    // Output [batchSize, numHeads, headSize].
+    T* out{nullptr};
+    // Number of tokens in the cache of every sequence, including the generation token [batchSize].
+    int32_t const* kvLengths{nullptr};
+    // Number of tokens written to the cache of every sequence since the last summary update [batchSize]. Only read by
+    // invokeUpdateKvBlockSummaries.
+    int32_t const* numNewTokens{nullptr};
+    // Per channel minimum and maximum of the keys of every block of the primary pool of the layer, see
+    // getKvBlockSummariesSize. Indexed by the pool index of the K block, so that reused blocks keep their summary.
+    float* blockSummaries{nullptr};
+    int32_t batchSize{0};
+    int32_t numHeads{0};
+    int32_t numKvHeads{0};
+    int32_t headSize{0};
+    // Number of blocks a sequence attends, per KV head. Sequences with fewer blocks attend all of them.
+    int32_t topKBlocks{0};
+    // Leading blocks that are always attended, since the first tokens draw much of the attention (attention sinks).
+    // The block of the generation token is always attended too.
+    int32_t numSinkBlocks{1};
+    // Scale of the attention scores, usually 1 / sqrt(headSize).
+    float qScale{1.f};
+    // Workspace of getSparseKvAttentionWorkspaceSize bytes, for the block scores and the selected blocks.
+    void* workspace{nullptr};
+
+    void checkParams() const
+    {
+        TLLM_CHECK(q && out && kvLengths && blockSummaries && workspace);
+        TLLM_CHECK(batchSize > 0 && topKBlocks > 0 && numSinkBlocks >= 0 && numSinkBlocks < topKBlocks);
+        TLLM_CHECK(numKvHeads > 0 && numHeads % numKvHeads == 0);
+        TLLM_CHECK_WITH_INFO(headSize == 64 || headSize == 128, "Sparse KV attention supports head sizes 64 and 128");
+    }
+};
+
+//! \brief Bytes of the block summaries of one layer: [numPoolBlocks, numKvHeads, 2 (min, max), headSize] floats.
+size_t getKvBlockSummariesSize(int32_t numPoolBlocks, int32_t numKvHeads, int32_t headSize);
+
+size_t getSparseKvAttentionWorkspaceSize(
+    int32_t batchSize, int32_t numKvHeads, int32_t maxBlocksPerSeq, int32_t topKBlocks);
+
+//! \brief Recompute the summaries of the blocks holding the last numNewTokens tokens of every sequence, after their K
+//! was written to the cache. Pass numNewTokens = kvLengths to rebuild all summaries of a sequence, e.g. after its
+//! blocks were onboarded from the secondary pool.
+template <typename T>
+void invokeUpdateKvBlockSummaries(
+    SparseKvAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream);
+
+//! \brief Generation attention over the topKBlocks most relevant blocks of every sequence and KV head.
+//! \details A first kernel bounds the score of every block from its summary, takes the maximum over the query heads of
+//! the KV head and keeps the sink blocks, the block of the generation token and the best other blocks. A second
+//! kernel attends the tokens of the selected blocks exactly, so the KV cache read per step is bounded by topKBlocks
+//! blocks instead of growing with the context. The KV cache must hold T, without quantization, beam search or cyclic
+//! window, and all blocks of the batch must be in the primary pool with up to date summaries.
+template <typename T>
+void invokeSparseKvAttention(
+    SparseKvAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -1470,13 +1470,13 @@ void invokeSetTopKsFromDyanmicTreeMaxTopK(SizeType32 layerIdx, SizeType32 batchS
 
 namespace
 {
-__global__ void copyScoresAndDraftTokenIds(SizeType32 layerIdx, SizeType32 mNumEagleLayers,
-    SizeType32 maxDecodingDraftTokens, SizeType32 batchSize, SizeType32 const dynamicTreeMaxTopK,
-    SizeType32* topKOffset, TokenIdType const* pluginInputCurrentExpandIndices, float const* pluginInputAllLayersScores,
+__device__ void copyRequestScoresAndDraftTokenIds(SizeType32 bix, SizeType32 layerIdx, SizeType32 mNumEagleLayers,
+    SizeType32 maxDecodingDraftTokens, SizeType32 const dynamicTreeMaxTopK,
+    TokenIdType const* pluginInputCurrentExpandIndices, float const* pluginInputAllLayersScores,
     TokenIdType const* pluginInputAllLayersDraftTokenIds,
     TokenIdType const* pluginInputAllLayersDraftTokenIdsPredecessor, float* pluginOutputAllLayersScores,
     TokenIdType* pluginOutputAllLayersDraftTokenIds, TokenIdType* pluginOutputAllLayersDraftTokenIdsPredecessor,
-    float* firstTopKOutputLogProbs, TokenIdType* firstTopKOutputIds)
+    float const* firstTopKOutputLogProbs, TokenIdType const* firstTopKOutputIds)
 {
     // topKOffset: [batchSize]
     // pluginInputCurrentExpandIndices: [batchSize, maxDecodingDraftTokens]
@@ -1492,64 +1492,78 @@ __global__ void copyScoresAndDraftTokenIds(SizeType32 layerIdx, SizeType32 mNumE
 
     // firstTopKOutputLogProbs: [numInputLogits, maxDecodingDraftTokens]
     // firstTopKOutputIds: [numInputLogits, maxDecodingDraftTokens]
+    auto pluginInputCurrentExpandIndicesPtr = pluginInputCurrentExpandIndices + bix * maxDecodingDraftTokens;
+    auto pluginInputAllLayersScoresPtr
+        = pluginInputAllLayersScores + bix * mNumEagleLayers * maxDecodingDraftTokens * maxDecodingDraftTokens;
+    auto pluginInputAllLayersDraftTokenIdsPtr = pluginInputAllLayersDraftTokenIds
+        + bix * mNumEagleLayers * maxDecodingDraftTokens * maxDecodingDraftTokens;
+    auto pluginInputAllLayersDraftTokenIdsPredecessorPtr = pluginInputAllLayersDraftTokenIdsPredecessor
+        + bix * mNumEagleLayers * maxDecodingDraftTokens * maxDecodingDraftTokens;
+
+    auto pluginOutputAllLayersScoresPtr
+        = pluginOutputAllLayersScores + bix * mNumEagleLayers * maxDecodingDraftTokens * maxDecodingDraftTokens;
+    auto pluginOutputAllLayersDraftTokenIdsPtr = pluginOutputAllLayersDraftTokenIds
+        + bix * mNumEagleLayers * maxDecodingDraftTokens * maxDecodingDraftTokens;
+    auto pluginOutputAllLayersDraftTokenIdsPredecessorPtr = pluginOutputAllLayersDraftTokenIdsPredecessor
+        + bix * mNumEagleLayers * maxDecodingDraftTokens * maxDecodingDraftTokens;
+
+    // When layerIdx == 0, firstTopKOutputLogProbs/firstTopKOutputIds shape: [batchSize, maxDecodingDraftTokens]
+    // When layerIdx > 0, firstTopKOutputLogProbs/firstTopKOutputIds shape: [batchSize * dynamicTreeMaxTopK,
+    // maxDecodingDraftTokens]
+    auto firstTopKOutputOffset = layerIdx == 0 ? 1 : dynamicTreeMaxTopK;
+    auto firstTopKOutputLogProbsPtr
+        = firstTopKOutputLogProbs + bix * firstTopKOutputOffset * maxDecodingDraftTokens;
+    auto firstTopKOutputIdsPtr = firstTopKOutputIds + bix * firstTopKOutputOffset * maxDecodingDraftTokens;
 
-    auto const bix = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
-    if (bix < batchSize)
-    {
-        auto pluginInputCurrentExpandIndicesPtr = pluginInputCurrentExpandIndices + bix * maxDecodingDraftTokens;
-        auto pluginInputAllLayersScoresPtr
-            = pluginInputAllLayersScores + bix * mNumEagleLayers * maxDecodingDraftTokens * maxDecodingDraftTokens;
-        auto pluginInputAllLayersDraftTokenIdsPtr = pluginInputAllLayersDraftTokenIds
-            + bix * mNumEagleLayers * maxDecodingDraftTokens * maxDecodingDraftTokens;
-        auto pluginInputAllLayersDraftTokenIdsPredecessorPtr = pluginInputAllLayersDraftTokenIdsPredecessor
-            + bix * mNumEagleLayers * maxDecodingDraftTokens * maxDecodingDraftTokens;
-
-        auto pluginOutputAllLayersScoresPtr
-            = pluginOutputAllLayersScores + bix * mNumEagleLayers * maxDecodingDraftTokens * maxDecodingDraftTokens;
-        auto pluginOutputAllLayersDraftTokenIdsPtr = pluginOutputAllLayersDraftTokenIds
-            + bix * mNumEagleLayers * maxDecodingDraftTokens * maxDecodingDraftTokens;
-        auto pluginOutputAllLayersDraftTokenIdsPredecessorPtr = pluginOutputAllLayersDraftTokenIdsPredecessor
-            + bix * mNumEagleLayers * maxDecodingDraftTokens * maxDecodingDraftTokens;
-
-        // When layerIdx == 0, firstTopKOutputLogProbs/firstTopKOutputIds shape: [batchSize, maxDecodingDraftTokens]
-        // When layerIdx > 0, firstTopKOutputLogProbs/firstTopKOutputIds shape: [batchSize * dynamicTreeMaxTopK,
-        // maxDecodingDraftTokens]
-        auto firstTopKOutputOffset = layerIdx == 0 ? 1 : dynamicTreeMaxTopK;
-        auto firstTopKOutputLogProbsPtr
-            = firstTopKOutputLogProbs + bix * firstTopKOutputOffset * maxDecodingDraftTokens;
-        auto firstTopKOutputIdsPtr = firstTopKOutputIds + bix * firstTopKOutputOffset * maxDecodingDraftTokens;
+    // We save the scores and draft tokensIds continuously
+    auto startOffset
+        = layerIdx == 0 ? 0 : (layerIdx - 1) * (dynamicTreeMaxTopK * dynamicTreeMaxTopK) + dynamicTreeMaxTopK;
 
-        // We save the scores and draft tokensIds continuously
-        auto startOffset
-            = layerIdx == 0 ? 0 : (layerIdx - 1) * (dynamicTreeMaxTopK * dynamicTreeMaxTopK) + dynamicTreeMaxTopK;
+    // 1) Copy all the previous scores and draft tokenIds from plugin input to plugin output
+    for (SizeType32 ii = 0; ii < startOffset; ++ii)
+    {
+        pluginOutputAllLayersScoresPtr[ii] = pluginInputAllLayersScoresPtr[ii];
+        pluginOutputAllLayersDraftTokenIdsPtr[ii] = pluginInputAllLayersDraftTokenIdsPtr[ii];
+        pluginOutputAllLayersDraftTokenIdsPredecessorPtr[ii] = pluginInputAllLayersDraftTokenIdsPredecessorPtr[ii];
+    }
 
-        // 1) Copy all the previous scores and draft tokenIds from plugin input to plugin output
-        for (SizeType32 ii = 0; ii < startOffset; ++ii)
+    // 2) Copy this layer's scores and draft tokenIds
+    // When layerIdx == 0, we only need to save dynamicTreeMaxTopK scores/draft tokens
+    // When layerIdx > 0, we need to save dynamicTreeMaxTopK * dynamicTreeMaxTopK scores/draft tokens
+    auto numExpandTokens = layerIdx == 0 ? 1 : dynamicTreeMaxTopK;
+    for (SizeType32 ii = 0; ii < numExpandTokens; ++ii)
+    {
+        for (SizeType32 jj = 0; jj < dynamicTreeMaxTopK; ++jj)
         {
-            pluginOutputAllLayersScoresPtr[ii] = pluginInputAllLayersScoresPtr[ii];
-            pluginOutputAllLayersDraftTokenIdsPtr[ii] = pluginInputAllLayersDraftTokenIdsPtr[ii];
-            pluginOutputAllLayersDraftTokenIdsPredecessorPtr[ii] = pluginInputAllLayersDraftTokenIdsPredecessorPtr[ii];
+            pluginOutputAllLayersScoresPtr[startOffset]
+                = firstTopKOutputLogProbsPtr[ii * maxDecodingDraftTokens + jj];
+            pluginOutputAllLayersDraftTokenIdsPtr[startOffset]
+                = firstTopKOutputIdsPtr[ii * maxDecodingDraftTokens + jj];
+
+            // Update the predecessor of this draft tokens
+            pluginOutputAllLayersDraftTokenIdsPredecessorPtr[startOffset]
+                = layerIdx == 0 ? 0 : pluginInputCurrentExpandIndicesPtr[ii];
+            startOffset++;
         }
+    }
+}
 
-        // 2) Copy this layer's scores and draft tokenIds
-        // When layerIdx == 0, we only need to save dynamicTreeMaxTopK scores/draft tokens
-        // When layerIdx > 0, we need to save dynamicTreeMaxTopK * dynamicTreeMaxTopK scores/draft tokens
-        auto numExpandTokens = layerIdx == 0 ? 1 : dynamicTreeMaxTopK;
-        for (SizeType32 ii = 0; ii < numExpandTokens; ++ii)
-        {
-            for (SizeType32 jj = 0; jj < dynamicTreeMaxTopK; ++jj)
-            {
-                pluginOutputAllLayersScoresPtr[startOffset]
-                    = firstTopKOutputLogProbsPtr[ii * maxDecodingDraftTokens + jj];
-                pluginOutputAllLayersDraftTokenIdsPtr[startOffset]
-                    = firstTopKOutputIdsPtr[ii * maxDecodingDraftTokens + jj];
-
-                // Update the predecessor of this draft tokens
-                pluginOutputAllLayersDraftTokenIdsPredecessorPtr[startOffset]
-                    = layerIdx == 0 ? 0 : pluginInputCurrentExpandIndicesPtr[ii];
-                startOffset++;
-            }
-        }
+__global__ void copyScoresAndDraftTokenIds(SizeType32 layerIdx, SizeType32 mNumEagleLayers,
+    SizeType32 maxDecodingDraftTokens, SizeType32 batchSize, SizeType32 const dynamicTreeMaxTopK,
+    SizeType32* topKOffset, TokenIdType const* pluginInputCurrentExpandIndices, float const* pluginInputAllLayersScores,
+    TokenIdType const* pluginInputAllLayersDraftTokenIds,
+    TokenIdType const* pluginInputAllLayersDraftTokenIdsPredecessor, float* pluginOutputAllLayersScores,
+    TokenIdType* pluginOutputAllLayersDraftTokenIds, TokenIdType* pluginOutputAllLayersDraftTokenIdsPredecessor,
+    float* firstTopKOutputLogProbs, TokenIdType* firstTopKOutputIds)
+{
+    auto const bix = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
+    if (bix < batchSize)
+    {
+        copyRequestScoresAndDraftTokenIds(bix, layerIdx, mNumEagleLayers, maxDecodingDraftTokens, dynamicTreeMaxTopK,
+            pluginInputCurrentExpandIndices, pluginInputAllLayersScores, pluginInputAllLayersDraftTokenIds,
+            pluginInputAllLayersDraftTokenIdsPredecessor, pluginOutputAllLayersScores,
+            pluginOutputAllLayersDraftTokenIds, pluginOutputAllLayersDraftTokenIdsPredecessor, firstTopKOutputLogProbs,
+            firstTopKOutputIds);
     }
 }
 
@@ -1575,7 +1589,7 @@ void invokeCopyScoresAndDraftTokenIds(SizeType32 layerIdx, SizeType32 mNumEagleL
 
 namespace
 {
-__global__ void updateScores(SizeType32 batchSize, SizeType32 const dynamicTreeMaxTopK,
+__device__ void updateRequestScores(SizeType32 bix, SizeType32 const dynamicTreeMaxTopK,
     SizeType32 maxDecodingDraftTokens, float* curLogProbs, float const* prevLayerScores)
 {
     // We update the current scores (curLogProbs, shape: [batchSize * dynamicTreeMaxTopK, maxDecodingDraftTokens])
@@ -1586,32 +1600,39 @@ __global__ void updateScores(SizeType32 batchSize, SizeType32 const dynamicTreeM
 
     // curLogProbs [numInputLogits(batchSize * dynamicTreeMaxTopK), maxDecodingDraftTokens]
     // prevLayerScores [batchSize, maxDecodingDraftTokens]. for each request, only top 'dynamicTreeMaxTopK' is valuable.
-    auto const bix = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
-    if (bix < batchSize)
-    {
-        // This request's buffer
-        auto prevLayerScoresPtr = prevLayerScores + bix * maxDecodingDraftTokens;
-        auto curLogProbsPtr = curLogProbs + bix * dynamicTreeMaxTopK * maxDecodingDraftTokens;
 
-        for (SizeType32 ii = 0; ii < dynamicTreeMaxTopK; ++ii)
+    // This request's buffer
+    auto prevLayerScoresPtr = prevLayerScores + bix * maxDecodingDraftTokens;
+    auto curLogProbsPtr = curLogProbs + bix * dynamicTreeMaxTopK * maxDecodingDraftTokens;
+
+    for (SizeType32 ii = 0; ii < dynamicTreeMaxTopK; ++ii)
+    {
+        auto curDraftTokenLogProbsPtr = curLogProbsPtr + ii * maxDecodingDraftTokens;
+        auto scoreValue = prevLayerScoresPtr[ii];
+        for (SizeType32 jj = 0; jj < maxDecodingDraftTokens; ++jj)
         {
-            auto curDraftTokenLogProbsPtr = curLogProbsPtr + ii * maxDecodingDraftTokens;
-            auto scoreValue = prevLayerScoresPtr[ii];
-            for (SizeType32 jj = 0; jj < maxDecodingDraftTokens; ++jj)
+            if (jj < dynamicTreeMaxTopK)
             {
-                if (jj < dynamicTreeMaxTopK)
-                {
-                    curDraftTokenLogProbsPtr[jj] += scoreValue;
-                }
-                else
-                {
-                    curDraftTokenLogProbsPtr[jj] = -std::numeric_limits<float>::infinity();
-                }
+                curDraftTokenLogProbsPtr[jj] += scoreValue;
+            }
+            else
+            {
+                curDraftTokenLogProbsPtr[jj] = -std::numeric_limits<float>::infinity();
             }
         }
     }
 }
 
+__global__ void updateScores(SizeType32 batchSize, SizeType32 const dynamicTreeMaxTopK,
+    SizeType32 maxDecodingDraftTokens, float* curLogProbs, float const* prevLayerScores)
+{
+    auto const bix = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
+    if (bix < batchSize)
+    {
+        updateRequestScores(bix, dynamicTreeMaxTopK, maxDecodingDraftTokens, curLogProbs, prevLayerScores);
+    }
+}
+
 } // namespace
 
 void invokeUpdateScores(SizeType32 batchSize, SizeType32 const dynamicTreeMaxTopK, SizeType32 maxDecodingDraftTokens,
@@ -1698,189 +1719,196 @@ inline __device__ SizeType32 findAncestorPathIndex(SizeType32 const* prevPaths,
 namespace
 {
 
-__global__ void updatePath(SizeType32 layerIdx, SizeType32 batchSize, SizeType32 dynamicTreeMaxTopK,
+__device__ void updateRequestPath(SizeType32 bix, SizeType32 layerIdx, SizeType32 dynamicTreeMaxTopK,
     SizeType32 maxDecodingTokens, SizeType32 maxPathLen, SizeType32 const* prevPaths, SizeType32* newPaths,
-    TokenIdType** secondTopKOutputIdsPtrs, TokenIdType* pluginOutputNextExpandIndices)
+    TokenIdType* secondTopKOutputIdsPtr, TokenIdType* pluginOutputNextExpandIndices)
 {
     // prevPaths: [batchSize, maxDecodingTokens, maxPathLen]
     // newPaths: [batchSize, maxDecodingTokens, maxPathLen]
-    // secondTopKOutputIdsPtrs: [batchSize, maxDecodingDraftTokens]
+    // secondTopKOutputIdsPtr: [maxDecodingDraftTokens], this request's outputIds of the second topK sampling
     // pluginOutputNextExpandIndices: [batchSize, maxDecodingDraftTokens]
 
     auto const maxDecodingDraftTokens = maxDecodingTokens - 1;
-    auto const bix = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
     // Considering that the Eagle-2 tree is dynamically changing,
     // we need the logits of the newly expanded nodes instead of treating them as leaves.
     // This value is use to distinguish non-leaf nodes for Eagle-2.
     auto const nonLeafSignal = maxDecodingTokens + 1;
 
-    if (bix < batchSize)
+    auto const prevPathPtr = prevPaths + bix * maxDecodingTokens * maxPathLen;
+    auto const newPathsPtr = newPaths + bix * maxDecodingTokens * maxPathLen;
+    auto const pluginOutputNextExpandIndicesPtr = pluginOutputNextExpandIndices + bix * maxDecodingDraftTokens;
+
+    // Init, all set to -1
+    for (SizeType32 ii = 0; ii < maxDecodingTokens * maxPathLen; ++ii)
     {
-        auto const prevPathPtr = prevPaths + bix * maxDecodingTokens * maxPathLen;
-        auto const newPathsPtr = newPaths + bix * maxDecodingTokens * maxPathLen;
-        auto const pluginOutputNextExpandIndicesPtr = pluginOutputNextExpandIndices + bix * maxDecodingDraftTokens;
+        newPathsPtr[ii] = -1;
+    }
 
-        // Init, all set to -1
-        for (SizeType32 ii = 0; ii < maxDecodingTokens * maxPathLen; ++ii)
+    if (layerIdx == 0)
+    {
+        // layer 0 is simple
+        // Example new paths: [[0, 1, -1, -1], [0, 2, -1, -1], ..., [0, dynamicTreeMaxTopK, -1, -1]]
+        for (SizeType32 ii = 0; ii < dynamicTreeMaxTopK; ++ii)
         {
-            newPathsPtr[ii] = -1;
+            newPathsPtr[ii * maxPathLen + 0] = 0;
+            newPathsPtr[ii * maxPathLen + 1] = ii + 1;
+            // Append nonLeafSignal
+            newPathsPtr[ii * maxPathLen + 2] = nonLeafSignal;
+
+            // When layerIdx == 0, only expand 'dynamicTreeMaxTopK' draft tokens
+            // We '+1' here because we take the root node into consideration
+            pluginOutputNextExpandIndicesPtr[ii] = ii + 1;
         }
-
-        if (layerIdx == 0)
+    }
+    else
+    {
+        // Find how many paths in the previous path
+        SizeType32 prevLayerNumPaths = 0;
+        for (SizeType32 ii = 0; ii < maxDecodingTokens; ++ii)
         {
-            // layer 0 is simple
-            // Example new paths: [[0, 1, -1, -1], [0, 2, -1, -1], ..., [0, dynamicTreeMaxTopK, -1, -1]]
-            for (SizeType32 ii = 0; ii < dynamicTreeMaxTopK; ++ii)
+            // Check the first value of each paths
+            if (prevPathPtr[ii * maxPathLen + 0] != -1)
             {
-                newPathsPtr[ii * maxPathLen + 0] = 0;
-                newPathsPtr[ii * maxPathLen + 1] = ii + 1;
-                // Append nonLeafSignal
-                newPathsPtr[ii * maxPathLen + 2] = nonLeafSignal;
-
-                // When layerIdx == 0, only expand 'dynamicTreeMaxTopK' draft tokens
-                // We '+1' here because we take the root node into consideration
-                pluginOutputNextExpandIndicesPtr[ii] = ii + 1;
+                prevLayerNumPaths++;
             }
-        }
-        else
-        {
-            // Find how many paths in the previous path
-            SizeType32 prevLayerNumPaths = 0;
-            for (SizeType32 ii = 0; ii < maxDecodingTokens; ++ii)
+            else
             {
-                // Check the first value of each paths
-                if (prevPathPtr[ii * maxPathLen + 0] != -1)
-                {
-                    prevLayerNumPaths++;
-                }
-                else
-                {
-                    break;
-                }
+                break;
             }
+        }
 
-            auto secondTopKOutputIdsPtr = secondTopKOutputIdsPtrs[bix];
-
-            // For each request, we will generate 'dynamicTreeMaxTopK' new draft tokens
-            // auto newDraftTokensIdsPtr = secondTopKOutputIdsPtrs[bix];
-            // Sort the outputIds, ascending
-            insertionSortOutputIds(secondTopKOutputIdsPtr, dynamicTreeMaxTopK);
+        // For each request, we will generate 'dynamicTreeMaxTopK' new draft tokens
+        // auto newDraftTokensIdsPtr = secondTopKOutputIdsPtrs[bix];
+        // Sort the outputIds, ascending
+        insertionSortOutputIds(secondTopKOutputIdsPtr, dynamicTreeMaxTopK);
 
-            // Update the selected draft tokens to the pluginOutputNextExpandIndices
-            // Exclude the root node
-            SizeType32 offsetToTheFinalTree = layerIdx == 1
-                ? dynamicTreeMaxTopK + 1
-                : (layerIdx - 1) * dynamicTreeMaxTopK * dynamicTreeMaxTopK + dynamicTreeMaxTopK + 1;
-            for (SizeType32 ii = 0; ii < dynamicTreeMaxTopK; ++ii)
-            {
-                SizeType32 rowIdx = secondTopKOutputIdsPtr[ii] / maxDecodingDraftTokens;
-                SizeType32 columnIdx = secondTopKOutputIdsPtr[ii] % maxDecodingDraftTokens;
+        // Update the selected draft tokens to the pluginOutputNextExpandIndices
+        // Exclude the root node
+        SizeType32 offsetToTheFinalTree = layerIdx == 1
+            ? dynamicTreeMaxTopK + 1
+            : (layerIdx - 1) * dynamicTreeMaxTopK * dynamicTreeMaxTopK + dynamicTreeMaxTopK + 1;
+        for (SizeType32 ii = 0; ii < dynamicTreeMaxTopK; ++ii)
+        {
+            SizeType32 rowIdx = secondTopKOutputIdsPtr[ii] / maxDecodingDraftTokens;
+            SizeType32 columnIdx = secondTopKOutputIdsPtr[ii] % maxDecodingDraftTokens;
 
-                pluginOutputNextExpandIndicesPtr[ii] = rowIdx * dynamicTreeMaxTopK + columnIdx + offsetToTheFinalTree;
-            }
+            pluginOutputNextExpandIndicesPtr[ii] = rowIdx * dynamicTreeMaxTopK + columnIdx + offsetToTheFinalTree;
+        }
 
-            // The start index of the node in this layer
-            auto const startIndexOfCurrentLayer = layerIdx * dynamicTreeMaxTopK + 1;
-            // The start index of the node in previous layer
-            auto const startIndexOfPreviousLayer = startIndexOfCurrentLayer - dynamicTreeMaxTopK;
+        // The start index of the node in this layer
+        auto const startIndexOfCurrentLayer = layerIdx * dynamicTreeMaxTopK + 1;
+        // The start index of the node in previous layer
+        auto const startIndexOfPreviousLayer = startIndexOfCurrentLayer - dynamicTreeMaxTopK;
 
-            // Record the index of path that had been used to expand in this layer
-            SizeType32 usedPrevLayerPathsIndex = -1;
+        // Record the index of path that had been used to expand in this layer
+        SizeType32 usedPrevLayerPathsIndex = -1;
 
-            SizeType32 numNewPath = 0;
-            for (SizeType32 ii = 0; ii < dynamicTreeMaxTopK; ++ii)
-            {
-                // This draft token's new index in the whole tree
-                SizeType32 newIndex = ii + startIndexOfCurrentLayer;
-                // Find this draft token's ancestor node
-                SizeType32 ancestorIndex
-                    = secondTopKOutputIdsPtr[ii] / maxDecodingDraftTokens + startIndexOfPreviousLayer;
-
-                // Find the path index in the previous path that take this ancestor node as the leaf node
-                SizeType32 ancestorPathIdxInPrevPaths
-                    = findAncestorPathIndex(prevPathPtr, ancestorIndex, layerIdx - 1, maxDecodingTokens, maxPathLen);
-
-                // The correct 'ancestorPathIdxInPrevPaths' must be:
-                // 1) ancestorPathIdxInPrevPaths == usedPrevLayerPathsIndex: continue to expand this path
-                // 2) ancestorPathIdxInPrevPaths > usedPrevLayerPathsIndex:
-                //       2.1) ancestorPathIdxInPrevPaths == usedPrevLayerPathsIndex + 1: expand a new path,
-                //            next to the previous one.
-                //       2.2) ancestorPathIdxInPrevPaths > usedPrevLayerPathsIndex + 1: there are multiple
-                //            path that do not have leaf at this layer, but we need to include as well.
+        SizeType32 numNewPath = 0;
+        for (SizeType32 ii = 0; ii < dynamicTreeMaxTopK; ++ii)
+        {
+            // This draft token's new index in the whole tree
+            SizeType32 newIndex = ii + startIndexOfCurrentLayer;
+            // Find this draft token's ancestor node
+            SizeType32 ancestorIndex
+                = secondTopKOutputIdsPtr[ii] / maxDecodingDraftTokens + startIndexOfPreviousLayer;
+
+            // Find the path index in the previous path that take this ancestor node as the leaf node
+            SizeType32 ancestorPathIdxInPrevPaths
+                = findAncestorPathIndex(prevPathPtr, ancestorIndex, layerIdx - 1, maxDecodingTokens, maxPathLen);
+
+            // The correct 'ancestorPathIdxInPrevPaths' must be:
+            // 1) ancestorPathIdxInPrevPaths == usedPrevLayerPathsIndex: continue to expand this path
+            // 2) ancestorPathIdxInPrevPaths > usedPrevLayerPathsIndex:
+            //       2.1) ancestorPathIdxInPrevPaths == usedPrevLayerPathsIndex + 1: expand a new path,
+            //            next to the previous one.
+            //       2.2) ancestorPathIdxInPrevPaths > usedPrevLayerPathsIndex + 1: there are multiple
+            //            path that do not have leaf at this layer, but we need to include as well.
 #ifdef TLLM_DEBUG_MODE
-                if (ancestorPathIdxInPrevPaths == -1 || ancestorPathIdxInPrevPaths < usedPrevLayerPathsIndex)
-                {
-                    // Throw error when can not find ancestor's path.
-                    // Or ancestorPath had been finish expand.
-                    printf(
-                        "Throw error from updatePath kernel: bix: %d can not find the correct ancestorPath of "
-                        "ancestorIndex: %d in layerIdx: %d, usedPrevLayerPathsIndex: %d, "
-                        "ancestorPathIdxInPrevPaths:%d\n",
-                        bix, ancestorIndex, layerIdx - 1, usedPrevLayerPathsIndex, ancestorPathIdxInPrevPaths);
-                    asm volatile("brkpt;\n");
-                }
+            if (ancestorPathIdxInPrevPaths == -1 || ancestorPathIdxInPrevPaths < usedPrevLayerPathsIndex)
+            {
+                // Throw error when can not find ancestor's path.
+                // Or ancestorPath had been finish expand.
+                printf(
+                    "Throw error from updatePath kernel: bix: %d can not find the correct ancestorPath of "
+                    "ancestorIndex: %d in layerIdx: %d, usedPrevLayerPathsIndex: %d, "
+                    "ancestorPathIdxInPrevPaths:%d\n",
+                    bix, ancestorIndex, layerIdx - 1, usedPrevLayerPathsIndex, ancestorPathIdxInPrevPaths);
+                asm volatile("brkpt;\n");
+            }
 #endif // TLLM_DEBUG_MODE
 
-                if (ancestorPathIdxInPrevPaths == usedPrevLayerPathsIndex + 1)
+            if (ancestorPathIdxInPrevPaths == usedPrevLayerPathsIndex + 1)
+            {
+                // Expand a new path, just behind the previous one.
+                usedPrevLayerPathsIndex++;
+            }
+            else if (ancestorPathIdxInPrevPaths > usedPrevLayerPathsIndex + 1)
+            {
+                // There are multiple path that will not be expand in this layer.
+                // But we also need to include them, since they are part of the tree.
+                while (ancestorPathIdxInPrevPaths > usedPrevLayerPathsIndex + 1)
                 {
-                    // Expand a new path, just behind the previous one.
+                    // Insert the paths that do not have leaf in this layer
                     usedPrevLayerPathsIndex++;
-                }
-                else if (ancestorPathIdxInPrevPaths > usedPrevLayerPathsIndex + 1)
-                {
-                    // There are multiple path that will not be expand in this layer.
-                    // But we also need to include them, since they are part of the tree.
-                    while (ancestorPathIdxInPrevPaths > usedPrevLayerPathsIndex + 1)
+                    // We do not need to copy the whole paths (i.e., maxPathLen) that do not expand in this layer.
+                    // We only need to copy top 'layerIdx + 1' value for these path.
+                    // The paths that do not expand will have 'layerIdx + 1' valid steps at most.
+                    // '+1' is for the root node.
+                    // This prevents us from copying nonLeafSignal as well.
+                    for (SizeType32 jj = 0; jj <= layerIdx; jj++)
                     {
-                        // Insert the paths that do not have leaf in this layer
-                        usedPrevLayerPathsIndex++;
-                        // We do not need to copy the whole paths (i.e., maxPathLen) that do not expand in this layer.
-                        // We only need to copy top 'layerIdx + 1' value for these path.
-                        // The paths that do not expand will have 'layerIdx + 1' valid steps at most.
-                        // '+1' is for the root node.
-                        // This prevents us from copying nonLeafSignal as well.
-                        for (SizeType32 jj = 0; jj <= layerIdx; jj++)
-                        {
-                            newPathsPtr[numNewPath * maxPathLen + jj]
-                                = prevPathPtr[usedPrevLayerPathsIndex * maxPathLen + jj];
-                        }
-                        numNewPath++;
+                        newPathsPtr[numNewPath * maxPathLen + jj]
+                            = prevPathPtr[usedPrevLayerPathsIndex * maxPathLen + jj];
                     }
-                    usedPrevLayerPathsIndex++; // Point to the path that we will expand this time.
+                    numNewPath++;
                 }
+                usedPrevLayerPathsIndex++; // Point to the path that we will expand this time.
+            }
 
-                // Expand the path
-                // Copy the original path
-                for (SizeType32 jj = 0; jj <= layerIdx; ++jj)
-                {
-                    newPathsPtr[numNewPath * maxPathLen + jj]
-                        = prevPathPtr[ancestorPathIdxInPrevPaths * maxPathLen + jj];
-                }
-                // Add this layer's new draft token
-                newPathsPtr[numNewPath * maxPathLen + layerIdx + 1] = newIndex;
-                // Append the nonLeafSignal
-                // 'layerIdx + 1 + 1' is always small than maxPathLen,
-                // because the last layer of EagleNet will not execute the logic here.
-                // Example: numEagleNets = 4, maxPathLen = 5, layerIdx [0, 3]
-                // The layerIdx range that will execute this logic is [1, 2]
-                newPathsPtr[numNewPath * maxPathLen + layerIdx + 1 + 1] = nonLeafSignal;
-                numNewPath++;
+            // Expand the path
+            // Copy the original path
+            for (SizeType32 jj = 0; jj <= layerIdx; ++jj)
+            {
+                newPathsPtr[numNewPath * maxPathLen + jj]
+                    = prevPathPtr[ancestorPathIdxInPrevPaths * maxPathLen + jj];
             }
+            // Add this layer's new draft token
+            newPathsPtr[numNewPath * maxPathLen + layerIdx + 1] = newIndex;
+            // Append the nonLeafSignal
+            // 'layerIdx + 1 + 1' is always small than maxPathLen,
+            // because the last layer of EagleNet will not execute the logic here.
+            // Example: numEagleNets = 4, maxPathLen = 5, layerIdx [0, 3]
+            // The layerIdx range that will execute this logic is [1, 2]
+            newPathsPtr[numNewPath * maxPathLen + layerIdx + 1 + 1] = nonLeafSignal;
+            numNewPath++;
+        }
 
-            // Insert the paths that do not have leaf in this layer
-            while (usedPrevLayerPathsIndex < prevLayerNumPaths)
+        // Insert the paths that do not have leaf in this layer
+        while (usedPrevLayerPathsIndex < prevLayerNumPaths)
+        {
+            usedPrevLayerPathsIndex++;
+            for (SizeType32 jj = 0; jj <= layerIdx; jj++)
             {
-                usedPrevLayerPathsIndex++;
-                for (SizeType32 jj = 0; jj <= layerIdx; jj++)
-                {
-                    newPathsPtr[numNewPath * maxPathLen + jj] = prevPathPtr[usedPrevLayerPathsIndex * maxPathLen + jj];
-                }
-                numNewPath++;
+                newPathsPtr[numNewPath * maxPathLen + jj] = prevPathPtr[usedPrevLayerPathsIndex * maxPathLen + jj];
             }
+            numNewPath++;
         }
     }
 }
 
+__global__ void updatePath(SizeType32 layerIdx, SizeType32 batchSize, SizeType32 dynamicTreeMaxTopK,
+    SizeType32 maxDecodingTokens, SizeType32 maxPathLen, SizeType32 const* prevPaths, SizeType32* newPaths,
+    TokenIdType** secondTopKOutputIdsPtrs, TokenIdType* pluginOutputNextExpandIndices)
+{
+    auto const bix = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
+    if (bix < batchSize)
+    {
+        // secondTopKOutputIdsPtrs is nullptr at layer 0.
+        updateRequestPath(bix, layerIdx, dynamicTreeMaxTopK, maxDecodingTokens, maxPathLen, prevPaths, newPaths,
+            layerIdx == 0 ? nullptr : secondTopKOutputIdsPtrs[bix], pluginOutputNextExpandIndices);
+    }
+}
+
 } // namespace
 
 void invokeUpdatePath(SizeType32 layerIdx, SizeType32 batchSize, SizeType32 dynamicTreeMaxTopK,
@@ -1898,60 +1926,64 @@ void invokeUpdatePath(SizeType32 layerIdx, SizeType32 batchSize, SizeType32 dyna
 namespace
 {
 
-__global__ void updateDraftTokensAndLensAndCurScores(SizeType32 layerIdx, SizeType32 batchSize,
-    SizeType32 dynamicTreeMaxTopK, SizeType32 maxDecodingDraftTokens, TokenIdType** curDraftIds,
+__device__ void updateRequestDraftTokensAndLensAndCurScores(SizeType32 bix, SizeType32 layerIdx,
+    SizeType32 dynamicTreeMaxTopK, SizeType32 maxDecodingDraftTokens, TokenIdType const* curDraftIds,
     TokenIdType const* pluginInputDraftIds, SizeType32 const* pluginInputDraftLens, TokenIdType* pluginOutputDraftIds,
     SizeType32* pluginOutputDraftLens, float const* curLayerScores, float* pluginOutputCurrentScores)
 {
-    // curDraftIds: shape [batchSize][maxDecodingDraftTokens]
+    // curDraftIds: shape [maxDecodingDraftTokens], this request's draft tokens of this layer
     // pluginInputDraftIds: shape [batchSize, maxDecodingDraftTokens]
     // pluginInputDraftLens: shape [batchSize]
     // pluginOutputDraftIds: shape [batchSize, maxDecodingDraftTokens]
     // pluginOutputDraftLens: shape [batchSize]
     // curLayerScores: shape [batchSize, maxDecodingDraftTokens]
     // pluginOutputCurrentScores: shape [batchSize, maxDecodingDraftTokens]
+    // 1) Update draft tokenIds and draft lengths
+    // Output draft token ids offset
+    TokenIdType* curPluginOutputDraftIdsPtr = pluginOutputDraftIds + bix * maxDecodingDraftTokens;
+    TokenIdType const* indicescurPluginInputDraftIdsPtr = pluginInputDraftIds + bix * maxDecodingDraftTokens;
 
-    auto const bix = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
-    if (bix < batchSize)
-    {
-        // 1) Update draft tokenIds and draft lengths
-        // Output draft token ids offset
-        TokenIdType* curPluginOutputDraftIdsPtr = pluginOutputDraftIds + bix * maxDecodingDraftTokens;
-        TokenIdType const* indicescurPluginInputDraftIdsPtr = pluginInputDraftIds + bix * maxDecodingDraftTokens;
-
-        // The length of the existing draft token
-        SizeType32 prevLen = layerIdx == 0 ? 0 : pluginInputDraftLens[bix];
+    // The length of the existing draft token
+    SizeType32 prevLen = layerIdx == 0 ? 0 : pluginInputDraftLens[bix];
 
-        // Copy exist tokens
-        for (SizeType32 ii = 0; ii < prevLen; ii++)
-        {
-            curPluginOutputDraftIdsPtr[ii] = indicescurPluginInputDraftIdsPtr[ii];
-        }
+    // Copy exist tokens
+    for (SizeType32 ii = 0; ii < prevLen; ii++)
+    {
+        curPluginOutputDraftIdsPtr[ii] = indicescurPluginInputDraftIdsPtr[ii];
+    }
 
-        SizeType32 curLen = prevLen;
+    SizeType32 curLen = prevLen;
 
-        SizeType32 startTopKOffset = bix;
-        SizeType32 endTopkOffset = bix + 1;
+    for (SizeType32 jj = 0; jj < dynamicTreeMaxTopK; jj++)
+    {
+        curPluginOutputDraftIdsPtr[curLen] = curDraftIds[jj];
+        curLen++;
+    }
 
-        for (SizeType32 ii = startTopKOffset; ii < endTopkOffset; ii++)
-        {
-            for (SizeType32 jj = 0; jj < dynamicTreeMaxTopK; jj++)
-            {
-                curPluginOutputDraftIdsPtr[curLen] = curDraftIds[ii][jj];
-                curLen++;
-            }
-        }
+    // Update the output draft token length of this request
+    pluginOutputDraftLens[bix] = curLen;
 
-        // Update the output draft token length of this request
-        pluginOutputDraftLens[bix] = curLen;
+    // 2) Update this layer's scores
+    auto const* curLayerScoresPtr = curLayerScores + bix * maxDecodingDraftTokens;
+    auto pluginOutputCurrentScoresPtr = pluginOutputCurrentScores + bix * maxDecodingDraftTokens;
+    for (SizeType32 ii = 0; ii < maxDecodingDraftTokens; ii++)
+    {
+        pluginOutputCurrentScoresPtr[ii] = curLayerScoresPtr[ii];
+    }
+}
 
-        // 2) Update this layer's scores
-        auto const* curLayerScoresPtr = curLayerScores + bix * maxDecodingDraftTokens;
-        auto pluginOutputCurrentScoresPtr = pluginOutputCurrentScores + bix * maxDecodingDraftTokens;
-        for (SizeType32 ii = 0; ii < maxDecodingDraftTokens; ii++)
-        {
-            pluginOutputCurrentScoresPtr[ii] = curLayerScoresPtr[ii];
-        }
+__global__ void updateDraftTokensAndLensAndCurScores(SizeType32 layerIdx, SizeType32 batchSize,
+    SizeType32 dynamicTreeMaxTopK, SizeType32 maxDecodingDraftTokens, TokenIdType** curDraftIds,
+    TokenIdType const* pluginInputDraftIds, SizeType32 const* pluginInputDraftLens, TokenIdType* pluginOutputDraftIds,
+    SizeType32* pluginOutputDraftLens, float const* curLayerScores, float* pluginOutputCurrentScores)
+{
+    // curDraftIds: shape [batchSize][maxDecodingDraftTokens]
+    auto const bix = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
+    if (bix < batchSize)
+    {
+        updateRequestDraftTokensAndLensAndCurScores(bix, layerIdx, dynamicTreeMaxTopK, maxDecodingDraftTokens,
+            curDraftIds[bix], pluginInputDraftIds, pluginInputDraftLens, pluginOutputDraftIds, pluginOutputDraftLens,
+            curLayerScores, pluginOutputCurrentScores);
     }
 }
 } // namespace
@@ -1972,35 +2004,39 @@ void invokeUpdateDraftTokensAndLensAndCurScores(SizeType32 layerIdx, SizeType32
 
 namespace
 {
+__device__ void extractRequestScoresAndRealDraftTokensIds(SizeType32 bix, SizeType32 dynamicTreeMaxTopK,
+    SizeType32 maxDecodingDraftTokens, float const* secondTopKInputScoresPtr, TokenIdType* secondTopKOutputIdsPtr,
+    TokenIdType const* firstTopKOutputIds, float* secondTopKOutputLogProbs)
+{
+    // secondTopKInputScoresPtr: shape [dynamicTreeMaxTopK * maxDecodingDraftTokens], this request's scores
+    // secondTopKOutputIdsPtr: shape [maxDecodingDraftTokens], this request's outputIds of the second topK sampling
+    // firstTopKOutputIds: shape [batchSize * dynamicTreeMaxTopK * maxDecodingDraftTokens]
+    // secondTopKOutputLogProbs: shape [batchSize, maxDecodingDraftTokens]
+    auto secondTopKOutputLogProbsPtr = secondTopKOutputLogProbs + bix * maxDecodingDraftTokens;
+    auto firstTopKOutputIdsPtr = firstTopKOutputIds + bix * dynamicTreeMaxTopK * maxDecodingDraftTokens;
+    for (SizeType32 ii = 0; ii < dynamicTreeMaxTopK; ii++)
+    {
+        auto row = secondTopKOutputIdsPtr[ii] / maxDecodingDraftTokens;
+        auto column = secondTopKOutputIdsPtr[ii] % maxDecodingDraftTokens;
+
+        // Extract scores
+        secondTopKOutputLogProbsPtr[ii] = secondTopKInputScoresPtr[row * maxDecodingDraftTokens + column];
+        // Extract real draft tokenIds
+        secondTopKOutputIdsPtr[ii] = firstTopKOutputIdsPtr[row * maxDecodingDraftTokens + column];
+    }
+}
+
 __global__ void extractScoresAndRealDraftTokensIds(SizeType32 batchSize, SizeType32 dynamicTreeMaxTopK,
     SizeType32 maxDecodingDraftTokens, float** secondTopKInputScoresPtrs, TokenIdType** secondTopKOutputIdsPtrs,
     TokenIdType* firstTopKOutputIds, float* secondTopKOutputLogProbs)
 {
     // secondTopKInputScoresPtrs: shape [batchSize][dynamicTreeMaxTopK * maxDecodingDraftTokens]
     // secondTopKOutputIdsPtrs: shape [batchSize][maxDecodingDraftTokens]
-    // firstTopKOutputIds: shape [batchSize * dynamicTreeMaxTopK * maxDecodingDraftTokens]
-    // secondTopKOutputLogProbs: shape [batchSize, maxDecodingDraftTokens]
-
     auto const bix = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
     if (bix < batchSize)
     {
-
-        auto secondTopKOutputLogProbsPtr = secondTopKOutputLogProbs + bix * maxDecodingDraftTokens;
-        auto firstTopKOutputIdsPtr = firstTopKOutputIds + bix * dynamicTreeMaxTopK * maxDecodingDraftTokens;
-        for (SizeType32 ii = 0; ii < dynamicTreeMaxTopK; ii++)
-        {
-            // auto selectIndex = secondTopKOutputIdsPtrs[bix][ii];
-            // auto selectScore = secondTopKInputScoresPtrs[bix][selectIndex];
-            // secondTopKOutputLogProbsPtr[ii] = selectScore;
-
-            auto row = secondTopKOutputIdsPtrs[bix][ii] / maxDecodingDraftTokens;
-            auto column = secondTopKOutputIdsPtrs[bix][ii] % maxDecodingDraftTokens;
-
-            // Extract scores
-            secondTopKOutputLogProbsPtr[ii] = secondTopKInputScoresPtrs[bix][row * maxDecodingDraftTokens + column];
-            // Extract real draft tokenIds
-            secondTopKOutputIdsPtrs[bix][ii] = firstTopKOutputIdsPtr[row * maxDecodingDraftTokens + column];
-        }
+        extractRequestScoresAndRealDraftTokensIds(bix, dynamicTreeMaxTopK, maxDecodingDraftTokens,
+            secondTopKInputScoresPtrs[bix], secondTopKOutputIdsPtrs[bix], firstTopKOutputIds, secondTopKOutputLogProbs);
     }
 }
 
@@ -2339,4 +2375,97 @@ void invokeCopyFinalDraftTokens(SizeType32 batchSize, SizeType32 const dynamicTr
     sync_check_cuda_error();
 }
 
+namespace
+{
+
+// Writes the indices of the dynamicTreeMaxTopK highest scores among the dynamicTreeMaxTopK * dynamicTreeMaxTopK
+// candidates of a request to outputIds, in descending order of the scores as the second topK sampling does.
+// Equal scores are taken in ascending order of their indices.
+__device__ void selectTopKScores(float const* scores, SizeType32 dynamicTreeMaxTopK,
+    SizeType32 maxDecodingDraftTokens, TokenIdType* outputIds)
+{
+    // scores: [dynamicTreeMaxTopK, maxDecodingDraftTokens], only the first dynamicTreeMaxTopK columns are candidates.
+    // The k-th selected candidate is the best one after the (k-1)-th in the order (score desc, index asc). There are
+    // few candidates, so they are scanned again for every selection instead of being sorted.
+    float prevScore = std::numeric_limits<float>::infinity();
+    SizeType32 prevIdx = -1;
+    for (SizeType32 ki = 0; ki < dynamicTreeMaxTopK; ++ki)
+    {
+        float bestScore = -std::numeric_limits<float>::infinity();
+        SizeType32 bestIdx = -1;
+        for (SizeType32 ii = 0; ii < dynamicTreeMaxTopK; ++ii)
+        {
+            for (SizeType32 jj = 0; jj < dynamicTreeMaxTopK; ++jj)
+            {
+                auto const idx = ii * maxDecodingDraftTokens + jj;
+                auto const score = scores[idx];
+                bool const afterPrev = score < prevScore || (score == prevScore && idx > prevIdx);
+                if (afterPrev && (bestIdx == -1 || score > bestScore))
+                {
+                    bestScore = score;
+                    bestIdx = idx;
+                }
+            }
+        }
+        outputIds[ki] = bestIdx;
+        prevScore = bestScore;
+        prevIdx = bestIdx;
+    }
+}
+
+__global__ void dynamicTreeLayerUpdate(DynamicTreeLayerUpdateParams params)
+{
+    auto const bix = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
+    if (bix >= params.batchSize)
+    {
+        return;
+    }
+
+    auto const layerIdx = params.layerIdx;
+    auto const dynamicTreeMaxTopK = params.dynamicTreeMaxTopK;
+    auto const maxDecodingDraftTokens = params.maxDecodingTokens - 1;
+
+    // 1) cu_scores = topk_p + scores[:, None], as invokeUpdateScores.
+    updateRequestScores(
+        bix, dynamicTreeMaxTopK, maxDecodingDraftTokens, params.firstTopKOutputLogProbs, params.inputPrevScores);
+
+    // 2) The second topK among the dynamicTreeMaxTopK x dynamicTreeMaxTopK candidates of this request.
+    auto const* scoresPtr = params.firstTopKOutputLogProbs + bix * dynamicTreeMaxTopK * maxDecodingDraftTokens;
+    auto* selectedIdsPtr = params.secondTopKOutputIds + bix * maxDecodingDraftTokens;
+    selectTopKScores(scoresPtr, dynamicTreeMaxTopK, maxDecodingDraftTokens, selectedIdsPtr);
+
+    // 3) Save this layer's scores and draft tokens with their predecessors.
+    copyRequestScoresAndDraftTokenIds(bix, layerIdx, params.numEagleLayers, maxDecodingDraftTokens, dynamicTreeMaxTopK,
+        params.inputCurrentExpandIndices, params.inputAllLayersScores, params.inputAllLayersDraftTokenIds,
+        params.inputAllLayersDraftTokenIdsPredecessor, params.outputAllLayersScores,
+        params.outputAllLayersDraftTokenIds, params.outputAllLayersDraftTokenIdsPredecessor,
+        params.firstTopKOutputLogProbs, params.firstTopKOutputIds);
+
+    // 4) The last layer reconstructs the paths from all layers, the other ones grow the previous paths.
+    if (layerIdx != params.numEagleLayers - 1)
+    {
+        updateRequestPath(bix, layerIdx, dynamicTreeMaxTopK, params.maxDecodingTokens, params.maxPathLen,
+            params.inputPaths, params.outputPaths, selectedIdsPtr, params.outputNextExpandIndices);
+    }
+
+    // 5) Replace the selected indices by the real draft tokenIds and gather their scores.
+    extractRequestScoresAndRealDraftTokensIds(bix, dynamicTreeMaxTopK, maxDecodingDraftTokens, scoresPtr,
+        selectedIdsPtr, params.firstTopKOutputIds, params.secondTopKOutputLogProbs);
+
+    // 6) Append the draft tokens and keep the scores for the next layer.
+    updateRequestDraftTokensAndLensAndCurScores(bix, layerIdx, dynamicTreeMaxTopK, maxDecodingDraftTokens,
+        selectedIdsPtr, params.inputDraftTokenIds, params.inputDraftLens, params.outputDraftTokenIds,
+        params.outputDraftLens, params.secondTopKOutputLogProbs, params.outputCurrentScores);
+}
+
+} // namespace
+
+void invokeDynamicTreeLayerUpdate(DynamicTreeLayerUpdateParams const& params, cudaStream_t stream)
+{
+    SizeType32 constexpr BLOCK_SIZE = 128;
+    dynamicTreeLayerUpdate<<<divUp(params.batchSize, BLOCK_SIZE), BLOCK_SIZE, 0, stream>>>(params);
+
+    sync_check_cuda_error();
+}
+
 } // namespace tensorrt_llm::kernels::speculative_decoding
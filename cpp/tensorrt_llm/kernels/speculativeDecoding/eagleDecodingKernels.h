@@ -792,4 +792,102 @@ void invokeCopyFinalDraftTokens(runtime::SizeType32 batchSize, runtime::SizeType
     runtime::TokenIdType* pluginOutputAllLayersDraftTokenIds, runtime::TokenIdType* pluginOutputDraftTokenIds,
     runtime::SizeType32* pluginOutputDraftLens, cudaStream_t stream);
 
+struct DynamicTreeLayerUpdateParams
+{
+    runtime::SizeType32 layerIdx{0};
+    runtime::SizeType32 numEagleLayers{0};
+    runtime::SizeType32 batchSize{0};
+    runtime::SizeType32 dynamicTreeMaxTopK{0};
+    runtime::SizeType32 maxDecodingTokens{0};
+    runtime::SizeType32 maxPathLen{0};
+
+    //! inputs
+    //! [batchSize, maxDecodingDraftTokens]
+    float const* inputPrevScores{nullptr};
+    //! [batchSize, maxDecodingDraftTokens]
+    runtime::TokenIdType const* inputCurrentExpandIndices{nullptr};
+    //! [batchSize, numEagleLayers, maxDecodingDraftTokens x maxDecodingDraftTokens]
+    float const* inputAllLayersScores{nullptr};
+    //! [batchSize, numEagleLayers, maxDecodingDraftTokens x maxDecodingDraftTokens]
+    runtime::TokenIdType const* inputAllLayersDraftTokenIds{nullptr};
+    //! [batchSize, numEagleLayers, maxDecodingDraftTokens x maxDecodingDraftTokens]
+    runtime::TokenIdType const* inputAllLayersDraftTokenIdsPredecessor{nullptr};
+    //! [batchSize, maxDecodingTokens, maxPathLen]
+    runtime::SizeType32 const* inputPaths{nullptr};
+    //! [batchSize, maxDecodingDraftTokens]
+    runtime::TokenIdType const* inputDraftTokenIds{nullptr};
+    //! [batchSize]
+    runtime::SizeType32 const* inputDraftLens{nullptr};
+
+    //! workspace
+    //! [batchSize * dynamicTreeMaxTopK, maxDecodingDraftTokens], the logProbs of the first topK sampling.
+    //! Updated in place with the previous scores.
+    float* firstTopKOutputLogProbs{nullptr};
+    //! [batchSize * dynamicTreeMaxTopK, maxDecodingDraftTokens], the outputIds of the first topK sampling.
+    runtime::TokenIdType const* firstTopKOutputIds{nullptr};
+    //! [batchSize, maxDecodingDraftTokens], this layer's selected draft tokenIds.
+    runtime::TokenIdType* secondTopKOutputIds{nullptr};
+    //! [batchSize, maxDecodingDraftTokens], this layer's selected scores.
+    float* secondTopKOutputLogProbs{nullptr};
+
+    //! outputs
+    //! [batchSize, numEagleLayers, maxDecodingDraftTokens x maxDecodingDraftTokens]
+    float* outputAllLayersScores{nullptr};
+    //! [batchSize, numEagleLayers, maxDecodingDraftTokens x maxDecodingDraftTokens]
+    runtime::TokenIdType* outputAllLayersDraftTokenIds{nullptr};
+    //! [batchSize, numEagleLayers, maxDecodingDraftTokens x maxDecodingDraftTokens]
+    runtime::TokenIdType* outputAllLayersDraftTokenIdsPredecessor{nullptr};
+    //! [batchSize, maxDecodingTokens, maxPathLen], not written at the last layer.
+    runtime::SizeType32* outputPaths{nullptr};
+    //! [batchSize, maxDecodingDraftTokens], not written at the last layer.
+    runtime::TokenIdType* outputNextExpandIndices{nullptr};
+    //! [batchSize, maxDecodingDraftTokens]
+    runtime::TokenIdType* outputDraftTokenIds{nullptr};
+    //! [batchSize]
+    runtime::SizeType32* outputDraftLens{nullptr};
+    //! [batchSize, maxDecodingDraftTokens]
+    float* outputCurrentScores{nullptr};
+
+    void checkParams()
+    {
+        TLLM_CHECK(inputPrevScores);
+        TLLM_CHECK(inputCurrentExpandIndices);
+        TLLM_CHECK(inputAllLayersScores);
+        TLLM_CHECK(inputAllLayersDraftTokenIds);
+        TLLM_CHECK(inputAllLayersDraftTokenIdsPredecessor);
+        TLLM_CHECK(inputDraftTokenIds);
+        TLLM_CHECK(inputDraftLens);
+
+        TLLM_CHECK(firstTopKOutputLogProbs);
+        TLLM_CHECK(firstTopKOutputIds);
+        TLLM_CHECK(secondTopKOutputIds);
+        TLLM_CHECK(secondTopKOutputLogProbs);
+
+        TLLM_CHECK(outputAllLayersScores);
+        TLLM_CHECK(outputAllLayersDraftTokenIds);
+        TLLM_CHECK(outputAllLayersDraftTokenIdsPredecessor);
+        TLLM_CHECK(outputDraftTokenIds);
+        TLLM_CHECK(outputDraftLens);
+        TLLM_CHECK(outputCurrentScores);
+        TLLM_CHECK(layerIdx == numEagleLayers - 1 || (inputPaths && outputPaths && outputNextExpandIndices));
+
+        TLLM_CHECK(batchSize > 0);
+        TLLM_CHECK(layerIdx > 0 && layerIdx < numEagleLayers);
+        TLLM_CHECK(dynamicTreeMaxTopK > 0 && dynamicTreeMaxTopK < maxDecodingTokens);
+        TLLM_CHECK(maxPathLen > 0);
+    }
+};
+
+//! \brief Eagle-2 dynamic tree update of a draft layer after the first one, in a single launch.
+//! Does for every request what invokeUpdateScores, invokeAssembleSecondTopKSamplingInputs, the second topK sampling,
+//! invokeCopyScoresAndDraftTokenIds, invokeUpdatePath (except at the last layer),
+//! invokeExtractScoresAndRealDraftTokensIds and invokeUpdateDraftTokensAndLensAndCurScores do in sequence. The second
+//! topK runs in the thread of the request over the dynamicTreeMaxTopK x dynamicTreeMaxTopK candidates instead of a
+//! sampling over a padded vocab. The outputs are the ones of that chain, up to the order of equal scores. The first
+//! topK sampling over the vocab must have run, and the final tree of the last layer is still built by the third topK
+//! sampling and invokeReconstructFinalPath.
+//! \param params kernel params.
+//! \param stream cuda stream.
+void invokeDynamicTreeLayerUpdate(DynamicTreeLayerUpdateParams const& params, cudaStream_t stream);
+
 } // namespace tensorrt_llm::kernels::speculative_decoding
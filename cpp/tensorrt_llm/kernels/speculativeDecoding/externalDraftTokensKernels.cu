@@ -112,8 +112,9 @@ template <typename T>
 __global__ void acceptDraftTokensKernel(T const* draftProbs, T* targetProbs, SizeType32 const* numsDraftTokens,
     bool const* batchUseDraftLogits, TokenIdType const* draftIds, FinishedState const* finishedInput,
     FinishedState* finishedOutput, curandState_t* curandState, SizeType32 const* batchSlots, SizeType32 maxDraftTokens,
-    SizeType32 beamWidth, SizeType32 vocabSize, bool randomThreshold, float constantThreshold, SizeType32 step,
-    bool* batchIsAccepted, SizeType32* targetOutputIds)
+    SizeType32 beamWidth, SizeType32 vocabSize, bool randomThreshold, float constantThreshold,
+    float typicalAcceptanceEpsilon, float typicalAcceptanceDelta, SizeType32 step, bool* batchIsAccepted,
+    SizeType32* targetOutputIds)
 {
     auto const bid = blockIdx.x;
     auto const draftTokenIdx = step;
@@ -162,10 +163,38 @@ __global__ void acceptDraftTokensKernel(T const* draftProbs, T* targetProbs, Siz
 
     __shared__ bool isAccepted;
     __shared__ T sSumVal;
+    __shared__ float sTypicalThreshold;
+
+    bool const typicalAcceptance = typicalAcceptanceEpsilon > 0.f;
+    if (typicalAcceptance)
+    {
+        // Typical acceptance threshold min(epsilon, delta * exp(-H)) with the entropy H of the target distribution.
+        float entropy = 0.f;
+        for (SizeType32 vIdx = tid; vIdx < vocabSize; vIdx += static_cast<SizeType32>(blockDim.x))
+        {
+            auto const prob = static_cast<float>(targetProbsBatch[vIdx]);
+            entropy -= prob > 0.f ? prob * __logf(prob) : 0.f;
+        }
+        entropy = blockReduceSum<float>(entropy);
+        if (tid == 0)
+        {
+            sTypicalThreshold = fminf(typicalAcceptanceEpsilon, typicalAcceptanceDelta * __expf(-entropy));
+        }
+        __syncthreads();
+    }
+
     if (tid == 0)
     {
         auto const draftOutputTokenId = draftIds[batchSlot * maxDraftTokens + draftTokenIdx];
-        if (useDraftLogits)
+        if (typicalAcceptance)
+        {
+            // Accept the tokens that are typical for the target model, with or without draft logits. A token equal to
+            // the sampled target token is always accepted.
+            auto const targetProb = static_cast<float>(targetProbsBatch[draftOutputTokenId]);
+            isAccepted = targetProb > sTypicalThreshold
+                || (!useDraftLogits && targetOutputIds[batchSlot] == draftOutputTokenId);
+        }
+        else if (useDraftLogits)
         {
             float threshold = randomThreshold ? curand_uniform(curandState + batchSlot) : constantThreshold;
             auto const targetProb = static_cast<float>(targetProbsBatch[draftOutputTokenId]);
@@ -186,7 +215,8 @@ __global__ void acceptDraftTokensKernel(T const* draftProbs, T* targetProbs, Siz
 
     __syncthreads();
 
-    if (useDraftLogits && !isAccepted)
+    // With typical acceptance the bonus token is sampled from the target distribution itself.
+    if (useDraftLogits && !isAccepted && !typicalAcceptance)
     {
         // correct target distribution
         T const zeroVal = static_cast<T>(0.0F);
@@ -266,8 +296,9 @@ template <typename T>
 void invokeAcceptDraftTokens(SizeType32 batchSize, T* draftProbs, T* targetProbs, SizeType32 const* numsDraftTokens,
     bool const* batchUseDraftLogits, TokenIdType const* draftIds, FinishedState const* finishedInput,
     FinishedState* finishedOutput, curandState_t* curandState, SizeType32 const* batchSlots, SizeType32 maxDraftTokens,
-    SizeType32 beamWidth, SizeType32 vocabSizePadded, bool randomThreshold, float constantThreshold, SizeType32 step,
-    bool* batchIsAccepted, SizeType32* targetOutputIds, cudaStream_t stream)
+    SizeType32 beamWidth, SizeType32 vocabSizePadded, bool randomThreshold, float constantThreshold,
+    float typicalAcceptanceEpsilon, float typicalAcceptanceDelta, SizeType32 step, bool* batchIsAccepted,
+    SizeType32* targetOutputIds, cudaStream_t stream)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
     TLLM_CHECK(beamWidth == 1);
@@ -276,7 +307,8 @@ void invokeAcceptDraftTokens(SizeType32 batchSize, T* draftProbs, T* targetProbs
         dim3 grid(batchSize * beamWidth);
         acceptDraftTokensKernel<<<grid, block, 0, stream>>>(draftProbs, targetProbs, numsDraftTokens,
             batchUseDraftLogits, draftIds, finishedInput, finishedOutput, curandState, batchSlots, maxDraftTokens,
-            beamWidth, vocabSizePadded, randomThreshold, constantThreshold, step, batchIsAccepted, targetOutputIds);
+            beamWidth, vocabSizePadded, randomThreshold, constantThreshold, typicalAcceptanceEpsilon,
+            typicalAcceptanceDelta, step, batchIsAccepted, targetOutputIds);
     }
     sync_check_cuda_error();
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
@@ -293,14 +325,14 @@ template void invokeAcceptDraftTokens(SizeType32 batchSize, float* draftProbs, f
     SizeType32 const* numsDraftTokens, bool const* batchUseDraftLogits, TokenIdType const* draftIds,
     FinishedState const* finishedInput, FinishedState* finishedOutput, curandState_t* curandState,
     SizeType32 const* batchSlots, SizeType32 maxDraftTokens, SizeType32 beamWidth, SizeType32 vocabSizePadded,
-    bool randomThreshold, float constantThreshold, SizeType32 step, bool* batchIsAccepted, SizeType32* targetOutputIds,
-    cudaStream_t stream);
+    bool randomThreshold, float constantThreshold, float typicalAcceptanceEpsilon, float typicalAcceptanceDelta,
+    SizeType32 step, bool* batchIsAccepted, SizeType32* targetOutputIds, cudaStream_t stream);
 template void invokeAcceptDraftTokens(SizeType32 batchSize, half* draftProbs, half* targetProbs,
     SizeType32 const* numsDraftTokens, bool const* batchUseDraftLogits, TokenIdType const* draftIds,
     FinishedState const* finishedInput, FinishedState* finishedOutput, curandState_t* curandState,
     SizeType32 const* batchSlots, SizeType32 maxDraftTokens, SizeType32 beamWidth, SizeType32 vocabSizePadded,
-    bool randomThreshold, float constantThreshold, SizeType32 step, bool* batchIsAccepted, SizeType32* targetOutputIds,
-    cudaStream_t stream);
+    bool randomThreshold, float constantThreshold, float typicalAcceptanceEpsilon, float typicalAcceptanceDelta,
+    SizeType32 step, bool* batchIsAccepted, SizeType32* targetOutputIds, cudaStream_t stream);
 
 void invokeForwardAcceptedTokens(SizeType32 batchSize, SizeType32 const* batchSlots, bool* batchIsAccepted,
     SizeType32* outputSequenceLengths, TokenIdType const* draftIds, TokenIdType** idsPtrs, SizeType32 step,
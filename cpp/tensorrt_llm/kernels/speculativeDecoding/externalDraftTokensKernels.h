@@ -50,6 +50,11 @@ namespace tensorrt_llm::kernels::speculative_decoding
 //! \param vocabSizePadded padded vocab size
 //! \param randomThreshold True if use uniformly sampled threshold for token acceptance
 //! \param constantThreshold threshold used to accept tokens if randomThreshold is false
+//! \param typicalAcceptanceEpsilon if > 0, typical acceptance (Medusa-2) replaces rejection sampling and exact match:
+//! a draft token x is accepted if pTarget(x) > min(epsilon, delta * exp(-H(pTarget))), H being the entropy, and the
+//! token of a rejected draft token is sampled from pTarget. It accepts more tokens when sampling at temperature > 0.
+//! \param typicalAcceptanceDelta scale of the entropy-dependent threshold of typical acceptance, usually
+//! sqrt(epsilon)
 //! \param step The current step of decoding (draft token id index)
 //! \param batchIsAccepted output buffer [batchSize]. Stores acceptance result for multinomial sampling later or
 //! forwarding next step.
@@ -61,8 +66,9 @@ void invokeAcceptDraftTokens(runtime::SizeType32 batchSize, T* draftProbs, T* ta
     runtime::SizeType32 const* numsDraftTokens, bool const* batchUseDraftLogits, runtime::TokenIdType const* draftIds,
     FinishedState const* finishedInput, FinishedState* finishedOutput, curandState_t* curandState,
     runtime::SizeType32 const* batchSlots, runtime::SizeType32 maxDraftTokens, runtime::SizeType32 beamWidth,
-    runtime::SizeType32 vocabSizePadded, bool randomThreshold, float constantThreshold, runtime::SizeType32 step,
-    bool* batchIsAccepted, runtime::SizeType32* targetOutputIds, cudaStream_t stream);
+    runtime::SizeType32 vocabSizePadded, bool randomThreshold, float constantThreshold, float typicalAcceptanceEpsilon,
+    float typicalAcceptanceDelta, runtime::SizeType32 step, bool* batchIsAccepted, runtime::SizeType32* targetOutputIds,
+    cudaStream_t stream);
 
 //! \brief Mask the target logits with -inf for unselected topK/topP token ids.
 //! according to
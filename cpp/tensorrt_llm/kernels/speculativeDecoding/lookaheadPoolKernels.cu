@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/speculativeDecoding/lookaheadPoolKernels.h"
+
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::runtime;
+
+namespace tensorrt_llm::kernels::speculative_decoding
+{
+namespace
+{
+
+SizeType32 constexpr kEmptyKey = -1;
+//! Number of buckets probed before the ngrams of a key are dropped.
+SizeType32 constexpr kMaxProbes = 16;
+
+__device__ __forceinline__ SizeType32 homeBucket(TokenIdType key, SizeType32 numBuckets)
+{
+    // Fibonacci hashing, token ids of similar values are spread over the table.
+    return static_cast<SizeType32>((static_cast<uint32_t>(key) * 2654435769u) >> 7) & (numBuckets - 1);
+}
+
+//! Bucket of key in the pool of a slot, -1 if it is absent.
+__device__ SizeType32 findBucket(TokenIdType const* keys, TokenIdType key, SizeType32 numBuckets)
+{
+    auto bucket = homeBucket(key, numBuckets);
+    for (SizeType32 probe = 0; probe < kMaxProbes && probe < numBuckets; ++probe)
+    {
+        auto const current = keys[bucket];
+        if (current == key)
+        {
+            return bucket;
+        }
+        if (current == kEmptyKey)
+        {
+            return -1;
+        }
+        bucket = (bucket + 1) & (numBuckets - 1);
+    }
+    return -1;
+}
+
+__global__ void resetLookaheadPoolKernel(LookaheadPool pool, SizeType32 const* batchSlots)
+{
+    auto const batchSlot = batchSlots[blockIdx.x];
+    auto* keys = pool.keys + static_cast<size_t>(batchSlot) * pool.numBuckets;
+    auto* counts = pool.ngramCounts + static_cast<size_t>(batchSlot) * pool.numBuckets;
+    for (auto bucket = static_cast<SizeType32>(threadIdx.x); bucket < pool.numBuckets; bucket += blockDim.x)
+    {
+        keys[bucket] = kEmptyKey;
+        counts[bucket] = 0;
+    }
+}
+
+// One thread per request: the insertions of a request depend on each other, and a few ngrams of a few tokens are moved
+// per insertion.
+__global__ void insertLookaheadPoolKernel(LookaheadPool pool, TokenIdType const* keyTokens, SizeType32 keyBatchStride,
+    SizeType32 keyStride, TokenIdType const* ngramTokens, SizeType32 ngramBatchStride, SizeType32 ngramStride,
+    SizeType32 const* numInserts, SizeType32 const* batchSlots, SizeType32 batchSize)
+{
+    auto const batchIdx = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
+    if (batchIdx >= batchSize)
+    {
+        return;
+    }
+    auto const batchSlot = batchSlots[batchIdx];
+    auto const guessSetSize = pool.guessSetSizes[batchSlot];
+    auto const ngramLen = pool.ngramLens[batchSlot];
+    if (guessSetSize <= 0 || ngramLen <= 0)
+    {
+        return;
+    }
+
+    auto const numBuckets = pool.numBuckets;
+    auto const bucketSize = pool.maxGuessSetSize * pool.maxNgramLen;
+    auto* keys = pool.keys + static_cast<size_t>(batchSlot) * numBuckets;
+    auto* counts = pool.ngramCounts + static_cast<size_t>(batchSlot) * numBuckets;
+    auto* ngrams = pool.ngrams + static_cast<size_t>(batchSlot) * numBuckets * bucketSize;
+
+    for (SizeType32 ii = 0; ii < numInserts[batchIdx]; ++ii)
+    {
+        auto const key = keyTokens[batchIdx * keyBatchStride + ii * keyStride];
+        auto const* ngram = ngramTokens + batchIdx * ngramBatchStride + ii * ngramStride;
+
+        // Find the bucket of the key, or take the first free one. Without both, the home bucket is taken over.
+        auto const home = homeBucket(key, numBuckets);
+        auto bucket = home;
+        bool found = false;
+        for (SizeType32 probe = 0; probe < kMaxProbes && probe < numBuckets; ++probe)
+        {
+            auto const current = keys[bucket];
+            if (current == key || current == kEmptyKey)
+            {
+                found = true;
+                break;
+            }
+            bucket = (bucket + 1) & (numBuckets - 1);
+        }
+        if (!found)
+        {
+            bucket = home;
+        }
+        if (keys[bucket] != key)
+        {
+            keys[bucket] = key;
+            counts[bucket] = 0;
+        }
+
+        auto* entries = ngrams + static_cast<size_t>(bucket) * bucketSize;
+        auto count = counts[bucket];
+        // Position of the ngram if it is present, else of the oldest one when the bucket is full.
+        SizeType32 removed = count;
+        for (SizeType32 gi = 0; gi < count && removed == count; ++gi)
+        {
+            bool equal = true;
+            for (SizeType32 ti = 0; ti < ngramLen && equal; ++ti)
+            {
+                equal = entries[gi * pool.maxNgramLen + ti] == ngram[ti];
+            }
+            if (equal)
+            {
+                removed = gi;
+            }
+        }
+        if (removed == count && count >= guessSetSize)
+        {
+            removed = 0;
+        }
+        if (removed < count)
+        {
+            for (SizeType32 gi = removed; gi + 1 < count; ++gi)
+            {
+                for (SizeType32 ti = 0; ti < ngramLen; ++ti)
+                {
+                    entries[gi * pool.maxNgramLen + ti] = entries[(gi + 1) * pool.maxNgramLen + ti];
+                }
+            }
+            --count;
+        }
+        for (SizeType32 ti = 0; ti < ngramLen; ++ti)
+        {
+            entries[count * pool.maxNgramLen + ti] = ngram[ti];
+        }
+        counts[bucket] = count + 1;
+    }
+}
+
+__global__ void guessLookaheadPoolKernel(LookaheadPool pool, TokenIdType* guessTokens, SizeType32* numGuesses,
+    TokenIdType const* lastTokens, SizeType32 const* guessSizes, SizeType32 const* batchSlots, SizeType32 batchSize)
+{
+    auto const batchIdx = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
+    if (batchIdx >= batchSize)
+    {
+        return;
+    }
+    auto const batchSlot = batchSlots[batchIdx];
+    auto const numBuckets = pool.numBuckets;
+    auto const bucketSize = pool.maxGuessSetSize * pool.maxNgramLen;
+    auto const* keys = pool.keys + static_cast<size_t>(batchSlot) * numBuckets;
+    auto const bucket = findBucket(keys, lastTokens[batchIdx], numBuckets);
+    if (bucket < 0)
+    {
+        numGuesses[batchIdx] = 0;
+        return;
+    }
+
+    auto const count = pool.ngramCounts[static_cast<size_t>(batchSlot) * numBuckets + bucket];
+    auto const numGuess = min(count, min(guessSizes[batchIdx], pool.maxGuessSetSize));
+    auto const ngramLen = pool.ngramLens[batchSlot];
+    auto const* entries = pool.ngrams + (static_cast<size_t>(batchSlot) * numBuckets + bucket) * bucketSize;
+    auto* guesses = guessTokens + static_cast<size_t>(batchIdx) * bucketSize;
+    for (SizeType32 gi = 0; gi < numGuess; ++gi)
+    {
+        for (SizeType32 ti = 0; ti < ngramLen; ++ti)
+        {
+            guesses[gi * pool.maxNgramLen + ti] = entries[(count - numGuess + gi) * pool.maxNgramLen + ti];
+        }
+    }
+    numGuesses[batchIdx] = numGuess;
+}
+
+} // namespace
+
+void invokeResetLookaheadPool(
+    LookaheadPool const& pool, SizeType32 const* batchSlots, SizeType32 batchSize, cudaStream_t stream)
+{
+    pool.checkParams();
+    if (batchSize == 0)
+    {
+        return;
+    }
+    SizeType32 constexpr BLOCK_SIZE = 256;
+    resetLookaheadPoolKernel<<<batchSize, BLOCK_SIZE, 0, stream>>>(pool, batchSlots);
+
+    sync_check_cuda_error();
+}
+
+void invokeInsertLookaheadPool(LookaheadPool const& pool, TokenIdType const* keyTokens, SizeType32 keyBatchStride,
+    SizeType32 keyStride, TokenIdType const* ngramTokens, SizeType32 ngramBatchStride, SizeType32 ngramStride,
+    SizeType32 const* numInserts, SizeType32 const* batchSlots, SizeType32 batchSize, cudaStream_t stream)
+{
+    pool.checkParams();
+    if (batchSize == 0)
+    {
+        return;
+    }
+    SizeType32 constexpr BLOCK_SIZE = 64;
+    insertLookaheadPoolKernel<<<divUp(batchSize, BLOCK_SIZE), BLOCK_SIZE, 0, stream>>>(pool, keyTokens,
+        keyBatchStride, keyStride, ngramTokens, ngramBatchStride, ngramStride, numInserts, batchSlots, batchSize);
+
+    sync_check_cuda_error();
+}
+
+void invokeGuessLookaheadPool(LookaheadPool const& pool, TokenIdType* guessTokens, SizeType32* numGuesses,
+    TokenIdType const* lastTokens, SizeType32 const* guessSizes, SizeType32 const* batchSlots, SizeType32 batchSize,
+    cudaStream_t stream)
+{
+    pool.checkParams();
+    if (batchSize == 0)
+    {
+        return;
+    }
+    SizeType32 constexpr BLOCK_SIZE = 64;
+    guessLookaheadPoolKernel<<<divUp(batchSize, BLOCK_SIZE), BLOCK_SIZE, 0, stream>>>(
+        pool, guessTokens, numGuesses, lastTokens, guessSizes, batchSlots, batchSize);
+
+    sync_check_cuda_error();
+}
+
+} // namespace tensorrt_llm::kernels::speculative_decoding
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/common.h"
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels::speculative_decoding
+{
+
+//! \brief Device-resident key-ngram pools of lookahead decoding, one per batch slot.
+//! Every pool is an open addressing hash table from a key token to the ngrams that followed it, oldest first, with
+//! the semantics of layers::LookaheadPoolManager: inserting an ngram that is present moves it to the newest position,
+//! and the oldest ngram is dropped when a key holds guessSetSize ngrams. When all probed buckets of a full table are
+//! taken by other keys, the ngrams of the first one are dropped.
+struct LookaheadPool
+{
+    //! buffer [maxBatchSize, numBuckets], key token of every bucket, -1 if empty.
+    runtime::TokenIdType* keys{nullptr};
+    //! buffer [maxBatchSize, numBuckets, maxGuessSetSize, maxNgramLen], ngrams of every bucket, oldest first.
+    runtime::TokenIdType* ngrams{nullptr};
+    //! buffer [maxBatchSize, numBuckets], number of ngrams of every bucket.
+    runtime::SizeType32* ngramCounts{nullptr};
+    //! input buffer [maxBatchSize], guess set size of every slot, at most maxGuessSetSize. No ngram is stored if 0.
+    runtime::SizeType32 const* guessSetSizes{nullptr};
+    //! input buffer [maxBatchSize], ngram length of every slot, level - 1, at most maxNgramLen.
+    runtime::SizeType32 const* ngramLens{nullptr};
+    //! number of buckets of a pool, a power of 2.
+    runtime::SizeType32 numBuckets{0};
+    runtime::SizeType32 maxGuessSetSize{0};
+    runtime::SizeType32 maxNgramLen{0};
+
+    void checkParams() const
+    {
+        TLLM_CHECK(keys);
+        TLLM_CHECK(ngrams);
+        TLLM_CHECK(ngramCounts);
+        TLLM_CHECK(guessSetSizes);
+        TLLM_CHECK(ngramLens);
+        TLLM_CHECK(numBuckets > 0 && (numBuckets & (numBuckets - 1)) == 0);
+        TLLM_CHECK(maxGuessSetSize > 0);
+        TLLM_CHECK(maxNgramLen > 0);
+    }
+};
+
+//! \brief Empties the pools of batchSlots, e.g. at the setup of new requests.
+//!
+//! \param pool the pools
+//! \param batchSlots input buffer [batchSize], address map from local index to global index [0, batchSize] ->
+//! [0, maxBatchSize].
+//! \param batchSize the number of pools to reset
+//! \param stream stream
+void invokeResetLookaheadPool(LookaheadPool const& pool, runtime::SizeType32 const* batchSlots,
+    runtime::SizeType32 batchSize, cudaStream_t stream);
+
+//! \brief Inserts ngrams into the pools of a batch, in order within a request and in parallel across requests.
+//! Insertion i of request bi has the key keyTokens[bi * keyBatchStride + i * keyStride] and the ngram starting at
+//! ngramTokens[bi * ngramBatchStride + i * ngramStride], of the ngram length of the slot. With keyStride = 1,
+//! ngramStride = 1 and ngramTokens = keyTokens + 1, all ngrams of a sequence are inserted, as for the prompt and the
+//! accepted tokens. With ngramStride = ngramLen, the shifted lookahead window is inserted under its shifted out keys.
+//!
+//! \param pool the pools
+//! \param keyTokens input buffer, key tokens
+//! \param keyBatchStride, keyStride strides of the key tokens between requests and between insertions
+//! \param ngramTokens input buffer, ngram tokens
+//! \param ngramBatchStride, ngramStride strides of the ngram tokens between requests and between insertions
+//! \param numInserts input buffer [batchSize], number of insertions of every request
+//! \param batchSlots input buffer [batchSize], address map from local index to global index [0, batchSize] ->
+//! [0, maxBatchSize].
+//! \param batchSize the number of requests
+//! \param stream stream
+void invokeInsertLookaheadPool(LookaheadPool const& pool, runtime::TokenIdType const* keyTokens,
+    runtime::SizeType32 keyBatchStride, runtime::SizeType32 keyStride, runtime::TokenIdType const* ngramTokens,
+    runtime::SizeType32 ngramBatchStride, runtime::SizeType32 ngramStride, runtime::SizeType32 const* numInserts,
+    runtime::SizeType32 const* batchSlots, runtime::SizeType32 batchSize, cudaStream_t stream);
+
+//! \brief Gathers the newest ngrams of the last golden token of every request, as LookaheadPoolManager::guess.
+//!
+//! \param pool the pools
+//! \param guessTokens output buffer [batchSize, maxGuessSetSize, maxNgramLen], the guessed ngrams, oldest first
+//! \param numGuesses output buffer [batchSize], the number of guessed ngrams
+//! \param lastTokens input buffer [batchSize], the last golden token of every request
+//! \param guessSizes input buffer [batchSize], the maximum number of guesses of every request
+//! \param batchSlots input buffer [batchSize], address map from local index to global index [0, batchSize] ->
+//! [0, maxBatchSize].
+//! \param batchSize the number of requests
+//! \param stream stream
+void invokeGuessLookaheadPool(LookaheadPool const& pool, runtime::TokenIdType* guessTokens,
+    runtime::SizeType32* numGuesses, runtime::TokenIdType const* lastTokens, runtime::SizeType32 const* guessSizes,
+    runtime::SizeType32 const* batchSlots, runtime::SizeType32 batchSize, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels::speculative_decoding
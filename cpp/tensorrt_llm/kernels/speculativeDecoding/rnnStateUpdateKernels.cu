@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rnnStateUpdateKernels.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+
+#include <algorithm>
+#include <array>
+
+namespace tensorrt_llm::kernels::speculative_decoding
+{
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+static constexpr SizeType32 kMaxLayersPerIter = 32;
+
+template <typename MoveEltType>
+__global__ void updateRnnStateDraftTokenLocationKernel(std::array<void*, kMaxLayersPerIter> stateList,
+    std::array<void const*, kMaxLayersPerIter> snapshotList, SizeType32 const* seqAcceptedDraftTokenOffsets,
+    IndexType const* packedAcceptedDraftTokensIndices, SizeType32 const* seqSlotRemapping, SizeType32 numSpecTokens,
+    SizeType32 eltCountPerState)
+{
+    auto const seqIdx = static_cast<SizeType32>(blockIdx.x);
+    auto const layerIdx = static_cast<SizeType32>(blockIdx.y);
+    auto const acceptedBegin = seqAcceptedDraftTokenOffsets[seqIdx];
+    auto const acceptedEnd = seqAcceptedDraftTokenOffsets[seqIdx + 1];
+    // The real token is always accepted, the drafts follow it.
+    auto const position = acceptedEnd > acceptedBegin ? packedAcceptedDraftTokensIndices[acceptedEnd - 1] + 1 : 0;
+    auto const slotIdx = seqSlotRemapping == nullptr ? seqIdx : seqSlotRemapping[seqIdx];
+
+    auto* dst = reinterpret_cast<MoveEltType*>(stateList[layerIdx]) + static_cast<size_t>(slotIdx) * eltCountPerState;
+    auto const* src = reinterpret_cast<MoveEltType const*>(snapshotList[layerIdx])
+        + (static_cast<size_t>(seqIdx) * numSpecTokens + position) * eltCountPerState;
+    for (SizeType32 idx = static_cast<SizeType32>(threadIdx.x); idx < eltCountPerState;
+         idx += static_cast<SizeType32>(blockDim.x))
+    {
+        dst[idx] = src[idx];
+    }
+}
+} // namespace
+
+void updateRnnStateDraftTokenLocation(void* const* stateList, void const* const* snapshotList,
+    SizeType32 const* seqAcceptedDraftTokenOffsets, IndexType const* packedAcceptedDraftTokensIndices,
+    SizeType32 const* seqSlotRemapping, SizeType32 layerCount, SizeType32 seqCount, SizeType32 numSpecTokens,
+    SizeType32 sizeInBytesPerState, cudaStream_t stream)
+{
+    if (seqCount == 0 || layerCount == 0)
+    {
+        return;
+    }
+    SizeType32 alignedBytes = 16;
+    while (alignedBytes > 1 && (sizeInBytesPerState % alignedBytes != 0))
+    {
+        alignedBytes >>= 1;
+    }
+    SizeType32 const eltCountPerState = sizeInBytesPerState / alignedBytes;
+
+    void (*pKernelFunc)(std::array<void*, kMaxLayersPerIter>, std::array<void const*, kMaxLayersPerIter>,
+        SizeType32 const*, IndexType const*, SizeType32 const*, SizeType32, SizeType32)
+        = nullptr;
+    switch (alignedBytes)
+    {
+    case 16: pKernelFunc = &updateRnnStateDraftTokenLocationKernel<int4>; break;
+    case 8: pKernelFunc = &updateRnnStateDraftTokenLocationKernel<int64_t>; break;
+    case 4: pKernelFunc = &updateRnnStateDraftTokenLocationKernel<int32_t>; break;
+    case 2: pKernelFunc = &updateRnnStateDraftTokenLocationKernel<int16_t>; break;
+    default: pKernelFunc = &updateRnnStateDraftTokenLocationKernel<int8_t>; break;
+    }
+
+    for (SizeType32 startLayer = 0; startLayer < layerCount; startLayer += kMaxLayersPerIter)
+    {
+        auto const microBatchLayerCount = std::min(layerCount - startLayer, kMaxLayersPerIter);
+        std::array<void*, kMaxLayersPerIter> stateArray{};
+        std::array<void const*, kMaxLayersPerIter> snapshotArray{};
+        for (SizeType32 i = 0; i < microBatchLayerCount; i++)
+        {
+            stateArray[i] = stateList[startLayer + i];
+            snapshotArray[i] = snapshotList[startLayer + i];
+        }
+        dim3 grid(seqCount, microBatchLayerCount, 1);
+        dim3 block(256, 1, 1);
+        pKernelFunc<<<grid, block, 0, stream>>>(stateArray, snapshotArray, seqAcceptedDraftTokenOffsets,
+            packedAcceptedDraftTokensIndices, seqSlotRemapping, numSpecTokens, eltCountPerState);
+        TLLM_CUDA_CHECK(cudaGetLastError());
+    }
+}
+
+} // namespace tensorrt_llm::kernels::speculative_decoding
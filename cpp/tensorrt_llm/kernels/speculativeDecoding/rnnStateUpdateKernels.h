@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/kernels/speculativeDecoding/kvCacheUpdateKernels.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <cuda_runtime_api.h>
+
+namespace tensorrt_llm::kernels::speculative_decoding
+{
+
+/*!
+ * Update the recurrent states of the Mamba layers of hybrid models for parallel decoding algorithms.
+ * The recurrent states cannot be rewound like the KV cache. Instead, the generation kernels write the state after
+ * every token of a sequence, the real token and its drafts, to a snapshot buffer and leave the cache as it was. This
+ * copies the snapshot of the last accepted token of every sequence to the cache.
+ * The accepted tokens are given as for updateKVCacheDraftTokenLocation, the snapshot of draft token i is at position
+ * i + 1 and the one of the real token at position 0.
+ * @param stateList : Host array of length layerCount, the states of every layer, [numSlots, sizeInBytesPerState]
+ * @param snapshotList : Host array of length layerCount, the snapshots of every layer,
+ * [seqCount, numSpecTokens, sizeInBytesPerState]
+ * @param seqAcceptedDraftTokenOffsets : Array of length seqCount + 1, like [0, 3, 5]
+ * @param packedAcceptedDraftTokensIndices : Array of length seqAcceptedDraftTokenOffsets[seqCount], each value is in
+ * range [0, numSpecTokens - 2]
+ * @param seqSlotRemapping : Array of length seqCount, the state slot of every sequence, identity if nullptr
+ * @param layerCount : Count of the recurrent states, the conv and the SSM states being separate ones
+ * @param seqCount : Count of sequence
+ * @param numSpecTokens : Count of tokens per sequence, 1 + the maximum count of draft tokens
+ * @param sizeInBytesPerState : Size of the state of a sequence in one layer
+ * @param stream : CUDA stream to use.
+ */
+void updateRnnStateDraftTokenLocation(void* const* stateList, void const* const* snapshotList,
+    runtime::SizeType32 const* seqAcceptedDraftTokenOffsets, IndexType const* packedAcceptedDraftTokensIndices,
+    runtime::SizeType32 const* seqSlotRemapping, runtime::SizeType32 layerCount, runtime::SizeType32 seqCount,
+    runtime::SizeType32 numSpecTokens, runtime::SizeType32 sizeInBytesPerState, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels::speculative_decoding
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/tokenBiasLogitsProcessor.h"
+
+#include <cuda_fp16.h>
+#ifdef ENABLE_BF16
+#include <cuda_bf16.h>
+#endif
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+template <typename T>
+__global__ void tokenBiasLogitsProcessorKernel(T* logits, int32_t const* rowOffsets, void* const* states,
+    int32_t beamWidth, int32_t vocabSize, int32_t vocabSizePadded)
+{
+    // One block per request and beam, one thread per biased token.
+    auto const requestIdx = blockIdx.x / beamWidth;
+    auto const beamIdx = blockIdx.x % beamWidth;
+    auto const& state = *static_cast<TokenBiasLogitsProcessorState const*>(states[requestIdx]);
+    auto const numTokens = min(state.numTokens, TokenBiasLogitsProcessorState::kMaxNumTokens);
+    auto* rowLogits = logits + static_cast<int64_t>(rowOffsets[requestIdx] + beamIdx) * vocabSizePadded;
+    for (int32_t ti = threadIdx.x; ti < numTokens; ti += blockDim.x)
+    {
+        auto const tokenId = state.tokenIds[ti];
+        if (tokenId >= 0 && tokenId < vocabSize)
+        {
+            // The ids of a state are distinct, so no two threads write the same logit.
+            rowLogits[tokenId] = static_cast<T>(static_cast<float>(rowLogits[tokenId]) + state.biases[ti]);
+        }
+    }
+}
+
+} // namespace
+
+template <typename T>
+void invokeTokenBiasLogitsProcessor(T* logits, int32_t const* rowOffsets, void* const* states, int32_t numRequests,
+    int32_t beamWidth, int32_t vocabSize, int32_t vocabSizePadded, cudaStream_t stream)
+{
+    if (numRequests == 0)
+    {
+        return;
+    }
+    dim3 const grid(numRequests * beamWidth);
+    dim3 const block(TokenBiasLogitsProcessorState::kMaxNumTokens);
+    tokenBiasLogitsProcessorKernel<T>
+        <<<grid, block, 0, stream>>>(logits, rowOffsets, states, beamWidth, vocabSize, vocabSizePadded);
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_TOKEN_BIAS_LOGITS_PROCESSOR(T)                                                                     \
+    template void invokeTokenBiasLogitsProcessor<T>(T * logits, int32_t const* rowOffsets, void* const* states,        \
+        int32_t numRequests, int32_t beamWidth, int32_t vocabSize, int32_t vocabSizePadded, cudaStream_t stream)
+
+INSTANTIATE_TOKEN_BIAS_LOGITS_PROCESSOR(float);
+INSTANTIATE_TOKEN_BIAS_LOGITS_PROCESSOR(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_TOKEN_BIAS_LOGITS_PROCESSOR(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_TOKEN_BIAS_LOGITS_PROCESSOR
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Per-request state of the token bias logits processor, in device memory.
+struct TokenBiasLogitsProcessorState
+{
+    static constexpr int32_t kMaxNumTokens = 64;
+
+    int32_t numTokens{0};
+    int32_t tokenIds[kMaxNumTokens]{};
+    float biases[kMaxNumTokens]{};
+};
+
+//! \brief Add the biases of the state of every request to the logits of all its beams. Tokens out of the vocabulary
+//! are ignored.
+//! \param logits [numRows, vocabSizePadded], beam b of request r is row rowOffsets[r] + b.
+//! \param rowOffsets [numRequests] on the device.
+//! \param states TokenBiasLogitsProcessorState of every request [numRequests] on the device.
+template <typename T>
+void invokeTokenBiasLogitsProcessor(T* logits, int32_t const* rowOffsets, void* const* states, int32_t numRequests,
+    int32_t beamWidth, int32_t vocabSize, int32_t vocabSizePadded, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/pdlUtils.cuh"
+#include "tensorrt_llm/kernels/tokenLogProbsKernels.h"
+
+#include <cub/cub.cuh>
+#include <cuda_fp16.h>
+#ifdef ENABLE_BF16
+#include <cuda_bf16.h>
+#endif
+
+#include <cfloat>
+
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::runtime;
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+constexpr SizeType32 kBlockSize = 256;
+
+struct RowStats
+{
+    float maxLogit;
+    float sumExp;
+};
+
+struct MergeRowStats
+{
+    __device__ __forceinline__ RowStats operator()(RowStats const& a, RowStats const& b) const
+    {
+        auto const maxLogit = fmaxf(a.maxLogit, b.maxLogit);
+        return RowStats{maxLogit,
+            (a.sumExp == 0.f ? 0.f : a.sumExp * __expf(a.maxLogit - maxLogit))
+                + (b.sumExp == 0.f ? 0.f : b.sumExp * __expf(b.maxLogit - maxLogit))};
+    }
+};
+
+//! \brief Grid [numTokens]. One pass over the row with the running max and sum of the exponentials of every thread,
+//! merged over the block.
+template <typename T>
+__global__ void tokenLogProbsKernel(TokenLogProbsParams<T> const params)
+{
+    using StatsReduce = cub::BlockReduce<RowStats, kBlockSize>;
+    __shared__ typename StatsReduce::TempStorage tempStorage;
+
+    auto const row = static_cast<SizeType32>(blockIdx.x);
+    auto const invTemperature = 1.f / params.temperature;
+
+    pdlWaitPrimaryGrid();
+
+    auto const* logits = params.logits + static_cast<std::size_t>(row) * params.vocabSize;
+    RowStats stats{-FLT_MAX, 0.f};
+    for (auto vi = static_cast<SizeType32>(threadIdx.x); vi < params.vocabSize; vi += kBlockSize)
+    {
+        auto const logit = static_cast<float>(logits[vi]) * invTemperature;
+        if (logit > stats.maxLogit)
+        {
+            stats.sumExp = stats.sumExp * __expf(stats.maxLogit - logit) + 1.f;
+            stats.maxLogit = logit;
+        }
+        else
+        {
+            stats.sumExp += __expf(logit - stats.maxLogit);
+        }
+    }
+    stats = StatsReduce(tempStorage).Reduce(stats, MergeRowStats{});
+
+    if (threadIdx.x == 0)
+    {
+        auto const targetId = params.targetIds[row];
+        auto const valid = targetId >= 0 && targetId < params.vocabSize;
+        auto const targetLogit = valid ? static_cast<float>(logits[targetId]) * invTemperature : 0.f;
+        params.logProbs[row] = valid ? targetLogit - stats.maxLogit - __logf(stats.sumExp) : 0.f;
+        if (params.isGreedy != nullptr)
+        {
+            params.isGreedy[row] = valid && targetLogit >= stats.maxLogit;
+        }
+    }
+
+    pdlLaunchDependents();
+}
+
+} // namespace
+
+template <typename T>
+void invokeTokenLogProbs(TokenLogProbsParams<T> const& params, cudaStream_t stream)
+{
+    TLLM_CHECK(params.logits != nullptr && params.targetIds != nullptr && params.logProbs != nullptr);
+    TLLM_CHECK_WITH_INFO(params.temperature > 0.f, "Scoring tokens with a temperature %f, must be positive",
+        params.temperature);
+    if (params.numTokens == 0)
+    {
+        return;
+    }
+    launchWithPdl(tokenLogProbsKernel<T>, dim3(params.numTokens), dim3(kBlockSize), 0, stream, params);
+    sync_check_cuda_error();
+}
+
+template void invokeTokenLogProbs(TokenLogProbsParams<float> const&, cudaStream_t);
+template void invokeTokenLogProbs(TokenLogProbsParams<half> const&, cudaStream_t);
+#ifdef ENABLE_BF16
+template void invokeTokenLogProbs(TokenLogProbsParams<__nv_bfloat16> const&, cudaStream_t);
+#endif
+
+} // namespace tensorrt_llm::kernels
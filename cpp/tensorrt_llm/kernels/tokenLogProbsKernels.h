@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Scoring of given tokens from the logits of the context phase, e.g. for reranking or log-likelihoods: the
+//! log probability of the target of every row, and whether it is the most likely token, without sampling.
+template <typename T>
+struct TokenLogProbsParams
+{
+    //! input buffer [numTokens, vocabSize], the logits of every position.
+    T const* logits{nullptr};
+    //! input buffer [numTokens], the token scored at every position, usually the next input token. Rows with a target
+    //! out of [0, vocabSize), e.g. the last position of a prompt, get 0.
+    runtime::TokenIdType const* targetIds{nullptr};
+
+    //! output buffer [numTokens], log-softmax of the logits at the target.
+    float* logProbs{nullptr};
+    //! output buffer [numTokens], optional. Whether the target has the largest logit of its row.
+    bool* isGreedy{nullptr};
+
+    runtime::SizeType32 numTokens{0};
+    runtime::SizeType32 vocabSize{0};
+    //! The logits are divided by the temperature.
+    float temperature{1.f};
+};
+
+template <typename T>
+void invokeTokenLogProbs(TokenLogProbsParams<T> const& params, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -1161,6 +1161,74 @@ __global__ void radix_topk_one_block_kernel(T const* in, IdxT const* in_idx, con
         }
     }
 }
+
+template <typename T, typename IdxT>
+constexpr bool can_pack_sort_keys()
+{
+    return sizeof(typename cub::Traits<T>::UnsignedBits) <= sizeof(uint32_t) && sizeof(IdxT) <= sizeof(uint32_t);
+}
+
+template <typename T, typename IdxT>
+bool use_packed_sort(IdxT k, bool sorted, TopkLastDimSortAlgo sort_algo)
+{
+    if (!sorted || !can_pack_sort_keys<T, IdxT>())
+    {
+        return false;
+    }
+    return sort_algo == TopkLastDimSortAlgo::kPACKED
+        || (sort_algo == TopkLastDimSortAlgo::kAUTO && k >= static_cast<IdxT>(kMinKForPackedTopkSort));
+}
+
+// The twiddled bits of the value in the high half, so that the ascending order of the keys is the order of the
+// values, and the index in the low half, so that ties are ordered by index without a stable sort.
+template <typename T, typename IdxT>
+__global__ void pack_sort_keys_kernel(T const* val, IdxT const* idx, uint64_t* keys, size_t len, bool select_min)
+{
+    for (size_t i = blockIdx.x * blockDim.x + threadIdx.x; i < len; i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        keys[i] = (static_cast<uint64_t>(twiddle_in(val[i], select_min)) << 32) | static_cast<uint32_t>(idx[i]);
+    }
+}
+
+template <typename T, typename IdxT>
+__global__ void unpack_sort_keys_kernel(uint64_t const* keys, T* val, IdxT* idx, size_t len, bool select_min)
+{
+    using Bits = typename cub::Traits<T>::UnsignedBits;
+    for (size_t i = blockIdx.x * blockDim.x + threadIdx.x; i < len; i += static_cast<size_t>(gridDim.x) * blockDim.x)
+    {
+        val[i] = twiddle_out<T>(static_cast<Bits>(keys[i] >> 32), select_min);
+        idx[i] = static_cast<IdxT>(static_cast<uint32_t>(keys[i]));
+    }
+}
+
+// Sorts the top-k of every row, by value then by index, with one segmented sort of packed keys. Replaces the sort by
+// index and the stable sort by value, which dominate the cost of the sorted output for large k.
+// Without temporary storage, only computes its size.
+template <typename T, typename IdxT>
+void sort_packed_topk(void* sort_temp_storage, size_t& temp_storage_bytes, T const* topk_out,
+    IdxT const* topk_out_idx, uint64_t* keys, uint64_t* sorted_keys, int batch_size, IdxT k, T* out, IdxT* out_idx,
+    bool select_min, cudaStream_t stream)
+{
+    static_assert(can_pack_sort_keys<T, IdxT>());
+    ComputeOffset<IdxT> computeoffset(k);
+    cub::CountingInputIterator<IdxT> counting_iter(0);
+    cub::TransformInputIterator<IdxT, ComputeOffset<IdxT>, cub::CountingInputIterator<IdxT>> transform_iter(
+        counting_iter, computeoffset);
+    size_t const len = static_cast<size_t>(k) * batch_size;
+    if (!sort_temp_storage)
+    {
+        cub::DeviceSegmentedSort::SortKeys(sort_temp_storage, temp_storage_bytes, keys, sorted_keys, len, batch_size,
+            transform_iter, transform_iter + 1, stream);
+        return;
+    }
+    constexpr int block_dim = 256;
+    auto const grid_dim = static_cast<unsigned>(std::min<size_t>(ceildiv<size_t>(len, block_dim), 1024));
+    pack_sort_keys_kernel<<<grid_dim, block_dim, 0, stream>>>(topk_out, topk_out_idx, keys, len, select_min);
+    cub::DeviceSegmentedSort::SortKeys(sort_temp_storage, temp_storage_bytes, keys, sorted_keys, len, batch_size,
+        transform_iter, transform_iter + 1, stream);
+    unpack_sort_keys_kernel<<<grid_dim, block_dim, 0, stream>>>(sorted_keys, out, out_idx, len, select_min);
+}
+
 } // namespace air_topk_stable
 
 //}
@@ -1200,7 +1268,7 @@ inline std::vector<void*> calc_aligned_pointers(void const* p, std::vector<size_
 template <typename T, typename IdxT, int BitsPerPass, int BlockSize>
 void standalone_stable_radix_topk_(void* buf, size_t& buf_size, T const* in, IdxT const* in_idx, int batch_size,
     IdxT len, IdxT k, T* out, IdxT* out_idx, bool select_min, bool fused_last_filter, unsigned grid_dim,
-    cudaStream_t stream, bool sorted = false)
+    cudaStream_t stream, bool sorted = false, bool packed_sort = false)
 {
     static_assert(air_topk_stable::calc_num_passes<T, BitsPerPass>() > 1);
     constexpr int num_buckets = air_topk_stable::calc_num_buckets<BitsPerPass>();
@@ -1226,7 +1294,12 @@ void standalone_stable_radix_topk_(void* buf, size_t& buf_size, T const* in, Idx
         transform_iter(counting_iter, computeoffset);
     cub::DeviceSegmentedSort::SortPairs(NULL, temp_storage_bytes, out_idx, out_idx, out, out, k * batch_size,
         batch_size, transform_iter, transform_iter + 1, stream);
-    if (sorted)
+    if (packed_sort)
+    {
+        air_topk_stable::sort_packed_topk<T, IdxT>(nullptr, temp_storage_bytes_sort, nullptr, nullptr, nullptr,
+            nullptr, batch_size, k, nullptr, nullptr, select_min, stream);
+    }
+    else if (sorted)
     {
         if (select_min)
         {
@@ -1248,11 +1321,14 @@ void standalone_stable_radix_topk_(void* buf, size_t& buf_size, T const* in, Idx
         {
             sort_buffer_size = k * batch_size;
         }
+        // The packed keys, before and after the sort, take the place of the sort input.
+        size_t const sort_in_size = packed_sort ? sizeof(uint64_t) : sizeof(*sort_in);
+        size_t const sort_in_idx_size = packed_sort ? sizeof(uint64_t) : sizeof(*sort_in_idx);
         std::vector<size_t> sizes = {sizeof(*counters) * batch_size, sizeof(*histograms) * num_buckets * batch_size,
             sizeof(*buf1) * len_candidates * batch_size, sizeof(*idx_buf1) * len_candidates * batch_size,
             sizeof(*buf2) * len_candidates * batch_size, sizeof(*idx_buf2) * len_candidates * batch_size,
             temp_storage_bytes, sizeof(*topk_out) * k * batch_size, sizeof(*topk_out_idx) * k * batch_size,
-            sizeof(*sort_in) * sort_buffer_size, sizeof(*sort_in_idx) * sort_buffer_size};
+            sort_in_size * sort_buffer_size, sort_in_idx_size * sort_buffer_size};
         size_t total_size = calc_aligned_size(sizes);
         if (!buf)
         {
@@ -1310,6 +1386,14 @@ void standalone_stable_radix_topk_(void* buf, size_t& buf_size, T const* in, Idx
             in, in_idx, out_buf, out_idx_buf, topk_out, topk_out_idx, len, k, counters, select_min);
     }
 
+    if (packed_sort)
+    {
+        air_topk_stable::sort_packed_topk(sort_temp_storage, temp_storage_bytes, topk_out, topk_out_idx,
+            reinterpret_cast<uint64_t*>(sort_in), reinterpret_cast<uint64_t*>(sort_in_idx), batch_size, k, out,
+            out_idx, select_min, stream);
+        return;
+    }
+
     T* idx_sort_out = sorted ? sort_in : out;
     IdxT* idx_sort_out_idx = sorted ? sort_in_idx : out_idx;
 
@@ -1332,7 +1416,8 @@ void standalone_stable_radix_topk_(void* buf, size_t& buf_size, T const* in, Idx
 
 template <typename T, typename IdxT, int BitsPerPass, int BlockSize>
 void standalone_stable_radix_topk_one_block_(void* buf, size_t& buf_size, T const* in, IdxT const* in_idx,
-    int batch_size, IdxT len, IdxT k, T* out, IdxT* out_idx, bool select_min, cudaStream_t stream, bool sorted = false)
+    int batch_size, IdxT len, IdxT k, T* out, IdxT* out_idx, bool select_min, cudaStream_t stream, bool sorted = false,
+    bool packed_sort = false)
 {
     static_assert(air_topk_stable::calc_num_passes<T, BitsPerPass>() > 1);
 
@@ -1354,7 +1439,12 @@ void standalone_stable_radix_topk_one_block_(void* buf, size_t& buf_size, T cons
 
     cub::DeviceSegmentedSort::SortPairs(NULL, temp_storage_bytes, out_idx, out_idx, out, out, k * batch_size,
         batch_size, transform_iter, transform_iter + 1, stream);
-    if (sorted)
+    if (packed_sort)
+    {
+        air_topk_stable::sort_packed_topk<T, IdxT>(nullptr, temp_storage_bytes_sort, nullptr, nullptr, nullptr,
+            nullptr, batch_size, k, nullptr, nullptr, select_min, stream);
+    }
+    else if (sorted)
     {
         if (select_min)
         {
@@ -1376,9 +1466,12 @@ void standalone_stable_radix_topk_one_block_(void* buf, size_t& buf_size, T cons
         {
             sort_buffer_size = k * batch_size;
         }
+        // The packed keys, before and after the sort, take the place of the sort input.
+        size_t const sort_in_size = packed_sort ? sizeof(uint64_t) : sizeof(*sort_in);
+        size_t const sort_in_idx_size = packed_sort ? sizeof(uint64_t) : sizeof(*sort_in_idx);
         std::vector<size_t> sizes = {buf_len * 2 * (sizeof(T) + sizeof(IdxT)) * batch_size, temp_storage_bytes,
             sizeof(*topk_out) * k * batch_size, sizeof(*topk_out_idx) * k * batch_size,
-            sizeof(*sort_in) * sort_buffer_size, sizeof(*sort_in_idx) * sort_buffer_size};
+            sort_in_size * sort_buffer_size, sort_in_idx_size * sort_buffer_size};
         total_size = calc_aligned_size(sizes);
 
         if (!buf)
@@ -1402,6 +1495,14 @@ void standalone_stable_radix_topk_one_block_(void* buf, size_t& buf_size, T cons
     air_topk_stable::radix_topk_one_block_kernel<T, IdxT, BitsPerPass, BlockSize, true>
         <<<batch_size, BlockSize, 0, stream>>>(in, in_idx, len, k, topk_out, topk_out_idx, select_min, bufs);
 
+    if (packed_sort)
+    {
+        air_topk_stable::sort_packed_topk(sort_temp_storage, temp_storage_bytes, topk_out, topk_out_idx,
+            reinterpret_cast<uint64_t*>(sort_in), reinterpret_cast<uint64_t*>(sort_in_idx), batch_size, k, out,
+            out_idx, select_min, stream);
+        return;
+    }
+
     T* idx_sort_out = sorted ? sort_in : out;
     IdxT* idx_sort_out_idx = sorted ? sort_in_idx : out_idx;
     cub::DeviceSegmentedSort::SortPairs(sort_temp_storage, temp_storage_bytes, topk_out_idx, idx_sort_out_idx, topk_out,
@@ -1423,15 +1524,17 @@ void standalone_stable_radix_topk_one_block_(void* buf, size_t& buf_size, T cons
 
 template <typename T, typename idxT, bool sorted = false>
 void standalone_stable_radix_11bits(void* buf, size_t& buf_size, T const* in, int batch_size, idxT len, idxT k, T* out,
-    idxT* out_idx, bool greater, cudaStream_t stream = 0)
+    idxT* out_idx, bool greater, cudaStream_t stream = 0, TopkLastDimSortAlgo sort_algo = TopkLastDimSortAlgo::kAUTO)
 {
     constexpr int items_per_thread = 32;
     constexpr int block_dim = 512;
     constexpr bool fused_last_filter = false;
+    bool const packed_sort = air_topk_stable::use_packed_sort<T, idxT>(k, sorted, sort_algo);
     if (len <= block_dim * items_per_thread)
     {
         standalone_stable_radix_topk_one_block_<T, idxT, 11, block_dim>(
-            buf, buf_size, in, static_cast<idxT*>(nullptr), batch_size, len, k, out, out_idx, !greater, stream, sorted);
+            buf, buf_size, in, static_cast<idxT*>(nullptr), batch_size, len, k, out, out_idx, !greater, stream, sorted,
+            packed_sort);
     }
     else
     {
@@ -1441,12 +1544,12 @@ void standalone_stable_radix_11bits(void* buf, size_t& buf_size, T const* in, in
         if (grid_dim == 1)
         {
             standalone_stable_radix_topk_one_block_<T, idxT, 11, block_dim>(buf, buf_size, in,
-                static_cast<idxT*>(nullptr), batch_size, len, k, out, out_idx, !greater, stream, sorted);
+                static_cast<idxT*>(nullptr), batch_size, len, k, out, out_idx, !greater, stream, sorted, packed_sort);
         }
         else
         {
             standalone_stable_radix_topk_<T, idxT, 11, block_dim>(buf, buf_size, in, static_cast<idxT*>(nullptr),
-                batch_size, len, k, out, out_idx, !greater, fused_last_filter, grid_dim, stream, sorted);
+                batch_size, len, k, out, out_idx, !greater, fused_last_filter, grid_dim, stream, sorted, packed_sort);
         }
     }
 }
@@ -1457,7 +1560,7 @@ void standalone_stable_radix_11bits(void* buf, size_t& buf_size, T const* in, in
 
 template <typename T>
 size_t invokeComputeTopkLastDimWorkspaceSize(
-    SizeType32 batchSize, SizeType32 inputLength, SizeType32 k, bool is_largest)
+    SizeType32 batchSize, SizeType32 inputLength, SizeType32 k, bool is_largest, TopkLastDimSortAlgo sortAlgo)
 {
     size_t buf_size = 0;
     void* workspace = nullptr;
@@ -1465,13 +1568,13 @@ size_t invokeComputeTopkLastDimWorkspaceSize(
     T* out_val = nullptr;
     SizeType32* out_idx = nullptr;
     standalone_stable_radix_11bits<T, SizeType32, true>(
-        workspace, buf_size, in, batchSize, inputLength, k, out_val, out_idx, is_largest, 0);
+        workspace, buf_size, in, batchSize, inputLength, k, out_val, out_idx, is_largest, 0, sortAlgo);
     return buf_size;
 }
 
 #define INSTANTIATE_COMPUTE_TOPK_LastDim_WORKSPACE_SIZE_DATA_TYPE(T)                                                   \
     template size_t invokeComputeTopkLastDimWorkspaceSize<T>(                                                          \
-        SizeType32 batchSize, SizeType32 inputLength, SizeType32 k, bool is_largest)
+        SizeType32 batchSize, SizeType32 inputLength, SizeType32 k, bool is_largest, TopkLastDimSortAlgo sortAlgo)
 
 INSTANTIATE_COMPUTE_TOPK_LastDim_WORKSPACE_SIZE_DATA_TYPE(int);
 INSTANTIATE_COMPUTE_TOPK_LastDim_WORKSPACE_SIZE_DATA_TYPE(float);
@@ -1488,20 +1591,20 @@ INSTANTIATE_COMPUTE_TOPK_LastDim_WORKSPACE_SIZE_DATA_TYPE(__nv_bfloat16);
 template <typename T>
 void invokeTopkLastDim(SizeType32 batchSize, SizeType32 inputLength, SizeType32 k, bool is_largest,
     void const* __restrict__ input, void* __restrict__ out_val, void* __restrict__ out_idx, void* workspace,
-    cudaStream_t stream)
+    cudaStream_t stream, TopkLastDimSortAlgo sortAlgo)
 {
     size_t buf_size = 0; // will be overwritten by the kernel
     T const* in = reinterpret_cast<T const*>(input);
     T* out_val_ = reinterpret_cast<T*>(out_val);
     SizeType32* out_idx_ = reinterpret_cast<SizeType32*>(out_idx);
     standalone_stable_radix_11bits<T, SizeType32, true>(
-        workspace, buf_size, in, batchSize, inputLength, k, out_val_, out_idx_, is_largest, stream);
+        workspace, buf_size, in, batchSize, inputLength, k, out_val_, out_idx_, is_largest, stream, sortAlgo);
 }
 
 #define INSTANTIATE_TOPK_LastDim_DATA_TYPE(T)                                                                          \
     template void invokeTopkLastDim<T>(SizeType32 batchSize, SizeType32 inputLength, SizeType32 k, bool is_largest,    \
         void const* __restrict__ input, void* __restrict__ out_val, void* __restrict__ out_idx, void* workspace,       \
-        cudaStream_t stream)
+        cudaStream_t stream, TopkLastDimSortAlgo sortAlgo)
 
 INSTANTIATE_TOPK_LastDim_DATA_TYPE(int);
 INSTANTIATE_TOPK_LastDim_DATA_TYPE(float);
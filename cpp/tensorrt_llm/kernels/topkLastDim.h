@@ -25,14 +25,31 @@ namespace tensorrt_llm
 namespace kernels
 {
 
+//! \brief How the selected top-k elements of every row are sorted by value, ties ordered by index.
+enum class TopkLastDimSortAlgo
+{
+    //! kPACKED from kMinKForPackedTopkSort elements, kSEGMENTED below.
+    kAUTO = 0,
+    //! A segmented sort by index, then a stable segmented sort by value.
+    kSEGMENTED = 1,
+    //! A single segmented sort of 64-bit keys packing the value and the index, only for 32-bit and smaller types.
+    kPACKED = 2,
+};
+
+//! \brief Smallest k sorted with TopkLastDimSortAlgo::kPACKED by TopkLastDimSortAlgo::kAUTO, see the decoding micro
+//! benchmark.
+constexpr runtime::SizeType32 kMinKForPackedTopkSort = 64;
+
 template <typename T>
-size_t invokeComputeTopkLastDimWorkspaceSize(
-    runtime::SizeType32 batchSize, runtime::SizeType32 inputLength, runtime::SizeType32 k, bool is_largest);
+size_t invokeComputeTopkLastDimWorkspaceSize(runtime::SizeType32 batchSize, runtime::SizeType32 inputLength,
+    runtime::SizeType32 k, bool is_largest, TopkLastDimSortAlgo sortAlgo = TopkLastDimSortAlgo::kAUTO);
 
+//! \brief The k largest or smallest elements of every row of input [batchSize, inputLength], sorted, with their
+//! indices. The workspace is sized by invokeComputeTopkLastDimWorkspaceSize with the same arguments.
 template <typename T>
 void invokeTopkLastDim(runtime::SizeType32 batchSize, runtime::SizeType32 inputLength, runtime::SizeType32 k,
     bool is_largest, void const* __restrict__ input, void* __restrict__ out_val, void* __restrict__ out_ind,
-    void* workspace, cudaStream_t stream);
+    void* workspace, cudaStream_t stream, TopkLastDimSortAlgo sortAlgo = TopkLastDimSortAlgo::kAUTO);
 
 } // namespace kernels
 } // namespace tensorrt_llm
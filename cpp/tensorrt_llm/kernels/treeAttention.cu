@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/treeAttention.h"
+
+#include <cfloat>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+namespace
+{
+
+int32_t constexpr kWarpSize = 32;
+int32_t constexpr kNumWarps = 4;
+// Rows (tree node, query head) of a warp. Their softmax states stay in registers over the whole KV loop.
+int32_t constexpr kRowsPerWarp = 4;
+int32_t constexpr kChunkRows = kNumWarps * kRowsPerWarp;
+// Tokens of a KV tile, one per lane when the scores are computed.
+int32_t constexpr kTileTokens = kWarpSize;
+
+template <int32_t HEAD_SIZE>
+struct TreeAttentionSmem
+{
+    float q[kChunkRows][HEAD_SIZE];
+    // Padded so that the lanes reading one channel of different tokens do not share a bank.
+    float k[kTileTokens][HEAD_SIZE + 1];
+    float v[kTileTokens][HEAD_SIZE];
+};
+
+__device__ __forceinline__ float warpMax(float val)
+{
+#pragma unroll
+    for (int32_t mask = kWarpSize / 2; mask > 0; mask >>= 1)
+    {
+        val = fmaxf(val, __shfl_xor_sync(0xffffffff, val, mask));
+    }
+    return val;
+}
+
+__device__ __forceinline__ float warpSum(float val)
+{
+#pragma unroll
+    for (int32_t mask = kWarpSize / 2; mask > 0; mask >>= 1)
+    {
+        val += __shfl_xor_sync(0xffffffff, val, mask);
+    }
+    return val;
+}
+
+// grid [numKvHeads, batchSize], block [kNumWarps * kWarpSize].
+template <typename T, int32_t HEAD_SIZE, typename KVCacheBuffer>
+__global__ void __launch_bounds__(kNumWarps* kWarpSize)
+    treeAttentionKernel(TreeAttentionParams<T> params, KVCacheBuffer kvCache)
+{
+    int32_t constexpr kChannelsPerLane = HEAD_SIZE / kWarpSize;
+    __shared__ TreeAttentionSmem<HEAD_SIZE> smem;
+
+    auto const kvHeadIdx = static_cast<int32_t>(blockIdx.x);
+    auto const batchIdx = static_cast<int32_t>(blockIdx.y);
+    auto const warpIdx = static_cast<int32_t>(threadIdx.x) / kWarpSize;
+    auto const laneIdx = static_cast<int32_t>(threadIdx.x) % kWarpSize;
+
+    auto const groupSize = params.numHeads / params.numKvHeads;
+    auto const pastKvLength = params.pastKvLengths[batchIdx];
+    auto const numNodes = params.generationLengths[batchIdx];
+    auto const kvLength = pastKvLength + numNodes;
+    auto const numRows = numNodes * groupSize;
+    auto const numMaskWords = (params.maxDecodingTokens + 31) / 32;
+
+    auto const* packedMask
+        = params.packedMask + static_cast<size_t>(batchIdx) * params.maxDecodingTokens * numMaskWords;
+
+    for (int32_t chunkStart = 0; chunkStart < numRows; chunkStart += kChunkRows)
+    {
+        // Load the scaled queries of the chunk.
+        __syncthreads();
+        for (auto idx = static_cast<int32_t>(threadIdx.x); idx < kChunkRows * HEAD_SIZE; idx += blockDim.x)
+        {
+            auto const localRow = idx / HEAD_SIZE;
+            auto const channel = idx % HEAD_SIZE;
+            auto const row = chunkStart + localRow;
+            float value = 0.f;
+            if (row < numRows)
+            {
+                auto const nodeIdx = row / groupSize;
+                auto const headIdx = kvHeadIdx * groupSize + row % groupSize;
+                auto const tokenOffset = static_cast<size_t>(batchIdx) * params.maxDecodingTokens + nodeIdx;
+                auto const offset = (tokenOffset * params.numHeads + headIdx) * HEAD_SIZE + channel;
+                value = cuda_cast<float>(params.q[offset]) * params.qScale;
+            }
+            smem.q[localRow][channel] = value;
+        }
+
+        float rowMax[kRowsPerWarp];
+        float rowSum[kRowsPerWarp];
+        float acc[kRowsPerWarp][kChannelsPerLane];
+#pragma unroll
+        for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+        {
+            rowMax[ri] = -FLT_MAX;
+            rowSum[ri] = 0.f;
+#pragma unroll
+            for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+            {
+                acc[ri][ci] = 0.f;
+            }
+        }
+
+        for (int32_t tileStart = 0; tileStart < kvLength; tileStart += kTileTokens)
+        {
+            // Load the tile once for all rows of the chunk.
+            __syncthreads();
+            for (auto idx = static_cast<int32_t>(threadIdx.x); idx < kTileTokens * HEAD_SIZE; idx += blockDim.x)
+            {
+                auto const tokenOffset = idx / HEAD_SIZE;
+                auto const channel = idx % HEAD_SIZE;
+                auto const tokenIdx = tileStart + tokenOffset;
+                float kValue = 0.f;
+                float vValue = 0.f;
+                if (tokenIdx < kvLength)
+                {
+                    auto const cacheTokenIdx = kvCache.getKVTokenIdx(tokenIdx);
+                    auto const localIdx = kvCache.getKVLocalIdx(cacheTokenIdx, kvHeadIdx, HEAD_SIZE, channel);
+                    kValue = cuda_cast<float>(
+                        reinterpret_cast<T const*>(kvCache.getKBlockPtr(batchIdx, cacheTokenIdx))[localIdx]);
+                    vValue = cuda_cast<float>(
+                        reinterpret_cast<T const*>(kvCache.getVBlockPtr(batchIdx, cacheTokenIdx))[localIdx]);
+                }
+                smem.k[tokenOffset][channel] = kValue;
+                smem.v[tokenOffset][channel] = vValue;
+            }
+            __syncthreads();
+
+            auto const tokenIdx = tileStart + laneIdx;
+#pragma unroll
+            for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+            {
+                auto const localRow = warpIdx * kRowsPerWarp + ri;
+                auto const row = chunkStart + localRow;
+                if (row >= numRows)
+                {
+                    continue;
+                }
+                // The prefix is visible to all nodes, a tree node only to the nodes of its subtree.
+                bool visible = tokenIdx < kvLength;
+                if (visible && tokenIdx >= pastKvLength)
+                {
+                    auto const nodeIdx = row / groupSize;
+                    auto const treeIdx = tokenIdx - pastKvLength;
+                    auto const maskWord = packedMask[nodeIdx * numMaskWords + treeIdx / 32];
+                    visible = (maskWord >> (treeIdx % 32)) & 1;
+                }
+                float score = -FLT_MAX;
+                if (visible)
+                {
+                    score = 0.f;
+#pragma unroll 16
+                    for (int32_t channel = 0; channel < HEAD_SIZE; ++channel)
+                    {
+                        score += smem.q[localRow][channel] * smem.k[laneIdx][channel];
+                    }
+                }
+
+                auto const tileMax = warpMax(score);
+                if (tileMax == -FLT_MAX)
+                {
+                    continue;
+                }
+                auto const newMax = fmaxf(rowMax[ri], tileMax);
+                auto const correction = __expf(rowMax[ri] - newMax);
+                auto const prob = visible ? __expf(score - newMax) : 0.f;
+                rowSum[ri] = rowSum[ri] * correction + warpSum(prob);
+                rowMax[ri] = newMax;
+#pragma unroll
+                for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+                {
+                    acc[ri][ci] *= correction;
+                }
+                for (int32_t ti = 0; ti < kTileTokens; ++ti)
+                {
+                    auto const p = __shfl_sync(0xffffffff, prob, ti);
+#pragma unroll
+                    for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+                    {
+                        acc[ri][ci] += p * smem.v[ti][ci * kWarpSize + laneIdx];
+                    }
+                }
+            }
+        }
+
+#pragma unroll
+        for (int32_t ri = 0; ri < kRowsPerWarp; ++ri)
+        {
+            auto const row = chunkStart + warpIdx * kRowsPerWarp + ri;
+            if (row >= numRows)
+            {
+                continue;
+            }
+            auto const nodeIdx = row / groupSize;
+            auto const headIdx = kvHeadIdx * groupSize + row % groupSize;
+            auto const invSum = rowSum[ri] > 0.f ? 1.f / rowSum[ri] : 0.f;
+            auto const tokenOffset = static_cast<size_t>(batchIdx) * params.maxDecodingTokens + nodeIdx;
+            auto* out = params.out + (tokenOffset * params.numHeads + headIdx) * HEAD_SIZE;
+#pragma unroll
+            for (int32_t ci = 0; ci < kChannelsPerLane; ++ci)
+            {
+                out[ci * kWarpSize + laneIdx] = cuda_cast<T>(acc[ri][ci] * invSum);
+            }
+        }
+    }
+}
+
+template <typename T, int32_t HEAD_SIZE, typename KVCacheBuffer>
+void launchTreeAttention(TreeAttentionParams<T> const& params, KVCacheBuffer const& kvCache, cudaStream_t stream)
+{
+    dim3 const grid(params.numKvHeads, params.batchSize);
+    treeAttentionKernel<T, HEAD_SIZE, KVCacheBuffer><<<grid, kNumWarps * kWarpSize, 0, stream>>>(params, kvCache);
+}
+
+} // namespace
+
+template <typename T, typename KVCacheBuffer>
+void invokeTreeAttention(TreeAttentionParams<T> const& params, KVCacheBuffer const& kvCache, cudaStream_t stream)
+{
+    params.checkParams();
+    switch (params.headSize)
+    {
+    case 64: launchTreeAttention<T, 64>(params, kvCache, stream); break;
+    case 128: launchTreeAttention<T, 128>(params, kvCache, stream); break;
+    default: TLLM_THROW("Unsupported head size %d", params.headSize);
+    }
+
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_TREE_ATTENTION(T)                                                                                  \
+    template void invokeTreeAttention<T, KVBlockArray>(                                                                \
+        TreeAttentionParams<T> const& params, KVBlockArray const& kvCache, cudaStream_t stream);                       \
+    template void invokeTreeAttention<T, KVLinearBuffer>(                                                              \
+        TreeAttentionParams<T> const& params, KVLinearBuffer const& kvCache, cudaStream_t stream);
+
+INSTANTIATE_TREE_ATTENTION(float);
+INSTANTIATE_TREE_ATTENTION(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_TREE_ATTENTION(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_TREE_ATTENTION
+
+} // namespace tensorrt_llm::kernels
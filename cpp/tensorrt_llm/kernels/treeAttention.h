@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/kernels/kvCacheUtils.h"
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+template <typename T>
+struct TreeAttentionParams
+{
+    // Queries of the tree nodes after the rotary embedding [batchSize, maxDecodingTokens, numHeads, headSize].
+    T const* q{nullptr};
+    // Output [batchSize, maxDecodingTokens, numHeads, headSize].
+    T* out{nullptr};
+    // Number of cached tokens before the tree [batchSize]. The K and V of the tree nodes follow them in the cache.
+    int32_t const* pastKvLengths{nullptr};
+    // Number of tree nodes [batchSize], at most maxDecodingTokens.
+    int32_t const* generationLengths{nullptr};
+    // Tree mask of the nodes [batchSize, maxDecodingTokens, divUp(maxDecodingTokens, 32)], the layout of
+    // specDecodingPackedMasks. Bit j of node i is set if node i attends node j.
+    int32_t const* packedMask{nullptr};
+    int32_t batchSize{0};
+    int32_t maxDecodingTokens{0};
+    int32_t numHeads{0};
+    int32_t numKvHeads{0};
+    int32_t headSize{0};
+    // Scale of the attention scores, usually 1 / sqrt(headSize).
+    float qScale{1.f};
+
+    void checkParams() const
+    {
+        TLLM_CHECK(q && out && pastKvLengths && generationLengths && packedMask);
+        TLLM_CHECK(batchSize > 0 && maxDecodingTokens > 0);
+        TLLM_CHECK(numKvHeads > 0 && numHeads % numKvHeads == 0);
+        TLLM_CHECK_WITH_INFO(headSize == 64 || headSize == 128, "Tree attention supports head sizes 64 and 128");
+    }
+};
+
+//! \brief Attention of all nodes of the draft trees of a verification step, in one pass over the KV cache.
+//! A block handles all nodes of one sequence and the query heads of one KV head: every tile of the cached prefix is
+//! loaded to shared memory once and scored against a chunk of nodes, and the tree part of the cache is masked with the
+//! bits of the packed mask while the scores are computed, so no general mask is materialized. For deep trees the cost
+//! is close to the one of a single-token decoding step of the prefix. The KV cache must hold T, without quantization,
+//! and the K and V of the tree nodes must be in the cache, e.g. written by invokeQKVPreprocessing.
+template <typename T, typename KVCacheBuffer>
+void invokeTreeAttention(TreeAttentionParams<T> const& params, KVCacheBuffer const& kvCache, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
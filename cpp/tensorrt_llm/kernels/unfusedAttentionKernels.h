@@ -15,6 +15,7 @@
  */
 #pragma once
 
+#include "tensorrt_llm/common/quantization.h"
 #include "tensorrt_llm/kernels/gptKernels.h"
 #include "tensorrt_llm/kernels/kvCacheUtils.h"
 #include "tensorrt_llm/kernels/mlaKernels.h"
@@ -67,6 +68,19 @@ enum class KvCacheDataType
     NVFP4
 };
 
+inline KvCacheDataType getKvCacheDataType(common::QuantMode const& kvCacheQuantMode)
+{
+    if (kvCacheQuantMode.hasInt8KvCache())
+    {
+        return KvCacheDataType::INT8;
+    }
+    if (kvCacheQuantMode.hasFp8KvCache())
+    {
+        return KvCacheDataType::FP8;
+    }
+    return kvCacheQuantMode.hasFp4KvCache() ? KvCacheDataType::NVFP4 : KvCacheDataType::BASE;
+}
+
 enum class RotaryPositionEmbeddingType
 {
     NONE = 0,
@@ -140,6 +154,7 @@ struct QKVPreprocessingParams
     // the pre-computed RoPE factors. computed at model build time, stored in the engine
     // shape is {rotary_embedding_max_positions, rotary_embedding_dim}. eg (2048, 128)
     float2 const* rotary_coef_cache_buffer{nullptr};
+    // Scale of the INT8/FP8 KV cache, [1] or [kv_head_num] if kv_scale_per_head.
     float const* kvScaleOrigQuant{nullptr};
     // Pair of floats on the GPU corresponding to the second level K/V scale for
     // FP4 KV cache quantization.
@@ -173,6 +188,8 @@ struct QKVPreprocessingParams
     KvCacheDataType cache_type{};
     bool separate_q_kv_output{false};
     bool quantized_fp8_output{false};
+    // Quantize the KV cache of every KV head with its own scale, see kvScaleOrigQuant.
+    bool kv_scale_per_head{false};
     bool generation_phase{false};
     int multi_processor_count{0};
     int rotary_vision_start{0};
@@ -183,6 +200,11 @@ struct QKVPreprocessingParams
     int kv_hidden_size{0};
     int hidden_size{0};
 
+    __device__ __host__ int getKvScaleIdx(int kv_head_idx) const
+    {
+        return kv_scale_per_head ? kv_head_idx : 0;
+    }
+
     void setCommonParameters()
     {
         half_rotary_dim = rotary_embedding_dim / 2;
@@ -247,6 +269,7 @@ struct QKVPreprocessingParams
         ss << "cache_type: " << static_cast<int>(cache_type) << std::endl;
         ss << "separate_q_kv_output: " << std::boolalpha << separate_q_kv_output << std::endl;
         ss << "quantized_fp8_output: " << quantized_fp8_output << std::endl;
+        ss << "kv_scale_per_head: " << kv_scale_per_head << std::endl;
         ss << "generation_phase: " << generation_phase << std::endl;
         ss << "multi_processor_count: " << multi_processor_count << std::endl;
 
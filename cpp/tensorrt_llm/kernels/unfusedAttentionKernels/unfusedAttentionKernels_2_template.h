@@ -20,6 +20,7 @@
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/cudaTypeUtils.cuh"
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/pdlUtils.cuh"
 #include "tensorrt_llm/common/reduceKernelUtils.cuh"
 #include "tensorrt_llm/kernels/decoderMaskedMultiheadAttentionUtils.h"
 #include "tensorrt_llm/kernels/gptKernels.h"
@@ -353,6 +354,10 @@ __global__ void applyBiasRopeUpdateKVCache(QKVPreprocessingParams<T, KVCacheBuff
     //  1. Contiguous QKV output.
     //  2. Contiguous Q output + Paged KV output (needed by Paged KV FMHA kernels).
 
+    // The QKV of the GEMM before, and the KV cache for the attention after.
+    pdlWaitPrimaryGrid();
+    pdlLaunchDependents();
+
     // VEC_SIZE is power of 2.
     constexpr int VEC_SIZE = Rotary_vec_t<T, Dh_MAX>::size;
     using VecType = typename Rotary_vec_t<T, Dh_MAX>::Type;
@@ -578,8 +583,8 @@ __global__ void applyBiasRopeUpdateKVCache(QKVPreprocessingParams<T, KVCacheBuff
                 [[maybe_unused]] TScale scaleOrigQuant;
                 if constexpr (FP8_OUTPUT || ENABLE_8BITS_CACHE)
                 {
-                    mmha::convert_from_float(
-                        &scaleOrigQuant, params.kvScaleOrigQuant ? params.kvScaleOrigQuant[0] : 1.0f);
+                    mmha::convert_from_float(&scaleOrigQuant,
+                        params.kvScaleOrigQuant ? params.kvScaleOrigQuant[params.getKvScaleIdx(kv_head_idx)] : 1.0f);
                 }
 
                 if constexpr (FP8_OUTPUT)
@@ -723,6 +728,10 @@ __global__ void applyBiasRopeUpdateKVCacheV2(QKVPreprocessingParams<T, KVCacheBu
     //  1. Contiguous QKV output.
     //  2. Contiguous Q output + Paged KV output (needed by Paged KV FMHA kernels).
 
+    // The QKV of the GEMM before, and the KV cache for the attention after.
+    pdlWaitPrimaryGrid();
+    pdlLaunchDependents();
+
     // Constants.
     using VecT = typename VecType<T>::Type;
     // Quantized output only supports fp8 currently.
@@ -770,6 +779,8 @@ __global__ void applyBiasRopeUpdateKVCacheV2(QKVPreprocessingParams<T, KVCacheBu
     int const src_v_offset = src_k_offset + params.kv_hidden_size;
 
     int const rotated_head_dim_offset = first_half ? params.half_rotary_dim : -params.half_rotary_dim;
+    [[maybe_unused]] bool const dynamic_rotary_scaling = params.rotary_scale_type == RotaryScalingType::kDYNAMIC
+        && params.max_input_seq_len > params.rotary_embedding_max_positions;
     // Make sure there are multiple of tokens_per_block otherwise syncthreads will lead to deadlocks.
     int const tokens_loop_end = int((params.token_num + TOKENS_PER_BLOCK - 1) / TOKENS_PER_BLOCK) * TOKENS_PER_BLOCK;
 
@@ -857,6 +868,11 @@ __global__ void applyBiasRopeUpdateKVCacheV2(QKVPreprocessingParams<T, KVCacheBu
 
         // Cos/sin cache.
         [[maybe_unused]] float2 const* rotary_coef_cache_buffer = nullptr;
+        // Positions past the cache, dynamic scaling and missing caches compute the cos/sin on the fly from the inverse
+        // frequencies as the v1 kernel does, so that long sequences do not need another pass over the QKV.
+        [[maybe_unused]] bool recompute_rotary_coef = false;
+        [[maybe_unused]] float const* rotary_inv_freq_buffer = nullptr;
+        [[maybe_unused]] float recompute_rotary_position = 0.f;
         if (params.mrope_rotary_cos_sin != nullptr)
         {
             rotary_coef_cache_buffer = params.mrope_rotary_cos_sin
@@ -865,13 +881,51 @@ __global__ void applyBiasRopeUpdateKVCacheV2(QKVPreprocessingParams<T, KVCacheBu
         }
         else
         {
-            rotary_coef_cache_buffer
-                = params.rotary_coef_cache_buffer + static_cast<size_t>(rotary_position) * params.half_rotary_dim;
+            recompute_rotary_coef = dynamic_rotary_scaling || params.rotary_coef_cache_buffer == nullptr
+                || rotary_position >= params.rotary_embedding_max_positions;
+            if (recompute_rotary_coef)
+            {
+                // Dynamic rotary scaling might have different inv_freq values for different sequences.
+                rotary_inv_freq_buffer = params.rotary_embedding_inv_freq
+                    + (dynamic_rotary_scaling ? static_cast<size_t>(batch_idx) * params.half_rotary_dim : 0);
+                int real_rotary_position = rotary_position
+                    + (params.mrope_position_deltas != nullptr ? params.mrope_position_deltas[batch_idx] : 0);
+                if constexpr (ROTARY_TYPE == RotaryPositionEmbeddingType::GPT_NEOX)
+                {
+                    if (params.rotary_vision_start != -1 && params.rotary_vision_length != -1)
+                    {
+                        if (real_rotary_position > params.rotary_vision_start
+                            && real_rotary_position <= params.rotary_vision_start + params.rotary_vision_length)
+                        {
+                            real_rotary_position = params.rotary_vision_start + 1;
+                        }
+                        else if (real_rotary_position > params.rotary_vision_start)
+                        {
+                            real_rotary_position -= params.rotary_vision_length - 1;
+                        }
+                    }
+                }
+                recompute_rotary_position = float(real_rotary_position);
+            }
+            else
+            {
+                rotary_coef_cache_buffer
+                    = params.rotary_coef_cache_buffer + static_cast<size_t>(rotary_position) * params.half_rotary_dim;
+            }
         }
+        [[maybe_unused]] auto const load_rotary_coef = [&](int rotary_dim_idx, int elt_id)
+        {
+            if (recompute_rotary_coef)
+            {
+                float const rotary_inv_freq = recompute_rotary_position
+                    * rotary_inv_freq_buffer[min(rotary_dim_idx + elt_id, params.half_rotary_dim - 1)];
+                return make_float2(cosf(rotary_inv_freq), sinf(rotary_inv_freq));
+            }
+            return rotary_coef_cache_buffer[rotary_dim_idx + elt_id];
+        };
 
         if constexpr (ROTARY_TYPE == RotaryPositionEmbeddingType::GPT_NEOX)
         {
-            rotary_coef_cache_buffer += gptneox_rotary_dim_idx;
 #pragma unroll
             for (int elt_id = 0; elt_id < ELTS_PER_VEC; elt_id++)
             {
@@ -882,7 +936,7 @@ __global__ void applyBiasRopeUpdateKVCacheV2(QKVPreprocessingParams<T, KVCacheBu
 
                 // Load cos/sin from cache.
                 float2 rotary_coef_cache
-                    = valid_rotary_dim_idx ? rotary_coef_cache_buffer[elt_id] : masked_rotary_cos_sin;
+                    = valid_rotary_dim_idx ? load_rotary_coef(gptneox_rotary_dim_idx, elt_id) : masked_rotary_cos_sin;
 
                 // Preprocess sin for second half rotary dim.
                 rotary_coef_cache.y = first_half ? -rotary_coef_cache.y : rotary_coef_cache.y;
@@ -891,7 +945,6 @@ __global__ void applyBiasRopeUpdateKVCacheV2(QKVPreprocessingParams<T, KVCacheBu
         }
         else if constexpr (ROTARY_TYPE == RotaryPositionEmbeddingType::GPTJ)
         {
-            rotary_coef_cache_buffer += gptj_rotary_dim_idx;
 // Pack two elements into one for gptj rotary embedding.
 #pragma unroll
             for (int elt_id = 0; elt_id < ELTS_PER_VEC / 2; elt_id++)
@@ -901,7 +954,7 @@ __global__ void applyBiasRopeUpdateKVCacheV2(QKVPreprocessingParams<T, KVCacheBu
 
                 // Load cos/sin from cache.
                 float2 rotary_coef_cache
-                    = valid_rotary_dim_idx ? rotary_coef_cache_buffer[elt_id] : masked_rotary_cos_sin;
+                    = valid_rotary_dim_idx ? load_rotary_coef(gptj_rotary_dim_idx, elt_id) : masked_rotary_cos_sin;
                 mmha::apply_rotary_embedding_gptj(q_, k_, rotary_coef_cache);
             }
         }
@@ -965,7 +1018,8 @@ __global__ void applyBiasRopeUpdateKVCacheV2(QKVPreprocessingParams<T, KVCacheBu
             [[maybe_unused]] TScale scaleOrigQuant;
             if constexpr (FP8_OUTPUT || ENABLE_8BITS_CACHE)
             {
-                mmha::convert_from_float(&scaleOrigQuant, params.kvScaleOrigQuant ? params.kvScaleOrigQuant[0] : 1.0f);
+                mmha::convert_from_float(&scaleOrigQuant,
+                    params.kvScaleOrigQuant ? params.kvScaleOrigQuant[params.getKvScaleIdx(kv_head_idx)] : 1.0f);
             }
 
             if constexpr (FP8_OUTPUT)
@@ -1010,7 +1064,8 @@ __global__ void applyBiasRopeUpdateKVCacheV2(QKVPreprocessingParams<T, KVCacheBu
                         // Cast float scale to dst data type.
                         using TScale = typename mmha::kv_cache_scale_type_t<T, TCache>::Type;
                         TScale scaleOrigQuant;
-                        mmha::convert_from_float(&scaleOrigQuant, params.kvScaleOrigQuant[0]);
+                        mmha::convert_from_float(
+                            &scaleOrigQuant, params.kvScaleOrigQuant[params.getKvScaleIdx(kv_head_idx)]);
                         // Store 8bits kv cache.
                         mmha::store_8bits_vec(kDst, k, inBlockIdx, scaleOrigQuant);
                         mmha::store_8bits_vec(vDst, v, inBlockIdx, scaleOrigQuant);
@@ -1051,21 +1106,21 @@ __global__ void applyBiasRopeUpdateKVCacheV2(QKVPreprocessingParams<T, KVCacheBu
         || params.position_embedding_type == PositionEmbeddingType::kLONG_ROPE                                         \
         || params.position_embedding_type == PositionEmbeddingType::kROPE_M)                                           \
     {                                                                                                                  \
-        applyBiasRopeUpdateKVCache<T, TCache, Dh_MAX, ADD_BIAS, STORE_QKV, KVCacheBuffer,                              \
-            RotaryPositionEmbeddingType::GPT_NEOX, DYNAMIC_ROTARY_SCALING, FP8_OUTPUT, GEN_PHASE>                      \
-            <<<grid, block, 0, stream>>>(params);                                                                      \
+        launchWithPdl(applyBiasRopeUpdateKVCache<T, TCache, Dh_MAX, ADD_BIAS, STORE_QKV, KVCacheBuffer,                \
+                          RotaryPositionEmbeddingType::GPT_NEOX, DYNAMIC_ROTARY_SCALING, FP8_OUTPUT, GEN_PHASE>,       \
+            grid, block, 0, stream, params);                                                                           \
     }                                                                                                                  \
     else if (params.position_embedding_type == PositionEmbeddingType::kROPE_GPTJ)                                      \
     {                                                                                                                  \
-        applyBiasRopeUpdateKVCache<T, TCache, Dh_MAX, ADD_BIAS, STORE_QKV, KVCacheBuffer,                              \
-            RotaryPositionEmbeddingType::GPTJ, DYNAMIC_ROTARY_SCALING, FP8_OUTPUT, GEN_PHASE>                          \
-            <<<grid, block, 0, stream>>>(params);                                                                      \
+        launchWithPdl(applyBiasRopeUpdateKVCache<T, TCache, Dh_MAX, ADD_BIAS, STORE_QKV, KVCacheBuffer,                \
+                          RotaryPositionEmbeddingType::GPTJ, DYNAMIC_ROTARY_SCALING, FP8_OUTPUT, GEN_PHASE>,           \
+            grid, block, 0, stream, params);                                                                           \
     }                                                                                                                  \
     else                                                                                                               \
     {                                                                                                                  \
-        applyBiasRopeUpdateKVCache<T, TCache, Dh_MAX, ADD_BIAS, STORE_QKV, KVCacheBuffer,                              \
-            RotaryPositionEmbeddingType::NONE, DYNAMIC_ROTARY_SCALING, FP8_OUTPUT, GEN_PHASE>                          \
-            <<<grid, block, 0, stream>>>(params);                                                                      \
+        launchWithPdl(applyBiasRopeUpdateKVCache<T, TCache, Dh_MAX, ADD_BIAS, STORE_QKV, KVCacheBuffer,                \
+                          RotaryPositionEmbeddingType::NONE, DYNAMIC_ROTARY_SCALING, FP8_OUTPUT, GEN_PHASE>,           \
+            grid, block, 0, stream, params);                                                                           \
     }
 
 #define DYNAMIC_ROTARY_SCALING_AND_FP8_OUTPUT_DISPATCH(ADD_BIAS, GEN_PHASE, STORE_QKV)                                 \
@@ -1205,18 +1260,21 @@ void kernelV1Dispatch(QKVPreprocessingParams<T, KVCacheBuffer> params, cudaStrea
         || params.position_embedding_type == PositionEmbeddingType::kLONG_ROPE                                         \
         || params.position_embedding_type == PositionEmbeddingType::kROPE_M)                                           \
     {                                                                                                                  \
-        applyBiasRopeUpdateKVCacheV2<T, TCache, BLOCK_SIZE, Dh, ADD_BIAS, STORE_QKV, FP8_OUTPUT, GEN_PHASE,            \
-            KVCacheBuffer, RotaryPositionEmbeddingType::GPT_NEOX><<<grid, block, 0, stream>>>(params);                 \
+        launchWithPdl(applyBiasRopeUpdateKVCacheV2<T, TCache, BLOCK_SIZE, Dh, ADD_BIAS, STORE_QKV, FP8_OUTPUT,         \
+                          GEN_PHASE, KVCacheBuffer, RotaryPositionEmbeddingType::GPT_NEOX>,                            \
+            grid, block, 0, stream, params);                                                                           \
     }                                                                                                                  \
     else if (params.position_embedding_type == PositionEmbeddingType::kROPE_GPTJ)                                      \
     {                                                                                                                  \
-        applyBiasRopeUpdateKVCacheV2<T, TCache, BLOCK_SIZE, Dh, ADD_BIAS, STORE_QKV, FP8_OUTPUT, GEN_PHASE,            \
-            KVCacheBuffer, RotaryPositionEmbeddingType::GPTJ><<<grid, block, 0, stream>>>(params);                     \
+        launchWithPdl(applyBiasRopeUpdateKVCacheV2<T, TCache, BLOCK_SIZE, Dh, ADD_BIAS, STORE_QKV, FP8_OUTPUT,         \
+                          GEN_PHASE, KVCacheBuffer, RotaryPositionEmbeddingType::GPTJ>,                                \
+            grid, block, 0, stream, params);                                                                           \
     }                                                                                                                  \
     else                                                                                                               \
     {                                                                                                                  \
-        applyBiasRopeUpdateKVCacheV2<T, TCache, BLOCK_SIZE, Dh, ADD_BIAS, STORE_QKV, FP8_OUTPUT, GEN_PHASE,            \
-            KVCacheBuffer, RotaryPositionEmbeddingType::NONE><<<grid, block, 0, stream>>>(params);                     \
+        launchWithPdl(applyBiasRopeUpdateKVCacheV2<T, TCache, BLOCK_SIZE, Dh, ADD_BIAS, STORE_QKV, FP8_OUTPUT,         \
+                          GEN_PHASE, KVCacheBuffer, RotaryPositionEmbeddingType::NONE>,                                \
+            grid, block, 0, stream, params);                                                                           \
     }
 
 #define STORE_QKV_AND_FP8_OUTPUT_DISPATCH(ADD_BIAS, GEN_PHASE)                                                         \
@@ -1342,7 +1400,8 @@ __global__ void updateKVCacheForCrossAttention(QKVPreprocessingParams<T, KVCache
     [[maybe_unused]] TScale scale_orig_quant;
     if constexpr (sizeof(TCache) == 1 || FP8_OUTPUT)
     {
-        mmha::convert_from_float(&scale_orig_quant, params.kvScaleOrigQuant ? params.kvScaleOrigQuant[0] : 1.0f);
+        mmha::convert_from_float(&scale_orig_quant,
+            params.kvScaleOrigQuant ? params.kvScaleOrigQuant[params.getKvScaleIdx(kv_head_idx)] : 1.0f);
     }
 
     // For loop in the sequence length dimension.
@@ -1498,13 +1557,17 @@ void invokeApplyBiasRopeUpdateKVCacheDispatch(QKVPreprocessingParams<T, KVCacheB
         return;
     }
 
-    // Long-sequence-length that exceeds the max_position_size needs to compute the cos/sin on-the-fly.
+    // Long-sequence-length that exceeds the max_position_size needs to compute the cos/sin on-the-fly, which the v2
+    // kernel does from the inverse frequencies too.
     bool const long_seq_rotary_support = params.rotary_scale_type == RotaryScalingType::kDYNAMIC
         || params.max_kv_seq_len > params.rotary_embedding_max_positions;
     bool const has_rotary_cos_sin_cache = params.rotary_coef_cache_buffer != nullptr;
+    bool const has_rotary_inv_freq = params.rotary_embedding_inv_freq != nullptr;
     bool const has_sink_tokens = params.sink_token_len > 0;
-    bool const use_v1_for_mrope
-        = params.position_embedding_type == PositionEmbeddingType::kROPE_M && params.mrope_rotary_cos_sin == nullptr;
+    bool const use_v1_for_mrope = params.position_embedding_type == PositionEmbeddingType::kROPE_M
+        && params.mrope_rotary_cos_sin == nullptr && !has_rotary_inv_freq;
+    bool const use_v1_for_rotary_recompute
+        = (long_seq_rotary_support || !has_rotary_cos_sin_cache) && !has_rotary_inv_freq;
     // V2 implementation requires multiple of paired 16 bytes for gpt-neox rotation.
     bool const support_rotary_for_v2 = (params.position_embedding_type != PositionEmbeddingType::kROPE_GPT_NEOX
                                            && params.position_embedding_type != PositionEmbeddingType::kLONG_ROPE)
@@ -1512,8 +1575,7 @@ void invokeApplyBiasRopeUpdateKVCacheDispatch(QKVPreprocessingParams<T, KVCacheB
 
     // Use v2 kernel for absolute_position_embedding.
     if (!absolute_position_embedding
-        && (long_seq_rotary_support || !has_rotary_cos_sin_cache || has_sink_tokens || !support_rotary_for_v2
-            || use_v1_for_mrope))
+        && (use_v1_for_rotary_recompute || has_sink_tokens || !support_rotary_for_v2 || use_v1_for_mrope))
     {
         kernelV1Dispatch<T, TCache, KVCacheBuffer>(params, stream);
         return;
@@ -14,9 +14,16 @@
  * limitations under the License.
  */
 #include "ub_allocator.h"
+#include "tensorrt_llm/common/logger.h"
 
 namespace tensorrt_llm::runtime::ub
 {
+namespace
+{
+// Smallest buffer the pool registers, larger ones are powers of two of it.
+size_t constexpr kPoolGranularity = 2 * 1024 * 1024;
+} // namespace
+
 UserBufferAllocator& UserBufferAllocator::Instance()
 {
     static UserBufferAllocator _;
@@ -30,6 +37,9 @@ void UserBufferAllocator::initialize(int tp)
         ub_comm_ = nullptr;
         create_communicator_grouped2(&ub_comm_, 1, 1, tp, 1);
         TLLM_CHECK(ub_comm_ != nullptr);
+        // Region 0 holds the flags of the communicator.
+        pool_ = std::make_unique<UBBufferPool>([this](size_t bytes) { return register_ub_buffer(bytes); },
+            kPoolGranularity, MAX_REGIONS - 1);
         is_initialized_ = true;
         tp_ = tp;
     }
@@ -51,14 +61,35 @@ UBBuffer UserBufferAllocator::register_ub_buffer(size_t bytes)
 
 void* UserBufferAllocator::allocate(int idx, size_t bytes)
 {
-    TLLM_CHECK(is_initialized() && idx < buffers_.size() && buffers_[idx].invalid());
-    auto ub_buffer = register_ub_buffer(bytes);
-    TLLM_CHECK(!ub_buffer.invalid());
-    buffers_[idx] = ub_buffer;
-    return ub_buffer.addr;
+    TLLM_CHECK(is_initialized() && idx < buffers_.size());
+    auto& buffer = buffers_[idx];
+    if (!buffer.invalid() && buffer.size >= bytes)
+    {
+        return buffer.addr;
+    }
+    if (!buffer.invalid())
+    {
+        pool_->release(buffer);
+    }
+    buffer = pool_->acquire(bytes);
+    TLLM_LOG_DEBUG("[UserBuffer] Buffer %d of %lu bytes for %lu bytes, %lu bytes registered in %d buffers", idx,
+        buffer.size, bytes, pool_->registered_bytes(), pool_->num_buffers());
+    return buffer.addr;
 }
 
-void UserBufferAllocator::deallocate(void* addr) {}
+void UserBufferAllocator::deallocate(void* addr)
+{
+    TLLM_CHECK(is_initialized());
+    for (auto& buffer : buffers_)
+    {
+        if (!buffer.invalid() && buffer.addr == addr)
+        {
+            pool_->release(buffer);
+            buffer = UBBuffer();
+            return;
+        }
+    }
+}
 
 UBBuffer UserBufferAllocator::get(int idx)
 {
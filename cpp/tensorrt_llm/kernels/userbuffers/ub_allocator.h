@@ -14,12 +14,17 @@
  * limitations under the License.
  */
 #pragma once
+#include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/runtime/bufferManager.h"
 #include "tensorrt_llm/runtime/iBuffer.h"
 #include "tensorrt_llm/runtime/tllmBuffers.h"
 #if ENABLE_MULTI_DEVICE
 #include "userbuffers.h"
 #endif
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -45,6 +50,95 @@ struct UBBuffer
         return (addr == nullptr) || (handle == -1) || (size == 0);
     }
 };
+
+// Pool of the buffers registered with the communicator. Registered buffers cannot be unregistered and the communicator
+// has a small number of regions, so a released buffer is kept for the next tensor that fits in it: tensors whose
+// lifetimes are disjoint share the same buffers, and memory only grows with the largest tensors actually seen. New
+// buffers are rounded up to a power of two times granularity bytes, so a tensor growing step by step takes a bounded
+// number of regions. Registration is collective, every rank has to acquire and release the same sizes in the same
+// order.
+class UBBufferPool
+{
+public:
+    using RegisterFn = std::function<UBBuffer(size_t bytes)>;
+
+    UBBufferPool(RegisterFn register_fn, size_t granularity, int max_buffers)
+        : register_fn_(std::move(register_fn))
+        , granularity_(granularity)
+        , max_buffers_(max_buffers)
+    {
+        TLLM_CHECK(register_fn_ != nullptr && granularity_ > 0);
+    }
+
+    // The smallest free buffer of at least bytes, registering a new one if none fits.
+    UBBuffer acquire(size_t bytes)
+    {
+        TLLM_CHECK(bytes > 0);
+        auto best = free_.end();
+        for (auto it = free_.begin(); it != free_.end(); ++it)
+        {
+            if (it->size >= bytes && (best == free_.end() || it->size < best->size))
+            {
+                best = it;
+            }
+        }
+        if (best != free_.end())
+        {
+            auto buffer = *best;
+            free_.erase(best);
+            in_use_bytes_ += buffer.size;
+            return buffer;
+        }
+        TLLM_CHECK_WITH_INFO(num_buffers_ < max_buffers_,
+            "UserBuffer pool is out of regions: %d buffers of %lu bytes registered, %lu bytes requested", num_buffers_,
+            registered_bytes_, bytes);
+        size_t size = granularity_;
+        while (size < bytes)
+        {
+            size *= 2;
+        }
+        auto buffer = register_fn_(size);
+        TLLM_CHECK(!buffer.invalid());
+        ++num_buffers_;
+        registered_bytes_ += buffer.size;
+        in_use_bytes_ += buffer.size;
+        return buffer;
+    }
+
+    // Return a buffer of acquire to the pool, the stream it was used on orders it before its next user.
+    void release(UBBuffer const& buffer)
+    {
+        TLLM_CHECK(std::none_of(
+            free_.begin(), free_.end(), [&buffer](UBBuffer const& other) { return other.addr == buffer.addr; }));
+        free_.push_back(buffer);
+        in_use_bytes_ -= buffer.size;
+    }
+
+    int num_buffers() const
+    {
+        return num_buffers_;
+    }
+
+    size_t registered_bytes() const
+    {
+        return registered_bytes_;
+    }
+
+    size_t in_use_bytes() const
+    {
+        return in_use_bytes_;
+    }
+
+private:
+    RegisterFn register_fn_;
+    size_t granularity_;
+    int max_buffers_;
+    std::vector<UBBuffer> free_;
+    int num_buffers_{0};
+    size_t registered_bytes_{0};
+    size_t in_use_bytes_{0};
+};
+
 #if ENABLE_MULTI_DEVICE
 class UserBufferAllocator
 {
@@ -56,7 +150,10 @@ public:
     void initialize(int tp);
     bool is_initialized();
     UBBuffer register_ub_buffer(size_t bytes);
+    // Buffer idx of at least bytes. The buffer of idx is kept if it is large enough, and is replaced by a buffer of the
+    // pool otherwise, the tensors bound to the previous buffer then have to be bound again.
     void* allocate(int idx, size_t bytes);
+    // Return the buffer at addr to the pool, for the next allocation that fits in it.
     void deallocate(void* addr);
     UBBuffer get(int idx);
     communicator* comm();
@@ -64,6 +161,7 @@ public:
 private:
     communicator* ub_comm_;
     std::array<UBBuffer, 3> buffers_;
+    std::unique_ptr<UBBufferPool> pool_;
     bool is_initialized_;
     int tp_;
 };
@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/pdlUtils.cuh"
+#include "tensorrt_llm/kernels/vocabParallelSamplingKernels.h"
+
+#include <cub/cub.cuh>
+#include <cuda_fp16.h>
+#ifdef ENABLE_BF16
+#include <cuda_bf16.h>
+#endif
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cstdint>
+
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::runtime;
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+
+constexpr SizeType32 kSummaryBlockSize = 256;
+constexpr SizeType32 kSampleBlockSize = 128;
+//! Id of the candidate of a thread that has none left, after all the real ids.
+constexpr TokenIdType kNoToken = INT_MAX;
+
+struct ShardCandidate
+{
+    float logit;
+    TokenIdType tokenId;
+};
+
+//! \brief The order of the top-k: decreasing logits, then increasing ids, whatever the order of the reduction.
+__device__ __forceinline__ bool isBefore(ShardCandidate const& a, ShardCandidate const& b)
+{
+    return a.logit > b.logit || (a.logit == b.logit && a.tokenId < b.tokenId);
+}
+
+struct TakeFirst
+{
+    __device__ __forceinline__ ShardCandidate operator()(ShardCandidate const& a, ShardCandidate const& b) const
+    {
+        return isBefore(b, a) ? b : a;
+    }
+};
+
+struct ShardStats
+{
+    float maxLogit;
+    float sumExp;
+};
+
+struct MergeShardStats
+{
+    __device__ __forceinline__ ShardStats operator()(ShardStats const& a, ShardStats const& b) const
+    {
+        auto const maxLogit = fmaxf(a.maxLogit, b.maxLogit);
+        return ShardStats{maxLogit,
+            (a.sumExp == 0.f ? 0.f : a.sumExp * __expf(a.maxLogit - maxLogit))
+                + (b.sumExp == 0.f ? 0.f : b.sumExp * __expf(b.maxLogit - maxLogit))};
+    }
+};
+
+//! \brief First candidate after prev of the logits of the thread, the ones at threadIdx.x modulo the block size.
+template <typename T>
+__device__ ShardCandidate nextCandidate(VocabShardSummaryParams<T> const& params, T const* logits, float invTemperature,
+    SizeType32 maskedId, ShardCandidate const& prev)
+{
+    ShardCandidate best{-FLT_MAX, kNoToken};
+    for (auto vi = static_cast<SizeType32>(threadIdx.x); vi < params.shardVocabSize; vi += kSummaryBlockSize)
+    {
+        ShardCandidate const candidate{static_cast<float>(logits[vi]) * invTemperature, params.vocabOffset + vi};
+        if (vi != maskedId && isBefore(prev, candidate) && isBefore(candidate, best))
+        {
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+//! \brief Grid [batchSize]. A first pass over the shard gets the max and the sum of the exponentials, and the best
+//! candidate of every thread. Every top-k step then takes the best of the candidates of the threads, and only the
+//! thread that provided it scans its logits again for its next candidate.
+template <typename T>
+__global__ void vocabShardSummaryKernel(VocabShardSummaryParams<T> const params)
+{
+    using StatsReduce = cub::BlockReduce<ShardStats, kSummaryBlockSize>;
+    using CandidateReduce = cub::BlockReduce<ShardCandidate, kSummaryBlockSize>;
+    __shared__ union
+    {
+        typename StatsReduce::TempStorage stats;
+        typename CandidateReduce::TempStorage candidate;
+    } tempStorage;
+    __shared__ ShardCandidate sTaken;
+
+    auto const batchIdx = static_cast<SizeType32>(blockIdx.x);
+
+    pdlWaitPrimaryGrid();
+
+    auto const batchSlot = params.batchSlots[batchIdx];
+    auto& summary = params.summaries[batchIdx];
+    auto const k = min(max(params.topKs != nullptr ? params.topKs[batchSlot] : params.maxTopK, 1),
+        kVocabParallelMaxTopK);
+    auto const finishState = params.finishedInput != nullptr ? params.finishedInput[batchSlot] : FinishedState::empty();
+    if (finishState.isFinished() || finishState.isSkipDecoding())
+    {
+        if (threadIdx.x == 0)
+        {
+            summary.maxLogit = -FLT_MAX;
+            summary.sumExp = 0.f;
+        }
+        for (auto ki = static_cast<SizeType32>(threadIdx.x); ki < k; ki += kSummaryBlockSize)
+        {
+            summary.topLogits[ki] = -FLT_MAX;
+            summary.topIds[ki] = -1;
+        }
+        return;
+    }
+
+    // EOS is masked until the request generated minLength tokens, by the rank of its shard.
+    auto const seqLen = params.sequenceLengths != nullptr ? params.sequenceLengths[batchSlot] : 0;
+    auto const inputLen = params.inputLengths != nullptr ? params.inputLengths[batchSlot] : 0;
+    auto const maskedId = params.minLengths != nullptr && seqLen - inputLen < params.minLengths[batchSlot]
+        ? params.endIds[batchSlot] - params.vocabOffset
+        : SizeType32{-1};
+    auto const invTemperature = params.temperatures != nullptr ? 1.f / params.temperatures[batchSlot] : 1.f;
+    auto const* logits = params.logitsPtrs[batchIdx];
+
+    ShardStats stats{-FLT_MAX, 0.f};
+    ShardCandidate candidate{-FLT_MAX, kNoToken};
+    for (auto vi = static_cast<SizeType32>(threadIdx.x); vi < params.shardVocabSize; vi += kSummaryBlockSize)
+    {
+        if (vi == maskedId)
+        {
+            continue;
+        }
+        auto const logit = static_cast<float>(logits[vi]) * invTemperature;
+        if (logit > stats.maxLogit)
+        {
+            stats.sumExp = stats.sumExp * __expf(stats.maxLogit - logit) + 1.f;
+            stats.maxLogit = logit;
+        }
+        else
+        {
+            stats.sumExp += __expf(logit - stats.maxLogit);
+        }
+        ShardCandidate const current{logit, params.vocabOffset + vi};
+        if (isBefore(current, candidate))
+        {
+            candidate = current;
+        }
+    }
+    pdlLaunchDependents();
+
+    auto const total = StatsReduce(tempStorage.stats).Reduce(stats, MergeShardStats{});
+    if (threadIdx.x == 0)
+    {
+        summary.maxLogit = total.maxLogit;
+        summary.sumExp = total.sumExp;
+    }
+    __syncthreads();
+
+    for (SizeType32 ki = 0; ki < k; ++ki)
+    {
+        auto const taken = CandidateReduce(tempStorage.candidate).Reduce(candidate, TakeFirst{});
+        if (threadIdx.x == 0)
+        {
+            summary.topLogits[ki] = taken.logit;
+            summary.topIds[ki] = taken.tokenId == kNoToken ? -1 : taken.tokenId;
+            sTaken = taken;
+        }
+        __syncthreads();
+        if (sTaken.tokenId == kNoToken)
+        {
+            // The shard has fewer than k tokens.
+            for (auto kj = ki + 1 + static_cast<SizeType32>(threadIdx.x); kj < k; kj += kSummaryBlockSize)
+            {
+                summary.topLogits[kj] = -FLT_MAX;
+                summary.topIds[kj] = -1;
+            }
+            return;
+        }
+        if (static_cast<SizeType32>(threadIdx.x) == (sTaken.tokenId - params.vocabOffset) % kSummaryBlockSize)
+        {
+            candidate = nextCandidate(params, logits, invTemperature, maskedId, sTaken);
+        }
+        // sTaken is rewritten by the next step.
+        __syncthreads();
+    }
+}
+
+//! \brief Append the selected token, if any, and apply the stop criteria, as invokeGreedyDecode does.
+__device__ void finalizeVocabParallelStep(VocabParallelSampleParams const& params, SizeType32 batchSlot,
+    FinishedState finishState, TokenIdType const* tokenId, float logProb)
+{
+    auto* outputIds = params.outputIdsPtrs[batchSlot];
+    auto seqLen = params.sequenceLengths[batchSlot];
+    if (tokenId != nullptr)
+    {
+        outputIds[seqLen] = *tokenId;
+        if (params.cumLogProbs != nullptr)
+        {
+            params.cumLogProbs[batchSlot] += logProb;
+        }
+        if (params.outputLogProbs != nullptr)
+        {
+            params.outputLogProbs[seqLen * params.maxBatchSize + batchSlot] = logProb;
+        }
+        if (*tokenId == params.endIds[batchSlot])
+        {
+            // The sequence length excludes the EOS token.
+            finishState.setFinishedEOS();
+        }
+        else
+        {
+            ++seqLen;
+        }
+    }
+    if (params.sequenceLimitLength != nullptr && params.sequenceLimitLength[batchSlot] - seqLen <= 0)
+    {
+        finishState.setFinishedMaxLength();
+        seqLen = params.sequenceLimitLength[batchSlot];
+    }
+    params.sequenceLengths[batchSlot] = seqLen;
+    if (params.finishedOutput != nullptr)
+    {
+        params.finishedOutput[batchSlot] = finishState;
+    }
+}
+
+//! \brief One thread per request. The top-k of the request are merged from the sorted top-k of the shards.
+__global__ void vocabParallelSampleKernel(VocabParallelSampleParams const params)
+{
+    auto const batchIdx = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
+
+    pdlWaitPrimaryGrid();
+    pdlLaunchDependents();
+
+    if (batchIdx >= params.batchSize)
+    {
+        return;
+    }
+    auto const batchSlot = params.batchSlots[batchIdx];
+    auto const finishState = params.finishedInput != nullptr ? params.finishedInput[batchSlot] : FinishedState::empty();
+    if (finishState.isFinished() || finishState.isSkipDecoding())
+    {
+        finalizeVocabParallelStep(params, batchSlot, finishState, nullptr, 0.f);
+        return;
+    }
+
+    auto const summaryOf = [&params, batchIdx](SizeType32 rank) -> VocabShardSummary const&
+    { return params.summaries[rank * params.batchSize + batchIdx]; };
+
+    // Log-sum-exp over the whole vocab.
+    ShardStats stats{-FLT_MAX, 0.f};
+    for (SizeType32 rank = 0; rank < params.tpSize; ++rank)
+    {
+        auto const& summary = summaryOf(rank);
+        stats = MergeShardStats{}(stats, ShardStats{summary.maxLogit, summary.sumExp});
+    }
+    auto const logSumExp = stats.maxLogit + __logf(stats.sumExp);
+
+    auto const k = min(max(params.topKs != nullptr ? params.topKs[batchSlot] : params.maxTopK, 1),
+        kVocabParallelMaxTopK);
+    float topLogits[kVocabParallelMaxTopK];
+    TokenIdType topIds[kVocabParallelMaxTopK];
+    std::uint8_t cursors[kVocabParallelMaxTpSize] = {};
+    SizeType32 numTop = 0;
+    float sumTopExp = 0.f;
+    for (; numTop < k; ++numTop)
+    {
+        SizeType32 bestRank = -1;
+        ShardCandidate best{-FLT_MAX, kNoToken};
+        for (SizeType32 rank = 0; rank < params.tpSize; ++rank)
+        {
+            auto const& summary = summaryOf(rank);
+            if (cursors[rank] < k && summary.topIds[cursors[rank]] >= 0)
+            {
+                ShardCandidate const candidate{summary.topLogits[cursors[rank]], summary.topIds[cursors[rank]]};
+                if (isBefore(candidate, best))
+                {
+                    best = candidate;
+                    bestRank = rank;
+                }
+            }
+        }
+        if (bestRank < 0)
+        {
+            break;
+        }
+        ++cursors[bestRank];
+        topLogits[numTop] = best.logit;
+        topIds[numTop] = best.tokenId;
+        sumTopExp += __expf(best.logit - stats.maxLogit);
+    }
+    if (numTop == 0)
+    {
+        // Like the top-k sampling, an invalid id shows as the last token of the vocab.
+        TokenIdType const tokenId = params.vocabSize - 1;
+        finalizeVocabParallelStep(params, batchSlot, finishState, &tokenId, 0.f);
+        return;
+    }
+
+    auto const topP = params.topPs != nullptr ? params.topPs[batchSlot] : 1.f;
+    auto randNum = params.curandState != nullptr ? curand_uniform(params.curandState + batchSlot) * topP * sumTopExp
+                                                 : topP * sumTopExp;
+    SizeType32 selected = 0;
+    for (; selected < numTop - 1; ++selected)
+    {
+        randNum -= __expf(topLogits[selected] - stats.maxLogit);
+        if (randNum <= 0.f)
+        {
+            break;
+        }
+    }
+    auto const logProb = params.normalizeLogProbs
+        ? topLogits[selected] - stats.maxLogit - __logf(sumTopExp)
+        : topLogits[selected] - logSumExp;
+    finalizeVocabParallelStep(params, batchSlot, finishState, &topIds[selected], logProb);
+}
+
+} // namespace
+
+template <typename T>
+void invokeVocabShardSummary(VocabShardSummaryParams<T> const& params, cudaStream_t stream)
+{
+    TLLM_CHECK_WITH_INFO(params.maxTopK <= kVocabParallelMaxTopK, "Top-k %d over vocab shards exceeds %d",
+        params.maxTopK, kVocabParallelMaxTopK);
+    if (params.batchSize == 0)
+    {
+        return;
+    }
+    launchWithPdl(vocabShardSummaryKernel<T>, dim3(params.batchSize), dim3(kSummaryBlockSize), 0, stream, params);
+    sync_check_cuda_error();
+}
+
+template void invokeVocabShardSummary(VocabShardSummaryParams<float> const& params, cudaStream_t stream);
+template void invokeVocabShardSummary(VocabShardSummaryParams<half> const& params, cudaStream_t stream);
+#ifdef ENABLE_BF16
+template void invokeVocabShardSummary(VocabShardSummaryParams<__nv_bfloat16> const& params, cudaStream_t stream);
+#endif
+
+void invokeVocabParallelSample(VocabParallelSampleParams const& params, cudaStream_t stream)
+{
+    TLLM_CHECK_WITH_INFO(params.tpSize > 0 && params.tpSize <= kVocabParallelMaxTpSize,
+        "Sampling over %d vocab shards, expected 1 to %d", params.tpSize, kVocabParallelMaxTpSize);
+    TLLM_CHECK_WITH_INFO(params.maxTopK <= kVocabParallelMaxTopK, "Top-k %d over vocab shards exceeds %d",
+        params.maxTopK, kVocabParallelMaxTopK);
+    if (params.batchSize == 0)
+    {
+        return;
+    }
+    launchWithPdl(vocabParallelSampleKernel, dim3(divUp(params.batchSize, kSampleBlockSize)),
+        dim3(kSampleBlockSize), 0, stream, params);
+    sync_check_cuda_error();
+}
+
+} // namespace tensorrt_llm::kernels
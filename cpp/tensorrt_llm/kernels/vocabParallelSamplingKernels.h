@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <cuda_runtime.h>
+#include <curand_kernel.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Largest top-k of the sampling over vocab shards.
+static constexpr runtime::SizeType32 kVocabParallelMaxTopK = 64;
+//! \brief Largest number of vocab shards.
+static constexpr runtime::SizeType32 kVocabParallelMaxTpSize = 64;
+
+//! \brief What a tensor parallel rank contributes to the sampling of a request from its shard of the vocab, in place
+//! of its logits: the max and the sum of the exponentials relative to it, from which the log-sum-exp over the whole
+//! vocab follows, and the top-k logits of the shard by decreasing logit, with their ids in the whole vocab.
+struct VocabShardSummary
+{
+    float maxLogit;
+    float sumExp;
+    float topLogits[kVocabParallelMaxTopK];
+    runtime::TokenIdType topIds[kVocabParallelMaxTopK];
+};
+
+template <typename T>
+struct VocabShardSummaryParams
+{
+    //! input buffer [batchSize][shardVocabSize], the logits of the shard of every request.
+    T const* const* logitsPtrs{nullptr};
+    //! input buffer [batchSize], the batch slot of every request.
+    runtime::SizeType32 const* batchSlots{nullptr};
+    //! input buffer [maxBatchSize], optional. Top-k of every request, maxTopK if nullptr.
+    runtime::SizeType32 const* topKs{nullptr};
+    //! input buffer [maxBatchSize], optional. The logits are divided by the temperature.
+    float const* temperatures{nullptr};
+    //! input buffer [maxBatchSize], optional. Finished requests get an empty summary.
+    FinishedState const* finishedInput{nullptr};
+    //! input buffer [maxBatchSize], EOS token ids per request, in the whole vocab.
+    runtime::TokenIdType const* endIds{nullptr};
+    //! input buffers [maxBatchSize], optional. EOS is masked until the request generated minLengths tokens.
+    runtime::SizeType32 const* inputLengths{nullptr};
+    runtime::SizeType32 const* minLengths{nullptr};
+    runtime::SizeType32 const* sequenceLengths{nullptr};
+
+    //! output buffer [batchSize].
+    VocabShardSummary* summaries{nullptr};
+
+    runtime::SizeType32 batchSize{0};
+    runtime::SizeType32 maxTopK{1};
+    runtime::SizeType32 shardVocabSize{0};
+    //! Id of the first token of the shard in the whole vocab.
+    runtime::SizeType32 vocabOffset{0};
+};
+
+//! \brief Summarize the logits of a vocab shard of every request, see VocabShardSummary.
+template <typename T>
+void invokeVocabShardSummary(VocabShardSummaryParams<T> const& params, cudaStream_t stream);
+
+//! \brief Sampling step of requests with beam width 1 and one token per step from the summaries of all the shards.
+//! The top-k and top-p selection are those of the top-k sampling kernels, but the log probabilities are those of the
+//! whole vocab. Every rank samples the same tokens given the same curand states.
+struct VocabParallelSampleParams
+{
+    //! input buffer [tpSize][batchSize], the summaries of all the ranks, e.g. after an all-gather.
+    VocabShardSummary const* summaries{nullptr};
+    //! input buffer [batchSize], the batch slot of every request.
+    runtime::SizeType32 const* batchSlots{nullptr};
+    //! input buffer [maxBatchSize], optional. Top-k of every request, maxTopK if nullptr.
+    runtime::SizeType32 const* topKs{nullptr};
+    //! input buffer [maxBatchSize], optional. Top-p of every request, within its top-k, 1 if nullptr.
+    float const* topPs{nullptr};
+    //! input buffer [maxBatchSize], optional. Initialized curand states. If nullptr, 1 is always used.
+    curandState_t* curandState{nullptr};
+    //! input buffer [maxBatchSize], EOS token ids per request.
+    runtime::TokenIdType const* endIds{nullptr};
+    //! input buffer [maxBatchSize], optional. Requests finish with their length at sequenceLimitLength.
+    runtime::SizeType32 const* sequenceLimitLength{nullptr};
+    //! input buffer [maxBatchSize], optional. Finished requests are not sampled.
+    FinishedState const* finishedInput{nullptr};
+
+    //! output buffer [maxBatchSize][maxSeqLen], the token is written at the current sequence length.
+    runtime::TokenIdType* const* outputIdsPtrs{nullptr};
+    //! input/output buffer [maxBatchSize]. Set up to, but excluding the EOS token.
+    runtime::SizeType32* sequenceLengths{nullptr};
+    //! output buffer [maxBatchSize], optional.
+    FinishedState* finishedOutput{nullptr};
+    //! input/output buffer [maxBatchSize], optional. Adds the log probability of the selected token.
+    float* cumLogProbs{nullptr};
+    //! output buffer [maxSeqLen, maxBatchSize], optional. Log probability of the selected token in the whole vocab,
+    //! or in the top-k if normalizeLogProbs.
+    float* outputLogProbs{nullptr};
+
+    runtime::SizeType32 batchSize{0};
+    runtime::SizeType32 maxBatchSize{0};
+    runtime::SizeType32 tpSize{1};
+    runtime::SizeType32 maxTopK{1};
+    runtime::SizeType32 vocabSize{0};
+    bool normalizeLogProbs{false};
+};
+
+void invokeVocabParallelSample(VocabParallelSampleParams const& params, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -79,6 +79,9 @@ struct Params
     int groupsize;
     KernelType type;
     bool apply_alpha_in_advance;
+    // Fused gated MLP: n is the number of output channels, and the weights, scales, zeros and bias hold the gate
+    // channels followed by the up channels, out = silu(gate) * up. The 2 * n intermediate channels are never written.
+    bool gated{false};
 
     Params(ConstPointer _act, ConstPointer _act_scale, ConstPointer _weight, ConstPointer _scales, ConstPointer _zeros,
         ConstPointer _bias, Pointer _out, float _alpha, int _m, int _n, int _k, int _groupsize, KernelType _type,
@@ -16,26 +16,43 @@
 
 #include "tensorrt_llm/kernels/weightOnlyBatchedGemv/int8SQ.h"
 
+#include <type_traits>
+
 namespace tensorrt_llm
 {
 namespace kernels
 {
 namespace smooth_quant
 {
-template <typename Type, int CtaM, int CtaN, int Threads, bool PerChannel, bool PerToken>
+template <typename Type>
+__device__ __forceinline__ Type convert_output(float value, float const* output_scale)
+{
+    if constexpr (std::is_same_v<Type, int8_t>)
+    {
+        return static_cast<int8_t>(fminf(fmaxf(rintf(value / output_scale[0]), -128.f), 127.f));
+    }
+    else
+    {
+        return static_cast<Type>(value);
+    }
+}
+
+template <typename Type, int CtaM, int CtaN, int Threads, bool PerChannel, bool PerToken, bool Gated>
 __global__ void int8_sq(int8_t const* act, int8_t const* weight, float const* scale_channels, float const* scale_tokens,
-    Type* output, int m, int n, int k)
+    float const* output_scale, Type* output, int m, int n, int k)
 {
+    // When Gated, the CTA also accumulates the up projection of its channels, n rows of weights after the gate.
+    static constexpr int Projections = Gated ? 2 : 1;
     using VecType = int4;
     static constexpr int kStepK = 128 / (8 * sizeof(int8_t));
     static constexpr int CtaK = kStepK * Threads;
     int tile_id_m = blockIdx.x * CtaM;
     int tile_id_n = blockIdx.y * CtaN;
     int tid = threadIdx.x;
-    int8_t tile_a[kStepK], tile_w[CtaN * kStepK];
-    int acc[CtaM * CtaN];
+    int8_t tile_a[kStepK], tile_w[Projections * CtaN * kStepK];
+    int acc[Projections * CtaM * CtaN];
 #pragma unroll
-    for (int i = 0; i < CtaM * CtaN; ++i)
+    for (int i = 0; i < Projections * CtaM * CtaN; ++i)
     {
         acc[i] = 0;
     }
@@ -45,22 +62,27 @@ __global__ void int8_sq(int8_t const* act, int8_t const* weight, float const* sc
     for (int idx_k = tid * kStepK; idx_k < k; idx_k += CtaK)
     {
 #pragma unroll
-        for (int i = 0; i < CtaN; ++i)
+        for (int p = 0; p < Projections; ++p)
         {
-            reinterpret_cast<VecType*>(tile_w)[i] = reinterpret_cast<VecType const*>(weight + i * k + idx_k)[0];
+#pragma unroll
+            for (int i = 0; i < CtaN; ++i)
+            {
+                reinterpret_cast<VecType*>(tile_w)[p * CtaN + i]
+                    = reinterpret_cast<VecType const*>(weight + (p * n + i) * k + idx_k)[0];
+            }
         }
 #pragma unroll
         for (int i = 0; i < CtaM; ++i)
         {
             reinterpret_cast<VecType*>(tile_a)[0] = reinterpret_cast<VecType const*>(act + i * k + idx_k)[0];
 #pragma unroll
-            for (int j = 0; j < CtaN; ++j)
+            for (int j = 0; j < Projections * CtaN; ++j)
             {
 #pragma unroll
                 for (int l = 0; l < kStepK; l += 4)
                 {
-                    acc[i * CtaN + j] = __dp4a(reinterpret_cast<int*>(tile_a + l)[0],
-                        reinterpret_cast<int*>(tile_w + j * kStepK + l)[0], acc[i * CtaN + j]);
+                    acc[j * CtaM + i] = __dp4a(reinterpret_cast<int*>(tile_a + l)[0],
+                        reinterpret_cast<int*>(tile_w + j * kStepK + l)[0], acc[j * CtaM + i]);
                 }
             }
         }
@@ -68,15 +90,16 @@ __global__ void int8_sq(int8_t const* act, int8_t const* weight, float const* sc
 
     static constexpr int kWarpSize = 32;
     static constexpr int kWarpNum = Threads / kWarpSize;
-    __shared__ int shmem[CtaM * CtaN * kWarpNum];
+    static constexpr int kTileSize = CtaM * CtaN;
+    __shared__ int shmem[Projections * kTileSize * kWarpNum];
     int warp_id = tid / kWarpSize, lane_id = tid % kWarpSize;
 #pragma unroll
     for (int i = 0; i < CtaM; ++i)
     {
 #pragma unroll
-        for (int j = 0; j < CtaN; ++j)
+        for (int j = 0; j < Projections * CtaN; ++j)
         {
-            int val = acc[i * CtaN + j];
+            int val = acc[j * CtaM + i];
             val += __shfl_xor_sync(~0, val, 16);
             val += __shfl_xor_sync(~0, val, 8);
             val += __shfl_xor_sync(~0, val, 4);
@@ -84,23 +107,26 @@ __global__ void int8_sq(int8_t const* act, int8_t const* weight, float const* sc
             val += __shfl_xor_sync(~0, val, 1);
             if (lane_id == 0)
             {
-                shmem[i * CtaN + j + warp_id * CtaM * CtaN] = val;
+                // The tile of the up projection follows the tiles of the gate of all the warps.
+                shmem[(j / CtaN) * kWarpNum * kTileSize + warp_id * kTileSize + i * CtaN + j % CtaN] = val;
             }
         }
     }
     __syncthreads();
 #pragma unroll
-    for (int ii = tid; ii < CtaM * CtaN; ii += Threads)
+    for (int ii = tid; ii < kTileSize; ii += Threads)
     {
         int mid = ii / CtaN, nid = ii % CtaN;
-        float scale_channel, scale_token;
+        float scale_channel, scale_token, scale_channel_up;
         if constexpr (PerChannel)
         {
             scale_channel = scale_channels[tile_id_n + nid];
+            scale_channel_up = Gated ? scale_channels[n + tile_id_n + nid] : 0.f;
         }
         else
         {
             scale_channel = scale_channels[0];
+            scale_channel_up = scale_channels[0];
         }
         if constexpr (PerToken)
         {
@@ -114,9 +140,21 @@ __global__ void int8_sq(int8_t const* act, int8_t const* weight, float const* sc
 #pragma unroll
         for (int jj = 0; jj < kWarpNum; ++jj)
         {
-            val += shmem[jj * CtaM * CtaN + ii];
+            val += shmem[jj * kTileSize + ii];
+        }
+        float value = static_cast<float>(val) * scale_channel * scale_token;
+        if constexpr (Gated)
+        {
+            int val_up = 0;
+#pragma unroll
+            for (int jj = 0; jj < kWarpNum; ++jj)
+            {
+                val_up += shmem[(kWarpNum + jj) * kTileSize + ii];
+            }
+            float const up = static_cast<float>(val_up) * scale_channel_up * scale_token;
+            value = value / (1.f + __expf(-value)) * up;
         }
-        output[mid * n + nid] = static_cast<Type>(static_cast<float>(val) * scale_channel * scale_token);
+        output[mid * n + nid] = convert_output<Type>(value, output_scale);
     }
 }
 
@@ -125,9 +163,16 @@ void int8_sq_kernel(Params& params, cudaStream_t s)
 {
     dim3 block(Threads);
     dim3 grid(params.m / CtaM, params.n / CtaN);
-    int8_sq<Type, CtaM, CtaN, Threads, PerChannel, PerToken><<<grid, block, 0, s>>>(params.act, params.weight,
-        params.scale_channels, params.scale_tokens, reinterpret_cast<Type*>(params.output), params.m, params.n,
-        params.k);
+    if (params.gated)
+    {
+        int8_sq<Type, CtaM, CtaN, Threads, PerChannel, PerToken, true><<<grid, block, 0, s>>>(params.act,
+            params.weight, params.scale_channels, params.scale_tokens, params.output_scale,
+            reinterpret_cast<Type*>(params.output), params.m, params.n, params.k);
+        return;
+    }
+    int8_sq<Type, CtaM, CtaN, Threads, PerChannel, PerToken, false><<<grid, block, 0, s>>>(params.act, params.weight,
+        params.scale_channels, params.scale_tokens, params.output_scale, reinterpret_cast<Type*>(params.output),
+        params.m, params.n, params.k);
 }
 
 template <typename Type, bool PerChannel, bool PerToken>
@@ -167,6 +212,7 @@ void int8_sq_launcher(Params& params, cudaStream_t s)
 template void int8_sq_launcher<float>(Params& params, cudaStream_t s);
 template void int8_sq_launcher<half>(Params& params, cudaStream_t s);
 template void int8_sq_launcher<int>(Params& params, cudaStream_t s);
+template void int8_sq_launcher<int8_t>(Params& params, cudaStream_t s);
 #ifdef ENABLE_BF16
 template void int8_sq_launcher<__nv_bfloat16>(Params& params, cudaStream_t s);
 #endif
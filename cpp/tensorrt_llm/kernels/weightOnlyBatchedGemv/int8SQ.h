@@ -40,6 +40,12 @@ struct Params
     void* output;
     int m, n, k;
     tensorrt_llm::common::QuantMode quant_mode;
+    // Fused gated MLP: n is the number of output channels, and the weights [2 * n, k] and the channel scales hold the
+    // gate channels followed by the up channels, output = silu(gate) * up.
+    bool gated{false};
+    // Static per-tensor scale of the int8 output, which feeds the down projection without a quantization kernel.
+    // Only read by int8_sq_launcher<int8_t>.
+    float const* output_scale{nullptr};
 
     Params(int8_t const* _act, int8_t const* _weight, float const* _scale_tokens, float const* _scale_channels,
         void* _output, int _m, int _n, int _k, tensorrt_llm::common::QuantMode _quant_mode)
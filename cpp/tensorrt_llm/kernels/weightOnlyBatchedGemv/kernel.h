@@ -27,7 +27,8 @@ namespace kernels
 namespace weight_only
 {
 template <typename Details, int CtaM, int CtaN, int Threads, int GroupSize, bool EnableActScale, bool EnableZero,
-    bool EnableBias, bool ApplyAlphaInAdvance, typename TypeA = typename Details::TypeDetailsA::Type>
+    bool EnableBias, bool ApplyAlphaInAdvance, bool Gated = false,
+    typename TypeA = typename Details::TypeDetailsA::Type>
 __global__ void kernel(TypeA* act, TypeA* act_scale, uint8_t* weight, TypeA* scales, TypeA* zeros, TypeA* bias,
     TypeA* out, float alpha, int m, int n, int k)
 {
@@ -41,6 +42,9 @@ __global__ void kernel(TypeA* act, TypeA* act_scale, uint8_t* weight, TypeA* sca
     // input            zeros            fp16/bf16              [k / GroupSize, n] or [1, n]    RowMajor
     // input            bias             fp16/bf16              [1, n]                          RowMajor
     // output           out              fp16/bf16              [m, n]                          RowMajor
+    //
+    // When Gated, the weights, scales, zeros and bias hold the gate of the n output channels followed by their up
+    // projection, [k, 2 * n] and [., 2 * n], and out = silu(gate) * up.
     // clang-format on
     using AccessTypeA = typename Details::AccessTypeA;
     using AccessTypeW = typename Details::AccessTypeW;
@@ -55,6 +59,8 @@ __global__ void kernel(TypeA* act, TypeA* act_scale, uint8_t* weight, TypeA* sca
     }
 
     int const origin_k = k, interleaved_k = k * Details::kInterleave;
+    // Columns of the weights, scales, zeros and bias
+    int const ldn = Gated ? 2 * n : n;
 
     int const tile_id_m = blockIdx.x, tile_id_n = blockIdx.y, tid = threadIdx.x;
     int const offset_m = tile_id_m * CtaM, interleaved_offset_n = tile_id_n * CtaN;
@@ -72,11 +78,22 @@ __global__ void kernel(TypeA* act, TypeA* act_scale, uint8_t* weight, TypeA* sca
         (interleaved_offset_n * interleaved_k + tid * StepK) / Details::kElemsPerByteW, CtaK / Details::kElemsPerByteW,
         interleaved_k / Details::kElemsPerByteW);
     GMemIterator<Mandatory, TypeA, CtaN, 1, TypeA> scales_iterator(scales,
-        (GroupSize != 0 ? real_offset_k / GroupSize * n : 0) + real_offset_n,
-        (GroupSize != 0 ? CtaK / Details::kInterleave / GroupSize * n : 0), Details::kInterleave);
+        (GroupSize != 0 ? real_offset_k / GroupSize * ldn : 0) + real_offset_n,
+        (GroupSize != 0 ? CtaK / Details::kInterleave / GroupSize * ldn : 0), Details::kInterleave);
     GMemIterator<EnableZero, TypeA, CtaN, 1, TypeA> zeros_iterator(zeros,
-        (GroupSize != 0 ? real_offset_k / GroupSize * n : 0) + real_offset_n,
-        (GroupSize != 0 ? CtaK / Details::kInterleave / GroupSize * n : 0), Details::kInterleave);
+        (GroupSize != 0 ? real_offset_k / GroupSize * ldn : 0) + real_offset_n,
+        (GroupSize != 0 ? CtaK / Details::kInterleave / GroupSize * ldn : 0), Details::kInterleave);
+
+    // The up projection of the same output channels, n columns after the gate.
+    GMemIterator<Gated, AccessTypeW, CtaN, Details::kAccessNumW, uint8_t> up_weight_iterator(weight,
+        ((interleaved_offset_n + n / Details::kInterleave) * interleaved_k + tid * StepK) / Details::kElemsPerByteW,
+        CtaK / Details::kElemsPerByteW, interleaved_k / Details::kElemsPerByteW);
+    GMemIterator<Gated, TypeA, CtaN, 1, TypeA> up_scales_iterator(scales,
+        (GroupSize != 0 ? real_offset_k / GroupSize * ldn : 0) + real_offset_n + n,
+        (GroupSize != 0 ? CtaK / Details::kInterleave / GroupSize * ldn : 0), Details::kInterleave);
+    GMemIterator<Gated && EnableZero, TypeA, CtaN, 1, TypeA> up_zeros_iterator(zeros,
+        (GroupSize != 0 ? real_offset_k / GroupSize * ldn : 0) + real_offset_n + n,
+        (GroupSize != 0 ? CtaK / Details::kInterleave / GroupSize * ldn : 0), Details::kInterleave);
 
     out += offset_m * n + tile_id_n * CtaN * Details::kInterleave;
     if constexpr (EnableBias)
@@ -86,6 +103,11 @@ __global__ void kernel(TypeA* act, TypeA* act_scale, uint8_t* weight, TypeA* sca
 
     TypeA tile_acc[CtaM * CtaN];
     fill<CtaM * CtaN>(tile_acc, static_cast<TypeA>(0.f));
+    TypeA tile_acc_up[Gated ? CtaM * CtaN : 1];
+    if constexpr (Gated)
+    {
+        fill<CtaM * CtaN>(tile_acc_up, static_cast<TypeA>(0.f));
+    }
 
     for (int idx_k = tid * StepK, iter = 0; idx_k < interleaved_k; idx_k += CtaK, ++iter)
     {
@@ -115,8 +137,40 @@ __global__ void kernel(TypeA* act, TypeA* act_scale, uint8_t* weight, TypeA* sca
             apply_scale<Details, 1, StepK, EnableActScale>(tile_a, vec_act_scale);
             mma<Details, 1, CtaN, StepK>(tile_acc + i * CtaN, tile_w_pack2, tile_a);
         }
+        if constexpr (Gated)
+        {
+#pragma unroll
+            for (int i = 0; i < CtaN; ++i)
+            {
+                up_scales_iterator.load(vec_scale + i, iter, i);
+                up_zeros_iterator.load(vec_zero + i, iter, i);
+            }
+#pragma unroll
+            for (int i = 0; i < CtaN; ++i)
+            {
+                up_weight_iterator.load(tile_w_quantized, iter, i);
+                dequantize<Details, 1, StepK, EnableZero, ApplyAlphaInAdvance>(
+                    tile_w, tile_w_quantized, vec_scale + i, vec_zero + i, alpha);
+                pack_to_vec2<Details, StepK>(tile_w_pack2, tile_w, i);
+            }
+#pragma unroll
+            for (int i = 0; i < CtaM; ++i)
+            {
+                act_iterator.load(tile_a, iter, i);
+                apply_scale<Details, 1, StepK, EnableActScale>(tile_a, vec_act_scale);
+                mma<Details, 1, CtaN, StepK>(tile_acc_up + i * CtaN, tile_w_pack2, tile_a);
+            }
+        }
+    }
+    if constexpr (Gated)
+    {
+        gated_epilogue<Details, CtaM, CtaN, Threads, EnableBias, ApplyAlphaInAdvance>(
+            out, n, tile_acc, tile_acc_up, bias, EnableBias ? bias + n : nullptr, alpha);
+    }
+    else
+    {
+        epilogue<Details, CtaM, CtaN, Threads, EnableBias, ApplyAlphaInAdvance>(out, n, tile_acc, bias, alpha);
     }
-    epilogue<Details, CtaM, CtaN, Threads, EnableBias, ApplyAlphaInAdvance>(out, n, tile_acc, bias, alpha);
 }
 
 template <typename Details, int CtaM, int CtaN, int Threads, int GroupSize, bool EnableActScale, bool EnableZero,
@@ -128,8 +182,28 @@ void exec_kernel(Params& params, cudaStream_t s)
     {
         throw std::runtime_error("launch failed");
     }
-    dim3 grid(params.m / CtaM, params.n / (CtaN * Details::kInterleave));
     dim3 block(Threads);
+    if (params.gated)
+    {
+        // Half the channels of a CTA, as it accumulates the gate and the up projection of each.
+        static constexpr int GatedCtaN = CtaN / 2;
+        dim3 grid(params.m / CtaM, params.n / (GatedCtaN * Details::kInterleave));
+        // clang-format off
+        kernel<Details, CtaM, GatedCtaN, Threads, GroupSize, EnableActScale, EnableZero, EnableBias, ApplyAlphaInAdvance, true><<<grid, block, 0, s>>>(
+            reinterpret_cast<T*>(params.act),
+            reinterpret_cast<T*>(params.act_scale),
+            reinterpret_cast<uint8_t*>(params.weight),
+            reinterpret_cast<T*>(params.scales),
+            reinterpret_cast<T*>(params.zeros),
+            reinterpret_cast<T*>(params.bias),
+            reinterpret_cast<T*>(params.out),
+            params.alpha,
+            params.m, params.n, params.k
+        );
+        // clang-format on
+        return;
+    }
+    dim3 grid(params.m / CtaM, params.n / (CtaN * Details::kInterleave));
     // clang-format off
     kernel<Details, CtaM, CtaN, Threads, GroupSize, EnableActScale, EnableZero, EnableBias, ApplyAlphaInAdvance><<<grid, block, 0, s>>>(
         reinterpret_cast<T*>(params.act),
@@ -268,6 +268,67 @@ __device__ __forceinline__ void epilogue(void* out, int stride, void* tile_acc,
     }
 }
 
+// The epilogue of the fused gated MLP, out = silu(gate) * up, from the accumulators of the gate and of the up
+// projection of the same channels.
+template <typename Details, int CtaM, int CtaN, int Threads, bool EnableBias, bool ApplyAlphaInAdvance>
+__device__ __forceinline__ void gated_epilogue(
+    void* out, int stride, void* tile_acc_gate, void* tile_acc_up, void* bias_gate, void* bias_up, float alpha)
+{
+    using Type = typename MathWrapper<typename Details::TypeDetailsA>::Type;
+    static constexpr int Interleave = Details::kInterleave;
+    static constexpr int ThreadsPerInterleavedTile = Details::kThreadsPerInterleavedTile;
+    static constexpr int WarpSize = Details::kWarpSize;
+    static constexpr int WarpNum = Threads / WarpSize;
+    static constexpr int TileSize = CtaM * CtaN * Interleave;
+    static_assert(Threads % WarpSize == 0);
+    __shared__ float shmem[2 * TileSize * WarpNum];
+    int tid = threadIdx.x;
+    int warp_id = tid / WarpSize, lane_id = tid % WarpSize;
+#pragma unroll
+    for (int m = 0; m < CtaM; ++m)
+    {
+#pragma unroll
+        for (int n = 0; n < CtaN; ++n)
+        {
+            float v_gate = static_cast<float>(reinterpret_cast<Type*>(tile_acc_gate)[m * CtaN + n]);
+            float v_up = static_cast<float>(reinterpret_cast<Type*>(tile_acc_up)[m * CtaN + n]);
+            v_gate = warp_reduce_sum<Interleave, ThreadsPerInterleavedTile>(v_gate);
+            v_up = warp_reduce_sum<Interleave, ThreadsPerInterleavedTile>(v_up);
+            if (lane_id < Interleave * ThreadsPerInterleavedTile && lane_id % ThreadsPerInterleavedTile == 0)
+            {
+                int const idx = warp_id * TileSize + m * CtaN * Interleave + n * Interleave
+                    + lane_id / ThreadsPerInterleavedTile;
+                shmem[idx] = v_gate;
+                shmem[WarpNum * TileSize + idx] = v_up;
+            }
+        }
+    }
+    __syncthreads();
+#pragma unroll
+    for (int ii = tid; ii < TileSize; ii += Threads)
+    {
+        int m = ii / (CtaN * Interleave), n = ii % (CtaN * Interleave);
+        float gate = 0.f, up = 0.f;
+#pragma unroll
+        for (int jj = 0; jj < WarpNum; ++jj)
+        {
+            gate += shmem[jj * TileSize + ii];
+            up += shmem[(WarpNum + jj) * TileSize + ii];
+        }
+        if constexpr (!ApplyAlphaInAdvance)
+        {
+            gate *= alpha;
+            up *= alpha;
+        }
+        if constexpr (EnableBias)
+        {
+            gate += static_cast<float>(reinterpret_cast<Type*>(bias_gate)[n]);
+            up += static_cast<float>(reinterpret_cast<Type*>(bias_up)[n]);
+        }
+        reinterpret_cast<Type*>(out)[m * stride + n] = static_cast<Type>(gate / (1.f + __expf(-gate)) * up);
+    }
+}
+
 template <int N, typename T>
 __device__ __forceinline__ void fill(void* tile, T v)
 {
@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/wordsAutomatonKernels.h"
+
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::runtime;
+
+namespace tensorrt_llm::kernels
+{
+
+namespace
+{
+// Header of an automaton.
+SizeType32 constexpr kBuilt = 0;
+SizeType32 constexpr kNumNodes = 1;
+SizeType32 constexpr kState = 2;
+SizeType32 constexpr kPosition = 3;
+SizeType32 constexpr kMaxDepth = 4;
+SizeType32 constexpr kHeaderSize = 8;
+// Arrays of maxNodes entries after the header, 7 for the automaton and 6 only used while building it.
+SizeType32 constexpr kNumArrays = 13;
+
+//! \brief Aho-Corasick automaton of the words of one request. Nodes are numbered in BFS order, so the children of a
+//! node are contiguous and sorted by token.
+struct WordsAutomaton
+{
+    SizeType32* header;
+    SizeType32* childBegin;
+    SizeType32* numChildren;
+    // Token of the edge into the node.
+    SizeType32* token;
+    SizeType32* fail;
+    // A word ends at the node or at a node of its failure chain.
+    SizeType32* matches;
+    // First node of the failure chain, starting at the node itself, with a child that ends a word. -1 if none.
+    SizeType32* banNext;
+    // A word ends at the node.
+    SizeType32* terminal;
+    // Trie in insertion order and BFS queue, to build the automaton.
+    SizeType32* trieChild;
+    SizeType32* trieSibling;
+    SizeType32* trieToken;
+    SizeType32* trieTerminal;
+    SizeType32* queue;
+    SizeType32* parent;
+};
+
+__device__ WordsAutomaton getAutomaton(SizeType32* automata, SizeType32 automatonSize, SizeType32 batchSlot)
+{
+    auto const maxNodes = (automatonSize - kHeaderSize) / kNumArrays;
+    auto* base = automata + static_cast<int64_t>(batchSlot) * automatonSize;
+    auto* arrays = base + kHeaderSize;
+    return WordsAutomaton{base, arrays, arrays + maxNodes, arrays + 2 * maxNodes, arrays + 3 * maxNodes,
+        arrays + 4 * maxNodes, arrays + 5 * maxNodes, arrays + 6 * maxNodes, arrays + 7 * maxNodes,
+        arrays + 8 * maxNodes, arrays + 9 * maxNodes, arrays + 10 * maxNodes, arrays + 11 * maxNodes,
+        arrays + 12 * maxNodes};
+}
+
+__device__ SizeType32 findChild(WordsAutomaton const& automaton, SizeType32 node, TokenIdType token)
+{
+    auto lo = automaton.childBegin[node];
+    auto hi = lo + automaton.numChildren[node];
+    while (lo < hi)
+    {
+        auto const mid = (lo + hi) / 2;
+        if (automaton.token[mid] < token)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo < automaton.childBegin[node] + automaton.numChildren[node] && automaton.token[lo] == token ? lo : -1;
+}
+
+__device__ SizeType32 advance(WordsAutomaton const& automaton, SizeType32 state, TokenIdType token)
+{
+    while (true)
+    {
+        auto const child = findChild(automaton, state, token);
+        if (child >= 0)
+        {
+            return child;
+        }
+        if (state == 0)
+        {
+            return 0;
+        }
+        state = automaton.fail[state];
+    }
+}
+
+//! \brief Returns the state of the automaton after the tokens [0, end) of the sequence.
+//! The state only depends on the last maxDepth tokens, so older tokens are skipped and a rewound sequence is fed
+//! again from there.
+__device__ SizeType32 feed(WordsAutomaton const& automaton, TokenIdType const* ids, SizeType32 end)
+{
+    auto state = automaton.header[kState];
+    auto position = automaton.header[kPosition];
+    auto const maxDepth = automaton.header[kMaxDepth];
+    if (position > end || end - position > maxDepth)
+    {
+        state = 0;
+        position = max(end - maxDepth, 0);
+    }
+    for (; position < end; ++position)
+    {
+        state = advance(automaton, state, ids[position]);
+    }
+    return state;
+}
+
+__global__ void buildWordsAutomata(TokenIdType const* const* words, SizeType32 const* wordsLens,
+    SizeType32 const* batchSlots, SizeType32 automatonSize, SizeType32* automata)
+{
+    auto const batchSlot = batchSlots[blockIdx.x];
+    auto const automaton = getAutomaton(automata, automatonSize, batchSlot);
+    if (automaton.header[kBuilt] != 0)
+    {
+        return;
+    }
+
+    // Insert the words into a trie with sorted sibling lists.
+    auto const wordsLen = wordsLens[batchSlot];
+    auto const* baseWords = words[batchSlot];
+    auto const* baseOffsets = baseWords + wordsLen;
+    automaton.trieChild[0] = -1;
+    automaton.trieSibling[0] = -1;
+    automaton.trieToken[0] = -1;
+    automaton.trieTerminal[0] = 0;
+    SizeType32 numNodes{1};
+    SizeType32 maxDepth{0};
+    SizeType32 itemStart{0};
+    for (SizeType32 wordIdx = 0; wordIdx < wordsLen && baseOffsets[wordIdx] >= 0; ++wordIdx)
+    {
+        auto const itemEnd = baseOffsets[wordIdx];
+        if (itemEnd <= itemStart)
+        {
+            continue;
+        }
+        SizeType32 node{0};
+        for (auto tokenIdx = itemStart; tokenIdx < itemEnd; ++tokenIdx)
+        {
+            auto const token = baseWords[tokenIdx];
+            SizeType32 prev{-1};
+            auto child = automaton.trieChild[node];
+            while (child >= 0 && automaton.trieToken[child] < token)
+            {
+                prev = child;
+                child = automaton.trieSibling[child];
+            }
+            if (child < 0 || automaton.trieToken[child] != token)
+            {
+                auto const created = numNodes++;
+                automaton.trieChild[created] = -1;
+                automaton.trieSibling[created] = child;
+                automaton.trieToken[created] = token;
+                automaton.trieTerminal[created] = 0;
+                (prev < 0 ? automaton.trieChild[node] : automaton.trieSibling[prev]) = created;
+                child = created;
+            }
+            node = child;
+        }
+        automaton.trieTerminal[node] = 1;
+        maxDepth = max(maxDepth, itemEnd - itemStart);
+        itemStart = itemEnd;
+    }
+
+    // Number the nodes in BFS order.
+    automaton.queue[0] = 0;
+    automaton.parent[0] = -1;
+    SizeType32 tail{1};
+    for (SizeType32 head = 0; head < tail; ++head)
+    {
+        auto const trieNode = automaton.queue[head];
+        automaton.childBegin[head] = tail;
+        for (auto child = automaton.trieChild[trieNode]; child >= 0; child = automaton.trieSibling[child])
+        {
+            automaton.queue[tail] = child;
+            automaton.parent[tail] = head;
+            ++tail;
+        }
+        automaton.numChildren[head] = tail - automaton.childBegin[head];
+        automaton.token[head] = automaton.trieToken[trieNode];
+        automaton.terminal[head] = automaton.trieTerminal[trieNode];
+    }
+
+    // Failure links point to nodes of smaller depth, which come first in BFS order.
+    for (SizeType32 node = 0; node < numNodes; ++node)
+    {
+        auto const parent = automaton.parent[node];
+        SizeType32 fail{-1};
+        if (parent == 0)
+        {
+            fail = 0;
+        }
+        else if (parent > 0)
+        {
+            auto state = automaton.fail[parent];
+            while (true)
+            {
+                auto const child = findChild(automaton, state, automaton.token[node]);
+                if (child >= 0 || state == 0)
+                {
+                    fail = max(child, 0);
+                    break;
+                }
+                state = automaton.fail[state];
+            }
+        }
+        automaton.fail[node] = fail;
+        automaton.matches[node] = automaton.terminal[node] != 0 || (fail >= 0 && automaton.matches[fail] != 0);
+
+        bool hasTerminalChild{false};
+        auto const childBegin = automaton.childBegin[node];
+        for (auto child = childBegin; child < childBegin + automaton.numChildren[node]; ++child)
+        {
+            hasTerminalChild |= automaton.terminal[child] != 0;
+        }
+        automaton.banNext[node] = hasTerminalChild ? node : (fail >= 0 ? automaton.banNext[fail] : -1);
+    }
+
+    automaton.header[kNumNodes] = numNodes;
+    automaton.header[kState] = 0;
+    automaton.header[kPosition] = 0;
+    automaton.header[kMaxDepth] = maxDepth;
+    automaton.header[kBuilt] = 1;
+}
+
+__global__ void stopWordsCriterionAutomaton(TokenIdType const** outputIds, SizeType32* automata,
+    SizeType32 automatonSize, FinishedState* finished, SizeType32* sequenceLengths, SizeType32 const* batchSlots,
+    SizeType32* numNewTokens, SizeType32 batchSize)
+{
+    auto const batchIdx = static_cast<SizeType32>(blockIdx.x * blockDim.x + threadIdx.x);
+    if (batchIdx >= batchSize)
+    {
+        return;
+    }
+    auto const batchSlot = batchSlots[batchIdx];
+    auto const automaton = getAutomaton(automata, automatonSize, batchSlot);
+    if (automaton.header[kBuilt] == 0 || automaton.header[kNumNodes] == 1)
+    {
+        return;
+    }
+
+    auto const* ids = outputIds[batchSlot];
+    auto const newTokens = numNewTokens ? numNewTokens[batchSlot] : 1;
+    // sequenceLengths already include the new tokens.
+    auto const firstNewIdx = sequenceLengths[batchSlot] - newTokens;
+    auto state = feed(automaton, ids, firstNewIdx);
+    auto position = firstNewIdx;
+    for (SizeType32 step = 0; step < newTokens; ++step)
+    {
+        state = advance(automaton, state, ids[position++]);
+        if (automaton.matches[state] != 0)
+        {
+            finished[batchSlot].setFinishedStopWords();
+            // When more than 1 token is predicted per step, keep the tokens up to the stop word (including).
+            if (newTokens > 1)
+            {
+                numNewTokens[batchSlot] = step + 1;
+                sequenceLengths[batchSlot] = position;
+            }
+            break;
+        }
+    }
+    automaton.header[kState] = state;
+    automaton.header[kPosition] = position;
+}
+
+template <typename T>
+__global__ void banBadWordsAutomaton(T* logits, TokenIdType const** outputIds, SizeType32* automata,
+    SizeType32 automatonSize, SizeType32 const* batchSlots, SizeType32 vocabSizePadded,
+    SizeType32 const* sequenceLengths)
+{
+    auto const batchIdx = static_cast<SizeType32>(blockIdx.x);
+    auto const batchSlot = batchSlots[batchIdx];
+    auto const automaton = getAutomaton(automata, automatonSize, batchSlot);
+    if (automaton.header[kBuilt] == 0 || automaton.header[kNumNodes] == 1)
+    {
+        return;
+    }
+
+    // One warp per request. The first lane advances the sequence, the lanes then visit the children together.
+    SizeType32 state{0};
+    if (threadIdx.x == 0)
+    {
+        auto const sequenceLength = sequenceLengths[batchSlot];
+        state = feed(automaton, outputIds[batchSlot], sequenceLength);
+        automaton.header[kState] = state;
+        automaton.header[kPosition] = sequenceLength;
+    }
+    state = __shfl_sync(0xffffffff, state, 0);
+
+    // The node of each suffix of the sequence in the automaton bans the last token of the words it continues to.
+    for (auto node = automaton.banNext[state]; node >= 0;
+         node = node == 0 ? -1 : automaton.banNext[automaton.fail[node]])
+    {
+        auto const childBegin = automaton.childBegin[node];
+        for (auto child = childBegin + static_cast<SizeType32>(threadIdx.x);
+             child < childBegin + automaton.numChildren[node]; child += static_cast<SizeType32>(blockDim.x))
+        {
+            auto const bannedToken = automaton.token[child];
+            if (automaton.terminal[child] != 0 && 0 <= bannedToken && bannedToken < vocabSizePadded)
+            {
+                logits[batchIdx * vocabSizePadded + bannedToken] = static_cast<T>(-INFINITY);
+            }
+        }
+    }
+}
+} // namespace
+
+SizeType32 getWordsAutomatonSize(SizeType32 maxWordsLen)
+{
+    // Every token of the words adds at most one node to the root.
+    return kHeaderSize + kNumArrays * (maxWordsLen + 1);
+}
+
+void invokeBuildWordsAutomata(TokenIdType const* const* words, SizeType32 const* wordsLens,
+    SizeType32 const* batchSlots, SizeType32 batchSize, SizeType32 automatonSize, SizeType32* automata,
+    cudaStream_t stream)
+{
+    // Building is sequential and done once per request, a single thread per request does it.
+    buildWordsAutomata<<<batchSize, 1, 0, stream>>>(words, wordsLens, batchSlots, automatonSize, automata);
+    sync_check_cuda_error();
+}
+
+void invokeStopWordsCriterionAutomaton(TokenIdType const** outputIds, SizeType32* automata, SizeType32 automatonSize,
+    FinishedState* finished, SizeType32* sequenceLengths, SizeType32 const* batchSlots, SizeType32* numNewTokens,
+    SizeType32 batchSize, cudaStream_t stream)
+{
+    constexpr SizeType32 blockSize{128};
+    auto const gridSize = (batchSize + blockSize - 1) / blockSize;
+    stopWordsCriterionAutomaton<<<gridSize, blockSize, 0, stream>>>(
+        outputIds, automata, automatonSize, finished, sequenceLengths, batchSlots, numNewTokens, batchSize);
+    sync_check_cuda_error();
+}
+
+template <typename T>
+void invokeBanBadWordsAutomaton(T* logits, TokenIdType const** outputIds, SizeType32* automata,
+    SizeType32 automatonSize, SizeType32 const* batchSlots, SizeType32 batchSize, SizeType32 vocabSizePadded,
+    SizeType32 const* sequenceLengths, cudaStream_t stream)
+{
+    banBadWordsAutomaton<<<batchSize, 32, 0, stream>>>(
+        logits, outputIds, automata, automatonSize, batchSlots, vocabSizePadded, sequenceLengths);
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_BAN_BAD_WORDS_AUTOMATON(T)                                                                         \
+    template void invokeBanBadWordsAutomaton(T* logits, TokenIdType const** outputIds, SizeType32* automata,           \
+        SizeType32 automatonSize, SizeType32 const* batchSlots, SizeType32 batchSize, SizeType32 vocabSizePadded,      \
+        SizeType32 const* sequenceLengths, cudaStream_t stream);
+
+INSTANTIATE_BAN_BAD_WORDS_AUTOMATON(float)
+INSTANTIATE_BAN_BAD_WORDS_AUTOMATON(half)
+#ifdef ENABLE_BF16
+INSTANTIATE_BAN_BAD_WORDS_AUTOMATON(__nv_bfloat16)
+#endif
+#undef INSTANTIATE_BAN_BAD_WORDS_AUTOMATON
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm::kernels
+{
+
+//! \brief Returns the number of int32 entries of the automaton of one request, for word lists of up to maxWordsLen
+//! tokens in total.
+runtime::SizeType32 getWordsAutomatonSize(runtime::SizeType32 maxWordsLen);
+
+//! \brief Compiles the word lists of the requests into Aho-Corasick automata, on the device.
+//! Only the automata that are zeroed are built, so a request is compiled once and must be zeroed when its batch slot
+//! is reused. The automaton also keeps the state of the sequence of the request, which the kernels below advance by
+//! the tokens generated since their last call. Supports beam width 1 only.
+//!
+//! \param words input buffer [maxBatchSize][2, wordsLen]. Same layout as the stopWords of invokeStopWordsCriterion
+//! \param wordsLens input buffer [maxBatchSize], total number of tokens of the words per request
+//! \param batchSlots input buffer [batchSize]. Indices of rows of data in memory pool
+//! \param batchSize batch size
+//! \param automatonSize getWordsAutomatonSize of the longest word list, larger than for any wordsLens
+//! \param automata input/output buffer [maxBatchSize, automatonSize]
+//! \param stream stream
+void invokeBuildWordsAutomata(runtime::TokenIdType const* const* words, runtime::SizeType32 const* wordsLens,
+    runtime::SizeType32 const* batchSlots, runtime::SizeType32 batchSize, runtime::SizeType32 automatonSize,
+    runtime::SizeType32* automata, cudaStream_t stream);
+
+//! \brief Same as invokeStopWordsCriterion for beam width 1, with the words compiled by invokeBuildWordsAutomata.
+//! Each new token costs one transition of the automaton, whatever the number of words.
+void invokeStopWordsCriterionAutomaton(runtime::TokenIdType const** outputIds, runtime::SizeType32* automata,
+    runtime::SizeType32 automatonSize, FinishedState* finished, runtime::SizeType32* sequenceLengths,
+    runtime::SizeType32 const* batchSlots, runtime::SizeType32* numNewTokens, runtime::SizeType32 batchSize,
+    cudaStream_t stream);
+
+//! \brief Same as invokeBanBadWords for beam width 1, with the words compiled by invokeBuildWordsAutomata.
+//! Advancing the sequence costs one transition, after which only the words that end with the next token are visited.
+template <typename T>
+void invokeBanBadWordsAutomaton(T* logits, runtime::TokenIdType const** outputIds, runtime::SizeType32* automata,
+    runtime::SizeType32 automatonSize, runtime::SizeType32 const* batchSlots, runtime::SizeType32 batchSize,
+    runtime::SizeType32 vocabSizePadded, runtime::SizeType32 const* sequenceLengths, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
@@ -48,8 +48,11 @@ XqaDispatcher::XqaDispatcher(XqaFixedParams fixedParams)
 {
     if (mUseTllmGen)
     {
-        // The preprocessing kernel will convert Q from inputDataType to fp8 if the kv cache dtype is also e4m3.
-        mQDataType = (mFixedParams.kvDataType == DATA_TYPE_E4M3) ? DATA_TYPE_E4M3 : mFixedParams.inputDataType;
+        // The preprocessing kernel will convert Q from inputDataType to fp8 if the kv cache dtype is e4m3 or e2m1, as
+        // the kernels dequantize the e2m1 kv cache to e4m3.
+        mQDataType = (mFixedParams.kvDataType == DATA_TYPE_E4M3 || mFixedParams.kvDataType == DATA_TYPE_E2M1)
+            ? DATA_TYPE_E4M3
+            : mFixedParams.inputDataType;
         mTllmGenFMHARunner.reset(
             new TllmGenFmhaRunner(mQDataType, mFixedParams.kvDataType, mFixedParams.outputDataType));
     }
@@ -157,12 +160,21 @@ bool XqaDispatcher::shouldUse(XQAParams const& params)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+bool XqaDispatcher::useJitImpl(XQAParams const& params)
+{
+    return !mUseTllmGen && mDecoderXqaRunner->isJitImpl(params);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 bool XqaDispatcher::isSupported()
 {
     if (mUseTllmGen)
     {
         // TODO (perkzz): add the support of fp8-kv fp16/bf16-mma fmha.
-        if ((mFixedParams.kvDataType != mFixedParams.mathDataType) || (mQDataType != mFixedParams.mathDataType))
+        bool const isFp4Kv = mFixedParams.kvDataType == DATA_TYPE_E2M1 && mFixedParams.mathDataType == DATA_TYPE_E4M3;
+        if ((mFixedParams.kvDataType != mFixedParams.mathDataType && !isFp4Kv)
+            || (mQDataType != mFixedParams.mathDataType))
         {
             TLLM_LOG_WARNING("Unsupported data type combination.");
             return false;
@@ -219,7 +231,8 @@ bool XqaDispatcher::isSupported()
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 template <typename T, typename KVCacheBuffer>
-void XqaDispatcher::runImpl(XQAParams params, KVCacheBuffer const& kv_cache_buffer)
+void XqaDispatcher::runImpl(
+    XQAParams params, KVCacheBuffer const& kv_cache_buffer, KVCacheBuffer const& kv_cache_block_scales_buffer)
 {
     if (mUseTllmGen)
     {
@@ -232,9 +245,8 @@ void XqaDispatcher::runImpl(XQAParams params, KVCacheBuffer const& kv_cache_buff
         unsigned int beam_width = params.beam_width;
         unsigned int batch_beam_size = params.batch_size * beam_width;
 
-        const KvCacheDataType cache_type = params.kv_cache_quant_mode.hasInt8KvCache()
-            ? KvCacheDataType::INT8
-            : (params.kv_cache_quant_mode.hasFp8KvCache() ? KvCacheDataType::FP8 : KvCacheDataType::BASE);
+        const KvCacheDataType cache_type = getKvCacheDataType(params.kv_cache_quant_mode);
+        bool const is_fp4_kv = cache_type == KvCacheDataType::NVFP4;
 
         XQALaunchParam<KVCacheBuffer> launchParams;
         void* inputScratch = nullptr;
@@ -263,6 +275,11 @@ void XqaDispatcher::runImpl(XQAParams params, KVCacheBuffer const& kv_cache_buff
             decoder_params.dequantScaleQ = params.kv_scale_quant_orig;
             decoder_params.dequantScaleKv = params.kv_scale_quant_orig;
         }
+        else if (is_fp4_kv)
+        {
+            // The e2m1 kv cache is dequantized by its block scales and kvSfScalePtr instead.
+            decoder_params.dequantScaleQ = params.kv_scale_quant_orig;
+        }
         if (params.is_fp8_output)
         {
             decoder_params.quantScaleO = params.fp8_out_scale;
@@ -285,12 +302,13 @@ void XqaDispatcher::runImpl(XQAParams params, KVCacheBuffer const& kv_cache_buff
         void* xqa_q_input_ptr = inputScratch;
         QKVPreprocessingParams<T, KVCacheBuffer> preprocessingParms{static_cast<T*>(const_cast<void*>(params.qkv)),
             nullptr, nullptr, static_cast<T*>(xqa_q_input_ptr), kv_cache_buffer,
-            /* kv_cache_block_scales_buffer*/ KVCacheBuffer{}, static_cast<T const*>(params.qkv_bias),
+            kv_cache_block_scales_buffer, static_cast<T const*>(params.qkv_bias),
             params.logn_scaling_ptr, /* tokens_info*/ nullptr, params.spec_decoding_generation_lengths,
             params.sequence_lengths,
             /* encoder_seqlens */ nullptr, params.multi_query_tokens ? launchParams.cu_seq_lens : nullptr,
             /* cu_kv_seqlens */ nullptr, launchParams.rotary_inv_freq_buf, nullptr, params.kv_scale_orig_quant,
-            /* kv_cache_scale_factors */ nullptr, params.spec_decoding_position_offsets, (float2 const*) nullptr,
+            /* kv_cache_scale_factors */ is_fp4_kv ? params.kv_scale_orig_quant : nullptr,
+            params.spec_decoding_position_offsets, (float2 const*) nullptr,
             params.mrope_position_deltas, int(batch_beam_size), params.generation_input_length,
             params.max_past_kv_length, params.cyclic_attention_window_size, params.sink_token_length,
             int(params.batch_size * beam_width * params.generation_input_length),
@@ -327,6 +345,12 @@ void XqaDispatcher::runImpl(XQAParams params, KVCacheBuffer const& kv_cache_buff
             tllmRunnerParams.kvPageIdxPtr = reinterpret_cast<KVCacheIndex::UnderlyingType const*>(kv_cache_buffer.data);
             tllmRunnerParams.mMaxNumPagesPerSeqKv = kv_cache_buffer.mMaxBlocksPerSeq;
             tllmRunnerParams.mNumTokensPerPage = kv_cache_buffer.mTokensPerBlock;
+            if (is_fp4_kv)
+            {
+                // The scale pools share the page indices of the kv pools.
+                tllmRunnerParams.kSfBasePtr = kv_cache_block_scales_buffer.mPrimaryPoolPtr;
+                tllmRunnerParams.vSfBasePtr = kv_cache_block_scales_buffer.mPrimaryPoolPtr;
+            }
         }
         else
         {
@@ -346,6 +370,8 @@ void XqaDispatcher::runImpl(XQAParams params, KVCacheBuffer const& kv_cache_buff
         tllmRunnerParams.scaleSoftmaxLog2Ptr
             = reinterpret_cast<float const*>(launchParams.bmm1_scale_ptr + kIdxScaleSoftmaxLog2Ptr);
         tllmRunnerParams.oSfScalePtr = params.fp4_out_sf_scale;
+        // The second level scales that dequantize the e4m3 block scales of the e2m1 kv cache.
+        tllmRunnerParams.kvSfScalePtr = is_fp4_kv ? params.kv_scale_quant_orig : nullptr;
 
         tllmRunnerParams.oPtr = params.output;
         tllmRunnerParams.oSfPtr = params.output_sf;
@@ -365,9 +391,11 @@ void XqaDispatcher::runImpl(XQAParams params, KVCacheBuffer const& kv_cache_buff
         if constexpr (std::is_same_v<KVCacheBuffer, KVBlockArray>)
         {
             auto const [freeMemory, totalMemory] = tensorrt_llm::common::getDeviceMemoryInfo(false);
+            // Sized in elements, e2m1 has half a byte per element.
             tllmRunnerParams.mNumPagesInMemPool = totalMemory
-                / (tllmRunnerParams.mNumHeadsKv * tllmRunnerParams.mNumTokensPerPage * tllmRunnerParams.mHeadDim
-                    * get_size_in_bytes(mFixedParams.kvDataType));
+                / get_size_in_bytes(static_cast<size_t>(tllmRunnerParams.mNumHeadsKv)
+                        * tllmRunnerParams.mNumTokensPerPage * tllmRunnerParams.mHeadDim,
+                    mFixedParams.kvDataType);
         }
         tllmRunnerParams.mMaxNumCtas = mMultiProcessorCount;
         tllmRunnerParams.stream = params.stream;
@@ -382,31 +410,33 @@ void XqaDispatcher::runImpl(XQAParams params, KVCacheBuffer const& kv_cache_buff
     }
 }
 
-void XqaDispatcher::run(XQAParams const& params, KVLinearBuffer const& kv_cache_buffer)
+void XqaDispatcher::run(
+    XQAParams const& params, KVLinearBuffer const& kv_cache_buffer, KVLinearBuffer const& kv_cache_block_scales_buffer)
 {
     TLLM_CHECK_WITH_INFO((mFixedParams.inputDataType == DATA_TYPE_FP16 || mFixedParams.inputDataType == DATA_TYPE_BF16),
         "The input Qkv tensor must be fp16/bf16.");
     if (mFixedParams.inputDataType == DATA_TYPE_FP16)
     {
-        this->runImpl<__half, KVLinearBuffer>(params, kv_cache_buffer);
+        this->runImpl<__half, KVLinearBuffer>(params, kv_cache_buffer, kv_cache_block_scales_buffer);
     }
     else
     {
-        this->runImpl<__nv_bfloat16, KVLinearBuffer>(params, kv_cache_buffer);
+        this->runImpl<__nv_bfloat16, KVLinearBuffer>(params, kv_cache_buffer, kv_cache_block_scales_buffer);
     }
 }
 
-void XqaDispatcher::run(XQAParams const& params, KVBlockArray const& kv_cache_buffer)
+void XqaDispatcher::run(
+    XQAParams const& params, KVBlockArray const& kv_cache_buffer, KVBlockArray const& kv_cache_block_scales_buffer)
 {
     TLLM_CHECK_WITH_INFO((mFixedParams.inputDataType == DATA_TYPE_FP16 || mFixedParams.inputDataType == DATA_TYPE_BF16),
         "The input Qkv tensor must be fp16/bf16.");
     if (mFixedParams.inputDataType == DATA_TYPE_FP16)
     {
-        this->runImpl<__half, KVBlockArray>(params, kv_cache_buffer);
+        this->runImpl<__half, KVBlockArray>(params, kv_cache_buffer, kv_cache_block_scales_buffer);
     }
     else
     {
-        this->runImpl<__nv_bfloat16, KVBlockArray>(params, kv_cache_buffer);
+        this->runImpl<__nv_bfloat16, KVBlockArray>(params, kv_cache_buffer, kv_cache_block_scales_buffer);
     }
 }
 
@@ -77,10 +77,12 @@ public:
     // Check whether XQA is supported.
     bool isSupported();
 
-    // Run the XQA kernel.
-    void run(XQAParams const& params, KVLinearBuffer const& kv_cache_buffer);
+    // Run the XQA kernel. The block scales are only read with the NVFP4 KV cache.
+    void run(XQAParams const& params, KVLinearBuffer const& kv_cache_buffer,
+        KVLinearBuffer const& kv_cache_block_scales_buffer = KVLinearBuffer{});
 
-    void run(XQAParams const& params, KVBlockArray const& kv_cache_buffer);
+    void run(XQAParams const& params, KVBlockArray const& kv_cache_buffer,
+        KVBlockArray const& kv_cache_block_scales_buffer = KVBlockArray{});
 
     int getWorkspaceAlignment();
 
@@ -88,6 +90,15 @@ public:
 
     bool shouldUse(XQAParams const& params);
 
+    // Whether the trtllm-gen kernels run instead of the decoder XQA ones.
+    bool useTllmGen() const
+    {
+        return mUseTllmGen;
+    }
+
+    // Whether the decoder XQA kernels for the params are JIT compiled, false for the precompiled and trtllm-gen ones.
+    bool useJitImpl(XQAParams const& params);
+
 private:
     // The fixed XQA parameters.
     XqaFixedParams mFixedParams;
@@ -104,7 +115,8 @@ private:
 
 protected:
     template <typename T, typename KVCacheBuffer>
-    void runImpl(XQAParams params, KVCacheBuffer const& kv_cache_buffer);
+    void runImpl(
+        XQAParams params, KVCacheBuffer const& kv_cache_buffer, KVCacheBuffer const& kv_cache_block_scales_buffer);
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -18,6 +18,7 @@
 #include "banWordsLayer.h"
 #include "tensorrt_llm/kernels/banBadWords.h"
 #include "tensorrt_llm/kernels/banRepeatNgram.h"
+#include "tensorrt_llm/kernels/wordsAutomatonKernels.h"
 #include "tensorrt_llm/layers/defaultDecodingParams.h"
 #include "tensorrt_llm/layers/layerUtils.h"
 
@@ -74,6 +75,56 @@ void BanWordsLayer<T>::setup(SizeType32 batchSize, SizeType32 beamWidth, TensorC
             mNoRepeatNgramSize, mNoRepeatNgramSizeDevice, batchSlots,
             std::make_pair(0.f, std::numeric_limits<float>::max()), "no_repeat_ngram_size");
     }
+    // New requests index their sequence and compile their bad words from scratch.
+    auto const* batchSlotsPtr = bufferCast<SizeType32>(*batchSlots);
+    for (SizeType32 bi = 0; bi < batchSize; ++bi)
+    {
+        for (auto const& perSlotBuffer : {mNgramTablesDevice, mBadWordsAutomataDevice})
+        {
+            if (perSlotBuffer)
+            {
+                auto slice = ITensor::slice(perSlotBuffer, batchSlotsPtr[bi], 1);
+                mBufferManager->setZero(*slice);
+            }
+        }
+    }
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
+template <typename T>
+void BanWordsLayer<T>::allocateNgramTables(SizeType32 maxSeqLen)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+
+    // Beam search reorders the histories, it keeps rescanning them.
+    if (mNgramTablesDevice || !mDecodingMode.isUseNoRepeatNgramSize() || mDecoderDomain.getBeamWidth() != 1)
+    {
+        return;
+    }
+    mNgramTableSize = getBanRepeatNgramTableSize(maxSeqLen);
+    mNgramTablesDevice = mBufferManager->gpu(
+        ITensor::makeShape({mDecoderDomain.getBatchSize(), 1 + 2 * mNgramTableSize}), TRTDataType<SizeType32>::value);
+    mBufferManager->setZero(*mNgramTablesDevice);
+
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
+template <typename T>
+void BanWordsLayer<T>::allocateBadWordsAutomata(SizeType32 maxBadWordsLen)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+
+    auto const automatonSize = getWordsAutomatonSize(maxBadWordsLen);
+    if (automatonSize <= mBadWordsAutomatonSize)
+    {
+        return;
+    }
+    // Grow by powers of 2 to rarely recompile. Zeroed automata are compiled again on their next use.
+    mBadWordsAutomatonSize = std::max(automatonSize, 2 * mBadWordsAutomatonSize);
+    mBadWordsAutomataDevice = mBufferManager->gpu(
+        ITensor::makeShape({mDecoderDomain.getBatchSize(), mBadWordsAutomatonSize}), TRTDataType<SizeType32>::value);
+    mBufferManager->setZero(*mBadWordsAutomataDevice);
+
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
 
@@ -97,10 +148,19 @@ void BanWordsLayer<T>::banRepeatNGrams(TensorPtr const& logits, std::shared_ptr<
         auto sequenceLengthPtr = bufferCast<SizeType32>(*outputs->sequenceLength.value());
         auto noRepeatNgramSizeDevicePtr = bufferCastOrNull<SizeType32>(noRepeatNgramSizeDevice);
 
-        // Call to invokeBanRepeatNgram with dereferenced inputs
-        invokeBanRepeatNgram(logitsPtr, outputIdsPtr, finishedPtr, parentIdsPtr, batchSlotsPtr, sequenceLengthPtr,
-            decoderDomain.getBatchSize(), decoderDomain.getBeamWidth(), maxSeqLen, noRepeatNgramSizeDevicePtr,
-            decoderDomain.getVocabSizePadded(), maxStep, getStream());
+        if (mNgramTablesDevice && decoderDomain.getBeamWidth() == 1)
+        {
+            invokeBanRepeatNgramIncremental(logitsPtr, outputIdsPtr, finishedPtr, batchSlotsPtr, sequenceLengthPtr,
+                decoderDomain.getBatchSize(), noRepeatNgramSizeDevicePtr, decoderDomain.getVocabSizePadded(),
+                bufferCast<SizeType32>(*mNgramTablesDevice), mNgramTableSize, getStream());
+        }
+        else
+        {
+            // Call to invokeBanRepeatNgram with dereferenced inputs
+            invokeBanRepeatNgram(logitsPtr, outputIdsPtr, finishedPtr, parentIdsPtr, batchSlotsPtr, sequenceLengthPtr,
+                decoderDomain.getBatchSize(), decoderDomain.getBeamWidth(), maxSeqLen, noRepeatNgramSizeDevicePtr,
+                decoderDomain.getVocabSizePadded(), maxStep, getStream());
+        }
     }
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
@@ -124,10 +184,23 @@ void BanWordsLayer<T>::banBadWords(TensorPtr const& logits, std::shared_ptr<Base
         auto sequenceLengthPtr = bufferCast<SizeType32>(*outputs->sequenceLength.value());
         auto batchSlotsPtr = bufferCast<SizeType32>(*batchSlots);
 
-        // Call to invokeBanBadWords with dereferenced inputs
-        invokeBanBadWords(logitsPtr, outputIdsPtr, parentIdsPtr, batchSlotsPtr, decoderDomain.getBatchSize(),
-            decoderDomain.getBeamWidth(), badWordsPtr, badWordsLens, maxBadWordsLength,
-            decoderDomain.getVocabSizePadded(), sequenceLengthPtr, maxSeqLen, getStream());
+        if (decoderDomain.getBeamWidth() == 1)
+        {
+            // Beam search reorders the histories, it keeps matching every word.
+            allocateBadWordsAutomata(maxBadWordsLength);
+            auto* automataPtr = bufferCast<SizeType32>(*mBadWordsAutomataDevice);
+            invokeBuildWordsAutomata(badWordsPtr, badWordsLens, batchSlotsPtr, decoderDomain.getBatchSize(),
+                mBadWordsAutomatonSize, automataPtr, getStream());
+            invokeBanBadWordsAutomaton(logitsPtr, outputIdsPtr, automataPtr, mBadWordsAutomatonSize, batchSlotsPtr,
+                decoderDomain.getBatchSize(), decoderDomain.getVocabSizePadded(), sequenceLengthPtr, getStream());
+        }
+        else
+        {
+            // Call to invokeBanBadWords with dereferenced inputs
+            invokeBanBadWords(logitsPtr, outputIdsPtr, parentIdsPtr, batchSlotsPtr, decoderDomain.getBatchSize(),
+                decoderDomain.getBeamWidth(), badWordsPtr, badWordsLens, maxBadWordsLength,
+                decoderDomain.getVocabSizePadded(), sequenceLengthPtr, maxSeqLen, getStream());
+        }
     }
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
@@ -147,6 +220,10 @@ void BanWordsLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> const&
     auto const localDecoderDomain = getLocalDecoderDomain(inputs, mDecoderDomain);
     auto const maxSeqLen = outputs->outputIds->getDimension<-1>();
 
+    if (mUseNoRepeatNgramSize)
+    {
+        allocateNgramTables(maxSeqLen);
+    }
     banRepeatNGrams(workspace->getDeviceRuntimeLogits(), outputs, inputs, workspace->getDeviceBatchSlots(),
         mNoRepeatNgramSizeDevice, localDecoderDomain, maxSeqLen, mUseNoRepeatNgramSize);
     banBadWords(workspace->getDeviceRuntimeLogits(), outputs, inputs, workspace->getDeviceBatchSlots(),
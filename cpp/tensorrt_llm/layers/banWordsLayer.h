@@ -57,6 +57,8 @@ private:
         std::shared_ptr<DecodingInputs> const& inputs, BufferConstPtr const& batchSlots,
         BufferPtr noRepeatNgramSizeDevice, DecoderDomain const& decoderDomain, runtime::SizeType32 maxSeqLen,
         bool useNoRepeatNgramSize);
+    void allocateNgramTables(runtime::SizeType32 maxSeqLen);
+    void allocateBadWordsAutomata(runtime::SizeType32 maxBadWordsLen);
 
 private:
     executor::DecodingMode mDecodingMode;
@@ -64,6 +66,12 @@ private:
     TensorPtr mNoRepeatNgramSizeDevice;
     TensorPtr mNoRepeatNgramSize;
     bool mUseNoRepeatNgramSize{false};
+    // Seen n-grams per batch slot for beam width 1, see invokeBanRepeatNgramIncremental.
+    TensorPtr mNgramTablesDevice;
+    runtime::SizeType32 mNgramTableSize{0};
+    // Bad words compiled per batch slot for beam width 1, see invokeBuildWordsAutomata.
+    TensorPtr mBadWordsAutomataDevice;
+    runtime::SizeType32 mBadWordsAutomatonSize{0};
 };
 
 } // namespace tensorrt_llm::layers
@@ -94,9 +94,11 @@ void BeamSearchLayer<T>::allocateBuffer()
     mBeamSearchDiversityRateHost = mBufferManager->pinnedPool(batchSizeShape, TRTDataType<float>::value);
     mLengthPenaltyHost = mBufferManager->pinnedPool(batchSizeShape, TRTDataType<float>::value);
     mEarlyStoppingHost = mBufferManager->pinnedPool(batchSizeShape, TRTDataType<int>::value);
+    mBeamWidthHost = mBufferManager->pinnedPool(batchSizeShape, TRTDataType<SizeType32>::value);
     mBeamSearchDiversityRateDevice = mBufferManager->gpu(batchSizeShape, TRTDataType<float>::value);
     mLengthPenaltyDevice = mBufferManager->gpu(batchSizeShape, TRTDataType<float>::value);
     mEarlyStoppingDevice = mBufferManager->gpu(batchSizeShape, TRTDataType<int>::value);
+    mBeamWidthDevice = mBufferManager->gpu(batchSizeShape, TRTDataType<SizeType32>::value);
 
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
@@ -278,6 +280,8 @@ void BeamSearchLayer<T>::setup(SizeType32 const batchSize, SizeType32 const beam
     fillBuffers(setupParams->earlyStopping, DefaultDecodingParams::getEarlyStopping(), mEarlyStoppingHost,
         mEarlyStoppingDevice, batchSlots, std::make_pair(-fltEpsilon, std::numeric_limits<int>::max()),
         "early stopping");
+    fillBuffers(setupParams->beamWidth, beamWidth, mBeamWidthHost, mBeamWidthDevice, batchSlots,
+        std::make_pair(0.f, static_cast<float>(beamWidth)), "beam width");
 
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
@@ -351,6 +355,7 @@ void BeamSearchLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> const
     bh.diversityRates = bufferCast<float>(*mBeamSearchDiversityRateDevice);
     bh.lengthPenalties = bufferCast<float>(*mLengthPenaltyDevice);
     bh.earlyStoppings = bufferCast<int>(*mEarlyStoppingDevice);
+    bh.beamWidths = bufferCast<SizeType32>(*mBeamWidthDevice);
 
     bh.inputLengths = bufferCast<SizeType32>(*ip->inputLengths.value());
     bh.endIds = bufferCast<TokenIdType>(*ip->endIds);
@@ -60,9 +60,11 @@ private:
     TensorPtr mBeamSearchDiversityRateDevice; // [batchSize], in device memory.
     TensorPtr mLengthPenaltyDevice;           // [batchSize], in device memory.
     TensorPtr mEarlyStoppingDevice;           // [batchSize], in device memory.
+    TensorPtr mBeamWidthDevice;               // [batchSize], in device memory.
     TensorPtr mBeamSearchDiversityRateHost;   // [batchSize], in pinned host memory.
     TensorPtr mLengthPenaltyHost;             // [batchSize], in pinned host memory.
     TensorPtr mEarlyStoppingHost;             // [batchSize], in pinned host memory.
+    TensorPtr mBeamWidthHost;                 // [batchSize], in pinned host memory.
 };
 
 } // namespace tensorrt_llm::layers
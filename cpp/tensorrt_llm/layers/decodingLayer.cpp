@@ -204,6 +204,7 @@ std::tuple<std::shared_ptr<BaseDecodingOutputs>, std::shared_ptr<BaseDecodingInp
         decodeInputs->finished = params->finished;
 
         decodeInputs->logits = logitsSlice;
+        decodeInputs->deferredPenaltyParams = params->deferredPenaltyParams;
 
         if (params->inputLengths)
         {
@@ -265,6 +266,8 @@ std::tuple<std::shared_ptr<BaseDecodingOutputs>, std::shared_ptr<BaseDecodingInp
         decodeInputs->draftTokenIds = externalDraftTokenParams->draftTokenIds;
         decodeInputs->constantThreshold = externalDraftTokenParams->constantThreshold;
         decodeInputs->useRandomAcceptanceThreshold = externalDraftTokenParams->useRandomAcceptanceThreshold;
+        decodeInputs->typicalAcceptanceEpsilon = externalDraftTokenParams->typicalAcceptanceEpsilon;
+        decodeInputs->typicalAcceptanceDelta = externalDraftTokenParams->typicalAcceptanceDelta;
         decodeInputs->step = externalDraftTokenParams->step;
         decodeInputs->useDraftLogits = externalDraftTokenParams->useDraftLogits;
         decodeInputs->useDraftLogitsHost = externalDraftTokenParams->useDraftLogitsHost;
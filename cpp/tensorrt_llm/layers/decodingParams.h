@@ -152,6 +152,7 @@ public:
     std::optional<std::vector<runtime::SizeType32>> runtimeTopK; // [1] or [setupBatchSize] on cpu
     std::optional<std::vector<float>> runtimeTopP;               // [1] or [setupBatchSize] on cpu
     std::optional<std::vector<float>> runtimeMinP;               // [1] or [setupBatchSize] on cpu
+    std::optional<std::vector<float>> runtimeTypicalP;           // [1] or [setupBatchSize] on cpu
 
     // topPSamplingLayer
     std::optional<std::vector<float>> topPDecay;                   // [setupBatchSize], must between [0, 1]
@@ -167,6 +168,8 @@ public:
     std::optional<std::vector<float>> beamSearchDiversityRate; // [setupBatchSize] on cpu
     std::optional<std::vector<float>> lengthPenalty;           // [setupBatchSize] on cpu
     std::optional<std::vector<int>> earlyStopping;             // [setupBatchSize] on cpu
+    //! Beam width of each request, up to the beam width of the setup. The beams beyond it are padding.
+    std::optional<std::vector<runtime::SizeType32>> beamWidth; // [setupBatchSize] on cpu
     bool hasDiffRuntimeArgs{false};
 };
 
@@ -326,6 +329,9 @@ public:
     std::optional<TensorConstPtr> finished;
     //! [maxBatchSize], on gpu
     std::optional<TensorPtr> curTokensPerStep;
+    //! kernels::InvokeBatchApplyPenaltyParams<T> of the logits type T, set if PenaltyLayer left the penalties to
+    //! the top-k sampling kernel. logits are then not penalized.
+    std::shared_ptr<void const> deferredPenaltyParams;
 
     std::shared_ptr<BanWordsDecodingInputs> banWordsInputs;
 
@@ -370,6 +376,9 @@ public:
     runtime::SizeType32 step{};
     float constantThreshold{};
     bool useRandomAcceptanceThreshold{};
+    //! Typical acceptance instead of rejection sampling if > 0, see invokeAcceptDraftTokens
+    float typicalAcceptanceEpsilon{};
+    float typicalAcceptanceDelta{};
 
     //! optional parameters
     //! [localBatchSize]
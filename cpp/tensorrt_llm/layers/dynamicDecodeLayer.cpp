@@ -15,8 +15,12 @@
  */
 
 #include "dynamicDecodeLayer.h"
+#include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/common/nvtxUtils.h"
 #include "tensorrt_llm/kernels/decodingKernels.h"
+#include "tensorrt_llm/kernels/greedyDecodeKernels.h"
+#include "tensorrt_llm/kernels/penaltyTypes.h"
+#include "tensorrt_llm/kernels/samplingTopKKernels.h"
 #include "tensorrt_llm/layers/layerUtils.h"
 #include "tensorrt_llm/layers/layersFactory.h"
 #include "tensorrt_llm/runtime/bufferManager.h"
@@ -40,7 +44,12 @@ size_t DynamicDecodeLayer<T>::getWorkspaceSize() const noexcept
     {
         maxWorkspaceSize = std::max(maxWorkspaceSize, layer->getWorkspaceSize());
     }
-    return maxWorkspaceSize;
+    // The logits pointers and the finished sums the greedy fast path mirrors in the workspace.
+    auto const batchSizeShape = ITensor::makeShape({mDecoderDomain.getBatchSize()});
+    auto const greedyWorkspaceSize = DecodingLayerWorkspace::calculateRequiredWorkspaceSize(
+        std::make_pair(batchSizeShape, TRTDataType<T*>::value),
+        std::make_pair(batchSizeShape, TRTDataType<SizeType32>::value));
+    return std::max(maxWorkspaceSize, greedyWorkspaceSize);
 }
 
 template <typename T>
@@ -91,6 +100,18 @@ void DynamicDecodeLayer<T>::allocateBuffer()
     mZeroParentIdsDevice
         = mBufferManager->gpu(ITensor::makeShape({2 * mDecoderDomain.getBatchSize()}), TRTDataType<TokenIdType>::value);
 
+    auto const batchSizeShape = ITensor::makeShape({mDecoderDomain.getBatchSize()});
+    mGreedyOnly.assign(mDecoderDomain.getBatchSize(), false);
+    mGreedyMinLength = mBufferManager->pinnedPool(batchSizeShape, TRTDataType<SizeType32>::value);
+    mGreedyMinLengthDevice = mBufferManager->gpu(batchSizeShape, TRTDataType<SizeType32>::value);
+    mGreedyLogitsPtrsHost = mBufferManager->pinnedPool(ITensor::makeShape({}), TRTDataType<T*>::value);
+    auto const greedyWorkspaceSize = static_cast<ITensor::DimType64>(
+        getGreedyDecodeWorkspaceSize(mDecoderDomain.getBatchSize()));
+    mGreedyWorkspaceDevice = mBufferManager->gpu(ITensor::makeShape({greedyWorkspaceSize}), nvinfer1::DataType::kINT8);
+    mGreedyBlockCountersDevice = mBufferManager->gpu(batchSizeShape, TRTDataType<SizeType32>::value);
+    mBufferManager->setZero(*mGreedyBlockCountersDevice);
+    mMultiProcessorCount = getMultiProcessorCount();
+
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
 
@@ -167,6 +188,8 @@ void DynamicDecodeLayer<T>::setup(SizeType32 batchSize, SizeType32 beamWidth, Te
         layer->setup(batchSize, beamWidth, batchSlots, baseSetupParams, workspace);
     }
 
+    setupGreedyFastPath(batchSize, batchSlots, setupParams);
+
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
 
@@ -201,6 +224,8 @@ void DynamicDecodeLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> co
             ITensor::makeShape({static_cast<int32_t>(maxSeqLen), static_cast<int32_t>(mDecoderDomain.getBatchSize())}));
         mParentIdsPtrHost->reshape(
             ITensor::makeShape({static_cast<int32_t>(maxSeqLen), static_cast<int32_t>(mDecoderDomain.getBatchSize())}));
+        mGreedyLogitsPtrsHost->reshape(
+            ITensor::makeShape({static_cast<int32_t>(maxSeqLen), static_cast<int32_t>(mDecoderDomain.getBatchSize())}));
         mRuntimeMaxSeqLen = maxSeqLen;
     }
 
@@ -210,15 +235,23 @@ void DynamicDecodeLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> co
     prepareIdsPtrs(baseOutputs, params->batchSlots, localDecoderDomain.getBatchSize(),
         localDecoderDomain.getBeamWidth(), maxSeqLen);
 
-    for (auto& layer : mLayers)
+    bool const greedy = canUseGreedyFastPath(params, localDecoderDomain);
+    if (greedy)
     {
-        layer->forwardAsync(baseOutputs, baseInputs, workspace);
+        forwardGreedy(baseOutputs, params, localDecoderDomain, workspace);
+    }
+    else
+    {
+        for (auto& layer : mLayers)
+        {
+            layer->forwardAsync(baseOutputs, baseInputs, workspace);
+        }
     }
 
     // Copy nextIds and transpose logits when needed
     prepareOutputData(baseOutputs, workspace->getDeviceBatchSlots(), localDecoderDomain.getBatchSize(),
         mDecoderDomain.getBatchSize(), localDecoderDomain.getBeamWidth(), maxSeqLen,
-        mDecoderDomain.getMaxDecodingTokens(), mOutputLogProbs, getStream());
+        mDecoderDomain.getMaxDecodingTokens(), mOutputLogProbs, /* copyNextStepIds */ !greedy, getStream());
 
     mCyclicStep += 1;
 
@@ -282,7 +315,7 @@ void DynamicDecodeLayer<T>::prepareIdsPtrs(std::shared_ptr<BaseDecodingOutputs>
 template <typename T>
 void DynamicDecodeLayer<T>::prepareOutputData(std::shared_ptr<BaseDecodingOutputs> const& outputs,
     BufferConstPtr batchSlots, SizeType32 batchSize, SizeType32 maxBatchSize, SizeType32 beamWidth,
-    SizeType32 maxSeqLen, SizeType32 maxTokensPerStep, bool outputLogProbs, cudaStream_t stream)
+    SizeType32 maxSeqLen, SizeType32 maxTokensPerStep, bool outputLogProbs, bool copyNextStepIds, cudaStream_t stream)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
     auto outputIdsPtrDevice = bufferCast<TokenIdType*>(*mOutputIdsPtrDevice);
@@ -291,8 +324,11 @@ void DynamicDecodeLayer<T>::prepareOutputData(std::shared_ptr<BaseDecodingOutput
     auto sequenceLengthsPtr = bufferCast<SizeType32>(*outputs->sequenceLength.value());
     auto const* batchSlotsPtr = bufferCast<SizeType32>(*batchSlots);
 
-    invokeCopyNextStepIds(newTokensPtr, outputIdsPtrDevice, sequenceLengthsPtr, numNewTokens, batchSlotsPtr, batchSize,
-        maxBatchSize, beamWidth, maxSeqLen, maxTokensPerStep, stream);
+    if (copyNextStepIds)
+    {
+        invokeCopyNextStepIds(newTokensPtr, outputIdsPtrDevice, sequenceLengthsPtr, numNewTokens, batchSlotsPtr,
+            batchSize, maxBatchSize, beamWidth, maxSeqLen, maxTokensPerStep, stream);
+    }
 
     // Transpose output log probs from [maxSeqLen, batchSize, beamWidth] to [batchSize, beamWidth, maxSeqLen]
     if (outputLogProbs && outputs->outputLogProbsTiled)
@@ -307,6 +343,173 @@ void DynamicDecodeLayer<T>::prepareOutputData(std::shared_ptr<BaseDecodingOutput
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
 
+template <typename T>
+void DynamicDecodeLayer<T>::setupGreedyFastPath(SizeType32 batchSize, TensorConstPtr const& batchSlots,
+    std::shared_ptr<DynamicDecodeSetupParams> const& setupParams)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+
+    auto const samplingParams = std::dynamic_pointer_cast<SamplingSetupParams>(setupParams->decodingParams);
+    if (samplingParams && samplingParams->normalizeLogProbs.has_value())
+    {
+        mNormalizeLogProbs = samplingParams->normalizeLogProbs.value();
+    }
+
+    // The value of request bi of a parameter given for 1 or for all the requests of the setup.
+    auto const valueAt = [](auto const& optParam, size_t bi, auto defaultValue)
+    {
+        if (!optParam.has_value() || optParam->empty())
+        {
+            return defaultValue;
+        }
+        return static_cast<decltype(defaultValue)>(optParam->size() == 1 ? optParam->front() : optParam->at(bi));
+    };
+    auto const& penaltyParams = setupParams->penaltyParams;
+    auto const& banWordsParams = setupParams->banWordsParams;
+    auto const* batchSlotsPtr = bufferCast<SizeType32>(*batchSlots);
+    for (SizeType32 bi = 0; bi < batchSize; ++bi)
+    {
+        bool greedyOnly = samplingParams != nullptr && mDecodingMode.isTopKorTopP();
+        if (greedyOnly)
+        {
+            auto topK = valueAt(samplingParams->runtimeTopK, bi, DefaultDecodingParams::getTopK());
+            auto topP = valueAt(samplingParams->runtimeTopP, bi, DefaultDecodingParams::getTopP());
+            clampTopK(topK);
+            regularizeTopKTopP(topK, topP);
+            // The argmax survives any min-p filter, applied after the top-k one.
+            greedyOnly = topK == 1
+                && valueAt(samplingParams->runtimeTypicalP, bi, DefaultDecodingParams::getTypicalP())
+                    == DefaultDecodingParams::getTypicalP();
+        }
+        if (greedyOnly && penaltyParams)
+        {
+            greedyOnly = valueAt(penaltyParams->temperature, bi, DefaultDecodingParams::getTemperature())
+                    == DefaultDecodingParams::getTemperature()
+                && valueAt(penaltyParams->repetitionPenalty, bi, DefaultDecodingParams::getRepetitionPenalty())
+                    == DefaultDecodingParams::getRepetitionPenalty()
+                && valueAt(penaltyParams->presencePenalty, bi, DefaultDecodingParams::getPresencePenalty())
+                    == DefaultDecodingParams::getPresencePenalty()
+                && valueAt(penaltyParams->frequencyPenalty, bi, DefaultDecodingParams::getFrequencyPenalty())
+                    == DefaultDecodingParams::getFrequencyPenalty();
+        }
+        if (greedyOnly && banWordsParams)
+        {
+            greedyOnly = valueAt(banWordsParams->noRepeatNgramSize, bi, DefaultDecodingParams::getNoRepeatNgramSize())
+                == DefaultDecodingParams::getNoRepeatNgramSize();
+        }
+        mGreedyOnly[batchSlotsPtr[bi]] = greedyOnly;
+    }
+
+    // The min length is the only penalty the fast path applies, by masking EOS.
+    FillBuffers const fillBuffers{batchSize, mDecoderDomain.getBatchSize(), mBufferManager};
+    fillBuffers(penaltyParams ? penaltyParams->minLength : std::nullopt, DefaultDecodingParams::getMinLength(),
+        mGreedyMinLength, mGreedyMinLengthDevice, batchSlots, getLimitsPenalty(DecodingPenaltyType::MinLength),
+        "min length");
+
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
+template <typename T>
+bool DynamicDecodeLayer<T>::canUseGreedyFastPath(
+    std::shared_ptr<DecodingInputs> const& params, DecoderDomain const& localDecoderDomain) const
+{
+    if (getEnvDisableGreedyFastPath() || !mDecodingMode.isTopKorTopP() || localDecoderDomain.getBeamWidth() != 1
+        || mDecoderDomain.getMaxDecodingTokens() != 1 || params->embeddingBias.has_value()
+        || params->curTokensPerStep.has_value())
+    {
+        return false;
+    }
+    // Bad and stop words need the layers of the chain.
+    auto const& banWordsInputs = params->banWordsInputs;
+    if (banWordsInputs && banWordsInputs->maxBadWordsLen > 0 && banWordsInputs->badWordsPtr.has_value())
+    {
+        return false;
+    }
+    auto const& stopCriteriaInputs = params->stopCriteriaInputs;
+    if (stopCriteriaInputs && stopCriteriaInputs->maxStopWordsLen > 0 && stopCriteriaInputs->stopWordsPtr.has_value())
+    {
+        return false;
+    }
+    auto const* batchSlotsPtr = bufferCast<SizeType32>(*params->batchSlots);
+    for (SizeType32 bi = 0; bi < localDecoderDomain.getBatchSize(); ++bi)
+    {
+        if (!mGreedyOnly[batchSlotsPtr[bi]])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+void DynamicDecodeLayer<T>::forwardGreedy(std::shared_ptr<BaseDecodingOutputs> const& outputs,
+    std::shared_ptr<DecodingInputs> const& params, DecoderDomain const& localDecoderDomain,
+    std::shared_ptr<runtime::DecodingLayerWorkspace> const& workspace)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    NVTX3_SCOPED_RANGE(DynamicDecodeLayer_forwardGreedy);
+
+    auto const batchSize = localDecoderDomain.getBatchSize();
+    TensorPtr logitsPtrsHost = ITensor::at(mGreedyLogitsPtrsHost, {mCyclicStep});
+    auto* logitsPtrsHostData = bufferCast<T const*>(*logitsPtrsHost);
+    for (SizeType32 bi = 0; bi < batchSize; ++bi)
+    {
+        if (params->logitsVec)
+        {
+            TLLM_CHECK_WITH_INFO(params->logitsVec->size() == batchSize,
+                "Logits vector size (%lu) is not equal to the batchSize (%d)", params->logitsVec->size(), batchSize);
+            logitsPtrsHostData[bi] = bufferCastOrNull<T>(params->logitsVec.value()[bi]);
+        }
+        else
+        {
+            TensorConstPtr logitsForBatchIndex = ITensor::slice(params->logits.value(), ITensor::makeShape({bi}));
+            logitsPtrsHostData[bi] = bufferCastOrNull<T>(logitsForBatchIndex);
+        }
+    }
+
+    TensorPtr logitsPtrsHostSlice = ITensor::slice(logitsPtrsHost, 0, batchSize);
+    auto [logitsPtrsDevice, finishedSumDevice]
+        = workspace->mirrorInWorkspace(logitsPtrsHostSlice, outputs->finishedSum.value_or(nullptr));
+
+    GreedyDecodeParams<T> greedyParams;
+    greedyParams.logitsPtrs = reinterpret_cast<T const* const*>(bufferCast<T const*>(*logitsPtrsDevice));
+    greedyParams.batchSlots = workspace->getDeviceBatchSlotsPtr();
+    greedyParams.endIds = bufferCast<TokenIdType>(*params->endIds);
+    greedyParams.inputLengths = bufferCastOrNull<SizeType32>(params->inputLengths);
+    greedyParams.minLengths = bufferCast<SizeType32>(*mGreedyMinLengthDevice);
+    greedyParams.sequenceLimitLength = params->stopCriteriaInputs
+        ? bufferCastOrNull<SizeType32>(params->stopCriteriaInputs->sequenceLimitLength)
+        : nullptr;
+    greedyParams.finishedInput = params->finished
+        ? reinterpret_cast<FinishedState const*>(bufferCast<FinishedState::UnderlyingType>(*params->finished.value()))
+        : nullptr;
+    greedyParams.outputIdsPtrs = bufferCast<TokenIdType*>(*outputs->outputIdsPtr);
+    greedyParams.sequenceLengths = bufferCast<SizeType32>(*outputs->sequenceLength.value());
+    greedyParams.finishedOutput = outputs->finished
+        ? reinterpret_cast<FinishedState*>(bufferCast<FinishedState::UnderlyingType>(*outputs->finished.value()))
+        : nullptr;
+    greedyParams.finishedSum = finishedSumDevice == nullptr ? nullptr : bufferCast<SizeType32>(*finishedSumDevice);
+    greedyParams.newTokens = bufferCast<TokenIdType>(*outputs->newTokens);
+    greedyParams.cumLogProbs = bufferCastOrNull<float>(outputs->cumLogProbs);
+    greedyParams.outputLogProbs = bufferCastOrNull<float>(outputs->outputLogProbsTiled);
+    greedyParams.workspace = mGreedyWorkspaceDevice->data();
+    greedyParams.blockCounters = bufferCast<SizeType32>(*mGreedyBlockCountersDevice);
+    greedyParams.batchSize = batchSize;
+    greedyParams.maxBatchSize = mDecoderDomain.getBatchSize();
+    greedyParams.vocabSize = mDecoderDomain.getVocabSize();
+    greedyParams.vocabSizePadded = mDecoderDomain.getVocabSizePadded();
+    greedyParams.multiProcessorCount = mMultiProcessorCount;
+    greedyParams.normalizeLogProbs = mNormalizeLogProbs;
+    invokeGreedyDecode(greedyParams, getStream());
+
+    if (finishedSumDevice != nullptr)
+    {
+        mBufferManager->copy(*finishedSumDevice, *outputs->finishedSum.value());
+    }
+
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
 template class DynamicDecodeLayer<float>;
 template class DynamicDecodeLayer<half>;
 
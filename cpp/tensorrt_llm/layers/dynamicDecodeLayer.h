@@ -61,7 +61,19 @@ private:
         runtime::SizeType32 batchSize, runtime::SizeType32 beamWidth, runtime::SizeType32 maxSeqLen);
     void prepareOutputData(std::shared_ptr<BaseDecodingOutputs> const& outputs, BufferConstPtr batchSlots,
         runtime::SizeType32 batchSize, runtime::SizeType32 maxBatchSize, runtime::SizeType32 beamWidth,
-        runtime::SizeType32 maxSeqLen, runtime::SizeType32 maxTokensPerStep, bool outputLogProbs, cudaStream_t stream);
+        runtime::SizeType32 maxSeqLen, runtime::SizeType32 maxTokensPerStep, bool outputLogProbs, bool copyNextStepIds,
+        cudaStream_t stream);
+
+    //! \brief Record which batch slots only decode greedily, without penalties that change the argmax.
+    void setupGreedyFastPath(runtime::SizeType32 batchSize, TensorConstPtr const& batchSlots,
+        std::shared_ptr<DynamicDecodeSetupParams> const& setupParams);
+    [[nodiscard]] bool canUseGreedyFastPath(std::shared_ptr<DecodingInputs> const& params,
+        DecoderDomain const& localDecoderDomain) const;
+    //! \brief Select, append and stop check the tokens of a greedy-only step in one kernel, instead of the penalty,
+    //! sampling and stop criteria layers.
+    void forwardGreedy(std::shared_ptr<BaseDecodingOutputs> const& outputs,
+        std::shared_ptr<DecodingInputs> const& params, DecoderDomain const& localDecoderDomain,
+        std::shared_ptr<runtime::DecodingLayerWorkspace> const& workspace);
 
 private:
     using Base::mDecoderDomain;
@@ -76,6 +88,16 @@ private:
     TensorPtr mOutputIdsPtrDevice;
     TensorPtr mParentIdsPtrDevice;
 
+    //! Greedy fast path, see forwardGreedy.
+    std::vector<bool> mGreedyOnly;
+    TensorPtr mGreedyMinLength;
+    TensorPtr mGreedyMinLengthDevice;
+    TensorPtr mGreedyLogitsPtrsHost;
+    TensorPtr mGreedyWorkspaceDevice;
+    TensorPtr mGreedyBlockCountersDevice;
+    bool mNormalizeLogProbs{false};
+    runtime::SizeType32 mMultiProcessorCount{1};
+
     bool mHasDiffRuntimeArgs{false};
 
     bool mOutputLogProbs{false};
@@ -403,7 +403,8 @@ void ExternalDraftTokensLayer<T>::acceptDraftTokens(std::shared_ptr<BaseDecoding
         bufferCast<SizeType32>(*inputs->numDraftTokens), bufferCast<bool>(*inputs->useDraftLogits),
         bufferCast<TokenIdType>(*inputs->draftTokenIds), finishedInput, finishedOutput, inputs->curandStates,
         workspace->getDeviceBatchSlotsPtr(), maxTokensPerStep, beamWidth, mDecoderDomain.getVocabSizePadded(),
-        inputs->useRandomAcceptanceThreshold, inputs->constantThreshold, inputs->step,
+        inputs->useRandomAcceptanceThreshold, inputs->constantThreshold, inputs->typicalAcceptanceEpsilon,
+        inputs->typicalAcceptanceDelta, inputs->step,
         bufferCast<bool>(*mBatchIsAccepted), bufferCast<SizeType32>(*mTargetOutputIds), getStream());
 
     sync_check_cuda_error();
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/layers/lookaheadDevicePool.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/iBuffer.h"
+
+namespace tensorrt_llm::layers
+{
+
+using namespace tensorrt_llm::runtime;
+using namespace tensorrt_llm::kernels::speculative_decoding;
+
+LookaheadDevicePool::LookaheadDevicePool(SizeType32 maxBatchSize, SizeType32 maxN, SizeType32 maxG,
+    SizeType32 numBuckets, std::shared_ptr<BufferManager> bufferManager)
+    : mBufferManager(std::move(bufferManager))
+    , mMaxBatchSize(maxBatchSize)
+    , mMaxN(maxN)
+    , mMaxG(maxG)
+    , mNumBuckets(numBuckets)
+{
+    TLLM_CHECK(maxBatchSize > 0 && maxN > 1 && maxG > 0);
+    TLLM_CHECK_WITH_INFO(numBuckets > 0 && (numBuckets & (numBuckets - 1)) == 0, "numBuckets must be a power of 2");
+
+    auto const maxBatchShape1D = ITensor::makeShape({maxBatchSize});
+    mKeys = mBufferManager->gpu(ITensor::makeShape({maxBatchSize, numBuckets}), nvinfer1::DataType::kINT32);
+    mNgrams = mBufferManager->gpu(
+        ITensor::makeShape({maxBatchSize, numBuckets, maxG, maxN - 1}), nvinfer1::DataType::kINT32);
+    mNgramCounts = mBufferManager->gpu(ITensor::makeShape({maxBatchSize, numBuckets}), nvinfer1::DataType::kINT32);
+    mGuessSetSizesHost = BufferManager::pinned(maxBatchShape1D, nvinfer1::DataType::kINT32);
+    mNgramLensHost = BufferManager::pinned(maxBatchShape1D, nvinfer1::DataType::kINT32);
+    mGuessSetSizes = mBufferManager->gpu(maxBatchShape1D, nvinfer1::DataType::kINT32);
+    mNgramLens = mBufferManager->gpu(maxBatchShape1D, nvinfer1::DataType::kINT32);
+    mSetupBatchSlots = mBufferManager->gpu(maxBatchShape1D, nvinfer1::DataType::kINT32);
+    mBufferManager->setZero(*mGuessSetSizesHost);
+    mBufferManager->setZero(*mNgramLensHost);
+    mBufferManager->setZero(*mGuessSetSizes);
+    mBufferManager->setZero(*mNgramLens);
+}
+
+LookaheadPool LookaheadDevicePool::getPool() const
+{
+    LookaheadPool pool;
+    pool.keys = bufferCast<TokenIdType>(*mKeys);
+    pool.ngrams = bufferCast<TokenIdType>(*mNgrams);
+    pool.ngramCounts = bufferCast<SizeType32>(*mNgramCounts);
+    pool.guessSetSizes = bufferCast<SizeType32>(*mGuessSetSizes);
+    pool.ngramLens = bufferCast<SizeType32>(*mNgramLens);
+    pool.numBuckets = mNumBuckets;
+    pool.maxGuessSetSize = mMaxG;
+    pool.maxNgramLen = mMaxN - 1;
+    return pool;
+}
+
+void LookaheadDevicePool::setup(
+    TensorConstPtr const& batchSlots, TensorConstPtr const& guessSetSizes, TensorConstPtr const& ngramLevels)
+{
+    auto const batchSize = static_cast<SizeType32>(batchSlots->getSize());
+    TLLM_CHECK(static_cast<SizeType32>(guessSetSizes->getSize()) == batchSize);
+    TLLM_CHECK(static_cast<SizeType32>(ngramLevels->getSize()) == batchSize);
+    BufferRange<SizeType32 const> slotRange(*batchSlots);
+    BufferRange<SizeType32 const> guessSetSizeRange(*guessSetSizes);
+    BufferRange<SizeType32 const> levelRange(*ngramLevels);
+    BufferRange<SizeType32> guessSetSizesHost(*mGuessSetSizesHost);
+    BufferRange<SizeType32> ngramLensHost(*mNgramLensHost);
+    for (SizeType32 bi = 0; bi < batchSize; ++bi)
+    {
+        auto const slot = slotRange[bi];
+        TLLM_CHECK(slot >= 0 && slot < mMaxBatchSize);
+        TLLM_CHECK(guessSetSizeRange[bi] >= 0 && guessSetSizeRange[bi] <= mMaxG);
+        TLLM_CHECK(levelRange[bi] > 1 && levelRange[bi] <= mMaxN);
+        guessSetSizesHost[slot] = guessSetSizeRange[bi];
+        ngramLensHost[slot] = levelRange[bi] - 1;
+    }
+    mBufferManager->copy(*mGuessSetSizesHost, *mGuessSetSizes);
+    mBufferManager->copy(*mNgramLensHost, *mNgramLens);
+    auto setupBatchSlots = ITensor::slice(mSetupBatchSlots, 0, batchSize);
+    mBufferManager->copy(*batchSlots, *setupBatchSlots);
+
+    invokeResetLookaheadPool(getPool(), bufferCast<SizeType32>(*setupBatchSlots), batchSize,
+        mBufferManager->getStream().get());
+}
+
+void LookaheadDevicePool::accept(
+    TensorConstPtr const& tokens, TensorConstPtr const& numInserts, TensorConstPtr const& batchSlots)
+{
+    auto const batchSize = static_cast<SizeType32>(batchSlots->getSize());
+    TLLM_CHECK(tokens->getShape().d[0] == batchSize);
+    auto const maxLength = static_cast<SizeType32>(tokens->getShape().d[1]);
+    auto const* tokensPtr = bufferCast<TokenIdType>(*tokens);
+
+    invokeInsertLookaheadPool(getPool(), tokensPtr, maxLength, 1, tokensPtr + 1, maxLength, 1,
+        bufferCast<SizeType32>(*numInserts), bufferCast<SizeType32>(*batchSlots), batchSize,
+        mBufferManager->getStream().get());
+}
+
+void LookaheadDevicePool::update(TensorConstPtr const& keyTokens, TensorConstPtr const& ngramTokens,
+    TensorConstPtr const& windowSizes, TensorConstPtr const& batchSlots)
+{
+    auto const batchSize = static_cast<SizeType32>(batchSlots->getSize());
+    TLLM_CHECK(keyTokens->getShape().d[0] == batchSize && ngramTokens->getShape().d[0] == batchSize);
+    auto const maxW = static_cast<SizeType32>(keyTokens->getShape().d[1]);
+    TLLM_CHECK(ngramTokens->getShape().d[1] == maxW && ngramTokens->getShape().d[2] == mMaxN - 1);
+
+    invokeInsertLookaheadPool(getPool(), bufferCast<TokenIdType>(*keyTokens), maxW, 1,
+        bufferCast<TokenIdType>(*ngramTokens), maxW * (mMaxN - 1), mMaxN - 1, bufferCast<SizeType32>(*windowSizes),
+        bufferCast<SizeType32>(*batchSlots), batchSize, mBufferManager->getStream().get());
+}
+
+void LookaheadDevicePool::guess(TensorPtr const& guessTokens, TensorPtr const& numGuesses,
+    TensorConstPtr const& lastTokens, TensorConstPtr const& guessSizes, TensorConstPtr const& batchSlots) const
+{
+    auto const batchSize = static_cast<SizeType32>(batchSlots->getSize());
+    TLLM_CHECK(guessTokens->getShape().d[0] == batchSize && guessTokens->getShape().d[1] == mMaxG
+        && guessTokens->getShape().d[2] == mMaxN - 1);
+
+    invokeGuessLookaheadPool(getPool(), bufferCast<TokenIdType>(*guessTokens), bufferCast<SizeType32>(*numGuesses),
+        bufferCast<TokenIdType>(*lastTokens), bufferCast<SizeType32>(*guessSizes), bufferCast<SizeType32>(*batchSlots),
+        batchSize, mBufferManager->getStream().get());
+}
+
+} // namespace tensorrt_llm::layers
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/kernels/speculativeDecoding/lookaheadPoolKernels.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <memory>
+
+namespace tensorrt_llm::layers
+{
+
+//! @brief The key-ngram pools of all lookahead requests of a batch in device memory.
+//! Batched replacement of one LookaheadPoolManager per request: the pools are filled and searched by one kernel for
+//! the whole batch, so the host does not walk a std::unordered_map per request and step.
+class LookaheadDevicePool
+{
+public:
+    using TensorPtr = runtime::ITensor::SharedPtr;
+    using TensorConstPtr = runtime::ITensor::SharedConstPtr;
+
+    //! @param maxN, maxG the maximum n-gram level and guess set size.
+    //! @param numBuckets the number of keys of a pool, a power of 2.
+    LookaheadDevicePool(runtime::SizeType32 maxBatchSize, runtime::SizeType32 maxN, runtime::SizeType32 maxG,
+        runtime::SizeType32 numBuckets, std::shared_ptr<runtime::BufferManager> bufferManager);
+
+    //! @brief setup the pools of new requests and empty them.
+    //! @param batchSlots the slots of the requests, [batchSize] on cpu
+    //! @param guessSetSizes the runtime guess set sizes, [batchSize] on cpu
+    //! @param ngramLevels the runtime n-gram levels, [batchSize] on cpu
+    void setup(
+        TensorConstPtr const& batchSlots, TensorConstPtr const& guessSetSizes, TensorConstPtr const& ngramLevels);
+
+    //! @brief fill the pools with all n-grams of token sequences, as LookaheadPoolManager::accept.
+    //! @param tokens the prompts or accepted tokens, [batchSize, maxLength] on gpu
+    //! @param numInserts the number of n-grams of every sequence, length - level + 1, [batchSize] on gpu
+    //! @param batchSlots the slots of the requests, [batchSize] on gpu
+    void accept(TensorConstPtr const& tokens, TensorConstPtr const& numInserts, TensorConstPtr const& batchSlots);
+
+    //! @brief update the pools with the shifted lookahead windows, as LookaheadPoolManager::update.
+    //! @param keyTokens the shifted out tokens of every window, [batchSize, maxW] on gpu
+    //! @param ngramTokens the shifted windows, [batchSize, maxW, maxN - 1] on gpu
+    //! @param windowSizes the runtime window sizes, [batchSize] on gpu
+    //! @param batchSlots the slots of the requests, [batchSize] on gpu
+    void update(TensorConstPtr const& keyTokens, TensorConstPtr const& ngramTokens, TensorConstPtr const& windowSizes,
+        TensorConstPtr const& batchSlots);
+
+    //! @brief get the newest n-grams of the last golden token of every request, as LookaheadPoolManager::guess.
+    //! @param guessTokens the guesses, oldest first, [batchSize, maxG, maxN - 1] on gpu
+    //! @param numGuesses the number of guesses, [batchSize] on gpu
+    //! @param lastTokens the newest golden tokens, [batchSize] on gpu
+    //! @param guessSizes at most guessSize guesses are returned, [batchSize] on gpu
+    //! @param batchSlots the slots of the requests, [batchSize] on gpu
+    void guess(TensorPtr const& guessTokens, TensorPtr const& numGuesses, TensorConstPtr const& lastTokens,
+        TensorConstPtr const& guessSizes, TensorConstPtr const& batchSlots) const;
+
+private:
+    [[nodiscard]] kernels::speculative_decoding::LookaheadPool getPool() const;
+
+    std::shared_ptr<runtime::BufferManager> mBufferManager;
+    //! @brief [maxBatchSize, numBuckets] keys, [maxBatchSize, numBuckets, maxG, maxN - 1] n-grams and
+    //! [maxBatchSize, numBuckets] n-gram counts of the hash tables.
+    TensorPtr mKeys;
+    TensorPtr mNgrams;
+    TensorPtr mNgramCounts;
+    //! @brief per slot guess set size and n-gram length on cpu, and their copies on gpu.
+    TensorPtr mGuessSetSizesHost;
+    TensorPtr mNgramLensHost;
+    TensorPtr mGuessSetSizes;
+    TensorPtr mNgramLens;
+    TensorPtr mSetupBatchSlots;
+
+    runtime::SizeType32 const mMaxBatchSize;
+    runtime::SizeType32 const mMaxN;
+    runtime::SizeType32 const mMaxG;
+    runtime::SizeType32 const mNumBuckets;
+};
+
+} // namespace tensorrt_llm::layers
@@ -33,6 +33,27 @@ using namespace tensorrt_llm::runtime;
 namespace tensorrt_llm::layers
 {
 
+namespace
+{
+//! \brief Whether the request at index bi of a setup batch needs the probabilities of its logits: log probs, min-p or
+//! typical-p.
+bool samplingNeedsProbs(SamplingSetupParams const& params, SizeType32 bi)
+{
+    auto const valueAt = [bi](auto const& values, auto defaultValue)
+    {
+        if (!values.has_value() || values->empty())
+        {
+            return defaultValue;
+        }
+        return values->size() == 1 ? values->front() : values->at(bi);
+    };
+    auto const minP = DefaultDecodingParams::getMinP();
+    auto const typicalP = DefaultDecodingParams::getTypicalP();
+    return valueAt(params.outputLogProbs, false) || valueAt(params.cumLogProbs, false)
+        || valueAt(params.runtimeMinP, minP) != minP || valueAt(params.runtimeTypicalP, typicalP) != typicalP;
+}
+} // namespace
+
 template <typename T>
 size_t PenaltyLayer<T>::getWorkspaceSize() const noexcept
 {
@@ -47,6 +68,14 @@ PenaltyLayer<T>::PenaltyLayer(executor::DecodingMode const& mode, DecoderDomain
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
 
+    mCanFuseIntoSampling = mDecodingMode.isUseFusedSampling() && mDecodingMode.isTopK() && !mDecodingMode.isTopP()
+        && !mDecodingMode.isUseBanTokens() && mDecoderDomain.getBeamWidth() == 1
+        && mDecoderDomain.getMaxDecodingTokens() == 1;
+    if (mDecodingMode.isUseFusedSampling() && !mCanFuseIntoSampling)
+    {
+        TLLM_LOG_WARNING("Fused sampling requires TopK mode without banned tokens and a single token per step");
+    }
+
     initialize();
 
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
@@ -62,6 +91,7 @@ void PenaltyLayer<T>::initialize()
     mCyclicStep = 0;
     mRuntimeMaxSeqLen = 0;
     mConfiguredBeamWidth = -1;
+    mOccurrenceTableSize = 0;
 
     if (!mDecodingMode.isAuto())
     {
@@ -94,6 +124,36 @@ void PenaltyLayer<T>::allocateWorkspace()
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
 
+template <typename T>
+void PenaltyLayer<T>::allocateOccurrenceTables(SizeType32 maxSeqLen)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+
+    // A sequence has at most maxSeqLen distinct tokens, keep the tables at most half full.
+    SizeType32 tableSize{1};
+    while (tableSize < 2 * maxSeqLen)
+    {
+        tableSize *= 2;
+    }
+    // The fused top-k kernel reads the dense occurrence counts.
+    if (!mPenaltyWorkspaceDevice || mCanFuseIntoSampling || 2 * tableSize >= mDecoderDomain.getVocabSize())
+    {
+        return;
+    }
+
+    mOccurrenceTableSize = tableSize;
+    auto const workspaceSize = mDecoderDomain.getBatchSize() * mDecoderDomain.getMaxDecodingTokens()
+        * mConfiguredBeamWidth * 2 * mOccurrenceTableSize;
+    // The tables of a request are initialized by the penalty kernel in its context phase.
+    mPenaltyWorkspaceDevice = mBufferManager->gpu(workspaceSize, nvinfer1::DataType::kINT32);
+    if (mPenaltyWorkspacePrevDevice)
+    {
+        mPenaltyWorkspacePrevDevice = mBufferManager->gpu(workspaceSize, nvinfer1::DataType::kINT32);
+    }
+
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
 template <typename T>
 void PenaltyLayer<T>::allocateBuffer()
 {
@@ -106,6 +166,7 @@ void PenaltyLayer<T>::allocateBuffer()
     mPresencePenalty = mBufferManager->pinnedPool(batchSizeShape, TRTDataType<float>::value);
     mFrequencyPenalty = mBufferManager->pinnedPool(batchSizeShape, TRTDataType<float>::value);
     mMinLength = mBufferManager->pinnedPool(batchSizeShape, TRTDataType<SizeType32>::value);
+    mSamplingNeedsProbs.assign(mDecoderDomain.getBatchSize(), false);
 
     if (mDecodingMode.isUseTemperature())
     {
@@ -175,6 +236,15 @@ void PenaltyLayer<T>::setup(SizeType32 batchSize, SizeType32 beamWidth, TensorCo
     mUseFrequencyPenalty |= useFrequencyPenalty;
     mUseMinLength |= useMinLength;
 
+    // Unlike the penalties above, tracked per slot: a request that needs probabilities only disables the fused
+    // penalties while it is in the batch.
+    auto const samplingParams = std::dynamic_pointer_cast<SamplingSetupParams>(setupParams->decodingParams);
+    auto const* batchSlotsHost = bufferCast<SizeType32>(*batchSlots);
+    for (SizeType32 bi = 0; bi < batchSize; ++bi)
+    {
+        mSamplingNeedsProbs.at(batchSlotsHost[bi]) = samplingParams && samplingNeedsProbs(*samplingParams, bi);
+    }
+
     if (mUseTemperature)
     {
         fillBuffers(penaltyParams->temperature, DefaultDecodingParams::getTemperature(), mTemperature,
@@ -202,10 +272,10 @@ void PenaltyLayer<T>::setup(SizeType32 batchSize, SizeType32 beamWidth, TensorCo
             batchSlots, getLimitsPenalty(DecodingPenaltyType::MinLength), "min length");
     }
 
-    // Reset penalty workspace
+    // Reset penalty workspace. Occurrence tables are reset by the penalty kernel.
     auto const workspaceSizePerBatch
         = mDecoderDomain.getMaxDecodingTokens() * mConfiguredBeamWidth * mDecoderDomain.getVocabSize();
-    for (size_t bi = 0; bi < batchSize; ++bi)
+    for (size_t bi = 0; bi < batchSize && mOccurrenceTableSize == 0; ++bi)
     {
         auto batchSlot = runtime::bufferCast<runtime::SizeType32>(*batchSlots)[bi];
 
@@ -246,6 +316,7 @@ void PenaltyLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> const& b
         mLogitsPtrsHost->reshape(
             ITensor::makeShape({static_cast<int32_t>(maxSeqLen), static_cast<int32_t>(mDecoderDomain.getBatchSize())}));
         mRuntimeMaxSeqLen = maxSeqLen;
+        allocateOccurrenceTables(maxSeqLen);
     }
 
     mCyclicStep = mCyclicStep % mRuntimeMaxSeqLen;
@@ -322,6 +393,11 @@ void PenaltyLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> const& b
         ? reinterpret_cast<FinishedState const*>(bufferCast<FinishedState::UnderlyingType>(*params->finished.value()))
         : nullptr;
     penaltyParams.stream = getStream();
+    bool const batchNeedsProbs = std::any_of(batchSlotsHostPtr, batchSlotsHostPtr + localDecoderDomain.getBatchSize(),
+        [this](SizeType32 batchSlot) { return mSamplingNeedsProbs[batchSlot]; });
+    bool const deferPenalties = mCanFuseIntoSampling && !batchNeedsProbs && !params->logitsVec;
+    penaltyParams.countOccurrencesOnly = deferPenalties;
+    penaltyParams.occurrenceTableSize = mOccurrenceTableSize;
 
     if (penaltyParams.beamWidth > 1)
     {
@@ -347,9 +423,19 @@ void PenaltyLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> const& b
 
     mCyclicStep += 1;
 
-    auto const logitsShape = ITensor::makeShape({localDecoderDomain.getBatchSize(),
-        mDecoderDomain.getMaxDecodingTokens(), localDecoderDomain.getBeamWidth(), mDecoderDomain.getVocabSizePadded()});
-    params->logits = ITensor::view(runtimeLogits, logitsShape);
+    if (deferPenalties)
+    {
+        // The sampling kernel reads params->logits, which stay untouched.
+        params->deferredPenaltyParams = std::make_shared<InvokeBatchApplyPenaltyParams<T>>(penaltyParams);
+    }
+    else
+    {
+        auto const logitsShape = ITensor::makeShape({localDecoderDomain.getBatchSize(),
+            mDecoderDomain.getMaxDecodingTokens(), localDecoderDomain.getBeamWidth(),
+            mDecoderDomain.getVocabSizePadded()});
+        params->logits = ITensor::view(runtimeLogits, logitsShape);
+        params->deferredPenaltyParams.reset();
+    }
 
     if (mDecodingMode.isBeamSearch())
     {
@@ -32,6 +32,8 @@ namespace tensorrt_llm::layers
 //! 3. Presence penalty
 //! 4. Frequency penalty
 //! 5. Min length penalty
+//! With DecodingMode::useFusedSampling, only counts the occurrences of tokens and leaves the penalties to the top-k
+//! sampling kernel.
 template <typename T>
 class PenaltyLayer : public BaseLayer
 {
@@ -54,6 +56,7 @@ public:
 private:
     void initialize();
     void allocateWorkspace();
+    void allocateOccurrenceTables(runtime::SizeType32 maxSeqLen);
     void allocateBuffer();
 
 private:
@@ -80,9 +83,16 @@ private:
     bool mUseFrequencyPenalty{false};
     bool mUseMinLength{false};
 
+    // Penalties are applied by the top-k sampling kernel, see DecodingMode::useFusedSampling.
+    bool mCanFuseIntoSampling{false};
+    // Per batch slot, whether the request needs probabilities, which the fused kernel does not compute.
+    std::vector<bool> mSamplingNeedsProbs;
+
     runtime::SizeType32 mCyclicStep{0};
     runtime::SizeType32 mRuntimeMaxSeqLen{0};
     runtime::SizeType32 mConfiguredBeamWidth{-1};
+    // Slots of the per beam occurrence tables, 0 while the workspace counts every vocab entry.
+    runtime::SizeType32 mOccurrenceTableSize{0};
 
     BufferPtr mPenaltyWorkspaceDevice;
     BufferPtr mPenaltyWorkspacePrevDevice;
@@ -18,6 +18,7 @@
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/common/nvtxUtils.h"
 #include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/kernels/samplingTypicalPKernels.h"
 #include "tensorrt_llm/layers/defaultDecodingParams.h"
 #include "tensorrt_llm/layers/layerUtils.h"
 #include "tensorrt_llm/layers/topKSamplingLayer.h"
@@ -80,9 +81,12 @@ void SamplingLayer<T>::allocateBuffer(SizeType32 batchSize)
 
     // host buffers.
     mSkipDecodeHost = mBufferManager->pinnedPool(batchSizeShape, TRTDataType<bool>::value);
+    mNeedsLogProbs.assign(batchSize, false);
 
     mRuntimeMinPHost = mBufferManager->pinnedPool(batchSizeShape, TRTDataType<float>::value);
     mRuntimeMinPDevice = mBufferManager->gpu(batchSizeShape, TRTDataType<float>::value);
+    mRuntimeTypicalPHost = mBufferManager->pinnedPool(batchSizeShape, TRTDataType<float>::value);
+    mRuntimeTypicalPDevice = mBufferManager->gpu(batchSizeShape, TRTDataType<float>::value);
     TLLM_CHECK(mSkipDecodeHost != nullptr);
 
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
@@ -100,18 +104,14 @@ void SamplingLayer<T>::setup(SizeType32 batchSize, SizeType32 beamWidth, TensorC
     workspace->initializeDeviceCurandStates(
         setupParams->randomSeed, batchSize, workspace->getDeviceBatchSlots(), mCurandStatesDevice);
 
-    if (setupParams->outputLogProbs)
+    // Per slot, as in PenaltyLayer, which only defers the penalties of a batch without log probs.
+    auto const* batchSlotsHost = bufferCast<SizeType32>(*batchSlots);
+    auto const valueAt = [](auto const& values, SizeType32 bi)
+    { return values.has_value() && !values->empty() && (values->size() == 1 ? values->front() : values->at(bi)); };
+    for (SizeType32 bi = 0; bi < batchSize; ++bi)
     {
-        // FIXME(nkorobov): monotonically growing
-        mOutputLogProbs = std::any_of(setupParams->outputLogProbs->begin(), setupParams->outputLogProbs->end(),
-            [this](bool outputLogProbs) { return this->mOutputLogProbs | outputLogProbs; });
-    }
-
-    if (setupParams->cumLogProbs)
-    {
-        // FIXME(nkorobov): monotonically growing
-        mCumLogProbs = std::any_of(setupParams->cumLogProbs->begin(), setupParams->cumLogProbs->end(),
-            [this](bool cumLogProbs) { return this->mCumLogProbs | cumLogProbs; });
+        mNeedsLogProbs.at(batchSlotsHost[bi])
+            = valueAt(setupParams->outputLogProbs, bi) || valueAt(setupParams->cumLogProbs, bi);
     }
 
     for (auto&& layer : mSamplingLayers)
@@ -127,6 +127,12 @@ void SamplingLayer<T>::setup(SizeType32 batchSize, SizeType32 beamWidth, TensorC
         fillBuffers(setupParams->runtimeMinP, DefaultDecodingParams::getMinP(), mRuntimeMinPHost, mRuntimeMinPDevice,
             batchSlots, std::pair<float, float>(-1e-6f, 1.0f), "min_p");
     }
+    mUseTypicalP |= setupParams->runtimeTypicalP.has_value();
+    if (mUseTypicalP)
+    {
+        fillBuffers(setupParams->runtimeTypicalP, DefaultDecodingParams::getTypicalP(), mRuntimeTypicalPHost,
+            mRuntimeTypicalPDevice, batchSlots, std::pair<float, float>(1e-6f, 1.0f), "typical_p");
+    }
 
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
@@ -159,8 +165,18 @@ void SamplingLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> const&
         ? mRuntimeMinPDevice
         : nullptr;
 
-    // Compute probabilities either for TopP or if cumLogProbs or outputLogProbs are specified
-    bool const skipSoftMax = skipTopP && !mOutputLogProbs && !mCumLogProbs && minPs == nullptr;
+    auto typicalPs = mUseTypicalP
+            && !allOfBatchSlots(batchSlotsHostPtr, bufferCast<float>(*mRuntimeTypicalPHost),
+                localDecoderDomain.getBatchSize(), DefaultDecodingParams::getTypicalP())
+        ? mRuntimeTypicalPDevice
+        : nullptr;
+
+    // Compute probabilities either for TopP, min-p and typical-p or if cumLogProbs or outputLogProbs are specified
+    bool const needsLogProbs = std::any_of(batchSlotsHostPtr, batchSlotsHostPtr + localDecoderDomain.getBatchSize(),
+        [this](SizeType32 batchSlot) { return mNeedsLogProbs[batchSlot]; });
+    bool const skipSoftMax = skipTopP && !needsLogProbs && minPs == nullptr && typicalPs == nullptr;
+    // The penalty layer only defers the penalties if the softmax is skipped, as it would read unpenalized logits.
+    TLLM_CHECK(!inputs->deferredPenaltyParams || skipSoftMax);
 
     inputs->curandStates = reinterpret_cast<curandState_t*>(bufferCast<int8_t>(*mCurandStatesDevice));
     inputs->probsComputed = !skipSoftMax;
@@ -190,6 +206,12 @@ void SamplingLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> const&
         biasSoftmaxParams.checkParams();
         invokeAddBiasSoftMax(biasSoftmaxParams, getStream());
         sync_check_cuda_error();
+
+        if (typicalPs != nullptr)
+        {
+            invokeTypicalPFilter(runtimeLogitsPtr, bufferCast<float>(*typicalPs), finishedInput, batchSlotsPtr,
+                batchSize, mDecoderDomain.getVocabSize(), mDecoderDomain.getVocabSizePadded(), getStream());
+        }
     }
 
     for (auto&& layer : mSamplingLayers)
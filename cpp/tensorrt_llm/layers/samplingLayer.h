@@ -63,13 +63,17 @@ private:
     TensorPtr mSkipDecodeHost;
     bool mSkipAny{false};
 
-    bool mOutputLogProbs{false};
-    bool mCumLogProbs{false};
+    // Per batch slot, whether the request returns log probs or cum log probs.
+    std::vector<bool> mNeedsLogProbs;
 
     TensorPtr mRuntimeMinPHost;
     TensorPtr mRuntimeMinPDevice;
     bool mUseMinP{false};
 
+    TensorPtr mRuntimeTypicalPHost;
+    TensorPtr mRuntimeTypicalPDevice;
+    bool mUseTypicalP{false};
+
     std::vector<std::unique_ptr<BaseLayer>> mSamplingLayers;
 
 private:
@@ -18,6 +18,7 @@
 #include "stopCriteriaLayer.h"
 #include "tensorrt_llm/common/nvtxUtils.h"
 #include "tensorrt_llm/kernels/stopCriteriaKernels.h"
+#include "tensorrt_llm/kernels/wordsAutomatonKernels.h"
 #include "tensorrt_llm/layers/layerUtils.h"
 
 using namespace tensorrt_llm::common;
@@ -59,6 +60,16 @@ void StopCriteriaLayer<T>::setup(SizeType32 batchSize, SizeType32 beamWidth, Ten
     std::shared_ptr<runtime::DecodingLayerWorkspace> const& workspace)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    if (mStopWordsAutomataDevice)
+    {
+        // New requests compile their stop words again.
+        auto const* batchSlotsPtr = bufferCast<SizeType32>(*batchSlots);
+        for (SizeType32 bi = 0; bi < batchSize; ++bi)
+        {
+            auto automatonSlice = ITensor::slice(mStopWordsAutomataDevice, batchSlotsPtr[bi], 1);
+            mBufferManager->setZero(*automatonSlice);
+        }
+    }
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
 
@@ -116,9 +127,32 @@ void StopCriteriaLayer<T>::checkStopWordsStopCriteria(std::shared_ptr<BaseDecodi
     auto* finishedPtr = finishedDevice == nullptr
         ? nullptr
         : reinterpret_cast<FinishedState*>(bufferCast<FinishedState::UnderlyingType>(*finishedDevice));
-    invokeStopWordsCriterion(outputIdsPtr, parentIdsPtr, stopWordsPtrPtr, finishedPtr, sequenceLengthPtr,
-        workspace->getDeviceBatchSlotsPtr(), stopWordsLengthsPtr, numNewTokens, maxStopWordsLength,
-        decoderDomain.getBatchSize(), decoderDomain.getBeamWidth(), maxSeqLen, bufferManager.getStream().get());
+    if (decoderDomain.getBeamWidth() == 1)
+    {
+        // Beam search reorders the histories, it keeps matching every word.
+        auto const automatonSize = getWordsAutomatonSize(maxStopWordsLength);
+        if (automatonSize > mStopWordsAutomatonSize)
+        {
+            // Grow by powers of 2 to rarely recompile. Zeroed automata are compiled again below.
+            mStopWordsAutomatonSize = std::max(automatonSize, 2 * mStopWordsAutomatonSize);
+            mStopWordsAutomataDevice = bufferManager.gpu(
+                ITensor::makeShape({mDecoderDomain.getBatchSize(), mStopWordsAutomatonSize}),
+                TRTDataType<SizeType32>::value);
+            bufferManager.setZero(*mStopWordsAutomataDevice);
+        }
+        auto* automataPtr = bufferCast<SizeType32>(*mStopWordsAutomataDevice);
+        invokeBuildWordsAutomata(stopWordsPtrPtr, stopWordsLengthsPtr, workspace->getDeviceBatchSlotsPtr(),
+            decoderDomain.getBatchSize(), mStopWordsAutomatonSize, automataPtr, bufferManager.getStream().get());
+        invokeStopWordsCriterionAutomaton(outputIdsPtr, automataPtr, mStopWordsAutomatonSize, finishedPtr,
+            sequenceLengthPtr, workspace->getDeviceBatchSlotsPtr(), numNewTokens, decoderDomain.getBatchSize(),
+            bufferManager.getStream().get());
+    }
+    else
+    {
+        invokeStopWordsCriterion(outputIdsPtr, parentIdsPtr, stopWordsPtrPtr, finishedPtr, sequenceLengthPtr,
+            workspace->getDeviceBatchSlotsPtr(), stopWordsLengthsPtr, numNewTokens, maxStopWordsLength,
+            decoderDomain.getBatchSize(), decoderDomain.getBeamWidth(), maxSeqLen, bufferManager.getStream().get());
+    }
     if (finishedPtr != nullptr)
     {
         bufferManager.copy(*finishedDevice, *outputs->finished.value());
@@ -51,7 +51,7 @@ private:
     static void checkMaxLengthStopCriteria(std::shared_ptr<BaseDecodingOutputs>& outputs,
         std::shared_ptr<DecodingInputs> const& inputs, DecoderDomain const& decoderDomain,
         runtime::BufferManager const& bufferManager, std::shared_ptr<runtime::DecodingLayerWorkspace> const& workspace);
-    static void checkStopWordsStopCriteria(std::shared_ptr<BaseDecodingOutputs>& outputs,
+    void checkStopWordsStopCriteria(std::shared_ptr<BaseDecodingOutputs>& outputs,
         std::shared_ptr<DecodingInputs> const& inputs, DecoderDomain const& decoderDomain,
         runtime::SizeType32 maxSeqLen, runtime::BufferManager const& bufferManager,
         std::shared_ptr<runtime::DecodingLayerWorkspace> const& workspace);
@@ -64,6 +64,9 @@ private:
 
     executor::DecodingMode mDecodingMode;
     size_t mWorkspaceSize{0};
+    // Stop words compiled per batch slot for beam width 1, see invokeBuildWordsAutomata.
+    TensorPtr mStopWordsAutomataDevice;
+    runtime::SizeType32 mStopWordsAutomatonSize{0};
 };
 
 } // namespace tensorrt_llm::layers
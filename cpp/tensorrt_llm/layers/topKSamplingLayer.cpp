@@ -181,6 +181,7 @@ void TopKSamplingLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> con
     params.vocabSizePadded = mDecoderDomain.getVocabSizePadded();
     params.normalizeLogProbs = mNormalizeLogProbs;
     params.logitsHasProbs = probsComputed;
+    params.penaltyParams = static_cast<InvokeBatchApplyPenaltyParams<T> const*>(inputs->deferredPenaltyParams.get());
 
     invokeBatchTopKSampling(params, getStream());
 
@@ -16,6 +16,7 @@
  */
 
 #include "topPSamplingLayer.h"
+#include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/memoryUtils.h"
 #include "tensorrt_llm/common/nvtxUtils.h"
@@ -41,6 +42,7 @@ TopPSamplingLayer<T>::TopPSamplingLayer(DecoderDomain const& decoderDomain,
     : BaseLayer(decoderDomain, bufferManager)
     , mIsDeterministic(isDeterministic)
     , mIsAirTopP(isAirTopP)
+    , mIsRejectionTopP(getEnvUseRejectionTopPSampling())
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
 
@@ -57,7 +59,11 @@ void TopPSamplingLayer<T>::allocateBuffer(SizeType32 batchSize)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
 
-    if (!mIsAirTopP)
+    if (mIsRejectionTopP)
+    {
+        mWorkspaceSize = 0;
+    }
+    else if (!mIsAirTopP)
     {
         mWorkspaceSize = getTopPWorkspaceSize<T>(batchSize, mDecoderDomain.getVocabSizePadded());
     }
@@ -204,7 +210,7 @@ void TopPSamplingLayer<T>::setup(SizeType32 batchSize, SizeType32 beamWidth, Ten
         {topKsPtr, runtimeTopK.front(), nullptr}, {}, //
         skipDecodeHostPtr, nullptr, batchSlotsHostPtr, false);
 
-    if (mIsAirTopP)
+    if (mIsAirTopP && !mIsRejectionTopP)
     {
         auto smCnt = mDeviceProp.multiProcessorCount;
         if (smCnt <= 0)
@@ -274,7 +280,11 @@ void TopPSamplingLayer<T>::forwardAsync(std::shared_ptr<BaseDecodingOutputs> con
     params.maxBatchSize = mDecoderDomain.getBatchSize();
     params.vocabSizePadded = mDecoderDomain.getVocabSizePadded();
 
-    if (!mIsAirTopP)
+    if (mIsRejectionTopP)
+    {
+        invokeBatchRejectionTopPSampling<T>(params, getStream());
+    }
+    else if (!mIsAirTopP)
     {
         invokeBatchTopPSampling<T>(params, getStream());
     }
@@ -62,6 +62,8 @@ protected:
     runtime::SizeType32 mAirTopPBlockNum{0};
     bool mIsDeterministic{true};
     bool mIsAirTopP{false};
+    // Rejection sampling, takes precedence over AirTopP.
+    bool mIsRejectionTopP{false};
 
     using Base::mDecoderDomain;
 
@@ -16,6 +16,7 @@
  */
 #include "tensorrt_llm/plugins/api/tllmPlugin.h"
 
+#include "tensorrt_llm/common/startupTrace.h"
 #include "tensorrt_llm/common/stringUtils.h"
 #include "tensorrt_llm/runtime/tllmLogger.h"
 
@@ -38,6 +39,7 @@
 #include "tensorrt_llm/plugins/gemmAllReducePlugin/gemmAllReducePlugin.h"
 #include "tensorrt_llm/plugins/ncclPlugin/allgatherPlugin.h"
 #include "tensorrt_llm/plugins/ncclPlugin/allreducePlugin.h"
+#include "tensorrt_llm/plugins/ncclPlugin/gemmCommOverlapPlugin.h"
 #include "tensorrt_llm/plugins/ncclPlugin/recvPlugin.h"
 #include "tensorrt_llm/plugins/ncclPlugin/reduceScatterPlugin.h"
 #include "tensorrt_llm/plugins/ncclPlugin/sendPlugin.h"
@@ -156,6 +158,7 @@ extern "C"
         {
             return true;
         }
+        TLLM_STARTUP_PHASE("plugin_registration");
 
         if (logger)
         {
@@ -219,6 +222,7 @@ extern "C"
         static tensorrt_llm::plugins::AllgatherPluginCreator allgatherPluginCreator;
         static tensorrt_llm::plugins::ReduceScatterPluginCreator reduceScatterPluginCreator;
         static tensorrt_llm::plugins::GemmAllReducePluginCreator gemmAllReducePluginCreator;
+        static tensorrt_llm::plugins::GemmCommOverlapPluginCreator gemmCommOverlapPluginCreator;
 #endif // ENABLE_MULTI_DEVICE
         static tensorrt_llm::plugins::SmoothQuantGemmPluginCreator smoothQuantGemmPluginCreator;
         static tensorrt_llm::plugins::QServeGemmPluginCreator qserveGemmPluginCreator;
@@ -260,6 +264,7 @@ extern "C"
                   creatorPtr(allgatherPluginCreator),
                   creatorPtr(reduceScatterPluginCreator),
                   creatorPtr(gemmAllReducePluginCreator),
+                  creatorPtr(gemmCommOverlapPluginCreator),
 #endif // ENABLE_MULTI_DEVICE
                   creatorPtr(smoothQuantGemmPluginCreator),
                   creatorPtr(qserveGemmPluginCreator),
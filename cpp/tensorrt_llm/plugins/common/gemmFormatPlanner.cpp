@@ -0,0 +1,288 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tensorrt_llm/plugins/common/gemmFormatPlanner.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <queue>
+
+namespace tensorrt_llm::plugins
+{
+
+namespace
+{
+
+// Options of a layer from the fastest to the most accurate, each one slower and more accurate than the one before,
+// with a decreasing error saved per millisecond.
+std::vector<GemmFormatOption> getLowerHull(std::vector<GemmFormatOption> options)
+{
+    std::sort(options.begin(), options.end(),
+        [](auto const& lhs, auto const& rhs)
+        { return lhs.latencyMs < rhs.latencyMs || (lhs.latencyMs == rhs.latencyMs && lhs.error < rhs.error); });
+
+    std::vector<GemmFormatOption> hull;
+    for (auto const& option : options)
+    {
+        // A slower option is only useful if it is more accurate.
+        if (!hull.empty() && option.error >= hull.back().error)
+        {
+            continue;
+        }
+        // Drop the options above the segment to the new one, their error per millisecond is not worth it.
+        while (hull.size() >= 2)
+        {
+            auto const& o = hull[hull.size() - 2];
+            auto const& a = hull.back();
+            auto const cross = (a.latencyMs - o.latencyMs) * (option.error - o.error)
+                - (a.error - o.error) * (option.latencyMs - o.latencyMs);
+            if (cross > 0.f)
+            {
+                break;
+            }
+            hull.pop_back();
+        }
+        hull.push_back(option);
+    }
+    return hull;
+}
+
+// Symmetric round to nearest of the value scaled to [-maxQ, maxQ] with an integer grid.
+float quantizeInt(float value, float scale, float maxQ)
+{
+    if (scale == 0.f)
+    {
+        return 0.f;
+    }
+    return std::clamp(std::nearbyint(value / scale), -maxQ, maxQ) * scale;
+}
+
+// Round to nearest of e4m3, with its subnormals and saturation at 448.
+float quantizeE4m3(float value, float scale)
+{
+    if (scale == 0.f)
+    {
+        return 0.f;
+    }
+    auto const scaled = std::min(std::fabs(value / scale), 448.f);
+    if (scaled == 0.f)
+    {
+        return 0.f;
+    }
+    auto const exponent = std::max(static_cast<int>(std::floor(std::log2(scaled))), -6);
+    auto const step = std::ldexp(1.f, exponent - 3);
+    return std::copysign(std::nearbyint(scaled / step) * step, value) * scale;
+}
+
+// Round to nearest of e2m1, whose magnitudes are 0, 0.5, 1, 1.5, 2, 3, 4 and 6.
+float quantizeE2m1(float value, float scale)
+{
+    static float constexpr kValues[] = {0.f, 0.5f, 1.f, 1.5f, 2.f, 3.f, 4.f, 6.f};
+    if (scale == 0.f)
+    {
+        return 0.f;
+    }
+    auto const scaled = std::fabs(value / scale);
+    float best = 0.f;
+    for (auto const candidate : kValues)
+    {
+        if (std::fabs(candidate - scaled) < std::fabs(best - scaled))
+        {
+            best = candidate;
+        }
+    }
+    return std::copysign(best, value) * scale;
+}
+
+float getAbsMax(float const* begin, float const* end)
+{
+    return std::accumulate(begin, end, 0.f, [](float acc, float x) { return std::max(acc, std::fabs(x)); });
+}
+
+} // namespace
+
+char const* getGemmPluginName(GemmWeightFormat format)
+{
+    switch (format)
+    {
+    case GemmWeightFormat::kFP16: return "Gemm";
+    case GemmWeightFormat::kFP8: return "Fp8RowwiseGemm";
+    case GemmWeightFormat::kINT8WeightOnly: return "WeightOnlyQuantMatmul";
+    case GemmWeightFormat::kINT4Groupwise: return "WeightOnlyGroupwiseQuantMatmul";
+    case GemmWeightFormat::kNVFP4: return "Fp4Gemm";
+    }
+    TLLM_THROW("Unknown GEMM weight format %d", static_cast<int>(format));
+}
+
+GemmFormatPlan planGemmFormats(std::vector<GemmLayerFormats> const& layers, GemmFormatBudget const& budget)
+{
+    TLLM_CHECK_WITH_INFO(budget.maxLatencyMs.has_value() != budget.maxError.has_value(),
+        "Set exactly one of the latency and the error budgets of the GEMM format plan.");
+
+    std::vector<std::vector<GemmFormatOption>> hulls;
+    hulls.reserve(layers.size());
+    for (auto const& layer : layers)
+    {
+        TLLM_CHECK_WITH_INFO(!layer.options.empty(), "The GEMM layer %s has no weight format.", layer.name.c_str());
+        hulls.push_back(getLowerHull(layer.options));
+    }
+
+    GemmFormatPlan plan;
+    std::vector<size_t> selected(layers.size(), 0);
+    for (auto const& hull : hulls)
+    {
+        plan.latencyMs += hull.front().latencyMs;
+        plan.error += hull.front().error;
+    }
+
+    // The next step of every layer by its error saved per millisecond.
+    using Step = std::pair<float, size_t>;
+    std::priority_queue<Step> steps;
+    auto const pushStep = [&](size_t layerIdx)
+    {
+        auto const& hull = hulls[layerIdx];
+        auto const next = selected[layerIdx] + 1;
+        if (next < hull.size())
+        {
+            auto const& from = hull[next - 1];
+            auto const& to = hull[next];
+            // The hull is strictly more accurate, a step of no latency is taken first.
+            auto const cost = std::max(to.latencyMs - from.latencyMs, 0.f);
+            auto const gain = from.error - to.error;
+            steps.emplace(cost > 0.f ? gain / cost : INFINITY, layerIdx);
+        }
+    };
+    for (size_t layerIdx = 0; layerIdx < layers.size(); ++layerIdx)
+    {
+        pushStep(layerIdx);
+    }
+
+    if (budget.maxLatencyMs)
+    {
+        plan.withinBudget = plan.latencyMs <= *budget.maxLatencyMs;
+        while (plan.withinBudget && !steps.empty())
+        {
+            auto const layerIdx = steps.top().second;
+            steps.pop();
+            auto const& from = hulls[layerIdx][selected[layerIdx]];
+            auto const& to = hulls[layerIdx][selected[layerIdx] + 1];
+            // The later steps of the layer save less per millisecond, so the layer keeps its format.
+            if (plan.latencyMs + to.latencyMs - from.latencyMs > *budget.maxLatencyMs)
+            {
+                continue;
+            }
+            plan.latencyMs += to.latencyMs - from.latencyMs;
+            plan.error += to.error - from.error;
+            ++selected[layerIdx];
+            pushStep(layerIdx);
+        }
+    }
+    else
+    {
+        while (plan.error > *budget.maxError && !steps.empty())
+        {
+            auto const layerIdx = steps.top().second;
+            steps.pop();
+            auto const& from = hulls[layerIdx][selected[layerIdx]];
+            auto const& to = hulls[layerIdx][selected[layerIdx] + 1];
+            plan.latencyMs += to.latencyMs - from.latencyMs;
+            plan.error += to.error - from.error;
+            ++selected[layerIdx];
+            pushStep(layerIdx);
+        }
+        plan.withinBudget = plan.error <= *budget.maxError;
+    }
+
+    plan.formats.reserve(layers.size());
+    for (size_t layerIdx = 0; layerIdx < layers.size(); ++layerIdx)
+    {
+        auto const format = hulls[layerIdx][selected[layerIdx]].format;
+        plan.formats.push_back(format);
+        TLLM_LOG_DEBUG("GEMM layer %s uses the %s plugin.", layers[layerIdx].name.c_str(), getGemmPluginName(format));
+    }
+    if (!plan.withinBudget)
+    {
+        TLLM_LOG_WARNING("No GEMM format plan fits the budget, the plan takes %f ms with an error of %f.",
+            plan.latencyMs, plan.error);
+    }
+    return plan;
+}
+
+double estimateActivationAwareError(float const* weights, float const* activationSquareMean, int64_t n, int64_t k,
+    GemmWeightFormat format, int64_t groupSize)
+{
+    TLLM_CHECK(weights != nullptr && activationSquareMean != nullptr && n > 0 && k > 0);
+    TLLM_CHECK_WITH_INFO(format != GemmWeightFormat::kINT4Groupwise || (groupSize > 0 && k % groupSize == 0),
+        "The INT4 groupwise k of %ld is not a multiple of the group size %ld.", k, groupSize);
+    int64_t constexpr kNvfp4GroupSize = 16;
+    if (format == GemmWeightFormat::kFP16)
+    {
+        return 0.;
+    }
+
+    // The FP8 GEMMs of the plugin scale the weights per tensor.
+    auto const tensorScale = format == GemmWeightFormat::kFP8 ? getAbsMax(weights, weights + n * k) / 448.f : 0.f;
+
+    double error = 0.;
+    std::vector<float> scales(k);
+    for (int64_t row = 0; row < n; ++row)
+    {
+        auto const* w = weights + row * k;
+        switch (format)
+        {
+        case GemmWeightFormat::kFP8: std::fill(scales.begin(), scales.end(), tensorScale); break;
+        case GemmWeightFormat::kINT8WeightOnly:
+            std::fill(scales.begin(), scales.end(), getAbsMax(w, w + k) / 127.f);
+            break;
+        case GemmWeightFormat::kINT4Groupwise:
+            for (int64_t col = 0; col < k; col += groupSize)
+            {
+                std::fill(scales.begin() + col, scales.begin() + col + groupSize,
+                    getAbsMax(w + col, w + col + groupSize) / 7.f);
+            }
+            break;
+        case GemmWeightFormat::kNVFP4:
+            for (int64_t col = 0; col < k; col += kNvfp4GroupSize)
+            {
+                auto const end = std::min(col + kNvfp4GroupSize, k);
+                std::fill(scales.begin() + col, scales.begin() + end, getAbsMax(w + col, w + end) / 6.f);
+            }
+            break;
+        default: break;
+        }
+
+        for (int64_t col = 0; col < k; ++col)
+        {
+            float quantized = 0.f;
+            switch (format)
+            {
+            case GemmWeightFormat::kFP8: quantized = quantizeE4m3(w[col], scales[col]); break;
+            case GemmWeightFormat::kINT8WeightOnly: quantized = quantizeInt(w[col], scales[col], 127.f); break;
+            case GemmWeightFormat::kINT4Groupwise: quantized = quantizeInt(w[col], scales[col], 7.f); break;
+            case GemmWeightFormat::kNVFP4: quantized = quantizeE2m1(w[col], scales[col]); break;
+            default: break;
+            }
+            auto const diff = static_cast<double>(w[col] - quantized);
+            error += diff * diff * activationSquareMean[col];
+        }
+    }
+    return error;
+}
+
+} // namespace tensorrt_llm::plugins
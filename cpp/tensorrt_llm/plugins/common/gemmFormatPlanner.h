@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::plugins
+{
+
+// Weight formats of a GEMM layer, each run by its own plugin.
+enum class GemmWeightFormat : int32_t
+{
+    kFP16 = 0,
+    kFP8 = 1,
+    kINT8WeightOnly = 2,
+    kINT4Groupwise = 3,
+    kNVFP4 = 4,
+};
+
+// Name of the plugin that runs the GEMMs of the format.
+[[nodiscard]] char const* getGemmPluginName(GemmWeightFormat format);
+
+// A format a layer can use, with the time of its GEMM from the profiler, see GemmPluginProfiler::getProfiledTimeMs, and
+// its error, see estimateActivationAwareError.
+struct GemmFormatOption
+{
+    GemmWeightFormat format{GemmWeightFormat::kFP16};
+    float latencyMs{0.f};
+    float error{0.f};
+};
+
+struct GemmLayerFormats
+{
+    std::string name;
+    std::vector<GemmFormatOption> options;
+};
+
+// Exactly one of the budgets is set: the plan either has the least total error within the latency, or the least total
+// latency within the error.
+struct GemmFormatBudget
+{
+    std::optional<float> maxLatencyMs;
+    std::optional<float> maxError;
+};
+
+struct GemmFormatPlan
+{
+    // Format of every layer, in the order of the layers.
+    std::vector<GemmWeightFormat> formats;
+    float latencyMs{0.f};
+    float error{0.f};
+    // False if even the fastest, or the most accurate, formats do not fit the budget. The plan then holds them.
+    bool withinBudget{true};
+};
+
+//! \brief Assigns a weight format to every GEMM layer of a model from the cost of its formats. Only the formats on the
+//! lower convex hull of the latency and error of a layer are used, and the layers start at their fastest format and
+//! move to a slower and more accurate one by the largest error saved per millisecond until the budget is met.
+[[nodiscard]] GemmFormatPlan planGemmFormats(
+    std::vector<GemmLayerFormats> const& layers, GemmFormatBudget const& budget);
+
+//! \brief Activation-aware output error of quantizing the [n, k] weights, k contiguous, to the format: the squared
+//! error of the weights of every input channel j weighted by E[x_j^2] of the calibration activations. The large
+//! activation channels make the layers whose outputs degrade most with a coarse format expensive, so that they keep
+//! a finer one. `groupSize` is the k group of the INT4 groupwise scales.
+[[nodiscard]] double estimateActivationAwareError(float const* weights, float const* activationSquareMean, int64_t n,
+    int64_t k, GemmWeightFormat format, int64_t groupSize = 128);
+
+} // namespace tensorrt_llm::plugins
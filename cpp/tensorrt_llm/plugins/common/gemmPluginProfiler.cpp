@@ -17,20 +17,48 @@
 
 #include "tensorrt_llm/plugins/common/gemmPluginProfiler.h"
 #include "tensorrt_llm/common/cublasMMWrapper.h"
+#include "tensorrt_llm/common/startupTrace.h"
 #include "tensorrt_llm/kernels/cutlass_kernels/fp8_rowwise_gemm/fp8_rowwise_gemm.h"
 #include "tensorrt_llm/kernels/cutlass_kernels/fpA_intB_gemm/fpA_intB_gemm.h"
 #include "tensorrt_llm/kernels/cutlass_kernels/fused_gated_gemm/fused_gated_gemm.h"
 #include "tensorrt_llm/kernels/cutlass_kernels/int8_gemm/int8_gemm.h"
 #include "tensorrt_llm/kernels/internal_cutlass_kernels/include/fp4_gemm.h"
+#include "tensorrt_llm/plugins/common/gemmTacticCache.h"
 #include "tensorrt_llm/plugins/gemmAllReducePlugin/gemmAllReducePlugin.h"
 #include "tensorrt_llm/plugins/lowLatencyGemmPlugin/lowLatencyGemmPlugin.h"
 #include "tensorrt_llm/plugins/lowLatencyGemmSwigluPlugin/lowLatencyGemmSwigluPlugin.h"
 #include "tensorrt_llm/plugins/mixtureOfExperts/mixtureOfExpertsPlugin.h"
 
 #include <cstddef>
+#include <cstring>
+#include <typeinfo>
 
 namespace tensorrt_llm::plugins
 {
+namespace
+{
+
+// The best config of an M is cached as its raw bytes, as in the engines. Nullopt if there is no cached config.
+template <typename Config>
+std::optional<std::optional<Config>> getCachedTactic(GemmTacticCache::Tactics const& tactics, int m)
+{
+    auto const it = tactics.find(m);
+    if (it == tactics.end() || it->second.config.size() != sizeof(std::optional<Config>))
+    {
+        return std::nullopt;
+    }
+    std::optional<Config> tactic;
+    std::memcpy(static_cast<void*>(&tactic), it->second.config.data(), sizeof(tactic));
+    return tactic;
+}
+
+template <typename Config>
+GemmTacticCache::Tactic toCachedTactic(std::optional<Config> const& tactic, float timeMs)
+{
+    return {std::string(reinterpret_cast<char const*>(&tactic), sizeof(tactic)), timeMs};
+}
+
+} // namespace
 
 template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
 GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::GemmPluginProfiler()
@@ -89,6 +117,26 @@ void GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::deserial
         read(data, config);
         profileMap->insert(config);
     }
+
+    // Add the tactics profiled for other Ms since the engine was built, so that the M of the requests finds its own
+    // tactic rather than the one of the next power of two.
+    auto const& tacticCache = GemmTacticCache::getInstance();
+    if (!mSkip && tacticCache.isEnabled())
+    {
+        if (auto const cacheKey = getGemmTacticCacheKey(gemmId))
+        {
+            auto const cachedTactics = tacticCache.load(*cacheKey);
+            for (auto const& cached : cachedTactics)
+            {
+                auto const tactic = getCachedTactic<Config>(cachedTactics, cached.first);
+                if (tactic && profileMap->count(cached.first) == 0)
+                {
+                    profileMap->insert({cached.first, *tactic});
+                    mMNKProfileMap->setProfiledTime(gemmId, cached.first, cached.second.timeMs);
+                }
+            }
+        }
+    }
 }
 
 template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
@@ -107,6 +155,20 @@ int GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::getMaxPro
     return 8192;
 }
 
+template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
+std::optional<std::string> GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::getGemmTacticCacheKey(
+    GemmIdType const& gemmId) const
+{
+    auto const profilerKey = getTacticCacheKey();
+    if (!profilerKey)
+    {
+        return std::nullopt;
+    }
+    std::ostringstream key;
+    key << typeid(*this).name() << "|" << sizeof(Config) << "|" << gemmId << "|" << *profilerKey;
+    return key.str();
+}
+
 template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
 void GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::initTmpData(
     int m, int n, int k, char* workspace, size_t size, cudaStream_t stream)
@@ -118,6 +180,7 @@ template <typename Config, typename RunnerPtr, typename GemmIdType, typename Gem
 void GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::profileTactics(RunnerPtr const& runner,
     nvinfer1::DataType const& type, GemmDims const& dims, GemmIdType const& gemmId, bool hasCudaKernel)
 {
+    TLLM_STARTUP_PHASE("gemm_plugin_profiling");
     writer_lock lock(mMNKProfileMap->mutex);
 
     if (!dims.isInitialized())
@@ -145,10 +208,23 @@ void GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::profileT
     auto mProfileMap = mMNKProfileMap->getMProfileMap(gemmId);
     bool isAllocated{false};
 
-    auto profileTactics = [&mProfileMap, &isAllocated, this](int m, int n, int k)
+    // Tactics profiled for the same GEMM by earlier builds, by other plugins or by other processes of the node.
+    auto const& tacticCache = GemmTacticCache::getInstance();
+    auto const cacheKey = tacticCache.isEnabled() ? getGemmTacticCacheKey(gemmId) : std::nullopt;
+    auto const cachedTactics = cacheKey ? tacticCache.load(*cacheKey) : GemmTacticCache::Tactics{};
+    GemmTacticCache::Tactics profiledTactics;
+
+    auto profileTactics
+        = [&mProfileMap, &isAllocated, &cachedTactics, &profiledTactics, &gemmId, this](int m, int n, int k)
     {
         if (mProfileMap->count(m) == 0)
         {
+            if (auto const cachedTactic = getCachedTactic<Config>(cachedTactics, m))
+            {
+                mProfileMap->insert({m, *cachedTactic});
+                mMNKProfileMap->setProfiledTime(gemmId, m, cachedTactics.at(m).timeMs);
+                return;
+            }
             if (!isAllocated)
             {
                 // Allocate tmp data to run GEMMs
@@ -158,16 +234,11 @@ void GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::profileT
             initTmpData(m, n, k, mWorkspaceTmp, mTmpWorkspaceSizeInBytes, mStream);
             auto tactics = this->getTactics(m, n, k);
 
-            // stop to profile Cuda kernel if m > 16 or CUTLASS kernel performs better for m - 1
+            // The CUDA kernel supports M up to 16 and competes with the CUTLASS tactics at every such M, as the faster
+            // of the two can change back and forth with M
             if constexpr (std::is_same_v<Config, tensorrt_llm::cutlass_extensions::CutlassGemmConfig>)
             {
-                // check if the best tactic for m-1 is CUTLASS kernel
-                bool lastTacticEnableCudaKernel = true;
-                if (mProfileMap->count(m - 1) > 0)
-                {
-                    lastTacticEnableCudaKernel = mProfileMap->at(m - 1).value().enableCudaKernel;
-                }
-                if (m > 16 || !lastTacticEnableCudaKernel)
+                if (m > 16)
                 {
                     if (!tactics.empty())
                     {
@@ -176,7 +247,11 @@ void GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::profileT
                 }
             }
             // Profile different tactics for particular m and insert best config to the map
-            mProfileMap->insert({m, this->profileTacticsForProblem(m, n, k, tactics)});
+            float bestTimeMs{-1.f};
+            auto const bestTactic = this->profileTacticsForProblem(m, n, k, tactics, bestTimeMs);
+            mProfileMap->insert({m, bestTactic});
+            mMNKProfileMap->setProfiledTime(gemmId, m, bestTimeMs);
+            profiledTactics.emplace(m, toCachedTactic(bestTactic, bestTimeMs));
         }
     };
 
@@ -215,6 +290,11 @@ void GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::profileT
         freeTmpData();
     }
     common::check_cuda_error(cudaStreamDestroy(mStream));
+
+    if (cacheKey)
+    {
+        tacticCache.store(*cacheKey, profiledTactics);
+    }
 }
 
 template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
@@ -249,6 +329,29 @@ std::optional<Config> GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHa
     }
 }
 
+template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
+std::optional<float> GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::getProfiledTimeMs(
+    int m, GemmIdType const& gemmId) const
+{
+    reader_lock lock(mMNKProfileMap->mutex);
+
+    auto const iter = mMNKProfileMap->timeMap.find(gemmId);
+    if (iter == mMNKProfileMap->timeMap.end())
+    {
+        return std::nullopt;
+    }
+    int const mRounded = std::min(std::max(1, nextPowerOfTwo(m)), getMaxProfileM());
+    for (int const key : {m, mRounded})
+    {
+        auto const time = iter->second.find(key);
+        if (time != iter->second.end())
+        {
+            return time->second;
+        }
+    }
+    return std::nullopt;
+}
+
 template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
 void GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::allocateTmpData()
 {
@@ -266,7 +369,7 @@ void GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::freeTmpD
 
 template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
 std::optional<Config> GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::profileTacticsForProblem(
-    int m, int n, int k, std::vector<Config> const& tactics)
+    int m, int n, int k, std::vector<Config> const& tactics, float& bestTimeMs)
 {
     TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
 
@@ -322,6 +425,7 @@ std::optional<Config> GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHa
         return std::nullopt;
     }
 
+    bestTimeMs = bestTime;
     return {bestConfig};
 }
 
@@ -23,11 +23,13 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <shared_mutex>
 #include <sstream>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -188,6 +190,9 @@ public:
         std::shared_timed_mutex mutex;
         // Map from GEMM Id to profile for particular GEMM
         std::unordered_map<GemmIdType, MProfileMapPtr, GemmIdHashType> profileMap;
+        // Map from GEMM Id to the time of the best config for every profiled M, the input of the cost model that
+        // assigns the weight formats of the layers at build time
+        std::unordered_map<GemmIdType, std::map<int, float>, GemmIdHashType> timeMap;
 
         bool existsMProfileMap(GemmIdType const& id)
         {
@@ -211,6 +216,14 @@ public:
             }
             return iter->second;
         }
+
+        void setProfiledTime(GemmIdType const& id, int m, float timeMs)
+        {
+            if (timeMs >= 0.f)
+            {
+                timeMap[id][m] = timeMs;
+            }
+        }
     };
 
     using MNKProfileMapPtr = std::shared_ptr<MNKProfileMap>;
@@ -242,6 +255,10 @@ public:
 
     std::optional<Config> getBestConfig(int m, GemmIdType const& gemmId) const;
 
+    // Time of the best config of the GEMM at M, rounded up as in getBestConfig. Nullopt when the M was not profiled in
+    // this process nor found in the tactic cache with its time.
+    std::optional<float> getProfiledTimeMs(int m, GemmIdType const& gemmId) const;
+
     virtual int getMaxProfileM() const;
 
 protected:
@@ -258,12 +275,22 @@ protected:
 
     virtual void initTmpData(int m, int n, int k, char* workspace, size_t size, cudaStream_t stream);
 
+    // State of the profiler beyond the GEMM ID that the best tactics depend on, so that the GEMMs that differ only in
+    // it do not share the tactics of TRTLLM_GEMM_TACTIC_CACHE_DIR. Nullopt disables the tactic cache of the profiler.
+    virtual std::optional<std::string> getTacticCacheKey() const
+    {
+        return std::string{};
+    }
+
 private:
     void allocateTmpData();
 
     void freeTmpData();
 
-    std::optional<Config> profileTacticsForProblem(int m, int n, int k, std::vector<Config> const& tactics);
+    std::optional<std::string> getGemmTacticCacheKey(GemmIdType const& gemmId) const;
+
+    std::optional<Config> profileTacticsForProblem(
+        int m, int n, int k, std::vector<Config> const& tactics, float& bestTimeMs);
 
     float profileTacticForProblem(int m, int n, int k, Config const& tactic);
 
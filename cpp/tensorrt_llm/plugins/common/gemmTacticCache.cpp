@@ -0,0 +1,213 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/plugins/common/gemmTacticCache.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/stringUtils.h"
+
+#include <cuda_runtime_api.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+
+namespace tensorrt_llm::plugins
+{
+
+namespace
+{
+
+uint32_t constexpr kMagic = 0x43544d47; // "GMTC"
+// Bump when the tactics of the profilers change meaning for the same key.
+uint32_t constexpr kFormatVersion = 2;
+
+template <typename T>
+bool readValue(std::ifstream& file, T& value)
+{
+    file.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return static_cast<bool>(file);
+}
+
+bool readString(std::ifstream& file, std::string& value)
+{
+    uint32_t size{0};
+    if (!readValue(file, size))
+    {
+        return false;
+    }
+    value.resize(size);
+    file.read(value.data(), static_cast<std::streamsize>(size));
+    return static_cast<bool>(file);
+}
+
+template <typename T>
+void writeValue(std::ofstream& file, T const& value)
+{
+    file.write(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+void writeString(std::ofstream& file, std::string const& value)
+{
+    writeValue(file, static_cast<uint32_t>(value.size()));
+    file.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+} // namespace
+
+GemmTacticCache const& GemmTacticCache::getInstance()
+{
+    static GemmTacticCache const cache{tensorrt_llm::common::getEnvGemmTacticCacheDir()};
+    return cache;
+}
+
+GemmTacticCache::GemmTacticCache(std::string dir)
+    : mDir(std::move(dir))
+{
+    if (mDir.empty())
+    {
+        return;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(mDir, error);
+    if (error)
+    {
+        TLLM_LOG_WARNING("Cannot create the GEMM tactic cache directory %s (%s), the cache is disabled.", mDir.c_str(),
+            error.message().c_str());
+        mDir.clear();
+    }
+}
+
+std::string GemmTacticCache::getFullKey(std::string const& gemmKey)
+{
+    int device{0};
+    TLLM_CUDA_CHECK(cudaGetDevice(&device));
+    cudaDeviceProp prop{};
+    TLLM_CUDA_CHECK(cudaGetDeviceProperties(&prop, device));
+    int clockRate{0};
+    TLLM_CUDA_CHECK(cudaDeviceGetAttribute(&clockRate, cudaDevAttrClockRate, device));
+    return tensorrt_llm::common::fmtstr("%s|sm%d%d|%s|%d SMs|%d kHz|CUDA %d|v%u", gemmKey.c_str(), prop.major,
+        prop.minor, prop.name, prop.multiProcessorCount, clockRate, CUDART_VERSION, kFormatVersion);
+}
+
+std::string GemmTacticCache::getPath(std::string const& fullKey) const
+{
+    // Collisions are caught by the check of the key on load.
+    auto const hash = std::hash<std::string>{}(fullKey);
+    auto const name = tensorrt_llm::common::fmtstr("gemm_%016llx.tactics", static_cast<unsigned long long>(hash));
+    return (std::filesystem::path{mDir} / name).string();
+}
+
+GemmTacticCache::Tactics GemmTacticCache::load(std::string const& gemmKey) const
+{
+    Tactics tactics;
+    if (!isEnabled())
+    {
+        return tactics;
+    }
+    auto const fullKey = getFullKey(gemmKey);
+    auto const path = getPath(fullKey);
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return tactics;
+    }
+    uint32_t magic{0};
+    std::string storedKey;
+    if (!readValue(file, magic) || magic != kMagic || !readString(file, storedKey) || storedKey != fullKey)
+    {
+        return tactics;
+    }
+    uint32_t count{0};
+    if (!readValue(file, count))
+    {
+        return tactics;
+    }
+    for (uint32_t ii = 0; ii < count; ++ii)
+    {
+        int m{0};
+        Tactic tactic;
+        if (!readValue(file, m) || !readValue(file, tactic.timeMs) || !readString(file, tactic.config))
+        {
+            TLLM_LOG_WARNING("Ignoring the truncated GEMM tactic cache file %s.", path.c_str());
+            return {};
+        }
+        tactics.emplace(m, std::move(tactic));
+    }
+    TLLM_LOG_DEBUG("Loaded %zu GEMM tactics from %s.", tactics.size(), path.c_str());
+    return tactics;
+}
+
+void GemmTacticCache::store(std::string const& gemmKey, Tactics const& tactics) const
+{
+    if (!isEnabled() || tactics.empty())
+    {
+        return;
+    }
+    try
+    {
+        // Keep the tactics stored by other processes since this one loaded the file.
+        auto merged = load(gemmKey);
+        for (auto const& [m, tactic] : tactics)
+        {
+            merged[m] = tactic;
+        }
+
+        auto const fullKey = getFullKey(gemmKey);
+        auto const path = getPath(fullKey);
+        auto const tmpPath = tensorrt_llm::common::fmtstr("%s.tmp.%d.%zu", path.c_str(), static_cast<int>(getpid()),
+            std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        {
+            std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+            writeValue(file, kMagic);
+            writeString(file, fullKey);
+            writeValue(file, static_cast<uint32_t>(merged.size()));
+            for (auto const& [m, tactic] : merged)
+            {
+                writeValue(file, m);
+                writeValue(file, tactic.timeMs);
+                writeString(file, tactic.config);
+            }
+            if (!file)
+            {
+                TLLM_LOG_WARNING("Cannot write the GEMM tactic cache file %s.", tmpPath.c_str());
+                file.close();
+                std::error_code error;
+                std::filesystem::remove(tmpPath, error);
+                return;
+            }
+        }
+        // Readers see either the previous file or a complete one.
+        std::error_code error;
+        std::filesystem::rename(tmpPath, path, error);
+        if (error)
+        {
+            TLLM_LOG_WARNING(
+                "Cannot write the GEMM tactic cache file %s (%s).", path.c_str(), error.message().c_str());
+            std::filesystem::remove(tmpPath, error);
+        }
+    }
+    catch (std::exception const& e)
+    {
+        TLLM_LOG_WARNING("Cannot store the GEMM tactics: %s", e.what());
+    }
+}
+
+} // namespace tensorrt_llm::plugins
@@ -0,0 +1,68 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <map>
+#include <string>
+
+namespace tensorrt_llm::plugins
+{
+
+// Best tactics of the GEMM plugins by M, stored in the directory of TRTLLM_GEMM_TACTIC_CACHE_DIR so that the builds of
+// later engines and the other plugins of the same GEMM skip the profiling. A file holds the tactics of one GEMM of one
+// profiler on one GPU model, and its full key is verified on load. Files are written to a temporary name and renamed,
+// so the processes of a node can share the directory.
+class GemmTacticCache
+{
+public:
+    struct Tactic
+    {
+        // Raw bytes of the std::optional<Config>.
+        std::string config;
+        // Profiled time of the config, < 0 if unknown.
+        float timeMs{-1.f};
+    };
+
+    // Tactic of every profiled M.
+    using Tactics = std::map<int, Tactic>;
+
+    static GemmTacticCache const& getInstance();
+
+    [[nodiscard]] bool isEnabled() const
+    {
+        return !mDir.empty();
+    }
+
+    // The key of a GEMM: the profiler, the size of its config and the GEMM ID. The GPU model is added by the cache.
+    [[nodiscard]] Tactics load(std::string const& gemmKey) const;
+
+    // Merges the tactics into the stored ones. Never throws: a failure to write only costs a profiling later.
+    void store(std::string const& gemmKey, Tactics const& tactics) const;
+
+private:
+    explicit GemmTacticCache(std::string dir);
+
+    // The GEMM key followed by the SM version, name, SM count and clock of the current GPU, which the tactics are tuned
+    // for, and by the CUDA version.
+    [[nodiscard]] static std::string getFullKey(std::string const& gemmKey);
+
+    [[nodiscard]] std::string getPath(std::string const& fullKey) const;
+
+    std::string mDir;
+};
+
+} // namespace tensorrt_llm::plugins
@@ -459,11 +459,11 @@ void EagleDecodeDraftTokensPlugin::doTopKSampling(nvinfer1::PluginTensorDesc con
 
     SizeType32 const secondTopKVocabSize = dynamicTreeMaxTopK * maxDecodingDraftTokens;
     // Workspace 9: Sampling from [batchSize, dynamicTreeMaxTopK * maxDecodingDraftTokens] to [batchSize,
-    // dynamicTreeMaxTopK]
+    // dynamicTreeMaxTopK]. The second topK is done by invokeDynamicTreeLayerUpdate without a sampling workspace, it is
+    // only skipped here to keep the offsets of the following workspaces.
     auto const secondTopKSamplingWorkspaceSize
         = getTopKWorkspaceSize<float>(batchSize, /* maxTokensPerStep */ 1, /* maxTopK */ maxTopK, secondTopKVocabSize);
-    void* workspaceScoresSampling
-        = reinterpret_cast<void*>(tc::nextWorkspacePtr(workspaceBytePtr, offset, secondTopKSamplingWorkspaceSize));
+    tc::nextWorkspacePtr(workspaceBytePtr, offset, secondTopKSamplingWorkspaceSize);
 
     // Workspace 10: the second (scores) sampling's outputIds, shape: [batchSize, maxDecodingDraftTokens]
     TokenIdType* secondTopKOutputIdsFlatten = reinterpret_cast<TokenIdType*>(
@@ -473,9 +473,8 @@ void EagleDecodeDraftTokensPlugin::doTopKSampling(nvinfer1::PluginTensorDesc con
     TokenIdType** secondTopKOutputIdsPtrs = reinterpret_cast<TokenIdType**>(
         tc::nextWorkspacePtr(workspaceBytePtr, offset, batchSize * sizeof(TokenIdType*)));
 
-    // Workspace 12: input scores pointers
-    float** secondTopKInputScoresPtrs
-        = reinterpret_cast<float**>(tc::nextWorkspacePtr(workspaceBytePtr, offset, batchSize * sizeof(float*)));
+    // Workspace 12: input scores pointers, unused since the second topK is done by invokeDynamicTreeLayerUpdate
+    tc::nextWorkspacePtr(workspaceBytePtr, offset, batchSize * sizeof(float*));
 
     // Workspace 13: the second sampling's outputLogProbs
     float* secondTopKOutputLogProbs = reinterpret_cast<float*>(
@@ -573,120 +572,88 @@ void EagleDecodeDraftTokensPlugin::doTopKSampling(nvinfer1::PluginTensorDesc con
 
     if (useDynamicTree)
     {
-        // When mLayerIdx == 0, we do not need to update scores.
-        // We take the outputLogProbs of the first topK sampling as the scores directly.
         if (mLayerIdx != 0)
         {
-            // Update firstTopKOutputLogProbs with pluginInputPrevScores, which is the scores from the previous layer
-            invokeUpdateScores(batchSize, dynamicTreeMaxTopK, maxDecodingDraftTokens, firstTopKOutputLogProbs,
-                pluginInputPrevScores, stream);
-            sync_check_cuda_error();
-
-            // Do the second top-dynamicTreeMaxTopK sampling among this dynamicTreeMaxTopK x dynamicTreeMaxTopK draft
-            // tokens. Through the second topK sampling, we obtain the dynamicTreeMaxTopK output draft tokens of this
-            // layer.
-
-            // Although theoretically we only need to select 'dynamicTreeMaxTopK' draft tokens from 'dynamicTreeMaxTopK
-            // * dynamicTreeMaxTopK' draft tokens, we over-set vocabSize here. This is because when we write the scores
-            // into firstTopKOutputLogProbs, we store it in the form of [batchSize * dynamicTreeMaxTopK,
-            // maxDecodingDraftTokens]. For each request, these 'dynamicTreeMaxTopK * dynamicTreeMaxTopK' scores are not
-            // saved continuously, but in the format of [dynamicTreeMaxTopK, maxDecodingDraftTokens]. For unused
-            // positions, we set '-inf' to ensure that they will not be sampled. Examples: For a request,
-            // dynamicTreeMaxTopK == 3, the scores in its buffer ([dynamicTreeMaxTopK, maxDecodingDraftTokens]) are as
-            // follow:
-            // [[1.1, 2.2, 3.3, -inf, -inf, ...],
-            //  [4.4, 5.5, 6.6, -inf, -inf, ...],
-            //  [7.7, 8.8, 9.9, -inf, -inf, ...]]
-
-            // Prepare the input of the second topK sampling.
-            invokeAssembleSecondTopKSamplingInputs(batchSize, dynamicTreeMaxTopK, maxDecodingDraftTokens,
-                firstTopKOutputLogProbs, secondTopKInputScoresPtrs, secondTopKOutputIdsFlatten, secondTopKOutputIdsPtrs,
-                stream);
-            sync_check_cuda_error();
-
-            TopKSamplingKernelParams<float> params{};
-            params.logProbsPtrs = secondTopKInputScoresPtrs;
-            params.outputIdsPtrs = secondTopKOutputIdsPtrs;
-            params.workspace = workspaceScoresSampling;
-            params.maxTopK = maxTopK; // Same to maxDecodingTokens
-            params.topKs = topKs;     // [batchSize], all set to dynamicTreeMaxTopK
-            params.batchSize = batchSize;
-            params.maxBatchSize = batchSize;
-            params.maxTokensPerStep = 1;
-            params.vocabSizePadded = secondTopKVocabSize;
-            params.returnAllSelectedTokens = true;
-            params.strictTopPBoundary = false;
-
-            invokeBatchTopKSampling(params, stream);
+            // Update firstTopKOutputLogProbs with pluginInputPrevScores, which is the scores from the previous layer,
+            // and select the top-dynamicTreeMaxTopK among these dynamicTreeMaxTopK x dynamicTreeMaxTopK draft tokens
+            // as the output draft tokens of this layer. Then save this layer's scores, draft tokens and their
+            // predecessors, grow the paths (except at the last layer) and append the output draft tokens and scores.
+            // All of it in one launch, see invokeDynamicTreeLayerUpdate for the equivalent chain of kernels.
+            DynamicTreeLayerUpdateParams layerUpdateParams;
+            layerUpdateParams.layerIdx = mLayerIdx;
+            layerUpdateParams.numEagleLayers = mNumEagleLayers;
+            layerUpdateParams.batchSize = batchSize;
+            layerUpdateParams.dynamicTreeMaxTopK = dynamicTreeMaxTopK;
+            layerUpdateParams.maxDecodingTokens = maxDecodingTokens;
+            layerUpdateParams.maxPathLen = maxPathLen;
+            layerUpdateParams.inputPrevScores = pluginInputPrevScores;
+            layerUpdateParams.inputCurrentExpandIndices = pluginInputCurrentExpandIndices;
+            layerUpdateParams.inputAllLayersScores = pluginInputAllLayersScores;
+            layerUpdateParams.inputAllLayersDraftTokenIds = pluginInputAllLayersDraftTokenIds;
+            layerUpdateParams.inputAllLayersDraftTokenIdsPredecessor = pluginInputAllLayersDraftTokenIdsPredecessor;
+            layerUpdateParams.inputPaths = pluginInputPaths;
+            layerUpdateParams.inputDraftTokenIds = pluginInputDraftTokenIds;
+            layerUpdateParams.inputDraftLens = pluginInputDraftLens;
+            layerUpdateParams.firstTopKOutputLogProbs = firstTopKOutputLogProbs;
+            layerUpdateParams.firstTopKOutputIds = firstTopKOutputIdsFlatten;
+            layerUpdateParams.secondTopKOutputIds = secondTopKOutputIdsFlatten;
+            layerUpdateParams.secondTopKOutputLogProbs = secondTopKOutputLogProbs;
+            layerUpdateParams.outputAllLayersScores = pluginOutputAllLayersScores;
+            layerUpdateParams.outputAllLayersDraftTokenIds = pluginOutputAllLayersDraftTokenIds;
+            layerUpdateParams.outputAllLayersDraftTokenIdsPredecessor = pluginOutputAllLayersDraftTokenIdsPredecessor;
+            layerUpdateParams.outputPaths = pluginOutputPaths;
+            layerUpdateParams.outputNextExpandIndices = pluginOutputNextExpandIndices;
+            layerUpdateParams.outputDraftTokenIds = pluginOutputDraftTokenIds;
+            layerUpdateParams.outputDraftLens = pluginOutputDraftLens;
+            layerUpdateParams.outputCurrentScores = pluginOutputCurrentScores;
+            layerUpdateParams.checkParams();
+
+            invokeDynamicTreeLayerUpdate(layerUpdateParams, stream);
             sync_check_cuda_error();
         }
-
-        // Copy this layer's scores and draft tokensId:
-        // 1) Copy this layer's scores to pluginOutputAllLayersScores
-        // 2) Copy dynamicTreeMaxTopK (or dynamicTreeMaxTopK * dynamicTreeMaxTopK) draft tokens to
-        // pluginOutputAllLayersDraftTokenIds 3) Set the predecessors of these draft tokens and save to
-        // pluginOutputAllLayersDraftTokenIdsPredecessor,
-        //    which will be used to reconstruct the final output tree at the last layer
-        invokeCopyScoresAndDraftTokenIds(mLayerIdx, mNumEagleLayers, maxDecodingDraftTokens, batchSize,
-            dynamicTreeMaxTopK, topKOffset,
-            pluginInputCurrentExpandIndices, // The indices of the nodes that expand in this layer (i.e., the input
-                                             // logits). The index is related to the final tree.
-            pluginInputAllLayersScores, pluginInputAllLayersDraftTokenIds, pluginInputAllLayersDraftTokenIdsPredecessor,
-            pluginOutputAllLayersScores, pluginOutputAllLayersDraftTokenIds,
-            pluginOutputAllLayersDraftTokenIdsPredecessor,
-            firstTopKOutputLogProbs,   // This layer's scores
-            firstTopKOutputIdsFlatten, // This layer's draft tokens
-            stream);
-        sync_check_cuda_error();
-
-        // Update Path
-        // For mLayerIdx == 0, the output of the first topK sampling are the output draft tokens of this layers. The
-        // update logic is simple. For mLayerIdx > 0, the output of the second topK sampling are the output draft tokens
-        // of this layers. 'secondTopKOutputIdsPtrs' contains the top-dynamicTreeMaxTopK selected from the second topK
-        // sampling. 'pluginOutputNextExpandIndices' record the selected the top-dynamicTreeMaxTopK draft token's Id of
-        // this layer,
-        //     which will be used in the next layer to compute the predecessors.
-        // The last layer will completely reconstruct the paths, so there is no need to update the paths here.
-        if (mLayerIdx != mNumEagleLayers - 1)
+        else
         {
-            invokeUpdatePath(mLayerIdx, batchSize, dynamicTreeMaxTopK, maxDecodingTokens, maxPathLen, pluginInputPaths,
-                pluginOutputPaths,
-                secondTopKOutputIdsPtrs, // if mLayerIdx == 0, secondTopKOutputIdsPtrs == nullptr, and it's useless
-                                         // during update paths
-                pluginOutputNextExpandIndices, stream);
+            // When mLayerIdx == 0, we do not need to update scores.
+            // We take the outputLogProbs of the first topK sampling as the scores directly.
+            // Copy this layer's scores and draft tokensId:
+            // 1) Copy this layer's scores to pluginOutputAllLayersScores
+            // 2) Copy dynamicTreeMaxTopK draft tokens to pluginOutputAllLayersDraftTokenIds
+            // 3) Set the predecessors of these draft tokens and save to pluginOutputAllLayersDraftTokenIdsPredecessor,
+            //    which will be used to reconstruct the final output tree at the last layer
+            invokeCopyScoresAndDraftTokenIds(mLayerIdx, mNumEagleLayers, maxDecodingDraftTokens, batchSize,
+                dynamicTreeMaxTopK, topKOffset, pluginInputCurrentExpandIndices, pluginInputAllLayersScores,
+                pluginInputAllLayersDraftTokenIds, pluginInputAllLayersDraftTokenIdsPredecessor,
+                pluginOutputAllLayersScores, pluginOutputAllLayersDraftTokenIds,
+                pluginOutputAllLayersDraftTokenIdsPredecessor,
+                firstTopKOutputLogProbs,   // This layer's scores
+                firstTopKOutputIdsFlatten, // This layer's draft tokens
+                stream);
             sync_check_cuda_error();
-        }
 
-        if (mLayerIdx != 0)
-        {
-            // We will extract the real draft tokenIds and scores from 'firstTopKOutputIdsFlatten' and
-            // 'secondTopKInputScoresPtrs' according to the 'secondTopKOutputIdsPtrs'. And store them into
-            // 'secondTopKOutputIdsPtrs' and 'secondTopKOutputLogProbs' (reuse these buffers).
-            // secondTopKInputScoresPtrs: shape [batchSize * dynamicTreeMaxTopK, maxDecodingDraftTokens]
-            //     The original scores, which were used to do the second TopK sampling
-            // secondTopKOutputIdsPtrs: shape [batchSize], each points to a [maxDecodingDraftTokens] buffer
-            //     The output of the second TopK sampling, which are the indices of the top-dynamicTreeMaxTopK among
-            //     'dynamicTreeMaxTopK * dynamicTreeMaxTopK'. We need to figure out what these top-dynamicTreeMaxTopK
-            //     draft tokens' real tokenIds.
-            // firstTopKOutputIdsFlatten: shape [batchSize * dynamicTreeMaxTopK, maxDecodingDraftTokens]
-            //     The value are related to the vocabSize, which is the real tokenIds.
-            invokeExtractScoresAndRealDraftTokensIds(batchSize, dynamicTreeMaxTopK, maxDecodingDraftTokens,
-                secondTopKInputScoresPtrs, secondTopKOutputIdsPtrs, firstTopKOutputIdsFlatten, secondTopKOutputLogProbs,
+            // Update Path
+            // The output of the first topK sampling are the output draft tokens of this layers. The update logic is
+            // simple. 'pluginOutputNextExpandIndices' record the selected draft token's Id of this layer, which will be
+            // used in the next layer to compute the predecessors.
+            // The last layer will completely reconstruct the paths, so there is no need to update the paths here.
+            if (mLayerIdx != mNumEagleLayers - 1)
+            {
+                invokeUpdatePath(mLayerIdx, batchSize, dynamicTreeMaxTopK, maxDecodingTokens, maxPathLen,
+                    pluginInputPaths, pluginOutputPaths,
+                    secondTopKOutputIdsPtrs, // secondTopKOutputIdsPtrs is useless during update paths at layer 0
+                    pluginOutputNextExpandIndices, stream);
+                sync_check_cuda_error();
+            }
+
+            // Copy this layer's output draft tokens and scores.
+            // This layer's output scores is next layer's previous scores.
+            // Directly use the first topK's outputIds / logProbs as this layer's output draft tokens / scores.
+            invokeUpdateDraftTokensAndLensAndCurScores(mLayerIdx, batchSize, dynamicTreeMaxTopK,
+                maxDecodingDraftTokens, firstTopKOutputIdsPtrs, pluginInputDraftTokenIds, pluginInputDraftLens,
+                pluginOutputDraftTokenIds, pluginOutputDraftLens, firstTopKOutputLogProbs, pluginOutputCurrentScores,
                 stream);
             sync_check_cuda_error();
         }
 
-        // Copy this layer's output draft tokens and scores.
-        // This layer's output scores is next layer's previous scores.
-        // if mLayerIdx == 0, directly use the first topK's outputIds / logProbs as this layer's output draft tokens /
-        // scores if mLayerIdx > 0, we use the second topK's outputIds / logProbs,
-        //      which is updated with the real draft tokenIds / logprobs in 'invokeExtractScoresAndRealDraftTokensIds'
-        invokeUpdateDraftTokensAndLensAndCurScores(mLayerIdx, batchSize, dynamicTreeMaxTopK, maxDecodingDraftTokens,
-            mLayerIdx == 0 ? firstTopKOutputIdsPtrs : secondTopKOutputIdsPtrs, pluginInputDraftTokenIds,
-            pluginInputDraftLens, pluginOutputDraftTokenIds, pluginOutputDraftLens,
-            mLayerIdx == 0 ? firstTopKOutputLogProbs : secondTopKOutputLogProbs, pluginOutputCurrentScores, stream);
-        sync_check_cuda_error();
-
         if (mLayerIdx == mNumEagleLayers - 1)
         {
             // The maximum number of nodes on the final tree (exclude the root node)
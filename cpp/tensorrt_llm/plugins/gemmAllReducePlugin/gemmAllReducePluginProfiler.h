@@ -48,6 +48,12 @@ protected:
 
     std::vector<GemmAllReduceImplInterface::LaunchConfig> getTactics(int m, int n, int k) const override;
 
+    // The tactics are kept in the own files of the profiler.
+    std::optional<std::string> getTacticCacheKey() const override
+    {
+        return std::nullopt;
+    }
+
 private:
     static std::string getCacheFileName(GemmIdCore gemmId);
 };
@@ -18,6 +18,8 @@
 #include "gptAttentionPlugin.h"
 
 #include "tensorrt_llm/batch_manager/contextProgress.h"
+#include "tensorrt_llm/batch_manager/kvCacheLayerwiseOnboarder.h"
+#include "tensorrt_llm/batch_manager/kvCacheTokenEvictor.h"
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention.h"
 #include "tensorrt_llm/kernels/gptKernels.h"
@@ -926,12 +928,19 @@ int GPTAttentionPlugin::enqueueSome(int32_t seqIdxBeg, int32_t localNbSeq, int32
 
     float const* kv_scale_orig_quant = nullptr;
     float const* kv_scale_quant_orig = nullptr;
+    bool kv_scale_per_head = false;
     if (useKVCache() && mKVCacheQuantMode.hasKvCacheQuant())
     {
         assert(inputDesc[getIdx(IdxEntry::KV_CACHE_QUANTIZATION_SCALE)].type == nvinfer1::DataType::kFLOAT);
         assert(inputDesc[getIdx(IdxEntry::KV_CACHE_DEQUANTIZATION_SCALE)].type == nvinfer1::DataType::kFLOAT);
         kv_scale_orig_quant = reinterpret_cast<float const*>(inputs[getIdx(IdxEntry::KV_CACHE_QUANTIZATION_SCALE)]);
         kv_scale_quant_orig = reinterpret_cast<float const*>(inputs[getIdx(IdxEntry::KV_CACHE_DEQUANTIZATION_SCALE)]);
+        // The scales are either per tensor [1] or per KV head [num_kv_heads].
+        auto const numKvScales = inputDesc[getIdx(IdxEntry::KV_CACHE_QUANTIZATION_SCALE)].dims.d[0];
+        TLLM_CHECK_WITH_INFO(numKvScales == 1 || numKvScales == mNumKVHeads,
+            "Expect 1 or %d KV cache scales, got " FMT_DIM, mNumKVHeads, numKvScales);
+        TLLM_CHECK(inputDesc[getIdx(IdxEntry::KV_CACHE_DEQUANTIZATION_SCALE)].dims.d[0] == numKvScales);
+        kv_scale_per_head = numKvScales > 1;
     }
 
     float const* attention_output_orig_quant = nullptr;
@@ -967,6 +976,8 @@ int GPTAttentionPlugin::enqueueSome(int32_t seqIdxBeg, int32_t localNbSeq, int32
     kernels::KVBlockArray::DataType* host_block_offsets = nullptr;
     void* host_primary_pool_pointer = nullptr;
     void* host_secondary_pool_pointer = nullptr;
+    void* host_primary_block_scale_pool_pointer = nullptr;
+    void* host_secondary_block_scale_pool_pointer = nullptr;
     if (useKVCache() && mPagedKVCache)
     {
         auto const& kvCacheBlockOffsetsShape = inputDesc[getIdx(IdxEntry::KV_CACHE_BLOCK_OFFSETS)].dims;
@@ -995,12 +1006,26 @@ int GPTAttentionPlugin::enqueueSome(int32_t seqIdxBeg, int32_t localNbSeq, int32
         auto const cacheElemSize = (mKVCacheQuantMode.hasKvCacheQuant() ? 1 : sizeof(T));
 
         auto const blockSize = mTokensPerBlock * mNumKVHeads * mHeadSize;
-        auto const bytesPerBlock = blockSize * cacheElemSize;
+        // The NVFP4 KV cache packs two elements per byte.
+        auto const bytesPerBlock = mKVCacheQuantMode.hasFp4KvCache() ? blockSize / 2 : blockSize * cacheElemSize;
         auto const layerOffset = mLayerIdxInCachePool * 2 * bytesPerBlock;
 
         host_primary_pool_pointer = reinterpret_cast<void*>(typed_host_pool_pointers[layerToPool * 2] + layerOffset);
         host_secondary_pool_pointer
             = reinterpret_cast<void*>(typed_host_pool_pointers[layerToPool * 2 + 1] + layerOffset);
+
+        if (mKVCacheQuantMode.hasFp4KvCache())
+        {
+            // The block scale pools follow the data pools, one per data pool, with one FP8 scale per 16 elements.
+            auto const numPools = inputDesc[getIdx(IdxEntry::HOST_KV_CACHE_POOL_POINTERS)].dims.d[0];
+            TLLM_CHECK_WITH_INFO(numPools % 2 == 0, "The NVFP4 KV cache needs one block scale pool per pool.");
+            auto const scalePoolIdx = layerToPool + numPools / 2;
+            auto const scaleLayerOffset = mLayerIdxInCachePool * 2 * (blockSize / 16);
+            host_primary_block_scale_pool_pointer
+                = reinterpret_cast<void*>(typed_host_pool_pointers[scalePoolIdx * 2] + scaleLayerOffset);
+            host_secondary_block_scale_pool_pointer
+                = reinterpret_cast<void*>(typed_host_pool_pointers[scalePoolIdx * 2 + 1] + scaleLayerOffset);
+        }
     }
 
     // The index of kv cache tensor in outputs. If fuse FP4 quant, an additional scaling factor output is added before
@@ -1109,6 +1134,9 @@ int GPTAttentionPlugin::enqueueSome(int32_t seqIdxBeg, int32_t localNbSeq, int32
             batch_size, localNbTokens, max_blocks_per_sequence, host_context_lengths, workspace, mrope_rotary_cos_sin};
 
         enqueue_params.runtime_perf_knobs = runtime_perf_knobs;
+        enqueue_params.kv_scale_per_head = kv_scale_per_head;
+        enqueue_params.host_primary_block_scale_pool_pointer = host_primary_block_scale_pool_pointer;
+        enqueue_params.host_secondary_block_scale_pool_pointer = host_secondary_block_scale_pool_pointer;
         if (isRelativePosition())
         {
             enqueue_params.relative_attention_bias
@@ -1147,6 +1175,12 @@ int GPTAttentionPlugin::enqueueSome(int32_t seqIdxBeg, int32_t localNbSeq, int32
             }
         }
 
+        // Reused blocks onboarded layer by layer must be in device memory before this layer reads them.
+        if (auto const* onboarder = batch_manager::kv_cache_manager::KVCacheLayerwiseOnboarder::getActive())
+        {
+            onboarder->waitForLayer(mLayerIdx, stream);
+        }
+
         enqueueContext<T, KVCacheBuffer>(enqueue_params, stream);
 
         {
@@ -1204,6 +1238,9 @@ int GPTAttentionPlugin::enqueueSome(int32_t seqIdxBeg, int32_t localNbSeq, int32
             mrope_position_deltas};
         enqueue_params.host_context_lengths = host_context_lengths;
         enqueue_params.runtime_perf_knobs = runtime_perf_knobs;
+        enqueue_params.kv_scale_per_head = kv_scale_per_head;
+        enqueue_params.host_primary_block_scale_pool_pointer = host_primary_block_scale_pool_pointer;
+        enqueue_params.host_secondary_block_scale_pool_pointer = host_secondary_block_scale_pool_pointer;
         if (isRelativePosition())
         {
             enqueue_params.relative_attention_bias
@@ -1233,6 +1270,12 @@ int GPTAttentionPlugin::enqueueSome(int32_t seqIdxBeg, int32_t localNbSeq, int32
         {
             enqueue_params.start_token_idx_sf = tokenIdxBeg;
         }
+        // Accumulate the attention mass of the cached tokens for token eviction.
+        if (auto const* evictor = batch_manager::kv_cache_manager::KVCacheTokenEvictor::getActive())
+        {
+            enqueue_params.attention_mass = evictor->getAttentionMass();
+            enqueue_params.attention_mass_rows = evictor->getAttentionMassRows() + seqIdxBeg;
+        }
 
         if (changeSpecDecodingMode)
         {
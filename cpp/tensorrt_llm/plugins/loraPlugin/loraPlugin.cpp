@@ -39,7 +39,7 @@ std::vector<nvinfer1::PluginField> LoraPluginCreator::mPluginAttributes;
 
 LoraPlugin::LoraPlugin(int in_hidden_size, std::vector<int> out_hidden_sizes, int transA, int transB,
     int num_lora_modules, nvinfer1::DataType type, LoraPlugin::PluginProfilerPtr const& pluginProfiler,
-    bool remove_input_padding, int max_low_rank, int weight_index)
+    bool remove_input_padding, int max_low_rank, int weight_index, bool fuse_dora)
     : mTransA(transA)
     , mTransB(transB)
     , mType(type)
@@ -48,6 +48,7 @@ LoraPlugin::LoraPlugin(int in_hidden_size, std::vector<int> out_hidden_sizes, in
     , mInHiddenSize(in_hidden_size)
     , mMaxLowRank(max_low_rank)
     , mWeightIndex(weight_index)
+    , mFuseDora(fuse_dora)
     , mPluginProfiler(pluginProfiler)
 {
     TLLM_LOG_DEBUG("%s", __PRETTY_FUNCTION__);
@@ -78,6 +79,11 @@ LoraPlugin::LoraPlugin(void const* data, size_t length, LoraPlugin::PluginProfil
     init();
 
     mPluginProfiler->deserialize(d, mDims, mGemmId);
+    // Appended, the engines built before the fused DoRA do not have it.
+    if (d != a + length)
+    {
+        read(d, mFuseDora);
+    }
 
     TLLM_CHECK_WITH_INFO(d == a + length,
         "Expected length (%d) != real length (%d). This is often "
@@ -248,8 +254,13 @@ int LoraPlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc, nvinfer1::P
     int numTokens = getNumTokens(inputDesc);
     mExpandLoraWeightPtrs.clear();
     mExpandLoraRanks.clear();
+    mExpandDoraMagnitudePtrs.clear();
     mExpandLoraWeightPtrs.reserve(mNumLoraModules * numTokens * 2);
     mExpandLoraRanks.reserve(mNumLoraModules * numTokens);
+    if (mFuseDora)
+    {
+        mExpandDoraMagnitudePtrs.reserve(mNumLoraModules * numTokens);
+    }
 
     for (int loraModuleIdx = 0; loraModuleIdx < mNumLoraModules; loraModuleIdx++)
     {
@@ -260,26 +271,21 @@ int LoraPlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc, nvinfer1::P
         for (int reqId = 0; reqId < numReqs; reqId++)
         {
             // loraWeightModulePtrs has 3 pointers for each module: A,B, and an optional DoRA magnitude
-            // the current LoRA plugin does not apply DoRA scaling, so the magnitude is ignored
+            // the magnitude is only used by the fused DoRA, else the DoRA plugin applies it
             RequestType const reqType = static_cast<RequestType const>(reqTypes[reqId]);
-            if (reqType == RequestType::kGENERATION)
+            int const reqNumTokens
+                = reqType == RequestType::kGENERATION ? 1 : (mRemoveInputPadding ? hostContextLengths[reqId] : seqLen);
+            for (int tokenId = 0; tokenId < reqNumTokens; tokenId++)
             {
                 mExpandLoraWeightPtrs.push_back(reinterpret_cast<void const*>(loraWeightModulePtrs[reqId * 3]));
                 mExpandLoraWeightPtrs.push_back(reinterpret_cast<void const*>(loraWeightModulePtrs[reqId * 3 + 1]));
                 mExpandLoraRanks.push_back(loraRankModule[reqId]);
-                idx += 1;
-            }
-            else
-            {
-                int contextLen = (mRemoveInputPadding ? hostContextLengths[reqId] : seqLen);
-
-                for (int contextId = 0; contextId < contextLen; contextId++)
+                if (mFuseDora)
                 {
-                    mExpandLoraWeightPtrs.push_back(reinterpret_cast<void const*>(loraWeightModulePtrs[reqId * 3]));
-                    mExpandLoraWeightPtrs.push_back(reinterpret_cast<void const*>(loraWeightModulePtrs[reqId * 3 + 1]));
-                    mExpandLoraRanks.push_back(loraRankModule[reqId]);
-                    idx += 1;
+                    mExpandDoraMagnitudePtrs.push_back(
+                        reinterpret_cast<void const*>(loraWeightModulePtrs[reqId * 3 + 2]));
                 }
+                idx += 1;
             }
         }
 
@@ -295,8 +301,14 @@ int LoraPlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc, nvinfer1::P
     // only used for unified gemm
     auto bestTactic = mPluginProfiler->getBestConfig(numTokens, mGemmId);
     mLoraImpl->setBestTactic(bestTactic);
+    kernels::LoraImpl::DoraEpilogue dora;
+    if (mFuseDora)
+    {
+        dora.residuals = &inputs[getResidualsIdx()];
+        dora.magnitudePtrs = mExpandDoraMagnitudePtrs.data();
+    }
     mLoraImpl->run(numTokens, numReqs, input, mExpandLoraRanks.data(), mExpandLoraWeightPtrs.data(), mWeightIndex,
-        outputs, workspace, stream);
+        outputs, workspace, stream, dora);
 
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
     return 0;
@@ -356,7 +368,8 @@ size_t LoraPlugin::getSerializationSize() const noexcept
     TLLM_LOG_DEBUG("%s", __PRETTY_FUNCTION__);
     return sizeof(mInHiddenSize) + sizeof(mTransA) + sizeof(mTransB) + sizeof(mNumLoraModules) + sizeof(mType)
         + mPluginProfiler->getSerializationSize(mGemmId) + sizeof(mRemoveInputPadding) + sizeof(mMaxLowRank)
-        + sizeof(mWeightIndex) + sizeof(int) * mNumLoraModules; // selected tactics container size
+        + sizeof(mWeightIndex) + sizeof(int) * mNumLoraModules // selected tactics container size
+        + sizeof(mFuseDora);
 }
 
 void LoraPlugin::serialize(void* buffer) const noexcept
@@ -376,6 +389,7 @@ void LoraPlugin::serialize(void* buffer) const noexcept
         write(d, mOutHiddenSizes.at(i));
     }
     mPluginProfiler->serialize(d, mGemmId);
+    write(d, mFuseDora);
     TLLM_CHECK(d == a + getSerializationSize());
 }
 
@@ -393,6 +407,7 @@ LoraPluginCreator::LoraPluginCreator()
     mPluginAttributes.emplace_back(PluginField("num_lora_modules", nullptr, PluginFieldType::kINT32, 1));
     mPluginAttributes.emplace_back(PluginField("type_id", nullptr, PluginFieldType::kINT32, 1));
     mPluginAttributes.emplace_back(PluginField("weight_index", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("fuse_dora", nullptr, PluginFieldType::kINT8, 1));
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
 }
@@ -428,6 +443,7 @@ IPluginV2* LoraPluginCreator::createPlugin(char const* name, PluginFieldCollecti
     bool remove_input_padding{};
     int max_low_rank{};
     int weight_index{};
+    bool fuse_dora{};
     // Read configurations from each fields
     for (int i = 0; i < fc->nbFields; ++i)
     {
@@ -472,6 +488,11 @@ IPluginV2* LoraPluginCreator::createPlugin(char const* name, PluginFieldCollecti
             TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
             weight_index = *(static_cast<int const*>(fields[i].data));
         }
+        else if (!strcmp(attrName, "fuse_dora"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT8);
+            fuse_dora = static_cast<bool>(*(static_cast<int8_t const*>(fields[i].data)));
+        }
     }
     std::vector<int> out_hidden_sizes;
     out_hidden_sizes.resize(num_lora_modules);
@@ -494,7 +515,7 @@ IPluginV2* LoraPluginCreator::createPlugin(char const* name, PluginFieldCollecti
         // FIXME enable tactic profiler
         auto pluginProfiler = gemmPluginProfileManager.createGemmPluginProfiler(/* inference */ false, /* skip */ true);
         auto* obj = new LoraPlugin(in_hidden_size, out_hidden_sizes, transA, transB, num_lora_modules, type,
-            pluginProfiler, remove_input_padding, max_low_rank, weight_index);
+            pluginProfiler, remove_input_padding, max_low_rank, weight_index, fuse_dora);
         obj->setPluginNamespace(mNamespace.c_str());
         return obj;
     }
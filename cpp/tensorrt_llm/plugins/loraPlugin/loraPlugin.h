@@ -38,7 +38,7 @@ public:
 
     LoraPlugin(int in_hidden_size, std::vector<int> out_hidden_sizes, int transA, int transB, int num_lora_modules,
         nvinfer1::DataType type, PluginProfilerPtr const& profiler, bool remove_input_padding, int max_low_rank,
-        int weight_index);
+        int weight_index, bool fuse_dora = false);
 
     LoraPlugin(void const* data, size_t length, PluginProfilerPtr const& profiler);
 
@@ -103,6 +103,13 @@ private:
         return 2 + mNumLoraModules + mNumLoraModules;
     }
 
+    // With the fused DoRA the base outputs of the modules are inputs, the outputs are the DoRA-scaled sums.
+    IndexType getResidualsIdx() const
+    {
+        TLLM_CHECK(mFuseDora);
+        return 2 + mNumLoraModules + mNumLoraModules + (mRemoveInputPadding ? 1 : 0);
+    }
+
     enum class RequestType : int32_t
     {
         kCONTEXT = 0,
@@ -121,8 +128,10 @@ private:
     int mInHiddenSize;
     int mMaxLowRank;
     int mWeightIndex;
+    bool mFuseDora{false};
 
     std::vector<void const*> mExpandLoraWeightPtrs{};
+    std::vector<void const*> mExpandDoraMagnitudePtrs{};
     std::vector<int32_t> mExpandLoraRanks{};
 
     GemmDims mDims{};
@@ -32,7 +32,7 @@ PluginFieldCollection MambaConv1dPluginCreator::mFC{};
 std::vector<nvinfer1::PluginField> MambaConv1dPluginCreator::mPluginAttributes;
 
 MambaConv1dPlugin::MambaConv1dPlugin(int dim, int dconv, int preStride, int postStride, nvinfer1::DataType type,
-    bool removePadding, bool pagedState, bool applySilu)
+    bool removePadding, bool pagedState, bool applySilu, bool chunkedContext, bool specDecoding)
     : mDim(dim)
     , mDConv(dconv)
     , mPreStride(preStride)
@@ -41,9 +41,12 @@ MambaConv1dPlugin::MambaConv1dPlugin(int dim, int dconv, int preStride, int post
     , mRemovePadding(removePadding)
     , mPagedState(pagedState)
     , mApplySilu(applySilu)
+    , mChunkedContext(chunkedContext)
+    , mSpecDecoding(specDecoding)
 {
     TLLM_CHECK_WITH_INFO((mType == DataType::kBF16) || (mType == DataType::kFLOAT) || (mType == DataType::kHALF),
         "Only support float, half, and bfloat16.");
+    TLLM_CHECK_WITH_INFO(mPagedState || !mSpecDecoding, "Speculative decoding needs the paged state");
 }
 
 // Parameterized constructor
@@ -58,6 +61,16 @@ MambaConv1dPlugin::MambaConv1dPlugin(void const* data, size_t length)
     read(d, mRemovePadding);
     read(d, mPagedState);
     read(d, mApplySilu);
+    // Appended, the engines built before chunked context do not have it.
+    if (d != a + length)
+    {
+        read(d, mChunkedContext);
+    }
+    // Appended, the engines built before speculative decoding do not have it.
+    if (d != a + length)
+    {
+        read(d, mSpecDecoding);
+    }
     TLLM_CHECK(d == a + length);
     TLLM_CHECK_WITH_INFO((mType == DataType::kBF16) || (mType == DataType::kFLOAT) || (mType == DataType::kHALF),
         "Only support float, half, and bfloat16.");
@@ -66,8 +79,9 @@ MambaConv1dPlugin::MambaConv1dPlugin(void const* data, size_t length)
 // IPluginV2DynamicExt Methods
 nvinfer1::IPluginV2DynamicExt* MambaConv1dPlugin::clone() const noexcept
 {
-    auto* plugin
-        = new MambaConv1dPlugin(mDim, mDConv, mPreStride, mPostStride, mType, mRemovePadding, mPagedState, mApplySilu);
+    auto* plugin = new MambaConv1dPlugin(
+        mDim, mDConv, mPreStride, mPostStride, mType, mRemovePadding, mPagedState, mApplySilu, mChunkedContext,
+        mSpecDecoding);
     plugin->setPluginNamespace(mNamespace.c_str());
     return plugin;
 }
@@ -91,7 +105,8 @@ bool MambaConv1dPlugin::supportsFormatCombination(
     int pos, nvinfer1::PluginTensorDesc const* inOut, int nbInputs, int nbOutputs) noexcept
 {
     if (pos == getHostRequestTypesIdx() || pos == getLastTokenIdsIdx()
-        || (mRemovePadding && pos == getHostContextLengthIdx()) || (mPagedState && pos == getSlotMappingIdx()))
+        || (mRemovePadding && pos == getHostContextLengthIdx()) || (mPagedState && pos == getSlotMappingIdx())
+        || (mChunkedContext && pos == getHasInitialStateIdx()) || (mSpecDecoding && pos == getSpecDecodingParentsIdx()))
     {
         return inOut[pos].type == nvinfer1::DataType::kINT32;
     }
@@ -113,7 +128,12 @@ void MambaConv1dPlugin::configurePlugin(nvinfer1::DynamicPluginTensorDesc const*
 size_t MambaConv1dPlugin::getWorkspaceSize(nvinfer1::PluginTensorDesc const* inputs, int nbInputs,
     nvinfer1::PluginTensorDesc const* outputs, int nbOutputs) const noexcept
 {
-    return 0;
+    if (!mChunkedContext)
+    {
+        return 0;
+    }
+    int const batchSize = inputs[getHostRequestTypesIdx()].dims.d[0];
+    return getMambaConv1dContextWorkspaceSize(batchSize, mDim, mDConv, getDTypeSize(mType));
 }
 
 void MambaConv1dPlugin::setMambaConv1dParams(tensorrt_llm::kernels::MambaConv1dParamsBase& params, const size_t batch,
@@ -159,6 +179,9 @@ int MambaConv1dPlugin::enqueueImpl(nvinfer1::PluginTensorDesc const* inputDesc,
     //     5.  last_token_ids [batch_size] int32
     //     6.  host_context_lengths [batch_size] int32, optional for remove_input_padding
     //     7.  state_slot_mapping [batch_size] int32, optional
+    //     8.  has_initial_state [batch_size] int32, optional for chunked_context
+    //     9.  spec_decoding_parents [batch_size, num_spec_tokens] int32, optional for spec_decoding
+    //    10.  conv_state_snapshots [batch_size, num_spec_tokens, dconv - 1, dim], optional for spec_decoding
     // outputs
     //     0. output_tensor [batch_size, seq_len, dim] or [num_tokens, dim] for remove_input_padding
     //     1. conv_state [batch_size, dconv - 1, dim]
@@ -174,8 +197,12 @@ int MambaConv1dPlugin::enqueueImpl(nvinfer1::PluginTensorDesc const* inputDesc,
         maxSeqLen = inputDesc[getInputTensorIdx()].dims.d[1];
     }
 
-    // only support context or generation, not for both of them
+    // Without chunked context, a batch holds only context or only generation requests. With it, a batch holding any
+    // context request runs the context kernel, the generation requests being chunks of one token with initial state.
     RequestType const* reqTypes = static_cast<RequestType const*>(inputs[getHostRequestTypesIdx()]);
+    bool const isContext = mChunkedContext
+        ? std::any_of(reqTypes, reqTypes + batchSize, [](RequestType type) { return type == RequestType::kCONTEXT; })
+        : reqTypes[0] == RequestType::kCONTEXT;
 
     MambaConv1dParamsBase mambaConv1dParams;
 
@@ -188,8 +215,21 @@ int MambaConv1dPlugin::enqueueImpl(nvinfer1::PluginTensorDesc const* inputDesc,
     setMambaConv1dParams(mambaConv1dParams, batchSize, mDim, maxSeqLen, mDConv, mPreStride, mPostStride,
         inputs[getInputTensorIdx()], stateInPtr, stateOutPtr, inputs[getWeightIdx()], inputs[getBiasIdx()], outputs[0],
         static_cast<int const*>(inputs[getLastTokenIdsIdx()]), slotMapping, mRemovePadding, mApplySilu);
+    if (mChunkedContext)
+    {
+        mambaConv1dParams.has_initial_state_ptr = static_cast<int const*>(inputs[getHasInitialStateIdx()]);
+        mambaConv1dParams.initial_state_ptr = workspace;
+    }
+    if (mSpecDecoding && !isContext)
+    {
+        // The generation requests carry the real token and the drafts, updateRnnStateDraftTokenLocation copies the
+        // state of the last accepted one to the cache.
+        mambaConv1dParams.num_spec_tokens = inputDesc[getSpecDecodingParentsIdx()].dims.d[1];
+        mambaConv1dParams.spec_parent_ptr = static_cast<int const*>(inputs[getSpecDecodingParentsIdx()]);
+        mambaConv1dParams.state_snapshot_ptr = const_cast<void*>(inputs[getStateSnapshotsIdx()]);
+    }
 
-    if (reqTypes[0] == RequestType::kCONTEXT)
+    if (isContext)
     {
         invokeMambaConv1dContext<T>(mambaConv1dParams, stream);
     }
@@ -260,7 +300,8 @@ void MambaConv1dPlugin::terminate() noexcept {}
 size_t MambaConv1dPlugin::getSerializationSize() const noexcept
 {
     return sizeof(mDim) + sizeof(mDConv) + sizeof(mPreStride) + sizeof(mPostStride) + sizeof(mType)
-        + sizeof(mRemovePadding) + sizeof(mPagedState) + sizeof(mApplySilu);
+        + sizeof(mRemovePadding) + sizeof(mPagedState) + sizeof(mApplySilu) + sizeof(mChunkedContext)
+        + sizeof(mSpecDecoding);
 }
 
 void MambaConv1dPlugin::serialize(void* buffer) const noexcept
@@ -274,6 +315,8 @@ void MambaConv1dPlugin::serialize(void* buffer) const noexcept
     write(d, mRemovePadding);
     write(d, mPagedState);
     write(d, mApplySilu);
+    write(d, mChunkedContext);
+    write(d, mSpecDecoding);
     TLLM_CHECK(d == a + getSerializationSize());
 }
 
@@ -296,6 +339,8 @@ MambaConv1dPluginCreator::MambaConv1dPluginCreator()
     mPluginAttributes.emplace_back(PluginField("remove_input_padding", nullptr, PluginFieldType::kINT8, 0));
     mPluginAttributes.emplace_back(PluginField("paged_state", nullptr, PluginFieldType::kINT8, 0));
     mPluginAttributes.emplace_back(PluginField("apply_silu", nullptr, PluginFieldType::kINT8, 0));
+    mPluginAttributes.emplace_back(PluginField("chunked_context", nullptr, PluginFieldType::kINT8, 0));
+    mPluginAttributes.emplace_back(PluginField("spec_decoding", nullptr, PluginFieldType::kINT8, 0));
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
 }
@@ -325,6 +370,8 @@ IPluginV2* MambaConv1dPluginCreator::createPlugin(char const* name, PluginFieldC
     bool removePadding{};
     bool pagedState{};
     bool applySilu{};
+    bool chunkedContext{};
+    bool specDecoding{};
     nvinfer1::DataType type{};
     // Read configurations from each fields
     for (int i = 0; i < fc->nbFields; ++i)
@@ -370,11 +417,21 @@ IPluginV2* MambaConv1dPluginCreator::createPlugin(char const* name, PluginFieldC
             TLLM_CHECK(fields[i].type == PluginFieldType::kINT8);
             applySilu = static_cast<bool>(*(static_cast<bool const*>(fields[i].data)));
         }
+        else if (!strcmp(attrName, "chunked_context"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT8);
+            chunkedContext = static_cast<bool>(*(static_cast<bool const*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "spec_decoding"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT8);
+            specDecoding = static_cast<bool>(*(static_cast<bool const*>(fields[i].data)));
+        }
     }
     try
     {
-        auto* obj
-            = new MambaConv1dPlugin(dim, dconv, pre_stride, post_stride, type, removePadding, pagedState, applySilu);
+        auto* obj = new MambaConv1dPlugin(dim, dconv, pre_stride, post_stride, type, removePadding, pagedState,
+            applySilu, chunkedContext, specDecoding);
         obj->setPluginNamespace(mNamespace.c_str());
         return obj;
     }
@@ -37,6 +37,12 @@ namespace tensorrt_llm::plugins
 //     5.  last_token_ids [batch_size] int32
 //     6.  host_context_lengths [batch_size] int32, optional for remove_input_padding
 //     7.  state_slot_mapping [batch_size] int32, optional
+//     8.  has_initial_state [batch_size] int32, optional for chunked_context. Nonzero for the context chunks that
+//         continue from the state in the cache, and for the generation requests of mixed batches.
+//     9.  spec_decoding_parents [batch_size, num_spec_tokens] int32, optional for spec_decoding. The position of the
+//         token each token of a generation request continues from, -1 for the state in the cache.
+//    10.  conv_state_snapshots [batch_size, num_spec_tokens, dconv - 1, dim], optional for spec_decoding. The states
+//         after every token of the generation requests, the state in the cache is left as it was.
 // outputs
 //     0. output_tensor [batch_size, seq_len, dim] or [num_tokens, dim] for remove_input_padding
 //     1. conv_state [batch_size, dconv - 1, dim]
@@ -45,7 +51,7 @@ class MambaConv1dPlugin : public BasePlugin
 {
 public:
     MambaConv1dPlugin(int dim, int dconv, int preStride, int postStride, nvinfer1::DataType type, bool removePadding,
-        bool pagedState, bool applySilu);
+        bool pagedState, bool applySilu, bool chunkedContext = false, bool specDecoding = false);
 
     MambaConv1dPlugin(void const* data, size_t length);
 
@@ -131,6 +137,21 @@ private:
         return mRemovePadding ? 7 : 6;
     };
 
+    IndexType getHasInitialStateIdx() const
+    {
+        return mPagedState ? getSlotMappingIdx() + 1 : getSlotMappingIdx();
+    };
+
+    IndexType getSpecDecodingParentsIdx() const
+    {
+        return mChunkedContext ? getHasInitialStateIdx() + 1 : getHasInitialStateIdx();
+    };
+
+    IndexType getStateSnapshotsIdx() const
+    {
+        return getSpecDecodingParentsIdx() + 1;
+    };
+
     void setMambaConv1dParams(tensorrt_llm::kernels::MambaConv1dParamsBase& params,
         // sizes
         const size_t batch, const size_t dim, const size_t maxSeqLen, const size_t dconv, const size_t preStride,
@@ -148,6 +169,8 @@ private:
     bool mRemovePadding = false;
     bool mPagedState = false;
     bool mApplySilu = true;
+    bool mChunkedContext = false;
+    bool mSpecDecoding = false;
 };
 
 class MambaConv1dPluginCreator : public BaseCreator
@@ -19,6 +19,8 @@
 #include "tensorrt_llm/common/dataType.h"
 #include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/common/quantization.h"
+#include "tensorrt_llm/kernels/moeAllToAllKernels.h"
+#include "tensorrt_llm/kernels/moeLoadBalanceKernels.h"
 #include "tensorrt_llm/runtime/iBuffer.h"
 #include "tensorrt_llm/runtime/utils/debugUtils.h"
 #include <numeric>
@@ -46,8 +48,10 @@ MixtureOfExpertsPlugin::MixtureOfExpertsPlugin(bool remove_input_padding, int nu
     bool use_finished, bool use_bias, int tp_size, int tp_rank, int ep_size, int ep_rank,
     MOEExpertScaleNormalizationMode normalization_mode, float sparse_mixer_epsilon, bool force_determinism,
     int side_stream_id, MixtureOfExpertsPluginProfilerPtr gemm_profiler_ptr, bool use_lora,
-    nvinfer1::DataType lora_type, LoraPluginProfilerPtr lora_profiler, int max_low_rank)
-    : mNumExperts(number_of_experts)
+    nvinfer1::DataType lora_type, LoraPluginProfilerPtr lora_profiler, int max_low_rank,
+    std::set<int> all_to_all_group, std::vector<int32_t> expert_placement, int load_balancer_id)
+    : mNumExperts(expert_placement.empty() ? number_of_experts : static_cast<int>(expert_placement.size()))
+    , mNumLogicalExperts(number_of_experts)
     , mK(top_k)
     , mExpertHiddenSize(expert_hidden_size)
     , mExpertInterSize(expert_inter_size)
@@ -68,6 +72,9 @@ MixtureOfExpertsPlugin::MixtureOfExpertsPlugin(bool remove_input_padding, int nu
     , mLoraType(lora_type)
     , mMaxLowRank(max_low_rank)
     , mRemoveInputPadding(remove_input_padding)
+    , mAllToAllGroup(std::move(all_to_all_group))
+    , mExpertPlacement(std::move(expert_placement))
+    , mLoadBalancerId(load_balancer_id)
     , mLoraProfiler(std::move(lora_profiler))
 {
     init();
@@ -76,6 +83,7 @@ MixtureOfExpertsPlugin::MixtureOfExpertsPlugin(bool remove_input_padding, int nu
 tensorrt_llm::plugins::MixtureOfExpertsPlugin::MixtureOfExpertsPlugin(MixtureOfExpertsPlugin const& other)
     : mMOERunner()
     , mNumExperts(other.mNumExperts)
+    , mNumLogicalExperts(other.mNumLogicalExperts)
     , mK(other.mK)
     , mExpertHiddenSize(other.mExpertHiddenSize)
     , mExpertInterSize(other.mExpertInterSize)
@@ -99,6 +107,9 @@ tensorrt_llm::plugins::MixtureOfExpertsPlugin::MixtureOfExpertsPlugin(MixtureOfE
     , mLoraType(other.mLoraType)
     , mMaxLowRank(other.mMaxLowRank)
     , mRemoveInputPadding(other.mRemoveInputPadding)
+    , mAllToAllGroup(other.mAllToAllGroup)
+    , mExpertPlacement(other.mExpertPlacement)
+    , mLoadBalancerId(other.mLoadBalancerId)
     , mLoraImpl1(other.mLoraImpl1)
     , mLoraImpl2(other.mLoraImpl2)
     , mLoraGemmId1(other.mLoraGemmId1)
@@ -117,7 +128,9 @@ size_t MixtureOfExpertsPlugin::getSerializationSize() const noexcept
         + sizeof(QuantMode::BaseType) + sizeof(mUseFinished) + sizeof(mUseBias) + sizeof(mParallelismConfig)
         + sizeof(mNormalizationMode) + sizeof(mSparseMixerEpsilon) + sizeof(mDims) + sizeof(mUseDeterministicKernels)
         + sizeof(mSideStreamId) + mGemmProfiler->getSerializationSize(mGemmId1)
-        + mGemmProfiler->getSerializationSize(mGemmId2) + sizeof(mUseLora) + sizeof(mLoraType) + sizeof(mMaxLowRank);
+        + mGemmProfiler->getSerializationSize(mGemmId2) + sizeof(mUseLora) + sizeof(mLoraType) + sizeof(mMaxLowRank)
+        + sizeof(int32_t) * (1 + mAllToAllGroup.size()) + sizeof(mNumLogicalExperts)
+        + sizeof(int32_t) * (1 + mExpertPlacement.size()) + sizeof(mLoadBalancerId);
 
     if (hasLora())
     {
@@ -158,6 +171,23 @@ MixtureOfExpertsPlugin::MixtureOfExpertsPlugin(void const* data, size_t length,
     read(d, mUseLora);
     read(d, mLoraType);
     read(d, mMaxLowRank);
+    int32_t all_to_all_group_size{};
+    read(d, all_to_all_group_size);
+    for (int32_t i = 0; i < all_to_all_group_size; ++i)
+    {
+        int32_t group_item{};
+        read(d, group_item);
+        mAllToAllGroup.insert(group_item);
+    }
+    read(d, mNumLogicalExperts);
+    int32_t expert_placement_size{};
+    read(d, expert_placement_size);
+    mExpertPlacement.resize(expert_placement_size);
+    for (auto& expert : mExpertPlacement)
+    {
+        read(d, expert);
+    }
+    read(d, mLoadBalancerId);
 
     // Call init before deserialising the profiler to initialize mGemmId
     init();
@@ -203,6 +233,18 @@ void MixtureOfExpertsPlugin::serialize(void* buffer) const noexcept
     write(d, mUseLora);
     write(d, mLoraType);
     write(d, mMaxLowRank);
+    write(d, static_cast<int32_t>(mAllToAllGroup.size()));
+    for (auto const group_item : mAllToAllGroup)
+    {
+        write(d, static_cast<int32_t>(group_item));
+    }
+    write(d, mNumLogicalExperts);
+    write(d, static_cast<int32_t>(mExpertPlacement.size()));
+    for (auto const expert : mExpertPlacement)
+    {
+        write(d, expert);
+    }
+    write(d, mLoadBalancerId);
 
     mGemmProfiler->serialize(d, mGemmId1);
     mGemmProfiler->serialize(d, mGemmId2);
@@ -227,6 +269,27 @@ void MixtureOfExpertsPlugin::init()
 
     TLLM_CHECK_WITH_INFO(!hasLora() || mLoraType == mOutputType, "The LoraType need to keep same with moe OutputType.");
 
+    TLLM_CHECK_WITH_INFO(hasExpertPlacement() || mNumLogicalExperts == mNumExperts,
+        "The %d routed experts do not match the %d experts", mNumLogicalExperts, mNumExperts);
+    TLLM_CHECK_WITH_INFO(!hasExpertPlacement()
+            || (!hasLora() && mNormalizationMode != MOEExpertScaleNormalizationMode::SPARSE_MIXER),
+        "The replicas of the MoE experts do not support LoRA or the sparse mixer normalization");
+
+    if (useAllToAll())
+    {
+        TLLM_CHECK_WITH_INFO(static_cast<int>(mAllToAllGroup.size()) == mParallelismConfig.ep_size,
+            "The all-to-all group of %zu ranks does not match the EP size %d", mAllToAllGroup.size(),
+            mParallelismConfig.ep_size);
+        TLLM_CHECK_WITH_INFO(!hasLora() && !mUseFinished && mType != DataType::kFP4,
+            "The MoE all-to-all does not support LoRA, the finished tensor or FP4 activations");
+        TLLM_CHECK_WITH_INFO(mOutputType == DataType::kHALF || mOutputType == DataType::kBF16
+                || mOutputType == DataType::kFLOAT,
+            "The MoE all-to-all does not support the output type %d", static_cast<int>(mOutputType));
+        auto const input_row_bytes = mExpertHiddenSize * tensorrt_llm::runtime::BufferDataType(mType).getSize();
+        TLLM_CHECK_WITH_INFO(input_row_bytes % 16 == 0 && mNumExperts % 4 == 0,
+            "The MoE all-to-all requires 16B aligned rows of hidden states and routing logits");
+    }
+
     if (mWeightType == nvinfer1::DataType::kINT8 && mQuantMode.hasInt4Weights())
     {
         mWeightType = DataType::kINT4;
@@ -499,19 +562,51 @@ void MixtureOfExpertsPlugin::configurePlugin(nvinfer1::DynamicPluginTensorDesc c
     }
 }
 
+int64_t MixtureOfExpertsPlugin::getAllToAllCapacity() const
+{
+    // Every rank sends each of its tokens at most once to a rank
+    return static_cast<int64_t>(mDims.maxM) * mParallelismConfig.ep_size;
+}
+
 auto MixtureOfExpertsPlugin::setupWorkspace(void* base_ptr, int64_t num_tokens, int num_reqs) const -> WorkspaceInfo
 {
-    size_t moe_workspace_size = mMOERunner->getWorkspaceSize(num_tokens, mExpertHiddenSize, mExpertInterSize,
+    // In the all-to-all mode, the MoE runs on the received tokens
+    int64_t const moe_num_tokens = useAllToAll() ? getAllToAllCapacity() : num_tokens;
+    size_t a2a_counts_size = 0;
+    size_t a2a_send_token_ids_size = 0;
+    size_t a2a_send_rows_size = 0;
+    size_t a2a_send_logits_size = 0;
+    size_t a2a_recv_rows_size = 0;
+    size_t a2a_recv_logits_size = 0;
+    size_t a2a_recv_output_size = 0;
+    if (useAllToAll())
+    {
+        auto const ep_size = mParallelismConfig.ep_size;
+        auto const input_size = tensorrt_llm::runtime::BufferDataType(mType).getSize();
+        auto const output_size = tensorrt_llm::runtime::BufferDataType(mOutputType).getSize();
+        a2a_counts_size = ep_size * sizeof(int32_t);
+        a2a_send_token_ids_size = num_tokens * ep_size * sizeof(int32_t);
+        a2a_send_rows_size = num_tokens * ep_size * mExpertHiddenSize * std::max(input_size, output_size);
+        a2a_send_logits_size = num_tokens * ep_size * mNumExperts * sizeof(float);
+        a2a_recv_rows_size = moe_num_tokens * mExpertHiddenSize * input_size;
+        a2a_recv_logits_size = moe_num_tokens * mNumExperts * sizeof(float);
+        a2a_recv_output_size = moe_num_tokens * mExpertHiddenSize * output_size;
+    }
+
+    size_t moe_workspace_size = mMOERunner->getWorkspaceSize(moe_num_tokens, mExpertHiddenSize, mExpertInterSize,
         mNumExperts, mK, mActivationType, mNormalizationMode, mParallelismConfig, hasLora());
 
     // Output of post-softmax routing probabilities
-    size_t scale_probabilities_size = num_tokens * mNumExperts * sizeof(float);
+    size_t scale_probabilities_size = moe_num_tokens * mNumExperts * sizeof(float);
 
     // Permutation map
-    size_t src_to_dest_map_size = mK * num_tokens * sizeof(int);
+    size_t src_to_dest_map_size = mK * moe_num_tokens * sizeof(int);
 
     // Selected expert map
-    size_t selected_expert_size = mK * num_tokens * sizeof(int);
+    size_t selected_expert_size = mK * moe_num_tokens * sizeof(int);
+
+    // Routing logits of the physical experts
+    size_t physical_routing_logits_size = hasExpertPlacement() ? num_tokens * mNumExperts * sizeof(float) : 0;
 
     size_t lora_workspace_size = 0;
     if (hasLora())
@@ -527,6 +622,16 @@ auto MixtureOfExpertsPlugin::setupWorkspace(void* base_ptr, int64_t num_tokens,
         src_to_dest_map_size,
         selected_expert_size,
         lora_workspace_size,
+        physical_routing_logits_size,
+        a2a_counts_size,
+        a2a_counts_size * mParallelismConfig.ep_size,
+        a2a_send_token_ids_size,
+        a2a_send_token_ids_size,
+        a2a_send_rows_size,
+        a2a_send_logits_size,
+        a2a_recv_rows_size,
+        a2a_recv_logits_size,
+        a2a_recv_output_size,
     };
 
     WorkspaceInfo info{};
@@ -539,6 +644,18 @@ auto MixtureOfExpertsPlugin::setupWorkspace(void* base_ptr, int64_t num_tokens,
         info.src_to_dest_map = nextWorkspacePtr((int8_t*) info.scale_probs, scale_probabilities_size);
         info.selected_experts = nextWorkspacePtr((int8_t*) info.src_to_dest_map, src_to_dest_map_size);
         info.lora_workspace = nextWorkspacePtr((int8_t*) info.selected_experts, selected_expert_size);
+        info.physical_routing_logits = nextWorkspacePtr((int8_t*) info.lora_workspace, lora_workspace_size);
+        info.a2a_send_counts
+            = nextWorkspacePtr((int8_t*) info.physical_routing_logits, physical_routing_logits_size);
+        info.a2a_all_counts = nextWorkspacePtr((int8_t*) info.a2a_send_counts, a2a_counts_size);
+        info.a2a_send_token_ids
+            = nextWorkspacePtr((int8_t*) info.a2a_all_counts, a2a_counts_size * mParallelismConfig.ep_size);
+        info.a2a_token_send_slots = nextWorkspacePtr((int8_t*) info.a2a_send_token_ids, a2a_send_token_ids_size);
+        info.a2a_send_rows = nextWorkspacePtr((int8_t*) info.a2a_token_send_slots, a2a_send_token_ids_size);
+        info.a2a_send_logits = nextWorkspacePtr((int8_t*) info.a2a_send_rows, a2a_send_rows_size);
+        info.a2a_recv_rows = nextWorkspacePtr((int8_t*) info.a2a_send_logits, a2a_send_logits_size);
+        info.a2a_recv_logits = nextWorkspacePtr((int8_t*) info.a2a_recv_rows, a2a_recv_rows_size);
+        info.a2a_recv_output = nextWorkspacePtr((int8_t*) info.a2a_recv_logits, a2a_recv_logits_size);
     }
 
     return info;
@@ -858,6 +975,35 @@ int MixtureOfExpertsPlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc,
         );
     }
 
+    void const* moe_input = inputs[getInputTensorIndex()];
+    auto const* moe_routing_logits = static_cast<float const*>(inputs[getRoutingTensorIndex()]);
+    void* moe_output = outputs[getOutputTensorIndex()];
+    int64_t moe_num_tokens = num_tokens;
+    if (hasExpertPlacement())
+    {
+        setLoadBalancerWeights(inputDesc, inputs);
+        auto const tables = mLoadBalancer->step(stream);
+        MoeExpertPlacementParams placement_params;
+        placement_params.logicalLogits = moe_routing_logits;
+        placement_params.physicalLogits = static_cast<float*>(workspace.physical_routing_logits);
+        placement_params.replicaSlots = tables.replicaSlots;
+        placement_params.replicaOffsets = tables.replicaOffsets;
+        placement_params.expertTokenCounts = tables.expertTokenCounts;
+        placement_params.numTokens = static_cast<int32_t>(num_tokens);
+        placement_params.numLogicalExperts = mNumLogicalExperts;
+        placement_params.numPhysicalExperts = mNumExperts;
+        placement_params.topK = mK;
+        invokeMoeMapLogicalToPhysicalExperts(placement_params, stream);
+        moe_routing_logits = static_cast<float const*>(workspace.physical_routing_logits);
+    }
+    if (useAllToAll())
+    {
+        moe_num_tokens = dispatchAllToAll(workspace, moe_input, moe_routing_logits, num_tokens, stream);
+        moe_input = workspace.a2a_recv_rows;
+        moe_routing_logits = static_cast<float const*>(workspace.a2a_recv_logits);
+        moe_output = workspace.a2a_recv_output;
+    }
+
     LoraParams lora_params{};
 
     if (hasLora())
@@ -874,26 +1020,41 @@ int MixtureOfExpertsPlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc,
     std::optional<tensorrt_llm::cutlass_extensions::CutlassGemmConfig> gemm2;
     if (common::getEnvForceDeterministicMOE())
     {
-        gemm1 = mMOERunner->getTactics()[0];
-        gemm2 = mMOERunner->getTactics()[0];
+        // The same tactics for any number of tokens, so that the results of a token do not depend on the batch: the
+        // best for the largest profiled M, which usually is much faster than the first tactic for all M.
+        auto const fixedM = static_cast<int>(useAllToAll() ? getAllToAllCapacity() : mDims.maxM);
+        gemm1 = mGemmProfiler->getBestConfig(fixedM, mGemmId1);
+        gemm2 = mGemmProfiler->getBestConfig(fixedM, mGemmId2);
+        if (!gemm1.has_value() || !gemm2.has_value())
+        {
+            gemm1 = mMOERunner->getTactics()[0];
+            gemm2 = mMOERunner->getTactics()[0];
+        }
     }
     else
     {
-        gemm1 = mGemmProfiler->getBestConfig(num_tokens, mGemmId1);
-        gemm2 = mGemmProfiler->getBestConfig(num_tokens, mGemmId2);
+        gemm1 = mGemmProfiler->getBestConfig(moe_num_tokens, mGemmId1);
+        gemm2 = mGemmProfiler->getBestConfig(moe_num_tokens, mGemmId2);
+    }
+
+    if (moe_num_tokens > 0)
+    {
+        mMOERunner->setTactic(gemm1, gemm2);
+        mMOERunner->runMoe(moe_input, moe_routing_logits, inputs[getExpertWeights1Index()],
+            hasBias() ? inputs[getExpertBias1Index()] : nullptr, mActivationType, inputs[getExpertWeights2Index()],
+            hasBias() ? inputs[getExpertBias2Index()] : nullptr, quant_params, moe_num_tokens, mExpertHiddenSize,
+            mExpertInterSize, mNumExperts, mK, static_cast<char*>(workspace.workspace),
+            // Outputs
+            moe_output, hasFinishedTensor() ? static_cast<bool const*>(inputs[getFinishedTensorIndex()]) : nullptr,
+            useAllToAll() ? moe_num_tokens : num_not_finished, workspace.scale_probs,
+            static_cast<int*>(workspace.src_to_dest_map), static_cast<int*>(workspace.selected_experts),
+            mSparseMixerEpsilon, mParallelismConfig, mNormalizationMode, hasLora(), lora_params, stream);
     }
 
-    mMOERunner->setTactic(gemm1, gemm2);
-    mMOERunner->runMoe(inputs[getInputTensorIndex()], static_cast<float const*>(inputs[getRoutingTensorIndex()]),
-        inputs[getExpertWeights1Index()], hasBias() ? inputs[getExpertBias1Index()] : nullptr, mActivationType,
-        inputs[getExpertWeights2Index()], hasBias() ? inputs[getExpertBias2Index()] : nullptr, quant_params, num_tokens,
-        mExpertHiddenSize, mExpertInterSize, mNumExperts, mK, static_cast<char*>(workspace.workspace),
-        // Outputs
-        outputs[getOutputTensorIndex()],
-        hasFinishedTensor() ? static_cast<bool const*>(inputs[getFinishedTensorIndex()]) : nullptr, num_not_finished,
-        workspace.scale_probs, static_cast<int*>(workspace.src_to_dest_map),
-        static_cast<int*>(workspace.selected_experts), mSparseMixerEpsilon, mParallelismConfig, mNormalizationMode,
-        hasLora(), lora_params, stream);
+    if (useAllToAll())
+    {
+        combineAllToAll(workspace, num_tokens, outputs[getOutputTensorIndex()], stream);
+    }
 
     if (useSideStream())
     {
@@ -905,6 +1066,182 @@ int MixtureOfExpertsPlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc,
     return 0;
 }
 
+void MixtureOfExpertsPlugin::setLoadBalancerWeights(
+    nvinfer1::PluginTensorDesc const* inputDesc, void const* const* inputs)
+{
+    std::vector<IndexType> indices{getExpertWeights1Index(), getExpertWeights2Index()};
+    if (hasBias())
+    {
+        indices.insert(indices.end(), {getExpertBias1Index(), getExpertBias2Index()});
+    }
+    if (hasExpertIntQuantScales())
+    {
+        indices.insert(indices.end(), {getExpertIntQuantScale1Index(), getExpertIntQuantScale2Index()});
+    }
+    if (hasExpertFp8QuantScales())
+    {
+        indices.insert(indices.end(), {getExpertFP8Dequant1Index(), getExpertFP8Dequant2Index()});
+    }
+    if (hasFP4QuantScales())
+    {
+        indices.insert(indices.end(),
+            {getFP4WeightSF1Index(), getFP4GlobalSF1Index(), getFP4WeightSF2Index(), getFP4GlobalSF2Index()});
+    }
+
+    std::vector<void*> device_weights;
+    std::vector<size_t> bytes_per_expert;
+    for (auto const index : indices)
+    {
+        auto const& dims = inputDesc[index].dims;
+        size_t bits = tensorrt_llm::runtime::BufferDataType(inputDesc[index].type).getSizeInBits();
+        for (int i = 1; i < dims.nbDims; ++i)
+        {
+            bits *= dims.d[i];
+        }
+        // The weights are moved by the balancer only, the MoE reads them
+        device_weights.push_back(const_cast<void*>(inputs[index]));
+        bytes_per_expert.push_back(bits / 8);
+    }
+    mLoadBalancer->setDeviceExpertWeights(device_weights, bytes_per_expert);
+}
+
+int64_t MixtureOfExpertsPlugin::dispatchAllToAll(WorkspaceInfo const& workspace, void const* input,
+    float const* routing_logits, int64_t num_tokens, cudaStream_t stream)
+{
+#if ENABLE_MULTI_DEVICE
+    TLLM_CHECK_WITH_INFO(mAllToAllComm.get() != nullptr, "mAllToAllComm should be initialized before used");
+    auto const ep_size = mParallelismConfig.ep_size;
+    auto const ep_rank = mParallelismConfig.ep_rank;
+    auto* send_counts = static_cast<int32_t*>(workspace.a2a_send_counts);
+    auto* send_token_ids = static_cast<int32_t*>(workspace.a2a_send_token_ids);
+
+    MoeAllToAllPlanParams plan_params;
+    plan_params.routingLogits = routing_logits;
+    plan_params.sendCounts = send_counts;
+    plan_params.sendTokenIds = send_token_ids;
+    plan_params.tokenSendSlots = static_cast<int32_t*>(workspace.a2a_token_send_slots);
+    plan_params.numTokens = static_cast<int32_t>(num_tokens);
+    plan_params.numExperts = mNumExperts;
+    plan_params.topK = mK;
+    plan_params.epSize = ep_size;
+    invokeMoeAllToAllPlan(plan_params, stream);
+
+    // The sizes of the transfers are needed on the host, which makes the all-to-all mode incompatible with CUDA graphs
+    NCCLCHECK(ncclAllGather(send_counts, workspace.a2a_all_counts, ep_size, ncclInt32, *mAllToAllComm, stream));
+    mAllToAllCounts.resize(ep_size * ep_size);
+    TLLM_CUDA_CHECK(cudaMemcpyAsync(mAllToAllCounts.data(), workspace.a2a_all_counts,
+        mAllToAllCounts.size() * sizeof(int32_t), cudaMemcpyDeviceToHost, stream));
+
+    auto const row_bytes = mExpertHiddenSize * tensorrt_llm::runtime::BufferDataType(mType).getSize();
+    auto const logits_row_bytes = static_cast<int64_t>(mNumExperts * sizeof(float));
+    // The rows are gathered while the counts are copied
+    invokeMoeAllToAllGatherRows(input, row_bytes, send_counts, send_token_ids, num_tokens, ep_size,
+        workspace.a2a_send_rows, stream);
+    invokeMoeAllToAllGatherRows(routing_logits, logits_row_bytes, send_counts, send_token_ids, num_tokens, ep_size,
+        workspace.a2a_send_logits, stream);
+    TLLM_CUDA_CHECK(cudaStreamSynchronize(stream));
+
+    int64_t num_received = 0;
+    for (int peer = 0; peer < ep_size; ++peer)
+    {
+        num_received += mAllToAllCounts[peer * ep_size + ep_rank];
+    }
+    TLLM_CHECK_WITH_INFO(num_received <= getAllToAllCapacity(),
+        "The rank received %ld tokens, more than the all-to-all capacity of %ld", num_received, getAllToAllCapacity());
+
+    auto* send_rows = static_cast<int8_t*>(workspace.a2a_send_rows);
+    auto* send_logits = static_cast<float*>(workspace.a2a_send_logits);
+    auto* recv_rows = static_cast<int8_t*>(workspace.a2a_recv_rows);
+    auto* recv_logits = static_cast<float*>(workspace.a2a_recv_logits);
+    int64_t send_offset = 0;
+    int64_t recv_offset = 0;
+    NCCLCHECK(ncclGroupStart());
+    for (int peer = 0; peer < ep_size; ++peer)
+    {
+        auto const num_send = mAllToAllCounts[ep_rank * ep_size + peer];
+        auto const num_recv = mAllToAllCounts[peer * ep_size + ep_rank];
+        if (num_send > 0)
+        {
+            NCCLCHECK(ncclSend(send_rows + send_offset * row_bytes, num_send * row_bytes, ncclInt8, peer,
+                *mAllToAllComm, stream));
+            NCCLCHECK(ncclSend(send_logits + send_offset * mNumExperts, num_send * mNumExperts, ncclFloat32, peer,
+                *mAllToAllComm, stream));
+        }
+        if (num_recv > 0)
+        {
+            NCCLCHECK(ncclRecv(recv_rows + recv_offset * row_bytes, num_recv * row_bytes, ncclInt8, peer,
+                *mAllToAllComm, stream));
+            NCCLCHECK(ncclRecv(recv_logits + recv_offset * mNumExperts, num_recv * mNumExperts, ncclFloat32, peer,
+                *mAllToAllComm, stream));
+        }
+        send_offset += num_send;
+        recv_offset += num_recv;
+    }
+    NCCLCHECK(ncclGroupEnd());
+    return num_received;
+#else
+    TLLM_THROW("The MoE all-to-all requires multi-device support");
+#endif // ENABLE_MULTI_DEVICE
+}
+
+void MixtureOfExpertsPlugin::combineAllToAll(
+    WorkspaceInfo const& workspace, int64_t num_tokens, void* output, cudaStream_t stream)
+{
+#if ENABLE_MULTI_DEVICE
+    auto const ep_size = mParallelismConfig.ep_size;
+    auto const ep_rank = mParallelismConfig.ep_rank;
+    auto const row_bytes = mExpertHiddenSize * tensorrt_llm::runtime::BufferDataType(mOutputType).getSize();
+
+    // The partial outputs come back in the order the rows were sent
+    auto* returned_rows = static_cast<int8_t*>(workspace.a2a_send_rows);
+    auto* recv_output = static_cast<int8_t*>(workspace.a2a_recv_output);
+    int64_t send_offset = 0;
+    int64_t recv_offset = 0;
+    NCCLCHECK(ncclGroupStart());
+    for (int peer = 0; peer < ep_size; ++peer)
+    {
+        auto const num_send = mAllToAllCounts[ep_rank * ep_size + peer];
+        auto const num_recv = mAllToAllCounts[peer * ep_size + ep_rank];
+        if (num_recv > 0)
+        {
+            NCCLCHECK(ncclSend(recv_output + recv_offset * row_bytes, num_recv * row_bytes, ncclInt8, peer,
+                *mAllToAllComm, stream));
+        }
+        if (num_send > 0)
+        {
+            NCCLCHECK(ncclRecv(returned_rows + send_offset * row_bytes, num_send * row_bytes, ncclInt8, peer,
+                *mAllToAllComm, stream));
+        }
+        send_offset += num_send;
+        recv_offset += num_recv;
+    }
+    NCCLCHECK(ncclGroupEnd());
+
+    auto const* send_counts = static_cast<int32_t const*>(workspace.a2a_send_counts);
+    auto const* token_send_slots = static_cast<int32_t const*>(workspace.a2a_token_send_slots);
+    switch (mOutputType)
+    {
+    case DataType::kFLOAT:
+        invokeMoeAllToAllCombine(reinterpret_cast<float const*>(returned_rows), send_counts, token_send_slots,
+            num_tokens, ep_size, mExpertHiddenSize, static_cast<float*>(output), stream);
+        break;
+    case DataType::kHALF:
+        invokeMoeAllToAllCombine(reinterpret_cast<half const*>(returned_rows), send_counts, token_send_slots,
+            num_tokens, ep_size, mExpertHiddenSize, static_cast<half*>(output), stream);
+        break;
+#ifdef ENABLE_BF16
+    case DataType::kBF16:
+        invokeMoeAllToAllCombine(reinterpret_cast<__nv_bfloat16 const*>(returned_rows), send_counts,
+            token_send_slots, num_tokens, ep_size, mExpertHiddenSize, static_cast<__nv_bfloat16*>(output), stream);
+        break;
+#endif
+    default: TLLM_THROW("Unsupported all-to-all output type %d", static_cast<int>(mOutputType));
+    }
+#else
+    TLLM_THROW("The MoE all-to-all requires multi-device support");
+#endif // ENABLE_MULTI_DEVICE
+}
+
 // IPluginV2Ext Methods
 nvinfer1::DataType MixtureOfExpertsPlugin::getOutputDataType(
     int index, nvinfer1::DataType const* inputTypes, int nbInputs) const noexcept
@@ -930,10 +1267,16 @@ char const* MixtureOfExpertsPlugin::getPluginVersion() const noexcept
 
 int MixtureOfExpertsPlugin::initialize() noexcept
 {
+    // In the all-to-all mode, the GEMMs run on the tokens received from all the ranks
+    auto profile_dims = mDims;
+    if (useAllToAll())
+    {
+        profile_dims.maxM = getAllToAllCapacity();
+    }
     mGemmProfiler->setGemmToProfile(kernels::GemmProfilerBackend::GemmToProfile::GEMM_1);
-    mGemmProfiler->profileTactics(this, mType, mDims, mGemmId1);
+    mGemmProfiler->profileTactics(this, mType, profile_dims, mGemmId1);
     mGemmProfiler->setGemmToProfile(kernels::GemmProfilerBackend::GemmToProfile::GEMM_2);
-    mGemmProfiler->profileTactics(this, mType, mDims, mGemmId2);
+    mGemmProfiler->profileTactics(this, mType, profile_dims, mGemmId2);
 
     if (hasLora())
     {
@@ -943,11 +1286,32 @@ int MixtureOfExpertsPlugin::initialize() noexcept
         mLoraProfiler->profileTactics(mLoraImpl1->mCublasWrapper, mType, mDims, mLoraGemmId1);
         mLoraProfiler->profileTactics(mLoraImpl2->mCublasWrapper, mType, mDims, mLoraGemmId2);
     }
+
+#if ENABLE_MULTI_DEVICE
+    if (useAllToAll() && !isBuilding())
+    {
+        mAllToAllComm = getComm(mAllToAllGroup);
+    }
+#endif // ENABLE_MULTI_DEVICE
+
+    if (hasExpertPlacement() && !isBuilding())
+    {
+        mLoadBalancer = MoeLoadBalancer::getOrCreate(mLoadBalancerId, mNumLogicalExperts, mExpertPlacement,
+            mParallelismConfig.ep_size, mParallelismConfig.ep_rank);
+#if ENABLE_MULTI_DEVICE
+        if (useAllToAll())
+        {
+            // Every rank counts the tokens of its own batch
+            mLoadBalancer->setCommunicator(mAllToAllComm);
+        }
+#endif // ENABLE_MULTI_DEVICE
+    }
     return 0;
 }
 
 void MixtureOfExpertsPlugin::terminate() noexcept
 {
+    mLoadBalancer.reset();
     if (mSideStreamPtr)
     {
         auto const resource_name = nvinfer1::pluginInternal::SideStream::getResourceKey(mSideStreamId);
@@ -1025,6 +1389,9 @@ MixtureOfExpertsPluginCreator::MixtureOfExpertsPluginCreator()
     mPluginAttributes.emplace_back(nvinfer1::PluginField("use_lora", nullptr, PluginFieldType::kINT32, 0));
     mPluginAttributes.emplace_back(nvinfer1::PluginField("lora_type_id", nullptr, PluginFieldType::kINT32, 0));
     mPluginAttributes.emplace_back(nvinfer1::PluginField("max_low_rank", nullptr, PluginFieldType::kINT32, 0));
+    mPluginAttributes.emplace_back(nvinfer1::PluginField("all_to_all_group", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(nvinfer1::PluginField("expert_placement", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(nvinfer1::PluginField("load_balancer_id", nullptr, PluginFieldType::kINT32, 1));
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
 }
@@ -1057,6 +1424,9 @@ IPluginV2* MixtureOfExpertsPluginCreator::createPlugin(
     int mMaxLowRank{0};
 
     float mSparseMixerEpsilon = -INFINITY;
+    std::set<int> mAllToAllGroup{};
+    std::vector<int32_t> mExpertPlacement{};
+    int mLoadBalancerId{-1};
 
     // Read configurations from each fields
     struct MapPair
@@ -1092,6 +1462,7 @@ IPluginV2* MixtureOfExpertsPluginCreator::createPlugin(
         MapPair{"side_stream_id", std::ref(mSideStreamId), true},
         MapPair{"lora_type_id", std::ref(mLoraType), true},
         MapPair{"max_low_rank", std::ref(mMaxLowRank), true},
+        MapPair{"load_balancer_id", std::ref(mLoadBalancerId), true},
     };
     for (int i = 0; i < fc->nbFields; ++i)
     {
@@ -1113,6 +1484,21 @@ IPluginV2* MixtureOfExpertsPluginCreator::createPlugin(
             TLLM_CHECK(fields[i].type == nvinfer1::PluginFieldType::kFLOAT32);
             mSparseMixerEpsilon = *static_cast<float const*>(fields[i].data);
         }
+        else if (!strcmp(attrName, "all_to_all_group"))
+        {
+            TLLM_CHECK(fields[i].type == nvinfer1::PluginFieldType::kINT32);
+            auto const* group = static_cast<int const*>(fields[i].data);
+            for (int j = 0; j < fields[i].length; ++j)
+            {
+                mAllToAllGroup.insert(group[j]);
+            }
+        }
+        else if (!strcmp(attrName, "expert_placement"))
+        {
+            TLLM_CHECK(fields[i].type == nvinfer1::PluginFieldType::kINT32);
+            auto const* placement = static_cast<int32_t const*>(fields[i].data);
+            mExpertPlacement.assign(placement, placement + fields[i].length);
+        }
     }
 
     for (auto& item : input_map)
@@ -1151,7 +1537,8 @@ IPluginV2* MixtureOfExpertsPluginCreator::createPlugin(
             QuantMode(mQuantMode), mUseFinished != 0, mUseBias != 0, mTPSize, mTPRank, mEPSize, mEPRank,
             static_cast<MOEExpertScaleNormalizationMode>(mNormalizationMode), mSparseMixerEpsilon,
             mRequiresDeterminism != 0, mSideStreamId, gemmProfiler, mUseLora != 0,
-            static_cast<nvinfer1::DataType>(mLoraType), loraProfiler, mMaxLowRank);
+            static_cast<nvinfer1::DataType>(mLoraType), loraProfiler, mMaxLowRank, mAllToAllGroup,
+            mExpertPlacement, mLoadBalancerId);
         obj->setPluginNamespace(mNamespace.c_str());
         return obj;
     }
@@ -26,6 +26,7 @@
 #include "tensorrt_llm/plugins/common/plugin.h"
 #include "tensorrt_llm/plugins/cudaStreamPlugin/cudaStreamPlugin.h"
 #include "tensorrt_llm/plugins/gemmPlugin/gemmPlugin.h"
+#include "tensorrt_llm/plugins/mixtureOfExperts/moeLoadBalancer.h"
 #include "tensorrt_llm/runtime/cudaStream.h"
 #include <cassert>
 #include <set>
@@ -108,7 +109,8 @@ public:
         bool use_finished, bool use_bias, int tp_size, int tp_rank, int ep_size, int ep_rank,
         MOEExpertScaleNormalizationMode normalization_mode, float sparse_mixer_epsilon, bool force_determinism,
         int side_stream_id, MixtureOfExpertsPluginProfilerPtr gemm_profiler_ptr, bool use_lora,
-        nvinfer1::DataType lora_type, LoraPluginProfilerPtr lora_profiler, int max_low_rank);
+        nvinfer1::DataType lora_type, LoraPluginProfilerPtr lora_profiler, int max_low_rank,
+        std::set<int> all_to_all_group, std::vector<int32_t> expert_placement, int load_balancer_id);
     MixtureOfExpertsPlugin(void const* data, size_t length, MixtureOfExpertsPluginProfilerPtr gemm_profiler_ptr,
         LoraPluginProfilerPtr lora_profiler);
     MixtureOfExpertsPlugin(MixtureOfExpertsPlugin const&);
@@ -154,7 +156,10 @@ public:
 private:
     friend class MixtureOfExpertsGemmProfiler;
     std::unique_ptr<kernels::CutlassMoeFCRunnerInterface> mMOERunner{};
+    // Physical experts, which the MoE runs and the expert weights hold
     int mNumExperts{};
+    // Experts of the routing logits, fewer than the physical experts with replicas of the hot experts
+    int mNumLogicalExperts{};
     int mK{};
     int64_t mExpertHiddenSize{};
     int64_t mExpertInterSize{};
@@ -187,6 +192,20 @@ private:
     int mMaxLowRank{};
     bool mRemoveInputPadding{};
 
+    // Ranks of the expert parallel all-to-all in the order of the EP ranks. When empty, every rank runs the MoE on all
+    // the tokens and drops the tokens of the other ranks.
+    std::set<int> mAllToAllGroup{};
+#if ENABLE_MULTI_DEVICE
+    std::shared_ptr<ncclComm_t> mAllToAllComm;
+#endif // ENABLE_MULTI_DEVICE
+    // Tokens sent by every rank to every rank [epSize, epSize], copied to the host by the dispatch.
+    std::vector<int32_t> mAllToAllCounts{};
+
+    // Logical expert of every physical expert, empty without replicas. See moeLoadBalancer.h.
+    std::vector<int32_t> mExpertPlacement{};
+    int mLoadBalancerId{-1};
+    std::shared_ptr<MoeLoadBalancer> mLoadBalancer;
+
     LoraImplPtr mLoraImpl1;
     LoraImplPtr mLoraImpl2;
 
@@ -216,12 +235,37 @@ private:
         void* src_to_dest_map{};
         void* selected_experts{};
         void* lora_workspace{};
+        // Routing logits of the physical experts
+        void* physical_routing_logits{};
+
+        // All-to-all buffers, see moeAllToAllKernels.h
+        void* a2a_send_counts{};
+        void* a2a_all_counts{};
+        void* a2a_send_token_ids{};
+        void* a2a_token_send_slots{};
+        // Rows sent by the dispatch, reused for the partial outputs returned by the combine
+        void* a2a_send_rows{};
+        void* a2a_send_logits{};
+        void* a2a_recv_rows{};
+        void* a2a_recv_logits{};
+        void* a2a_recv_output{};
         size_t size{};
     };
 
     int64_t getNumTokens(nvinfer1::PluginTensorDesc const* input_tensor) const;
     WorkspaceInfo setupWorkspace(void* base_ptr, int64_t num_tokens, int num_reqs = 0) const;
 
+    // Tokens received by a rank at most, the MoE runs on them in the all-to-all mode.
+    int64_t getAllToAllCapacity() const;
+    // Sends the tokens to the ranks of their experts and returns the number of tokens received.
+    int64_t dispatchAllToAll(WorkspaceInfo const& workspace, void const* input, float const* routing_logits,
+        int64_t num_tokens, cudaStream_t stream);
+    // Returns the partial outputs of the received tokens and sums those of the local tokens into output.
+    void combineAllToAll(WorkspaceInfo const& workspace, int64_t num_tokens, void* output, cudaStream_t stream);
+    // Gives the load balancer the slots of this rank of the expert weights and per expert scales, which it moves
+    // together.
+    void setLoadBalancerWeights(nvinfer1::PluginTensorDesc const* inputDesc, void const* const* inputs);
+
     kernels::MOEParallelismConfig getParallelismConfig() const;
     kernels::QuantParams getQuantParams(nvinfer1::PluginTensorDesc const* inputDesc, void const* const* inputs,
         int scale_1_idx = -1, int scale_2_idx = -1, int scale_3_idx = -1, int scale_4_idx = -1, int scale_5_idx = -1,
@@ -301,6 +345,16 @@ private:
         return mUseLora;
     }
 
+    bool hasExpertPlacement() const
+    {
+        return !mExpertPlacement.empty();
+    }
+
+    bool useAllToAll() const
+    {
+        return !mAllToAllGroup.empty();
+    }
+
     bool hasGatedLoraWeightsAndRanks() const
     {
         return mUseLora && isGatedActivation(mActivationType);
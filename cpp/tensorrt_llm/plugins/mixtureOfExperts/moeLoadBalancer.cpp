@@ -0,0 +1,388 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tensorrt_llm/plugins/mixtureOfExperts/moeLoadBalancer.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <utility>
+
+namespace tensorrt_llm::plugins
+{
+
+namespace
+{
+
+std::mutex gBalancersMutex;
+std::map<int, std::weak_ptr<MoeLoadBalancer>> gBalancers;
+
+} // namespace
+
+MoeLoadBalancer::MoeLoadBalancer(int numLogicalExperts, std::vector<int32_t> slotExperts, int epSize, int epRank)
+    : mNumLogicalExperts(numLogicalExperts)
+    , mNumPhysicalExperts(static_cast<int>(slotExperts.size()))
+    , mEpSize(epSize)
+    , mEpRank(epRank)
+    , mSlotExperts(std::move(slotExperts))
+    , mUpdateInterval(tensorrt_llm::common::getEnvMoeLoadBalanceInterval())
+{
+    TLLM_CHECK_WITH_INFO(mNumLogicalExperts % mEpSize == 0 && mNumPhysicalExperts % mEpSize == 0
+            && mNumPhysicalExperts >= mNumLogicalExperts,
+        "The %d experts and %d slots must be evenly distributed over the %d ranks", mNumLogicalExperts,
+        mNumPhysicalExperts, mEpSize);
+    auto const slotsPerRank = mNumPhysicalExperts / mEpSize;
+    auto const homesPerRank = mNumLogicalExperts / mEpSize;
+    for (int slot = 0; slot < mNumPhysicalExperts; ++slot)
+    {
+        auto const rank = slot / slotsPerRank;
+        auto const rankSlot = slot % slotsPerRank;
+        auto const expert = mSlotExperts[slot];
+        TLLM_CHECK_WITH_INFO(0 <= expert && expert < mNumLogicalExperts, "Slot %d holds the invalid expert %d", slot,
+            expert);
+        TLLM_CHECK_WITH_INFO(rankSlot >= homesPerRank || expert == rank * homesPerRank + rankSlot,
+            "Slot %d must hold the expert %d of rank %d", slot, rank * homesPerRank + rankSlot, rank);
+    }
+
+    auto const tablesSize = (mNumLogicalExperts + 1 + mNumPhysicalExperts) * sizeof(int32_t);
+    TLLM_CUDA_CHECK(cudaMalloc(&mDeviceTables, tablesSize));
+    TLLM_CUDA_CHECK(cudaMallocHost(&mHostTables, tablesSize));
+    TLLM_CUDA_CHECK(cudaMalloc(&mDeviceTokenCounts, mNumLogicalExperts * sizeof(int32_t)));
+    TLLM_CUDA_CHECK(cudaMallocHost(&mHostTokenCounts, mNumLogicalExperts * sizeof(int32_t)));
+    TLLM_CUDA_CHECK(cudaMemset(mDeviceTokenCounts, 0, mNumLogicalExperts * sizeof(int32_t)));
+    TLLM_CUDA_CHECK(cudaEventCreateWithFlags(&mTablesEvent, cudaEventDisableTiming));
+    TLLM_CUDA_CHECK(cudaEventCreateWithFlags(&mCountsEvent, cudaEventDisableTiming));
+    TLLM_CUDA_CHECK(cudaEventCreateWithFlags(&mCopyEvent, cudaEventDisableTiming));
+    TLLM_CUDA_CHECK(cudaStreamCreateWithFlags(&mCopyStream, cudaStreamNonBlocking));
+
+    buildTables(mSlotExperts, std::vector<bool>(mNumPhysicalExperts, true), mNumLogicalExperts, mHostTables,
+        mHostTables + mNumLogicalExperts + 1);
+    TLLM_CUDA_CHECK(cudaMemcpy(mDeviceTables, mHostTables, tablesSize, cudaMemcpyHostToDevice));
+}
+
+MoeLoadBalancer::~MoeLoadBalancer()
+{
+    TLLM_CUDA_CHECK_FREE_RESOURCE(cudaStreamSynchronize(mCopyStream));
+    TLLM_CUDA_CHECK_FREE_RESOURCE(cudaStreamDestroy(mCopyStream));
+    TLLM_CUDA_CHECK_FREE_RESOURCE(cudaEventSynchronize(mTablesEvent));
+    TLLM_CUDA_CHECK_FREE_RESOURCE(cudaEventSynchronize(mCountsEvent));
+    TLLM_CUDA_CHECK_FREE_RESOURCE(cudaEventDestroy(mTablesEvent));
+    TLLM_CUDA_CHECK_FREE_RESOURCE(cudaEventDestroy(mCountsEvent));
+    TLLM_CUDA_CHECK_FREE_RESOURCE(cudaEventDestroy(mCopyEvent));
+    TLLM_CUDA_CHECK_FREE_RESOURCE(cudaFree(mDeviceTables));
+    TLLM_CUDA_CHECK_FREE_RESOURCE(cudaFreeHost(mHostTables));
+    TLLM_CUDA_CHECK_FREE_RESOURCE(cudaFree(mDeviceTokenCounts));
+    TLLM_CUDA_CHECK_FREE_RESOURCE(cudaFreeHost(mHostTokenCounts));
+}
+
+std::shared_ptr<MoeLoadBalancer> MoeLoadBalancer::getOrCreate(
+    int id, int numLogicalExperts, std::vector<int32_t> const& slotExperts, int epSize, int epRank)
+{
+    if (id < 0)
+    {
+        return std::make_shared<MoeLoadBalancer>(numLogicalExperts, slotExperts, epSize, epRank);
+    }
+    std::lock_guard<std::mutex> lock(gBalancersMutex);
+    if (auto balancer = gBalancers[id].lock())
+    {
+        TLLM_CHECK_WITH_INFO(balancer->mNumLogicalExperts == numLogicalExperts
+                && balancer->mNumPhysicalExperts == static_cast<int>(slotExperts.size()),
+            "The MoE load balancer %d is shared by layers of different shapes", id);
+        return balancer;
+    }
+    auto balancer = std::make_shared<MoeLoadBalancer>(numLogicalExperts, slotExperts, epSize, epRank);
+    gBalancers[id] = balancer;
+    return balancer;
+}
+
+std::shared_ptr<MoeLoadBalancer> MoeLoadBalancer::get(int id)
+{
+    std::lock_guard<std::mutex> lock(gBalancersMutex);
+    auto const it = gBalancers.find(id);
+    return it == gBalancers.end() ? nullptr : it->second.lock();
+}
+
+void MoeLoadBalancer::setUpdateInterval(int updateInterval)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mUpdateInterval = std::max(updateInterval, 0);
+}
+
+void MoeLoadBalancer::setHostExpertWeights(std::vector<void const*> hostWeights)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    TLLM_CHECK_WITH_INFO(mPhase == Phase::kIDLE, "The host weights cannot change during a re-placement");
+    mHostWeights = std::move(hostWeights);
+}
+
+void MoeLoadBalancer::setDeviceExpertWeights(
+    std::vector<void*> const& deviceWeights, std::vector<size_t> const& bytesPerExpert)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    TLLM_CHECK(deviceWeights.size() == bytesPerExpert.size());
+    mDeviceWeights = deviceWeights;
+    mBytesPerExpert = bytesPerExpert;
+}
+
+#if ENABLE_MULTI_DEVICE
+void MoeLoadBalancer::setCommunicator(std::shared_ptr<ncclComm_t> comm)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mComm = std::move(comm);
+}
+#endif // ENABLE_MULTI_DEVICE
+
+auto MoeLoadBalancer::step(cudaStream_t stream) -> Tables
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    bool const balancing = mUpdateInterval > 0 && !mHostWeights.empty();
+    Tables tables{mDeviceTables, mDeviceTables + mNumLogicalExperts + 1, balancing ? mDeviceTokenCounts : nullptr};
+    if (!balancing)
+    {
+        return tables;
+    }
+    TLLM_CHECK_WITH_INFO(mHostWeights.size() == mDeviceWeights.size(),
+        "%zu host expert weights were given for %zu device expert weights", mHostWeights.size(),
+        mDeviceWeights.size());
+
+    ++mPhaseSteps;
+    switch (mPhase)
+    {
+    case Phase::kIDLE:
+        if (mPhaseSteps >= mUpdateInterval)
+        {
+            // The counts of the previous steps, before the routing of this one adds to them
+            auto const countsSize = mNumLogicalExperts * sizeof(int32_t);
+#if ENABLE_MULTI_DEVICE
+            if (mComm)
+            {
+                NCCLCHECK(ncclAllReduce(
+                    mDeviceTokenCounts, mDeviceTokenCounts, mNumLogicalExperts, ncclInt32, ncclSum, *mComm, stream));
+            }
+#endif // ENABLE_MULTI_DEVICE
+            TLLM_CUDA_CHECK(
+                cudaMemcpyAsync(mHostTokenCounts, mDeviceTokenCounts, countsSize, cudaMemcpyDeviceToHost, stream));
+            TLLM_CUDA_CHECK(cudaMemsetAsync(mDeviceTokenCounts, 0, countsSize, stream));
+            TLLM_CUDA_CHECK(cudaEventRecord(mCountsEvent, stream));
+            mPhase = Phase::kCOUNTING;
+            mPhaseSteps = 0;
+        }
+        break;
+    case Phase::kCOUNTING:
+    {
+        // Usually complete, as the counts were copied before the previous step
+        TLLM_CUDA_CHECK(cudaEventSynchronize(mCountsEvent));
+        std::vector<int64_t> const tokenCounts(mHostTokenCounts, mHostTokenCounts + mNumLogicalExperts);
+        mNextSlotExperts = computeSlotExperts(mSlotExperts, tokenCounts, mNumLogicalExperts, mEpSize);
+        mPhaseSteps = 0;
+        if (mNextSlotExperts == mSlotExperts)
+        {
+            mPhase = Phase::kIDLE;
+            break;
+        }
+        std::vector<bool> activeSlots(mNumPhysicalExperts);
+        for (int slot = 0; slot < mNumPhysicalExperts; ++slot)
+        {
+            activeSlots[slot] = mNextSlotExperts[slot] == mSlotExperts[slot];
+        }
+        // Stop routing to the moved slots before their weights are overwritten
+        uploadTables(activeSlots, stream);
+        startCopies(mNextSlotExperts, stream);
+        mPhase = Phase::kCOPYING;
+        break;
+    }
+    case Phase::kCOPYING:
+        if (mPhaseSteps >= kCopySteps)
+        {
+            TLLM_CUDA_CHECK(cudaEventSynchronize(mCopyEvent));
+            mSlotExperts = mNextSlotExperts;
+            uploadTables(std::vector<bool>(mNumPhysicalExperts, true), stream);
+            TLLM_LOG_DEBUG("Re-placed the replicas of the MoE experts");
+            mPhase = Phase::kIDLE;
+            mPhaseSteps = 0;
+        }
+        break;
+    }
+    return tables;
+}
+
+void MoeLoadBalancer::uploadTables(std::vector<bool> const& activeSlots, cudaStream_t stream)
+{
+    // The staging buffer is reused once its previous upload is complete
+    TLLM_CUDA_CHECK(cudaEventSynchronize(mTablesEvent));
+    buildTables(mSlotExperts, activeSlots, mNumLogicalExperts, mHostTables, mHostTables + mNumLogicalExperts + 1);
+    TLLM_CUDA_CHECK(cudaMemcpyAsync(mDeviceTables, mHostTables,
+        (mNumLogicalExperts + 1 + mNumPhysicalExperts) * sizeof(int32_t), cudaMemcpyHostToDevice, stream));
+    TLLM_CUDA_CHECK(cudaEventRecord(mTablesEvent, stream));
+}
+
+void MoeLoadBalancer::startCopies(std::vector<int32_t> const& nextSlotExperts, cudaStream_t stream)
+{
+    // The previous steps, which may read the moved slots, are complete once the tables are uploaded
+    TLLM_CUDA_CHECK(cudaStreamWaitEvent(mCopyStream, mTablesEvent));
+    auto const slotsPerRank = mNumPhysicalExperts / mEpSize;
+    for (int rankSlot = 0; rankSlot < slotsPerRank; ++rankSlot)
+    {
+        auto const slot = mEpRank * slotsPerRank + rankSlot;
+        auto const expert = nextSlotExperts[slot];
+        if (expert == mSlotExperts[slot])
+        {
+            continue;
+        }
+        for (size_t ii = 0; ii < mDeviceWeights.size(); ++ii)
+        {
+            auto const bytes = mBytesPerExpert[ii];
+            TLLM_CUDA_CHECK(cudaMemcpyAsync(static_cast<int8_t*>(mDeviceWeights[ii]) + rankSlot * bytes,
+                static_cast<int8_t const*>(mHostWeights[ii]) + expert * bytes, bytes, cudaMemcpyHostToDevice,
+                mCopyStream));
+        }
+    }
+    TLLM_CUDA_CHECK(cudaEventRecord(mCopyEvent, mCopyStream));
+}
+
+std::vector<int32_t> MoeLoadBalancer::computeSlotExperts(std::vector<int32_t> const& slotExperts,
+    std::vector<int64_t> const& tokenCounts, int numLogicalExperts, int epSize)
+{
+    auto const numPhysicalExperts = static_cast<int>(slotExperts.size());
+    auto const slotsPerRank = numPhysicalExperts / epSize;
+    auto const homesPerRank = numLogicalExperts / epSize;
+
+    // Give the replicas to the experts with the most tokens per replica
+    std::vector<int> numReplicas(numLogicalExperts, 1);
+    auto const getShare = [&](int expert)
+    { return static_cast<double>(tokenCounts[expert]) / static_cast<double>(numReplicas[expert]); };
+    std::priority_queue<std::pair<double, int>> queue;
+    for (int expert = 0; expert < numLogicalExperts; ++expert)
+    {
+        queue.emplace(getShare(expert), expert);
+    }
+    for (int ii = numLogicalExperts; ii < numPhysicalExperts; ++ii)
+    {
+        auto const expert = queue.top().second;
+        queue.pop();
+        ++numReplicas[expert];
+        queue.emplace(getShare(expert), expert);
+    }
+
+    std::vector<int> numExtraReplicas(numLogicalExperts);
+    std::transform(numReplicas.begin(), numReplicas.end(), numExtraReplicas.begin(), [](int n) { return n - 1; });
+    std::vector<double> rankLoads(epSize, 0.);
+    std::vector<std::vector<bool>> rankHostsExpert(epSize, std::vector<bool>(numLogicalExperts, false));
+    std::vector<int32_t> nextSlotExperts(slotExperts);
+    std::vector<bool> freeSlots(numPhysicalExperts, false);
+    for (int slot = 0; slot < numPhysicalExperts; ++slot)
+    {
+        auto const rank = slot / slotsPerRank;
+        auto const expert = slotExperts[slot];
+        if (slot % slotsPerRank < homesPerRank)
+        {
+            rankLoads[rank] += getShare(expert);
+            rankHostsExpert[rank][expert] = true;
+        }
+    }
+    // Keep the replicas that are still needed in their slot
+    for (int slot = 0; slot < numPhysicalExperts; ++slot)
+    {
+        auto const rank = slot / slotsPerRank;
+        auto const expert = slotExperts[slot];
+        if (slot % slotsPerRank < homesPerRank)
+        {
+            continue;
+        }
+        if (numExtraReplicas[expert] > 0 && !rankHostsExpert[rank][expert])
+        {
+            --numExtraReplicas[expert];
+            rankLoads[rank] += getShare(expert);
+            rankHostsExpert[rank][expert] = true;
+        }
+        else
+        {
+            freeSlots[slot] = true;
+        }
+    }
+
+    // Place the other replicas, the most loaded first, on the least loaded ranks that do not hold the expert yet
+    std::vector<std::pair<double, int>> replicas;
+    for (int expert = 0; expert < numLogicalExperts; ++expert)
+    {
+        for (int ii = 0; ii < numExtraReplicas[expert]; ++ii)
+        {
+            replicas.emplace_back(getShare(expert), expert);
+        }
+    }
+    std::stable_sort(replicas.begin(), replicas.end(), [](auto const& a, auto const& b) { return a.first > b.first; });
+    for (auto const& [share, expert] : replicas)
+    {
+        int bestSlot = -1;
+        for (int slot = 0; slot < numPhysicalExperts; ++slot)
+        {
+            if (!freeSlots[slot])
+            {
+                continue;
+            }
+            auto const rank = slot / slotsPerRank;
+            if (bestSlot < 0)
+            {
+                bestSlot = slot;
+                continue;
+            }
+            auto const bestRank = bestSlot / slotsPerRank;
+            auto const key = std::make_pair(rankHostsExpert[rank][expert], rankLoads[rank]);
+            auto const bestKey = std::make_pair(rankHostsExpert[bestRank][expert], rankLoads[bestRank]);
+            if (key < bestKey)
+            {
+                bestSlot = slot;
+            }
+        }
+        TLLM_CHECK(bestSlot >= 0);
+        auto const rank = bestSlot / slotsPerRank;
+        nextSlotExperts[bestSlot] = expert;
+        freeSlots[bestSlot] = false;
+        rankLoads[rank] += share;
+        rankHostsExpert[rank][expert] = true;
+    }
+    return nextSlotExperts;
+}
+
+void MoeLoadBalancer::buildTables(std::vector<int32_t> const& slotExperts, std::vector<bool> const& activeSlots,
+    int numLogicalExperts, int32_t* replicaOffsets, int32_t* replicaSlots)
+{
+    std::fill_n(replicaOffsets, numLogicalExperts + 1, 0);
+    for (size_t slot = 0; slot < slotExperts.size(); ++slot)
+    {
+        if (activeSlots[slot])
+        {
+            ++replicaOffsets[slotExperts[slot] + 1];
+        }
+    }
+    for (int expert = 0; expert < numLogicalExperts; ++expert)
+    {
+        replicaOffsets[expert + 1] += replicaOffsets[expert];
+    }
+    std::vector<int32_t> next(replicaOffsets, replicaOffsets + numLogicalExperts);
+    for (size_t slot = 0; slot < slotExperts.size(); ++slot)
+    {
+        if (activeSlots[slot])
+        {
+            replicaSlots[next[slotExperts[slot]]++] = static_cast<int32_t>(slot);
+        }
+    }
+}
+
+} // namespace tensorrt_llm::plugins
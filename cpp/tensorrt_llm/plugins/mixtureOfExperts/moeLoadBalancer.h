@@ -0,0 +1,146 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2024 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/common/opUtils.h"
+
+#include <cstdint>
+#include <cuda_runtime.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tensorrt_llm::plugins
+{
+
+// Placement of the logical experts of a MoE layer on its physical experts, which are the slots of the expert weights of
+// the EP ranks. Rank r holds the slots [r * slotsPerRank, (r + 1) * slotsPerRank). The first numLogicalExperts / epSize
+// slots of a rank hold its own experts, as without replicas, and never move. The other slots hold replicas of the hot
+// experts, which the balancer re-places every updateInterval steps from the tokens routed to the experts. The weights
+// of the re-placed slots are copied from a host copy of all the experts on a side stream, while the MoE does not route
+// to them.
+//
+// Every rank of the layer takes the same decisions at the same steps, from the same token counts, so that the ranks
+// always agree on the placement.
+class MoeLoadBalancer
+{
+public:
+    // Device tables of the current placement, see MoeExpertPlacementParams.
+    struct Tables
+    {
+        int32_t const* replicaOffsets{nullptr};
+        int32_t const* replicaSlots{nullptr};
+        // Null when the token counts are not collected.
+        int32_t* expertTokenCounts{nullptr};
+    };
+
+    MoeLoadBalancer(int numLogicalExperts, std::vector<int32_t> slotExperts, int epSize, int epRank);
+    ~MoeLoadBalancer();
+
+    MoeLoadBalancer(MoeLoadBalancer const&) = delete;
+    MoeLoadBalancer& operator=(MoeLoadBalancer const&) = delete;
+
+    // The balancer shared by the instances of the plugin of a layer, which the runtime retrieves by its ID to provide
+    // the host weights. An ID < 0 returns a new balancer.
+    static std::shared_ptr<MoeLoadBalancer> getOrCreate(
+        int id, int numLogicalExperts, std::vector<int32_t> const& slotExperts, int epSize, int epRank);
+    // Null when no plugin of the layer is initialized.
+    static std::shared_ptr<MoeLoadBalancer> get(int id);
+
+    // Steps between two re-placements, 0 to keep the placement. Takes TRTLLM_MOE_LOAD_BALANCE_INTERVAL by default.
+    void setUpdateInterval(int updateInterval);
+
+    // Host copies of the weights of all the logical experts, [numLogicalExperts, bytes of an expert] for every tensor
+    // given to setDeviceExpertWeights, in the same order. Should be pinned for the copies to be asynchronous.
+    void setHostExpertWeights(std::vector<void const*> hostWeights);
+
+    // Slots of this rank of every expert weight tensor, [slotsPerRank, bytesPerExpert].
+    void setDeviceExpertWeights(std::vector<void*> const& deviceWeights, std::vector<size_t> const& bytesPerExpert);
+
+#if ENABLE_MULTI_DEVICE
+    // Sums the token counts of the EP ranks, when they route different tokens.
+    void setCommunicator(std::shared_ptr<ncclComm_t> comm);
+#endif // ENABLE_MULTI_DEVICE
+
+    // Advances the balancer by a step of the MoE on the stream and returns the tables the step routes with.
+    Tables step(cudaStream_t stream);
+
+    [[nodiscard]] std::vector<int32_t> const& getSlotExperts() const
+    {
+        return mSlotExperts;
+    }
+
+    // Re-places the replicas from the tokens routed to every logical expert. Every replica of an expert is given the
+    // same share of its tokens, the replicas go to the hottest experts by share and then to the ranks with the fewest
+    // tokens. The replicas that stay on their rank keep their slot, so that only the moved replicas are copied.
+    [[nodiscard]] static std::vector<int32_t> computeSlotExperts(std::vector<int32_t> const& slotExperts,
+        std::vector<int64_t> const& tokenCounts, int numLogicalExperts, int epSize);
+
+    // Tables of a placement: the replicas of logical expert e are replicaSlots[replicaOffsets[e]:replicaOffsets[e+1]].
+    // Slots whose active flag is false are left out.
+    static void buildTables(std::vector<int32_t> const& slotExperts, std::vector<bool> const& activeSlots,
+        int numLogicalExperts, int32_t* replicaOffsets, int32_t* replicaSlots);
+
+private:
+    enum class Phase
+    {
+        // Collecting the token counts
+        kIDLE,
+        // The token counts are copied to the host
+        kCOUNTING,
+        // The moved slots are copied while the MoE does not route to them
+        kCOPYING
+    };
+
+    // Steps the weights of the moved slots are given to copy before the MoE routes to them again
+    static int constexpr kCopySteps = 4;
+
+    void uploadTables(std::vector<bool> const& activeSlots, cudaStream_t stream);
+    void startCopies(std::vector<int32_t> const& nextSlotExperts, cudaStream_t stream);
+
+    int const mNumLogicalExperts;
+    int const mNumPhysicalExperts;
+    int const mEpSize;
+    int const mEpRank;
+    std::vector<int32_t> mSlotExperts;
+    std::vector<int32_t> mNextSlotExperts;
+
+    int mUpdateInterval{0};
+    Phase mPhase{Phase::kIDLE};
+    int mPhaseSteps{0};
+
+    std::vector<void const*> mHostWeights;
+    std::vector<void*> mDeviceWeights;
+    std::vector<size_t> mBytesPerExpert;
+#if ENABLE_MULTI_DEVICE
+    std::shared_ptr<ncclComm_t> mComm;
+#endif // ENABLE_MULTI_DEVICE
+
+    // [numLogicalExperts + 1 + numPhysicalExperts] tables on the device, staged in pinned memory
+    int32_t* mDeviceTables{nullptr};
+    int32_t* mHostTables{nullptr};
+    int32_t* mDeviceTokenCounts{nullptr};
+    int32_t* mHostTokenCounts{nullptr};
+    cudaEvent_t mTablesEvent{};
+    cudaEvent_t mCountsEvent{};
+    cudaEvent_t mCopyEvent{};
+    cudaStream_t mCopyStream{};
+
+    std::mutex mMutex;
+};
+
+} // namespace tensorrt_llm::plugins
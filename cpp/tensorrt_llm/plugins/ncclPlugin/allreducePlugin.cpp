@@ -23,6 +23,7 @@
 #include "tensorrt_llm/common/mpiUtils.h"
 #include "tensorrt_llm/kernels/customAllReduceKernels.h"
 #include "tensorrt_llm/kernels/quantization.h"
+#include "tensorrt_llm/kernels/residualRmsNormQuantKernels.h"
 #include "tensorrt_llm/kernels/userbuffers/ub_interface.h"
 #include <nccl.h>
 #include <unordered_set>
@@ -33,6 +34,17 @@ using tensorrt_llm::plugins::AllreducePlugin;
 using tensorrt_llm::kernels::AllReduceFusionOp;
 using tensorrt_llm::kernels::AllReduceStrategyType;
 using tensorrt_llm::kernels::AllReduceStrategyConfig;
+using tensorrt_llm::utils::customAllReduceUtils::AllReduceStrategyProfile;
+using tensorrt_llm::utils::customAllReduceUtils::AllReduceTopology;
+
+namespace
+{
+bool isQuantFusionOp(AllReduceFusionOp op)
+{
+    return op == AllReduceFusionOp::RESIDUAL_RMS_NORM_QUANT_FP8
+        || op == AllReduceFusionOp::RESIDUAL_RMS_NORM_QUANT_NVFP4;
+}
+} // namespace
 
 static char const* ALLREDUCE_PLUGIN_VERSION{"1"};
 static char const* ALLREDUCE_PLUGIN_NAME{"AllReduce"};
@@ -101,7 +113,7 @@ nvinfer1::IPluginV2DynamicExt* AllreducePlugin::clone() const noexcept
 nvinfer1::DimsExprs AllreducePlugin::getOutputDimensions(
     int outputIndex, nvinfer1::DimsExprs const* inputs, int nbInputs, nvinfer1::IExprBuilder& exprBuilder) noexcept
 {
-    if (mOp == AllReduceFusionOp::RESIDUAL_RMS_NORM_QUANT_NVFP4 && mStrategy == AllReduceStrategyType::UB && mScale)
+    if (mOp == AllReduceFusionOp::RESIDUAL_RMS_NORM_QUANT_NVFP4 && mScale)
     {
         if (outputIndex == 0)
         {
@@ -172,7 +184,7 @@ bool AllreducePlugin::supportsFormatCombination(
     {
         return (inOut[pos].type == nvinfer1::DataType::kINT64) && (inOut[pos].format == TensorFormat::kLINEAR);
     }
-    if (mStrategy == AllReduceStrategyType::UB)
+    if (mStrategy == AllReduceStrategyType::UB || isQuantFusionOp(mOp))
     {
         if (mScale && pos == scale_idx)
         {
@@ -232,11 +244,6 @@ AllReduceStrategyType AllreducePlugin::selectImplementation(
         return AllReduceStrategyType::NCCL;
     }
 
-    if (isAuto && !mIsNVLINKSupported && !forceDeterministic)
-    {
-        return AllReduceStrategyType::NCCL;
-    }
-
     auto const maxWorkspaceSize = utils::customAllReduceUtils::getMaxRequiredWorkspaceSize(worldSize);
 
     AllReduceStrategyType strat = AllReduceStrategyType::NCCL;
@@ -251,37 +258,23 @@ AllReduceStrategyType AllreducePlugin::selectImplementation(
         {
             strat = mStrategy;
         }
-        else if (forceDeterministic)
-        {
-            strat = AllReduceStrategyType::ONESHOT;
-        }
-        else if (worldSize <= 2)
-        {
-            strat = AllReduceStrategyType::ONESHOT;
-        }
-        else if (worldSize <= 4)
-        {
-            if (messageSizeBytes < 1 * 1000 * 1000)
-            {
-                strat = AllReduceStrategyType::ONESHOT;
-            }
-            else
-            {
-                strat = AllReduceStrategyType::NCCL;
-            }
-        }
         else
         {
-            if (messageSizeBytes < 500 * 1000)
-            {
-                strat = AllReduceStrategyType::ONESHOT;
-            }
-            else
+            strat = AllReduceStrategyProfile::getActive()->select(mTopology, worldSize, messageSizeBytes);
+            // The one-shot and two-shot kernels sum the ranks in the same order, so they give the same results on all
+            // the ranks and either can serve a message. Only NCCL, for the messages the profile leaves to it, is not
+            // deterministic.
+            if (forceDeterministic && strat != AllReduceStrategyType::ONESHOT)
             {
-                strat = AllReduceStrategyType::NCCL;
+                strat = AllReduceStrategyType::TWOSHOT;
             }
         }
 
+        if (forceDeterministic && strat == AllReduceStrategyType::TWOSHOT
+            && !kernels::configurationSupported(strat, messageSize, worldSize, type))
+        {
+            strat = AllReduceStrategyType::ONESHOT;
+        }
         if (!kernels::configurationSupported(strat, messageSize, worldSize, type))
         {
             if (!isAuto)
@@ -315,6 +308,24 @@ AllReduceStrategyType AllreducePlugin::selectImplementation(
     return strat;
 }
 
+AllReduceStrategyType AllreducePlugin::selectNvlsImplementation(size_t messageSize, int hiddenSize) noexcept
+{
+    if (mNvlsComm == nullptr)
+    {
+        TLLM_LOG_WARNING("Since NVLS multicast not supported, fallback to AllReduceStrategy: NCCL");
+        return AllReduceStrategyType::NCCL;
+    }
+    bool const fused = mOp == AllReduceFusionOp::RESIDUAL_RMS_NORM;
+    if ((!fused && mOp != AllReduceFusionOp::NONE)
+        || !mNvlsComm->supportsAllReduce(messageSize, mType, fused ? hiddenSize : 0))
+    {
+        TLLM_LOG_WARNING(
+            "Since the message or the fusion is not supported by NVLS, fallback to AllReduceStrategy: NCCL");
+        return AllReduceStrategyType::NCCL;
+    }
+    return AllReduceStrategyType::NVLS;
+}
+
 int AllreducePlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc, nvinfer1::PluginTensorDesc const* outputDesc,
     void const* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream) noexcept
 {
@@ -340,6 +351,10 @@ int AllreducePlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc, nvinfe
     {
         runtimeStrategy = AllReduceStrategyType::UB;
     }
+    else if (mStrategy == AllReduceStrategyType::NVLS)
+    {
+        runtimeStrategy = selectNvlsImplementation(size, inputDesc[0].dims.d[inputDesc[0].dims.nbDims - 1]);
+    }
     else
     {
         runtimeStrategy = selectImplementation(size, mGroup.size(), mType);
@@ -369,10 +384,32 @@ int AllreducePlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc, nvinfe
         TLLM_LOG_DEBUG("AllReducePlugin strategy for rank %d: UB", rank);
         break;
     }
+    case AllReduceStrategyType::NVLS:
+    {
+        TLLM_LOG_DEBUG("AllReducePlugin strategy for rank %d: NVLS", rank);
+        break;
+    }
     default: break;
     }
 
-    if (runtimeStrategy == AllReduceStrategyType::NCCL)
+    if (runtimeStrategy == AllReduceStrategyType::NVLS)
+    {
+        // The layout of the inputs is the one of the custom strategies, the workspace at inputs[1] is not used.
+        if (mOp == AllReduceFusionOp::RESIDUAL_RMS_NORM)
+        {
+            int fusion_ptr_idx = 2;
+            void const* bias = mBias ? inputs[fusion_ptr_idx++] : nullptr;
+            void const* residual = inputs[fusion_ptr_idx++];
+            void const* weight = mAffine ? inputs[fusion_ptr_idx++] : nullptr;
+            mNvlsComm->allReduceResidualRmsNorm(inputs[0], residual, bias, weight, outputs[0], outputs[1], size,
+                inputDesc[0].dims.d[inputDesc[0].dims.nbDims - 1], mEps, mType, stream);
+        }
+        else
+        {
+            mNvlsComm->allReduce(inputs[0], outputs[0], size, mType, stream);
+        }
+    }
+    else if (runtimeStrategy == AllReduceStrategyType::NCCL)
     {
         if (mOp == AllReduceFusionOp::RESIDUAL_RMS_NORM || mOp == AllReduceFusionOp::RESIDUAL_RMS_PREPOST_NORM)
         {
@@ -402,6 +439,12 @@ int AllreducePlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc, nvinfe
             TLLM_LOG_DEBUG("residualRmsNorm called");
             tensorrt_llm::kernels::residualRmsNorm(params, mType, stream, mOp);
         }
+        else if (isQuantFusionOp(mOp))
+        {
+            NCCLCHECK(ncclAllReduce(inputs[0], outputs[1], size, (*getDtypeMap())[mType], ncclSum, *mNcclComm, stream));
+            enqueueResidualRmsNormQuant(
+                inputDesc, inputs, outputs, size, mStrategy == AllReduceStrategyType::NCCL ? 1 : 2, stream);
+        }
         else
         {
             NCCLCHECK(ncclAllReduce(inputs[0], outputs[0], size, (*getDtypeMap())[mType], ncclSum, *mNcclComm, stream));
@@ -481,6 +524,27 @@ int AllreducePlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc, nvinfe
 
         int token_num = size / inputDesc[0].dims.d[inputDesc[0].dims.nbDims - 1];
         int hidden_size = inputDesc[0].dims.d[inputDesc[0].dims.nbDims - 1];
+        // AUTO runs the custom kernels with the config tuned for the message size, if the profile has one.
+        auto config = mConfig;
+        if (mStrategy == AllReduceStrategyType::AUTO && !common::getEnvForceDeterministicAllReduce())
+        {
+            config = AllReduceStrategyProfile::getActive()->selectConfig(
+                mTopology, static_cast<int>(tpSize), size * common::getDTypeSize(mType), mConfig);
+        }
+        if (isQuantFusionOp(mOp))
+        {
+            // The custom kernels only fuse the norm without quantization.
+            auto params = tensorrt_llm::kernels::AllReduceParams::deserialize(
+                reinterpret_cast<int64_t*>(const_cast<void*>(inputs[1])), tpSize, tpRank, mType, token_num,
+                hidden_size, AllReduceFusionOp::NONE);
+            params.local_output_buffer_ptr = outputs[1];
+            params.local_input_buffer_ptr = inputs[0];
+            params.elts_total = size;
+            tensorrt_llm::kernels::customAllReduce(
+                params, mType, runtimeStrategy, config, AllReduceFusionOp::NONE, stream);
+            enqueueResidualRmsNormQuant(inputDesc, inputs, outputs, size, 2, stream);
+            return 0;
+        }
         auto params = tensorrt_llm::kernels::AllReduceParams::deserialize(
             reinterpret_cast<int64_t*>(const_cast<void*>(inputs[1])), tpSize, tpRank, mType, token_num, hidden_size,
             mOp);
@@ -511,12 +575,32 @@ int AllreducePlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc, nvinfe
             }
         }
         TLLM_LOG_DEBUG("customAllReduce called");
-        tensorrt_llm::kernels::customAllReduce(params, mType, runtimeStrategy, mConfig, mOp, stream);
+        tensorrt_llm::kernels::customAllReduce(params, mType, runtimeStrategy, config, mOp, stream);
     }
 
     return 0;
 }
 
+void AllreducePlugin::enqueueResidualRmsNormQuant(nvinfer1::PluginTensorDesc const* inputDesc,
+    void const* const* inputs, void* const* outputs, size_t size, int fusionPtrIdx, cudaStream_t stream)
+{
+    TLLM_CHECK(mAffine);
+    TLLM_CHECK(mScale);
+    tensorrt_llm::kernels::AllReduceParams params;
+    params.fusion_params.bias_buffer = mBias ? inputs[fusionPtrIdx++] : nullptr;
+    params.fusion_params.residual_buffer = inputs[fusionPtrIdx++];
+    params.fusion_params.weight_buffer = inputs[fusionPtrIdx++];
+    auto const* scale = reinterpret_cast<float const*>(inputs[fusionPtrIdx++]);
+    params.local_output_buffer_ptr = outputs[0];
+    params.elts_total = size;
+    params.fusion_params.hidden_size = inputDesc[0].dims.d[inputDesc[0].dims.nbDims - 1];
+    params.fusion_params.eps = mEps;
+    params.fusion_params.intermediate_buffer = outputs[1];
+    auto* scaleOutput = mOp == AllReduceFusionOp::RESIDUAL_RMS_NORM_QUANT_NVFP4 ? outputs[2] : nullptr;
+    TLLM_LOG_DEBUG("residualRmsNormQuant called");
+    tensorrt_llm::kernels::residualRmsNormQuant(params, mType, mOp, scale, scaleOutput, stream);
+}
+
 // IPluginV2Ext Methods
 nvinfer1::DataType AllreducePlugin::getOutputDataType(
     int index, nvinfer1::DataType const* inputTypes, int nbInputs) const noexcept
@@ -664,16 +748,17 @@ std::set<int> getLocalGroup(std::set<int> const& group)
 
 void AllreducePlugin::initGroupTopology() noexcept
 {
-    static std::map<std::set<int>, std::tuple<bool, bool>> cache;
+    static std::map<std::set<int>, std::tuple<bool, bool, AllReduceTopology>> cache;
     if (cache.find(mGroup) != cache.end())
     {
-        auto [isNVLINKSupported, isP2PSupported] = cache[mGroup];
+        auto [isNVLINKSupported, isP2PSupported, topology] = cache[mGroup];
         mIsNVLINKSupported = isNVLINKSupported;
         mIsP2PSupported = isP2PSupported;
+        mTopology = topology;
         return;
     }
     setGroupTopology();
-    cache[mGroup] = {mIsNVLINKSupported, mIsP2PSupported};
+    cache[mGroup] = {mIsNVLINKSupported, mIsP2PSupported, mTopology};
 }
 
 void AllreducePlugin::setGroupTopology() noexcept
@@ -685,6 +770,7 @@ void AllreducePlugin::setGroupTopology() noexcept
     {
         mIsP2PSupported = false;
         mIsNVLINKSupported = false;
+        mTopology = AllReduceTopology::kINTER_NODE;
         TLLM_LOG_INFO("Found inter-node TP group for rank %d", rank);
         return;
     }
@@ -694,6 +780,8 @@ void AllreducePlugin::setGroupTopology() noexcept
     std::unordered_set<int> visitedDevice;
     mIsP2PSupported = true;
     mIsNVLINKSupported = true;
+    mTopology = AllReduceTopology::kPCIE;
+    bool isNVSwitch = false;
 
     // Use cudaDeviceCanAccessPeer to determine whether p2p is supported,
     // and use nvml to determine whether there are nvlink links between ranks.
@@ -764,6 +852,7 @@ void AllreducePlugin::setGroupTopology() noexcept
                         if (strcmp(remotePciInfo.busId, secondRemotePciInfo.busId) == 0)
                         {
                             isNVLINK = true;
+                            isNVSwitch = true;
                             break;
                         }
                     }
@@ -783,6 +872,10 @@ void AllreducePlugin::setGroupTopology() noexcept
         }
         visitedDevice.insert(firstDeviceId);
     }
+    if (mIsNVLINKSupported)
+    {
+        mTopology = isNVSwitch ? AllReduceTopology::kNVSWITCH : AllReduceTopology::kNVLINK;
+    }
 }
 
 int AllreducePlugin::initialize() noexcept
@@ -798,6 +891,11 @@ int AllreducePlugin::initialize() noexcept
     {
         initGroupTopology();
     }
+    if (mStrategy == AllReduceStrategyType::NVLS && mTopology == AllReduceTopology::kNVSWITCH
+        && runtime::NvlsCommunicator::isSupported())
+    {
+        mNvlsComm = runtime::NvlsCommunicator::getComm(mGroup);
+    }
 
     TLLM_LOG_TRACE("%s stop for rank %d", __PRETTY_FUNCTION__, COMM_SESSION.getRank());
     return 0;
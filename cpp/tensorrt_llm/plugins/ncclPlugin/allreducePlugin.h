@@ -16,8 +16,10 @@
  */
 #pragma once
 
+#include "tensorrt_llm/common/customAllReduceUtils.h"
 #include "tensorrt_llm/kernels/customAllReduceKernels.h"
 #include "tensorrt_llm/plugins/common/plugin.h"
+#include "tensorrt_llm/runtime/nvlsCommunicator.h"
 
 #include <cassert>
 #include <memory>
@@ -72,19 +74,28 @@ private:
     void setGroupTopology() noexcept;
     kernels::AllReduceStrategyType selectImplementation(
         size_t messageSize, int worldSize, nvinfer1::DataType type) noexcept;
+    // NVLS if the multicast communicator serves the message and the fusion, NCCL otherwise.
+    kernels::AllReduceStrategyType selectNvlsImplementation(size_t messageSize, int hiddenSize) noexcept;
     void check() noexcept;
+    // Residual add, RMS norm and quantization after an all-reduce into outputs[1], for the strategies without this
+    // fusion.
+    void enqueueResidualRmsNormQuant(nvinfer1::PluginTensorDesc const* inputDesc, void const* const* inputs,
+        void* const* outputs, size_t size, int fusionPtrIdx, cudaStream_t stream);
 
 private:
     std::string const mLayerName;
     std::set<int> mGroup;
     bool mIsNVLINKSupported;
     bool mIsP2PSupported;
+    utils::customAllReduceUtils::AllReduceTopology mTopology{
+        utils::customAllReduceUtils::AllReduceTopology::kINTER_NODE};
     nvinfer1::DataType mType;
     kernels::AllReduceStrategyType mStrategy;
     kernels::AllReduceStrategyConfig mConfig;
     kernels::AllReduceFusionOp mOp;
     float mEps;
     std::shared_ptr<ncclComm_t> mNcclComm;
+    std::shared_ptr<runtime::NvlsCommunicator> mNvlsComm;
     int8_t mAffine;
     int8_t mBias;
     int8_t mScale;
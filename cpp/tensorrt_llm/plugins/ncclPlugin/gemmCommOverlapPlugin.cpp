@@ -0,0 +1,500 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "gemmCommOverlapPlugin.h"
+
+#include "tensorrt_llm/common/workspace.h"
+
+#include <NvInferRuntime.h>
+#include <algorithm>
+#include <nccl.h>
+
+using namespace nvinfer1;
+using namespace tensorrt_llm::common;
+using tensorrt_llm::plugins::GemmCommOverlapEvents;
+using tensorrt_llm::plugins::GemmCommOverlapMode;
+using tensorrt_llm::plugins::GemmCommOverlapPluginCreator;
+using tensorrt_llm::plugins::GemmCommOverlapPlugin;
+
+static char const* GEMM_COMM_OVERLAP_PLUGIN_VERSION{"1"};
+static char const* GEMM_COMM_OVERLAP_PLUGIN_NAME{"GemmCommOverlap"};
+PluginFieldCollection GemmCommOverlapPluginCreator::mFC{};
+std::vector<nvinfer1::PluginField> GemmCommOverlapPluginCreator::mPluginAttributes;
+
+GemmCommOverlapEvents::GemmCommOverlapEvents()
+{
+    for (auto* events : {&gemmDone, &commDone})
+    {
+        for (auto& event : *events)
+        {
+            TLLM_CUDA_CHECK(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+        }
+    }
+}
+
+GemmCommOverlapEvents::~GemmCommOverlapEvents()
+{
+    for (auto* events : {&gemmDone, &commDone})
+    {
+        for (auto& event : *events)
+        {
+            TLLM_CUDA_CHECK(cudaEventDestroy(event));
+        }
+    }
+}
+
+GemmCommOverlapPlugin::GemmCommOverlapPlugin(std::set<int> group, nvinfer1::DataType type, int transB,
+    GemmCommOverlapMode mode, int numChunks, int sideStreamId)
+    : mGroup(std::move(group))
+    , mType(type)
+    , mTransB(transB)
+    , mMode(mode)
+    , mNumChunks(numChunks)
+    , mSideStreamId(sideStreamId)
+{
+    TLLM_CHECK_WITH_INFO(mNumChunks > 0, "The GEMM needs at least one chunk");
+    TLLM_CHECK_WITH_INFO(mSideStreamId > 0, "The collectives need a side stream");
+}
+
+// Parameterized constructor
+GemmCommOverlapPlugin::GemmCommOverlapPlugin(void const* data, size_t length)
+{
+    char const *d = reinterpret_cast<char const*>(data), *a = d;
+    read(d, mType);
+    read(d, mTransB);
+    read(d, mMode);
+    read(d, mNumChunks);
+    read(d, mSideStreamId);
+    mGroup.clear();
+    int groupItem = 0;
+    while (d != a + length)
+    {
+        read(d, groupItem);
+        mGroup.insert(groupItem);
+    }
+    TLLM_CHECK_WITH_INFO(d == a + length,
+        "Expected length (%d) != real length (%d). This is often "
+        "caused by using different TensorRT-LLM version to build "
+        "engine and run engine.",
+        (int) length, (int) (d - a));
+}
+
+// IPluginV2DynamicExt Methods
+nvinfer1::IPluginV2DynamicExt* GemmCommOverlapPlugin::clone() const noexcept
+{
+    auto* plugin = new GemmCommOverlapPlugin(*this);
+    plugin->mSideStreamPtr = nullptr;
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+nvinfer1::DimsExprs GemmCommOverlapPlugin::getOutputDimensions(
+    int outputIndex, nvinfer1::DimsExprs const* inputs, int nbInputs, nvinfer1::IExprBuilder& exprBuilder) noexcept
+{
+    try
+    {
+        TLLM_CHECK(nbInputs == 2);
+        TLLM_CHECK(outputIndex == 0);
+        TLLM_CHECK_WITH_INFO(inputs[0].nbDims == 2 && inputs[1].nbDims == 2, "Expected [M, K] activations");
+        auto const groupSize = exprBuilder.constant(mGroup.size());
+        DimsExprs ret;
+        ret.nbDims = 2;
+        ret.d[0] = mMode == GemmCommOverlapMode::kREDUCE_SCATTER
+            ? exprBuilder.operation(DimensionOperation::kFLOOR_DIV, *inputs[0].d[0], *groupSize)
+            : exprBuilder.operation(DimensionOperation::kPROD, *inputs[0].d[0], *groupSize);
+        ret.d[1] = mTransB ? inputs[1].d[0] : inputs[1].d[1];
+        return ret;
+    }
+    catch (std::exception const& e)
+    {
+        caughtError(e);
+    }
+    return DimsExprs{};
+}
+
+bool GemmCommOverlapPlugin::supportsFormatCombination(
+    int pos, nvinfer1::PluginTensorDesc const* inOut, int nbInputs, int nbOutputs) noexcept
+{
+    return (inOut[pos].type == mType) && (inOut[pos].format == TensorFormat::kLINEAR);
+}
+
+void GemmCommOverlapPlugin::configurePlugin(nvinfer1::DynamicPluginTensorDesc const* in, int nbInputs,
+    nvinfer1::DynamicPluginTensorDesc const* out, int nbOutputs) noexcept
+{
+}
+
+int64_t GemmCommOverlapPlugin::getRowsPerRank(int64_t m) const
+{
+    // The reduce-scatter splits the rows of the input, the all-gather collects the rows of every rank.
+    return mMode == GemmCommOverlapMode::kREDUCE_SCATTER ? m / static_cast<int64_t>(mGroup.size()) : m;
+}
+
+int64_t GemmCommOverlapPlugin::getChunkRows(int64_t rowsPerRank) const
+{
+    auto const numChunks = std::max<int64_t>(std::min<int64_t>(mNumChunks, rowsPerRank), 1);
+    return (rowsPerRank + numChunks - 1) / numChunks;
+}
+
+size_t GemmCommOverlapPlugin::getChunkBufferSize(int64_t m, int64_t n, int64_t k) const
+{
+    // A chunk of the GEMM output before the reduce-scatter, or of the activations after the all-gather.
+    auto const chunkRows = getChunkRows(getRowsPerRank(m));
+    auto const cols = mMode == GemmCommOverlapMode::kREDUCE_SCATTER ? n : k;
+    return static_cast<size_t>(mGroup.size() * chunkRows * cols) * getDTypeSize(mType);
+}
+
+size_t GemmCommOverlapPlugin::getWorkspaceSize(nvinfer1::PluginTensorDesc const* inputs, int nbInputs,
+    nvinfer1::PluginTensorDesc const* outputs, int nbOutputs) const noexcept
+{
+    auto const m = inputs[0].dims.d[0];
+    auto const k = inputs[0].dims.d[1];
+    auto const n = mTransB ? inputs[1].dims.d[0] : inputs[1].dims.d[1];
+    auto const chunkBufferSize = getChunkBufferSize(m, n, k);
+    size_t const workspaces[] = {CUBLAS_WORKSPACE_SIZE, chunkBufferSize, chunkBufferSize};
+    return calculateTotalWorkspaceSize(workspaces, 3);
+}
+
+void GemmCommOverlapPlugin::setGemmConfig()
+{
+    if (mType == nvinfer1::DataType::kHALF)
+    {
+        mCublasWrapper->setFP16GemmConfig();
+    }
+    else if (mType == nvinfer1::DataType::kFLOAT)
+    {
+        mCublasWrapper->setFP32GemmConfig();
+    }
+#ifdef ENABLE_BF16
+    else if (mType == nvinfer1::DataType::kBF16)
+    {
+        mCublasWrapper->setBF16GemmConfig();
+    }
+#endif
+}
+
+void GemmCommOverlapPlugin::runChunkGemm(void const* act, int64_t actStride, void const* weight, void* out,
+    int64_t outStride, int64_t rows, int n, int k, void* workspace, cudaStream_t stream)
+{
+    // Row major out[rows, n] = act[rows, k] * weight is the column major out^T = weight^T * act^T. The weight is shared
+    // by the batches, one per rank.
+    TLLM_CUDA_CHECK(cublasSetStream(mCublasWrapper->getCublasHandle(), stream));
+    mCublasWrapper->setStream(stream);
+    mCublasWrapper->setWorkspace(workspace);
+    mCublasWrapper->stridedBatchedGemm(mTransB ? CUBLAS_OP_T : CUBLAS_OP_N, CUBLAS_OP_N, n, static_cast<int>(rows), k,
+        weight, mTransB ? k : n, 0, act, k, actStride, out, n, outStride, static_cast<int>(mGroup.size()));
+}
+
+void GemmCommOverlapPlugin::enqueueReduceScatter(void const* act, void const* weight, void* out, int64_t m, int n,
+    int k, int8_t* chunkBuffers, size_t chunkBufferStride, void* workspace, cudaStream_t stream, cudaStream_t sideStream)
+{
+    auto const typeSize = getDTypeSize(mType);
+    auto const rowsPerRank = getRowsPerRank(m);
+    auto const chunkRows = getChunkRows(rowsPerRank);
+    auto const ncclType = (*getDtypeMap())[mType];
+    auto const& events = *mEvents;
+    for (int64_t row = 0, chunkIdx = 0; row < rowsPerRank; row += chunkRows, ++chunkIdx)
+    {
+        auto const rows = std::min(chunkRows, rowsPerRank - row);
+        auto const bufferIdx = chunkIdx % 2;
+        auto* buffer = chunkBuffers + bufferIdx * chunkBufferStride;
+        if (chunkIdx >= 2)
+        {
+            // The reduce-scatter two chunks back still reads the buffer.
+            TLLM_CUDA_CHECK(cudaStreamWaitEvent(stream, events.commDone[bufferIdx]));
+        }
+        runChunkGemm(static_cast<int8_t const*>(act) + row * k * typeSize, rowsPerRank * k, weight, buffer, rows * n,
+            rows, n, k, workspace, stream);
+        TLLM_CUDA_CHECK(cudaEventRecord(events.gemmDone[bufferIdx], stream));
+
+        TLLM_CUDA_CHECK(cudaStreamWaitEvent(sideStream, events.gemmDone[bufferIdx]));
+        NCCLCHECK(ncclReduceScatter(buffer, static_cast<int8_t*>(out) + row * n * typeSize, rows * n, ncclType,
+            ncclSum, *mNcclComm, sideStream));
+        TLLM_CUDA_CHECK(cudaEventRecord(events.commDone[bufferIdx], sideStream));
+    }
+}
+
+void GemmCommOverlapPlugin::enqueueAllGather(void const* act, void const* weight, void* out, int64_t m, int n, int k,
+    int8_t* chunkBuffers, size_t chunkBufferStride, void* workspace, cudaStream_t stream, cudaStream_t sideStream)
+{
+    auto const typeSize = getDTypeSize(mType);
+    auto const rowsPerRank = getRowsPerRank(m);
+    auto const chunkRows = getChunkRows(rowsPerRank);
+    auto const ncclType = (*getDtypeMap())[mType];
+    auto const& events = *mEvents;
+    for (int64_t row = 0, chunkIdx = 0; row < rowsPerRank; row += chunkRows, ++chunkIdx)
+    {
+        auto const rows = std::min(chunkRows, rowsPerRank - row);
+        auto const bufferIdx = chunkIdx % 2;
+        auto* buffer = chunkBuffers + bufferIdx * chunkBufferStride;
+        if (chunkIdx >= 2)
+        {
+            // The GEMM two chunks back still reads the buffer.
+            TLLM_CUDA_CHECK(cudaStreamWaitEvent(sideStream, events.gemmDone[bufferIdx]));
+        }
+        NCCLCHECK(ncclAllGather(static_cast<int8_t const*>(act) + row * k * typeSize, buffer, rows * k, ncclType,
+            *mNcclComm, sideStream));
+        TLLM_CUDA_CHECK(cudaEventRecord(events.commDone[bufferIdx], sideStream));
+
+        TLLM_CUDA_CHECK(cudaStreamWaitEvent(stream, events.commDone[bufferIdx]));
+        runChunkGemm(buffer, rows * k, weight, static_cast<int8_t*>(out) + row * n * typeSize, rowsPerRank * n, rows,
+            n, k, workspace, stream);
+        TLLM_CUDA_CHECK(cudaEventRecord(events.gemmDone[bufferIdx], stream));
+    }
+}
+
+int GemmCommOverlapPlugin::enqueue(nvinfer1::PluginTensorDesc const* inputDesc,
+    nvinfer1::PluginTensorDesc const* outputDesc, void const* const* inputs, void* const* outputs, void* workspace,
+    cudaStream_t stream) noexcept
+{
+    // inputs
+    //     act [M, K]
+    //     weight [K, N] (mTransB = False)
+    // outputs
+    //     mat [M / tp, N] (kREDUCE_SCATTER) or [M * tp, N] (kALL_GATHER)
+    if (isBuilding())
+    {
+        return 0;
+    }
+    auto const m = inputDesc[0].dims.d[0];
+    auto const k = static_cast<int>(inputDesc[0].dims.d[1]);
+    auto const n = static_cast<int>(mTransB ? inputDesc[1].dims.d[0] : inputDesc[1].dims.d[1]);
+    if (getRowsPerRank(m) == 0)
+    {
+        return 0;
+    }
+    TLLM_CHECK_WITH_INFO(mNcclComm.get() != nullptr, "mNcclComm should be initialized before used");
+    TLLM_CHECK_WITH_INFO(mMode == GemmCommOverlapMode::kALL_GATHER || m % static_cast<int64_t>(mGroup.size()) == 0,
+        "The rows (%ld) must be divisible by the group size (%zu)", static_cast<long>(m), mGroup.size());
+
+    if (!mSideStreamPtr)
+    {
+        auto const resourceName = nvinfer1::pluginInternal::SideStream::getResourceKey(mSideStreamId);
+        nvinfer1::pluginInternal::SideStream sideStream{};
+        mSideStreamPtr = reinterpret_cast<nvinfer1::pluginInternal::SideStream*>(
+            getPluginRegistry()->acquirePluginResource(resourceName.c_str(), &sideStream));
+    }
+    setGemmConfig();
+
+    // Both chunk buffers are adjacent and aligned.
+    auto const chunkBufferStride = (getChunkBufferSize(m, n, k) + kCudaMemAlign - 1) / kCudaMemAlign * kCudaMemAlign;
+    uintptr_t offset = 0;
+    auto* cublasWorkspace = nextWorkspacePtr(static_cast<int8_t*>(workspace), offset, CUBLAS_WORKSPACE_SIZE);
+    auto* chunkBuffers = nextWorkspacePtr(static_cast<int8_t*>(workspace), offset, 2 * chunkBufferStride);
+
+    // The side stream writes the output of the reduce-scatter and reads the inputs of the all-gather.
+    mSideStreamPtr->waitMainStreamOnSideStream(stream);
+    auto const sideStream = mSideStreamPtr->getStream();
+    if (mMode == GemmCommOverlapMode::kREDUCE_SCATTER)
+    {
+        enqueueReduceScatter(inputs[0], inputs[1], outputs[0], m, n, k, chunkBuffers, chunkBufferStride,
+            cublasWorkspace, stream, sideStream);
+        // The last reduce-scatter completes the output.
+        mSideStreamPtr->waitSideStreamOnMainStream(stream);
+    }
+    else
+    {
+        // The main stream already waited for every all-gather.
+        enqueueAllGather(inputs[0], inputs[1], outputs[0], m, n, k, chunkBuffers, chunkBufferStride, cublasWorkspace,
+            stream, sideStream);
+    }
+    return 0;
+}
+
+// IPluginV2Ext Methods
+nvinfer1::DataType GemmCommOverlapPlugin::getOutputDataType(
+    int index, nvinfer1::DataType const* inputTypes, int nbInputs) const noexcept
+{
+    TLLM_CHECK(index == 0);
+    return inputTypes[0];
+}
+
+// IPluginV2 Methods
+
+char const* GemmCommOverlapPlugin::getPluginType() const noexcept
+{
+    return GEMM_COMM_OVERLAP_PLUGIN_NAME;
+}
+
+char const* GemmCommOverlapPlugin::getPluginVersion() const noexcept
+{
+    return GEMM_COMM_OVERLAP_PLUGIN_VERSION;
+}
+
+int GemmCommOverlapPlugin::getNbOutputs() const noexcept
+{
+    return 1;
+}
+
+int GemmCommOverlapPlugin::initialize() noexcept
+{
+    if (isBuilding())
+    {
+        return 0;
+    }
+    mNcclComm = getComm(mGroup);
+    mCublasWrapper = std::make_shared<CublasMMWrapper>(getCublasHandle(), getCublasLtHandle(), nullptr, nullptr);
+    mEvents = std::make_shared<GemmCommOverlapEvents>();
+    return 0;
+}
+
+void GemmCommOverlapPlugin::terminate() noexcept
+{
+    if (mSideStreamPtr)
+    {
+        auto const resourceName = nvinfer1::pluginInternal::SideStream::getResourceKey(mSideStreamId);
+        getPluginRegistry()->releasePluginResource(resourceName.c_str());
+        mSideStreamPtr = nullptr;
+    }
+}
+
+size_t GemmCommOverlapPlugin::getSerializationSize() const noexcept
+{
+    return sizeof(mType) + sizeof(mTransB) + sizeof(mMode) + sizeof(mNumChunks) + sizeof(mSideStreamId)
+        + sizeof(int) * mGroup.size();
+}
+
+void GemmCommOverlapPlugin::serialize(void* buffer) const noexcept
+{
+    char *d = static_cast<char*>(buffer), *a = d;
+    write(d, mType);
+    write(d, mTransB);
+    write(d, mMode);
+    write(d, mNumChunks);
+    write(d, mSideStreamId);
+    for (auto it = mGroup.begin(); it != mGroup.end(); ++it)
+    {
+        write(d, *it);
+    }
+    TLLM_CHECK(d == a + getSerializationSize());
+}
+
+void GemmCommOverlapPlugin::destroy() noexcept
+{
+    // This gets called when the network containing plugin is destroyed
+    delete this;
+}
+
+///////////////
+
+GemmCommOverlapPluginCreator::GemmCommOverlapPluginCreator()
+{
+    // Fill PluginFieldCollection with PluginField arguments metadata
+    mPluginAttributes.clear();
+    mPluginAttributes.emplace_back(PluginField("group", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("type_id", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("transb", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("mode", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("num_chunks", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("side_stream_id", nullptr, PluginFieldType::kINT32, 1));
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+char const* GemmCommOverlapPluginCreator::getPluginName() const noexcept
+{
+    return GEMM_COMM_OVERLAP_PLUGIN_NAME;
+}
+
+char const* GemmCommOverlapPluginCreator::getPluginVersion() const noexcept
+{
+    return GEMM_COMM_OVERLAP_PLUGIN_VERSION;
+}
+
+PluginFieldCollection const* GemmCommOverlapPluginCreator::getFieldNames() noexcept
+{
+    return &mFC;
+}
+
+IPluginV2* GemmCommOverlapPluginCreator::createPlugin(char const* name, PluginFieldCollection const* fc) noexcept
+{
+    PluginField const* fields = fc->fields;
+    std::set<int> group;
+    nvinfer1::DataType type{};
+    int transB{};
+    auto mode = GemmCommOverlapMode::kREDUCE_SCATTER;
+    int numChunks{4};
+    int sideStreamId{1};
+    // Read configurations from each fields
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        char const* attrName = fields[i].name;
+        if (!strcmp(attrName, "group"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            auto const* r = static_cast<int const*>(fields[i].data);
+            for (int j = 0; j < fields[i].length; ++j)
+            {
+                group.insert(*r);
+                ++r;
+            }
+        }
+        else if (!strcmp(attrName, "type_id"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            type = static_cast<nvinfer1::DataType>(*(static_cast<nvinfer1::DataType const*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "transb"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            transB = *static_cast<int const*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "mode"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            mode = static_cast<GemmCommOverlapMode>(*static_cast<int const*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "num_chunks"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            numChunks = *static_cast<int const*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "side_stream_id"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            sideStreamId = *static_cast<int const*>(fields[i].data);
+        }
+    }
+
+    try
+    {
+        auto* obj = new GemmCommOverlapPlugin(group, type, transB, mode, numChunks, sideStreamId);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (std::exception const& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
+
+IPluginV2* GemmCommOverlapPluginCreator::deserializePlugin(
+    char const* name, void const* serialData, size_t serialLength) noexcept
+{
+    // This object will be deleted when the network is destroyed, which will
+    // call GemmCommOverlapPlugin::destroy()
+    try
+    {
+        auto* obj = new GemmCommOverlapPlugin(serialData, serialLength);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (std::exception const& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/cublasMMWrapper.h"
+#include "tensorrt_llm/plugins/common/plugin.h"
+#include "tensorrt_llm/plugins/cudaStreamPlugin/cudaStreamPlugin.h"
+
+#include <array>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::plugins
+{
+
+// How the GEMM is combined with the collective of the tensor parallel group.
+enum class GemmCommOverlapMode : int32_t
+{
+    // Row parallel GEMM followed by a reduce-scatter over the rows of the output, [M, K] -> [M / tp, N].
+    kREDUCE_SCATTER = 0,
+    // Sequence parallel all-gather of the rows of the input followed by a column parallel GEMM, [M, K] -> [M * tp, N].
+    kALL_GATHER = 1,
+};
+
+// Events that order the main and the side stream on the two chunk buffers.
+struct GemmCommOverlapEvents
+{
+    GemmCommOverlapEvents();
+    ~GemmCommOverlapEvents();
+
+    std::array<cudaEvent_t, 2> gemmDone{};
+    std::array<cudaEvent_t, 2> commDone{};
+};
+
+// GEMM and collective of the generic tensor parallel path, pipelined over chunks of the rows of every rank. The
+// collective of one chunk runs on a side stream while the GEMM of the next chunk runs on the main stream, through two
+// chunk buffers in the workspace. Chunk c covers the rows [c * T, (c + 1) * T) of the slice of every rank, so that a
+// collective on the chunk exchanges the same rows as the collective on the whole tensor. The GEMM of a chunk is a
+// strided batched GEMM over the ranks.
+class GemmCommOverlapPlugin : public BasePlugin
+{
+public:
+    GemmCommOverlapPlugin(std::set<int> group, nvinfer1::DataType type, int transB, GemmCommOverlapMode mode,
+        int numChunks, int sideStreamId);
+
+    GemmCommOverlapPlugin(void const* data, size_t length);
+
+    ~GemmCommOverlapPlugin() override = default;
+
+    // IPluginV2DynamicExt Methods
+    nvinfer1::IPluginV2DynamicExt* clone() const noexcept override;
+    nvinfer1::DimsExprs getOutputDimensions(int outputIndex, nvinfer1::DimsExprs const* inputs, int nbInputs,
+        nvinfer1::IExprBuilder& exprBuilder) noexcept override;
+    bool supportsFormatCombination(
+        int pos, nvinfer1::PluginTensorDesc const* inOut, int nbInputs, int nbOutputs) noexcept override;
+    void configurePlugin(nvinfer1::DynamicPluginTensorDesc const* in, int nbInputs,
+        nvinfer1::DynamicPluginTensorDesc const* out, int nbOutputs) noexcept override;
+    size_t getWorkspaceSize(nvinfer1::PluginTensorDesc const* inputs, int nbInputs,
+        nvinfer1::PluginTensorDesc const* outputs, int nbOutputs) const noexcept override;
+    int enqueue(nvinfer1::PluginTensorDesc const* inputDesc, nvinfer1::PluginTensorDesc const* outputDesc,
+        void const* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream) noexcept override;
+
+    // IPluginV2Ext Methods
+    nvinfer1::DataType getOutputDataType(
+        int index, nvinfer1::DataType const* inputTypes, int nbInputs) const noexcept override;
+
+    // IPluginV2 Methods
+    char const* getPluginType() const noexcept override;
+    char const* getPluginVersion() const noexcept override;
+    int getNbOutputs() const noexcept override;
+    int initialize() noexcept override;
+    void terminate() noexcept override;
+    size_t getSerializationSize() const noexcept override;
+    void serialize(void* buffer) const noexcept override;
+    void destroy() noexcept override;
+
+private:
+    // Rows of the slice of every rank, and the rows of a chunk of it.
+    [[nodiscard]] int64_t getRowsPerRank(int64_t m) const;
+    [[nodiscard]] int64_t getChunkRows(int64_t rowsPerRank) const;
+    [[nodiscard]] size_t getChunkBufferSize(int64_t m, int64_t n, int64_t k) const;
+    void setGemmConfig();
+    // out[r] = act[r] * weight for the rows of every rank r.
+    void runChunkGemm(void const* act, int64_t actStride, void const* weight, void* out, int64_t outStride,
+        int64_t rows, int n, int k, void* workspace, cudaStream_t stream);
+    void enqueueReduceScatter(void const* act, void const* weight, void* out, int64_t m, int n, int k,
+        int8_t* chunkBuffers, size_t chunkBufferStride, void* workspace, cudaStream_t stream, cudaStream_t sideStream);
+    void enqueueAllGather(void const* act, void const* weight, void* out, int64_t m, int n, int k,
+        int8_t* chunkBuffers, size_t chunkBufferStride, void* workspace, cudaStream_t stream, cudaStream_t sideStream);
+
+    const std::string mLayerName;
+    std::set<int> mGroup;
+    nvinfer1::DataType mType;
+    int mTransB;
+    GemmCommOverlapMode mMode;
+    int mNumChunks;
+    int mSideStreamId;
+    std::shared_ptr<ncclComm_t> mNcclComm;
+    std::shared_ptr<tensorrt_llm::common::CublasMMWrapper> mCublasWrapper;
+    std::shared_ptr<GemmCommOverlapEvents> mEvents;
+    nvinfer1::pluginInternal::SideStream* mSideStreamPtr{nullptr};
+};
+
+class GemmCommOverlapPluginCreator : public BaseCreator
+{
+public:
+    GemmCommOverlapPluginCreator();
+
+    char const* getPluginName() const noexcept override;
+
+    char const* getPluginVersion() const noexcept override;
+
+    nvinfer1::PluginFieldCollection const* getFieldNames() noexcept override;
+
+    nvinfer1::IPluginV2* createPlugin(char const* name, nvinfer1::PluginFieldCollection const* fc) noexcept override;
+
+    nvinfer1::IPluginV2* deserializePlugin(
+        char const* name, void const* serialData, size_t serialLength) noexcept override;
+
+private:
+    static nvinfer1::PluginFieldCollection mFC;
+    static std::vector<nvinfer1::PluginField> mPluginAttributes;
+};
+
+} // namespace tensorrt_llm::plugins
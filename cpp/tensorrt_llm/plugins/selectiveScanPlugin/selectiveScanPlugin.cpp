@@ -30,7 +30,8 @@ PluginFieldCollection SelectiveScanPluginCreator::mFC{};
 std::vector<nvinfer1::PluginField> SelectiveScanPluginCreator::mPluginAttributes;
 
 SelectiveScanPlugin::SelectiveScanPlugin(int dim, int dstate, int dtRank, int nHeads, int nGroups, int chunkSize,
-    bool deltaSoftplus, nvinfer1::DataType type, bool removePadding, bool pagedState, bool zEnabled, bool isMamba2)
+    bool deltaSoftplus, nvinfer1::DataType type, bool removePadding, bool pagedState, bool zEnabled, bool isMamba2,
+    bool chunkedContext, bool specDecoding)
     : mDim(dim)
     , mDState(dstate)
     , mDtRank(dtRank)
@@ -43,12 +44,15 @@ SelectiveScanPlugin::SelectiveScanPlugin(int dim, int dstate, int dtRank, int nH
     , mPagedState(pagedState)
     , mZEnabled(zEnabled)
     , mIsMamba2(isMamba2)
+    , mChunkedContext(chunkedContext)
+    , mSpecDecoding(specDecoding)
     , mDriver(tensorrt_llm::common::CUDADriverWrapper::getInstance())
 {
     TLLM_CHECK_WITH_INFO(
         (mChunkSize == 256 || mChunkSize == 128) || (!mIsMamba2), "Only support CHUNK_SIZE 256 or 128");
     TLLM_CHECK_WITH_INFO((mType == DataType::kBF16) || (mType == DataType::kFLOAT) || (mType == DataType::kHALF),
         "Only support float, half, and bfloat16.");
+    TLLM_CHECK_WITH_INFO(mPagedState || !mSpecDecoding, "Speculative decoding needs the paged state");
 }
 
 // Parameterized constructor
@@ -68,6 +72,16 @@ SelectiveScanPlugin::SelectiveScanPlugin(void const* data, size_t length)
     read(d, mPagedState);
     read(d, mZEnabled);
     read(d, mIsMamba2);
+    // Appended, the engines built before chunked context do not have it.
+    if (d != a + length)
+    {
+        read(d, mChunkedContext);
+    }
+    // Appended, the engines built before speculative decoding do not have it.
+    if (d != a + length)
+    {
+        read(d, mSpecDecoding);
+    }
     TLLM_CHECK(d == a + length);
     TLLM_CHECK_WITH_INFO(
         (mChunkSize == 256 || mChunkSize == 128) || (!mIsMamba2), "Only support CHUNK_SIZE 256 or 128");
@@ -79,7 +93,7 @@ SelectiveScanPlugin::SelectiveScanPlugin(void const* data, size_t length)
 nvinfer1::IPluginV2DynamicExt* SelectiveScanPlugin::clone() const noexcept
 {
     auto* plugin = new SelectiveScanPlugin(mDim, mDState, mDtRank, mNHeads, mNGroups, mChunkSize, mDeltaSoftplus, mType,
-        mRemovePadding, mPagedState, mZEnabled, mIsMamba2);
+        mRemovePadding, mPagedState, mZEnabled, mIsMamba2, mChunkedContext, mSpecDecoding);
     plugin->setPluginNamespace(mNamespace.c_str());
     return plugin;
 }
@@ -110,7 +124,8 @@ bool SelectiveScanPlugin::supportsFormatCombination(
     int pos, nvinfer1::PluginTensorDesc const* inOut, int nbInputs, int nbOutputs) noexcept
 {
     if (pos == getHostRequestTypesIdx() || pos == getLastTokenIdsIdx()
-        || (mRemovePadding && pos == getHostContextLengthIdx()) || (mPagedState && pos == getSlotMappingIdx()))
+        || (mRemovePadding && pos == getHostContextLengthIdx()) || (mPagedState && pos == getSlotMappingIdx())
+        || (mChunkedContext && pos == getHasInitialStateIdx()) || (mSpecDecoding && pos == getSpecDecodingParentsIdx()))
     {
         return inOut[pos].type == nvinfer1::DataType::kINT32;
     }
@@ -248,6 +263,9 @@ int SelectiveScanPlugin::enqueueImpl(nvinfer1::PluginTensorDesc const* inputDesc
     //     9.  host_context_lengths [batch_size] int32, optional for remove_input_padding
     //    10.  state_slot_mapping [batch_size] int32, optional for paged state
     //    11.  z [batch_size, max_seq_len, dim] or [num_tokens, dim]
+    //    12.  has_initial_state [batch_size] int32, optional for chunked_context
+    //    13.  spec_decoding_parents [batch_size, num_spec_tokens] int32, optional for spec_decoding
+    //    14.  state_snapshots [batch_size, num_spec_tokens, ...state], optional for spec_decoding
     // outputs
     //     0. output_tensor [batch_size, max_seq_len, dim] or [num_tokens, dim]
     //     1. state, [batch_size, dstate, dim] for mamba, [batch_size, nheads, dstate, dim] for mamba2
@@ -263,8 +281,12 @@ int SelectiveScanPlugin::enqueueImpl(nvinfer1::PluginTensorDesc const* inputDesc
         max_seq_len = inputDesc[getInputTensorIdx()].dims.d[1];
     }
 
-    // only support context or generation, not for both of them
+    // Without chunked context, a batch holds only context or only generation requests. With it, a batch holding any
+    // context request runs the context kernels, the generation requests being chunks of one token with initial state.
     RequestType const* reqTypes = static_cast<RequestType const*>(inputs[getHostRequestTypesIdx()]);
+    bool const isContext = mChunkedContext
+        ? std::any_of(reqTypes, reqTypes + batch_size, [](RequestType type) { return type == RequestType::kCONTEXT; })
+        : reqTypes[0] == RequestType::kCONTEXT;
 
     SSMParamsBase ssm_params;
 
@@ -284,7 +306,7 @@ int SelectiveScanPlugin::enqueueImpl(nvinfer1::PluginTensorDesc const* inputDesc
     T* mxCB = nullptr;
     void* descs = nullptr;
 
-    if (!mIsMamba2 || reqTypes[0] == RequestType::kGENERATION) /* no workspace needed */
+    if (!mIsMamba2 || !isContext) /* no workspace needed */
         ;
     else if (mRemovePadding)
     {
@@ -331,8 +353,20 @@ int SelectiveScanPlugin::enqueueImpl(nvinfer1::PluginTensorDesc const* inputDesc
         statePtr, inputs[getInputTensorIdx()], inputs[getDeltaIdx()], inputs[getDeltaBiasIdx()], inputs[getAIdx()],
         inputs[getBCIdx()], inputs[getDIdx()], z, mxOs, mxSt, mxdc, mxdA, mxCB, descs,
         static_cast<int const*>(inputs[getLastTokenIdsIdx()]), slotMapping, outputs[0], mDeltaSoftplus, mRemovePadding);
+    if (mChunkedContext)
+    {
+        ssm_params.has_initial_state_ptr = static_cast<int const*>(inputs[getHasInitialStateIdx()]);
+    }
+    if (mSpecDecoding && !isContext)
+    {
+        // The generation requests carry the real token and the drafts, updateRnnStateDraftTokenLocation copies the
+        // state of the last accepted one to the cache.
+        ssm_params.num_spec_tokens = inputDesc[getSpecDecodingParentsIdx()].dims.d[1];
+        ssm_params.spec_parent_ptr = static_cast<int const*>(inputs[getSpecDecodingParentsIdx()]);
+        ssm_params.state_snapshot_ptr = const_cast<void*>(inputs[getStateSnapshotsIdx()]);
+    }
 
-    if (reqTypes[0] == RequestType::kCONTEXT)
+    if (isContext)
     {
         if (mIsMamba2)
         {
@@ -418,7 +452,7 @@ size_t SelectiveScanPlugin::getSerializationSize() const noexcept
 {
     return sizeof(mDim) + sizeof(mDState) + sizeof(mDtRank) + sizeof(mNHeads) + sizeof(mNGroups) + sizeof(mChunkSize)
         + sizeof(mDeltaSoftplus) + sizeof(mType) + sizeof(mRemovePadding) + sizeof(mPagedState) + sizeof(mZEnabled)
-        + sizeof(mIsMamba2);
+        + sizeof(mIsMamba2) + sizeof(mChunkedContext) + sizeof(mSpecDecoding);
 }
 
 void SelectiveScanPlugin::serialize(void* buffer) const noexcept
@@ -436,6 +470,8 @@ void SelectiveScanPlugin::serialize(void* buffer) const noexcept
     write(d, mPagedState);
     write(d, mZEnabled);
     write(d, mIsMamba2);
+    write(d, mChunkedContext);
+    write(d, mSpecDecoding);
     TLLM_CHECK(d == a + getSerializationSize());
 }
 
@@ -462,6 +498,8 @@ SelectiveScanPluginCreator::SelectiveScanPluginCreator()
     mPluginAttributes.emplace_back(PluginField("paged_state", nullptr, PluginFieldType::kINT8, 1));
     mPluginAttributes.emplace_back(PluginField("z_enabled", nullptr, PluginFieldType::kINT8, 1));
     mPluginAttributes.emplace_back(PluginField("is_mamba2", nullptr, PluginFieldType::kINT8, 1));
+    mPluginAttributes.emplace_back(PluginField("chunked_context", nullptr, PluginFieldType::kINT8, 1));
+    mPluginAttributes.emplace_back(PluginField("spec_decoding", nullptr, PluginFieldType::kINT8, 1));
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
 }
@@ -495,6 +533,8 @@ IPluginV2* SelectiveScanPluginCreator::createPlugin(char const* name, PluginFiel
     bool pagedState{};
     bool zEnabled{};
     bool isMamab2{};
+    bool chunkedContext{};
+    bool specDecoding{};
     nvinfer1::DataType type{};
     // Read configurations from each fields
     for (int i = 0; i < fc->nbFields; ++i)
@@ -560,11 +600,21 @@ IPluginV2* SelectiveScanPluginCreator::createPlugin(char const* name, PluginFiel
             TLLM_CHECK(fields[i].type == PluginFieldType::kINT8);
             isMamab2 = static_cast<bool>(*(static_cast<bool const*>(fields[i].data)));
         }
+        else if (!strcmp(attrName, "chunked_context"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT8);
+            chunkedContext = static_cast<bool>(*(static_cast<bool const*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "spec_decoding"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT8);
+            specDecoding = static_cast<bool>(*(static_cast<bool const*>(fields[i].data)));
+        }
     }
     try
     {
         auto* obj = new SelectiveScanPlugin(dim, dstate, dtRank, nHeads, nGroups, chunkSize, deltaSoftplus, type,
-            removePadding, pagedState, zEnabled, isMamab2);
+            removePadding, pagedState, zEnabled, isMamab2, chunkedContext, specDecoding);
         obj->setPluginNamespace(mNamespace.c_str());
         return obj;
     }
@@ -45,6 +45,13 @@ namespace tensorrt_llm::plugins
 //     9.  host_context_lengths [batch_size] int32, optional for remove_input_padding
 //    10.  state_slot_mapping [batch_size] int32, optional for paged state
 //    11.  z [batch_size, seq_len, dim] or [num_tokens, dim] for remove_input_padding
+//    12.  has_initial_state [batch_size] int32, optional for chunked_context. Nonzero for the context chunks that
+//         continue from the state in the cache, and for the generation requests of mixed batches.
+//    13.  spec_decoding_parents [batch_size, num_spec_tokens] int32, optional for spec_decoding. The position of the
+//         token each token of a generation request continues from, -1 for the state in the cache.
+//    14.  state_snapshots [batch_size, num_spec_tokens, dstate, dim] for mamba, [batch_size, num_spec_tokens, nheads,
+//         dstate, dim] for mamba2, optional for spec_decoding. The states after every token of the generation
+//         requests, the state in the cache is left as it was.
 // outputs
 //     0. output_tensor [batch_size, seq_len, dim] or [num_tokens, dim] for remove_input_padding
 //     1. state, [batch_size, dstate, dim] for mamba, [batch_size, nheads, dstate, dim] for mamba2
@@ -53,7 +60,8 @@ class SelectiveScanPlugin : public BasePlugin
 {
 public:
     SelectiveScanPlugin(int dim, int dstate, int dtRank, int nHeads, int nGroups, int chunkSize, bool deltaSoftplus,
-        nvinfer1::DataType type, bool removePadding, bool pagedState, bool zEnabled, bool isMamba2);
+        nvinfer1::DataType type, bool removePadding, bool pagedState, bool zEnabled, bool isMamba2,
+        bool chunkedContext = false, bool specDecoding = false);
 
     SelectiveScanPlugin(void const* data, size_t length);
 
@@ -167,6 +175,21 @@ private:
             return getSlotMappingIdx();
     };
 
+    IndexType getHasInitialStateIdx() const
+    {
+        return getZIdx() + 1;
+    };
+
+    IndexType getSpecDecodingParentsIdx() const
+    {
+        return mChunkedContext ? getHasInitialStateIdx() + 1 : getHasInitialStateIdx();
+    };
+
+    IndexType getStateSnapshotsIdx() const
+    {
+        return getSpecDecodingParentsIdx() + 1;
+    };
+
     void setSSMParams(tensorrt_llm::kernels::SSMParamsBase& params,
         // sizes
         const size_t batch, const size_t dim, const size_t maxSeqLen, const size_t numTokens, const size_t dstate,
@@ -189,6 +212,8 @@ private:
     bool mPagedState = false;
     bool mZEnabled = true;
     bool mIsMamba2 = false;
+    bool mChunkedContext = false;
+    bool mSpecDecoding = false;
     std::shared_ptr<tensorrt_llm::common::CUDADriverWrapper> mDriver;
 };
 
@@ -74,6 +74,11 @@ protected:
 
     std::vector<Config> getTactics(int m, int n, int k) const override;
 
+    std::optional<std::string> getTacticCacheKey() const override
+    {
+        return std::to_string(mQuantAlgo) + "," + std::to_string(mGroupSize);
+    }
+
 private:
     int mQuantAlgo;
     int mGroupSize;
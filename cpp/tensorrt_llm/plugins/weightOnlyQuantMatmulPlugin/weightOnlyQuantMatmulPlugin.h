@@ -74,6 +74,11 @@ protected:
 
     std::vector<Config> getTactics(int m, int n, int k) const override;
 
+    std::optional<std::string> getTacticCacheKey() const override
+    {
+        return std::to_string(static_cast<int>(mWeightTypeId));
+    }
+
 private:
     WeightTypeId mWeightTypeId;
 };
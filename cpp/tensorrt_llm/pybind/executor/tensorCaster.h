@@ -21,6 +21,7 @@
 #include "tensorrt_llm/pybind/common/customCasters.h"
 #include "tensorrt_llm/runtime/torch.h"
 #include "tensorrt_llm/runtime/torchView.h"
+#include <ATen/DLConvertor.h>
 #include <pybind11/pybind11.h>
 #include <torch/extension.h>
 
@@ -36,6 +37,8 @@ public:
     PYBIND11_TYPE_CASTER(tensorrt_llm::executor::Tensor, _("torch.Tensor"));
 
     // Convert PyObject(torch.Tensor) -> tensorrt_llm::executor::Tensor
+    // Any object implementing __dlpack__ (numpy, cupy, jax, ...) or a "dltensor" capsule is imported without a copy,
+    // the memory is freed by its producer once the last executor::Tensor referencing it is gone.
     bool load(handle src, bool)
     {
         PyObject* obj = src.ptr();
@@ -45,6 +48,14 @@ public:
             value = tensorrt_llm::executor::detail::ofITensor(tensorrt_llm::runtime::TorchView::of(t));
             return true;
         }
+        if (PyCapsule_IsValid(obj, kDlTensorName))
+        {
+            return loadDlPack(reinterpret_borrow<object>(src));
+        }
+        if (hasattr(src, "__dlpack__"))
+        {
+            return loadDlPack(src.attr("__dlpack__")());
+        }
         return false;
     }
 
@@ -53,6 +64,31 @@ public:
     {
         return THPVariable_Wrap(tensorrt_llm::runtime::Torch::tensor(tensorrt_llm::executor::detail::toITensor(src)));
     }
+
+private:
+    static constexpr char const* kDlTensorName = "dltensor";
+    static constexpr char const* kUsedDlTensorName = "used_dltensor";
+
+    bool loadDlPack(object const& capsule)
+    {
+        auto* managed = static_cast<DLManagedTensor*>(PyCapsule_GetPointer(capsule.ptr(), kDlTensorName));
+        if (managed == nullptr)
+        {
+            PyErr_Clear();
+            return false;
+        }
+        // Renaming the capsule hands the ownership of the managed tensor over to the at::Tensor, whose deleter calls
+        // the one of the producer. The producer keeps its buffer alive until then.
+        PyCapsule_SetName(capsule.ptr(), kUsedDlTensorName);
+        auto tensor = at::fromDLPack(managed);
+        // TorchView needs a dense tensor, only strided views are copied.
+        if (!tensor.is_contiguous())
+        {
+            tensor = tensor.contiguous();
+        }
+        value = tensorrt_llm::executor::detail::ofITensor(tensorrt_llm::runtime::TorchView::of(tensor));
+        return true;
+    }
 };
 
 } // namespace detail
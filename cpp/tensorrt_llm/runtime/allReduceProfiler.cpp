@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tensorrt_llm/runtime/allReduceProfiler.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/ncclCommunicator.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <sstream>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+
+using kernels::AllReduceStrategyConfig;
+using kernels::AllReduceStrategyType;
+using tensorrt_llm::utils::customAllReduceUtils::AllReduceStrategyProfile;
+using tensorrt_llm::utils::customAllReduceUtils::AllReduceTopology;
+
+SizeType32 constexpr kNumWarmupRuns = 5;
+SizeType32 constexpr kNumRuns = 10;
+
+std::vector<AllReduceProfiler::Candidate> getCandidates()
+{
+    std::vector<AllReduceProfiler::Candidate> candidates{{AllReduceStrategyType::NCCL}};
+    // PUSH_MODE needs a workspace of tpSize messages, which is not allocated for deterministic all-reduce.
+    for (auto const strategy : {AllReduceStrategyType::ONESHOT, AllReduceStrategyType::TWOSHOT})
+    {
+        for (auto const config : {AllReduceStrategyConfig{0}, AllReduceStrategyConfig::USE_MEMCPY,
+                 AllReduceStrategyConfig::PUSH_MODE})
+        {
+            candidates.push_back({strategy, config});
+        }
+    }
+    return candidates;
+}
+
+bool isSameChoice(AllReduceProfiler::Candidate const& lhs, AllReduceProfiler::Candidate const& rhs)
+{
+    return lhs.strategy == rhs.strategy && lhs.config == rhs.config;
+}
+
+} // namespace
+
+AllReduceProfiler::AllReduceProfiler(
+    AllReduceBuffers& buffers, BufferManager const& manager, WorldConfig const& worldConfig)
+    : mBuffers{buffers}
+    , mManager{manager}
+    , mWorldConfig{worldConfig}
+    , mTpComm{COMM_SESSION.split(worldConfig.getContextParallelRank()
+                      + worldConfig.getContextParallelism() * worldConfig.getPipelineParallelRank(),
+          worldConfig.getTensorParallelRank())}
+    , mNccl{std::make_unique<NcclCommunicator>(
+          worldConfig.getTensorParallelism(), worldConfig.getTensorParallelRank(), mTpComm)}
+{
+}
+
+AllReduceProfiler::~AllReduceProfiler() = default;
+
+float AllReduceProfiler::time(Candidate const& candidate, nvinfer1::DataType dtype, SizeType32 numTokens,
+    SizeType32 hiddenSize, IBuffer& input, IBuffer& output) const
+{
+    auto const& stream = mManager.getStream();
+    auto const tpSize = static_cast<std::size_t>(mWorldConfig.getTensorParallelism());
+    auto const tpRank = static_cast<std::size_t>(mWorldConfig.getTensorParallelRank());
+    auto const numElements = static_cast<std::size_t>(numTokens) * hiddenSize;
+
+    auto const run = [&]()
+    {
+        if (candidate.strategy == AllReduceStrategyType::NCCL)
+        {
+            mNccl->allReduce(input.data(), output.data(), numElements, dtype, stream);
+            return;
+        }
+        // Advances the barrier flag in the workspace like the plugins do, so they stay in sync after tuning.
+        auto params = kernels::AllReduceParams::deserialize(bufferCast<std::int64_t>(*mBuffers.mAllReduceCommPtrs),
+            tpSize, tpRank, dtype, numTokens, hiddenSize, kernels::AllReduceFusionOp::NONE);
+        params.local_input_buffer_ptr = input.data();
+        params.local_output_buffer_ptr = output.data();
+        params.elts_total = numElements;
+        auto const config = candidate.config.value_or(AllReduceStrategyConfig{0});
+        kernels::customAllReduce(
+            params, dtype, candidate.strategy, config, kernels::AllReduceFusionOp::NONE, stream.get());
+    };
+
+    for (SizeType32 i = 0; i < kNumWarmupRuns; ++i)
+    {
+        run();
+    }
+    CudaEvent start{static_cast<unsigned int>(cudaEventDefault)};
+    CudaEvent stop{static_cast<unsigned int>(cudaEventDefault)};
+    stream.record(start);
+    for (SizeType32 i = 0; i < kNumRuns; ++i)
+    {
+        run();
+    }
+    stream.record(stop);
+    stop.synchronize();
+    float elapsedMs{0};
+    TLLM_CUDA_CHECK(cudaEventElapsedTime(&elapsedMs, start.get(), stop.get()));
+    return elapsedMs / kNumRuns;
+}
+
+std::vector<AllReduceProfiler::Measurement> AllReduceProfiler::measure(
+    nvinfer1::DataType dtype, SizeType32 hiddenSize, std::size_t maxMessageBytes) const
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    auto const tpSize = static_cast<std::size_t>(mWorldConfig.getTensorParallelism());
+    auto const elementSize = BufferDataType(dtype).getSize();
+    auto const maxNumTokens
+        = static_cast<SizeType32>(maxMessageBytes / (static_cast<std::size_t>(hiddenSize) * elementSize));
+    TLLM_CHECK_WITH_INFO(maxNumTokens > 0, "The all-reduce workspace cannot hold a single token");
+
+    auto input = mManager.gpu(static_cast<std::size_t>(maxNumTokens) * hiddenSize, dtype);
+    auto output = mManager.gpu(static_cast<std::size_t>(maxNumTokens) * hiddenSize, dtype);
+    mManager.setZero(*input);
+
+    auto const candidates = getCandidates();
+    bool const forceDeterministic = common::getEnvForceDeterministicAllReduce();
+    std::vector<Measurement> measurements;
+    for (SizeType32 numTokens = 1; numTokens <= maxNumTokens; numTokens *= 2)
+    {
+        auto const numElements = static_cast<std::size_t>(numTokens) * hiddenSize;
+        // Same candidates on every rank, the kernels synchronize the group.
+        std::vector<Candidate> supported;
+        for (auto const& candidate : candidates)
+        {
+            if (candidate.strategy == AllReduceStrategyType::NCCL
+                || (kernels::configurationSupported(candidate.strategy, numElements, tpSize, dtype)
+                    && !(forceDeterministic && candidate.config == AllReduceStrategyConfig::PUSH_MODE)))
+            {
+                supported.push_back(candidate);
+            }
+        }
+        std::vector<float> times;
+        for (auto const& candidate : supported)
+        {
+            times.push_back(time(candidate, dtype, numTokens, hiddenSize, *input, *output));
+        }
+        std::vector<float> maxTimes(times.size());
+        mTpComm.allreduce(times.data(), maxTimes.data(), static_cast<int>(times.size()), mpi::MpiType::kFLOAT,
+            mpi::MpiOp::MAX);
+        for (std::size_t i = 0; i < supported.size(); ++i)
+        {
+            measurements.push_back({numElements * elementSize, supported[i], maxTimes[i]});
+        }
+    }
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+    return measurements;
+}
+
+AllReduceStrategyProfile AllReduceProfiler::makeProfile(
+    std::vector<Measurement> const& measurements, SizeType32 tpSize)
+{
+    // Fastest candidate per message size, sizes in increasing order.
+    std::vector<Measurement> fastest;
+    for (auto const& measurement : measurements)
+    {
+        auto it = std::find_if(fastest.begin(), fastest.end(),
+            [&measurement](Measurement const& other) { return other.messageBytes == measurement.messageBytes; });
+        if (it == fastest.end())
+        {
+            fastest.push_back(measurement);
+        }
+        else if (measurement.timeMs < it->timeMs)
+        {
+            *it = measurement;
+        }
+    }
+    std::sort(fastest.begin(), fastest.end(),
+        [](Measurement const& lhs, Measurement const& rhs) { return lhs.messageBytes < rhs.messageBytes; });
+
+    // A measured size decides for the messages above the previous one. Neighbours with the same choice are merged.
+    std::vector<AllReduceStrategyProfile::Rule> tunedRules;
+    for (auto const& measurement : fastest)
+    {
+        auto const& candidate = measurement.candidate;
+        if (!tunedRules.empty() && isSameChoice({tunedRules.back().strategy, tunedRules.back().config}, candidate))
+        {
+            tunedRules.back().maxMessageBytes = measurement.messageBytes + 1;
+            continue;
+        }
+        tunedRules.push_back(
+            {AllReduceTopology::kPCIE, tpSize, measurement.messageBytes + 1, candidate.strategy, candidate.config});
+    }
+
+    // The fingerprint pins the topology of the group, so the rules apply to all intra-node topologies.
+    std::vector<AllReduceStrategyProfile::Rule> rules;
+    for (auto const topology : {AllReduceTopology::kPCIE, AllReduceTopology::kNVLINK, AllReduceTopology::kNVSWITCH})
+    {
+        for (auto rule : tunedRules)
+        {
+            rule.topology = topology;
+            rules.push_back(rule);
+        }
+    }
+    auto const& defaultRules = AllReduceStrategyProfile::getDefault().getRules();
+    rules.insert(rules.end(), defaultRules.begin(), defaultRules.end());
+    return AllReduceStrategyProfile{std::move(rules)};
+}
+
+std::string AllReduceProfiler::getHardwareFingerprint(WorldConfig const& worldConfig)
+{
+    auto const device = worldConfig.getDevice();
+    cudaDeviceProp properties{};
+    TLLM_CUDA_CHECK(cudaGetDeviceProperties(&properties, device));
+    int clockRateKHz{0};
+    int memoryClockRateKHz{0};
+    TLLM_CUDA_CHECK(cudaDeviceGetAttribute(&clockRateKHz, cudaDevAttrClockRate, device));
+    TLLM_CUDA_CHECK(cudaDeviceGetAttribute(&memoryClockRateKHz, cudaDevAttrMemoryClockRate, device));
+    int driverVersion{0};
+    TLLM_CUDA_CHECK(cudaDriverGetVersion(&driverVersion));
+
+    std::ostringstream fingerprint;
+    fingerprint << properties.name << " sm" << properties.major << properties.minor << " x"
+                << properties.multiProcessorCount << " " << clockRateKHz << "kHz " << memoryClockRateKHz
+                << "kHz driver " << driverVersion << " tp" << worldConfig.getTensorParallelism() << " links";
+    // Links of every pair in the group, so that every rank computes the same fingerprint.
+    auto const group = worldConfig.getTensorParallelGroup();
+    for (std::size_t i = 0; i < group.size(); ++i)
+    {
+        for (std::size_t j = i + 1; j < group.size(); ++j)
+        {
+            auto const src = worldConfig.getDeviceOf(group[i]);
+            auto const dst = worldConfig.getDeviceOf(group[j]);
+            int accessSupported{0};
+            int performanceRank{0};
+            if (src != dst)
+            {
+                TLLM_CUDA_CHECK(cudaDeviceGetP2PAttribute(&accessSupported, cudaDevP2PAttrAccessSupported, src, dst));
+                TLLM_CUDA_CHECK(
+                    cudaDeviceGetP2PAttribute(&performanceRank, cudaDevP2PAttrPerformanceRank, src, dst));
+            }
+            fingerprint << " " << accessSupported << ":" << performanceRank;
+        }
+    }
+    return fingerprint.str();
+}
+
+void tuneAllReduceStrategies(AllReduceBuffers& buffers, BufferManager const& manager, WorldConfig const& worldConfig,
+    nvinfer1::DataType dtype, SizeType32 hiddenSize, std::size_t maxMessageBytes)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    auto const cacheDir = common::getEnvAllReduceAutotuneCacheDir();
+    auto const tpSize = worldConfig.getTensorParallelism();
+    if (cacheDir.empty() || tpSize == 1 || common::getEnvForceDeterministicAllReduce())
+    {
+        return;
+    }
+    // The workspace is not shared without peer access, and AUTO always selects NCCL then.
+    auto const commPtrs = BufferRange<void*>(*buffers.mAllReduceCommPtrs);
+    if (std::any_of(commPtrs.begin(), commPtrs.begin() + tpSize, [](void* ptr) { return ptr == nullptr; }))
+    {
+        return;
+    }
+
+    std::ostringstream key;
+    key << AllReduceProfiler::getHardwareFingerprint(worldConfig) << " dtype " << static_cast<int>(dtype) << " hidden "
+        << hiddenSize << " max " << maxMessageBytes;
+    auto const header = "# " + key.str();
+    auto const path = std::filesystem::path{cacheDir}
+        / ("allreduce_" + std::to_string(std::hash<std::string>{}(key.str())) + ".profile");
+
+    // Every rank of the group must measure if one does, as the kernels synchronize the group.
+    std::optional<AllReduceStrategyProfile> profile;
+    if (std::ifstream file{path}; file.is_open())
+    {
+        std::string firstLine;
+        if (std::getline(file, firstLine) && firstLine == header)
+        {
+            profile = AllReduceStrategyProfile::load(file);
+        }
+    }
+    auto const tpGroupId = worldConfig.getContextParallelRank()
+        + worldConfig.getContextParallelism() * worldConfig.getPipelineParallelRank();
+    auto const tpComm = COMM_SESSION.split(tpGroupId, worldConfig.getTensorParallelRank());
+    std::int32_t const isCached = profile.has_value() ? 1 : 0;
+    std::int32_t allCached{0};
+    tpComm.allreduce(&isCached, &allCached, 1, mpi::MpiType::kINT32, mpi::MpiOp::MIN);
+    if (allCached == 1)
+    {
+        TLLM_LOG_INFO("Loaded the tuned all-reduce strategy profile %s", path.c_str());
+    }
+    else
+    {
+        TLLM_LOG_INFO("Tuning the all-reduce strategies for %s", key.str().c_str());
+        AllReduceProfiler const profiler{buffers, manager, worldConfig};
+        profile = AllReduceProfiler::makeProfile(profiler.measure(dtype, hiddenSize, maxMessageBytes), tpSize);
+        if (worldConfig.getTensorParallelRank() == 0)
+        {
+            std::filesystem::create_directories(cacheDir);
+            std::ofstream file{path};
+            if (file.is_open())
+            {
+                file << header << '\n';
+                profile->save(file);
+                TLLM_LOG_INFO("Saved the tuned all-reduce strategy profile %s", path.c_str());
+            }
+            else
+            {
+                TLLM_LOG_WARNING("Cannot write the all-reduce strategy profile %s", path.c_str());
+            }
+        }
+    }
+    AllReduceStrategyProfile::setActive(std::move(*profile));
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "tensorrt_llm/common/customAllReduceUtils.h"
+#include "tensorrt_llm/common/mpiUtils.h"
+#include "tensorrt_llm/kernels/customAllReduceKernels.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/ipcUtils.h"
+#include "tensorrt_llm/runtime/worldConfig.h"
+
+#include <NvInferRuntime.h>
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+class NcclCommunicator;
+
+// Measures the all-reduce strategies on the workspace of the engine, to tune the strategy profile of AUTO on the
+// system it runs on. Every rank times the same candidates and the slowest rank counts, so all ranks of the tensor
+// parallel group select the same strategies.
+class AllReduceProfiler
+{
+public:
+    struct Candidate
+    {
+        kernels::AllReduceStrategyType strategy;
+        std::optional<kernels::AllReduceStrategyConfig> config{std::nullopt};
+    };
+
+    struct Measurement
+    {
+        std::size_t messageBytes;
+        Candidate candidate;
+        float timeMs;
+    };
+
+    AllReduceProfiler(AllReduceBuffers& buffers, BufferManager const& manager, WorldConfig const& worldConfig);
+    ~AllReduceProfiler();
+
+    // Time every candidate on messages of [numTokens, hiddenSize] elements of dtype, for numTokens = 1, 2, 4, ...
+    // while the message fits into maxMessageBytes.
+    [[nodiscard]] std::vector<Measurement> measure(
+        nvinfer1::DataType dtype, SizeType32 hiddenSize, std::size_t maxMessageBytes) const;
+
+    // Profile that selects the fastest candidate up to every measured size, with the default rules for other groups.
+    [[nodiscard]] static tensorrt_llm::utils::customAllReduceUtils::AllReduceStrategyProfile makeProfile(
+        std::vector<Measurement> const& measurements, SizeType32 tpSize);
+
+    // Identifies the GPUs, the driver and the links within the tensor parallel group. Equal on all ranks of the group.
+    [[nodiscard]] static std::string getHardwareFingerprint(WorldConfig const& worldConfig);
+
+private:
+    [[nodiscard]] float time(Candidate const& candidate, nvinfer1::DataType dtype, SizeType32 numTokens,
+        SizeType32 hiddenSize, IBuffer& input, IBuffer& output) const;
+
+    AllReduceBuffers& mBuffers;
+    BufferManager const& mManager;
+    WorldConfig const& mWorldConfig;
+    mpi::MpiComm mTpComm;
+    std::unique_ptr<NcclCommunicator> mNccl;
+};
+
+// Make AUTO use a profile tuned for this system. The profile is loaded from TRTLLM_ALLREDUCE_AUTOTUNE_CACHE_DIR if it
+// was measured before with the same hardware fingerprint and message sizes, and measured and cached otherwise. Does
+// nothing if the cache directory is not set or the custom kernels cannot run on the group.
+void tuneAllReduceStrategies(AllReduceBuffers& buffers, BufferManager const& manager, WorldConfig const& worldConfig,
+    nvinfer1::DataType dtype, SizeType32 hiddenSize, std::size_t maxMessageBytes);
+
+} // namespace tensorrt_llm::runtime
@@ -15,8 +15,10 @@
  */
 #include "bufferManager.h"
 #include "cudaMemPool.h"
+#include "scratchArena.h"
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
 #include "tllmBuffers.h"
 
 #include <cstring>
@@ -30,6 +32,7 @@ namespace tensorrt_llm::runtime
 
 BufferManager::BufferManager(CudaStreamPtr stream, bool trimPool)
     : mStream{std::move(stream)}
+    , mScratch{std::make_shared<ScratchArena>()}
     , mTrimPool{trimPool}
 {
     TLLM_CHECK_WITH_INFO(static_cast<bool>(mStream), "Undefined CUDA stream");
@@ -56,6 +59,59 @@ BufferManager::ITensorPtr BufferManager::gpu(nvinfer1::Dims dims, nvinfer1::Data
     return gpuSync(dims, type);
 }
 
+BufferManager::IBufferPtr BufferManager::scratch(std::size_t size, nvinfer1::DataType type) const
+{
+    auto const sizeInBytes = size * BufferDataType(type).getSizeInBits() / 8;
+    if (auto* ptr = mScratch->allocate(sizeInBytes))
+    {
+        return std::make_unique<GenericBuffer<GpuBorrowingAllocator>>(
+            size, type, GpuBorrowingAllocator(ptr, sizeInBytes));
+    }
+    return gpu(size, type);
+}
+
+BufferManager::ITensorPtr BufferManager::scratch(nvinfer1::Dims dims, nvinfer1::DataType type) const
+{
+    auto const size = ITensor::volumeNonNegative(dims);
+    auto const sizeInBytes = size * BufferDataType(type).getSizeInBits() / 8;
+    if (auto* ptr = mScratch->allocate(sizeInBytes))
+    {
+        return std::make_unique<GenericTensor<GpuBorrowingAllocator>>(
+            dims, type, GpuBorrowingAllocator(ptr, sizeInBytes));
+    }
+    return gpu(dims, type);
+}
+
+void BufferManager::resetScratch() const
+{
+    if (auto const size = mScratch->reset())
+    {
+        TLLM_LOG_DEBUG("Growing the scratch arena from %zu to %zu bytes", mScratch->getCapacity(), *size);
+        // The release of the previous slab is ordered after the work of the step on the stream.
+        mScratch->setSlab(nullptr);
+        mScratch->setSlab(gpu(*size));
+    }
+}
+
+void BufferManager::reserveScratch(std::size_t size) const
+{
+    if (size > mScratch->getCapacity())
+    {
+        mScratch->setSlab(nullptr);
+        mScratch->setSlab(gpu(size));
+    }
+}
+
+std::size_t BufferManager::scratchCapacity() const
+{
+    return mScratch->getCapacity();
+}
+
+std::size_t BufferManager::scratchUsed() const
+{
+    return mScratch->getUsed();
+}
+
 BufferManager::IBufferPtr BufferManager::gpuSync(std::size_t size, nvinfer1::DataType type)
 {
     return std::make_unique<StaticDeviceBuffer>(size, type, CudaAllocator{});
@@ -88,11 +144,19 @@ BufferManager::ITensorPtr BufferManager::pinned(nvinfer1::Dims dims, nvinfer1::D
 
 BufferManager::IBufferPtr BufferManager::pinnedPool(std::size_t size, nvinfer1::DataType type)
 {
+    if (common::getEnvPinnedPoolSizeClasses())
+    {
+        return std::make_unique<PinnedSizeClassPoolBuffer>(size, type);
+    }
     return std::make_unique<PinnedPoolBuffer>(size, type);
 }
 
 BufferManager::ITensorPtr BufferManager::pinnedPool(nvinfer1::Dims dims, nvinfer1::DataType type)
 {
+    if (common::getEnvPinnedPoolSizeClasses())
+    {
+        return std::make_unique<PinnedSizeClassPoolTensor>(dims, type);
+    }
     return std::make_unique<PinnedPoolTensor>(dims, type);
 }
 
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/cudaGraphCache.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+std::vector<SizeType32> getPowerOfTwoSizes(SizeType32 unit, SizeType32 maxSize)
+{
+    std::vector<SizeType32> sizes;
+    for (SizeType32 size = unit; size < maxSize; size *= 2)
+    {
+        sizes.push_back(size);
+    }
+    sizes.push_back(maxSize);
+    return sizes;
+}
+
+std::optional<SizeType32> roundUp(std::vector<SizeType32> const& sizes, SizeType32 size)
+{
+    if (size == 0)
+    {
+        return 0;
+    }
+    auto const it = std::lower_bound(sizes.begin(), sizes.end(), size);
+    return it == sizes.end() ? std::nullopt : std::optional<SizeType32>{*it};
+}
+} // namespace
+
+CudaGraphBuckets::CudaGraphBuckets(
+    SizeType32 maxNumGenRequests, SizeType32 maxNumContextTokens, SizeType32 contextTokenGranularity)
+{
+    TLLM_CHECK(maxNumGenRequests > 0 && maxNumContextTokens > 0 && contextTokenGranularity > 0);
+    auto const maxContextTokens
+        = (maxNumContextTokens + contextTokenGranularity - 1) / contextTokenGranularity * contextTokenGranularity;
+    mGenRequestSizes = getPowerOfTwoSizes(1, maxNumGenRequests);
+    mContextTokenSizes = getPowerOfTwoSizes(contextTokenGranularity, maxContextTokens);
+}
+
+std::optional<CudaGraphBucket> CudaGraphBuckets::select(SizeType32 numGenRequests, SizeType32 numContextTokens) const
+{
+    auto const genRequests = roundUp(mGenRequestSizes, numGenRequests);
+    auto const contextTokens = roundUp(mContextTokenSizes, numContextTokens);
+    if (!genRequests.has_value() || !contextTokens.has_value())
+    {
+        return std::nullopt;
+    }
+    return CudaGraphBucket{*genRequests, *contextTokens};
+}
+
+std::vector<CudaGraphBucket> CudaGraphBuckets::getAll() const
+{
+    std::vector<CudaGraphBucket> buckets;
+    for (auto const numContextTokens : mContextTokenSizes)
+    {
+        buckets.push_back({0, numContextTokens});
+    }
+    for (auto const numGenRequests : mGenRequestSizes)
+    {
+        buckets.push_back({numGenRequests, 0});
+        for (auto const numContextTokens : mContextTokenSizes)
+        {
+            buckets.push_back({numGenRequests, numContextTokens});
+        }
+    }
+    return buckets;
+}
+
+CudaGraphCache::CudaGraphCache(SizeType32 capacity)
+    : mCapacity{capacity}
+{
+    TLLM_CHECK_WITH_INFO(capacity > 0, "The CUDA graph cache needs room for at least one graph");
+}
+
+CudaGraphCache::~CudaGraphCache()
+{
+    try
+    {
+        clear();
+    }
+    catch (std::exception& e)
+    {
+        TLLM_LOG_EXCEPTION(e);
+    }
+}
+
+CudaGraphCache::KeyType CudaGraphCache::getKey(CudaGraphBucket const& bucket) noexcept
+{
+    return (static_cast<KeyType>(static_cast<std::uint32_t>(bucket.numGenRequests)) << 32)
+        | static_cast<std::uint32_t>(bucket.numContextTokens);
+}
+
+bool CudaGraphCache::contains(CudaGraphBucket const& bucket) const
+{
+    return mEntriesByKey.count(getKey(bucket)) != 0;
+}
+
+void CudaGraphCache::run(CudaGraphBucket const& bucket, CudaStream const& stream, std::function<void()> const& enqueue)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    cudaGraph_t graph;
+    TLLM_CUDA_CHECK(cudaStreamBeginCapture(stream.get(), cudaStreamCaptureModeThreadLocal));
+    enqueue();
+    TLLM_CUDA_CHECK(cudaStreamEndCapture(stream.get(), &graph));
+
+    auto const entry = getOrCreate(getKey(bucket), graph);
+    TLLM_CUDA_CHECK(cudaGraphDestroy(graph));
+    TLLM_CUDA_CHECK(cudaGraphLaunch(entry->second, stream.get()));
+    ++mStats.numLaunches;
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
+std::list<CudaGraphCache::Entry>::iterator CudaGraphCache::getOrCreate(KeyType key, cudaGraph_t graph)
+{
+    auto const found = mEntriesByKey.find(key);
+    if (found != mEntriesByKey.end())
+    {
+        auto const entry = found->second;
+        mEntries.splice(mEntries.begin(), mEntries, entry);
+        if (cudaGraphExecUpdate(entry->second, graph, nullptr) == cudaSuccess)
+        {
+            ++mStats.numUpdates;
+            return entry;
+        }
+        // The topology changed, e.g. another plugin path was taken. Reset the error and instantiate again.
+        static_cast<void>(cudaGetLastError());
+        TLLM_CUDA_CHECK(cudaGraphExecDestroy(entry->second));
+        TLLM_CUDA_CHECK(cudaGraphInstantiate(&entry->second, graph, nullptr, nullptr, 0));
+        ++mStats.numInstantiations;
+        return entry;
+    }
+
+    if (static_cast<SizeType32>(mEntries.size()) >= mCapacity)
+    {
+        TLLM_CUDA_CHECK(cudaGraphExecDestroy(mEntries.back().second));
+        mEntriesByKey.erase(mEntries.back().first);
+        mEntries.pop_back();
+        ++mStats.numEvictions;
+    }
+    cudaGraphExec_t instance;
+    TLLM_CUDA_CHECK(cudaGraphInstantiate(&instance, graph, nullptr, nullptr, 0));
+    ++mStats.numInstantiations;
+    mEntries.emplace_front(key, instance);
+    mEntriesByKey.emplace(key, mEntries.begin());
+    return mEntries.begin();
+}
+
+void CudaGraphCache::clear()
+{
+    for (auto const& [key, instance] : mEntries)
+    {
+        TLLM_CUDA_CHECK(cudaGraphExecDestroy(instance));
+    }
+    mEntries.clear();
+    mEntriesByKey.clear();
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+
+#include <cuda_runtime_api.h>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Padded shape of a batch that mixes generation requests with context tokens.
+struct CudaGraphBucket
+{
+    SizeType32 numGenRequests;
+    SizeType32 numContextTokens;
+
+    [[nodiscard]] bool operator==(CudaGraphBucket const& other) const noexcept
+    {
+        return numGenRequests == other.numGenRequests && numContextTokens == other.numContextTokens;
+    }
+};
+
+/// @brief The shapes CUDA graphs are captured for.
+/// @details The number of generation requests is rounded up to a power of two, the number of context tokens to a
+/// power of two multiple of the granularity, which bounds the padding to less than half of a bucket and the number of
+/// graphs to the logarithm of the limits. A batch is padded to its bucket with dummy generation requests and a dummy
+/// context chunk, the same way generation batches are padded for the existing CUDA graph mode.
+class CudaGraphBuckets
+{
+public:
+    /// @param contextTokenGranularity Smallest context bucket, usually the chunk unit size.
+    CudaGraphBuckets(
+        SizeType32 maxNumGenRequests, SizeType32 maxNumContextTokens, SizeType32 contextTokenGranularity);
+
+    /// @brief Smallest bucket holding the batch, not set if it exceeds the limits, in which case it runs eagerly.
+    [[nodiscard]] std::optional<CudaGraphBucket> select(SizeType32 numGenRequests, SizeType32 numContextTokens) const;
+
+    /// @brief Every bucket, smallest first, e.g. to capture the graphs during warmup.
+    [[nodiscard]] std::vector<CudaGraphBucket> getAll() const;
+
+private:
+    std::vector<SizeType32> mGenRequestSizes;
+    std::vector<SizeType32> mContextTokenSizes;
+};
+
+/// @brief Captured executable graphs of the engine, one per bucket, with least recently used eviction.
+/// @details Every step is captured again and the executable graph of its bucket is updated in place, which is much
+/// cheaper than instantiating it and keeps the graph in sync with buffer addresses that change between steps.
+class CudaGraphCache
+{
+public:
+    struct Stats
+    {
+        std::int64_t numLaunches{0};
+        std::int64_t numUpdates{0};
+        std::int64_t numInstantiations{0};
+        std::int64_t numEvictions{0};
+    };
+
+    explicit CudaGraphCache(SizeType32 capacity);
+
+    ~CudaGraphCache();
+
+    CudaGraphCache(CudaGraphCache const&) = delete;
+    CudaGraphCache& operator=(CudaGraphCache const&) = delete;
+
+    /// @brief Capture the work that enqueue puts on stream and launch it as the graph of bucket.
+    void run(CudaGraphBucket const& bucket, CudaStream const& stream, std::function<void()> const& enqueue);
+
+    [[nodiscard]] bool contains(CudaGraphBucket const& bucket) const;
+
+    void clear();
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+private:
+    using KeyType = std::uint64_t;
+    using Entry = std::pair<KeyType, cudaGraphExec_t>;
+
+    [[nodiscard]] static KeyType getKey(CudaGraphBucket const& bucket) noexcept;
+
+    //! \brief Executable graph of the bucket, most recently used first.
+    std::list<Entry>::iterator getOrCreate(KeyType key, cudaGraph_t graph);
+
+    SizeType32 mCapacity;
+    std::list<Entry> mEntries;
+    std::unordered_map<KeyType, std::list<Entry>::iterator> mEntriesByKey;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/decoderOutputStaging.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+DecoderOutputStaging::TensorPtr pinnedLike(DecoderOutputStaging::TensorPtr const& tensor)
+{
+    return tensor ? BufferManager::pinned(tensor->getShape(), tensor->getDataType()) : nullptr;
+}
+
+void copyToHost(BufferManager const& manager, DecoderOutputStaging::TensorPtr const& device,
+    DecoderOutputStaging::TensorPtr const& host)
+{
+    if (device)
+    {
+        host->reshape(device->getShape());
+        manager.copy(*device, *host);
+    }
+}
+} // namespace
+
+DecoderOutputStaging::DecoderOutputStaging(DeviceOutputs deviceOutputs)
+    : mDeviceOutputs{std::move(deviceOutputs)}
+    , mCopyStream{std::make_shared<CudaStream>()}
+    , mCopyManager{mCopyStream}
+{
+    TLLM_CHECK_WITH_INFO(mDeviceOutputs.newOutputTokens && mDeviceOutputs.sequenceLengths
+            && mDeviceOutputs.finishReasons,
+        "The new tokens, the sequence lengths and the finish reasons of the decoder are all staged");
+    for (auto& slot : mSlots)
+    {
+        slot.outputs.newOutputTokens = pinnedLike(mDeviceOutputs.newOutputTokens);
+        slot.outputs.sequenceLengths = pinnedLike(mDeviceOutputs.sequenceLengths);
+        slot.outputs.finishReasons = pinnedLike(mDeviceOutputs.finishReasons);
+        slot.outputs.cumLogProbs = pinnedLike(mDeviceOutputs.cumLogProbs);
+    }
+}
+
+DecoderOutputStaging::StepIdType DecoderOutputStaging::stage(CudaStream const& forwardStream)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto const slotIdx = static_cast<SizeType32>(mNextStepId % kNumBuffers);
+    auto& slot = mSlots[slotIdx];
+    mSlotDrained.wait(lock, [&slot]() { return !slot.staged; });
+
+    auto const stepId = mNextStepId++;
+    slot.outputs.stepId = stepId;
+
+    CudaEvent stepDone{};
+    forwardStream.record(stepDone);
+    mCopyStream->wait(stepDone);
+    copyToHost(mCopyManager, mDeviceOutputs.newOutputTokens, slot.outputs.newOutputTokens);
+    copyToHost(mCopyManager, mDeviceOutputs.sequenceLengths, slot.outputs.sequenceLengths);
+    copyToHost(mCopyManager, mDeviceOutputs.finishReasons, slot.outputs.finishReasons);
+    copyToHost(mCopyManager, mDeviceOutputs.cumLogProbs, slot.outputs.cumLogProbs);
+    mCopyStream->record(slot.copied);
+    // The next step overwrites the device outputs only once they are copied.
+    forwardStream.wait(slot.copied);
+
+    slot.staged = true;
+    mStaged.push_back(slotIdx);
+    lock.unlock();
+    mSlotStaged.notify_all();
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+    return stepId;
+}
+
+void DecoderOutputStaging::consumeOldest(
+    std::unique_lock<std::mutex>& lock, std::function<void(HostOutputs const&)> const& consume)
+{
+    auto& slot = mSlots[mStaged.front()];
+    mStaged.pop_front();
+    lock.unlock();
+
+    auto const release = [this, &slot]()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mMutex);
+            slot.staged = false;
+        }
+        mSlotDrained.notify_all();
+    };
+    try
+    {
+        slot.copied.synchronize();
+        consume(slot.outputs);
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+    release();
+}
+
+void DecoderOutputStaging::drain(std::function<void(HostOutputs const&)> const& consume)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mSlotStaged.wait(lock, [this]() { return !mStaged.empty(); });
+    consumeOldest(lock, consume);
+}
+
+bool DecoderOutputStaging::tryDrain(std::function<void(HostOutputs const&)> const& consume)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    if (mStaged.empty())
+    {
+        return false;
+    }
+    auto const status = ::cudaEventQuery(mSlots[mStaged.front()].copied.get());
+    if (status == cudaErrorNotReady)
+    {
+        return false;
+    }
+    TLLM_CUDA_CHECK(status);
+    consumeOldest(lock, consume);
+    return true;
+}
+
+SizeType32 DecoderOutputStaging::getNumStaged() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return static_cast<SizeType32>(mStaged.size());
+}
+
+} // namespace tensorrt_llm::runtime
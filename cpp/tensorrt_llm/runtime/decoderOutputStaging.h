@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Double-buffered pinned host staging of the outputs of the decoder steps.
+//! \details The outputs of step N are copied to the pinned buffers N % kNumBuffers on a copy stream, which waits for
+//! the step on the device. The forward stream only waits on the device for the copy before the next step overwrites
+//! the outputs, so the executor thread never syncs and launches step N + 1 right away. The response thread drains the
+//! steps in order and syncs with the copies only. stage blocks while both buffers are still to be drained.
+class DecoderOutputStaging
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+    using StepIdType = std::uint64_t;
+
+    static SizeType32 constexpr kNumBuffers{2};
+
+    //! \brief Device outputs of the decoder, at fixed addresses between the steps. cumLogProbs can be null.
+    struct DeviceOutputs
+    {
+        TensorPtr newOutputTokens; // [maxTokensPerStep, maxNumSequences, beamWidth]
+        TensorPtr sequenceLengths; // [maxNumSequences, beamWidth]
+        TensorPtr finishReasons;   // [maxTokensPerStep, maxNumSequences, beamWidth]
+        TensorPtr cumLogProbs;     // [maxNumSequences, beamWidth]
+    };
+
+    //! \brief Pinned host copies of the outputs of a step, valid until the consumer returns.
+    struct HostOutputs
+    {
+        StepIdType stepId{0};
+        TensorPtr newOutputTokens;
+        TensorPtr sequenceLengths;
+        TensorPtr finishReasons;
+        TensorPtr cumLogProbs;
+    };
+
+    explicit DecoderOutputStaging(DeviceOutputs deviceOutputs);
+
+    DecoderOutputStaging(DecoderOutputStaging const&) = delete;
+    DecoderOutputStaging& operator=(DecoderOutputStaging const&) = delete;
+
+    //! \brief Stage the outputs of the step enqueued last on forwardStream, called by the executor thread.
+    StepIdType stage(CudaStream const& forwardStream);
+
+    //! \brief Wait for the oldest staged step and hand its outputs to consume, called by the response thread.
+    void drain(std::function<void(HostOutputs const&)> const& consume);
+
+    //! \brief Drain the oldest staged step if its copies are done, without blocking.
+    //! \return Whether a step was drained.
+    bool tryDrain(std::function<void(HostOutputs const&)> const& consume);
+
+    //! \brief Number of staged steps that are not drained yet.
+    [[nodiscard]] SizeType32 getNumStaged() const;
+
+private:
+    struct Slot
+    {
+        HostOutputs outputs;
+        CudaEvent copied;
+        bool staged{false};
+    };
+
+    void consumeOldest(std::unique_lock<std::mutex>& lock, std::function<void(HostOutputs const&)> const& consume);
+
+    DeviceOutputs mDeviceOutputs;
+    std::shared_ptr<CudaStream> mCopyStream;
+    BufferManager mCopyManager;
+    std::array<Slot, kNumBuffers> mSlots;
+    StepIdType mNextStepId{0};
+
+    mutable std::mutex mMutex;
+    std::condition_variable mSlotStaged;
+    std::condition_variable mSlotDrained;
+    // Slots of the staged steps, oldest first.
+    std::deque<SizeType32> mStaged;
+};
+
+} // namespace tensorrt_llm::runtime
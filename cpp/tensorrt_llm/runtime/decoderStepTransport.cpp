@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/decoderStepTransport.h"
+
+#include "tensorrt_llm/batch_manager/decoderBuffers.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+#include "tensorrt_llm/runtime/ncclCommunicator.h"
+
+using namespace tensorrt_llm::runtime;
+
+DecoderStepTransport::DecoderStepTransport(std::shared_ptr<NcclCommunicator> comm, int rank, CudaStreamPtr stream)
+    : mComm{std::move(comm)}
+    , mRank{rank}
+    , mBufferManager{std::move(stream)}
+{
+    TLLM_CHECK_WITH_INFO(mComm != nullptr, "DecoderStepTransport needs a NCCL communicator");
+}
+
+std::vector<DecoderStepTransport::Message> DecoderStepTransport::getStepMessages(
+    batch_manager::DecoderBuffers const& decoderBuffers, bool returnLogProbs, SizeType32 maxBeamWidth, bool useMedusa)
+{
+    std::vector<Message> messages;
+    messages.push_back({decoderBuffers.newOutputTokens, decoderBuffers.newOutputTokensHost});
+    messages.push_back({nullptr, decoderBuffers.finished});
+    messages.push_back({decoderBuffers.sequenceLengths, decoderBuffers.sequenceLengthsHost});
+    if (returnLogProbs)
+    {
+        messages.push_back({decoderBuffers.cumLogProbs, decoderBuffers.cumLogProbsHost});
+        messages.push_back({decoderBuffers.logProbs, decoderBuffers.logProbsHost});
+    }
+    if (maxBeamWidth > 1)
+    {
+        messages.push_back({decoderBuffers.cacheIndirectionOutput, nullptr});
+    }
+    if (useMedusa)
+    {
+        messages.push_back({decoderBuffers.draftBuffers.acceptedLengthsCumSumDevice, nullptr});
+        messages.push_back({decoderBuffers.draftBuffers.acceptedPackedPathsDevice, nullptr});
+    }
+    messages.push_back({nullptr, decoderBuffers.finishReasonsHost});
+    return messages;
+}
+
+DecoderStepTransport::Message DecoderStepTransport::makeMessage(TensorPtr const& tensor)
+{
+    TLLM_CHECK(tensor != nullptr);
+    if (tensor->getMemoryType() == MemoryType::kGPU || tensor->getMemoryType() == MemoryType::kUVM)
+    {
+        return {tensor, nullptr};
+    }
+    return {nullptr, tensor};
+}
+
+ITensor& DecoderStepTransport::getDeviceTensor(Message const& message)
+{
+    if (message.device)
+    {
+        return *message.device;
+    }
+    TLLM_CHECK_WITH_INFO(message.host != nullptr, "A message needs a device or a host tensor");
+    auto& scratch = mScratch[message.host.get()];
+    if (scratch == nullptr || scratch->getSizeInBytes() < message.host->getSizeInBytes())
+    {
+        scratch = mBufferManager.gpu(message.host->getShape(), message.host->getDataType());
+    }
+    else
+    {
+        scratch->reshape(message.host->getShape());
+    }
+    return *scratch;
+}
+
+void DecoderStepTransport::copyToHost(std::vector<Message> const& messages)
+{
+    for (auto const& message : messages)
+    {
+        if (message.host)
+        {
+            mBufferManager.copy(getDeviceTensor(message), *message.host);
+        }
+    }
+    getStream().record(mEvent);
+}
+
+void DecoderStepTransport::send(std::vector<Message> const& messages, int peer)
+{
+    NVTX3_FUNC_RANGE();
+    std::vector<ITensor*> deviceTensors;
+    deviceTensors.reserve(messages.size());
+    for (auto const& message : messages)
+    {
+        auto& deviceTensor = getDeviceTensor(message);
+        if (!message.device)
+        {
+            mBufferManager.copy(*message.host, deviceTensor);
+        }
+        deviceTensors.push_back(&deviceTensor);
+    }
+    NcclCommunicator::groupStart();
+    for (auto const* deviceTensor : deviceTensors)
+    {
+        mComm->send(*deviceTensor, peer, getStream());
+    }
+    NcclCommunicator::groupEnd();
+    getStream().record(mEvent);
+}
+
+void DecoderStepTransport::receive(std::vector<Message> const& messages, int peer)
+{
+    NVTX3_FUNC_RANGE();
+    std::vector<ITensor*> deviceTensors;
+    deviceTensors.reserve(messages.size());
+    for (auto const& message : messages)
+    {
+        deviceTensors.push_back(&getDeviceTensor(message));
+    }
+    NcclCommunicator::groupStart();
+    for (auto* deviceTensor : deviceTensors)
+    {
+        mComm->receive(*deviceTensor, peer, getStream());
+    }
+    NcclCommunicator::groupEnd();
+    copyToHost(messages);
+}
+
+void DecoderStepTransport::broadcast(std::vector<Message> const& messages, int root)
+{
+    NVTX3_FUNC_RANGE();
+    auto const isRoot = mRank == root;
+    std::vector<ITensor*> deviceTensors;
+    deviceTensors.reserve(messages.size());
+    for (auto const& message : messages)
+    {
+        auto& deviceTensor = getDeviceTensor(message);
+        if (isRoot && !message.device)
+        {
+            mBufferManager.copy(*message.host, deviceTensor);
+        }
+        deviceTensors.push_back(&deviceTensor);
+    }
+    NcclCommunicator::groupStart();
+    for (auto* deviceTensor : deviceTensors)
+    {
+        mComm->broadcast(*deviceTensor, root, getStream());
+    }
+    NcclCommunicator::groupEnd();
+    if (isRoot)
+    {
+        getStream().record(mEvent);
+    }
+    else
+    {
+        copyToHost(messages);
+    }
+}
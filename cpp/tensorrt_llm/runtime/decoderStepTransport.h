@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+class DecoderBuffers;
+} // namespace tensorrt_llm::batch_manager
+
+namespace tensorrt_llm::runtime
+{
+
+class NcclCommunicator;
+
+//! \brief Device side alternative to the MPI sends of DecoderBuffers::asyncSend, recv and bcast and of
+//! SlotDecoderBuffers::asyncSend, with NCCL point-to-point and broadcast calls.
+//! \details NCCL moves the tensors GPU to GPU, over NVLink between the GPUs of a node, instead of staging them in
+//! host memory on both ends. The tensors of a step are sent in one NCCL group, i.e. one launch. A message with a
+//! device tensor is sent from it and, on the receiving ranks, copied to its host tensor too if it has one. The ones
+//! that only exist on the host, like the finished states, go through a device scratch buffer of the transport.
+//!
+//! The calls are enqueued on the stream of the transport: the sender makes it wait for the step to be decoded and the
+//! receivers call synchronize, or make their streams wait on getEvent, before reading the messages. The communicator
+//! must span the ranks of the MPI communicator the decoder buffers would use, with the same ranks.
+class DecoderStepTransport
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+    using CudaStreamPtr = std::shared_ptr<CudaStream>;
+
+    struct Message
+    {
+        TensorPtr device;
+        TensorPtr host;
+    };
+
+    DecoderStepTransport(std::shared_ptr<NcclCommunicator> comm, int rank, CudaStreamPtr stream);
+
+    //! \brief Whether the executor replaces the MPI sends of the decoder buffers with the transport.
+    [[nodiscard]] static bool isEnabled()
+    {
+        return common::getEnvDecoderNcclTransport();
+    }
+
+    //! \brief The messages of DecoderBuffers::asyncSend, in the same order.
+    [[nodiscard]] static std::vector<Message> getStepMessages(batch_manager::DecoderBuffers const& decoderBuffers,
+        bool returnLogProbs, SizeType32 maxBeamWidth, bool useMedusa);
+
+    //! \brief A message of a single tensor, e.g. of the slot views of SlotDecoderBuffers::asyncSend.
+    [[nodiscard]] static Message makeMessage(TensorPtr const& tensor);
+
+    void send(std::vector<Message> const& messages, int peer);
+
+    void receive(std::vector<Message> const& messages, int peer);
+
+    void broadcast(std::vector<Message> const& messages, int root);
+
+    [[nodiscard]] CudaStream const& getStream() const
+    {
+        return mBufferManager.getStream();
+    }
+
+    //! \brief Recorded after the last call, once its messages are in their device and host tensors.
+    [[nodiscard]] CudaEvent const& getEvent() const noexcept
+    {
+        return mEvent;
+    }
+
+    void synchronize() const
+    {
+        mEvent.synchronize();
+    }
+
+private:
+    //! \brief The tensor NCCL reads or writes the message from, the device scratch of host only messages.
+    [[nodiscard]] ITensor& getDeviceTensor(Message const& message);
+
+    //! \brief Move the device data of the messages to their host tensors after they were received.
+    void copyToHost(std::vector<Message> const& messages);
+
+    std::shared_ptr<NcclCommunicator> mComm;
+    int mRank;
+    BufferManager mBufferManager;
+    CudaEvent mEvent;
+    // Device scratch of the host only messages, by host tensor.
+    std::unordered_map<ITensor const*, TensorPtr> mScratch;
+};
+
+} // namespace tensorrt_llm::runtime
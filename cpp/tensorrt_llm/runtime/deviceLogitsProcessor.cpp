@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/deviceLogitsProcessor.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+#include "tensorrt_llm/kernels/tokenBiasLogitsProcessor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+using namespace tensorrt_llm::runtime;
+namespace tk = tensorrt_llm::kernels;
+
+namespace
+{
+
+template <typename T>
+void invokeTokenBias(DeviceLogitsProcessorParams const& params, cudaStream_t stream)
+{
+    tk::invokeTokenBiasLogitsProcessor(static_cast<T*>(params.logits), params.rowOffsets, params.states,
+        params.numRequests, params.beamWidth, params.vocabSize, params.vocabSizePadded, stream);
+}
+
+void launchTokenBias(DeviceLogitsProcessorParams const& params, cudaStream_t stream)
+{
+    switch (params.logitsType)
+    {
+    case nvinfer1::DataType::kFLOAT: invokeTokenBias<float>(params, stream); break;
+    case nvinfer1::DataType::kHALF: invokeTokenBias<half>(params, stream); break;
+#ifdef ENABLE_BF16
+    case nvinfer1::DataType::kBF16: invokeTokenBias<__nv_bfloat16>(params, stream); break;
+#endif
+    default: TLLM_THROW("Unsupported logits data type %d", static_cast<int>(params.logitsType));
+    }
+}
+
+} // namespace
+
+DeviceLogitsProcessorRegistry& DeviceLogitsProcessorRegistry::getInstance()
+{
+    static DeviceLogitsProcessorRegistry instance;
+    return instance;
+}
+
+DeviceLogitsProcessorRegistry::DeviceLogitsProcessorRegistry()
+{
+    mProcessors.emplace(kTokenBias, Processor{launchTokenBias, sizeof(tk::TokenBiasLogitsProcessorState)});
+}
+
+void DeviceLogitsProcessorRegistry::registerProcessor(
+    std::string const& name, DeviceLogitsProcessorLauncher launcher, std::size_t stateSize)
+{
+    TLLM_CHECK_WITH_INFO(launcher != nullptr, "Device logits processor %s has no launcher", name.c_str());
+    TLLM_CHECK_WITH_INFO(stateSize > 0, "Device logits processor %s has an empty state", name.c_str());
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const [it, inserted] = mProcessors.emplace(name, Processor{launcher, stateSize});
+    TLLM_CHECK_WITH_INFO(inserted, "Device logits processor %s is already registered", name.c_str());
+}
+
+std::optional<DeviceLogitsProcessorRegistry::Processor> DeviceLogitsProcessorRegistry::getProcessor(
+    std::string const& name) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mProcessors.find(name);
+    if (it == mProcessors.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+namespace
+{
+
+// Bytes staged per request: the state pointer, the row offset and the batch slot.
+constexpr std::size_t kStagingBytesPerRequest = sizeof(void*) + 2 * sizeof(SizeType32);
+
+} // namespace
+
+DeviceLogitsProcessorBatch::DeviceLogitsProcessorBatch(SizeType32 maxNumSequences)
+    : mMaxNumSequences{maxNumSequences}
+    , mSlots(maxNumSequences)
+{
+    TLLM_CHECK(maxNumSequences > 0);
+    auto const stagingSize = static_cast<std::size_t>(maxNumSequences) * kStagingBytesPerRequest;
+    for (auto& staging : mStaging)
+    {
+        staging.host = BufferManager::pinned(stagingSize);
+    }
+}
+
+void DeviceLogitsProcessorBatch::setRequest(SizeType32 batchSlot, std::string const& processorName,
+    void const* hostState, BufferManager const& bufferManager)
+{
+    TLLM_CHECK_WITH_INFO(batchSlot >= 0 && batchSlot < mMaxNumSequences, "Invalid batch slot %d", batchSlot);
+    auto const processor = DeviceLogitsProcessorRegistry::getInstance().getProcessor(processorName);
+    TLLM_CHECK_WITH_INFO(processor.has_value(), "Unknown device logits processor %s", processorName.c_str());
+    TLLM_CHECK(hostState != nullptr);
+
+    auto& slot = mSlots[batchSlot];
+    // A slot keeps its state buffer when the next request of the slot uses the same processor.
+    if (!slot.has_value() || slot->name != processorName)
+    {
+        slot = SlotProcessor{processorName, processor->launcher, bufferManager.gpu(processor->stateSize)};
+    }
+    bufferManager.copy(hostState, *slot->state, MemoryType::kCPU);
+}
+
+void DeviceLogitsProcessorBatch::clearRequest(SizeType32 batchSlot)
+{
+    TLLM_CHECK_WITH_INFO(batchSlot >= 0 && batchSlot < mMaxNumSequences, "Invalid batch slot %d", batchSlot);
+    mSlots[batchSlot].reset();
+}
+
+bool DeviceLogitsProcessorBatch::hasRequest(SizeType32 batchSlot) const
+{
+    return batchSlot >= 0 && batchSlot < mMaxNumSequences && mSlots[batchSlot].has_value();
+}
+
+void* DeviceLogitsProcessorBatch::getState(SizeType32 batchSlot) const
+{
+    TLLM_CHECK_WITH_INFO(hasRequest(batchSlot), "No device logits processor for batch slot %d", batchSlot);
+    return mSlots[batchSlot]->state->data();
+}
+
+void DeviceLogitsProcessorBatch::run(ITensor& logits, std::vector<SizeType32> const& batchSlots,
+    std::vector<SizeType32> const& rowOffsets, SizeType32 beamWidth, SizeType32 vocabSize,
+    ITensor const* sequenceLengths, BufferManager const& bufferManager)
+{
+    NVTX3_FUNC_RANGE();
+    TLLM_CHECK(batchSlots.size() == rowOffsets.size());
+    TLLM_CHECK(batchSlots.size() <= static_cast<std::size_t>(mMaxNumSequences));
+
+    // Requests of every processor, in the order of their first request.
+    std::vector<std::pair<DeviceLogitsProcessorLauncher, std::vector<std::size_t>>> groups;
+    for (std::size_t ri = 0; ri < batchSlots.size(); ++ri)
+    {
+        if (!hasRequest(batchSlots[ri]))
+        {
+            continue;
+        }
+        auto const launcher = mSlots[batchSlots[ri]]->launcher;
+        auto it = std::find_if(
+            groups.begin(), groups.end(), [launcher](auto const& group) { return group.first == launcher; });
+        if (it == groups.end())
+        {
+            it = groups.emplace(groups.end(), launcher, std::vector<std::size_t>{});
+        }
+        it->second.push_back(ri);
+    }
+    if (groups.empty())
+    {
+        return;
+    }
+
+    auto& staging = mStaging[mNextStaging];
+    mNextStaging = (mNextStaging + 1) % kNumStagingBuffers;
+    if (staging.pending)
+    {
+        // Only waits when the host is kNumStagingBuffers steps ahead of the copies.
+        staging.copied.synchronize();
+    }
+    if (staging.device == nullptr)
+    {
+        staging.device = bufferManager.gpu(staging.host->getSizeInBytes());
+    }
+
+    auto const capacity = static_cast<std::size_t>(mMaxNumSequences);
+    auto* hostBytes = static_cast<std::uint8_t*>(staging.host->data());
+    auto* hostStates = reinterpret_cast<void**>(hostBytes);
+    auto* hostRowOffsets = reinterpret_cast<SizeType32*>(hostBytes + capacity * sizeof(void*));
+    auto* hostBatchSlots = hostRowOffsets + capacity;
+    std::size_t ri = 0;
+    for (auto const& [launcher, requests] : groups)
+    {
+        for (auto const request : requests)
+        {
+            hostStates[ri] = mSlots[batchSlots[request]]->state->data();
+            hostRowOffsets[ri] = rowOffsets[request];
+            hostBatchSlots[ri] = batchSlots[request];
+            ++ri;
+        }
+    }
+    bufferManager.copy(*staging.host, *staging.device);
+    bufferManager.getStream().record(staging.copied);
+    staging.pending = true;
+
+    auto const& shape = logits.getShape();
+    auto* deviceBytes = static_cast<std::uint8_t*>(staging.device->data());
+    auto* deviceStates = reinterpret_cast<void* const*>(deviceBytes);
+    auto* deviceRowOffsets = reinterpret_cast<SizeType32 const*>(deviceBytes + capacity * sizeof(void*));
+    auto* deviceBatchSlots = deviceRowOffsets + capacity;
+
+    DeviceLogitsProcessorParams params;
+    params.logits = logits.data();
+    params.logitsType = logits.getDataType();
+    params.sequenceLengths = sequenceLengths != nullptr ? bufferCast<SizeType32>(*sequenceLengths) : nullptr;
+    params.beamWidth = beamWidth;
+    params.vocabSize = vocabSize;
+    params.vocabSizePadded = static_cast<SizeType32>(shape.d[shape.nbDims - 1]);
+    TLLM_CHECK(vocabSize <= params.vocabSizePadded);
+    std::size_t offset = 0;
+    for (auto const& [launcher, requests] : groups)
+    {
+        params.states = deviceStates + offset;
+        params.rowOffsets = deviceRowOffsets + offset;
+        params.batchSlots = deviceBatchSlots + offset;
+        params.numRequests = static_cast<SizeType32>(requests.size());
+        launcher(params, bufferManager.getStream().get());
+        offset += requests.size();
+    }
+}
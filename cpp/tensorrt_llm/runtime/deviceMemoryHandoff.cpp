@@ -0,0 +1,285 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tensorrt_llm/runtime/deviceMemoryHandoff.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+namespace tensorrt_llm::runtime
+{
+
+// Protocol over a SOCK_SEQPACKET connection, one message each:
+//     HandoffHeader
+//     per memory: MemoryDesc, then the descriptors of its mapped chunks in messages of up to kMaxFdsPerMessage
+namespace
+{
+constexpr std::uint32_t kHandoffMagic{0x48444d54}; // "TMDH"
+constexpr std::uint32_t kHandoffVersion{1};
+constexpr std::size_t kMaxFdsPerMessage{64};
+// Device memory is mapped in chunks of at least 2 MiB, this allows for 2 TiB per memory.
+constexpr std::size_t kMaxNumChunks{1 << 20};
+
+struct HandoffHeader
+{
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t numMemories;
+};
+
+struct MemoryDesc
+{
+    std::uint64_t chunkSize;
+    std::uint64_t numChunks;
+    std::uint64_t numFds;
+};
+
+sockaddr_un getAddress(std::string const& socketPath)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    TLLM_CHECK_WITH_INFO(
+        socketPath.size() < sizeof(address.sun_path), "Socket path %s is too long", socketPath.c_str());
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    return address;
+}
+
+class FdGuard
+{
+public:
+    explicit FdGuard(int fd)
+        : mFd{fd}
+    {
+    }
+
+    ~FdGuard()
+    {
+        if (mFd >= 0)
+        {
+            ::close(mFd);
+        }
+    }
+
+    FdGuard(FdGuard const&) = delete;
+    FdGuard& operator=(FdGuard const&) = delete;
+
+    [[nodiscard]] int get() const noexcept
+    {
+        return mFd;
+    }
+
+private:
+    int mFd;
+};
+
+void sendMessage(int socketFd, void const* data, std::size_t size, int const* fds = nullptr, std::size_t numFds = 0)
+{
+    iovec iov{const_cast<void*>(data), size};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * numFds));
+    if (numFds > 0)
+    {
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+        auto* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * numFds);
+        std::memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * numFds);
+    }
+    TLLM_CHECK_WITH_INFO(::sendmsg(socketFd, &msg, MSG_NOSIGNAL) == static_cast<ssize_t>(size),
+        "Failed to send a device memory handoff message: %s", std::strerror(errno));
+}
+
+//! \brief Receive one message of exactly size bytes, and the descriptors attached to it.
+std::vector<int> receiveMessage(int socketFd, void* data, std::size_t size)
+{
+    iovec iov{data, size};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * kMaxFdsPerMessage));
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    auto const received = ::recvmsg(socketFd, &msg, MSG_CMSG_CLOEXEC);
+    std::vector<int> fds;
+    for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            auto const numFds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            auto const offset = fds.size();
+            fds.resize(offset + numFds);
+            std::memcpy(fds.data() + offset, CMSG_DATA(cmsg), sizeof(int) * numFds);
+        }
+    }
+    if (received != static_cast<ssize_t>(size) || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0)
+    {
+        for (auto const fd : fds)
+        {
+            ::close(fd);
+        }
+        TLLM_THROW("Failed to receive a device memory handoff message: %s",
+            received < 0 ? std::strerror(errno) : "truncated message");
+    }
+    return fds;
+}
+} // namespace
+
+DeviceMemoryHandoffReceiver::DeviceMemoryHandoffReceiver(std::string socketPath)
+    : mSocketPath{std::move(socketPath)}
+{
+    auto const address = getAddress(mSocketPath);
+    mListenFd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    TLLM_CHECK_WITH_INFO(mListenFd >= 0, "Failed to create socket: %s", std::strerror(errno));
+    ::unlink(mSocketPath.c_str());
+    if (::bind(mListenFd, reinterpret_cast<sockaddr const*>(&address), sizeof(address)) != 0
+        || ::listen(mListenFd, 1) != 0)
+    {
+        auto const error = errno;
+        ::close(mListenFd);
+        TLLM_THROW("Failed to listen on %s: %s", mSocketPath.c_str(), std::strerror(error));
+    }
+}
+
+DeviceMemoryHandoffReceiver::~DeviceMemoryHandoffReceiver()
+{
+    ::close(mListenFd);
+    ::unlink(mSocketPath.c_str());
+}
+
+std::optional<std::vector<std::unique_ptr<VirtualDeviceMemory>>> DeviceMemoryHandoffReceiver::receive(
+    std::optional<std::chrono::milliseconds> timeout)
+{
+    pollfd pfd{mListenFd, POLLIN, 0};
+    auto const ready = ::poll(&pfd, 1, timeout.has_value() ? static_cast<int>(timeout->count()) : -1);
+    TLLM_CHECK_WITH_INFO(ready >= 0, "Failed to wait for a device memory handoff: %s", std::strerror(errno));
+    if (ready == 0)
+    {
+        return std::nullopt;
+    }
+    FdGuard const connection{::accept4(mListenFd, nullptr, nullptr, SOCK_CLOEXEC)};
+    TLLM_CHECK_WITH_INFO(connection.get() >= 0, "Failed to accept a device memory handoff: %s", std::strerror(errno));
+
+    HandoffHeader header{};
+    receiveMessage(connection.get(), &header, sizeof(header));
+    TLLM_CHECK_WITH_INFO(header.magic == kHandoffMagic && header.version == kHandoffVersion,
+        "Invalid device memory handoff from %s", mSocketPath.c_str());
+
+    std::vector<std::unique_ptr<VirtualDeviceMemory>> memories;
+    for (std::uint32_t memoryIdx = 0; memoryIdx < header.numMemories; ++memoryIdx)
+    {
+        MemoryDesc desc{};
+        receiveMessage(connection.get(), &desc, sizeof(desc));
+        TLLM_CHECK_WITH_INFO(desc.numChunks <= kMaxNumChunks && desc.numFds <= desc.numChunks,
+            "Invalid device memory handoff from %s", mSocketPath.c_str());
+        std::vector<std::uint8_t> isMapped(desc.numChunks);
+        receiveMessage(connection.get(), isMapped.data(), isMapped.size());
+
+        std::vector<int> fds;
+        try
+        {
+            while (fds.size() < desc.numFds)
+            {
+                std::uint32_t numFds{0};
+                auto received = receiveMessage(connection.get(), &numFds, sizeof(numFds));
+                fds.insert(fds.end(), received.begin(), received.end());
+                TLLM_CHECK_WITH_INFO(received.size() == numFds && fds.size() <= desc.numFds,
+                    "Invalid device memory handoff from %s", mSocketPath.c_str());
+            }
+            std::vector<int> chunkFds(desc.numChunks, -1);
+            auto fdIt = fds.begin();
+            for (std::size_t chunkIdx = 0; chunkIdx < chunkFds.size(); ++chunkIdx)
+            {
+                if (isMapped[chunkIdx] != 0)
+                {
+                    TLLM_CHECK_WITH_INFO(fdIt != fds.end(), "Invalid device memory handoff from %s",
+                        mSocketPath.c_str());
+                    chunkFds[chunkIdx] = *fdIt++;
+                }
+            }
+            memories.push_back(VirtualDeviceMemory::importChunks(chunkFds, desc.chunkSize));
+        }
+        catch (...)
+        {
+            std::for_each(fds.begin(), fds.end(), ::close);
+            throw;
+        }
+        std::for_each(fds.begin(), fds.end(), ::close);
+    }
+    TLLM_LOG_INFO("Received %zu device memory ranges over %s", memories.size(), mSocketPath.c_str());
+    return memories;
+}
+
+void sendDeviceMemory(std::string const& socketPath, std::vector<std::shared_ptr<VirtualDeviceMemory>> const& memories)
+{
+    auto const address = getAddress(socketPath);
+    FdGuard const connection{::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)};
+    TLLM_CHECK_WITH_INFO(connection.get() >= 0, "Failed to create socket: %s", std::strerror(errno));
+    TLLM_CHECK_WITH_INFO(
+        ::connect(connection.get(), reinterpret_cast<sockaddr const*>(&address), sizeof(address)) == 0,
+        "Failed to connect to %s: %s", socketPath.c_str(), std::strerror(errno));
+
+    HandoffHeader const header{kHandoffMagic, kHandoffVersion, static_cast<std::uint32_t>(memories.size())};
+    sendMessage(connection.get(), &header, sizeof(header));
+    for (auto const& memory : memories)
+    {
+        auto const chunkFds = memory->exportChunks();
+        std::vector<int> fds;
+        std::vector<std::uint8_t> isMapped(chunkFds.size(), 0);
+        for (std::size_t chunkIdx = 0; chunkIdx < chunkFds.size(); ++chunkIdx)
+        {
+            if (chunkFds[chunkIdx] >= 0)
+            {
+                fds.push_back(chunkFds[chunkIdx]);
+                isMapped[chunkIdx] = 1;
+            }
+        }
+        try
+        {
+            MemoryDesc const desc{memory->getChunkSize(), chunkFds.size(), fds.size()};
+            sendMessage(connection.get(), &desc, sizeof(desc));
+            sendMessage(connection.get(), isMapped.data(), isMapped.size());
+            for (std::size_t offset = 0; offset < fds.size(); offset += kMaxFdsPerMessage)
+            {
+                auto const numFds = static_cast<std::uint32_t>(std::min(kMaxFdsPerMessage, fds.size() - offset));
+                sendMessage(connection.get(), &numFds, sizeof(numFds), fds.data() + offset, numFds);
+            }
+        }
+        catch (...)
+        {
+            std::for_each(fds.begin(), fds.end(), ::close);
+            throw;
+        }
+        // The receiver holds its own references now.
+        std::for_each(fds.begin(), fds.end(), ::close);
+    }
+    TLLM_LOG_INFO("Sent %zu device memory ranges to %s", memories.size(), socketPath.c_str());
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "tensorrt_llm/runtime/virtualDeviceMemory.h"
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Receiving end of a handoff of virtual device memory between processes on the same node.
+/// @details A warm standby creates the receiver on a Unix domain socket before its peer starts serving, so the peer
+/// can send its shareable KV cache pools right away and again after every resize. The standby maps the peer's physical
+/// memory with VirtualDeviceMemory::importChunks, which keeps it alive when the peer crashes; promoting the standby
+/// takes the pools of the last handoff instead of allocating and warming new ones.
+class DeviceMemoryHandoffReceiver
+{
+public:
+    explicit DeviceMemoryHandoffReceiver(std::string socketPath);
+
+    ~DeviceMemoryHandoffReceiver();
+
+    DeviceMemoryHandoffReceiver(DeviceMemoryHandoffReceiver const&) = delete;
+    DeviceMemoryHandoffReceiver& operator=(DeviceMemoryHandoffReceiver const&) = delete;
+
+    /// @brief Wait for a peer to send its memory, in the order it was sent.
+    /// @return Not set if no peer connected before the timeout.
+    [[nodiscard]] std::optional<std::vector<std::unique_ptr<VirtualDeviceMemory>>> receive(
+        std::optional<std::chrono::milliseconds> timeout = std::nullopt);
+
+    [[nodiscard]] std::string const& getSocketPath() const noexcept
+    {
+        return mSocketPath;
+    }
+
+private:
+    std::string mSocketPath;
+    int mListenFd{-1};
+};
+
+/// @brief Send shareable virtual device memory to the receiver listening on socketPath.
+void sendDeviceMemory(
+    std::string const& socketPath, std::vector<std::shared_ptr<VirtualDeviceMemory>> const& memories);
+
+} // namespace tensorrt_llm::runtime
@@ -20,6 +20,8 @@
 #include "tensorrt_llm/executor/types.h"
 #include "tensorrt_llm/runtime/speculativeDecodingModule.h"
 
+#include <utility>
+
 namespace tensorrt_llm::runtime
 {
 
@@ -46,6 +48,25 @@ public:
         return mDefaultEagleChoices;
     }
 
+    //! Replaces the default tree, e.g. by the chain of an MTP model.
+    void setDefaultEagleChoices(executor::EagleChoices eagleChoices) noexcept
+    {
+        mDefaultEagleChoices = std::move(eagleChoices);
+    }
+
+    //! Chain tree {{0}, {0, 0}, ...} of the given depth: the top-1 token of every draft layer. MTP modules predict one
+    //! token per depth, so it is their tree.
+    [[nodiscard]] static executor::EagleChoices getChainEagleChoices(SizeType32 depth)
+    {
+        executor::EagleChoices choices;
+        choices.reserve(depth);
+        for (SizeType32 di = 0; di < depth; ++di)
+        {
+            choices.emplace_back(di + 1, 0);
+        }
+        return choices;
+    }
+
     [[nodiscard]] SizeType32 getNumTransformerLayers() const noexcept
     {
         return mNumTransformersLayer;
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/encoderOnlyRunner.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+#include "tensorrt_llm/kernels/sequencePooling.h"
+#include "tensorrt_llm/runtime/tllmRuntime.h"
+
+using namespace tensorrt_llm::runtime;
+namespace tk = tensorrt_llm::kernels;
+
+namespace
+{
+
+template <typename T>
+void invokePooling(ITensor const& hiddenStates, ITensor const& seqOffsets, SizeType32 batchSize, bool mean,
+    ITensor& pooled, CudaStream const& stream)
+{
+    auto const hiddenSize = static_cast<SizeType32>(hiddenStates.getShape().d[hiddenStates.getShape().nbDims - 1]);
+    tk::invokeSequencePooling(bufferCast<T>(hiddenStates), bufferCast<SizeType32>(seqOffsets), batchSize, hiddenSize,
+        mean, bufferCast<float>(pooled), stream.get());
+}
+
+} // namespace
+
+EncoderOnlyRunner::EncoderOnlyRunner(RawEngine const& rawEngine, nvinfer1::ILogger* logger, Config config)
+    : mRuntime{std::make_unique<TllmRuntime>(rawEngine, logger)}
+    , mConfig{std::move(config)}
+{
+    mRuntime->addContext(0);
+}
+
+EncoderOnlyRunner::~EncoderOnlyRunner() = default;
+
+std::vector<EncoderOnlyRunner::Output> EncoderOnlyRunner::run(PackedBatch const& batch)
+{
+    NVTX3_FUNC_RANGE();
+    auto const batchSize = batch.getBatchSize();
+    auto const numTokens = batch.getNumTokens();
+    TLLM_CHECK_WITH_INFO(batchSize > 0, "An encoder step needs requests");
+    auto const& manager = mRuntime->getBufferManager();
+    auto const& stream = mRuntime->getStream();
+
+    auto const tokensShape = ITensor::makeShape({numTokens});
+    TllmRuntime::TensorMap inputs;
+    inputs.emplace("input_ids", manager.copyFrom(batch.inputIds, tokensShape, MemoryType::kGPU));
+    inputs.emplace(
+        "input_lengths", manager.copyFrom(batch.inputLengths, ITensor::makeShape({batchSize}), MemoryType::kGPU));
+    // Only the shape of max_input_length is read.
+    inputs.emplace("max_input_length",
+        manager.gpu(ITensor::makeShape({batch.maxInputLength}), nvinfer1::DataType::kINT32));
+    if (mConfig.hasTokenTypeIds)
+    {
+        inputs.emplace("token_type_ids", manager.copyFrom(batch.tokenTypeIds, tokensShape, MemoryType::kGPU));
+    }
+    if (mConfig.hasPositionIds)
+    {
+        inputs.emplace("position_ids", manager.copyFrom(batch.positionIds, tokensShape, MemoryType::kGPU));
+    }
+    TllmRuntime::TensorMap outputs;
+    mRuntime->setInputTensors(0, inputs);
+    mRuntime->setOutputTensors(0, outputs);
+    TLLM_CHECK_WITH_INFO(mRuntime->executeContext(0), "Executing the encoder failed");
+
+    auto const outputIt = outputs.find(mConfig.outputName);
+    TLLM_CHECK_WITH_INFO(outputIt != outputs.end(), "The encoder has no output %s", mConfig.outputName.c_str());
+    auto const& hiddenStates = outputIt->second;
+    auto const& shape = hiddenStates->getShape();
+    TLLM_CHECK_WITH_INFO(shape.nbDims == 2 && shape.d[0] == numTokens,
+        "The encoder output must be [numTokens, hiddenSize], is the engine built with remove_input_padding?");
+    auto const hiddenSize = static_cast<SizeType32>(shape.d[1]);
+
+    TensorPtr hostOutput;
+    if (mConfig.pooling == PoolingMode::kNone)
+    {
+        hostOutput = BufferManager::pinned(shape, hiddenStates->getDataType());
+        manager.copy(*hiddenStates, *hostOutput);
+    }
+    else
+    {
+        auto const mean = mConfig.pooling == PoolingMode::kMean;
+        auto seqOffsets = manager.copyFrom(batch.seqOffsets, ITensor::makeShape({batchSize + 1}), MemoryType::kGPU);
+        auto pooled = manager.gpu(ITensor::makeShape({batchSize, hiddenSize}), nvinfer1::DataType::kFLOAT);
+        switch (hiddenStates->getDataType())
+        {
+        case nvinfer1::DataType::kFLOAT:
+            invokePooling<float>(*hiddenStates, *seqOffsets, batchSize, mean, *pooled, stream);
+            break;
+        case nvinfer1::DataType::kHALF:
+            invokePooling<half>(*hiddenStates, *seqOffsets, batchSize, mean, *pooled, stream);
+            break;
+#ifdef ENABLE_BF16
+        case nvinfer1::DataType::kBF16:
+            invokePooling<__nv_bfloat16>(*hiddenStates, *seqOffsets, batchSize, mean, *pooled, stream);
+            break;
+#endif
+        default:
+            TLLM_THROW("Unsupported encoder output data type %d", static_cast<int>(hiddenStates->getDataType()));
+        }
+        hostOutput = BufferManager::pinned(pooled->getShape(), nvinfer1::DataType::kFLOAT);
+        manager.copy(*pooled, *hostOutput);
+    }
+    stream.synchronize();
+
+    std::vector<Output> results;
+    results.reserve(batchSize);
+    for (SizeType32 bi = 0; bi < batchSize; ++bi)
+    {
+        auto embedding = mConfig.pooling == PoolingMode::kNone
+            ? ITensor::slice(hostOutput, batch.seqOffsets[bi], batch.inputLengths[bi])
+            : ITensor::slice(hostOutput, bi, 1);
+        results.push_back(Output{batch.requestIds[bi], std::move(embedding)});
+    }
+    return results;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/packedEncoderBatcher.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/rawEngine.h"
+
+#include <NvInferRuntime.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+class TllmRuntime;
+
+//! \brief Runs the packed batches of batch_manager::PackedEncoderBatcher on an encoder-only engine built with
+//! remove_input_padding, and returns an embedding per request.
+//! \details The engine takes input_ids, token_type_ids and position_ids [numTokens], input_lengths [batchSize] and
+//! max_input_length, whose shape [maxInputLength] sizes the FMHA of the BERT attention plugin, and outputs the hidden
+//! states [numTokens, hiddenSize]. The pooling runs on the device, so a pooled batch moves batchSize * hiddenSize
+//! floats to the host.
+class EncoderOnlyRunner
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+    using PackedBatch = batch_manager::PackedEncoderBatcher::PackedBatch;
+    using RequestIdType = batch_manager::PackedEncoderBatcher::RequestIdType;
+
+    enum class PoolingMode
+    {
+        //! \brief The hidden states of all the tokens, in the type of the engine.
+        kNone,
+        //! \brief The hidden state of the first token.
+        kCls,
+        kMean,
+    };
+
+    struct Config
+    {
+        PoolingMode pooling{PoolingMode::kCls};
+        std::string outputName{"hidden_states"};
+        bool hasTokenTypeIds{true};
+        bool hasPositionIds{true};
+    };
+
+    struct Output
+    {
+        RequestIdType requestId{0};
+        //! \brief On the host, [1, hiddenSize] in FP32 when pooled, [numTokens, hiddenSize] otherwise.
+        TensorPtr embedding;
+    };
+
+    EncoderOnlyRunner(RawEngine const& rawEngine, nvinfer1::ILogger* logger, Config config);
+
+    ~EncoderOnlyRunner();
+
+    //! \brief Run a batch and wait for its outputs.
+    [[nodiscard]] std::vector<Output> run(PackedBatch const& batch);
+
+    [[nodiscard]] Config const& getConfig() const
+    {
+        return mConfig;
+    }
+
+private:
+    std::unique_ptr<TllmRuntime> mRuntime;
+    Config mConfig;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -16,6 +16,7 @@
 
 #include "tensorrt_llm/runtime/gptDecoder.h"
 
+#include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/kernels/decodingKernels.h"
 #include "tensorrt_llm/kernels/speculativeDecoding/externalDraftTokensKernels.h"
 #include "tensorrt_llm/layers/decodingParams.h"
@@ -26,6 +27,7 @@
 
 #include <NvInferRuntime.h>
 
+namespace tc = tensorrt_llm::common;
 namespace tle = tensorrt_llm::executor;
 namespace tl = tensorrt_llm::layers;
 namespace tksd = tensorrt_llm::kernels::speculative_decoding;
@@ -347,6 +349,9 @@ void prepareExternalDraftTokensInputs(DecodingInput const& inputs, std::shared_p
     inputParams->draftTokenIds = externalDraftTokensInputs.draftTokenIds;
     inputParams->constantThreshold = externalDraftTokensInputs.constantThreshold;
     inputParams->useRandomAcceptanceThreshold = externalDraftTokensInputs.useRandomAcceptanceThreshold;
+    // Not part of DecodingInput, whose layout is shared with the prebuilt batch manager.
+    inputParams->typicalAcceptanceEpsilon = tc::getEnvTypicalAcceptanceEpsilon();
+    inputParams->typicalAcceptanceDelta = tc::getEnvTypicalAcceptanceDelta();
     inputParams->step = externalDraftTokensInputs.step;
     inputParams->useDraftLogits = externalDraftTokensInputs.useDraftLogits;
     inputParams->useDraftLogitsHost = externalDraftTokensInputs.useDraftLogitsHost;
@@ -19,11 +19,15 @@
 #include "tensorrt_llm/batch_manager/createNewDecoderRequests.h"
 #include "tensorrt_llm/batch_manager/llmRequest.h"
 #include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/iterationTimeline.h"
 #include "tensorrt_llm/executor/types.h"
 #include "tensorrt_llm/kernels/decodingCommon.h"
 #include "tensorrt_llm/kernels/decodingKernels.h"
 #include "tensorrt_llm/runtime/bufferManager.h"
 #include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaGraphCache.h"
+#include "tensorrt_llm/runtime/kernelSampler.h"
 #include "tensorrt_llm/runtime/runtimeKernels.h"
 
 #include <algorithm>
@@ -348,6 +352,13 @@ void GptDecoderBatched::setup(executor::DecodingMode const& mode, SizeType32 max
         mOutputBeamHypotheses->empty(mBufferManager);
         mOutputBeamHypotheses->reshape(1, maxBeamWidth, mMaxSequenceLength);
         mCumLogProbsTmp = mBufferManager.gpu(ITensor::makeShape({1, maxBeamWidth}), nvinfer1::DataType::kFLOAT);
+
+        mFinalizeBatchSlots = mBufferManager.pinned(maxBatchSizeShape, TRTDataType<SizeType32>::value);
+        mFinalizeLengthPenalties = mBufferManager.pinned(maxBatchSizeShape, nvinfer1::DataType::kFLOAT);
+        mFinalizeBeamWidths = mBufferManager.pinned(maxBatchSizeShape, TRTDataType<SizeType32>::value);
+        mFinalizedIds = mBufferManager.pinned(jointOutputIdsShape, TRTDataType<TokenIdType>::value);
+        mFinalizedSequenceLengths = mBufferManager.pinned(maxBatchSizeXmaxBeamWidth, TRTDataType<SizeType32>::value);
+        mFinalizedCumLogProbs = mBufferManager.pinned(maxBatchSizeXmaxBeamWidth, nvinfer1::DataType::kFLOAT);
     }
     else
     {
@@ -425,6 +436,20 @@ void GptDecoderBatched::setup(executor::DecodingMode const& mode, SizeType32 max
     mDecoder = IGptDecoder::create(mode, dtype, maxBatchSize, maxBeamWidth, mVocabSize, mVocabSizePadded,
         mMaxSequenceLength, mDecoderStream, speculativeDecodingModulePtr);
 
+    mDecoderGraphBuckets.reset();
+    mDecoderGraphs.reset();
+    // Only the layers of the non-speculative decoding are captured, the lookahead layer syncs with the host.
+    if (common::getEnvDecoderCudaGraph() && mSpeculativeDecodingMode.isNone())
+    {
+        auto constexpr kNumContextTokens = 1;
+        mDecoderGraphBuckets = std::make_shared<CudaGraphBuckets>(maxBatchSize, kNumContextTokens, kNumContextTokens);
+        auto const buckets = mDecoderGraphBuckets->getAll();
+        auto const numGenBuckets = std::count_if(buckets.begin(), buckets.end(),
+            [](auto const& bucket) { return bucket.numGenRequests > 0 && bucket.numContextTokens == 0; });
+        mDecoderGraphs = std::make_shared<CudaGraphCache>(static_cast<SizeType32>(numGenBuckets));
+        mDecoderGraphWarm.assign(maxBatchSize + 1, false);
+    }
+
     mNbSteps.clear();
     mNbSteps.resize(maxBatchSize, 0);
     mFinished.clear();
@@ -561,11 +586,13 @@ GptDecoderBatched::DecoderFinishedEventPtr GptDecoderBatched::forwardAsync(
     decoder_batch::Output& output, decoder_batch::Input const& input)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    TLLM_TIMELINE_SCOPE("decoder_forward_async");
+    KernelSampler::ScopedRegion const kernelSamplerRegion("decoder");
 
     forwardDispatch(output, input, ForwardType::kASYNC);
 
     CudaEvent eventStop{};
-    mRuntimeStream->record(eventStop);
+    (mOverlapWithEngine ? mDecoderStream : mRuntimeStream)->record(eventStop);
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
     return std::make_unique<decoder_batch::DecoderFinishedEvent>(std::move(eventStop), input.active);
 }
@@ -701,7 +728,23 @@ void GptDecoderBatched::forwardDecoder(
     {
         if (forwardType == ForwardType::kASYNC)
         {
-            decoder.forwardAsync(dOutput, dInput);
+            // The step is captured again every time and updates the graph of its bucket, so the batch slots, the
+            // logits and the batch size of the step are the ones of the graph. The beam search runs eagerly.
+            auto const bucket = mDecoderGraphs && maxBeamWidth == 1
+                ? mDecoderGraphBuckets->select(localBatchDecoderIdx, 0)
+                : std::nullopt;
+            if (bucket && mDecoderGraphWarm[bucket->numGenRequests])
+            {
+                mDecoderGraphs->run(*bucket, *mDecoderStream, [&]() { decoder.forwardAsync(dOutput, dInput); });
+            }
+            else
+            {
+                if (bucket)
+                {
+                    mDecoderGraphWarm[bucket->numGenRequests] = true;
+                }
+                decoder.forwardAsync(dOutput, dInput);
+            }
         }
         else if (forwardType == ForwardType::kSYNC)
         {
@@ -725,7 +768,7 @@ void GptDecoderBatched::forwardDecoder(
     }
 
     // If last iteration
-    if (async && step == maxDecodingEngineTokens - mMaxDecodingDecoderTokens)
+    if (async && !mOverlapWithEngine && step == maxDecodingEngineTokens - mMaxDecodingDecoderTokens)
     {
         CudaEvent event{};
         mDecoderStream->record(event);
@@ -753,6 +796,7 @@ void GptDecoderBatched::updateFinished(decoder_batch::DecoderFinishedEvent const
 void GptDecoderBatched::forwardSync(decoder_batch::DecoderFinishedEvent const& decoderFinishEvent)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    TLLM_TIMELINE_SCOPE("decoder_forward_sync");
     decoderFinishEvent.event.synchronize();
 
     updateFinished(decoderFinishEvent);
@@ -764,6 +808,7 @@ void GptDecoderBatched::forwardSync(decoder_batch::DecoderFinishedEvent const& d
     decoder_batch::Output& output, decoder_batch::Input const& input)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    TLLM_TIMELINE_SCOPE("decoder_forward_sync");
     decoderFinishEvent.event.synchronize();
 
     forwardDispatch(output, input, ForwardType::kSYNC);
@@ -949,14 +994,23 @@ void GptDecoderBatched::forwardAsync(decoder::Output& output, decoder::Input con
     batchOutput.sequenceLengths = output.sequenceLengths;
 
     mDecoderFinishEvent = forwardAsync(batchOutput, batchInput);
-    mBufferManager.setZero(*mFinishedSum);
-    kernels::reduce(
-        *mFinishedSum, *ITensor::slice(mJointDecodingOutput->finishedSum, 0, mActualBatchSize), *mRuntimeStream);
-    mRuntimeStream->record(mForwardEvent);
+    // With the overlap, the number of finished sequences is counted on the decoder stream too.
+    auto const& stream = mOverlapWithEngine ? mDecoderStream : mRuntimeStream;
+    BufferManager{stream}.setZero(*mFinishedSum);
+    kernels::reduce(*mFinishedSum, *ITensor::slice(mJointDecodingOutput->finishedSum, 0, mActualBatchSize), *stream);
+    stream->record(mForwardEvent);
 
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
 
+void GptDecoderBatched::setOverlapWithEngine(bool overlapWithEngine)
+{
+    // The inputs of speculative decoding are set on the runtime stream after the decoding starts waiting for it.
+    TLLM_CHECK_WITH_INFO(!overlapWithEngine || mSpeculativeDecodingMode.isNone(),
+        "Overlapping the decoder with the engine is not supported with speculative decoding");
+    mOverlapWithEngine = overlapWithEngine;
+}
+
 void GptDecoderBatched::forwardSync()
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
@@ -969,14 +1023,64 @@ void GptDecoderBatched::forwardSync()
 void GptDecoderBatched::finalize(SamplingConfig const& samplingConfig) const
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
-    auto batchSlots = bufferCast<SizeType32>(*mBatchSlotsSetup);
-    for (SizeType32 batchIdx = 0; batchIdx < mActualBatchSize; ++batchIdx)
+    auto batchSlotsSetup = bufferCast<SizeType32>(*mBatchSlotsSetup);
+    std::vector<SizeType32> batchSlots(batchSlotsSetup, batchSlotsSetup + mActualBatchSize);
+    std::vector<SamplingConfig> samplingConfigs;
+    samplingConfigs.reserve(batchSlots.size());
+    for (auto const slot : batchSlots)
+    {
+        samplingConfigs.push_back(extractSamplingConfig(samplingConfig, slot));
+    }
+    auto event = finalize(batchSlots, samplingConfigs);
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
+CudaEvent GptDecoderBatched::finalize(
+    std::vector<SizeType32> const& batchSlots, std::vector<SamplingConfig> const& samplingConfigs) const
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    TLLM_CHECK_WITH_INFO(batchSlots.size() == samplingConfigs.size(),
+        "Got %zu sampling configs for %zu requests to finalize", samplingConfigs.size(), batchSlots.size());
+    TLLM_CHECK_WITH_INFO(mFinalizeBatchSlots != nullptr, "Finalizing several requests at once is for beam search");
+    auto const batchSize = static_cast<SizeType32>(batchSlots.size());
+    TLLM_CHECK(batchSize <= static_cast<SizeType32>(mFinalizeBatchSlots->getSize()));
+
+    // The previous batched finalize may still read the parameters in pinned memory, this only waits if it has not
+    // started yet.
+    mFinalizeEvent.synchronize();
+    auto finalizeBatchSlots = bufferCast<SizeType32>(*mFinalizeBatchSlots);
+    auto lengthPenalties = bufferCast<float>(*mFinalizeLengthPenalties);
+    auto beamWidths = bufferCast<SizeType32>(*mFinalizeBeamWidths);
+    for (SizeType32 batchIdx = 0; batchIdx < batchSize; ++batchIdx)
     {
-        auto slot = batchSlots[batchIdx];
-        auto requestSamplingConfig = extractSamplingConfig(samplingConfig, slot);
-        auto event = postProcessRequest(slot, requestSamplingConfig, /*streaming*/ false);
+        auto const& samplingConfig = samplingConfigs[batchIdx];
+        finalizeBatchSlots[batchIdx] = batchSlots[batchIdx];
+        lengthPenalties[batchIdx]
+            = samplingConfig.lengthPenalty.has_value() && !samplingConfig.lengthPenalty.value().empty()
+            ? samplingConfig.lengthPenalty.value()[0]
+            : 1.0f;
+        beamWidths[batchIdx] = samplingConfig.beamWidth;
     }
+
+    auto const& stream = *mRuntimeStream;
+    kernels::gatherTree(*mJointDecodingOutput, *mJointDecodingInput, finalizeBatchSlots, lengthPenalties, beamWidths,
+        batchSize, stream);
+
+    // The gathered beams are written to the pinned buffers by the device, without a copy to wait for on the host.
+    auto const& finalizedIdsShape = mFinalizedIds->getShape();
+    tensorrt_llm::kernels::invokeCopyFinalizedBeams(bufferCast<TokenIdType>(*mFinalizedIds),
+        bufferCast<SizeType32>(*mFinalizedSequenceLengths), bufferCast<float>(*mFinalizedCumLogProbs),
+        bufferCast<TokenIdType>(*mJointDecodingOutput->gatheredIds),
+        bufferCast<SizeType32>(*mJointDecodingOutput->lengths), bufferCast<float>(*mJointDecodingOutput->cumLogProbs),
+        finalizeBatchSlots, batchSize, static_cast<SizeType32>(finalizedIdsShape.d[1]),
+        static_cast<SizeType32>(finalizedIdsShape.d[2]), stream.get());
+    sync_check_cuda_error();
+
+    stream.record(mFinalizeEvent);
+    CudaEvent event{};
+    stream.record(event);
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+    return event;
 }
 
 CudaEvent GptDecoderBatched::finalize(SizeType32 batchSlot, SamplingConfig const& samplingConfig, bool streaming) const
@@ -171,6 +171,12 @@ ModelConfig createModelConfig(
             json.at("build_config"), "speculative_decoding_mode");
 
         if (speculativeDecodingModeOpt.has_value()
+            && SpeculativeDecodingMode(speculativeDecodingModeOpt.value()).isMtp())
+        {
+            // The MTP modules are transformer blocks of the engine and have their KV cache in the pool of the model.
+            numLayers += json.at("pretrained_config").at("num_nextn_predict_layers").template get<SizeType32>();
+        }
+        else if (speculativeDecodingModeOpt.has_value()
             && SpeculativeDecodingMode(speculativeDecodingModeOpt.value()).isEagle())
         {
             auto const& eagleConfig = json.at("pretrained_config").at("eagle_net_config");
@@ -597,6 +603,22 @@ GptJsonConfig parseJson(InputType&& input)
                     = std::make_shared<SpeculativeDecodingModule>(maxDraftLen, maxDraftLen, 1);
                 modelConfig.setSpeculativeDecodingModule(speculativeDecodingModule);
             }
+            else if (modelConfig.getSpeculativeDecodingMode().isMtp())
+            {
+                auto const& pretrainedConfig = json.at("pretrained_config");
+                auto const numMtpModules = parseJsonFieldOr(pretrainedConfig, "num_nextn_predict_layers", 0);
+
+                TLLM_CHECK_WITH_INFO(
+                    numMtpModules > 0, "num_nextn_predict_layers has to be larger than 0 for MTP decoding");
+                TLLM_CHECK_WITH_INFO(maxDraftLen == 0 || maxDraftLen == numMtpModules,
+                    "max_draft_len (%d) has to be equal to num_nextn_predict_layers (%d) for MTP decoding", maxDraftLen,
+                    numMtpModules);
+                // Every MTP module is one transformer block drafting one token from the hidden state of the previous
+                // depth, i.e. an Eagle net of one layer with a single non-leaf node per draft layer.
+                auto eagleModule = std::make_shared<EagleModule>(numMtpModules, numMtpModules, 1, 1);
+                eagleModule->setDefaultEagleChoices(EagleModule::getChainEagleChoices(numMtpModules));
+                modelConfig.setSpeculativeDecodingModule(eagleModule);
+            }
             else if (modelConfig.getSpeculativeDecodingMode().isEagle())
             {
                 auto const& pretrainedConfig = json.at("pretrained_config");
@@ -20,10 +20,14 @@
 #include "iBuffer.h"
 #include "tensorrt_llm/batch_manager/createNewDecoderRequests.h"
 #include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/iterationTimeline.h"
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/stringUtils.h"
+#include "tensorrt_llm/runtime/allReduceProfiler.h"
 #include "tensorrt_llm/runtime/gptDecoderBatched.h"
 #include "tensorrt_llm/runtime/ipcUtils.h"
+#include "tensorrt_llm/runtime/kernelSampler.h"
 #include "tensorrt_llm/runtime/ncclCommunicator.h"
 #include "tensorrt_llm/runtime/runtimeBuffers.h"
 #include "tensorrt_llm/runtime/runtimeKernels.h"
@@ -118,7 +122,7 @@ GptSession::GptSession(Config const& sessionConfig, ModelConfig const& modelConf
 GptSession::GptSession(Config const& sessionConfig, ModelConfig const& modelConfig, WorldConfig const& worldConfig,
     std::string const& engineFile, LoggerPtr logger)
     : GptSession(
-        setPath(sessionConfig, engineFile), modelConfig, worldConfig, utils::loadEngine(engineFile), std::move(logger))
+        setPath(sessionConfig, engineFile), modelConfig, worldConfig, RawEngine(engineFile), std::move(logger))
 {
 }
 
@@ -279,6 +283,17 @@ void GptSession::createCustomAllReduceWorkspace(
     mAllReduceBuffers = std::make_shared<AllReduceBuffers>(maxBatchSize, maxBeamWidth, maxSequenceLength, hiddenSize,
         manager, mWorldConfig, mRuntime->isUserBufferEnabled());
 
+    if (!mRuntime->isUserBufferEnabled())
+    {
+        // Messages up to the workspace of one rank, see AllReduceBuffers.
+        auto const tpSize = mWorldConfig.getTensorParallelism();
+        auto const maxMessageBytes = std::min(
+            static_cast<std::size_t>(maxBatchSize) * maxBeamWidth * maxSequenceLength * hiddenSize * sizeof(float),
+            tensorrt_llm::utils::customAllReduceUtils::getMaxRequiredWorkspaceSize(tpSize));
+        tuneAllReduceStrategies(*mAllReduceBuffers, manager, mWorldConfig, mModelConfig.getDataType(),
+            tpSize * hiddenSize, maxMessageBytes);
+    }
+
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
 
@@ -367,6 +382,26 @@ void GptSession::setup(Config const& sessionConfig)
         createDecoders(mMicroBatchConfig.genBatchSize, maxBeamWidth, maxAttentionWindow, sinkTokenLength,
             maxSequenceLength, logitsType, sessionConfig.decoderPerRequest, mMicroBatchConfig.numGenBatches,
             decodingMode);
+
+        if (tc::getEnvOverlapMicroBatchDecoding())
+        {
+            // While the engine runs the step of a micro batch, the decoder of the previous one samples its tokens. The
+            // next step of a micro batch waits for its decoder in waitForDecoderStep.
+            if (mWorldConfig.isPipelineParallel() || mMicroBatchConfig.numGenBatches < 2
+                || !sessionConfig.decoderPerRequest)
+            {
+                TLLM_LOG_WARNING(
+                    "Overlapping the decoding of the micro batches needs at least 2 generation micro batches, no "
+                    "pipeline parallelism and a decoder per request, the decoding is not overlapped");
+            }
+            else
+            {
+                for (auto& decoder : mDecoders)
+                {
+                    std::dynamic_pointer_cast<GptDecoderBatched>(decoder)->setOverlapWithEngine(true);
+                }
+            }
+        }
     }
 
     if (mWorldConfig.isPipelineParallel() || mMicroBatchConfig.numGenBatches > 1)
@@ -832,7 +867,11 @@ void GptSession::generateBatched(std::vector<GenerationOutput>& microBatchesOutp
     auto const profileContext = !kProfileMbIdxs.empty() && kProfileMbIdxs.count(0) > 0;
     if (profileContext)
         cudaProfilerStart();
-    executeContextStep(microBatchesInputs, microBatchOffsets, kvCacheManager);
+    {
+        tc::IterationTimeline::ScopedIteration const timelineIteration;
+        KernelSampler::ScopedIteration const kernelSamplerIteration;
+        executeContextStep(microBatchesInputs, microBatchOffsets, kvCacheManager);
+    }
     if (profileContext)
         cudaProfilerStop();
 
@@ -853,10 +892,15 @@ void GptSession::generateBatched(std::vector<GenerationOutput>& microBatchesOutp
         if (profileStep)
             cudaProfilerStart();
 
-        numBatchesFinished += executeGenerationStep(
-            step, microBatchesInputs, microBatchesOutputs, microBatchOffsets, kvCacheManager, microBatchesFinished);
+        {
+            tc::IterationTimeline::ScopedIteration const timelineIteration;
+            KernelSampler::ScopedIteration const kernelSamplerIteration;
+            numBatchesFinished += executeGenerationStep(
+                step, microBatchesInputs, microBatchesOutputs, microBatchOffsets, kvCacheManager, microBatchesFinished);
 
-        onTokenGenerated(step - 1, numBatchesFinished == numMicroBatches);
+            TLLM_TIMELINE_SCOPE("response_dispatch");
+            onTokenGenerated(step - 1, numBatchesFinished == numMicroBatches);
+        }
 
         if (profileStep)
             cudaProfilerStop();
@@ -870,6 +914,7 @@ void GptSession::generateBatched(std::vector<GenerationOutput>& microBatchesOutp
     // Collect the results for the last step
     for (auto microBatchId = 0; microBatchId < numMicroBatches; ++microBatchId)
     {
+        waitForDecoderStep(microBatchId);
         auto const& generationConfig = mBuffers.at(microBatchId)->generationConfig;
         auto const microBatchSize = generationConfig.batchSize;
 
@@ -1025,6 +1070,7 @@ SizeType32 GptSession::executeGenerationStep(SizeType32 step, std::vector<Genera
         auto& inputBuffer = buffers.inputBuffers[flipFlopId];
         auto& outputBuffer = buffers.outputBuffers[flipFlopId];
 
+        waitForDecoderStep(generationBatchId);
         auto nextInputIds = buffers.prepareNextStep(
             step - 1, manager, kvCacheManager, microBatchOffsets.at(generationBatchId), mModelConfig, mWorldConfig);
         buffers.getRuntimeBuffers(
@@ -1171,14 +1217,32 @@ void GptSession::decoderStepAsync(SizeType32 decoderStep, SizeType32 microBatchI
 
     if (!mWorldConfig.isPipelineParallel() && mMicroBatchConfig.numGenBatches > 1)
     {
-        updateOutputIds(outputIds, newTokens, decoderStep, stream);
-        stream.record(mReceivedEvents.at(microBatchId).get());
+        // Stay behind the decoding on its stream when it overlaps the engine step of the next micro batch.
+        auto const* decoder = dynamic_cast<GptDecoderBatched const*>(mDecoders.at(microBatchId).get());
+        auto const& outputStream
+            = decoder != nullptr && decoder->getOverlapWithEngine() ? *decoder->getDecoderStream() : stream;
+        updateOutputIds(outputIds, newTokens, decoderStep, outputStream);
+        outputStream.record(mReceivedEvents.at(microBatchId).get());
     }
 
     sync_check_cuda_error();
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
 
+void GptSession::waitForDecoderStep(SizeType32 microBatchId)
+{
+    if (!mWorldConfig.isLastPipelineParallelRank())
+    {
+        return;
+    }
+    auto const* decoder = dynamic_cast<GptDecoderBatched const*>(mDecoders.at(microBatchId).get());
+    if (decoder != nullptr && decoder->getOverlapWithEngine())
+    {
+        // The output ids are updated on the decoder stream after the decoding, their event covers both.
+        mRuntime->getStream().wait(mReceivedEvents.at(microBatchId));
+    }
+}
+
 bool GptSession::shouldStopSync(SizeType32 batchSize, SizeType32 beamWidth, SizeType32 microBatchId)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
@@ -0,0 +1,440 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/hostSampler.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+#include "tensorrt_llm/layers/defaultDecodingParams.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TLLM_HOST_SAMPLER_AVX512 1
+#include <immintrin.h>
+#endif
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+using DefaultParams = tensorrt_llm::layers::DefaultDecodingParams;
+using FinishReason = tensorrt_llm::executor::FinishReason;
+
+template <typename T>
+bool isDefault(std::optional<std::vector<T>> const& values, T defaultValue)
+{
+    return !values.has_value()
+        || std::all_of(values->begin(), values->end(), [defaultValue](T value) { return value == defaultValue; });
+}
+
+template <typename T>
+T getFirst(std::optional<std::vector<T>> const& values, T defaultValue)
+{
+    return values.has_value() && !values->empty() ? values->front() : defaultValue;
+}
+
+// Orders the top-k candidates as a min-heap, the smallest candidate being the threshold of the scan.
+bool greaterCandidate(host_sampler::Candidate const& lhs, host_sampler::Candidate const& rhs)
+{
+    return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+}
+
+void convertRowScalar(std::uint16_t const* src, float* dst, SizeType32 n)
+{
+    for (SizeType32 i = 0; i < n; ++i)
+    {
+        dst[i] = host_sampler::halfToFloat(src[i]);
+    }
+}
+
+SizeType32 argmaxScalar(float const* row, SizeType32 n)
+{
+    return static_cast<SizeType32>(std::max_element(row, row + n) - row);
+}
+
+// Offers the elements of row above the threshold of the heap of candidates, starting at first.
+void scanTopKScalar(float const* row, SizeType32 first, SizeType32 n, SizeType32 k,
+    std::vector<host_sampler::Candidate>& heap)
+{
+    for (SizeType32 i = first; i < n; ++i)
+    {
+        if (static_cast<SizeType32>(heap.size()) < k)
+        {
+            heap.emplace_back(row[i], i);
+            std::push_heap(heap.begin(), heap.end(), greaterCandidate);
+        }
+        else if (row[i] > heap.front().first)
+        {
+            std::pop_heap(heap.begin(), heap.end(), greaterCandidate);
+            heap.back() = {row[i], i};
+            std::push_heap(heap.begin(), heap.end(), greaterCandidate);
+        }
+    }
+}
+
+#if TLLM_HOST_SAMPLER_AVX512
+
+__attribute__((target("avx512f"))) void convertRowAvx512(std::uint16_t const* src, float* dst, SizeType32 n)
+{
+    SizeType32 i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        auto const half = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+        _mm512_storeu_ps(dst + i, _mm512_cvtph_ps(half));
+    }
+    convertRowScalar(src + i, dst + i, n - i);
+}
+
+__attribute__((target("avx512f"))) SizeType32 argmaxAvx512(float const* row, SizeType32 n)
+{
+    if (n < 16)
+    {
+        return argmaxScalar(row, n);
+    }
+    // The max first, then the first position holding it, so ties resolve to the lowest id as on the device.
+    auto maxValues = _mm512_loadu_ps(row);
+    SizeType32 i = 16;
+    for (; i + 16 <= n; i += 16)
+    {
+        maxValues = _mm512_max_ps(maxValues, _mm512_loadu_ps(row + i));
+    }
+    auto maxValue = _mm512_reduce_max_ps(maxValues);
+    for (; i < n; ++i)
+    {
+        maxValue = std::max(maxValue, row[i]);
+    }
+    auto const target = _mm512_set1_ps(maxValue);
+    for (i = 0; i + 16 <= n; i += 16)
+    {
+        auto const mask = _mm512_cmp_ps_mask(_mm512_loadu_ps(row + i), target, _CMP_EQ_OQ);
+        if (mask != 0)
+        {
+            return i + static_cast<SizeType32>(__builtin_ctz(mask));
+        }
+    }
+    return static_cast<SizeType32>(std::find(row + i, row + n, maxValue) - row);
+}
+
+__attribute__((target("avx512f"))) void scanTopKAvx512(
+    float const* row, SizeType32 n, SizeType32 k, std::vector<host_sampler::Candidate>& heap)
+{
+    // Fill the heap, then only blocks with an element above its threshold leave the vector loop.
+    auto const first = std::min(k, n);
+    scanTopKScalar(row, 0, first, k, heap);
+    SizeType32 i = first;
+    for (; i + 16 <= n; i += 16)
+    {
+        auto const values = _mm512_loadu_ps(row + i);
+        auto mask = static_cast<std::uint32_t>(
+            _mm512_cmp_ps_mask(values, _mm512_set1_ps(heap.front().first), _CMP_GT_OQ));
+        while (mask != 0)
+        {
+            auto const j = i + static_cast<SizeType32>(__builtin_ctz(mask));
+            mask &= mask - 1;
+            if (row[j] > heap.front().first)
+            {
+                std::pop_heap(heap.begin(), heap.end(), greaterCandidate);
+                heap.back() = {row[j], j};
+                std::push_heap(heap.begin(), heap.end(), greaterCandidate);
+            }
+        }
+    }
+    scanTopKScalar(row, i, n, k, heap);
+}
+
+#endif // TLLM_HOST_SAMPLER_AVX512
+
+} // namespace
+
+float host_sampler::halfToFloat(std::uint16_t half)
+{
+    std::uint32_t const sign = static_cast<std::uint32_t>(half & 0x8000U) << 16;
+    std::uint32_t exponent = (half >> 10) & 0x1FU;
+    std::uint32_t mantissa = half & 0x3FFU;
+    std::uint32_t bits{0};
+    if (exponent == 0x1FU)
+    {
+        bits = sign | 0x7F800000U | (mantissa << 13);
+    }
+    else if (exponent != 0)
+    {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else if (mantissa != 0)
+    {
+        // Subnormal, normalized in float.
+        exponent = 113;
+        while ((mantissa & 0x400U) == 0)
+        {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FFU) << 13);
+    }
+    else
+    {
+        bits = sign;
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void host_sampler::convertRow(std::uint16_t const* src, float* dst, SizeType32 n, bool avx512)
+{
+#if TLLM_HOST_SAMPLER_AVX512
+    if (avx512)
+    {
+        convertRowAvx512(src, dst, n);
+        return;
+    }
+#endif
+    convertRowScalar(src, dst, n);
+}
+
+SizeType32 host_sampler::argmax(float const* row, SizeType32 n, bool avx512)
+{
+#if TLLM_HOST_SAMPLER_AVX512
+    if (avx512)
+    {
+        return argmaxAvx512(row, n);
+    }
+#endif
+    return argmaxScalar(row, n);
+}
+
+void host_sampler::topK(float const* row, SizeType32 n, SizeType32 k, std::vector<Candidate>& candidates, bool avx512)
+{
+    candidates.clear();
+#if TLLM_HOST_SAMPLER_AVX512
+    if (avx512)
+    {
+        scanTopKAvx512(row, n, k, candidates);
+    }
+    else
+#endif
+    {
+        scanTopKScalar(row, 0, n, k, candidates);
+    }
+    std::sort(candidates.begin(), candidates.end(), greaterCandidate);
+}
+
+FinishReason host_sampler::finishStep(
+    TokenIdType token, TokenIdType endId, SizeType32& sequenceLength, SizeType32 maxSequenceLength)
+{
+    if (token == endId)
+    {
+        return FinishReason::kEND_ID;
+    }
+    return ++sequenceLength >= maxSequenceLength ? FinishReason::kLENGTH : FinishReason::kNOT_FINISHED;
+}
+
+HostSampler::Result const& HostSampler::PendingStep::get()
+{
+    for (auto const& chunk : mChunks)
+    {
+        chunk.get();
+    }
+    return *mResult;
+}
+
+HostSampler::HostSampler(SizeType32 maxBatchSize, SizeType32 vocabSize, SizeType32 vocabSizePadded,
+    nvinfer1::DataType logitsType, BufferManager bufferManager, std::size_t numThreads)
+    : mMaxBatchSize{maxBatchSize}
+    , mVocabSize{vocabSize}
+    , mVocabSizePadded{vocabSizePadded}
+    , mLogitsType{logitsType}
+    , mBufferManager{std::move(bufferManager)}
+    , mNumThreads{numThreads}
+    , mSlots(maxBatchSize)
+{
+    TLLM_CHECK_WITH_INFO(mNumThreads > 0, "Host sampling needs at least one thread");
+    TLLM_CHECK(mVocabSize > 0 && mVocabSize <= mVocabSizePadded);
+    TLLM_CHECK_WITH_INFO(mLogitsType == nvinfer1::DataType::kFLOAT || mLogitsType == nvinfer1::DataType::kHALF,
+        "Host sampling supports FP32 and FP16 logits only");
+    auto const stagingShape = ITensor::makeShape({maxBatchSize, vocabSizePadded});
+    for (auto& staging : mStagings)
+    {
+        staging.logits = BufferManager::pinned(stagingShape, mLogitsType);
+    }
+    mWorkerPool = std::make_unique<WorkerPool>(mNumThreads, mBufferManager.getStream().getDevice());
+    TLLM_LOG_INFO("Sampling simple requests on %lu host threads%s", mNumThreads, hasAvx512() ? " with AVX-512" : "");
+}
+
+bool HostSampler::isSupported(SamplingConfig const& config)
+{
+    if (config.beamWidth != 1 || config.getNumReturnBeams() != 1)
+    {
+        return false;
+    }
+    auto const topK = getFirst(config.topK, DefaultParams::getTopK());
+    auto const topP = getFirst(config.topP, DefaultParams::getTopP());
+    // topK 0 and topP 0 is greedy, top-p 1 keeps the whole top-k.
+    auto const isTopK = topK >= 0 && topK <= kMaxTopK && (topP == 0.F || (topP == 1.F && topK > 0));
+    return isTopK && isDefault(config.repetitionPenalty, DefaultParams::getRepetitionPenalty())
+        && isDefault(config.presencePenalty, DefaultParams::getPresencePenalty())
+        && isDefault(config.frequencyPenalty, DefaultParams::getFrequencyPenalty())
+        && isDefault(config.minLength, DefaultParams::getMinLength())
+        && isDefault(config.noRepeatNgramSize, DefaultParams::getNoRepeatNgramSize())
+        && isDefault(config.minP, DefaultParams::getMinP()) && isDefault(config.outputLogProbs, false)
+        && isDefault(config.cumLogProbs, false) && !config.topPDecay.has_value() && !config.topPMin.has_value()
+        && !config.topPResetIds.has_value();
+}
+
+bool HostSampler::hasAvx512()
+{
+#if TLLM_HOST_SAMPLER_AVX512
+    static bool const hasAvx512 = __builtin_cpu_supports("avx512f");
+    return hasAvx512;
+#else
+    return false;
+#endif
+}
+
+void HostSampler::setup(SizeType32 slot, SamplingConfig const& config, TokenIdType endId, SizeType32 sequenceLength,
+    SizeType32 maxSequenceLength)
+{
+    TLLM_CHECK_WITH_INFO(isSupported(config), "The sampling config of slot %d cannot be sampled on the host", slot);
+    auto& state = mSlots.at(slot);
+    state.endId = endId;
+    state.sequenceLength = sequenceLength;
+    state.maxSequenceLength = maxSequenceLength;
+    state.topK = std::max(getFirst(config.topK, DefaultParams::getTopK()), 1);
+    state.temperature = getFirst(config.temperature, DefaultParams::getTemperature());
+    state.generator.seed(getFirst(config.randomSeed, DefaultParams::getSeed()));
+}
+
+HostSampler::PendingStep HostSampler::sampleAsync(std::vector<SizeType32> const& slots, ITensor const& logits)
+{
+    NVTX3_SCOPED_RANGE(hostSamplerSampleAsync);
+    auto const numRequests = static_cast<SizeType32>(slots.size());
+    TLLM_CHECK(numRequests <= mMaxBatchSize);
+    TLLM_CHECK_WITH_INFO(logits.getSize() == static_cast<std::size_t>(numRequests) * mVocabSizePadded,
+        "Expected %d rows of %d logits", numRequests, mVocabSizePadded);
+    TLLM_CHECK(logits.getDataType() == mLogitsType);
+
+    PendingStep step;
+    step.mResult = std::make_shared<Result>();
+    step.mResult->newTokens.resize(numRequests);
+    step.mResult->sequenceLengths.resize(numRequests);
+    step.mResult->finishReasons.resize(numRequests, executor::FinishReason::kNOT_FINISHED);
+    if (numRequests == 0)
+    {
+        return step;
+    }
+
+    // The staging buffer is reused two steps later, when the caller is usually done with that step.
+    auto& staging = mStagings[mNextStaging];
+    mNextStaging = (mNextStaging + 1) % mStagings.size();
+    for (auto const& chunk : staging.chunks)
+    {
+        chunk.wait();
+    }
+    staging.chunks.clear();
+
+    auto stagingLogits = ITensor::slice(staging.logits, 0, numRequests);
+    mBufferManager.copy(logits, *stagingLogits);
+    mBufferManager.getStream().record(staging.copied);
+
+    auto const sharedSlots = std::make_shared<std::vector<SizeType32> const>(slots);
+    auto const numChunks = std::min(mNumThreads, slots.size());
+    for (std::size_t ci = 0; ci < numChunks; ++ci)
+    {
+        auto const begin = slots.size() * ci / numChunks;
+        auto const end = slots.size() * (ci + 1) / numChunks;
+        auto future = mWorkerPool->enqueue(
+            [this, &staging, sharedSlots, begin, end, result = step.mResult]()
+            {
+                staging.copied.synchronize();
+                sampleRows(staging, *sharedSlots, begin, end, *result);
+            });
+        staging.chunks.emplace_back(future.share());
+    }
+    step.mChunks = staging.chunks;
+    return step;
+}
+
+void HostSampler::sampleRows(
+    Staging const& staging, std::vector<SizeType32> const& slots, std::size_t begin, std::size_t end, Result& result)
+{
+    NVTX3_SCOPED_RANGE(hostSamplerSampleRows);
+    thread_local std::vector<float> row;
+    if (mLogitsType == nvinfer1::DataType::kHALF)
+    {
+        row.resize(mVocabSize);
+    }
+
+    for (auto ri = begin; ri < end; ++ri)
+    {
+        auto& state = mSlots.at(slots[ri]);
+        float const* logits{nullptr};
+        if (mLogitsType == nvinfer1::DataType::kHALF)
+        {
+            auto const* src = static_cast<std::uint16_t const*>(staging.logits->data()) + ri * mVocabSizePadded;
+            host_sampler::convertRow(src, row.data(), mVocabSize, hasAvx512());
+            logits = row.data();
+        }
+        else
+        {
+            logits = bufferCast<float>(*staging.logits) + ri * mVocabSizePadded;
+        }
+
+        auto const token = sampleRow(logits, state);
+        result.finishReasons[ri]
+            = host_sampler::finishStep(token, state.endId, state.sequenceLength, state.maxSequenceLength);
+        result.newTokens[ri] = token;
+        result.sequenceLengths[ri] = state.sequenceLength;
+    }
+}
+
+TokenIdType HostSampler::sampleRow(float const* logits, SlotState& state) const
+{
+    if (state.topK == 1 || state.temperature <= 0.F)
+    {
+        return host_sampler::argmax(logits, mVocabSize, hasAvx512());
+    }
+
+    thread_local std::vector<host_sampler::Candidate> heap;
+    thread_local std::vector<float> probs;
+    host_sampler::topK(logits, mVocabSize, std::min(state.topK, mVocabSize), heap, hasAvx512());
+
+    // Unnormalized softmax of the candidates with temperature, sampled by inverse transform.
+    probs.resize(heap.size());
+    auto const maxLogit = heap.front().first;
+    float sum{0.F};
+    for (std::size_t i = 0; i < heap.size(); ++i)
+    {
+        probs[i] = std::exp((heap[i].first - maxLogit) / state.temperature);
+        sum += probs[i];
+    }
+    auto const u = std::uniform_real_distribution<float>{0.F, sum}(state.generator);
+    float cumulative{0.F};
+    for (std::size_t i = 0; i < heap.size(); ++i)
+    {
+        cumulative += probs[i];
+        if (u < cumulative)
+        {
+            return heap[i].second;
+        }
+    }
+    return heap.back().second;
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/executor/types.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/samplingConfig.h"
+#include "tensorrt_llm/runtime/workerPool.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Row operations of HostSampler. The avx512 variants need HostSampler::hasAvx512.
+namespace host_sampler
+{
+using Candidate = std::pair<float, SizeType32>;
+
+[[nodiscard]] float halfToFloat(std::uint16_t half);
+
+//! \brief Convert n FP16 values, given as their bits, to float.
+void convertRow(std::uint16_t const* src, float* dst, SizeType32 n, bool avx512);
+
+//! \brief Position of the max of row, the lowest one on ties as on the device.
+[[nodiscard]] SizeType32 argmax(float const* row, SizeType32 n, bool avx512);
+
+//! \brief The min(k, n) largest elements of row, by decreasing value then increasing id.
+void topK(float const* row, SizeType32 n, SizeType32 k, std::vector<Candidate>& candidates, bool avx512);
+
+//! \brief Finish reason of a step that sampled token, adding it to sequenceLength unless it is the end id.
+[[nodiscard]] executor::FinishReason finishStep(
+    TokenIdType token, TokenIdType endId, SizeType32& sequenceLength, SizeType32 maxSequenceLength);
+} // namespace host_sampler
+
+//! \brief Samples the tokens of a generation step on host cores, for requests with greedy or plain top-k sampling.
+//! \details In high-batch offline generation, the sampling layers of DynamicDecodeLayer run on the decoder stream and
+//! take SMs and HBM bandwidth from the engine while the host cores are idle. The sampler copies the logits of a step
+//! to pinned memory on the stream of its buffer manager, where the copy overlaps the compute of the next engine step,
+//! and samples them on a pool of host threads: an argmax for greedy requests, a top-k selection and a softmax with
+//! temperature for the others. The rows are scanned with AVX-512 when the CPU supports it. The end id and the length
+//! stop criteria are evaluated on the host too.
+//!
+//! It only serves the requests isSupported accepts, the others go through the decoder. The random numbers are not the
+//! ones of the curand states of the decoder, so top-k outputs differ from device sampling with the same seed.
+class HostSampler
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+
+    //! \brief Outputs of a step, in the order of the slots passed to sampleAsync.
+    struct Result
+    {
+        std::vector<TokenIdType> newTokens;
+        //! \brief Lengths after the step. As in the decoder, the end id is not counted.
+        std::vector<SizeType32> sequenceLengths;
+        std::vector<executor::FinishReason> finishReasons;
+    };
+
+    //! \brief A step whose logits are being copied or sampled.
+    class PendingStep
+    {
+    public:
+        //! \brief Wait for the sampling of the step, rethrowing its errors.
+        [[nodiscard]] Result const& get();
+
+    private:
+        friend class HostSampler;
+
+        std::vector<std::shared_future<void>> mChunks;
+        std::shared_ptr<Result> mResult;
+    };
+
+    //! \param logitsType kFLOAT or kHALF.
+    //! \param numThreads Host threads sampling the rows of a step, at least one. Host sampling is off by default, the
+    //! caller only creates a sampler when TRTLLM_HOST_SAMPLING_THREADS is set and passes its value.
+    HostSampler(SizeType32 maxBatchSize, SizeType32 vocabSize, SizeType32 vocabSizePadded,
+        nvinfer1::DataType logitsType, BufferManager bufferManager, std::size_t numThreads);
+
+    //! \brief Whether the host can sample a request: beam width 1, greedy or top-k up to kMaxTopK without top-p, no
+    //! penalties, min length, min-p or log probs.
+    [[nodiscard]] static bool isSupported(SamplingConfig const& config);
+
+    //! \brief Whether the rows are scanned with AVX-512.
+    [[nodiscard]] static bool hasAvx512();
+
+    //! \brief Set the request sampled in a slot, while no step of the slot is pending.
+    //! \param sequenceLength Length of the sequence of the request before its first sampled token.
+    void setup(SizeType32 slot, SamplingConfig const& config, TokenIdType endId, SizeType32 sequenceLength,
+        SizeType32 maxSequenceLength);
+
+    //! \brief Start sampling a token for the requests of slots.
+    //! \param logits [slots.size(), vocabSizePadded] on the device, ready on the stream of the buffer manager.
+    [[nodiscard]] PendingStep sampleAsync(std::vector<SizeType32> const& slots, ITensor const& logits);
+
+    [[nodiscard]] SizeType32 getSequenceLength(SizeType32 slot) const
+    {
+        return mSlots.at(slot).sequenceLength;
+    }
+
+    static constexpr SizeType32 kMaxTopK = 1024;
+
+private:
+    struct SlotState
+    {
+        TokenIdType endId{-1};
+        SizeType32 sequenceLength{0};
+        SizeType32 maxSequenceLength{0};
+        //! \brief 1 for greedy requests.
+        SizeType32 topK{1};
+        float temperature{1.F};
+        std::mt19937_64 generator;
+    };
+
+    // Pinned logits of a step, reused once the chunks of that step are sampled.
+    struct Staging
+    {
+        TensorPtr logits;
+        CudaEvent copied{};
+        std::vector<std::shared_future<void>> chunks;
+    };
+
+    //! \brief Sample the rows [begin, end) of a staging buffer.
+    void sampleRows(Staging const& staging, std::vector<SizeType32> const& slots, std::size_t begin, std::size_t end,
+        Result& result);
+
+    [[nodiscard]] TokenIdType sampleRow(float const* logits, SlotState& state) const;
+
+    SizeType32 mMaxBatchSize;
+    SizeType32 mVocabSize;
+    SizeType32 mVocabSizePadded;
+    nvinfer1::DataType mLogitsType;
+    BufferManager mBufferManager;
+    std::size_t mNumThreads;
+    std::vector<SlotState> mSlots;
+
+    std::array<Staging, 2> mStagings;
+    std::size_t mNextStaging{0};
+
+    // Declared last to join the workers before the staging buffers are freed.
+    std::unique_ptr<WorkerPool> mWorkerPool;
+};
+
+} // namespace tensorrt_llm::runtime
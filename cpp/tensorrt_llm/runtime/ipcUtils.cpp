@@ -19,6 +19,7 @@
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/common/customAllReduceUtils.h"
 #include "tensorrt_llm/common/mpiUtils.h"
+#include "tensorrt_llm/common/startupTrace.h"
 #include "tensorrt_llm/common/workspace.h"
 
 #include <NvInferRuntimeBase.h>
@@ -150,6 +151,7 @@ AllReduceBuffers::AllReduceBuffers(SizeType32 maxBatchSize, SizeType32 maxBeamWi
     SizeType32 hiddenSize, BufferManager const& manager, WorldConfig const& worldConfig, bool const fakeBuffers)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    TLLM_STARTUP_PHASE("custom_allreduce_ipc_setup");
     if (fakeBuffers)
     {
         auto const tpSize = worldConfig.getTensorParallelism();
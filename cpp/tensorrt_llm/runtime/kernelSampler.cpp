@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/kernelSampler.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+#ifdef ENABLE_CUPTI
+#include <cupti.h>
+#ifndef _WIN32
+#include <cxxabi.h>
+#endif
+#endif
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+#ifdef ENABLE_CUPTI
+#define TLLM_CUPTI_CHECK(call)                                                                                         \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        CUptiResult const status_ = call;                                                                              \
+        if (status_ != CUPTI_SUCCESS)                                                                                  \
+        {                                                                                                              \
+            char const* msg_ = nullptr;                                                                                \
+            cuptiGetResultString(status_, &msg_);                                                                      \
+            TLLM_THROW("CUPTI error in %s: %s", #call, msg_);                                                         \
+        }                                                                                                              \
+    } while (0)
+
+std::size_t constexpr kBufferSize = 8 * 1024 * 1024;
+std::size_t constexpr kBufferAlignment = 8;
+
+CUpti_ActivityKind constexpr kActivityKinds[] = {CUPTI_ACTIVITY_KIND_CONCURRENT_KERNEL, CUPTI_ACTIVITY_KIND_RUNTIME,
+    CUPTI_ACTIVITY_KIND_DRIVER, CUPTI_ACTIVITY_KIND_EXTERNAL_CORRELATION, CUPTI_ACTIVITY_KIND_MARKER};
+
+void CUPTIAPI bufferRequested(uint8_t** buffer, size_t* size, size_t* maxNumRecords)
+{
+    *buffer = static_cast<uint8_t*>(std::aligned_alloc(kBufferAlignment, kBufferSize));
+    *size = *buffer != nullptr ? kBufferSize : 0;
+    *maxNumRecords = 0;
+}
+
+void CUPTIAPI bufferCompleted(CUcontext, uint32_t, uint8_t* buffer, size_t, size_t validSize)
+{
+    KernelSampler::getInstance().consumeBuffer(buffer, validSize);
+    std::free(buffer);
+}
+
+//! \brief The demangled name without the parameters, the mangled one if it cannot be demangled.
+std::string demangle(char const* name)
+{
+#ifndef _WIN32
+    int status{0};
+    char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (status == 0 && demangled != nullptr)
+    {
+        std::string result{demangled};
+        std::free(demangled);
+        return result.substr(0, result.find('('));
+    }
+    std::free(demangled);
+#endif
+    return name;
+}
+#endif
+
+SizeType32 getSamplingInterval()
+{
+    auto const interval = common::getEnvKernelSamplingInterval();
+#ifndef ENABLE_CUPTI
+    if (interval > 0)
+    {
+        TLLM_LOG_WARNING("TLLM_KERNEL_SAMPLING_INTERVAL is ignored, TensorRT-LLM was built without ENABLE_CUPTI");
+    }
+    return 0;
+#else
+    return interval;
+#endif
+}
+} // namespace
+
+KernelSampler::ScopedIteration::ScopedIteration()
+    : mSampled{false}
+{
+    auto& sampler = KernelSampler::getInstance();
+    if (!sampler.isEnabled())
+    {
+        return;
+    }
+    auto const iteration = sampler.mNextIteration++;
+    if (iteration % sampler.mInterval == 0)
+    {
+        sampler.mSampledIteration = iteration;
+        sampler.beginSample();
+        mSampled = true;
+    }
+}
+
+KernelSampler::ScopedIteration::~ScopedIteration()
+{
+    if (mSampled)
+    {
+        KernelSampler::getInstance().endSample();
+    }
+}
+
+KernelSampler::ScopedRegion::ScopedRegion([[maybe_unused]] char const* name)
+    : mPushed{false}
+{
+#ifdef ENABLE_CUPTI
+    auto& sampler = KernelSampler::getInstance();
+    if (sampler.isSampling())
+    {
+        TLLM_CUPTI_CHECK(
+            cuptiActivityPushExternalCorrelationId(CUPTI_EXTERNAL_CORRELATION_KIND_CUSTOM0, sampler.getRegionId(name)));
+        mPushed = true;
+    }
+#endif
+}
+
+KernelSampler::ScopedRegion::~ScopedRegion()
+{
+#ifdef ENABLE_CUPTI
+    if (mPushed)
+    {
+        uint64_t regionId{0};
+        cuptiActivityPopExternalCorrelationId(CUPTI_EXTERNAL_CORRELATION_KIND_CUSTOM0, &regionId);
+    }
+#endif
+}
+
+KernelSampler::KernelSampler()
+    : mInterval{getSamplingInterval()}
+{
+#ifdef ENABLE_CUPTI
+    if (isEnabled())
+    {
+        TLLM_CUPTI_CHECK(cuptiActivityRegisterCallbacks(bufferRequested, bufferCompleted));
+        TLLM_LOG_INFO("Sampling the kernels of 1 in %d iterations with CUPTI", mInterval);
+    }
+#endif
+}
+
+KernelSampler& KernelSampler::getInstance()
+{
+    static KernelSampler sampler;
+    return sampler;
+}
+
+std::uint64_t KernelSampler::getRegionId(char const* name)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const [it, inserted] = mRegionIds.try_emplace(name, mRegionNames.size() + 1);
+    if (inserted)
+    {
+        mRegionNames.emplace_back(name);
+    }
+    return it->second;
+}
+
+void KernelSampler::beginSample()
+{
+#ifdef ENABLE_CUPTI
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mKernels.clear();
+        mLaunches.clear();
+        mRegionByCorrelation.clear();
+        mOpenRanges.clear();
+        mRangesByThread.clear();
+    }
+    for (auto const kind : kActivityKinds)
+    {
+        TLLM_CUPTI_CHECK(cuptiActivityEnable(kind));
+    }
+    mSampling.store(true, std::memory_order_relaxed);
+#endif
+}
+
+void KernelSampler::consumeBuffer([[maybe_unused]] std::uint8_t* buffer, [[maybe_unused]] std::size_t validSize)
+{
+#ifdef ENABLE_CUPTI
+    std::lock_guard<std::mutex> lock(mMutex);
+    CUpti_Activity* record = nullptr;
+    while (cuptiActivityGetNextRecord(buffer, validSize, &record) == CUPTI_SUCCESS)
+    {
+        switch (record->kind)
+        {
+        case CUPTI_ACTIVITY_KIND_CONCURRENT_KERNEL:
+        {
+            auto const* kernel = reinterpret_cast<CUpti_ActivityKernel9 const*>(record);
+            mKernels.push_back(
+                KernelRecord{kernel->correlationId, kernel->end - kernel->start, demangle(kernel->name)});
+            break;
+        }
+        case CUPTI_ACTIVITY_KIND_RUNTIME:
+        case CUPTI_ACTIVITY_KIND_DRIVER:
+        {
+            auto const* api = reinterpret_cast<CUpti_ActivityAPI const*>(record);
+            mLaunches[api->correlationId] = Launch{api->threadId, api->start};
+            break;
+        }
+        case CUPTI_ACTIVITY_KIND_EXTERNAL_CORRELATION:
+        {
+            auto const* correlation = reinterpret_cast<CUpti_ActivityExternalCorrelation const*>(record);
+            if (correlation->externalKind == CUPTI_EXTERNAL_CORRELATION_KIND_CUSTOM0)
+            {
+                mRegionByCorrelation[correlation->correlationId] = correlation->externalId;
+            }
+            break;
+        }
+        case CUPTI_ACTIVITY_KIND_MARKER:
+        {
+            auto const* marker = reinterpret_cast<CUpti_ActivityMarker2 const*>(record);
+            if (marker->flags & CUPTI_ACTIVITY_FLAG_MARKER_START)
+            {
+                mOpenRanges[marker->id] = {marker->objectId.pt.threadId,
+                    Range{marker->timestamp, marker->timestamp, marker->name != nullptr ? marker->name : ""}};
+            }
+            else if (marker->flags & CUPTI_ACTIVITY_FLAG_MARKER_END)
+            {
+                // The ranges opened before the sample have no start and are dropped.
+                auto const it = mOpenRanges.find(marker->id);
+                if (it != mOpenRanges.end())
+                {
+                    auto& [threadId, range] = it->second;
+                    range.end = marker->timestamp;
+                    mRangesByThread[threadId].push_back(std::move(range));
+                    mOpenRanges.erase(it);
+                }
+            }
+            break;
+        }
+        default: break;
+        }
+    }
+#endif
+}
+
+void KernelSampler::endSample()
+{
+#ifdef ENABLE_CUPTI
+    // All the kernels of the iteration must be complete to be flushed.
+    TLLM_CUDA_CHECK(cudaDeviceSynchronize());
+    mSampling.store(false, std::memory_order_relaxed);
+    for (auto const kind : kActivityKinds)
+    {
+        TLLM_CUPTI_CHECK(cuptiActivityDisable(kind));
+    }
+    TLLM_CUPTI_CHECK(cuptiActivityFlushAll(CUPTI_ACTIVITY_FLAG_FLUSH_FORCED));
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // The innermost NVTX range of every launch, the ranges of a thread are nested so a sweep by start time with a
+    // stack of the open ranges finds them.
+    std::unordered_map<std::uint32_t, std::vector<std::pair<std::uint64_t, std::uint32_t>>> launchesByThread;
+    for (auto const& [correlationId, launch] : mLaunches)
+    {
+        launchesByThread[launch.threadId].emplace_back(launch.start, correlationId);
+    }
+    std::unordered_map<std::uint32_t, std::string const*> rangeByCorrelation;
+    for (auto& [threadId, launches] : launchesByThread)
+    {
+        auto& ranges = mRangesByThread[threadId];
+        std::sort(ranges.begin(), ranges.end(), [](Range const& a, Range const& b) { return a.start < b.start; });
+        std::sort(launches.begin(), launches.end());
+        std::vector<Range const*> openRanges;
+        std::size_t nextRange{0};
+        for (auto const& [start, correlationId] : launches)
+        {
+            for (; nextRange < ranges.size() && ranges[nextRange].start <= start; ++nextRange)
+            {
+                while (!openRanges.empty() && openRanges.back()->end < ranges[nextRange].start)
+                {
+                    openRanges.pop_back();
+                }
+                openRanges.push_back(&ranges[nextRange]);
+            }
+            while (!openRanges.empty() && openRanges.back()->end < start)
+            {
+                openRanges.pop_back();
+            }
+            if (!openRanges.empty())
+            {
+                rangeByCorrelation[correlationId] = &openRanges.back()->name;
+            }
+        }
+    }
+
+    IterationKernelStats stats;
+    stats.iteration = mSampledIteration;
+    std::unordered_map<std::string, KernelSample> samples;
+    for (auto const& kernel : mKernels)
+    {
+        KernelSample sample;
+        auto const region = mRegionByCorrelation.find(kernel.correlationId);
+        if (region != mRegionByCorrelation.end() && region->second > 0 && region->second <= mRegionNames.size())
+        {
+            sample.region = mRegionNames[region->second - 1];
+        }
+        auto const range = rangeByCorrelation.find(kernel.correlationId);
+        if (range != rangeByCorrelation.end())
+        {
+            sample.range = *range->second;
+        }
+        sample.kernel = kernel.name;
+        auto const key = sample.region + '\n' + sample.range + '\n' + sample.kernel;
+        auto& aggregate = samples.try_emplace(key, std::move(sample)).first->second;
+        auto const durationUs = static_cast<double>(kernel.durationNs) * 1e-3;
+        ++aggregate.count;
+        aggregate.totalUs += durationUs;
+        stats.totalKernelUs += durationUs;
+    }
+    stats.kernels.reserve(samples.size());
+    for (auto& [key, sample] : samples)
+    {
+        stats.kernels.push_back(std::move(sample));
+    }
+    std::sort(stats.kernels.begin(), stats.kernels.end(),
+        [](KernelSample const& a, KernelSample const& b) { return a.totalUs > b.totalUs; });
+
+    mStats.push_back(std::move(stats));
+    if (mStats.size() > kMaxStoredIterations)
+    {
+        mStats.pop_front();
+    }
+#endif
+}
+
+std::deque<IterationKernelStats> KernelSampler::getLatestStats()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::deque<IterationKernelStats> stats;
+    std::swap(stats, mStats);
+    return stats;
+}
+
+std::string KernelSampler::toJsonStr(IterationKernelStats const& stats, std::size_t maxKernels)
+{
+    auto const quoted = [](std::string const& str)
+    {
+        std::string result{"\""};
+        for (auto const c : str)
+        {
+            if (c == '"' || c == '\\')
+            {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result + "\"";
+    };
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{\"iter\": " << stats.iteration << ", \"total_kernel_us\": " << stats.totalKernelUs << ", \"kernels\": [";
+    auto const numKernels = std::min(maxKernels, stats.kernels.size());
+    for (std::size_t idx = 0; idx < numKernels; ++idx)
+    {
+        auto const& sample = stats.kernels[idx];
+        ss << (idx == 0 ? "" : ", ") << "{\"region\": " << quoted(sample.region) << ", \"range\": "
+           << quoted(sample.range) << ", \"kernel\": " << quoted(sample.kernel) << ", \"count\": " << sample.count
+           << ", \"total_us\": " << sample.totalUs << "}";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Kernel time of one (region, NVTX range, kernel) in a sampled iteration.
+struct KernelSample
+{
+    //! \brief The innermost KernelSampler::ScopedRegion the kernel was launched in, e.g. "engine" or "decoder".
+    std::string region;
+    //! \brief The innermost NVTX range of the launching thread, the layer of TRT engines built with detailed
+    //! profiling verbosity, which names the plugins too. Empty without NVTX.
+    std::string range;
+    std::string kernel;
+    std::uint64_t count{0};
+    double totalUs{0};
+};
+
+struct IterationKernelStats
+{
+    std::int64_t iteration{0};
+    double totalKernelUs{0};
+    //! \brief Sorted by decreasing total time.
+    std::vector<KernelSample> kernels;
+};
+
+//! \brief Collects the kernels of 1 in TLLM_KERNEL_SAMPLING_INTERVAL iterations with CUPTI, without nsys.
+//! \details Outside of the sampled iterations, CUPTI activity collection is off and the scopes cost a branch. A sampled
+//! iteration records the kernels and the CUDA launches with their external correlation to the regions, synchronizes
+//! the device at its end and aggregates the kernel durations by (region, NVTX range, kernel).
+//!
+//! The NVTX ranges are only recorded when NVTX is compiled in (NVTX_DISABLE=OFF) and injected into CUPTI with
+//! NVTX_INJECTION64_PATH=<path to libcupti.so>. Built without ENABLE_CUPTI, the sampler is always disabled.
+class KernelSampler
+{
+public:
+    class ScopedIteration
+    {
+    public:
+        ScopedIteration();
+        ~ScopedIteration();
+
+        ScopedIteration(ScopedIteration const&) = delete;
+        ScopedIteration& operator=(ScopedIteration const&) = delete;
+
+    private:
+        bool mSampled;
+    };
+
+    //! \brief Attributes the kernels launched in its scope to a region. The name must be a string literal.
+    class ScopedRegion
+    {
+    public:
+        explicit ScopedRegion(char const* name);
+        ~ScopedRegion();
+
+        ScopedRegion(ScopedRegion const&) = delete;
+        ScopedRegion& operator=(ScopedRegion const&) = delete;
+
+    private:
+        bool mPushed;
+    };
+
+    static KernelSampler& getInstance();
+
+    [[nodiscard]] bool isEnabled() const noexcept
+    {
+        return mInterval > 0;
+    }
+
+    [[nodiscard]] bool isSampling() const noexcept
+    {
+        return mSampling.load(std::memory_order_relaxed);
+    }
+
+    //! \brief The stats of the sampled iterations since the last call, at most kMaxStoredIterations.
+    [[nodiscard]] std::deque<IterationKernelStats> getLatestStats();
+
+    //! \brief The stats as a JSON object, for the iteration stats: {"iter": i, "total_kernel_us": t, "kernels":
+    //! [{"region", "range", "kernel", "count", "total_us"}, ...]}, the first maxKernels kernels only.
+    [[nodiscard]] static std::string toJsonStr(IterationKernelStats const& stats, std::size_t maxKernels = 32);
+
+    //! \brief Adds the CUPTI records of a completed activity buffer to the current sample.
+    void consumeBuffer(std::uint8_t* buffer, std::size_t validSize);
+
+    static constexpr std::size_t kMaxStoredIterations = 16;
+
+private:
+    KernelSampler();
+
+    void beginSample();
+    void endSample();
+
+    [[nodiscard]] std::uint64_t getRegionId(char const* name);
+
+    struct Launch
+    {
+        std::uint32_t threadId;
+        std::uint64_t start;
+    };
+
+    struct Range
+    {
+        std::uint64_t start;
+        std::uint64_t end;
+        std::string name;
+    };
+
+    struct KernelRecord
+    {
+        std::uint32_t correlationId;
+        std::uint64_t durationNs;
+        std::string name;
+    };
+
+    SizeType32 const mInterval;
+    std::int64_t mNextIteration{0};
+    std::int64_t mSampledIteration{-1};
+    std::atomic<bool> mSampling{false};
+
+    std::mutex mMutex;
+    std::unordered_map<char const*, std::uint64_t> mRegionIds;
+    std::vector<std::string> mRegionNames;
+
+    // Records of the current sample, keyed by correlation id or by marker id
+    std::vector<KernelRecord> mKernels;
+    std::unordered_map<std::uint32_t, Launch> mLaunches;
+    std::unordered_map<std::uint32_t, std::uint64_t> mRegionByCorrelation;
+    std::unordered_map<std::uint64_t, std::pair<std::uint32_t, Range>> mOpenRanges;
+    std::unordered_map<std::uint32_t, std::vector<Range>> mRangesByThread;
+
+    std::deque<IterationKernelStats> mStats;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "localRankGroup.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <cstring>
+#include <exception>
+#include <thread>
+
+namespace tensorrt_llm::runtime
+{
+
+LocalRankGroup::LocalRankGroup(SizeType32 worldSize)
+    : mWorldSize{worldSize}
+{
+    TLLM_CHECK_WITH_INFO(worldSize > 0, "A LocalRankGroup needs at least one rank");
+}
+
+void LocalRankGroup::run(
+    std::function<void(SizeType32 rank)> const& fn, std::optional<std::vector<SizeType32>> const& deviceIds)
+{
+    TLLM_CHECK_WITH_INFO(!deviceIds.has_value() || static_cast<SizeType32>(deviceIds->size()) == mWorldSize,
+        "Expected one device per rank, got %zu devices for %d ranks", deviceIds.has_value() ? deviceIds->size() : 0,
+        mWorldSize);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mNumArrived = 0;
+        mAborted = false;
+        mBcastBuf = nullptr;
+        mMailboxes.clear();
+    }
+
+    std::vector<std::exception_ptr> errors(mWorldSize);
+    std::vector<std::thread> threads;
+    threads.reserve(mWorldSize);
+    for (SizeType32 rank = 0; rank < mWorldSize; ++rank)
+    {
+        auto const deviceId = deviceIds.has_value() ? (*deviceIds)[rank] : rank;
+        threads.emplace_back(
+            [this, &fn, &errors, rank, deviceId]()
+            {
+                try
+                {
+                    TLLM_CUDA_CHECK(cudaSetDevice(deviceId));
+                    fn(rank);
+                }
+                catch (...)
+                {
+                    errors[rank] = std::current_exception();
+                    abort();
+                }
+            });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    // Rethrow the first error by rank, the others are usually the aborts it caused.
+    std::exception_ptr first;
+    for (SizeType32 rank = 0; rank < mWorldSize; ++rank)
+    {
+        if (!errors[rank])
+        {
+            continue;
+        }
+        try
+        {
+            std::rethrow_exception(errors[rank]);
+        }
+        catch (std::exception const& e)
+        {
+            TLLM_LOG_ERROR("Local rank %d failed: %s", rank, e.what());
+        }
+        catch (...)
+        {
+            TLLM_LOG_ERROR("Local rank %d failed", rank);
+        }
+        if (!first)
+        {
+            first = errors[rank];
+        }
+    }
+    if (first)
+    {
+        std::rethrow_exception(first);
+    }
+}
+
+void LocalRankGroup::abort()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mAborted = true;
+    }
+    mCv.notify_all();
+}
+
+void LocalRankGroup::checkRank(SizeType32 rank) const
+{
+    TLLM_CHECK_WITH_INFO(0 <= rank && rank < mWorldSize, "Rank %d out of the %d ranks of the group", rank, mWorldSize);
+}
+
+void LocalRankGroup::barrier()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    TLLM_CHECK_WITH_INFO(!mAborted, "Local rank group aborted");
+    auto const generation = mGeneration;
+    if (++mNumArrived == mWorldSize)
+    {
+        mNumArrived = 0;
+        ++mGeneration;
+        lock.unlock();
+        mCv.notify_all();
+        return;
+    }
+    mCv.wait(lock, [this, generation]() { return mGeneration != generation || mAborted; });
+    TLLM_CHECK_WITH_INFO(mGeneration != generation, "Local rank group aborted");
+}
+
+void LocalRankGroup::bcast(void* buf, std::size_t size, SizeType32 root, SizeType32 rank)
+{
+    checkRank(root);
+    checkRank(rank);
+    if (mWorldSize == 1)
+    {
+        return;
+    }
+    if (rank == root)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mBcastBuf = buf;
+    }
+    // The buffer of the root is published by the first barrier and stays valid until the second.
+    barrier();
+    if (rank != root && size > 0)
+    {
+        std::memcpy(buf, mBcastBuf, size);
+    }
+    barrier();
+}
+
+void LocalRankGroup::bcast(std::vector<char>& buf, SizeType32 root, SizeType32 rank)
+{
+    std::uint64_t size = buf.size();
+    bcastValue(size, root, rank);
+    if (rank != root)
+    {
+        buf.resize(size);
+    }
+    bcast(buf.data(), size, root, rank);
+}
+
+void LocalRankGroup::send(std::vector<char> buf, SizeType32 dest, SizeType32 source, std::int32_t tag)
+{
+    checkRank(dest);
+    checkRank(source);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mMailboxes[{source, dest, tag}].push_back(std::move(buf));
+    }
+    mCv.notify_all();
+}
+
+std::vector<char> LocalRankGroup::recv(SizeType32 source, SizeType32 dest, std::int32_t tag)
+{
+    checkRank(dest);
+    checkRank(source);
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto& mailbox = mMailboxes[{source, dest, tag}];
+    mCv.wait(lock, [this, &mailbox]() { return !mailbox.empty() || mAborted; });
+    TLLM_CHECK_WITH_INFO(!mailbox.empty(), "Local rank group aborted");
+    auto buf = std::move(mailbox.front());
+    mailbox.pop_front();
+    return buf;
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief The ranks of a model as threads of a single process, one per GPU, in place of MPI processes.
+//! \details run starts a thread per rank on its device. The ranks exchange host data, e.g. the requests of a step or
+//! the outputs of the decoder, through the host collectives below, which are plain copies in shared memory, and device
+//! data through the communicators of NcclCommunicator::createLocalComms. A rank that throws aborts the group: the
+//! collectives of the other ranks throw instead of waiting for it, and run rethrows the first error.
+class LocalRankGroup
+{
+public:
+    explicit LocalRankGroup(SizeType32 worldSize);
+
+    LocalRankGroup(LocalRankGroup const&) = delete;
+    LocalRankGroup& operator=(LocalRankGroup const&) = delete;
+
+    [[nodiscard]] SizeType32 getSize() const noexcept
+    {
+        return mWorldSize;
+    }
+
+    //! \brief Run fn(rank) on a thread per rank and wait for all of them. Rank r runs on device deviceIds[r], on
+    //! device r by default.
+    void run(std::function<void(SizeType32 rank)> const& fn,
+        std::optional<std::vector<SizeType32>> const& deviceIds = std::nullopt);
+
+    //! \brief Wait for all the ranks of the group.
+    void barrier();
+
+    //! \brief Copy size bytes of buf of rank root to buf of the other ranks.
+    void bcast(void* buf, std::size_t size, SizeType32 root, SizeType32 rank);
+
+    //! \brief Copy buf of rank root to buf of the other ranks, resizing it.
+    void bcast(std::vector<char>& buf, SizeType32 root, SizeType32 rank);
+
+    template <typename T>
+    void bcastValue(T& value, SizeType32 root, SizeType32 rank)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        bcast(&value, sizeof(T), root, rank);
+    }
+
+    //! \brief Queue buf for rank dest, the call does not wait for the receiver.
+    void send(std::vector<char> buf, SizeType32 dest, SizeType32 source, std::int32_t tag = 0);
+
+    //! \brief Wait for the next buffer rank source sent to rank dest with tag.
+    [[nodiscard]] std::vector<char> recv(SizeType32 source, SizeType32 dest, std::int32_t tag = 0);
+
+private:
+    void abort();
+    void checkRank(SizeType32 rank) const;
+
+    SizeType32 mWorldSize;
+
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    SizeType32 mNumArrived{0};
+    std::uint64_t mGeneration{0};
+    bool mAborted{false};
+    //! \brief Buffer of the root of the bcast in progress.
+    void const* mBcastBuf{nullptr};
+
+    using MailboxKey = std::tuple<SizeType32, SizeType32, std::int32_t>;
+    std::map<MailboxKey, std::deque<std::vector<char>>> mMailboxes;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/logitsReturnStreamer.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+#include "tensorrt_llm/kernels/logitsReturn.h"
+#include "tensorrt_llm/kernels/topkLastDim.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace tensorrt_llm::runtime;
+namespace tk = tensorrt_llm::kernels;
+
+namespace
+{
+
+struct ChunkBuffers
+{
+    void const* logits;
+    ITensor& compactLogits;
+    ITensor* logSumExp;
+    ITensor* topKLogits;
+    ITensor* topKIds;
+    ITensor* topKLogProbs;
+    ITensor* topKWorkspace;
+};
+
+template <typename T>
+void enqueueCompression(LogitsReturnStreamer::Mode mode, ChunkBuffers const& buffers, SizeType32 numTokens,
+    SizeType32 vocabSize, SizeType32 vocabSizePadded, SizeType32 topK, cudaStream_t stream)
+{
+    auto const* logits = static_cast<T const*>(buffers.logits);
+    switch (mode)
+    {
+    case LogitsReturnStreamer::Mode::kFull:
+        tk::invokeCompactLogits(
+            logits, bufferCast<float>(buffers.compactLogits), numTokens, vocabSize, vocabSizePadded, stream);
+        break;
+    case LogitsReturnStreamer::Mode::kHalf:
+        tk::invokeCompactLogits(
+            logits, bufferCast<half>(buffers.compactLogits), numTokens, vocabSize, vocabSizePadded, stream);
+        break;
+    case LogitsReturnStreamer::Mode::kTopK:
+    {
+        auto* compact = bufferCast<T>(buffers.compactLogits);
+        auto* lse = bufferCast<float>(*buffers.logSumExp);
+        auto* topKLogits = bufferCast<T>(*buffers.topKLogits);
+        tk::invokeCompactLogits(logits, compact, numTokens, vocabSize, vocabSizePadded, stream);
+        tk::invokeRowLogSumExp(compact, lse, numTokens, vocabSize, stream);
+        tk::invokeTopkLastDim<T>(numTokens, vocabSize, topK, /* is_largest */ true, compact, topKLogits,
+            buffers.topKIds->data(), buffers.topKWorkspace->data(), stream);
+        tk::invokeTopKLogProbs(topKLogits, lse, bufferCast<float>(*buffers.topKLogProbs), numTokens, topK, stream);
+        break;
+    }
+    }
+}
+
+template <typename T>
+std::size_t getTopKWorkspaceSize(SizeType32 maxChunkTokens, SizeType32 vocabSize, SizeType32 topK)
+{
+    return tk::invokeComputeTopkLastDimWorkspaceSize<T>(maxChunkTokens, vocabSize, topK, /* is_largest */ true);
+}
+
+} // namespace
+
+LogitsReturnStreamer::Config LogitsReturnStreamer::Config::fromEnv()
+{
+    Config config;
+    if (auto const topK = common::getEnvReturnLogitsTopK(); topK > 0)
+    {
+        config.mode = Mode::kTopK;
+        config.topK = topK;
+    }
+    else if (common::getEnvReturnLogitsHalf())
+    {
+        config.mode = Mode::kHalf;
+    }
+    return config;
+}
+
+LogitsReturnStreamer::LogitsReturnStreamer(
+    Config const& config, SizeType32 vocabSize, nvinfer1::DataType logitsType, BufferManager bufferManager)
+    : mConfig{config}
+    , mVocabSize{vocabSize}
+    , mLogitsType{logitsType}
+    , mBufferManager{std::move(bufferManager)}
+{
+    TLLM_CHECK(mConfig.maxChunkTokens > 0);
+    TLLM_CHECK(mVocabSize > 0);
+    TLLM_CHECK_WITH_INFO(mConfig.mode != Mode::kTopK || (mConfig.topK > 0 && mConfig.topK <= mVocabSize),
+        "Invalid top K %d of the returned logits for a vocabulary of %d", mConfig.topK, mVocabSize);
+    TLLM_CHECK_WITH_INFO(logitsType == nvinfer1::DataType::kFLOAT || logitsType == nvinfer1::DataType::kHALF
+            || logitsType == nvinfer1::DataType::kBF16,
+        "Unsupported logits data type %d", static_cast<int>(logitsType));
+
+    auto const maxTokens = mConfig.maxChunkTokens;
+    auto const logitsShape = ITensor::makeShape({maxTokens, mVocabSize});
+    if (mConfig.mode == Mode::kTopK)
+    {
+        auto const topKShape = ITensor::makeShape({maxTokens, mConfig.topK});
+        mCompactLogits = mBufferManager.gpu(logitsShape, mLogitsType);
+        mLogSumExp = mBufferManager.gpu(ITensor::makeShape({maxTokens}), nvinfer1::DataType::kFLOAT);
+        mTopKLogits = mBufferManager.gpu(topKShape, mLogitsType);
+        mTopKIds = mBufferManager.gpu(topKShape, nvinfer1::DataType::kINT32);
+        mTopKLogProbs = mBufferManager.gpu(topKShape, nvinfer1::DataType::kFLOAT);
+        std::size_t workspaceSize = 0;
+        switch (mLogitsType)
+        {
+        case nvinfer1::DataType::kFLOAT:
+            workspaceSize = getTopKWorkspaceSize<float>(maxTokens, mVocabSize, mConfig.topK);
+            break;
+        case nvinfer1::DataType::kHALF:
+            workspaceSize = getTopKWorkspaceSize<half>(maxTokens, mVocabSize, mConfig.topK);
+            break;
+#ifdef ENABLE_BF16
+        case nvinfer1::DataType::kBF16:
+            workspaceSize = getTopKWorkspaceSize<__nv_bfloat16>(maxTokens, mVocabSize, mConfig.topK);
+            break;
+#endif
+        default: TLLM_THROW("Unsupported logits data type %d", static_cast<int>(mLogitsType));
+        }
+        mTopKWorkspace = mBufferManager.gpu(ITensor::makeShape({static_cast<SizeType32>(workspaceSize)}),
+            nvinfer1::DataType::kINT8);
+        for (auto& slot : mSlots)
+        {
+            slot.hostTopKIds = BufferManager::pinned(topKShape, nvinfer1::DataType::kINT32);
+            slot.hostTopKLogProbs = BufferManager::pinned(topKShape, nvinfer1::DataType::kFLOAT);
+        }
+    }
+    else
+    {
+        auto const hostType = mConfig.mode == Mode::kHalf ? nvinfer1::DataType::kHALF : nvinfer1::DataType::kFLOAT;
+        mCompactLogits = mBufferManager.gpu(logitsShape, hostType);
+        for (auto& slot : mSlots)
+        {
+            slot.hostLogits = BufferManager::pinned(logitsShape, hostType);
+        }
+    }
+}
+
+std::size_t LogitsReturnStreamer::getBytesPerToken() const
+{
+    switch (mConfig.mode)
+    {
+    case Mode::kFull: return mVocabSize * sizeof(float);
+    case Mode::kHalf: return mVocabSize * sizeof(half);
+    case Mode::kTopK: return mConfig.topK * (sizeof(std::int32_t) + sizeof(float));
+    }
+    return 0;
+}
+
+void LogitsReturnStreamer::enqueueChunk(ITensor const& logits, SizeType32 firstToken, SizeType32 numTokens, Slot& slot)
+{
+    auto const& stream = mBufferManager.getStream();
+    auto const vocabSizePadded = static_cast<SizeType32>(logits.getShape().d[1]);
+    auto const* chunkLogits = static_cast<std::uint8_t const*>(logits.data())
+        + static_cast<std::size_t>(firstToken) * vocabSizePadded * BufferDataType(mLogitsType).getSize();
+    ChunkBuffers const buffers{chunkLogits, *mCompactLogits, mLogSumExp.get(), mTopKLogits.get(), mTopKIds.get(),
+        mTopKLogProbs.get(), mTopKWorkspace.get()};
+    switch (mLogitsType)
+    {
+    case nvinfer1::DataType::kFLOAT:
+        enqueueCompression<float>(
+            mConfig.mode, buffers, numTokens, mVocabSize, vocabSizePadded, mConfig.topK, stream.get());
+        break;
+    case nvinfer1::DataType::kHALF:
+        enqueueCompression<half>(
+            mConfig.mode, buffers, numTokens, mVocabSize, vocabSizePadded, mConfig.topK, stream.get());
+        break;
+#ifdef ENABLE_BF16
+    case nvinfer1::DataType::kBF16:
+        enqueueCompression<__nv_bfloat16>(
+            mConfig.mode, buffers, numTokens, mVocabSize, vocabSizePadded, mConfig.topK, stream.get());
+        break;
+#endif
+    default: TLLM_THROW("Unsupported logits data type %d", static_cast<int>(mLogitsType));
+    }
+
+    // The scratch is reused by the next chunk, which is enqueued after these copies on the same stream.
+    slot.chunk = Chunk{firstToken, numTokens, nullptr, nullptr, nullptr};
+    if (mConfig.mode == Mode::kTopK)
+    {
+        slot.chunk.topKIds = ITensor::slice(slot.hostTopKIds, 0, numTokens);
+        slot.chunk.topKLogProbs = ITensor::slice(slot.hostTopKLogProbs, 0, numTokens);
+        mBufferManager.copy(*ITensor::slice(mTopKIds, 0, numTokens), *slot.chunk.topKIds);
+        mBufferManager.copy(*ITensor::slice(mTopKLogProbs, 0, numTokens), *slot.chunk.topKLogProbs);
+    }
+    else
+    {
+        slot.chunk.logits = ITensor::slice(slot.hostLogits, 0, numTokens);
+        mBufferManager.copy(*ITensor::slice(mCompactLogits, 0, numTokens), *slot.chunk.logits);
+    }
+    stream.record(slot.copied);
+}
+
+void LogitsReturnStreamer::stream(ITensor const& logits, Consumer const& consume)
+{
+    NVTX3_FUNC_RANGE();
+    auto const& shape = logits.getShape();
+    TLLM_CHECK_WITH_INFO(shape.nbDims == 2 && shape.d[1] >= mVocabSize, "Logits must be [numTokens, vocabSizePadded]");
+    TLLM_CHECK(logits.getDataType() == mLogitsType);
+    auto const numTokens = static_cast<SizeType32>(shape.d[0]);
+
+    // Chunk i goes through slot i % 2: chunk i - 1 is consumed while chunk i is computed and copied.
+    Slot* pending = nullptr;
+    std::size_t slotIdx = 0;
+    for (SizeType32 firstToken = 0; firstToken < numTokens; firstToken += mConfig.maxChunkTokens)
+    {
+        auto& slot = mSlots[slotIdx];
+        slotIdx = (slotIdx + 1) % mSlots.size();
+        enqueueChunk(logits, firstToken, std::min(mConfig.maxChunkTokens, numTokens - firstToken), slot);
+        if (pending != nullptr)
+        {
+            pending->copied.synchronize();
+            consume(pending->chunk);
+        }
+        pending = &slot;
+    }
+    if (pending != nullptr)
+    {
+        pending->copied.synchronize();
+        consume(pending->chunk);
+    }
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <array>
+#include <cstddef>
+#include <functional>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Copies the context or generation logits of a request to the host in chunks of positions, optionally
+//! compressed on the device.
+//! \details Returning the FP32 logits of every position moves 4 * vocabSize bytes per token over PCIe, 512KB for a
+//! 128k vocabulary. kHalf halves that, and kTopK returns the ids and log-probabilities of the topK largest logits only,
+//! computed with invokeTopkLastDim on the stream of the buffer manager. The chunks go through two pinned buffers, so
+//! the consumer of a chunk runs while the next one is copied and the host memory in use is bounded by the chunk size.
+class LogitsReturnStreamer
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+
+    enum class Mode
+    {
+        kFull,
+        kHalf,
+        kTopK,
+    };
+
+    struct Config
+    {
+        Mode mode{Mode::kFull};
+        SizeType32 topK{0};
+        SizeType32 maxChunkTokens{256};
+
+        //! \brief The mode of TRTLLM_RETURN_LOGITS_TOPK and TRTLLM_RETURN_LOGITS_FP16, kTopK taking precedence.
+        static Config fromEnv();
+    };
+
+    //! \brief Pinned host copies of the positions [firstToken, firstToken + numTokens), valid during the consumer call.
+    struct Chunk
+    {
+        SizeType32 firstToken{0};
+        SizeType32 numTokens{0};
+        //! \brief [numTokens, vocabSize], FP32 for kFull and FP16 for kHalf, null for kTopK.
+        TensorPtr logits;
+        //! \brief [numTokens, topK] by decreasing logits for kTopK, null otherwise.
+        TensorPtr topKIds;
+        TensorPtr topKLogProbs;
+    };
+
+    using Consumer = std::function<void(Chunk const&)>;
+
+    LogitsReturnStreamer(
+        Config const& config, SizeType32 vocabSize, nvinfer1::DataType logitsType, BufferManager bufferManager);
+
+    //! \brief Copy logits [numTokens, vocabSizePadded] on the device chunk by chunk, consuming the chunks in order.
+    //! Returns after the last chunk is consumed.
+    void stream(ITensor const& logits, Consumer const& consume);
+
+    //! \brief Bytes copied to the host per position.
+    [[nodiscard]] std::size_t getBytesPerToken() const;
+
+    [[nodiscard]] Config const& getConfig() const
+    {
+        return mConfig;
+    }
+
+private:
+    struct Slot
+    {
+        Chunk chunk;
+        TensorPtr hostLogits;
+        TensorPtr hostTopKIds;
+        TensorPtr hostTopKLogProbs;
+        CudaEvent copied{};
+    };
+
+    //! \brief Enqueue the computation and the copy of a chunk into slot.
+    void enqueueChunk(ITensor const& logits, SizeType32 firstToken, SizeType32 numTokens, Slot& slot);
+
+    Config mConfig;
+    SizeType32 mVocabSize;
+    nvinfer1::DataType mLogitsType;
+    BufferManager mBufferManager;
+
+    // Device scratch of a chunk.
+    TensorPtr mCompactLogits;
+    TensorPtr mLogSumExp;
+    TensorPtr mTopKLogits;
+    TensorPtr mTopKIds;
+    TensorPtr mTopKLogProbs;
+    TensorPtr mTopKWorkspace;
+
+    std::array<Slot, 2> mSlots;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/loraAdapterMerger.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaBf16Wrapper.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/kernels/loraMergeKernels.h"
+
+#include <algorithm>
+#include <cuda_fp16.h>
+#include <iterator>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+template <typename T>
+void mergeModule(ITensor& merged, ITensor const& base, LoraCache::TaskLayerModuleConfig const& config, SizeType32 inDim,
+    SizeType32 outDim, bool transposed, cudaStream_t stream)
+{
+    kernels::invokeLoraMerge<T>(bufferCast<T>(merged), bufferCast<T>(base),
+        reinterpret_cast<T const*>(config.weightsInPointer), reinterpret_cast<T const*>(config.weightsOutPointer),
+        outDim, inDim, config.adapterSize, transposed, stream);
+}
+} // namespace
+
+LoraAdapterMerger::LoraAdapterMerger(Config const& config, BaseWeightLookup baseWeights, bool transposedWeights)
+    : mConfig{config}
+    , mBaseWeights{std::move(baseWeights)}
+    , mTransposedWeights{transposedWeights}
+{
+    TLLM_CHECK_WITH_INFO(mBaseWeights, "The LoRA adapter merger needs the base weights");
+    TLLM_CHECK_WITH_INFO(0.F <= mConfig.releaseShare && mConfig.releaseShare <= mConfig.mergeShare,
+        "The release share of merged LoRA adapters (%f) must be in [0, mergeShare = %f]", mConfig.releaseShare,
+        mConfig.mergeShare);
+    TLLM_CHECK_WITH_INFO(0.F < mConfig.smoothing && mConfig.smoothing <= 1.F,
+        "The smoothing of the LoRA token shares (%f) must be in (0, 1]", mConfig.smoothing);
+}
+
+void LoraAdapterMerger::recordIteration(std::unordered_map<TaskIdType, SizeType32> const& tokensPerTask)
+{
+    SizeType32 totalTokens{0};
+    for (auto const& [taskId, numTokens] : tokensPerTask)
+    {
+        totalTokens += numTokens;
+    }
+    // Iterations without LoRA tokens leave the shares as they are.
+    if (totalTokens == 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const alpha = mConfig.smoothing;
+    for (auto it = mShares.begin(); it != mShares.end();)
+    {
+        it->second *= 1.F - alpha;
+        // Forget the tasks that have not been seen for a while, unless their weights are merged.
+        it = it->second < 1e-3F && mMerged.count(it->first) == 0 ? mShares.erase(it) : std::next(it);
+    }
+    for (auto const& [taskId, numTokens] : tokensPerTask)
+    {
+        mShares[taskId] += alpha * static_cast<float>(numTokens) / static_cast<float>(totalTokens);
+    }
+}
+
+LoraAdapterMerger::Decision LoraAdapterMerger::decide() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Decision decision;
+    std::vector<std::pair<float, TaskIdType>> candidates;
+    for (auto const& [taskId, share] : mShares)
+    {
+        bool const merged = mMerged.count(taskId) != 0;
+        if (merged && share < mConfig.releaseShare)
+        {
+            decision.toRelease.push_back(taskId);
+        }
+        else if (!merged && share >= mConfig.mergeShare)
+        {
+            candidates.emplace_back(share, taskId);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), std::greater<>());
+
+    auto const numKept = static_cast<SizeType32>(mMerged.size() - decision.toRelease.size());
+    auto const numFree = std::max(mConfig.maxMergedAdapters - numKept, 0);
+    for (std::size_t idx = 0; idx < candidates.size() && static_cast<SizeType32>(idx) < numFree; ++idx)
+    {
+        decision.toMerge.push_back(candidates[idx].second);
+    }
+    return decision;
+}
+
+bool LoraAdapterMerger::merge(
+    TaskIdType taskId, std::vector<TaskLayerModuleConfig> const& configs, BufferManager const& manager)
+{
+    if (isMerged(taskId))
+    {
+        return true;
+    }
+    if (std::any_of(configs.begin(), configs.end(),
+            [](TaskLayerModuleConfig const& config) { return config.scalingVecPointer.has_value(); }))
+    {
+        TLLM_LOG_DEBUG("LoRA task %lu is a DoRA adapter and is not merged", taskId);
+        return false;
+    }
+
+    std::vector<std::pair<TaskLayerModuleConfig const*, TensorPtr>> modules;
+    std::size_t numBytes{0};
+    for (auto const& config : configs)
+    {
+        auto base = mBaseWeights(config.layerId, config.moduleId);
+        if (!base)
+        {
+            continue;
+        }
+        auto const inDim = config.inSize / config.adapterSize;
+        auto const outDim = config.outSize / config.adapterSize;
+        auto const expectedShape = mTransposedWeights ? ITensor::makeShape({inDim, outDim})
+                                                      : ITensor::makeShape({outDim, inDim});
+        TLLM_CHECK_WITH_INFO(ITensor::shapeEquals(base->getShape(), expectedShape),
+            "The base weight of module %d in layer %d is %s, LoRA task %lu expects %s", config.moduleId,
+            config.layerId, ITensor::toString(base->getShape()).c_str(), taskId,
+            ITensor::toString(expectedShape).c_str());
+        numBytes += base->getSizeInBytes();
+        modules.emplace_back(&config, std::move(base));
+    }
+    if (modules.empty())
+    {
+        return false;
+    }
+
+    if (mConfig.maxMergedBytes > 0 && getMergedBytes() + numBytes > mConfig.maxMergedBytes)
+    {
+        TLLM_LOG_DEBUG("The merged weights of LoRA task %lu (%zu bytes) exceed the budget of %zu bytes", taskId,
+            numBytes, mConfig.maxMergedBytes);
+        return false;
+    }
+
+    MergedWeights merged;
+    try
+    {
+        for (auto const& [config, base] : modules)
+        {
+            auto weight = manager.gpu(base->getShape(), base->getDataType());
+            auto const inDim = config->inSize / config->adapterSize;
+            auto const outDim = config->outSize / config->adapterSize;
+            auto const stream = manager.getStream().get();
+            switch (base->getDataType())
+            {
+            case nvinfer1::DataType::kFLOAT:
+                mergeModule<float>(*weight, *base, *config, inDim, outDim, mTransposedWeights, stream);
+                break;
+            case nvinfer1::DataType::kHALF:
+                mergeModule<half>(*weight, *base, *config, inDim, outDim, mTransposedWeights, stream);
+                break;
+#ifdef ENABLE_BF16
+            case nvinfer1::DataType::kBF16:
+                mergeModule<__nv_bfloat16>(*weight, *base, *config, inDim, outDim, mTransposedWeights, stream);
+                break;
+#endif
+            default:
+                TLLM_LOG_DEBUG("LoRA task %lu is not merged into base weights of type %d", taskId,
+                    static_cast<int>(base->getDataType()));
+                return false;
+            }
+            merged.emplace(LayerModule{config->layerId, config->moduleId}, std::move(weight));
+        }
+    }
+    catch (std::exception const& e)
+    {
+        // Out of device memory, the task keeps running on the LoRA kernels.
+        TLLM_LOG_WARNING("Could not merge LoRA task %lu: %s", taskId, e.what());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mMergedBytes += numBytes;
+    mMerged.emplace(taskId, std::move(merged));
+    TLLM_LOG_INFO("Merged LoRA task %lu into %zu weights (%zu bytes)", taskId, modules.size(), numBytes);
+    return true;
+}
+
+void LoraAdapterMerger::release(TaskIdType taskId)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mMerged.find(taskId);
+    if (it == mMerged.end())
+    {
+        return;
+    }
+    for (auto const& [layerModule, weight] : it->second)
+    {
+        mMergedBytes -= weight->getSizeInBytes();
+    }
+    mMerged.erase(it);
+    TLLM_LOG_INFO("Released the merged weights of LoRA task %lu", taskId);
+}
+
+bool LoraAdapterMerger::isMerged(TaskIdType taskId) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMerged.count(taskId) != 0;
+}
+
+LoraAdapterMerger::TensorPtr LoraAdapterMerger::getMergedWeight(
+    TaskIdType taskId, SizeType32 layerId, SizeType32 moduleId) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mMerged.find(taskId);
+    if (it == mMerged.end())
+    {
+        return nullptr;
+    }
+    auto const weight = it->second.find(LayerModule{layerId, moduleId});
+    return weight == it->second.end() ? nullptr : weight->second;
+}
+
+float LoraAdapterMerger::getShare(TaskIdType taskId) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mShares.find(taskId);
+    return it == mShares.end() ? 0.F : it->second;
+}
+
+std::size_t LoraAdapterMerger::getMergedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMergedBytes;
+}
+
+} // namespace tensorrt_llm::runtime
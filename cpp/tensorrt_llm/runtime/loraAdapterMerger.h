@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/loraCache.h"
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Keeps copies of the base weights with the dominant LoRA adapters folded in, W + B * A.
+//! \details The requests of a merged adapter run the plain GEMMs on the merged copies instead of the low-rank path on
+//! every layer. The merger tracks the share of the LoRA tokens of every task as a moving average. A task is merged
+//! once its share reaches `mergeShare` and released when it falls below `releaseShare`, so that the adapters do not
+//! flap between the paths. The copies live in spare device memory, up to `maxMergedBytes`. DoRA adapters are not
+//! linear in the weights and are never merged.
+class LoraAdapterMerger
+{
+public:
+    using TaskIdType = LoraCache::TaskIdType;
+    using TensorPtr = ITensor::SharedPtr;
+    using TaskLayerModuleConfig = LoraCache::TaskLayerModuleConfig;
+
+    struct Config
+    {
+        float mergeShare{0.4F};
+        float releaseShare{0.2F};
+        //! \brief Weight of the last iteration in the moving average of the shares.
+        float smoothing{0.1F};
+        SizeType32 maxMergedAdapters{2};
+        //! \brief Device memory of the merged copies, unbounded if 0.
+        std::size_t maxMergedBytes{0};
+    };
+
+    //! \brief The base weight of a module in a layer, [outHiddenSize, inHiddenSize] or [inHiddenSize, outHiddenSize]
+    //! if transposed. Null for the modules that are not merged.
+    using BaseWeightLookup = std::function<TensorPtr(SizeType32 layerId, SizeType32 moduleId)>;
+
+    struct Decision
+    {
+        //! \brief By decreasing share.
+        std::vector<TaskIdType> toMerge;
+        std::vector<TaskIdType> toRelease;
+    };
+
+    LoraAdapterMerger(Config const& config, BaseWeightLookup baseWeights, bool transposedWeights = false);
+
+    //! \brief Records the LoRA tokens of an iteration by task.
+    void recordIteration(std::unordered_map<TaskIdType, SizeType32> const& tokensPerTask);
+
+    [[nodiscard]] Decision decide() const;
+
+    //! \brief Enqueues the merge of the modules of the task on the stream of the manager. The pages of the task must
+    //! stay in the device cache until the stream reaches the merge.
+    //! \return Whether the task is merged, false if it is a DoRA adapter or its copies do not fit.
+    bool merge(TaskIdType taskId, std::vector<TaskLayerModuleConfig> const& configs, BufferManager const& manager);
+
+    void release(TaskIdType taskId);
+
+    [[nodiscard]] bool isMerged(TaskIdType taskId) const;
+
+    //! \brief The merged weight of a module in a layer, null if the task is not merged or has no LoRA on the module.
+    [[nodiscard]] TensorPtr getMergedWeight(TaskIdType taskId, SizeType32 layerId, SizeType32 moduleId) const;
+
+    [[nodiscard]] float getShare(TaskIdType taskId) const;
+
+    [[nodiscard]] std::size_t getMergedBytes() const;
+
+private:
+    using LayerModule = std::pair<SizeType32, SizeType32>;
+    using MergedWeights = std::map<LayerModule, TensorPtr>;
+
+    Config mConfig;
+    BaseWeightLookup mBaseWeights;
+    bool mTransposedWeights;
+
+    mutable std::mutex mMutex;
+    std::unordered_map<TaskIdType, float> mShares;
+    std::unordered_map<TaskIdType, MergedWeights> mMerged;
+    std::size_t mMergedBytes{0};
+};
+
+} // namespace tensorrt_llm::runtime
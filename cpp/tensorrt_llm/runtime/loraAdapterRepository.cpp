@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/loraAdapterRepository.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/loraUtils.h"
+#include "tensorrt_llm/runtime/utils/numpyUtils.h"
+
+#include <filesystem>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+LoraAdapterSource::TensorPtr loadAdapterTensor(BufferManager const& manager, std::filesystem::path const& path)
+{
+    TLLM_CHECK_WITH_INFO(std::filesystem::exists(path), "LoRA adapter file %s does not exist", path.c_str());
+    LoraAdapterSource::TensorPtr tensor = utils::loadNpy(manager, path.string(), MemoryType::kCPU);
+    // The files of a single adapter may lack the batch dimension of a request.
+    if (tensor->getShape().nbDims == 2)
+    {
+        tensor->unsqueeze(0);
+    }
+    return tensor;
+}
+} // namespace
+
+DirectoryLoraAdapterSource::DirectoryLoraAdapterSource(BufferManager::CudaStreamPtr stream)
+    : mBufferManager{std::move(stream)}
+{
+}
+
+LoraAdapterSource::Adapter DirectoryLoraAdapterSource::fetch(std::string const& uri) const
+{
+    std::string const filePrefix{"file://"};
+    std::filesystem::path const dir{uri.rfind(filePrefix, 0) == 0 ? uri.substr(filePrefix.size()) : uri};
+    Adapter adapter;
+    adapter.weights = loadAdapterTensor(mBufferManager, dir / "model.lora_weights.npy");
+    adapter.config = loadAdapterTensor(mBufferManager, dir / "model.lora_config.npy");
+    return adapter;
+}
+
+LoraAdapterRepository::LoraAdapterRepository(std::shared_ptr<LoraAdapterSource const> source, LoraCache& hostCache,
+    std::shared_ptr<WorkerPool> putWorkers, ModelConfig modelConfig, WorldConfig worldConfig,
+    std::size_t maxPrefetchesInFlight)
+    : mSource{std::move(source)}
+    , mHostCache{hostCache}
+    , mPutWorkers{std::move(putWorkers)}
+    , mModelConfig{std::move(modelConfig)}
+    , mWorldConfig{std::move(worldConfig)}
+    , mMaxPrefetchesInFlight{maxPrefetchesInFlight}
+{
+    TLLM_CHECK_WITH_INFO(mSource && mPutWorkers, "The LoRA adapter repository needs a source and put workers");
+}
+
+LoraAdapterRepository::~LoraAdapterRepository()
+{
+    waitForFetches();
+}
+
+void LoraAdapterRepository::registerAdapter(TaskIdType taskId, std::string uri)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& entry = mEntries[taskId];
+    TLLM_CHECK_WITH_INFO(!entry.fetching, "LoRA task %lu is re-registered while it is fetched", taskId);
+    entry.uri = std::move(uri);
+    entry.error.reset();
+}
+
+LoraAdapterRepository::Status LoraAdapterRepository::request(TaskIdType taskId)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mEntries.find(taskId);
+    if (it == mEntries.end())
+    {
+        // The weights of the task may have come with a request.
+        return mHostCache.isLoaded(taskId) ? Status::kCACHED : Status::kUNKNOWN;
+    }
+    auto const status = getStatus(taskId, it->second);
+    if (status == Status::kMISSING || status == Status::kFAILED)
+    {
+        startFetch(taskId, it->second, false);
+        return Status::kFETCHING;
+    }
+    return status;
+}
+
+void LoraAdapterRepository::prefetch(std::vector<TaskIdType> const& queuedTaskIds)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto const taskId : queuedTaskIds)
+    {
+        if (mNumPrefetching >= mMaxPrefetchesInFlight)
+        {
+            break;
+        }
+        auto const it = mEntries.find(taskId);
+        // Failed fetches are only retried for the requests that are scheduled.
+        if (it != mEntries.end() && getStatus(taskId, it->second) == Status::kMISSING)
+        {
+            startFetch(taskId, it->second, true);
+        }
+    }
+}
+
+LoraAdapterRepository::Status LoraAdapterRepository::getStatus(TaskIdType taskId) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mEntries.find(taskId);
+    return it == mEntries.end() ? Status::kUNKNOWN : getStatus(taskId, it->second);
+}
+
+std::optional<std::string> LoraAdapterRepository::getError(TaskIdType taskId) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mEntries.find(taskId);
+    return it == mEntries.end() ? std::nullopt : it->second.error;
+}
+
+void LoraAdapterRepository::waitForFetches() const
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mFetchDone.wait(lock, [this]() { return mNumFetching == 0; });
+}
+
+LoraAdapterRepository::Status LoraAdapterRepository::getStatus(TaskIdType taskId, Entry const& entry) const
+{
+    if (entry.fetching)
+    {
+        return Status::kFETCHING;
+    }
+    if (mHostCache.isLoaded(taskId))
+    {
+        return Status::kCACHED;
+    }
+    return entry.error.has_value() ? Status::kFAILED : Status::kMISSING;
+}
+
+void LoraAdapterRepository::startFetch(TaskIdType taskId, Entry& entry, bool prefetch)
+{
+    entry.fetching = true;
+    entry.prefetch = prefetch;
+    entry.error.reset();
+    ++mNumFetching;
+    if (prefetch)
+    {
+        ++mNumPrefetching;
+    }
+    auto const priority = prefetch ? WorkerPool::Priority::kNORMAL : WorkerPool::Priority::kHIGH;
+    mPutWorkers->enqueueDetached([this, taskId, uri = entry.uri]() { fetch(taskId, uri); }, priority);
+}
+
+void LoraAdapterRepository::fetch(TaskIdType taskId, std::string const& uri)
+{
+    TLLM_LOG_DEBUG("Fetching LoRA task %lu from %s", taskId, uri.c_str());
+    std::optional<std::string> error;
+    try
+    {
+        auto const adapter = mSource->fetch(uri);
+        lora::loraValidateRequestTensors(taskId, adapter.weights, adapter.config, mModelConfig, mWorldConfig);
+        mHostCache.put(taskId, adapter.weights, adapter.config);
+    }
+    catch (std::exception const& e)
+    {
+        error = e.what();
+        TLLM_LOG_WARNING("Failed to fetch LoRA task %lu from %s: %s", taskId, uri.c_str(), e.what());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& entry = mEntries.at(taskId);
+        entry.fetching = false;
+        entry.error = std::move(error);
+        --mNumFetching;
+        if (entry.prefetch)
+        {
+            --mNumPrefetching;
+            entry.prefetch = false;
+        }
+        // Notified under the lock, the destructor may run as soon as the last fetch is counted out.
+        mFetchDone.notify_all();
+    }
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/loraCache.h"
+#include "tensorrt_llm/runtime/modelConfig.h"
+#include "tensorrt_llm/runtime/workerPool.h"
+#include "tensorrt_llm/runtime/worldConfig.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Where the LoRA adapters referenced by URI are fetched from.
+class LoraAdapterSource
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+
+    //! \brief The weights and config of an adapter in host memory, in the layout of executor::LoraConfig.
+    struct Adapter
+    {
+        TensorPtr weights; // [1, numModuleLayers, maxSize]
+        TensorPtr config;  // [1, numModuleLayers, configSize]
+    };
+
+    virtual ~LoraAdapterSource() = default;
+
+    //! \brief Fetch the adapter, called on the put workers. Throws on failure.
+    [[nodiscard]] virtual Adapter fetch(std::string const& uri) const = 0;
+};
+
+//! \brief Adapters in directories holding model.lora_weights.npy and model.lora_config.npy, as written by the LoRA
+//! conversion scripts. The URI is the path of the directory, optionally prefixed by file://. Object stores are served
+//! by a source that downloads to such a directory, or mounts the bucket.
+class DirectoryLoraAdapterSource : public LoraAdapterSource
+{
+public:
+    explicit DirectoryLoraAdapterSource(BufferManager::CudaStreamPtr stream);
+
+    [[nodiscard]] Adapter fetch(std::string const& uri) const override;
+
+private:
+    BufferManager mBufferManager;
+};
+
+//! \brief Catalog of the adapters by task id, loading them into the host LoraCache in the background.
+//! \details A request only carries the task id of an adapter registered here. On the first request of a task the
+//! adapter is fetched, validated against the model and put into the host cache on the put workers, so the request
+//! payload does not carry the weights. Meanwhile `request` reports the task as not ready and the scheduler defers the
+//! request instead of failing it with PeftTaskNotCachedException. `prefetch` loads the adapters of the queued requests
+//! at a lower priority than the ones needed now, bounded by `maxPrefetchesInFlight`.
+class LoraAdapterRepository
+{
+public:
+    using TaskIdType = LoraCache::TaskIdType;
+
+    enum class Status : std::int8_t
+    {
+        //! \brief No URI is registered for the task.
+        kUNKNOWN,
+        //! \brief Registered, not in the host cache, e.g. never fetched or evicted since.
+        kMISSING,
+        kFETCHING,
+        kCACHED,
+        //! \brief The last fetch failed, see `getError`. The next request retries.
+        kFAILED
+    };
+
+    LoraAdapterRepository(std::shared_ptr<LoraAdapterSource const> source, LoraCache& hostCache,
+        std::shared_ptr<WorkerPool> putWorkers, ModelConfig modelConfig, WorldConfig worldConfig,
+        std::size_t maxPrefetchesInFlight = 4);
+
+    LoraAdapterRepository(LoraAdapterRepository const&) = delete;
+    LoraAdapterRepository& operator=(LoraAdapterRepository const&) = delete;
+
+    //! \brief Waits for the fetches in flight.
+    ~LoraAdapterRepository();
+
+    void registerAdapter(TaskIdType taskId, std::string uri);
+
+    //! \brief Makes the adapter of a scheduled request available, starting its fetch if it is not cached yet.
+    //! \return kCACHED once the request can run, kFETCHING while it has to be deferred.
+    Status request(TaskIdType taskId);
+
+    //! \brief Starts fetching the adapters of queued requests, in the order of the queue.
+    void prefetch(std::vector<TaskIdType> const& queuedTaskIds);
+
+    [[nodiscard]] Status getStatus(TaskIdType taskId) const;
+
+    [[nodiscard]] std::optional<std::string> getError(TaskIdType taskId) const;
+
+    //! \brief Blocks until no fetch is in flight.
+    void waitForFetches() const;
+
+private:
+    struct Entry
+    {
+        std::string uri;
+        bool fetching{false};
+        bool prefetch{false};
+        std::optional<std::string> error;
+    };
+
+    [[nodiscard]] Status getStatus(TaskIdType taskId, Entry const& entry) const;
+
+    //! \brief Enqueues the fetch of the entry, called with mMutex held.
+    void startFetch(TaskIdType taskId, Entry& entry, bool prefetch);
+
+    void fetch(TaskIdType taskId, std::string const& uri);
+
+    std::shared_ptr<LoraAdapterSource const> mSource;
+    LoraCache& mHostCache;
+    std::shared_ptr<WorkerPool> mPutWorkers;
+    ModelConfig mModelConfig;
+    WorldConfig mWorldConfig;
+    std::size_t mMaxPrefetchesInFlight;
+
+    mutable std::mutex mMutex;
+    mutable std::condition_variable mFetchDone;
+    std::unordered_map<TaskIdType, Entry> mEntries;
+    std::size_t mNumFetching{0};
+    std::size_t mNumPrefetching{0};
+};
+
+} // namespace tensorrt_llm::runtime
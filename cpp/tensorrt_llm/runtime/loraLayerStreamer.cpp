@@ -0,0 +1,317 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/loraLayerStreamer.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <string>
+
+namespace tensorrt_llm::runtime
+{
+
+LoraLayerStreamer::LoraLayerStreamer(
+    LoraCachePageManagerConfig const& deviceConfig, LoraCache& hostCache, BufferManager const& manager)
+    : mDeviceConfig{deviceConfig}
+    , mHostCache{hostCache}
+    , mPageManager{std::make_unique<LoraCachePageManager>(deviceConfig, manager)}
+{
+    TLLM_CHECK_WITH_INFO(mDeviceConfig.getMemoryType() == MemoryType::kGPU, "The LoRA layer pages must be on the GPU");
+    TLLM_CHECK_WITH_INFO(mDeviceConfig.getNumCopyStreams() > 0, "The LoRA layers need at least one copy stream");
+    for (SizeType32 i = 0; i < mDeviceConfig.getNumCopyStreams(); ++i)
+    {
+        mCopyManagers.push_back(std::make_unique<BufferManager>(std::make_shared<CudaStream>()));
+    }
+}
+
+SizeType32 LoraLayerStreamer::prefetch(TaskIdType taskId)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const layerIds = getLayerIds(taskId);
+    SizeType32 numResident{0};
+    for (auto const layerId : layerIds)
+    {
+        LayerKey const key{taskId, layerId};
+        if (mLayers.count(key) != 0)
+        {
+            ++numResident;
+            continue;
+        }
+        auto const hostConfigs = getHostConfigs(taskId, layerId);
+        auto& copyManager = *mCopyManagers[mNextCopyStream];
+        auto pageIds = claimPages(taskId, determineNumPages(hostConfigs), false, copyManager.getStream());
+        if (!pageIds)
+        {
+            // The remaining layers are streamed.
+            break;
+        }
+        mNextCopyStream = (mNextCopyStream + 1) % mCopyManagers.size();
+        load(key, hostConfigs, std::move(*pageIds), copyManager);
+        ++numResident;
+    }
+    TLLM_LOG_DEBUG("LoRA task %lu has %d of %zu layers resident", taskId, numResident, layerIds.size());
+    return numResident;
+}
+
+std::vector<LoraLayerStreamer::TaskLayerModuleConfig> LoraLayerStreamer::enqueueLayer(
+    TaskIdType taskId, SizeType32 layerId)
+{
+    LayerKey const key{taskId, layerId};
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mLayers.find(key);
+    if (it != mLayers.end())
+    {
+        auto& layer = it->second;
+        layer.inUse = true;
+        mLru.splice(mLru.begin(), mLru, layer.lruIt);
+        ++mStats.numLayerHits;
+        return layer.configs;
+    }
+
+    auto const hostConfigs = getHostConfigs(taskId, layerId);
+    TLLM_CHECK_WITH_INFO(!hostConfigs.empty(), "LoRA task %lu has no modules in layer %d", taskId, layerId);
+    auto& copyManager = *mCopyManagers[mNextCopyStream];
+    mNextCopyStream = (mNextCopyStream + 1) % mCopyManagers.size();
+    auto const numPages = determineNumPages(hostConfigs);
+    auto pageIds = claimPages(taskId, numPages, true, copyManager.getStream());
+    if (!pageIds)
+    {
+        throw LoraCacheFullException("Could not stream layer " + std::to_string(layerId) + " of LoRA task "
+            + std::to_string(taskId) + ": it needs " + std::to_string(numPages) + " pages, "
+            + std::to_string(mPageManager->numAvailablePages()) + " are free and the others are in use");
+    }
+    auto& layer = load(key, hostConfigs, std::move(*pageIds), copyManager);
+    layer.inUse = true;
+    return layer.configs;
+}
+
+void LoraLayerStreamer::waitForLayer(TaskIdType taskId, SizeType32 layerId, CudaStream const& stream) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mLayers.find(LayerKey{taskId, layerId});
+    TLLM_CHECK_WITH_INFO(
+        it != mLayers.end(), "Layer %d of LoRA task %lu is waited for but was not enqueued", layerId, taskId);
+    stream.wait(it->second.ready);
+}
+
+void LoraLayerStreamer::releaseLayer(TaskIdType taskId, SizeType32 layerId, CudaStream const& stream)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mLayers.find(LayerKey{taskId, layerId});
+    if (it == mLayers.end())
+    {
+        return;
+    }
+    stream.record(it->second.released);
+    it->second.inUse = false;
+}
+
+void LoraLayerStreamer::evict(TaskIdType taskId)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mLayers.lower_bound(LayerKey{taskId, std::numeric_limits<SizeType32>::min()});
+    while (it != mLayers.end() && it->first.first == taskId)
+    {
+        auto const next = std::next(it);
+        if (!it->second.inUse)
+        {
+            evictLayer(it);
+        }
+        it = next;
+    }
+}
+
+bool LoraLayerStreamer::isResident(TaskIdType taskId, SizeType32 layerId) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mLayers.count(LayerKey{taskId, layerId}) != 0;
+}
+
+SizeType32 LoraLayerStreamer::getNumAvailablePages() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPageManager->numAvailablePages();
+}
+
+LoraLayerStreamer::Stats LoraLayerStreamer::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+std::vector<LoraLayerStreamer::TaskLayerModuleConfig> LoraLayerStreamer::getHostConfigs(
+    TaskIdType taskId, SizeType32 layerId) const
+{
+    auto const& configs = mHostCache.get(taskId);
+    std::vector<TaskLayerModuleConfig> layerConfigs;
+    std::copy_if(configs.begin(), configs.end(), std::back_inserter(layerConfigs),
+        [layerId](TaskLayerModuleConfig const& config) { return config.layerId == layerId; });
+    return layerConfigs;
+}
+
+std::vector<SizeType32> LoraLayerStreamer::getLayerIds(TaskIdType taskId) const
+{
+    auto const& configs = mHostCache.get(taskId);
+    std::vector<SizeType32> layerIds;
+    for (auto const& config : configs)
+    {
+        if (std::find(layerIds.begin(), layerIds.end(), config.layerId) == layerIds.end())
+        {
+            layerIds.push_back(config.layerId);
+        }
+    }
+    return layerIds;
+}
+
+SizeType32 LoraLayerStreamer::determineNumPages(std::vector<TaskLayerModuleConfig> const& hostConfigs) const
+{
+    SizeType32 numPages{0};
+    SizeType32 currSlot{mDeviceConfig.getSlotsPerPage()};
+    for (auto const& config : hostConfigs)
+    {
+        TLLM_CHECK(config.numSlots <= mDeviceConfig.getSlotsPerPage());
+        if (currSlot + config.numSlots > mDeviceConfig.getSlotsPerPage())
+        {
+            currSlot = 0;
+            ++numPages;
+        }
+        currSlot += config.numSlots;
+    }
+    return numPages;
+}
+
+std::optional<std::vector<std::size_t>> LoraLayerStreamer::claimPages(
+    TaskIdType taskId, SizeType32 numPages, bool evictLayers, CudaStream const& copyStream)
+{
+    if (mPageManager->numAvailablePages() < numPages && evictLayers)
+    {
+        // The layers of the task itself first, by the order of the layers since they are streamed in that order.
+        std::vector<std::map<LayerKey, Layer>::iterator> candidates;
+        for (auto it = mLayers.lower_bound(LayerKey{taskId, std::numeric_limits<SizeType32>::min()});
+             it != mLayers.end() && it->first.first == taskId; ++it)
+        {
+            if (!it->second.inUse)
+            {
+                candidates.push_back(it);
+            }
+        }
+        for (auto lruIt = mLru.rbegin(); lruIt != mLru.rend(); ++lruIt)
+        {
+            if (lruIt->first == taskId)
+            {
+                continue;
+            }
+            auto const it = mLayers.find(*lruIt);
+            if (!it->second.inUse)
+            {
+                candidates.push_back(it);
+            }
+        }
+
+        for (auto const& it : candidates)
+        {
+            if (mPageManager->numAvailablePages() >= numPages)
+            {
+                break;
+            }
+            evictLayer(it);
+        }
+    }
+    auto pageIds = mPageManager->claimPages(numPages);
+    if (pageIds)
+    {
+        // The pages may still be read by the layers evicted before, until their released events complete.
+        mReleasedEvents.erase(std::remove_if(mReleasedEvents.begin(), mReleasedEvents.end(),
+                                  [](CudaEvent const& event) { return ::cudaEventQuery(event.get()) == cudaSuccess; }),
+            mReleasedEvents.end());
+        for (auto const& released : mReleasedEvents)
+        {
+            copyStream.wait(released);
+        }
+    }
+    return pageIds;
+}
+
+LoraLayerStreamer::Layer& LoraLayerStreamer::load(LayerKey const& key,
+    std::vector<TaskLayerModuleConfig> const& hostConfigs, std::vector<std::size_t> pageIds,
+    BufferManager const& copyManager)
+{
+    auto const pageWidth = mDeviceConfig.getPageWidth();
+    auto const slotsPerPage = mDeviceConfig.getSlotsPerPage();
+
+    std::vector<TaskLayerModuleConfig> deviceConfigs;
+    deviceConfigs.reserve(hostConfigs.size());
+    std::size_t currPage{0};
+    SizeType32 currSlot{0};
+    for (auto const& hostConfig : hostConfigs)
+    {
+        if (currSlot + hostConfig.numSlots > slotsPerPage)
+        {
+            currSlot = 0;
+            ++currPage;
+        }
+        auto const numElements = hostConfig.numSlots * pageWidth;
+        auto const flatShape = ITensor::makeShape({numElements});
+        auto const source = ITensor::view(
+            ITensor::slice(mHostCache.getPagePtr(hostConfig.pageId), hostConfig.slotIdx, hostConfig.numSlots),
+            flatShape);
+        ITensor::SharedPtr const target = ITensor::view(
+            ITensor::slice(mPageManager->mutablePagePtr(pageIds.at(currPage)), currSlot, hostConfig.numSlots),
+            flatShape);
+        copyManager.copy(*source, *target);
+
+        auto config = hostConfig;
+        config.pageId = pageIds.at(currPage);
+        config.slotIdx = currSlot;
+        config.weightsInPointer = reinterpret_cast<std::int64_t>(ITensor::slice(target, 0, config.inSize)->data());
+        config.weightsOutPointer
+            = reinterpret_cast<std::int64_t>(ITensor::slice(target, config.inSize, config.outSize)->data());
+        if (config.scalingVecPointer.has_value())
+        {
+            auto const outDim = config.outSize / config.adapterSize;
+            config.scalingVecPointer = reinterpret_cast<std::int64_t>(
+                ITensor::slice(target, config.inSize + config.outSize, outDim)->data());
+        }
+        deviceConfigs.push_back(config);
+        currSlot += hostConfig.numSlots;
+    }
+
+    mLru.push_front(key);
+    auto [it, inserted] = mLayers.try_emplace(key);
+    TLLM_CHECK(inserted);
+    auto& layer = it->second;
+    layer.pageIds = std::move(pageIds);
+    layer.configs = std::move(deviceConfigs);
+    layer.lruIt = mLru.begin();
+    copyManager.getStream().record(layer.ready);
+    ++mStats.numLayerCopies;
+    return layer;
+}
+
+void LoraLayerStreamer::evictLayer(std::map<LayerKey, Layer>::iterator it)
+{
+    TLLM_LOG_DEBUG("Evicting layer %d of LoRA task %lu", it->first.second, it->first.first);
+    mPageManager->releasePages(it->second.pageIds);
+    mReleasedEvents.push_back(std::move(it->second.released));
+    mLru.erase(it->second.lruIt);
+    mLayers.erase(it);
+    ++mStats.numLayerEvictions;
+}
+
+} // namespace tensorrt_llm::runtime
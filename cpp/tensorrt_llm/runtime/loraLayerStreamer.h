@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/loraCache.h"
+#include "tensorrt_llm/runtime/loraCachePageManagerConfig.h"
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/**
+ * Device residency of the LoRA tasks of a host LoraCache by layer.
+ *
+ * The unit of residency and eviction is the set of modules of a task in one layer, packed in its own device pages. A
+ * task may thus have only some of its layers resident, the others are streamed from the host cache while the forward
+ * pass runs: `enqueueLayer` copies a layer on one of the copy streams and records its event, the compute stream waits
+ * for it in `waitForLayer` right before the layer. Once the compute stream is done with a layer, `releaseLayer` makes
+ * it evictable again.
+ *
+ * Streaming first evicts the released layers of the same task, so that a large adapter cycles through its own pages
+ * instead of evicting the layers of the small ones. `prefetch` only uses free pages.
+ */
+class LoraLayerStreamer
+{
+public:
+    using TaskIdType = LoraCache::TaskIdType;
+    using TaskLayerModuleConfig = LoraCache::TaskLayerModuleConfig;
+
+    struct Stats
+    {
+        std::size_t numLayerHits{0};
+        std::size_t numLayerCopies{0};
+        std::size_t numLayerEvictions{0};
+    };
+
+    /**
+     * \param[in] deviceConfig: the device pages, of the page width of the host cache. The layers are copied on
+     * numCopyStreams streams.
+     * \param[in] hostCache: the cache the tasks are streamed from, a task must stay loaded there while it is streamed
+     * \param[in] manager: a BufferManager used to allocate the device pages
+     */
+    LoraLayerStreamer(
+        LoraCachePageManagerConfig const& deviceConfig, LoraCache& hostCache, BufferManager const& manager);
+
+    /**
+     * \brief Makes the layers of a task resident in order, as long as free pages are left.
+     * \returns -- the number of resident layers of the task
+     */
+    SizeType32 prefetch(TaskIdType taskId);
+
+    /**
+     * \brief Enqueues the copy of a layer of a task unless it is resident, and marks it in use.
+     * \returns -- the configs of the modules of the layer, pointing to the device pages
+     * \throws LoraCacheFullException if every page is used by layers in use
+     */
+    std::vector<TaskLayerModuleConfig> enqueueLayer(TaskIdType taskId, SizeType32 layerId);
+
+    //! \brief Makes the stream wait for the copy of the layer enqueued last.
+    void waitForLayer(TaskIdType taskId, SizeType32 layerId, CudaStream const& stream) const;
+
+    //! \brief Marks the layer evictable once the work enqueued on the stream so far is done.
+    void releaseLayer(TaskIdType taskId, SizeType32 layerId, CudaStream const& stream);
+
+    //! \brief Frees the pages of the layers of the task that are not in use.
+    void evict(TaskIdType taskId);
+
+    [[nodiscard]] bool isResident(TaskIdType taskId, SizeType32 layerId) const;
+
+    [[nodiscard]] SizeType32 getNumAvailablePages() const;
+
+    [[nodiscard]] Stats getStats() const;
+
+private:
+    using LayerKey = std::pair<TaskIdType, SizeType32>;
+
+    struct Layer
+    {
+        std::vector<std::size_t> pageIds;
+        std::vector<TaskLayerModuleConfig> configs;
+        //! \brief Recorded after the copy of the layer.
+        CudaEvent ready;
+        //! \brief Recorded when the layer is released, the copies to its pages wait for the readers.
+        CudaEvent released;
+        bool inUse{false};
+        std::list<LayerKey>::iterator lruIt;
+    };
+
+    //! \brief The configs of the modules of a layer of a task in the host cache.
+    [[nodiscard]] std::vector<TaskLayerModuleConfig> getHostConfigs(TaskIdType taskId, SizeType32 layerId) const;
+
+    [[nodiscard]] std::vector<SizeType32> getLayerIds(TaskIdType taskId) const;
+
+    [[nodiscard]] SizeType32 determineNumPages(std::vector<TaskLayerModuleConfig> const& hostConfigs) const;
+
+    //! \brief Claims pages, evicting the released layers of `taskId` first if `evictLayers`, then the least recently
+    //! used ones. The copy stream waits for the readers of the evicted pages. Called with mMutex held.
+    std::optional<std::vector<std::size_t>> claimPages(
+        TaskIdType taskId, SizeType32 numPages, bool evictLayers, CudaStream const& copyStream);
+
+    //! \brief Copies the layer to the pages and records its event. Called with mMutex held.
+    Layer& load(LayerKey const& key, std::vector<TaskLayerModuleConfig> const& hostConfigs,
+        std::vector<std::size_t> pageIds, BufferManager const& copyManager);
+
+    //! \brief Called with mMutex held.
+    void evictLayer(std::map<LayerKey, Layer>::iterator it);
+
+    LoraCachePageManagerConfig mDeviceConfig;
+    LoraCache& mHostCache;
+    std::vector<std::unique_ptr<BufferManager>> mCopyManagers;
+
+    mutable std::mutex mMutex;
+    std::unique_ptr<LoraCachePageManager> mPageManager;
+    std::map<LayerKey, Layer> mLayers;
+    //! \brief Most recently used first.
+    std::list<LayerKey> mLru;
+    //! \brief The released events of the evicted layers that may not have completed yet.
+    std::vector<CudaEvent> mReleasedEvents;
+    std::size_t mNextCopyStream{0};
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::runtime
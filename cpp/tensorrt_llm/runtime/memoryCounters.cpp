@@ -57,8 +57,17 @@ std::string MemoryCounters::bytesToString(DiffType bytes, int precision)
 
 std::string MemoryCounters::toString() const
 {
-    return tensorrt_llm::common::fmtstr("[MemUsage] GPU %s, CPU %s, Pinned %s", bytesToString(this->getGpu()).c_str(),
-        bytesToString(this->getCpu()).c_str(), bytesToString(this->getPinned()).c_str());
+    auto str = tensorrt_llm::common::fmtstr("[MemUsage] GPU %s, CPU %s, Pinned %s",
+        bytesToString(this->getGpu()).c_str(), bytesToString(this->getCpu()).c_str(),
+        bytesToString(this->getPinned()).c_str());
+    if (this->getPinnedPoolReserved() > 0)
+    {
+        str += tensorrt_llm::common::fmtstr(", Pinned pool %s (reserved %s, peak %s, fragmented %s)",
+            bytesToString(this->getPinnedPool()).c_str(), bytesToString(this->getPinnedPoolReserved()).c_str(),
+            bytesToString(this->getPinnedPoolPeak()).c_str(),
+            bytesToString(this->getPinnedPoolFragmentation()).c_str());
+    }
+    return str;
 }
 
 void MemoryCounters::allocate(MemoryType memoryType, MemoryCounters::SizeType32 size)
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/memoryPlanner.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/memoryCounters.h"
+#include "tensorrt_llm/runtime/tllmRuntime.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+struct Demand
+{
+    std::size_t kvTokens{0};
+    std::size_t crossKvTokens{0};
+    SizeType32 numAdapters{0};
+    SizeType32 numCudaGraphs{0};
+    std::size_t bytes{0};
+};
+
+Demand getDemand(
+    SizeType32 batchSize, MemoryPlanner::Requirements const& requirements, MemoryPlanner::WorkloadMix const& mix)
+{
+    Demand demand;
+    demand.kvTokens = std::max(requirements.minKvTokens,
+        static_cast<std::size_t>(std::ceil(batchSize * (mix.inputLength + mix.outputLength))));
+    if (requirements.crossKvBytesPerToken > 0)
+    {
+        demand.crossKvTokens = static_cast<std::size_t>(std::ceil(batchSize * mix.inputLength));
+    }
+    if (requirements.loraBytesPerAdapter > 0 && mix.numAdapters > 0)
+    {
+        // A request uses one adapter, so the batch needs at most as many adapters as LoRA requests.
+        auto const numLoraRequests = static_cast<SizeType32>(std::ceil(batchSize * mix.loraFraction));
+        demand.numAdapters = std::min(mix.numAdapters, numLoraRequests);
+    }
+    if (requirements.maxNumCudaGraphs > 0)
+    {
+        // One graph per power of two batch size up to the batch.
+        auto const numBuckets = static_cast<SizeType32>(std::floor(std::log2(std::max(batchSize, 1)))) + 1;
+        demand.numCudaGraphs = std::min(requirements.maxNumCudaGraphs, numBuckets);
+    }
+    demand.bytes = demand.kvTokens * requirements.kvBytesPerToken
+        + demand.crossKvTokens * requirements.crossKvBytesPerToken
+        + demand.numAdapters * requirements.loraBytesPerAdapter + demand.numCudaGraphs * requirements.cudaGraphBytes;
+    return demand;
+}
+
+std::string toMiB(std::size_t bytes)
+{
+    return MemoryCounters::bytesToString(static_cast<MemoryCounters::DiffType>(bytes));
+}
+} // namespace
+
+MemoryPlanner::MemoryPlan MemoryPlanner::plan(
+    std::size_t budget, Requirements const& requirements, WorkloadMix const& mix)
+{
+    TLLM_CHECK_WITH_INFO(requirements.kvBytesPerToken > 0, "The KV cache needs a size per token");
+    TLLM_CHECK_WITH_INFO(mix.targetBatchSize > 0, "The target batch size must be positive");
+
+    MemoryPlan plan;
+    plan.budget = budget;
+    plan.activation = requirements.activationBytes;
+    plan.allReduceWorkspace = requirements.allReduceWorkspaceBytes;
+    plan.userBuffer = requirements.userBufferBytes;
+    auto const fixed = plan.activation + plan.allReduceWorkspace + plan.userBuffer;
+    TLLM_CHECK_WITH_INFO(fixed < budget, "The activations and the workspaces need %s, more than the budget of %s",
+        toMiB(fixed).c_str(), toMiB(budget).c_str());
+    auto const flexible = budget - fixed;
+
+    // The demand grows with the batch size, so the largest batch that fits is found by bisection.
+    TLLM_CHECK_WITH_INFO(getDemand(1, requirements, mix).bytes <= flexible,
+        "A budget of %s does not fit a single request next to %s of activations and workspaces", toMiB(budget).c_str(),
+        toMiB(fixed).c_str());
+    SizeType32 low = 1;
+    SizeType32 high = mix.targetBatchSize;
+    while (low < high)
+    {
+        auto const mid = low + (high - low + 1) / 2;
+        if (getDemand(mid, requirements, mix).bytes <= flexible)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    auto const demand = getDemand(low, requirements, mix);
+    plan.batchSize = low;
+    plan.numAdapters = demand.numAdapters;
+    plan.numCudaGraphs = demand.numCudaGraphs;
+    plan.lora = demand.numAdapters * requirements.loraBytesPerAdapter;
+    plan.cudaGraphs = demand.numCudaGraphs * requirements.cudaGraphBytes;
+
+    // The rest goes to the KV caches, split like the demand of a request.
+    auto const spare = flexible - demand.bytes;
+    auto const selfBytes = demand.kvTokens * requirements.kvBytesPerToken;
+    auto const crossBytes = demand.crossKvTokens * requirements.crossKvBytesPerToken;
+    auto const crossSpare = crossBytes == 0
+        ? std::size_t{0}
+        : static_cast<std::size_t>(static_cast<double>(spare) * crossBytes / (selfBytes + crossBytes));
+    plan.kvTokens = (selfBytes + spare - crossSpare) / requirements.kvBytesPerToken;
+    plan.kvCache = plan.kvTokens * requirements.kvBytesPerToken;
+    if (requirements.crossKvBytesPerToken > 0)
+    {
+        plan.crossKvTokens = (crossBytes + crossSpare) / requirements.crossKvBytesPerToken;
+        plan.crossKvCache = plan.crossKvTokens * requirements.crossKvBytesPerToken;
+    }
+    plan.unassigned = flexible - plan.kvCache - plan.crossKvCache - plan.lora - plan.cudaGraphs;
+
+    if (plan.batchSize < mix.targetBatchSize)
+    {
+        TLLM_LOG_WARNING("The memory budget serves a batch of %d of the %d requests targeted", plan.batchSize,
+            mix.targetBatchSize);
+    }
+    return plan;
+}
+
+std::size_t MemoryPlanner::getActivationBytes(TllmRuntime const& runtime)
+{
+    std::size_t activationBytes{0};
+    for (SizeType32 profileIdx = 0; profileIdx < runtime.getNbProfiles(); ++profileIdx)
+    {
+        activationBytes = std::max(activationBytes, runtime.getActivationMemorySize(profileIdx));
+    }
+    return activationBytes;
+}
+
+void MemoryPlanner::log(MemoryPlan const& plan)
+{
+    TLLM_LOG_INFO("[MemoryPlan] %s", plan.toString().c_str());
+}
+
+float MemoryPlanner::MemoryPlan::getFreeGpuMemoryFraction() const
+{
+    auto const freeMemory = budget - activation;
+    return freeMemory == 0 ? 0.F : static_cast<float>(static_cast<double>(kvCache + crossKvCache) / freeMemory);
+}
+
+float MemoryPlanner::MemoryPlan::getCrossKvCacheFraction() const
+{
+    auto const kvMemory = kvCache + crossKvCache;
+    return kvMemory == 0 ? 0.F : static_cast<float>(static_cast<double>(crossKvCache) / kvMemory);
+}
+
+float MemoryPlanner::MemoryPlan::getDeviceCachePercent() const
+{
+    auto const freeMemory = budget - activation;
+    return freeMemory == 0 ? 0.F : static_cast<float>(static_cast<double>(lora) / freeMemory);
+}
+
+std::string MemoryPlanner::MemoryPlan::toString() const
+{
+    std::stringstream ss;
+    ss << "budget " << toMiB(budget) << ", batch " << batchSize << ": activations " << toMiB(activation)
+       << ", all-reduce workspace " << toMiB(allReduceWorkspace) << ", user buffers " << toMiB(userBuffer)
+       << ", KV cache " << toMiB(kvCache) << " (" << kvTokens << " tokens)";
+    if (crossKvCache > 0)
+    {
+        ss << ", cross KV cache " << toMiB(crossKvCache) << " (" << crossKvTokens << " tokens)";
+    }
+    if (lora > 0)
+    {
+        ss << ", LoRA " << toMiB(lora) << " (" << numAdapters << " adapters)";
+    }
+    if (cudaGraphs > 0)
+    {
+        ss << ", CUDA graphs " << toMiB(cudaGraphs) << " (" << numCudaGraphs << " graphs)";
+    }
+    ss << ", unassigned " << toMiB(unassigned);
+    return ss.str();
+}
+
+} // namespace tensorrt_llm::runtime
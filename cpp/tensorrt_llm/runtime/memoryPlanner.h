@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <cstddef>
+#include <string>
+
+namespace tensorrt_llm::runtime
+{
+
+class TllmRuntime;
+
+//! \brief Splits one device memory budget between the activations, the workspaces, the KV caches, the LoRA cache and
+//! the CUDA graphs, instead of sizing each of them by its own knob.
+//! \details The activations of the largest profile and the all-reduce and user-buffer workspaces are fixed. The plan
+//! then serves the largest batch of the target workload mix that fits: every request of the batch needs its self and
+//! cross KV, every LoRA request of it an adapter up to the number of distinct adapters, and every power of two batch
+//! size up to it a CUDA graph. The memory left goes to the KV caches, which bounds the reuse and the queueing of the
+//! mix.
+class MemoryPlanner
+{
+public:
+    //! \brief The workload the plan is sized for, on average per request.
+    struct WorkloadMix
+    {
+        double inputLength{0};
+        double outputLength{0};
+        //! \brief Requests in flight the plan aims to serve.
+        SizeType32 targetBatchSize{1};
+        //! \brief Fraction of the requests with a LoRA adapter.
+        double loraFraction{0};
+        //! \brief Distinct adapters in use.
+        SizeType32 numAdapters{0};
+    };
+
+    //! \brief The memory needs of the subsystems.
+    struct Requirements
+    {
+        std::size_t activationBytes{0};
+        std::size_t allReduceWorkspaceBytes{0};
+        std::size_t userBufferBytes{0};
+        std::size_t kvBytesPerToken{0};
+        //! \brief Zero without cross attention, the encoder output is as long as the input.
+        std::size_t crossKvBytesPerToken{0};
+        //! \brief Tokens the KV cache needs at least, e.g. one sequence of the max length.
+        std::size_t minKvTokens{0};
+        std::size_t loraBytesPerAdapter{0};
+        std::size_t cudaGraphBytes{0};
+        //! \brief CUDA graphs kept at most, zero without CUDA graphs.
+        SizeType32 maxNumCudaGraphs{0};
+    };
+
+    struct MemoryPlan
+    {
+        std::size_t budget{0};
+        std::size_t activation{0};
+        std::size_t allReduceWorkspace{0};
+        std::size_t userBuffer{0};
+        std::size_t kvCache{0};
+        std::size_t crossKvCache{0};
+        std::size_t lora{0};
+        std::size_t cudaGraphs{0};
+        std::size_t unassigned{0};
+
+        //! \brief Largest batch of the mix the plan serves.
+        SizeType32 batchSize{0};
+        std::size_t kvTokens{0};
+        std::size_t crossKvTokens{0};
+        SizeType32 numAdapters{0};
+        SizeType32 numCudaGraphs{0};
+
+        //! \brief The plan as KvCacheConfig::freeGpuMemoryFraction, relative to the memory left by the activations.
+        [[nodiscard]] float getFreeGpuMemoryFraction() const;
+
+        //! \brief The plan as KvCacheConfig::crossKvCacheFraction.
+        [[nodiscard]] float getCrossKvCacheFraction() const;
+
+        //! \brief The plan as PeftCacheConfig::deviceCachePercent, relative to the memory left by the activations.
+        [[nodiscard]] float getDeviceCachePercent() const;
+
+        [[nodiscard]] std::string toString() const;
+    };
+
+    //! \brief Plans `budget` bytes, the device memory free once the weights are loaded.
+    [[nodiscard]] static MemoryPlan plan(std::size_t budget, Requirements const& requirements, WorkloadMix const& mix);
+
+    //! \brief The activation memory of the runtime, the largest of its profiles.
+    [[nodiscard]] static std::size_t getActivationBytes(TllmRuntime const& runtime);
+
+    static void log(MemoryPlan const& plan);
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tensorrt_llm/runtime/moeExpertPager.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace tensorrt_llm::runtime
+{
+
+ExpertResidencyPolicy::ExpertResidencyPolicy(SizeType32 numExperts, SizeType32 numSlots, float decay)
+    : mDecay{decay}
+    , mScores(numExperts, 0.F)
+    , mSlotOfExpert(numExperts, kNotResident)
+    , mExpertInSlot(numSlots, kNotResident)
+    , mIsRecent(numExperts, false)
+{
+    TLLM_CHECK_WITH_INFO(numSlots > 0 && numSlots <= numExperts, "Cannot page %d experts through %d slots",
+        numExperts, numSlots);
+    TLLM_CHECK(decay >= 0.F && decay < 1.F);
+}
+
+void ExpertResidencyPolicy::observe(std::vector<SizeType32> const& numTokensPerExpert)
+{
+    TLLM_CHECK(numTokensPerExpert.size() == mScores.size());
+    for (std::size_t expert = 0; expert < mScores.size(); ++expert)
+    {
+        mScores[expert] = mDecay * mScores[expert] + static_cast<float>(numTokensPerExpert[expert]);
+    }
+}
+
+std::vector<ExpertResidencyPolicy::Load> ExpertResidencyPolicy::require(std::vector<SizeType32> const& experts)
+{
+    std::vector<bool> isPinned(mScores.size(), false);
+    for (auto const expert : experts)
+    {
+        isPinned.at(expert) = true;
+    }
+    TLLM_CHECK_WITH_INFO(std::count(isPinned.begin(), isPinned.end(), true) <= getNumSlots(),
+        "A step needs more experts than there are slots (%d)", getNumSlots());
+
+    std::vector<Load> loads;
+    for (auto const expert : experts)
+    {
+        ++mStats.numRequired;
+        if (mSlotOfExpert[expert] != kNotResident)
+        {
+            continue;
+        }
+        ++mStats.numMisses;
+        auto const slot = findVictim(isPinned);
+        TLLM_CHECK(slot != kNotResident);
+        assign(expert, slot);
+        loads.push_back({expert, slot});
+    }
+    mIsRecent = std::move(isPinned);
+    return loads;
+}
+
+std::vector<ExpertResidencyPolicy::Load> ExpertResidencyPolicy::prefetch(SizeType32 maxNumLoads)
+{
+    std::vector<SizeType32> candidates;
+    for (SizeType32 expert = 0; expert < static_cast<SizeType32>(mScores.size()); ++expert)
+    {
+        if (mSlotOfExpert[expert] == kNotResident && mScores[expert] > 0.F)
+        {
+            candidates.push_back(expert);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [this](SizeType32 a, SizeType32 b) { return mScores[a] > mScores[b]; });
+
+    std::vector<Load> loads;
+    for (auto const expert : candidates)
+    {
+        if (static_cast<SizeType32>(loads.size()) >= maxNumLoads)
+        {
+            break;
+        }
+        auto const slot = findVictim(mIsRecent);
+        if (slot == kNotResident)
+        {
+            break;
+        }
+        auto const victim = mExpertInSlot[slot];
+        // Candidates are sorted, no later one will be hotter than this victim either.
+        if (victim != kNotResident && mScores[victim] >= mScores[expert])
+        {
+            break;
+        }
+        assign(expert, slot);
+        loads.push_back({expert, slot});
+        ++mStats.numPrefetches;
+    }
+    return loads;
+}
+
+SizeType32 ExpertResidencyPolicy::findVictim(std::vector<bool> const& isPinned) const
+{
+    SizeType32 victimSlot{kNotResident};
+    for (SizeType32 slot = 0; slot < getNumSlots(); ++slot)
+    {
+        auto const expert = mExpertInSlot[slot];
+        if (expert == kNotResident)
+        {
+            return slot;
+        }
+        if (!isPinned[expert]
+            && (victimSlot == kNotResident || mScores[expert] < mScores[mExpertInSlot[victimSlot]]))
+        {
+            victimSlot = slot;
+        }
+    }
+    return victimSlot;
+}
+
+void ExpertResidencyPolicy::assign(SizeType32 expert, SizeType32 slot)
+{
+    auto const previous = mExpertInSlot[slot];
+    if (previous != kNotResident)
+    {
+        mSlotOfExpert[previous] = kNotResident;
+    }
+    mExpertInSlot[slot] = expert;
+    mSlotOfExpert[expert] = slot;
+}
+
+MoeExpertPager::MoeExpertPager(
+    std::vector<WeightTensor> tensors, SizeType32 numExperts, SizeType32 numSlots, float decay)
+    : mTensors{std::move(tensors)}
+    , mPolicy{numExperts, numSlots, decay}
+    , mHostSlotsEvents(2)
+{
+    for (auto const& tensor : mTensors)
+    {
+        TLLM_CHECK(tensor.hostData != nullptr && tensor.expertSizeInBytes > 0);
+        mSlotBuffers.push_back(BufferManager::gpuSync(tensor.expertSizeInBytes * numSlots));
+    }
+    auto const tableSize = sizeof(SizeType32) * numExperts;
+    mDeviceSlots = BufferManager::gpuSync(tableSize);
+    // All bytes 0xff is kNotResident.
+    TLLM_CUDA_CHECK(cudaMemset(mDeviceSlots->data(), 0xff, tableSize));
+    for (std::size_t i = 0; i < mHostSlotsEvents.size(); ++i)
+    {
+        mHostSlots.push_back(BufferManager::pinned(tableSize));
+    }
+}
+
+void MoeExpertPager::page(std::vector<SizeType32> const& numTokensPerExpert, cudaStream_t stream)
+{
+    mPolicy.observe(numTokensPerExpert);
+    std::vector<SizeType32> experts;
+    for (SizeType32 expert = 0; expert < static_cast<SizeType32>(numTokensPerExpert.size()); ++expert)
+    {
+        if (numTokensPerExpert[expert] > 0)
+        {
+            experts.push_back(expert);
+        }
+    }
+    load(mPolicy.require(experts), stream);
+    // Also covers prefetches of experts this step needs that may still be in flight.
+    TLLM_CUDA_CHECK(cudaStreamWaitEvent(stream, mCopiedEvent.get()));
+}
+
+void MoeExpertPager::prefetch(SizeType32 maxNumLoads, cudaStream_t stream)
+{
+    load(mPolicy.prefetch(maxNumLoads), stream);
+}
+
+void MoeExpertPager::load(std::vector<ExpertResidencyPolicy::Load> const& loads, cudaStream_t stream)
+{
+    if (loads.empty())
+    {
+        return;
+    }
+    // Slots are overwritten, so earlier steps must be done reading them.
+    TLLM_CUDA_CHECK(cudaEventRecord(mReadyEvent.get(), stream));
+    mCopyStream.wait(mReadyEvent);
+    for (std::size_t tensorIdx = 0; tensorIdx < mTensors.size(); ++tensorIdx)
+    {
+        auto const& tensor = mTensors[tensorIdx];
+        auto* slots = static_cast<std::uint8_t*>(mSlotBuffers[tensorIdx]->data());
+        auto const* host = static_cast<std::uint8_t const*>(tensor.hostData);
+        for (auto const& [expert, slot] : loads)
+        {
+            TLLM_CUDA_CHECK(cudaMemcpyAsync(slots + slot * tensor.expertSizeInBytes,
+                host + expert * tensor.expertSizeInBytes, tensor.expertSizeInBytes, cudaMemcpyHostToDevice,
+                mCopyStream.get()));
+        }
+    }
+
+    auto& hostSlots = *mHostSlots[mHostSlotsIdx];
+    auto const& hostSlotsEvent = mHostSlotsEvents[mHostSlotsIdx];
+    // The previous copy out of this table must be done before it is overwritten.
+    hostSlotsEvent.synchronize();
+    auto const& slotOfExpert = mPolicy.getSlots();
+    std::memcpy(hostSlots.data(), slotOfExpert.data(), sizeof(SizeType32) * slotOfExpert.size());
+    TLLM_CUDA_CHECK(cudaMemcpyAsync(mDeviceSlots->data(), hostSlots.data(), sizeof(SizeType32) * slotOfExpert.size(),
+        cudaMemcpyHostToDevice, mCopyStream.get()));
+    mCopyStream.record(hostSlotsEvent);
+    mHostSlotsIdx = (mHostSlotsIdx + 1) % mHostSlots.size();
+    mCopyStream.record(mCopiedEvent);
+}
+
+} // namespace tensorrt_llm::runtime
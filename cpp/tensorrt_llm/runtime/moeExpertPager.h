@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/iBuffer.h"
+
+#include <cuda_runtime_api.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Decides which experts of a MoE layer are resident in a fixed number of device slots.
+/// @details Every expert has a score, the exponentially decayed number of tokens routed to it. Experts a step needs
+/// are loaded on demand and replace the resident experts with the lowest scores. Between steps, the hottest experts
+/// that are not resident are prefetched into the slots of colder ones, without evicting the experts of the last step.
+class ExpertResidencyPolicy
+{
+public:
+    struct Load
+    {
+        SizeType32 expert;
+        SizeType32 slot;
+    };
+
+    struct Stats
+    {
+        std::int64_t numRequired{0};
+        std::int64_t numMisses{0};
+        std::int64_t numPrefetches{0};
+    };
+
+    static constexpr SizeType32 kNotResident{-1};
+
+    ExpertResidencyPolicy(SizeType32 numExperts, SizeType32 numSlots, float decay = 0.9F);
+
+    /// @brief Record how many tokens one step routed to every expert.
+    void observe(std::vector<SizeType32> const& numTokensPerExpert);
+
+    /// @brief Make the experts resident, evicting the coldest experts the step does not need.
+    /// @return The experts to load and their slots.
+    [[nodiscard]] std::vector<Load> require(std::vector<SizeType32> const& experts);
+
+    /// @brief Up to maxNumLoads non-resident experts that score higher than the resident experts they replace.
+    [[nodiscard]] std::vector<Load> prefetch(SizeType32 maxNumLoads);
+
+    /// @brief Slot of every expert, kNotResident for experts that are not resident.
+    [[nodiscard]] std::vector<SizeType32> const& getSlots() const noexcept
+    {
+        return mSlotOfExpert;
+    }
+
+    [[nodiscard]] SizeType32 getNumSlots() const noexcept
+    {
+        return static_cast<SizeType32>(mExpertInSlot.size());
+    }
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+private:
+    //! \brief The free slot or the slot of the coldest resident expert that is not pinned, kNotResident if none.
+    [[nodiscard]] SizeType32 findVictim(std::vector<bool> const& isPinned) const;
+
+    void assign(SizeType32 expert, SizeType32 slot);
+
+    float mDecay;
+    std::vector<float> mScores;
+    std::vector<SizeType32> mSlotOfExpert;
+    std::vector<SizeType32> mExpertInSlot;
+    // Experts of the last step, prefetching does not evict them.
+    std::vector<bool> mIsRecent;
+    Stats mStats;
+};
+
+/// @brief Pages the expert weights of a MoE layer between pinned host memory and a fixed number of device slots.
+/// @details Every weight tensor of the layer (e.g. FC1, FC2, their biases and scales) holds all experts back to back in
+/// host memory and numSlots experts in device memory, in the layout the grouped GEMMs expect for numSlots experts.
+/// Before a step, page() loads the experts the routing selected and makes the stream wait for them; the routing must
+/// then be remapped to slots with the table from getDeviceSlots(). After the step was enqueued, prefetch() loads
+/// predicted experts on a side stream, overlapping the copies with the attention of the next layers.
+class MoeExpertPager
+{
+public:
+    struct WeightTensor
+    {
+        //! \brief Pinned host memory with the weights of every expert.
+        void const* hostData;
+        std::size_t expertSizeInBytes;
+    };
+
+    MoeExpertPager(std::vector<WeightTensor> tensors, SizeType32 numExperts, SizeType32 numSlots, float decay = 0.9F);
+
+    /// @brief Load the experts a step needs and make stream wait for them. Experts that reside already are not copied.
+    /// @param numTokensPerExpert Tokens routed to every expert in this step, experts with none are not loaded.
+    void page(std::vector<SizeType32> const& numTokensPerExpert, cudaStream_t stream);
+
+    /// @brief Load up to maxNumLoads predicted experts once the work enqueued on stream so far is done with the slots.
+    void prefetch(SizeType32 maxNumLoads, cudaStream_t stream);
+
+    /// @brief Device memory of the slots of a weight tensor, numSlots experts back to back.
+    [[nodiscard]] void* getSlotData(SizeType32 tensorIdx) const
+    {
+        return mSlotBuffers.at(tensorIdx)->data();
+    }
+
+    /// @brief Device table with the slot of every expert, ExpertResidencyPolicy::kNotResident if not resident.
+    [[nodiscard]] SizeType32 const* getDeviceSlots() const
+    {
+        return static_cast<SizeType32 const*>(mDeviceSlots->data());
+    }
+
+    [[nodiscard]] ExpertResidencyPolicy const& getPolicy() const noexcept
+    {
+        return mPolicy;
+    }
+
+private:
+    //! \brief Copy the experts and the slot table on the copy stream after the work on stream.
+    void load(std::vector<ExpertResidencyPolicy::Load> const& loads, cudaStream_t stream);
+
+    std::vector<WeightTensor> mTensors;
+    ExpertResidencyPolicy mPolicy;
+    std::vector<IBuffer::SharedPtr> mSlotBuffers;
+    IBuffer::SharedPtr mDeviceSlots;
+    // Pinned copies of the slot table, one per copy in flight.
+    std::vector<IBuffer::SharedPtr> mHostSlots;
+    std::vector<CudaEvent> mHostSlotsEvents;
+    std::size_t mHostSlotsIdx{0};
+    CudaStream mCopyStream;
+    CudaEvent mReadyEvent;
+    CudaEvent mCopiedEvent;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -17,6 +17,7 @@
 #include "tensorrt_llm/runtime/ncclCommunicator.h"
 
 #include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/startupTrace.h"
 #include "tensorrt_llm/runtime/utils/multiDeviceUtils.h"
 
 #if ENABLE_MULTI_DEVICE
@@ -69,6 +70,55 @@ void NcclCommunicator::receive(
 #endif // ENABLE_MULTI_DEVICE
 }
 
+void NcclCommunicator::broadcast(IBuffer& buf, int root, CudaStream const& stream) const
+{
+#if ENABLE_MULTI_DEVICE
+    TLLM_NCCL_CHECK(ncclBroadcast(
+        buf.data(), buf.data(), buf.getSize(), toNcclType(buf.getDataType()), root, mComm, stream.get()));
+#else
+    TLLM_THROW("Multi device support is disabled.");
+#endif // ENABLE_MULTI_DEVICE
+}
+
+void NcclCommunicator::allGather(IBuffer const& sendBuf, IBuffer& recvBuf, CudaStream const& stream) const
+{
+#if ENABLE_MULTI_DEVICE
+    TLLM_CHECK(sendBuf.getDataType() == recvBuf.getDataType());
+    TLLM_NCCL_CHECK(ncclAllGather(sendBuf.data(), recvBuf.data(), sendBuf.getSize(),
+        toNcclType(sendBuf.getDataType()), mComm, stream.get()));
+#else
+    TLLM_THROW("Multi device support is disabled.");
+#endif // ENABLE_MULTI_DEVICE
+}
+
+void NcclCommunicator::groupStart()
+{
+#if ENABLE_MULTI_DEVICE
+    TLLM_NCCL_CHECK(ncclGroupStart());
+#else
+    TLLM_THROW("Multi device support is disabled.");
+#endif // ENABLE_MULTI_DEVICE
+}
+
+void NcclCommunicator::groupEnd()
+{
+#if ENABLE_MULTI_DEVICE
+    TLLM_NCCL_CHECK(ncclGroupEnd());
+#else
+    TLLM_THROW("Multi device support is disabled.");
+#endif // ENABLE_MULTI_DEVICE
+}
+
+void NcclCommunicator::allReduce(
+    void const* sendbuff, void* recvbuff, size_t count, nvinfer1::DataType dataType, CudaStream const& stream) const
+{
+#if ENABLE_MULTI_DEVICE
+    TLLM_NCCL_CHECK(ncclAllReduce(sendbuff, recvbuff, count, toNcclType(dataType), ncclSum, mComm, stream.get()));
+#else
+    TLLM_THROW("Multi device support is disabled.");
+#endif // ENABLE_MULTI_DEVICE
+}
+
 ncclComm_t NcclCommunicator::createComm(int worldSize, int rank, mpi::MpiComm const& mpiComm)
 {
 #if ENABLE_MULTI_DEVICE
@@ -87,7 +137,10 @@ ncclComm_t NcclCommunicator::createComm(int worldSize, int rank, mpi::MpiComm co
 #else
     setenv("NCCL_RUNTIME_CONNECT", "0", 0);
 #endif // _WIN32
-    TLLM_NCCL_CHECK(ncclCommInitRank(&comm, worldSize, id, rank));
+    {
+        TLLM_STARTUP_PHASE("nccl_comm_init");
+        TLLM_NCCL_CHECK(ncclCommInitRank(&comm, worldSize, id, rank));
+    }
     return comm;
 #else
     // Python runtime requires instantiation of a communicator even though it may never be used to enable
@@ -96,6 +149,34 @@ ncclComm_t NcclCommunicator::createComm(int worldSize, int rank, mpi::MpiComm co
 #endif // ENABLE_MULTI_DEVICE
 }
 
+std::vector<std::shared_ptr<NcclCommunicator>> NcclCommunicator::createLocalComms(std::vector<int> const& deviceIds)
+{
+#if ENABLE_MULTI_DEVICE
+    TLLM_CHECK_WITH_INFO(!deviceIds.empty(), "Local communicators need at least one device");
+    std::vector<ncclComm_t> comms(deviceIds.size());
+    // Static connection initialization, as in createComm.
+#if defined(_WIN32)
+    if (getenv("NCCL_RUNTIME_CONNECT") == nullptr)
+        _putenv_s("NCCL_RUNTIME_CONNECT", "0");
+#else
+    setenv("NCCL_RUNTIME_CONNECT", "0", 0);
+#endif // _WIN32
+    {
+        TLLM_STARTUP_PHASE("nccl_comm_init");
+        TLLM_NCCL_CHECK(ncclCommInitAll(comms.data(), static_cast<int>(deviceIds.size()), deviceIds.data()));
+    }
+    std::vector<std::shared_ptr<NcclCommunicator>> communicators;
+    communicators.reserve(comms.size());
+    for (auto* comm : comms)
+    {
+        communicators.push_back(std::make_shared<NcclCommunicator>(comm));
+    }
+    return communicators;
+#else
+    TLLM_THROW("Multi device support is disabled.");
+#endif // ENABLE_MULTI_DEVICE
+}
+
 NcclCommunicator::~NcclCommunicator()
 {
 #if ENABLE_MULTI_DEVICE
@@ -21,6 +21,9 @@
 #include "tensorrt_llm/runtime/iBuffer.h"
 #include "tensorrt_llm/runtime/worldConfig.h"
 
+#include <memory>
+#include <vector>
+
 struct ncclComm;
 typedef struct ncclComm* ncclComm_t;
 
@@ -41,6 +44,11 @@ public:
 
     ~NcclCommunicator();
 
+    //! \brief Communicators of ranks 0 to deviceIds.size() - 1 of a single process, one per device, without MPI.
+    //! Rank r runs on deviceIds[r], see LocalRankGroup for the threads of the ranks.
+    [[nodiscard]] static std::vector<std::shared_ptr<NcclCommunicator>> createLocalComms(
+        std::vector<int> const& deviceIds);
+
     // no copy
     NcclCommunicator(NcclCommunicator const&) = delete;
     NcclCommunicator& operator=(NcclCommunicator const&) = delete;
@@ -55,6 +63,20 @@ public:
         receive(buf.data(), buf.getSize(), buf.getDataType(), peer, stream);
     }
 
+    //! \brief Copy buf of rank root to buf of the other ranks.
+    void broadcast(IBuffer& buf, int root, CudaStream const& stream) const;
+
+    //! \brief Concatenate sendBuf of all ranks, by rank, in recvBuf.
+    void allGather(IBuffer const& sendBuf, IBuffer& recvBuf, CudaStream const& stream) const;
+
+    //! \brief Fuse the point-to-point and collective calls until groupEnd into a single launch.
+    static void groupStart();
+    static void groupEnd();
+
+    // Sum of count elements over all ranks.
+    void allReduce(void const* sendbuff, void* recvbuff, size_t count, nvinfer1::DataType dataType,
+        CudaStream const& stream) const;
+
 private:
     void send(
         void const* sendbuff, size_t count, nvinfer1::DataType dataType, int peer, CudaStream const& stream) const;
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/nvlsCommunicator.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/dataType.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/mpiUtils.h"
+
+#include <iterator>
+#include <map>
+#include <mutex>
+
+using namespace tensorrt_llm::runtime;
+namespace tk = tensorrt_llm::kernels;
+
+NvlsCommunicator::NvlsCommunicator(std::set<int> group, std::size_t workspaceSize)
+    : mGroup{std::move(group)}
+{
+    auto const rank = COMM_SESSION.getRank();
+    auto const it = mGroup.find(rank);
+    TLLM_CHECK_WITH_INFO(it != mGroup.end(), "Rank %d is not in the group of the NVLS communicator", rank);
+    mRank = static_cast<int>(std::distance(mGroup.begin(), it));
+    TLLM_CHECK_WITH_INFO(workspaceSize % tk::kNvlsVectorBytes == 0,
+        "NVLS workspace of %zu bytes, not a multiple of 16 bytes", workspaceSize);
+
+    mBuffer.reset(workspaceSize, mGroup);
+    mFlags.reset(tk::kNvlsNumFlags, mGroup);
+    // The counters of all the ranks must be zero before any rank arrives at the first barrier.
+    TLLM_CUDA_CHECK(cudaMemset(mFlags.getUnicastPointer(), 0, tk::kNvlsNumFlags * sizeof(uint32_t)));
+    TLLM_CUDA_CHECK(cudaDeviceSynchronize());
+    MPI_group_barrier(mGroup);
+    TLLM_LOG_INFO("NVLS communicator of %zu ranks with a workspace of %zu bytes", mGroup.size(), workspaceSize);
+}
+
+std::shared_ptr<NvlsCommunicator> NvlsCommunicator::getComm(std::set<int> const& group)
+{
+    static std::map<std::set<int>, std::shared_ptr<NvlsCommunicator>> commMap;
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& comm = commMap[group];
+    if (comm == nullptr)
+    {
+        comm = std::make_shared<NvlsCommunicator>(group, common::getEnvNvlsWorkspaceSize());
+    }
+    return comm;
+}
+
+bool NvlsCommunicator::isSupported()
+{
+    return common::getSMVersion() >= 90 && ipcNvlsSupported();
+}
+
+bool NvlsCommunicator::supportsAllReduce(
+    std::size_t numElements, nvinfer1::DataType dataType, int hiddenSize) const noexcept
+{
+    auto const bytes = numElements * common::getDTypeSize(dataType);
+    if (!tk::nvlsCollectiveSupported(dataType, bytes))
+    {
+        return false;
+    }
+    if (hiddenSize == 0)
+    {
+        return bytes <= getWorkspaceSize();
+    }
+    auto const rowBytes = hiddenSize * common::getDTypeSize(dataType);
+    return numElements % hiddenSize == 0 && rowBytes % tk::kNvlsVectorBytes == 0
+        && rowBytes / tk::kNvlsVectorBytes <= tk::kNvlsMaxRowVectors && 2 * bytes <= getWorkspaceSize();
+}
+
+tk::NvlsCollectiveParams NvlsCommunicator::makeParams(
+    void const* input, void* output, std::size_t numElements) const noexcept
+{
+    tk::NvlsCollectiveParams params;
+    params.ucBuffer = mBuffer.getUnicastPointer();
+    params.mcBuffer = mBuffer.getMulticastPointer();
+    params.ucFlags = mFlags.getUnicastPointer();
+    params.mcFlags = mFlags.getMulticastPointer();
+    params.input = input;
+    params.output = output;
+    params.numElements = numElements;
+    params.rank = mRank;
+    params.nRanks = static_cast<int>(mGroup.size());
+    return params;
+}
+
+void NvlsCommunicator::checkWorkspace(std::size_t bytes) const
+{
+    TLLM_CHECK_WITH_INFO(bytes <= getWorkspaceSize(),
+        "NVLS collective of %zu bytes, larger than the workspace of %zu bytes, see TRTLLM_NVLS_WORKSPACE_SIZE", bytes,
+        getWorkspaceSize());
+}
+
+void NvlsCommunicator::allReduce(void const* input, void* output, std::size_t numElements,
+    nvinfer1::DataType dataType, cudaStream_t stream) const
+{
+    checkWorkspace(numElements * common::getDTypeSize(dataType));
+    tk::invokeNvlsAllReduce(makeParams(input, output, numElements), dataType, stream);
+}
+
+void NvlsCommunicator::reduceScatter(void const* input, void* output, std::size_t numElements,
+    nvinfer1::DataType dataType, cudaStream_t stream) const
+{
+    checkWorkspace(mGroup.size() * numElements * common::getDTypeSize(dataType));
+    tk::invokeNvlsReduceScatter(makeParams(input, output, numElements), dataType, stream);
+}
+
+void NvlsCommunicator::allGather(void const* input, void* output, std::size_t numElements,
+    nvinfer1::DataType dataType, cudaStream_t stream) const
+{
+    checkWorkspace(mGroup.size() * numElements * common::getDTypeSize(dataType));
+    tk::invokeNvlsAllGather(makeParams(input, output, numElements), dataType, stream);
+}
+
+void NvlsCommunicator::allReduceResidualRmsNorm(void const* input, void const* residual, void const* bias,
+    void const* weight, void* output, void* residualOutput, std::size_t numElements, int hiddenSize, float eps,
+    nvinfer1::DataType dataType, cudaStream_t stream) const
+{
+    checkWorkspace(2 * numElements * common::getDTypeSize(dataType));
+    auto params = makeParams(input, output, numElements);
+    params.fusion.residual = residual;
+    params.fusion.bias = bias;
+    params.fusion.weight = weight;
+    params.fusion.residualOutput = residualOutput;
+    params.fusion.hiddenSize = hiddenSize;
+    params.fusion.eps = eps;
+    tk::invokeNvlsAllReduceResidualRmsNorm(params, dataType, stream);
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/kernels/nvlsCollectiveKernels.h"
+#include "tensorrt_llm/runtime/ipcNvlsMemory.h"
+
+#include <NvInferRuntime.h>
+#include <cuda_runtime.h>
+#include <memory>
+#include <set>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Collectives of the ranks of a NVSwitch node over a NVLS multicast workspace, see
+//! kernels::NvlsCollectiveParams. The reductions run on NVSwitch, so they take a few SMs and leave the others to the
+//! GEMMs they overlap with.
+//!
+//! All the ranks of the group must run the same collectives, in the same order and on streams that do not run other
+//! collectives of the group at the same time.
+class NvlsCommunicator
+{
+public:
+    //! \brief Allocates the workspace, collective over the ranks of the group.
+    NvlsCommunicator(std::set<int> group, std::size_t workspaceSize);
+
+    //! \brief The communicator of the group with a workspace of common::getEnvNvlsWorkspaceSize() bytes, created on the
+    //! first call, collective over the ranks of the group, like the NCCL communicators of common::getComm.
+    static std::shared_ptr<NvlsCommunicator> getComm(std::set<int> const& group);
+
+    //! \brief Whether the GPUs of this process support multicast objects.
+    [[nodiscard]] static bool isSupported();
+
+    [[nodiscard]] std::size_t getWorkspaceSize() const noexcept
+    {
+        return mBuffer.getCapacity();
+    }
+
+    //! \brief Whether allReduce, or allReduceResidualRmsNorm if hiddenSize is not 0, can serve the message.
+    [[nodiscard]] bool supportsAllReduce(
+        std::size_t numElements, nvinfer1::DataType dataType, int hiddenSize = 0) const noexcept;
+
+    void allReduce(void const* input, void* output, std::size_t numElements, nvinfer1::DataType dataType,
+        cudaStream_t stream) const;
+
+    //! \brief Reduce [nRanks, numElements] and keep the slice of this rank, [numElements].
+    void reduceScatter(void const* input, void* output, std::size_t numElements, nvinfer1::DataType dataType,
+        cudaStream_t stream) const;
+
+    //! \brief Gather [numElements] of every rank into [nRanks, numElements].
+    void allGather(void const* input, void* output, std::size_t numElements, nvinfer1::DataType dataType,
+        cudaStream_t stream) const;
+
+    //! \brief All-reduce, add the bias, if any, and the residual, and normalize the rows of hiddenSize, scaled by the
+    //! weight if any. residualOutput is the sum before the normalization.
+    void allReduceResidualRmsNorm(void const* input, void const* residual, void const* bias, void const* weight,
+        void* output, void* residualOutput, std::size_t numElements, int hiddenSize, float eps,
+        nvinfer1::DataType dataType, cudaStream_t stream) const;
+
+private:
+    [[nodiscard]] kernels::NvlsCollectiveParams makeParams(
+        void const* input, void* output, std::size_t numElements) const noexcept;
+
+    void checkWorkspace(std::size_t bytes) const;
+
+    std::set<int> mGroup;
+    int mRank{0};
+    DeviceAllocationNvls<uint8_t> mBuffer;
+    DeviceAllocationNvls<uint32_t> mFlags;
+};
+
+} // namespace tensorrt_llm::runtime
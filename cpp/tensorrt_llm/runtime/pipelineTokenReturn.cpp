@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/pipelineTokenReturn.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+#include "tensorrt_llm/runtime/ncclCommunicator.h"
+
+#include <algorithm>
+
+using namespace tensorrt_llm::runtime;
+
+PipelineTokenReturn::PipelineTokenReturn(std::shared_ptr<NcclCommunicator> comm, WorldConfig const& worldConfig,
+    SizeType32 numMicroBatches, SizeType32 maxNumSequences, SizeType32 maxTokensPerSequence, CudaStreamPtr stream)
+    : mComm{std::move(comm)}
+    , mBufferManager{std::move(stream)}
+    , mMaxNumSequences{maxNumSequences}
+    , mMaxTokensPerSequence{maxTokensPerSequence}
+{
+    TLLM_CHECK_WITH_INFO(mComm != nullptr, "PipelineTokenReturn needs a NCCL communicator");
+    TLLM_CHECK_WITH_INFO(numMicroBatches >= 1, "numMicroBatches must be at least 1");
+    TLLM_CHECK(maxNumSequences >= 1 && maxTokensPerSequence >= 1);
+
+    auto const pipelineGroup = worldConfig.getPipelineParallelGroup();
+    mFirstRank = pipelineGroup.front();
+    mLastRank = pipelineGroup.back();
+    mIsSender = worldConfig.isLastPipelineParallelRank() && mFirstRank != mLastRank;
+    mIsReceiver = worldConfig.isFirstPipelineParallelRank() && mFirstRank != mLastRank;
+
+    if (mIsSender || mIsReceiver)
+    {
+        // The number of sequences, then the sequences.
+        auto const size = 1 + static_cast<std::size_t>(maxNumSequences) * getSequenceStride();
+        mSlots.reserve(numMicroBatches);
+        for (SizeType32 i = 0; i < numMicroBatches; ++i)
+        {
+            Slot slot{mBufferManager.gpu(size, nvinfer1::DataType::kINT64),
+                BufferManager::pinned(size, nvinfer1::DataType::kINT64)};
+            mSlots.emplace_back(std::move(slot));
+        }
+    }
+}
+
+PipelineTokenReturn::Slot& PipelineTokenReturn::getSlot(std::uint64_t microBatchId)
+{
+    TLLM_CHECK_WITH_INFO(!mSlots.empty(), "Rank is neither the first nor the last of its pipeline parallel group");
+    return mSlots.at(microBatchId % mSlots.size());
+}
+
+void PipelineTokenReturn::send(std::uint64_t microBatchId, std::vector<SequenceTokens> const& sequences)
+{
+    NVTX3_FUNC_RANGE();
+    TLLM_CHECK_WITH_INFO(mIsSender, "Only the last pipeline parallel rank sends the new tokens");
+    TLLM_CHECK_WITH_INFO(static_cast<SizeType32>(sequences.size()) <= mMaxNumSequences,
+        "Micro-batch %lu has %zu sequences, more than %d", microBatchId, sequences.size(), mMaxNumSequences);
+
+    auto& slot = getSlot(microBatchId);
+    // The pinned buffer of the slot is reused once the copy of the previous micro-batch of the slot is done.
+    if (slot.pending)
+    {
+        slot.event.synchronize();
+    }
+
+    auto* packed = bufferCast<std::int64_t>(*slot.host);
+    packed[0] = static_cast<std::int64_t>(sequences.size());
+    auto* sequencePacked = packed + 1;
+    for (auto const& sequence : sequences)
+    {
+        TLLM_CHECK_WITH_INFO(static_cast<SizeType32>(sequence.tokens.size()) <= mMaxTokensPerSequence,
+            "Request %lu has %zu new tokens, more than %d", sequence.requestId, sequence.tokens.size(),
+            mMaxTokensPerSequence);
+        sequencePacked[0] = static_cast<std::int64_t>(sequence.requestId);
+        sequencePacked[1] = sequence.finished ? 1 : 0;
+        sequencePacked[2] = static_cast<std::int64_t>(sequence.tokens.size());
+        std::copy(sequence.tokens.begin(), sequence.tokens.end(), sequencePacked + 3);
+        sequencePacked += getSequenceStride();
+    }
+
+    auto const& stream = mBufferManager.getStream();
+    mBufferManager.copy(*slot.host, *slot.device);
+    mComm->send(*slot.device, mFirstRank, stream);
+    stream.record(slot.event);
+    slot.pending = true;
+}
+
+void PipelineTokenReturn::receiveAsync(std::uint64_t microBatchId)
+{
+    NVTX3_FUNC_RANGE();
+    TLLM_CHECK_WITH_INFO(mIsReceiver, "Only the first pipeline parallel rank receives the new tokens");
+
+    auto& slot = getSlot(microBatchId);
+    TLLM_CHECK_WITH_INFO(!slot.pending, "The receive of micro-batch %lu was not waited for",
+        microBatchId - mSlots.size());
+
+    auto const& stream = mBufferManager.getStream();
+    mComm->receive(*slot.device, mLastRank, stream);
+    mBufferManager.copy(*slot.device, *slot.host);
+    stream.record(slot.event);
+    slot.pending = true;
+}
+
+std::vector<PipelineTokenReturn::SequenceTokens> PipelineTokenReturn::wait(std::uint64_t microBatchId)
+{
+    NVTX3_FUNC_RANGE();
+    auto& slot = getSlot(microBatchId);
+    TLLM_CHECK_WITH_INFO(mIsReceiver && slot.pending, "No receive was posted for micro-batch %lu", microBatchId);
+    slot.event.synchronize();
+    slot.pending = false;
+
+    auto const* packed = bufferCast<std::int64_t>(*slot.host);
+    auto const numSequences = static_cast<SizeType32>(packed[0]);
+    TLLM_CHECK_WITH_INFO(numSequences >= 0 && numSequences <= mMaxNumSequences,
+        "Received %d sequences for micro-batch %lu", numSequences, microBatchId);
+
+    std::vector<SequenceTokens> sequences(numSequences);
+    auto const* sequencePacked = packed + 1;
+    for (auto& sequence : sequences)
+    {
+        sequence.requestId = static_cast<RequestIdType>(sequencePacked[0]);
+        sequence.finished = sequencePacked[1] != 0;
+        auto const numTokens = static_cast<SizeType32>(sequencePacked[2]);
+        TLLM_CHECK(numTokens >= 0 && numTokens <= mMaxTokensPerSequence);
+        sequence.tokens.assign(sequencePacked + 3, sequencePacked + 3 + numTokens);
+        sequencePacked += getSequenceStride();
+    }
+    return sequences;
+}
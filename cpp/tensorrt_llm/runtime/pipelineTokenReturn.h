@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/iBuffer.h"
+#include "tensorrt_llm/runtime/worldConfig.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+class NcclCommunicator;
+
+//! \brief Returns the new tokens of a micro-batch from the last pipeline parallel rank, which samples them, to the
+//! first one, which schedules the next micro-batches, with a NCCL send/recv instead of the MPI decoder step sends.
+//! \details The tokens of a micro-batch are packed in one int64 buffer of fixed capacity, so that every transfer is a
+//! single ncclSend matched by a single ncclRecv. Every micro-batch in flight has its own slot, in the order of the
+//! launches on both ranks, so that the first rank can post the receive of a micro-batch while later ones are still
+//! in the pipeline. Only the first and the last ranks of a pipeline parallel group take part.
+class PipelineTokenReturn
+{
+public:
+    using RequestIdType = std::uint64_t;
+    using CudaStreamPtr = std::shared_ptr<CudaStream>;
+
+    struct SequenceTokens
+    {
+        RequestIdType requestId{0};
+        bool finished{false};
+        //! \brief [numTokens * beamWidth], the new tokens of the beams one after the other.
+        std::vector<TokenIdType> tokens;
+    };
+
+    //! \param maxTokensPerSequence Largest number of new tokens of a sequence in one step, over all its beams.
+    PipelineTokenReturn(std::shared_ptr<NcclCommunicator> comm, WorldConfig const& worldConfig,
+        SizeType32 numMicroBatches, SizeType32 maxNumSequences, SizeType32 maxTokensPerSequence,
+        CudaStreamPtr stream);
+
+    //! \brief On the last rank, send the new tokens of micro-batch microBatchId to the first rank.
+    void send(std::uint64_t microBatchId, std::vector<SequenceTokens> const& sequences);
+
+    //! \brief On the first rank, post the receive of the tokens of micro-batch microBatchId.
+    void receiveAsync(std::uint64_t microBatchId);
+
+    //! \brief On the first rank, wait for the receive posted for microBatchId and return its tokens.
+    [[nodiscard]] std::vector<SequenceTokens> wait(std::uint64_t microBatchId);
+
+    [[nodiscard]] bool isSender() const noexcept
+    {
+        return mIsSender;
+    }
+
+    [[nodiscard]] bool isReceiver() const noexcept
+    {
+        return mIsReceiver;
+    }
+
+private:
+    struct Slot
+    {
+        IBuffer::SharedPtr device;
+        IBuffer::SharedPtr host;
+        CudaEvent event{};
+        bool pending{false};
+    };
+
+    [[nodiscard]] Slot& getSlot(std::uint64_t microBatchId);
+
+    // Number of int64 values of a sequence in the packed buffer: request id, finished, number of tokens, tokens.
+    [[nodiscard]] std::size_t getSequenceStride() const noexcept
+    {
+        return 3 + static_cast<std::size_t>(mMaxTokensPerSequence);
+    }
+
+    std::shared_ptr<NcclCommunicator> mComm;
+    BufferManager mBufferManager;
+    SizeType32 mMaxNumSequences;
+    SizeType32 mMaxTokensPerSequence;
+    int mFirstRank;
+    int mLastRank;
+    bool mIsSender;
+    bool mIsReceiver;
+    std::vector<Slot> mSlots;
+};
+
+} // namespace tensorrt_llm::runtime
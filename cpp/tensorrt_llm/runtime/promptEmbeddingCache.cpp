@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/promptEmbeddingCache.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+using HashType = PromptEmbeddingCache::HashType;
+
+HashType mix(HashType h)
+{
+    h = (h ^ (h >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+    h = (h ^ (h >> 27)) * UINT64_C(0x94d049bb133111eb);
+    return h ^ (h >> 31);
+}
+
+HashType hashBytes(std::uint8_t const* data, std::size_t size, HashType seed)
+{
+    auto h = mix(seed ^ size);
+    std::size_t offset = 0;
+    for (; offset + sizeof(std::uint64_t) <= size; offset += sizeof(std::uint64_t))
+    {
+        std::uint64_t word;
+        std::memcpy(&word, data + offset, sizeof(word));
+        h = mix(h ^ word) + UINT64_C(0x9e3779b97f4a7c15);
+    }
+    if (offset < size)
+    {
+        std::uint64_t word = 0;
+        std::memcpy(&word, data + offset, size - offset);
+        h = mix(h ^ word) + UINT64_C(0x9e3779b97f4a7c15);
+    }
+    return mix(h);
+}
+
+} // namespace
+
+std::vector<HashType> PromptEmbeddingCache::hashRows(ITensor const& table)
+{
+    TLLM_CHECK_WITH_INFO(table.getMemoryType() != MemoryType::kGPU, "The prompt embedding table must be on the host");
+    auto const& shape = table.getShape();
+    TLLM_CHECK(shape.nbDims >= 2);
+    auto const hiddenSize = static_cast<std::size_t>(shape.d[shape.nbDims - 1]);
+    auto const numRows = hiddenSize == 0 ? 0 : table.getSize() / hiddenSize;
+    auto const rowBytes = table.getSizeInBytes() / std::max<std::size_t>(numRows, 1);
+    // The data type is part of the row hash, the same bits in another type are another embedding.
+    auto const seed = static_cast<HashType>(table.getDataType()) + 1;
+
+    auto const* data = static_cast<std::uint8_t const*>(table.data());
+    std::vector<HashType> rowHashes(numRows);
+    for (std::size_t ri = 0; ri < numRows; ++ri)
+    {
+        auto const h = hashBytes(data + ri * rowBytes, rowBytes, seed);
+        rowHashes[ri] = h == 0 ? 1 : h;
+    }
+    return rowHashes;
+}
+
+HashType PromptEmbeddingCache::hashTable(std::vector<HashType> const& rowHashes)
+{
+    return hashBytes(reinterpret_cast<std::uint8_t const*>(rowHashes.data()), rowHashes.size() * sizeof(HashType),
+        /* seed */ 0);
+}
+
+VecTokenExtraIds PromptEmbeddingCache::makeExtraIds(
+    std::vector<TokenIdType> const& inputTokens, SizeType32 vocabSize, std::vector<HashType> const& rowHashes)
+{
+    VecTokenExtraIds extraIds(inputTokens.size(), 0);
+    for (std::size_t ti = 0; ti < inputTokens.size(); ++ti)
+    {
+        auto const row = inputTokens[ti] - vocabSize;
+        if (row >= 0)
+        {
+            TLLM_CHECK_WITH_INFO(static_cast<std::size_t>(row) < rowHashes.size(),
+                "Prompt tuning token %d is out of the embedding table of %lu rows", inputTokens[ti], rowHashes.size());
+            extraIds[ti] = rowHashes[row];
+        }
+    }
+    return extraIds;
+}
+
+PromptEmbeddingCache::PromptEmbeddingCache(std::size_t maxBytes, BufferManager bufferManager)
+    : mMaxBytes{maxBytes}
+    , mBufferManager{std::move(bufferManager)}
+{
+}
+
+PromptEmbeddingCache::TensorPtr PromptEmbeddingCache::acquire(
+    ITensor const& hostTable, std::vector<HashType> const& rowHashes)
+{
+    // The shape is hashed with the rows, so that a table of the same rows split differently is another table.
+    auto hashes = rowHashes;
+    auto const& shape = hostTable.getShape();
+    for (SizeType32 di = 0; di < shape.nbDims; ++di)
+    {
+        hashes.push_back(static_cast<HashType>(shape.d[di]));
+    }
+    auto const hash = hashTable(hashes);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (auto const it = mIndex.find(hash); it != mIndex.end())
+    {
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        ++mStats.numHits;
+        return it->second->table;
+    }
+
+    ++mStats.numMisses;
+    TensorPtr table = mBufferManager.copyFrom(hostTable, MemoryType::kGPU);
+    mStats.usedBytes += table->getSizeInBytes();
+    mEntries.push_front(Entry{hash, table});
+    mIndex.emplace(hash, mEntries.begin());
+    evict();
+    return table;
+}
+
+void PromptEmbeddingCache::evict()
+{
+    auto it = mEntries.end();
+    while (mStats.usedBytes > mMaxBytes && it != mEntries.begin())
+    {
+        --it;
+        // Tables held by requests stay, the cache only owns a reference to them.
+        if (it->table.use_count() > 1)
+        {
+            continue;
+        }
+        TLLM_LOG_DEBUG("Evicting prompt embedding table %lx", it->hash);
+        mStats.usedBytes -= it->table->getSizeInBytes();
+        ++mStats.numEvictions;
+        mIndex.erase(it->hash);
+        it = mEntries.erase(it);
+    }
+}
+
+PromptEmbeddingCache::Stats PromptEmbeddingCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
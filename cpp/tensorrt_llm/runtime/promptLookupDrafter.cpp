@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/promptLookupDrafter.h"
+#include "tensorrt_llm/common/assert.h"
+
+#include <algorithm>
+
+namespace tensorrt_llm::runtime
+{
+
+PromptLookupDrafter::PromptLookupDrafter(SizeType32 maxDraftLen, SizeType32 maxNgramSize, SizeType32 minNgramSize)
+    : mMaxDraftLen{maxDraftLen}
+    , mMaxNgramSize{maxNgramSize}
+    , mMinNgramSize{minNgramSize}
+{
+    TLLM_CHECK_WITH_INFO(maxDraftLen > 0, "maxDraftLen must be positive");
+    TLLM_CHECK_WITH_INFO(minNgramSize > 0 && minNgramSize <= maxNgramSize,
+        "Invalid n-gram sizes [%d, %d] for prompt lookup", minNgramSize, maxNgramSize);
+}
+
+std::uint64_t PromptLookupDrafter::hashNgram(TokenIdType const* begin, SizeType32 ngramSize)
+{
+    // FNV-1a, seeded with the size so that n-grams of different sizes do not share keys.
+    std::uint64_t hash = 14695981039346656037ULL ^ static_cast<std::uint64_t>(ngramSize);
+    for (SizeType32 i = 0; i < ngramSize; ++i)
+    {
+        hash = (hash ^ static_cast<std::uint32_t>(begin[i])) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+void PromptLookupDrafter::update(VecTokens const& tokens)
+{
+    auto const numTokens = static_cast<SizeType32>(tokens.size());
+    TLLM_CHECK_WITH_INFO(numTokens >= mNumIndexed, "Sequence shrank from %d to %d tokens", mNumIndexed, numTokens);
+    // Every token but the first one continues the n-grams ending before it.
+    for (auto pos = std::max(mNumIndexed, SizeType32{1}); pos < numTokens; ++pos)
+    {
+        for (auto ngramSize = mMinNgramSize; ngramSize <= std::min(mMaxNgramSize, pos); ++ngramSize)
+        {
+            mContinuations[hashNgram(tokens.data() + pos - ngramSize, ngramSize)] = pos;
+        }
+    }
+    mNumIndexed = numTokens;
+}
+
+PromptLookupDrafter::VecTokens PromptLookupDrafter::propose(VecTokens const& tokens)
+{
+    update(tokens);
+    auto const numTokens = static_cast<SizeType32>(tokens.size());
+    for (auto ngramSize = std::min(mMaxNgramSize, numTokens); ngramSize >= mMinNgramSize; --ngramSize)
+    {
+        auto const* suffix = tokens.data() + numTokens - ngramSize;
+        auto const it = mContinuations.find(hashNgram(suffix, ngramSize));
+        if (it == mContinuations.end())
+        {
+            continue;
+        }
+        auto const pos = it->second;
+        // Discard hash collisions.
+        if (!std::equal(suffix, suffix + ngramSize, tokens.data() + pos - ngramSize))
+        {
+            continue;
+        }
+        auto const end = std::min(pos + mMaxDraftLen, numTokens);
+        return VecTokens(tokens.begin() + pos, tokens.begin() + end);
+    }
+    return {};
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/ringAttentionRunner.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+#include "tensorrt_llm/kernels/ringAttention.h"
+#include "tensorrt_llm/runtime/ncclCommunicator.h"
+
+using namespace tensorrt_llm::runtime;
+namespace tk = tensorrt_llm::kernels;
+
+namespace
+{
+
+template <typename T>
+void invokeStep(RingAttentionRunner::AttentionInputs const& inputs, RingAttentionRunner::KvChunk const& chunk,
+    bool causal, bool firstStep, ITensor& stateOut, ITensor& stateLse, CudaStream const& stream)
+{
+    tk::RingAttentionParams<T> params;
+    params.q = bufferCast<T>(*inputs.q);
+    params.qSeqIdx = bufferCast<std::int32_t>(*inputs.qSeqIdx);
+    params.qPositions = bufferCast<std::int32_t>(*inputs.qPositions);
+    params.k = bufferCast<T>(*chunk.k);
+    params.v = bufferCast<T>(*chunk.v);
+    params.kvPositions = bufferCast<std::int32_t>(*chunk.positions);
+    params.kvSeqOffsets = bufferCast<std::int32_t>(*chunk.seqOffsets);
+    params.numQTokens = static_cast<std::int32_t>(inputs.qSeqIdx->getSize());
+    params.batchSize = inputs.batchSize;
+    params.numHeads = inputs.numHeads;
+    params.numKvHeads = inputs.numKvHeads;
+    params.headSize = inputs.headSize;
+    params.causal = causal;
+    params.firstStep = firstStep;
+    params.qScale = inputs.qScale;
+    tk::invokeRingAttentionStep(
+        params, tk::AttentionState{bufferCast<float>(stateOut), bufferCast<float>(stateLse)}, stream.get());
+}
+
+template <typename T>
+void invokeMerge(ITensor const& partOut, ITensor const& partLse, SizeType32 numParts, ITensor& out,
+    SizeType32 headSize, CudaStream const& stream)
+{
+    auto const numRows = static_cast<std::int32_t>(partLse.getSize() / numParts);
+    tk::invokeMergeAttentionStates(bufferCast<float>(partOut), bufferCast<float>(partLse), numParts, numRows,
+        headSize, bufferCast<T>(out), stream.get());
+}
+
+} // namespace
+
+RingAttentionRunner::RingAttentionRunner(
+    std::shared_ptr<NcclCommunicator> cpComm, WorldConfig const& worldConfig, CudaStreamPtr commStream)
+    : mComm{std::move(cpComm)}
+    , mCpRank{worldConfig.getContextParallelRank()}
+    , mCpSize{worldConfig.getContextParallelism()}
+    , mCommStream{std::move(commStream)}
+{
+    TLLM_CHECK_WITH_INFO(mComm != nullptr || mCpSize == 1, "Context parallelism needs a NCCL communicator");
+    TLLM_CHECK(mCommStream != nullptr);
+}
+
+void RingAttentionRunner::step(AttentionInputs const& inputs, KvChunk const& chunk, bool causal, bool firstStep,
+    ITensor& stateOut, ITensor& stateLse, CudaStream const& stream) const
+{
+    switch (inputs.q->getDataType())
+    {
+    case nvinfer1::DataType::kFLOAT:
+        invokeStep<float>(inputs, chunk, causal, firstStep, stateOut, stateLse, stream);
+        break;
+    case nvinfer1::DataType::kHALF:
+        invokeStep<half>(inputs, chunk, causal, firstStep, stateOut, stateLse, stream);
+        break;
+#ifdef ENABLE_BF16
+    case nvinfer1::DataType::kBF16:
+        invokeStep<__nv_bfloat16>(inputs, chunk, causal, firstStep, stateOut, stateLse, stream);
+        break;
+#endif
+    default: TLLM_THROW("Unsupported data type %d for ring attention", static_cast<int>(inputs.q->getDataType()));
+    }
+}
+
+void RingAttentionRunner::mergeStates(ITensor const& partOut, ITensor const& partLse, SizeType32 numParts, ITensor& out,
+    SizeType32 headSize, CudaStream const& stream)
+{
+    switch (out.getDataType())
+    {
+    case nvinfer1::DataType::kFLOAT: invokeMerge<float>(partOut, partLse, numParts, out, headSize, stream); break;
+    case nvinfer1::DataType::kHALF: invokeMerge<half>(partOut, partLse, numParts, out, headSize, stream); break;
+#ifdef ENABLE_BF16
+    case nvinfer1::DataType::kBF16:
+        invokeMerge<__nv_bfloat16>(partOut, partLse, numParts, out, headSize, stream);
+        break;
+#endif
+    default: TLLM_THROW("Unsupported data type %d for ring attention", static_cast<int>(out.getDataType()));
+    }
+}
+
+void RingAttentionRunner::allocateRingBuffers(KvChunk const& localKv, BufferManager const& bufferManager)
+{
+    auto sameShape = [](TensorPtr const& buffer, TensorPtr const& like)
+    {
+        return buffer != nullptr && buffer->getDataType() == like->getDataType()
+            && ITensor::volume(buffer->getShape()) == ITensor::volume(like->getShape());
+    };
+    for (auto& buffer : mRingBuffers)
+    {
+        if (!sameShape(buffer.k, localKv.k) || !sameShape(buffer.positions, localKv.positions)
+            || !sameShape(buffer.seqOffsets, localKv.seqOffsets))
+        {
+            buffer.k = bufferManager.gpu(localKv.k->getShape(), localKv.k->getDataType());
+            buffer.v = bufferManager.gpu(localKv.v->getShape(), localKv.v->getDataType());
+            buffer.positions = bufferManager.gpu(localKv.positions->getShape(), nvinfer1::DataType::kINT32);
+            buffer.seqOffsets = bufferManager.gpu(localKv.seqOffsets->getShape(), nvinfer1::DataType::kINT32);
+        }
+    }
+}
+
+void RingAttentionRunner::prefill(
+    AttentionInputs const& inputs, KvChunk const& localKv, ITensor& out, BufferManager const& bufferManager)
+{
+    NVTX3_FUNC_RANGE();
+    auto const& stream = bufferManager.getStream();
+    auto const numRows = static_cast<SizeType32>(inputs.qSeqIdx->getSize()) * inputs.numHeads;
+    auto stateOut = bufferManager.gpu(ITensor::makeShape({numRows, inputs.headSize}), nvinfer1::DataType::kFLOAT);
+    auto stateLse = bufferManager.gpu(ITensor::makeShape({numRows}), nvinfer1::DataType::kFLOAT);
+    if (mCpSize > 1)
+    {
+        allocateRingBuffers(localKv, bufferManager);
+    }
+
+    auto const nextRank = (mCpRank + 1) % mCpSize;
+    auto const prevRank = (mCpRank + mCpSize - 1) % mCpSize;
+    KvChunk const* current = &localKv;
+    for (SizeType32 si = 0; si < mCpSize; ++si)
+    {
+        auto const hasNext = si + 1 < mCpSize;
+        auto& next = mRingBuffers[si % 2];
+        if (hasNext)
+        {
+            // The buffer received into was read by the previous step, and the local chunk must be written.
+            stream.record(mComputeReady);
+            mCommStream->wait(mComputeReady);
+            NcclCommunicator::groupStart();
+            mComm->send(*current->k, nextRank, *mCommStream);
+            mComm->send(*current->v, nextRank, *mCommStream);
+            mComm->send(*current->positions, nextRank, *mCommStream);
+            mComm->send(*current->seqOffsets, nextRank, *mCommStream);
+            mComm->receive(*next.k, prevRank, *mCommStream);
+            mComm->receive(*next.v, prevRank, *mCommStream);
+            mComm->receive(*next.positions, prevRank, *mCommStream);
+            mComm->receive(*next.seqOffsets, prevRank, *mCommStream);
+            NcclCommunicator::groupEnd();
+            mCommStream->record(mChunkReceived);
+        }
+
+        step(inputs, *current, /* causal */ true, si == 0, *stateOut, *stateLse, stream);
+
+        if (hasNext)
+        {
+            stream.wait(mChunkReceived);
+            current = &next;
+        }
+    }
+    mergeStates(*stateOut, *stateLse, 1, out, inputs.headSize, stream);
+}
+
+void RingAttentionRunner::generation(
+    AttentionInputs const& inputs, KvChunk const& localKv, ITensor& out, BufferManager const& bufferManager)
+{
+    NVTX3_FUNC_RANGE();
+    auto const& stream = bufferManager.getStream();
+    auto const numRows = static_cast<SizeType32>(inputs.qSeqIdx->getSize()) * inputs.numHeads;
+    auto localOut = bufferManager.gpu(ITensor::makeShape({numRows, inputs.headSize}), nvinfer1::DataType::kFLOAT);
+    auto localLse = bufferManager.gpu(ITensor::makeShape({numRows}), nvinfer1::DataType::kFLOAT);
+    // The generation tokens see all the KV tokens of their sequence, the ones after them are not written yet.
+    step(inputs, localKv, /* causal */ false, /* firstStep */ true, *localOut, *localLse, stream);
+    if (mCpSize == 1)
+    {
+        mergeStates(*localOut, *localLse, 1, out, inputs.headSize, stream);
+        return;
+    }
+
+    auto gatheredOut = bufferManager.gpu(
+        ITensor::makeShape({mCpSize, numRows, inputs.headSize}), nvinfer1::DataType::kFLOAT);
+    auto gatheredLse = bufferManager.gpu(ITensor::makeShape({mCpSize, numRows}), nvinfer1::DataType::kFLOAT);
+    NcclCommunicator::groupStart();
+    mComm->allGather(*localOut, *gatheredOut, stream);
+    mComm->allGather(*localLse, *gatheredLse, stream);
+    NcclCommunicator::groupEnd();
+    mergeStates(*gatheredOut, *gatheredLse, mCpSize, out, inputs.headSize, stream);
+}
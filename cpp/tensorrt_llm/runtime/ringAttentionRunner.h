@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/worldConfig.h"
+
+#include <array>
+#include <memory>
+
+namespace tensorrt_llm::runtime
+{
+
+class NcclCommunicator;
+
+//! \brief Attention of a context parallel group whose ranks each hold a slice of the prompts and of their KV cache.
+//! \details For the prefill, the KV chunks circulate around the ring of the group: at step s, a rank attends its
+//! queries to the chunk of rank (rank - s) mod cpSize while it sends that chunk to the next rank and receives the one
+//! of step s + 1 on the communication stream. For the generation, every rank attends the generation tokens to its own
+//! KV tokens and the softmax states of the ranks are gathered and merged, so that the KV cache of a sequence never
+//! has to fit in a single GPU.
+//!
+//! The communicator spans the context parallel group, with the context parallel rank as its rank. The KV chunks of
+//! all ranks have the same capacity, see batch_manager::ContextParallelKvPlanner::getMaxLocalContextTokens, since
+//! every NCCL transfer moves the whole chunk.
+class RingAttentionRunner
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+    using CudaStreamPtr = std::shared_ptr<CudaStream>;
+
+    //! \brief The KV tokens of a rank, on the device.
+    struct KvChunk
+    {
+        //! \brief [maxKvTokens, numKvHeads, headSize].
+        TensorPtr k;
+        TensorPtr v;
+        //! \brief Position of every token in its sequence [maxKvTokens], int32.
+        TensorPtr positions;
+        //! \brief Tokens of sequence s are [seqOffsets[s], seqOffsets[s + 1]) [batchSize + 1], int32.
+        TensorPtr seqOffsets;
+    };
+
+    struct AttentionInputs
+    {
+        //! \brief Queries after the rotary embedding [numQTokens, numHeads, headSize], sorted by sequence.
+        TensorPtr q;
+        //! \brief Sequence and position of every query [numQTokens], int32.
+        TensorPtr qSeqIdx;
+        TensorPtr qPositions;
+        SizeType32 batchSize{0};
+        SizeType32 numHeads{0};
+        SizeType32 numKvHeads{0};
+        SizeType32 headSize{0};
+        float qScale{1.f};
+    };
+
+    RingAttentionRunner(std::shared_ptr<NcclCommunicator> cpComm, WorldConfig const& worldConfig,
+        CudaStreamPtr commStream);
+
+    //! \brief Causal attention of the local prompt slices to the prompts of all ranks, into out [numQTokens,
+    //! numHeads, headSize] of the type of the queries. Enqueued on the stream of bufferManager.
+    void prefill(
+        AttentionInputs const& inputs, KvChunk const& localKv, ITensor& out, BufferManager const& bufferManager);
+
+    //! \brief Attention of the generation tokens, the same on all ranks, to the KV tokens of all ranks.
+    void generation(
+        AttentionInputs const& inputs, KvChunk const& localKv, ITensor& out, BufferManager const& bufferManager);
+
+private:
+    //! \brief Attend to a chunk and merge it into the state.
+    void step(AttentionInputs const& inputs, KvChunk const& chunk, bool causal, bool firstStep, ITensor& stateOut,
+        ITensor& stateLse, CudaStream const& stream) const;
+
+    static void mergeStates(ITensor const& partOut, ITensor const& partLse, SizeType32 numParts, ITensor& out,
+        SizeType32 headSize, CudaStream const& stream);
+
+    //! \brief Allocate the receive buffers of the ring like the local chunk.
+    void allocateRingBuffers(KvChunk const& localKv, BufferManager const& bufferManager);
+
+    std::shared_ptr<NcclCommunicator> mComm;
+    SizeType32 mCpRank;
+    SizeType32 mCpSize;
+    CudaStreamPtr mCommStream;
+    CudaEvent mComputeReady;
+    CudaEvent mChunkReceived;
+    std::array<KvChunk, 2> mRingBuffers;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -17,6 +17,7 @@
 
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/common/memoryUtils.h"
+#include "tensorrt_llm/common/pdlUtils.cuh"
 #include "tensorrt_llm/common/reduceKernelUtils.cuh"
 #include "tensorrt_llm/kernels/speculativeDecoding/kvCacheUpdateKernels.h"
 #include "tensorrt_llm/runtime/runtimeKernels.h"
@@ -77,6 +78,9 @@ namespace
 template <typename T>
 __global__ void fillBatch(T* data, std::int32_t const* indices, std::size_t size, T const* values)
 {
+    tc::pdlWaitPrimaryGrid();
+    tc::pdlLaunchDependents();
+
     auto const batchIdx = indices[blockIdx.y];
     const T value = values[blockIdx.y];
     auto const tidx = static_cast<std::size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
@@ -105,7 +109,7 @@ void invokeFillBatch(IBuffer& buffer, IBuffer const& slotIndices, std::size_t sl
     std::size_t const gridMax{std::numeric_limits<std::uint32_t>::max()};
     dim3 const gridSize{static_cast<std::uint32_t>(std::min(gridx, gridMax)), static_cast<std::uint32_t>(numSlots)};
 
-    fillBatch<<<gridSize, blockSize, 0, stream.get()>>>(data, indices, size, fillValues);
+    tc::launchWithPdl(fillBatch<T>, gridSize, blockSize, 0, stream.get(), data, indices, size, fillValues);
 }
 
 // template instantiation
@@ -120,6 +124,10 @@ __global__ void copyBatch(uint8_t const* srcData, uint8_t* dstData, SizeType64 c
     SizeType64 const* dstOffsets, SizeType64 const* sizes, SizeType64 const dataTypeSize)
 {
     constexpr auto VEC_ELTS = static_cast<int32_t>(sizeof(VecT));
+
+    tc::pdlWaitPrimaryGrid();
+    tc::pdlLaunchDependents();
+
     SizeType64 const srcStartIdx = srcOffsets[blockIdx.y] * dataTypeSize;
     SizeType64 const dstStartIdx = dstOffsets[blockIdx.y] * dataTypeSize;
     SizeType64 const size = sizes[blockIdx.y] * dataTypeSize;
@@ -177,8 +185,8 @@ void invokeCopyBatch(IBuffer const& srcBuffer, IBuffer& dstBuffer, IBuffer const
     std::size_t const gridx{tc::ceilDiv(copyRowSizeInBytes / vectorSize, blockSize.x)};
     std::size_t const gridMax{std::numeric_limits<std::uint32_t>::max()};
     dim3 const gridSize{static_cast<std::uint32_t>(std::min(gridx, gridMax)), static_cast<std::uint32_t>(numSlots)};
-    copyBatchInvocation<<<gridSize, blockSize, 0, stream.get()>>>(
-        srcDataPtr, dstDataPtr, srcOffsetsPtr, dstOffsetsPtr, sizesPtr, static_cast<SizeType64>(dataTypeSize));
+    tc::launchWithPdl(copyBatchInvocation, gridSize, blockSize, 0, stream.get(), srcDataPtr, dstDataPtr, srcOffsetsPtr,
+        dstOffsetsPtr, sizesPtr, static_cast<SizeType64>(dataTypeSize));
 }
 
 namespace
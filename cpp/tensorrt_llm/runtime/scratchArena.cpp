@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/scratchArena.h"
+#include "tensorrt_llm/common/assert.h"
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+std::size_t alignSize(std::size_t size)
+{
+    return (size + ScratchArena::kAlignment - 1) / ScratchArena::kAlignment * ScratchArena::kAlignment;
+}
+} // namespace
+
+void* ScratchArena::allocate(std::size_t size)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const alignedSize = alignSize(size);
+    mRequested += alignedSize;
+    if (!mSlab || mOffset + alignedSize > mSlab->getSizeInBytes())
+    {
+        return nullptr;
+    }
+    auto* ptr = static_cast<std::uint8_t*>(mSlab->data()) + mOffset;
+    mOffset += alignedSize;
+    return ptr;
+}
+
+std::optional<std::size_t> ScratchArena::reset()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const requested = mRequested;
+    mOffset = 0;
+    mRequested = 0;
+    if (requested > (mSlab ? mSlab->getSizeInBytes() : 0))
+    {
+        return requested;
+    }
+    return std::nullopt;
+}
+
+void ScratchArena::setSlab(IBuffer::SharedPtr slab)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    TLLM_CHECK_WITH_INFO(mOffset == 0, "The scratch slab cannot be replaced while %zu bytes are allocated", mOffset);
+    mSlab = std::move(slab);
+}
+
+std::size_t ScratchArena::getCapacity() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mSlab ? mSlab->getSizeInBytes() : 0;
+}
+
+std::size_t ScratchArena::getUsed() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mOffset;
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/iBuffer.h"
+
+#include <cstddef>
+#include <mutex>
+#include <optional>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Bump allocator over one device slab for the transient buffers of a step. The allocations are released
+//! together by `reset`, so that they cost no call to the allocator and get the same addresses in every step with the
+//! same sequence of allocations, which the captured CUDA graphs rely on.
+class ScratchArena
+{
+public:
+    static std::size_t constexpr kAlignment{256};
+
+    //! \brief Returns `size` bytes of the slab, nullptr if they do not fit. The requests that do not fit still count
+    //! for the size of the slab needed by the step.
+    [[nodiscard]] void* allocate(std::size_t size);
+
+    //! \brief Releases all the allocations. Returns the slab size needed by the released step if the current slab was
+    //! too small for it.
+    [[nodiscard]] std::optional<std::size_t> reset();
+
+    //! \brief Replaces the slab, which must not be in use.
+    void setSlab(IBuffer::SharedPtr slab);
+
+    [[nodiscard]] std::size_t getCapacity() const;
+
+    [[nodiscard]] std::size_t getUsed() const;
+
+private:
+    mutable std::mutex mMutex;
+    IBuffer::SharedPtr mSlab;
+    // Bytes allocated in the slab.
+    std::size_t mOffset{0};
+    // Bytes requested since the last reset, including the requests that did not fit.
+    std::size_t mRequested{0};
+};
+
+} // namespace tensorrt_llm::runtime
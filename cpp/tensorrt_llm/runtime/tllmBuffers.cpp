@@ -25,6 +25,13 @@ typename PoolAllocator<TAllocator>::PoolType& PoolAllocator<TAllocator>::getPool
     return pool;
 }
 
+template <typename TAllocator>
+typename SizeClassPoolAllocator<TAllocator>::PoolType& SizeClassPoolAllocator<TAllocator>::getPool()
+{
+    static PoolType pool;
+    return pool;
+}
+
 IpcNvlsTensorView::IpcNvlsTensorView(std::weak_ptr<IpcNvlsTensor> const& tensor, bool unicastView)
     : mTensor(tensor)
     , mUnicastView(unicastView)
@@ -114,4 +121,5 @@ MemoryType IpcNvlsTensorView::getMemoryType() const
 
 // explicit instantiations
 template class PoolAllocator<PinnedAllocator>;
+template class SizeClassPoolAllocator<PinnedAllocator>;
 } // namespace tensorrt_llm::runtime
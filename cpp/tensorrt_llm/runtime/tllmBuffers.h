@@ -19,6 +19,7 @@
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/numaUtils.h"
 #include "tensorrt_llm/runtime/cudaMemPool.h"
 #include "tensorrt_llm/runtime/cudaStream.h"
 #include "tensorrt_llm/runtime/iBuffer.h"
@@ -30,12 +31,15 @@
 #include <cuda_runtime_api.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cstdlib>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 namespace tensorrt_llm::runtime
@@ -169,6 +173,8 @@ public:
 protected:
     void allocateImpl(PointerType* ptr, std::size_t n) // NOLINT(readability-convert-member-functions-to-static)
     {
+        // The driver touches the pages when it pins them, so they land on the node preferred by the thread.
+        common::ScopedNumaMemoryPolicy const numaPolicy{common::getNumaBindingNode()};
         TLLM_CUDA_CHECK(::cudaHostAlloc(ptr, n, cudaHostAllocDefault));
     }
 
@@ -500,6 +506,363 @@ protected:
 
 using PinnedPoolAllocator = PoolAllocator<PinnedAllocator>;
 
+/**
+ * A pool segregated by power-of-two size classes, from kAlignment up to kMaxClassSize bytes. Every class carves the
+ * blocks of its slabs and keeps its free blocks behind its own lock, and every thread caches a few free blocks of every
+ * class, so that the threads rarely contend and the blocks of a class never fragment the others. Larger requests are
+ * served by a first-fit MemoryPool. Slabs are only released with the pool. For pinned memory, the used, reserved and
+ * peak bytes are reported to the kPINNEDPOOL counters of MemoryCounters.
+ */
+template <typename TAllocator>
+class SizeClassMemoryPool : public BaseAllocator<SizeClassMemoryPool<TAllocator>, TAllocator::kMemoryType, false>
+{
+    friend class BaseAllocator<SizeClassMemoryPool<TAllocator>, TAllocator::kMemoryType, false>;
+
+public:
+    using Base = BaseAllocator<SizeClassMemoryPool<TAllocator>, TAllocator::kMemoryType, false>;
+    using PointerType = typename Base::PointerType;
+
+    using Allocator = TAllocator;
+    using LargePoolType = MemoryPool<TAllocator>;
+
+    static std::size_t constexpr kAlignment{LargePoolType::kAlignment};
+    static std::size_t constexpr kNumSizeClasses{15};
+    static std::size_t constexpr kMaxClassSize{kAlignment << (kNumSizeClasses - 1)}; // 4 MB
+    static std::size_t constexpr kMinSlabSize{std::size_t{1} << 16};                 // 64 KB
+    static std::size_t constexpr kMaxSlabSize{kMaxClassSize * 2};
+    static std::size_t constexpr kBlocksPerSlab{16};
+    // Bytes of free blocks a thread caches per class, the classes above it are not cached.
+    static std::size_t constexpr kThreadCacheSize{std::size_t{1} << 20}; // 1 MB
+    static std::size_t constexpr kInitialLargeChunkSize{std::size_t{1} << 26}; // 64 MB
+
+    explicit SizeClassMemoryPool(std::size_t largeChunkSize = kInitialLargeChunkSize, Allocator allocator = Allocator{})
+        : mAllocator{allocator}
+        , mLargePool{largeChunkSize, allocator}
+        , mSizeClasses{std::make_shared<SizeClasses>()}
+    {
+    }
+
+    ~SizeClassMemoryPool()
+    {
+        std::size_t numSlabs{0};
+        for (auto& sizeClass : *mSizeClasses)
+        {
+            std::lock_guard<std::mutex> lock(sizeClass.lock);
+            numSlabs += sizeClass.slabs.size();
+            for (auto const& [ptr, size] : sizeClass.slabs)
+            {
+                try
+                {
+                    mAllocator.deallocate(ptr, size);
+                }
+                catch (std::exception const& e)
+                {
+                    TLLM_LOG_EXCEPTION(e);
+                }
+            }
+            sizeClass.slabs.clear();
+            sizeClass.freeBlocks.clear();
+        }
+        TLLM_LOG_DEBUG("SizeClassMemoryPool: Deallocated %zu slabs", numSlabs);
+        if constexpr (kCountPinnedPool)
+        {
+            MemoryCounters::getInstance().releasePinnedPool(mReservedSize);
+        }
+    }
+
+    //! \brief Index of the size class of a request, kNumSizeClasses for the requests of the large pool.
+    [[nodiscard]] static std::size_t getSizeClass(std::size_t size)
+    {
+        std::size_t sizeClass{0};
+        while (sizeClass < kNumSizeClasses && getClassSize(sizeClass) < size)
+        {
+            ++sizeClass;
+        }
+        return sizeClass;
+    }
+
+    [[nodiscard]] static constexpr std::size_t getClassSize(std::size_t sizeClass)
+    {
+        return kAlignment << sizeClass;
+    }
+
+    [[nodiscard]] static constexpr std::size_t getSlabSize(std::size_t sizeClass)
+    {
+        return std::clamp(getClassSize(sizeClass) * kBlocksPerSlab, kMinSlabSize, kMaxSlabSize);
+    }
+
+    //! \brief Bytes requested by the live allocations.
+    [[nodiscard]] std::size_t getUsedSize() const
+    {
+        return mUsedSize;
+    }
+
+    [[nodiscard]] std::size_t getPeakUsedSize() const
+    {
+        return mPeakUsedSize;
+    }
+
+    //! \brief Bytes of the slabs and of the chunks of the large pool.
+    [[nodiscard]] std::size_t getReservedSize() const
+    {
+        return mReservedSize;
+    }
+
+    [[nodiscard]] std::size_t getFragmentedSize() const
+    {
+        std::size_t const reserved = mReservedSize;
+        std::size_t const used = mUsedSize;
+        return reserved > used ? reserved - used : 0;
+    }
+
+    LargePoolType& getLargePool()
+    {
+        return mLargePool;
+    }
+
+protected:
+    void allocateImpl(PointerType* ptr, std::size_t requestedSize);
+
+    void deallocateImpl(PointerType ptr, std::size_t n);
+
+private:
+    static bool constexpr kCountPinnedPool{TAllocator::kMemoryType == MemoryType::kPINNED};
+
+    struct SizeClass
+    {
+        std::mutex mutable lock{};
+        std::vector<PointerType> freeBlocks{};
+        std::vector<std::tuple<PointerType, std::size_t>> slabs{};
+    };
+
+    using SizeClasses = std::array<SizeClass, kNumSizeClasses>;
+    using BlockCache = std::array<std::vector<PointerType>, kNumSizeClasses>;
+
+    [[nodiscard]] static constexpr std::size_t getThreadCacheBlocks(std::size_t sizeClass)
+    {
+        return kThreadCacheSize / getClassSize(sizeClass);
+    }
+
+    // The free blocks a thread caches for every pool it used. A cache outliving its pool is dropped, the blocks of the
+    // others go back to their classes when the thread exits.
+    class ThreadCache
+    {
+    public:
+        ~ThreadCache()
+        {
+            for (auto& [key, entry] : mEntries)
+            {
+                if (auto sizeClasses = entry.sizeClasses.lock())
+                {
+                    for (std::size_t sizeClass = 0; sizeClass < kNumSizeClasses; ++sizeClass)
+                    {
+                        returnBlocks(
+                            (*sizeClasses)[sizeClass], entry.blocks[sizeClass], entry.blocks[sizeClass].size());
+                    }
+                }
+            }
+        }
+
+        BlockCache& get(std::shared_ptr<SizeClasses> const& sizeClasses)
+        {
+            auto& entry = mEntries[sizeClasses.get()];
+            // An expired entry was left by a destroyed pool at the same address.
+            if (entry.sizeClasses.expired())
+            {
+                entry = Entry{sizeClasses, {}};
+            }
+            return entry.blocks;
+        }
+
+    private:
+        struct Entry
+        {
+            std::weak_ptr<SizeClasses> sizeClasses;
+            BlockCache blocks;
+        };
+
+        std::unordered_map<SizeClasses const*, Entry> mEntries;
+    };
+
+    static ThreadCache& getThreadCache()
+    {
+        thread_local ThreadCache cache;
+        return cache;
+    }
+
+    // Moves the last `count` blocks of `blocks` to the free list of the class.
+    static void returnBlocks(SizeClass& sizeClass, std::vector<PointerType>& blocks, std::size_t count)
+    {
+        std::lock_guard<std::mutex> lock(sizeClass.lock);
+        auto const first = blocks.end() - static_cast<std::ptrdiff_t>(count);
+        sizeClass.freeBlocks.insert(sizeClass.freeBlocks.end(), first, blocks.end());
+        blocks.erase(first, blocks.end());
+    }
+
+    // Moves up to `count` free blocks of the class to `blocks`, carving a new slab when the class has none.
+    void takeBlocks(std::size_t sizeClassIdx, std::vector<PointerType>& blocks, std::size_t count);
+
+    void addUsedSize(std::size_t size)
+    {
+        auto const used = mUsedSize += size;
+        auto peak = mPeakUsedSize.load();
+        while (peak < used && !mPeakUsedSize.compare_exchange_weak(peak, used))
+        {
+        }
+        if constexpr (kCountPinnedPool)
+        {
+            MemoryCounters::getInstance().allocate<MemoryType::kPINNEDPOOL>(size);
+        }
+    }
+
+    void addReservedSize(std::size_t size)
+    {
+        mReservedSize += size;
+        if constexpr (kCountPinnedPool)
+        {
+            MemoryCounters::getInstance().reservePinnedPool(size);
+        }
+    }
+
+    TAllocator mAllocator;
+    LargePoolType mLargePool;
+    std::shared_ptr<SizeClasses> mSizeClasses;
+    // Reserved size of the large pool accounted in mReservedSize, the large pool never releases its chunks.
+    std::atomic<std::size_t> mLargeReservedSize{0};
+    std::atomic<std::size_t> mUsedSize{0};
+    std::atomic<std::size_t> mPeakUsedSize{0};
+    std::atomic<std::size_t> mReservedSize{0};
+};
+
+template <typename TAllocator>
+void SizeClassMemoryPool<TAllocator>::takeBlocks(
+    std::size_t sizeClassIdx, std::vector<PointerType>& blocks, std::size_t count)
+{
+    auto& sizeClass = (*mSizeClasses)[sizeClassIdx];
+    std::lock_guard<std::mutex> lock(sizeClass.lock);
+    if (sizeClass.freeBlocks.empty())
+    {
+        auto const classSize = getClassSize(sizeClassIdx);
+        auto const slabSize = getSlabSize(sizeClassIdx);
+        TLLM_LOG_DEBUG("SizeClassMemoryPool: Allocating a slab of %zu B for blocks of %zu B", slabSize, classSize);
+        auto* slab = static_cast<std::uint8_t*>(mAllocator.allocate(slabSize));
+        sizeClass.slabs.emplace_back(slab, slabSize);
+        addReservedSize(slabSize);
+        // In reverse, so that the lowest blocks are taken first.
+        for (auto offset = slabSize; offset >= classSize; offset -= classSize)
+        {
+            sizeClass.freeBlocks.push_back(slab + offset - classSize);
+        }
+    }
+    auto const taken = std::min(count, sizeClass.freeBlocks.size());
+    auto const first = sizeClass.freeBlocks.end() - static_cast<std::ptrdiff_t>(taken);
+    blocks.insert(blocks.end(), first, sizeClass.freeBlocks.end());
+    sizeClass.freeBlocks.erase(first, sizeClass.freeBlocks.end());
+}
+
+template <typename TAllocator>
+void SizeClassMemoryPool<TAllocator>::allocateImpl(PointerType* ptr, std::size_t requestedSize)
+{
+    auto const sizeClass = getSizeClass(requestedSize);
+    if (sizeClass == kNumSizeClasses)
+    {
+        *ptr = mLargePool.allocate(requestedSize);
+        // The large pool only grows, account the growth once.
+        auto const largeReserved = mLargePool.getReservedSize();
+        auto accounted = mLargeReservedSize.load();
+        while (accounted < largeReserved && !mLargeReservedSize.compare_exchange_weak(accounted, largeReserved))
+        {
+        }
+        if (accounted < largeReserved)
+        {
+            addReservedSize(largeReserved - accounted);
+        }
+        addUsedSize(requestedSize);
+        return;
+    }
+
+    auto const cacheBlocks = getThreadCacheBlocks(sizeClass);
+    if (cacheBlocks == 0)
+    {
+        std::vector<PointerType> blocks;
+        takeBlocks(sizeClass, blocks, 1);
+        *ptr = blocks.back();
+    }
+    else
+    {
+        auto& blocks = getThreadCache().get(mSizeClasses)[sizeClass];
+        if (blocks.empty())
+        {
+            // Refill half of the cache, so that a thread alternating allocations and frees stays in its cache.
+            takeBlocks(sizeClass, blocks, std::max(cacheBlocks / 2, std::size_t{1}));
+        }
+        *ptr = blocks.back();
+        blocks.pop_back();
+    }
+    addUsedSize(requestedSize);
+}
+
+template <typename TAllocator>
+void SizeClassMemoryPool<TAllocator>::deallocateImpl(PointerType ptr, std::size_t n)
+{
+    TLLM_CHECK_WITH_INFO(ptr != nullptr, "SizeClassMemoryPool free: Requested to free a null pointer");
+    mUsedSize -= n;
+    if constexpr (kCountPinnedPool)
+    {
+        MemoryCounters::getInstance().deallocate<MemoryType::kPINNEDPOOL>(n);
+    }
+
+    auto const sizeClass = getSizeClass(n);
+    if (sizeClass == kNumSizeClasses)
+    {
+        mLargePool.deallocate(ptr, n);
+        return;
+    }
+
+    auto const cacheBlocks = getThreadCacheBlocks(sizeClass);
+    if (cacheBlocks == 0)
+    {
+        std::vector<PointerType> blocks{ptr};
+        returnBlocks((*mSizeClasses)[sizeClass], blocks, 1);
+        return;
+    }
+    auto& blocks = getThreadCache().get(mSizeClasses)[sizeClass];
+    blocks.push_back(ptr);
+    if (blocks.size() > cacheBlocks)
+    {
+        // Give half of the cache back, so that the other threads can reuse the blocks freed by this one.
+        returnBlocks((*mSizeClasses)[sizeClass], blocks, blocks.size() / 2);
+    }
+}
+
+template <typename TAllocator>
+class SizeClassPoolAllocator
+    : public BaseAllocator<SizeClassPoolAllocator<TAllocator>, TAllocator::kMemoryType, false>
+{
+    friend class BaseAllocator<SizeClassPoolAllocator<TAllocator>, TAllocator::kMemoryType, false>;
+
+public:
+    using Base = BaseAllocator<SizeClassPoolAllocator<TAllocator>, TAllocator::kMemoryType, false>;
+    using PointerType = typename Base::PointerType;
+    using PoolType = SizeClassMemoryPool<TAllocator>;
+
+    static PoolType& getPool();
+
+protected:
+    void allocateImpl(PointerType* ptr, std::size_t n) // NOLINT(readability-convert-member-functions-to-static)
+    {
+        *ptr = getPool().allocate(n);
+    }
+
+    void deallocateImpl( // NOLINT(readability-convert-member-functions-to-static)
+        typename TAllocator::PointerType ptr, std::size_t n)
+    {
+        getPool().deallocate(ptr, n);
+    }
+};
+
+using PinnedSizeClassPoolAllocator = SizeClassPoolAllocator<PinnedAllocator>;
+
 // Adopted from https://github.com/NVIDIA/TensorRT/blob/release/8.6/samples/common/buffers.h
 
 //!
@@ -818,6 +1181,7 @@ using StaticDeviceBuffer = GenericBuffer<CudaAllocator>;
 using HostBuffer = GenericBuffer<HostAllocator>;
 using PinnedBuffer = GenericBuffer<PinnedAllocator>;
 using PinnedPoolBuffer = GenericBuffer<PinnedPoolAllocator>;
+using PinnedSizeClassPoolBuffer = GenericBuffer<PinnedSizeClassPoolAllocator>;
 using UVMBuffer = GenericBuffer<UVMAllocator>;
 
 template <typename T>
@@ -1046,6 +1410,7 @@ using StaticDeviceTensor = GenericTensor<CudaAllocator>;
 using HostTensor = GenericTensor<HostAllocator>;
 using PinnedTensor = GenericTensor<PinnedAllocator>;
 using PinnedPoolTensor = GenericTensor<PinnedPoolAllocator>;
+using PinnedSizeClassPoolTensor = GenericTensor<PinnedSizeClassPoolAllocator>;
 using UVMTensor = GenericTensor<UVMAllocator>;
 
 } // namespace tensorrt_llm::runtime
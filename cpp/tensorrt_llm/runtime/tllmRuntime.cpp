@@ -17,22 +17,33 @@
 #include "common.h"
 #include "nlohmann/json.hpp"
 #include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/iterationTimeline.h"
 #include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/memoryMappedFile.h"
 #include "tensorrt_llm/common/mpiUtils.h"
 #include "tensorrt_llm/common/nvtxUtils.h"
 #include "tensorrt_llm/common/safetensors.h"
+#include "tensorrt_llm/common/startupTrace.h"
 #include "tensorrt_llm/executor/tensor.h"
 #include "tensorrt_llm/kernels/userbuffers/ub_interface.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/kernelSampler.h"
+#include "tensorrt_llm/runtime/weightStreamLoader.h"
 #include "tllmLogger.h"
 
 #include <NvInferRuntime.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
+#include <cstring>
 #include <iterator>
 #include <limits>
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -73,34 +84,72 @@ std::vector<std::size_t> dimsToShape(nvinfer1::Dims const& dims)
 
 tensorrt_llm::runtime::TllmLogger defaultLogger{};
 
-class StreamReader final : public nvinfer1::IStreamReader
+//! \brief Streams the engine to TensorRT from a memory mapping of the file.
+//! \details A background thread prefetches the file in windows ahead of the reader from several threads, so file IO
+//! overlaps with deserialization. Pages behind the reader are dropped from the mapping, so the engine is never held
+//! in host memory twice.
+class MappedStreamReader final : public nvinfer1::IStreamReader
 {
 public:
-    StreamReader(std::filesystem::path fp)
+    MappedStreamReader(std::filesystem::path const& fp, std::size_t numThreads)
+        : mFile{fp.string(), tensorrt_llm::common::MemoryMappedFile::Mode::kREAD_ONLY}
     {
-        mFile.open(fp.string(), std::ios::binary | std::ios::in);
-        TLLM_CHECK_WITH_INFO(mFile.good(), std::string("Error opening engine file: " + fp.string()));
+        mFile.advise(tensorrt_llm::common::MemoryMappedFile::Advice::kSEQUENTIAL);
+        if (numThreads > 0)
+        {
+            mPrefetcher = std::thread([this, numThreads] { prefetchAhead(numThreads); });
+        }
     }
 
-    virtual ~StreamReader()
+    ~MappedStreamReader() final
     {
-        if (mFile.is_open())
+        mStop = true;
+        if (mPrefetcher.joinable())
         {
-            mFile.close();
+            mPrefetcher.join();
         }
     }
 
+    MappedStreamReader(MappedStreamReader const&) = delete;
+    MappedStreamReader& operator=(MappedStreamReader const&) = delete;
+
     int64_t read(void* destination, int64_t nbBytes) final
     {
-        if (!mFile.good())
+        auto const pos = mPos.load(std::memory_order_relaxed);
+        auto const numBytes = std::min(static_cast<std::size_t>(std::max<int64_t>(nbBytes, 0)), mFile.size() - pos);
+        std::memcpy(destination, mFile.data() + pos, numBytes);
+        mPos.store(pos + numBytes, std::memory_order_relaxed);
+        if (pos + numBytes - mReleasedPos >= kWindowSize)
+        {
+            mFile.advise(tensorrt_llm::common::MemoryMappedFile::Advice::kDONT_NEED, mReleasedPos,
+                pos + numBytes - mReleasedPos);
+            mReleasedPos = pos + numBytes;
+        }
+        return static_cast<int64_t>(numBytes);
+    }
+
+private:
+    static constexpr std::size_t kWindowSize{std::size_t{256} << 20};
+    static constexpr std::size_t kMaxPrefetchDistance{std::size_t{8} * kWindowSize};
+
+    void prefetchAhead(std::size_t numThreads)
+    {
+        for (std::size_t offset = 0; offset < mFile.size() && !mStop; offset += kWindowSize)
         {
-            return -1;
+            // Do not run so far ahead that prefetched pages are evicted before they are read.
+            while (!mStop && offset > mPos.load(std::memory_order_relaxed) + kMaxPrefetchDistance)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            mFile.prefetch(offset, std::min(kWindowSize, mFile.size() - offset), numThreads);
         }
-        mFile.read(static_cast<char*>(destination), nbBytes);
-        return mFile.gcount();
     }
 
-    std::ifstream mFile;
+    tensorrt_llm::common::MemoryMappedFile mFile;
+    std::atomic<std::size_t> mPos{0};
+    std::size_t mReleasedPos{0};
+    std::atomic<bool> mStop{false};
+    std::thread mPrefetcher;
 };
 
 void setWeightStreaming(nvinfer1::ICudaEngine& engine, float const gpuWeightsPercent)
@@ -216,24 +265,31 @@ TllmRuntime::TllmRuntime(
     , mBufferManager{mStream, true} // Ensure to trim the memory pool on destruction.
     , mRuntime{nvinfer1::createInferRuntime(static_cast<bool>(logger) ? *logger : defaultLogger)}
     , mUseShapeInference{useShapeInference}
+    , mGpuWeightsPercent{gpuWeightsPercent}
     , mUserBufferEnabled{false}
+    , mLogger{static_cast<bool>(logger) ? logger : &defaultLogger}
 {
-    switch (rawEngine.getType())
-    {
-    case RawEngine::Type::FilePath:
     {
-        auto reader = StreamReader(rawEngine.getPath());
-        mEngine.reset(mRuntime->deserializeCudaEngine(reader));
-        break;
-    }
-    case RawEngine::Type::AddressWithSize:
-        mEngine.reset(mRuntime->deserializeCudaEngine(rawEngine.getAddress(), rawEngine.getSize()));
-        break;
-    case RawEngine::Type::HostMemory:
-        mEngine.reset(
-            mRuntime->deserializeCudaEngine(rawEngine.getHostMemory()->data(), rawEngine.getHostMemory()->size()));
-        break;
-    default: TLLM_THROW("Unsupported raw engine type.");
+        TLLM_STARTUP_PHASE("engine_deserialize");
+        switch (rawEngine.getType())
+        {
+        case RawEngine::Type::FilePath:
+        {
+            MappedStreamReader reader{rawEngine.getPath(), common::getEnvEngineLoadThreads()};
+            mEngine.reset(mRuntime->deserializeCudaEngine(reader));
+            break;
+        }
+        case RawEngine::Type::AddressWithSize:
+            mEngine.reset(mRuntime->deserializeCudaEngine(rawEngine.getAddress(), rawEngine.getSize()));
+            break;
+        case RawEngine::Type::HostMemory:
+        {
+            auto const& hostMemory = *rawEngine.getHostMemory();
+            mEngine.reset(mRuntime->deserializeCudaEngine(hostMemory.data(), hostMemory.size()));
+            break;
+        }
+        default: TLLM_THROW("Unsupported raw engine type.");
+        }
     }
 
     TLLM_CHECK_WITH_INFO(mEngine != nullptr, "Failed to deserialize cuda engine.");
@@ -241,7 +297,10 @@ TllmRuntime::TllmRuntime(
     assessLikelihoodOfRuntimeAllocation(*mEngine, *mEngineInspector);
     setWeightStreaming(getEngine(), gpuWeightsPercent);
     auto const devMemorySize = mEngine->getDeviceMemorySizeV2();
-    mEngineBuffer = mBufferManager.gpu(devMemorySize);
+    {
+        TLLM_STARTUP_PHASE("execution_context_memory");
+        mEngineBuffer = mBufferManager.gpu(devMemorySize);
+    }
     // Print context memory size for CI/CD to track.
     TLLM_LOG_INFO("[MemUsageChange] Allocated %.2f MiB for execution context memory.",
         static_cast<double>(devMemorySize) / 1048576.0);
@@ -500,9 +559,33 @@ void TllmRuntime::clearContexts()
 bool TllmRuntime::executeContext(SizeType32 contextIndex) const
 {
     NVTX3_FUNC_RANGE();
+    TLLM_TIMELINE_SCOPE("engine_enqueue");
+    KernelSampler::ScopedRegion const kernelSamplerRegion("engine");
     auto& context = getContext(contextIndex);
+    nvinfer1::IProfiler* streamingProfiler{nullptr};
+    if (mWeightStreamingScheduler)
+    {
+        mWeightStreamingScheduler->bind(contextIndex, context);
+        // A step profiled with the layer profiler is not measured for weight streaming.
+        if (context.getProfiler() == nullptr)
+        {
+            streamingProfiler = mWeightStreamingScheduler->getProfiler();
+            if (streamingProfiler != nullptr)
+            {
+                context.setProfiler(streamingProfiler);
+            }
+        }
+    }
     auto res = context.enqueueV3(mStream->get());
     sync_check_cuda_error();
+    if (mWeightStreamingScheduler)
+    {
+        if (streamingProfiler != nullptr)
+        {
+            context.setProfiler(nullptr);
+        }
+        mWeightStreamingScheduler->onStepEnqueued(*mStream);
+    }
     return res;
 }
 
@@ -683,32 +766,28 @@ void TllmRuntime::setUserBufferTensors(SizeType32 contextIndex, TensorMap& tenso
     auto& context = getContext(contextIndex);
     for (auto const& name : mOutputTensorNames)
     {
-        auto const pos = tensorMap.find(name);
-        if (pos != tensorMap.end() || !startsWith(name, prefix))
+        if (!startsWith(name, prefix))
         {
             continue;
         }
         auto const engineDtype = mEngine->getTensorDataType(name.c_str());
         auto const dims = context.getTensorShape(name.c_str());
-        void* ubBuffer = nullptr;
-        if (name[prefix.size()] == '0')
-        {
-            ubBuffer = tensorrt_llm::runtime::ub::ub_get(0).addr;
-        }
-        else if (name[prefix.size()] == '1')
-        {
-            ubBuffer = tensorrt_llm::runtime::ub::ub_get(1).addr;
-        }
-        else if (name[prefix.size()] == '2')
+        int const idx = name[prefix.size()] - '0';
+        TLLM_CHECK_WITH_INFO(idx >= 0 && idx <= 2, "Unknown UserBuffer tensor %s", name.c_str());
+        // The buffers follow the shapes of the steps instead of being sized for the max number of tokens: a buffer
+        // grows from the pool when a step needs more, and the tensors are bound again every step since its address
+        // may change. The TP ranks run the same shapes, so they grow their buffers together.
+        auto const bits = static_cast<std::size_t>(ITensor::volume(dims)) * BufferDataType(engineDtype).getSizeInBits();
+        void* ubBuffer = tensorrt_llm::runtime::ub::ub_allocate(idx, std::max<std::size_t>((bits + 7) / 8, 1));
+        auto tensor = ITensor::SharedPtr(ITensor::wrap(ubBuffer, engineDtype, dims));
+        if (auto const pos = tensorMap.find(name); pos != tensorMap.end())
         {
-            ubBuffer = tensorrt_llm::runtime::ub::ub_get(2).addr;
+            pos->second = tensor;
         }
         else
         {
-            TLLM_CHECK(false);
+            tensorMap.emplace(name, tensor);
         }
-        auto tensor = ITensor::SharedPtr(ITensor::wrap(ubBuffer, engineDtype, dims));
-        tensorMap.insert(pos, std::make_pair(name, tensor));
         context.setTensorAddress(name.c_str(), ubBuffer);
     }
 }
@@ -716,22 +795,12 @@ void TllmRuntime::setUserBufferTensors(SizeType32 contextIndex, TensorMap& tenso
 void TllmRuntime::initializeUserBuffer(SizeType32 tpSize, SizeType32 maxBatchSize, SizeType32 maxBeamWidth,
     SizeType32 maxSequenceLength, SizeType32 hiddenSize, std::optional<SizeType32> maxNumTokens)
 {
+    TLLM_STARTUP_PHASE("user_buffer_init");
     auto startsWith = [](std::string const& str, std::string const& prefix) -> bool
     { return str.size() > prefix.size() && str.compare(0, prefix.size(), prefix) == 0; };
     std::string prefix(tensorrt_llm::runtime::ub::tensor_prefix);
-    bool useNVFP4Model = false;
-    for (auto const& name : mOutputTensorNames)
-    {
-        if (startsWith(name, prefix))
-        {
-            mUserBufferEnabled = true;
-            if (name[prefix.size()] == '2')
-            {
-                useNVFP4Model = true;
-                break;
-            }
-        }
-    }
+    mUserBufferEnabled = std::any_of(mOutputTensorNames.begin(), mOutputTensorNames.end(),
+        [&](std::string const& name) { return startsWith(name, prefix); });
     if (!mUserBufferEnabled)
     {
         return;
@@ -740,16 +809,13 @@ void TllmRuntime::initializeUserBuffer(SizeType32 tpSize, SizeType32 maxBatchSiz
     size_t realHiddenSize = hiddenSize * tpSize;
     size_t tokensNum = maxNumTokens.value_or(maxBatchSize * maxBeamWidth * maxSequenceLength);
     TLLM_CHECK(tokensNum > 0);
-    size_t elemNum = tokensNum * realHiddenSize;
-    TLLM_LOG_INFO("[UserBuffer] MaxBatchSize %d, maxBeamWidth %d, maxSequenceLength %d, maxNumTokens %d, select %lu",
-        maxBatchSize, maxBeamWidth, maxSequenceLength, maxNumTokens.has_value() ? maxNumTokens.value() : 0, tokensNum);
+    // The buffers are allocated from the pool of the allocator by setUserBufferTensors, for the shapes of the steps.
+    TLLM_LOG_INFO(
+        "[UserBuffer] MaxBatchSize %d, maxBeamWidth %d, maxSequenceLength %d, maxNumTokens %d, up to %lu bytes per "
+        "buffer",
+        maxBatchSize, maxBeamWidth, maxSequenceLength, maxNumTokens.has_value() ? maxNumTokens.value() : 0,
+        tokensNum * realHiddenSize * sizeof(half));
     tensorrt_llm::runtime::ub::ub_initialize(tpSize);
-    tensorrt_llm::runtime::ub::ub_allocate(0, elemNum * sizeof(half));
-    tensorrt_llm::runtime::ub::ub_allocate(1, elemNum * sizeof(half));
-    if (useNVFP4Model)
-    {
-        tensorrt_llm::runtime::ub::ub_allocate(2, elemNum * sizeof(uint8_t) / 16);
-    }
 }
 
 CudaStream const& TllmRuntime::getStream() const
@@ -786,9 +852,16 @@ void TllmRuntime::reportToProfiler(SizeType32 contextId)
 void TllmRuntime::loadManagedWeights(RawEngine const& rawEngine, int localRank)
 {
     TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
-    NVTX3_FUNC_RANGE();
+    TLLM_STARTUP_PHASE("managed_weights_load");
     auto& engine = getEngine();
     auto& manager = getBufferManager();
+    // Under weight streaming, the weights of the decoder layers are loaded to the host and streamed from there.
+    bool const streamLayers = mGpuWeightsPercent < 1;
+    auto const getMemoryType = [streamLayers](std::string const& name)
+    {
+        return streamLayers && WeightStreamingScheduler::getLayerIdx(name).has_value() ? MemoryType::kPINNED
+                                                                                       : MemoryType::kGPU;
+    };
     if (rawEngine.getManagedWeightsMapOpt().has_value())
     {
         TLLM_LOG_DEBUG("Loading managed weights from raw engine");
@@ -797,7 +870,7 @@ void TllmRuntime::loadManagedWeights(RawEngine const& rawEngine, int localRank)
         {
             TLLM_LOG_DEBUG("Loading managed weight: %s", name.c_str());
             auto iTensor = tensorrt_llm::executor::detail::toITensor(weight);
-            auto weightsDevice = std::shared_ptr<ITensor>{manager.copyFrom(*iTensor, MemoryType::kGPU)};
+            auto weightsDevice = std::shared_ptr<ITensor>{manager.copyFrom(*iTensor, getMemoryType(name))};
             mManagedWeightsMap.insert(std::make_pair(name, weightsDevice));
         }
     }
@@ -809,17 +882,147 @@ void TllmRuntime::loadManagedWeights(RawEngine const& rawEngine, int localRank)
         auto weightPath
             = enginePath->parent_path() / ("rank" + std::to_string(localRank) + "_managed_weights.safetensors");
         auto managed_weights = common::safetensors::ISafeTensor::open(weightPath.string().c_str());
+        WeightStreamLoader::Config loaderConfig;
+        loaderConfig.numWorkers = std::max<std::size_t>(1, common::getEnvEngineLoadThreads());
+        WeightStreamLoader loader{loaderConfig};
         for (auto const& name : managed_weights->keys())
         {
             TLLM_LOG_DEBUG("Loading managed weight: %s", name.c_str());
             auto const weight = managed_weights->getTensor(name.c_str());
             TLLM_CHECK(weight->dtype() == engine.getTensorDataType(name.c_str()));
-            auto weightsDevice
-                = std::shared_ptr<ITensor>{manager.allocate(MemoryType::kGPU, weight->trtDims(), weight->dtype())};
-            manager.copy(weight->data(), *weightsDevice, MemoryType::kCPU);
+            auto weightsDevice = std::shared_ptr<ITensor>{
+                manager.allocate(getMemoryType(name), weight->trtDims(), weight->dtype())};
+            TLLM_CHECK(weightsDevice->getSizeInBytes() == weight->sizeInBytes());
+            loader.add(managed_weights->path(), weight->fileOffset(), weight->sizeInBytes(), weightsDevice->data());
             mManagedWeightsMap.insert(std::make_pair(name, weightsDevice));
         }
+        // The buffers were allocated on the stream of the manager.
+        manager.getStream().synchronize();
+        loader.load();
+    }
+    if (streamLayers)
+    {
+        std::size_t layerWeightsSize{0};
+        for (auto const& [name, weight] : mManagedWeightsMap)
+        {
+            layerWeightsSize += weight->getMemoryType() == MemoryType::kPINNED ? weight->getSizeInBytes() : 0;
+        }
+        mWeightStreamingScheduler = std::make_unique<WeightStreamingScheduler>(mManagedWeightsMap,
+            static_cast<std::size_t>(mGpuWeightsPercent * static_cast<float>(layerWeightsSize)),
+            common::getEnvWeightStreamingProfileInterval(), manager);
+        setStaticInputTensors(mWeightStreamingScheduler->getBindings());
+    }
+    else
+    {
+        setStaticInputTensors(mManagedWeightsMap);
+    }
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
+void TllmRuntime::updateWeights(WeightUpdateMap const& updates)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    TLLM_CHECK_WITH_INFO(
+        mWeightStreamingScheduler == nullptr, "Weights cannot be updated while managed weights are streamed");
+    NVTX3_FUNC_RANGE();
+    // Device to device copies are bound by the bandwidth, the streams only overlap the launches of small weights.
+    std::size_t constexpr kMaxNumCopyStreams{4};
+
+    std::unordered_map<std::string, void*> ipcMappings;
+    auto const closeIpcMappings = [&ipcMappings]()
+    {
+        for (auto const& [key, ptr] : ipcMappings)
+        {
+            TLLM_CUDA_CHECK(cudaIpcCloseMemHandle(ptr));
+        }
+    };
+    auto const getSource = [&ipcMappings](WeightUpdate const& update) -> void const*
+    {
+        if (!update.ipcHandle.has_value())
+        {
+            TLLM_CHECK_WITH_INFO(update.devicePtr != nullptr, "A weight update needs a device pointer or IPC handle");
+            return update.devicePtr;
+        }
+        auto const& handle = update.ipcHandle.value();
+        std::string key(handle.reserved, sizeof(handle.reserved));
+        auto it = ipcMappings.find(key);
+        if (it == ipcMappings.end())
+        {
+            void* ptr{nullptr};
+            TLLM_CUDA_CHECK(cudaIpcOpenMemHandle(&ptr, handle, cudaIpcMemLazyEnablePeerAccess));
+            it = ipcMappings.emplace(std::move(key), ptr).first;
+        }
+        return static_cast<std::uint8_t const*>(it->second) + update.ipcOffset;
+    };
+
+    try
+    {
+        auto const numCopyStreams = std::min(kMaxNumCopyStreams, std::max<std::size_t>(1, updates.size()));
+        std::vector<CudaStream> copyStreams(numCopyStreams);
+        CudaEvent enqueued{};
+        mStream->record(enqueued);
+        for (auto const& copyStream : copyStreams)
+        {
+            copyStream.wait(enqueued);
+        }
+
+        std::unique_ptr<nvinfer1::IRefitter> refitter;
+        std::size_t numCopies{0};
+        for (auto const& [name, update] : updates)
+        {
+            auto const* source = getSource(update);
+            if (auto const managed = mManagedWeightsMap.find(name); managed != mManagedWeightsMap.end())
+            {
+                auto& weight = *managed->second;
+                TLLM_CHECK_WITH_INFO(weight.getDataType() == update.dataType
+                        && weight.getSizeInBytes() == update.sizeInBytes,
+                    "The update of weight %s does not match its type or size", name.c_str());
+                auto const& copyStream = copyStreams[numCopies++ % numCopyStreams];
+                TLLM_CUDA_CHECK(cudaMemcpyAsync(
+                    weight.data(), source, update.sizeInBytes, cudaMemcpyDeviceToDevice, copyStream.get()));
+                continue;
+            }
+            if (!refitter)
+            {
+                refitter.reset(nvinfer1::createInferRefitter(getEngine(), *mLogger));
+                TLLM_CHECK_WITH_INFO(refitter != nullptr && getEngine().isRefittable(),
+                    "Weight %s is built into the engine, which is not refittable", name.c_str());
+            }
+            auto const count = static_cast<std::int64_t>(
+                update.sizeInBytes * 8 / BufferDataType(update.dataType).getSizeInBits());
+            nvinfer1::Weights const weights{update.dataType, source, count};
+            TLLM_CHECK_WITH_INFO(refitter->setNamedWeights(name.c_str(), weights, nvinfer1::TensorLocation::kDEVICE),
+                "Failed to set weight %s for the refit", name.c_str());
+        }
+
+        if (refitter)
+        {
+            auto const numMissing = refitter->getMissingWeights(0, nullptr);
+            if (numMissing > 0)
+            {
+                std::vector<char const*> missing(numMissing);
+                refitter->getMissingWeights(numMissing, missing.data());
+                TLLM_THROW("The refit misses %d weights, e.g. %s, which are combined with the updated ones",
+                    numMissing, missing.front());
+            }
+            TLLM_CHECK_WITH_INFO(refitter->refitCudaEngineAsync(mStream->get()), "Failed to refit the engine");
+        }
+        for (auto const& copyStream : copyStreams)
+        {
+            CudaEvent copied{};
+            copyStream.record(copied);
+            mStream->wait(copied);
+        }
+        mStream->synchronize();
+        TLLM_LOG_INFO("Updated %zu weights, %zu in place and %zu by refit", updates.size(), numCopies,
+            updates.size() - numCopies);
+    }
+    catch (...)
+    {
+        mStream->synchronize();
+        closeIpcMappings();
+        throw;
     }
-    setStaticInputTensors(mManagedWeightsMap);
+    closeIpcMappings();
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
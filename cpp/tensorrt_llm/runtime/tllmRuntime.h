@@ -20,13 +20,17 @@
 #include "tensorrt_llm/runtime/iTensor.h"
 #include "tensorrt_llm/runtime/layerProfiler.h"
 #include "tensorrt_llm/runtime/rawEngine.h"
+#include "tensorrt_llm/runtime/weightStreamingScheduler.h"
 #include "tensorrt_llm/runtime/worldConfig.h"
 #include <NvInferRuntime.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace tensorrt_llm::runtime
@@ -36,6 +40,21 @@ class TllmRuntime
 public:
     using TensorMap = StringPtrMap<ITensor>;
 
+    /// @brief New value of a weight in device memory, of this process or of another one, e.g. a training process.
+    struct WeightUpdate
+    {
+        /// @brief The weight in this process, unused with an IPC handle.
+        void const* devicePtr{nullptr};
+        /// @brief Allocation exported by another process and the offset of the weight in it. The allocations shared
+        /// by several weights are opened once.
+        std::optional<cudaIpcMemHandle_t> ipcHandle;
+        std::size_t ipcOffset{0};
+        nvinfer1::DataType dataType{nvinfer1::DataType::kFLOAT};
+        std::size_t sizeInBytes{0};
+    };
+
+    using WeightUpdateMap = std::unordered_map<std::string, WeightUpdate>;
+
     explicit TllmRuntime(RawEngine const& rawEngine, nvinfer1::ILogger* logger, float gpuWeightsPercent = 1.0f,
         bool useShapeInference = true);
 
@@ -54,6 +73,12 @@ public:
         return static_cast<SizeType32>(mEngine->getNbOptimizationProfiles());
     }
 
+    /// @brief The execution context memory the profile needs, the engine buffer is sized for the largest profile.
+    [[nodiscard]] std::size_t getActivationMemorySize(SizeType32 profileIndex) const
+    {
+        return static_cast<std::size_t>(mEngine->getDeviceMemorySizeForProfileV2(profileIndex));
+    }
+
     /// @brief If multiple TensorRT optimization profiles are built in the engine, this function selects the
     /// corresponding profile that is going to be used based on the runtime shape, for now, TensorRT-LLM only split
     /// multiple profiles on the num_tokens dimension, hence the profile index is selected based on which profile
@@ -133,7 +158,25 @@ public:
     bool hasLayerProfiler(SizeType32 contextId) const;
     std::string getLayerProfileInfo() const;
     void reportToProfiler(SizeType32 contextId);
+    /// @brief Load the weights of the engine that are bound as input tensors.
+    /// @details With gpuWeightsPercent below 1, the managed weights of the decoder layers stay in pinned host memory
+    /// and only the share of them that fits in the percent is kept on the device, see WeightStreamingScheduler.
     void loadManagedWeights(RawEngine const& rawEngine, int localRank);
+
+    /// @brief The scheduler of the managed weights streamed from the host, null when none is.
+    [[nodiscard]] WeightStreamingScheduler const* getWeightStreamingScheduler() const noexcept
+    {
+        return mWeightStreamingScheduler.get();
+    }
+
+    /// @brief Replace weights device to device, without going through host memory.
+    /// @details The managed weights are overwritten in place by copies spread over several streams, the weights built
+    /// into a refittable engine are refit by one IRefitter pass from device memory. The update is ordered after the
+    /// steps enqueued on the runtime stream, so the requests in flight keep their KV cache and the next steps use the
+    /// new weights. An executor that must not mix weights within a request drains the active requests first. Returns
+    /// once the update is done, the sources can be released then.
+    void updateWeights(WeightUpdateMap const& updates);
+
     void initializeUserBuffer(SizeType32 tpSize, SizeType32 maxBatchSize, SizeType32 maxBeamWidth,
         SizeType32 maxSequenceLength, SizeType32 hiddenSize, std::optional<SizeType32> maxNumTokens);
 
@@ -211,11 +254,14 @@ private:
     std::unique_ptr<LayerProfiler> mLayerProfiler;
     bool mUseShapeInference;
     TensorMap mManagedWeightsMap;
+    float mGpuWeightsPercent;
+    std::unique_ptr<WeightStreamingScheduler> mWeightStreamingScheduler;
     // List of input tensor names.
     // Names of static tensors are removed from this list when setStaticInputTensors is called.
     std::vector<std::string> mInputTensorNames;
     std::vector<std::string> mOutputTensorNames;
 
     bool mUserBufferEnabled;
+    nvinfer1::ILogger* mLogger;
 };
 } // namespace tensorrt_llm::runtime
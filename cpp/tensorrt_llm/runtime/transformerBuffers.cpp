@@ -17,6 +17,7 @@
 #include "tensorrt_llm/runtime/transformerBuffers.h"
 #include "iTensor.h"
 #include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/stlUtils.h"
 #include "tensorrt_llm/runtime/runtimeBuffers.h"
@@ -138,8 +139,46 @@ void TransformerBuffers::reshape(
             TLLM_LOG_DEBUG("kvCacheBlockOffsets not allocated yet");
         }
     }
+    else if (modelConfig.useGptAttentionPlugin() && generationConfig.beamWidth == 1
+        && tc::getEnvVirtualLinearKVCache())
+    {
+        // Beam search tiles the cache into new buffers, so it always uses the regular ones.
+        if (virtualKeysVals.empty()
+            || !ITensor::shapeEquals(virtualKeysVals.front()->getTensor()->getShape(), kvCacheReserve))
+        {
+            virtualKeysVals.clear();
+            for (auto& buffer : presentKeysVals)
+            {
+                // Free a regular allocation before reserving the new range.
+                auto const dataType = buffer->getDataType();
+                buffer.reset();
+                virtualKeysVals.push_back(std::make_shared<VirtualKvCacheBuffer>(batchSize,
+                    modelConfig.getNbKvHeads(0), maxAttentionWindow, modelConfig.getSizePerHead(), dataType));
+                buffer = virtualKeysVals.back()->getTensor();
+            }
+        }
+        else
+        {
+            // The previous batch has completed, give its memory back.
+            for (auto& buffer : virtualKeysVals)
+            {
+                buffer->release();
+            }
+        }
+    }
     else
     {
+        if (!virtualKeysVals.empty())
+        {
+            // The virtual caches cannot be reshaped, switch back to regular buffers.
+            for (auto& buffer : presentKeysVals)
+            {
+                auto const dataType = buffer->getDataType();
+                buffer.reset();
+                buffer = BufferManager::gpuSync(kvCacheReserve, dataType);
+            }
+            virtualKeysVals.clear();
+        }
         utils::reshapeBufferVector(presentKeysVals, kvCacheReserve);
     }
 
@@ -223,6 +262,7 @@ TransformerBuffers TransformerBuffers::sliceTo(
     else
     {
         buffers.presentKeysVals = utils::sliceBufferVector(presentKeysVals, offset, batchSize);
+        buffers.virtualKeysVals = virtualKeysVals;
     }
 
     if (modelConfig.useGptAttentionPlugin())
@@ -424,6 +464,8 @@ void TransformerBuffers::prepareContextStep(RuntimeBuffers* runtimeBuffers, Tens
         hiddenStates->reshape(hiddenStatesShape);
     }
 
+    reserveVirtualKvCache(generationConfig.maxInputLength);
+
     if (modelConfig.useGptAttentionPlugin() && modelConfig.isPagedKVCache())
     {
         auto constexpr contextBeamWidth = 1;
@@ -536,6 +578,15 @@ void TransformerBuffers::tile(RuntimeBuffers* runtimeBuffers, BufferManager& man
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
 
+void TransformerBuffers::reserveVirtualKvCache(SizeType32 numTokens)
+{
+    // All slices share the caches of the whole batch, so every sequence is reserved.
+    for (auto& buffer : virtualKeysVals)
+    {
+        buffer->reserve(numTokens);
+    }
+}
+
 void TransformerBuffers::postContextStep(RuntimeBuffers* runtimeBuffers,
     std::vector<RuntimeBuffers> const& contextBuffers, BufferManager& manager, ModelConfig const& modelConfig,
     WorldConfig const& worldConfig)
@@ -692,6 +743,9 @@ void TransformerBuffers::prepareNextStep(RuntimeBuffers* runtimeBuffers, SizeTyp
         hiddenStates->reshape(hiddenStatesShape);
     }
 
+    // Map the slot of the token written by the next step.
+    reserveVirtualKvCache(generationConfig.maxInputLength + step + 1);
+
     if (modelConfig.isPagedKVCache())
     {
         for (auto batchIdx = firstBatchSlotIdx; batchIdx < firstBatchSlotIdx + batchSize; ++batchIdx)
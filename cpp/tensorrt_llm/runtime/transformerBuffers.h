@@ -23,6 +23,7 @@
 #include "tensorrt_llm/runtime/modelConfig.h"
 #include "tensorrt_llm/runtime/tllmBuffers.h"
 #include "tensorrt_llm/runtime/tllmRuntime.h"
+#include "tensorrt_llm/runtime/virtualKvCacheBuffer.h"
 #include "tensorrt_llm/runtime/worldConfig.h"
 
 namespace tensorrt_llm::batch_manager::kv_cache_manager
@@ -83,6 +84,8 @@ protected:
     void tile(RuntimeBuffers* runtimeBuffers, BufferManager& manager, ModelConfig const& modelConfig,
         WorldConfig const& worldConfig);
 
+    void reserveVirtualKvCache(SizeType32 numTokens);
+
 public:
     // engine
     TensorPtr pastKeyValueLengths; // with attention plugin, host tensor
@@ -91,6 +94,8 @@ public:
 
     std::vector<TensorPtr> presentKeysVals;
     std::vector<TensorPtr> presentKeysValsAlt; // without attention plugin
+    // backing of presentKeysVals with TRTLLM_VIRTUAL_LINEAR_KVCACHE, attention plugin without paged KV cache only
+    std::vector<std::shared_ptr<VirtualKvCacheBuffer>> virtualKeysVals;
     TensorPtr maxAttentionWindows;             // with attention plugin, host tensor
     TensorPtr sinkTokenLengths;                // with attention plugin, host tensor
     TensorPtr kvCacheBlockPoolPointers;
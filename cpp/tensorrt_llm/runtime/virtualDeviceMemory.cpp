@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tensorrt_llm/runtime/virtualDeviceMemory.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaDriverWrapper.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <cuda.h>
+
+#include <algorithm>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+CUmemAllocationProp getAllocationProp(int deviceId, bool shareable)
+{
+    CUmemAllocationProp prop{};
+    prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+    prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    prop.location.id = deviceId;
+    if (shareable)
+    {
+        prop.requestedHandleTypes = CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR;
+    }
+    return prop;
+}
+} // namespace
+
+VirtualDeviceMemory::VirtualDeviceMemory(std::size_t maxSize, std::size_t chunkSize, int deviceId, bool shareable)
+    : mDeviceId{deviceId >= 0 ? deviceId : common::getDevice()}
+    , mShareable{shareable}
+{
+    auto const driver = common::CUDADriverWrapper::getInstance();
+    auto const prop = getAllocationProp(mDeviceId, mShareable);
+    std::size_t granularity{0};
+    TLLM_CU_CHECK(driver->cuMemGetAllocationGranularity(&granularity, &prop, CU_MEM_ALLOC_GRANULARITY_RECOMMENDED));
+    mChunkSize = common::ceilDiv(std::max(chunkSize, granularity), granularity) * granularity;
+    mReservedSize = common::ceilDiv(maxSize, mChunkSize) * mChunkSize;
+    CUdeviceptr address{0};
+    TLLM_CU_CHECK(driver->cuMemAddressReserve(&address, mReservedSize, granularity, 0, 0));
+    mAddress = address;
+    mHandles.resize(mReservedSize / mChunkSize, 0);
+    TLLM_LOG_DEBUG("Reserved %zu bytes of virtual device memory in chunks of %zu bytes", mReservedSize, mChunkSize);
+}
+
+VirtualDeviceMemory::~VirtualDeviceMemory()
+{
+    try
+    {
+        resize(0);
+        TLLM_CU_CHECK(common::CUDADriverWrapper::getInstance()->cuMemAddressFree(mAddress, mReservedSize));
+    }
+    catch (std::exception const& e)
+    {
+        TLLM_LOG_EXCEPTION(e);
+    }
+}
+
+void VirtualDeviceMemory::resize(std::size_t size)
+{
+    TLLM_CHECK_WITH_INFO(size <= mReservedSize, "Cannot map %zu bytes, only %zu bytes are reserved", size,
+        mReservedSize);
+    auto const mappedSize = common::ceilDiv(size, mChunkSize) * mChunkSize;
+    map(0, size);
+    unmap(mappedSize, mReservedSize - mappedSize);
+}
+
+void VirtualDeviceMemory::map(std::size_t offset, std::size_t size)
+{
+    TLLM_CHECK_WITH_INFO(offset + size <= mReservedSize, "Cannot map [%zu, %zu), only %zu bytes are reserved", offset,
+        offset + size, mReservedSize);
+    if (size == 0)
+    {
+        return;
+    }
+    for (auto chunkIdx = offset / mChunkSize; chunkIdx < common::ceilDiv(offset + size, mChunkSize); ++chunkIdx)
+    {
+        if (mHandles[chunkIdx] == 0)
+        {
+            mapChunk(chunkIdx);
+        }
+    }
+}
+
+void VirtualDeviceMemory::unmap(std::size_t offset, std::size_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    auto const endChunkIdx = std::min(common::ceilDiv(offset + size, mChunkSize), mHandles.size());
+    for (auto chunkIdx = offset / mChunkSize; chunkIdx < endChunkIdx; ++chunkIdx)
+    {
+        if (mHandles[chunkIdx] != 0)
+        {
+            unmapChunk(chunkIdx);
+        }
+    }
+}
+
+void VirtualDeviceMemory::mapChunk(std::size_t chunkIdx)
+{
+    auto const driver = common::CUDADriverWrapper::getInstance();
+    auto const prop = getAllocationProp(mDeviceId, mShareable);
+    CUmemGenericAllocationHandle handle{};
+    TLLM_CU_CHECK(driver->cuMemCreate(&handle, mChunkSize, &prop, 0));
+    mapHandle(chunkIdx, handle);
+}
+
+void VirtualDeviceMemory::mapHandle(std::size_t chunkIdx, std::uint64_t handle)
+{
+    auto const driver = common::CUDADriverWrapper::getInstance();
+    auto const chunkAddress = mAddress + chunkIdx * mChunkSize;
+    try
+    {
+        TLLM_CU_CHECK(driver->cuMemMap(chunkAddress, mChunkSize, 0, handle, 0));
+        CUmemAccessDesc access{};
+        access.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+        access.location.id = mDeviceId;
+        access.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+        TLLM_CU_CHECK(driver->cuMemSetAccess(chunkAddress, mChunkSize, &access, 1));
+    }
+    catch (...)
+    {
+        driver->cuMemUnmap(chunkAddress, mChunkSize);
+        driver->cuMemRelease(handle);
+        throw;
+    }
+    mHandles[chunkIdx] = handle;
+    ++mNumMappedChunks;
+}
+
+void VirtualDeviceMemory::unmapChunk(std::size_t chunkIdx)
+{
+    auto const driver = common::CUDADriverWrapper::getInstance();
+    auto const handle = mHandles[chunkIdx];
+    mHandles[chunkIdx] = 0;
+    --mNumMappedChunks;
+    TLLM_CU_CHECK(driver->cuMemUnmap(mAddress + chunkIdx * mChunkSize, mChunkSize));
+    TLLM_CU_CHECK(driver->cuMemRelease(handle));
+}
+
+std::vector<int> VirtualDeviceMemory::exportChunks() const
+{
+    TLLM_CHECK_WITH_INFO(mShareable, "Virtual device memory was not created shareable");
+    auto const driver = common::CUDADriverWrapper::getInstance();
+    std::vector<int> chunkFds(mHandles.size(), -1);
+    for (std::size_t chunkIdx = 0; chunkIdx < mHandles.size(); ++chunkIdx)
+    {
+        if (mHandles[chunkIdx] != 0)
+        {
+            TLLM_CU_CHECK(driver->cuMemExportToShareableHandle(
+                &chunkFds[chunkIdx], mHandles[chunkIdx], CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR, 0));
+        }
+    }
+    return chunkFds;
+}
+
+std::unique_ptr<VirtualDeviceMemory> VirtualDeviceMemory::importChunks(
+    std::vector<int> const& chunkFds, std::size_t chunkSize, int deviceId)
+{
+    auto memory = std::make_unique<VirtualDeviceMemory>(chunkFds.size() * chunkSize, chunkSize, deviceId, true);
+    TLLM_CHECK_WITH_INFO(memory->getChunkSize() == chunkSize,
+        "Chunk size %zu does not match the allocation granularity of device %d", chunkSize, memory->mDeviceId);
+    auto const driver = common::CUDADriverWrapper::getInstance();
+    for (std::size_t chunkIdx = 0; chunkIdx < chunkFds.size(); ++chunkIdx)
+    {
+        if (chunkFds[chunkIdx] < 0)
+        {
+            continue;
+        }
+        CUmemGenericAllocationHandle handle{};
+        TLLM_CU_CHECK(driver->cuMemImportFromShareableHandle(&handle,
+            reinterpret_cast<void*>(static_cast<std::uintptr_t>(chunkFds[chunkIdx])),
+            CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR));
+        memory->mapHandle(chunkIdx, handle);
+    }
+    TLLM_LOG_INFO("Imported %zu bytes of virtual device memory", memory->getMappedSize());
+    return memory;
+}
+
+} // namespace tensorrt_llm::runtime
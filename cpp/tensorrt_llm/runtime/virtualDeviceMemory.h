@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Device memory with a fixed virtual address range whose physical backing can grow and shrink at runtime.
+/// @details The full virtual range is reserved up front with the CUDA virtual memory management APIs. Physical memory
+/// is mapped in chunks, either from the start of the range with resize() or for arbitrary ranges with map(), so
+/// pointers into the range stay valid while the backing changes. Memory released by unmapping goes straight back to
+/// the device and becomes available to other allocations.
+/// Shareable memory can be exported as one file descriptor per chunk and mapped by another process with
+/// importChunks(), e.g. to hand the KV cache pools of a draining executor over to its successor.
+class VirtualDeviceMemory
+{
+public:
+    /// @param maxSize Size of the reserved virtual address range in bytes.
+    /// @param chunkSize Granularity of mapping and unmapping, rounded up to the allocation granularity of the device.
+    /// @param shareable Whether the chunks can be exported to other processes.
+    explicit VirtualDeviceMemory(
+        std::size_t maxSize, std::size_t chunkSize = kDefaultChunkSize, int deviceId = -1, bool shareable = false);
+
+    ~VirtualDeviceMemory();
+
+    VirtualDeviceMemory(VirtualDeviceMemory const&) = delete;
+    VirtualDeviceMemory& operator=(VirtualDeviceMemory const&) = delete;
+
+    [[nodiscard]] void* data() const noexcept
+    {
+        return reinterpret_cast<void*>(mAddress);
+    }
+
+    /// @brief Size of the reserved virtual address range.
+    [[nodiscard]] std::size_t getReservedSize() const noexcept
+    {
+        return mReservedSize;
+    }
+
+    /// @brief Amount of physical memory mapped into the range, a multiple of getChunkSize().
+    [[nodiscard]] std::size_t getMappedSize() const noexcept
+    {
+        return mNumMappedChunks * mChunkSize;
+    }
+
+    [[nodiscard]] std::size_t getChunkSize() const noexcept
+    {
+        return mChunkSize;
+    }
+
+    /// @brief Map the chunks overlapping [0, size) and unmap all others. The caller must make sure that no pending
+    /// work accesses the memory that is unmapped.
+    void resize(std::size_t size);
+
+    /// @brief Map every chunk overlapping [offset, offset + size) that is not mapped yet.
+    void map(std::size_t offset, std::size_t size);
+
+    /// @brief Unmap every chunk overlapping [offset, offset + size). The caller must make sure that no pending work
+    /// accesses the memory that is unmapped.
+    void unmap(std::size_t offset, std::size_t size);
+
+    /// @brief Export every chunk as a POSIX file descriptor, -1 for chunks that are not mapped. The caller owns the
+    /// descriptors. The physical memory stays alive as long as any process maps it or holds a descriptor.
+    [[nodiscard]] std::vector<int> exportChunks() const;
+
+    /// @brief Map the memory exported by exportChunks() of another process into a new range of the same layout.
+    /// @details Chunks with descriptor -1 are left unmapped and are backed by local memory when mapped later. The
+    /// descriptors are not closed.
+    [[nodiscard]] static std::unique_ptr<VirtualDeviceMemory> importChunks(
+        std::vector<int> const& chunkFds, std::size_t chunkSize, int deviceId = -1);
+
+    static constexpr std::size_t kDefaultChunkSize = std::size_t{64} << 20;
+
+private:
+    void mapChunk(std::size_t chunkIdx);
+    /// @brief Map an allocation into a chunk, taking ownership of the handle.
+    void mapHandle(std::size_t chunkIdx, std::uint64_t handle);
+    void unmapChunk(std::size_t chunkIdx);
+
+    int mDeviceId;
+    bool mShareable;
+    std::size_t mChunkSize;
+    std::size_t mReservedSize;
+    std::uint64_t mAddress{0};
+    // Allocation handle of every chunk of the range, 0 for chunks that are not mapped.
+    std::vector<std::uint64_t> mHandles;
+    std::size_t mNumMappedChunks{0};
+};
+
+} // namespace tensorrt_llm::runtime
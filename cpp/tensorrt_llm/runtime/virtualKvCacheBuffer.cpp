@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/virtualKvCacheBuffer.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <algorithm>
+
+namespace tensorrt_llm::runtime
+{
+
+VirtualKvCacheBuffer::VirtualKvCacheBuffer(SizeType32 batchSize, SizeType32 numKvHeads, SizeType32 maxSeqLen,
+    SizeType32 sizePerHead, nvinfer1::DataType dataType)
+    : mNumRows{batchSize * 2 * numKvHeads}
+    , mMaxSeqLen{maxSeqLen}
+    , mBytesPerToken{static_cast<std::size_t>(sizePerHead) * BufferDataType(dataType).getSize()}
+    // Map at the allocation granularity of the device, the rows are much smaller than the default chunks.
+    , mMemory{static_cast<std::size_t>(mNumRows) * maxSeqLen * mBytesPerToken, 0}
+    , mTensor{ITensor::wrap(mMemory.data(), dataType,
+          ITensor::makeShape({batchSize, 2, numKvHeads, maxSeqLen, sizePerHead}))}
+{
+    TLLM_LOG_DEBUG("Reserved %zu bytes for a virtual KV cache of %d sequences", mMemory.getReservedSize(), batchSize);
+}
+
+void VirtualKvCacheBuffer::reserve(SizeType32 numTokens)
+{
+    numTokens = std::min(numTokens, mMaxSeqLen);
+    if (numTokens <= mNumTokens)
+    {
+        return;
+    }
+    auto const rowSize = static_cast<std::size_t>(mMaxSeqLen) * mBytesPerToken;
+    for (SizeType32 rowIdx = 0; rowIdx < mNumRows; ++rowIdx)
+    {
+        mMemory.map(rowIdx * rowSize + mNumTokens * mBytesPerToken, (numTokens - mNumTokens) * mBytesPerToken);
+    }
+    mNumTokens = numTokens;
+}
+
+void VirtualKvCacheBuffer::release()
+{
+    mMemory.resize(0);
+    mNumTokens = 0;
+}
+
+} // namespace tensorrt_llm::runtime
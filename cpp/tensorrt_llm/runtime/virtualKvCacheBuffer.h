@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/virtualDeviceMemory.h"
+
+#include <NvInferRuntime.h>
+
+#include <cstddef>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Contiguous KV cache of one layer whose physical memory is mapped as the sequences grow.
+/// @details The tensor has the layout the attention plugin expects without paged KV cache,
+/// [batchSize, 2, numKvHeads, maxSeqLen, sizePerHead], so kernels address it linearly through KVLinearBuffer without
+/// any block table. The virtual range for the worst case is reserved up front, but only the first numTokens tokens
+/// of every (sequence, K/V, head) row are backed by physical memory. Rows shorter than the mapping granularity share
+/// chunks with their neighbours, so the savings grow with the maximum sequence length.
+class VirtualKvCacheBuffer
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+
+    VirtualKvCacheBuffer(SizeType32 batchSize, SizeType32 numKvHeads, SizeType32 maxSeqLen, SizeType32 sizePerHead,
+        nvinfer1::DataType dataType);
+
+    /// @brief View of the whole cache, valid for the lifetime of this object.
+    [[nodiscard]] TensorPtr const& getTensor() const noexcept
+    {
+        return mTensor;
+    }
+
+    /// @brief Make sure the first numTokens tokens of every sequence are backed by physical memory.
+    void reserve(SizeType32 numTokens);
+
+    /// @brief Unmap all physical memory. The caller must make sure that no pending work accesses the cache.
+    void release();
+
+    [[nodiscard]] SizeType32 getNumReservedTokens() const noexcept
+    {
+        return mNumTokens;
+    }
+
+    [[nodiscard]] std::size_t getMappedSize() const noexcept
+    {
+        return mMemory.getMappedSize();
+    }
+
+private:
+    SizeType32 mNumRows;
+    SizeType32 mMaxSeqLen;
+    std::size_t mBytesPerToken;
+    VirtualDeviceMemory mMemory;
+    TensorPtr mTensor;
+    SizeType32 mNumTokens{0};
+};
+
+} // namespace tensorrt_llm::runtime
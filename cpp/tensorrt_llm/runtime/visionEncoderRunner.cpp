@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/visionEncoderRunner.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+#include "tensorrt_llm/runtime/tllmRuntime.h"
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+bool sameShape(ITensor::Shape const& a, ITensor::Shape const& b)
+{
+    if (a.nbDims != b.nbDims)
+    {
+        return false;
+    }
+    for (SizeType32 di = 0; di < a.nbDims; ++di)
+    {
+        if (a.d[di] != b.d[di])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+VisionEncoderRunner::VisionEncoderRunner(RawEngine const& rawEngine, nvinfer1::ILogger* logger, Config config)
+    : mRuntime{std::make_unique<TllmRuntime>(rawEngine, logger)}
+    , mConfig{std::move(config)}
+{
+    TLLM_CHECK(mConfig.maxBatchSize > 0);
+    mRuntime->addContext(0);
+}
+
+VisionEncoderRunner::~VisionEncoderRunner() = default;
+
+CudaStream const& VisionEncoderRunner::getStream() const
+{
+    return mRuntime->getStream();
+}
+
+void VisionEncoderRunner::enqueue(RequestIdType requestId, TensorPtr image)
+{
+    TLLM_CHECK_WITH_INFO(image != nullptr && image->getShape().nbDims == 3, "The image must be [channels, h, w]");
+    TLLM_CHECK_WITH_INFO(mTables.count(requestId) == 0, "Request %lu has an embedding table already", requestId);
+    mPending.push_back(PendingImage{requestId, std::move(image)});
+}
+
+std::vector<VisionEncoderRunner::RequestIdType> VisionEncoderRunner::step()
+{
+    NVTX3_FUNC_RANGE();
+    std::vector<RequestIdType> requestIds;
+    if (mPending.empty())
+    {
+        return requestIds;
+    }
+
+    // The images of a batch have the shape of the oldest one, the others wait for a batch of their own.
+    auto const imageShape = mPending.front().image->getShape();
+    auto const imageType = mPending.front().image->getDataType();
+    std::vector<TensorPtr> images;
+    for (auto it = mPending.begin();
+         it != mPending.end() && static_cast<SizeType32>(images.size()) < mConfig.maxBatchSize;)
+    {
+        if (sameShape(it->image->getShape(), imageShape) && it->image->getDataType() == imageType)
+        {
+            requestIds.push_back(it->requestId);
+            images.push_back(std::move(it->image));
+            it = mPending.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    auto const& manager = mRuntime->getBufferManager();
+    auto const batchSize = static_cast<SizeType32>(images.size());
+    TensorPtr input
+        = manager.gpu(ITensor::makeShape({batchSize, imageShape.d[0], imageShape.d[1], imageShape.d[2]}), imageType);
+    for (SizeType32 bi = 0; bi < batchSize; ++bi)
+    {
+        auto slot = ITensor::slice(input, bi, 1);
+        manager.copy(*images[bi], *slot);
+    }
+
+    TllmRuntime::TensorMap inputs{{mConfig.inputName, input}};
+    TllmRuntime::TensorMap outputs;
+    mRuntime->setInputTensors(0, inputs);
+    // The runtime allocates the output of the batch, shared by the tables of its requests.
+    mRuntime->setOutputTensors(0, outputs);
+    TLLM_CHECK_WITH_INFO(mRuntime->executeContext(0), "Executing the vision encoder failed");
+    auto ready = std::make_shared<CudaEvent>();
+    mRuntime->getStream().record(*ready);
+
+    auto const outputIt = outputs.find(mConfig.outputName);
+    TLLM_CHECK_WITH_INFO(outputIt != outputs.end(), "The vision encoder has no output %s", mConfig.outputName.c_str());
+    auto const& output = outputIt->second;
+    TLLM_CHECK_WITH_INFO(output->getShape().nbDims == 3 && output->getShape().d[0] == batchSize,
+        "The vision encoder output must be [batchSize, numImageTokens, hiddenSize]");
+    for (SizeType32 bi = 0; bi < batchSize; ++bi)
+    {
+        mTables.emplace(requestIds[bi], EmbeddingTable{ITensor::slice(output, bi, 1), ready});
+    }
+    TLLM_LOG_DEBUG("Encoded %d images, %zu pending", batchSize, mPending.size());
+    return requestIds;
+}
+
+std::optional<VisionEncoderRunner::EmbeddingTable> VisionEncoderRunner::getEmbeddingTable(
+    RequestIdType requestId) const
+{
+    auto const it = mTables.find(requestId);
+    return it == mTables.end() ? std::nullopt : std::optional<EmbeddingTable>{it->second};
+}
+
+void VisionEncoderRunner::waitForEmbeddingTable(RequestIdType requestId, CudaStream const& llmStream) const
+{
+    auto const it = mTables.find(requestId);
+    TLLM_CHECK_WITH_INFO(it != mTables.end(), "The image of request %lu is not encoded", requestId);
+    llmStream.wait(*it->second.ready);
+}
+
+void VisionEncoderRunner::release(RequestIdType requestId)
+{
+    mTables.erase(requestId);
+    for (auto it = mPending.begin(); it != mPending.end(); ++it)
+    {
+        if (it->requestId == requestId)
+        {
+            mPending.erase(it);
+            break;
+        }
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/rawEngine.h"
+
+#include <NvInferRuntime.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+class TllmRuntime;
+
+//! \brief Runs the vision encoder of a multimodal model in the process of the LLM, as a second engine on its own
+//! stream, instead of shipping its outputs with every request as a PromptTuningConfig.
+//! \details The images of the requests are queued and step encodes up to maxBatchSize of them at once, the oldest
+//! first. The embeddings of an image stay in the output of its batch on the device, and are handed to the LLM as the
+//! prompt embedding table of the request, the table the lookup plugin reads, without any copy. The LLM stream waits
+//! for the encoder stream on the device only, see waitForEmbeddingTable.
+class VisionEncoderRunner
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+    using RequestIdType = std::uint64_t;
+
+    struct Config
+    {
+        SizeType32 maxBatchSize{8};
+        std::string inputName{"input"};
+        std::string outputName{"encoder_output"};
+    };
+
+    //! \brief The prompt embedding table of a request, valid once ready is reached on the encoder stream.
+    struct EmbeddingTable
+    {
+        //! \brief [1, numImageTokens, hiddenSize] on the device, the layout of LlmRequest::getPromptEmbeddingTable.
+        TensorPtr table;
+        std::shared_ptr<CudaEvent> ready;
+    };
+
+    VisionEncoderRunner(RawEngine const& rawEngine, nvinfer1::ILogger* logger, Config config);
+
+    ~VisionEncoderRunner();
+
+    //! \brief Queue the image of a request [numChannels, height, width], on the host or the device. It must not be
+    //! modified before it is encoded.
+    void enqueue(RequestIdType requestId, TensorPtr image);
+
+    [[nodiscard]] SizeType32 getNumPending() const
+    {
+        return static_cast<SizeType32>(mPending.size());
+    }
+
+    //! \brief Encode a batch of the queued images, the oldest ones of the shape of the oldest.
+    //! \return The requests whose embedding table was enqueued.
+    std::vector<RequestIdType> step();
+
+    [[nodiscard]] std::optional<EmbeddingTable> getEmbeddingTable(RequestIdType requestId) const;
+
+    //! \brief Make the LLM stream wait for the encoder of a request, before its context step.
+    void waitForEmbeddingTable(RequestIdType requestId, CudaStream const& llmStream) const;
+
+    //! \brief Release the table of a request once its context steps are enqueued. The output of a batch is freed with
+    //! the last of its tables.
+    void release(RequestIdType requestId);
+
+    [[nodiscard]] CudaStream const& getStream() const;
+
+private:
+    struct PendingImage
+    {
+        RequestIdType requestId;
+        TensorPtr image;
+    };
+
+    std::unique_ptr<TllmRuntime> mRuntime;
+    Config mConfig;
+    std::deque<PendingImage> mPending;
+    std::unordered_map<RequestIdType, EmbeddingTable> mTables;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/vocabParallelSampler.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+#include "tensorrt_llm/runtime/ncclCommunicator.h"
+
+#include <algorithm>
+
+using namespace tensorrt_llm::runtime;
+namespace tk = tensorrt_llm::kernels;
+
+VocabParallelSampler::VocabParallelSampler(std::shared_ptr<NcclCommunicator> tpComm, WorldConfig const& worldConfig,
+    SizeType32 maxBatchSize, SizeType32 vocabSize, BufferManager const& bufferManager)
+    : mComm{std::move(tpComm)}
+    , mTpSize{worldConfig.getTensorParallelism()}
+    , mMaxBatchSize{maxBatchSize}
+    , mVocabSize{vocabSize}
+{
+    TLLM_CHECK_WITH_INFO(mComm != nullptr || mTpSize == 1, "Sampling over vocab shards needs a NCCL communicator");
+    TLLM_CHECK_WITH_INFO(mTpSize <= tk::kVocabParallelMaxTpSize, "Sampling over %d vocab shards, at most %d supported",
+        mTpSize, tk::kVocabParallelMaxTpSize);
+    auto const paddedShardSize = common::divUp(vocabSize, mTpSize);
+    mVocabOffset = worldConfig.getTensorParallelRank() * paddedShardSize;
+    mShardVocabSize = std::clamp(vocabSize - mVocabOffset, 0, paddedShardSize);
+
+    auto const summarySize = static_cast<std::size_t>(maxBatchSize) * sizeof(tk::VocabShardSummary);
+    mSummaries = bufferManager.gpu(summarySize, nvinfer1::DataType::kUINT8);
+    mGatheredSummaries = bufferManager.gpu(mTpSize * summarySize, nvinfer1::DataType::kUINT8);
+}
+
+template <typename T>
+void VocabParallelSampler::sample(
+    tk::VocabShardSummaryParams<T> summaryParams, tk::VocabParallelSampleParams sampleParams, CudaStream const& stream)
+{
+    NVTX3_SCOPED_RANGE(VocabParallelSampler_sample);
+    auto const batchSize = summaryParams.batchSize;
+    TLLM_CHECK(batchSize <= mMaxBatchSize && sampleParams.batchSize == batchSize);
+
+    summaryParams.summaries = static_cast<tk::VocabShardSummary*>(mSummaries->data());
+    summaryParams.shardVocabSize = mShardVocabSize;
+    summaryParams.vocabOffset = mVocabOffset;
+    tk::invokeVocabShardSummary(summaryParams, stream.get());
+
+    auto const batchBytes = static_cast<std::size_t>(batchSize) * sizeof(tk::VocabShardSummary);
+    if (mTpSize > 1)
+    {
+        // Gathered as [tpSize, batchSize], the layout of VocabParallelSampleParams::summaries.
+        auto const local = IBuffer::slice(mSummaries, 0, batchBytes);
+        auto gathered = IBuffer::slice(mGatheredSummaries, 0, mTpSize * batchBytes);
+        mComm->allGather(*local, *gathered, stream);
+        sampleParams.summaries = static_cast<tk::VocabShardSummary*>(mGatheredSummaries->data());
+    }
+    else
+    {
+        sampleParams.summaries = static_cast<tk::VocabShardSummary*>(mSummaries->data());
+    }
+    sampleParams.tpSize = mTpSize;
+    sampleParams.vocabSize = mVocabSize;
+    tk::invokeVocabParallelSample(sampleParams, stream.get());
+}
+
+template void VocabParallelSampler::sample(
+    tk::VocabShardSummaryParams<float>, tk::VocabParallelSampleParams, CudaStream const&);
+template void VocabParallelSampler::sample(
+    tk::VocabShardSummaryParams<half>, tk::VocabParallelSampleParams, CudaStream const&);
+#ifdef ENABLE_BF16
+template void VocabParallelSampler::sample(
+    tk::VocabShardSummaryParams<__nv_bfloat16>, tk::VocabParallelSampleParams, CudaStream const&);
+#endif
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/kernels/vocabParallelSamplingKernels.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/iBuffer.h"
+#include "tensorrt_llm/runtime/worldConfig.h"
+
+#include <memory>
+
+namespace tensorrt_llm::runtime
+{
+
+class NcclCommunicator;
+
+//! \brief Sampling from the logits of an LM head split over the vocab by tensor parallelism, without gathering them.
+//! \details Every rank summarizes the logits of its shard, see kernels::VocabShardSummary, the summaries are
+//! all-gathered, a few hundred bytes per request and rank instead of the logits of the whole vocab, and every rank
+//! samples the same tokens from them. The shards are the column split of the LM head: rank r holds the tokens
+//! [r * shardSize, (r + 1) * shardSize) of the vocab padded to a multiple of the tensor parallelism.
+//!
+//! It only serves requests with beam width 1, a top-k in [1, kernels::kVocabParallelMaxTopK] and no logits to return,
+//! the others need the logits of the whole vocab, see supportsTopK.
+class VocabParallelSampler
+{
+public:
+    VocabParallelSampler(std::shared_ptr<NcclCommunicator> tpComm, WorldConfig const& worldConfig,
+        SizeType32 maxBatchSize, SizeType32 vocabSize, BufferManager const& bufferManager);
+
+    [[nodiscard]] static bool supportsTopK(SizeType32 topK) noexcept
+    {
+        return topK >= 1 && topK <= kernels::kVocabParallelMaxTopK;
+    }
+
+    //! \brief Tokens of the vocab in the shard of this rank, excluding the padding.
+    [[nodiscard]] SizeType32 getShardVocabSize() const noexcept
+    {
+        return mShardVocabSize;
+    }
+
+    [[nodiscard]] SizeType32 getVocabOffset() const noexcept
+    {
+        return mVocabOffset;
+    }
+
+    //! \brief Sample a token for every request from its shard logits in summaryParams.logitsPtrs. The summaries, the
+    //! shard and the tensor parallelism of the params are set here, the other fields by the caller, with the same
+    //! batch on all the ranks.
+    template <typename T>
+    void sample(kernels::VocabShardSummaryParams<T> summaryParams, kernels::VocabParallelSampleParams sampleParams,
+        CudaStream const& stream);
+
+private:
+    std::shared_ptr<NcclCommunicator> mComm;
+    SizeType32 mTpSize;
+    SizeType32 mMaxBatchSize;
+    SizeType32 mVocabSize;
+    SizeType32 mShardVocabSize;
+    SizeType32 mVocabOffset;
+    //! \brief [maxBatchSize] summaries of this rank and [tpSize, batchSize] of all the ranks, as bytes.
+    IBuffer::SharedPtr mSummaries;
+    IBuffer::SharedPtr mGatheredSummaries;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tensorrt_llm/runtime/weightStreamLoader.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+// O_DIRECT requires offsets, sizes and buffer addresses aligned to the logical block size of the device.
+constexpr std::size_t kDirectIoAlignment{4096};
+
+struct OpenFile
+{
+    int fd{-1};
+    bool isDirect{false};
+    std::size_t size{0};
+};
+
+OpenFile openFile(std::string const& path, bool directIo)
+{
+    OpenFile file;
+    if (directIo)
+    {
+        file.fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+        file.isDirect = file.fd >= 0;
+    }
+    if (file.fd < 0)
+    {
+        file.fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    TLLM_CHECK_WITH_INFO(file.fd >= 0, "Failed to open %s: %s", path.c_str(), std::strerror(errno));
+    auto const end = ::lseek(file.fd, 0, SEEK_END);
+    TLLM_CHECK_WITH_INFO(end >= 0, "Failed to get the size of %s: %s", path.c_str(), std::strerror(errno));
+    file.size = static_cast<std::size_t>(end);
+    return file;
+}
+
+//! \brief Read up to size bytes at offset, fewer only at the end of the file. With O_DIRECT, dst, offset and size
+//! must be aligned to kDirectIoAlignment.
+std::size_t readFully(OpenFile const& file, std::uint8_t* dst, std::size_t offset, std::size_t size)
+{
+    std::size_t numRead{0};
+    while (numRead < size)
+    {
+        auto const result = ::pread(file.fd, dst + numRead, size - numRead, static_cast<off_t>(offset + numRead));
+        if (result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        TLLM_CHECK_WITH_INFO(result >= 0, "Failed to read weights: %s", std::strerror(errno));
+        if (result == 0)
+        {
+            break;
+        }
+        numRead += static_cast<std::size_t>(result);
+        if (file.isDirect && numRead < size && numRead % kDirectIoAlignment != 0)
+        {
+            if (offset + numRead >= file.size)
+            {
+                // The last block of the file.
+                break;
+            }
+            // O_DIRECT fails with EINVAL at an unaligned offset, read the partial block again from its start.
+            numRead = numRead / kDirectIoAlignment * kDirectIoAlignment;
+        }
+    }
+    return numRead;
+}
+
+struct Chunk
+{
+    std::size_t fileIdx;
+    std::size_t offset;
+    std::size_t size;
+};
+} // namespace
+
+WeightStreamLoader::WeightStreamLoader(Config const& config)
+    : mConfig{config}
+{
+    TLLM_CHECK_WITH_INFO(mConfig.chunkSize > 0 && mConfig.chunkSize % kDirectIoAlignment == 0,
+        "The chunk size must be a multiple of %zu bytes", kDirectIoAlignment);
+    TLLM_CHECK(mConfig.numWorkers > 0 && mConfig.numBuffersPerWorker > 0);
+}
+
+void WeightStreamLoader::add(std::string const& path, std::size_t fileOffset, std::size_t size, void* dst)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    auto it = std::find_if(mFiles.begin(), mFiles.end(), [&path](File const& file) { return file.path == path; });
+    if (it == mFiles.end())
+    {
+        it = mFiles.insert(mFiles.end(), File{path, {}});
+    }
+    it->copies.push_back({fileOffset, size, dst});
+}
+
+WeightStreamLoader::Stats WeightStreamLoader::load()
+{
+    auto const start = std::chrono::steady_clock::now();
+    Stats stats;
+
+    // Sort the copies of every file and cover them with aligned chunks.
+    std::vector<OpenFile> files;
+    struct FileCloser
+    {
+        std::vector<OpenFile>& files;
+
+        ~FileCloser()
+        {
+            for (auto const& file : files)
+            {
+                ::close(file.fd);
+            }
+        }
+    } const fileCloser{files};
+    std::vector<Chunk> chunks;
+    for (std::size_t fileIdx = 0; fileIdx < mFiles.size(); ++fileIdx)
+    {
+        auto& copies = mFiles[fileIdx].copies;
+        std::sort(
+            copies.begin(), copies.end(), [](Copy const& a, Copy const& b) { return a.fileOffset < b.fileOffset; });
+        files.push_back(openFile(mFiles[fileIdx].path, mConfig.directIo));
+        stats.numDirectIoFiles += files.back().isDirect ? 1 : 0;
+        for (std::size_t i = 0; i < copies.size(); ++i)
+        {
+            TLLM_CHECK_WITH_INFO(copies[i].fileOffset + copies[i].size <= files.back().size,
+                "Weights at offset %zu exceed the size of %s", copies[i].fileOffset, mFiles[fileIdx].path.c_str());
+            TLLM_CHECK_WITH_INFO(i == 0 || copies[i - 1].fileOffset + copies[i - 1].size <= copies[i].fileOffset,
+                "Weights at offset %zu of %s overlap", copies[i].fileOffset, mFiles[fileIdx].path.c_str());
+        }
+        // Chunks only span gaps between tensors that are smaller than a chunk.
+        std::size_t chunkEnd{0};
+        for (auto const& copy : copies)
+        {
+            auto offset = std::max(chunkEnd, copy.fileOffset / kDirectIoAlignment * kDirectIoAlignment);
+            auto const copyEnd = copy.fileOffset + copy.size;
+            for (; offset < copyEnd; offset += mConfig.chunkSize)
+            {
+                chunks.push_back({fileIdx, offset, mConfig.chunkSize});
+                chunkEnd = offset + mConfig.chunkSize;
+            }
+        }
+    }
+
+    std::atomic<std::size_t> nextChunkIdx{0};
+    std::atomic<std::size_t> numBytesRead{0};
+    std::atomic<std::size_t> numBytesCopied{0};
+    std::atomic<bool> failed{false};
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    auto const deviceId = common::getDevice();
+    auto work = [&]()
+    {
+        try
+        {
+            TLLM_CUDA_CHECK(cudaSetDevice(deviceId));
+            CudaStream const stream;
+            std::vector<IBuffer::SharedPtr> buffers;
+            std::vector<CudaEvent> events(mConfig.numBuffersPerWorker);
+            for (std::size_t i = 0; i < mConfig.numBuffersPerWorker; ++i)
+            {
+                buffers.push_back(BufferManager::pinned(mConfig.chunkSize));
+                TLLM_CHECK(reinterpret_cast<std::uintptr_t>(buffers.back()->data()) % kDirectIoAlignment == 0);
+            }
+            for (std::size_t slot = 0;; slot = (slot + 1) % buffers.size())
+            {
+                auto const chunkIdx = nextChunkIdx.fetch_add(1);
+                if (chunkIdx >= chunks.size() || failed)
+                {
+                    break;
+                }
+                auto const& chunk = chunks[chunkIdx];
+                auto* buffer = static_cast<std::uint8_t*>(buffers[slot]->data());
+                // The copies out of this buffer from earlier chunks must be done before it is overwritten.
+                events[slot].synchronize();
+                auto const numRead = readFully(files[chunk.fileIdx], buffer, chunk.offset, chunk.size);
+                numBytesRead += numRead;
+
+                auto const& copies = mFiles[chunk.fileIdx].copies;
+                auto const chunkEnd = chunk.offset + numRead;
+                auto it = std::upper_bound(copies.begin(), copies.end(), chunk.offset,
+                    [](std::size_t offset, Copy const& copy) { return offset < copy.fileOffset + copy.size; });
+                for (; it != copies.end() && it->fileOffset < chunkEnd; ++it)
+                {
+                    auto const begin = std::max(it->fileOffset, chunk.offset);
+                    auto const end = std::min(it->fileOffset + it->size, chunkEnd);
+                    TLLM_CUDA_CHECK(cudaMemcpyAsync(static_cast<std::uint8_t*>(it->dst) + (begin - it->fileOffset),
+                        buffer + (begin - chunk.offset), end - begin, cudaMemcpyDefault, stream.get()));
+                    numBytesCopied += end - begin;
+                }
+                stream.record(events[slot]);
+            }
+            stream.synchronize();
+        }
+        catch (...)
+        {
+            failed = true;
+            std::lock_guard lock{errorMutex};
+            if (error == nullptr)
+            {
+                error = std::current_exception();
+            }
+        }
+    };
+
+    auto const numWorkers = std::max<std::size_t>(1, std::min(mConfig.numWorkers, chunks.size()));
+    std::vector<std::thread> workers;
+    for (std::size_t i = 1; i < numWorkers; ++i)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    mFiles.clear();
+    if (error != nullptr)
+    {
+        std::rethrow_exception(error);
+    }
+
+    stats.numBytesRead = numBytesRead;
+    stats.numBytesCopied = numBytesCopied;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    TLLM_LOG_INFO("Streamed %.2f GiB of weights in %.2f s (%zu of %zu files with direct IO)",
+        static_cast<double>(stats.numBytesCopied) / (1 << 30), stats.seconds, stats.numDirectIoFiles, files.size());
+    return stats;
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Streams byte ranges of weight files straight into device memory.
+/// @details Files are read with O_DIRECT in large chunks into pinned staging buffers, bypassing the page cache, and
+/// every chunk is copied to the ranges of device memory it overlaps while the next one is read. Each worker owns a
+/// stream and a few buffers, and the workers share the chunks of all files, so several shards load in parallel. Files
+/// that do not support O_DIRECT, e.g. on tmpfs, are read through the page cache instead.
+class WeightStreamLoader
+{
+public:
+    struct Config
+    {
+        /// @brief Bytes read per request, a multiple of the direct IO alignment.
+        std::size_t chunkSize{std::size_t{32} << 20};
+        std::size_t numWorkers{4};
+        std::size_t numBuffersPerWorker{2};
+        bool directIo{true};
+    };
+
+    struct Stats
+    {
+        std::size_t numBytesRead{0};
+        std::size_t numBytesCopied{0};
+        std::size_t numDirectIoFiles{0};
+        double seconds{0};
+    };
+
+    explicit WeightStreamLoader(Config const& config);
+
+    /// @brief Copy size bytes at fileOffset of the file at path to the device or pinned host memory at dst. Ranges of a
+    /// file must not overlap.
+    void add(std::string const& path, std::size_t fileOffset, std::size_t size, void* dst);
+
+    /// @brief Run every copy added so far and wait for them to complete.
+    Stats load();
+
+private:
+    struct Copy
+    {
+        std::size_t fileOffset;
+        std::size_t size;
+        void* dst;
+    };
+
+    struct File
+    {
+        std::string path;
+        std::vector<Copy> copies;
+    };
+
+    Config mConfig;
+    std::vector<File> mFiles;
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/weightStreamingScheduler.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <numeric>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+// Alignment of the weights within a slot.
+std::size_t constexpr kWeightAlignment{256};
+
+std::size_t alignWeightSize(std::size_t size)
+{
+    return (size + kWeightAlignment - 1) / kWeightAlignment * kWeightAlignment;
+}
+} // namespace
+
+LayerResidencyPolicy::LayerResidencyPolicy(SizeType32 numLayers, Config const& config)
+    : mConfig{config}
+    , mIsResident(numLayers, false)
+    , mResidentMs(numLayers)
+    , mStreamedMs(numLayers)
+{
+    TLLM_CHECK(numLayers >= 0 && config.numSlots >= 0 && config.maxMigrationsPerUpdate >= 0);
+    TLLM_CHECK(config.decay >= 0.F && config.decay < 1.F && config.hysteresis >= 0.F);
+    mNumResident = std::min(numLayers, config.numSlots);
+    std::fill_n(mIsResident.begin(), mNumResident, true);
+}
+
+float LayerResidencyPolicy::getEstimate(std::vector<std::optional<float>> const& estimates, SizeType32 layer)
+{
+    if (estimates[layer].has_value())
+    {
+        return *estimates[layer];
+    }
+    float sum{0.F};
+    std::size_t count{0};
+    for (auto const& estimate : estimates)
+    {
+        if (estimate.has_value())
+        {
+            sum += *estimate;
+            ++count;
+        }
+    }
+    return count > 0 ? sum / static_cast<float>(count) : 0.F;
+}
+
+float LayerResidencyPolicy::getStallMs(SizeType32 layer) const
+{
+    TLLM_CHECK(layer >= 0 && layer < getNumLayers());
+    return std::max(getEstimate(mStreamedMs, layer) - getEstimate(mResidentMs, layer), 0.F);
+}
+
+LayerResidencyPolicy::Migrations LayerResidencyPolicy::update(std::vector<float> const& layerTimesMs)
+{
+    TLLM_CHECK_WITH_INFO(static_cast<SizeType32>(layerTimesMs.size()) == getNumLayers(),
+        "Expected the times of %d layers, got %zu", getNumLayers(), layerTimesMs.size());
+    for (SizeType32 layer = 0; layer < getNumLayers(); ++layer)
+    {
+        if (layerTimesMs[layer] < 0.F)
+        {
+            continue;
+        }
+        auto& estimate = mIsResident[layer] ? mResidentMs[layer] : mStreamedMs[layer];
+        estimate = estimate.has_value() ? mConfig.decay * *estimate + (1.F - mConfig.decay) * layerTimesMs[layer]
+                                        : layerTimesMs[layer];
+    }
+
+    std::vector<SizeType32> candidates;
+    std::vector<SizeType32> victims;
+    std::vector<float> stalls(getNumLayers());
+    for (SizeType32 layer = 0; layer < getNumLayers(); ++layer)
+    {
+        stalls[layer] = getStallMs(layer);
+        (mIsResident[layer] ? victims : candidates).push_back(layer);
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+        [&stalls](SizeType32 lhs, SizeType32 rhs) { return stalls[lhs] > stalls[rhs]; });
+    std::stable_sort(victims.begin(), victims.end(),
+        [&stalls](SizeType32 lhs, SizeType32 rhs) { return stalls[lhs] < stalls[rhs]; });
+
+    Migrations migrations;
+    std::size_t victimIdx{0};
+    for (auto const layer : candidates)
+    {
+        if (static_cast<SizeType32>(migrations.promotions.size()) >= mConfig.maxMigrationsPerUpdate)
+        {
+            break;
+        }
+        if (mNumResident >= mConfig.numSlots)
+        {
+            if (victimIdx == victims.size() || stalls[layer] <= stalls[victims[victimIdx]] * (1.F + mConfig.hysteresis)
+                || stalls[layer] <= 0.F)
+            {
+                break;
+            }
+            auto const victim = victims[victimIdx++];
+            mIsResident[victim] = false;
+            --mNumResident;
+            migrations.demotions.push_back(victim);
+        }
+        mIsResident[layer] = true;
+        ++mNumResident;
+        migrations.promotions.push_back(layer);
+    }
+    std::sort(migrations.promotions.begin(), migrations.promotions.end());
+    std::sort(migrations.demotions.begin(), migrations.demotions.end());
+    return migrations;
+}
+
+WeightStreamingScheduler::LayerTimeRecorder::LayerTimeRecorder(std::vector<Layer> const& layers)
+    : mTimesMs(layers.size(), -1.F)
+{
+    for (std::size_t pos = 0; pos < layers.size(); ++pos)
+    {
+        mLayerPositions.emplace(layers[pos].layerIdx, pos);
+    }
+}
+
+void WeightStreamingScheduler::LayerTimeRecorder::reportLayerTime(char const* layerName, float timeMs) noexcept
+{
+    auto const layerIdx = getLayerIdx(layerName);
+    if (!layerIdx.has_value())
+    {
+        return;
+    }
+    if (auto const it = mLayerPositions.find(*layerIdx); it != mLayerPositions.end())
+    {
+        auto& time = mTimesMs[it->second];
+        time = std::max(time, 0.F) + timeMs;
+    }
+}
+
+std::vector<float> WeightStreamingScheduler::LayerTimeRecorder::takeTimes()
+{
+    auto times = mTimesMs;
+    std::fill(mTimesMs.begin(), mTimesMs.end(), -1.F);
+    return times;
+}
+
+std::optional<SizeType32> WeightStreamingScheduler::getLayerIdx(std::string const& name)
+{
+    // Weights are named transformer.layers.3.mlp.fc.weight, engine layers transformer/layers/3/mlp/fc/... or so.
+    static std::string const kLayers{"layers"};
+    for (auto pos = name.find(kLayers); pos != std::string::npos; pos = name.find(kLayers, pos + 1))
+    {
+        auto begin = pos + kLayers.size();
+        if (begin >= name.size() || std::isalnum(static_cast<unsigned char>(name[begin])))
+        {
+            continue;
+        }
+        ++begin;
+        auto end = begin;
+        while (end < name.size() && std::isdigit(static_cast<unsigned char>(name[end])))
+        {
+            ++end;
+        }
+        // At most 9 digits, so that the index fits.
+        if (end > begin && end - begin <= 9
+            && (end == name.size() || !std::isalnum(static_cast<unsigned char>(name[end]))))
+        {
+            return static_cast<SizeType32>(std::stoi(name.substr(begin, end - begin)));
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<WeightStreamingScheduler::Layer> WeightStreamingScheduler::makeLayers(TensorMap const& weights)
+{
+    std::map<SizeType32, Layer> layers;
+    for (auto const& [name, weight] : weights)
+    {
+        auto const layerIdx = getLayerIdx(name);
+        if (!layerIdx.has_value())
+        {
+            continue;
+        }
+        TLLM_CHECK_WITH_INFO(weight->getMemoryType() == MemoryType::kPINNED
+                || weight->getMemoryType() == MemoryType::kPINNEDPOOL,
+            "Streamed weight %s must be in pinned host memory", name.c_str());
+        auto& layer = layers.try_emplace(*layerIdx, Layer{*layerIdx}).first->second;
+        layer.names.push_back(name);
+        layer.sizeInBytes += alignWeightSize(weight->getSizeInBytes());
+    }
+    std::vector<Layer> result;
+    result.reserve(layers.size());
+    for (auto& [layerIdx, layer] : layers)
+    {
+        std::sort(layer.names.begin(), layer.names.end());
+        result.push_back(std::move(layer));
+    }
+    return result;
+}
+
+WeightStreamingScheduler::WeightStreamingScheduler(
+    TensorMap weights, std::size_t deviceBudget, SizeType32 profileInterval, BufferManager const& manager)
+    : mHostWeights{std::move(weights)}
+    , mBindings{mHostWeights}
+    , mLayers{makeLayers(mHostWeights)}
+    , mSlotSize{std::accumulate(mLayers.begin(), mLayers.end(), std::size_t{0},
+          [](std::size_t size, Layer const& layer) { return std::max(size, layer.sizeInBytes); })}
+    , mPolicy{static_cast<SizeType32>(mLayers.size()),
+          LayerResidencyPolicy::Config{static_cast<SizeType32>(
+              mSlotSize > 0 ? std::min(mLayers.size(), deviceBudget / mSlotSize) : mLayers.size())}}
+    , mCopyStream{std::make_shared<CudaStream>()}
+    , mProfileInterval{profileInterval}
+    , mRecorder{mLayers}
+{
+    TLLM_CHECK_WITH_INFO(profileInterval >= 0, "The profile interval of weight streaming must not be negative");
+    auto const numSlots = mPolicy.getNumResident();
+    if (numSlots > 0 && mSlotSize > 0)
+    {
+        mSlots = manager.gpu(static_cast<std::size_t>(numSlots) * mSlotSize);
+    }
+    for (auto slot = numSlots - 1; slot >= 0; --slot)
+    {
+        mFreeSlots.push_back(slot);
+    }
+    for (SizeType32 layer = 0; layer < mPolicy.getNumLayers(); ++layer)
+    {
+        if (mPolicy.isResident(layer))
+        {
+            mLayers[layer].slot = mFreeSlots.back();
+            mFreeSlots.pop_back();
+            copyToSlot(layer);
+            setLayerBindings(layer);
+        }
+    }
+    mCopyStream->synchronize();
+    TLLM_LOG_INFO("Streaming the managed weights of %d of %zu layers, %d slots of %zu bytes on the device",
+        mPolicy.getNumLayers() - numSlots, mLayers.size(), numSlots, mSlotSize);
+}
+
+void WeightStreamingScheduler::copyToSlot(SizeType32 layerIdx)
+{
+    auto const& layer = mLayers.at(layerIdx);
+    TLLM_CHECK(layer.slot.has_value());
+    auto* dst = static_cast<std::uint8_t*>(mSlots->data()) + static_cast<std::size_t>(*layer.slot) * mSlotSize;
+    for (auto const& name : layer.names)
+    {
+        auto const& weight = *mHostWeights.at(name);
+        TLLM_CUDA_CHECK(cudaMemcpyAsync(
+            dst, weight.data(), weight.getSizeInBytes(), cudaMemcpyHostToDevice, mCopyStream->get()));
+        dst += alignWeightSize(weight.getSizeInBytes());
+    }
+    mStats.numPromotedBytes += layer.sizeInBytes;
+}
+
+void WeightStreamingScheduler::setLayerBindings(SizeType32 layerIdx)
+{
+    auto const& layer = mLayers.at(layerIdx);
+    auto* dst = layer.slot.has_value()
+        ? static_cast<std::uint8_t*>(mSlots->data()) + static_cast<std::size_t>(*layer.slot) * mSlotSize
+        : nullptr;
+    for (auto const& name : layer.names)
+    {
+        auto const& weight = mHostWeights.at(name);
+        if (dst == nullptr)
+        {
+            mBindings[name] = weight;
+            continue;
+        }
+        mBindings[name] = ITensor::wrap(dst, weight->getDataType(), weight->getShape());
+        dst += alignWeightSize(weight->getSizeInBytes());
+    }
+    ++mVersion;
+}
+
+void WeightStreamingScheduler::bind(SizeType32 contextIndex, nvinfer1::IExecutionContext& context)
+{
+    if (!mPendingPromotions.empty() && cudaEventQuery(mCopiesDone.get()) == cudaSuccess)
+    {
+        for (auto const layer : mPendingPromotions)
+        {
+            setLayerBindings(layer);
+        }
+        mPendingPromotions.clear();
+    }
+    if (static_cast<std::size_t>(contextIndex) >= mBoundVersions.size())
+    {
+        // The contexts that exist are bound with the static input tensors when the weights are loaded.
+        mBoundVersions.resize(contextIndex + 1, mVersion);
+    }
+    if (mBoundVersions[contextIndex] == mVersion)
+    {
+        return;
+    }
+    for (auto const& [name, weight] : mBindings)
+    {
+        if (getLayerIdx(name).has_value())
+        {
+            TLLM_CHECK_WITH_INFO(context.setInputTensorAddress(name.c_str(), weight->data()),
+                "Failed to bind streamed weight %s", name.c_str());
+        }
+    }
+    mBoundVersions[contextIndex] = mVersion;
+}
+
+nvinfer1::IProfiler* WeightStreamingScheduler::getProfiler() noexcept
+{
+    // Migrations in flight are not measured, the next profiled step waits for them to land.
+    mProfiling = mProfileInterval > 0 && isStreaming() && mPendingPromotions.empty() && mStep % mProfileInterval == 0;
+    return mProfiling ? &mRecorder : nullptr;
+}
+
+void WeightStreamingScheduler::onStepEnqueued(CudaStream const& computeStream)
+{
+    ++mStep;
+    if (!mProfiling)
+    {
+        return;
+    }
+    mProfiling = false;
+    ++mStats.numProfiledSteps;
+    auto const migrations = mPolicy.update(mRecorder.takeTimes());
+    if (migrations.promotions.empty())
+    {
+        return;
+    }
+    for (auto const layer : migrations.demotions)
+    {
+        mFreeSlots.push_back(mLayers[layer].slot.value());
+        mLayers[layer].slot.reset();
+        setLayerBindings(layer);
+    }
+    // The slots of the demoted layers are only overwritten once the steps enqueued so far are done with them.
+    CudaEvent enqueued;
+    computeStream.record(enqueued);
+    mCopyStream->wait(enqueued);
+    for (auto const layer : migrations.promotions)
+    {
+        TLLM_CHECK(!mFreeSlots.empty());
+        mLayers[layer].slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+        copyToSlot(layer);
+        mPendingPromotions.push_back(layer);
+    }
+    mCopyStream->record(mCopiesDone);
+    mStats.numPromotions += migrations.promotions.size();
+    mStats.numDemotions += migrations.demotions.size();
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <NvInferRuntime.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+/// @brief Decides which decoder layers keep their weights in the device slots of a WeightStreamingScheduler.
+/// @details Every layer has two estimates of its time, in profiled steps where it was resident and where it was
+/// streamed, decayed exponentially. The stall of a layer is the difference, the estimates a layer has no measurement
+/// for yet are the means of the other layers. Streamed layers with the largest stalls replace the resident layers with
+/// the smallest ones, up to a number of migrations per update.
+class LayerResidencyPolicy
+{
+public:
+    struct Config
+    {
+        /// @brief Layers whose weights fit in the device budget.
+        SizeType32 numSlots;
+        float decay{0.5F};
+        /// @brief Relative margin of stall a swap must gain, so that layers with close stalls do not swap back and
+        /// forth.
+        float hysteresis{0.1F};
+        SizeType32 maxMigrationsPerUpdate{2};
+    };
+
+    struct Migrations
+    {
+        /// @brief Sorted indices of the layers to move to the device, and back to the host.
+        std::vector<SizeType32> promotions;
+        std::vector<SizeType32> demotions;
+    };
+
+    /// @brief The first numSlots layers start resident.
+    LayerResidencyPolicy(SizeType32 numLayers, Config const& config);
+
+    /// @brief Record the times of the layers in a profiled step and decide the migrations that follow.
+    /// @param layerTimesMs Time of every layer in ms, negative for the layers the step did not report.
+    [[nodiscard]] Migrations update(std::vector<float> const& layerTimesMs);
+
+    /// @brief Estimated time the layer spends waiting for its weights when they are streamed, in ms.
+    [[nodiscard]] float getStallMs(SizeType32 layer) const;
+
+    [[nodiscard]] bool isResident(SizeType32 layer) const
+    {
+        return mIsResident.at(layer);
+    }
+
+    [[nodiscard]] SizeType32 getNumLayers() const noexcept
+    {
+        return static_cast<SizeType32>(mIsResident.size());
+    }
+
+    [[nodiscard]] SizeType32 getNumResident() const noexcept
+    {
+        return mNumResident;
+    }
+
+private:
+    [[nodiscard]] static float getEstimate(std::vector<std::optional<float>> const& estimates, SizeType32 layer);
+
+    Config mConfig;
+    std::vector<bool> mIsResident;
+    SizeType32 mNumResident{0};
+    std::vector<std::optional<float>> mResidentMs;
+    std::vector<std::optional<float>> mStreamedMs;
+};
+
+/// @brief Streams the managed weights of the decoder layers that do not fit in the device budget of weight streaming.
+/// @details TensorRT streams the weights built into the engine on its own, with no control over which ones stay
+/// resident. The managed weights are bound by the runtime, so their residency is chosen here: the weights of every
+/// decoder layer have a copy in pinned host memory, and the layers that fit in the budget also get a device slot. The
+/// kernels read the weights of the other layers over the host link while the layer runs.
+///
+/// Every profileInterval steps, a step is profiled and LayerResidencyPolicy swaps the layers that stall the most into
+/// the slots. A promoted layer keeps reading its host copy while its slot is filled on a dedicated copy stream, and
+/// only reads the slot from the first step after the copy lands. A demoted layer reads its host copy from the next
+/// step on, and its slot is reused once the steps enqueued before are done with it.
+class WeightStreamingScheduler
+{
+public:
+    using TensorMap = StringPtrMap<ITensor>;
+
+    struct Stats
+    {
+        std::size_t numProfiledSteps{0};
+        std::size_t numPromotions{0};
+        std::size_t numDemotions{0};
+        std::size_t numPromotedBytes{0};
+    };
+
+    /// @param weights The managed weights, the ones of decoder layers in pinned host memory and the others on the
+    /// device.
+    /// @param deviceBudget Bytes of device memory for the managed weights of the decoder layers.
+    /// @param profileInterval Steps between two profiled steps, 0 to keep the initial residency.
+    WeightStreamingScheduler(
+        TensorMap weights, std::size_t deviceBudget, SizeType32 profileInterval, BufferManager const& manager);
+
+    /// @brief Index of the decoder layer of a weight or of an engine layer, e.g. 3 for transformer.layers.3.mlp.fc.
+    [[nodiscard]] static std::optional<SizeType32> getLayerIdx(std::string const& name);
+
+    /// @brief Whether some decoder layer is streamed from the host.
+    [[nodiscard]] bool isStreaming() const noexcept
+    {
+        return mPolicy.getNumResident() < mPolicy.getNumLayers();
+    }
+
+    /// @brief The weights the next step reads, device slots of the resident layers and host copies of the others.
+    [[nodiscard]] TensorMap const& getBindings() const noexcept
+    {
+        return mBindings;
+    }
+
+    /// @brief Land the promotions whose copies completed, and bind the weights to the context if they changed since
+    /// its last step.
+    void bind(SizeType32 contextIndex, nvinfer1::IExecutionContext& context);
+
+    /// @brief The profiler to set on the context for the next step, null when the step is not profiled.
+    [[nodiscard]] nvinfer1::IProfiler* getProfiler() noexcept;
+
+    /// @brief Record the layer times of a profiled step once it is enqueued on computeStream, and start the migrations
+    /// they lead to.
+    void onStepEnqueued(CudaStream const& computeStream);
+
+    [[nodiscard]] LayerResidencyPolicy const& getPolicy() const noexcept
+    {
+        return mPolicy;
+    }
+
+    [[nodiscard]] Stats const& getStats() const noexcept
+    {
+        return mStats;
+    }
+
+private:
+    struct Layer
+    {
+        // Index of the decoder layer in the model, the scheduler only knows the layers with managed weights.
+        SizeType32 layerIdx;
+        std::vector<std::string> names;
+        std::size_t sizeInBytes{0};
+        std::optional<SizeType32> slot;
+    };
+
+    // Sums the times of the engine layers of every decoder layer.
+    class LayerTimeRecorder : public nvinfer1::IProfiler
+    {
+    public:
+        explicit LayerTimeRecorder(std::vector<Layer> const& layers);
+
+        void reportLayerTime(char const* layerName, float timeMs) noexcept override;
+
+        [[nodiscard]] std::vector<float> takeTimes();
+
+    private:
+        std::map<SizeType32, std::size_t> mLayerPositions;
+        std::vector<float> mTimesMs;
+    };
+
+    [[nodiscard]] static std::vector<Layer> makeLayers(TensorMap const& weights);
+
+    /// @brief Point the bindings of the layer to its slot, or to its host copies without one.
+    void setLayerBindings(SizeType32 layerIdx);
+
+    /// @brief Enqueue the copies of the host copies of the layer to its slot on the copy stream.
+    void copyToSlot(SizeType32 layerIdx);
+
+    TensorMap mHostWeights;
+    TensorMap mBindings;
+    std::vector<Layer> mLayers;
+    std::size_t mSlotSize;
+    LayerResidencyPolicy mPolicy;
+    BufferManager::IBufferPtr mSlots;
+    std::vector<SizeType32> mFreeSlots;
+
+    BufferManager::CudaStreamPtr mCopyStream;
+    CudaEvent mCopiesDone;
+    std::vector<SizeType32> mPendingPromotions;
+
+    // Bumped whenever the bindings change, contexts bound to an older version are bound again.
+    std::uint64_t mVersion{1};
+    std::vector<std::uint64_t> mBoundVersions;
+
+    SizeType32 mProfileInterval;
+    std::uint64_t mStep{0};
+    bool mProfiling{false};
+    LayerTimeRecorder mRecorder;
+    Stats mStats;
+};
+
+} // namespace tensorrt_llm::runtime
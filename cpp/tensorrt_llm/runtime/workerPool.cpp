@@ -15,57 +15,149 @@
  */
 
 #include "workerPool.h"
+#include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/numaUtils.h"
 
 namespace tensorrt_llm::runtime
 {
-WorkerPool::WorkerPool(std::size_t numWorkers, std::int32_t deviceId)
+
+namespace
+{
+// Pool and queue of the worker running on this thread, to keep the tasks it enqueues in its own queue.
+thread_local WorkerPool const* tCurrentPool{nullptr};
+thread_local std::size_t tCurrentWorker{0};
+} // namespace
+
+WorkerPool::WorkerPool(std::size_t numWorkers, std::int32_t deviceId, std::vector<int> cpuAffinity)
 {
+    TLLM_CHECK_WITH_INFO(numWorkers > 0, "A WorkerPool needs at least one worker");
+    mQueues.reserve(numWorkers);
     for (std::size_t i = 0; i < numWorkers; ++i)
     {
-        mWorkers.emplace_back(
-            [this, deviceId]
-            {
-                if (deviceId >= 0)
-                {
-                    TLLM_CUDA_CHECK(cudaSetDevice(deviceId));
-                }
-                else
-                {
-                    TLLM_LOG_WARNING("WorkerPool did not set cuda device");
-                }
-
-                while (true)
-                {
-                    std::function<void()> task;
-
-                    {
-                        std::unique_lock<std::mutex> lock(this->mQueueMutex);
-                        this->condition.wait(lock, [this] { return this->stop || !this->mTasks.empty(); });
-                        if (this->stop && this->mTasks.empty())
-                        {
-                            return;
-                        }
-                        task = std::move(this->mTasks.front());
-                        this->mTasks.pop();
-                    }
-
-                    task();
-                }
-            });
+        mQueues.push_back(std::make_unique<WorkQueue>());
+    }
+    for (std::size_t i = 0; i < numWorkers; ++i)
+    {
+        mWorkers.emplace_back([this, i, deviceId, cpuAffinity] { work(i, deviceId, cpuAffinity); });
     }
 }
 
 WorkerPool::~WorkerPool()
 {
     {
-        std::unique_lock<std::mutex> lock(mQueueMutex);
-        stop = true;
+        std::unique_lock<std::mutex> lock(mWakeMutex);
+        mStop = true;
     }
-    condition.notify_all();
+    mWake.notify_all();
     for (std::thread& worker : mWorkers)
     {
         worker.join();
     }
 }
+
+void WorkerPool::push(Task task, Priority priority)
+{
+    WorkQueue* queue = &mHighPriorityQueue;
+    if (priority == Priority::kNORMAL)
+    {
+        auto const queueIdx = tCurrentPool == this ? tCurrentWorker : mNextQueue++ % mQueues.size();
+        queue = mQueues[queueIdx].get();
+    }
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(mWakeMutex);
+        ++mNumPending;
+    }
+    mWake.notify_one();
+}
+
+bool WorkerPool::tryPop(std::size_t workerIdx, Task& task)
+{
+    auto const popFront = [&task](WorkQueue& queue)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+        {
+            return false;
+        }
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    };
+
+    if (popFront(mHighPriorityQueue) || popFront(*mQueues[workerIdx]))
+    {
+        return true;
+    }
+    for (std::size_t offset = 1; offset < mQueues.size(); ++offset)
+    {
+        auto& victim = *mQueues[(workerIdx + offset) % mQueues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            // The back is the newest task, the victim keeps the ones it is about to run.
+            task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            ++mNumStolen;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::work(std::size_t workerIdx, std::int32_t deviceId, std::vector<int> const& cpuAffinity)
+{
+    if (deviceId >= 0)
+    {
+        TLLM_CUDA_CHECK(cudaSetDevice(deviceId));
+    }
+    else
+    {
+        TLLM_LOG_WARNING("WorkerPool did not set cuda device");
+    }
+    if (!cpuAffinity.empty())
+    {
+        common::bindThreadToCpus(cpuAffinity);
+    }
+    else if (deviceId >= 0)
+    {
+        if (auto const numaNode = common::getNumaBindingNode(deviceId))
+        {
+            common::bindThreadToNumaNode(*numaNode);
+        }
+    }
+    tCurrentPool = this;
+    tCurrentWorker = workerIdx;
+
+    while (true)
+    {
+        Task task;
+        if (tryPop(workerIdx, task))
+        {
+            --mNumPending;
+            try
+            {
+                task();
+            }
+            catch (std::exception const& e)
+            {
+                // Only the detached tasks throw, the others keep the exception in their future.
+                TLLM_LOG_EXCEPTION(e);
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mWakeMutex);
+        mWake.wait(lock, [this] { return mStop || mNumPending > 0; });
+        if (mStop && mNumPending <= 0)
+        {
+            return;
+        }
+    }
+}
 } // namespace tensorrt_llm::runtime
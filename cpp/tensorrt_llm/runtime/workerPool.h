@@ -16,24 +16,147 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <new>
 #include <thread>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace tensorrt_llm::runtime
 {
 
+//! \brief Pool of host threads with a queue per worker and work stealing.
+//! \details Tasks enqueued from outside of the pool are spread round-robin over the queues of the workers, tasks
+//! enqueued by a worker go to its own queue. An idle worker steals from the back of the other queues. High priority
+//! tasks, e.g. latency critical response building, sit in a separate lane that every worker serves first, ahead of
+//! background work such as LoRA host cache loads. Tasks are stored inline when small, so enqueueDetached does not
+//! allocate.
 class WorkerPool
 {
 public:
-    explicit WorkerPool(std::size_t numWorkers = 1, std::int32_t deviceId = -1);
+    enum class Priority : std::int8_t
+    {
+        kHIGH,
+        kNORMAL
+    };
+
+    //! \brief Move-only callable, stored inline when it fits in kInlineSize bytes.
+    class Task
+    {
+    public:
+        static std::size_t constexpr kInlineSize{48};
+
+        Task() noexcept = default;
+
+        template <class F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+        explicit Task(F&& f)
+        {
+            using Fn = std::decay_t<F>;
+            if constexpr (sizeof(Fn) <= kInlineSize && alignof(Fn) <= alignof(std::max_align_t)
+                && std::is_nothrow_move_constructible_v<Fn>)
+            {
+                new (&mStorage) Fn(std::forward<F>(f));
+                mOps = &kInlineOps<Fn>;
+            }
+            else
+            {
+                new (&mStorage) Fn*(new Fn(std::forward<F>(f)));
+                mOps = &kHeapOps<Fn>;
+            }
+        }
+
+        Task(Task&& other) noexcept
+        {
+            moveFrom(other);
+        }
+
+        Task& operator=(Task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                moveFrom(other);
+            }
+            return *this;
+        }
+
+        Task(Task const&) = delete;
+        Task& operator=(Task const&) = delete;
+
+        ~Task()
+        {
+            reset();
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return mOps != nullptr;
+        }
+
+        void operator()()
+        {
+            assert(mOps != nullptr);
+            mOps->invoke(&mStorage);
+        }
+
+    private:
+        struct Ops
+        {
+            void (*invoke)(void* storage);
+            void (*move)(void* dst, void* src);
+            void (*destroy)(void* storage);
+        };
+
+        template <class Fn>
+        static constexpr Ops kInlineOps{[](void* storage) { (*static_cast<Fn*>(storage))(); },
+            [](void* dst, void* src)
+            {
+                new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+                static_cast<Fn*>(src)->~Fn();
+            },
+            [](void* storage) { static_cast<Fn*>(storage)->~Fn(); }};
+
+        template <class Fn>
+        static constexpr Ops kHeapOps{[](void* storage) { (**static_cast<Fn**>(storage))(); },
+            [](void* dst, void* src) { new (dst) Fn*(*static_cast<Fn**>(src)); },
+            [](void* storage) { delete *static_cast<Fn**>(storage); }};
+
+        void moveFrom(Task& other) noexcept
+        {
+            mOps = std::exchange(other.mOps, nullptr);
+            if (mOps != nullptr)
+            {
+                mOps->move(&mStorage, &other.mStorage);
+            }
+        }
+
+        void reset() noexcept
+        {
+            if (mOps != nullptr)
+            {
+                mOps->destroy(&mStorage);
+                mOps = nullptr;
+            }
+        }
+
+        alignas(std::max_align_t) unsigned char mStorage[kInlineSize];
+        Ops const* mOps{nullptr};
+    };
+
+    //! \param deviceId Device the workers set, none if negative.
+    //! \param cpuAffinity CPUs the workers run on. If empty, the workers of a device run on its NUMA node when
+    //! TRTLLM_NUMA_BINDING is enabled.
+    explicit WorkerPool(std::size_t numWorkers = 1, std::int32_t deviceId = -1, std::vector<int> cpuAffinity = {});
 
     WorkerPool(WorkerPool const&) = delete;
     WorkerPool(WorkerPool&&) = delete;
@@ -42,44 +165,58 @@ public:
     ~WorkerPool();
 
     template <class F>
-    auto enqueue(F&& task) -> std::future<typename std::invoke_result<F>::type>
+    auto enqueue(F&& task, Priority priority = Priority::kNORMAL) -> std::future<typename std::invoke_result<F>::type>
     {
         using returnType = typename std::invoke_result<F>::type;
-        auto const taskPromise = std::make_shared<std::promise<returnType>>();
-        {
-            std::lock_guard<std::mutex> lock(mQueueMutex);
-            mTasks.push(
-                [task = std::forward<F>(task), taskPromise]()
-                {
-                    try
-                    {
-                        if constexpr (std::is_void_v<returnType>)
-                        {
-                            task();
-                            taskPromise->set_value();
-                        }
-                        else
-                        {
-                            taskPromise->set_value(task());
-                        }
-                    }
-                    catch (...)
-                    {
-                        taskPromise->set_exception(std::current_exception());
-                    }
-                });
-        }
-        condition.notify_one();
-        return taskPromise->get_future();
+        std::packaged_task<returnType()> packagedTask{std::forward<F>(task)};
+        auto future = packagedTask.get_future();
+        push(Task{std::move(packagedTask)}, priority);
+        return future;
+    }
+
+    //! \brief Enqueue a task without a future. Its exceptions are logged.
+    template <class F>
+    void enqueueDetached(F&& task, Priority priority = Priority::kNORMAL)
+    {
+        push(Task{std::forward<F>(task)}, priority);
+    }
+
+    [[nodiscard]] std::size_t getNumWorkers() const noexcept
+    {
+        return mWorkers.size();
+    }
+
+    //! \brief Number of tasks run by another worker than the one they were queued to.
+    [[nodiscard]] std::size_t getNumStolen() const noexcept
+    {
+        return mNumStolen;
     }
 
 private:
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void push(Task task, Priority priority);
+
+    //! \brief Next task of a worker: the high priority lane, then its own queue, then the back of the others.
+    bool tryPop(std::size_t workerIdx, Task& task);
+
+    void work(std::size_t workerIdx, std::int32_t deviceId, std::vector<int> const& cpuAffinity);
+
     std::vector<std::thread> mWorkers;
-    std::queue<std::function<void()>> mTasks;
+    std::vector<std::unique_ptr<WorkQueue>> mQueues;
+    WorkQueue mHighPriorityQueue;
+    std::atomic<std::size_t> mNextQueue{0};
+    std::atomic<std::size_t> mNumStolen{0};
 
-    std::mutex mQueueMutex;
-    std::condition_variable condition;
-    bool stop{};
+    // Tasks in the queues, transiently negative when a task is popped before its push is counted.
+    std::atomic<std::int64_t> mNumPending{0};
+    std::mutex mWakeMutex;
+    std::condition_variable mWake;
+    bool mStop{false};
 };
 
 } // namespace tensorrt_llm::runtime
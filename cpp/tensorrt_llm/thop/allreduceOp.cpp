@@ -21,6 +21,7 @@
 #include "tensorrt_llm/common/opUtils.h"
 #include "tensorrt_llm/kernels/customAllReduceKernels.h"
 #include "tensorrt_llm/kernels/userbuffers/ub_interface.h"
+#include "tensorrt_llm/runtime/nvlsCommunicator.h"
 #include "tensorrt_llm/runtime/torchUtils.h"
 #include "tensorrt_llm/thop/thUtils.h"
 #include <nvml.h>
@@ -34,6 +35,8 @@
 using tensorrt_llm::kernels::AllReduceFusionOp;
 using tensorrt_llm::kernels::AllReduceStrategyType;
 using tensorrt_llm::kernels::AllReduceStrategyConfig;
+using tensorrt_llm::utils::customAllReduceUtils::AllReduceStrategyProfile;
+using tensorrt_llm::utils::customAllReduceUtils::AllReduceTopology;
 
 namespace torch_ext
 {
@@ -164,6 +167,10 @@ public:
         {
             runtimeStrategy = AllReduceStrategyType::NCCL;
         }
+        else if (mStrategy == AllReduceStrategyType::NVLS)
+        {
+            runtimeStrategy = selectNvlsImplementation(size, input.size(-1));
+        }
         else
         {
             runtimeStrategy = selectImplementation(size, mGroup.size(), mType);
@@ -193,6 +200,11 @@ public:
             TLLM_LOG_DEBUG("AllReducePlugin strategy for rank %d: UB", rank);
             break;
         }
+        case AllReduceStrategyType::NVLS:
+        {
+            TLLM_LOG_DEBUG("AllReducePlugin strategy for rank %d: NVLS", rank);
+            break;
+        }
         default: break;
         }
 
@@ -223,6 +235,25 @@ public:
             finalOutput = torch::from_blob(ub_buffer1.addr, input.sizes(), input.strides(),
                 torch::dtype(torch::kFloat8_e4m3fn).device(torch::kCUDA));
         }
+        else if (runtimeStrategy == AllReduceStrategyType::NVLS)
+        {
+            output = torch::empty_like(input);
+            if (mOp == AllReduceFusionOp::RESIDUAL_RMS_NORM)
+            {
+                finalOutput = torch::empty_like(input);
+                int fusion_ptr_idx = 0;
+                void const* bias = mBias ? reduce_fusion_inputs[fusion_ptr_idx++].data_ptr() : nullptr;
+                void const* residual = reduce_fusion_inputs[fusion_ptr_idx++].data_ptr();
+                void const* weight = mAffine ? reduce_fusion_inputs[fusion_ptr_idx++].data_ptr() : nullptr;
+                mNvlsComm->allReduceResidualRmsNorm(input.data_ptr(), residual, bias, weight,
+                    finalOutput.mutable_data_ptr(), output.mutable_data_ptr(), size, input.size(-1), mEps, mType,
+                    stream);
+            }
+            else
+            {
+                mNvlsComm->allReduce(input.data_ptr(), output.mutable_data_ptr(), size, mType, stream);
+            }
+        }
         else if (runtimeStrategy == AllReduceStrategyType::NCCL)
         {
             output = torch::empty_like(input);
@@ -298,7 +329,13 @@ public:
             {
                 params.local_output_buffer_ptr = output.mutable_data_ptr();
             }
-            tensorrt_llm::kernels::customAllReduce(params, mType, runtimeStrategy, mConfig, mOp, stream);
+            auto config = mConfig;
+            if (mStrategy == AllReduceStrategyType::AUTO)
+            {
+                config = AllReduceStrategyProfile::getActive()->selectConfig(mTopology, static_cast<int>(tpSize),
+                    size * tensorrt_llm::common::getDTypeSize(mType), mConfig);
+            }
+            tensorrt_llm::kernels::customAllReduce(params, mType, runtimeStrategy, config, mOp, stream);
         }
 
         if (mOp == AllReduceFusionOp::RESIDUAL_RMS_NORM)
@@ -319,6 +356,11 @@ public:
         {
             initGroupTopology();
         }
+        if (mStrategy == AllReduceStrategyType::NVLS && mTopology == AllReduceTopology::kNVSWITCH
+            && tensorrt_llm::runtime::NvlsCommunicator::isSupported())
+        {
+            mNvlsComm = tensorrt_llm::runtime::NvlsCommunicator::getComm(mGroup);
+        }
 
         TLLM_LOG_TRACE("%s stop for rank %d", __PRETTY_FUNCTION__, COMM_SESSION.getRank());
         return 0;
@@ -327,16 +369,17 @@ public:
 private:
     void initGroupTopology() noexcept
     {
-        static std::map<std::set<int>, std::tuple<bool, bool>> cache;
+        static std::map<std::set<int>, std::tuple<bool, bool, AllReduceTopology>> cache;
         if (cache.find(mGroup) != cache.end())
         {
-            auto [isNVLINKSupported, isP2PSupported] = cache[mGroup];
+            auto [isNVLINKSupported, isP2PSupported, topology] = cache[mGroup];
             mIsNVLINKSupported = isNVLINKSupported;
             mIsP2PSupported = isP2PSupported;
+            mTopology = topology;
             return;
         }
         setGroupTopology();
-        cache[mGroup] = {mIsNVLINKSupported, mIsP2PSupported};
+        cache[mGroup] = {mIsNVLINKSupported, mIsP2PSupported, mTopology};
     }
 
     void setGroupTopology() noexcept
@@ -348,6 +391,7 @@ private:
         {
             mIsP2PSupported = false;
             mIsNVLINKSupported = false;
+            mTopology = AllReduceTopology::kINTER_NODE;
             TLLM_LOG_INFO("Found inter-node TP group for rank %d", rank);
             return;
         }
@@ -357,6 +401,8 @@ private:
         std::unordered_set<int> visitedDevice;
         mIsP2PSupported = true;
         mIsNVLINKSupported = true;
+        mTopology = AllReduceTopology::kPCIE;
+        bool isNVSwitch = false;
 
         // Use cudaDeviceCanAccessPeer to determine whether p2p is supported,
         // and use nvml to determine whether there are nvlink links between ranks.
@@ -427,6 +473,7 @@ private:
                             if (strcmp(remotePciInfo.busId, secondRemotePciInfo.busId) == 0)
                             {
                                 isNVLINK = true;
+                                isNVSwitch = true;
                                 break;
                             }
                         }
@@ -446,6 +493,28 @@ private:
             }
             visitedDevice.insert(firstDeviceId);
         }
+        if (mIsNVLINKSupported)
+        {
+            mTopology = isNVSwitch ? AllReduceTopology::kNVSWITCH : AllReduceTopology::kNVLINK;
+        }
+    }
+
+    AllReduceStrategyType selectNvlsImplementation(size_t messageSize, int hiddenSize) noexcept
+    {
+        if (mNvlsComm == nullptr)
+        {
+            TLLM_LOG_WARNING("Since NVLS multicast not supported, fallback to AllReduceStrategy: NCCL");
+            return AllReduceStrategyType::NCCL;
+        }
+        bool const fused = mOp == AllReduceFusionOp::RESIDUAL_RMS_NORM;
+        if ((!fused && mOp != AllReduceFusionOp::NONE)
+            || !mNvlsComm->supportsAllReduce(messageSize, mType, fused ? hiddenSize : 0))
+        {
+            TLLM_LOG_WARNING(
+                "Since the message or the fusion is not supported by NVLS, fallback to AllReduceStrategy: NCCL");
+            return AllReduceStrategyType::NCCL;
+        }
+        return AllReduceStrategyType::NVLS;
     }
 
     AllReduceStrategyType selectImplementation(size_t messageSize, int worldSize, nvinfer1::DataType type) noexcept
@@ -461,11 +530,6 @@ private:
             return AllReduceStrategyType::NCCL;
         }
 
-        if (isAuto && !mIsNVLINKSupported)
-        {
-            return AllReduceStrategyType::NCCL;
-        }
-
         auto const maxWorkspaceSize = tensorrt_llm::utils::customAllReduceUtils::getMaxRequiredWorkspaceSize(worldSize);
 
         AllReduceStrategyType strat = AllReduceStrategyType::NCCL;
@@ -480,31 +544,9 @@ private:
             {
                 strat = mStrategy;
             }
-            else if (worldSize <= 2)
-            {
-                strat = AllReduceStrategyType::ONESHOT;
-            }
-            else if (worldSize <= 4)
-            {
-                if (messageSizeBytes < 1 * 1000 * 1000)
-                {
-                    strat = AllReduceStrategyType::ONESHOT;
-                }
-                else
-                {
-                    strat = AllReduceStrategyType::NCCL;
-                }
-            }
             else
             {
-                if (messageSizeBytes < 500 * 1000)
-                {
-                    strat = AllReduceStrategyType::ONESHOT;
-                }
-                else
-                {
-                    strat = AllReduceStrategyType::NCCL;
-                }
+                strat = AllReduceStrategyProfile::getActive()->select(mTopology, worldSize, messageSizeBytes);
             }
 
             if (!tensorrt_llm::kernels::configurationSupported(strat, messageSize, worldSize, type))
@@ -532,12 +574,14 @@ private:
     std::set<int> mGroup;
     bool mIsNVLINKSupported;
     bool mIsP2PSupported;
+    AllReduceTopology mTopology{AllReduceTopology::kINTER_NODE};
     nvinfer1::DataType mType;
     AllReduceStrategyType mStrategy;
     AllReduceStrategyConfig mConfig;
     AllReduceFusionOp mOp;
     float mEps;
     std::shared_ptr<ncclComm_t> mNcclComm;
+    std::shared_ptr<tensorrt_llm::runtime::NvlsCommunicator> mNvlsComm;
     bool mAffine;
     bool mBias;
     bool mScale;
@@ -111,6 +111,11 @@ std::tuple<th::Tensor, th::Tensor> mamba_conv1d(th::Tensor const& input, th::Ten
         params.state_out_ptr = state_out.data_ptr();
         params.state_slot_mapping_ptr = nullptr;
     }
+    params.has_initial_state_ptr = nullptr;
+    params.initial_state_ptr = nullptr;
+    params.num_spec_tokens = 1;
+    params.spec_parent_ptr = nullptr;
+    params.state_snapshot_ptr = nullptr;
 
     c10::ScalarType dtype = input.scalar_type();
 
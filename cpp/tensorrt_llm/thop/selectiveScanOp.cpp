@@ -115,6 +115,10 @@ std::tuple<th::Tensor, th::Tensor> run_selective_scan(th::Tensor const& input, t
         params.x_ptr = state.data_ptr();
         params.slot_mapping_ptr = nullptr;
     }
+    params.has_initial_state_ptr = nullptr;
+    params.num_spec_tokens = 1;
+    params.spec_parent_ptr = nullptr;
+    params.state_snapshot_ptr = nullptr;
 
     if (z.has_value())
     {
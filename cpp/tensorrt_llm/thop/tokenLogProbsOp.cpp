@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/tokenLogProbsKernels.h"
+#include "tensorrt_llm/thop/thUtils.h"
+
+#include <c10/cuda/CUDAStream.h>
+#include <torch/extension.h>
+
+namespace tk = tensorrt_llm::kernels;
+
+namespace torch_ext
+{
+
+namespace
+{
+
+template <typename T>
+void runTokenLogProbs(torch::Tensor& logits, torch::Tensor& targetIds, torch::Tensor& logProbs,
+    torch::Tensor& isGreedy, double temperature)
+{
+    tk::TokenLogProbsParams<T> params;
+    params.logits = get_ptr<T const>(logits);
+    params.targetIds = get_ptr<int32_t const>(targetIds);
+    params.logProbs = get_ptr<float>(logProbs);
+    params.isGreedy = get_ptr<bool>(isGreedy);
+    params.numTokens = static_cast<int32_t>(logits.size(0));
+    params.vocabSize = static_cast<int32_t>(logits.size(1));
+    params.temperature = static_cast<float>(temperature);
+    tk::invokeTokenLogProbs(params, at::cuda::getCurrentCUDAStream(logits.get_device()));
+}
+
+} // namespace
+
+// Scores the target tokens of a prefill from its logits, without the decoder: the log probabilities of the targets
+// over the vocab, and whether each target is the greedy token. Returns ([num_tokens] float32, [num_tokens] bool).
+std::tuple<torch::Tensor, torch::Tensor> token_log_probs(
+    torch::Tensor logits, torch::Tensor target_ids, double const temperature)
+{
+    CHECK_TH_CUDA(logits);
+    CHECK_CONTIGUOUS(logits);
+    CHECK_INPUT(target_ids, torch::kInt32);
+    TORCH_CHECK(logits.dim() == 2, "logits must be [num_tokens, vocab_size]");
+    TORCH_CHECK(target_ids.dim() == 1 && target_ids.size(0) == logits.size(0),
+        "target_ids must be [num_tokens], one target per row of logits");
+
+    auto logProbs = torch::empty({logits.size(0)}, logits.options().dtype(torch::kFloat32));
+    auto isGreedy = torch::empty({logits.size(0)}, logits.options().dtype(torch::kBool));
+    switch (logits.scalar_type())
+    {
+    case torch::kFloat32: runTokenLogProbs<float>(logits, target_ids, logProbs, isGreedy, temperature); break;
+    case torch::kFloat16: runTokenLogProbs<half>(logits, target_ids, logProbs, isGreedy, temperature); break;
+#ifdef ENABLE_BF16
+    case torch::kBFloat16:
+        runTokenLogProbs<__nv_bfloat16>(logits, target_ids, logProbs, isGreedy, temperature);
+        break;
+#endif
+    default: TORCH_CHECK(false, "Invalid datatype. logits must be FP32, FP16 or BF16");
+    }
+    return {logProbs, isGreedy};
+}
+
+} // namespace torch_ext
+
+TORCH_LIBRARY_FRAGMENT(trtllm, m)
+{
+    m.def("token_log_probs(Tensor logits, Tensor target_ids, float temperature=1.0) -> (Tensor, Tensor)");
+}
+
+TORCH_LIBRARY_IMPL(trtllm, CUDA, m)
+{
+    m.impl("token_log_probs", &torch_ext::token_log_probs);
+}
@@ -16,6 +16,7 @@
 
 #include "tensorrt_llm/common/cudaBf16Wrapper.h"
 #include "tensorrt_llm/kernels/cutlass_kernels/cutlass_preprocessors.h"
+#include "tensorrt_llm/kernels/cutlass_kernels/preprocessed_weight_cache.h"
 #include "tensorrt_llm/thop/thUtils.h"
 
 #if defined(TORCH_VERSION_MAJOR)                                                                                       \
@@ -124,7 +125,6 @@ Tensor preprocess_weights_for_mixed_gemm(
     Tensor row_major_quantized_weight, torch::ScalarType quant_type, torch::ScalarType activation_type)
 {
     auto _st = row_major_quantized_weight.scalar_type();
-    CHECK_CPU(row_major_quantized_weight);
     CHECK_CONTIGUOUS(row_major_quantized_weight);
     TORCH_CHECK(_st == torch::kInt8, "Quantized tensor must be int8 dtype");
     check_quant_type_allowed(quant_type);
@@ -144,12 +144,74 @@ Tensor preprocess_weights_for_mixed_gemm(
 
     bool force_interleave = row_major_quantized_weight.dim() == 3; // WAR for MoE 3-D tensors.
 
+    if (row_major_quantized_weight.is_cuda())
+    {
+        // The weights on the GPU are preprocessed there, on the stream of torch.
+        Tensor workspace = torch::empty_like(row_major_quantized_weight);
+        auto stream = at::cuda::getCurrentCUDAStream(row_major_quantized_weight.get_device());
+        preprocess_weights_for_mixed_gemm_cuda(output_byte_ptr, input_byte_ptr, get_ptr<int8_t>(workspace),
+            {num_experts, num_rows, num_cols}, ft_quant_type, force_interleave, stream);
+        return processed_tensor;
+    }
+
     preprocess_weights_for_mixed_gemm(
         output_byte_ptr, input_byte_ptr, {num_experts, num_rows, num_cols}, ft_quant_type, force_interleave);
 
     return processed_tensor;
 }
 
+// Stores weights returned by preprocess_weights_for_mixed_gemm, with the layout of the current GPU, so that the loads
+// of the checkpoint on the GPUs with the same layout skip the preprocessing.
+void save_preprocessed_weights_for_mixed_gemm(Tensor preprocessed_quantized_weight, std::string const& path,
+    torch::ScalarType quant_type, torch::ScalarType activation_type)
+{
+    CHECK_CONTIGUOUS(preprocessed_quantized_weight);
+    TORCH_CHECK(preprocessed_quantized_weight.scalar_type() == torch::kInt8, "Quantized tensor must be int8 dtype");
+    check_quant_type_allowed(quant_type);
+    TORCH_CHECK(preprocessed_quantized_weight.dim() == 2 || preprocessed_quantized_weight.dim() == 3,
+        "Invalid dim. The dim of weight should be 2 or 3");
+
+    QuantType ft_quant_type = get_ft_quant_type(quant_type, activation_type);
+    const size_t bits_in_quant_type = get_weight_quant_bits(ft_quant_type);
+    bool force_interleave = preprocessed_quantized_weight.dim() == 3;
+
+    PreprocessedWeightHeader header;
+    header.quant_type = ft_quant_type;
+    header.layout = get_mixed_gemm_weight_layout(ft_quant_type, force_interleave);
+    header.shape = {size_t(preprocessed_quantized_weight.dim() == 2 ? 1 : preprocessed_quantized_weight.size(0)),
+        size_t(preprocessed_quantized_weight.size(-2)),
+        (8 / bits_in_quant_type) * size_t(preprocessed_quantized_weight.size(-1))};
+    Tensor host_weight = preprocessed_quantized_weight.cpu();
+    save_preprocessed_weights(path, get_ptr<int8_t>(host_weight), header);
+}
+
+// Returns the stored preprocessed weights of shape `quantized_weight_shape`, the shape of the row major quantized
+// weights, or None if the file is missing or stale for the current GPU.
+std::optional<Tensor> load_preprocessed_weights_for_mixed_gemm(std::string const& path,
+    std::vector<int64_t> quantized_weight_shape, torch::ScalarType quant_type, torch::ScalarType activation_type)
+{
+    check_quant_type_allowed(quant_type);
+    TORCH_CHECK(quantized_weight_shape.size() == 2 || quantized_weight_shape.size() == 3,
+        "Invalid dim. The dim of weight should be 2 or 3");
+
+    QuantType ft_quant_type = get_ft_quant_type(quant_type, activation_type);
+    const size_t bits_in_quant_type = get_weight_quant_bits(ft_quant_type);
+    bool force_interleave = quantized_weight_shape.size() == 3;
+    const size_t num_experts = quantized_weight_shape.size() == 2 ? 1 : quantized_weight_shape[0];
+    const size_t num_rows = quantized_weight_shape[quantized_weight_shape.size() - 2];
+    const size_t num_cols = (8 / bits_in_quant_type) * quantized_weight_shape.back();
+
+    // Pinned, so that the copy of the caller to the GPU runs at the bandwidth of the link.
+    Tensor weight = torch::empty(quantized_weight_shape,
+        torch::dtype(torch::kInt8).device(torch::kCPU).pinned_memory(true).requires_grad(false));
+    if (!load_preprocessed_weights(
+            path, get_ptr<int8_t>(weight), {num_experts, num_rows, num_cols}, ft_quant_type, force_interleave))
+    {
+        return std::nullopt;
+    }
+    return weight;
+}
+
 std::vector<Tensor> symmetric_quantize_helper(
     Tensor weight, torch::ScalarType quant_type, bool return_unprocessed_quantized_tensor)
 {
@@ -362,6 +424,14 @@ static auto symmetric_quantize_last_axis_of_batched_matrix
 static auto preprocess_weights_for_mixed_gemm = torch::RegisterOperators(
     "trtllm::preprocess_weights_for_mixed_gemm", &torch_ext::preprocess_weights_for_mixed_gemm);
 
+static auto save_preprocessed_weights_for_mixed_gemm
+    = torch::RegisterOperators("trtllm::save_preprocessed_weights_for_mixed_gemm",
+        &torch_ext::save_preprocessed_weights_for_mixed_gemm);
+
+static auto load_preprocessed_weights_for_mixed_gemm
+    = torch::RegisterOperators("trtllm::load_preprocessed_weights_for_mixed_gemm",
+        &torch_ext::load_preprocessed_weights_for_mixed_gemm);
+
 static auto unpack_int4_packed_tensor_to_int8 = torch::RegisterOperators(
     "trtllm::unpack_int4_packed_tensor_to_int8", &torch_ext::unpack_int4_packed_tensor_to_int8);
 
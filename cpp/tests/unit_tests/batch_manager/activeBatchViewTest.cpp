@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/activeBatchView.h"
+
+#include <memory>
+
+using namespace tensorrt_llm::batch_manager;
+using SizeType32 = ActiveBatchView::SizeType32;
+
+namespace
+{
+std::shared_ptr<LlmRequest> createRequest(
+    LlmRequest::RequestIdType requestId, SizeType32 promptLen, SizeType32 maxNewTokens, SizeType32 seqSlot)
+{
+    auto tokens = std::make_shared<std::vector<LlmRequest::TokenIdType>>(promptLen, 1);
+    auto req = std::make_shared<LlmRequest>(
+        requestId, maxNewTokens, tokens, tensorrt_llm::runtime::SamplingConfig{1}, false);
+    req->mSeqSlot = seqSlot;
+    return req;
+}
+} // namespace
+
+TEST(ActiveBatchViewTest, removeKeepsArraysDense)
+{
+    ActiveBatchView view{8};
+    view.add(createRequest(10, 4, 2, 3));
+    view.add(createRequest(11, 5, 2, 1));
+    view.add(createRequest(12, 6, 2, 6));
+    EXPECT_EQ(view.size(), 3);
+    EXPECT_EQ(view.getIndex(1), 1);
+
+    view.remove(3);
+    EXPECT_EQ(view.size(), 2);
+    EXPECT_EQ(view.getIndex(3), ActiveBatchView::kNoIndex);
+    // The last request takes the index of the removed one.
+    EXPECT_EQ(view.getIndex(6), 0);
+    EXPECT_EQ(view.getRequestIds(), (std::vector<LlmRequest::RequestIdType>{12, 11}));
+    EXPECT_EQ(view.getPromptLens(), (std::vector<SizeType32>{6, 5}));
+    EXPECT_EQ(view.getRequest(0)->mRequestId, 12);
+
+    EXPECT_THROW(view.remove(3), tensorrt_llm::common::TllmException);
+    EXPECT_THROW(view.add(createRequest(13, 4, 2, 1)), tensorrt_llm::common::TllmException);
+}
+
+TEST(ActiveBatchViewTest, generatedTokensAndLengthFinish)
+{
+    ActiveBatchView view{4};
+    view.add(createRequest(1, 4, 2, 0));
+    view.add(createRequest(2, 4, 3, 1));
+    EXPECT_EQ(view.getRemainingTokens(0), 2);
+
+    EXPECT_TRUE(view.addGeneratedTokens({1, 1}).empty());
+    EXPECT_EQ(view.addGeneratedTokens({1, 1}), (std::vector<SizeType32>{0}));
+    EXPECT_TRUE(view.getFlags()[0] & ActiveBatchView::kLengthFinished);
+    EXPECT_EQ(view.getRemainingTokens(0), 0);
+    // A finished request is reported once.
+    EXPECT_EQ(view.addGeneratedTokens({0, 1}), (std::vector<SizeType32>{1}));
+    EXPECT_EQ(view.getNumTokens(), (std::vector<SizeType32>{6, 7}));
+}
+
+TEST(ActiveBatchViewTest, contextStateIsFlushed)
+{
+    ActiveBatchView view{2};
+    auto const req = createRequest(1, 8, 4, 0);
+    view.add(req);
+    EXPECT_EQ(view.getStates()[0], LlmRequestState::kCONTEXT_INIT);
+
+    view.advanceContext(0, 4);
+    EXPECT_EQ(view.getContextPositions()[0], 4);
+    EXPECT_EQ(view.getStates()[0], LlmRequestState::kCONTEXT_INIT);
+    view.advanceContext(0, 4);
+    EXPECT_EQ(view.getStates()[0], LlmRequestState::kGENERATION_IN_PROGRESS);
+    EXPECT_EQ(req->getState(), LlmRequestState::kCONTEXT_INIT);
+
+    view.flushAll();
+    EXPECT_EQ(req->getState(), LlmRequestState::kGENERATION_IN_PROGRESS);
+
+    req->setState(LlmRequestState::kGENERATION_COMPLETE);
+    view.refresh(0);
+    EXPECT_EQ(view.getStates()[0], LlmRequestState::kGENERATION_COMPLETE);
+}
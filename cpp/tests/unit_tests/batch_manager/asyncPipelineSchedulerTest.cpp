@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/asyncPipelineScheduler.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+using namespace tensorrt_llm::batch_manager;
+
+TEST(AsyncPipelineSchedulerTest, keepsMicroBatchesInFlight)
+{
+    AsyncPipelineScheduler scheduler{2};
+    EXPECT_EQ(scheduler.getMaxMicroBatchesInFlight(), 3);
+
+    EXPECT_EQ(scheduler.launch({1, 2}), 0);
+    EXPECT_EQ(scheduler.launch({3}), 1);
+    EXPECT_EQ(scheduler.launch({4, 5}), 2);
+    EXPECT_FALSE(scheduler.canLaunch());
+    EXPECT_EQ(scheduler.getInflightReqIds().size(), 5);
+    EXPECT_THROW(scheduler.launch({6}), tensorrt_llm::common::TllmException);
+
+    EXPECT_EQ(scheduler.getOldestMicroBatchId(), 0);
+    auto const completed = scheduler.complete({2});
+    EXPECT_EQ(completed.microBatchId, 0);
+    EXPECT_EQ(completed.readyRequests, std::vector<AsyncPipelineScheduler::RequestIdType>({1}));
+    EXPECT_EQ(completed.finishedRequests, std::vector<AsyncPipelineScheduler::RequestIdType>({2}));
+    EXPECT_TRUE(scheduler.canLaunch());
+    EXPECT_EQ(scheduler.getInflightReqIds().count(1), 0);
+    EXPECT_EQ(scheduler.getInflightReqIds().count(3), 1);
+}
+
+TEST(AsyncPipelineSchedulerTest, sequencesChangeMicroBatch)
+{
+    AsyncPipelineScheduler scheduler{2, 2};
+    scheduler.launch({1});
+    scheduler.launch({2, 3});
+
+    // Request 1 is back before micro-batch 1 is and joins the next micro-batch with a new request.
+    scheduler.complete({});
+    EXPECT_EQ(scheduler.launch({1, 4}), 2);
+    // A request cannot be in two micro-batches in flight.
+    scheduler.complete({});
+    EXPECT_THROW(scheduler.launch({1}), tensorrt_llm::common::TllmException);
+
+    EXPECT_EQ(scheduler.launch({}), 3);
+    EXPECT_EQ(scheduler.getNumEmptyLaunches(), 1);
+    EXPECT_EQ(scheduler.getNumLaunchedSequences(), 5);
+}
+
+TEST(AsyncPipelineSchedulerTest, rejectsFinishedRequestsOfOtherMicroBatches)
+{
+    EXPECT_THROW(AsyncPipelineScheduler(4, 3), tensorrt_llm::common::TllmException);
+
+    AsyncPipelineScheduler scheduler{1};
+    scheduler.launch({1});
+    scheduler.launch({2});
+    EXPECT_THROW(scheduler.complete({2}), tensorrt_llm::common::TllmException);
+}
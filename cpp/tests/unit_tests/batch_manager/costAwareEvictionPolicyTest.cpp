@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/costAwareEvictionPolicy.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+using namespace tensorrt_llm::batch_manager::eviction_policy;
+using namespace tensorrt_llm::batch_manager::kv_cache_manager;
+using tensorrt_llm::runtime::SizeType32;
+
+namespace
+{
+constexpr double kDepthWeight = 4.0;
+constexpr double kHostCopyDiscount = 0.5;
+
+// Primary blocks only, so that the host copy discount does not apply.
+std::vector<BlockPtr> makeBlocks(SizeType32 numBlocks)
+{
+    std::vector<BlockPtr> blocks;
+    for (SizeType32 i = 0; i < numBlocks; ++i)
+    {
+        blocks.push_back(std::make_shared<KVCacheBlock>(i, tensorrt_llm::kernels::KVCacheIndex{i}));
+    }
+    return blocks;
+}
+
+// H = L + frequency * cost, with cost = 1 + depthWeight / depth.
+double gdsfKey(double inflation, std::uint32_t frequency, SizeType32 depth)
+{
+    return inflation + frequency * (1.0 + kDepthWeight / depth);
+}
+
+// Evict the next block of a cache level, and claim it for new content.
+KVCacheBlock::IdType evict(CostAwareEvictionPolicy& policy, SizeType32 cacheLevel = 0)
+{
+    auto const [block, canOffload] = policy.getFreeBlock(cacheLevel);
+    policy.claimBlock(block);
+    return block->getBlockId();
+}
+} // namespace
+
+TEST(CostAwareEvictionPolicyTest, evictsInGdsfKeyOrder)
+{
+    auto blocks = makeBlocks(4);
+    CostAwareEvictionPolicy policy{kDepthWeight, kHostCopyDiscount};
+    policy.initialize(blocks, {4}, std::nullopt);
+    for (auto const& block : blocks)
+    {
+        policy.claimBlock(block);
+    }
+    // Blocks 0, 1 and 2 are a chain of the reuse tree, block 3 is a root that was reused once.
+    blocks[1]->setPrevBlock(blocks[0]);
+    blocks[2]->setPrevBlock(blocks[1]);
+    policy.releaseBlock(blocks[3]);
+    policy.claimBlock(blocks[3]);
+    EXPECT_EQ(policy.getStats().numHits, 1);
+    EXPECT_EQ(policy.getStats().numMisses, 4);
+
+    for (auto const& block : blocks)
+    {
+        policy.releaseBlock(block);
+    }
+    // Keys 5, 3, 2.33 and 10: the deepest block goes first, the reused root last.
+    std::vector<std::pair<double, KVCacheBlock::IdType>> expected{
+        {gdsfKey(0, 1, 1), 0}, {gdsfKey(0, 1, 2), 1}, {gdsfKey(0, 1, 3), 2}, {gdsfKey(0, 2, 1), 3}};
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(policy.getNumFreeBlocks(0), 4);
+    for (auto const& [key, blockId] : expected)
+    {
+        EXPECT_EQ(evict(policy), blockId) << "key " << key;
+    }
+    EXPECT_EQ(policy.getStats().numEvictions, 4);
+    EXPECT_EQ(policy.getNumFreeBlocks(0), 0);
+}
+
+TEST(CostAwareEvictionPolicyTest, agingRaisesLaterKeys)
+{
+    auto blocks = makeBlocks(3);
+    CostAwareEvictionPolicy policy{kDepthWeight, kHostCopyDiscount};
+    policy.initialize(blocks, {3}, std::nullopt);
+    for (auto const& block : blocks)
+    {
+        policy.claimBlock(block);
+    }
+    // Block 2 is the child of block 1, key 3, block 1 a root, key 5.
+    blocks[2]->setPrevBlock(blocks[1]);
+    policy.releaseBlock(blocks[1]);
+    policy.releaseBlock(blocks[2]);
+    EXPECT_EQ(evict(policy), 2);
+
+    // Block 0 is a root too, but released after the eviction of a block of key 3: its key is 3 + 5. Without aging,
+    // blocks 0 and 1 would have the same key and block 0 would go first.
+    policy.releaseBlock(blocks[0]);
+    EXPECT_GT(gdsfKey(gdsfKey(0, 1, 2), 1, 1), gdsfKey(0, 1, 1));
+    EXPECT_EQ(evict(policy), 1);
+    EXPECT_EQ(evict(policy), 0);
+    EXPECT_EQ(policy.getStats().numEvictions, 3);
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/encoderOutputCache.h"
+
+using namespace tensorrt_llm::batch_manager;
+
+TEST(EncoderOutputCacheIndexTest, evictsLeastRecentlyUsed)
+{
+    EncoderOutputCacheIndex index{100};
+    ASSERT_TRUE(index.insert(1, 40).has_value());
+    auto const noneEvicted = index.insert(2, 40);
+    ASSERT_TRUE(noneEvicted.has_value());
+    EXPECT_TRUE(noneEvicted->empty());
+    EXPECT_EQ(index.getNumBytes(), 80);
+
+    // Input 1 is used again, input 2 makes room for input 3.
+    EXPECT_TRUE(index.touch(1));
+    auto const evicted = index.insert(3, 40);
+    ASSERT_TRUE(evicted.has_value());
+    EXPECT_EQ(*evicted, std::vector<EncoderOutputCacheIndex::InputHash>{2});
+    EXPECT_TRUE(index.contains(1));
+    EXPECT_FALSE(index.contains(2));
+    EXPECT_TRUE(index.contains(3));
+    EXPECT_EQ(index.getNumEntries(), 2);
+    EXPECT_EQ(index.getNumBytes(), 80);
+}
+
+TEST(EncoderOutputCacheIndexTest, rejectsCachedAndOversizedOutputs)
+{
+    EncoderOutputCacheIndex index{100};
+    ASSERT_TRUE(index.insert(1, 60).has_value());
+    EXPECT_FALSE(index.insert(1, 60).has_value());
+    EXPECT_FALSE(index.insert(2, 101).has_value());
+    EXPECT_TRUE(index.contains(1));
+
+    // An output of the whole budget evicts everything else.
+    auto const evicted = index.insert(3, 100);
+    ASSERT_TRUE(evicted.has_value());
+    EXPECT_EQ(*evicted, std::vector<EncoderOutputCacheIndex::InputHash>{1});
+    EXPECT_EQ(index.getNumBytes(), 100);
+
+    index.erase(3);
+    EXPECT_EQ(index.getNumEntries(), 0);
+    EXPECT_EQ(index.getNumBytes(), 0);
+}
+
+TEST(EncoderOutputCacheIndexTest, crossKvUniqueTokensFollowTheInput)
+{
+    auto const tokens = encoder_output_cache::makeCrossKvUniqueTokens(42, 8);
+    auto const sameTokens = encoder_output_cache::makeCrossKvUniqueTokens(42, 8);
+    auto const otherTokens = encoder_output_cache::makeCrossKvUniqueTokens(43, 8);
+    ASSERT_EQ(tokens->size(), 8);
+    EXPECT_EQ(*tokens, *sameTokens);
+    EXPECT_NE(*tokens, *otherTokens);
+    for (std::size_t idx = 0; idx < tokens->size(); ++idx)
+    {
+        EXPECT_GE((*tokens)[idx].tokenId, 0);
+        EXPECT_EQ((*tokens)[idx].tokenExtraId, 42);
+        EXPECT_NE((*tokens)[idx].tokenId, (*otherTokens)[idx].tokenId);
+    }
+}
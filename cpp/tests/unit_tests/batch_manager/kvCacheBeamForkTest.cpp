@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/kvCacheBeamFork.h"
+
+#include <set>
+
+using namespace tensorrt_llm::batch_manager::kv_cache_manager;
+using BlockIds = std::vector<BeamBlockForkTable::BlockIdType>;
+using Copies = std::vector<BeamBlockForkTable::BlockCopy>;
+
+namespace
+{
+constexpr tensorrt_llm::runtime::SizeType32 kTokensPerBlock = 4;
+
+class KVCacheBeamForkTest : public ::testing::Test
+{
+protected:
+    BeamBlockForkTable makeTable(
+        tensorrt_llm::runtime::SizeType32 beamWidth, BlockIds const& contextBlocks, int numContextTokens)
+    {
+        mNextBlockId = 100;
+        return BeamBlockForkTable(
+            kTokensPerBlock, beamWidth, contextBlocks, numContextTokens, [this]() { return mNextBlockId++; },
+            [this](BeamBlockForkTable::BlockIdType blockId) { EXPECT_TRUE(mReleased.insert(blockId).second); });
+    }
+
+    BeamBlockForkTable::BlockIdType mNextBlockId{100};
+    std::set<BeamBlockForkTable::BlockIdType> mReleased;
+};
+} // namespace
+
+TEST_F(KVCacheBeamForkTest, sharedPartialBlockIsForkedOnce)
+{
+    auto table = makeTable(2, {0, 1}, 6);
+    EXPECT_EQ(table.getNumUniqueBlocks(), 2);
+
+    // Both beams write to the shared block 1, only the first one gets a copy.
+    auto const copies = table.advance({0, 0});
+    EXPECT_EQ(copies, (Copies{{1, 100}}));
+    EXPECT_EQ(table.getCacheBlockIds()[0], (BlockIds{0, 100}));
+    EXPECT_EQ(table.getCacheBlockIds()[1], (BlockIds{0, 1}));
+    EXPECT_EQ(table.getNumUniqueBlocks(), 3);
+    EXPECT_EQ(table.getNumTokens(), 7);
+
+    // Beams keep their own parents, nothing is shared anymore.
+    EXPECT_TRUE(table.advance({0, 1}).empty());
+    EXPECT_EQ(table.getNumForkedBlocks(), 1);
+}
+
+TEST_F(KVCacheBeamForkTest, newBlocksArePrivate)
+{
+    auto table = makeTable(2, {0, 1}, 8);
+    EXPECT_TRUE(table.advance({0, 0}).empty());
+    EXPECT_EQ(table.getCacheBlockIds()[0], (BlockIds{0, 1, 100}));
+    EXPECT_EQ(table.getCacheBlockIds()[1], (BlockIds{0, 1, 101}));
+    EXPECT_EQ(table.getNumForkedBlocks(), 0);
+}
+
+TEST_F(KVCacheBeamForkTest, abandonedBeamIsReleased)
+{
+    auto table = makeTable(2, {0}, 3);
+    table.advance({0, 0});
+    EXPECT_EQ(table.getCacheBlockIds()[0], (BlockIds{100}));
+    EXPECT_EQ(table.getCacheBlockIds()[1], (BlockIds{0}));
+
+    // Both beams continue beam 1, the private block of beam 0 is abandoned.
+    table.advance({1, 1});
+    EXPECT_EQ(mReleased, (std::set<BeamBlockForkTable::BlockIdType>{100}));
+    EXPECT_EQ(table.getCacheBlockIds()[0], (BlockIds{0, 101}));
+    EXPECT_EQ(table.getCacheBlockIds()[1], (BlockIds{0, 102}));
+
+    table.release();
+    EXPECT_EQ(mReleased, (std::set<BeamBlockForkTable::BlockIdType>{0, 100, 101, 102}));
+    EXPECT_EQ(table.getNumUniqueBlocks(), 0);
+}
+
+TEST_F(KVCacheBeamForkTest, swappedParentsKeepBlocks)
+{
+    auto table = makeTable(2, {0}, 2);
+    table.advance({0, 0});
+    auto const before = table.getCacheBlockIds();
+
+    // The beams swap their histories, which is free.
+    EXPECT_TRUE(table.advance({1, 0}).empty());
+    EXPECT_EQ(table.getCacheBlockIds()[0], before[1]);
+    EXPECT_EQ(table.getCacheBlockIds()[1], before[0]);
+    EXPECT_TRUE(mReleased.empty());
+}
+
+TEST_F(KVCacheBeamForkTest, invalidParent)
+{
+    auto table = makeTable(2, {0}, 2);
+    EXPECT_THROW(table.advance({0}), tensorrt_llm::common::TllmException);
+    EXPECT_THROW(table.advance({0, 2}), tensorrt_llm::common::TllmException);
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/kvCacheCopyOnWrite.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+
+#include <memory>
+#include <numeric>
+#include <vector>
+
+using namespace tensorrt_llm::batch_manager::kv_cache_manager;
+using tensorrt_llm::runtime::SizeType32;
+namespace tc = tensorrt_llm::common;
+namespace tr = tensorrt_llm::runtime;
+
+namespace
+{
+constexpr SizeType32 kTokensPerBlock = 4;
+constexpr SizeType32 kBlocksInPrimaryPool = 8;
+
+// The pool content of a block, in float elements.
+std::vector<float> readBlock(BlockManager const& blockManager, KVCacheBlock::IdType blockId)
+{
+    auto const& block = blockManager.getBlockById(blockId);
+    auto const slice = tr::ITensor::slice(blockManager.getPrimaryPool(0), block->getMemoryPoolBlockIndex(), 1);
+    std::vector<float> values(slice->getSize());
+    blockManager.getBufferManager().copy(*slice, values.data());
+    blockManager.getBufferManager().getStream().synchronize();
+    return values;
+}
+} // namespace
+
+TEST(KVCacheCopyOnWriteTest, adoptIgnoresFullBlocks)
+{
+    GenerationRequest sequence(1, 8, 1, 4);
+    PartialBlockReuseTracker tracker;
+    tracker.adopt(sequence, 1, kTokensPerBlock, kTokensPerBlock);
+    EXPECT_FALSE(tracker.hasAdoptedBlocks(1));
+    EXPECT_EQ(tracker.getNumAdoptedTokens(), 0);
+
+    tracker.adopt(sequence, 1, 3, kTokensPerBlock);
+    EXPECT_TRUE(tracker.hasAdoptedBlocks(1));
+    EXPECT_EQ(tracker.getNumAdoptedTokens(), 3);
+
+    tracker.release(1);
+    EXPECT_FALSE(tracker.hasAdoptedBlocks(1));
+    // The reuse counter survives the release of its request.
+    EXPECT_EQ(tracker.getNumAdoptedTokens(), 3);
+    EXPECT_THROW(tracker.adopt(sequence, 0, 0, kTokensPerBlock), tc::TllmException);
+}
+
+TEST(KVCacheCopyOnWriteTest, forkOnWriteCopiesSharedBlock)
+{
+    if (tc::getDeviceCount() == 0)
+    {
+        GTEST_SKIP() << "This test cannot run on systems with no devices.";
+    }
+
+    auto const stream = std::make_shared<tr::CudaStream>();
+    BlockManager blockManager(
+        {1}, 4, kTokensPerBlock, kBlocksInPrimaryPool, 0, 4, stream, /*onboardBlocks=*/true);
+    blockManager.allocatePools(nvinfer1::DataType::kFLOAT, false);
+
+    // Two beams sharing both blocks of a prompt of 6 tokens, the second block holding 2 of them.
+    SizeType32 constexpr kBeamWidth = 2;
+    GenerationRequest sequence(1, 6, kBeamWidth, 4);
+    blockManager.addSequence(sequence, 2, 2);
+    auto const sharedIds = sequence.getCacheBlockIds().at(0);
+    ASSERT_EQ(sharedIds.size(), 2);
+    EXPECT_EQ(sequence.getCacheBlockIds().at(1), sharedIds);
+    EXPECT_TRUE(blockManager.getBlockById(sharedIds.at(1))->isShared());
+    EXPECT_EQ(blockManager.getNumFreeBlocks(), kBlocksInPrimaryPool - 2);
+
+    auto const& partial = blockManager.getBlockById(sharedIds.at(1));
+    auto slice = tr::ITensor::slice(blockManager.getPrimaryPool(0), partial->getMemoryPoolBlockIndex(), 1);
+    std::vector<float> content(slice->getSize());
+    std::iota(content.begin(), content.end(), 1.F);
+    blockManager.getBufferManager().copy(content.data(), *slice);
+
+    PartialBlockReuseTracker tracker;
+    tracker.adopt(sequence, 1, 2, kTokensPerBlock);
+    // Writing the first block leaves the adopted block shared.
+    EXPECT_EQ(tracker.forkOnWrite(blockManager, sequence, 3), 0);
+    EXPECT_TRUE(tracker.hasAdoptedBlocks(1));
+
+    EXPECT_EQ(tracker.forkOnWrite(blockManager, sequence, 6), 1);
+    EXPECT_FALSE(tracker.hasAdoptedBlocks(1));
+    EXPECT_EQ(tracker.getNumForkedBlocks(), 1);
+    // Once forked, the next tokens of the block are written in place.
+    EXPECT_EQ(tracker.forkOnWrite(blockManager, sequence, 7), 0);
+
+    auto const& blockIds = sequence.getCacheBlockIds();
+    for (SizeType32 beamIdx = 0; beamIdx < kBeamWidth; ++beamIdx)
+    {
+        EXPECT_EQ(blockIds.at(beamIdx).at(0), sharedIds.at(0));
+        auto const forkedId = blockIds.at(beamIdx).at(1);
+        EXPECT_FALSE(blockManager.getBlockById(forkedId)->isShared());
+        EXPECT_EQ(readBlock(blockManager, forkedId), content) << "beam " << beamIdx;
+    }
+    EXPECT_NE(blockIds.at(0).at(1), blockIds.at(1).at(1));
+    // The first block stays shared, each beam has its own second block.
+    EXPECT_EQ(blockManager.getNumFreeBlocks(), kBlocksInPrimaryPool - 1 - kBeamWidth);
+
+    tracker.release(1);
+    blockManager.releaseBlocks(sequence);
+    EXPECT_EQ(blockManager.getNumFreeBlocks(), kBlocksInPrimaryPool);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/kvCacheHostDirectTier.h"
+
+using namespace tensorrt_llm::batch_manager::kv_cache_manager;
+using SizeType32 = BlockResidencyPolicy::SizeType32;
+
+TEST(BlockResidencyPolicyTest, fillsTheDeviceFirst)
+{
+    BlockResidencyPolicy policy{8, BlockResidencyPolicy::Config{4}};
+    auto const migrations = policy.step({1, 2, 5});
+    EXPECT_EQ(migrations.promotions, (std::vector<SizeType32>{1, 2, 5}));
+    EXPECT_TRUE(migrations.demotions.empty());
+    EXPECT_EQ(policy.getNumOnDevice(), 3);
+    EXPECT_EQ(policy.getStats().numHostReads, 3);
+
+    // Resident blocks are read in place and do not migrate again.
+    auto const again = policy.step({1, 2, 5});
+    EXPECT_TRUE(again.promotions.empty());
+    EXPECT_EQ(policy.getStats().numHostReads, 3);
+}
+
+TEST(BlockResidencyPolicyTest, hotBlocksReplaceColdOnes)
+{
+    BlockResidencyPolicy policy{8, BlockResidencyPolicy::Config{2, 0.5F}};
+    static_cast<void>(policy.step({0, 1}));
+    // Block 1 stays hot, block 0 cools down.
+    static_cast<void>(policy.step({1}));
+    static_cast<void>(policy.step({1}));
+
+    auto const migrations = policy.step({1, 6});
+    EXPECT_EQ(migrations.promotions, (std::vector<SizeType32>{6}));
+    EXPECT_EQ(migrations.demotions, (std::vector<SizeType32>{0}));
+    EXPECT_TRUE(policy.isOnDevice(1));
+    EXPECT_TRUE(policy.isOnDevice(6));
+    EXPECT_FALSE(policy.isOnDevice(0));
+}
+
+TEST(BlockResidencyPolicyTest, keepsBlocksOfTheStepAndLimitsMigrations)
+{
+    BlockResidencyPolicy policy{8, BlockResidencyPolicy::Config{2, 0.9F, 1}};
+    static_cast<void>(policy.step({0}));
+    static_cast<void>(policy.step({1}));
+    EXPECT_EQ(policy.getNumOnDevice(), 2);
+
+    // Both resident blocks are read by the step, so the new blocks are read from the host.
+    auto const migrations = policy.step({0, 1, 3, 4});
+    EXPECT_TRUE(migrations.promotions.empty());
+    EXPECT_TRUE(migrations.demotions.empty());
+
+    // Only one migration per step.
+    auto const next = policy.step({3, 4});
+    EXPECT_EQ(next.promotions.size(), 1);
+    EXPECT_EQ(next.demotions.size(), 1);
+}
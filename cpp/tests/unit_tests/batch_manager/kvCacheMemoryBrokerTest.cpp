@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/kvCacheMemoryBroker.h"
+
+using namespace tensorrt_llm::batch_manager::kv_cache_manager;
+
+namespace
+{
+constexpr std::size_t kBlockSize{1024};
+} // namespace
+
+TEST(KVCacheMemoryBrokerTest, idleModelLendsMemory)
+{
+    KVCacheMemoryBroker broker{100 * kBlockSize};
+    auto const busy = broker.addModel({kBlockSize, 20, 80}, 50);
+    auto const idle = broker.addModel({kBlockSize, 20, 80}, 50);
+
+    // Nobody needs more than it holds, the memory stays where it is.
+    broker.setDemand(busy, 30);
+    broker.setDemand(idle, 10);
+    EXPECT_EQ(broker.getTargetNumBlocks(busy), 50);
+    EXPECT_EQ(broker.getTargetNumBlocks(idle), 50);
+
+    // The busy model borrows everything beyond the guarantee of the idle one, up to its maximum.
+    broker.setDemand(busy, 200);
+    EXPECT_EQ(broker.getTargetNumBlocks(busy), 80);
+    EXPECT_EQ(broker.getTargetNumBlocks(idle), 20);
+
+    // Growing is limited to the memory the idle model gave back.
+    EXPECT_EQ(broker.reserve(busy, 80), 50);
+    broker.release(idle, 30);
+    EXPECT_EQ(broker.reserve(busy, 80), 70);
+    broker.release(idle, 20);
+    EXPECT_EQ(broker.reserve(busy, 80), 80);
+
+    auto const stats = broker.getStats();
+    EXPECT_EQ(stats.numGrows, 2);
+    EXPECT_EQ(stats.numShrinks, 2);
+    EXPECT_EQ(stats.numMappedBytes, 100 * kBlockSize);
+}
+
+TEST(KVCacheMemoryBrokerTest, contendedMemoryIsSplitByWeight)
+{
+    KVCacheMemoryBroker broker{100 * kBlockSize};
+    auto const heavy = broker.addModel({kBlockSize, 10, 100, 3.F}, 10);
+    auto const light = broker.addModel({kBlockSize, 10, 100, 1.F}, 10);
+    broker.setDemand(heavy, 100);
+    broker.setDemand(light, 100);
+    EXPECT_EQ(broker.getTargetNumBlocks(heavy), 70);
+    EXPECT_EQ(broker.getTargetNumBlocks(light), 30);
+
+    // What a model does not need goes to the other one.
+    broker.setDemand(light, 15);
+    EXPECT_EQ(broker.getTargetNumBlocks(heavy), 85);
+    EXPECT_EQ(broker.getTargetNumBlocks(light), 15);
+
+    // Guarantees are kept even without demand.
+    broker.setDemand(light, 0);
+    EXPECT_EQ(broker.getTargetNumBlocks(light), 10);
+}
+
+TEST(KVCacheMemoryBrokerTest, guaranteesMustFitTheBudget)
+{
+    KVCacheMemoryBroker broker{100 * kBlockSize};
+    broker.addModel({kBlockSize, 60, 100}, 60);
+    EXPECT_THROW(broker.addModel({kBlockSize, 50, 100}, 50), tensorrt_llm::common::TllmException);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/kvCachePoolPlanner.h"
+
+using namespace tensorrt_llm::batch_manager::kv_cache_manager;
+using tensorrt_llm::runtime::SizeType32;
+
+namespace
+{
+constexpr SizeType32 kSizePerHead = 64;
+constexpr SizeType32 kMaxSequenceLength = 4096;
+} // namespace
+
+TEST(KVCachePoolPlannerTest, groupsLayersByWindow)
+{
+    // Gemma2-style alternation of sliding window and global layers.
+    std::vector<SizeType32> const numKvHeadsPerLayer(6, 4);
+    KVCachePoolPlannerConfig const config{nvinfer1::DataType::kHALF, 64, nvinfer1::DataType::kFP8, 16};
+    auto const groups = planKVCachePools(numKvHeadsPerLayer, kSizePerHead, {512, kMaxSequenceLength},
+        kMaxSequenceLength, 8, std::size_t{1} << 30, config);
+    ASSERT_EQ(groups.size(), 2);
+
+    auto const& window = groups[0];
+    EXPECT_EQ(window.attentionWindow, 512);
+    EXPECT_EQ(window.layers, (std::vector<SizeType32>{0, 2, 4}));
+    EXPECT_EQ(window.dtype, nvinfer1::DataType::kFP8);
+    EXPECT_EQ(window.tokensPerBlock, 16);
+    EXPECT_EQ(window.getBlockSizeInBytes(kSizePerHead), 3 * 4 * 2 * kSizePerHead * 16);
+    // Capped at what 8 sequences can use.
+    EXPECT_EQ(window.numBlocks, 8 * (512 / 16 + 1));
+
+    auto const& global = groups[1];
+    EXPECT_EQ(global.attentionWindow, kMaxSequenceLength);
+    EXPECT_EQ(global.layers, (std::vector<SizeType32>{1, 3, 5}));
+    EXPECT_EQ(global.dtype, nvinfer1::DataType::kHALF);
+    EXPECT_EQ(global.tokensPerBlock, 64);
+
+    auto const usedBytes = window.numBlocks * window.getBlockSizeInBytes(kSizePerHead)
+        + global.numBlocks * global.getBlockSizeInBytes(kSizePerHead);
+    EXPECT_LE(usedBytes, std::size_t{1} << 30);
+    EXPECT_GT(usedBytes + global.getBlockSizeInBytes(kSizePerHead), std::size_t{1} << 30);
+}
+
+TEST(KVCachePoolPlannerTest, measuredDemand)
+{
+    KVCacheLayerDemand demand({512, kMaxSequenceLength});
+    demand.addSequence(256);
+    demand.addSequence(1024);
+    EXPECT_EQ(demand.getNumSequences(), 2);
+    EXPECT_DOUBLE_EQ(demand.getMeanTokens(512), (256 + 512) / 2.);
+    EXPECT_DOUBLE_EQ(demand.getMeanTokens(kMaxSequenceLength), (256 + 1024) / 2.);
+
+    std::vector<SizeType32> const numKvHeadsPerLayer(2, 8);
+    KVCachePoolPlannerConfig const config{nvinfer1::DataType::kHALF, 32};
+    auto const budget = std::size_t{256} << 20;
+    auto const groups = planKVCachePools(
+        numKvHeadsPerLayer, kSizePerHead, {512, kMaxSequenceLength}, kMaxSequenceLength, 1024, budget, config, demand);
+    ASSERT_EQ(groups.size(), 2);
+    // Both groups have the same block size, so the blocks follow the measured tokens.
+    auto const ratio = static_cast<double>(groups[0].numBlocks) / groups[1].numBlocks;
+    EXPECT_NEAR(ratio, demand.getMeanTokens(512) / demand.getMeanTokens(kMaxSequenceLength), 0.01);
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/kvCacheRadixTree.h"
+
+#include <numeric>
+
+using namespace tensorrt_llm::batch_manager::kv_cache_manager;
+using BlockIds = std::vector<KVCacheRadixTree::BlockIdType>;
+
+namespace
+{
+VecUniqueTokens makeTokens(tensorrt_llm::runtime::TokenIdType first, std::size_t numTokens)
+{
+    VecUniqueTokens tokens(numTokens);
+    for (std::size_t i = 0; i < numTokens; ++i)
+    {
+        tokens[i] = {first + static_cast<tensorrt_llm::runtime::TokenIdType>(i), 0};
+    }
+    return tokens;
+}
+
+VecUniqueTokens concat(VecUniqueTokens a, VecUniqueTokens const& b)
+{
+    a.insert(a.end(), b.begin(), b.end());
+    return a;
+}
+
+constexpr tensorrt_llm::runtime::SizeType32 kTokensPerBlock = 4;
+} // namespace
+
+TEST(KVCacheRadixTreeTest, fullBlockMatch)
+{
+    KVCacheRadixTree tree(kTokensPerBlock);
+    auto const tokens = makeTokens(0, 12);
+    EXPECT_EQ(tree.insert(std::nullopt, tokens, {0, 1, 2}), 3);
+    EXPECT_EQ(tree.getNumBlocks(), 3);
+
+    auto const match = tree.findLongestPrefix(std::nullopt, concat(makeTokens(0, 8), makeTokens(100, 4)));
+    EXPECT_EQ(match.blocks, (BlockIds{0, 1}));
+    EXPECT_EQ(match.numMatchedTokens, 8);
+    EXPECT_FALSE(match.isLastBlockPartial(kTokensPerBlock));
+
+    auto const all = tree.findLongestPrefix(std::nullopt, tokens);
+    EXPECT_EQ(all.blocks, (BlockIds{0, 1, 2}));
+    EXPECT_EQ(all.numMatchedTokens, 12);
+}
+
+TEST(KVCacheRadixTreeTest, partialMatchInsideBlock)
+{
+    KVCacheRadixTree tree(kTokensPerBlock);
+    tree.insert(std::nullopt, makeTokens(0, 8), {0, 1});
+
+    // Diverges after the second token of the second block.
+    auto const match = tree.findLongestPrefix(std::nullopt, concat(makeTokens(0, 6), makeTokens(100, 3)));
+    EXPECT_EQ(match.blocks, (BlockIds{0, 1}));
+    EXPECT_EQ(match.numMatchedTokens, 6);
+    EXPECT_TRUE(match.isLastBlockPartial(kTokensPerBlock));
+    EXPECT_EQ(match.getNumMatchedTokensInLastBlock(kTokensPerBlock), 2);
+
+    // Query shorter than the cached sequence.
+    auto const shorter = tree.findLongestPrefix(std::nullopt, makeTokens(0, 5));
+    EXPECT_EQ(shorter.blocks, (BlockIds{0, 1}));
+    EXPECT_EQ(shorter.numMatchedTokens, 5);
+}
+
+TEST(KVCacheRadixTreeTest, partiallyFilledBlock)
+{
+    KVCacheRadixTree tree(kTokensPerBlock);
+    tree.insert(std::nullopt, makeTokens(0, 6), {0, 1});
+
+    auto const match = tree.findLongestPrefix(std::nullopt, makeTokens(0, 10));
+    EXPECT_EQ(match.blocks, (BlockIds{0, 1}));
+    EXPECT_EQ(match.numMatchedTokens, 6);
+
+    // A full block for the same position is preferred as it covers more tokens.
+    tree.insert(std::nullopt, makeTokens(0, 8), {0, 2});
+    auto const full = tree.findLongestPrefix(std::nullopt, makeTokens(0, 10));
+    EXPECT_EQ(full.blocks, (BlockIds{0, 2}));
+    EXPECT_EQ(full.numMatchedTokens, 8);
+}
+
+TEST(KVCacheRadixTreeTest, branchesShareBlocks)
+{
+    KVCacheRadixTree tree(kTokensPerBlock);
+    tree.insert(std::nullopt, concat(makeTokens(0, 4), makeTokens(10, 4)), {0, 1});
+    EXPECT_EQ(tree.insert(std::nullopt, concat(makeTokens(0, 4), makeTokens(20, 4)), {0, 2}), 1);
+
+    EXPECT_EQ(tree.findLongestPrefix(std::nullopt, concat(makeTokens(0, 4), makeTokens(10, 4))).blocks,
+        (BlockIds{0, 1}));
+    EXPECT_EQ(tree.findLongestPrefix(std::nullopt, concat(makeTokens(0, 4), makeTokens(20, 4))).blocks,
+        (BlockIds{0, 2}));
+    EXPECT_EQ(tree.findLongestPrefix(std::nullopt, concat(makeTokens(0, 4), makeTokens(30, 4))).blocks, (BlockIds{0}));
+}
+
+TEST(KVCacheRadixTreeTest, loraAndExtraIds)
+{
+    KVCacheRadixTree tree(kTokensPerBlock, /*usesExtraIds=*/true);
+    auto tokens = makeTokens(0, 4);
+    tree.insert(std::nullopt, tokens, {0});
+    tree.insert(7, tokens, {1});
+
+    EXPECT_EQ(tree.findLongestPrefix(std::nullopt, tokens).blocks, (BlockIds{0}));
+    EXPECT_EQ(tree.findLongestPrefix(7, tokens).blocks, (BlockIds{1}));
+    EXPECT_TRUE(tree.findLongestPrefix(8, tokens).blocks.empty());
+
+    tokens[1].tokenExtraId = 42;
+    auto const match = tree.findLongestPrefix(std::nullopt, tokens);
+    EXPECT_EQ(match.blocks, (BlockIds{0}));
+    EXPECT_EQ(match.numMatchedTokens, 1);
+}
+
+TEST(KVCacheRadixTreeTest, remove)
+{
+    KVCacheRadixTree tree(kTokensPerBlock);
+    tree.insert(std::nullopt, makeTokens(0, 12), {0, 1, 2});
+    auto const numNodes = tree.getNumNodes();
+
+    EXPECT_TRUE(tree.remove(2));
+    EXPECT_FALSE(tree.remove(2));
+    EXPECT_EQ(tree.getNumNodes(), numNodes - 1);
+    EXPECT_EQ(tree.findLongestPrefix(std::nullopt, makeTokens(0, 12)).blocks, (BlockIds{0, 1}));
+
+    // Removing an inner block breaks the chain after it.
+    tree.insert(std::nullopt, makeTokens(0, 12), {0, 1, 2});
+    EXPECT_TRUE(tree.remove(1));
+    auto const match = tree.findLongestPrefix(std::nullopt, makeTokens(0, 12));
+    EXPECT_EQ(match.blocks, (BlockIds{0}));
+    EXPECT_EQ(match.numMatchedTokens, 4);
+
+    tree.insert(std::nullopt, makeTokens(0, 8), {0, 3});
+    EXPECT_EQ(tree.findLongestPrefix(std::nullopt, makeTokens(0, 12)).blocks, (BlockIds{0, 3, 2}));
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/kvCacheRemoteBlocks.h"
+
+using namespace tensorrt_llm::batch_manager::kv_cache_manager;
+namespace tle = tensorrt_llm::executor;
+
+namespace
+{
+constexpr tensorrt_llm::runtime::SizeType32 kTokensPerBlock = 4;
+
+VecUniqueTokens makeTokens(tensorrt_llm::runtime::TokenIdType first, std::size_t numTokens)
+{
+    VecUniqueTokens tokens(numTokens);
+    for (std::size_t i = 0; i < numTokens; ++i)
+    {
+        tokens[i] = {first + static_cast<tensorrt_llm::runtime::TokenIdType>(i), 0};
+    }
+    return tokens;
+}
+
+tle::KVCacheEvent makeStoredEvent(VecUniqueTokens const& tokens)
+{
+    auto const hashes = computeBlockHashes(tokens, kTokensPerBlock, std::nullopt, false);
+    std::vector<tle::KVCacheStoredBlockData> blocks;
+    for (std::size_t i = 0; i < hashes.size(); ++i)
+    {
+        blocks.emplace_back(hashes[i],
+            VecUniqueTokens(tokens.begin() + i * kTokensPerBlock, tokens.begin() + (i + 1) * kTokensPerBlock), 0, 0,
+            35);
+    }
+    return tle::KVCacheEvent{0, tle::KVCacheStoredData{std::nullopt, std::move(blocks)}};
+}
+} // namespace
+
+TEST(KVCacheRemoteBlockIndexTest, computeBlockHashesChainsParents)
+{
+    auto const tokens = makeTokens(0, 10);
+    auto const hashes = computeBlockHashes(tokens, kTokensPerBlock, std::nullopt, false);
+    ASSERT_EQ(hashes.size(), 2);
+
+    BlockKey const first{false, false, 0, VecUniqueTokens(tokens.begin(), tokens.begin() + kTokensPerBlock)};
+    BlockKey const second{false, false, 0,
+        VecUniqueTokens(tokens.begin() + kTokensPerBlock, tokens.begin() + 2 * kTokensPerBlock)};
+    EXPECT_EQ(hashes[0], BlockKeyHasher()(first));
+    EXPECT_EQ(hashes[1], BlockKeyHasher()(second, hashes[0]));
+
+    // A different LoRA gives different hashes.
+    EXPECT_NE(computeBlockHashes(tokens, kTokensPerBlock, 1, false), hashes);
+}
+
+TEST(KVCacheRemoteBlockIndexTest, findLongestPrefix)
+{
+    KVCacheRemoteBlockIndex index;
+    auto const tokens = makeTokens(0, 16);
+    index.apply(1, {makeStoredEvent(VecUniqueTokens(tokens.begin(), tokens.begin() + 8))});
+    index.apply(2, {makeStoredEvent(tokens)});
+    auto const hashes = computeBlockHashes(tokens, kTokensPerBlock, std::nullopt, false);
+
+    auto const prefix = index.findLongestPrefix(hashes);
+    ASSERT_TRUE(prefix.instanceId.has_value());
+    EXPECT_EQ(*prefix.instanceId, 2);
+    EXPECT_EQ(prefix.numBlocks, 4);
+
+    auto const excluded = index.findLongestPrefix(hashes, 2);
+    ASSERT_TRUE(excluded.instanceId.has_value());
+    EXPECT_EQ(*excluded.instanceId, 1);
+    EXPECT_EQ(excluded.numBlocks, 2);
+
+    auto const miss = index.findLongestPrefix(computeBlockHashes(makeTokens(100, 8), kTokensPerBlock, 1, false));
+    EXPECT_FALSE(miss.instanceId.has_value());
+    EXPECT_EQ(miss.numBlocks, 0);
+}
+
+TEST(KVCacheRemoteBlockIndexTest, removedAndCreatedEvents)
+{
+    KVCacheRemoteBlockIndex index;
+    auto const tokens = makeTokens(0, 12);
+    auto const hashes = computeBlockHashes(tokens, kTokensPerBlock, std::nullopt, false);
+    index.apply(1, {makeStoredEvent(tokens)});
+    index.apply(2, {makeStoredEvent(tokens)});
+    EXPECT_EQ(index.getNumBlocks(1), 3);
+
+    // Instance 2 evicted its last block, instance 1 still has the full prefix.
+    index.apply(2, {tle::KVCacheEvent{1, tle::KVCacheRemovedData{{hashes[2]}}}});
+    EXPECT_EQ(index.getNumBlocks(2), 2);
+    auto const prefix = index.findLongestPrefix(hashes);
+    EXPECT_EQ(*prefix.instanceId, 1);
+    EXPECT_EQ(prefix.numBlocks, 3);
+
+    // Instance 1 restarted.
+    index.apply(1, {tle::KVCacheEvent{2, tle::KVCacheCreatedData{{100}}}});
+    EXPECT_EQ(index.getNumBlocks(1), 0);
+    auto const restarted = index.findLongestPrefix(hashes);
+    EXPECT_EQ(*restarted.instanceId, 2);
+    EXPECT_EQ(restarted.numBlocks, 2);
+
+    index.removeInstance(2);
+    EXPECT_FALSE(index.findLongestPrefix(hashes).instanceId.has_value());
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/kvCacheReshard.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace tensorrt_llm::batch_manager::kv_cache_manager;
+using tensorrt_llm::runtime::SizeType32;
+
+namespace
+{
+KVCacheParallelLayout makeLayout(SizeType32 tpSize, SizeType32 ppSize, SizeType32 numKvHeads = 8)
+{
+    return KVCacheParallelLayout{tpSize, ppSize, 4, numKvHeads, 64, 16, 2};
+}
+
+//! \brief Fill the source pools of every rank with the global coordinates of every head, reshard them into the
+//! destination pools on the host and check that every destination head holds the right one.
+void checkReshard(KVCacheParallelLayout const& src, KVCacheParallelLayout const& dst)
+{
+    auto const headSize = src.getHeadSizeInBytes();
+    auto const numBlocks = 3;
+    auto const makeHeadValue = [&](SizeType32 block, SizeType32 layer, SizeType32 kvIdx, SizeType32 head)
+    { return static_cast<std::uint8_t>(((block * src.numLayers + layer) * 2 + kvIdx) * src.numKvHeads + head); };
+
+    std::vector<std::vector<std::uint8_t>> srcPools(src.tpSize * src.ppSize);
+    for (SizeType32 ppRank = 0; ppRank < src.ppSize; ++ppRank)
+    {
+        for (SizeType32 tpRank = 0; tpRank < src.tpSize; ++tpRank)
+        {
+            auto& pool = srcPools[src.getRank(tpRank, ppRank)];
+            pool.resize(numBlocks * src.getBlockSizeInBytes());
+            for (SizeType32 block = 0; block < numBlocks; ++block)
+            {
+                for (SizeType32 layer = 0; layer < src.getNumLocalLayers(); ++layer)
+                {
+                    for (SizeType32 kvIdx = 0; kvIdx < 2; ++kvIdx)
+                    {
+                        for (SizeType32 head = 0; head < src.getNumLocalHeads(); ++head)
+                        {
+                            auto const offset = block * src.getBlockSizeInBytes()
+                                + ((layer * 2 + kvIdx) * src.getNumLocalHeads() + head) * headSize;
+                            std::fill_n(pool.begin() + offset, headSize,
+                                makeHeadValue(block, ppRank * src.getNumLocalLayers() + layer, kvIdx,
+                                    src.getFirstHead(tpRank) + head));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Blocks are stored in reverse order on the destination.
+    std::vector<SizeType32> const srcBlocks{0, 1, 2};
+    std::vector<SizeType32> const dstBlocks{2, 1, 0};
+    for (SizeType32 ppRank = 0; ppRank < dst.ppSize; ++ppRank)
+    {
+        for (SizeType32 tpRank = 0; tpRank < dst.tpSize; ++tpRank)
+        {
+            auto const dstRank = dst.getRank(tpRank, ppRank);
+            std::vector<std::uint8_t> dstPool(numBlocks * dst.getBlockSizeInBytes(), 0xFF);
+            for (SizeType32 srcRank = 0; srcRank < static_cast<SizeType32>(srcPools.size()); ++srcRank)
+            {
+                KVCacheResharder const resharder{src, dst, srcRank, dstRank};
+                auto const copies = resharder.getCopies(srcPools[srcRank].data(), dstPool.data(), srcBlocks, dstBlocks);
+                for (auto const& copy : copies)
+                {
+                    std::copy_n(static_cast<std::uint8_t const*>(copy.src), copy.numBytes,
+                        static_cast<std::uint8_t*>(copy.dst));
+                }
+            }
+            for (SizeType32 block = 0; block < numBlocks; ++block)
+            {
+                for (SizeType32 layer = 0; layer < dst.getNumLocalLayers(); ++layer)
+                {
+                    for (SizeType32 kvIdx = 0; kvIdx < 2; ++kvIdx)
+                    {
+                        for (SizeType32 head = 0; head < dst.getNumLocalHeads(); ++head)
+                        {
+                            auto const offset = dstBlocks[block] * dst.getBlockSizeInBytes()
+                                + ((layer * 2 + kvIdx) * dst.getNumLocalHeads() + head) * headSize;
+                            auto const expected = makeHeadValue(block, ppRank * dst.getNumLocalLayers() + layer, kvIdx,
+                                dst.getFirstHead(tpRank) + head);
+                            for (std::int64_t byteIdx = 0; byteIdx < headSize; ++byteIdx)
+                            {
+                                ASSERT_EQ(dstPool[offset + byteIdx], expected);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+} // namespace
+
+TEST(KVCacheReshardTest, sameLayoutCopiesWholeBlocks)
+{
+    auto const layout = makeLayout(2, 1);
+    KVCacheResharder const resharder{layout, layout, 1, 1};
+    EXPECT_TRUE(KVCacheResharder(layout, layout, 0, 1).isEmpty());
+    std::vector<std::uint8_t> src(4 * layout.getBlockSizeInBytes());
+    std::vector<std::uint8_t> dst(src.size());
+
+    // Adjacent blocks merge into one copy.
+    auto const copies = resharder.getCopies(src.data(), dst.data(), {1, 2, 0}, {0, 1, 3});
+    ASSERT_EQ(copies.size(), 2);
+    EXPECT_EQ(copies[0].numBytes, 2 * layout.getBlockSizeInBytes());
+    EXPECT_EQ(copies[1].numBytes, layout.getBlockSizeInBytes());
+    EXPECT_EQ(copies[1].dst, dst.data() + 3 * layout.getBlockSizeInBytes());
+}
+
+TEST(KVCacheReshardTest, splitsHeads)
+{
+    auto const src = makeLayout(1, 1);
+    auto const dst = makeLayout(4, 1);
+    auto const segments = planKVCacheReshard(src, dst);
+    ASSERT_EQ(segments.size(), 4);
+    for (SizeType32 dstRank = 0; dstRank < 4; ++dstRank)
+    {
+        EXPECT_EQ(segments[dstRank].srcHead, 2 * dstRank);
+        EXPECT_EQ(segments[dstRank].numHeads, 2);
+        EXPECT_EQ(segments[dstRank].numLayers, 4);
+    }
+    checkReshard(src, dst);
+    checkReshard(dst, src);
+}
+
+TEST(KVCacheReshardTest, reshardsTensorAndPipelineParallelism)
+{
+    checkReshard(makeLayout(4, 1), makeLayout(2, 2));
+    checkReshard(makeLayout(2, 2), makeLayout(1, 4));
+    checkReshard(makeLayout(1, 2), makeLayout(8, 1));
+}
+
+TEST(KVCacheReshardTest, spreadsReadsOverReplicatedHeads)
+{
+    // 2 KV heads over 8 TP ranks, every head is held by 4 ranks.
+    auto const src = makeLayout(8, 1, 2);
+    auto const dst = makeLayout(2, 1, 2);
+    auto const segments = planKVCacheReshard(src, dst);
+    ASSERT_EQ(segments.size(), 2);
+    EXPECT_EQ(segments[0].srcRank, 0);
+    EXPECT_EQ(segments[1].srcRank, 5);
+    checkReshard(src, dst);
+    checkReshard(dst, src);
+    checkReshard(src, makeLayout(4, 2, 2));
+}
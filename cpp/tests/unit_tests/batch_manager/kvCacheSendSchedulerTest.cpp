@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/kvCacheSendScheduler.h"
+
+using namespace tensorrt_llm::batch_manager;
+using namespace std::chrono_literals;
+
+namespace
+{
+class FakeClockScheduler : public KVCacheSendScheduler
+{
+public:
+    using KVCacheSendScheduler::KVCacheSendScheduler;
+
+    [[nodiscard]] Clock::time_point getTime() const override
+    {
+        return mNow;
+    }
+
+    Clock::time_point mNow{};
+};
+} // namespace
+
+TEST(KVCacheSendSchedulerTest, sendsShortestRemainingFirst)
+{
+    KVCacheSendScheduler::Config config;
+    config.chunkNumBlocks = 4;
+    config.maxConcurrency = 1;
+    FakeClockScheduler scheduler{config};
+    scheduler.add(1, 20);
+    auto first = scheduler.tryAcquire();
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(first->requestId, 1);
+    EXPECT_FALSE(scheduler.tryAcquire().has_value());
+
+    // The short request overtakes the long one as soon as a chunk completes.
+    scheduler.add(2, 6);
+    scheduler.mNow += 2ms;
+    EXPECT_FALSE(scheduler.complete(*first, 1000).has_value());
+    auto chunk = scheduler.tryAcquire();
+    ASSERT_TRUE(chunk.has_value());
+    EXPECT_EQ(chunk->requestId, 2);
+    EXPECT_EQ(chunk->numBlocks, 4);
+    scheduler.mNow += 1ms;
+    EXPECT_FALSE(scheduler.complete(*chunk, 1000).has_value());
+    chunk = scheduler.tryAcquire();
+    ASSERT_TRUE(chunk.has_value());
+    EXPECT_EQ(chunk->requestId, 2);
+    EXPECT_EQ(chunk->firstBlock, 4);
+    EXPECT_EQ(chunk->numBlocks, 2);
+    scheduler.mNow += 1ms;
+    auto const transferTime = scheduler.complete(*chunk, 500);
+    ASSERT_TRUE(transferTime.has_value());
+    // Measured from add, so the wait for the first chunk of the long request counts.
+    EXPECT_DOUBLE_EQ(transferTime->count(), 4.);
+
+    chunk = scheduler.tryAcquire();
+    ASSERT_TRUE(chunk.has_value());
+    EXPECT_EQ(chunk->requestId, 1);
+    EXPECT_EQ(chunk->firstBlock, 4);
+
+    auto const times = scheduler.popTransferTimes();
+    ASSERT_EQ(times.size(), 1);
+    EXPECT_EQ(times[0].first, 2);
+    auto const stats = scheduler.getStats();
+    EXPECT_EQ(stats.numRequests, 1);
+    EXPECT_EQ(stats.transferTimeHistogram[3], 1);
+}
+
+TEST(KVCacheSendSchedulerTest, adaptsConcurrencyToThroughput)
+{
+    KVCacheSendScheduler::Config config;
+    config.chunkNumBlocks = 1;
+    config.maxConcurrency = 8;
+    // Divisible by every concurrency below, so windows end with a batch.
+    config.windowNumChunks = 12;
+    FakeClockScheduler scheduler{config};
+    scheduler.add(1, 1000);
+
+    // The link saturates at 3 chunks in flight, more only take longer each.
+    std::vector<int> concurrencies;
+    for (int batch = 0; batch < 30; ++batch)
+    {
+        std::vector<KVCacheSendScheduler::Chunk> chunks;
+        while (auto chunk = scheduler.tryAcquire())
+        {
+            chunks.push_back(*chunk);
+        }
+        auto const numChunks = static_cast<int>(chunks.size());
+        scheduler.mNow += std::chrono::milliseconds(10 * numChunks / std::min(numChunks, 3));
+        for (auto const& chunk : chunks)
+        {
+            scheduler.complete(chunk, 1 << 20);
+        }
+        auto const concurrency = scheduler.getStats().concurrency;
+        if (concurrencies.empty() || concurrencies.back() != concurrency)
+        {
+            concurrencies.push_back(concurrency);
+        }
+    }
+    // Climbs to the saturation point and oscillates around it.
+    std::vector<int> const expected{1, 2, 3, 4, 3, 4};
+    ASSERT_GE(concurrencies.size(), expected.size());
+    concurrencies.resize(expected.size());
+    EXPECT_EQ(concurrencies, expected);
+    EXPECT_NEAR(scheduler.getStats().throughput, 300. * (1 << 20), 1e3);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <gmock/gmock.h>
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/peftCacheManager.h"
+
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager::test
+{
+
+//! \brief BaseKVCacheManager for the tests of the components that only call it, without device pools.
+class MockKvCacheManager : public kv_cache_manager::BaseKVCacheManager
+{
+public:
+    using BlockIds = std::vector<std::vector<SizeType32>>;
+    using BatchBlockIds = std::vector<std::vector<std::vector<SizeType32>>>;
+    template <typename T>
+    using OptionalRef = common::OptionalRef<T>;
+
+    MOCK_METHOD(void, allocatePools, (nvinfer1::DataType dtype, bool useUvm), (override));
+    MOCK_METHOD(void, releasePools, (), (override));
+    MOCK_METHOD(void, startScheduling, (), (override));
+    MOCK_METHOD(SizeType32, getTokensPerBlock, (), (const, override));
+    MOCK_METHOD(SizeType32, getMaxNumBlocks, (), (const, override));
+    MOCK_METHOD(SizeType32, getUsedNumBlocks, (), (const, override));
+    MOCK_METHOD(SizeType32, getNumFreeBlocks, (), (const, override));
+    MOCK_METHOD(SizeType32, getNumPools, (), (const, override));
+    MOCK_METHOD(SizeType32, getNumReusedBlocks, (), (const, noexcept, override));
+    MOCK_METHOD(kv_cache_manager::KvCacheStats, getKvCacheStats, (), (const, override));
+    MOCK_METHOD(SizeType32, getMaxBlocksPerSeq, (), (const, override));
+    MOCK_METHOD(std::deque<executor::KVCacheEvent>, getLatestEvents,
+        (std::optional<std::chrono::milliseconds> timeout), (const, override));
+    MOCK_METHOD(kv_cache_manager::BlockManager const&, getBlockManager, (), (const, override));
+    MOCK_METHOD(SizeType32, getNeededBlocksOneStep, (LlmRequest const& req, bool twoStepsLookAhead), (const, override));
+    MOCK_METHOD(SizeType32, getRemainingBlocksToCompletion, (LlmRequest const& req), (const, override));
+    MOCK_METHOD(void, addToken, (LlmRequest::RequestIdType requestId), (override));
+    MOCK_METHOD(void, addSequence,
+        (LlmRequest::RequestIdType requestId, SizeType32 inputLength, SizeType32 beamWidth,
+            OptionalRef<LlmRequest> llmRequest),
+        (override));
+    MOCK_METHOD(void, removeSequence,
+        (LlmRequest::RequestIdType requestId, OptionalRef<LlmRequest const> llmRequest), (override));
+    MOCK_METHOD(void, schedulingRemoveSequence, (LlmRequest::RequestIdType requestId), (override));
+    MOCK_METHOD(runtime::ITensor::SharedPtr, getBlockPoolPointers, (), (const, override));
+    MOCK_METHOD(runtime::ITensor::SharedPtr, getLayerToPoolMapping, (), (const, override));
+    MOCK_METHOD(void, getBlockOffsetsOfBatch,
+        (runtime::ITensor & output, SizeType32 firstBatchSlotIdx, SizeType32 batchSize, SizeType32 beamWidth),
+        (const, override));
+    MOCK_METHOD(SizeType32, copyBlockOffsets,
+        (runtime::ITensor & output, SizeType32 outputSlotOffset, LlmRequest::RequestIdType requestId),
+        (const, override));
+    MOCK_METHOD(bool, isEnableBlockReuse, (), (const, override));
+    MOCK_METHOD(bool, isUseOneMoreBlock, (), (const, override));
+    MOCK_METHOD(void, rewindKVCache, (LlmRequest::RequestIdType requestId, SizeType32 rewindLengths), (override));
+    MOCK_METHOD(kv_cache_manager::GenerationRequest const&, getSequence, (LlmRequest::RequestIdType requestId),
+        (const, override));
+    MOCK_METHOD(bool, isCrossKv, (), (const, override));
+    MOCK_METHOD(std::optional<kv_cache_manager::BlockKey>, findNewContextBlock,
+        (kv_cache_manager::VecUniqueTokens const& uniqueTokens, LlmRequest const& llmRequest), (const, override));
+    MOCK_METHOD(void, storeContextBlocks, (LlmRequest const& llmRequest), (override));
+    MOCK_METHOD(bool, schedulingHasFreeBlocks, (SizeType32 numRequired), (const, override));
+    MOCK_METHOD(BlockIds const&, getCacheBlockIds, (LlmRequest::RequestIdType requestId), (const, override));
+    MOCK_METHOD(BatchBlockIds, getBatchCacheBlockIds, (std::vector<LlmRequest::RequestIdType> const& requestIds),
+        (const, override));
+    MOCK_METHOD(runtime::ITensor::SharedPtr, getPrimaryPool, (SizeType32 layer_idx), (const, override));
+    MOCK_METHOD(SizeType32, getPoolLayerIdx, (SizeType32 layer_idx), (const, override));
+    MOCK_METHOD(void, refreshBlocks, (), (override));
+    MOCK_METHOD(void, flushIterationEvents, (), (override));
+    MOCK_METHOD(SizeType32, getMaxCapacityBatchSize, (SizeType32 inputLength, SizeType32 outputLength),
+        (const, override));
+};
+
+class MockPeftCacheManager : public BasePeftCacheManager
+{
+public:
+    MOCK_METHOD(void, addRequestPeft, (LlmRequestPtr llmRequest, bool tryGpuCache), (override));
+    MOCK_METHOD(PeftTable, ensureBatch,
+        (RequestVector const& contextRequests, RequestVector const& generationRequests, bool resetGpuCache),
+        (override));
+    MOCK_METHOD(void, resetDeviceCache, (), (override));
+    MOCK_METHOD(void, markRequestDone, (LlmRequest const& llmReq, bool pause), (override));
+    MOCK_METHOD(SizeType32, getMaxDevicePages, (), (const, override));
+    MOCK_METHOD(SizeType32, getMaxHostPages, (), (const, override));
+    MOCK_METHOD(SizeType32, determineNumPages, (std::shared_ptr<LlmRequest> llmRequest), (const, override));
+    MOCK_METHOD(bool, enabled, (), (const, override));
+};
+
+} // namespace tensorrt_llm::batch_manager::test
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/packedEncoderBatcher.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+using namespace tensorrt_llm::batch_manager;
+
+namespace
+{
+
+PackedEncoderBatcher::Request makeRequest(PackedEncoderBatcher::RequestIdType requestId, int numTokens)
+{
+    PackedEncoderBatcher::Request request;
+    request.requestId = requestId;
+    for (int ti = 0; ti < numTokens; ++ti)
+    {
+        request.inputTokens.push_back(static_cast<int>(requestId) * 100 + ti);
+    }
+    return request;
+}
+
+} // namespace
+
+TEST(PackedEncoderBatcherTest, packsRequestsIntoTokenBudget)
+{
+    PackedEncoderBatcher batcher{/* maxNumTokens */ 10, /* maxBatchSize */ 8};
+    batcher.enqueue(makeRequest(1, 4));
+    batcher.enqueue(makeRequest(2, 3));
+    batcher.enqueue(makeRequest(3, 2));
+
+    auto const batch = batcher.nextBatch();
+    ASSERT_TRUE(batch.has_value());
+    EXPECT_EQ(batch->requestIds, (std::vector<PackedEncoderBatcher::RequestIdType>{1, 2, 3}));
+    EXPECT_EQ(batch->getNumTokens(), 9);
+    EXPECT_EQ(batch->inputLengths, (std::vector<int>{4, 3, 2}));
+    EXPECT_EQ(batch->seqOffsets, (std::vector<int>{0, 4, 7, 9}));
+    EXPECT_EQ(batch->positionIds, (std::vector<int>{0, 1, 2, 3, 0, 1, 2, 0, 1}));
+    EXPECT_EQ(batch->tokenTypeIds, std::vector<int>(9, 0));
+    EXPECT_EQ(batch->inputIds[4], 200);
+    EXPECT_EQ(batch->maxInputLength, 4);
+    EXPECT_FALSE(batcher.nextBatch().has_value());
+}
+
+TEST(PackedEncoderBatcherTest, laterRequestsFillTheBudget)
+{
+    PackedEncoderBatcher batcher{/* maxNumTokens */ 10, /* maxBatchSize */ 8};
+    batcher.enqueue(makeRequest(1, 6));
+    batcher.enqueue(makeRequest(2, 7));
+    batcher.enqueue(makeRequest(3, 4));
+
+    // Request 2 does not fit next to request 1, request 3 does and goes first.
+    auto batch = batcher.nextBatch();
+    EXPECT_EQ(batch->requestIds, (std::vector<PackedEncoderBatcher::RequestIdType>{1, 3}));
+    EXPECT_EQ(batcher.getNumPending(), 1);
+    batch = batcher.nextBatch();
+    EXPECT_EQ(batch->requestIds, (std::vector<PackedEncoderBatcher::RequestIdType>{2}));
+}
+
+TEST(PackedEncoderBatcherTest, boundsBatchSizeAndLookahead)
+{
+    PackedEncoderBatcher batcher{/* maxNumTokens */ 100, /* maxBatchSize */ 2, /* lookahead */ 1};
+    batcher.enqueue(makeRequest(1, 90));
+    batcher.enqueue(makeRequest(2, 20));
+    batcher.enqueue(makeRequest(3, 5));
+    batcher.enqueue(makeRequest(4, 5));
+    batcher.enqueue(makeRequest(5, 5));
+
+    // Request 3 would fit but is beyond the lookahead of request 1.
+    EXPECT_EQ(batcher.nextBatch()->requestIds, (std::vector<PackedEncoderBatcher::RequestIdType>{1}));
+    EXPECT_EQ(batcher.nextBatch()->requestIds, (std::vector<PackedEncoderBatcher::RequestIdType>{2, 3}));
+    EXPECT_EQ(batcher.nextBatch()->requestIds, (std::vector<PackedEncoderBatcher::RequestIdType>{4, 5}));
+}
+
+TEST(PackedEncoderBatcherTest, rejectsInvalidRequests)
+{
+    PackedEncoderBatcher batcher{/* maxNumTokens */ 8, /* maxBatchSize */ 4};
+    EXPECT_THROW(batcher.enqueue(makeRequest(1, 0)), tensorrt_llm::common::TllmException);
+    EXPECT_THROW(batcher.enqueue(makeRequest(2, 9)), tensorrt_llm::common::TllmException);
+    auto request = makeRequest(3, 4);
+    request.tokenTypeIds = {0, 1};
+    EXPECT_THROW(batcher.enqueue(request), tensorrt_llm::common::TllmException);
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/requestCanceller.h"
+
+#include "mockCacheManagers.h"
+
+#include <memory>
+#include <vector>
+
+using namespace tensorrt_llm::batch_manager;
+using namespace tensorrt_llm::batch_manager::test;
+using ::testing::_;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+namespace
+{
+using tensorrt_llm::runtime::SizeType32;
+
+std::shared_ptr<LlmRequest> makeRequest(LlmRequest::RequestIdType requestId)
+{
+    auto tokens = std::make_shared<std::vector<tensorrt_llm::runtime::TokenIdType>>(8, 1);
+    return std::make_shared<LlmRequest>(requestId, 16, tokens, tensorrt_llm::runtime::SamplingConfig{1}, false);
+}
+
+// A manager with one slot, so a slot is only handed to a new sequence once the previous one freed it.
+SequenceSlotManager makeSlotManager()
+{
+    return SequenceSlotManager{1, 1000000};
+}
+} // namespace
+
+TEST(RequestCancellerTest, applyReleasesCancelledRequests)
+{
+    auto const first = makeRequest(1);
+    auto const second = makeRequest(2);
+    second->setState(LlmRequestState::kGENERATION_IN_PROGRESS);
+    RequestList activeRequests{first, second};
+
+    NiceMock<MockKvCacheManager> kvCacheManager;
+    NiceMock<MockPeftCacheManager> peftCacheManager;
+    auto seqSlotManager = makeSlotManager();
+    ASSERT_TRUE(seqSlotManager.getSequenceSlot(true, 2).has_value());
+
+    EXPECT_CALL(kvCacheManager, getNumFreeBlocks()).WillOnce(Return(10)).WillOnce(Return(14));
+    EXPECT_CALL(kvCacheManager, removeSequence(2, _)).Times(1);
+    EXPECT_CALL(kvCacheManager, removeSequence(1, _)).Times(0);
+    EXPECT_CALL(peftCacheManager, markRequestDone(_, false)).Times(1);
+
+    RequestCanceller canceller;
+    canceller.cancel(2);
+    EXPECT_TRUE(canceller.hasPending());
+    auto const cancelled
+        = canceller.apply(activeRequests, &kvCacheManager, nullptr, &peftCacheManager, &seqSlotManager);
+
+    ASSERT_EQ(cancelled.size(), 1);
+    EXPECT_EQ(cancelled.front()->mRequestId, 2);
+    EXPECT_TRUE(second->isFinished());
+    EXPECT_FALSE(first->isFinished());
+    ASSERT_EQ(activeRequests.size(), 1);
+    EXPECT_EQ(activeRequests.front()->mRequestId, 1);
+    EXPECT_FALSE(canceller.hasPending());
+    // The slot of the cancelled request is free for the next sequence.
+    EXPECT_TRUE(seqSlotManager.getSequenceSlot(true, 3).has_value());
+
+    auto const stats = canceller.takeStats();
+    EXPECT_EQ(stats.numCancelled, 1);
+    EXPECT_EQ(stats.numCancelledInGeneration, 1);
+    EXPECT_EQ(stats.numBlocksReleased, 4);
+}
+
+TEST(RequestCancellerTest, applyKeepsCancellationsOfInactiveRequests)
+{
+    RequestList activeRequests{makeRequest(1)};
+    NiceMock<MockKvCacheManager> kvCacheManager;
+    EXPECT_CALL(kvCacheManager, removeSequence(_, _)).Times(0);
+
+    RequestCanceller canceller;
+    canceller.cancel(7);
+    EXPECT_TRUE(canceller.apply(activeRequests, &kvCacheManager, nullptr, nullptr, nullptr).empty());
+    EXPECT_EQ(activeRequests.size(), 1);
+    EXPECT_TRUE(canceller.hasPending());
+
+    canceller.forget(7);
+    EXPECT_FALSE(canceller.hasPending());
+}
+
+TEST(RequestCancellerTest, maskRemovesCancelledScheduledRequests)
+{
+    auto const first = makeRequest(1);
+    auto const second = makeRequest(2);
+    auto const third = makeRequest(3);
+    RequestVector scheduledRequests{first, second, third};
+
+    NiceMock<MockKvCacheManager> kvCacheManager;
+    NiceMock<MockKvCacheManager> crossKvCacheManager;
+    NiceMock<MockPeftCacheManager> peftCacheManager;
+    auto seqSlotManager = makeSlotManager();
+    ASSERT_TRUE(seqSlotManager.getSequenceSlot(true, 1).has_value());
+
+    // Each cancelled request returns 2 blocks to each manager.
+    SizeType32 numFreeBlocks = 0;
+    SizeType32 numFreeCrossBlocks = 0;
+    ON_CALL(kvCacheManager, getNumFreeBlocks()).WillByDefault([&numFreeBlocks]() { return numFreeBlocks; });
+    ON_CALL(crossKvCacheManager, getNumFreeBlocks()).WillByDefault([&numFreeCrossBlocks]() {
+        return numFreeCrossBlocks;
+    });
+    EXPECT_CALL(kvCacheManager, removeSequence(_, _)).Times(2).WillRepeatedly([&numFreeBlocks]() {
+        numFreeBlocks += 2;
+    });
+    EXPECT_CALL(crossKvCacheManager, removeSequence(_, _)).Times(2).WillRepeatedly([&numFreeCrossBlocks]() {
+        numFreeCrossBlocks += 2;
+    });
+    EXPECT_CALL(peftCacheManager, markRequestDone(_, _)).Times(2);
+
+    RequestCanceller canceller;
+    canceller.cancel(1);
+    canceller.cancel(3);
+    auto const cancelled = canceller.mask(
+        scheduledRequests, &kvCacheManager, &crossKvCacheManager, &peftCacheManager, &seqSlotManager);
+
+    ASSERT_EQ(cancelled.size(), 2);
+    EXPECT_EQ(cancelled.at(0)->mRequestId, 1);
+    EXPECT_EQ(cancelled.at(1)->mRequestId, 3);
+    ASSERT_EQ(scheduledRequests.size(), 1);
+    EXPECT_EQ(scheduledRequests.front()->mRequestId, 2);
+    EXPECT_TRUE(first->isFinished());
+    EXPECT_TRUE(third->isFinished());
+    EXPECT_FALSE(second->isFinished());
+    EXPECT_TRUE(seqSlotManager.getSequenceSlot(true, 4).has_value());
+
+    auto const stats = canceller.takeStats();
+    EXPECT_EQ(stats.numCancelled, 2);
+    EXPECT_EQ(stats.numCancelledInGeneration, 0);
+    EXPECT_EQ(stats.numBlocksReleased, 8);
+    // The counters are reset once taken.
+    auto const nextStats = canceller.takeStats();
+    EXPECT_EQ(nextStats.numCancelled, 0);
+    EXPECT_EQ(nextStats.numBlocksReleased, 0);
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/requestCostAccounting.h"
+
+#include "mockCacheManagers.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace tensorrt_llm::batch_manager;
+using namespace tensorrt_llm::batch_manager::test;
+using namespace std::chrono_literals;
+using ::testing::NiceMock;
+using ::testing::ReturnRef;
+
+namespace
+{
+using tensorrt_llm::runtime::SizeType32;
+using TokenIdType = tensorrt_llm::runtime::TokenIdType;
+using Seconds = RequestCostAccounting::Seconds;
+
+std::shared_ptr<LlmRequest> makeRequest(
+    LlmRequest::RequestIdType requestId, SizeType32 promptLen, SizeType32 beamWidth = 1)
+{
+    auto tokens = std::make_shared<std::vector<TokenIdType>>(promptLen, 1);
+    return std::make_shared<LlmRequest>(requestId, 16, tokens, tensorrt_llm::runtime::SamplingConfig{beamWidth}, false);
+}
+
+std::shared_ptr<LlmRequest> makeGenerationRequest(
+    LlmRequest::RequestIdType requestId, SizeType32 beamWidth, SizeType32 numDraftTokens)
+{
+    auto llmReq = makeRequest(requestId, 4, beamWidth);
+    llmReq->setState(LlmRequestState::kGENERATION_IN_PROGRESS);
+    llmReq->setDraftTokens(std::make_shared<std::vector<TokenIdType>>(numDraftTokens, 2));
+    return llmReq;
+}
+} // namespace
+
+TEST(RequestCostAccountingTest, splitsGpuTimeByTokenShare)
+{
+    // 8 context tokens, since 4 of the 12 tokens of the prompt are reused.
+    auto const contextRequest = makeRequest(1, 12);
+    contextRequest->setPrepopulatedPromptLen(4, 4);
+    // 2 beams, and a step with 3 draft tokens.
+    auto const beamRequest = makeGenerationRequest(2, 2, 0);
+    auto const draftRequest = makeGenerationRequest(3, 1, 3);
+
+    RequestCostAccounting accounting;
+    accounting.accumulate({contextRequest}, {beamRequest, draftRequest}, Seconds{1.4});
+
+    auto const& contextCost = accounting.getCost(1);
+    EXPECT_EQ(contextCost.contextTokensComputed, 8);
+    EXPECT_EQ(contextCost.contextTokensReused, 4);
+    EXPECT_EQ(contextCost.numContextChunks, 1);
+    EXPECT_NEAR(contextCost.gpuSeconds, 0.8, 1e-9);
+
+    auto const& beamCost = accounting.getCost(2);
+    EXPECT_EQ(beamCost.generationTokensComputed, 2);
+    EXPECT_EQ(beamCost.numGenerationSteps, 1);
+    EXPECT_NEAR(beamCost.gpuSeconds, 0.2, 1e-9);
+
+    auto const& draftCost = accounting.getCost(3);
+    EXPECT_EQ(draftCost.generationTokensComputed, 4);
+    EXPECT_NEAR(draftCost.gpuSeconds, 0.4, 1e-9);
+
+    // The GPU seconds of the requests add up to the iteration time.
+    EXPECT_NEAR(contextCost.gpuSeconds + beamCost.gpuSeconds + draftCost.gpuSeconds, 1.4, 1e-9);
+    EXPECT_EQ(accounting.getNumTrackedRequests(), 3);
+}
+
+TEST(RequestCostAccountingTest, accumulatesKvBlockSeconds)
+{
+    auto const first = makeGenerationRequest(1, 1, 0);
+    auto const second = makeGenerationRequest(2, 2, 0);
+
+    MockKvCacheManager::BlockIds firstBlockIds{{0, 1, 2}};
+    // The beams share the blocks of the context.
+    MockKvCacheManager::BlockIds const secondBlockIds{{3, 4, 5}, {3, 4, 6}};
+    NiceMock<MockKvCacheManager> kvCacheManager;
+    ON_CALL(kvCacheManager, getCacheBlockIds(1)).WillByDefault(ReturnRef(firstBlockIds));
+    ON_CALL(kvCacheManager, getCacheBlockIds(2)).WillByDefault(ReturnRef(secondBlockIds));
+
+    RequestCostAccounting accounting;
+    accounting.accumulate({}, {first, second}, Seconds{2.}, &kvCacheManager);
+    EXPECT_NEAR(accounting.getCost(1).kvBlockSeconds, 6., 1e-9);
+    EXPECT_EQ(accounting.getCost(1).maxKvBlocks, 3);
+    EXPECT_NEAR(accounting.getCost(2).kvBlockSeconds, 8., 1e-9);
+    EXPECT_EQ(accounting.getCost(2).maxKvBlocks, 4);
+
+    // Fewer blocks in a later iteration, e.g. with a sliding window, keep the maximum.
+    firstBlockIds = {{1, 2}};
+    accounting.accumulate({}, {first}, 500ms, &kvCacheManager);
+    EXPECT_NEAR(accounting.getCost(1).kvBlockSeconds, 7., 1e-9);
+    EXPECT_EQ(accounting.getCost(1).maxKvBlocks, 3);
+    EXPECT_EQ(accounting.getCost(1).numGenerationSteps, 2);
+    EXPECT_NEAR(accounting.getCost(1).gpuSeconds, 2. / 3. + 0.5, 1e-9);
+}
+
+TEST(RequestCostAccountingTest, takeForgetsTheRequest)
+{
+    auto const llmReq = makeGenerationRequest(1, 1, 0);
+    RequestCostAccounting accounting;
+    accounting.accumulate({}, {llmReq}, 1s);
+    accounting.accumulate({}, {llmReq}, 1s);
+
+    auto const cost = accounting.take(1);
+    EXPECT_EQ(cost.numGenerationSteps, 2);
+    EXPECT_NEAR(cost.gpuSeconds, 2., 1e-9);
+    EXPECT_EQ(accounting.getNumTrackedRequests(), 0);
+    EXPECT_EQ(accounting.getCost(1).numGenerationSteps, 0);
+    EXPECT_EQ(accounting.take(1).numGenerationSteps, 0);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/rnnStateCheckpointCache.h"
+
+using namespace tensorrt_llm::batch_manager::rnn_state_manager;
+using tensorrt_llm::batch_manager::kv_cache_manager::VecUniqueTokens;
+
+namespace
+{
+VecUniqueTokens makeTokens(tensorrt_llm::runtime::TokenIdType first, std::size_t numTokens)
+{
+    VecUniqueTokens tokens(numTokens);
+    for (std::size_t i = 0; i < numTokens; ++i)
+    {
+        tokens[i] = {first + static_cast<tensorrt_llm::runtime::TokenIdType>(i), 0};
+    }
+    return tokens;
+}
+
+constexpr tensorrt_llm::runtime::SizeType32 kInterval = 4;
+} // namespace
+
+TEST(RnnStateCheckpointIndexTest, longestCheckpoint)
+{
+    RnnStateCheckpointIndex index(kInterval, 4);
+    auto const tokens = makeTokens(0, 12);
+    auto const first = index.insert(tokens, 4, std::nullopt);
+    auto const second = index.insert(tokens, 8, std::nullopt);
+    ASSERT_TRUE(first.has_value() && second.has_value());
+    EXPECT_NE(*first, *second);
+    // The same prefix is only checkpointed once.
+    EXPECT_FALSE(index.insert(tokens, 8, std::nullopt).has_value());
+
+    auto const match = index.findLongestPrefix(makeTokens(0, 20), std::nullopt);
+    ASSERT_TRUE(match.has_value());
+    EXPECT_EQ(match->slot, *second);
+    EXPECT_EQ(match->numTokens, 8);
+
+    // At least one token is left to run in the context.
+    auto const exact = index.findLongestPrefix(makeTokens(0, 8), std::nullopt);
+    ASSERT_TRUE(exact.has_value());
+    EXPECT_EQ(exact->numTokens, 4);
+
+    auto diverging = makeTokens(0, 12);
+    diverging[5].tokenId = 100;
+    auto const partial = index.findLongestPrefix(diverging, std::nullopt);
+    ASSERT_TRUE(partial.has_value());
+    EXPECT_EQ(partial->numTokens, 4);
+
+    EXPECT_FALSE(index.findLongestPrefix(makeTokens(1, 12), std::nullopt).has_value());
+    EXPECT_FALSE(index.findLongestPrefix(tokens, 1).has_value());
+}
+
+TEST(RnnStateCheckpointIndexTest, evictsLeastRecentlyUsed)
+{
+    RnnStateCheckpointIndex index(kInterval, 2);
+    auto const a = makeTokens(0, 4);
+    auto const b = makeTokens(100, 4);
+    auto const c = makeTokens(200, 4);
+    auto const slotA = index.insert(a, 4, std::nullopt);
+    ASSERT_TRUE(index.insert(b, 4, std::nullopt).has_value());
+    // Using a makes b the least recently used checkpoint.
+    ASSERT_TRUE(index.findLongestPrefix(makeTokens(0, 5), std::nullopt).has_value());
+    auto const slotC = index.insert(c, 4, std::nullopt);
+    ASSERT_TRUE(slotC.has_value());
+    EXPECT_NE(*slotC, *slotA);
+    EXPECT_EQ(index.getNumCheckpoints(), 2);
+    EXPECT_FALSE(index.findLongestPrefix(makeTokens(100, 5), std::nullopt).has_value());
+    EXPECT_TRUE(index.findLongestPrefix(makeTokens(200, 5), std::nullopt).has_value());
+
+    EXPECT_THROW((void) index.insert(c, 3, std::nullopt), tensorrt_llm::common::TllmException);
+}
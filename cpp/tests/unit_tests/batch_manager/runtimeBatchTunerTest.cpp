@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/runtimeBatchTuner.h"
+
+#include <chrono>
+
+using namespace tensorrt_llm::batch_manager;
+using namespace std::chrono_literals;
+
+namespace
+{
+using Decision = RuntimeBatchTuner::Decision;
+using SizeType32 = RuntimeBatchTuner::SizeType32;
+
+RuntimeBatchTuner::Config makeConfig()
+{
+    return RuntimeBatchTuner::Config{50ms, 1, 256, 64, 8192, /*windowSize=*/4};
+}
+
+// Run a window of iterations that fill the current limits.
+Decision runWindow(RuntimeBatchTuner& tuner, RuntimeBatchTuner::Duration latency, double kvCacheUsage = 0.5)
+{
+    auto decision = Decision::kKeep;
+    for (SizeType32 i = 0; i < 4; ++i)
+    {
+        auto const batchSize = tuner.getMaxBatchSize();
+        decision = tuner.recordIteration(latency, batchSize, batchSize, tuner.getMaxNumTokens(), kvCacheUsage);
+    }
+    return decision;
+}
+} // namespace
+
+TEST(RuntimeBatchTunerTest, decreasesOverLatencyBound)
+{
+    auto config = makeConfig();
+    RuntimeBatchTuner tuner{config};
+    EXPECT_EQ(tuner.getMaxBatchSize(), 256);
+    EXPECT_EQ(runWindow(tuner, 80ms), Decision::kDecreaseLatency);
+    EXPECT_EQ(tuner.getMaxBatchSize(), 192);
+    EXPECT_EQ(tuner.getMaxNumTokens(), 6144);
+    EXPECT_NEAR(tuner.getStats().p99InterTokenLatencyMs, 80., 1e-6);
+    for (int i = 0; i < 32; ++i)
+    {
+        runWindow(tuner, 80ms);
+    }
+    EXPECT_EQ(tuner.getMaxBatchSize(), config.minBatchSize);
+    EXPECT_EQ(tuner.getMaxNumTokens(), config.minNumTokens);
+}
+
+TEST(RuntimeBatchTunerTest, decreasesUnderKvCachePressure)
+{
+    RuntimeBatchTuner tuner{makeConfig()};
+    EXPECT_EQ(runWindow(tuner, 20ms, 0.99), Decision::kDecreaseKvCache);
+    EXPECT_EQ(tuner.getMaxBatchSize(), 192);
+    EXPECT_EQ(tuner.getMaxNumTokens(), 8192);
+}
+
+TEST(RuntimeBatchTunerTest, climbsAndRevertsOnThroughputDrop)
+{
+    RuntimeBatchTuner tuner{makeConfig()};
+    runWindow(tuner, 80ms);
+    EXPECT_EQ(tuner.getMaxBatchSize(), 192);
+
+    // Under the bound with saturated limits, the tuner climbs back.
+    EXPECT_EQ(runWindow(tuner, 20ms), Decision::kIncrease);
+    EXPECT_EQ(tuner.getMaxBatchSize(), 216);
+    EXPECT_EQ(tuner.getMaxNumTokens(), 6912);
+
+    // The larger limits process more tokens in the same time, then a step costs so much more that the throughput
+    // drops.
+    EXPECT_EQ(runWindow(tuner, 20ms), Decision::kIncrease);
+    EXPECT_EQ(tuner.getMaxBatchSize(), 243);
+    EXPECT_EQ(runWindow(tuner, 40ms), Decision::kRevert);
+    EXPECT_EQ(tuner.getMaxBatchSize(), 216);
+    EXPECT_EQ(tuner.getStats().numReverts, 1);
+    // The reverted limits are held for a few windows.
+    EXPECT_EQ(runWindow(tuner, 20ms), Decision::kKeep);
+    EXPECT_EQ(tuner.getMaxBatchSize(), 216);
+}
+
+TEST(RuntimeBatchTunerTest, keepsLimitsThatAreNotReached)
+{
+    RuntimeBatchTuner tuner{makeConfig()};
+    runWindow(tuner, 80ms);
+    for (SizeType32 i = 0; i < 4; ++i)
+    {
+        EXPECT_EQ(tuner.recordIteration(20ms, 8, 8, 8, 0.1), Decision::kKeep);
+    }
+    EXPECT_EQ(tuner.getMaxBatchSize(), 192);
+    EXPECT_EQ(tuner.getMaxNumTokens(), 6144);
+}
+
+TEST(RuntimeBatchTunerTest, iterationStats)
+{
+    RuntimeBatchTuner tuner{makeConfig()};
+    tensorrt_llm::executor::IterationStats stats{};
+    stats.iterLatencyMS = 80.;
+    stats.numActiveRequests = 256;
+    stats.maxBatchSizeStatic = 128;
+    stats.maxNumTokensStatic = 8192;
+    stats.inflightBatchingStats = tensorrt_llm::executor::InflightBatchingStats{};
+    stats.inflightBatchingStats->numGenRequests = 200;
+    stats.inflightBatchingStats->numCtxTokens = 100;
+    for (SizeType32 i = 0; i < 4; ++i)
+    {
+        tuner.recordIteration(stats);
+    }
+    EXPECT_EQ(tuner.getLastDecision(), Decision::kDecreaseLatency);
+    tuner.fillIterationStats(stats);
+    EXPECT_EQ(stats.maxBatchSizeTunerRecommended, 192);
+    EXPECT_EQ(stats.maxBatchSizeRuntime, 128);
+    EXPECT_EQ(stats.maxNumTokensTunerRecommended, 6144);
+    EXPECT_EQ(stats.maxNumTokensRuntime, 6144);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/sloCapacityScheduler.h"
+
+#include <chrono>
+#include <memory>
+
+using namespace tensorrt_llm::batch_manager;
+using namespace std::chrono_literals;
+
+namespace
+{
+std::shared_ptr<LlmRequest> createRequest(LlmRequest::RequestIdType requestId, SizeType32 promptLen)
+{
+    auto tokens = std::make_shared<std::vector<LlmRequest::TokenIdType>>(promptLen, 1);
+    return std::make_shared<LlmRequest>(requestId, 16, tokens, tensorrt_llm::runtime::SamplingConfig{1}, false);
+}
+} // namespace
+
+TEST(RequestSloTrackerTest, slackOfTimeToFirstToken)
+{
+    RequestSloTracker tracker;
+    auto const now = RequestSloTracker::TimePoint{} + 1h;
+    auto const interactive = createRequest(1, 100);
+    auto const batch = createRequest(2, 100);
+    tracker.setSlo(interactive->mRequestId, RequestSlo{300ms, 50ms, 0});
+    tracker.observe(*interactive, now);
+    tracker.observe(*batch, now);
+
+    EXPECT_EQ(tracker.getSlack(*interactive, now + 100ms), 200ms);
+    EXPECT_EQ(tracker.getSlack(*batch, now + 100ms), RequestSloTracker::kNoDeadline);
+    // 100 prompt tokens at 1000 tokens per second take 100ms.
+    EXPECT_EQ(tracker.getSlack(*interactive, now + 100ms, 1000.), 100ms);
+    EXPECT_LT(tracker.getSlack(*interactive, now + 400ms).count(), 0);
+}
+
+TEST(RequestSloTrackerTest, priorityClass)
+{
+    RequestSloTracker tracker;
+    auto const request = createRequest(1, 8);
+    EXPECT_EQ(tracker.getPriorityClass(*request), 0);
+    tracker.setSlo(request->mRequestId, RequestSlo{std::nullopt, std::nullopt, 2});
+    EXPECT_EQ(tracker.getPriorityClass(*request), 2);
+    tracker.erase(request->mRequestId);
+    EXPECT_EQ(tracker.getPriorityClass(*request), 0);
+}
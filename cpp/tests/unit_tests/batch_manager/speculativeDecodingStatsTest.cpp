@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/speculativeDecodingStats.h"
+
+using namespace tensorrt_llm::batch_manager;
+using SizeType32 = SpeculativeDecodingStats::SizeType32;
+
+TEST(SpeculativeDecodingStatsTest, countsPerDepth)
+{
+    SpeculativeDecodingStats stats;
+    stats.record(4, 4);
+    stats.record(4, 1);
+    stats.record(4, 0);
+    stats.record(2, 2);
+
+    EXPECT_EQ(stats.numSteps, 4);
+    EXPECT_EQ(stats.numDraftTokens, 14);
+    EXPECT_EQ(stats.numAcceptedDraftTokens, 7);
+    EXPECT_EQ(stats.getNumWastedDraftTokens(), 7);
+    EXPECT_EQ(stats.acceptedLengthsHistogram, (std::vector<SizeType32>{1, 1, 1, 0, 1}));
+    // Depth 0 is reached by all steps, depth 1 by the steps which accepted depth 0.
+    EXPECT_EQ(stats.numReachedPerDepth, (std::vector<SizeType32>{4, 3, 1, 1}));
+    EXPECT_EQ(stats.numAcceptedPerDepth, (std::vector<SizeType32>{3, 2, 1, 1}));
+    EXPECT_DOUBLE_EQ(stats.getAcceptanceProbability(0), 0.75);
+    EXPECT_DOUBLE_EQ(stats.getAcceptanceProbability(1), 2. / 3.);
+    EXPECT_DOUBLE_EQ(stats.getAcceptanceProbability(4), 0.);
+    EXPECT_DOUBLE_EQ(stats.getMeanAcceptedLength(), 1.75);
+
+    auto const metrics = stats.getMetrics();
+    EXPECT_EQ(metrics.totalDraftTokens, 14);
+    EXPECT_EQ(metrics.totalAcceptedDraftTokens, 7);
+    EXPECT_FLOAT_EQ(metrics.acceptanceRate, 0.5f);
+}
+
+TEST(SpeculativeDecodingStatsTest, collectsIterationsAndRequests)
+{
+    SpeculativeDecodingStatsCollector collector;
+    collector.record(1, 3, 2, 5);
+    collector.record(2, 3, 0, 0);
+    collector.record(2, 0, 0);
+
+    auto const iteration = collector.takeIterationStats();
+    EXPECT_EQ(iteration.numSteps, 2);
+    EXPECT_EQ(iteration.acceptedPathsHistogram, (std::vector<SizeType32>{1, 0, 0, 0, 0, 1}));
+    EXPECT_EQ(collector.takeIterationStats().numSteps, 0);
+
+    collector.record(1, 3, 3);
+    EXPECT_EQ(collector.getRequestStats(1).numSteps, 2);
+    EXPECT_EQ(collector.getRequestStats(1).numAcceptedDraftTokens, 5);
+    EXPECT_EQ(collector.getRequestStats(2).getNumWastedDraftTokens(), 3);
+    EXPECT_EQ(collector.getTotalStats().numSteps, 3);
+
+    collector.remove(1);
+    EXPECT_EQ(collector.getRequestStats(1).numSteps, 0);
+
+    SpeculativeDecodingStats merged = iteration;
+    merged.merge(collector.getRequestStats(2));
+    EXPECT_EQ(merged.numSteps, 3);
+    EXPECT_EQ(merged.numReachedPerDepth, (std::vector<SizeType32>{3, 1, 1}));
+}
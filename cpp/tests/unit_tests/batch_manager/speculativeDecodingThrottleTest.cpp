@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/batch_manager/speculativeDecodingThrottle.h"
+
+using namespace tensorrt_llm::batch_manager;
+using SizeType32 = SpeculativeDecodingThrottle::SizeType32;
+
+namespace
+{
+// Steps with drafts produce 3 tokens per request, at a cost that grows with the batch size and exceeds the gain from
+// 32 requests on.
+void runSteps(SpeculativeDecodingThrottle& throttle, SizeType32 numGenRequests, SizeType32 numSteps)
+{
+    for (SizeType32 i = 0; i < numSteps; ++i)
+    {
+        auto const enabled = throttle.isDraftingEnabled(numGenRequests);
+        auto const tokensPerRequest = enabled ? 3 : 1;
+        auto const stepTimeMs = enabled ? 10. + numGenRequests : 10. + numGenRequests / 8.;
+        throttle.update(numGenRequests, enabled, tokensPerRequest * numGenRequests, stepTimeMs);
+    }
+}
+} // namespace
+
+TEST(SpeculativeDecodingThrottleTest, measuresBothModes)
+{
+    SpeculativeDecodingThrottle throttle{{2, 0, 0.5, 0.}};
+    EXPECT_FALSE(throttle.getPreference(4).has_value());
+    EXPECT_TRUE(throttle.isDraftingEnabled(4));
+    throttle.update(4, true, 12, 14.);
+    throttle.update(4, true, 12, 14.);
+    EXPECT_FALSE(throttle.isDraftingEnabled(4));
+    throttle.update(4, false, 4, 11.);
+    EXPECT_FALSE(throttle.getPreference(4).has_value());
+    throttle.update(4, false, 4, 11.);
+    ASSERT_TRUE(throttle.getPreference(4).has_value());
+    EXPECT_TRUE(*throttle.getPreference(4));
+    // 5 to 7 requests share the bucket of 4.
+    EXPECT_TRUE(throttle.isDraftingEnabled(7));
+}
+
+TEST(SpeculativeDecodingThrottleTest, disablesDraftingAtHighLoad)
+{
+    SpeculativeDecodingThrottle throttle{{4, 0, 0.2, 0.05}};
+    for (SizeType32 numGenRequests : {1, 4, 16, 64, 256})
+    {
+        runSteps(throttle, numGenRequests, 16);
+    }
+    EXPECT_TRUE(throttle.isDraftingEnabled(1));
+    EXPECT_TRUE(throttle.isDraftingEnabled(4));
+    EXPECT_TRUE(throttle.isDraftingEnabled(16));
+    EXPECT_FALSE(throttle.isDraftingEnabled(64));
+    EXPECT_FALSE(throttle.isDraftingEnabled(256));
+}
+
+TEST(SpeculativeDecodingThrottleTest, inheritsPreferenceOfSmallerBatches)
+{
+    SpeculativeDecodingThrottle throttle{{4, 0, 0.2, 0.05}};
+    runSteps(throttle, 64, 16);
+    ASSERT_TRUE(throttle.getPreference(64).has_value());
+    EXPECT_FALSE(*throttle.getPreference(64));
+    // Unmeasured larger batches start without drafts, unmeasured smaller ones with drafts.
+    EXPECT_FALSE(throttle.isDraftingEnabled(128));
+    EXPECT_TRUE(throttle.isDraftingEnabled(8));
+}
+
+TEST(SpeculativeDecodingThrottleTest, probesOtherMode)
+{
+    SpeculativeDecodingThrottle throttle{{1, 4, 1., 0.}};
+    runSteps(throttle, 1, 2);
+    ASSERT_TRUE(throttle.getPreference(1).value_or(false));
+    std::vector<bool> decisions;
+    for (int i = 0; i < 8; ++i)
+    {
+        decisions.push_back(throttle.isDraftingEnabled(1));
+    }
+    EXPECT_EQ(decisions, (std::vector<bool>{true, true, true, false, true, true, true, false}));
+}
+
+TEST(SpeculativeDecodingThrottleTest, invalidArguments)
+{
+    EXPECT_THROW(SpeculativeDecodingThrottle({0, 64, 0.1, 0.05}), tensorrt_llm::common::TllmException);
+    SpeculativeDecodingThrottle throttle;
+    EXPECT_THROW(static_cast<void>(throttle.isDraftingEnabled(0)), tensorrt_llm::common::TllmException);
+    EXPECT_THROW(throttle.update(1, true, 1, 0.), tensorrt_llm::common::TllmException);
+}
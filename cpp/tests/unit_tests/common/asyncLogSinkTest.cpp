@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/asyncLogSink.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tensorrt_llm::common;
+
+namespace
+{
+auto constexpr kPrefix = "[TensorRT-LLM]";
+} // namespace
+
+TEST(AsyncLogSink, formatsOnTheWriterThread)
+{
+    auto& sink = AsyncLogSink::getInstance();
+    testing::internal::CaptureStdout();
+    {
+        // The string argument is copied, it may change once push returns.
+        std::string name = "decoder";
+        ASSERT_TRUE(sink.push(kPrefix, "DEBUG", -1, "step %d of %s took %.1f ms", 3, name.c_str(), 2.5));
+        name = "overwritten";
+        ASSERT_TRUE(sink.push(kPrefix, "INFO", 1, "no arguments"));
+        ASSERT_TRUE(sink.push(kPrefix, "INFO", -1, "null %s", static_cast<char const*>(nullptr)));
+    }
+    sink.flushThread();
+    auto const output = testing::internal::GetCapturedStdout();
+    EXPECT_EQ(output,
+        "[TensorRT-LLM][DEBUG] step 3 of decoder took 2.5 ms\n"
+        "[TensorRT-LLM][INFO][1] no arguments\n"
+        "[TensorRT-LLM][INFO] null (null)\n");
+}
+
+TEST(AsyncLogSink, leavesLongMessagesToTheCaller)
+{
+    auto& sink = AsyncLogSink::getInstance();
+    std::string const longArg(LogRecord::kPayloadSize, 'x');
+    EXPECT_FALSE(sink.push(kPrefix, "INFO", -1, "%s", longArg.c_str()));
+
+    testing::internal::CaptureStdout();
+    EXPECT_TRUE(sink.push(kPrefix, "INFO", -1, "%s", "short"));
+    sink.flushThread();
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "[TensorRT-LLM][INFO] short\n");
+}
+
+TEST(AsyncLogSink, drainsTheThreadsThatExited)
+{
+    auto constexpr kNumThreads = 4;
+    // More messages than a ring holds, so that the threads wait for the writer.
+    auto constexpr kNumMessages = static_cast<int>(2 * AsyncLogSink::kRingCapacity);
+    testing::internal::CaptureStdout();
+    std::vector<std::thread> threads;
+    std::vector<int> numQueued(kNumThreads, 0);
+    for (int ti = 0; ti < kNumThreads; ++ti)
+    {
+        threads.emplace_back(
+            [ti, &numQueued]()
+            {
+                auto& sink = AsyncLogSink::getInstance();
+                for (int mi = 0; mi < kNumMessages; ++mi)
+                {
+                    numQueued[ti] += sink.push(kPrefix, "TRACE", ti, "message %d", mi) ? 1 : 0;
+                }
+                sink.flushThread();
+            });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    auto const output = testing::internal::GetCapturedStdout();
+    for (int ti = 0; ti < kNumThreads; ++ti)
+    {
+        EXPECT_EQ(numQueued[ti], kNumMessages);
+        auto const last = "[TensorRT-LLM][TRACE][" + std::to_string(ti) + "] message "
+            + std::to_string(kNumMessages - 1) + "\n";
+        EXPECT_NE(output.find(last), std::string::npos);
+    }
+    EXPECT_EQ(std::count(output.begin(), output.end(), '\n'), kNumThreads * kNumMessages);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/customAllReduceUtils.h"
+
+#include <sstream>
+
+using namespace tensorrt_llm::utils::customAllReduceUtils;
+using tensorrt_llm::kernels::AllReduceStrategyType;
+
+TEST(AllReduceStrategyProfileTest, defaultMatchesNVLinkThresholds)
+{
+    auto const profile = AllReduceStrategyProfile::getDefault();
+    EXPECT_EQ(profile.select(AllReduceTopology::kNVLINK, 2, 8 << 20), AllReduceStrategyType::ONESHOT);
+    EXPECT_EQ(profile.select(AllReduceTopology::kNVSWITCH, 4, 999 * 1000), AllReduceStrategyType::ONESHOT);
+    EXPECT_EQ(profile.select(AllReduceTopology::kNVSWITCH, 4, 1000 * 1000), AllReduceStrategyType::NCCL);
+    EXPECT_EQ(profile.select(AllReduceTopology::kNVLINK, 8, 400 * 1000), AllReduceStrategyType::ONESHOT);
+    EXPECT_EQ(profile.select(AllReduceTopology::kNVLINK, 8, 600 * 1000), AllReduceStrategyType::NCCL);
+    EXPECT_EQ(profile.select(AllReduceTopology::kPCIE, 2, 1024), AllReduceStrategyType::NCCL);
+    EXPECT_EQ(profile.select(AllReduceTopology::kINTER_NODE, 16, 1024), AllReduceStrategyType::NCCL);
+}
+
+TEST(AllReduceStrategyProfileTest, loadsRulesInOrder)
+{
+    std::istringstream is{R"(# Tuned on a PCIe box with 4 GPUs
+pcie 4 65536 ONESHOT
+
+pcie 4 1048576 TWOSHOT
+nvswitch 8 4000000 ONESHOT
+)"};
+    auto const profile = AllReduceStrategyProfile::load(is);
+    EXPECT_EQ(profile.select(AllReduceTopology::kPCIE, 4, 1024), AllReduceStrategyType::ONESHOT);
+    EXPECT_EQ(profile.select(AllReduceTopology::kPCIE, 2, 100000), AllReduceStrategyType::TWOSHOT);
+    EXPECT_EQ(profile.select(AllReduceTopology::kPCIE, 8, 1024), AllReduceStrategyType::NCCL);
+    EXPECT_EQ(profile.select(AllReduceTopology::kNVSWITCH, 8, 2000000), AllReduceStrategyType::ONESHOT);
+    EXPECT_EQ(profile.select(AllReduceTopology::kNVLINK, 2, 1024), AllReduceStrategyType::NCCL);
+
+    std::istringstream malformed{"nvlink 8 ONESHOT\n"};
+    EXPECT_THROW(AllReduceStrategyProfile::load(malformed), tensorrt_llm::common::TllmException);
+    std::istringstream autoRule{"nvlink 8 1024 AUTO\n"};
+    EXPECT_THROW(AllReduceStrategyProfile::load(autoRule), tensorrt_llm::common::TllmException);
+}
+
+TEST(AllReduceStrategyProfileTest, savesTunedConfigs)
+{
+    using tensorrt_llm::kernels::AllReduceStrategyConfig;
+    std::istringstream is{"nvlink 4 65536 TWOSHOT 2\nnvlink 4 1048576 ONESHOT\n"};
+    auto const profile = AllReduceStrategyProfile::load(is);
+    EXPECT_EQ(profile.selectConfig(AllReduceTopology::kNVLINK, 4, 1024, AllReduceStrategyConfig::USE_MEMCPY),
+        AllReduceStrategyConfig::PUSH_MODE);
+    EXPECT_EQ(profile.selectConfig(AllReduceTopology::kNVLINK, 4, 100000, AllReduceStrategyConfig::USE_MEMCPY),
+        AllReduceStrategyConfig::USE_MEMCPY);
+
+    std::ostringstream os;
+    profile.save(os);
+    EXPECT_EQ(os.str(), is.str());
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/iterationTimeline.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace tensorrt_llm::common;
+
+namespace
+{
+void recordNow(IterationTimeline& timeline, char const* name)
+{
+    auto const start = IterationTimeline::readTicks();
+    timeline.record(name, start, IterationTimeline::readTicks());
+}
+} // namespace
+
+TEST(IterationTimeline, ringKeepsTheLastEvents)
+{
+    IterationTimeline timeline(3, "", {}, {});
+    ASSERT_TRUE(timeline.isRecording());
+    for (char const* name : {"scheduling", "prepare_inputs", "engine_enqueue", "decoder", "response_dispatch"})
+    {
+        recordNow(timeline, name);
+    }
+
+    auto const events = timeline.getEvents();
+    ASSERT_EQ(events.size(), 3);
+    EXPECT_STREQ(events[0].name, "engine_enqueue");
+    EXPECT_STREQ(events[1].name, "decoder");
+    EXPECT_STREQ(events[2].name, "response_dispatch");
+    EXPECT_EQ(events[2].iteration, -1);
+    EXPECT_LE(events[0].startTicks, events[0].endTicks);
+
+    timeline.reset();
+    EXPECT_TRUE(timeline.getEvents().empty());
+}
+
+TEST(IterationTimeline, recordsAndDumpsTheProfiledRange)
+{
+    auto const prefix = (std::filesystem::temp_directory_path() / "iterationTimelineTest").string();
+    IterationTimeline timeline(16, prefix, {1}, {2});
+    EXPECT_FALSE(timeline.isRecording());
+
+    for (int i = 0; i < 4; ++i)
+    {
+        auto const iteration = timeline.beginIteration();
+        EXPECT_EQ(iteration, i);
+        auto const start = IterationTimeline::readTicks();
+        recordNow(timeline, "engine_enqueue");
+        timeline.endIteration(iteration, start);
+        if (iteration == 2)
+        {
+            EXPECT_FALSE(timeline.isRecording());
+        }
+    }
+
+    // Iterations 1 and 2 only, each with its phase and the iteration itself
+    auto const events = timeline.getEvents();
+    ASSERT_EQ(events.size(), 4);
+    EXPECT_STREQ(events[0].name, "engine_enqueue");
+    EXPECT_EQ(events[0].iteration, 1);
+    EXPECT_STREQ(events[1].name, "iteration");
+    EXPECT_EQ(events[3].iteration, 2);
+
+    auto const json = timeline.toChromeTraceJson();
+    EXPECT_NE(json.find("\"traceEvents\": [{\"name\": \"engine_enqueue\""), std::string::npos);
+    EXPECT_NE(json.find("\"ph\": \"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"args\": {\"iteration\": 2}"), std::string::npos);
+
+    // The stop iteration wrote the first dump
+    auto const dumpPath = timeline.dump();
+    auto const firstDump = dumpPath.substr(0, dumpPath.size() - std::string("1.json").size()) + "0.json";
+    std::ifstream stream(firstDump);
+    ASSERT_TRUE(stream.good());
+    std::stringstream content;
+    content << stream.rdbuf();
+    EXPECT_NE(content.str().find("\"args\": {\"iteration\": 1}"), std::string::npos);
+    std::filesystem::remove(firstDump);
+    std::filesystem::remove(dumpPath);
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/memoryMappedFile.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <numeric>
+
+using namespace tensorrt_llm::common;
+namespace fs = std::filesystem;
+
+class MemoryMappedFileTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        mPath = fs::temp_directory_path()
+            / ("memoryMappedFileTest_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) + ".bin");
+    }
+
+    void TearDown() override
+    {
+        fs::remove(mPath);
+    }
+
+    fs::path mPath;
+};
+
+TEST_F(MemoryMappedFileTest, createWriteAndReopen)
+{
+    std::size_t constexpr size = 3 * 4096 + 17;
+    {
+        MemoryMappedFile file(mPath.string(), MemoryMappedFile::Mode::kCREATE, size);
+        ASSERT_EQ(file.size(), size);
+        ASSERT_TRUE(file.isWritable());
+        std::iota(file.data(), file.data() + size, std::uint8_t{0});
+        file.flush();
+    }
+    EXPECT_EQ(fs::file_size(mPath), size);
+
+    MemoryMappedFile file(mPath.string(), MemoryMappedFile::Mode::kREAD_ONLY);
+    ASSERT_EQ(file.size(), size);
+    EXPECT_FALSE(file.isWritable());
+    file.prefetch(0, 0, 4);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        ASSERT_EQ(file.data()[i], static_cast<std::uint8_t>(i));
+    }
+}
+
+TEST_F(MemoryMappedFileTest, adviseUnalignedRange)
+{
+    std::size_t constexpr size = 8192;
+    MemoryMappedFile file(mPath.string(), MemoryMappedFile::Mode::kCREATE, size);
+    EXPECT_NO_THROW(file.advise(MemoryMappedFile::Advice::kWILL_NEED, 100, 5000));
+    EXPECT_NO_THROW(file.flush(4097, 10));
+    EXPECT_THROW(file.advise(MemoryMappedFile::Advice::kRANDOM, size + 1), TllmException);
+}
+
+TEST_F(MemoryMappedFileTest, move)
+{
+    MemoryMappedFile file(mPath.string(), MemoryMappedFile::Mode::kCREATE, 64);
+    file.data()[3] = 42;
+    MemoryMappedFile moved(std::move(file));
+    EXPECT_EQ(moved.size(), 64);
+    EXPECT_EQ(moved.data()[3], 42);
+    EXPECT_EQ(file.data(), nullptr);
+}
+
+TEST_F(MemoryMappedFileTest, missingFile)
+{
+    EXPECT_THROW(MemoryMappedFile(mPath.string(), MemoryMappedFile::Mode::kREAD_ONLY), TllmException);
+}
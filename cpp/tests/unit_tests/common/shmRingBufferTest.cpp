@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/shmRingBuffer.h"
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tensorrt_llm::common;
+
+namespace
+{
+std::string getRingName()
+{
+    return "shmRingBufferTest_" + std::to_string(::testing::UnitTest::GetInstance()->random_seed()) + "_"
+        + ::testing::UnitTest::GetInstance()->current_test_info()->name();
+}
+} // namespace
+
+TEST(ShmRingBufferTest, pushAndPopInPlace)
+{
+    auto producer = ShmRingBuffer::create(getRingName(), 100);
+    auto consumer = ShmRingBuffer::open(getRingName());
+    EXPECT_FALSE(consumer->front().has_value());
+
+    std::string const message = "hello";
+    ASSERT_TRUE(producer->tryPush(message.data(), message.size()));
+    auto const view = consumer->front();
+    ASSERT_TRUE(view.has_value());
+    EXPECT_EQ(std::string(view->begin(), view->end()), message);
+    consumer->popFront();
+    EXPECT_FALSE(consumer->front().has_value());
+}
+
+TEST(ShmRingBufferTest, rejectsWhenFull)
+{
+    auto producer = ShmRingBuffer::create(getRingName(), 128);
+    auto consumer = ShmRingBuffer::open(getRingName());
+    // The largest message takes half of the ring.
+    std::vector<char> const message(producer->getMaxMessageSize(), 'x');
+    ASSERT_TRUE(producer->tryPush(message.data(), message.size()));
+    ASSERT_TRUE(producer->tryPush(message.data(), message.size()));
+    EXPECT_FALSE(producer->tryPush(message.data(), message.size()));
+    consumer->popFront();
+    EXPECT_TRUE(producer->tryPush(message.data(), message.size()));
+}
+
+TEST(ShmRingBufferTest, wrapsAroundInOrder)
+{
+    auto producer = ShmRingBuffer::create(getRingName(), 1024);
+    auto consumer = ShmRingBuffer::open(getRingName());
+    int constexpr numMessages = 20000;
+    std::thread thread(
+        [&producer]()
+        {
+            std::vector<char> message(256);
+            for (int i = 0; i < numMessages; ++i)
+            {
+                std::memcpy(message.data(), &i, sizeof(i));
+                auto const size = sizeof(i) + static_cast<std::size_t>(i * 37) % 200;
+                while (!producer->tryPush(message.data(), size))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    std::vector<char> message;
+    for (int i = 0; i < numMessages; ++i)
+    {
+        ASSERT_TRUE(consumer->waitPop(message, std::chrono::seconds{10}));
+        int value;
+        std::memcpy(&value, message.data(), sizeof(value));
+        ASSERT_EQ(value, i);
+        ASSERT_EQ(message.size(), sizeof(i) + static_cast<std::size_t>(i * 37) % 200);
+    }
+    thread.join();
+}
+
+TEST(ShmRingBufferTest, closeWakesConsumer)
+{
+    auto producer = ShmRingBuffer::create(getRingName(), 128);
+    auto consumer = ShmRingBuffer::open(getRingName());
+    std::thread thread([&producer]() { producer->close(); });
+    std::vector<char> message;
+    EXPECT_FALSE(consumer->waitPop(message, std::chrono::seconds{10}));
+    thread.join();
+    EXPECT_TRUE(consumer->isClosed());
+}
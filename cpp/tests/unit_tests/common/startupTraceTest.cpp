@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/startupTrace.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace tensorrt_llm::common;
+
+TEST(StartupTrace, aggregatesRepeatedPhases)
+{
+    auto& trace = StartupTrace::getInstance();
+    trace.reset();
+    {
+        TLLM_STARTUP_PHASE("engine_deserialize");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        TLLM_STARTUP_PHASE("gemm_plugin_profiling");
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    auto const phases = trace.getPhases();
+    ASSERT_EQ(phases.size(), 2);
+    EXPECT_EQ(phases[0].name, "engine_deserialize");
+    EXPECT_EQ(phases[0].count, 1);
+    EXPECT_GE(phases[0].durationMs, 20.0);
+    EXPECT_EQ(phases[1].name, "gemm_plugin_profiling");
+    EXPECT_EQ(phases[1].count, 3);
+    EXPECT_GE(phases[1].durationMs, 15.0);
+    EXPECT_GE(phases[1].startMs, phases[0].startMs + phases[0].durationMs);
+
+    auto const json = trace.toJson();
+    EXPECT_NE(json.find("\"rank\": "), std::string::npos);
+    EXPECT_NE(json.find("\"name\": \"gemm_plugin_profiling\""), std::string::npos);
+    EXPECT_NE(json.find("\"count\": 3"), std::string::npos);
+
+    trace.reset();
+    EXPECT_TRUE(trace.getPhases().empty());
+}
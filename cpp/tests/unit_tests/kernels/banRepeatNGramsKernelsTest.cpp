@@ -158,8 +158,19 @@ public:
         }
     }
 
+    void runBanRepeatNGramIncremental(SizeType32 batchSize)
+    {
+        tk::invokeBanRepeatNgramIncremental(bufferCast<float>(*mLogits),
+            reinterpret_cast<int32_t const**>(bufferCast<int64_t>(*mOutputIdsPtr)),
+            reinterpret_cast<tk::FinishedState*>(bufferCast<tk::FinishedState::UnderlyingType>(*mFinished)),
+            bufferCast<int32_t>(*mBatchSlots), bufferCast<int32_t>(*mSequenceLengths), batchSize,
+            bufferCast<int32_t>(*mNGramSizes), mVocabSizePadded, bufferCast<int32_t>(*mNgramTables), mNgramTableSize,
+            mStream->get());
+    }
+
     void runBanRepeatNGramTest(std::vector<std::vector<SizeType32>> const& outputIds,
-        std::vector<SizeType32> const& nGramSizes, std::vector<SizeType32> const& expectedLastId)
+        std::vector<SizeType32> const& nGramSizes, std::vector<SizeType32> const& expectedLastId,
+        bool incremental = false, bool stepwise = false)
     {
         auto const batchSize = expectedLastId.size();
         int32_t maxStep = 0;
@@ -169,6 +180,36 @@ public:
         }
         initData(outputIds, nGramSizes);
 
+        if (incremental)
+        {
+            auto const maxBatchSize = 2 * static_cast<SizeType32>(batchSize);
+            mNgramTableSize = tk::getBanRepeatNgramTableSize(mMaxSeqLen);
+            mNgramTables = mBufferManager->gpu(
+                ITensor::makeShape({maxBatchSize, 1 + 2 * mNgramTableSize}), nvinfer1::DataType::kINT32);
+            mBufferManager->setZero(*mNgramTables);
+            if (stepwise)
+            {
+                // Index the sequences one token at a time, the banned logits of these steps are discarded.
+                auto sequenceLengthsPtr = bufferCast<SizeType32>(*mSequenceLengths);
+                auto const batchSlotsPtr = bufferCast<int32_t>(*mBatchSlots);
+                for (SizeType32 step = 1; step < maxStep; ++step)
+                {
+                    for (SizeType32 bi = 0; bi < batchSize; ++bi)
+                    {
+                        auto const finalLength = static_cast<SizeType32>(outputIds[bi].size() - 1);
+                        sequenceLengthsPtr[batchSlotsPtr[bi] * mBeamWidth] = std::min(step, finalLength);
+                    }
+                    runBanRepeatNGramIncremental(batchSize);
+                    mStream->synchronize();
+                }
+                initData(outputIds, nGramSizes);
+            }
+            runBanRepeatNGramIncremental(batchSize);
+            mStream->synchronize();
+            verifyBanRepeatNGramResults(nGramSizes, expectedLastId);
+            return;
+        }
+
         tk::invokeBanRepeatNgram(bufferCast<float>(*mLogits),
             reinterpret_cast<int32_t const**>(bufferCast<int64_t>(*mOutputIdsPtr)),
             reinterpret_cast<tk::FinishedState*>(bufferCast<tk::FinishedState::UnderlyingType>(*mFinished)),
@@ -196,6 +237,8 @@ protected:
     TensorPtr mParentIdsPtr;
     TensorPtr mNGramSizes;
     TensorPtr mBatchSlots;
+    TensorPtr mNgramTables;
+    SizeType32 mNgramTableSize{0};
 
     static constexpr SizeType32 mMaxSeqLen{16};
     static constexpr SizeType32 mVocabSizePadded{32};
@@ -229,4 +272,19 @@ TEST_F(BanRepeatNgramKernelsTest, noRepeatNGramsBS2BW1Test)
     }
 }
 
+TEST_F(BanRepeatNgramKernelsTest, noRepeatNGramsIncrementalBS2BW1Test)
+{
+    std::vector<std::vector<std::vector<SizeType32>>> outputIds = {{{1, 2, 3, 6, 2, 3}, {1, 3, 3, 4, 5, 6, 2, 3}},
+        {{1, 2, 3, 2, 3}, {1, 2, 3, 4, 5, 6, 2, 3}}, {{2, 2, 2, 2, 3}, {4, 5, 4, 5, 4, 5}}};
+    std::vector<std::vector<SizeType32>> nGramSizes = {{2, 2}, {3, 2}, {3, 3}};
+    // Positive value shows expected id of the last token. Negative value shows not-expected id of the last token
+    std::vector<std::vector<SizeType32>> expectedOutputIds = {{-3, 3}, {3, -3}, {-2, -5}};
+    for (SizeType32 ti = 0; ti < nGramSizes.size(); ++ti)
+    {
+        // Index the whole sequence at once, like a prompt, and token by token, like generation.
+        this->runBanRepeatNGramTest(outputIds[ti], nGramSizes[ti], expectedOutputIds[ti], true, false);
+        this->runBanRepeatNGramTest(outputIds[ti], nGramSizes[ti], expectedOutputIds[ti], true, true);
+    }
+}
+
 } // end of namespace
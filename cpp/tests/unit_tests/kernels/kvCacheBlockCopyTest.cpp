@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/kvCacheBlockCopy.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+
+namespace tk = tensorrt_llm::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class KVCacheBlockCopyTest : public testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        mStream = std::make_shared<CudaStream>();
+        mBufferManager = std::make_shared<BufferManager>(mStream);
+    }
+
+    std::shared_ptr<CudaStream> mStream;
+    std::shared_ptr<BufferManager> mBufferManager;
+};
+
+TEST_F(KVCacheBlockCopyTest, deviceToHostAndBack)
+{
+    std::int64_t constexpr numBlocks = 8;
+    // Larger than the bytes handled by one CTA and not a multiple of the vector size.
+    std::int64_t constexpr blockSize = 200 * 1024 + 3;
+
+    auto host = BufferManager::pinned(numBlocks * blockSize, nvinfer1::DataType::kUINT8);
+    auto* hostPtr = bufferCast<std::uint8_t>(*host);
+    for (std::int64_t i = 0; i < numBlocks * blockSize; ++i)
+    {
+        hostPtr[i] = static_cast<std::uint8_t>(i * 7 + 1);
+    }
+    auto device = mBufferManager->gpu(numBlocks * blockSize, nvinfer1::DataType::kUINT8);
+    auto copiedBack = BufferManager::pinned(numBlocks * blockSize, nvinfer1::DataType::kUINT8);
+    auto* copiedBackPtr = bufferCast<std::uint8_t>(*copiedBack);
+    std::fill(copiedBackPtr, copiedBackPtr + numBlocks * blockSize, 0);
+
+    auto descriptors = BufferManager::pinned(numBlocks * sizeof(tk::KVBlockCopyDesc), nvinfer1::DataType::kUINT8);
+    auto* onboardCopies = reinterpret_cast<tk::KVBlockCopyDesc*>(descriptors->data());
+    auto* devicePtr = bufferCast<std::uint8_t>(*device);
+    for (std::int64_t i = 0; i < numBlocks; ++i)
+    {
+        // Reverse the block order to check that every copy uses its own descriptor.
+        onboardCopies[i] = {hostPtr + i * blockSize, devicePtr + (numBlocks - 1 - i) * blockSize, blockSize};
+    }
+    tk::invokeBatchedBlockCopy(onboardCopies, numBlocks, blockSize, mStream->get());
+
+    auto offloadDescriptors
+        = BufferManager::pinned(numBlocks * sizeof(tk::KVBlockCopyDesc), nvinfer1::DataType::kUINT8);
+    auto* offloadCopies = reinterpret_cast<tk::KVBlockCopyDesc*>(offloadDescriptors->data());
+    for (std::int64_t i = 0; i < numBlocks; ++i)
+    {
+        offloadCopies[i] = {devicePtr + (numBlocks - 1 - i) * blockSize, copiedBackPtr + i * blockSize, blockSize};
+    }
+    tk::invokeBatchedBlockCopy(offloadCopies, numBlocks, blockSize, mStream->get());
+    mStream->synchronize();
+
+    for (std::int64_t i = 0; i < numBlocks * blockSize; ++i)
+    {
+        ASSERT_EQ(copiedBackPtr[i], hostPtr[i]) << "at byte " << i;
+    }
+}
+
+} // namespace
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/loraSgmvKernels.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+
+namespace tk = tensorrt_llm::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class LoraSgmvKernelsTest : public testing::Test
+{
+protected:
+    static int32_t constexpr kNumTokens = 12;
+    static int32_t constexpr kNumAdapters = 3;
+    static int32_t constexpr kNumModules = 2;
+    static int32_t constexpr kInHiddenSize = 64;
+    static int32_t constexpr kMaxLowRank = 16;
+    // The weights of two layers are stacked, the test runs the second.
+    static int32_t constexpr kNumLayers = 2;
+    static int32_t constexpr kWeightIndex = 1;
+
+    void SetUp() override
+    {
+        mStream = std::make_shared<CudaStream>();
+        mBufferManager = std::make_shared<BufferManager>(mStream);
+    }
+
+    std::vector<float> randomVector(size_t size)
+    {
+        std::normal_distribution<float> dist(0.f, 1.f);
+        std::vector<float> values(size);
+        std::generate(values.begin(), values.end(), [&]() { return dist(mGen); });
+        return values;
+    }
+
+    std::mt19937 mGen{42};
+    std::shared_ptr<CudaStream> mStream;
+    std::shared_ptr<BufferManager> mBufferManager;
+};
+
+TEST_F(LoraSgmvKernelsTest, heterogeneousRanks)
+{
+    std::vector<int32_t> const outHiddenSizes{48, 200};
+    // Adapter 1 has no LoRA in module 1 and adapter 2 none in module 0.
+    std::vector<int32_t> const ranks{4, 16, 0, 8, 0, 2};
+    std::vector<int32_t> const tokenAdapters{0, 0, 0, 1, -1, 2, 2, 1, 0, -1, 1, 1};
+
+    auto const input = randomVector(kNumTokens * kInHiddenSize);
+    std::vector<std::vector<float>> inWeights(kNumModules * kNumAdapters);
+    std::vector<std::vector<float>> outWeights(kNumModules * kNumAdapters);
+    std::vector<IBuffer::SharedPtr> weightBuffers;
+    std::vector<int64_t> weightPtrs(kNumModules * kNumAdapters * 2, 0);
+    for (int32_t tableIdx = 0; tableIdx < kNumModules * kNumAdapters; ++tableIdx)
+    {
+        auto const rank = ranks[tableIdx];
+        if (rank == 0)
+        {
+            continue;
+        }
+        auto const outHiddenSize = outHiddenSizes[tableIdx / kNumAdapters];
+        inWeights[tableIdx] = randomVector(kNumLayers * rank * kInHiddenSize);
+        outWeights[tableIdx] = randomVector(kNumLayers * outHiddenSize * rank);
+        weightBuffers.push_back(mBufferManager->copyFrom(inWeights[tableIdx], MemoryType::kGPU));
+        weightPtrs[tableIdx * 2] = reinterpret_cast<int64_t>(weightBuffers.back()->data());
+        weightBuffers.push_back(mBufferManager->copyFrom(outWeights[tableIdx], MemoryType::kGPU));
+        weightPtrs[tableIdx * 2 + 1] = reinterpret_cast<int64_t>(weightBuffers.back()->data());
+    }
+
+    auto inputDevice = mBufferManager->copyFrom(input, MemoryType::kGPU);
+    auto tokenAdaptersDevice = mBufferManager->copyFrom(tokenAdapters, MemoryType::kGPU);
+    auto ranksDevice = mBufferManager->copyFrom(ranks, MemoryType::kGPU);
+    auto weightPtrsDevice = mBufferManager->copyFrom(weightPtrs, MemoryType::kGPU);
+    auto lowRank = mBufferManager->gpu(kNumModules * kNumTokens * kMaxLowRank, nvinfer1::DataType::kFLOAT);
+    std::vector<IBuffer::SharedPtr> outputs;
+
+    tk::LoraSgmvParams params;
+    params.input = inputDevice->data();
+    params.tokenAdapters = bufferCast<int32_t>(*tokenAdaptersDevice);
+    params.adapterRanks = bufferCast<int32_t>(*ranksDevice);
+    params.adapterWeightPtrs = bufferCast<int64_t>(*weightPtrsDevice);
+    params.lowRank = lowRank->data();
+    for (int32_t moduleIdx = 0; moduleIdx < kNumModules; ++moduleIdx)
+    {
+        outputs.push_back(mBufferManager->gpu(kNumTokens * outHiddenSizes[moduleIdx], nvinfer1::DataType::kFLOAT));
+        mBufferManager->setZero(*outputs.back());
+        params.outputs[moduleIdx] = outputs.back()->data();
+        params.outHiddenSizes[moduleIdx] = outHiddenSizes[moduleIdx];
+    }
+    params.numTokens = kNumTokens;
+    params.numAdapters = kNumAdapters;
+    params.numModules = kNumModules;
+    params.inHiddenSize = kInHiddenSize;
+    params.maxLowRank = kMaxLowRank;
+    params.weightIndex = kWeightIndex;
+    tk::invokeLoraSgmvShrink<float>(params, mStream->get());
+    tk::invokeLoraSgmvExpand<float>(params, mStream->get());
+
+    for (int32_t moduleIdx = 0; moduleIdx < kNumModules; ++moduleIdx)
+    {
+        auto const outHiddenSize = outHiddenSizes[moduleIdx];
+        auto const outputHost = mBufferManager->copyFrom(*outputs[moduleIdx], MemoryType::kCPU);
+        mStream->synchronize();
+        auto const* output = bufferCast<float>(*outputHost);
+        for (int32_t tokenIdx = 0; tokenIdx < kNumTokens; ++tokenIdx)
+        {
+            auto const adapter = tokenAdapters[tokenIdx];
+            auto const tableIdx = moduleIdx * kNumAdapters + adapter;
+            auto const rank = adapter < 0 ? 0 : ranks[tableIdx];
+            std::vector<float> shrunk(rank, 0.f);
+            for (int32_t r = 0; r < rank; ++r)
+            {
+                auto const* weight = &inWeights[tableIdx][(kWeightIndex * rank + r) * kInHiddenSize];
+                for (int32_t idx = 0; idx < kInHiddenSize; ++idx)
+                {
+                    shrunk[r] += input[tokenIdx * kInHiddenSize + idx] * weight[idx];
+                }
+            }
+            for (int32_t channel = 0; channel < outHiddenSize; ++channel)
+            {
+                float expected = 0.f;
+                for (int32_t r = 0; r < rank; ++r)
+                {
+                    expected += shrunk[r] * outWeights[tableIdx][(kWeightIndex * outHiddenSize + channel) * rank + r];
+                }
+                ASSERT_NEAR(output[tokenIdx * outHiddenSize + channel], expected, 1e-3f)
+                    << "module " << moduleIdx << " token " << tokenIdx << " channel " << channel;
+            }
+        }
+    }
+}
+
+} // namespace
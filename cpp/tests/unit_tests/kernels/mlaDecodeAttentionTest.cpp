@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/mlaDecodeAttention.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cuda_fp16.h>
+#include <random>
+
+namespace tk = tensorrt_llm::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class MlaDecodeAttentionTest : public testing::Test
+{
+protected:
+    static int32_t constexpr kBatchSize = 2;
+    // More heads than a CTA handles, with a partial chunk.
+    static int32_t constexpr kNumHeads = 20;
+    static int32_t constexpr kLatentDim = 512;
+    static int32_t constexpr kHeadSize = kLatentDim + 64;
+    static int32_t constexpr kTokensPerBlock = 64;
+    static int32_t constexpr kMaxBlocksPerSeq = 8;
+    // One K and one V block per block of every sequence.
+    static int32_t constexpr kNumPoolBlocks = kBatchSize * 2 * kMaxBlocksPerSeq;
+
+    void SetUp() override
+    {
+        mStream = std::make_shared<CudaStream>();
+        mBufferManager = std::make_shared<BufferManager>(mStream);
+
+        std::mt19937 gen(42);
+        std::normal_distribution<float> dist(0.f, 1.f);
+        // Round through half, so that the reference sees the values of the kernel.
+        auto const sample = [&]() { return __half2float(__float2half(dist(gen))); };
+        mPool.resize(static_cast<size_t>(kNumPoolBlocks) * kTokensPerBlock * kHeadSize);
+        std::generate(mPool.begin(), mPool.end(), sample);
+        mQ.resize(static_cast<size_t>(kBatchSize) * kNumHeads * kHeadSize);
+        std::generate(mQ.begin(), mQ.end(), sample);
+
+        for (int32_t batchIdx = 0; batchIdx < kBatchSize; ++batchIdx)
+        {
+            for (int32_t kvIdx = 0; kvIdx < 2; ++kvIdx)
+            {
+                for (int32_t blockIdx = 0; blockIdx < kMaxBlocksPerSeq; ++blockIdx)
+                {
+                    mOffsets.emplace_back((batchIdx * 2 + kvIdx) * kMaxBlocksPerSeq + blockIdx);
+                }
+            }
+        }
+    }
+
+    float kAt(int32_t batchIdx, int32_t tokenIdx, int32_t channel) const
+    {
+        auto const block = batchIdx * 2 * kMaxBlocksPerSeq + tokenIdx / kTokensPerBlock;
+        return mPool[(static_cast<size_t>(block) * kTokensPerBlock + tokenIdx % kTokensPerBlock) * kHeadSize + channel];
+    }
+
+    void run(std::vector<int32_t> const& kvLengths, int32_t numSplits)
+    {
+        auto const qScale = 1.f / std::sqrt(192.f);
+
+        auto const toHalf = [](std::vector<float> const& values)
+        {
+            std::vector<half> converted(values.size());
+            std::transform(values.begin(), values.end(), converted.begin(), [](float v) { return __float2half(v); });
+            return converted;
+        };
+        auto pool = mBufferManager->copyFrom(toHalf(mPool), MemoryType::kGPU);
+        auto offsets = mBufferManager->gpu(mOffsets.size() * sizeof(tk::KVCacheIndex));
+        mBufferManager->copy(mOffsets.data(), *offsets, MemoryType::kCPU);
+        auto q = mBufferManager->copyFrom(toHalf(mQ), MemoryType::kGPU);
+        auto out = mBufferManager->gpu(kBatchSize * kNumHeads * kLatentDim, nvinfer1::DataType::kHALF);
+        auto lengths = mBufferManager->copyFrom(kvLengths, MemoryType::kGPU);
+        auto workspace = mBufferManager->gpu(std::max<size_t>(
+            tk::getMlaDecodeWorkspaceSize(kBatchSize, kNumHeads, numSplits), 1));
+
+        auto const maxKvLength = *std::max_element(kvLengths.begin(), kvLengths.end());
+        tk::KVBlockArray const kvCache(kBatchSize, kMaxBlocksPerSeq, kTokensPerBlock,
+            static_cast<int32_t>(kHeadSize * sizeof(half)), maxKvLength, maxKvLength, 0, false, pool->data(), nullptr,
+            reinterpret_cast<tk::KVCacheIndex*>(offsets->data()));
+
+        tk::MlaDecodeAttentionParams<half> params;
+        params.q = bufferCast<half>(*q);
+        params.out = bufferCast<half>(*out);
+        params.kvLengths = bufferCast<int32_t>(*lengths);
+        params.batchSize = kBatchSize;
+        params.numHeads = kNumHeads;
+        params.numSplits = numSplits;
+        params.qScale = qScale;
+        params.workspace = workspace->data();
+
+        tk::invokeMlaDecodeAttention(params, kvCache, mStream->get());
+        auto const outHost = mBufferManager->copyFrom(*out, MemoryType::kCPU);
+        mStream->synchronize();
+        auto const* outPtr = bufferCast<half>(*outHost);
+
+        for (int32_t batchIdx = 0; batchIdx < kBatchSize; ++batchIdx)
+        {
+            auto const kvLength = kvLengths[batchIdx];
+            for (int32_t head = 0; head < kNumHeads; ++head)
+            {
+                auto const* qHead = &mQ[(static_cast<size_t>(batchIdx) * kNumHeads + head) * kHeadSize];
+                std::vector<float> scores(kvLength);
+                for (int32_t token = 0; token < kvLength; ++token)
+                {
+                    float score = 0.f;
+                    for (int32_t channel = 0; channel < kHeadSize; ++channel)
+                    {
+                        score += qHead[channel] * kAt(batchIdx, token, channel);
+                    }
+                    scores[token] = score * qScale;
+                }
+                auto const maxScore = *std::max_element(scores.begin(), scores.end());
+                float sum = 0.f;
+                for (auto& score : scores)
+                {
+                    score = std::exp(score - maxScore);
+                    sum += score;
+                }
+                for (int32_t channel = 0; channel < kLatentDim; ++channel)
+                {
+                    float expected = 0.f;
+                    for (int32_t token = 0; token < kvLength; ++token)
+                    {
+                        expected += scores[token] / sum * kAt(batchIdx, token, channel);
+                    }
+                    auto const outIdx = (static_cast<size_t>(batchIdx) * kNumHeads + head) * kLatentDim + channel;
+                    auto const actual = __half2float(outPtr[outIdx]);
+                    ASSERT_NEAR(actual, expected, 1e-2f)
+                        << "batch " << batchIdx << " head " << head << " channel " << channel;
+                }
+            }
+        }
+    }
+
+    std::shared_ptr<CudaStream> mStream;
+    std::shared_ptr<BufferManager> mBufferManager;
+    std::vector<float> mPool;
+    std::vector<float> mQ;
+    std::vector<tk::KVCacheIndex> mOffsets;
+};
+
+TEST_F(MlaDecodeAttentionTest, singleSplit)
+{
+    run({300, 45}, 1);
+}
+
+TEST_F(MlaDecodeAttentionTest, multipleSplits)
+{
+    // The second sequence leaves the last splits empty.
+    run({500, 45}, 4);
+}
+
+} // namespace
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/moeAllToAllKernels.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <random>
+
+namespace tk = tensorrt_llm::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class MoeAllToAllKernelsTest : public testing::Test
+{
+protected:
+    // More tokens than the CTA of the slot assignment handles at once.
+    static int32_t constexpr kNumTokens = 300;
+    static int32_t constexpr kNumExperts = 16;
+    static int32_t constexpr kTopK = 2;
+    static int32_t constexpr kEpSize = 4;
+    static int32_t constexpr kExpertsPerRank = kNumExperts / kEpSize;
+    static int32_t constexpr kHiddenSize = 40;
+
+    void SetUp() override
+    {
+        mStream = std::make_shared<CudaStream>();
+        mBufferManager = std::make_shared<BufferManager>(mStream);
+
+        std::mt19937 gen(42);
+        std::normal_distribution<float> dist(0.f, 1.f);
+        mLogits.resize(kNumTokens * kNumExperts);
+        std::generate(mLogits.begin(), mLogits.end(), [&]() { return dist(gen); });
+        mHidden.resize(kNumTokens * kHiddenSize);
+        std::generate(mHidden.begin(), mHidden.end(), [&]() { return dist(gen); });
+
+        // Both top-2 experts of token 1 are on rank 2, which receives the token once.
+        std::fill_n(&mLogits[1 * kNumExperts], kNumExperts, 0.f);
+        mLogits[1 * kNumExperts + 2 * kExpertsPerRank] = 3.f;
+        mLogits[1 * kNumExperts + 2 * kExpertsPerRank + 1] = 2.f;
+        // Three experts of token 2 on ranks 0, 1 and 3 are tied for the top-2, and all their ranks receive the token.
+        std::fill_n(&mLogits[2 * kNumExperts], kNumExperts, 0.f);
+        mLogits[2 * kNumExperts + 0 * kExpertsPerRank] = 1.f;
+        mLogits[2 * kNumExperts + 1 * kExpertsPerRank] = 1.f;
+        mLogits[2 * kNumExperts + 3 * kExpertsPerRank] = 1.f;
+    }
+
+    // Ranks of the experts with a logit at least the k-th largest one.
+    std::vector<bool> expectedRanks(int32_t tokenIdx) const
+    {
+        std::vector<float> sorted(&mLogits[tokenIdx * kNumExperts], &mLogits[(tokenIdx + 1) * kNumExperts]);
+        std::sort(sorted.begin(), sorted.end(), std::greater<float>());
+        std::vector<bool> ranks(kEpSize, false);
+        for (int32_t expert = 0; expert < kNumExperts; ++expert)
+        {
+            if (mLogits[tokenIdx * kNumExperts + expert] >= sorted[kTopK - 1])
+            {
+                ranks[expert / kExpertsPerRank] = true;
+            }
+        }
+        return ranks;
+    }
+
+    std::shared_ptr<CudaStream> mStream;
+    std::shared_ptr<BufferManager> mBufferManager;
+    std::vector<float> mLogits;
+    std::vector<float> mHidden;
+};
+
+TEST_F(MoeAllToAllKernelsTest, dispatchAndCombine)
+{
+    auto logits = mBufferManager->copyFrom(mLogits, MemoryType::kGPU);
+    auto hidden = mBufferManager->copyFrom(mHidden, MemoryType::kGPU);
+    auto sendCounts = mBufferManager->gpu(kEpSize, nvinfer1::DataType::kINT32);
+    auto sendTokenIds = mBufferManager->gpu(kEpSize * kNumTokens, nvinfer1::DataType::kINT32);
+    auto tokenSendSlots = mBufferManager->gpu(kNumTokens * kEpSize, nvinfer1::DataType::kINT32);
+    auto sendRows = mBufferManager->gpu(kEpSize * kNumTokens * kHiddenSize, nvinfer1::DataType::kFLOAT);
+
+    tk::MoeAllToAllPlanParams params;
+    params.routingLogits = bufferCast<float>(*logits);
+    params.sendCounts = bufferCast<int32_t>(*sendCounts);
+    params.sendTokenIds = bufferCast<int32_t>(*sendTokenIds);
+    params.tokenSendSlots = bufferCast<int32_t>(*tokenSendSlots);
+    params.numTokens = kNumTokens;
+    params.numExperts = kNumExperts;
+    params.topK = kTopK;
+    params.epSize = kEpSize;
+    tk::invokeMoeAllToAllPlan(params, mStream->get());
+    tk::invokeMoeAllToAllGatherRows(bufferCast<float>(*hidden), kHiddenSize * sizeof(float),
+        bufferCast<int32_t>(*sendCounts), bufferCast<int32_t>(*sendTokenIds), kNumTokens, kEpSize,
+        bufferCast<float>(*sendRows), mStream->get());
+
+    auto const countsHost = mBufferManager->copyFrom(*sendCounts, MemoryType::kCPU);
+    auto const tokenIdsHost = mBufferManager->copyFrom(*sendTokenIds, MemoryType::kCPU);
+    auto const slotsHost = mBufferManager->copyFrom(*tokenSendSlots, MemoryType::kCPU);
+    auto rowsHost = mBufferManager->copyFrom(*sendRows, MemoryType::kCPU);
+    mStream->synchronize();
+    auto const* counts = bufferCast<int32_t>(*countsHost);
+    auto const* tokenIds = bufferCast<int32_t>(*tokenIdsHost);
+    auto const* slots = bufferCast<int32_t>(*slotsHost);
+    auto* rows = bufferCast<float>(*rowsHost);
+
+    std::vector<int32_t> offsets(kEpSize, 0);
+    for (int32_t rank = 1; rank < kEpSize; ++rank)
+    {
+        offsets[rank] = offsets[rank - 1] + counts[rank - 1];
+    }
+    for (int32_t rank = 0; rank < kEpSize; ++rank)
+    {
+        int32_t expectedSlot = 0;
+        for (int32_t tokenIdx = 0; tokenIdx < kNumTokens; ++tokenIdx)
+        {
+            auto const slot = slots[tokenIdx * kEpSize + rank];
+            if (!expectedRanks(tokenIdx)[rank])
+            {
+                ASSERT_EQ(slot, -1) << "token " << tokenIdx << " rank " << rank;
+                continue;
+            }
+            // The tokens keep their order in the rows of every rank.
+            ASSERT_EQ(slot, expectedSlot) << "token " << tokenIdx << " rank " << rank;
+            ASSERT_EQ(tokenIds[rank * kNumTokens + slot], tokenIdx);
+            for (int32_t idx = 0; idx < kHiddenSize; ++idx)
+            {
+                ASSERT_EQ(rows[(offsets[rank] + slot) * kHiddenSize + idx], mHidden[tokenIdx * kHiddenSize + idx]);
+            }
+            ++expectedSlot;
+        }
+        ASSERT_EQ(counts[rank], expectedSlot) << "rank " << rank;
+    }
+    EXPECT_EQ(slots[1 * kEpSize + 2], 0);
+    EXPECT_EQ(std::count_if(&slots[2 * kEpSize], &slots[3 * kEpSize], [](int32_t slot) { return slot >= 0; }), 3);
+
+    // Every rank returns its rows scaled by the rank + 1 as partial outputs.
+    for (int32_t rank = 0; rank < kEpSize; ++rank)
+    {
+        for (int32_t idx = 0; idx < counts[rank] * kHiddenSize; ++idx)
+        {
+            rows[offsets[rank] * kHiddenSize + idx] *= static_cast<float>(rank + 1);
+        }
+    }
+    auto returnedRows = mBufferManager->copyFrom(*rowsHost, MemoryType::kGPU);
+    auto output = mBufferManager->gpu(kNumTokens * kHiddenSize, nvinfer1::DataType::kFLOAT);
+    tk::invokeMoeAllToAllCombine(bufferCast<float>(*returnedRows), bufferCast<int32_t>(*sendCounts),
+        bufferCast<int32_t>(*tokenSendSlots), kNumTokens, kEpSize, kHiddenSize, bufferCast<float>(*output),
+        mStream->get());
+    auto const outputHost = mBufferManager->copyFrom(*output, MemoryType::kCPU);
+    mStream->synchronize();
+    auto const* out = bufferCast<float>(*outputHost);
+
+    for (int32_t tokenIdx = 0; tokenIdx < kNumTokens; ++tokenIdx)
+    {
+        auto const ranks = expectedRanks(tokenIdx);
+        float scale = 0.f;
+        for (int32_t rank = 0; rank < kEpSize; ++rank)
+        {
+            scale += ranks[rank] ? static_cast<float>(rank + 1) : 0.f;
+        }
+        for (int32_t idx = 0; idx < kHiddenSize; ++idx)
+        {
+            ASSERT_NEAR(out[tokenIdx * kHiddenSize + idx], scale * mHidden[tokenIdx * kHiddenSize + idx], 1e-4f)
+                << "token " << tokenIdx << " idx " << idx;
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tensorrt_llm/kernels/residualRmsNormQuantKernels.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cuda_fp16.h>
+#ifdef ENABLE_FP8
+#include <cuda_fp8.h>
+#endif
+
+namespace tk = tensorrt_llm::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+#ifdef ENABLE_FP8
+TEST(ResidualRmsNormQuantTest, fp8MatchesReference)
+{
+    SizeType32 constexpr numTokens = 3;
+    // Not a multiple of the CTA size, the last pass is partial.
+    SizeType32 constexpr hiddenSize = 1040;
+    float constexpr eps = 1e-6F;
+    float constexpr scale = 0.5F;
+    auto constexpr numElements = static_cast<std::size_t>(numTokens) * hiddenSize;
+
+    auto stream = std::make_shared<CudaStream>();
+    BufferManager manager{stream};
+
+    auto inter = BufferManager::pinned(numElements, nvinfer1::DataType::kHALF);
+    auto residual = BufferManager::pinned(numElements, nvinfer1::DataType::kHALF);
+    auto gamma = BufferManager::pinned(hiddenSize, nvinfer1::DataType::kHALF);
+    auto scaleBuffer = BufferManager::pinned(1, nvinfer1::DataType::kFLOAT);
+    auto output = BufferManager::pinned(numElements, nvinfer1::DataType::kFP8);
+    auto* interPtr = bufferCast<half>(*inter);
+    auto* residualPtr = bufferCast<half>(*residual);
+    auto* gammaPtr = bufferCast<half>(*gamma);
+    for (std::size_t i = 0; i < numElements; ++i)
+    {
+        interPtr[i] = __float2half(std::sin(0.1F * static_cast<float>(i)));
+        residualPtr[i] = __float2half(0.25F * std::cos(0.3F * static_cast<float>(i)));
+    }
+    for (SizeType32 i = 0; i < hiddenSize; ++i)
+    {
+        gammaPtr[i] = __float2half(0.5F + static_cast<float>(i % 7) / 7.F);
+    }
+    *bufferCast<float>(*scaleBuffer) = scale;
+
+    std::vector<float> expectedResidual(numElements);
+    std::vector<float> expectedOutput(numElements);
+    for (SizeType32 token = 0; token < numTokens; ++token)
+    {
+        float sumSquares{0.F};
+        for (SizeType32 i = 0; i < hiddenSize; ++i)
+        {
+            auto const idx = token * hiddenSize + i;
+            auto const sum = __half2float(interPtr[idx]) + __half2float(residualPtr[idx]);
+            expectedResidual[idx] = __half2float(__float2half(sum));
+            sumSquares += expectedResidual[idx] * expectedResidual[idx];
+        }
+        auto const invRms = 1.F / std::sqrt(sumSquares / hiddenSize + eps);
+        for (SizeType32 i = 0; i < hiddenSize; ++i)
+        {
+            auto const idx = token * hiddenSize + i;
+            expectedOutput[idx] = expectedResidual[idx] * invRms * __half2float(gammaPtr[i]) / scale;
+        }
+    }
+
+    tk::AllReduceParams params;
+    params.elts_total = numElements;
+    params.local_output_buffer_ptr = output->data();
+    params.fusion_params.residual_buffer = residual->data();
+    params.fusion_params.weight_buffer = gamma->data();
+    params.fusion_params.intermediate_buffer = inter->data();
+    params.fusion_params.hidden_size = hiddenSize;
+    params.fusion_params.eps = eps;
+    tk::residualRmsNormQuant(params, nvinfer1::DataType::kHALF, tk::AllReduceFusionOp::RESIDUAL_RMS_NORM_QUANT_FP8,
+        bufferCast<float>(*scaleBuffer), nullptr, stream->get());
+    stream->synchronize();
+
+    auto const* outputPtr = bufferCast<__nv_fp8_e4m3>(*output);
+    for (std::size_t i = 0; i < numElements; ++i)
+    {
+        ASSERT_NEAR(__half2float(interPtr[i]), expectedResidual[i], 1e-3F) << "at element " << i;
+        // E4M3 keeps 3 mantissa bits.
+        ASSERT_NEAR(static_cast<float>(outputPtr[i]), expectedOutput[i], std::abs(expectedOutput[i]) / 8.F + 1e-2F)
+            << "at element " << i;
+    }
+}
+#endif
+
+} // namespace
@@ -9,6 +9,7 @@
 #include "tensorrt_llm/kernels/weightOnlyBatchedGemv/int8SQ.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -308,3 +309,73 @@ TEST(Kernel, WeightOnly)
         }
     }
 }
+
+// The fused gated MLP against the plain GEMV of the 2 * n channels followed by silu(gate) * up on the host.
+bool verify_gated(int m, int n, int k, tensorrt_llm::common::QuantMode const& quant_mode)
+{
+    std::srand(20240123);
+    bool per_token = quant_mode.hasPerTokenScaling();
+    bool per_channel = quant_mode.hasPerChannelScaling();
+    printf("gated mnk (%d, %d, %d), per token: %d, per channel: %d\n", m, n, k, per_token ? 1 : 0, per_channel ? 1 : 0);
+    CudaBuffer d_act(m * k);
+    CudaBuffer d_weight(k * 2 * n);
+    CudaBuffer d_scale_tokens(per_token ? m * sizeof(float) : sizeof(float));
+    CudaBuffer d_scale_channels(per_channel ? 2 * n * sizeof(float) : sizeof(float));
+    CudaBuffer d_intermediate(m * 2 * n * sizeof(float));
+    CudaBuffer d_out(m * n * sizeof(float));
+    std::vector<int8_t> h_act(m * k);
+    std::vector<int8_t> h_weight(k * 2 * n);
+    std::vector<float> h_scale_tokens(per_token ? m : 1), h_scale_channels(per_channel ? 2 * n : 1);
+    std::vector<float> h_intermediate(m * 2 * n), h_out(m * n), h_ref(m * n);
+
+    random_fill(h_scale_tokens, -0.01f, 0.01f);
+    random_fill(h_scale_channels, -0.01f, 0.01f);
+    for (int8_t& v : h_act)
+    {
+        v = (rand() % 256) - 128;
+    }
+    for (int8_t& v : h_weight)
+    {
+        v = (rand() % 256) - 128;
+    }
+    d_act.copy_from(h_act.data());
+    d_weight.copy_from(h_weight.data());
+    d_scale_tokens.copy_from(h_scale_tokens.data());
+    d_scale_channels.copy_from(h_scale_channels.data());
+
+    Params params{d_act.data<int8_t>(), d_weight.data<int8_t>(), d_scale_tokens.data<float>(),
+        d_scale_channels.data<float>(), d_intermediate.data(), m, 2 * n, k, quant_mode};
+    int8_sq_launcher<float>(params, nullptr);
+    params.output = d_out.data();
+    params.n = n;
+    params.gated = true;
+    int8_sq_launcher<float>(params, nullptr);
+    cudaDeviceSynchronize();
+    d_intermediate.copy_to(h_intermediate.data());
+    d_out.copy_to(h_out.data());
+
+    for (int i = 0; i < m; ++i)
+    {
+        for (int j = 0; j < n; ++j)
+        {
+            float gate = h_intermediate[i * 2 * n + j];
+            float up = h_intermediate[i * 2 * n + n + j];
+            h_ref[i * n + j] = gate / (1.f + std::exp(-gate)) * up;
+        }
+    }
+    return compare<float>(h_out.data(), h_ref.data(), m * n, 1e-3f);
+}
+
+TEST(Kernel, SmoothQuantGatedMlp)
+{
+    std::vector<tensorrt_llm::common::QuantMode> quant_modes(2);
+    quant_modes[0] = tensorrt_llm::common::QuantMode::fromDescription(false, false, false, false);
+    quant_modes[1] = tensorrt_llm::common::QuantMode::fromDescription(false, false, true, true);
+    for (auto m : {1, 3})
+    {
+        for (auto quant_mode : quant_modes)
+        {
+            EXPECT_TRUE(verify_gated(m, 1024, 2048, quant_mode));
+        }
+    }
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/sparseKvAttention.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace tk = tensorrt_llm::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class SparseKvAttentionTest : public testing::Test
+{
+protected:
+    static int32_t constexpr kBatchSize = 2;
+    static int32_t constexpr kNumHeads = 4;
+    static int32_t constexpr kNumKvHeads = 2;
+    static int32_t constexpr kHeadSize = 64;
+    static int32_t constexpr kTokensPerBlock = 16;
+    static int32_t constexpr kMaxBlocksPerSeq = 8;
+    // One K and one V block per block of every sequence.
+    static int32_t constexpr kNumPoolBlocks = kBatchSize * 2 * kMaxBlocksPerSeq;
+
+    void SetUp() override
+    {
+        mStream = std::make_shared<CudaStream>();
+        mBufferManager = std::make_shared<BufferManager>(mStream);
+
+        std::mt19937 gen(42);
+        std::normal_distribution<float> dist(0.f, 1.f);
+        mPool.resize(static_cast<size_t>(kNumPoolBlocks) * kTokensPerBlock * kNumKvHeads * kHeadSize);
+        std::generate(mPool.begin(), mPool.end(), [&]() { return dist(gen); });
+        mQ.resize(kBatchSize * kNumHeads * kHeadSize);
+        std::generate(mQ.begin(), mQ.end(), [&]() { return dist(gen); });
+        // Make one block of the first sequence stand out, so that it must be selected.
+        for (int32_t token = 0; token < kTokensPerBlock; ++token)
+        {
+            for (int32_t channel = 0; channel < kHeadSize; ++channel)
+            {
+                for (int32_t kvHead = 0; kvHead < kNumKvHeads; ++kvHead)
+                {
+                    auto const& q = mQ[kvHead * (kNumHeads / kNumKvHeads) * kHeadSize + channel];
+                    kAt(0, 3 * kTokensPerBlock + token, kvHead, channel) = 2.f * q;
+                }
+            }
+        }
+
+        for (int32_t batchIdx = 0; batchIdx < kBatchSize; ++batchIdx)
+        {
+            for (int32_t kvIdx = 0; kvIdx < 2; ++kvIdx)
+            {
+                for (int32_t blockIdx = 0; blockIdx < kMaxBlocksPerSeq; ++blockIdx)
+                {
+                    mOffsets.emplace_back(poolIndex(batchIdx, kvIdx, blockIdx));
+                }
+            }
+        }
+    }
+
+    static int32_t poolIndex(int32_t batchIdx, int32_t kvIdx, int32_t blockIdx)
+    {
+        return (batchIdx * 2 + kvIdx) * kMaxBlocksPerSeq + blockIdx;
+    }
+
+    float& at(int32_t batchIdx, int32_t kvIdx, int32_t tokenIdx, int32_t kvHead, int32_t channel)
+    {
+        auto const block = poolIndex(batchIdx, kvIdx, tokenIdx / kTokensPerBlock);
+        auto const offset = ((static_cast<size_t>(block) * kNumKvHeads + kvHead) * kTokensPerBlock
+                                + tokenIdx % kTokensPerBlock)
+                * kHeadSize
+            + channel;
+        return mPool[offset];
+    }
+
+    float& kAt(int32_t batchIdx, int32_t tokenIdx, int32_t kvHead, int32_t channel)
+    {
+        return at(batchIdx, 0, tokenIdx, kvHead, channel);
+    }
+
+    float& vAt(int32_t batchIdx, int32_t tokenIdx, int32_t kvHead, int32_t channel)
+    {
+        return at(batchIdx, 1, tokenIdx, kvHead, channel);
+    }
+
+    //! \brief Blocks of a sequence and KV head selected from the exact key ranges.
+    std::vector<int32_t> referenceSelection(
+        int32_t batchIdx, int32_t kvHead, int32_t kvLength, int32_t topKBlocks, int32_t numSinkBlocks)
+    {
+        auto const numBlocks = (kvLength + kTokensPerBlock - 1) / kTokensPerBlock;
+        std::vector<int32_t> blocks(numBlocks);
+        std::iota(blocks.begin(), blocks.end(), 0);
+        if (numBlocks <= topKBlocks)
+        {
+            return blocks;
+        }
+        auto const groupSize = kNumHeads / kNumKvHeads;
+        std::vector<float> scores(numBlocks);
+        for (int32_t block = 0; block < numBlocks; ++block)
+        {
+            float bound = -INFINITY;
+            for (int32_t head = kvHead * groupSize; head < (kvHead + 1) * groupSize; ++head)
+            {
+                float partial = 0.f;
+                for (int32_t channel = 0; channel < kHeadSize; ++channel)
+                {
+                    float kMin = INFINITY;
+                    float kMax = -INFINITY;
+                    for (int32_t token = block * kTokensPerBlock;
+                         token < std::min((block + 1) * kTokensPerBlock, kvLength); ++token)
+                    {
+                        kMin = std::min(kMin, kAt(batchIdx, token, kvHead, channel));
+                        kMax = std::max(kMax, kAt(batchIdx, token, kvHead, channel));
+                    }
+                    auto const q = mQ[(batchIdx * kNumHeads + head) * kHeadSize + channel];
+                    partial += std::max(q * kMin, q * kMax);
+                }
+                bound = std::max(bound, partial);
+            }
+            bool const forced = block < numSinkBlocks || block == numBlocks - 1;
+            scores[block] = forced ? INFINITY : bound;
+        }
+        std::sort(blocks.begin(), blocks.end(), [&](int32_t lhs, int32_t rhs) { return scores[lhs] > scores[rhs]; });
+        blocks.resize(topKBlocks);
+        return blocks;
+    }
+
+    void run(std::vector<int32_t> const& kvLengths, int32_t topKBlocks)
+    {
+        int32_t constexpr numSinkBlocks = 1;
+        auto const qScale = 1.f / std::sqrt(static_cast<float>(kHeadSize));
+
+        auto pool = mBufferManager->copyFrom(mPool, MemoryType::kGPU);
+        auto offsets = mBufferManager->gpu(mOffsets.size() * sizeof(tk::KVCacheIndex));
+        mBufferManager->copy(mOffsets.data(), *offsets, MemoryType::kCPU);
+        auto q = mBufferManager->copyFrom(mQ, MemoryType::kGPU);
+        auto out = mBufferManager->gpu(mQ.size(), nvinfer1::DataType::kFLOAT);
+        auto lengths = mBufferManager->copyFrom(kvLengths, MemoryType::kGPU);
+        auto summaries = mBufferManager->gpu(tk::getKvBlockSummariesSize(kNumPoolBlocks, kNumKvHeads, kHeadSize));
+        auto workspace = mBufferManager->gpu(
+            tk::getSparseKvAttentionWorkspaceSize(kBatchSize, kNumKvHeads, kMaxBlocksPerSeq, topKBlocks));
+
+        auto const maxKvLength = *std::max_element(kvLengths.begin(), kvLengths.end());
+        tk::KVBlockArray const kvCache(kBatchSize, kMaxBlocksPerSeq, kTokensPerBlock,
+            static_cast<int32_t>(kNumKvHeads * kHeadSize * sizeof(float)), maxKvLength, maxKvLength, 0, false,
+            pool->data(), nullptr, reinterpret_cast<tk::KVCacheIndex*>(offsets->data()));
+
+        tk::SparseKvAttentionParams<float> params;
+        params.q = bufferCast<float>(*q);
+        params.out = bufferCast<float>(*out);
+        params.kvLengths = bufferCast<int32_t>(*lengths);
+        // The whole cache is new, so that all summaries are built.
+        params.numNewTokens = params.kvLengths;
+        params.blockSummaries = reinterpret_cast<float*>(summaries->data());
+        params.batchSize = kBatchSize;
+        params.numHeads = kNumHeads;
+        params.numKvHeads = kNumKvHeads;
+        params.headSize = kHeadSize;
+        params.topKBlocks = topKBlocks;
+        params.numSinkBlocks = numSinkBlocks;
+        params.qScale = qScale;
+        params.workspace = workspace->data();
+
+        tk::invokeUpdateKvBlockSummaries(params, kvCache, mStream->get());
+        tk::invokeSparseKvAttention(params, kvCache, mStream->get());
+        auto const outHost = mBufferManager->copyFrom(*out, MemoryType::kCPU);
+        mStream->synchronize();
+        auto const* outPtr = bufferCast<float>(*outHost);
+
+        auto const groupSize = kNumHeads / kNumKvHeads;
+        for (int32_t batchIdx = 0; batchIdx < kBatchSize; ++batchIdx)
+        {
+            for (int32_t head = 0; head < kNumHeads; ++head)
+            {
+                auto const kvHead = head / groupSize;
+                auto const blocks
+                    = referenceSelection(batchIdx, kvHead, kvLengths[batchIdx], topKBlocks, numSinkBlocks);
+                if (batchIdx == 0 && static_cast<int32_t>(blocks.size()) < kvLengths[0] / kTokensPerBlock)
+                {
+                    EXPECT_NE(std::find(blocks.begin(), blocks.end(), 3), blocks.end());
+                }
+                std::vector<int32_t> tokens;
+                for (auto const block : blocks)
+                {
+                    for (int32_t token = block * kTokensPerBlock;
+                         token < std::min((block + 1) * kTokensPerBlock, kvLengths[batchIdx]); ++token)
+                    {
+                        tokens.push_back(token);
+                    }
+                }
+                auto const* qHead = &mQ[(batchIdx * kNumHeads + head) * kHeadSize];
+                std::vector<float> scores;
+                for (auto const token : tokens)
+                {
+                    float score = 0.f;
+                    for (int32_t channel = 0; channel < kHeadSize; ++channel)
+                    {
+                        score += qHead[channel] * qScale * kAt(batchIdx, token, kvHead, channel);
+                    }
+                    scores.push_back(score);
+                }
+                auto const maxScore = *std::max_element(scores.begin(), scores.end());
+                float sum = 0.f;
+                for (auto& score : scores)
+                {
+                    score = std::exp(score - maxScore);
+                    sum += score;
+                }
+                for (int32_t channel = 0; channel < kHeadSize; ++channel)
+                {
+                    float expected = 0.f;
+                    for (size_t ti = 0; ti < tokens.size(); ++ti)
+                    {
+                        expected += scores[ti] / sum * vAt(batchIdx, tokens[ti], kvHead, channel);
+                    }
+                    ASSERT_NEAR(outPtr[(batchIdx * kNumHeads + head) * kHeadSize + channel], expected, 1e-4f)
+                        << "batch " << batchIdx << " head " << head << " channel " << channel;
+                }
+            }
+        }
+    }
+
+    std::shared_ptr<CudaStream> mStream;
+    std::shared_ptr<BufferManager> mBufferManager;
+    std::vector<float> mPool;
+    std::vector<float> mQ;
+    std::vector<tk::KVCacheIndex> mOffsets;
+};
+
+TEST_F(SparseKvAttentionTest, allBlocksMatchDenseAttention)
+{
+    run({100, 37}, kMaxBlocksPerSeq);
+}
+
+TEST_F(SparseKvAttentionTest, topKBlocks)
+{
+    run({100, 37}, 3);
+}
+
+} // namespace
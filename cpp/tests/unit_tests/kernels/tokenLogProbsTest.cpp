@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/tokenLogProbsKernels.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace tk = tensorrt_llm::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class TokenLogProbsTest : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        mStream = std::make_shared<CudaStream>();
+    }
+
+    //! \brief Score random targets of random logits, with every fourth target the greedy token and the last one out
+    //! of the vocab, and check them against the log-softmax on the host.
+    void runTest(SizeType32 seed, SizeType32 numTokens, SizeType32 vocabSize, float temperature)
+    {
+        std::mt19937 generator(seed);
+        std::normal_distribution<float> logitDistr(0.f, 4.f);
+        std::uniform_int_distribution<TokenIdType> idDistr(0, vocabSize - 1);
+
+        auto logits = BufferManager::pinned(ITensor::makeShape({numTokens, vocabSize}), nvinfer1::DataType::kFLOAT);
+        auto targetIds = BufferManager::pinned(ITensor::makeShape({numTokens}), nvinfer1::DataType::kINT32);
+        auto logProbs = BufferManager::pinned(ITensor::makeShape({numTokens}), nvinfer1::DataType::kFLOAT);
+        auto isGreedy = BufferManager::pinned(ITensor::makeShape({numTokens}), nvinfer1::DataType::kBOOL);
+
+        auto* logitsData = bufferCast<float>(*logits);
+        std::generate(logitsData, logitsData + numTokens * vocabSize, [&]() { return logitDistr(generator); });
+        auto* targets = bufferCast<TokenIdType>(*targetIds);
+        for (SizeType32 ti = 0; ti < numTokens; ++ti)
+        {
+            auto const* row = logitsData + ti * vocabSize;
+            targets[ti] = ti % 4 == 0 ? static_cast<TokenIdType>(std::max_element(row, row + vocabSize) - row)
+                                      : idDistr(generator);
+        }
+        targets[numTokens - 1] = vocabSize;
+
+        tk::TokenLogProbsParams<float> params;
+        params.logits = logitsData;
+        params.targetIds = targets;
+        params.logProbs = bufferCast<float>(*logProbs);
+        params.isGreedy = bufferCast<bool>(*isGreedy);
+        params.numTokens = numTokens;
+        params.vocabSize = vocabSize;
+        params.temperature = temperature;
+        tk::invokeTokenLogProbs(params, mStream->get());
+        mStream->synchronize();
+
+        for (SizeType32 ti = 0; ti < numTokens; ++ti)
+        {
+            auto const* row = logitsData + ti * vocabSize;
+            auto const maxLogit = *std::max_element(row, row + vocabSize) / temperature;
+            double sumExp = 0;
+            for (SizeType32 vi = 0; vi < vocabSize; ++vi)
+            {
+                sumExp += std::exp(row[vi] / temperature - maxLogit);
+            }
+            auto const valid = targets[ti] < vocabSize;
+            auto const expected = valid ? row[targets[ti]] / temperature - maxLogit - std::log(sumExp) : 0.;
+            EXPECT_NEAR(bufferCast<float>(*logProbs)[ti], expected, 1e-3) << "token " << ti;
+            EXPECT_EQ(bufferCast<bool>(*isGreedy)[ti], valid && row[targets[ti]] / temperature >= maxLogit)
+                << "token " << ti;
+        }
+    }
+
+protected:
+    std::shared_ptr<CudaStream> mStream;
+};
+
+TEST_F(TokenLogProbsTest, SmallVocab)
+{
+    runTest(0, 9, 100, 1.f);
+}
+
+TEST_F(TokenLogProbsTest, LargeVocab)
+{
+    runTest(1, 33, 32003, 1.f);
+}
+
+TEST_F(TokenLogProbsTest, Temperature)
+{
+    runTest(2, 17, 4096, 0.7f);
+}
+
+} // namespace
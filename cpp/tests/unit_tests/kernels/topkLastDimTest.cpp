@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/topkLastDim.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+namespace tk = tensorrt_llm::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class TopkLastDimTest : public testing::TestWithParam<tk::TopkLastDimSortAlgo>
+{
+public:
+    void SetUp() override
+    {
+        mStream = std::make_shared<CudaStream>();
+        mBufferManager = std::make_shared<BufferManager>(mStream);
+    }
+
+    //! \brief Select the top-k of random rows with many ties and check them against a stable sort on the host: sorted
+    //! by value, ties by index.
+    void runTest(SizeType32 seed, SizeType32 batchSize, SizeType32 inputLength, SizeType32 k, bool isLargest)
+    {
+        auto const sortAlgo = GetParam();
+        std::mt19937 generator(seed);
+        // Few distinct values, so that most of the selected elements are ties.
+        std::uniform_int_distribution<int> valueDistr(-64, 64);
+
+        auto input = BufferManager::pinned(ITensor::makeShape({batchSize, inputLength}), nvinfer1::DataType::kFLOAT);
+        auto outVal = BufferManager::pinned(ITensor::makeShape({batchSize, k}), nvinfer1::DataType::kFLOAT);
+        auto outIdx = BufferManager::pinned(ITensor::makeShape({batchSize, k}), nvinfer1::DataType::kINT32);
+        auto* inputData = bufferCast<float>(*input);
+        std::generate(inputData, inputData + batchSize * inputLength,
+            [&]() { return static_cast<float>(valueDistr(generator)) / 4.F; });
+
+        auto const workspaceSize
+            = tk::invokeComputeTopkLastDimWorkspaceSize<float>(batchSize, inputLength, k, isLargest, sortAlgo);
+        auto workspace = mBufferManager->gpu(workspaceSize);
+        tk::invokeTopkLastDim<float>(batchSize, inputLength, k, isLargest, inputData, bufferCast<float>(*outVal),
+            bufferCast<SizeType32>(*outIdx), workspace->data(), mStream->get(), sortAlgo);
+        mStream->synchronize();
+
+        std::vector<SizeType32> order(inputLength);
+        for (SizeType32 bi = 0; bi < batchSize; ++bi)
+        {
+            auto const* row = inputData + bi * inputLength;
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(),
+                [row, isLargest](SizeType32 lhs, SizeType32 rhs)
+                { return isLargest ? row[lhs] > row[rhs] : row[lhs] < row[rhs]; });
+            for (SizeType32 ki = 0; ki < k; ++ki)
+            {
+                EXPECT_EQ(bufferCast<SizeType32>(*outIdx)[bi * k + ki], order[ki]) << "row " << bi << " rank " << ki;
+                EXPECT_EQ(bufferCast<float>(*outVal)[bi * k + ki], row[order[ki]]) << "row " << bi << " rank " << ki;
+            }
+        }
+    }
+
+protected:
+    std::shared_ptr<CudaStream> mStream;
+    std::shared_ptr<BufferManager> mBufferManager;
+};
+
+TEST_P(TopkLastDimTest, SmallK)
+{
+    runTest(0, 5, 3000, 8, true);
+}
+
+TEST_P(TopkLastDimTest, LargeKOneBlock)
+{
+    runTest(1, 7, 8192, 512, true);
+}
+
+TEST_P(TopkLastDimTest, LargeKLargeVocab)
+{
+    runTest(2, 3, 131072, 1024, true);
+}
+
+TEST_P(TopkLastDimTest, Smallest)
+{
+    runTest(3, 4, 50000, 256, false);
+}
+
+INSTANTIATE_TEST_SUITE_P(TopkLastDimSortAlgos, TopkLastDimTest,
+    testing::Values(tk::TopkLastDimSortAlgo::kAUTO, tk::TopkLastDimSortAlgo::kSEGMENTED,
+        tk::TopkLastDimSortAlgo::kPACKED));
+
+} // namespace
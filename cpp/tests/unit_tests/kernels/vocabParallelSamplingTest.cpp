@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/vocabParallelSamplingKernels.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+namespace tk = tensorrt_llm::kernels;
+namespace tc = tensorrt_llm::common;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class VocabParallelSamplingTest : public testing::Test
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+
+    void SetUp() override
+    {
+        mStream = std::make_shared<CudaStream>();
+        mBufferManager = std::make_shared<BufferManager>(mStream);
+    }
+
+    //! \brief Sample with every top-k from the summaries of tpSize shards of random logits, without curand, so that
+    //! the last token of the top-k is selected, and check it against the reference.
+    void runTest(SizeType32 seed, SizeType32 batchSize, SizeType32 vocabSize, SizeType32 tpSize, SizeType32 topK)
+    {
+        std::mt19937 generator(seed);
+        std::normal_distribution<float> logitDistr(0.f, 4.f);
+
+        auto const shardSize = tc::divUp(vocabSize, tpSize);
+        auto logits = BufferManager::pinned(ITensor::makeShape({batchSize, vocabSize}), nvinfer1::DataType::kFLOAT);
+        auto logitsPtrs = BufferManager::pinned(ITensor::makeShape({tpSize, batchSize}), nvinfer1::DataType::kINT64);
+        auto batchSlots = BufferManager::pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+        auto endIds = BufferManager::pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+        auto seqLengths = BufferManager::pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+        auto outputIds = BufferManager::pinned(ITensor::makeShape({batchSize, mMaxSeqLen}), nvinfer1::DataType::kINT32);
+        auto outputIdsPtrs = BufferManager::pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT64);
+        auto outputLogProbs
+            = BufferManager::pinned(ITensor::makeShape({mMaxSeqLen, batchSize}), nvinfer1::DataType::kFLOAT);
+        auto summaries = BufferManager::pinned(
+            ITensor::makeShape({static_cast<SizeType32>(tpSize * batchSize * sizeof(tk::VocabShardSummary))}),
+            nvinfer1::DataType::kUINT8);
+
+        auto* logitsData = bufferCast<float>(*logits);
+        std::generate(logitsData, logitsData + batchSize * vocabSize, [&]() { return logitDistr(generator); });
+        auto* slots = bufferCast<SizeType32>(*batchSlots);
+        std::iota(slots, slots + batchSize, 0);
+        std::fill_n(bufferCast<SizeType32>(*endIds), batchSize, vocabSize);
+        std::fill_n(bufferCast<SizeType32>(*seqLengths), batchSize, 0);
+        auto** ptrs = reinterpret_cast<float const**>(bufferCast<int64_t>(*logitsPtrs));
+        for (SizeType32 rank = 0; rank < tpSize; ++rank)
+        {
+            for (SizeType32 bi = 0; bi < batchSize; ++bi)
+            {
+                ptrs[rank * batchSize + bi] = logitsData + bi * vocabSize + rank * shardSize;
+            }
+        }
+        auto** idsPtrs = reinterpret_cast<TokenIdType**>(bufferCast<int64_t>(*outputIdsPtrs));
+        for (SizeType32 bi = 0; bi < batchSize; ++bi)
+        {
+            idsPtrs[bi] = bufferCast<TokenIdType>(*outputIds) + bi * mMaxSeqLen;
+        }
+        auto* summaryData = reinterpret_cast<tk::VocabShardSummary*>(bufferCast<uint8_t>(*summaries));
+
+        // The ranks of a tensor parallel group, in sequence, the summaries stacked like after the all-gather.
+        for (SizeType32 rank = 0; rank < tpSize; ++rank)
+        {
+            tk::VocabShardSummaryParams<float> summaryParams;
+            summaryParams.logitsPtrs = ptrs + rank * batchSize;
+            summaryParams.batchSlots = slots;
+            summaryParams.endIds = bufferCast<TokenIdType>(*endIds);
+            summaryParams.summaries = summaryData + rank * batchSize;
+            summaryParams.batchSize = batchSize;
+            summaryParams.maxTopK = topK;
+            summaryParams.vocabOffset = rank * shardSize;
+            summaryParams.shardVocabSize = std::clamp(vocabSize - rank * shardSize, 0, shardSize);
+            tk::invokeVocabShardSummary(summaryParams, mStream->get());
+        }
+
+        tk::VocabParallelSampleParams sampleParams;
+        sampleParams.summaries = summaryData;
+        sampleParams.batchSlots = slots;
+        sampleParams.endIds = bufferCast<TokenIdType>(*endIds);
+        sampleParams.outputIdsPtrs = idsPtrs;
+        sampleParams.sequenceLengths = bufferCast<SizeType32>(*seqLengths);
+        sampleParams.outputLogProbs = bufferCast<float>(*outputLogProbs);
+        sampleParams.batchSize = batchSize;
+        sampleParams.maxBatchSize = batchSize;
+        sampleParams.tpSize = tpSize;
+        sampleParams.maxTopK = topK;
+        sampleParams.vocabSize = vocabSize;
+        tk::invokeVocabParallelSample(sampleParams, mStream->get());
+        mStream->synchronize();
+
+        for (SizeType32 bi = 0; bi < batchSize; ++bi)
+        {
+            auto const* row = logitsData + bi * vocabSize;
+            std::vector<SizeType32> order(vocabSize);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [row](auto a, auto b) { return row[a] > row[b]; });
+            auto const maxLogit = row[order.front()];
+            double sumExp = 0;
+            for (SizeType32 vi = 0; vi < vocabSize; ++vi)
+            {
+                sumExp += std::exp(row[vi] - maxLogit);
+            }
+            auto const expectedId = order[topK - 1];
+            auto const expectedLogProb = row[expectedId] - maxLogit - std::log(sumExp);
+
+            EXPECT_EQ(bufferCast<TokenIdType>(*outputIds)[bi * mMaxSeqLen], expectedId) << "request " << bi;
+            EXPECT_EQ(bufferCast<SizeType32>(*seqLengths)[bi], 1);
+            EXPECT_NEAR(bufferCast<float>(*outputLogProbs)[bi], expectedLogProb, 1e-3) << "request " << bi;
+        }
+    }
+
+protected:
+    std::shared_ptr<BufferManager> mBufferManager;
+    std::shared_ptr<CudaStream> mStream;
+
+    static constexpr SizeType32 mMaxSeqLen = 4;
+};
+
+TEST_F(VocabParallelSamplingTest, GreedySingleShard)
+{
+    runTest(0, 8, 1000, 1, 1);
+}
+
+TEST_F(VocabParallelSamplingTest, GreedyShards)
+{
+    runTest(1, 16, 32000, 4, 1);
+}
+
+TEST_F(VocabParallelSamplingTest, TopKUnevenShards)
+{
+    runTest(2, 5, 32003, 8, 16);
+}
+
+TEST_F(VocabParallelSamplingTest, TopKLargerThanShard)
+{
+    runTest(3, 3, 100, 8, 40);
+}
+
+} // namespace
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/kernels/cutlass_kernels/cutlass_preprocessors.h"
+#include "tensorrt_llm/kernels/cutlass_kernels/preprocessed_weight_cache.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+namespace tkc = tensorrt_llm::kernels::cutlass_kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class MixedGemmPreprocessTest : public testing::TestWithParam<std::tuple<tkc::QuantType, bool>>
+{
+protected:
+    void SetUp() override
+    {
+        mStream = std::make_shared<CudaStream>();
+        mBufferManager = std::make_shared<BufferManager>(mStream);
+    }
+
+    std::vector<int8_t> randomBytes(size_t size)
+    {
+        std::uniform_int_distribution<int> dist(-128, 127);
+        std::vector<int8_t> values(size);
+        for (auto& value : values)
+        {
+            value = static_cast<int8_t>(dist(mGen));
+        }
+        return values;
+    }
+
+    std::mt19937 mGen{42};
+    std::shared_ptr<CudaStream> mStream;
+    std::shared_ptr<BufferManager> mBufferManager;
+};
+
+TEST_P(MixedGemmPreprocessTest, matchesHost)
+{
+    auto const [quantType, isMoe] = GetParam();
+    std::vector<size_t> const shape = isMoe ? std::vector<size_t>{3, 256, 192} : std::vector<size_t>{1, 512, 384};
+    auto const numBytes = shape[0] * shape[1] * shape[2] * tkc::get_weight_quant_bits(quantType) / 8;
+    auto const weight = randomBytes(numBytes);
+
+    std::vector<int8_t> expected(numBytes);
+    tkc::preprocess_weights_for_mixed_gemm(expected.data(), weight.data(), shape, quantType, isMoe);
+
+    auto weightDevice = mBufferManager->copyFrom(weight, MemoryType::kGPU);
+    auto preprocessedDevice = mBufferManager->gpu(numBytes, nvinfer1::DataType::kINT8);
+    auto workspace = mBufferManager->gpu(numBytes, nvinfer1::DataType::kINT8);
+    tkc::preprocess_weights_for_mixed_gemm_cuda(bufferCast<int8_t>(*preprocessedDevice),
+        bufferCast<int8_t>(*weightDevice), bufferCast<int8_t>(*workspace), shape, quantType, isMoe, mStream->get());
+    auto const preprocessedHost = mBufferManager->copyFrom(*preprocessedDevice, MemoryType::kCPU);
+    mStream->synchronize();
+    auto const* preprocessed = bufferCast<int8_t>(*preprocessedHost);
+    for (size_t idx = 0; idx < numBytes; ++idx)
+    {
+        ASSERT_EQ(preprocessed[idx], expected[idx]) << "byte " << idx;
+    }
+
+    // The stored weights are loaded back on the same GPU, and not for another shape.
+    auto const path = testing::TempDir() + "mixedGemmPreprocessTest.weights";
+    tkc::PreprocessedWeightHeader header;
+    header.quant_type = quantType;
+    header.layout = tkc::get_mixed_gemm_weight_layout(quantType, isMoe);
+    header.shape = shape;
+    tkc::save_preprocessed_weights(path, expected.data(), header);
+    std::vector<int8_t> loaded(numBytes);
+    EXPECT_TRUE(tkc::load_preprocessed_weights(path, loaded.data(), shape, quantType, isMoe));
+    EXPECT_EQ(loaded, expected);
+    EXPECT_FALSE(
+        tkc::load_preprocessed_weights(path, loaded.data(), {shape[0], shape[1], 2 * shape[2]}, quantType, isMoe));
+    std::remove(path.c_str());
+}
+
+INSTANTIATE_TEST_SUITE_P(QuantTypes, MixedGemmPreprocessTest,
+    testing::Combine(testing::Values(tkc::QuantType::W8_A16, tkc::QuantType::W4_A16, tkc::QuantType::W4_AFP8),
+        testing::Bool()));
+
+} // namespace
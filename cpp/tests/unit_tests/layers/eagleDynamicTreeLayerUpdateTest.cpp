@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/kernels/samplingTopKKernels.h"
+#include "tensorrt_llm/kernels/speculativeDecoding/eagleDecodingKernels.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+
+namespace tk = tensorrt_llm::kernels;
+namespace tksd = tensorrt_llm::kernels::speculative_decoding;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+// Compares invokeDynamicTreeLayerUpdate with the chain of kernels of EagleDecodeDraftTokensPlugin it replaces, for
+// the draft layers after the first one of Eagle-2, and measures both.
+class EagleDynamicTreeLayerUpdateTest : public testing::Test
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+
+    static SizeType32 constexpr kNumEagleLayers = 4;
+    static SizeType32 constexpr kDynamicTreeMaxTopK = 3;
+    static SizeType32 constexpr kMaxDecodingDraftTokens = 15;
+    static SizeType32 constexpr kMaxDecodingTokens = kMaxDecodingDraftTokens + 1;
+    static SizeType32 constexpr kMaxPathLen = kNumEagleLayers + 1;
+    static SizeType32 constexpr kVocabSize = 32000;
+
+    void SetUp() override
+    {
+        mStream = std::make_shared<CudaStream>();
+        mBufferManager = std::make_shared<BufferManager>(mStream);
+    }
+
+    // Buffers of one draft layer, pinned so that they are filled and checked on the host.
+    struct LayerBuffers
+    {
+        TensorPtr prevScores;
+        TensorPtr currentExpandIndices;
+        TensorPtr inputAllLayersScores;
+        TensorPtr inputAllLayersDraftTokenIds;
+        TensorPtr inputAllLayersDraftTokenIdsPredecessor;
+        TensorPtr inputPaths;
+        TensorPtr inputDraftTokenIds;
+        TensorPtr inputDraftLens;
+        TensorPtr firstTopKOutputLogProbs;
+        TensorPtr firstTopKOutputIds;
+
+        TensorPtr outputAllLayersScores;
+        TensorPtr outputAllLayersDraftTokenIds;
+        TensorPtr outputAllLayersDraftTokenIdsPredecessor;
+        TensorPtr outputPaths;
+        TensorPtr outputNextExpandIndices;
+        TensorPtr outputDraftTokenIds;
+        TensorPtr outputDraftLens;
+        TensorPtr outputCurrentScores;
+
+        // Workspace of the chain.
+        TensorPtr topKs;
+        TensorPtr secondTopKOutputIds;
+        TensorPtr secondTopKOutputIdsPtrs;
+        TensorPtr secondTopKInputScoresPtrs;
+        TensorPtr secondTopKOutputLogProbs;
+        TensorPtr samplingWorkspace;
+    };
+
+    LayerBuffers allocate(SizeType32 batchSize) const
+    {
+        auto const allLayersShape
+            = ITensor::makeShape({batchSize, kNumEagleLayers, kMaxDecodingDraftTokens * kMaxDecodingDraftTokens});
+        auto const draftShape = ITensor::makeShape({batchSize, kMaxDecodingDraftTokens});
+        auto const firstTopKShape = ITensor::makeShape({batchSize * kDynamicTreeMaxTopK, kMaxDecodingDraftTokens});
+        auto const pathsShape = ITensor::makeShape({batchSize, kMaxDecodingTokens, kMaxPathLen});
+        auto const batchShape = ITensor::makeShape({batchSize});
+        auto const ptrType = TRTDataType<void*>::value;
+
+        LayerBuffers buffers;
+        buffers.prevScores = BufferManager::pinned(draftShape, nvinfer1::DataType::kFLOAT);
+        buffers.currentExpandIndices = BufferManager::pinned(draftShape, nvinfer1::DataType::kINT32);
+        buffers.inputAllLayersScores = BufferManager::pinned(allLayersShape, nvinfer1::DataType::kFLOAT);
+        buffers.inputAllLayersDraftTokenIds = BufferManager::pinned(allLayersShape, nvinfer1::DataType::kINT32);
+        buffers.inputAllLayersDraftTokenIdsPredecessor
+            = BufferManager::pinned(allLayersShape, nvinfer1::DataType::kINT32);
+        buffers.inputPaths = BufferManager::pinned(pathsShape, nvinfer1::DataType::kINT32);
+        buffers.inputDraftTokenIds = BufferManager::pinned(draftShape, nvinfer1::DataType::kINT32);
+        buffers.inputDraftLens = BufferManager::pinned(batchShape, nvinfer1::DataType::kINT32);
+        buffers.firstTopKOutputLogProbs = BufferManager::pinned(firstTopKShape, nvinfer1::DataType::kFLOAT);
+        buffers.firstTopKOutputIds = BufferManager::pinned(firstTopKShape, nvinfer1::DataType::kINT32);
+
+        buffers.outputAllLayersScores = BufferManager::pinned(allLayersShape, nvinfer1::DataType::kFLOAT);
+        buffers.outputAllLayersDraftTokenIds = BufferManager::pinned(allLayersShape, nvinfer1::DataType::kINT32);
+        buffers.outputAllLayersDraftTokenIdsPredecessor
+            = BufferManager::pinned(allLayersShape, nvinfer1::DataType::kINT32);
+        buffers.outputPaths = BufferManager::pinned(pathsShape, nvinfer1::DataType::kINT32);
+        buffers.outputNextExpandIndices = BufferManager::pinned(draftShape, nvinfer1::DataType::kINT32);
+        buffers.outputDraftTokenIds = BufferManager::pinned(draftShape, nvinfer1::DataType::kINT32);
+        buffers.outputDraftLens = BufferManager::pinned(batchShape, nvinfer1::DataType::kINT32);
+        buffers.outputCurrentScores = BufferManager::pinned(draftShape, nvinfer1::DataType::kFLOAT);
+
+        buffers.topKs = BufferManager::pinned(batchShape, nvinfer1::DataType::kINT32);
+        buffers.secondTopKOutputIds = BufferManager::pinned(draftShape, nvinfer1::DataType::kINT32);
+        buffers.secondTopKOutputIdsPtrs = BufferManager::pinned(batchShape, ptrType);
+        buffers.secondTopKInputScoresPtrs = BufferManager::pinned(batchShape, ptrType);
+        buffers.secondTopKOutputLogProbs = BufferManager::pinned(draftShape, nvinfer1::DataType::kFLOAT);
+        auto const samplingWorkspaceSize = tk::getTopKWorkspaceSize<float>(
+            batchSize, 1, kDynamicTreeMaxTopK, kDynamicTreeMaxTopK * kMaxDecodingDraftTokens);
+        buffers.samplingWorkspace = mBufferManager->gpu(samplingWorkspaceSize);
+
+        std::fill_n(bufferCast<SizeType32>(*buffers.topKs), batchSize, kDynamicTreeMaxTopK);
+        clearOutputs(buffers);
+        return buffers;
+    }
+
+    static void clearOutputs(LayerBuffers const& buffers)
+    {
+        auto fill = [](TensorPtr const& tensor, auto value)
+        { std::fill_n(bufferCast<decltype(value)>(*tensor), tensor->getSize(), value); };
+        fill(buffers.outputAllLayersScores, 0.f);
+        fill(buffers.outputAllLayersDraftTokenIds, TokenIdType{-1});
+        fill(buffers.outputAllLayersDraftTokenIdsPredecessor, TokenIdType{-1});
+        fill(buffers.outputPaths, SizeType32{-2});
+        fill(buffers.outputNextExpandIndices, TokenIdType{-1});
+        fill(buffers.outputDraftTokenIds, TokenIdType{-1});
+        fill(buffers.outputDraftLens, SizeType32{0});
+        fill(buffers.outputCurrentScores, 0.f);
+    }
+
+    template <typename T>
+    static void copyTensor(TensorPtr const& src, TensorPtr const& dst)
+    {
+        std::copy_n(bufferCast<T>(*src), src->getSize(), bufferCast<T>(*dst));
+    }
+
+    // The state after layer 0: dynamicTreeMaxTopK draft tokens below the root.
+    void initFirstLayerOutputs(LayerBuffers const& buffers, SizeType32 batchSize)
+    {
+        std::uniform_real_distribution<float> scoreDist(-4.f, 0.f);
+        std::uniform_int_distribution<TokenIdType> tokenDist(0, kVocabSize - 1);
+        auto* prevScores = bufferCast<float>(*buffers.prevScores);
+        auto* expandIndices = bufferCast<TokenIdType>(*buffers.currentExpandIndices);
+        auto* allScores = bufferCast<float>(*buffers.inputAllLayersScores);
+        auto* allIds = bufferCast<TokenIdType>(*buffers.inputAllLayersDraftTokenIds);
+        auto* allPredecessors = bufferCast<TokenIdType>(*buffers.inputAllLayersDraftTokenIdsPredecessor);
+        auto* paths = bufferCast<SizeType32>(*buffers.inputPaths);
+        auto* draftIds = bufferCast<TokenIdType>(*buffers.inputDraftTokenIds);
+        auto* draftLens = bufferCast<SizeType32>(*buffers.inputDraftLens);
+        std::fill_n(paths, buffers.inputPaths->getSize(), -1);
+
+        auto const allLayersStride = kNumEagleLayers * kMaxDecodingDraftTokens * kMaxDecodingDraftTokens;
+        for (SizeType32 bi = 0; bi < batchSize; ++bi)
+        {
+            for (SizeType32 ki = 0; ki < kDynamicTreeMaxTopK; ++ki)
+            {
+                auto const score = scoreDist(mRng);
+                auto const token = tokenDist(mRng);
+                prevScores[bi * kMaxDecodingDraftTokens + ki] = score;
+                expandIndices[bi * kMaxDecodingDraftTokens + ki] = ki + 1;
+                allScores[bi * allLayersStride + ki] = score;
+                allIds[bi * allLayersStride + ki] = token;
+                allPredecessors[bi * allLayersStride + ki] = 0;
+                draftIds[bi * kMaxDecodingDraftTokens + ki] = token;
+                auto* path = paths + (bi * kMaxDecodingTokens + ki) * kMaxPathLen;
+                path[0] = 0;
+                path[1] = ki + 1;
+                path[2] = kMaxDecodingTokens + 1;
+            }
+            draftLens[bi] = kDynamicTreeMaxTopK;
+        }
+    }
+
+    // The result of the first topK sampling of a layer: dynamicTreeMaxTopK tokens of every expanded node.
+    void initFirstTopK(LayerBuffers const& buffers, SizeType32 batchSize)
+    {
+        std::uniform_real_distribution<float> logProbDist(-6.f, 0.f);
+        std::uniform_int_distribution<TokenIdType> tokenDist(0, kVocabSize - 1);
+        auto* logProbs = bufferCast<float>(*buffers.firstTopKOutputLogProbs);
+        auto* ids = bufferCast<TokenIdType>(*buffers.firstTopKOutputIds);
+        for (SizeType32 ri = 0; ri < batchSize * kDynamicTreeMaxTopK; ++ri)
+        {
+            std::vector<float> rowLogProbs(kDynamicTreeMaxTopK);
+            std::generate(rowLogProbs.begin(), rowLogProbs.end(), [&]() { return logProbDist(mRng); });
+            std::sort(rowLogProbs.begin(), rowLogProbs.end(), std::greater<float>());
+            for (SizeType32 ci = 0; ci < kMaxDecodingDraftTokens; ++ci)
+            {
+                logProbs[ri * kMaxDecodingDraftTokens + ci] = ci < kDynamicTreeMaxTopK ? rowLogProbs[ci] : 0.f;
+                ids[ri * kMaxDecodingDraftTokens + ci] = tokenDist(mRng);
+            }
+        }
+    }
+
+    // The outputs of a layer are the inputs of the next one.
+    static void advanceLayer(LayerBuffers const& buffers)
+    {
+        copyTensor<float>(buffers.outputCurrentScores, buffers.prevScores);
+        copyTensor<TokenIdType>(buffers.outputNextExpandIndices, buffers.currentExpandIndices);
+        copyTensor<float>(buffers.outputAllLayersScores, buffers.inputAllLayersScores);
+        copyTensor<TokenIdType>(buffers.outputAllLayersDraftTokenIds, buffers.inputAllLayersDraftTokenIds);
+        copyTensor<TokenIdType>(
+            buffers.outputAllLayersDraftTokenIdsPredecessor, buffers.inputAllLayersDraftTokenIdsPredecessor);
+        copyTensor<SizeType32>(buffers.outputPaths, buffers.inputPaths);
+        copyTensor<TokenIdType>(buffers.outputDraftTokenIds, buffers.inputDraftTokenIds);
+        copyTensor<SizeType32>(buffers.outputDraftLens, buffers.inputDraftLens);
+    }
+
+    // Inputs of `dst` are set to the ones of `src`.
+    static void copyInputs(LayerBuffers const& src, LayerBuffers const& dst)
+    {
+        copyTensor<float>(src.prevScores, dst.prevScores);
+        copyTensor<TokenIdType>(src.currentExpandIndices, dst.currentExpandIndices);
+        copyTensor<float>(src.inputAllLayersScores, dst.inputAllLayersScores);
+        copyTensor<TokenIdType>(src.inputAllLayersDraftTokenIds, dst.inputAllLayersDraftTokenIds);
+        copyTensor<TokenIdType>(src.inputAllLayersDraftTokenIdsPredecessor, dst.inputAllLayersDraftTokenIdsPredecessor);
+        copyTensor<SizeType32>(src.inputPaths, dst.inputPaths);
+        copyTensor<TokenIdType>(src.inputDraftTokenIds, dst.inputDraftTokenIds);
+        copyTensor<SizeType32>(src.inputDraftLens, dst.inputDraftLens);
+        copyTensor<float>(src.firstTopKOutputLogProbs, dst.firstTopKOutputLogProbs);
+        copyTensor<TokenIdType>(src.firstTopKOutputIds, dst.firstTopKOutputIds);
+    }
+
+    // The kernels launched by EagleDecodeDraftTokensPlugin for a layer after the first one before the fusion.
+    void runChain(LayerBuffers const& buffers, SizeType32 layerIdx, SizeType32 batchSize) const
+    {
+        auto const stream = mStream->get();
+        auto* firstTopKOutputLogProbs = bufferCast<float>(*buffers.firstTopKOutputLogProbs);
+        auto* secondTopKInputScoresPtrs
+            = reinterpret_cast<float**>(bufferCast<int64_t>(*buffers.secondTopKInputScoresPtrs));
+        auto* secondTopKOutputIdsPtrs
+            = reinterpret_cast<TokenIdType**>(bufferCast<int64_t>(*buffers.secondTopKOutputIdsPtrs));
+
+        tksd::invokeUpdateScores(batchSize, kDynamicTreeMaxTopK, kMaxDecodingDraftTokens, firstTopKOutputLogProbs,
+            bufferCast<float>(*buffers.prevScores), stream);
+        tksd::invokeAssembleSecondTopKSamplingInputs(batchSize, kDynamicTreeMaxTopK, kMaxDecodingDraftTokens,
+            firstTopKOutputLogProbs, secondTopKInputScoresPtrs, bufferCast<TokenIdType>(*buffers.secondTopKOutputIds),
+            secondTopKOutputIdsPtrs, stream);
+
+        tk::TopKSamplingKernelParams<float> params{};
+        params.logProbsPtrs = secondTopKInputScoresPtrs;
+        params.outputIdsPtrs = secondTopKOutputIdsPtrs;
+        params.workspace = buffers.samplingWorkspace->data();
+        params.maxTopK = kDynamicTreeMaxTopK;
+        params.topKs = bufferCast<SizeType32>(*buffers.topKs);
+        params.batchSize = batchSize;
+        params.maxBatchSize = batchSize;
+        params.maxTokensPerStep = 1;
+        params.vocabSizePadded = kDynamicTreeMaxTopK * kMaxDecodingDraftTokens;
+        params.returnAllSelectedTokens = true;
+        params.strictTopPBoundary = false;
+        tk::invokeBatchTopKSampling(params, stream);
+
+        tksd::invokeCopyScoresAndDraftTokenIds(layerIdx, kNumEagleLayers, kMaxDecodingDraftTokens, batchSize,
+            kDynamicTreeMaxTopK, nullptr, bufferCast<TokenIdType>(*buffers.currentExpandIndices),
+            bufferCast<float>(*buffers.inputAllLayersScores),
+            bufferCast<TokenIdType>(*buffers.inputAllLayersDraftTokenIds),
+            bufferCast<TokenIdType>(*buffers.inputAllLayersDraftTokenIdsPredecessor),
+            bufferCast<float>(*buffers.outputAllLayersScores),
+            bufferCast<TokenIdType>(*buffers.outputAllLayersDraftTokenIds),
+            bufferCast<TokenIdType>(*buffers.outputAllLayersDraftTokenIdsPredecessor), firstTopKOutputLogProbs,
+            bufferCast<TokenIdType>(*buffers.firstTopKOutputIds), stream);
+        if (layerIdx != kNumEagleLayers - 1)
+        {
+            tksd::invokeUpdatePath(layerIdx, batchSize, kDynamicTreeMaxTopK, kMaxDecodingTokens, kMaxPathLen,
+                bufferCast<SizeType32>(*buffers.inputPaths), bufferCast<SizeType32>(*buffers.outputPaths),
+                secondTopKOutputIdsPtrs, bufferCast<TokenIdType>(*buffers.outputNextExpandIndices), stream);
+        }
+        tksd::invokeExtractScoresAndRealDraftTokensIds(batchSize, kDynamicTreeMaxTopK, kMaxDecodingDraftTokens,
+            secondTopKInputScoresPtrs, secondTopKOutputIdsPtrs, bufferCast<TokenIdType>(*buffers.firstTopKOutputIds),
+            bufferCast<float>(*buffers.secondTopKOutputLogProbs), stream);
+        tksd::invokeUpdateDraftTokensAndLensAndCurScores(layerIdx, batchSize, kDynamicTreeMaxTopK,
+            kMaxDecodingDraftTokens, secondTopKOutputIdsPtrs, bufferCast<TokenIdType>(*buffers.inputDraftTokenIds),
+            bufferCast<SizeType32>(*buffers.inputDraftLens), bufferCast<TokenIdType>(*buffers.outputDraftTokenIds),
+            bufferCast<SizeType32>(*buffers.outputDraftLens), bufferCast<float>(*buffers.secondTopKOutputLogProbs),
+            bufferCast<float>(*buffers.outputCurrentScores), stream);
+    }
+
+    void runFused(LayerBuffers const& buffers, SizeType32 layerIdx, SizeType32 batchSize) const
+    {
+        tksd::DynamicTreeLayerUpdateParams params;
+        params.layerIdx = layerIdx;
+        params.numEagleLayers = kNumEagleLayers;
+        params.batchSize = batchSize;
+        params.dynamicTreeMaxTopK = kDynamicTreeMaxTopK;
+        params.maxDecodingTokens = kMaxDecodingTokens;
+        params.maxPathLen = kMaxPathLen;
+        params.inputPrevScores = bufferCast<float>(*buffers.prevScores);
+        params.inputCurrentExpandIndices = bufferCast<TokenIdType>(*buffers.currentExpandIndices);
+        params.inputAllLayersScores = bufferCast<float>(*buffers.inputAllLayersScores);
+        params.inputAllLayersDraftTokenIds = bufferCast<TokenIdType>(*buffers.inputAllLayersDraftTokenIds);
+        params.inputAllLayersDraftTokenIdsPredecessor
+            = bufferCast<TokenIdType>(*buffers.inputAllLayersDraftTokenIdsPredecessor);
+        params.inputPaths = bufferCast<SizeType32>(*buffers.inputPaths);
+        params.inputDraftTokenIds = bufferCast<TokenIdType>(*buffers.inputDraftTokenIds);
+        params.inputDraftLens = bufferCast<SizeType32>(*buffers.inputDraftLens);
+        params.firstTopKOutputLogProbs = bufferCast<float>(*buffers.firstTopKOutputLogProbs);
+        params.firstTopKOutputIds = bufferCast<TokenIdType>(*buffers.firstTopKOutputIds);
+        params.secondTopKOutputIds = bufferCast<TokenIdType>(*buffers.secondTopKOutputIds);
+        params.secondTopKOutputLogProbs = bufferCast<float>(*buffers.secondTopKOutputLogProbs);
+        params.outputAllLayersScores = bufferCast<float>(*buffers.outputAllLayersScores);
+        params.outputAllLayersDraftTokenIds = bufferCast<TokenIdType>(*buffers.outputAllLayersDraftTokenIds);
+        params.outputAllLayersDraftTokenIdsPredecessor
+            = bufferCast<TokenIdType>(*buffers.outputAllLayersDraftTokenIdsPredecessor);
+        params.outputPaths = bufferCast<SizeType32>(*buffers.outputPaths);
+        params.outputNextExpandIndices = bufferCast<TokenIdType>(*buffers.outputNextExpandIndices);
+        params.outputDraftTokenIds = bufferCast<TokenIdType>(*buffers.outputDraftTokenIds);
+        params.outputDraftLens = bufferCast<SizeType32>(*buffers.outputDraftLens);
+        params.outputCurrentScores = bufferCast<float>(*buffers.outputCurrentScores);
+        params.checkParams();
+
+        tksd::invokeDynamicTreeLayerUpdate(params, mStream->get());
+    }
+
+    template <typename T>
+    static void expectEqual(TensorPtr const& expected, TensorPtr const& actual, SizeType32 batchSize,
+        SizeType32 rowSize, SizeType32 numCompared, char const* name)
+    {
+        auto const* expectedPtr = bufferCast<T>(*expected);
+        auto const* actualPtr = bufferCast<T>(*actual);
+        for (SizeType32 bi = 0; bi < batchSize; ++bi)
+        {
+            for (SizeType32 ii = 0; ii < numCompared; ++ii)
+            {
+                auto const idx = bi * rowSize + ii;
+                EXPECT_EQ(expectedPtr[idx], actualPtr[idx]) << name << " bi " << bi << " ii " << ii;
+            }
+        }
+    }
+
+    void compareOutputs(
+        LayerBuffers const& expected, LayerBuffers const& actual, SizeType32 layerIdx, SizeType32 batchSize) const
+    {
+        auto const allLayersStride = kNumEagleLayers * kMaxDecodingDraftTokens * kMaxDecodingDraftTokens;
+        auto const numAllLayersTokens = layerIdx * kDynamicTreeMaxTopK * kDynamicTreeMaxTopK + kDynamicTreeMaxTopK;
+        expectEqual<float>(expected.outputAllLayersScores, actual.outputAllLayersScores, batchSize, allLayersStride,
+            numAllLayersTokens, "allLayersScores");
+        expectEqual<TokenIdType>(expected.outputAllLayersDraftTokenIds, actual.outputAllLayersDraftTokenIds, batchSize,
+            allLayersStride, numAllLayersTokens, "allLayersDraftTokenIds");
+        expectEqual<TokenIdType>(expected.outputAllLayersDraftTokenIdsPredecessor,
+            actual.outputAllLayersDraftTokenIdsPredecessor, batchSize, allLayersStride, numAllLayersTokens,
+            "allLayersDraftTokenIdsPredecessor");
+        expectEqual<SizeType32>(expected.outputPaths, actual.outputPaths, batchSize, kMaxDecodingTokens * kMaxPathLen,
+            kMaxDecodingTokens * kMaxPathLen, "paths");
+        expectEqual<TokenIdType>(expected.outputNextExpandIndices, actual.outputNextExpandIndices, batchSize,
+            kMaxDecodingDraftTokens, kDynamicTreeMaxTopK, "nextExpandIndices");
+        expectEqual<TokenIdType>(expected.outputDraftTokenIds, actual.outputDraftTokenIds, batchSize,
+            kMaxDecodingDraftTokens, (layerIdx + 1) * kDynamicTreeMaxTopK, "draftTokenIds");
+        expectEqual<SizeType32>(expected.outputDraftLens, actual.outputDraftLens, batchSize, 1, 1, "draftLens");
+        // Only the first dynamicTreeMaxTopK scores of a request are set, the other ones come from the workspace.
+        expectEqual<float>(expected.outputCurrentScores, actual.outputCurrentScores, batchSize,
+            kMaxDecodingDraftTokens, kDynamicTreeMaxTopK, "currentScores");
+    }
+
+    template <typename Func>
+    float measure(Func&& func, SizeType32 numIterations) const
+    {
+        for (SizeType32 it = 0; it < 10; ++it)
+        {
+            func();
+        }
+        CudaEvent start;
+        CudaEvent stop;
+        mStream->record(start);
+        for (SizeType32 it = 0; it < numIterations; ++it)
+        {
+            func();
+        }
+        mStream->record(stop);
+        stop.synchronize();
+        float elapsedMs{0.f};
+        TLLM_CUDA_CHECK(cudaEventElapsedTime(&elapsedMs, start.get(), stop.get()));
+        return elapsedMs * 1000.f / static_cast<float>(numIterations);
+    }
+
+protected:
+    std::shared_ptr<CudaStream> mStream;
+    std::shared_ptr<BufferManager> mBufferManager;
+    std::mt19937 mRng{42};
+};
+
+TEST_F(EagleDynamicTreeLayerUpdateTest, MatchesChain)
+{
+    for (SizeType32 const batchSize : {1, 7, 64})
+    {
+        auto const chain = allocate(batchSize);
+        auto const fused = allocate(batchSize);
+        initFirstLayerOutputs(chain, batchSize);
+        for (SizeType32 layerIdx = 1; layerIdx < kNumEagleLayers; ++layerIdx)
+        {
+            initFirstTopK(chain, batchSize);
+            copyInputs(chain, fused);
+            clearOutputs(chain);
+            clearOutputs(fused);
+
+            runChain(chain, layerIdx, batchSize);
+            runFused(fused, layerIdx, batchSize);
+            mStream->synchronize();
+
+            compareOutputs(chain, fused, layerIdx, batchSize);
+            // The scores updated in place are the input of the second topK, thus the same.
+            expectEqual<float>(chain.firstTopKOutputLogProbs, fused.firstTopKOutputLogProbs, batchSize,
+                kDynamicTreeMaxTopK * kMaxDecodingDraftTokens, kDynamicTreeMaxTopK * kMaxDecodingDraftTokens,
+                "firstTopKOutputLogProbs");
+            advanceLayer(chain);
+        }
+    }
+}
+
+TEST_F(EagleDynamicTreeLayerUpdateTest, Benchmark)
+{
+    SizeType32 constexpr kLayerIdx = 1;
+    SizeType32 constexpr kNumIterations = 100;
+    for (SizeType32 const batchSize : {1, 4, 16, 64})
+    {
+        auto const chain = allocate(batchSize);
+        auto const fused = allocate(batchSize);
+        initFirstLayerOutputs(chain, batchSize);
+        initFirstTopK(chain, batchSize);
+        copyInputs(chain, fused);
+
+        // The scores are updated in place at every iteration, the selected draft tokens stay valid.
+        auto const chainUs = measure([&]() { runChain(chain, kLayerIdx, batchSize); }, kNumIterations);
+        auto const fusedUs = measure([&]() { runFused(fused, kLayerIdx, batchSize); }, kNumIterations);
+        TLLM_LOG_INFO("Eagle dynamic tree layer update, batch size %d: chain %.2f us, fused %.2f us", batchSize,
+            chainUs, fusedUs);
+    }
+}
+
+} // namespace
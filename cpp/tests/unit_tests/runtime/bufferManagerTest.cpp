@@ -281,3 +281,39 @@ TEST_F(BufferManagerTest, TrimPoolOnDestruction)
     EXPECT_LE(memoryPoolReserved(), reserved);
     EXPECT_LE(memoryPoolFree(), free);
 }
+
+TEST_F(BufferManagerTest, ScratchArena)
+{
+    auto constexpr kSize = 1000;
+    EXPECT_EQ(mBufferManager->scratchCapacity(), 0);
+    // The first step does not fit and sizes the arena for the next ones.
+    {
+        auto const buffer = mBufferManager->scratch(kSize, nvinfer1::DataType::kFLOAT);
+        EXPECT_EQ(buffer->getSize(), kSize);
+        EXPECT_EQ(mBufferManager->scratchUsed(), 0);
+    }
+    mBufferManager->resetScratch();
+    EXPECT_GE(mBufferManager->scratchCapacity(), kSize * sizeof(float));
+
+    std::vector<void*> addresses;
+    for (int step = 0; step < 2; ++step)
+    {
+        auto const buffer = mBufferManager->scratch(kSize, nvinfer1::DataType::kFLOAT);
+        EXPECT_EQ(buffer->getMemoryType(), MemoryType::kGPU);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer->data()) % 256, 0);
+        EXPECT_GT(mBufferManager->scratchUsed(), 0);
+        mBufferManager->setZero(*buffer);
+        addresses.push_back(buffer->data());
+        mBufferManager->resetScratch();
+        EXPECT_EQ(mBufferManager->scratchUsed(), 0);
+    }
+    // The steps with the same allocations get the same addresses.
+    EXPECT_EQ(addresses[0], addresses[1]);
+
+    mBufferManager->reserveScratch(4 * kSize * sizeof(float));
+    auto const tensor = mBufferManager->scratch(ITensor::makeShape({2, kSize}), nvinfer1::DataType::kINT32);
+    auto const buffer = mBufferManager->scratch(kSize, nvinfer1::DataType::kHALF);
+    EXPECT_EQ(tensor->getSize(), 2 * kSize);
+    EXPECT_GE(static_cast<std::uint8_t*>(buffer->data()) - static_cast<std::uint8_t*>(tensor->data()),
+        tensor->getSizeInBytes());
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/decoderOutputStaging.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+namespace tc = tensorrt_llm::common;
+
+namespace
+{
+
+TEST(DecoderOutputStagingTest, drainsStepsInOrder)
+{
+    if (tc::getDeviceCount() == 0)
+    {
+        GTEST_SKIP() << "This test cannot run on systems with no devices.";
+    }
+
+    SizeType32 constexpr kMaxNumSequences = 8;
+    SizeType32 constexpr kNumSteps = 16;
+    auto stream = std::make_shared<CudaStream>();
+    BufferManager manager{stream};
+
+    DecoderOutputStaging::DeviceOutputs deviceOutputs;
+    auto const stepShape = ITensor::makeShape({1, kMaxNumSequences, 1});
+    deviceOutputs.newOutputTokens = manager.gpu(stepShape, nvinfer1::DataType::kINT32);
+    deviceOutputs.sequenceLengths = manager.gpu(ITensor::makeShape({kMaxNumSequences, 1}), nvinfer1::DataType::kINT32);
+    deviceOutputs.finishReasons = manager.gpu(stepShape, nvinfer1::DataType::kUINT8);
+    DecoderOutputStaging staging{deviceOutputs};
+
+    std::vector<DecoderOutputStaging::StepIdType> drainedSteps;
+    std::thread responseThread(
+        [&]()
+        {
+            for (SizeType32 step = 0; step < kNumSteps; ++step)
+            {
+                staging.drain(
+                    [&](DecoderOutputStaging::HostOutputs const& outputs)
+                    {
+                        drainedSteps.push_back(outputs.stepId);
+                        auto const* tokens = bufferCast<SizeType32>(*outputs.newOutputTokens);
+                        auto const* lengths = bufferCast<SizeType32>(*outputs.sequenceLengths);
+                        for (SizeType32 seq = 0; seq < kMaxNumSequences; ++seq)
+                        {
+                            EXPECT_EQ(tokens[seq], static_cast<SizeType32>(outputs.stepId) * 100 + seq);
+                            EXPECT_EQ(lengths[seq], static_cast<SizeType32>(outputs.stepId) + 1);
+                        }
+                    });
+            }
+        });
+
+    // The host writes stand for the decoder steps, which overwrite the device outputs every step.
+    std::vector<SizeType32> tokens(kMaxNumSequences);
+    std::vector<SizeType32> lengths(kMaxNumSequences);
+    for (SizeType32 step = 0; step < kNumSteps; ++step)
+    {
+        std::iota(tokens.begin(), tokens.end(), step * 100);
+        std::fill(lengths.begin(), lengths.end(), step + 1);
+        manager.copy(tokens.data(), *deviceOutputs.newOutputTokens);
+        manager.copy(lengths.data(), *deviceOutputs.sequenceLengths);
+        EXPECT_EQ(staging.stage(*stream), static_cast<DecoderOutputStaging::StepIdType>(step));
+        EXPECT_LE(staging.getNumStaged(), DecoderOutputStaging::kNumBuffers);
+    }
+    responseThread.join();
+
+    ASSERT_EQ(drainedSteps.size(), kNumSteps);
+    for (SizeType32 step = 0; step < kNumSteps; ++step)
+    {
+        EXPECT_EQ(drainedSteps[step], static_cast<DecoderOutputStaging::StepIdType>(step));
+    }
+    EXPECT_EQ(staging.getNumStaged(), 0);
+    EXPECT_FALSE(staging.tryDrain([](DecoderOutputStaging::HostOutputs const&) {}));
+}
+
+} // namespace
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/hostSampler.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+namespace hs = tensorrt_llm::runtime::host_sampler;
+using tensorrt_llm::executor::FinishReason;
+
+namespace
+{
+
+// The scalar path, and the AVX-512 one where the CPU has it.
+std::vector<bool> getVariants()
+{
+    std::vector<bool> variants{false};
+    if (HostSampler::hasAvx512())
+    {
+        variants.push_back(true);
+    }
+    return variants;
+}
+
+// Values with many ties, to check the order of the candidates of equal value.
+std::vector<float> makeRow(SizeType32 n, std::uint32_t seed)
+{
+    std::mt19937 generator{seed};
+    std::uniform_int_distribution<int> distribution{-8, 8};
+    std::vector<float> row(n);
+    std::generate(row.begin(), row.end(), [&]() { return static_cast<float>(distribution(generator)); });
+    return row;
+}
+
+std::vector<hs::Candidate> referenceTopK(std::vector<float> const& row, SizeType32 k)
+{
+    std::vector<hs::Candidate> candidates;
+    for (SizeType32 i = 0; i < static_cast<SizeType32>(row.size()); ++i)
+    {
+        candidates.emplace_back(row[i], i);
+    }
+    std::stable_sort(candidates.begin(), candidates.end(),
+        [](hs::Candidate const& lhs, hs::Candidate const& rhs) { return lhs.first > rhs.first; });
+    candidates.resize(std::min<std::size_t>(k, candidates.size()));
+    return candidates;
+}
+
+std::uint32_t toBits(float value)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+} // namespace
+
+TEST(HostSamplerTest, argmaxTiesGoToLowestId)
+{
+    for (auto const avx512 : getVariants())
+    {
+        // Ties within a vector block, across blocks, in the scalar tail, and rows shorter than a block.
+        for (auto const& [n, first, second] : std::vector<std::array<SizeType32, 3>>{
+                 {100, 3, 7}, {100, 5, 40}, {100, 97, 99}, {100, 0, 99}, {7, 2, 6}, {16, 15, 15}})
+        {
+            std::vector<float> row(n, -1.F);
+            row[first] = 2.F;
+            row[second] = 2.F;
+            EXPECT_EQ(hs::argmax(row.data(), n, avx512), first) << "n " << n << " avx512 " << avx512;
+        }
+        std::vector<float> const row(33, std::numeric_limits<float>::lowest());
+        EXPECT_EQ(hs::argmax(row.data(), 33, avx512), 0);
+    }
+}
+
+TEST(HostSamplerTest, topKMatchesReference)
+{
+    SizeType32 constexpr kVocabSize = 1000;
+    for (auto const avx512 : getVariants())
+    {
+        for (SizeType32 const k : {1, 2, 16, 50, kVocabSize, kVocabSize + 7})
+        {
+            auto const row = makeRow(kVocabSize, k);
+            std::vector<hs::Candidate> candidates;
+            hs::topK(row.data(), kVocabSize, k, candidates, avx512);
+            EXPECT_EQ(candidates, referenceTopK(row, k)) << "k " << k << " avx512 " << avx512;
+        }
+        // k 1 picks the token of the argmax.
+        auto const row = makeRow(kVocabSize, 42);
+        std::vector<hs::Candidate> candidates;
+        hs::topK(row.data(), kVocabSize, 1, candidates, avx512);
+        ASSERT_EQ(candidates.size(), 1);
+        EXPECT_EQ(candidates.front().second, hs::argmax(row.data(), kVocabSize, avx512));
+    }
+}
+
+TEST(HostSamplerTest, halfToFloat)
+{
+    EXPECT_EQ(hs::halfToFloat(0x3C00), 1.F);
+    EXPECT_EQ(hs::halfToFloat(0xC000), -2.F);
+    EXPECT_EQ(hs::halfToFloat(0x7BFF), 65504.F);
+    // Subnormals, the smallest and the largest.
+    EXPECT_EQ(hs::halfToFloat(0x0001), std::ldexp(1.F, -24));
+    EXPECT_EQ(hs::halfToFloat(0x83FF), -std::ldexp(1023.F, -24));
+    EXPECT_EQ(hs::halfToFloat(0x0400), std::ldexp(1.F, -14));
+    EXPECT_EQ(hs::halfToFloat(0x7C00), std::numeric_limits<float>::infinity());
+    EXPECT_EQ(hs::halfToFloat(0xFC00), -std::numeric_limits<float>::infinity());
+    EXPECT_TRUE(std::isnan(hs::halfToFloat(0x7E00)));
+    auto const negativeZero = hs::halfToFloat(0x8000);
+    EXPECT_EQ(negativeZero, 0.F);
+    EXPECT_TRUE(std::signbit(negativeZero));
+}
+
+TEST(HostSamplerTest, convertRowMatchesScalar)
+{
+    if (!HostSampler::hasAvx512())
+    {
+        GTEST_SKIP() << "This test needs a CPU with AVX-512.";
+    }
+    // Every FP16 value, in a row whose length is not a multiple of the vector width.
+    SizeType32 constexpr kNumValues = 1 << 16;
+    std::vector<std::uint16_t> src(kNumValues + 5);
+    std::iota(src.begin(), src.begin() + kNumValues, 0);
+    std::vector<float> scalar(src.size());
+    std::vector<float> vectorized(src.size());
+    hs::convertRow(src.data(), scalar.data(), static_cast<SizeType32>(src.size()), false);
+    hs::convertRow(src.data(), vectorized.data(), static_cast<SizeType32>(src.size()), true);
+    for (std::size_t i = 0; i < src.size(); ++i)
+    {
+        if (std::isnan(scalar[i]))
+        {
+            EXPECT_TRUE(std::isnan(vectorized[i])) << "half " << src[i];
+        }
+        else
+        {
+            EXPECT_EQ(toBits(scalar[i]), toBits(vectorized[i])) << "half " << src[i];
+        }
+    }
+}
+
+TEST(HostSamplerTest, finishStep)
+{
+    TokenIdType constexpr kEndId = 2;
+    SizeType32 sequenceLength = 8;
+    EXPECT_EQ(hs::finishStep(5, kEndId, sequenceLength, 10), FinishReason::kNOT_FINISHED);
+    EXPECT_EQ(sequenceLength, 9);
+    // The end id is not counted in the length, as in the decoder.
+    EXPECT_EQ(hs::finishStep(kEndId, kEndId, sequenceLength, 10), FinishReason::kEND_ID);
+    EXPECT_EQ(sequenceLength, 9);
+    EXPECT_EQ(hs::finishStep(5, kEndId, sequenceLength, 10), FinishReason::kLENGTH);
+    EXPECT_EQ(sequenceLength, 10);
+    // The end id takes precedence over the length.
+    SizeType32 lastLength = 9;
+    EXPECT_EQ(hs::finishStep(kEndId, kEndId, lastLength, 10), FinishReason::kEND_ID);
+    EXPECT_EQ(lastLength, 9);
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/logitsReturnStreamer.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+namespace tc = tensorrt_llm::common;
+
+namespace
+{
+
+SizeType32 constexpr kNumTokens = 7;
+SizeType32 constexpr kVocabSize = 50;
+SizeType32 constexpr kVocabSizePadded = 64;
+
+class LogitsReturnStreamerTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        if (tc::getDeviceCount() == 0)
+        {
+            GTEST_SKIP() << "This test cannot run on systems with no devices.";
+        }
+        mStream = std::make_shared<CudaStream>();
+        mManager = std::make_unique<BufferManager>(mStream);
+
+        mHostLogits.resize(kNumTokens * kVocabSizePadded);
+        for (SizeType32 ti = 0; ti < kNumTokens; ++ti)
+        {
+            for (SizeType32 vi = 0; vi < kVocabSizePadded; ++vi)
+            {
+                // Distinct values per row, with the largest ones in the padding to check that it is ignored.
+                mHostLogits[ti * kVocabSizePadded + vi] = vi < kVocabSize
+                    ? static_cast<float>((vi * 7 + ti * 3) % kVocabSize) * 0.125f
+                    : 100.f;
+            }
+        }
+        mLogits = mManager->copyFrom(
+            mHostLogits.data(), ITensor::makeShape({kNumTokens, kVocabSizePadded}), MemoryType::kGPU);
+    }
+
+    float hostLogit(SizeType32 token, SizeType32 vocabIdx) const
+    {
+        return mHostLogits[token * kVocabSizePadded + vocabIdx];
+    }
+
+    std::shared_ptr<CudaStream> mStream;
+    std::unique_ptr<BufferManager> mManager;
+    std::vector<float> mHostLogits;
+    ITensor::SharedPtr mLogits;
+};
+
+TEST_F(LogitsReturnStreamerTest, streamsFullLogitsInChunks)
+{
+    LogitsReturnStreamer::Config config;
+    config.maxChunkTokens = 3;
+    LogitsReturnStreamer streamer{config, kVocabSize, nvinfer1::DataType::kFLOAT, *mManager};
+
+    std::vector<SizeType32> firstTokens;
+    streamer.stream(*mLogits,
+        [&](LogitsReturnStreamer::Chunk const& chunk)
+        {
+            firstTokens.push_back(chunk.firstToken);
+            ASSERT_EQ(chunk.logits->getDataType(), nvinfer1::DataType::kFLOAT);
+            auto const* logits = bufferCast<float>(*chunk.logits);
+            for (SizeType32 ti = 0; ti < chunk.numTokens; ++ti)
+            {
+                for (SizeType32 vi = 0; vi < kVocabSize; ++vi)
+                {
+                    EXPECT_EQ(logits[ti * kVocabSize + vi], hostLogit(chunk.firstToken + ti, vi));
+                }
+            }
+        });
+    EXPECT_EQ(firstTokens, (std::vector<SizeType32>{0, 3, 6}));
+}
+
+TEST_F(LogitsReturnStreamerTest, streamsHalfLogits)
+{
+    LogitsReturnStreamer::Config config;
+    config.mode = LogitsReturnStreamer::Mode::kHalf;
+    config.maxChunkTokens = 4;
+    LogitsReturnStreamer streamer{config, kVocabSize, nvinfer1::DataType::kFLOAT, *mManager};
+    EXPECT_EQ(streamer.getBytesPerToken(), kVocabSize * sizeof(half));
+
+    SizeType32 numTokens = 0;
+    streamer.stream(*mLogits,
+        [&](LogitsReturnStreamer::Chunk const& chunk)
+        {
+            ASSERT_EQ(chunk.logits->getDataType(), nvinfer1::DataType::kHALF);
+            auto const* logits = bufferCast<half>(*chunk.logits);
+            for (SizeType32 ti = 0; ti < chunk.numTokens; ++ti)
+            {
+                for (SizeType32 vi = 0; vi < kVocabSize; ++vi)
+                {
+                    // The logits are multiples of 1/8 below 8, exact in FP16.
+                    EXPECT_EQ(static_cast<float>(logits[ti * kVocabSize + vi]), hostLogit(chunk.firstToken + ti, vi));
+                }
+            }
+            numTokens += chunk.numTokens;
+        });
+    EXPECT_EQ(numTokens, kNumTokens);
+}
+
+TEST_F(LogitsReturnStreamerTest, returnsTopKLogProbs)
+{
+    SizeType32 constexpr kTopK = 4;
+    LogitsReturnStreamer::Config config;
+    config.mode = LogitsReturnStreamer::Mode::kTopK;
+    config.topK = kTopK;
+    config.maxChunkTokens = 2;
+    LogitsReturnStreamer streamer{config, kVocabSize, nvinfer1::DataType::kFLOAT, *mManager};
+
+    streamer.stream(*mLogits,
+        [&](LogitsReturnStreamer::Chunk const& chunk)
+        {
+            EXPECT_EQ(chunk.logits, nullptr);
+            auto const* ids = bufferCast<SizeType32>(*chunk.topKIds);
+            auto const* logProbs = bufferCast<float>(*chunk.topKLogProbs);
+            for (SizeType32 ti = 0; ti < chunk.numTokens; ++ti)
+            {
+                auto const token = chunk.firstToken + ti;
+                std::vector<SizeType32> expectedIds(kVocabSize);
+                std::iota(expectedIds.begin(), expectedIds.end(), 0);
+                std::sort(expectedIds.begin(), expectedIds.end(),
+                    [&](auto a, auto b) { return hostLogit(token, a) > hostLogit(token, b); });
+                auto const maxLogit = hostLogit(token, expectedIds.front());
+                double sumExp = 0;
+                for (SizeType32 vi = 0; vi < kVocabSize; ++vi)
+                {
+                    sumExp += std::exp(hostLogit(token, vi) - maxLogit);
+                }
+                auto const lse = maxLogit + std::log(sumExp);
+
+                std::vector<SizeType32> topKIds(ids + ti * kTopK, ids + (ti + 1) * kTopK);
+                std::sort(topKIds.begin(), topKIds.end(),
+                    [&](auto a, auto b) { return hostLogit(token, a) > hostLogit(token, b); });
+                for (SizeType32 ki = 0; ki < kTopK; ++ki)
+                {
+                    EXPECT_EQ(topKIds[ki], expectedIds[ki]);
+                    auto const id = ids[ti * kTopK + ki];
+                    EXPECT_NEAR(logProbs[ti * kTopK + ki], hostLogit(token, id) - lse, 1e-4);
+                }
+            }
+        });
+}
+
+} // namespace
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/runtime/loraAdapterMerger.h"
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+LoraAdapterMerger makeMerger(float smoothing)
+{
+    LoraAdapterMerger::Config config;
+    config.smoothing = smoothing;
+    config.maxMergedAdapters = 1;
+    return LoraAdapterMerger{config, [](SizeType32, SizeType32) { return ITensor::SharedPtr{}; }};
+}
+} // namespace
+
+TEST(LoraAdapterMergerTest, dominantAdaptersAreMerged)
+{
+    auto merger = makeMerger(0.5F);
+    merger.recordIteration({{1, 80}, {2, 10}, {3, 10}});
+    EXPECT_FLOAT_EQ(merger.getShare(1), 0.4F);
+    auto decision = merger.decide();
+    ASSERT_EQ(decision.toMerge.size(), 1);
+    EXPECT_EQ(decision.toMerge[0], 1);
+    EXPECT_TRUE(decision.toRelease.empty());
+
+    // Iterations without LoRA tokens do not decay the shares.
+    merger.recordIteration({});
+    EXPECT_FLOAT_EQ(merger.getShare(1), 0.4F);
+
+    merger.recordIteration({{2, 100}});
+    EXPECT_FLOAT_EQ(merger.getShare(1), 0.2F);
+    EXPECT_FLOAT_EQ(merger.getShare(2), 0.525F);
+    decision = merger.decide();
+    ASSERT_EQ(decision.toMerge.size(), 1);
+    EXPECT_EQ(decision.toMerge[0], 2);
+}
+
+TEST(LoraAdapterMergerTest, tasksWithoutMergeableWeightsAreNotMerged)
+{
+    auto merger = makeMerger(1.F);
+    LoraCache::TaskLayerModuleConfig config{};
+    config.inSize = 8;
+    config.outSize = 8;
+    config.adapterSize = 2;
+    BufferManager manager{std::make_shared<CudaStream>()};
+    EXPECT_FALSE(merger.merge(1, {config}, manager));
+    EXPECT_FALSE(merger.isMerged(1));
+    EXPECT_EQ(merger.getMergedWeight(1, 0, 0), nullptr);
+
+    config.scalingVecPointer = 0;
+    EXPECT_FALSE(merger.merge(2, {config}, manager));
+    EXPECT_EQ(merger.getMergedBytes(), 0);
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/runtime/moeExpertPager.h"
+
+using namespace tensorrt_llm::runtime;
+
+TEST(ExpertResidencyPolicyTest, requiredExpertsEvictTheColdest)
+{
+    ExpertResidencyPolicy policy{8, 3, 0.5F};
+    policy.observe({4, 2, 1, 0, 0, 0, 0, 0});
+    auto loads = policy.require({0, 1, 2});
+    EXPECT_EQ(loads.size(), 3);
+    EXPECT_EQ(policy.getStats().numMisses, 3);
+
+    // Expert 2 is the coldest resident one.
+    policy.observe({4, 2, 0, 3, 0, 0, 0, 0});
+    loads = policy.require({0, 1, 3});
+    ASSERT_EQ(loads.size(), 1);
+    EXPECT_EQ(loads[0].expert, 3);
+    EXPECT_EQ(policy.getSlots()[2], ExpertResidencyPolicy::kNotResident);
+    EXPECT_EQ(policy.getSlots()[3], loads[0].slot);
+
+    // Resident experts are hits.
+    loads = policy.require({0, 3});
+    EXPECT_TRUE(loads.empty());
+    EXPECT_EQ(policy.getStats().numRequired, 8);
+    EXPECT_EQ(policy.getStats().numMisses, 4);
+
+    EXPECT_THROW(static_cast<void>(policy.require({4, 5, 6, 7})), tensorrt_llm::common::TllmException);
+}
+
+TEST(ExpertResidencyPolicyTest, prefetchKeepsTheExpertsOfTheLastStep)
+{
+    ExpertResidencyPolicy policy{6, 3, 0.5F};
+    policy.observe({1, 1, 1, 0, 0, 0});
+    static_cast<void>(policy.require({0, 1, 2}));
+    // Expert 4 got hot while expert 2 cooled down.
+    policy.observe({1, 1, 0, 0, 8, 0});
+    static_cast<void>(policy.require({0, 1}));
+
+    auto const loads = policy.prefetch(2);
+    ASSERT_EQ(loads.size(), 1);
+    EXPECT_EQ(loads[0].expert, 4);
+    EXPECT_EQ(policy.getSlots()[2], ExpertResidencyPolicy::kNotResident);
+    EXPECT_EQ(policy.getStats().numPrefetches, 1);
+
+    // Nothing is hotter than the remaining residents.
+    EXPECT_TRUE(policy.prefetch(2).empty());
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/promptLookupDrafter.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <gtest/gtest.h>
+
+namespace tensorrt_llm::runtime
+{
+
+using VecTokens = PromptLookupDrafter::VecTokens;
+
+TEST(PromptLookupDrafter, copiesContinuationOfLongestSuffix)
+{
+    PromptLookupDrafter drafter(3, 3);
+    // The suffix 2 5 was followed by 6 and by 8, the longer suffix 9 2 5 only by 8.
+    VecTokens tokens{1, 2, 5, 6, 7, 9, 2, 5, 8, 4, 3, 9, 2, 5};
+    EXPECT_EQ(drafter.propose(tokens), (VecTokens{8, 4, 3}));
+    EXPECT_EQ(drafter.getNumIndexedTokens(), 14);
+}
+
+TEST(PromptLookupDrafter, usesMostRecentOccurrence)
+{
+    PromptLookupDrafter drafter(2, 1);
+    VecTokens tokens{1, 2, 3, 1, 4, 5, 1};
+    EXPECT_EQ(drafter.propose(tokens), (VecTokens{4, 5}));
+}
+
+TEST(PromptLookupDrafter, draftIsCutAtEndOfSequence)
+{
+    PromptLookupDrafter drafter(4, 2);
+    VecTokens tokens{7, 8, 9, 7, 8};
+    EXPECT_EQ(drafter.propose(tokens), (VecTokens{9, 7, 8}));
+}
+
+TEST(PromptLookupDrafter, incrementalUpdate)
+{
+    PromptLookupDrafter drafter(2, 2);
+    VecTokens tokens{1, 2, 3, 4};
+    EXPECT_TRUE(drafter.propose(tokens).empty());
+
+    // The accepted tokens are indexed as they are appended.
+    tokens.insert(tokens.end(), {2, 3});
+    EXPECT_EQ(drafter.propose(tokens), (VecTokens{4, 2}));
+    tokens.push_back(9);
+    EXPECT_TRUE(drafter.propose(tokens).empty());
+
+    tokens.pop_back();
+    tokens.pop_back();
+    EXPECT_THROW(drafter.update(tokens), common::TllmException);
+}
+
+TEST(PromptLookupDrafter, invalidConfig)
+{
+    EXPECT_THROW(PromptLookupDrafter(0), common::TllmException);
+    EXPECT_THROW(PromptLookupDrafter(2, 1, 2), common::TllmException);
+}
+
+} // namespace tensorrt_llm::runtime
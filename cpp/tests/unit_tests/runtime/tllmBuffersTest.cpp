@@ -128,6 +128,25 @@ TEST_F(TllmBuffersTest, HostAllocator)
     EXPECT_EQ(allocator.getMemoryType(), MemoryType::kCPU);
 }
 
+TEST_F(TllmBuffersTest, MemoryCountersPeaks)
+{
+    auto constexpr size = 1024;
+    HostAllocator allocator{};
+    auto& counters = MemoryCounters::getInstance();
+    counters.resetPeaks();
+    auto const peakBefore = counters.getCpuPeak();
+    EXPECT_EQ(peakBefore, counters.getCpu());
+    auto first = allocator.allocate(size);
+    auto second = allocator.allocate(size);
+    EXPECT_EQ(counters.getCpuPeak(), peakBefore + 2 * size);
+    allocator.deallocate(second, size);
+    EXPECT_EQ(counters.getCpuPeak(), peakBefore + 2 * size);
+    counters.resetPeaks();
+    EXPECT_EQ(counters.getCpuPeak(), peakBefore + size);
+    allocator.deallocate(first, size);
+    EXPECT_EQ(counters.getCpuPeak(), peakBefore + size);
+}
+
 TEST_F(TllmBuffersTest, UVMAllocator)
 {
     auto constexpr size = 1024;
@@ -15,10 +15,13 @@
  */
 
 #include "tensorrt_llm/common/mpiUtils.h"
+#include "tensorrt_llm/common/tllmException.h"
 #include "tensorrt_llm/kernels/userbuffers/ub_interface.h"
 
 #include <gtest/gtest.h>
 
+#include <vector>
+
 namespace mpi = tensorrt_llm::mpi;
 namespace tr = tensorrt_llm::runtime;
 
@@ -47,3 +50,42 @@ TEST(UserBuffer, basic)
     tr::ub::ub_deallocate(p0);
     tr::ub::ub_deallocate(p1);
 }
+
+TEST(UserBuffer, poolReusesAndGrows)
+{
+    size_t constexpr granularity = 1024;
+    std::vector<std::vector<char>> regions;
+    regions.reserve(4);
+    auto registerBuffer = [&regions](size_t bytes)
+    {
+        regions.emplace_back(bytes);
+        return tr::ub::UBBuffer(regions.back().data(), static_cast<int>(regions.size()), bytes);
+    };
+    tr::ub::UBBufferPool pool(registerBuffer, granularity, 3);
+
+    // New buffers are rounded up to a power of two of the granularity.
+    auto small = pool.acquire(100);
+    EXPECT_EQ(small.size, granularity);
+    auto large = pool.acquire(3 * granularity);
+    EXPECT_EQ(large.size, 4 * granularity);
+    EXPECT_EQ(pool.num_buffers(), 2);
+    EXPECT_EQ(pool.in_use_bytes(), 5 * granularity);
+
+    // A released buffer is reused by the next tensor that fits, the smallest one first.
+    pool.release(large);
+    pool.release(small);
+    EXPECT_EQ(pool.in_use_bytes(), 0);
+    auto reused = pool.acquire(granularity);
+    EXPECT_EQ(reused.addr, small.addr);
+    auto reusedLarge = pool.acquire(2 * granularity);
+    EXPECT_EQ(reusedLarge.addr, large.addr);
+    EXPECT_EQ(pool.num_buffers(), 2);
+    EXPECT_EQ(pool.registered_bytes(), 5 * granularity);
+
+    // A tensor larger than the free buffers registers a new one, up to the number of regions.
+    pool.release(reused);
+    auto grown = pool.acquire(5 * granularity);
+    EXPECT_EQ(grown.size, 8 * granularity);
+    EXPECT_EQ(pool.num_buffers(), 3);
+    EXPECT_THROW(pool.acquire(16 * granularity), tensorrt_llm::common::TllmException);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/runtime/weightStreamingScheduler.h"
+
+using namespace tensorrt_llm::runtime;
+
+TEST(LayerResidencyPolicyTest, theFirstLayersStartResident)
+{
+    LayerResidencyPolicy const policy{4, LayerResidencyPolicy::Config{2}};
+    EXPECT_EQ(policy.getNumResident(), 2);
+    EXPECT_TRUE(policy.isResident(0));
+    EXPECT_TRUE(policy.isResident(1));
+    EXPECT_FALSE(policy.isResident(2));
+
+    LayerResidencyPolicy const allResident{2, LayerResidencyPolicy::Config{4}};
+    EXPECT_EQ(allResident.getNumResident(), 2);
+}
+
+TEST(LayerResidencyPolicyTest, layersThatStallTheMostReplaceTheOthers)
+{
+    LayerResidencyPolicy policy{4, LayerResidencyPolicy::Config{2, 0.5F, 0.1F, 2}};
+    // Layer 2 waits 2 ms for its weights, layer 3 0.2 ms, the resident layers would wait 1.1 ms.
+    auto const migrations = policy.update({1.F, 1.F, 3.F, 1.2F});
+    EXPECT_EQ(migrations.promotions, (std::vector<SizeType32>{2}));
+    EXPECT_EQ(migrations.demotions, (std::vector<SizeType32>{0}));
+    EXPECT_NEAR(policy.getStallMs(2), 2.F, 1e-5F);
+    EXPECT_NEAR(policy.getStallMs(3), 0.2F, 1e-5F);
+    EXPECT_TRUE(policy.isResident(2));
+    EXPECT_FALSE(policy.isResident(0));
+    EXPECT_EQ(policy.getNumResident(), 2);
+
+    // Close stalls do not swap back.
+    auto const again = policy.update({2.2F, 1.F, 1.F, 1.2F});
+    EXPECT_TRUE(again.promotions.empty());
+    EXPECT_TRUE(again.demotions.empty());
+}
+
+TEST(LayerResidencyPolicyTest, migrationsAreLimited)
+{
+    LayerResidencyPolicy policy{6, LayerResidencyPolicy::Config{2, 0.5F, 0.1F, 1}};
+    // Layers 2 and 3 both stall more than the resident layers, one of them is promoted.
+    auto const migrations = policy.update({1.F, 1.F, 6.F, 6.F, 1.F, 1.F});
+    EXPECT_EQ(migrations.promotions.size(), 1);
+    EXPECT_EQ(migrations.demotions.size(), 1);
+
+    // Layers the step did not report keep their estimates.
+    auto const unreported = policy.update({-1.F, -1.F, -1.F, -1.F, -1.F, -1.F});
+    EXPECT_EQ(unreported.promotions.size(), 1);
+    EXPECT_EQ(policy.getNumResident(), 2);
+    EXPECT_THROW(static_cast<void>(policy.update({1.F})), tensorrt_llm::common::TllmException);
+}
+
+TEST(WeightStreamingSchedulerTest, layerIdxOfWeightsAndEngineLayers)
+{
+    EXPECT_EQ(WeightStreamingScheduler::getLayerIdx("transformer.layers.12.mlp.fc.weight"), 12);
+    EXPECT_EQ(WeightStreamingScheduler::getLayerIdx("transformer/layers/3/attention/qkv/MATMUL"), 3);
+    EXPECT_EQ(WeightStreamingScheduler::getLayerIdx("transformer.layers.7"), 7);
+    EXPECT_FALSE(WeightStreamingScheduler::getLayerIdx("lm_head.weight").has_value());
+    EXPECT_FALSE(WeightStreamingScheduler::getLayerIdx("transformer.num_layers").has_value());
+    EXPECT_FALSE(WeightStreamingScheduler::getLayerIdx("transformer.layers_norm.weight").has_value());
+    EXPECT_FALSE(WeightStreamingScheduler::getLayerIdx("transformer.layers.1a.weight").has_value());
+}
@@ -17,7 +17,13 @@
 #include "tensorrt_llm/runtime/workerPool.h"
 
 #include <gtest/gtest.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iostream>
 #include <random>
+#include <stdexcept>
 
 namespace tensorrt_llm::runtime
 {
@@ -70,6 +76,109 @@ TEST(WorkerPool, voidReturn)
     EXPECT_EQ(returnVal3, 10003);
 }
 
+TEST(WorkerPool, highPriorityFirst)
+{
+    WorkerPool pool(1);
+    std::promise<void> release;
+    auto blocker = pool.enqueue([released = release.get_future().share()]() { released.wait(); });
+
+    std::mutex mutex;
+    std::vector<int> order;
+    auto record = [&](int value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(value);
+    };
+    auto f1 = pool.enqueue([&]() { record(1); });
+    auto f2 = pool.enqueue([&]() { record(2); });
+    auto f3 = pool.enqueue([&]() { record(3); }, WorkerPool::Priority::kHIGH);
+    release.set_value();
+    blocker.get();
+    f1.get();
+    f2.get();
+    f3.get();
+
+    EXPECT_EQ(order, (std::vector<int>{3, 1, 2}));
+}
+
+TEST(WorkerPool, nestedTasksAreStolen)
+{
+    auto constexpr numSubtasks = 32;
+    WorkerPool pool(4);
+    // The subtasks go to the queue of the worker that waits for them, so only the other workers can run them.
+    auto parent = pool.enqueue(
+        [&pool]()
+        {
+            std::vector<std::future<int>> subtasks;
+            for (int i = 0; i < numSubtasks; ++i)
+            {
+                subtasks.push_back(pool.enqueue(
+                    [i]()
+                    {
+                        std::this_thread::sleep_for(std::chrono::microseconds(100));
+                        return i;
+                    }));
+            }
+            int sum = 0;
+            for (auto& subtask : subtasks)
+            {
+                sum += subtask.get();
+            }
+            return sum;
+        });
+
+    EXPECT_EQ(parent.get(), numSubtasks * (numSubtasks - 1) / 2);
+    EXPECT_GE(pool.getNumStolen(), static_cast<std::size_t>(numSubtasks));
+}
+
+TEST(WorkerPool, moveOnlyAndDetachedTasks)
+{
+    std::atomic<int> counter{0};
+    {
+        WorkerPool pool(2);
+        auto value = std::make_unique<int>(42);
+        auto f = pool.enqueue([value = std::move(value)]() { return *value; });
+        EXPECT_EQ(f.get(), 42);
+
+        // Larger than the inline storage of a task.
+        std::array<std::int64_t, 16> payload{};
+        payload.fill(1);
+        for (int i = 0; i < 100; ++i)
+        {
+            pool.enqueueDetached([&counter]() { ++counter; });
+            pool.enqueueDetached([&counter, payload]() { counter += static_cast<int>(payload[15]); });
+        }
+        pool.enqueueDetached([]() { throw std::runtime_error("logged, not propagated"); });
+    }
+    // The pool runs the pending tasks before it is destroyed.
+    EXPECT_EQ(counter, 200);
+}
+
+TEST(WorkerPool, throughput)
+{
+    auto constexpr numTasks = 20000;
+    for (std::size_t numWorkers : {1, 4})
+    {
+        WorkerPool pool(numWorkers);
+        std::atomic<int> counter{0};
+        auto const start = std::chrono::steady_clock::now();
+        for (int i = 0; i < numTasks; ++i)
+        {
+            pool.enqueueDetached([&counter]() { ++counter; });
+        }
+        auto last = pool.enqueue([]() {});
+        last.get();
+        while (counter < numTasks)
+        {
+            std::this_thread::yield();
+        }
+        auto const elapsed
+            = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        // Reported to compare the pool implementations, not checked.
+        std::cout << numWorkers << " workers: " << elapsed / numTasks << " us per task" << std::endl;
+    }
+}
+
 class WorkerPoolTest : public ::testing::TestWithParam<std::tuple<int, int>>
 {
 protected: